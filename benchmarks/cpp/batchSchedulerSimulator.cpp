@@ -0,0 +1,533 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2022-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tensorrt_llm/batch_manager/batchScheduler.h"
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/samplingConfig.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cxxopts.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <numeric>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace tensorrt_llm::batch_manager;
+using namespace tensorrt_llm::runtime;
+
+namespace tc = tensorrt_llm::common;
+
+namespace
+{
+
+// Work of one iteration of the batch manager
+struct StepShape
+{
+    SizeType numContextRequests{0};
+    // Prompt tokens computed, without the ones found in the KV cache
+    SizeType numContextTokens{0};
+    SizeType numGenerationRequests{0};
+    // Tokens in the KV cache of the generation requests, read by the attention
+    SizeType numGenerationKvTokens{0};
+};
+
+// Predicts the duration of an iteration from the shape of its batch
+class StepLatencyModel
+{
+public:
+    virtual ~StepLatencyModel() = default;
+
+    [[nodiscard]] virtual double getStepMs(StepShape const& shape) const = 0;
+};
+
+// Fixed cost of an iteration plus a cost per context token, per generation request and per token of KV cache read.
+// The coefficients are fitted on gptSessionBenchmark runs by fit_step_latency.py.
+class LinearStepLatencyModel : public StepLatencyModel
+{
+public:
+    explicit LinearStepLatencyModel(nlohmann::json const& json)
+        : mBaseMs(json.at("base_ms"))
+        , mContextTokenMs(json.at("context_token_ms"))
+        , mGenerationRequestMs(json.at("generation_request_ms"))
+        , mKvTokenMs(json.at("kv_token_ms"))
+    {
+    }
+
+    [[nodiscard]] double getStepMs(StepShape const& shape) const override
+    {
+        return mBaseMs + mContextTokenMs * shape.numContextTokens + mGenerationRequestMs * shape.numGenerationRequests
+            + mKvTokenMs * shape.numGenerationKvTokens;
+    }
+
+private:
+    double mBaseMs;
+    double mContextTokenMs;
+    double mGenerationRequestMs;
+    double mKvTokenMs;
+};
+
+std::unique_ptr<StepLatencyModel> makeStepLatencyModel(std::filesystem::path const& modelPath)
+{
+    TLLM_CHECK_WITH_INFO(std::filesystem::exists(modelPath), "File does not exist: %s", modelPath.string().c_str());
+    std::ifstream jsonStream(modelPath);
+    auto const json = nlohmann::json::parse(jsonStream);
+    auto const type = json.value("type", std::string{"linear"});
+    if (type == "linear")
+    {
+        return std::make_unique<LinearStepLatencyModel>(json);
+    }
+    TLLM_THROW("Unexpected latency model type: %s", type.c_str());
+}
+
+std::pair<std::vector<std::vector<int32_t>>, std::vector<int32_t>> parseDataset(
+    std::filesystem::path const& datasetPath)
+{
+    auto constexpr allowExceptions = true;
+    auto constexpr ingoreComments = true;
+    TLLM_CHECK_WITH_INFO(std::filesystem::exists(datasetPath), "File does not exist: %s", datasetPath.string().c_str());
+    std::ifstream jsonStream(datasetPath);
+    auto json = nlohmann::json::parse(jsonStream, nullptr, allowExceptions, ingoreComments);
+
+    std::vector<std::vector<int32_t>> inputIds;
+    std::vector<int32_t> outputIds;
+    for (auto& sample : json)
+    {
+        inputIds.push_back(sample["input_ids"]);
+        outputIds.push_back(sample["output_len"]);
+    }
+    return std::make_pair(inputIds, outputIds);
+}
+
+// Same arrivals as gptManagerBenchmark: replayed from a trace, a Poisson process of the given rate, or all the requests
+// at once
+std::vector<double> makeArrivalTimes(
+    std::size_t numSamples, std::optional<float> const& requestRate, std::string const& tracePath)
+{
+    if (!tracePath.empty())
+    {
+        TLLM_CHECK_WITH_INFO(std::filesystem::exists(tracePath), "File does not exist: %s", tracePath.c_str());
+        std::ifstream jsonStream(tracePath);
+        std::vector<double> arrivalTimes = nlohmann::json::parse(jsonStream);
+        TLLM_CHECK_WITH_INFO(std::is_sorted(arrivalTimes.begin(), arrivalTimes.end()),
+            "Arrival times of %s are not sorted", tracePath.c_str());
+        TLLM_CHECK_WITH_INFO(arrivalTimes.size() >= numSamples, "Trace has %lu arrival times for %lu samples",
+            arrivalTimes.size(), numSamples);
+        arrivalTimes.resize(numSamples);
+        return arrivalTimes;
+    }
+
+    std::vector<double> arrivalTimes(numSamples, 0.0);
+    if (requestRate)
+    {
+        TLLM_CHECK_WITH_INFO(requestRate.value() > 0, "Request rate must be positive");
+        std::mt19937 gen(0);
+        std::exponential_distribution<double> interArrival(requestRate.value());
+        double time = 0.0;
+        for (auto& arrivalTime : arrivalTimes)
+        {
+            arrivalTime = time;
+            time += interArrival(gen);
+        }
+    }
+    return arrivalTimes;
+}
+
+struct SchedulerConfig
+{
+    batch_scheduler::SchedulerPolicy schedulerPolicy;
+    SizeType maxNumSequences;
+    SizeType maxTokensInPagedKvCache;
+    SizeType tokensPerBlock;
+    bool enableBlockReuse;
+};
+
+struct RequestTimes
+{
+    double arrival{0};
+    std::optional<double> firstToken;
+    double end{0};
+};
+
+struct SimulationResult
+{
+    double durationMs{0};
+    std::size_t numSteps{0};
+    std::size_t numGeneratedTokens{0};
+    // Requests evicted from the KV cache by the MAX_UTILIZATION policy, and the tokens computed again when they resume
+    std::size_t numPauses{0};
+    std::size_t numRecomputedTokens{0};
+    std::size_t numReusedTokens{0};
+    double sumBatchSize{0};
+    double sumKvCacheUtilization{0};
+    std::vector<RequestTimes> requestTimes;
+};
+
+// Replays the arrivals through the BatchScheduler and the KVCacheManager of the batch manager, advancing the clock by
+// the predicted duration of every iteration instead of running the model. Mirrors the request lifecycle of GptManager:
+// paused requests release their KV cache and slot and are computed again from their prompt and generated tokens.
+SimulationResult simulate(SchedulerConfig const& config, std::vector<std::vector<int32_t>> const& inputIds,
+    std::vector<int32_t> const& outputLengths, std::vector<double> const& arrivalTimes,
+    StepLatencyModel const& latencyModel, SizeType maxInputLen, SizeType maxSeqLen)
+{
+    auto const numSamples = inputIds.size();
+    auto const maxNumBlocks = tc::ceilDiv(config.maxTokensInPagedKvCache, config.tokensPerBlock);
+    auto const maxBlocksPerSeq = tc::ceilDiv(maxSeqLen, config.tokensPerBlock);
+    // The scheduler only counts blocks, so the KV cache holds one element per token of a single head and layer
+    SizeType constexpr numLayers = 1;
+    SizeType constexpr numHeads = 1;
+    SizeType constexpr hiddenSize = 1;
+    SizeType constexpr beamWidth = 1;
+    auto kvCacheManager = std::make_shared<kv_cache_manager::KVCacheManager>(numLayers, numHeads, numHeads, hiddenSize,
+        config.tokensPerBlock, maxNumBlocks, config.maxNumSequences, beamWidth, maxBlocksPerSeq, maxSeqLen,
+        nvinfer1::DataType::kHALF, std::make_shared<CudaStream>(), config.enableBlockReuse);
+    batch_scheduler::BatchScheduler scheduler{config.maxNumSequences, kvCacheManager, config.schedulerPolicy};
+
+    SimulationResult result;
+    result.requestTimes.resize(numSamples);
+    std::vector<SizeType> freeSlots(config.maxNumSequences);
+    std::iota(freeSlots.rbegin(), freeSlots.rend(), 0);
+    batch_scheduler::BatchScheduler::RequestList activeRequests;
+    std::size_t nextArrival = 0;
+    std::size_t numFinished = 0;
+    double timeMs = 0;
+
+    auto const releaseSlot = [&](std::shared_ptr<LlmRequest> const& request)
+    {
+        kvCacheManager->removeSequence(request->mSeqSlot, request);
+        freeSlots.push_back(request->mSeqSlot);
+    };
+
+    while (numFinished < numSamples)
+    {
+        for (; nextArrival < numSamples && arrivalTimes[nextArrival] * 1000 <= timeMs; ++nextArrival)
+        {
+            auto tokens = std::make_shared<std::vector<int32_t>>(inputIds[nextArrival]);
+            activeRequests.push_back(std::make_shared<LlmRequest>(
+                nextArrival, outputLengths[nextArrival], tokens, SamplingConfig{beamWidth}, false));
+            result.requestTimes[nextArrival].arrival = arrivalTimes[nextArrival] * 1000;
+        }
+        if (activeRequests.empty())
+        {
+            timeMs = arrivalTimes[nextArrival] * 1000;
+            continue;
+        }
+
+        kvCacheManager->startScheduling();
+        auto const [scheduledRequests, pausedRequests] = scheduler.scheduleRequests(activeRequests);
+        for (auto const& [requestId, request] : pausedRequests)
+        {
+            releaseSlot(request);
+            auto const numTokens = request->getNumTokens(0);
+            request->pause(maxInputLen);
+            ++result.numPauses;
+            result.numRecomputedTokens += std::min(numTokens, request->mPromptLen);
+        }
+
+        StepShape shape;
+        std::vector<std::shared_ptr<LlmRequest>> stepRequests;
+        for (auto const& request : scheduledRequests)
+        {
+            if (request->mState == REQUEST_STATE_CONTEXT_INIT)
+            {
+                if (freeSlots.empty())
+                {
+                    continue;
+                }
+                request->mSeqSlot = freeSlots.back();
+                freeSlots.pop_back();
+                kvCacheManager->addSequence(request->mSeqSlot, request->mPromptLen, beamWidth, request);
+                auto const numReusedTokens = kvCacheManager->getNumPrepopulatedTokens(request->mSeqSlot, 0);
+                result.numReusedTokens += numReusedTokens;
+                ++shape.numContextRequests;
+                shape.numContextTokens += request->mPromptLen - numReusedTokens;
+            }
+            else
+            {
+                kvCacheManager->addToken(request->mSeqSlot);
+                ++shape.numGenerationRequests;
+                shape.numGenerationKvTokens += request->getNumTokens(0);
+            }
+            stepRequests.push_back(request);
+        }
+        if (stepRequests.empty())
+        {
+            if (!pausedRequests.empty())
+            {
+                continue;
+            }
+            TLLM_CHECK_WITH_INFO(nextArrival < numSamples, "No active request fits in the KV cache");
+            timeMs = std::max(timeMs, arrivalTimes[nextArrival] * 1000);
+            continue;
+        }
+
+        timeMs += latencyModel.getStepMs(shape);
+        ++result.numSteps;
+        result.sumBatchSize += stepRequests.size();
+        result.sumKvCacheUtilization
+            += static_cast<double>(kvCacheManager->getUsedNumBlocks()) / kvCacheManager->getMaxNumBlocks();
+
+        for (auto const& request : stepRequests)
+        {
+            request->mState = REQUEST_STATE_GENERATION_IN_PROGRESS;
+            request->addNewToken(0, 0);
+            ++result.numGeneratedTokens;
+            auto& times = result.requestTimes[request->mRequestId];
+            if (!times.firstToken)
+            {
+                times.firstToken = timeMs;
+            }
+            if (request->getMaxNumGeneratedTokens() >= request->mMaxNewTokens)
+            {
+                request->mState = REQUEST_STATE_GENERATION_COMPLETE;
+                releaseSlot(request);
+                times.end = timeMs;
+                ++numFinished;
+            }
+        }
+        activeRequests.remove_if([](auto const& request)
+            { return request->mState == REQUEST_STATE_GENERATION_COMPLETE; });
+    }
+    result.durationMs = timeMs;
+    return result;
+}
+
+struct LatencyStats
+{
+    double average{0};
+    double p50{0};
+    double p90{0};
+    double p99{0};
+};
+
+LatencyStats calculateStats(std::vector<double> values)
+{
+    LatencyStats stats;
+    if (values.empty())
+    {
+        return stats;
+    }
+    std::sort(values.begin(), values.end());
+    // Nearest-rank percentile
+    auto const percentile = [&values](double p)
+    {
+        auto const rank = static_cast<std::size_t>(std::ceil(p / 100 * values.size()));
+        return values[std::max<std::size_t>(rank, 1) - 1];
+    };
+    stats.average = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+    stats.p50 = percentile(50);
+    stats.p90 = percentile(90);
+    stats.p99 = percentile(99);
+    return stats;
+}
+
+void report(SchedulerConfig const& config, SimulationResult const& result)
+{
+    std::vector<double> latencies;
+    std::vector<double> firstTokenLatencies;
+    for (auto const& times : result.requestTimes)
+    {
+        latencies.push_back(times.end - times.arrival);
+        firstTokenLatencies.push_back(times.firstToken.value_or(times.end) - times.arrival);
+    }
+    auto const latency = calculateStats(latencies);
+    auto const firstTokenLatency = calculateStats(firstTokenLatencies);
+    auto const numRequests = result.requestTimes.size();
+    auto const numSteps = std::max<std::size_t>(result.numSteps, 1);
+
+    auto const* policy = config.schedulerPolicy == batch_scheduler::SchedulerPolicy::MAX_UTILIZATION
+        ? "max_utilization"
+        : "guaranteed_no_evict";
+    printf("[BENCHMARK] scheduler_policy %s max_num_sequences %d max_tokens_in_paged_kvcache %d tokens_per_block %d\n",
+        policy, config.maxNumSequences, config.maxTokensInPagedKvCache, config.tokensPerBlock);
+    printf("[BENCHMARK] num_samples %lu\n", numRequests);
+    printf("[BENCHMARK] total_latency(ms) %.2f\n", result.durationMs);
+    printf("[BENCHMARK] seq_throughput(seq/sec) %.2f\n", numRequests / (result.durationMs / 1000));
+    printf("[BENCHMARK] token_throughput(token/sec) %.2f\n", result.numGeneratedTokens / (result.durationMs / 1000));
+    printf("[BENCHMARK] avg_sequence_latency(ms) %.2f p50 %.2f p90 %.2f p99 %.2f\n", latency.average, latency.p50,
+        latency.p90, latency.p99);
+    printf("[BENCHMARK] avg_time_to_first_token(ms) %.2f p50 %.2f p90 %.2f p99 %.2f\n", firstTokenLatency.average,
+        firstTokenLatency.p50, firstTokenLatency.p90, firstTokenLatency.p99);
+    printf("[BENCHMARK] num_steps %lu avg_batch_size %.2f avg_kv_cache_utilization %.4f\n", result.numSteps,
+        result.sumBatchSize / numSteps, result.sumKvCacheUtilization / numSteps);
+    printf("[BENCHMARK] num_pauses %lu eviction_rate %.4f recomputed_tokens %lu\n", result.numPauses,
+        static_cast<double>(result.numPauses) / numRequests, result.numRecomputedTokens);
+    if (config.enableBlockReuse)
+    {
+        printf("[BENCHMARK] reused_tokens %lu\n", result.numReusedTokens);
+    }
+}
+
+std::vector<int> parseList(std::string const& arg)
+{
+    std::istringstream ss(arg);
+    std::vector<int> values;
+    for (std::string token; std::getline(ss, token, ';');)
+    {
+        values.push_back(std::stoi(token));
+    }
+    return values;
+}
+
+std::vector<batch_scheduler::SchedulerPolicy> parsePolicies(std::string const& arg)
+{
+    std::istringstream ss(arg);
+    std::vector<batch_scheduler::SchedulerPolicy> policies;
+    for (std::string token; std::getline(ss, token, ';');)
+    {
+        if (token == "max_utilization")
+        {
+            policies.push_back(batch_scheduler::SchedulerPolicy::MAX_UTILIZATION);
+        }
+        else if (token == "guaranteed_no_evict")
+        {
+            policies.push_back(batch_scheduler::SchedulerPolicy::GUARANTEED_NO_EVICT);
+        }
+        else
+        {
+            TLLM_THROW("Unexpected scheduler policy: %s", token.c_str());
+        }
+    }
+    return policies;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    cxxopts::Options options("TensorRT-LLM Batch Scheduler Simulator",
+        "Predicts the throughput, latency and evictions of in-flight batching for a dataset and an arrival process "
+        "without running the model. Multiple values of the scheduler options can be separated by \";\", all their "
+        "combinations are simulated.");
+    options.add_options()("h,help", "Print usage");
+    options.add_options()("dataset", "Dataset prepared by prepare_dataset.py.", cxxopts::value<std::string>());
+    options.add_options()("latency_model", "JSON step latency model, as written by fit_step_latency.py.",
+        cxxopts::value<std::string>());
+    options.add_options()("scheduler_policy", "Scheduler policies among max_utilization/guaranteed_no_evict.",
+        cxxopts::value<std::string>()->default_value("guaranteed_no_evict"));
+    options.add_options()(
+        "max_num_sequences", "Max numbers of sequences.", cxxopts::value<std::string>()->default_value("64"));
+    options.add_options()("max_tokens_in_paged_kvcache", "Max tokens in paged K-V Cache.",
+        cxxopts::value<std::string>()->default_value("65536"));
+    options.add_options()(
+        "tokens_per_block", "Tokens per KV cache block.", cxxopts::value<std::string>()->default_value("64"));
+    options.add_options()("enable_kv_cache_reuse", "Enables the KV cache reuse.");
+    options.add_options()("max_input_len",
+        "Max prompt length of the engine, the longest prompt of the dataset if unset.", cxxopts::value<int>());
+    options.add_options()("request_rate",
+        "Requests per second of a Poisson arrival process, all the requests arrive at once if unset.",
+        cxxopts::value<float>());
+    options.add_options()("trace", "JSON list of the arrival times of the requests in seconds, overrides request_rate.",
+        cxxopts::value<std::string>()->default_value(""));
+    options.add_options()("log_level", "Choose log level between verbose/info/warning/error/internal_error.",
+        cxxopts::value<std::string>()->default_value("error"));
+
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help"))
+    {
+        std::cout << options.help() << std::endl;
+        exit(0);
+    }
+
+    if (!result.count("dataset") || !result.count("latency_model"))
+    {
+        TLLM_LOG_ERROR("Please specify the dataset and the latency model.");
+        return 1;
+    }
+
+    auto const logLevel = result["log_level"].as<std::string>();
+    auto* logger = tc::Logger::getLogger();
+    if (logLevel == "verbose")
+    {
+        logger->setLevel(tc::Logger::TRACE);
+    }
+    else if (logLevel == "info")
+    {
+        logger->setLevel(tc::Logger::INFO);
+    }
+    else if (logLevel == "warning")
+    {
+        logger->setLevel(tc::Logger::WARNING);
+    }
+    else if (logLevel == "error" || logLevel == "internal_error")
+    {
+        logger->setLevel(tc::Logger::ERROR);
+    }
+    else
+    {
+        TLLM_LOG_ERROR("Unexpected log level: " + logLevel);
+        return 1;
+    }
+
+    try
+    {
+        auto const [inputIds, outputLengths] = parseDataset(result["dataset"].as<std::string>());
+        auto const latencyModel = makeStepLatencyModel(result["latency_model"].as<std::string>());
+        std::optional<float> requestRate;
+        if (result.count("request_rate"))
+        {
+            requestRate = result["request_rate"].as<float>();
+        }
+        auto const arrivalTimes = makeArrivalTimes(inputIds.size(), requestRate, result["trace"].as<std::string>());
+
+        SizeType maxPromptLen = 0;
+        SizeType maxSeqLen = 0;
+        for (std::size_t i = 0; i < inputIds.size(); ++i)
+        {
+            auto const promptLen = static_cast<SizeType>(inputIds[i].size());
+            maxPromptLen = std::max(maxPromptLen, promptLen);
+            maxSeqLen = std::max(maxSeqLen, promptLen + outputLengths[i]);
+        }
+        auto const maxInputLen = result.count("max_input_len") ? result["max_input_len"].as<int>() : maxPromptLen;
+
+        for (auto const schedulerPolicy : parsePolicies(result["scheduler_policy"].as<std::string>()))
+        {
+            for (auto const maxNumSequences : parseList(result["max_num_sequences"].as<std::string>()))
+            {
+                for (auto const maxTokens : parseList(result["max_tokens_in_paged_kvcache"].as<std::string>()))
+                {
+                    for (auto const tokensPerBlock : parseList(result["tokens_per_block"].as<std::string>()))
+                    {
+                        SchedulerConfig const config{schedulerPolicy, maxNumSequences, maxTokens, tokensPerBlock,
+                            result.count("enable_kv_cache_reuse") > 0};
+                        auto const simulation = simulate(
+                            config, inputIds, outputLengths, arrivalTimes, *latencyModel, maxInputLen, maxSeqLen);
+                        report(config, simulation);
+                    }
+                }
+            }
+        }
+    }
+    catch (std::exception const& e)
+    {
+        TLLM_LOG_ERROR(e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,258 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2022-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+
+#include <NvInferVersion.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cxxopts.hpp>
+#include <filesystem>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm::benchmark
+{
+
+//! \brief Distribution of the samples of a metric, e.g. the latencies of the iterations or of the requests.
+struct MetricSummary
+{
+    std::size_t count{0};
+    double mean{0};
+    //! Sample standard deviation, 0 with less than 2 samples
+    double stddev{0};
+    double min{0};
+    double max{0};
+    double p50{0};
+    double p90{0};
+    double p99{0};
+};
+
+inline MetricSummary summarize(std::vector<double> samples)
+{
+    MetricSummary summary;
+    summary.count = samples.size();
+    if (samples.empty())
+    {
+        return summary;
+    }
+    std::sort(samples.begin(), samples.end());
+    // Nearest-rank percentile
+    auto const percentile = [&samples](double p)
+    {
+        auto const rank = static_cast<std::size_t>(std::ceil(p / 100 * samples.size()));
+        return samples[std::clamp<std::size_t>(rank, 1, samples.size()) - 1];
+    };
+    summary.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+    if (samples.size() > 1)
+    {
+        double squares = 0;
+        for (auto const sample : samples)
+        {
+            squares += (sample - summary.mean) * (sample - summary.mean);
+        }
+        summary.stddev = std::sqrt(squares / (samples.size() - 1));
+    }
+    summary.min = samples.front();
+    summary.max = samples.back();
+    summary.p50 = percentile(50);
+    summary.p90 = percentile(90);
+    summary.p99 = percentile(99);
+    return summary;
+}
+
+inline void to_json(nlohmann::json& json, MetricSummary const& summary)
+{
+    json = nlohmann::json{{"count", summary.count}, {"mean", summary.mean}, {"stddev", summary.stddev},
+        {"min", summary.min}, {"max", summary.max}, {"p50", summary.p50}, {"p90", summary.p90}, {"p99", summary.p99}};
+}
+
+inline void from_json(nlohmann::json const& json, MetricSummary& summary)
+{
+    json.at("count").get_to(summary.count);
+    json.at("mean").get_to(summary.mean);
+    json.at("stddev").get_to(summary.stddev);
+    json.at("min").get_to(summary.min);
+    json.at("max").get_to(summary.max);
+    json.at("p50").get_to(summary.p50);
+    json.at("p90").get_to(summary.p90);
+    json.at("p99").get_to(summary.p99);
+}
+
+//! \brief Every option of the command line, with its default when it is not given.
+inline nlohmann::json makeConfig(cxxopts::ParseResult const& result)
+{
+    nlohmann::json config = nlohmann::json::object();
+    for (auto const& keyValue : result.defaults())
+    {
+        config[keyValue.key()] = keyValue.value();
+    }
+    for (auto const& keyValue : result.arguments())
+    {
+        config[keyValue.key()] = keyValue.value();
+    }
+    config.erase("help");
+    return config;
+}
+
+//! \brief GPU and software versions of the run.
+inline nlohmann::json getEnvironment()
+{
+    int device{0};
+    TLLM_CUDA_CHECK(cudaGetDevice(&device));
+    cudaDeviceProp prop{};
+    TLLM_CUDA_CHECK(cudaGetDeviceProperties(&prop, device));
+    int deviceCount{0};
+    TLLM_CUDA_CHECK(cudaGetDeviceCount(&deviceCount));
+    int driverVersion{0};
+    TLLM_CUDA_CHECK(cudaDriverGetVersion(&driverVersion));
+    int runtimeVersion{0};
+    TLLM_CUDA_CHECK(cudaRuntimeGetVersion(&runtimeVersion));
+    return nlohmann::json{{"gpu", prop.name}, {"sm", prop.major * 10 + prop.minor}, {"num_gpus", deviceCount},
+        {"memory_clock_khz", prop.memoryClockRate}, {"cuda_driver_version", driverVersion},
+        {"cuda_runtime_version", runtimeVersion},
+        {"tensorrt_version",
+            std::to_string(NV_TENSORRT_MAJOR) + "." + std::to_string(NV_TENSORRT_MINOR) + "."
+                + std::to_string(NV_TENSORRT_PATCH)}};
+}
+
+//! \brief Results of a benchmark in JSON, and their comparison with the results of a previous run.
+//!
+//! A result is the set of metrics measured for one configuration of the benchmark, identified by its params, e.g. the
+//! batch size and the sequence lengths. Every metric keeps its samples and their summary, so that a later run can test
+//! whether it changed significantly.
+class BenchmarkReport
+{
+public:
+    BenchmarkReport(std::string const& benchmark, nlohmann::json config)
+        : mJson{{"benchmark", benchmark}, {"config", std::move(config)}, {"environment", getEnvironment()},
+            {"results", nlohmann::json::array()}}
+    {
+    }
+
+    //! \param higherIsBetter Whether an increase of the metric is an improvement, e.g. a throughput.
+    void addMetric(nlohmann::json const& params, std::string const& metric, std::vector<double> const& samples,
+        bool higherIsBetter)
+    {
+        auto& results = mJson["results"];
+        auto result = std::find_if(
+            results.begin(), results.end(), [&params](auto const& result) { return result["params"] == params; });
+        if (result == results.end())
+        {
+            results.push_back({{"params", params}, {"metrics", nlohmann::json::object()}});
+            result = std::prev(results.end());
+        }
+        (*result)["metrics"][metric] = {{"higher_is_better", higherIsBetter}, {"summary", summarize(samples)},
+            {"samples", samples}};
+    }
+
+    [[nodiscard]] nlohmann::json const& toJson() const
+    {
+        return mJson;
+    }
+
+    void write(std::filesystem::path const& path) const
+    {
+        std::ofstream(path) << mJson.dump(4) << std::endl;
+    }
+
+    //! \brief Prints the metrics that are worse than in the baseline, by more than threshold (relative) and with a
+    //! statistically significant difference of their means (Welch's t-test at 95%). Metrics with a single sample,
+    //! such as the throughput of a run, only use the threshold.
+    //! \return The number of regressions.
+    std::size_t compare(std::filesystem::path const& baselinePath, double threshold) const
+    {
+        TLLM_CHECK_WITH_INFO(
+            std::filesystem::exists(baselinePath), "File does not exist: %s", baselinePath.string().c_str());
+        std::ifstream jsonStream(baselinePath);
+        auto const baseline = nlohmann::json::parse(jsonStream);
+
+        std::size_t numRegressions = 0;
+        std::size_t numCompared = 0;
+        for (auto const& result : mJson["results"])
+        {
+            auto const& baselineResults = baseline["results"];
+            auto const baselineResult = std::find_if(baselineResults.begin(), baselineResults.end(),
+                [&result](auto const& baselineResult) { return baselineResult["params"] == result["params"]; });
+            if (baselineResult == baselineResults.end())
+            {
+                continue;
+            }
+            for (auto const& [metric, value] : result["metrics"].items())
+            {
+                if (!(*baselineResult)["metrics"].contains(metric))
+                {
+                    continue;
+                }
+                auto const current = value["summary"].get<MetricSummary>();
+                auto const previous = (*baselineResult)["metrics"][metric]["summary"].get<MetricSummary>();
+                auto const higherIsBetter = value["higher_is_better"].get<bool>();
+                ++numCompared;
+                if (previous.mean == 0)
+                {
+                    continue;
+                }
+                auto const change = (current.mean - previous.mean) / previous.mean;
+                auto const worse = higherIsBetter ? change < -threshold : change > threshold;
+                if (worse && isSignificant(current, previous))
+                {
+                    ++numRegressions;
+                    printf("[BENCHMARK] regression %s %s baseline %.4f current %.4f change(%%) %+.2f\n",
+                        result["params"].dump().c_str(), metric.c_str(), previous.mean, current.mean, change * 100);
+                }
+            }
+        }
+        printf("[BENCHMARK] compared_metrics %lu regressions %lu\n", numCompared, numRegressions);
+        return numRegressions;
+    }
+
+private:
+    static bool isSignificant(MetricSummary const& a, MetricSummary const& b)
+    {
+        if (a.count < 2 || b.count < 2)
+        {
+            return true;
+        }
+        auto const varA = a.stddev * a.stddev / a.count;
+        auto const varB = b.stddev * b.stddev / b.count;
+        if (varA + varB == 0)
+        {
+            return a.mean != b.mean;
+        }
+        auto const t = std::abs(a.mean - b.mean) / std::sqrt(varA + varB);
+        // Welch-Satterthwaite degrees of freedom
+        auto const dof = (varA + varB) * (varA + varB)
+            / (varA * varA / (a.count - 1) + varB * varB / (b.count - 1));
+        // Two-sided 95% quantiles of Student's t distribution for 1 to 30 degrees of freedom
+        static std::array<double, 30> constexpr kQuantiles{12.71, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+            2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069,
+            2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+        auto const index = static_cast<std::size_t>(std::max(std::floor(dof), 1.0));
+        auto const quantile = index <= kQuantiles.size() ? kQuantiles[index - 1] : 1.960;
+        return t > quantile;
+    }
+
+    nlohmann::json mJson;
+};
+
+} // namespace tensorrt_llm::benchmark
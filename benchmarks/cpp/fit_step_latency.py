@@ -0,0 +1,88 @@
+# SPDX-FileCopyrightText: Copyright (c) 2022-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+import argparse
+import json
+import re
+
+import numpy as np
+
+BENCHMARK_LINE = re.compile(
+    r"\[BENCHMARK\] batch_size (\d+) input_length (\d+) output_length (\d+) "
+    r"latency\(ms\) ([\d.]+)")
+
+
+def parse_runs(log_files):
+    runs = []
+    for log_file in log_files:
+        with open(log_file) as f:
+            for line in f:
+                match = BENCHMARK_LINE.search(line)
+                if match:
+                    batch_size, input_len, output_len = map(
+                        int, match.groups()[:3])
+                    runs.append((batch_size, input_len, output_len,
+                                 float(match.group(4))))
+    return runs
+
+
+def fit_linear_model(runs):
+    # A run of gptSessionBenchmark is one context step of batch_size *
+    # input_len tokens and output_len - 1 generation steps of batch_size
+    # requests, the t-th one reading input_len + t tokens of KV cache each.
+    rows = []
+    latencies = []
+    for batch_size, input_len, output_len, latency in runs:
+        num_gen_steps = output_len - 1
+        kv_tokens = batch_size * (num_gen_steps * input_len +
+                                  num_gen_steps * (num_gen_steps + 1) // 2)
+        rows.append([
+            output_len, batch_size * input_len, batch_size * num_gen_steps,
+            kv_tokens
+        ])
+        latencies.append(latency)
+    coefficients, _, rank, _ = np.linalg.lstsq(np.array(rows, dtype=float),
+                                               np.array(latencies),
+                                               rcond=None)
+    if rank < 4:
+        raise ValueError(
+            "The runs do not determine the model, vary the batch size, the "
+            "input length and the output length (including output length 1)")
+    coefficients = np.maximum(coefficients, 0.0)
+    return {
+        'type': 'linear',
+        'base_ms': coefficients[0],
+        'context_token_ms': coefficients[1],
+        'generation_request_ms': coefficients[2],
+        'kv_token_ms': coefficients[3],
+    }
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(
+        description='Fit the step latency model of batchSchedulerSimulator '
+        'on the output of gptSessionBenchmark.')
+    parser.add_argument('logs',
+                        nargs='+',
+                        help='Output files of gptSessionBenchmark runs.')
+    parser.add_argument('--output', type=str, required=True)
+    args = parser.parse_args()
+
+    runs = parse_runs(args.logs)
+    if not runs:
+        raise ValueError('No [BENCHMARK] line found')
+    model = fit_linear_model(runs)
+    with open(args.output, 'w') as f:
+        json.dump(model, f, indent=4)
+    print(json.dumps(model, indent=4))
@@ -14,23 +14,34 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include "benchmarkReport.h"
+#include "rankTiming.h"
 #include "tensorrt_llm/batch_manager/GptManager.h"
 
 #include "tensorrt_llm/batch_manager/inferenceRequest.h"
 #include "tensorrt_llm/batch_manager/namedTensor.h"
+#include "tensorrt_llm/batch_manager/requestReplay.h"
 #include "tensorrt_llm/common/assert.h"
 #include "tensorrt_llm/common/logger.h"
 #include "tensorrt_llm/common/memoryUtils.h"
 #include "tensorrt_llm/common/mpiUtils.h"
 #include "tensorrt_llm/common/stringUtils.h"
 #include "tensorrt_llm/plugins/api/tllmPlugin.h"
+#include "tensorrt_llm/runtime/gptJsonConfig.h"
 #include "tensorrt_llm/runtime/tllmLogger.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
 #include <cxxopts.hpp>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <nlohmann/json.hpp>
+#include <random>
 #include <string>
+#include <thread>
 
 using namespace tensorrt_llm::batch_manager;
 using namespace tensorrt_llm::runtime;
@@ -184,14 +195,29 @@ struct BenchInfo
     int inputLength;
     int outputLength;
     std::chrono::time_point<std::chrono::steady_clock> start;
+    std::chrono::time_point<std::chrono::steady_clock> firstToken;
     std::chrono::time_point<std::chrono::steady_clock> end;
-    float latency; // millisecond
+    bool hasFirstToken{false};
+    float latency;            // millisecond
+    float firstTokenLatency;  // millisecond
+    float timePerOutputToken; // millisecond
+};
+
+struct LatencyStats
+{
+    float average{0};
+    float p50{0};
+    float p90{0};
+    float p99{0};
 };
 
 class Recorder
 {
 public:
-    Recorder() {}
+    explicit Recorder(bool streaming)
+        : mStreaming(streaming)
+    {
+    }
 
     void initialize()
     {
@@ -212,51 +238,150 @@ public:
             "Undefined scalar vector for %s", maxNewTokens.name.c_str());
         auto const outputLength = *bufferCast<SizeType>(*outputLengthTensor);
         auto const start = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lk(mMutex);
         mRequestBenchInfos[requestId] = BenchInfo(inputLength, outputLength, start);
     }
 
+    // Called for every streamed response, only the first one is kept
+    void recordToken(uint64_t requestId)
+    {
+        auto const now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lk(mMutex);
+        auto& info = mRequestBenchInfos[requestId];
+        if (!info.hasFirstToken)
+        {
+            info.firstToken = now;
+            info.hasFirstToken = true;
+        }
+    }
+
     void recordEnd(uint64_t requestId)
     {
-        mRequestBenchInfos[requestId].end = std::chrono::steady_clock::now();
-        mRequestBenchInfos[requestId].latency = std::chrono::duration<float, std::milli>(
-            mRequestBenchInfos[requestId].end - mRequestBenchInfos[requestId].start)
-                                                    .count();
+        auto const end = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lk(mMutex);
+        auto& info = mRequestBenchInfos[requestId];
+        // Without streaming, all the tokens come with the final response
+        if (!info.hasFirstToken)
+        {
+            info.firstToken = end;
+            info.hasFirstToken = true;
+        }
+        info.end = end;
+        info.latency = std::chrono::duration<float, std::milli>(info.end - info.start).count();
+        info.firstTokenLatency = std::chrono::duration<float, std::milli>(info.firstToken - info.start).count();
+        // The first token is generated by the context phase, the others by the generation steps
+        info.timePerOutputToken
+            = info.outputLength > 1 ? (info.latency - info.firstTokenLatency) / (info.outputLength - 1) : 0.F;
     }
 
     void calculateMetrics()
     {
+        std::lock_guard<std::mutex> lk(mMutex);
         mNumSamples = mRequestBenchInfos.size();
         mTotalLatency = std::chrono::duration<float, std::milli>(mEnd - mStart).count();
         mSeqThroughput = mNumSamples / (mTotalLatency / 1000);
-        mAvgSeqLatency = 0;
+        std::vector<float> seqLatencies;
+        std::vector<float> firstTokenLatencies;
+        std::vector<float> timesPerOutputToken;
         int totalOutputTokens = 0;
-        for (auto reqInfo : mRequestBenchInfos)
+        for (auto const& reqInfo : mRequestBenchInfos)
         {
-            mAvgSeqLatency += reqInfo.second.latency;
+            seqLatencies.push_back(reqInfo.second.latency);
+            firstTokenLatencies.push_back(reqInfo.second.firstTokenLatency);
+            timesPerOutputToken.push_back(reqInfo.second.timePerOutputToken);
             totalOutputTokens += reqInfo.second.outputLength;
         }
-        mAvgSeqLatency /= mNumSamples;
+        mSeqLatency = calculateStats(seqLatencies);
+        mFirstTokenLatency = calculateStats(firstTokenLatencies);
+        mTimePerOutputToken = calculateStats(timesPerOutputToken);
         mTokenThroughput = totalOutputTokens / (mTotalLatency / 1000);
     }
 
+    // Distributions of the metrics of report(), the throughputs are a single sample of the whole run
+    void addMetrics(tensorrt_llm::benchmark::BenchmarkReport& report)
+    {
+        std::lock_guard<std::mutex> lk(mMutex);
+        auto const params = nlohmann::json::object();
+        std::vector<double> seqLatencies;
+        std::vector<double> firstTokenLatencies;
+        std::vector<double> timesPerOutputToken;
+        for (auto const& reqInfo : mRequestBenchInfos)
+        {
+            seqLatencies.push_back(reqInfo.second.latency);
+            firstTokenLatencies.push_back(reqInfo.second.firstTokenLatency);
+            timesPerOutputToken.push_back(reqInfo.second.timePerOutputToken);
+        }
+        report.addMetric(params, "seq_throughput", {mSeqThroughput}, true);
+        report.addMetric(params, "token_throughput", {mTokenThroughput}, true);
+        report.addMetric(params, "sequence_latency_ms", seqLatencies, false);
+        if (mStreaming)
+        {
+            report.addMetric(params, "time_to_first_token_ms", firstTokenLatencies, false);
+            report.addMetric(params, "time_per_output_token_ms", timesPerOutputToken, false);
+        }
+    }
+
     void report()
     {
         printf("[BENCHMARK] num_samples(ms) %d\n", mNumSamples);
         printf("[BENCHMARK] total_latency(ms) %.2f\n", mTotalLatency);
         printf("[BENCHMARK] seq_throughput(seq/sec) %.2f\n", mSeqThroughput);
-        printf("[BENCHMARK] avg_sequence_latency(ms) %.2f\n", mAvgSeqLatency);
+        reportStats("sequence_latency", mSeqLatency);
         printf("[BENCHMARK] token_throughput(token/sec) %.2f\n", mTokenThroughput);
+        if (mStreaming)
+        {
+            reportStats("time_to_first_token", mFirstTokenLatency);
+            reportStats("time_per_output_token", mTimePerOutputToken);
+        }
     }
 
 private:
+    static LatencyStats calculateStats(std::vector<float> values)
+    {
+        LatencyStats stats;
+        if (values.empty())
+        {
+            return stats;
+        }
+        std::sort(values.begin(), values.end());
+        // Nearest-rank percentile
+        auto const percentile = [&values](float p)
+        {
+            auto const rank = static_cast<std::size_t>(std::ceil(p / 100.F * values.size()));
+            return values[std::clamp<std::size_t>(rank, 1, values.size()) - 1];
+        };
+        for (auto const value : values)
+        {
+            stats.average += value;
+        }
+        stats.average /= values.size();
+        stats.p50 = percentile(50);
+        stats.p90 = percentile(90);
+        stats.p99 = percentile(99);
+        return stats;
+    }
+
+    static void reportStats(char const* name, LatencyStats const& stats)
+    {
+        printf("[BENCHMARK] avg_%s(ms) %.2f\n", name, stats.average);
+        printf("[BENCHMARK] p50_%s(ms) %.2f\n", name, stats.p50);
+        printf("[BENCHMARK] p90_%s(ms) %.2f\n", name, stats.p90);
+        printf("[BENCHMARK] p99_%s(ms) %.2f\n", name, stats.p99);
+    }
+
+    bool mStreaming;
     std::unordered_map<uint64_t, BenchInfo> mRequestBenchInfos;
+    // The responses are recorded by the batch manager thread while requests arrive
+    std::mutex mMutex;
 
     std::chrono::time_point<std::chrono::steady_clock> mStart;
     std::chrono::time_point<std::chrono::steady_clock> mEnd;
     int mNumSamples;
     float mTotalLatency;
     float mSeqThroughput;
-    float mAvgSeqLatency;
+    LatencyStats mSeqLatency;
+    LatencyStats mFirstTokenLatency;
+    LatencyStats mTimePerOutputToken;
     float mTokenThroughput;
 }; // class Recorder
 
@@ -265,7 +390,12 @@ class GptServer
 public:
     GptServer(std::filesystem::path const& trtEnginePath, TrtGptModelType modelType, int32_t maxBeamWidth,
         batch_scheduler::SchedulerPolicy schedulerPolicy, TrtGptModelOptionalParams const& optionalParams,
-        std::shared_ptr<Recorder> recorder, std::optional<uint64_t> terminateReqId)
+        std::shared_ptr<Recorder> recorder, std::optional<uint64_t> terminateReqId,
+        std::shared_ptr<tensorrt_llm::benchmark::RankTiming> rankTiming,
+        std::shared_ptr<RequestRecorder> requestRecorder, std::shared_ptr<RequestReplayer> requestReplayer)
+        : mRankTiming{std::move(rankTiming)}
+        , mRequestRecorder{std::move(requestRecorder)}
+        , mRequestReplayer{std::move(requestReplayer)}
     {
         mBatchManager = std::make_shared<GptManager>(
             trtEnginePath, modelType, maxBeamWidth, schedulerPolicy,
@@ -273,7 +403,8 @@ public:
             [this](uint64_t requestId, std::list<NamedTensor> response_tensors, bool final_response,
                 const std::string& errMsg)
             { return sendResponse(requestId, response_tensors, final_response, errMsg); },
-            nullptr, nullptr, optionalParams, terminateReqId);
+            mRequestReplayer ? mRequestReplayer->pollStopSignalCallback() : nullptr, nullptr, optionalParams,
+            terminateReqId);
         mRecorder = recorder;
         mTerminateReqId = terminateReqId;
     }
@@ -321,11 +452,29 @@ public:
         mBatchManager->waitUntilTerminate();
     }
 
+    // The warm-up is not recorded
+    void startRecording()
+    {
+        mRecording.store(true, std::memory_order_release);
+    }
+
     // Return up to max_num_requests inference requests.
     std::list<std::shared_ptr<InferenceRequest>> getInferenceRequests(const int max_num_requests)
     {
+        if (mRankTiming)
+        {
+            recordStep();
+        }
         std::list<std::shared_ptr<InferenceRequest>> rval;
         auto& comm = COMM_SESSION;
+        if (mRequestReplayer && comm.getRank() == 0)
+        {
+            // Fetched below, in the iteration they were recorded in
+            for (auto const& request : mRequestReplayer->getRequests(max_num_requests))
+            {
+                enqueue(request);
+            }
+        }
         if (max_num_requests > 0)
         {
             auto world_size = comm.getSize();
@@ -393,6 +542,13 @@ public:
                 }
             }
         }
+        if (mRequestRecorder && comm.getRank() == 0 && mRecording.load(std::memory_order_acquire))
+        {
+            // The terminate request is sent by the benchmark, it is not replayed
+            auto recorded = rval;
+            recorded.remove_if([this](auto const& request) { return request->getRequestId() == mTerminateReqId; });
+            mRequestRecorder->recordRequests(recorded);
+        }
         return rval;
     }
 
@@ -409,6 +565,10 @@ public:
                 mWorkItemsQueue.markFinished(requestId);
                 mRecorder->recordEnd(requestId);
             }
+            else
+            {
+                mRecorder->recordToken(requestId);
+            }
         }
         catch (const std::exception& e)
         {
@@ -417,10 +577,36 @@ public:
     }
 
 private:
+    // Called at the start of each iteration of the generation loop, which ends the previous one. The iterations
+    // without collectives are the ones without requests to run, they are not counted.
+    void recordStep()
+    {
+        auto const now = std::chrono::steady_clock::now();
+        auto const commStats = tc::CommProfiler::getInstance().collect();
+        float totalCommMs = 0.F;
+        uint64_t numCollectives = 0;
+        for (auto const& stats : commStats)
+        {
+            totalCommMs += stats.getTotal().timeMs;
+            numCollectives += stats.getTotal().count;
+        }
+        if (mLastStepStart && numCollectives > 0)
+        {
+            mRankTiming->addStep(
+                std::chrono::duration<double, std::milli>(now - mLastStepStart.value()).count(), totalCommMs);
+        }
+        mLastStepStart = now;
+    }
+
     std::shared_ptr<GptManager> mBatchManager;
     std::shared_ptr<Recorder> mRecorder;
     WorkItemsQueue mWorkItemsQueue;
     std::optional<uint64_t> mTerminateReqId;
+    std::shared_ptr<tensorrt_llm::benchmark::RankTiming> mRankTiming;
+    std::optional<std::chrono::steady_clock::time_point> mLastStepStart;
+    std::shared_ptr<RequestRecorder> mRequestRecorder;
+    std::shared_ptr<RequestReplayer> mRequestReplayer;
+    std::atomic<bool> mRecording{false};
 
 }; // class GptServer
 
@@ -446,10 +632,93 @@ std::pair<std::vector<std::vector<int32_t>>, std::vector<int32_t>> parseDataset(
     return std::make_pair(inputIds, outputIds);
 }
 
+// Blocks of the prompts found in the KV cache when block reuse is enabled
+struct KvReuseEstimate
+{
+    std::size_t numBlocks{0};
+    std::size_t numReusedBlocks{0};
+};
+
+// GptManager does not expose the counters of its BlockManager, so the reuse is replayed on the prompts of the dataset
+// with the same matching rule: full blocks match from the start of the prompt until the first miss, and the last
+// prompt token is always computed. Blocks are cached as soon as their request arrives and are never evicted, so this
+// is the upper bound of what the BlockManager reaches.
+KvReuseEstimate estimateKvReuse(std::vector<std::vector<int32_t>> const& inputIds, SizeType tokensPerBlock)
+{
+    // Prefix tree of the cached blocks, a child is keyed by its parent node and its tokens
+    std::map<std::pair<std::size_t, std::vector<int32_t>>, std::size_t> children;
+    std::size_t constexpr rootNode = 0;
+    KvReuseEstimate estimate;
+    for (auto const& ids : inputIds)
+    {
+        auto const numBlocks = ids.empty() ? 0 : (ids.size() - 1) / tokensPerBlock;
+        auto node = rootNode;
+        bool matching = true;
+        for (std::size_t block = 0; block < numBlocks; ++block)
+        {
+            auto const blockBegin = ids.begin() + block * tokensPerBlock;
+            std::vector<int32_t> blockTokens(blockBegin, blockBegin + tokensPerBlock);
+            auto const [child, inserted]
+                = children.try_emplace(std::make_pair(node, std::move(blockTokens)), children.size() + 1);
+            matching = matching && !inserted;
+            estimate.numReusedBlocks += matching ? 1 : 0;
+            node = child->second;
+        }
+        estimate.numBlocks += numBlocks;
+    }
+    return estimate;
+}
+
+// Arrival times of the requests in seconds, relative to the start of the benchmark
+std::vector<double> parseTrace(std::filesystem::path const& tracePath)
+{
+    auto constexpr allowExceptions = true;
+    auto constexpr ingoreComments = true;
+    TLLM_CHECK_WITH_INFO(std::filesystem::exists(tracePath), "File does not exist: %s", tracePath.string().c_str());
+    std::ifstream jsonStream(tracePath);
+    auto json = nlohmann::json::parse(jsonStream, nullptr, allowExceptions, ingoreComments);
+
+    std::vector<double> arrivalTimes = json;
+    TLLM_CHECK_WITH_INFO(std::is_sorted(arrivalTimes.begin(), arrivalTimes.end()),
+        "Arrival times of %s are not sorted", tracePath.string().c_str());
+    return arrivalTimes;
+}
+
+// Arrival times of an open-loop load: replayed from a trace, a Poisson process of the given rate, or all the requests
+// at once
+std::vector<double> makeArrivalTimes(
+    std::size_t numSamples, std::optional<float> const& requestRate, std::string const& tracePath)
+{
+    if (!tracePath.empty())
+    {
+        auto arrivalTimes = parseTrace(tracePath);
+        TLLM_CHECK_WITH_INFO(arrivalTimes.size() >= numSamples, "Trace has %lu arrival times for %lu samples",
+            arrivalTimes.size(), numSamples);
+        arrivalTimes.resize(numSamples);
+        return arrivalTimes;
+    }
+
+    std::vector<double> arrivalTimes(numSamples, 0.0);
+    if (requestRate)
+    {
+        TLLM_CHECK_WITH_INFO(requestRate.value() > 0, "Request rate must be positive");
+        // Fixed seed so that runs are comparable
+        std::mt19937 gen(0);
+        std::exponential_distribution<double> interArrival(requestRate.value());
+        double time = 0.0;
+        for (auto& arrivalTime : arrivalTimes)
+        {
+            arrivalTime = time;
+            time += interArrival(gen);
+        }
+    }
+    return arrivalTimes;
+}
+
 std::shared_ptr<InferenceRequest> makeRequest(std::uint64_t reqId,
     std::pair<std::vector<std::vector<int32_t>>, std::vector<int32_t>> const& dataset, std::size_t sample_idx,
     ITensor::SharedPtr const& beamWidthTensor, ITensor::SharedPtr const& eosId, ITensor::SharedPtr const& padId,
-    BufferManager const& bufferManager)
+    BufferManager const& bufferManager, bool streaming)
 {
     auto request = std::make_shared<InferenceRequest>(reqId);
     auto const& inputIds = dataset.first[sample_idx];
@@ -461,6 +730,7 @@ std::shared_ptr<InferenceRequest> makeRequest(std::uint64_t reqId,
     request->setBeamWidth(beamWidthTensor);
     request->setEndId(eosId);
     request->setPadId(padId);
+    request->setIsStreaming(streaming);
     return request;
 }
 
@@ -468,8 +738,11 @@ void benchmarkGptManager([[maybe_unused]] std::string const& modelName, std::fil
     std::string const& type, std::string const& datasetPath, int beamWidth, int warmUp,
     const std::optional<int32_t>& eosId, const std::optional<int32_t>& padId,
     std::shared_ptr<nvinfer1::ILogger> const& logger, TrtGptModelOptionalParams const& optionalParams,
-    batch_scheduler::SchedulerPolicy schedulerPolicy)
+    batch_scheduler::SchedulerPolicy schedulerPolicy, std::optional<float> const& requestRate,
+    std::string const& tracePath, bool streaming, bool timeRanks, std::string const& recordPath,
+    std::string const& replayPath, tensorrt_llm::benchmark::BenchmarkReport& report)
 {
+    auto const modelConfig = GptJsonConfig::parse(engineDir / "config.json").getModelConfig();
     auto const worldConfig = WorldConfig::mpi();
 
     TrtGptModelType modelType;
@@ -491,15 +764,44 @@ void benchmarkGptManager([[maybe_unused]] std::string const& modelName, std::fil
     ITensor::SharedPtr beamWidthTensor{
         bufferManager.copyFrom(&beamWidth, ITensor::makeShape({1}), MemoryType::kPINNED)};
 
-    // Load dataset
-    auto dataset = parseDataset(datasetPath);
+    // Load dataset, the requests of a replay are in the recording
+    auto dataset = replayPath.empty() ? parseDataset(datasetPath) : decltype(parseDataset(datasetPath)){};
     const auto numSamples = dataset.first.size();
+    auto const arrivalTimes = makeArrivalTimes(numSamples, requestRate, tracePath);
 
     const int maxBeamWidth = beamWidth;
-    auto recorder = std::make_shared<Recorder>();
+    auto recorder = std::make_shared<Recorder>(streaming);
     uint64_t terminateReqId = numSamples + 1;
-    auto gptServer = std::make_shared<GptServer>(
-        engineDir, modelType, maxBeamWidth, schedulerPolicy, optionalParams, recorder, terminateReqId);
+    std::shared_ptr<RequestRecorder> requestRecorder;
+    std::shared_ptr<RequestReplayer> requestReplayer;
+    if (worldConfig.getRank() == 0 && !recordPath.empty())
+    {
+        requestRecorder = std::make_shared<RequestRecorder>(recordPath);
+    }
+    if (!replayPath.empty())
+    {
+        if (worldConfig.getRank() == 0)
+        {
+            requestReplayer = std::make_shared<RequestReplayer>(replayPath);
+            terminateReqId = requestReplayer->getMaxRequestId() + 1;
+        }
+        if (worldConfig.getSize() > 1)
+        {
+            COMM_SESSION.bcast(&terminateReqId, 1, mpi::MpiType::kUINT64, 0);
+        }
+    }
+    std::shared_ptr<tensorrt_llm::benchmark::RankTiming> rankTiming;
+    if (timeRanks)
+    {
+        // The iterations are timed on the host, their collectives by the CommProfiler
+        tc::CommProfiler::getInstance().setEnabled(true);
+        rankTiming = std::make_shared<tensorrt_llm::benchmark::RankTiming>();
+    }
+    // The plugins are warmed up while the GptManager deserializes its engine and allocates its KV cache
+    tensorrt_llm::plugins::api::PluginWarmup pluginWarmup{worldConfig.getDevice()};
+    auto gptServer = std::make_shared<GptServer>(engineDir, modelType, maxBeamWidth, schedulerPolicy, optionalParams,
+        recorder, terminateReqId, rankTiming, requestRecorder, requestReplayer);
+    pluginWarmup.wait();
 
     ITensor::SharedPtr eosIdTensor{
         eosId ? bufferManager.copyFrom(&eosId.value(), ITensor::makeShape({1}), MemoryType::kPINNED) : nullptr};
@@ -508,35 +810,70 @@ void benchmarkGptManager([[maybe_unused]] std::string const& modelName, std::fil
 
     if (worldConfig.getRank() == 0)
     {
-        // Warm up
-        SizeType reqId = 0;
-        for (auto i = 0; i < warmUp; ++i)
+        if (requestReplayer)
         {
-            ++reqId;
-            if (i == terminateReqId)
-                ++reqId;
-            auto request = makeRequest(reqId, dataset, 0, beamWidthTensor, eosIdTensor, padIdTensor, bufferManager);
-            gptServer->enqueue(request);
+            // The batch manager fetches the recorded requests in the iterations they were recorded in, without warm-up
+            printf("[BENCHMARK] replaying %lu requests\n", requestReplayer->getNumRequests());
+            recorder->initialize();
+            while (!requestReplayer->isDone())
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
         }
-        gptServer->waitForEmpty();
-
-        // Benchmark
-        recorder->initialize();
-        for (std::size_t i = 0; i < numSamples; ++i)
+        else
         {
-            auto request = makeRequest(i + 1, dataset, i, beamWidthTensor, eosIdTensor, padIdTensor, bufferManager);
-            gptServer->enqueue(request);
+            // Warm up
+            SizeType reqId = 0;
+            for (auto i = 0; i < warmUp; ++i)
+            {
+                ++reqId;
+                if (i == terminateReqId)
+                    ++reqId;
+                auto request = makeRequest(
+                    reqId, dataset, 0, beamWidthTensor, eosIdTensor, padIdTensor, bufferManager, streaming);
+                gptServer->enqueue(request);
+            }
+            gptServer->waitForEmpty();
+
+            // Benchmark
+            gptServer->startRecording();
+            recorder->initialize();
+            auto const start = std::chrono::steady_clock::now();
+            for (std::size_t i = 0; i < numSamples; ++i)
+            {
+                auto request = makeRequest(
+                    i + 1, dataset, i, beamWidthTensor, eosIdTensor, padIdTensor, bufferManager, streaming);
+                std::this_thread::sleep_until(start
+                    + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                        std::chrono::duration<double>(arrivalTimes[i])));
+                gptServer->enqueue(request);
+            }
         }
         gptServer->waitForEmpty();
         recorder->finalize();
         recorder->calculateMetrics();
         recorder->report();
+        recorder->addMetrics(report);
+        if (optionalParams.kvCacheConfig.enableBlockReuse && modelConfig.usePagedKvCache() && !requestReplayer)
+        {
+            auto const tokensPerBlock = modelConfig.getTokensPerBlock();
+            auto const estimate = estimateKvReuse(dataset.first, tokensPerBlock);
+            auto const hitRate
+                = estimate.numBlocks > 0 ? static_cast<float>(estimate.numReusedBlocks) / estimate.numBlocks : 0.F;
+            printf("[BENCHMARK] max_kv_block_hit_rate %.4f\n", hitRate);
+            printf("[BENCHMARK] max_prefill_tokens_saved %lu\n", estimate.numReusedBlocks * tokensPerBlock);
+        }
         // Send terminateReqId to terminate servers on all ranks
         // Sever on rank 0 will broadcast the terminate signal to other servers on multi-GPU cases
         gptServer->enqueue(std::make_shared<InferenceRequest>(terminateReqId));
     }
     // Wait until benchmarking is done and batch manager is terminated
     gptServer->waitBatchManager();
+
+    if (rankTiming)
+    {
+        rankTiming->gather(COMM_SESSION, nlohmann::json::object(), "iterations", report);
+    }
 }
 
 } // namespace
@@ -565,9 +902,34 @@ int main(int argc, char* argv[])
         "kv_cache_free_gpu_mem_fraction", "K-V Cache Free Gpu Mem Fraction.", cxxopts::value<float>());
     options.add_options()(
         "enable_trt_overlap", "Overlap TRT context preparation and execution", cxxopts::value<bool>());
+    options.add_options()("enable_kv_cache_reuse", "Enables the KV cache reuse.", cxxopts::value<bool>());
+    options.add_options()("request_rate",
+        "Rate of the Poisson arrivals of the requests in requests/sec. All the requests arrive at once if unset.",
+        cxxopts::value<float>());
+    options.add_options()("trace", "JSON list of the arrival times of the requests in seconds, overrides request_rate.",
+        cxxopts::value<std::string>()->default_value(""));
+    options.add_options()("streaming", "Stream the responses to measure the time to first token and per output token.",
+        cxxopts::value<bool>()->default_value("false"));
 
     options.add_options()("scheduler_policy", "Choose scheduler policy between max_utilization/guaranteed_no_evict.",
         cxxopts::value<std::string>()->default_value("guaranteed_no_evict"));
+    options.add_options()("rank_timing",
+        "Time the iterations and their collectives on each rank and report the compute and communication time of "
+        "each rank and the skew of the iterations between the ranks. Needs tensor or pipeline parallelism.");
+    options.add_options()("output_json", "Write the config, the environment and the measurements to a JSON file.",
+        cxxopts::value<std::string>()->default_value(""));
+    options.add_options()("baseline",
+        "JSON written by a previous run with --output_json. Significant regressions are reported and fail the run.",
+        cxxopts::value<std::string>()->default_value(""));
+    options.add_options()("regression_threshold", "Relative change of a metric below which it is not a regression.",
+        cxxopts::value<float>()->default_value("0.02"));
+
+    options.add_options()("record_requests",
+        "Record the requests and the iterations of the batch manager that fetched them to a file, see replay_requests.",
+        cxxopts::value<std::string>()->default_value(""));
+    options.add_options()("replay_requests",
+        "Replay the requests of a recording in the iterations they were recorded in, instead of the dataset.",
+        cxxopts::value<std::string>()->default_value(""));
 
     options.add_options()("log_level", "Choose log level between verbose/info/warning/error/internal_error.",
         cxxopts::value<std::string>()->default_value("error"));
@@ -619,6 +981,19 @@ int main(int argc, char* argv[])
         optionalParams.enableTrtOverlap = result["enable_trt_overlap"].as<bool>();
     }
 
+    // Argument: Enable KV cache reuse
+    if (result.count("enable_kv_cache_reuse"))
+    {
+        optionalParams.kvCacheConfig.enableBlockReuse = result["enable_kv_cache_reuse"].as<bool>();
+    }
+
+    std::optional<float> requestRate;
+    // Argument: Request rate
+    if (result.count("request_rate"))
+    {
+        requestRate = result["request_rate"].as<float>();
+    }
+
     std::optional<int32_t> padId;
     // Argument: Padding token id
     if (result.count("pad_id"))
@@ -683,8 +1058,28 @@ int main(int argc, char* argv[])
 
     try
     {
+        tensorrt_llm::benchmark::BenchmarkReport report{
+            "gptManagerBenchmark", tensorrt_llm::benchmark::makeConfig(result)};
         benchmarkGptManager(result["model"].as<std::string>(), result["engine_dir"].as<std::string>(), type,
-            datasetPath, beamWidth, result["warm_up"].as<int>(), eosId, padId, logger, optionalParams, schedulerPolicy);
+            datasetPath, beamWidth, result["warm_up"].as<int>(), eosId, padId, logger, optionalParams, schedulerPolicy,
+            requestRate, result["trace"].as<std::string>(), result["streaming"].as<bool>(),
+            result.count("rank_timing") > 0, result["record_requests"].as<std::string>(),
+            result["replay_requests"].as<std::string>(), report);
+
+        // Only the first rank measures
+        if (COMM_SESSION.getRank() == 0)
+        {
+            auto const outputJson = result["output_json"].as<std::string>();
+            if (!outputJson.empty())
+            {
+                report.write(outputJson);
+            }
+            auto const baseline = result["baseline"].as<std::string>();
+            if (!baseline.empty() && report.compare(baseline, result["regression_threshold"].as<float>()) > 0)
+            {
+                return 1;
+            }
+        }
     }
     catch (const std::exception& e)
     {
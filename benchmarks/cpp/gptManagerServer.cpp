@@ -0,0 +1,1246 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2022-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A reference server of GptManager without Python. The requests and the responses are JSON over HTTP/1.1, the streamed
+// responses are sent as chunks, one JSON line per iteration. The connections are served by a pool of I/O threads,
+// each with its own epoll instance, and the generation loop hands the responses to the thread of their connection
+// through a queue and an eventfd, so that no thread blocks on another one.
+
+#include "tensorrt_llm/batch_manager/GptManager.h"
+#include "tensorrt_llm/batch_manager/flightRecorder.h"
+#include "tensorrt_llm/batch_manager/inferenceRequest.h"
+#include "tensorrt_llm/batch_manager/iterationStats.h"
+#include "tensorrt_llm/batch_manager/metricsRegistry.h"
+#include "tensorrt_llm/batch_manager/namedTensor.h"
+#include "tensorrt_llm/batch_manager/requestReplay.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/commProfiler.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/mpiUtils.h"
+#include "tensorrt_llm/plugins/api/tllmPlugin.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/detokenizer.h"
+#include "tensorrt_llm/runtime/tllmLogger.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <cxxopts.hpp>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace tensorrt_llm::batch_manager;
+using namespace tensorrt_llm::runtime;
+
+namespace trt = nvinfer1;
+
+namespace
+{
+
+auto constexpr kMaxHeaderSize = std::size_t{16} << 10;
+auto constexpr kMaxBodySize = std::size_t{64} << 20;
+
+// A response of the generation loop, framed by the I/O thread of its connection
+struct Outgoing
+{
+    std::uint64_t connectionId;
+    int status;
+    std::string body;
+    // The last response of the request
+    bool final;
+};
+
+struct HttpRequest
+{
+    std::string method;
+    std::string target;
+    std::string body;
+    bool keepAlive{true};
+};
+
+enum class ParseStatus
+{
+    kIncomplete,
+    kComplete,
+    kInvalid,
+};
+
+std::string toLower(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+std::string trim(std::string const& text)
+{
+    auto const begin = text.find_first_not_of(" \t");
+    if (begin == std::string::npos)
+    {
+        return {};
+    }
+    return text.substr(begin, text.find_last_not_of(" \t") - begin + 1);
+}
+
+// Parses the first request of the bytes received on a connection and removes it from them. The bodies are read
+// with their Content-Length, the chunked requests are not supported.
+ParseStatus parseHttpRequest(std::string& input, HttpRequest& request)
+{
+    auto const headerEnd = input.find("\r\n\r\n");
+    if (headerEnd == std::string::npos)
+    {
+        return input.size() > kMaxHeaderSize ? ParseStatus::kInvalid : ParseStatus::kIncomplete;
+    }
+
+    auto lineEnd = input.find("\r\n");
+    auto const requestLine = input.substr(0, lineEnd);
+    auto const methodEnd = requestLine.find(' ');
+    auto const targetEnd = requestLine.find(' ', methodEnd + 1);
+    if (methodEnd == std::string::npos || targetEnd == std::string::npos)
+    {
+        return ParseStatus::kInvalid;
+    }
+    request.method = requestLine.substr(0, methodEnd);
+    request.target = requestLine.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+    auto const version = requestLine.substr(targetEnd + 1);
+    if (version != "HTTP/1.1" && version != "HTTP/1.0")
+    {
+        return ParseStatus::kInvalid;
+    }
+    request.keepAlive = version == "HTTP/1.1";
+
+    std::size_t contentLength = 0;
+    while (lineEnd < headerEnd)
+    {
+        auto const lineBegin = lineEnd + 2;
+        lineEnd = input.find("\r\n", lineBegin);
+        auto const colon = input.find(':', lineBegin);
+        if (colon == std::string::npos || colon > lineEnd)
+        {
+            return ParseStatus::kInvalid;
+        }
+        auto const name = toLower(input.substr(lineBegin, colon - lineBegin));
+        auto const value = trim(input.substr(colon + 1, lineEnd - colon - 1));
+        if (name == "content-length")
+        {
+            if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos || value.size() > 12)
+            {
+                return ParseStatus::kInvalid;
+            }
+            contentLength = std::stoull(value);
+        }
+        else if (name == "connection")
+        {
+            auto const connection = toLower(value);
+            request.keepAlive = connection == "close" ? false : connection == "keep-alive" ? true : request.keepAlive;
+        }
+        else if (name == "transfer-encoding")
+        {
+            return ParseStatus::kInvalid;
+        }
+    }
+    if (contentLength > kMaxBodySize)
+    {
+        return ParseStatus::kInvalid;
+    }
+
+    auto const bodyBegin = headerEnd + 4;
+    if (input.size() < bodyBegin + contentLength)
+    {
+        return ParseStatus::kIncomplete;
+    }
+    request.body = input.substr(bodyBegin, contentLength);
+    input.erase(0, bodyBegin + contentLength);
+    return ParseStatus::kComplete;
+}
+
+char const* reasonPhrase(int status)
+{
+    switch (status)
+    {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 500: return "Internal Server Error";
+    default: return "Unknown";
+    }
+}
+
+std::string httpResponse(
+    int status, std::string const& body, bool keepAlive, char const* contentType = "application/json")
+{
+    return "HTTP/1.1 " + std::to_string(status) + " " + reasonPhrase(status) + "\r\nContent-Type: " + contentType
+        + "\r\nContent-Length: " + std::to_string(body.size())
+        + (keepAlive ? "\r\nConnection: keep-alive\r\n\r\n" : "\r\nConnection: close\r\n\r\n") + body;
+}
+
+auto constexpr kStreamingHeader
+    = "HTTP/1.1 200 OK\r\nContent-Type: application/x-ndjson\r\nTransfer-Encoding: chunked\r\n\r\n";
+auto constexpr kLastChunk = "0\r\n\r\n";
+
+std::string httpChunk(std::string const& data)
+{
+    std::array<char, 16> size{};
+    std::snprintf(size.data(), size.size(), "%zx\r\n", data.size());
+    return size.data() + data + "\r\n";
+}
+
+template <typename T>
+ITensor::SharedPtr hostTensor(std::vector<T> const& values, ITensor::Shape const& shape)
+{
+    auto tensor = BufferManager::cpu(shape, TRTDataType<T>::value);
+    std::memcpy(tensor->data(), values.data(), tensor->getSizeInBytes());
+    return tensor;
+}
+
+template <typename T>
+ITensor::SharedPtr scalarTensor(T value)
+{
+    return hostTensor(std::vector<T>{value}, ITensor::makeShape({1}));
+}
+
+// The values of the requests that do not set them
+struct RequestDefaults
+{
+    SizeType maxNewTokens;
+    std::optional<SizeType> endId;
+    std::optional<SizeType> padId;
+};
+
+class IoThread;
+
+// Owns the GptManager. The I/O threads enqueue the requests, the generation loop fetches them and posts their
+// responses to the I/O thread of their connection.
+class Server
+{
+public:
+    Server(std::filesystem::path const& engineDir, TrtGptModelType modelType, SizeType maxBeamWidth,
+        batch_scheduler::SchedulerPolicy schedulerPolicy, TrtGptModelOptionalParams const& optionalParams,
+        std::optional<Detokenizer> detokenizer, RequestDefaults const& defaults,
+        std::optional<std::filesystem::path> const& iterationStatsPath,
+        std::optional<std::string> const& flightRecordPath,
+        std::optional<std::filesystem::path> const& requestRecordPath)
+        : mDetokenizer{std::move(detokenizer)}
+        , mDefaults{defaults}
+    {
+        if (requestRecordPath)
+        {
+            mRequestRecorder = std::make_unique<RequestRecorder>(*requestRecordPath);
+        }
+        if (flightRecordPath)
+        {
+            mFlightRecorder = std::make_unique<FlightRecorder>();
+            FlightRecorder::install(*mFlightRecorder, *flightRecordPath);
+        }
+        if (iterationStatsPath)
+        {
+            mStatsFile.open(*iterationStatsPath);
+            TLLM_CHECK_WITH_INFO(mStatsFile.is_open(), "Failed to open %s", iterationStatsPath->c_str());
+            mStatsThread = std::thread([this]() { writeStats(); });
+        }
+
+        // The callbacks are called by the generation loop, an iteration starts with the requests it fetches
+        mBatchManager = std::make_unique<GptManager>(
+            engineDir, modelType, maxBeamWidth, schedulerPolicy,
+            [this](int maxNumRequests)
+            {
+                mIterationStart = Clock::now();
+                auto requests = getInferenceRequests(maxNumRequests);
+                if (mRequestRecorder)
+                {
+                    mRequestRecorder->recordRequests(requests);
+                }
+                mFetchRequestsTime
+                    = std::chrono::duration_cast<IterationStats::Duration>(Clock::now() - mIterationStart);
+                mSendResponsesTime = IterationStats::Duration{0};
+                return requests;
+            },
+            [this](uint64_t requestId, std::list<NamedTensor> const& tensors, bool isFinal, std::string const& errMsg)
+            {
+                auto const start = Clock::now();
+                sendResponse(requestId, tensors, isFinal, errMsg);
+                mSendResponsesTime += std::chrono::duration_cast<IterationStats::Duration>(Clock::now() - start);
+            },
+            [this]()
+            {
+                auto requestIds = pollStopSignals();
+                if (mRequestRecorder)
+                {
+                    mRequestRecorder->recordStopSignals(requestIds);
+                }
+                return requestIds;
+            },
+            [this](std::string const& stats) { recordStats(stats); }, optionalParams);
+    }
+
+    ~Server()
+    {
+        shutdown();
+    }
+
+    // Stops the generation loop, after which no response is posted, then writes the stats left
+    void shutdown()
+    {
+        mBatchManager.reset();
+        if (mStatsThread.joinable())
+        {
+            mStatsStopped.store(true, std::memory_order_release);
+            mStatsThread.join();
+        }
+    }
+
+    // Returns the id of the request, throws if the body is not a valid request
+    std::uint64_t enqueue(nlohmann::json const& body, IoThread& thread, std::uint64_t connectionId, bool& streaming);
+
+    // The connection of the request was closed
+    void cancel(std::uint64_t requestId);
+
+    // The metrics of the last iterations in the Prometheus text format, from any thread
+    [[nodiscard]] std::string getMetrics() const
+    {
+        return mMetrics.getRegistry().toPrometheus();
+    }
+
+private:
+    struct Route
+    {
+        // Null once the request is cancelled
+        IoThread* thread;
+        std::uint64_t connectionId;
+        bool streaming;
+        SizeType inputLength;
+        std::vector<Detokenizer::Stream> beams;
+    };
+
+    std::list<std::shared_ptr<InferenceRequest>> getInferenceRequests(int maxNumRequests);
+
+    void sendResponse(
+        std::uint64_t requestId, std::list<NamedTensor> const& tensors, bool isFinal, std::string const& errMsg);
+
+    std::unordered_set<uint64_t> pollStopSignals();
+
+    // Called at the end of the iterations with active requests, with the JSON string of the batch manager
+    void recordStats(std::string const& json);
+
+    // Appends the stats of the queue to the file, one JSON line per iteration, until shutdown
+    void writeStats();
+
+    using Clock = std::chrono::steady_clock;
+
+    std::optional<Detokenizer> mDetokenizer;
+    RequestDefaults mDefaults;
+    std::atomic<std::uint64_t> mNextRequestId{1};
+
+    std::mutex mMutex;
+    std::deque<std::shared_ptr<InferenceRequest>> mPending;
+    std::unordered_set<std::uint64_t> mCancelled;
+    std::unordered_map<std::uint64_t, Route> mRoutes;
+
+    // Only used by the generation loop
+    Clock::time_point mIterationStart{Clock::now()};
+    IterationStats::Duration mFetchRequestsTime{0};
+    IterationStats::Duration mSendResponsesTime{0};
+
+    BatchManagerMetrics mMetrics;
+    std::unique_ptr<FlightRecorder> mFlightRecorder;
+    std::unique_ptr<RequestRecorder> mRequestRecorder;
+    IterationStatsQueue mStatsQueue;
+    std::ofstream mStatsFile;
+    std::thread mStatsThread;
+    std::atomic<bool> mStatsStopped{false};
+
+    std::unique_ptr<GptManager> mBatchManager;
+};
+
+// Serves the connections it accepts on the shared listening socket, with an epoll instance of its own
+class IoThread
+{
+public:
+    IoThread(Server& server, int listenFd)
+        : mServer{server}
+        , mListenFd{listenFd}
+    {
+        mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+        mWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        TLLM_CHECK_WITH_INFO(mEpollFd >= 0 && mWakeFd >= 0, "Failed to create the epoll instance: %s", strerror(errno));
+        // Each connection is accepted by a single thread
+        addFd(mListenFd, EPOLLIN | EPOLLEXCLUSIVE);
+        addFd(mWakeFd, EPOLLIN);
+        mThread = std::thread([this]() { run(); });
+    }
+
+    ~IoThread()
+    {
+        stop();
+        ::close(mWakeFd);
+        ::close(mEpollFd);
+    }
+
+    void stop()
+    {
+        if (!mThread.joinable())
+        {
+            return;
+        }
+        mStopped.store(true, std::memory_order_release);
+        wake();
+        mThread.join();
+    }
+
+    // Called by the generation loop
+    void post(Outgoing outgoing)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mOutbox.push_back(std::move(outgoing));
+        }
+        wake();
+    }
+
+private:
+    struct Connection
+    {
+        int fd;
+        std::uint64_t id;
+        std::string input;
+        std::string output;
+        // The request being served, the next ones wait in the input
+        std::optional<std::uint64_t> requestId;
+        bool streaming{false};
+        bool keepAlive{true};
+        // Closed once its output is sent
+        bool closing{false};
+        bool writing{false};
+    };
+
+    void addFd(int fd, std::uint32_t events)
+    {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        TLLM_CHECK_WITH_INFO(epoll_ctl(mEpollFd, EPOLL_CTL_ADD, fd, &event) == 0, "Failed to add to epoll: %s",
+            strerror(errno));
+    }
+
+    void wake()
+    {
+        std::uint64_t const one = 1;
+        [[maybe_unused]] auto const written = ::write(mWakeFd, &one, sizeof(one));
+    }
+
+    void run()
+    {
+        std::array<epoll_event, 64> events{};
+        while (!mStopped.load(std::memory_order_acquire))
+        {
+            auto const count = epoll_wait(mEpollFd, events.data(), static_cast<int>(events.size()), -1);
+            if (count < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                TLLM_LOG_ERROR("epoll_wait failed: %s", strerror(errno));
+                break;
+            }
+            for (int i = 0; i < count; ++i)
+            {
+                auto const fd = events[i].data.fd;
+                if (fd == mListenFd)
+                {
+                    accept();
+                }
+                else if (fd == mWakeFd)
+                {
+                    std::uint64_t value;
+                    [[maybe_unused]] auto const bytes = ::read(mWakeFd, &value, sizeof(value));
+                    drainOutbox();
+                }
+                else
+                {
+                    auto const it = mConnections.find(fd);
+                    if (it == mConnections.end())
+                    {
+                        continue;
+                    }
+                    auto& connection = it->second;
+                    if (events[i].events & (EPOLLERR | EPOLLHUP))
+                    {
+                        close(connection);
+                        continue;
+                    }
+                    if ((events[i].events & EPOLLIN) && !receive(connection))
+                    {
+                        continue;
+                    }
+                    if (events[i].events & EPOLLOUT)
+                    {
+                        flush(connection);
+                    }
+                }
+            }
+        }
+
+        while (!mConnections.empty())
+        {
+            close(mConnections.begin()->second);
+        }
+    }
+
+    void accept()
+    {
+        while (true)
+        {
+            auto const fd = accept4(mListenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0)
+            {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                {
+                    TLLM_LOG_WARNING("accept failed: %s", strerror(errno));
+                }
+                return;
+            }
+            // The streamed tokens are small writes that must not wait for the acknowledgement of the previous ones
+            int const noDelay = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+            auto const id = sNextConnectionId.fetch_add(1, std::memory_order_relaxed);
+            mConnections.emplace(fd, Connection{fd, id});
+            mConnectionFds.emplace(id, fd);
+            addFd(fd, EPOLLIN);
+        }
+    }
+
+    // Returns false if the connection was closed
+    bool receive(Connection& connection)
+    {
+        std::array<char, 16 << 10> buffer{};
+        while (true)
+        {
+            auto const size = ::recv(connection.fd, buffer.data(), buffer.size(), 0);
+            if (size > 0)
+            {
+                connection.input.append(buffer.data(), size);
+                continue;
+            }
+            if (size < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (size == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+            {
+                close(connection);
+                return false;
+            }
+            break;
+        }
+        process(connection);
+        return flush(connection);
+    }
+
+    // Serves the requests received on the connection, one at a time
+    void process(Connection& connection)
+    {
+        while (!connection.requestId && !connection.closing)
+        {
+            HttpRequest request;
+            auto const status = parseHttpRequest(connection.input, request);
+            if (status == ParseStatus::kIncomplete)
+            {
+                break;
+            }
+            if (status == ParseStatus::kInvalid)
+            {
+                connection.output += httpResponse(400, R"({"error":"Invalid HTTP request"})", false);
+                connection.closing = true;
+                break;
+            }
+
+            connection.keepAlive = request.keepAlive;
+            if (request.method == "GET" && request.target == "/health")
+            {
+                connection.output += httpResponse(200, R"({"status":"ok"})", connection.keepAlive);
+            }
+            else if (request.method == "GET" && request.target == "/metrics")
+            {
+                connection.output += httpResponse(
+                    200, mServer.getMetrics(), connection.keepAlive, "text/plain; version=0.0.4; charset=utf-8");
+            }
+            else if (request.method == "POST" && request.target == "/generate")
+            {
+                try
+                {
+                    bool streaming = false;
+                    auto const body = nlohmann::json::parse(request.body);
+                    connection.requestId = mServer.enqueue(body, *this, connection.id, streaming);
+                    connection.streaming = streaming;
+                    if (streaming)
+                    {
+                        connection.output += kStreamingHeader;
+                    }
+                }
+                catch (std::exception const& e)
+                {
+                    auto const error = nlohmann::json{{"error", e.what()}}.dump();
+                    connection.output += httpResponse(400, error, connection.keepAlive);
+                }
+            }
+            else
+            {
+                connection.output += httpResponse(404, R"({"error":"Not found"})", connection.keepAlive);
+            }
+            connection.closing = !connection.requestId && !connection.keepAlive;
+        }
+    }
+
+    void drainOutbox()
+    {
+        std::vector<Outgoing> outbox;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            outbox.swap(mOutbox);
+        }
+        std::vector<int> touched;
+        for (auto& outgoing : outbox)
+        {
+            auto const fdIt = mConnectionFds.find(outgoing.connectionId);
+            if (fdIt == mConnectionFds.end())
+            {
+                continue;
+            }
+            auto& connection = mConnections.at(fdIt->second);
+            if (connection.streaming)
+            {
+                connection.output += httpChunk(outgoing.body + "\n");
+                if (outgoing.final)
+                {
+                    connection.output += kLastChunk;
+                }
+            }
+            else
+            {
+                connection.output += httpResponse(outgoing.status, outgoing.body, connection.keepAlive);
+            }
+            if (outgoing.final)
+            {
+                connection.requestId.reset();
+                connection.streaming = false;
+                connection.closing = !connection.keepAlive;
+                process(connection);
+            }
+            touched.push_back(connection.fd);
+        }
+        for (auto const fd : touched)
+        {
+            auto const it = mConnections.find(fd);
+            if (it != mConnections.end())
+            {
+                flush(it->second);
+            }
+        }
+    }
+
+    // Sends what the socket accepts of the output, returns false if the connection was closed
+    bool flush(Connection& connection)
+    {
+        std::size_t sent = 0;
+        while (sent < connection.output.size())
+        {
+            auto const size
+                = ::send(connection.fd, connection.output.data() + sent, connection.output.size() - sent, MSG_NOSIGNAL);
+            if (size > 0)
+            {
+                sent += size;
+                continue;
+            }
+            if (size < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                break;
+            }
+            close(connection);
+            return false;
+        }
+        connection.output.erase(0, sent);
+
+        if (connection.output.empty() && connection.closing)
+        {
+            close(connection);
+            return false;
+        }
+        // Waits for the socket to accept more only when there is something left to send
+        auto const writing = !connection.output.empty();
+        if (writing != connection.writing)
+        {
+            epoll_event event{};
+            event.events = writing ? EPOLLIN | EPOLLOUT : EPOLLIN;
+            event.data.fd = connection.fd;
+            epoll_ctl(mEpollFd, EPOLL_CTL_MOD, connection.fd, &event);
+            connection.writing = writing;
+        }
+        return true;
+    }
+
+    void close(Connection& connection)
+    {
+        if (connection.requestId)
+        {
+            mServer.cancel(*connection.requestId);
+        }
+        auto const fd = connection.fd;
+        epoll_ctl(mEpollFd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        mConnectionFds.erase(connection.id);
+        mConnections.erase(fd);
+    }
+
+    static inline std::atomic<std::uint64_t> sNextConnectionId{1};
+
+    Server& mServer;
+    int mListenFd;
+    int mEpollFd;
+    int mWakeFd;
+    std::atomic<bool> mStopped{false};
+    std::thread mThread;
+
+    // Only used by the thread
+    std::unordered_map<int, Connection> mConnections;
+    std::unordered_map<std::uint64_t, int> mConnectionFds;
+
+    std::mutex mMutex;
+    std::vector<Outgoing> mOutbox;
+};
+
+std::uint64_t Server::enqueue(nlohmann::json const& body, IoThread& thread, std::uint64_t connectionId, bool& streaming)
+{
+    auto const inputIds = body.at("input_ids").get<std::vector<TokenIdType>>();
+    TLLM_CHECK_WITH_INFO(!inputIds.empty(), "input_ids must not be empty");
+    auto const inputLength = static_cast<SizeType>(inputIds.size());
+    auto const maxNewTokens = body.value("max_new_tokens", mDefaults.maxNewTokens);
+    TLLM_CHECK_WITH_INFO(maxNewTokens > 0, "max_new_tokens must be positive");
+    streaming = body.value("streaming", false);
+
+    auto const requestId = mNextRequestId.fetch_add(1, std::memory_order_relaxed);
+    auto request = std::make_shared<InferenceRequest>(requestId);
+    request->setInputIds(hostTensor(inputIds, ITensor::makeShape({inputLength})));
+    request->setMaxNewTokens(hostTensor(std::vector<SizeType>{maxNewTokens}, ITensor::makeShape({1, 1})));
+    request->setBeamWidth(scalarTensor(body.value("beam_width", SizeType{1})));
+    auto const endId = body.contains("end_id") ? std::make_optional(body["end_id"].get<SizeType>()) : mDefaults.endId;
+    if (endId)
+    {
+        request->setEndId(scalarTensor(*endId));
+    }
+    auto const padId = body.contains("pad_id") ? std::make_optional(body["pad_id"].get<SizeType>()) : mDefaults.padId;
+    if (padId)
+    {
+        request->setPadId(scalarTensor(*padId));
+    }
+    if (body.contains("temperature"))
+    {
+        request->setTemperature(scalarTensor(body["temperature"].get<float>()));
+    }
+    if (body.contains("top_k"))
+    {
+        request->setRuntimeTopK(scalarTensor(body["top_k"].get<SizeType>()));
+    }
+    if (body.contains("top_p"))
+    {
+        request->setRuntimeTopP(scalarTensor(body["top_p"].get<float>()));
+    }
+    if (body.contains("repetition_penalty"))
+    {
+        request->setRepetitionPenalty(scalarTensor(body["repetition_penalty"].get<float>()));
+    }
+    if (body.contains("min_length"))
+    {
+        request->setMinLength(scalarTensor(body["min_length"].get<SizeType>()));
+    }
+    if (body.contains("random_seed"))
+    {
+        request->setRandomSeed(scalarTensor(body["random_seed"].get<std::int64_t>()));
+    }
+    request->setIsStreaming(streaming);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRoutes.emplace(requestId, Route{&thread, connectionId, streaming, inputLength, {}});
+    mPending.push_back(std::move(request));
+    return requestId;
+}
+
+void Server::cancel(std::uint64_t requestId)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const it = mRoutes.find(requestId);
+    if (it != mRoutes.end())
+    {
+        it->second.thread = nullptr;
+        mCancelled.insert(requestId);
+    }
+}
+
+std::list<std::shared_ptr<InferenceRequest>> Server::getInferenceRequests(int maxNumRequests)
+{
+    std::list<std::shared_ptr<InferenceRequest>> requests;
+    std::lock_guard<std::mutex> lock(mMutex);
+    while (!mPending.empty() && static_cast<int>(requests.size()) < maxNumRequests)
+    {
+        auto request = std::move(mPending.front());
+        mPending.pop_front();
+        auto const requestId = request->getRequestId();
+        // Cancelled before it started
+        if (mCancelled.erase(requestId) > 0)
+        {
+            mRoutes.erase(requestId);
+            continue;
+        }
+        requests.push_back(std::move(request));
+    }
+    return requests;
+}
+
+std::unordered_set<uint64_t> Server::pollStopSignals()
+{
+    std::unordered_set<uint64_t> cancelled;
+    std::lock_guard<std::mutex> lock(mMutex);
+    cancelled.swap(mCancelled);
+    return cancelled;
+}
+
+void Server::sendResponse(
+    std::uint64_t requestId, std::list<NamedTensor> const& tensors, bool isFinal, std::string const& errMsg)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const it = mRoutes.find(requestId);
+    if (it == mRoutes.end())
+    {
+        return;
+    }
+    auto& route = it->second;
+    if (route.thread == nullptr)
+    {
+        if (isFinal)
+        {
+            mRoutes.erase(it);
+        }
+        return;
+    }
+
+    Outgoing outgoing{route.connectionId, 200, {}, isFinal || !errMsg.empty()};
+    if (!errMsg.empty())
+    {
+        outgoing.status = 500;
+        outgoing.body = nlohmann::json{{"error", errMsg}}.dump();
+    }
+    else
+    {
+        ITensor::SharedPtr outputIds;
+        ITensor::SharedPtr sequenceLengths;
+        for (auto const& tensor : tensors)
+        {
+            if (tensor.name == inference_request::kOutputIdsTensorName)
+            {
+                outputIds = tensor.tensor;
+            }
+            else if (tensor.name == inference_request::kSequenceLengthTensorName)
+            {
+                sequenceLengths = tensor.tensor;
+            }
+        }
+        TLLM_CHECK_WITH_INFO(outputIds && sequenceLengths, "The response has no output ids");
+
+        // [1, beamWidth, maxLength], the new tokens of a streamed response, the input and the output otherwise
+        auto const& shape = outputIds->getShape();
+        auto const beamWidth = static_cast<SizeType>(shape.d[1]);
+        auto const maxLength = static_cast<SizeType>(shape.d[2]);
+        auto const* ids = bufferCast<TokenIdType>(*outputIds);
+        auto const* lengths = bufferCast<SizeType>(*sequenceLengths);
+
+        auto response = nlohmann::json::object();
+        auto& beamIds = response["output_ids"] = nlohmann::json::array();
+        route.beams.resize(beamWidth);
+        for (SizeType beam = 0; beam < beamWidth; ++beam)
+        {
+            auto const begin = route.streaming ? 0 : std::min(route.inputLength, maxLength);
+            auto const end = std::max(begin, std::min(lengths[beam], maxLength));
+            auto const* beamBegin = ids + beam * maxLength;
+            beamIds.push_back(std::vector<TokenIdType>(beamBegin + begin, beamBegin + end));
+            if (mDetokenizer)
+            {
+                auto& stream = route.beams[beam];
+                auto text = mDetokenizer->decode(stream, beamBegin + begin, end - begin);
+                if (isFinal)
+                {
+                    text += mDetokenizer->finish(stream);
+                }
+                response["text"].push_back(std::move(text));
+            }
+        }
+        if (route.streaming)
+        {
+            response["finished"] = isFinal;
+        }
+        outgoing.body = response.dump();
+    }
+
+    route.thread->post(std::move(outgoing));
+    if (isFinal)
+    {
+        mRoutes.erase(it);
+    }
+}
+
+void Server::recordStats(std::string const& json)
+{
+    auto const now = Clock::now();
+    auto const fields = nlohmann::json::parse(json);
+    auto const field = [&fields](char const* key) { return fields.value(key, SizeType{0}); };
+
+    IterationStats stats;
+    stats.timestamp = std::chrono::system_clock::now();
+    stats.iterationCounter = fields.value("Iteration Counter", std::int64_t{0});
+    stats.numActiveRequests = field("Active Request Count");
+    stats.maxNumRequests = field("Max Request Count");
+    stats.numScheduledRequests = field("Scheduled Requests");
+    stats.numContextRequests = field("Context Requests");
+    stats.numGenerationRequests = field("Generation Requests");
+    stats.numContextTokens = field("Total Context Tokens");
+    stats.numGenerationTokens = field("Total Generation Tokens");
+    stats.maxNumKvBlocks = field("Max KV cache blocks");
+    stats.freeNumKvBlocks = field("Free KV cache blocks");
+    stats.usedNumKvBlocks = field("Used KV cache blocks");
+    stats.tokensPerKvBlock = field("Tokens per KV cache block");
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        stats.numQueuedRequests = static_cast<SizeType>(mPending.size());
+    }
+
+    // The batch manager does not time its scheduling apart from the forward pass
+    auto const stepTime = std::chrono::duration_cast<IterationStats::Duration>(now - mIterationStart);
+    stats.fetchRequestsTime = mFetchRequestsTime;
+    stats.sendResponsesTime = mSendResponsesTime;
+    stats.forwardTime = std::max(stepTime - mFetchRequestsTime - mSendResponsesTime, IterationStats::Duration{0});
+
+    auto& commProfiler = tensorrt_llm::common::CommProfiler::getInstance();
+    if (commProfiler.isEnabled())
+    {
+        stats.addCommStats(commProfiler.collect());
+    }
+    stats.addMemoryStats();
+
+    mMetrics.record(stats);
+    if (mFlightRecorder)
+    {
+        mFlightRecorder->record(stats);
+    }
+    if (mStatsThread.joinable())
+    {
+        mStatsQueue.push(stats);
+    }
+}
+
+void Server::writeStats()
+{
+    std::vector<IterationStats> stats;
+    auto stopped = false;
+    while (!stopped)
+    {
+        // Read before draining, so that the stats of the last iterations are written
+        stopped = mStatsStopped.load(std::memory_order_acquire);
+        stats.clear();
+        mStatsQueue.popAll(stats);
+        for (auto const& iterationStats : stats)
+        {
+            mStatsFile << toJson(iterationStats) << '\n';
+        }
+        mStatsFile.flush();
+        if (!stopped)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+    if (auto const numDropped = mStatsQueue.getNumDropped(); numDropped > 0)
+    {
+        TLLM_LOG_WARNING("The stats of %lu iterations were dropped", numDropped);
+    }
+}
+
+int listenOn(std::string const& host, int port)
+{
+    auto const fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    TLLM_CHECK_WITH_INFO(fd >= 0, "Failed to create the socket: %s", strerror(errno));
+    int const reuseAddress = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuseAddress, sizeof(reuseAddress));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<std::uint16_t>(port));
+    TLLM_CHECK_WITH_INFO(inet_pton(AF_INET, host.c_str(), &address.sin_addr) == 1, "Invalid address %s", host.c_str());
+    TLLM_CHECK_WITH_INFO(bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0,
+        "Failed to bind %s:%d: %s", host.c_str(), port, strerror(errno));
+    TLLM_CHECK_WITH_INFO(::listen(fd, SOMAXCONN) == 0, "Failed to listen: %s", strerror(errno));
+    return fd;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    cxxopts::Options options("TensorRT-LLM GptManager Server", "TensorRT-LLM GptManager Server");
+    options.add_options()("h,help", "Print usage");
+    options.add_options()("engine_dir", "Directory that store the engines.", cxxopts::value<std::string>());
+    options.add_options()(
+        "type", "Batching type: IFB or V1(non-IFB) batching.", cxxopts::value<std::string>()->default_value("IFB"));
+    options.add_options()("host", "Address to listen on.", cxxopts::value<std::string>()->default_value("0.0.0.0"));
+    options.add_options()("port", "Port to listen on.", cxxopts::value<int>()->default_value("8000"));
+    options.add_options()(
+        "io_threads", "Number of threads serving the connections.", cxxopts::value<int>()->default_value("2"));
+    options.add_options()("tokenizer", "tokenizer.json of a Hugging Face tokenizer, to return the text of the outputs.",
+        cxxopts::value<std::string>()->default_value(""));
+    options.add_options()(
+        "max_beam_width", "Max beam width of the requests.", cxxopts::value<int>()->default_value("1"));
+    options.add_options()("max_new_tokens", "Max new tokens of the requests that do not set it.",
+        cxxopts::value<int>()->default_value("16"));
+    options.add_options()("eos_id", "Specify the end-of-sequence token id.", cxxopts::value<int>());
+    options.add_options()("pad_id", "Specify the padding token id.", cxxopts::value<int>());
+    options.add_options()("max_num_sequences", "Max number of Sequences.", cxxopts::value<int>());
+    options.add_options()("max_tokens_in_paged_kvcache", "Max tokens in paged K-V Cache.", cxxopts::value<int>());
+    options.add_options()(
+        "kv_cache_free_gpu_mem_fraction", "K-V Cache Free Gpu Mem Fraction.", cxxopts::value<float>());
+    options.add_options()("enable_kv_cache_reuse", "Enables the KV cache reuse.", cxxopts::value<bool>());
+    options.add_options()("scheduler_policy", "Choose scheduler policy between max_utilization/guaranteed_no_evict.",
+        cxxopts::value<std::string>()->default_value("guaranteed_no_evict"));
+    options.add_options()("log_level", "Choose log level between verbose/info/warning/error/internal_error.",
+        cxxopts::value<std::string>()->default_value("info"));
+    options.add_options()("iteration_stats", "File to append the stats of each iteration to, as JSON lines.",
+        cxxopts::value<std::string>());
+    options.add_options()("flight_record", "File to dump the last iterations to on SIGUSR1 or on an error.",
+        cxxopts::value<std::string>());
+    options.add_options()("record_requests",
+        "File to record the requests to, with the iterations that fetched them, see replay_requests of "
+        "gptManagerBenchmark.",
+        cxxopts::value<std::string>());
+
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help"))
+    {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    // Argument: Engine directory
+    if (!result.count("engine_dir"))
+    {
+        std::cout << options.help() << std::endl;
+        TLLM_LOG_ERROR("Please specify engine directory.");
+        return 1;
+    }
+
+    // Argument: Batching Type
+    TrtGptModelType modelType;
+    auto const type = result["type"].as<std::string>();
+    if (type == "V1")
+    {
+        modelType = TrtGptModelType::V1;
+    }
+    else if (type == "IFB")
+    {
+        modelType = TrtGptModelType::InflightFusedBatching;
+    }
+    else
+    {
+        TLLM_LOG_ERROR("Unexpected batching type: %s", type.c_str());
+        return 1;
+    }
+
+    TrtGptModelOptionalParams optionalParams;
+    // Argument: Max Num Sequences
+    if (result.count("max_num_sequences"))
+    {
+        optionalParams.maxNumSequences = result["max_num_sequences"].as<int>();
+    }
+    // Argument: Max tokens in paged K-V Cache
+    if (result.count("max_tokens_in_paged_kvcache"))
+    {
+        optionalParams.kvCacheConfig.maxTokens = result["max_tokens_in_paged_kvcache"].as<int>();
+    }
+    // Argument: K-V Cache Free Gpu Mem Fraction
+    if (result.count("kv_cache_free_gpu_mem_fraction"))
+    {
+        optionalParams.kvCacheConfig.freeGpuMemoryFraction = result["kv_cache_free_gpu_mem_fraction"].as<float>();
+    }
+    // Argument: Enable KV cache reuse
+    if (result.count("enable_kv_cache_reuse"))
+    {
+        optionalParams.kvCacheConfig.enableBlockReuse = result["enable_kv_cache_reuse"].as<bool>();
+    }
+
+    RequestDefaults defaults{result["max_new_tokens"].as<int>(), std::nullopt, std::nullopt};
+    // Argument: End-of-sentence token id
+    if (result.count("eos_id"))
+    {
+        defaults.endId = result["eos_id"].as<int>();
+    }
+    // Argument: Padding token id
+    if (result.count("pad_id"))
+    {
+        defaults.padId = result["pad_id"].as<int>();
+    }
+
+    // Argument: Scheduler policy
+    batch_scheduler::SchedulerPolicy schedulerPolicy;
+    auto const schedulerPolicyArg = result["scheduler_policy"].as<std::string>();
+    if (schedulerPolicyArg == "max_utilization")
+    {
+        schedulerPolicy = batch_scheduler::SchedulerPolicy::MAX_UTILIZATION;
+    }
+    else if (schedulerPolicyArg == "guaranteed_no_evict")
+    {
+        schedulerPolicy = batch_scheduler::SchedulerPolicy::GUARANTEED_NO_EVICT;
+    }
+    else
+    {
+        TLLM_LOG_ERROR("Unexpected scheduler policy: " + schedulerPolicyArg);
+        return 1;
+    }
+
+    // Argument: Log level
+    auto logger = std::make_shared<TllmLogger>();
+    auto const logLevel = result["log_level"].as<std::string>();
+    if (logLevel == "verbose")
+    {
+        logger->setLevel(trt::ILogger::Severity::kVERBOSE);
+    }
+    else if (logLevel == "info")
+    {
+        logger->setLevel(trt::ILogger::Severity::kINFO);
+    }
+    else if (logLevel == "warning")
+    {
+        logger->setLevel(trt::ILogger::Severity::kWARNING);
+    }
+    else if (logLevel == "error")
+    {
+        logger->setLevel(trt::ILogger::Severity::kERROR);
+    }
+    else if (logLevel == "internal_error")
+    {
+        logger->setLevel(trt::ILogger::Severity::kINTERNAL_ERROR);
+    }
+    else
+    {
+        TLLM_LOG_ERROR("Unexpected log level: " + logLevel);
+        return 1;
+    }
+
+    initTrtLlmPlugins(logger.get());
+
+    // The signals are waited for by the main thread, the threads started from here inherit the mask
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    try
+    {
+        TLLM_CHECK_WITH_INFO(COMM_SESSION.getSize() == 1, "The server runs engines of a single rank");
+
+        std::optional<Detokenizer> detokenizer;
+        auto const tokenizerPath = result["tokenizer"].as<std::string>();
+        if (!tokenizerPath.empty())
+        {
+            detokenizer = Detokenizer::parse(std::filesystem::path{tokenizerPath});
+        }
+
+        std::optional<std::filesystem::path> iterationStatsPath;
+        if (result.count("iteration_stats"))
+        {
+            iterationStatsPath = result["iteration_stats"].as<std::string>();
+        }
+        std::optional<std::string> flightRecordPath;
+        if (result.count("flight_record"))
+        {
+            flightRecordPath = result["flight_record"].as<std::string>();
+        }
+        std::optional<std::filesystem::path> requestRecordPath;
+        if (result.count("record_requests"))
+        {
+            requestRecordPath = result["record_requests"].as<std::string>();
+        }
+
+        auto server = std::make_unique<Server>(result["engine_dir"].as<std::string>(), modelType,
+            result["max_beam_width"].as<int>(), schedulerPolicy, optionalParams, std::move(detokenizer), defaults,
+            iterationStatsPath, flightRecordPath, requestRecordPath);
+
+        auto const host = result["host"].as<std::string>();
+        auto const port = result["port"].as<int>();
+        auto const listenFd = listenOn(host, port);
+        std::vector<std::unique_ptr<IoThread>> ioThreads;
+        for (int i = 0; i < std::max(result["io_threads"].as<int>(), 1); ++i)
+        {
+            ioThreads.push_back(std::make_unique<IoThread>(*server, listenFd));
+        }
+        TLLM_LOG_INFO("Listening on %s:%d", host.c_str(), port);
+
+        int signal = 0;
+        sigwait(&signals, &signal);
+        TLLM_LOG_INFO("Shutting down on signal %d", signal);
+
+        // The connections are closed first, then the generation loop posts its last responses to the stopped threads
+        for (auto& ioThread : ioThreads)
+        {
+            ioThread->stop();
+        }
+        server->shutdown();
+        ioThreads.clear();
+        ::close(listenFd);
+    }
+    catch (std::exception const& e)
+    {
+        TLLM_LOG_ERROR(e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,455 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2022-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/kernels/mixtureOfExperts/moe_kernels.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cxxopts.hpp>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace tensorrt_llm::kernels;
+using namespace tensorrt_llm::runtime;
+
+namespace tc = tensorrt_llm::common;
+
+namespace
+{
+constexpr int kNumPhases = static_cast<int>(MOEPhase::NUM_PHASES);
+constexpr std::array<char const*, kNumPhases> kPhaseNames{"routing", "fc1", "fc2", "finalize"};
+
+using PhaseTimes = std::array<float, kNumPhases>;
+using PhaseCounts = std::array<double, kNumPhases>;
+
+struct MoeLayerConfig
+{
+    int numTokens;
+    int numExperts;
+    int topK;
+    int hiddenSize;
+    int interSize;
+    tensorrt_llm::ActivationType activationType;
+    // "none", "tp" or "ep". Only the work of rank 0 is run, the communication between the ranks is not included.
+    std::string parallelism;
+    int parallelSize;
+
+    MOEParallelismConfig getParallelismConfig() const
+    {
+        if (parallelism == "tp")
+        {
+            return MOEParallelismConfig::TensorParallelism(parallelSize, 0);
+        }
+        if (parallelism == "ep")
+        {
+            return MOEParallelismConfig::ExpertParallelism(parallelSize, 0);
+        }
+        return {};
+    }
+};
+
+// Runs the MoE layer numRuns times and returns the average time of each phase in ms
+template <typename T, typename WeightType>
+PhaseTimes timeMoeLayer(CutlassMoeFCRunner<T, WeightType>& runner, MoeLayerConfig const& config,
+    std::vector<void*> const& ptrs, std::array<cudaEvent_t, kNumPhases + 1> const& events, int warmUp, int numRuns,
+    cudaStream_t stream)
+{
+    auto const parallelismConfig = config.getParallelismConfig();
+    auto const interSize = config.interSize / parallelismConfig.tp_size;
+    auto run = [&]()
+    {
+        runner.runMoe(ptrs[0], static_cast<float const*>(ptrs[1]), ptrs[2], ptrs[3], ptrs[4], config.activationType,
+            ptrs[5], ptrs[6], ptrs[7], config.numTokens, config.hiddenSize, interSize, config.numExperts, config.topK,
+            static_cast<char*>(ptrs[8]), ptrs[9], ptrs[10], nullptr, config.numTokens, ptrs[11],
+            static_cast<int*>(ptrs[12]), static_cast<int*>(ptrs[13]), parallelismConfig,
+            MOEExpertScaleNormalizationMode::RENORMALIZE, stream);
+    };
+
+    runner.setPhaseEvents(nullptr);
+    for (int i = 0; i < warmUp; ++i)
+    {
+        run();
+    }
+    TLLM_CUDA_CHECK(cudaStreamSynchronize(stream));
+
+    PhaseTimes times{};
+    runner.setPhaseEvents(events.data() + 1);
+    for (int i = 0; i < numRuns; ++i)
+    {
+        TLLM_CUDA_CHECK(cudaEventRecord(events[0], stream));
+        run();
+        TLLM_CUDA_CHECK(cudaEventSynchronize(events[kNumPhases]));
+        for (int phase = 0; phase < kNumPhases; ++phase)
+        {
+            float ms{};
+            TLLM_CUDA_CHECK(cudaEventElapsedTime(&ms, events[phase], events[phase + 1]));
+            times[phase] += ms / numRuns;
+        }
+    }
+    runner.setPhaseEvents(nullptr);
+    return times;
+}
+
+template <typename T, typename WeightType>
+void benchmarkMoeLayer(MoeLayerConfig const& config, BufferManager const& bufferManager, int warmUp, int numRuns,
+    bool allTactics, std::string const& dtypeName, std::string const& weightTypeName)
+{
+    constexpr bool isQuantized = !std::is_same_v<T, WeightType>;
+    constexpr double weightBytes = std::is_same_v<WeightType, cutlass::uint4b_t> ? 0.5 : sizeof(WeightType);
+    constexpr size_t dtypeBytes = sizeof(T);
+
+    auto stream = bufferManager.getStream().get();
+    auto const parallelismConfig = config.getParallelismConfig();
+    size_t const numTokens = config.numTokens;
+    size_t const hiddenSize = config.hiddenSize;
+    size_t const interSize = config.interSize / parallelismConfig.tp_size;
+    size_t const numLocalExperts = config.numExperts / parallelismConfig.ep_size;
+    size_t const fc1OutSize = isGatedActivation(config.activationType) ? 2 * interSize : interSize;
+
+    CutlassMoeFCRunner<T, WeightType> runner;
+    size_t const workspaceSize = runner.getWorkspaceSize(config.numTokens, config.hiddenSize, interSize,
+        config.numExperts, config.topK, config.activationType, parallelismConfig);
+
+    // The contents do not change the timings, only the routing matters and it is load balanced below
+    std::vector<size_t> const sizes{
+        numTokens * hiddenSize * dtypeBytes,                                          // input
+        numTokens * config.numExperts * sizeof(float),                                // routing
+        static_cast<size_t>(numLocalExperts * hiddenSize * fc1OutSize * weightBytes), // fc1 weights
+        isQuantized ? numLocalExperts * fc1OutSize * dtypeBytes : 0,                  // fc1 scales
+        numLocalExperts * fc1OutSize * dtypeBytes,                                    // fc1 bias
+        static_cast<size_t>(numLocalExperts * interSize * hiddenSize * weightBytes),  // fc2 weights
+        isQuantized ? numLocalExperts * hiddenSize * dtypeBytes : 0,                  // fc2 scales
+        numLocalExperts * hiddenSize * dtypeBytes,                                    // fc2 bias
+        workspaceSize,                                                                // workspace
+        numTokens * hiddenSize * dtypeBytes,                                          // output
+        numTokens * config.topK * hiddenSize * dtypeBytes,                            // fc2 result
+        numTokens * config.numExperts * sizeof(float),                                // expert scales
+        numTokens * config.topK * sizeof(int),                                        // source to expanded row
+        numTokens * config.topK * sizeof(int),                                        // selected experts
+    };
+    std::vector<BufferManager::IBufferPtr> buffers;
+    std::vector<void*> ptrs;
+    for (auto size : sizes)
+    {
+        if (size == 0)
+        {
+            ptrs.push_back(nullptr);
+            continue;
+        }
+        buffers.push_back(bufferManager.gpu(size));
+        ptrs.push_back(buffers.back()->data());
+        TLLM_CUDA_CHECK(cudaMemsetAsync(ptrs.back(), 0x11, size, stream));
+    }
+    makeLoadBalancedRoutingConfiguration(
+        ptrs[1], config.numExperts, config.numTokens, config.topK, nvinfer1::DataType::kFLOAT, stream);
+
+    std::array<cudaEvent_t, kNumPhases + 1> events{};
+    for (auto& event : events)
+    {
+        TLLM_CUDA_CHECK(cudaEventCreate(&event));
+    }
+
+    if (allTactics)
+    {
+        // Keep the fastest tactic, as the plugin profiler does
+        std::optional<tensorrt_llm::cutlass_extensions::CutlassGemmConfig> bestTactic;
+        float bestTime = std::numeric_limits<float>::max();
+        for (auto const& tactic : runner.getTactics())
+        {
+            runner.setTactic(tactic);
+            try
+            {
+                auto const times = timeMoeLayer(runner, config, ptrs, events, warmUp, numRuns, stream);
+                auto const total = times[static_cast<int>(MOEPhase::FC1)] + times[static_cast<int>(MOEPhase::FC2)];
+                if (total < bestTime)
+                {
+                    bestTime = total;
+                    bestTactic = tactic;
+                }
+            }
+            catch (std::exception const& e)
+            {
+                TLLM_LOG_WARNING("Skipping a tactic: %s", e.what());
+            }
+        }
+        runner.setTactic(bestTactic);
+    }
+
+    auto const times = timeMoeLayer(runner, config, ptrs, events, warmUp, numRuns, stream);
+
+    for (auto event : events)
+    {
+        TLLM_CUDA_CHECK(cudaEventDestroy(event));
+    }
+
+    // Rows of rank 0 with load balanced routing, and the experts they read the weights of
+    double const expandedRows = static_cast<double>(numTokens) * config.topK * numLocalExperts / config.numExperts;
+    double const touchedExperts = std::min(static_cast<double>(numLocalExperts), std::ceil(expandedRows));
+    double const scaleBytes = isQuantized ? dtypeBytes : 0;
+
+    PhaseCounts flops{};
+    flops[static_cast<int>(MOEPhase::FC1)] = 2.0 * expandedRows * hiddenSize * fc1OutSize;
+    flops[static_cast<int>(MOEPhase::FC2)] = 2.0 * expandedRows * interSize * hiddenSize;
+
+    PhaseCounts bytes{};
+    bytes[static_cast<int>(MOEPhase::ROUTING)] = numTokens * config.numExperts * sizeof(float)
+        + numTokens * hiddenSize * dtypeBytes + expandedRows * hiddenSize * dtypeBytes;
+    bytes[static_cast<int>(MOEPhase::FC1)] = touchedExperts * fc1OutSize * (hiddenSize * weightBytes + scaleBytes)
+        + expandedRows * (hiddenSize + fc1OutSize) * dtypeBytes;
+    bytes[static_cast<int>(MOEPhase::FC2)] = touchedExperts * hiddenSize * (interSize * weightBytes + scaleBytes)
+        + expandedRows * (interSize + hiddenSize) * dtypeBytes;
+    bytes[static_cast<int>(MOEPhase::FINALIZE)]
+        = expandedRows * hiddenSize * dtypeBytes + numTokens * hiddenSize * dtypeBytes;
+
+    std::ostringstream prefix;
+    prefix << "[BENCHMARK] tokens " << config.numTokens << " experts " << config.numExperts << " top_k "
+           << config.topK << " hidden " << config.hiddenSize << " inter " << config.interSize << " dtype "
+           << dtypeName << " weight_type " << weightTypeName << " parallelism " << config.parallelism << " "
+           << config.parallelSize;
+    float totalMs = 0.f;
+    for (int phase = 0; phase < kNumPhases; ++phase)
+    {
+        totalMs += times[phase];
+        std::ostringstream line;
+        line << prefix.str() << " phase " << kPhaseNames[phase] << " latency(ms) " << times[phase];
+        if (flops[phase] > 0)
+        {
+            line << " tflops " << flops[phase] / (times[phase] * 1e9);
+        }
+        line << " bandwidth(GB/s) " << bytes[phase] / (times[phase] * 1e6);
+        std::cout << line.str() << std::endl;
+    }
+    std::cout << prefix.str() << " phase total latency(ms) " << totalMs << std::endl;
+}
+
+template <typename T>
+void benchmarkMoeLayer(MoeLayerConfig const& config, BufferManager const& bufferManager, int warmUp, int numRuns,
+    bool allTactics, std::string const& dtypeName, std::string const& weightTypeName)
+{
+    if (weightTypeName == "int8")
+    {
+        benchmarkMoeLayer<T, uint8_t>(config, bufferManager, warmUp, numRuns, allTactics, dtypeName, weightTypeName);
+    }
+    else if (weightTypeName == "int4")
+    {
+        benchmarkMoeLayer<T, cutlass::uint4b_t>(
+            config, bufferManager, warmUp, numRuns, allTactics, dtypeName, weightTypeName);
+    }
+    else
+    {
+        benchmarkMoeLayer<T, T>(config, bufferManager, warmUp, numRuns, allTactics, dtypeName, weightTypeName);
+    }
+}
+
+std::vector<int> parseList(std::string const& arg)
+{
+    std::istringstream ss(arg);
+    std::vector<int> values;
+    for (std::string token; std::getline(ss, token, ';');)
+    {
+        values.push_back(std::stoi(token));
+    }
+    return values;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    cxxopts::Options options("TensorRT-LLM MoE Layer Benchmark",
+        "TensorRT-LLM benchmark of the MoE layer, reporting the time of each phase. Multiple values can be separated "
+        "by \";\", example: \"1;8;64\", all their combinations are benchmarked.");
+    options.add_options()("h,help", "Print usage");
+    options.add_options()(
+        "num_tokens", "Number of tokens of the layer.", cxxopts::value<std::string>()->default_value("1;64;4096"));
+    options.add_options()("num_experts", "Number of experts.", cxxopts::value<std::string>()->default_value("8"));
+    options.add_options()("top_k", "Number of experts per token.", cxxopts::value<std::string>()->default_value("2"));
+    options.add_options()("hidden_size", "Hidden size.", cxxopts::value<std::string>()->default_value("4096"));
+    options.add_options()(
+        "inter_size", "Intermediate size of each expert.", cxxopts::value<std::string>()->default_value("14336"));
+    options.add_options()("parallel_size", "Number of ranks splitting the layer.",
+        cxxopts::value<std::string>()->default_value("1"));
+    options.add_options()("parallelism",
+        "How the ranks split the layer, between none/tp/ep. Only the work of one rank is run, without the "
+        "communication.",
+        cxxopts::value<std::string>()->default_value("none"));
+    options.add_options()(
+        "dtype", "Activation type, between fp16/bf16/fp32.", cxxopts::value<std::string>()->default_value("fp16"));
+    options.add_options()("weight_type", "Expert weight type, between same/int8/int4.",
+        cxxopts::value<std::string>()->default_value("same"));
+    options.add_options()("activation", "Expert activation, between gelu/relu/silu/swiglu/geglu.",
+        cxxopts::value<std::string>()->default_value("swiglu"));
+    options.add_options()("all_tactics", "Time all the GEMM tactics and report the fastest instead of the heuristic.");
+    options.add_options()(
+        "warm_up", "Specify warm up iterations before benchmark starts.", cxxopts::value<int>()->default_value("2"));
+    options.add_options()(
+        "num_runs", "Number of iterations to average.", cxxopts::value<int>()->default_value("10"));
+    options.add_options()("log_level", "Choose log level between verbose/info/warning/error/internal_error.",
+        cxxopts::value<std::string>()->default_value("error"));
+
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help"))
+    {
+        std::cout << options.help() << std::endl;
+        exit(0);
+    }
+
+    auto const logLevel = result["log_level"].as<std::string>();
+    auto* logger = tc::Logger::getLogger();
+    if (logLevel == "verbose")
+    {
+        logger->setLevel(tc::Logger::TRACE);
+    }
+    else if (logLevel == "info")
+    {
+        logger->setLevel(tc::Logger::INFO);
+    }
+    else if (logLevel == "warning")
+    {
+        logger->setLevel(tc::Logger::WARNING);
+    }
+    else if (logLevel == "error" || logLevel == "internal_error")
+    {
+        logger->setLevel(tc::Logger::ERROR);
+    }
+    else
+    {
+        TLLM_LOG_ERROR("Unexpected log level: " + logLevel);
+        return 1;
+    }
+
+    auto const activation = result["activation"].as<std::string>();
+    tensorrt_llm::ActivationType activationType;
+    if (activation == "gelu")
+    {
+        activationType = tensorrt_llm::ActivationType::Gelu;
+    }
+    else if (activation == "relu")
+    {
+        activationType = tensorrt_llm::ActivationType::Relu;
+    }
+    else if (activation == "silu")
+    {
+        activationType = tensorrt_llm::ActivationType::Silu;
+    }
+    else if (activation == "swiglu")
+    {
+        activationType = tensorrt_llm::ActivationType::Swiglu;
+    }
+    else if (activation == "geglu")
+    {
+        activationType = tensorrt_llm::ActivationType::Geglu;
+    }
+    else
+    {
+        TLLM_LOG_ERROR("Unexpected activation: " + activation);
+        return 1;
+    }
+
+    auto const parallelism = result["parallelism"].as<std::string>();
+    if (parallelism != "none" && parallelism != "tp" && parallelism != "ep")
+    {
+        TLLM_LOG_ERROR("Unexpected parallelism: " + parallelism);
+        return 1;
+    }
+    auto const dtype = result["dtype"].as<std::string>();
+    auto const weightType = result["weight_type"].as<std::string>();
+    if (weightType != "same" && weightType != "int8" && weightType != "int4")
+    {
+        TLLM_LOG_ERROR("Unexpected weight type: " + weightType);
+        return 1;
+    }
+    if (dtype == "fp32" && weightType != "same")
+    {
+        TLLM_LOG_ERROR("Quantized weights require fp16 or bf16 activations");
+        return 1;
+    }
+
+    auto const warmUp = result["warm_up"].as<int>();
+    auto const numRuns = result["num_runs"].as<int>();
+    auto const allTactics = result.count("all_tactics") > 0;
+
+    BufferManager bufferManager{std::make_shared<CudaStream>()};
+
+    for (auto numExperts : parseList(result["num_experts"].as<std::string>()))
+    {
+        for (auto topK : parseList(result["top_k"].as<std::string>()))
+        {
+            for (auto hiddenSize : parseList(result["hidden_size"].as<std::string>()))
+            {
+                for (auto interSize : parseList(result["inter_size"].as<std::string>()))
+                {
+                    for (auto parallelSize : parseList(result["parallel_size"].as<std::string>()))
+                    {
+                        if ((parallelism == "none" && parallelSize != 1)
+                            || (parallelism == "tp" && interSize % parallelSize != 0)
+                            || (parallelism == "ep" && numExperts % parallelSize != 0))
+                        {
+                            TLLM_LOG_WARNING("Skipping parallel size %d, it does not divide the layer", parallelSize);
+                            continue;
+                        }
+                        for (auto numTokens : parseList(result["num_tokens"].as<std::string>()))
+                        {
+                            MoeLayerConfig const config{numTokens, numExperts, topK, hiddenSize, interSize,
+                                activationType, parallelism, parallelSize};
+                            try
+                            {
+                                if (dtype == "fp16")
+                                {
+                                    benchmarkMoeLayer<half>(
+                                        config, bufferManager, warmUp, numRuns, allTactics, dtype, weightType);
+                                }
+#ifdef ENABLE_BF16
+                                else if (dtype == "bf16")
+                                {
+                                    benchmarkMoeLayer<__nv_bfloat16>(
+                                        config, bufferManager, warmUp, numRuns, allTactics, dtype, weightType);
+                                }
+#endif
+                                else if (dtype == "fp32")
+                                {
+                                    benchmarkMoeLayer<float, float>(
+                                        config, bufferManager, warmUp, numRuns, allTactics, dtype, weightType);
+                                }
+                                else
+                                {
+                                    TLLM_LOG_ERROR("Unexpected dtype: " + dtype);
+                                    return 1;
+                                }
+                            }
+                            catch (std::exception const& e)
+                            {
+                                TLLM_LOG_ERROR(e.what());
+                                return 1;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
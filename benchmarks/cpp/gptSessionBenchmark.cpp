@@ -14,17 +14,28 @@
  * See the License for the specific language governing permissions and
  * limitations under the License.
  */
+#include "benchmarkReport.h"
+#include "rankTiming.h"
 #include "tensorrt_llm/common/memoryUtils.h"
+#include "tensorrt_llm/common/mpiUtils.h"
+#include "tensorrt_llm/common/stringUtils.h"
 #include "tensorrt_llm/plugins/api/tllmPlugin.h"
 #include "tensorrt_llm/runtime/gptJsonConfig.h"
 #include "tensorrt_llm/runtime/gptSession.h"
 #include "tensorrt_llm/runtime/iTensor.h"
+#include "tensorrt_llm/runtime/layerProfileStats.h"
 #include "tensorrt_llm/runtime/memoryCounters.h"
 #include "tensorrt_llm/runtime/tllmLogger.h"
 
 #include <NvInfer.h>
+#include <algorithm>
+#include <cctype>
 #include <chrono>
+#include <cmath>
 #include <cxxopts.hpp>
+#include <map>
+#include <numeric>
+#include <optional>
 #include <sstream>
 #include <string>
 
@@ -35,10 +46,239 @@ namespace trt = nvinfer1;
 
 namespace
 {
+// Snake case name of the owner of the memory, e.g. kv_cache
+std::string getMemoryTagKey(MemoryTag tag)
+{
+    std::string key = getMemoryTagName(tag);
+    std::transform(key.begin(), key.end(), key.begin(),
+        [](unsigned char c) { return c == ' ' ? '_' : static_cast<char>(std::tolower(c)); });
+    return key;
+}
+
+// Memory allocated through the runtime by each owner, the highest since the last MemoryCounters::resetPeaks and the
+// one still allocated (steady state), and the memory used on the device including the CUDA context and TensorRT
+void reportMemory(
+    nlohmann::json const& params, std::string const& prefix, tensorrt_llm::benchmark::BenchmarkReport& report)
+{
+    auto constexpr MB = static_cast<double>(1 << 20);
+    std::size_t freeMem{0};
+    std::size_t totalMem{0};
+    TLLM_CUDA_CHECK(cudaMemGetInfo(&freeMem, &totalMem));
+    auto const gpuPeak = MemoryCounters::getPeak(MemoryType::kGPU);
+    auto const gpuSteady = MemoryCounters::getInstance().getGpu();
+    auto const pinnedPeak = MemoryCounters::getPeak(MemoryType::kPINNED);
+    auto const pinnedSteady = MemoryCounters::getInstance().getPinned();
+    printf("[BENCHMARK] %s memory device_used(MB) %.2f gpu_peak(MB) %.2f gpu_steady(MB) %.2f pinned_peak(MB) %.2f "
+           "pinned_steady(MB) %.2f\n",
+        prefix.c_str(), (totalMem - freeMem) / MB, gpuPeak / MB, gpuSteady / MB, pinnedPeak / MB, pinnedSteady / MB);
+    report.addMetric(params, "memory_device_used_bytes", {static_cast<double>(totalMem - freeMem)}, false);
+    report.addMetric(params, "memory_gpu_peak_bytes", {static_cast<double>(gpuPeak)}, false);
+    report.addMetric(params, "memory_pinned_peak_bytes", {static_cast<double>(pinnedPeak)}, false);
+
+    for (std::size_t tagIdx = 0; tagIdx < kNbMemoryTags; ++tagIdx)
+    {
+        auto const tag = static_cast<MemoryTag>(tagIdx);
+        auto const tagGpuPeak = MemoryCounters::getTaggedPeak(MemoryType::kGPU, tag);
+        auto const tagPinnedPeak = MemoryCounters::getTaggedPeak(MemoryType::kPINNED, tag);
+        if (tagGpuPeak == 0 && tagPinnedPeak == 0)
+        {
+            continue;
+        }
+        auto const key = getMemoryTagKey(tag);
+        printf("[BENCHMARK] %s memory_owner %s gpu_peak(MB) %.2f gpu_steady(MB) %.2f pinned_peak(MB) %.2f "
+               "pinned_steady(MB) %.2f\n",
+            prefix.c_str(), key.c_str(), tagGpuPeak / MB, MemoryCounters::getTagged(MemoryType::kGPU, tag) / MB,
+            tagPinnedPeak / MB, MemoryCounters::getTagged(MemoryType::kPINNED, tag) / MB);
+        report.addMetric(params, "memory_gpu_peak_bytes_" + key, {static_cast<double>(tagGpuPeak)}, false);
+    }
+}
+
+// Time of each kind of layer per profiled enqueue and its share of the time of all the layers
+void reportLayerProfile(LayerProfileStats const& profile, nlohmann::json const& params, std::string const& prefix,
+    tensorrt_llm::benchmark::BenchmarkReport& report)
+{
+    auto const totalTimeMs = profile.getTotalTimeMs();
+    if (profile.numProfiledEnqueues == 0 || totalTimeMs <= 0)
+    {
+        return;
+    }
+    auto const numEnqueues = static_cast<double>(profile.numProfiledEnqueues);
+    std::string kinds;
+    for (std::size_t kindIdx = 0; kindIdx < kNbLayerKinds; ++kindIdx)
+    {
+        auto const& kindStats = profile.kinds[kindIdx];
+        std::string key = getLayerKindName(static_cast<LayerKind>(kindIdx));
+        std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return std::tolower(c); });
+        kinds += tc::fmtstr(" %s(%%) %.1f", key.c_str(), 100.0 * kindStats.timeMs / totalTimeMs);
+        report.addMetric(params, "layer_time_ms_" + key, {kindStats.timeMs / numEnqueues}, false);
+    }
+    printf("[BENCHMARK] %s profiled_enqueues %lu layers_time_per_enqueue(ms) %.3f%s\n", prefix.c_str(),
+        profile.numProfiledEnqueues, totalTimeMs / numEnqueues, kinds.c_str());
+}
+
+// Least squares fit of y = c[0] + c[1] * x + ... + c[degree] * x^degree, empty if there are too few points
+std::vector<double> fitPolynomial(std::vector<double> const& x, std::vector<double> const& y, std::size_t degree)
+{
+    auto const n = degree + 1;
+    if (x.size() < n)
+    {
+        return {};
+    }
+    // Scale x to keep the normal equations well conditioned up to long sequences
+    auto const scale = *std::max_element(x.begin(), x.end());
+    std::vector<std::vector<double>> a(n, std::vector<double>(n + 1, 0.0));
+    for (std::size_t k = 0; k < x.size(); ++k)
+    {
+        std::vector<double> powers(2 * n - 1, 1.0);
+        for (std::size_t i = 1; i < powers.size(); ++i)
+        {
+            powers[i] = powers[i - 1] * x[k] / scale;
+        }
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            for (std::size_t j = 0; j < n; ++j)
+            {
+                a[i][j] += powers[i + j];
+            }
+            a[i][n] += powers[i] * y[k];
+        }
+    }
+    // Gaussian elimination with partial pivoting
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        auto const pivot = std::max_element(a.begin() + i, a.end(),
+            [i](auto const& lhs, auto const& rhs) { return std::abs(lhs[i]) < std::abs(rhs[i]); });
+        std::swap(a[i], *pivot);
+        if (a[i][i] == 0)
+        {
+            return {};
+        }
+        for (std::size_t r = 0; r < n; ++r)
+        {
+            if (r != i)
+            {
+                auto const factor = a[r][i] / a[i][i];
+                for (std::size_t c = i; c <= n; ++c)
+                {
+                    a[r][c] -= factor * a[i][c];
+                }
+            }
+        }
+    }
+    std::vector<double> coefficients(n);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        coefficients[i] = a[i][n] / a[i][i] / std::pow(scale, i);
+    }
+    return coefficients;
+}
+
+// Latencies of the phases of a run of the input length sweep
+struct SweepPoint
+{
+    SizeType inputLength;
+    SizeType outputLength;
+    double contextLatencyMs;
+    double decodeLatencyMs;
+};
+
+// The time that grows with the sequence length faster than the rest of the model is spent in the attention: the
+// context latency is fitted with a quadratic and the decode latency per token with a linear function of the length.
+void reportAttentionShare(SizeType batchSize, std::vector<SweepPoint> const& points)
+{
+    std::vector<double> inputLengths;
+    std::vector<double> contextLatencies;
+    std::vector<double> kvLengths;
+    std::vector<double> decodeLatencies;
+    for (auto const& point : points)
+    {
+        inputLengths.push_back(point.inputLength);
+        contextLatencies.push_back(point.contextLatencyMs);
+        // Average length of the KV cache read by the decode steps
+        kvLengths.push_back(point.inputLength + point.outputLength / 2.0);
+        decodeLatencies.push_back(point.decodeLatencyMs);
+    }
+    auto const contextFit = fitPolynomial(inputLengths, contextLatencies, 2);
+    auto const decodeFit = fitPolynomial(kvLengths, decodeLatencies, 1);
+    if (contextFit.empty() || decodeFit.empty())
+    {
+        TLLM_LOG_WARNING("At least 3 input lengths are needed to estimate the attention share");
+        return;
+    }
+    for (std::size_t i = 0; i < points.size(); ++i)
+    {
+        auto const contextShare
+            = std::clamp(contextFit[2] * inputLengths[i] * inputLengths[i] / contextLatencies[i], 0.0, 1.0);
+        auto const decodeShare = std::clamp(decodeFit[1] * kvLengths[i] / decodeLatencies[i], 0.0, 1.0);
+        printf("[BENCHMARK] batch_size %d input_length %d output_length %d attention_share_context(%%) %.1f "
+               "attention_share_decode(%%) %.1f\n",
+            batchSize, points[i].inputLength, points[i].outputLength, contextShare * 100, decodeShare * 100);
+    }
+}
+
+// Draft model of speculative decoding
+struct SpeculativeConfig
+{
+    std::filesystem::path engineDir;
+    std::string modelName;
+    std::vector<int> numsDraftTokens;
+};
+
+// Latencies of speculative decoding runs and the acceptance of their draft tokens, summed over the runs
+struct SpeculativeResults
+{
+    std::vector<double> latencies;
+    GptSession::SpeculativeDecodingStats stats;
+};
+
+SpeculativeResults benchmarkSpeculative(GptSession& session, GptSession& draftSession,
+    GenerationInput const& generationInput, SamplingConfig const& samplingConfig, SizeType numDraftTokens, int warmUp,
+    int numRuns, int duration)
+{
+    auto& bufferManager = session.getBufferManager();
+    GenerationOutput generationOutput{bufferManager.emptyTensor(MemoryType::kGPU, nvinfer1::DataType::kINT32),
+        bufferManager.emptyTensor(MemoryType::kGPU, nvinfer1::DataType::kINT32)};
+    for (auto r = 0; r < warmUp; ++r)
+    {
+        session.generateSpeculative(generationOutput, generationInput, samplingConfig, draftSession, numDraftTokens);
+    }
+
+    SpeculativeResults results;
+    auto& total = results.stats;
+    total.numDraftTokens.resize(numDraftTokens, 0);
+    total.numAcceptedTokens.resize(numDraftTokens, 0);
+    double curDuration = 0;
+    while (static_cast<int>(results.latencies.size()) < numRuns || curDuration / 1000 < duration)
+    {
+        auto const start = std::chrono::steady_clock::now();
+        session.generateSpeculative(generationOutput, generationInput, samplingConfig, draftSession, numDraftTokens);
+        auto const end = std::chrono::steady_clock::now();
+        auto const latency = std::chrono::duration<double, std::milli>(end - start).count();
+        curDuration += latency;
+        results.latencies.push_back(latency);
+
+        auto const& stats = session.getSpeculativeDecodingStats();
+        total.numIterations += stats.numIterations;
+        total.numVerifications += stats.numVerifications;
+        total.numTokens += stats.numTokens;
+        for (SizeType position = 0; position < numDraftTokens; ++position)
+        {
+            total.numDraftTokens[position] += stats.numDraftTokens[position];
+            total.numAcceptedTokens[position] += stats.numAcceptedTokens[position];
+        }
+        total.draftTimeMs += stats.draftTimeMs;
+        total.targetTimeMs += stats.targetTimeMs;
+    }
+    return results;
+}
+
 void benchmarkGptSession(std::string const& modelName, std::filesystem::path const& dataPath,
     std::vector<int> const& batchSizes, int beamWidth, std::vector<std::vector<int>> const& inOutLen,
+    std::vector<int> const& inputLenSweep,
     std::shared_ptr<nvinfer1::ILogger> const& logger, int warmUp, int numRuns, int duration,
-    GptSession::Config& sessionConfig, bool cudaGraphMode, bool printAllLogits, bool disableForceMaxTokens)
+    GptSession::Config& sessionConfig, bool cudaGraphMode, bool printAllLogits, bool disableForceMaxTokens,
+    bool profileMemory, bool timeRanks, SizeType layerProfilingInterval,
+    std::optional<SpeculativeConfig> const& speculativeConfig, tensorrt_llm::benchmark::BenchmarkReport& report)
 {
     std::string modelNameHyphen = modelName;
     std::filesystem::path jsonFileName = dataPath / "config.json";
@@ -48,6 +288,8 @@ void benchmarkGptSession(std::string const& modelName, std::filesystem::path con
     SizeType deviceCount{0};
     TLLM_CUDA_CHECK(cudaGetDeviceCount(&deviceCount));
     auto const worldConfig = WorldConfig::mpi(deviceCount, json.getTensorParallelism(), json.getPipelineParallelism());
+    // The plugins are warmed up while the first session deserializes its engine and allocates its KV cache
+    tensorrt_llm::plugins::api::PluginWarmup pluginWarmup{worldConfig.getDevice()};
     auto const enginePath = dataPath / json.engineFilename(worldConfig, modelNameHyphen);
     auto const dtype = modelConfig.getDataType();
     auto const useHalf = (dtype == nvinfer1::DataType::kHALF);
@@ -63,16 +305,95 @@ void benchmarkGptSession(std::string const& modelName, std::filesystem::path con
     sessionConfig.maxBeamWidth = beamWidth;
     sessionConfig.decoderPerRequest = false;
     sessionConfig.cudaGraphMode = cudaGraphMode;
+    GptSession::Options sessionOptions{};
+    if (json.hasStrippedWeights())
+    {
+        sessionOptions.weightsFile = (dataPath / json.weightsFilename(worldConfig)).string();
+    }
+
+    // Double the input length from the first one of the sweep up to the longest the engine accepts
+    auto const sweep = !inputLenSweep.empty();
+    auto lengths = inOutLen;
+    if (sweep)
+    {
+        auto const maxInputLen = sessionConfig.kvCacheConfig.maxAttentionWindow
+            ? std::min(modelConfig.getMaxInputLen(), sessionConfig.kvCacheConfig.maxAttentionWindow.value())
+            : modelConfig.getMaxInputLen();
+        TLLM_CHECK_WITH_INFO(inputLenSweep[0] <= maxInputLen, "The sweep starts above the max input length %d",
+            maxInputLen);
+        lengths.clear();
+        for (auto inputLength = inputLenSweep[0]; inputLength < maxInputLen; inputLength *= 2)
+        {
+            lengths.push_back({inputLength, inputLenSweep[1]});
+        }
+        lengths.push_back({maxInputLen, inputLenSweep[1]});
+    }
+    // Bytes of K and V of one token in all the layers of this rank
+    auto const kvDtype = modelConfig.getQuantMode().hasFp8KvCache() ? nvinfer1::DataType::kFP8
+        : modelConfig.getQuantMode().hasInt8KvCache()                ? nvinfer1::DataType::kINT8
+                                                                     : dtype;
+    auto const kvBytesPerToken = 2 * modelConfig.getNbLayers(worldConfig.getPipelineParallelism())
+        * modelConfig.getNbKvHeads() * modelConfig.getSizePerHead() * BufferDataType(kvDtype).getSize();
+    std::map<SizeType, std::vector<SweepPoint>> sweepPoints;
+
+    // The steps and their collectives are timed by the CommProfiler
+    tensorrt_llm::benchmark::RankTiming rankTiming;
+    if (timeRanks)
+    {
+        tc::CommProfiler::getInstance().setEnabled(true);
+        if (cudaGraphMode)
+        {
+            TLLM_LOG_WARNING("The collectives of the steps run with CUDA graphs are not timed");
+        }
+    }
+
+    std::optional<GptModelConfig> draftModelConfig;
+    std::optional<WorldConfig> draftWorldConfig;
+    std::filesystem::path draftEnginePath;
+    SizeType maxNumDraftTokens{0};
+    if (speculativeConfig)
+    {
+        TLLM_CHECK_WITH_INFO(beamWidth == 1, "Speculative decoding does not support beam search");
+        auto const draftJson = GptJsonConfig::parse(speculativeConfig->engineDir / "config.json");
+        draftModelConfig = draftJson.getModelConfig();
+        draftWorldConfig = WorldConfig::mpi(
+            deviceCount, draftJson.getTensorParallelism(), draftJson.getPipelineParallelism());
+        draftEnginePath
+            = speculativeConfig->engineDir / draftJson.engineFilename(*draftWorldConfig, speculativeConfig->modelName);
+        maxNumDraftTokens = *std::max_element(
+            speculativeConfig->numsDraftTokens.begin(), speculativeConfig->numsDraftTokens.end());
+    }
 
-    for (auto inOut : inOutLen)
+    for (auto inOut : lengths)
     {
         auto const maxInputLength = inOut[0];
         auto const maxNewTokens = inOut[1];
 
-        sessionConfig.maxSequenceLength = maxInputLength + maxNewTokens;
+        // Both sessions of speculative decoding fit the draft tokens beyond the longest sequence
+        sessionConfig.maxSequenceLength = maxInputLength + maxNewTokens + maxNumDraftTokens;
         samplingConfig.minLength = std::vector{disableForceMaxTokens ? 1 : maxNewTokens};
 
-        GptSession session{sessionConfig, modelConfig, worldConfig, enginePath.string(), logger};
+        // The draft session is created first, with a KV cache sized for its sequences, the target session takes the
+        // memory left
+        std::unique_ptr<GptSession> draftSession;
+        if (speculativeConfig)
+        {
+            GptSession::Config draftSessionConfig{maxBatchSize, 1, sessionConfig.maxSequenceLength};
+            draftSessionConfig.kvCacheConfig.maxTokens = maxBatchSize * sessionConfig.maxSequenceLength;
+            draftSession = std::make_unique<GptSession>(
+                draftSessionConfig, *draftModelConfig, *draftWorldConfig, draftEnginePath.string(), logger);
+        }
+
+        GptSession session{sessionConfig, sessionOptions, modelConfig, worldConfig, enginePath.string(), logger};
+        pluginWarmup.wait();
+        if (draftSession)
+        {
+            session.shareEngineWorkspace(*draftSession);
+        }
+        if (layerProfilingInterval > 0)
+        {
+            session.setLayerProfilingInterval(layerProfilingInterval);
+        }
 
         // Use bufferManager for copying data to and from the GPU
         auto& bufferManager = session.getBufferManager();
@@ -82,9 +403,16 @@ void benchmarkGptSession(std::string const& modelName, std::filesystem::path con
 
         auto& memoryCounter = MemoryCounters::getInstance();
         TLLM_LOG_INFO(memoryCounter.toString());
+        TLLM_LOG_INFO(MemoryCounters::toTaggedString());
 
         for (auto const batchSize : batchSizes)
         {
+            nlohmann::json const params{{"batch_size", batchSize}, {"beam_width", beamWidth},
+                {"input_length", maxInputLength}, {"output_length", maxNewTokens}};
+            auto const configPrefix = tc::fmtstr(
+                "batch_size %d input_length %d output_length %d", batchSize, maxInputLength, maxNewTokens);
+            // The session and its KV cache are allocated once per lengths, the peaks include them
+            MemoryCounters::resetPeaks();
             try
             {
                 TLLM_LOG_INFO(memoryCounter.toString());
@@ -135,30 +463,64 @@ void benchmarkGptSession(std::string const& modelName, std::filesystem::path con
                     bufferManager.getStream().synchronize();
                 }
                 cudaDeviceSynchronize();
+                // Drops the layers profiled during the warm-up
+                session.collectLayerProfile();
 
                 TLLM_LOG_INFO(memoryCounter.toString());
 
                 int iterIdx = 0;
                 float curDuration = 0;
+                std::vector<double> latencies;
+                std::vector<double> contextLatencies;
+                std::vector<double> decodeLatencies;
                 while (iterIdx < numRuns || curDuration / 1000 < duration)
                 {
                     auto const start = std::chrono::steady_clock::now();
+                    auto firstToken = start;
                     SizeType numSteps = 0;
                     generationOutput.onTokenGenerated
-                        = [&numSteps, maxNewTokens](GenerationOutput::TensorPtr const& outputIds, SizeType step,
-                              bool finished) { ++numSteps; };
+                        = [&numSteps, &firstToken, &bufferManager, sweep](
+                              GenerationOutput::TensorPtr const& outputIds, SizeType step, bool finished)
+                    {
+                        // Separating the phases waits for the first token
+                        if (sweep && numSteps == 0)
+                        {
+                            bufferManager.getStream().synchronize();
+                            firstToken = std::chrono::steady_clock::now();
+                        }
+                        ++numSteps;
+                    };
                     session.generate(generationOutput, generationInput, samplingConfig);
                     bufferManager.getStream().synchronize();
                     auto const end = std::chrono::steady_clock::now();
 
                     iterIdx += 1;
-                    curDuration += std::chrono::duration<float, std::milli>(end - start).count();
+                    auto const latency = std::chrono::duration<float, std::milli>(end - start).count();
+                    curDuration += latency;
+                    latencies.push_back(latency);
+                    if (timeRanks)
+                    {
+                        rankTiming.addSteps(session.getStepTimes(), session.getCommStats());
+                    }
+                    if (sweep)
+                    {
+                        contextLatencies.push_back(
+                            std::chrono::duration<double, std::milli>(firstToken - start).count());
+                        decodeLatencies.push_back(std::chrono::duration<double, std::milli>(end - firstToken).count()
+                            / std::max(numSteps - 1, 1));
+                    }
                 }
 
                 TLLM_LOG_INFO(memoryCounter.toString());
 
                 printf("Benchmarking done. Iteration: %d, duration: %.2f sec.\n", iterIdx, curDuration / 1000);
 
+                if (timeRanks)
+                {
+                    rankTiming.gather(COMM_SESSION, params, configPrefix, report);
+                }
+                auto const layerProfile = session.collectLayerProfile();
+
                 if (worldConfig.getRank() == 0)
                 {
                     auto const averageLatency = curDuration / iterIdx;
@@ -167,6 +529,83 @@ void benchmarkGptSession(std::string const& modelName, std::filesystem::path con
                         "[BENCHMARK] batch_size %d input_length %d output_length %d latency(ms) %.2f tokensPerSec "
                         "%.2f\n",
                         batchSize, maxInputLength, maxNewTokens, averageLatency, tokensPerSec);
+
+                    std::vector<double> tokensPerSecs;
+                    for (auto const latency : latencies)
+                    {
+                        tokensPerSecs.push_back(batchSize * maxNewTokens / (latency / 1000));
+                    }
+                    report.addMetric(params, "latency_ms", latencies, false);
+                    report.addMetric(params, "tokens_per_sec", tokensPerSecs, true);
+                    if (sweep)
+                    {
+                        // Tokens per second for each GB of KV cache held by the sequences at the end of the run
+                        auto const kvCacheGB = static_cast<double>(batchSize) * beamWidth
+                            * (maxInputLength + maxNewTokens) * kvBytesPerToken / 1e9;
+                        auto const contextLatency = tensorrt_llm::benchmark::summarize(contextLatencies).mean;
+                        auto const decodeLatency = tensorrt_llm::benchmark::summarize(decodeLatencies).mean;
+                        printf("[BENCHMARK] batch_size %d input_length %d output_length %d context_latency(ms) %.2f "
+                               "decode_latency_per_token(ms) %.3f kv_cache(GB) %.3f tokensPerSecPerGB %.2f\n",
+                            batchSize, maxInputLength, maxNewTokens, contextLatency, decodeLatency, kvCacheGB,
+                            tokensPerSec / kvCacheGB);
+                        report.addMetric(params, "context_latency_ms", contextLatencies, false);
+                        report.addMetric(params, "decode_latency_per_token_ms", decodeLatencies, false);
+                        sweepPoints[batchSize].push_back(
+                            {maxInputLength, maxNewTokens, contextLatency, decodeLatency});
+                    }
+                    if (profileMemory)
+                    {
+                        reportMemory(params, configPrefix, report);
+                    }
+                    if (layerProfilingInterval > 0)
+                    {
+                        reportLayerProfile(layerProfile, params, configPrefix, report);
+                    }
+                }
+
+                if (speculativeConfig)
+                {
+                    auto const plainTokensPerSec = batchSize * maxNewTokens / (curDuration / iterIdx / 1000);
+                    for (auto const numDraftTokens : speculativeConfig->numsDraftTokens)
+                    {
+                        auto const results = benchmarkSpeculative(session, *draftSession, generationInput,
+                            samplingConfig, numDraftTokens, warmUp, numRuns, duration);
+                        if (worldConfig.getRank() != 0)
+                        {
+                            continue;
+                        }
+                        auto const& stats = results.stats;
+                        auto const numSpeculativeRuns = static_cast<double>(results.latencies.size());
+                        auto const latency = tensorrt_llm::benchmark::summarize(results.latencies).mean;
+                        auto const tokensPerSec = stats.numTokens / numSpeculativeRuns / (latency / 1000);
+                        auto const numDrafted
+                            = std::accumulate(stats.numDraftTokens.begin(), stats.numDraftTokens.end(), 0.0);
+                        auto const numAccepted
+                            = std::accumulate(stats.numAcceptedTokens.begin(), stats.numAcceptedTokens.end(), 0.0);
+                        auto const acceptanceRate = numDrafted > 0 ? numAccepted / numDrafted : 0.0;
+                        printf("[BENCHMARK] %s num_draft_tokens %d latency(ms) %.2f tokensPerSec %.2f speedup %.3f "
+                               "acceptance_rate(%%) %.1f tokens_per_target_forward %.2f tokens_per_request_forward "
+                               "%.3f draft_time(%%) %.1f\n",
+                            configPrefix.c_str(), numDraftTokens, latency, tokensPerSec,
+                            tokensPerSec / plainTokensPerSec, acceptanceRate * 100,
+                            static_cast<double>(stats.numTokens) / std::max(stats.numIterations, 1),
+                            static_cast<double>(stats.numTokens) / std::max(stats.numVerifications, 1),
+                            100.0 * stats.draftTimeMs / std::max(stats.draftTimeMs + stats.targetTimeMs, 1e-3F));
+                        std::ostringstream byPosition;
+                        for (SizeType position = 0; position < numDraftTokens; ++position)
+                        {
+                            byPosition << " " << tc::fmtstr("%.1f", stats.getAcceptanceRate(position) * 100);
+                        }
+                        printf("[BENCHMARK] %s num_draft_tokens %d acceptance_rate_by_position(%%)%s\n",
+                            configPrefix.c_str(), numDraftTokens, byPosition.str().c_str());
+
+                        auto speculativeParams = params;
+                        speculativeParams["num_draft_tokens"] = numDraftTokens;
+                        report.addMetric(speculativeParams, "latency_ms", results.latencies, false);
+                        report.addMetric(speculativeParams, "tokens_per_sec", {tokensPerSec}, true);
+                        report.addMetric(speculativeParams, "speedup", {tokensPerSec / plainTokensPerSec}, true);
+                        report.addMetric(speculativeParams, "acceptance_rate", {acceptanceRate}, true);
+                    }
                 }
 
                 // logits are store in last rank
@@ -211,12 +650,25 @@ void benchmarkGptSession(std::string const& modelName, std::filesystem::path con
                     printf(
                         "[BENCHMARK] batch_size %d input_length %d output_length %d latency(ms) N/A tokensPerSec N/A\n",
                         batchSize, maxInputLength, maxNewTokens);
+                    // Memory held when the allocation failed
+                    if (profileMemory)
+                    {
+                        reportMemory(params, configPrefix, report);
+                    }
                 }
                 continue;
             }
         }
         TLLM_LOG_INFO(memoryCounter.toString());
     }
+
+    if (sweep && worldConfig.getRank() == 0)
+    {
+        for (auto const& [batchSize, points] : sweepPoints)
+        {
+            reportAttentionShare(batchSize, points);
+        }
+    }
 }
 
 } // namespace
@@ -240,6 +692,12 @@ int main(int argc, char* argv[])
         "example: \"60,20;128,20\".",
         cxxopts::value<std::string>()->default_value("128,20"));
 
+    options.add_options()("input_len_sweep",
+        "Sweep the input length instead of --input_output_len: start at the given input length and double it up to "
+        "the max input length of the engine (or max_attention_window), with a fixed output length, example: "
+        "\"1024,64\". Reports the latency of each phase, the attention share and the tokens/sec per GB of KV cache.",
+        cxxopts::value<std::string>()->default_value(""));
+
     options.add_options()("log_level", "Choose log level between verbose/info/warning/error/internal_error.",
         cxxopts::value<std::string>()->default_value("error"));
     options.add_options()(
@@ -259,6 +717,33 @@ int main(int argc, char* argv[])
     options.add_options()("enable_cuda_graph", "Execute GPT session with CUDA graph.");
     options.add_options()("print_all_logits", "Print all context and generation logits.");
     options.add_options()("disable_force_max_tokens", "Disable force the engine generating new max_tokens.");
+    options.add_options()("profile_memory",
+        "Report the peak and steady-state memory of each owner (engine, activations, KV cache, decoder, ...) for "
+        "each configuration.");
+    options.add_options()("draft_engine_dir",
+        "Directory of the engine of a draft model. Each configuration is then also run with speculative decoding, "
+        "the target engine must be built with gather_all_token_logits.",
+        cxxopts::value<std::string>()->default_value(""));
+    options.add_options()("draft_model", "Model name specified for the draft engine, the one of --model if unset.",
+        cxxopts::value<std::string>()->default_value(""));
+    options.add_options()("num_draft_tokens",
+        "Number(s) of draft tokens per iteration of speculative decoding. Multiple numbers can be separated by \";\", "
+        "example: \"2;4;8\".",
+        cxxopts::value<std::string>()->default_value("4"));
+    options.add_options()("rank_timing",
+        "Time the steps and their collectives on each rank and report the compute and communication time of each "
+        "rank and the skew of the steps between the ranks.");
+    options.add_options()("layer_profiling_interval",
+        "Time the layers of one in every N steps with the TensorRT profiler and report the time of the attention, "
+        "GEMM, collective and other layers, 0 to disable.",
+        cxxopts::value<int>()->default_value("0"));
+    options.add_options()("output_json", "Write the config, the environment and the measurements to a JSON file.",
+        cxxopts::value<std::string>()->default_value(""));
+    options.add_options()("baseline",
+        "JSON written by a previous run with --output_json. Significant regressions are reported and fail the run.",
+        cxxopts::value<std::string>()->default_value(""));
+    options.add_options()("regression_threshold", "Relative change of a metric below which it is not a regression.",
+        cxxopts::value<float>()->default_value("0.02"));
 
     auto result = options.parse(argc, argv);
 
@@ -303,6 +788,42 @@ int main(int argc, char* argv[])
         inOutLen.push_back(inOut);
     }
 
+    // Argument: Input length sweep
+    std::vector<int> inputLenSweep;
+    if (!result["input_len_sweep"].as<std::string>().empty())
+    {
+        std::istringstream ssSweepArg(result["input_len_sweep"].as<std::string>());
+        for (std::string t; std::getline(ssSweepArg, t, ',');)
+        {
+            inputLenSweep.push_back(std::stoi(t));
+        }
+        if (inputLenSweep.size() != 2 || inputLenSweep[0] <= 0 || inputLenSweep[1] <= 0)
+        {
+            TLLM_LOG_ERROR("Please specify the input length sweep as \"input_len,output_len\".");
+            return 1;
+        }
+    }
+
+    // Argument: Draft model of speculative decoding
+    std::optional<SpeculativeConfig> speculativeConfig;
+    if (!result["draft_engine_dir"].as<std::string>().empty())
+    {
+        speculativeConfig = SpeculativeConfig{result["draft_engine_dir"].as<std::string>(),
+            result["draft_model"].as<std::string>().empty() ? result["model"].as<std::string>()
+                                                            : result["draft_model"].as<std::string>(),
+            {}};
+        std::istringstream ssNumDraftTokensArg(result["num_draft_tokens"].as<std::string>());
+        for (std::string token; std::getline(ssNumDraftTokensArg, token, ';');)
+        {
+            speculativeConfig->numsDraftTokens.push_back(std::stoi(token));
+        }
+        if (speculativeConfig->numsDraftTokens.empty())
+        {
+            TLLM_LOG_ERROR("Please specify the number of draft tokens.");
+            return 1;
+        }
+    }
+
     // Argument: Log level
     auto logger = std::make_shared<TllmLogger>();
     auto const logLevel = result["log_level"].as<std::string>();
@@ -368,9 +889,28 @@ int main(int argc, char* argv[])
 
     try
     {
+        tensorrt_llm::benchmark::BenchmarkReport report{
+            "gptSessionBenchmark", tensorrt_llm::benchmark::makeConfig(result)};
         benchmarkGptSession(result["model"].as<std::string>(), result["engine_dir"].as<std::string>(), batchSizes,
-            beamWidth, inOutLen, logger, result["warm_up"].as<int>(), result["num_runs"].as<int>(),
-            result["duration"].as<int>(), sessionConfig, enableCudaGraph, printAllLogits, disableForceMaxTokens);
+            beamWidth, inOutLen, inputLenSweep, logger, result["warm_up"].as<int>(), result["num_runs"].as<int>(),
+            result["duration"].as<int>(), sessionConfig, enableCudaGraph, printAllLogits, disableForceMaxTokens,
+            result.count("profile_memory") > 0, result.count("rank_timing") > 0,
+            result["layer_profiling_interval"].as<int>(), speculativeConfig, report);
+
+        // Only the first rank measures
+        if (COMM_SESSION.getRank() == 0)
+        {
+            auto const outputJson = result["output_json"].as<std::string>();
+            if (!outputJson.empty())
+            {
+                report.write(outputJson);
+            }
+            auto const baseline = result["baseline"].as<std::string>();
+            if (!baseline.empty() && report.compare(baseline, result["regression_threshold"].as<float>()) > 0)
+            {
+                return 1;
+            }
+        }
     }
     catch (const std::exception& e)
     {
@@ -0,0 +1,797 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2022-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/mpiUtils.h"
+#include "tensorrt_llm/common/tensor.h"
+#include "tensorrt_llm/kernels/customAllReduceKernels.h"
+#include "tensorrt_llm/kernels/decoderMaskedMultiheadAttention.h"
+#include "tensorrt_llm/kernels/decoderMaskedMultiheadAttention/decoderXQARunner.h"
+#include "tensorrt_llm/kernels/decodingCommon.h"
+#include "tensorrt_llm/kernels/samplingTopPKernels.h"
+#include "tensorrt_llm/kernels/weightOnlyBatchedGemv/enabled.h"
+#include "tensorrt_llm/kernels/weightOnlyBatchedGemv/kernelLauncher.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/ipcUtils.h"
+#include "tensorrt_llm/runtime/worldConfig.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cxxopts.hpp>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace tensorrt_llm::kernels;
+using namespace tensorrt_llm::runtime;
+
+namespace tc = tensorrt_llm::common;
+
+namespace
+{
+
+// Sizes of a benchmarked configuration, in the order they are printed
+using Shape = std::vector<std::pair<std::string, int64_t>>;
+
+struct BenchContext
+{
+    BufferManager const& bufferManager;
+    WorldConfig worldConfig;
+    int warmUp;
+    int numRuns;
+    // GB/s of the device memory
+    double peakBandwidth;
+    std::optional<double> peakTflops;
+    // GB/s of the links between the GPUs, the roofline of the all-reduce
+    std::optional<double> peakLinkBandwidth;
+    int multiProcessorCount;
+    int maxSharedMemoryPerBlockOptin;
+    BufferManager::IBufferPtr l2Flush;
+    std::array<cudaEvent_t, 2> events;
+    nlohmann::json results = nlohmann::json::array();
+
+    [[nodiscard]] bool isReportingRank() const
+    {
+        return worldConfig.getRank() == 0;
+    }
+};
+
+// Runs func numRuns times and returns its average time in ms
+template <typename Func>
+float timeKernel(BenchContext& ctx, Func const& func)
+{
+    auto stream = ctx.bufferManager.getStream().get();
+    for (int i = 0; i < ctx.warmUp; ++i)
+    {
+        func();
+    }
+    TLLM_CUDA_CHECK(cudaStreamSynchronize(stream));
+
+    float totalMs = 0.f;
+    for (int i = 0; i < ctx.numRuns; ++i)
+    {
+        // Evict the operands from the L2, in a model the weights and the KV cache of a layer are read from the
+        // device memory
+        TLLM_CUDA_CHECK(cudaMemsetAsync(ctx.l2Flush->data(), 0, ctx.l2Flush->getSizeInBytes(), stream));
+        TLLM_CUDA_CHECK(cudaEventRecord(ctx.events[0], stream));
+        func();
+        TLLM_CUDA_CHECK(cudaEventRecord(ctx.events[1], stream));
+        TLLM_CUDA_CHECK(cudaEventSynchronize(ctx.events[1]));
+        float ms{};
+        TLLM_CUDA_CHECK(cudaEventElapsedTime(&ms, ctx.events[0], ctx.events[1]));
+        totalMs += ms;
+    }
+    return totalMs / ctx.numRuns;
+}
+
+// Prints the achieved throughput of a kernel and its fraction of the roofline. bytes is the minimal traffic of the
+// kernel, reading every operand and writing every result once.
+void report(BenchContext& ctx, std::string const& kernel, std::string const& dtype, Shape const& shape,
+    float latencyMs, double flops, double bytes, std::optional<double> peakBandwidth)
+{
+    if (!ctx.isReportingRank())
+    {
+        return;
+    }
+
+    auto const bandwidth = bytes / (latencyMs * 1e6);
+    auto const tflops = flops / (latencyMs * 1e9);
+    // Time of the kernel on the roofline, bound by the bandwidth or by the math throughput
+    std::optional<double> rooflineMs;
+    if (peakBandwidth)
+    {
+        rooflineMs = bytes / (peakBandwidth.value() * 1e6);
+    }
+    if (ctx.peakTflops && flops > 0)
+    {
+        rooflineMs = std::max(rooflineMs.value_or(0.0), flops / (ctx.peakTflops.value() * 1e9));
+    }
+
+    std::ostringstream line;
+    nlohmann::json result{{"kernel", kernel}, {"dtype", dtype}};
+    line << "[BENCHMARK] kernel " << kernel << " dtype " << dtype;
+    for (auto const& [name, value] : shape)
+    {
+        line << " " << name << " " << value;
+        result["shape"][name] = value;
+    }
+    line << " latency(ms) " << latencyMs;
+    result["latency_ms"] = latencyMs;
+    if (flops > 0)
+    {
+        line << " tflops " << tflops;
+        result["tflops"] = tflops;
+    }
+    line << " bandwidth(GB/s) " << bandwidth;
+    result["bandwidth_gbps"] = bandwidth;
+    if (rooflineMs)
+    {
+        auto const efficiency = rooflineMs.value() / latencyMs;
+        line << " roofline(%) " << efficiency * 100;
+        result["roofline_efficiency"] = efficiency;
+    }
+    std::cout << line.str() << std::endl;
+    ctx.results.push_back(std::move(result));
+}
+
+BufferManager::IBufferPtr allocate(BenchContext const& ctx, std::size_t size, int value = 0)
+{
+    auto buffer = ctx.bufferManager.gpu(size);
+    TLLM_CUDA_CHECK(cudaMemsetAsync(buffer->data(), value, size, ctx.bufferManager.getStream().get()));
+    return buffer;
+}
+
+// The MMHA kernels take uint16_t for half
+template <typename T>
+struct MmhaType
+{
+    using Type = T;
+};
+
+template <>
+struct MmhaType<half>
+{
+    using Type = uint16_t;
+};
+
+// One generation step of a sequence of seqLen past tokens, with a contiguous KV cache as in the GPT attention plugin
+template <typename T>
+void benchmarkMmha(BenchContext& ctx, std::string const& dtype, int batchSize, int numHeads, int numKvHeads,
+    int headSize, int seqLen, bool multiBlockMode)
+{
+    using DataType = typename MmhaType<T>::Type;
+    auto stream = ctx.bufferManager.getStream().get();
+    auto const maxAttentionWindow = seqLen + 1;
+    size_t const qkvSize = static_cast<size_t>(batchSize) * (numHeads + 2 * numKvHeads) * headSize;
+    size_t const outSize = static_cast<size_t>(batchSize) * numHeads * headSize;
+    size_t const sizePerToken = static_cast<size_t>(numKvHeads) * headSize * sizeof(T);
+
+    auto qkv = allocate(ctx, qkvSize * sizeof(T), 0x11);
+    auto out = allocate(ctx, outSize * sizeof(T));
+    auto kvCache = allocate(ctx, 2 * batchSize * maxAttentionWindow * sizePerToken, 0x11);
+    auto finished = allocate(ctx, batchSize * sizeof(bool));
+    auto sequenceLengths
+        = ctx.bufferManager.copyFrom(std::vector<int32_t>(batchSize, seqLen + 1), MemoryType::kGPU);
+    auto inputLengths = ctx.bufferManager.copyFrom(std::vector<int32_t>(batchSize, seqLen), MemoryType::kGPU);
+
+    // Same choice of the number of blocks per sequence as GPTAttentionPluginCommon::enqueueGeneration
+    auto const estimatedMinMultiBlockCount
+        = estimate_min_multi_block_count<T>(seqLen, ctx.maxSharedMemoryPerBlockOptin - 2048);
+    auto const maxNumSeqLenTiles = std::max(
+        multiBlockMode ? tc::divUp(ctx.multiProcessorCount, batchSize * numHeads) : 0, estimatedMinMultiBlockCount);
+    bool const enableMultiBlock = (multiBlockMode && maxNumSeqLenTiles > 1) || estimatedMinMultiBlockCount > 1;
+    BufferManager::IBufferPtr partialOut, partialSum, partialMax, blockCounter;
+    if (enableMultiBlock)
+    {
+        partialOut = allocate(ctx, outSize * maxNumSeqLenTiles * sizeof(T));
+        partialSum = allocate(ctx, batchSize * numHeads * maxNumSeqLenTiles * sizeof(float));
+        partialMax = allocate(ctx, batchSize * numHeads * maxNumSeqLenTiles * sizeof(float));
+        blockCounter = allocate(ctx, batchSize * numHeads * sizeof(int));
+    }
+
+    Masked_multihead_attention_params<DataType> params{};
+    params.out = static_cast<DataType*>(out->data());
+    params.q = static_cast<DataType const*>(qkv->data());
+    params.k = params.q + numHeads * headSize;
+    params.v = params.k + numKvHeads * headSize;
+    params.stride = (numHeads + 2 * numKvHeads) * headSize;
+    params.finished = static_cast<bool*>(finished->data());
+    params.batch_size = batchSize;
+    params.beam_width = 1;
+    params.max_attention_window_size = maxAttentionWindow;
+    params.cyclic_attention_window_size = maxAttentionWindow;
+    params.cyclic_kv_cache_len = maxAttentionWindow;
+    params.length_per_sample = bufferCast<int32_t>(*sequenceLengths);
+    params.input_lengths = bufferCast<int32_t>(*inputLengths);
+    params.timestep = seqLen;
+    params.num_heads = numHeads;
+    params.num_kv_heads = numKvHeads;
+    params.hidden_size_per_head = headSize;
+    params.inv_sqrt_dh = 1.F / sqrtf(static_cast<float>(headSize));
+    params.multi_block_mode = enableMultiBlock;
+    if (enableMultiBlock)
+    {
+        params.min_seq_len_tile = std::max(1, estimatedMinMultiBlockCount);
+        params.max_seq_len_tile = maxNumSeqLenTiles;
+        params.partial_out = static_cast<DataType*>(partialOut->data());
+        params.partial_sum = static_cast<float*>(partialSum->data());
+        params.partial_max = static_cast<float*>(partialMax->data());
+        params.block_counter = static_cast<int*>(blockCounter->data());
+    }
+    params.multi_processor_count = ctx.multiProcessorCount;
+
+    KVLinearBuffer kvCacheBuffer(batchSize, 1, maxAttentionWindow, sizePerToken);
+    kvCacheBuffer.data = static_cast<int8_t*>(kvCache->data());
+
+    auto const latencyMs = timeKernel(ctx,
+        [&]()
+        {
+            if (enableMultiBlock)
+            {
+                TLLM_CUDA_CHECK(
+                    cudaMemsetAsync(blockCounter->data(), 0, blockCounter->getSizeInBytes(), stream));
+            }
+            masked_multihead_attention(params, kvCacheBuffer, stream);
+        });
+
+    // QK^T and PV over the past tokens and the new one, reading the KV cache and writing the new K and V
+    double const flops = 4.0 * batchSize * numHeads * (seqLen + 1) * headSize;
+    double const bytes = (qkvSize + outSize) * sizeof(T) + 2.0 * batchSize * (seqLen + 1) * sizePerToken;
+    report(ctx, "mmha", dtype,
+        {{"batch_size", batchSize}, {"num_heads", numHeads}, {"num_kv_heads", numKvHeads}, {"head_size", headSize},
+            {"seq_len", seqLen}, {"multi_block", enableMultiBlock}},
+        latencyMs, flops, bytes, ctx.peakBandwidth);
+}
+
+// Same step as benchmarkMmha with the XQA kernels, which only support fp16, head size 128, 8 query heads per KV head
+// and no beam search
+void benchmarkXqa(BenchContext& ctx, std::string const& dtype, int batchSize, int numHeads, int numKvHeads,
+    int headSize, int seqLen)
+{
+    auto stream = ctx.bufferManager.getStream().get();
+    auto const maxAttentionWindow = seqLen + 1;
+    size_t const qkvSize = static_cast<size_t>(batchSize) * (numHeads + 2 * numKvHeads) * headSize;
+    size_t const outSize = static_cast<size_t>(batchSize) * numHeads * headSize;
+    size_t const sizePerToken = static_cast<size_t>(numKvHeads) * headSize * sizeof(half);
+
+    std::vector<int32_t> const hostPastKvLengths(batchSize, seqLen);
+    std::vector<int32_t> const hostContextLengths(batchSize, seqLen);
+    auto sequenceLengths
+        = ctx.bufferManager.copyFrom(std::vector<int32_t>(batchSize, seqLen + 1), MemoryType::kGPU);
+    auto contextLengths = ctx.bufferManager.copyFrom(hostContextLengths, MemoryType::kGPU);
+
+    XQAParams params;
+    params.data_type = DATA_TYPE_FP16;
+    params.kv_cache_data_type = DATA_TYPE_FP16;
+    params.host_past_key_value_lengths = hostPastKvLengths.data();
+    params.host_context_lengths = hostContextLengths.data();
+    params.batch_size = batchSize;
+    params.beam_width = 1;
+    params.max_attention_window_size = maxAttentionWindow;
+    params.cyclic_attention_window_size = maxAttentionWindow;
+    params.timestep = seqLen;
+    params.qkv_bias = nullptr;
+    params.sequence_lengths = bufferCast<int32_t>(*sequenceLengths);
+    params.context_lengths = bufferCast<int32_t>(*contextLengths);
+    params.alibi_slopes = nullptr;
+    params.num_q_heads = numHeads;
+    params.num_kv_heads = numKvHeads;
+    params.head_size = headSize;
+    params.unidirectional = 1;
+    params.q_scaling = 1.0f;
+    params.rotary_embedding_scale_type = RotaryScalingType::kNONE;
+    params.rotary_embedding_scale = 1.0f;
+    params.rotary_embedding_max_positions = 0;
+    params.position_embedding_type = PositionEmbeddingType::kLEARNED_ABSOLUTE;
+    params.remove_padding = true;
+    params.mask_type = AttentionMaskType::CAUSAL;
+    params.paged_kv_cache = false;
+    params.tokens_per_block = 0;
+    params.qkv_bias_enabled = false;
+    params.cross_attention = false;
+
+    DecoderXQARunner runner(DATA_TYPE_FP16, numHeads, numKvHeads, headSize);
+    if (!runner.shouldUse<half>(params))
+    {
+        TLLM_LOG_WARNING("Skipping XQA with %d heads, %d KV heads and head size %d, it is not supported", numHeads,
+            numKvHeads, headSize);
+        return;
+    }
+
+    auto qkv = allocate(ctx, qkvSize * sizeof(half), 0x11);
+    auto out = allocate(ctx, outSize * sizeof(half));
+    auto kvCache = allocate(ctx, 2 * batchSize * maxAttentionWindow * sizePerToken, 0x11);
+    auto workspace = allocate(ctx, runner.getWorkspaceSize());
+    params.qkv = qkv->data();
+    params.output = out->data();
+    params.workspaces = workspace->data();
+
+    KVLinearBuffer kvCacheBuffer(batchSize, 1, maxAttentionWindow, sizePerToken);
+    kvCacheBuffer.data = static_cast<int8_t*>(kvCache->data());
+
+    auto const latencyMs = timeKernel(ctx, [&]() { runner.dispatch(params, kvCacheBuffer, stream); });
+
+    double const flops = 4.0 * batchSize * numHeads * (seqLen + 1) * headSize;
+    double const bytes = (qkvSize + outSize) * sizeof(half) + 2.0 * batchSize * (seqLen + 1) * sizePerToken;
+    report(ctx, "xqa", dtype,
+        {{"batch_size", batchSize}, {"num_heads", numHeads}, {"num_kv_heads", numKvHeads}, {"head_size", headSize},
+            {"seq_len", seqLen}},
+        latencyMs, flops, bytes, ctx.peakBandwidth);
+}
+
+// out[m, n] = in[m, k] * dequantize(weight[k, n]) with per-channel (groupSize 0) or group-wise scales
+template <typename T>
+void benchmarkWeightOnlyGemv(
+    BenchContext& ctx, std::string const& dtype, int m, int n, int k, std::string const& weightType, int groupSize)
+{
+    auto const quantType = weightType == "int4" ? WeightOnlyQuantType::Int4b : WeightOnlyQuantType::Int8b;
+    auto const weightOnlyType = groupSize > 0 ? WeightOnlyType::GroupWise : WeightOnlyType::PerChannel;
+    auto const maxM = groupSize > 0 ? 4 : kWeightOnlyBatchedGemvMaxM;
+    if (!isWeightOnlyBatchedGemvEnabled(quantType) || m > maxM || (groupSize > 0 && k % groupSize != 0))
+    {
+        TLLM_LOG_WARNING("Skipping weight-only GEMV m %d k %d group size %d, it is not supported", m, k, groupSize);
+        return;
+    }
+    auto const activationType
+        = std::is_same_v<T, half> ? WeightOnlyActivationType::FP16 : WeightOnlyActivationType::BF16;
+
+    double const weightBytes = static_cast<double>(n) * k * (quantType == WeightOnlyQuantType::Int4b ? 0.5 : 1.0);
+    size_t const numScales = static_cast<size_t>(n) * (groupSize > 0 ? k / groupSize : 1);
+    auto weight = allocate(ctx, static_cast<size_t>(weightBytes), 0x11);
+    auto scales = allocate(ctx, numScales * sizeof(T), 0x11);
+    auto zeros = groupSize > 0 ? allocate(ctx, numScales * sizeof(T)) : nullptr;
+    auto in = allocate(ctx, static_cast<size_t>(m) * k * sizeof(T), 0x11);
+    auto out = allocate(ctx, static_cast<size_t>(m) * n * sizeof(T));
+
+    WeightOnlyParams params{static_cast<uint8_t const*>(weight->data()), scales->data(),
+        zeros ? zeros->data() : nullptr, in->data(), nullptr, nullptr, out->data(), m, n, k, groupSize, quantType,
+        weightOnlyType, WeightOnlyActivationFunctionType::Identity, activationType};
+    auto stream = ctx.bufferManager.getStream().get();
+    auto const latencyMs = timeKernel(ctx, [&]() { weight_only_batched_gemv_launcher(params, stream); });
+
+    double const flops = 2.0 * m * n * k;
+    double const bytes = weightBytes + numScales * sizeof(T) * (groupSize > 0 ? 2 : 1)
+        + static_cast<double>(m) * (k + n) * sizeof(T);
+    report(ctx, "weight_only_gemv", dtype,
+        {{"m", m}, {"n", n}, {"k", k}, {"weight_bits", quantType == WeightOnlyQuantType::Int4b ? 4 : 8},
+            {"group_size", groupSize}},
+        latencyMs, flops, bytes, ctx.peakBandwidth);
+}
+
+// Top-P sampling of one token per request from uniform probabilities, which no single token covers, so that the
+// probabilities of every request are sorted. Includes the initialization of the sort offsets, as the sampling layer
+// runs it at every step.
+template <typename T>
+void benchmarkTopPSampling(BenchContext& ctx, std::string const& dtype, int batchSize, int vocabSize, float topP)
+{
+    auto stream = ctx.bufferManager.getStream().get();
+    size_t workspaceSize{0};
+    size_t cubTempStorageSize{0};
+    invokeBatchTopPSampling<T>(nullptr, workspaceSize, cubTempStorageSize, nullptr, nullptr, nullptr, nullptr,
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, batchSize, vocabSize, nullptr, topP, nullptr,
+        stream, nullptr);
+
+    auto probs = ctx.bufferManager.copyFrom(
+        std::vector<T>(static_cast<size_t>(batchSize) * vocabSize, static_cast<T>(1.f / vocabSize)), MemoryType::kGPU);
+    auto workspace = allocate(ctx, workspaceSize);
+    auto idVals = allocate(ctx, static_cast<size_t>(batchSize) * vocabSize * sizeof(int));
+    auto offsets = allocate(ctx, (batchSize + 1) * sizeof(int));
+    auto beginOffsets = allocate(ctx, (batchSize + 1) * sizeof(int));
+    auto outputIds = allocate(ctx, batchSize * sizeof(int));
+    auto sequenceLengths = allocate(ctx, batchSize * sizeof(int));
+    auto endIds = ctx.bufferManager.copyFrom(std::vector<int32_t>(batchSize, -1), MemoryType::kGPU);
+    std::vector<int*> outputIdsPtrs(batchSize);
+    for (int bi = 0; bi < batchSize; ++bi)
+    {
+        outputIdsPtrs[bi] = static_cast<int*>(outputIds->data()) + bi;
+    }
+    auto outputIdsPtrsDevice = ctx.bufferManager.copyFrom(outputIdsPtrs, MemoryType::kGPU);
+    auto curandStates = allocate(ctx, batchSize * sizeof(curandState_t));
+    invokeCurandInitialize(static_cast<curandState_t*>(curandStates->data()), batchSize, 0, stream);
+
+    auto const latencyMs = timeKernel(ctx,
+        [&]()
+        {
+            // The sampled token is written at the current length of the sequence, keep it at 0
+            TLLM_CUDA_CHECK(cudaMemsetAsync(sequenceLengths->data(), 0, sequenceLengths->getSizeInBytes(), stream));
+            invokeTopPInitialize(static_cast<int*>(idVals->data()), static_cast<int*>(offsets->data()),
+                static_cast<int*>(beginOffsets->data()), batchSize, vocabSize, stream);
+            invokeBatchTopPSampling<T>(workspace->data(), workspaceSize, cubTempStorageSize,
+                bufferCast<int*>(*outputIdsPtrsDevice), static_cast<int*>(sequenceLengths->data()), nullptr, nullptr,
+                nullptr, nullptr, bufferCast<T>(*probs), static_cast<int*>(idVals->data()),
+                static_cast<int*>(offsets->data()), static_cast<int*>(beginOffsets->data()),
+                static_cast<curandState_t*>(curandStates->data()), batchSize, vocabSize, bufferCast<int32_t>(*endIds),
+                topP, nullptr, stream, nullptr);
+        });
+
+    // The sort reads and writes the probabilities several times, the roofline only reads them once
+    double const bytes = static_cast<double>(batchSize) * vocabSize * sizeof(T);
+    report(ctx, "top_p_sampling", dtype, {{"batch_size", batchSize}, {"vocab_size", vocabSize}}, latencyMs, 0, bytes,
+        ctx.peakBandwidth);
+}
+
+// Custom all-reduce of numTokens x hiddenSize between the ranks of the node, as run by the all-reduce plugin: barrier,
+// copy to the IPC buffer, then the one shot or two shot kernel
+template <typename T>
+void benchmarkAllReduce(
+    BenchContext& ctx, std::string const& dtype, int numTokens, int hiddenSize, std::string const& strategyName)
+{
+    auto const worldSize = ctx.worldConfig.getSize();
+    auto const strategy = strategyName == "twoshot" ? AllReduceStrategyType::TWOSHOT : AllReduceStrategyType::ONESHOT;
+    size_t const elts = static_cast<size_t>(numTokens) * hiddenSize;
+    size_t const bufferSize = elts * sizeof(T);
+    auto stream = ctx.bufferManager.getStream().get();
+
+    setPeerAccess(ctx.worldConfig, true);
+    std::vector<std::unique_ptr<IpcMemory>> ipcMemory;
+    ipcMemory.emplace_back(std::make_unique<IpcMemory>(ctx.worldConfig, bufferSize));
+    ipcMemory.emplace_back(std::make_unique<IpcMemory>(ctx.worldConfig, IpcMemory::FLAGS_SIZE * sizeof(int32_t)));
+    ipcMemory.emplace_back(std::make_unique<IpcMemory>(ctx.worldConfig, IpcMemory::FLAGS_SIZE * sizeof(int32_t)));
+    std::vector<void*> commPtrs;
+    for (auto const& memory : ipcMemory)
+    {
+        auto const& ptrs = memory->getCommPtrsTensor();
+        commPtrs.insert(commPtrs.end(), ptrs.begin(), ptrs.end());
+    }
+    auto const localTpSize = static_cast<size_t>(ipcMemory.front()->getCommPtrsTensor().size());
+    auto const localRank = ctx.worldConfig.getRank() % localTpSize;
+
+    auto input = allocate(ctx, bufferSize, 0x11);
+    auto output = allocate(ctx, bufferSize);
+    // Each invocation waits for the flag of its own barrier
+    uint32_t flag = 0;
+    COMM_SESSION.barrier();
+    auto const latencyMs = timeKernel(ctx,
+        [&]()
+        {
+            auto params = AllReduceParams::deserialize(
+                reinterpret_cast<int32_t const*>(commPtrs.data()), localTpSize, localRank, ++flag);
+            invokeMultiGpuBarrier(params, stream);
+            TLLM_CUDA_CHECK(cudaMemcpyAsync(params.peer_comm_buffer_ptrs[localRank], input->data(), bufferSize,
+                cudaMemcpyDeviceToDevice, stream));
+            customAllReduce(
+                params, output->data(), elts, sizeof(T), tc::TensorDataType<T>::value, strategy, stream);
+        });
+    COMM_SESSION.barrier();
+
+    // Bus bandwidth as reported by nccl-tests, the traffic through the links of each rank
+    double const busBytes = 2.0 * (worldSize - 1) / worldSize * bufferSize;
+    report(ctx, "all_reduce_" + strategyName, dtype,
+        {{"num_tokens", numTokens}, {"hidden_size", hiddenSize}, {"num_ranks", worldSize}}, latencyMs, 0, busBytes,
+        ctx.peakLinkBandwidth);
+}
+
+std::vector<int> parseList(std::string const& arg)
+{
+    std::istringstream ss(arg);
+    std::vector<int> values;
+    for (std::string token; std::getline(ss, token, ';');)
+    {
+        values.push_back(std::stoi(token));
+    }
+    return values;
+}
+
+std::vector<std::string> parseStringList(std::string const& arg)
+{
+    std::istringstream ss(arg);
+    std::vector<std::string> values;
+    for (std::string token; std::getline(ss, token, ';');)
+    {
+        values.push_back(token);
+    }
+    return values;
+}
+
+bool contains(std::vector<std::string> const& values, std::string const& value)
+{
+    return std::find(values.begin(), values.end(), value) != values.end();
+}
+
+template <typename T>
+void benchmarkKernels(BenchContext& ctx, cxxopts::ParseResult const& result, std::string const& dtype)
+{
+    auto const kernels = parseStringList(result["kernels"].as<std::string>());
+    auto const batchSizes = parseList(result["batch_size"].as<std::string>());
+    // The other kernels run on one GPU, on the first rank only
+    bool const runSingleGpuKernels = ctx.isReportingRank();
+
+    if (contains(kernels, "mmha") && runSingleGpuKernels)
+    {
+        for (auto numHeads : parseList(result["num_heads"].as<std::string>()))
+        {
+            for (auto numKvHeads : parseList(result["num_kv_heads"].as<std::string>()))
+            {
+                for (auto headSize : parseList(result["head_size"].as<std::string>()))
+                {
+                    for (auto seqLen : parseList(result["seq_len"].as<std::string>()))
+                    {
+                        for (auto batchSize : batchSizes)
+                        {
+                            benchmarkMmha<T>(ctx, dtype, batchSize, numHeads, numKvHeads, headSize, seqLen,
+                                result.count("multi_block_mode") > 0);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if constexpr (std::is_same_v<T, half>)
+    {
+        if (contains(kernels, "xqa") && runSingleGpuKernels)
+        {
+            for (auto numHeads : parseList(result["num_heads"].as<std::string>()))
+            {
+                for (auto numKvHeads : parseList(result["num_kv_heads"].as<std::string>()))
+                {
+                    for (auto headSize : parseList(result["head_size"].as<std::string>()))
+                    {
+                        for (auto seqLen : parseList(result["seq_len"].as<std::string>()))
+                        {
+                            for (auto batchSize : batchSizes)
+                            {
+                                benchmarkXqa(ctx, dtype, batchSize, numHeads, numKvHeads, headSize, seqLen);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if constexpr (!std::is_same_v<T, float>)
+    {
+        if (contains(kernels, "gemv") && runSingleGpuKernels)
+        {
+            for (auto const& weightType : parseStringList(result["weight_type"].as<std::string>()))
+            {
+                for (auto groupSize : parseList(result["group_size"].as<std::string>()))
+                {
+                    for (auto n : parseList(result["gemv_n"].as<std::string>()))
+                    {
+                        for (auto k : parseList(result["gemv_k"].as<std::string>()))
+                        {
+                            for (auto m : batchSizes)
+                            {
+                                benchmarkWeightOnlyGemv<T>(ctx, dtype, m, n, k, weightType, groupSize);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if constexpr (std::is_same_v<T, half> || std::is_same_v<T, float>)
+    {
+        if (contains(kernels, "topp") && runSingleGpuKernels)
+        {
+            for (auto vocabSize : parseList(result["vocab_size"].as<std::string>()))
+            {
+                for (auto batchSize : batchSizes)
+                {
+                    benchmarkTopPSampling<T>(ctx, dtype, batchSize, vocabSize, result["top_p"].as<float>());
+                }
+            }
+        }
+    }
+
+    if (contains(kernels, "allreduce"))
+    {
+        if (ctx.worldConfig.getSize() == 1)
+        {
+            TLLM_LOG_WARNING("Skipping the all-reduce, run the benchmark with mpirun on several GPUs");
+            return;
+        }
+        for (auto const& strategy : parseStringList(result["allreduce_strategy"].as<std::string>()))
+        {
+            for (auto hiddenSize : parseList(result["hidden_size"].as<std::string>()))
+            {
+                for (auto numTokens : batchSizes)
+                {
+                    benchmarkAllReduce<T>(ctx, dtype, numTokens, hiddenSize, strategy);
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    cxxopts::Options options("TensorRT-LLM Kernel Benchmark",
+        "TensorRT-LLM benchmark of the kernels of the generation step, reporting their bandwidth and TFLOPs against "
+        "the roofline of the device. Multiple values can be separated by \";\", example: \"1;8;64\", all their "
+        "combinations are benchmarked.");
+    options.add_options()("h,help", "Print usage");
+    options.add_options()("kernels", "Kernels to benchmark, among mmha/xqa/gemv/topp/allreduce.",
+        cxxopts::value<std::string>()->default_value("mmha;xqa;gemv;topp;allreduce"));
+    options.add_options()(
+        "dtype", "Activation types, among fp16/bf16/fp32.", cxxopts::value<std::string>()->default_value("fp16"));
+    options.add_options()("batch_size", "Number of sequences, the number of rows of the GEMV and the all-reduce.",
+        cxxopts::value<std::string>()->default_value("1;8;64"));
+    options.add_options()(
+        "num_heads", "Number of attention heads.", cxxopts::value<std::string>()->default_value("32"));
+    options.add_options()("num_kv_heads", "Number of KV heads of the attention.",
+        cxxopts::value<std::string>()->default_value("32;8"));
+    options.add_options()(
+        "head_size", "Size of the attention heads.", cxxopts::value<std::string>()->default_value("128"));
+    options.add_options()("seq_len", "Number of past tokens in the KV cache.",
+        cxxopts::value<std::string>()->default_value("1024;4096"));
+    options.add_options()("multi_block_mode", "Split the sequences of the MMHA between several blocks.");
+    options.add_options()("gemv_n", "Output size of the GEMV.", cxxopts::value<std::string>()->default_value("4096"));
+    options.add_options()("gemv_k", "Input size of the GEMV.", cxxopts::value<std::string>()->default_value("4096"));
+    options.add_options()("weight_type", "GEMV weight types, among int8/int4.",
+        cxxopts::value<std::string>()->default_value("int8;int4"));
+    options.add_options()("group_size", "GEMV scale group sizes, 0 for per-channel scales.",
+        cxxopts::value<std::string>()->default_value("0;128"));
+    options.add_options()(
+        "vocab_size", "Vocabulary size of the sampling.", cxxopts::value<std::string>()->default_value("32000"));
+    options.add_options()("top_p", "P of the top-P sampling.", cxxopts::value<float>()->default_value("0.9"));
+    options.add_options()(
+        "hidden_size", "Hidden size of the all-reduce.", cxxopts::value<std::string>()->default_value("4096"));
+    options.add_options()("allreduce_strategy", "All-reduce strategies, among oneshot/twoshot.",
+        cxxopts::value<std::string>()->default_value("oneshot;twoshot"));
+    options.add_options()("peak_bandwidth", "Bandwidth of the device memory in GB/s, queried from the device if unset.",
+        cxxopts::value<double>());
+    options.add_options()("peak_tflops",
+        "Math throughput of the device in TFLOPs for the data type, the roofline only includes the bandwidth if unset.",
+        cxxopts::value<double>());
+    options.add_options()("peak_link_bandwidth",
+        "Bus bandwidth between the GPUs in GB/s, the roofline of the all-reduce.", cxxopts::value<double>());
+    options.add_options()("output_json", "Write the results to a JSON file.",
+        cxxopts::value<std::string>()->default_value(""));
+    options.add_options()(
+        "warm_up", "Specify warm up iterations before benchmark starts.", cxxopts::value<int>()->default_value("5"));
+    options.add_options()(
+        "num_runs", "Number of iterations to average.", cxxopts::value<int>()->default_value("20"));
+    options.add_options()("log_level", "Choose log level between verbose/info/warning/error/internal_error.",
+        cxxopts::value<std::string>()->default_value("error"));
+
+    auto result = options.parse(argc, argv);
+
+    if (result.count("help"))
+    {
+        std::cout << options.help() << std::endl;
+        exit(0);
+    }
+
+    auto const logLevel = result["log_level"].as<std::string>();
+    auto* logger = tc::Logger::getLogger();
+    if (logLevel == "verbose")
+    {
+        logger->setLevel(tc::Logger::TRACE);
+    }
+    else if (logLevel == "info")
+    {
+        logger->setLevel(tc::Logger::INFO);
+    }
+    else if (logLevel == "warning")
+    {
+        logger->setLevel(tc::Logger::WARNING);
+    }
+    else if (logLevel == "error" || logLevel == "internal_error")
+    {
+        logger->setLevel(tc::Logger::ERROR);
+    }
+    else
+    {
+        TLLM_LOG_ERROR("Unexpected log level: " + logLevel);
+        return 1;
+    }
+
+    auto const worldConfig = WorldConfig::mpi();
+    TLLM_CUDA_CHECK(cudaSetDevice(worldConfig.getDevice()));
+    int device{};
+    TLLM_CUDA_CHECK(cudaGetDevice(&device));
+    cudaDeviceProp prop{};
+    TLLM_CUDA_CHECK(cudaGetDeviceProperties(&prop, device));
+
+    // Double data rate memory clock in kHz, bus width in bits
+    double peakBandwidth = 2.0 * prop.memoryClockRate * 1e3 * (prop.memoryBusWidth / 8) / 1e9;
+    if (result.count("peak_bandwidth"))
+    {
+        peakBandwidth = result["peak_bandwidth"].as<double>();
+    }
+    std::optional<double> peakTflops;
+    if (result.count("peak_tflops"))
+    {
+        peakTflops = result["peak_tflops"].as<double>();
+    }
+    std::optional<double> peakLinkBandwidth;
+    if (result.count("peak_link_bandwidth"))
+    {
+        peakLinkBandwidth = result["peak_link_bandwidth"].as<double>();
+    }
+
+    BufferManager bufferManager{std::make_shared<CudaStream>()};
+    BenchContext ctx{bufferManager, worldConfig, result["warm_up"].as<int>(), result["num_runs"].as<int>(),
+        peakBandwidth, peakTflops, peakLinkBandwidth, prop.multiProcessorCount,
+        static_cast<int>(prop.sharedMemPerBlockOptin), bufferManager.gpu(2 * static_cast<size_t>(prop.l2CacheSize)),
+        {}};
+    for (auto& event : ctx.events)
+    {
+        TLLM_CUDA_CHECK(cudaEventCreate(&event));
+    }
+    if (ctx.isReportingRank())
+    {
+        std::cout << "[BENCHMARK] device " << prop.name << " peak_bandwidth(GB/s) " << peakBandwidth << std::endl;
+    }
+
+    try
+    {
+        for (auto const& dtype : parseStringList(result["dtype"].as<std::string>()))
+        {
+            if (dtype == "fp16")
+            {
+                benchmarkKernels<half>(ctx, result, dtype);
+            }
+#ifdef ENABLE_BF16
+            else if (dtype == "bf16")
+            {
+                benchmarkKernels<__nv_bfloat16>(ctx, result, dtype);
+            }
+#endif
+            else if (dtype == "fp32")
+            {
+                benchmarkKernels<float>(ctx, result, dtype);
+            }
+            else
+            {
+                TLLM_LOG_ERROR("Unexpected dtype: " + dtype);
+                return 1;
+            }
+        }
+    }
+    catch (std::exception const& e)
+    {
+        TLLM_LOG_ERROR(e.what());
+        return 1;
+    }
+
+    for (auto event : ctx.events)
+    {
+        TLLM_CUDA_CHECK(cudaEventDestroy(event));
+    }
+
+    auto const outputJson = result["output_json"].as<std::string>();
+    if (!outputJson.empty() && ctx.isReportingRank())
+    {
+        nlohmann::json json{{"device", prop.name}, {"sm", prop.major * 10 + prop.minor},
+            {"peak_bandwidth_gbps", peakBandwidth}, {"results", ctx.results}};
+        if (peakTflops)
+        {
+            json["peak_tflops"] = peakTflops.value();
+        }
+        if (peakLinkBandwidth)
+        {
+            json["peak_link_bandwidth_gbps"] = peakLinkBandwidth.value();
+        }
+        std::ofstream(outputJson) << json.dump(4) << std::endl;
+    }
+
+    return 0;
+}
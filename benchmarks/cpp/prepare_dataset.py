@@ -2,22 +2,123 @@
 
 import argparse
 import json
+import random
 
 from transformers import AutoTokenizer, LlamaTokenizer, T5Tokenizer
 
+
+def load_tokenizer(tokenizer_dir, tokenizer_type):
+    if tokenizer_type == 't5':
+        tokenizer = T5Tokenizer(vocab_file=tokenizer_dir, padding_side='left')
+    elif tokenizer_type == 'auto':
+        tokenizer = AutoTokenizer.from_pretrained(tokenizer_dir,
+                                                  padding_side='left')
+    elif tokenizer_type == 'llama':
+        tokenizer = LlamaTokenizer.from_pretrained(tokenizer_dir,
+                                                   legacy=False,
+                                                   padding_side='left')
+    else:
+        raise AttributeError(f'Unexpected tokenizer type: {tokenizer_type}')
+    tokenizer.pad_token = tokenizer.eos_token
+    return tokenizer
+
+
+def prepare_dataset(tokenizer, dataset, max_input_len):
+    results = []
+    with open(dataset, 'r') as f:
+        data_dict = json.load(f)
+        for req in data_dict:
+            prompt = req['input'] + ' ' + req['instruction']
+            output = req['output']
+            line = tokenizer.encode(prompt)
+            if len(line) > max_input_len:
+                continue
+            # 1.3 is a magic number that converts number of words to number of tokens
+            output_len = int(len(output.split(' ')) * 1.3)
+            results.append({'input_ids': line, 'output_len': output_len})
+    return results
+
+
+def prepare_shared_prefix(num_prefixes, fan_out, shared_prefix_len,
+                          unique_len, output_len, vocab_size, seed):
+    """
+    Random prompts made of one of num_prefixes shared prefixes followed by a
+    unique suffix. Each prefix is used by fan_out requests, which arrive in
+    random order.
+    """
+    rng = random.Random(seed)
+
+    def random_tokens(length):
+        return [rng.randrange(vocab_size) for _ in range(length)]
+
+    results = []
+    for _ in range(num_prefixes):
+        prefix = random_tokens(shared_prefix_len)
+        for _ in range(fan_out):
+            results.append({
+                'input_ids': prefix + random_tokens(unique_len),
+                'output_len': output_len
+            })
+    rng.shuffle(results)
+    return results
+
+
+def prepare_multi_turn(tokenizer, dataset, max_input_len, num_turns):
+    """
+    Replays conversations in the ShareGPT format. The prompt of a turn is the
+    history of the conversation followed by the new question, so it extends
+    the prompt of the previous turn. The turns of all the conversations are
+    interleaved: all the first turns come first, then all the second ones.
+    """
+    turns = []
+    with open(dataset, 'r') as f:
+        for conversation in json.load(f):
+            messages = conversation['conversations']
+            history = []
+            conversation_turns = []
+            for question, answer in zip(messages[0::2], messages[1::2]):
+                if len(conversation_turns) == num_turns:
+                    break
+                # Messages are encoded separately so that the history is an
+                # exact token prefix of the next prompts
+                history = history + tokenizer.encode(question['value'])
+                if len(history) > max_input_len:
+                    break
+                answer_ids = tokenizer.encode(answer['value'])
+                conversation_turns.append({
+                    'input_ids': history,
+                    'output_len': len(answer_ids)
+                })
+                history = history + answer_ids
+            turns.append(conversation_turns)
+
+    results = []
+    for turn in range(max((len(t) for t in turns), default=0)):
+        results += [t[turn] for t in turns if turn < len(t)]
+    return results
+
+
 if __name__ == '__main__':
     parser = argparse.ArgumentParser()
+    parser.add_argument(
+        '--mode',
+        type=str,
+        default='dataset',
+        choices=['dataset', 'shared_prefix', 'multi_turn'],
+        help='dataset: independent prompts of the dataset, '
+        'shared_prefix: random prompts sharing prefixes, '
+        'multi_turn: replay of the conversations of a ShareGPT dataset')
     parser.add_argument('--dataset',
                         type=str,
-                        required=True,
+                        default=None,
                         help='Dataset path used for the test.')
     parser.add_argument('--max_input_len',
                         type=int,
-                        required=True,
+                        default=None,
                         help='Specify max input length')
     parser.add_argument('--tokenizer_dir',
                         type=str,
-                        required=True,
+                        default=None,
                         help='Specify tokenizer directory')
     parser.add_argument('--tokenizer_type',
                         type=str,
@@ -25,39 +126,58 @@ if __name__ == '__main__':
                         required=False,
                         choices=['auto', 't5', 'llama'],
                         help='Specify tokenizer type')
+    parser.add_argument('--num_turns',
+                        type=int,
+                        default=None,
+                        help='Max number of turns replayed per conversation.')
+    parser.add_argument('--num_prefixes',
+                        type=int,
+                        default=8,
+                        help='Number of distinct shared prefixes.')
+    parser.add_argument('--fan_out',
+                        type=int,
+                        default=16,
+                        help='Number of requests sharing each prefix.')
+    parser.add_argument('--shared_prefix_len',
+                        type=int,
+                        default=512,
+                        help='Length of the shared prefixes in tokens.')
+    parser.add_argument('--unique_len',
+                        type=int,
+                        default=64,
+                        help='Length of the unique suffixes in tokens.')
+    parser.add_argument('--output_len',
+                        type=int,
+                        default=128,
+                        help='Output length of the shared prefix requests.')
+    parser.add_argument('--vocab_size',
+                        type=int,
+                        default=32000,
+                        help='Token ids of the shared prefix requests are '
+                        'drawn from [0, vocab_size).')
+    parser.add_argument('--random_seed', type=int, default=0)
     parser.add_argument('--output',
                         type=str,
                         default='preprocessed_dataset.json',
                         help='Preprocessed dataset path.')
     FLAGS = parser.parse_args()
 
-    if FLAGS.tokenizer_type == 't5':
-        tokenizer = T5Tokenizer(vocab_file=FLAGS.tokenizer_dir,
-                                padding_side='left')
-    elif FLAGS.tokenizer_type == 'auto':
-        tokenizer = AutoTokenizer.from_pretrained(FLAGS.tokenizer_dir,
-                                                  padding_side='left')
-    elif FLAGS.tokenizer_type == 'llama':
-        tokenizer = LlamaTokenizer.from_pretrained(FLAGS.tokenizer_dir,
-                                                   legacy=False,
-                                                   padding_side='left')
+    if FLAGS.mode == 'shared_prefix':
+        results = prepare_shared_prefix(FLAGS.num_prefixes, FLAGS.fan_out,
+                                        FLAGS.shared_prefix_len,
+                                        FLAGS.unique_len, FLAGS.output_len,
+                                        FLAGS.vocab_size, FLAGS.random_seed)
     else:
-        raise AttributeError(
-            f'Unexpected tokenizer type: {FLAGS.tokenizer_type}')
-    tokenizer.pad_token = tokenizer.eos_token
-
-    results = []
-    with open(FLAGS.dataset, 'r') as f:
-        data_dict = json.load(f)
-        for req in data_dict:
-            prompt = req['input'] + ' ' + req['instruction']
-            output = req['output']
-            line = tokenizer.encode(prompt)
-            if len(line) > FLAGS.max_input_len:
-                continue
-            # 1.3 is a magic number that converts number of words to number of tokens
-            output_len = int(len(output.split(' ')) * 1.3)
-            results.append({'input_ids': line, 'output_len': output_len})
+        for arg in ['dataset', 'max_input_len', 'tokenizer_dir']:
+            if getattr(FLAGS, arg) is None:
+                parser.error(f'--{arg} is required with --mode {FLAGS.mode}')
+        tokenizer = load_tokenizer(FLAGS.tokenizer_dir, FLAGS.tokenizer_type)
+        if FLAGS.mode == 'dataset':
+            results = prepare_dataset(tokenizer, FLAGS.dataset,
+                                      FLAGS.max_input_len)
+        else:
+            results = prepare_multi_turn(tokenizer, FLAGS.dataset,
+                                         FLAGS.max_input_len, FLAGS.num_turns)
 
     with open(FLAGS.output, 'w') as f:
         json.dump(results, f)
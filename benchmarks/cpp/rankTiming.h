@@ -0,0 +1,163 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2022-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "benchmarkReport.h"
+#include "tensorrt_llm/common/commProfiler.h"
+#include "tensorrt_llm/common/mpiUtils.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm::benchmark
+{
+
+//! \brief Durations of the steps on each rank and the part spent in collectives, to find a slow GPU or link.
+//!
+//! The ranks of a tensor or pipeline parallel model wait for each other in the collectives: a slow GPU has the longest
+//! compute time (step minus collectives) while the other ranks wait in their collectives, a slow link makes the
+//! collectives of the ranks using it longer. The communication time comes from common::CommProfiler, which must be
+//! enabled.
+class RankTiming
+{
+public:
+    void addStep(double stepMs, double commMs)
+    {
+        mSteps.push_back(stepMs);
+        mSteps.push_back(commMs);
+    }
+
+    //! \brief Adds the duration of each step with the time of its collectives, from the stats of
+    //! common::CommProfiler::collect with one iteration per step.
+    void addSteps(std::vector<float> const& stepTimesMs, std::vector<common::CommIterationStats> const& commStats)
+    {
+        std::vector<double> commMs(stepTimesMs.size(), 0.0);
+        for (auto const& stats : commStats)
+        {
+            if (stats.iteration >= 0 && static_cast<std::size_t>(stats.iteration) < commMs.size())
+            {
+                commMs[stats.iteration] = stats.getTotal().timeMs;
+            }
+        }
+        for (std::size_t step = 0; step < stepTimesMs.size(); ++step)
+        {
+            addStep(stepTimesMs[step], commMs[step]);
+        }
+    }
+
+    [[nodiscard]] std::size_t getNumSteps() const
+    {
+        return mSteps.size() / 2;
+    }
+
+    void clear()
+    {
+        mSteps.clear();
+    }
+
+    //! \brief Gathers the steps of all the ranks and prints, on rank 0, the time of each rank and the skew of the
+    //! steps, i.e. the difference between the slowest and the fastest rank. The steps are matched by their index, the
+    //! ones beyond the fewest steps of any rank are dropped. All the ranks of comm must call it. Clears the steps.
+    void gather(mpi::MpiComm const& comm, nlohmann::json const& params, std::string const& prefix,
+        BenchmarkReport& report)
+    {
+        auto const numRanks = comm.getSize();
+        int64_t const localNumSteps = getNumSteps();
+        std::vector<int64_t> numSteps(numRanks);
+        comm.allgather(&localNumSteps, numSteps.data(), 1, mpi::MpiType::kINT64);
+        auto const minNumSteps = *std::min_element(numSteps.begin(), numSteps.end());
+        mSteps.resize(2 * minNumSteps);
+        std::vector<double> steps(numRanks * mSteps.size());
+        comm.allgather(mSteps.data(), steps.data(), static_cast<int>(mSteps.size()), mpi::MpiType::kDOUBLE);
+        clear();
+        if (comm.getRank() != 0 || minNumSteps == 0)
+        {
+            return;
+        }
+
+        auto const stepTime = [&](int rank, int64_t step) { return steps[2 * (rank * minNumSteps + step)]; };
+        auto const commTime = [&](int rank, int64_t step) { return steps[2 * (rank * minNumSteps + step) + 1]; };
+
+        std::vector<int64_t> numSlowest(numRanks, 0);
+        std::vector<double> minStepTimes;
+        std::vector<double> maxStepTimes;
+        std::vector<double> skews;
+        for (int64_t step = 0; step < minNumSteps; ++step)
+        {
+            double minStepTime = stepTime(0, step);
+            double maxStepTime = stepTime(0, step);
+            int slowestRank = 0;
+            for (int rank = 1; rank < numRanks; ++rank)
+            {
+                minStepTime = std::min(minStepTime, stepTime(rank, step));
+                maxStepTime = std::max(maxStepTime, stepTime(rank, step));
+                if (stepTime(rank, step) - commTime(rank, step)
+                    > stepTime(slowestRank, step) - commTime(slowestRank, step))
+                {
+                    slowestRank = rank;
+                }
+            }
+            ++numSlowest[slowestRank];
+            minStepTimes.push_back(minStepTime);
+            maxStepTimes.push_back(maxStepTime);
+            skews.push_back(maxStepTime - minStepTime);
+        }
+
+        for (int rank = 0; rank < numRanks; ++rank)
+        {
+            std::vector<double> stepTimes;
+            std::vector<double> commTimes;
+            std::vector<double> computeTimes;
+            for (int64_t step = 0; step < minNumSteps; ++step)
+            {
+                stepTimes.push_back(stepTime(rank, step));
+                commTimes.push_back(commTime(rank, step));
+                computeTimes.push_back(stepTime(rank, step) - commTime(rank, step));
+            }
+            auto const stepSummary = summarize(stepTimes);
+            auto const commSummary = summarize(commTimes);
+            auto const computeSummary = summarize(computeTimes);
+            printf("[BENCHMARK] %s rank %d steps %ld step_time(ms) %.3f max_step_time(ms) %.3f comm_time(ms) %.3f "
+                   "compute_time(ms) %.3f slowest_steps(%%) %.1f\n",
+                prefix.c_str(), rank, minNumSteps, stepSummary.mean, stepSummary.max, commSummary.mean,
+                computeSummary.mean, 100.0 * numSlowest[rank] / minNumSteps);
+            auto const suffix = "_rank" + std::to_string(rank);
+            report.addMetric(params, "step_time_ms" + suffix, stepTimes, false);
+            report.addMetric(params, "comm_time_ms" + suffix, commTimes, false);
+            report.addMetric(params, "compute_time_ms" + suffix, computeTimes, false);
+        }
+
+        auto const skewSummary = summarize(skews);
+        auto const maxSkewStep = std::max_element(skews.begin(), skews.end()) - skews.begin();
+        auto const slowestRank = std::max_element(numSlowest.begin(), numSlowest.end()) - numSlowest.begin();
+        printf("[BENCHMARK] %s step_skew(ms) mean %.3f p99 %.3f max %.3f max_skew_step %ld min_step_time(ms) %.3f "
+               "max_step_time(ms) %.3f slowest_rank %ld\n",
+            prefix.c_str(), skewSummary.mean, skewSummary.p99, skewSummary.max, maxSkewStep,
+            minStepTimes[maxSkewStep], maxStepTimes[maxSkewStep], slowestRank);
+        report.addMetric(params, "step_time_ms_min", minStepTimes, false);
+        report.addMetric(params, "step_time_ms_max", maxStepTimes, false);
+        report.addMetric(params, "step_skew_ms", skews, false);
+    }
+
+private:
+    // Duration of each step followed by the time of its collectives
+    std::vector<double> mSteps;
+};
+
+} // namespace tensorrt_llm::benchmark
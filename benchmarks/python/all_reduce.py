@@ -64,7 +64,8 @@ def allreduce_benchmark(dtype: str, test_range: str = "10,10000000,10"):
 
         for strategy in [
                 AllReduceStrategy.RING, AllReduceStrategy.ONESHOT,
-                AllReduceStrategy.TWOSHOT
+                AllReduceStrategy.TWOSHOT, AllReduceStrategy.NVLS,
+                AllReduceStrategy.LOWLATENCY
         ]:
             builder = tllm.Builder()
             net = builder.create_network()
@@ -156,3 +156,6 @@ class BaseBenchmark(object):
 
     def report(self, config, latency):
         raise NotImplementedError
+
+    def add_report_metrics(self, report, config, latencies):
+        raise NotImplementedError
@@ -185,6 +185,20 @@ def parse_arguments():
                         default=False,
                         action="store_true",
                         help='Output in CSV format.')
+    parser.add_argument(
+        '--runtime',
+        type=str,
+        default='python',
+        choices=['python', 'cpp'],
+        help=('Run GPT models with the Python GenerationSession, or with the '
+              'C++ GptSession through ModelRunnerCpp. The C++ runtime times '
+              'the same scope as gptSessionBenchmark and needs --engine_dir.'))
+    parser.add_argument(
+        '--output_json',
+        type=str,
+        default=None,
+        help=('Write the config, the environment and the measurements to a '
+              'JSON file, with the schema of the C++ benchmarks.'))
     parser.add_argument('--enable_cuda_graph',
                         default=False,
                         action='store_true',
@@ -237,6 +251,7 @@ def main(args):
     # so we set the start method first, then initialize MPI.
     from allowed_configs import get_allowed_models
     from benchmark_profiler import BenchmarkProfiler
+    from benchmark_report import BenchmarkReport
     from bert_benchmark import BERTBenchmark
     from enc_dec_benchmark import EncDecBenchmark
     from gpt_benchmark import GPTBenchmark
@@ -272,7 +287,9 @@ def main(args):
 
     benchmark_profiler = None
     if args.model in get_allowed_models(benchmark_type="gpt"):
-        benchmark_profiler = BenchmarkProfiler()
+        # The C++ session is only timed as a whole
+        if args.runtime == 'python':
+            benchmark_profiler = BenchmarkProfiler()
         benchmarker = GPTBenchmark(args, batch_size_options, in_out_len_options,
                                    rank, world_size)
     elif args.model in get_allowed_models(benchmark_type="bert"):
@@ -287,6 +304,11 @@ def main(args):
     if args.build_only:
         return
 
+    report = None
+    if args.output_json is not None and rank == 0:
+        report = BenchmarkReport(f'benchmark.py ({args.runtime} runtime)',
+                                 vars(args))
+
     start = torch.cuda.Event(enable_timing=True)
     end = torch.cuda.Event(enable_timing=True)
     benchmarker.print_report_header(args.csv,
@@ -345,6 +367,9 @@ def main(args):
             benchmark_profiler.add_aux_info('iter_count', iter_idx)
             benchmark_profiler.stop()
 
+        if report is not None:
+            benchmarker.add_report_metrics(report, config, latencies)
+
         latency = round(sum(latencies) / iter_idx, 3)
         latencies.sort()
         percentile95 = round(latencies[int(iter_idx * 0.95)], 3)
@@ -357,6 +382,9 @@ def main(args):
                            csv=args.csv,
                            benchmark_profiler=benchmark_profiler)
 
+    if report is not None:
+        report.write(args.output_json)
+
 
 if __name__ == '__main__':
     mp.set_start_method('spawn')
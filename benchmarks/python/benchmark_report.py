@@ -0,0 +1,115 @@
+# SPDX-FileCopyrightText: Copyright (c) 2022-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+import ctypes
+import json
+import math
+
+import torch
+
+# Same JSON schema as benchmarks/cpp/benchmarkReport.h, so that the results of
+# the Python benchmarks can be compared with those of the C++ benchmarks, e.g.
+# with `gptSessionBenchmark --baseline`.
+
+
+def summarize(samples):
+    samples = sorted(samples)
+    summary = {
+        'count': len(samples),
+        'mean': 0.0,
+        'stddev': 0.0,
+        'min': 0.0,
+        'max': 0.0,
+        'p50': 0.0,
+        'p90': 0.0,
+        'p99': 0.0
+    }
+    if not samples:
+        return summary
+
+    # Nearest-rank percentile
+    def percentile(p):
+        rank = math.ceil(p / 100 * len(samples))
+        return samples[min(max(rank, 1), len(samples)) - 1]
+
+    mean = sum(samples) / len(samples)
+    summary['mean'] = mean
+    if len(samples) > 1:
+        summary['stddev'] = math.sqrt(
+            sum((s - mean)**2 for s in samples) / (len(samples) - 1))
+    summary['min'] = samples[0]
+    summary['max'] = samples[-1]
+    summary['p50'] = percentile(50)
+    summary['p90'] = percentile(90)
+    summary['p99'] = percentile(99)
+    return summary
+
+
+def _get_cuda_driver_version():
+    try:
+        libcuda = ctypes.CDLL('libcuda.so.1')
+        version = ctypes.c_int(0)
+        libcuda.cuDriverGetVersion(ctypes.byref(version))
+        return version.value
+    except OSError:
+        return 0
+
+
+def get_environment():
+    import tensorrt as trt
+    device = torch.cuda.current_device()
+    prop = torch.cuda.get_device_properties(device)
+    # Encoded like cudaRuntimeGetVersion, e.g. 12020 for 12.2
+    major, minor = (int(v) for v in torch.version.cuda.split('.')[:2])
+    return {
+        'gpu': prop.name,
+        'sm': prop.major * 10 + prop.minor,
+        'num_gpus': torch.cuda.device_count(),
+        'cuda_driver_version': _get_cuda_driver_version(),
+        'cuda_runtime_version': major * 1000 + minor * 10,
+        'tensorrt_version': '.'.join(trt.__version__.split('.')[:3]),
+    }
+
+
+class BenchmarkReport(object):
+    """
+    Results of a benchmark in JSON. A result is the set of metrics measured
+    for one configuration, identified by its params, e.g. the batch size and
+    the sequence lengths. Every metric keeps its samples and their summary.
+    """
+
+    def __init__(self, benchmark: str, config: dict):
+        self.json = {
+            'benchmark': benchmark,
+            'config': config,
+            'environment': get_environment(),
+            'results': []
+        }
+
+    def add_metric(self, params: dict, metric: str, samples: list,
+                   higher_is_better: bool):
+        results = self.json['results']
+        result = next((r for r in results if r['params'] == params), None)
+        if result is None:
+            result = {'params': params, 'metrics': {}}
+            results.append(result)
+        result['metrics'][metric] = {
+            'higher_is_better': higher_is_better,
+            'summary': summarize(samples),
+            'samples': list(samples)
+        }
+
+    def write(self, path: str):
+        with open(path, 'w') as f:
+            json.dump(self.json, f, indent=4)
@@ -97,6 +97,13 @@ class BERTBenchmark(BaseBenchmark):
         assert ok, "Runtime execution failed"
         torch.cuda.synchronize()
 
+    def add_report_metrics(self, report, config, latencies):
+        batch_size, inlen = config[0], config[1]
+        report.add_metric({
+            'batch_size': batch_size,
+            'input_length': inlen
+        }, 'latency_ms', latencies, False)
+
     def report(self, config, latency, percentile95, percentile99,
                peak_gpu_used):
         if self.runtime_rank == 0:
@@ -33,6 +33,11 @@ class GPTBenchmark(BaseBenchmark):
         self.in_out_lens = in_out_lens
         self.num_beams = args.num_beams
         self.mode = args.mode
+        self.runtime = args.runtime
+        assert self.runtime == 'python' or args.engine_dir is not None, \
+            'The C++ runtime loads the engines of --engine_dir'
+        self.top_k = args.top_k
+        self.top_p = args.top_p
         self.build_time = 0
 
         self.cuda_graph_mode = args.enable_cuda_graph
@@ -78,6 +83,17 @@ class GPTBenchmark(BaseBenchmark):
 
         if not hasattr(self, 'num_kv_heads') or self.num_kv_heads is None:
             self.num_kv_heads = self.num_heads
+        if self.runtime == 'cpp':
+            # Like gptSessionBenchmark, a C++ session is created for each
+            # input-output length by prepare_inputs
+            self.runner = None
+            self.runner_lengths = None
+            if "llama" in args.model:
+                self.end_id, self.pad_id = 2, 0
+            else:
+                self.end_id, self.pad_id = 50256, 50256
+            return
+
         model_config = tensorrt_llm.runtime.ModelConfig(
             vocab_size=self.vocab_size,
             num_layers=self.num_layers,
@@ -142,8 +158,54 @@ class GPTBenchmark(BaseBenchmark):
                     continue
                 yield (batch_size, inlen, outlen)
 
+    def prepare_cpp_inputs(self, batch_size, inlen, outlen):
+        from tensorrt_llm.bindings import (GenerationInput, GenerationOutput,
+                                           SamplingConfig)
+        from tensorrt_llm.runtime import ModelRunnerCpp
+
+        if self.runner_lengths != (inlen, outlen):
+            # Free the previous session before creating the next one
+            self.runner = None
+            torch.cuda.empty_cache()
+            self.runner = ModelRunnerCpp.from_dir(
+                self.engine_dir,
+                rank=self.runtime_rank,
+                max_batch_size=min(max(self.batch_sizes), self.max_batch_size),
+                max_input_len=inlen,
+                max_output_len=outlen,
+                max_beam_width=self.num_beams)
+            self.runner_lengths = (inlen, outlen)
+
+        # The inputs are prepared once, only GptSession.generate is timed
+        input_ids = torch.randint(100, (batch_size, inlen)).int().cuda()
+        input_lengths = torch.full((batch_size, ), inlen).int().cuda()
+        if self.runner.remove_input_padding:
+            input_ids = input_ids.view(-1)
+        generation_input = GenerationInput(self.end_id, self.pad_id,
+                                           input_ids, input_lengths,
+                                           self.runner.remove_input_padding)
+        generation_input.max_new_tokens = outlen
+        output_ids = torch.empty((batch_size, self.num_beams, inlen + outlen),
+                                 dtype=torch.int32,
+                                 device='cuda')
+        output_lengths = torch.empty((batch_size, self.num_beams),
+                                     dtype=torch.int32,
+                                     device='cuda')
+        generation_output = GenerationOutput(output_ids, output_lengths)
+
+        # Same sampling as gptSessionBenchmark, all output tokens generated
+        sampling_config = SamplingConfig(self.num_beams)
+        sampling_config.temperature = [1.0]
+        sampling_config.random_seed = [42]
+        sampling_config.top_k = [self.top_k]
+        sampling_config.top_p = [self.top_p]
+        sampling_config.min_length = [outlen]
+        return (generation_input, generation_output, sampling_config)
+
     def prepare_inputs(self, config):
         batch_size, inlen, outlen = config[0], config[1], config[2]
+        if self.runtime == 'cpp':
+            return self.prepare_cpp_inputs(batch_size, inlen, outlen)
         input_ids = torch.randint(100, (batch_size, inlen)).int().cuda()
         input_lengths = torch.tensor([inlen
                                       for _ in range(batch_size)]).int().cuda()
@@ -162,6 +224,10 @@ class GPTBenchmark(BaseBenchmark):
 
     def run(self, inputs, config, benchmark_profiler=None):
         batch_size, inlen, outlen = config[0], config[1], config[2]
+        if self.runtime == 'cpp':
+            self.runner.session.generate(inputs[1], inputs[0], inputs[2])
+            torch.cuda.synchronize()
+            return
         self.decoder.setup(batch_size, inlen, outlen, beam_width=self.num_beams)
         if self.remove_input_padding:
             self.decoder.decode_batch(inputs[0],
@@ -174,6 +240,20 @@ class GPTBenchmark(BaseBenchmark):
                                 benchmark_profiler=benchmark_profiler)
         torch.cuda.synchronize()
 
+    def add_report_metrics(self, report, config, latencies):
+        batch_size, inlen, outlen = config[0], config[1], config[2]
+        # Same params and metrics as gptSessionBenchmark
+        params = {
+            'batch_size': batch_size,
+            'beam_width': self.num_beams,
+            'input_length': inlen,
+            'output_length': outlen
+        }
+        report.add_metric(params, 'latency_ms', latencies, False)
+        report.add_metric(params, 'tokens_per_sec',
+                          [batch_size * outlen / (l / 1000) for l in latencies],
+                          True)
+
     def report(self,
                config,
                latency,
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/NamedTensor.h"
+#include "tensorrt_llm/batch_manager/callbacks.h"
+#include "tensorrt_llm/common/mpscQueue.h"
+#include "tensorrt_llm/common/nvtxUtils.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace tensorrt_llm::batch_manager
+{
+
+struct Response
+{
+    uint64_t requestId;
+    std::list<NamedTensor> tensors;
+    bool isFinal;
+    std::string errMsg;
+};
+
+using SendResponsesCallback = std::function<void(std::list<Response> const&)>;
+
+/* Decouples the frontend from the GptManager generation loop.
+   Frontend threads add requests with enqueueRequest, without locking; the callback returned by
+   getInferenceRequestsCallback only drains them. The callback returned by sendResponseCallback only queues the
+   responses, which a dispatch thread delivers in batches to the frontend callback, so slow serialization of
+   responses runs concurrently with the next step instead of stalling it.
+
+   Pass both callbacks to the GptManager and keep this object alive until the GptManager has shut down. */
+class AsyncCallbacks
+{
+public:
+    /* maxResponsesPerBatch bounds the responses given to one call of sendResponsesCb. */
+    explicit AsyncCallbacks(SendResponsesCallback sendResponsesCb, std::size_t maxResponsesPerBatch = 256,
+        std::chrono::microseconds pollInterval = std::chrono::microseconds{1000})
+        : mSendResponsesCb{std::move(sendResponsesCb)}
+        , mMaxResponsesPerBatch{maxResponsesPerBatch}
+        , mPollInterval{pollInterval}
+        , mDispatchThread{&AsyncCallbacks::dispatchLoop, this}
+    {
+    }
+
+    /* Delivers the responses one by one to a per-response frontend callback. */
+    explicit AsyncCallbacks(SendResponseCallback sendResponseCb)
+        : AsyncCallbacks(
+            [cb = std::move(sendResponseCb)](std::list<Response> const& responses)
+            {
+                for (auto const& response : responses)
+                {
+                    cb(response.requestId, response.tensors, response.isFinal, response.errMsg);
+                }
+            })
+    {
+    }
+
+    AsyncCallbacks(AsyncCallbacks const&) = delete;
+    AsyncCallbacks& operator=(AsyncCallbacks const&) = delete;
+
+    /* Delivers the queued responses and stops the dispatch thread. */
+    ~AsyncCallbacks()
+    {
+        mShutdown.store(true, std::memory_order_release);
+        mResponsesCv.notify_one();
+        mDispatchThread.join();
+    }
+
+    /* Thread safe and lock-free. */
+    void enqueueRequest(std::shared_ptr<InferenceRequest> request)
+    {
+        mRequests.push(std::move(request));
+    }
+
+    [[nodiscard]] GetInferenceRequestsCallback getInferenceRequestsCallback()
+    {
+        return [this](int32_t maxNumRequests)
+        {
+            std::list<std::shared_ptr<InferenceRequest>> requests;
+            if (maxNumRequests > 0)
+            {
+                mRequests.popAll(requests, static_cast<std::size_t>(maxNumRequests));
+            }
+            // Called by the batch manager at the start of each step
+            common::nvtx::mark<common::nvtx::category::Scheduling>("fetch_requests", requests.size());
+            return requests;
+        };
+    }
+
+    /* The tensors of a response are shared, not copied, with the dispatch thread. */
+    [[nodiscard]] SendResponseCallback sendResponseCallback()
+    {
+        return [this](uint64_t requestId, std::list<NamedTensor> const& tensors, bool isFinal,
+                   std::string const& errMsg)
+        {
+            mResponses.push(Response{requestId, tensors, isFinal, errMsg});
+            mResponsesCv.notify_one();
+        };
+    }
+
+private:
+    void dispatchLoop()
+    {
+        while (true)
+        {
+            // Read before draining, so responses queued before shutdown are delivered
+            auto const shutdown = mShutdown.load(std::memory_order_acquire);
+            std::list<Response> responses;
+            mResponses.popAll(responses, mMaxResponsesPerBatch);
+            if (!responses.empty())
+            {
+                mSendResponsesCb(responses);
+                continue;
+            }
+            if (shutdown)
+            {
+                break;
+            }
+            // Producers notify without taking the lock, a missed notification is caught by the next poll
+            std::unique_lock<std::mutex> lock(mResponsesMutex);
+            mResponsesCv.wait_for(lock, mPollInterval,
+                [this] { return !mResponses.empty() || mShutdown.load(std::memory_order_acquire); });
+        }
+    }
+
+    SendResponsesCallback mSendResponsesCb;
+    std::size_t mMaxResponsesPerBatch;
+    std::chrono::microseconds mPollInterval;
+
+    common::MpscQueue<std::shared_ptr<InferenceRequest>> mRequests;
+    common::MpscQueue<Response> mResponses;
+    std::mutex mResponsesMutex;
+    std::condition_variable mResponsesCv;
+    std::atomic<bool> mShutdown{false};
+    // Started last, after the queues it reads
+    std::thread mDispatchThread;
+};
+
+} // namespace tensorrt_llm::batch_manager
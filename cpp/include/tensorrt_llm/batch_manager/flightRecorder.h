@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/batch_manager/iterationStats.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/commProfiler.h"
+#include "tensorrt_llm/common/tllmException.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace tensorrt_llm::batch_manager
+{
+
+/* One iteration in the file written by FlightRecorder::dump. The layout is fixed, scripts/decode_flight_record.py
+   decodes it. */
+struct FlightRecord
+{
+    static constexpr std::size_t kMaxRequestIds{32};
+
+    std::int64_t iterationCounter;
+    // Microseconds since the epoch of the system clock
+    std::int64_t timestampUs;
+    std::int64_t stepTimeUs;
+    std::int64_t fetchRequestsTimeUs;
+    std::int64_t scheduleTimeUs;
+    std::int64_t forwardTimeUs;
+    std::int64_t sendResponsesTimeUs;
+    std::int32_t numActiveRequests;
+    std::int32_t numQueuedRequests;
+    std::int32_t numPausedRequests;
+    std::int32_t numContextRequests;
+    std::int32_t numGenerationRequests;
+    std::int32_t numContextTokens;
+    std::int32_t numGenerationTokens;
+    std::int32_t usedKvBlocks;
+    std::int32_t freeKvBlocks;
+    // Net change of the used KV cache blocks since the previous iteration
+    std::int32_t kvBlocksAllocated;
+    std::int32_t kvBlocksFreed;
+    // May exceed kMaxRequestIds, only the first ids are kept
+    std::int32_t numScheduledRequests;
+    // Collectives by common::CommOp, zero unless common::CommProfiler is enabled
+    std::array<float, common::kNbCommOps> commTimeMs;
+    std::array<std::uint32_t, common::kNbCommOps> commCount;
+    std::array<std::uint64_t, kMaxRequestIds> requestIds;
+};
+
+static_assert(std::is_trivially_copyable_v<FlightRecord>);
+static_assert(sizeof(FlightRecord) % alignof(std::uint64_t) == 0);
+
+/* Header of the file written by FlightRecorder::dump, followed by numRecords records, oldest first. */
+struct FlightRecordFileHeader
+{
+    static constexpr std::array<char, 8> kMagic{'T', 'L', 'L', 'M', 'F', 'L', 'T', '1'};
+
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t recordSize;
+    std::uint32_t numCommOps;
+    std::uint32_t maxRequestIds;
+    std::uint64_t numRecords;
+};
+
+/* Always-on ring of the last iterations of the batch manager, to see what the scheduler did before a latency spike or
+   an exception. record copies a few integers into a preallocated slot and is called by the generation loop, the only
+   writer. dump only uses async-signal-safe calls, so it can run in a signal handler or while record runs. */
+class FlightRecorder
+{
+public:
+    explicit FlightRecorder(std::size_t capacity = 1024)
+        : mRecords(std::max<std::size_t>(capacity, 2))
+    {
+    }
+
+    FlightRecorder(FlightRecorder const&) = delete;
+    FlightRecorder& operator=(FlightRecorder const&) = delete;
+
+    ~FlightRecorder()
+    {
+        FlightRecorder const* self = this;
+        sInstalled.compare_exchange_strong(self, nullptr);
+    }
+
+    /* Records an iteration and the ids of the requests it scheduled. */
+    template <typename TRequestList>
+    void record(IterationStats const& stats, TRequestList const& scheduledRequests)
+    {
+        auto& record = beginRecord(stats);
+        record.numScheduledRequests = 0;
+        for (auto const& request : scheduledRequests)
+        {
+            if (static_cast<std::size_t>(record.numScheduledRequests) < FlightRecord::kMaxRequestIds)
+            {
+                record.requestIds[record.numScheduledRequests] = request->mRequestId;
+            }
+            ++record.numScheduledRequests;
+        }
+        endRecord();
+    }
+
+    void record(IterationStats const& stats)
+    {
+        beginRecord(stats);
+        endRecord();
+    }
+
+    /* The recorded iterations, oldest first. */
+    [[nodiscard]] std::vector<FlightRecord> getRecords() const
+    {
+        auto const [begin, end] = getRange();
+        std::vector<FlightRecord> records;
+        for (auto i = begin; i < end; ++i)
+        {
+            records.push_back(mRecords[i % mRecords.size()]);
+        }
+        return records;
+    }
+
+    /* Writes the recorded iterations to path, replacing it. Returns false on error. */
+    bool dump(char const* path) const noexcept
+    {
+        auto const [begin, end] = getRange();
+        FlightRecordFileHeader header{};
+        header.magic = FlightRecordFileHeader::kMagic;
+        header.version = 1;
+        header.recordSize = sizeof(FlightRecord);
+        header.numCommOps = common::kNbCommOps;
+        header.maxRequestIds = FlightRecord::kMaxRequestIds;
+        header.numRecords = end - begin;
+
+        auto const fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            return false;
+        }
+        auto ok = writeAll(fd, &header, sizeof(header));
+        for (auto i = begin; ok && i < end; ++i)
+        {
+            ok = writeAll(fd, &mRecords[i % mRecords.size()], sizeof(FlightRecord));
+        }
+        return ::close(fd) == 0 && ok;
+    }
+
+    /* Dumps recorder to path when the process receives signal, e.g. `kill -USR1`, and whenever a TllmException is
+       created. After a signal other than SIGUSR1 and SIGUSR2, e.g. SIGABRT, the default action follows the dump. One
+       recorder is installed at a time, it is uninstalled when destroyed. */
+    static void install(FlightRecorder& recorder, std::string const& path, int signal = SIGUSR1)
+    {
+        TLLM_CHECK_WITH_INFO(path.size() < sPath.size(), "Flight recorder path is too long: " + path);
+        std::copy(path.begin(), path.end(), sPath.begin());
+        sPath[path.size()] = '\0';
+        sInstalled.store(&recorder, std::memory_order_release);
+        std::signal(signal, &FlightRecorder::handleSignal);
+        common::TllmException::setCreationHook(&FlightRecorder::dumpInstalled);
+    }
+
+    /* Dumps the installed recorder, if any. */
+    static void dumpInstalled() noexcept
+    {
+        if (auto const* recorder = sInstalled.load(std::memory_order_acquire); recorder != nullptr)
+        {
+            recorder->dump(sPath.data());
+        }
+    }
+
+private:
+    FlightRecord& beginRecord(IterationStats const& stats)
+    {
+        auto const toMicroseconds = [](IterationStats::Duration duration) { return duration.count(); };
+        auto const index = mNumRecords.load(std::memory_order_relaxed);
+        auto& record = mRecords[index % mRecords.size()];
+        record = FlightRecord{};
+        record.iterationCounter = stats.iterationCounter;
+        record.timestampUs
+            = std::chrono::duration_cast<std::chrono::microseconds>(stats.timestamp.time_since_epoch()).count();
+        record.stepTimeUs = toMicroseconds(stats.getStepTime());
+        record.fetchRequestsTimeUs = toMicroseconds(stats.fetchRequestsTime);
+        record.scheduleTimeUs = toMicroseconds(stats.scheduleTime);
+        record.forwardTimeUs = toMicroseconds(stats.forwardTime);
+        record.sendResponsesTimeUs = toMicroseconds(stats.sendResponsesTime);
+        record.numActiveRequests = stats.numActiveRequests;
+        record.numQueuedRequests = stats.numQueuedRequests;
+        record.numPausedRequests = stats.numPausedRequests;
+        record.numContextRequests = stats.numContextRequests;
+        record.numGenerationRequests = stats.numGenerationRequests;
+        record.numContextTokens = stats.numContextTokens;
+        record.numGenerationTokens = stats.numGenerationTokens;
+        record.usedKvBlocks = stats.usedNumKvBlocks;
+        record.freeKvBlocks = stats.freeNumKvBlocks;
+        auto const kvBlocksDelta = stats.usedNumKvBlocks - mLastUsedKvBlocks;
+        record.kvBlocksAllocated = std::max(kvBlocksDelta, 0);
+        record.kvBlocksFreed = std::max(-kvBlocksDelta, 0);
+        mLastUsedKvBlocks = stats.usedNumKvBlocks;
+        record.numScheduledRequests = stats.numScheduledRequests;
+        for (std::size_t op = 0; op < common::kNbCommOps; ++op)
+        {
+            record.commTimeMs[op] = stats.commStats.ops[op].timeMs;
+            record.commCount[op] = static_cast<std::uint32_t>(stats.commStats.ops[op].count);
+        }
+        return record;
+    }
+
+    void endRecord()
+    {
+        mNumRecords.fetch_add(1, std::memory_order_release);
+    }
+
+    // Indices of the complete records, the oldest slot is left out since record may be overwriting it
+    [[nodiscard]] std::pair<std::size_t, std::size_t> getRange() const
+    {
+        auto const end = mNumRecords.load(std::memory_order_acquire);
+        auto const count = std::min(end, mRecords.size() - 1);
+        return {end - count, end};
+    }
+
+    static bool writeAll(int fd, void const* data, std::size_t size) noexcept
+    {
+        auto const* bytes = static_cast<char const*>(data);
+        while (size > 0)
+        {
+            auto const written = ::write(fd, bytes, size);
+            if (written < 0)
+            {
+                return false;
+            }
+            bytes += written;
+            size -= static_cast<std::size_t>(written);
+        }
+        return true;
+    }
+
+    static void handleSignal(int signal)
+    {
+        dumpInstalled();
+        if (signal != SIGUSR1 && signal != SIGUSR2)
+        {
+            std::signal(signal, SIG_DFL);
+            std::raise(signal);
+        }
+    }
+
+    std::vector<FlightRecord> mRecords;
+    std::atomic<std::size_t> mNumRecords{0};
+    IterationStats::SizeType mLastUsedKvBlocks{0};
+
+    inline static std::atomic<FlightRecorder const*> sInstalled{nullptr};
+    inline static std::array<char, 4096> sPath{};
+};
+
+} // namespace tensorrt_llm::batch_manager
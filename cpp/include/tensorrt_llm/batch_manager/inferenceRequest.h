@@ -54,6 +54,9 @@ auto constexpr kPresencePenaltyTensorName = "presence_penalty";
 auto constexpr kFrequencyPenaltyTensorName = "frequency_penalty";
 auto constexpr kRandomSeedTensorName = "random_seed";
 auto constexpr kReturnLogProbsTensorName = "return_log_probs";
+auto constexpr kReturnTimelineTensorName = "return_timeline";
+// [4] (int64) W3C trace context of the caller, see batch_manager::TraceContext
+auto constexpr kTraceContextTensorName = "trace_context";
 auto constexpr kPromptEmbeddingTableName = "prompt_embedding_table";
 auto constexpr kPromptVocabSizeName = "prompt_vocab_size";
 
@@ -67,6 +70,8 @@ auto constexpr kLogProbsTensorName = "output_log_probs";
 auto constexpr kCumLogProbsTensorName = "cum_log_probs";
 auto constexpr kContextLogitsName = "context_logits";
 auto constexpr kGenerationLogitsName = "generation_logits";
+// [numEvents, 2] of batch_manager::RequestTimelineEvent and microseconds since arrival, with the final response
+auto constexpr kRequestTimelineTensorName = "request_timeline";
 
 } // namespace inference_request
 
@@ -136,6 +141,8 @@ public:
         inference_request::kFrequencyPenaltyTensorName,
         inference_request::kRandomSeedTensorName,
         inference_request::kReturnLogProbsTensorName,
+        inference_request::kReturnTimelineTensorName,
+        inference_request::kTraceContextTensorName,
         inference_request::kPromptEmbeddingTableName,
         inference_request::kPromptVocabSizeName,
         // obsolete names for backward compatibility
@@ -193,6 +200,8 @@ public:
     TENSOR_GETTER_SETTER(FrequencyPenalty, inference_request::kFrequencyPenaltyTensorName)
     TENSOR_GETTER_SETTER(RandomSeed, inference_request::kRandomSeedTensorName)
     TENSOR_GETTER_SETTER(ReturnLogProbs, inference_request::kReturnLogProbsTensorName)
+    TENSOR_GETTER_SETTER(ReturnTimeline, inference_request::kReturnTimelineTensorName)
+    TENSOR_GETTER_SETTER(TraceContext, inference_request::kTraceContextTensorName)
     TENSOR_GETTER_SETTER(PromptEmbeddingTable, inference_request::kPromptEmbeddingTableName)
     TENSOR_GETTER_SETTER(PromptVocabSize, inference_request::kPromptVocabSizeName)
 
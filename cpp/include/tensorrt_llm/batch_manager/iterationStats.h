@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/common/commProfiler.h"
+#include "tensorrt_llm/common/spscRingBuffer.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/gpuMetricsStats.h"
+#include "tensorrt_llm/runtime/layerProfileStats.h"
+#include "tensorrt_llm/runtime/memoryCounters.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+/* Statistics of one iteration of the generation loop, the typed counterpart of the JSON string given to
+   ReturnBatchManagerStatsCallback. Filling it only copies integers, formatting is left to toJson. */
+struct IterationStats
+{
+    using SizeType = runtime::SizeType;
+    using Duration = std::chrono::microseconds;
+
+    int64_t iterationCounter{0};
+    std::chrono::system_clock::time_point timestamp{};
+
+    SizeType numActiveRequests{0};
+    SizeType maxNumRequests{0};
+    // Requests fetched but not scheduled yet
+    SizeType numQueuedRequests{0};
+    SizeType numScheduledRequests{0};
+    SizeType numContextRequests{0};
+    SizeType numGenerationRequests{0};
+    SizeType numPausedRequests{0};
+
+    SizeType numContextTokens{0};
+    SizeType numGenerationTokens{0};
+
+    // Copied from kv_cache_manager::KvCacheStats, zero without paged KV cache
+    SizeType maxNumKvBlocks{0};
+    SizeType freeNumKvBlocks{0};
+    SizeType usedNumKvBlocks{0};
+    SizeType tokensPerKvBlock{0};
+    // Blocks found in the cached blocks and blocks that were not since the start, zero unless addKvCacheStats is called
+    std::size_t reusedNumKvBlocks{0};
+    std::size_t newNumKvBlocks{0};
+
+    // Latency breakdown of the step
+    Duration fetchRequestsTime{0};
+    Duration scheduleTime{0};
+    Duration forwardTime{0};
+    Duration sendResponsesTime{0};
+
+    // Collectives of the step by kind, zero unless common::CommProfiler is enabled
+    common::CommIterationStats commStats{};
+
+    // Layers by kind over the enqueues of the step sampled by the layer profiler, zero unless addLayerProfile is called
+    runtime::LayerProfileStats layerProfile{};
+
+    // GPU hardware metrics by phase over the steps sampled by the runtime, zero unless addGpuMetrics is called
+    runtime::GpuMetricsStats gpuMetrics{};
+
+    // GPU memory allocated by each owner, indexed by runtime::MemoryTag
+    std::array<std::size_t, runtime::kNbMemoryTags> gpuMemoryByTag{};
+
+    // Stream-ordered memory pool of the GPU allocations, zero unless addMemoryPoolStats is called
+    std::size_t memoryPoolReserved{0};
+    std::size_t memoryPoolUsed{0};
+    std::size_t memoryPoolReleaseThreshold{0};
+    bool memoryPoolDedicated{false};
+
+    /* Counts the requests scheduled for this iteration and the tokens they process. */
+    template <typename TRequestList>
+    void addScheduledRequests(TRequestList const& requests)
+    {
+        for (auto const& request : requests)
+        {
+            ++numScheduledRequests;
+            if (request->mState == REQUEST_STATE_CONTEXT_INIT)
+            {
+                ++numContextRequests;
+                numContextTokens += request->mPromptLen;
+            }
+            else if (request->mState == REQUEST_STATE_GENERATION_IN_PROGRESS)
+            {
+                ++numGenerationRequests;
+                numGenerationTokens += request->mSamplingConfig.beamWidth;
+            }
+        }
+    }
+
+    /* Copies the stats of a kv_cache_manager::KVCacheManager, including the blocks reused since the start
+       (kv_cache_manager::getKvCacheReuseStats). */
+    template <typename TKvCacheManager>
+    void addKvCacheStats(TKvCacheManager const& manager)
+    {
+        auto const kvCacheStats = manager.getKvCacheStats();
+        maxNumKvBlocks = kvCacheStats.maxNumBlocks;
+        freeNumKvBlocks = kvCacheStats.freeNumBlocks;
+        usedNumKvBlocks = kvCacheStats.usedNumBlocks;
+        tokensPerKvBlock = kvCacheStats.toksPerBlock;
+        auto const reuseStats = getKvCacheReuseStats(manager);
+        reusedNumKvBlocks = reuseStats.reusedBlocks;
+        newNumKvBlocks = reuseStats.allocNewBlocks;
+    }
+
+    /* Adds the stats returned by common::CommProfiler::collect() once the forward pass is done. */
+    void addCommStats(std::vector<common::CommIterationStats> const& stats)
+    {
+        commStats.iteration = iterationCounter;
+        for (auto const& iterationStats : stats)
+        {
+            for (std::size_t op = 0; op < common::kNbCommOps; ++op)
+            {
+                commStats.ops[op].count += iterationStats.ops[op].count;
+                commStats.ops[op].bytes += iterationStats.ops[op].bytes;
+                commStats.ops[op].timeMs += iterationStats.ops[op].timeMs;
+            }
+        }
+    }
+
+    /* Adds the stats returned by collectLayerProfile() of the runtime once the forward pass is done. */
+    void addLayerProfile(runtime::LayerProfileStats const& stats)
+    {
+        layerProfile.add(stats);
+    }
+
+    /* Adds the stats returned by collectGpuMetrics() of the session once the forward pass is done. */
+    void addGpuMetrics(runtime::GpuMetricsStats const& stats)
+    {
+        gpuMetrics.add(stats);
+    }
+
+    /* Copies the GPU memory counted by runtime::MemoryCounters for each owner. */
+    void addMemoryStats()
+    {
+        for (std::size_t tag = 0; tag < runtime::kNbMemoryTags; ++tag)
+        {
+            gpuMemoryByTag[tag]
+                = runtime::MemoryCounters::getTagged(runtime::MemoryType::kGPU, static_cast<runtime::MemoryTag>(tag));
+        }
+    }
+
+    /* Copies the state and the settings of the memory pool of a runtime::BufferManager. */
+    template <typename TBufferManager>
+    void addMemoryPoolStats(TBufferManager const& manager)
+    {
+        memoryPoolReserved = manager.memoryPoolReserved();
+        memoryPoolUsed = manager.memoryPoolUsed();
+        memoryPoolReleaseThreshold = manager.memoryPoolReleaseThreshold();
+        memoryPoolDedicated = manager.hasDedicatedMemoryPool();
+    }
+
+    [[nodiscard]] Duration getStepTime() const
+    {
+        return fetchRequestsTime + scheduleTime + forwardTime + sendResponsesTime;
+    }
+};
+
+/* Formats stats with the keys of the JSON string given to ReturnBatchManagerStatsCallback, followed by the fields
+   the string does not have. */
+[[nodiscard]] inline std::string toJson(IterationStats const& stats)
+{
+    auto const time = std::chrono::system_clock::to_time_t(stats.timestamp);
+    std::tm tm{};
+    localtime_r(&time, &tm);
+    std::ostringstream ss;
+    ss << "{\"Timestamp\":\"" << std::put_time(&tm, "%m-%d-%Y %H:%M:%S") << "\""
+       << ",\"Iteration Counter\":" << stats.iterationCounter
+       << ",\"Active Request Count\":" << stats.numActiveRequests
+       << ",\"Max Request Count\":" << stats.maxNumRequests
+       << ",\"Max KV cache blocks\":" << stats.maxNumKvBlocks
+       << ",\"Free KV cache blocks\":" << stats.freeNumKvBlocks
+       << ",\"Used KV cache blocks\":" << stats.usedNumKvBlocks
+       << ",\"Tokens per KV cache block\":" << stats.tokensPerKvBlock
+       << ",\"Scheduled Requests\":" << stats.numScheduledRequests
+       << ",\"Context Requests\":" << stats.numContextRequests
+       << ",\"Generation Requests\":" << stats.numGenerationRequests
+       << ",\"Total Context Tokens\":" << stats.numContextTokens
+       << ",\"Total Generation Tokens\":" << stats.numGenerationTokens
+       << ",\"Queued Requests\":" << stats.numQueuedRequests
+       << ",\"Paused Requests\":" << stats.numPausedRequests
+       << ",\"Fetch Requests Time (us)\":" << stats.fetchRequestsTime.count()
+       << ",\"Schedule Time (us)\":" << stats.scheduleTime.count()
+       << ",\"Forward Time (us)\":" << stats.forwardTime.count()
+       << ",\"Send Responses Time (us)\":" << stats.sendResponsesTime.count()
+       << ",\"Reused KV cache blocks\":" << stats.reusedNumKvBlocks
+       << ",\"New KV cache blocks\":" << stats.newNumKvBlocks;
+    auto const toMicroseconds = [](float timeMs) { return static_cast<int64_t>(timeMs * 1000.F); };
+    auto const commTotal = stats.commStats.getTotal();
+    ss << ",\"Comm Time (us)\":" << toMicroseconds(commTotal.timeMs) << ",\"Comm Bytes\":" << commTotal.bytes;
+    for (std::size_t op = 0; op < common::kNbCommOps; ++op)
+    {
+        auto const& opStats = stats.commStats.ops[op];
+        if (opStats.count > 0)
+        {
+            auto const name = std::string{common::getCommOpName(static_cast<common::CommOp>(op))};
+            ss << ",\"" << name << " Count\":" << opStats.count << ",\"" << name << " Bytes\":" << opStats.bytes
+               << ",\"" << name << " Time (us)\":" << toMicroseconds(opStats.timeMs);
+        }
+    }
+    if (stats.layerProfile.numProfiledEnqueues > 0)
+    {
+        ss << ",\"Profiled Enqueues\":" << stats.layerProfile.numProfiledEnqueues;
+        for (std::size_t kind = 0; kind < runtime::kNbLayerKinds; ++kind)
+        {
+            ss << ",\"" << runtime::getLayerKindName(static_cast<runtime::LayerKind>(kind))
+               << " Layers Time (us)\":" << toMicroseconds(stats.layerProfile.kinds[kind].timeMs);
+        }
+    }
+    for (std::size_t phase = 0; phase < runtime::kNbGpuPhases; ++phase)
+    {
+        auto const& phaseMetrics = stats.gpuMetrics.phases[phase];
+        if (phaseMetrics.numSamples > 0)
+        {
+            auto const name = std::string{runtime::getGpuPhaseName(static_cast<runtime::GpuPhase>(phase))};
+            ss << ",\"" << name << " GPU Metrics Samples\":" << phaseMetrics.numSamples;
+            for (std::size_t metric = 0; metric < runtime::kNbGpuMetrics; ++metric)
+            {
+                auto const gpuMetric = static_cast<runtime::GpuMetric>(metric);
+                ss << ",\"" << name << " " << runtime::getGpuMetricName(gpuMetric)
+                   << " (%)\":" << phaseMetrics.getAverage(gpuMetric);
+            }
+        }
+    }
+    for (std::size_t tag = 0; tag < runtime::kNbMemoryTags; ++tag)
+    {
+        if (stats.gpuMemoryByTag[tag] > 0)
+        {
+            ss << ",\"" << runtime::getMemoryTagName(static_cast<runtime::MemoryTag>(tag))
+               << " GPU Memory (bytes)\":" << stats.gpuMemoryByTag[tag];
+        }
+    }
+    if (stats.memoryPoolReserved > 0)
+    {
+        ss << ",\"Memory Pool Reserved (bytes)\":" << stats.memoryPoolReserved
+           << ",\"Memory Pool Used (bytes)\":" << stats.memoryPoolUsed
+           << ",\"Memory Pool Release Threshold (bytes)\":" << stats.memoryPoolReleaseThreshold
+           << ",\"Memory Pool Dedicated\":" << (stats.memoryPoolDedicated ? "true" : "false");
+    }
+    ss << "}";
+    return ss.str();
+}
+
+/* Hands the stats of each iteration from the generation loop to one reader thread through a ring buffer.
+   push never blocks or allocates. When the reader falls behind by more than the capacity, the stats of the newer
+   iterations are dropped and counted. */
+class IterationStatsQueue
+{
+public:
+    explicit IterationStatsQueue(std::size_t capacity = 1024)
+        : mStats{capacity}
+    {
+    }
+
+    /* Called by the generation loop. */
+    void push(IterationStats const& stats)
+    {
+        if (!mStats.tryPush(stats))
+        {
+            mNumDropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /* Called by the reader, appends up to maxCount stats to out in iteration order. */
+    template <typename TContainer>
+    std::size_t popAll(TContainer& out, std::size_t maxCount = static_cast<std::size_t>(-1))
+    {
+        return mStats.popAll(out, maxCount);
+    }
+
+    [[nodiscard]] uint64_t getNumDropped() const
+    {
+        return mNumDropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    common::SpscRingBuffer<IterationStats> mStats;
+    std::atomic<uint64_t> mNumDropped{0};
+};
+
+} // namespace tensorrt_llm::batch_manager
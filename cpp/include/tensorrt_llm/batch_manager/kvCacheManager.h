@@ -82,6 +82,16 @@ struct KvCacheStats
     SizeType toksPerBlock;
 };
 
+// Block reuse counters since the start, see getKvCacheReuseStats. Kept apart from KvCacheStats, whose layout is fixed
+// by the prebuilt batch manager.
+struct KvCacheReuseStats
+{
+    // Blocks assigned to sequences, the ones not found in the cached blocks and the ones found there
+    std::size_t allocTotalBlocks{0};
+    std::size_t allocNewBlocks{0};
+    std::size_t reusedBlocks{0};
+};
+
 // Basic building block of a paged KV cache - a single
 // cache block. This class just holds metadata, no pointers
 // since it is reused across all layers.
@@ -301,6 +311,24 @@ public:
         return mTokensPerBlock;
     }
 
+    //! \brief Number of blocks assigned to sequences, reused or new.
+    [[nodiscard]] std::size_t getNumAllocTotalBlocks() const
+    {
+        return mAllocTotalBlocks;
+    }
+
+    //! \brief Number of blocks assigned to sequences that were not found in the cached blocks.
+    [[nodiscard]] std::size_t getNumAllocNewBlocks() const
+    {
+        return mAllocNewBlocks;
+    }
+
+    //! \brief Number of blocks assigned to sequences that were found in the cached blocks.
+    [[nodiscard]] std::size_t getNumReusedBlocks() const
+    {
+        return mReusedBlocks;
+    }
+
 private:
     //! \brief Add single block to beam of sequence and mAllocatedBlocksPerSeq.
     void addBlockToBeam(BlockPtr& block, GenerationRequest& sequence, SizeType beamIdx, SizeType seqSlotIdx);
@@ -492,4 +520,15 @@ private:
     // Whether to cache KV pages for reuse
     bool mEnableBlockReuse;
 };
+
+//! \brief Get the block reuse counters of a KV cache manager, read from its block manager in O(1).
+[[nodiscard]] inline KvCacheReuseStats getKvCacheReuseStats(KVCacheManager const& kvCacheManager)
+{
+    auto const& blockManager = kvCacheManager.getBlockManager();
+    KvCacheReuseStats reuseStats;
+    reuseStats.allocTotalBlocks = blockManager.getNumAllocTotalBlocks();
+    reuseStats.allocNewBlocks = blockManager.getNumAllocNewBlocks();
+    reuseStats.reusedBlocks = blockManager.getNumReusedBlocks();
+    return reuseStats;
+}
 } // namespace tensorrt_llm::batch_manager::kv_cache_manager
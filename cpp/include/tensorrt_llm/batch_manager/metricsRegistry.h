@@ -0,0 +1,407 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/batch_manager/iterationStats.h"
+#include "tensorrt_llm/common/assert.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+namespace detail
+{
+inline void atomicAdd(std::atomic<double>& target, double value)
+{
+    auto current = target.load(std::memory_order_relaxed);
+    while (!target.compare_exchange_weak(current, current + value, std::memory_order_relaxed))
+    {
+    }
+}
+} // namespace detail
+
+/* Monotonic value, e.g. a number of tokens. add is lock-free. */
+class MetricsCounter
+{
+public:
+    void add(double value = 1.0)
+    {
+        detail::atomicAdd(mValue, value);
+    }
+
+    /* For a count kept elsewhere, which must not decrease. */
+    void set(double value)
+    {
+        mValue.store(value, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] double get() const
+    {
+        return mValue.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<double> mValue{0.0};
+};
+
+/* Value that goes up and down, e.g. a number of active requests. set is lock-free. */
+class MetricsGauge
+{
+public:
+    void set(double value)
+    {
+        mValue.store(value, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] double get() const
+    {
+        return mValue.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<double> mValue{0.0};
+};
+
+/* Distribution of observations over fixed buckets given by their upper bounds. observe is lock-free. A reader
+   running concurrently with observe may see the count of a bucket and the sum of different observations. */
+class MetricsHistogram
+{
+public:
+    explicit MetricsHistogram(std::vector<double> bounds)
+        : mBounds{std::move(bounds)}
+        , mCounts(mBounds.size() + 1)
+    {
+        TLLM_CHECK_WITH_INFO(std::is_sorted(mBounds.begin(), mBounds.end()), "Histogram bounds must be sorted");
+    }
+
+    void observe(double value)
+    {
+        // The last bucket is +Inf
+        auto const bucket = std::lower_bound(mBounds.begin(), mBounds.end(), value) - mBounds.begin();
+        mCounts[bucket].fetch_add(1, std::memory_order_relaxed);
+        detail::atomicAdd(mSum, value);
+    }
+
+    [[nodiscard]] std::vector<double> const& getBounds() const
+    {
+        return mBounds;
+    }
+
+    /* Number of observations lower than or equal to the bound of each bucket, followed by the total count. */
+    [[nodiscard]] std::vector<uint64_t> getCumulativeCounts() const
+    {
+        std::vector<uint64_t> counts(mCounts.size());
+        uint64_t total = 0;
+        for (std::size_t bucket = 0; bucket < mCounts.size(); ++bucket)
+        {
+            total += mCounts[bucket].load(std::memory_order_relaxed);
+            counts[bucket] = total;
+        }
+        return counts;
+    }
+
+    [[nodiscard]] double getSum() const
+    {
+        return mSum.load(std::memory_order_relaxed);
+    }
+
+    /* count bounds from start, each factor times the previous one. */
+    [[nodiscard]] static std::vector<double> exponentialBounds(double start, double factor, std::size_t count)
+    {
+        std::vector<double> bounds;
+        for (auto bound = start; bounds.size() < count; bound *= factor)
+        {
+            bounds.push_back(bound);
+        }
+        return bounds;
+    }
+
+private:
+    std::vector<double> mBounds;
+    std::vector<std::atomic<uint64_t>> mCounts;
+    std::atomic<double> mSum{0.0};
+};
+
+/* Owns the metrics and formats them in the Prometheus text exposition format. The metrics are registered up front
+   and updated through the returned references without locking. Registering and formatting take a lock, so that a
+   scraper can format while the metrics are updated. Metrics with the same name form a family and are told apart by
+   their labels, e.g. `phase="forward"`. */
+class MetricsRegistry
+{
+public:
+    MetricsCounter& addCounter(std::string const& name, std::string const& help, std::string const& labels = {})
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto& family = getFamily(name, help, Type::kCOUNTER);
+        family.labels.push_back(labels);
+        return *family.counters.emplace_back(std::make_unique<MetricsCounter>());
+    }
+
+    MetricsGauge& addGauge(std::string const& name, std::string const& help, std::string const& labels = {})
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto& family = getFamily(name, help, Type::kGAUGE);
+        family.labels.push_back(labels);
+        return *family.gauges.emplace_back(std::make_unique<MetricsGauge>());
+    }
+
+    MetricsHistogram& addHistogram(std::string const& name, std::string const& help, std::vector<double> bounds,
+        std::string const& labels = {})
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto& family = getFamily(name, help, Type::kHISTOGRAM);
+        family.labels.push_back(labels);
+        return *family.histograms.emplace_back(std::make_unique<MetricsHistogram>(std::move(bounds)));
+    }
+
+    [[nodiscard]] std::string toPrometheus() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::ostringstream ss;
+        // Integers up to 1e15 are printed exactly
+        ss.precision(15);
+        auto const withLabels = [](std::string const& labels, std::string const& extra = {})
+        {
+            auto const all = labels.empty() || extra.empty() ? labels + extra : labels + "," + extra;
+            return all.empty() ? std::string{} : "{" + all + "}";
+        };
+        for (auto const& family : mFamilies)
+        {
+            ss << "# HELP " << family.name << " " << family.help << "\n";
+            ss << "# TYPE " << family.name << " " << getTypeName(family.type) << "\n";
+            for (std::size_t i = 0; i < family.labels.size(); ++i)
+            {
+                auto const& labels = family.labels[i];
+                if (family.type == Type::kCOUNTER)
+                {
+                    ss << family.name << withLabels(labels) << " " << family.counters[i]->get() << "\n";
+                }
+                else if (family.type == Type::kGAUGE)
+                {
+                    ss << family.name << withLabels(labels) << " " << family.gauges[i]->get() << "\n";
+                }
+                else
+                {
+                    auto const& histogram = *family.histograms[i];
+                    auto const& bounds = histogram.getBounds();
+                    auto const counts = histogram.getCumulativeCounts();
+                    for (std::size_t bucket = 0; bucket < bounds.size(); ++bucket)
+                    {
+                        std::ostringstream le;
+                        le.precision(15);
+                        le << "le=\"" << bounds[bucket] << "\"";
+                        ss << family.name << "_bucket" << withLabels(labels, le.str()) << " " << counts[bucket]
+                           << "\n";
+                    }
+                    ss << family.name << "_bucket" << withLabels(labels, "le=\"+Inf\"") << " " << counts.back()
+                       << "\n";
+                    ss << family.name << "_sum" << withLabels(labels) << " " << histogram.getSum() << "\n";
+                    ss << family.name << "_count" << withLabels(labels) << " " << counts.back() << "\n";
+                }
+            }
+        }
+        return ss.str();
+    }
+
+    /* Writes toPrometheus() to a temporary file renamed to path, so that a reader, e.g. the textfile collector of the
+       node exporter, never sees a partial file. */
+    void writeTextFile(std::string const& path) const
+    {
+        auto const tmpPath = path + ".tmp";
+        {
+            std::ofstream file(tmpPath, std::ios::trunc);
+            TLLM_CHECK_WITH_INFO(file.good(), "Cannot open " + tmpPath);
+            file << toPrometheus();
+        }
+        TLLM_CHECK_WITH_INFO(std::rename(tmpPath.c_str(), path.c_str()) == 0, "Cannot rename " + tmpPath);
+    }
+
+private:
+    enum class Type
+    {
+        kCOUNTER,
+        kGAUGE,
+        kHISTOGRAM
+    };
+
+    struct Family
+    {
+        std::string name;
+        std::string help;
+        Type type;
+        std::vector<std::string> labels;
+        std::vector<std::unique_ptr<MetricsCounter>> counters;
+        std::vector<std::unique_ptr<MetricsGauge>> gauges;
+        std::vector<std::unique_ptr<MetricsHistogram>> histograms;
+    };
+
+    static char const* getTypeName(Type type)
+    {
+        switch (type)
+        {
+        case Type::kCOUNTER: return "counter";
+        case Type::kGAUGE: return "gauge";
+        case Type::kHISTOGRAM: return "histogram";
+        }
+        return "untyped";
+    }
+
+    Family& getFamily(std::string const& name, std::string const& help, Type type)
+    {
+        auto it = std::find_if(
+            mFamilies.begin(), mFamilies.end(), [&name](Family const& family) { return family.name == name; });
+        if (it == mFamilies.end())
+        {
+            return mFamilies.emplace_back(Family{name, help, type, {}, {}, {}, {}});
+        }
+        TLLM_CHECK_WITH_INFO(it->type == type, "Metric " + name + " is registered with another type");
+        return *it;
+    }
+
+    mutable std::mutex mMutex;
+    std::vector<Family> mFamilies;
+};
+
+/* Metrics of the batch manager built from the IterationStats of each iteration, under the tensorrt_llm_ prefix.
+   record is called by the generation loop and never locks, toPrometheus or writeTextFile of getRegistry() can be
+   called from any other thread. */
+class BatchManagerMetrics
+{
+public:
+    BatchManagerMetrics()
+        : mIterations{mRegistry.addCounter("tensorrt_llm_iterations_total", "Iterations of the generation loop.")}
+        , mIterationLatency{mRegistry.addHistogram("tensorrt_llm_iteration_latency_seconds",
+              "Duration of an iteration of the generation loop.", MetricsHistogram::exponentialBounds(1e-3, 2.0, 14))}
+        , mFetchRequestsLatency{addPhaseHistogram("fetch_requests")}
+        , mScheduleLatency{addPhaseHistogram("schedule")}
+        , mForwardLatency{addPhaseHistogram("forward")}
+        , mSendResponsesLatency{addPhaseHistogram("send_responses")}
+        , mActiveRequests{mRegistry.addGauge("tensorrt_llm_active_requests", "Requests in flight.")}
+        , mMaxRequests{mRegistry.addGauge("tensorrt_llm_max_requests", "Maximum number of requests in flight.")}
+        , mQueuedRequests{mRegistry.addGauge("tensorrt_llm_queued_requests", "Requests fetched but not scheduled yet.")}
+        , mScheduledRequests{
+              mRegistry.addGauge("tensorrt_llm_scheduled_requests", "Requests of the last iteration.", "phase=\"all\"")}
+        , mContextRequests{mRegistry.addGauge(
+              "tensorrt_llm_scheduled_requests", "Requests of the last iteration.", "phase=\"context\"")}
+        , mGenerationRequests{mRegistry.addGauge(
+              "tensorrt_llm_scheduled_requests", "Requests of the last iteration.", "phase=\"generation\"")}
+        , mPausedRequests{mRegistry.addGauge("tensorrt_llm_paused_requests", "Requests paused in the last iteration.")}
+        , mContextTokens{
+              mRegistry.addCounter("tensorrt_llm_tokens_total", "Tokens processed by the engine.", "phase=\"context\"")}
+        , mGenerationTokens{mRegistry.addCounter(
+              "tensorrt_llm_tokens_total", "Tokens processed by the engine.", "phase=\"generation\"")}
+        , mTokensPerSecond{mRegistry.addGauge(
+              "tensorrt_llm_tokens_per_second", "Tokens over the duration of the last iteration.")}
+        , mUsedKvBlocks{mRegistry.addGauge("tensorrt_llm_kv_cache_blocks", "Blocks of the KV cache.", "state=\"used\"")}
+        , mFreeKvBlocks{mRegistry.addGauge("tensorrt_llm_kv_cache_blocks", "Blocks of the KV cache.", "state=\"free\"")}
+        , mMaxKvBlocks{mRegistry.addGauge("tensorrt_llm_kv_cache_blocks", "Blocks of the KV cache.", "state=\"max\"")}
+        , mReusedKvBlocks{mRegistry.addCounter(
+              "tensorrt_llm_kv_cache_reused_blocks_total", "Blocks of the KV cache found in the cached blocks.")}
+        , mNewKvBlocks{mRegistry.addCounter(
+              "tensorrt_llm_kv_cache_new_blocks_total", "Blocks of the KV cache not found in the cached blocks.")}
+    {
+    }
+
+    void record(IterationStats const& stats)
+    {
+        auto const toSeconds = [](IterationStats::Duration duration)
+        { return std::chrono::duration<double>(duration).count(); };
+
+        mIterations.add();
+        auto const stepTime = toSeconds(stats.getStepTime());
+        mIterationLatency.observe(stepTime);
+        mFetchRequestsLatency.observe(toSeconds(stats.fetchRequestsTime));
+        mScheduleLatency.observe(toSeconds(stats.scheduleTime));
+        mForwardLatency.observe(toSeconds(stats.forwardTime));
+        mSendResponsesLatency.observe(toSeconds(stats.sendResponsesTime));
+
+        mActiveRequests.set(stats.numActiveRequests);
+        mMaxRequests.set(stats.maxNumRequests);
+        mQueuedRequests.set(stats.numQueuedRequests);
+        mScheduledRequests.set(stats.numScheduledRequests);
+        mContextRequests.set(stats.numContextRequests);
+        mGenerationRequests.set(stats.numGenerationRequests);
+        mPausedRequests.set(stats.numPausedRequests);
+
+        mContextTokens.add(stats.numContextTokens);
+        mGenerationTokens.add(stats.numGenerationTokens);
+        auto const numTokens = stats.numContextTokens + stats.numGenerationTokens;
+        mTokensPerSecond.set(stepTime > 0.0 ? numTokens / stepTime : 0.0);
+
+        mUsedKvBlocks.set(stats.usedNumKvBlocks);
+        mFreeKvBlocks.set(stats.freeNumKvBlocks);
+        mMaxKvBlocks.set(stats.maxNumKvBlocks);
+        mReusedKvBlocks.set(static_cast<double>(stats.reusedNumKvBlocks));
+        mNewKvBlocks.set(static_cast<double>(stats.newNumKvBlocks));
+    }
+
+    [[nodiscard]] MetricsRegistry& getRegistry()
+    {
+        return mRegistry;
+    }
+
+    [[nodiscard]] MetricsRegistry const& getRegistry() const
+    {
+        return mRegistry;
+    }
+
+private:
+    MetricsHistogram& addPhaseHistogram(std::string const& phase)
+    {
+        return mRegistry.addHistogram("tensorrt_llm_phase_latency_seconds", "Duration of a phase of an iteration.",
+            MetricsHistogram::exponentialBounds(1e-4, 2.0, 18), "phase=\"" + phase + "\"");
+    }
+
+    // Declared first, the metrics below refer to it
+    MetricsRegistry mRegistry;
+
+    MetricsCounter& mIterations;
+    MetricsHistogram& mIterationLatency;
+    MetricsHistogram& mFetchRequestsLatency;
+    MetricsHistogram& mScheduleLatency;
+    MetricsHistogram& mForwardLatency;
+    MetricsHistogram& mSendResponsesLatency;
+    MetricsGauge& mActiveRequests;
+    MetricsGauge& mMaxRequests;
+    MetricsGauge& mQueuedRequests;
+    MetricsGauge& mScheduledRequests;
+    MetricsGauge& mContextRequests;
+    MetricsGauge& mGenerationRequests;
+    MetricsGauge& mPausedRequests;
+    MetricsCounter& mContextTokens;
+    MetricsCounter& mGenerationTokens;
+    MetricsGauge& mTokensPerSecond;
+    MetricsGauge& mUsedKvBlocks;
+    MetricsGauge& mFreeKvBlocks;
+    MetricsGauge& mMaxKvBlocks;
+    MetricsCounter& mReusedKvBlocks;
+    MetricsCounter& mNewKvBlocks;
+};
+
+} // namespace tensorrt_llm::batch_manager
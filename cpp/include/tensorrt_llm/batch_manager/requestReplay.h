@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/callbacks.h"
+#include "tensorrt_llm/batch_manager/inferenceRequest.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+/* Layout of a recording, a sequence of int64 values: kReplayMagic, kReplayVersion, then for each iteration that
+   fetched requests or polled stop signals its index (the number of fetches before it), the number of requests, the
+   number of stop signals, each request as its size and its InferenceRequest::serialize values, and the ids to stop.
+   The iterations without either are not written. */
+std::int64_t constexpr kReplayMagic = 0x594c50524d4c4c54; // "TLLMRPLY" in little endian
+std::int64_t constexpr kReplayVersion = 1;
+
+/* Records the requests the batch manager fetches and the stop signals it polls, with the iteration of its generation
+   loop they were returned in, so that RequestReplayer can feed them back with the same alignment: the batches of a
+   slow interval of production can then be rerun under a profiler. The GptManager calls the request callback once per
+   iteration, the fetches are counted as iterations. Each iteration that returned something is written and flushed
+   before the callback returns, so a recording survives a crash of the server. */
+class RequestRecorder
+{
+public:
+    explicit RequestRecorder(std::filesystem::path const& path)
+        : mFile{path, std::ios::binary | std::ios::trunc}
+    {
+        TLLM_CHECK_WITH_INFO(mFile.is_open(), "Cannot open the request recording %s", path.c_str());
+        write({kReplayMagic, kReplayVersion});
+        mFile.flush();
+    }
+
+    RequestRecorder(RequestRecorder const&) = delete;
+    RequestRecorder& operator=(RequestRecorder const&) = delete;
+
+    /* Records the requests returned by the fetch of an iteration, then moves to the next iteration. */
+    void recordRequests(std::list<std::shared_ptr<InferenceRequest>> const& requests)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!requests.empty())
+        {
+            write({mIteration, static_cast<std::int64_t>(requests.size()), 0});
+            for (auto const& request : requests)
+            {
+                auto const packed = request->serialize();
+                write({static_cast<std::int64_t>(packed.size())});
+                write(packed);
+            }
+            mFile.flush();
+        }
+        ++mIteration;
+    }
+
+    /* Records the ids to stop polled in the current iteration. */
+    void recordStopSignals(std::unordered_set<uint64_t> const& requestIds)
+    {
+        if (requestIds.empty())
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        write({mIteration, 0, static_cast<std::int64_t>(requestIds.size())});
+        for (auto const requestId : requestIds)
+        {
+            write({static_cast<std::int64_t>(requestId)});
+        }
+        mFile.flush();
+    }
+
+    /* Returns a callback for the GptManager that records what getInferenceRequestsCb returns. */
+    [[nodiscard]] GetInferenceRequestsCallback wrapInferenceRequestsCallback(
+        GetInferenceRequestsCallback getInferenceRequestsCb)
+    {
+        return [this, cb = std::move(getInferenceRequestsCb)](int32_t maxNumRequests)
+        {
+            auto requests = cb(maxNumRequests);
+            recordRequests(requests);
+            return requests;
+        };
+    }
+
+    /* Returns a callback for the GptManager that records what pollStopSignalCb returns. */
+    [[nodiscard]] PollStopSignalCallback wrapPollStopSignalCallback(PollStopSignalCallback pollStopSignalCb)
+    {
+        return [this, cb = std::move(pollStopSignalCb)]()
+        {
+            auto requestIds = cb();
+            recordStopSignals(requestIds);
+            return requestIds;
+        };
+    }
+
+private:
+    void write(std::vector<std::int64_t> const& values)
+    {
+        mFile.write(reinterpret_cast<char const*>(values.data()),
+            static_cast<std::streamsize>(values.size() * sizeof(std::int64_t)));
+    }
+
+    std::mutex mMutex;
+    std::ofstream mFile;
+    std::int64_t mIteration{0};
+};
+
+/* Feeds a recording of RequestRecorder back to a GptManager: the requests are returned by the fetch of the iteration
+   they were recorded in, and the stop signals by the poll of their iteration. The batches are the same as long as the
+   engine, the config of the batch manager and the outputs are the same. When the batch manager asks for fewer
+   requests than were recorded in an iteration, the others are returned by the next fetches and the replay is no
+   longer aligned. */
+class RequestReplayer
+{
+public:
+    explicit RequestReplayer(std::filesystem::path const& path)
+    {
+        std::ifstream file{path, std::ios::binary | std::ios::ate};
+        TLLM_CHECK_WITH_INFO(file.is_open(), "Cannot open the request recording %s", path.c_str());
+        std::vector<std::int64_t> values(static_cast<std::size_t>(file.tellg()) / sizeof(std::int64_t));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(values.data()),
+            static_cast<std::streamsize>(values.size() * sizeof(std::int64_t)));
+        TLLM_CHECK_WITH_INFO(values.size() >= 2 && values[0] == kReplayMagic && values[1] == kReplayVersion,
+            "%s is not a request recording of version %ld", path.c_str(), kReplayVersion);
+
+        auto const* it = values.data() + 2;
+        auto const* const end = values.data() + values.size();
+        auto const remaining = [&it, end] { return static_cast<std::int64_t>(end - it); };
+        // A crash of the recorded server can leave the last iteration incomplete, it is skipped
+        auto truncated = false;
+        while (remaining() > 0)
+        {
+            truncated = remaining() < 3;
+            if (truncated)
+            {
+                break;
+            }
+            Iteration iteration;
+            iteration.index = it[0];
+            auto const numRequests = it[1];
+            auto const numStopSignals = it[2];
+            it += 3;
+            for (std::int64_t i = 0; i < numRequests && !truncated; ++i)
+            {
+                truncated = remaining() < 1 || remaining() <= *it;
+                if (!truncated)
+                {
+                    auto const size = *it++;
+                    auto request = InferenceRequest::deserialize(it);
+                    it += size;
+                    iteration.requests.push_back(std::move(request));
+                }
+            }
+            truncated = truncated || remaining() < numStopSignals;
+            if (truncated)
+            {
+                break;
+            }
+            for (std::int64_t i = 0; i < numStopSignals; ++i)
+            {
+                iteration.stopSignals.insert(static_cast<uint64_t>(*it++));
+            }
+            for (auto const& request : iteration.requests)
+            {
+                mMaxRequestId = std::max(mMaxRequestId, request->getRequestId());
+            }
+            mNumRequests += iteration.requests.size();
+            mIterations.push_back(std::move(iteration));
+        }
+        if (truncated)
+        {
+            TLLM_LOG_WARNING("The last iteration of the request recording %s is truncated, it is not replayed",
+                path.c_str());
+        }
+    }
+
+    RequestReplayer(RequestReplayer const&) = delete;
+    RequestReplayer& operator=(RequestReplayer const&) = delete;
+
+    /* Returns the requests recorded in the current iteration, then moves to the next iteration. */
+    std::list<std::shared_ptr<InferenceRequest>> getRequests(int32_t maxNumRequests)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::list<std::shared_ptr<InferenceRequest>> requests;
+        // Requests that did not fit in the previous fetches come first
+        for (auto it = mIterations.begin(); it != mIterations.end() && it->index <= mIteration;)
+        {
+            while (!it->requests.empty() && static_cast<int32_t>(requests.size()) < maxNumRequests)
+            {
+                requests.push_back(std::move(it->requests.front()));
+                it->requests.pop_front();
+            }
+            if (!it->requests.empty() && !mDiverged)
+            {
+                TLLM_LOG_WARNING("The batch manager fetched %d requests in iteration %ld, fewer than recorded: the "
+                                 "replay is no longer aligned with the recording",
+                    maxNumRequests, mIteration);
+                mDiverged = true;
+            }
+            it = it->requests.empty() && it->stopSignals.empty() ? mIterations.erase(it) : std::next(it);
+        }
+        mNumReplayed += requests.size();
+        ++mIteration;
+        return requests;
+    }
+
+    /* Returns the ids to stop recorded in the current iteration. */
+    std::unordered_set<uint64_t> getStopSignals()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::unordered_set<uint64_t> requestIds;
+        for (auto it = mIterations.begin(); it != mIterations.end() && it->index <= mIteration;)
+        {
+            requestIds.merge(it->stopSignals);
+            it->stopSignals.clear();
+            it = it->requests.empty() ? mIterations.erase(it) : std::next(it);
+        }
+        return requestIds;
+    }
+
+    [[nodiscard]] GetInferenceRequestsCallback getInferenceRequestsCallback()
+    {
+        return [this](int32_t maxNumRequests) { return getRequests(maxNumRequests); };
+    }
+
+    [[nodiscard]] PollStopSignalCallback pollStopSignalCallback()
+    {
+        return [this]() { return getStopSignals(); };
+    }
+
+    /* Whether all the requests and stop signals were returned. */
+    [[nodiscard]] bool isDone() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mIterations.empty();
+    }
+
+    [[nodiscard]] std::size_t getNumRequests() const
+    {
+        return mNumRequests;
+    }
+
+    [[nodiscard]] std::size_t getNumReplayed() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mNumReplayed;
+    }
+
+    [[nodiscard]] uint64_t getMaxRequestId() const
+    {
+        return mMaxRequestId;
+    }
+
+private:
+    struct Iteration
+    {
+        std::int64_t index{0};
+        std::deque<std::shared_ptr<InferenceRequest>> requests;
+        std::unordered_set<uint64_t> stopSignals;
+    };
+
+    mutable std::mutex mMutex;
+    // Iterations still to return, in order
+    std::list<Iteration> mIterations;
+    std::size_t mNumRequests{0};
+    std::size_t mNumReplayed{0};
+    uint64_t mMaxRequestId{0};
+    std::int64_t mIteration{0};
+    bool mDiverged{false};
+};
+
+} // namespace tensorrt_llm::batch_manager
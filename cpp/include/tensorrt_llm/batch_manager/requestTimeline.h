@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+enum class RequestTimelineEvent : std::int64_t
+{
+    kArrival = 0,
+    kScheduled = 1,
+    kFirstToken = 2,
+    kCompletion = 3
+};
+
+/// @brief Monotonic timestamps of the life of a request, to attribute its latency to queueing, the first token and
+/// decode.
+struct RequestTimeline
+{
+    using Clock = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
+    TimePoint arrival{Clock::now()};
+    // Handed to the batch manager
+    std::optional<TimePoint> scheduled;
+    // First response, which is the final one for a request that is not streamed
+    std::optional<TimePoint> firstToken;
+    std::optional<TimePoint> completion;
+
+    /// @brief Get the events in the order they happened
+    /// @return The events with their time since arrival in microseconds
+    [[nodiscard]] std::vector<std::pair<RequestTimelineEvent, std::int64_t>> getEvents() const
+    {
+        auto const sinceArrival = [this](TimePoint time)
+        { return std::chrono::duration_cast<std::chrono::microseconds>(time - arrival).count(); };
+        std::vector<std::pair<RequestTimelineEvent, std::int64_t>> events{{RequestTimelineEvent::kArrival, 0}};
+        auto const addEvent = [&](RequestTimelineEvent event, std::optional<TimePoint> const& time)
+        {
+            if (time)
+            {
+                events.emplace_back(event, sinceArrival(*time));
+            }
+        };
+        addEvent(RequestTimelineEvent::kScheduled, scheduled);
+        addEvent(RequestTimelineEvent::kFirstToken, firstToken);
+        addEvent(RequestTimelineEvent::kCompletion, completion);
+        std::stable_sort(events.begin(), events.end(),
+            [](auto const& lhs, auto const& rhs) { return lhs.second < rhs.second; });
+        return events;
+    }
+
+    /// @brief Get the timeline for the response, see inference_request::kRequestTimelineTensorName
+    /// @return A host tensor [numEvents, 2] of RequestTimelineEvent and microseconds since arrival
+    [[nodiscard]] runtime::ITensor::SharedPtr toTensor() const
+    {
+        auto const events = getEvents();
+        auto const numEvents = static_cast<runtime::SizeType>(events.size());
+        auto timeline
+            = runtime::BufferManager::cpu(runtime::ITensor::makeShape({numEvents, 2}), nvinfer1::DataType::kINT64);
+        auto* timelinePtr = runtime::bufferCast<std::int64_t>(*timeline);
+        for (runtime::SizeType i = 0; i < numEvents; ++i)
+        {
+            timelinePtr[2 * i] = static_cast<std::int64_t>(events[i].first);
+            timelinePtr[2 * i + 1] = events[i].second;
+        }
+        return timeline;
+    }
+};
+
+/// @brief Timelines of the requests being served, keyed by request id.
+///
+/// The batch manager ships prebuilt and its LlmRequest layout is fixed, so the timelines are kept next to it by the
+/// code that feeds the batch manager and receives its responses, e.g. the callbacks of the Python GptManager. Only the
+/// requests added with add() are tracked, the others cost a lookup.
+class RequestTimelines
+{
+public:
+    using RequestIdType = std::uint64_t;
+
+    /// @brief Start the timeline of a request that arrived at time arrival
+    void add(RequestIdType requestId, RequestTimeline::TimePoint arrival = RequestTimeline::Clock::now())
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTimelines[requestId].arrival = arrival;
+    }
+
+    [[nodiscard]] bool contains(RequestIdType requestId) const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mTimelines.find(requestId) != mTimelines.end();
+    }
+
+    /// @brief Record that the request was handed to the batch manager
+    void recordScheduled(RequestIdType requestId)
+    {
+        auto const now = RequestTimeline::Clock::now();
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (auto it = mTimelines.find(requestId); it != mTimelines.end() && !it->second.scheduled)
+        {
+            it->second.scheduled = now;
+        }
+    }
+
+    /// @brief Record a response of the request, the final one completes it
+    void recordResponse(RequestIdType requestId, bool isFinal)
+    {
+        auto const now = RequestTimeline::Clock::now();
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (auto it = mTimelines.find(requestId); it != mTimelines.end())
+        {
+            auto& timeline = it->second;
+            if (!timeline.firstToken)
+            {
+                timeline.firstToken = now;
+            }
+            if (isFinal)
+            {
+                timeline.completion = now;
+            }
+        }
+    }
+
+    /// @brief Remove the timeline of a request, once its final response was recorded
+    [[nodiscard]] std::optional<RequestTimeline> take(RequestIdType requestId)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mTimelines.find(requestId);
+        if (it == mTimelines.end())
+        {
+            return std::nullopt;
+        }
+        auto timeline = std::move(it->second);
+        mTimelines.erase(it);
+        return timeline;
+    }
+
+    [[nodiscard]] std::size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mTimelines.size();
+    }
+
+private:
+    mutable std::mutex mMutex;
+    std::unordered_map<RequestIdType, RequestTimeline> mTimelines;
+};
+
+} // namespace tensorrt_llm::batch_manager
@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/batch_manager/requestTimeline.h"
+#include "tensorrt_llm/batch_manager/traceContext.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace tensorrt_llm::batch_manager
+{
+
+/* One span of the trace of a request, with the fields of an OpenTelemetry span. */
+struct TraceSpan
+{
+    using AttributeValue = std::variant<std::int64_t, double>;
+
+    std::uint64_t traceIdHigh{0};
+    std::uint64_t traceIdLow{0};
+    std::uint64_t spanId{0};
+    std::uint64_t parentSpanId{0};
+    std::string name;
+    std::int64_t startTimeUnixNano{0};
+    std::int64_t endTimeUnixNano{0};
+    std::vector<std::pair<std::string, AttributeValue>> attributes;
+};
+
+/* Formats spans as an OTLP/JSON ExportTraceServiceRequest, the body of a POST to the /v1/traces endpoint of an
+   OpenTelemetry collector, and the line format of its file receiver. */
+[[nodiscard]] inline std::string toOtlpJson(
+    std::vector<TraceSpan> const& spans, std::string const& serviceName = "tensorrt_llm")
+{
+    auto const hex = [](std::uint64_t value)
+    {
+        char digits[17];
+        std::snprintf(digits, sizeof(digits), "%016llx", static_cast<unsigned long long>(value));
+        return std::string{digits};
+    };
+    std::ostringstream ss;
+    ss << "{\"resourceSpans\":[{\"resource\":{\"attributes\":[{\"key\":\"service.name\",\"value\":{\"stringValue\":\"";
+    for (auto const c : serviceName)
+    {
+        ss << (c == '"' || c == '\\' ? "\\" : "") << c;
+    }
+    ss << "\"}}]},\"scopeSpans\":[{\"scope\":{\"name\":\"tensorrt_llm.batch_manager\"},\"spans\":[";
+    for (std::size_t i = 0; i < spans.size(); ++i)
+    {
+        auto const& span = spans[i];
+        ss << (i > 0 ? "," : "") << "{\"traceId\":\"" << hex(span.traceIdHigh) << hex(span.traceIdLow)
+           << "\",\"spanId\":\"" << hex(span.spanId) << "\",\"parentSpanId\":\"" << hex(span.parentSpanId)
+           << "\",\"name\":\"" << span.name << "\",\"kind\":1,\"startTimeUnixNano\":\"" << span.startTimeUnixNano
+           << "\",\"endTimeUnixNano\":\"" << span.endTimeUnixNano << "\",\"attributes\":[";
+        for (std::size_t j = 0; j < span.attributes.size(); ++j)
+        {
+            auto const& [key, value] = span.attributes[j];
+            ss << (j > 0 ? "," : "") << "{\"key\":\"" << key << "\",\"value\":{";
+            if (auto const* intValue = std::get_if<std::int64_t>(&value))
+            {
+                // 64-bit integers are strings in the JSON mapping of protobuf
+                ss << "\"intValue\":\"" << *intValue << "\"}}";
+            }
+            else
+            {
+                ss << "\"doubleValue\":" << std::get<double>(value) << "}}";
+            }
+        }
+        ss << "]}";
+    }
+    ss << "]}]}]}";
+    return ss.str();
+}
+
+/* Records the spans of the requests that carry a sampled trace context and hands them in batches to an exporter on a
+   background thread, so that a slow request can be looked into from the trace of the caller without profiling the
+   whole server. Each traced request gets a span from its arrival to its completion, child of the span of the caller,
+   and child spans for the queueing, the wait for the first token and the generation of the others, built from its
+   RequestTimeline. The batch manager ships prebuilt, so the contexts are kept here by request id: startRequest is
+   called where the requests enter, e.g. the callbacks of the Python GptManager, and endRequest with their final
+   response. When the exporter falls behind, the spans past maxQueueSize are dropped and counted. */
+class RequestTracer
+{
+public:
+    using Exporter = std::function<void(std::vector<TraceSpan> const& spans)>;
+    using RequestIdType = std::uint64_t;
+
+    explicit RequestTracer(Exporter exporter, std::size_t maxBatchSize = 512,
+        std::chrono::milliseconds exportInterval = std::chrono::milliseconds{1000}, std::size_t maxQueueSize = 16384)
+        : mExporter{std::move(exporter)}
+        , mMaxBatchSize{std::max<std::size_t>(maxBatchSize, 1)}
+        , mExportInterval{exportInterval}
+        , mMaxQueueSize{maxQueueSize}
+        , mRandom{std::random_device{}()}
+        , mThread{&RequestTracer::exportLoop, this}
+    {
+    }
+
+    RequestTracer(RequestTracer const&) = delete;
+    RequestTracer& operator=(RequestTracer const&) = delete;
+
+    /* Exports the pending spans and stops the export thread. */
+    ~RequestTracer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+        mCondition.notify_all();
+        mThread.join();
+    }
+
+    /* Starts tracing a request if its context is valid and sampled, returns whether it is traced. */
+    bool startRequest(RequestIdType requestId, TraceContext const& context, std::int64_t promptLen = 0,
+        std::int64_t beamWidth = 1)
+    {
+        if (!context.isValid() || !context.isSampled())
+        {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRequests[requestId] = TracedRequest{context, promptLen, beamWidth};
+        return true;
+    }
+
+    [[nodiscard]] bool isTraced(RequestIdType requestId) const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mRequests.find(requestId) != mRequests.end();
+    }
+
+    /* Records the spans of a traced request once it is complete, or failed, and queues them for export. */
+    void endRequest(RequestIdType requestId, RequestTimeline const& timeline, bool failed = false)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        auto const it = mRequests.find(requestId);
+        if (it == mRequests.end())
+        {
+            return;
+        }
+        auto const request = it->second;
+        mRequests.erase(it);
+        lock.unlock();
+
+        auto spans = makeSpans(requestId, request, timeline, failed);
+
+        lock.lock();
+        for (auto& span : spans)
+        {
+            if (mQueue.size() >= mMaxQueueSize)
+            {
+                ++mNumDropped;
+                continue;
+            }
+            mQueue.push_back(std::move(span));
+            ++mNumQueued;
+        }
+        lock.unlock();
+        mCondition.notify_all();
+    }
+
+    /* Blocks until the spans queued before the call are exported. */
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        auto const target = mNumQueued;
+        mFlushTarget = std::max(mFlushTarget, target);
+        mCondition.notify_all();
+        mCondition.wait(lock, [this, target] { return mNumExported >= target; });
+    }
+
+    [[nodiscard]] std::size_t getNumDropped() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mNumDropped;
+    }
+
+    /* Appends each batch to path as one line of OTLP/JSON, the format read by the otlpjsonfile receiver of the
+       OpenTelemetry collector. */
+    [[nodiscard]] static Exporter fileExporter(std::string const& path, std::string serviceName = "tensorrt_llm")
+    {
+        auto file = std::make_shared<std::ofstream>(path, std::ios::app);
+        TLLM_CHECK_WITH_INFO(file->is_open(), "Cannot open the trace file " + path);
+        return [file, serviceName = std::move(serviceName)](std::vector<TraceSpan> const& spans)
+        { *file << toOtlpJson(spans, serviceName) << std::endl; };
+    }
+
+private:
+    struct TracedRequest
+    {
+        TraceContext context;
+        std::int64_t promptLen;
+        std::int64_t beamWidth;
+    };
+
+    std::vector<TraceSpan> makeSpans(
+        RequestIdType requestId, TracedRequest const& request, RequestTimeline const& timeline, bool failed)
+    {
+        using Clock = RequestTimeline::Clock;
+        auto const& context = request.context;
+        // The timeline is monotonic, the spans are in the time of the system clock like the ones of the caller
+        auto const now = Clock::now();
+        auto const nowUnixNano = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch())
+                                     .count();
+        auto const toUnixNano = [now, nowUnixNano](Clock::time_point time)
+        { return nowUnixNano - std::chrono::duration_cast<std::chrono::nanoseconds>(now - time).count(); };
+        auto const end = timeline.completion.value_or(now);
+
+        std::vector<TraceSpan> spans;
+        auto const addSpan = [&](std::uint64_t parentSpanId, char const* name, Clock::time_point start,
+                                 Clock::time_point stop) -> TraceSpan&
+        {
+            auto& span = spans.emplace_back();
+            span.traceIdHigh = context.traceIdHigh;
+            span.traceIdLow = context.traceIdLow;
+            span.spanId = newSpanId();
+            span.parentSpanId = parentSpanId;
+            span.name = name;
+            span.startTimeUnixNano = toUnixNano(start);
+            span.endTimeUnixNano = toUnixNano(std::max(start, stop));
+            return span;
+        };
+
+        auto& root = addSpan(context.spanId, "llm_request", timeline.arrival, end);
+        auto const rootSpanId = root.spanId;
+        root.attributes = {{"request_id", static_cast<std::int64_t>(requestId)}, {"prompt_tokens", request.promptLen},
+            {"beam_width", request.beamWidth}, {"failed", std::int64_t{failed}}};
+        if (!timeline.scheduled)
+        {
+            addSpan(rootSpanId, "queue", timeline.arrival, end);
+            return spans;
+        }
+        addSpan(rootSpanId, "queue", timeline.arrival, *timeline.scheduled);
+        addSpan(rootSpanId, "first_token", *timeline.scheduled, timeline.firstToken.value_or(end));
+        if (timeline.firstToken)
+        {
+            addSpan(rootSpanId, "generation", *timeline.firstToken, end);
+        }
+        return spans;
+    }
+
+    std::uint64_t newSpanId()
+    {
+        std::uint64_t spanId{0};
+        while (spanId == 0)
+        {
+            spanId = mRandom();
+        }
+        return spanId;
+    }
+
+    void exportLoop()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (true)
+        {
+            mCondition.wait_for(lock, mExportInterval,
+                [this] { return mStop || mQueue.size() >= mMaxBatchSize || mFlushTarget > mNumExported; });
+            if (mQueue.empty())
+            {
+                if (mStop)
+                {
+                    return;
+                }
+                continue;
+            }
+            auto const batchSize = std::min(mQueue.size(), mMaxBatchSize);
+            std::vector<TraceSpan> batch(std::make_move_iterator(mQueue.begin()),
+                std::make_move_iterator(mQueue.begin() + static_cast<std::ptrdiff_t>(batchSize)));
+            mQueue.erase(mQueue.begin(), mQueue.begin() + static_cast<std::ptrdiff_t>(batchSize));
+            lock.unlock();
+            try
+            {
+                mExporter(batch);
+            }
+            catch (std::exception const& e)
+            {
+                TLLM_LOG_WARNING("Dropped %zu trace spans, the exporter failed: %s", batch.size(), e.what());
+            }
+            lock.lock();
+            mNumExported += batchSize;
+            mCondition.notify_all();
+        }
+    }
+
+    Exporter mExporter;
+    std::size_t mMaxBatchSize;
+    std::chrono::milliseconds mExportInterval;
+    std::size_t mMaxQueueSize;
+    // Only used by endRequest, which is called by one thread
+    std::mt19937_64 mRandom;
+
+    mutable std::mutex mMutex;
+    std::unordered_map<RequestIdType, TracedRequest> mRequests;
+    std::condition_variable mCondition;
+    std::deque<TraceSpan> mQueue;
+    std::size_t mNumQueued{0};
+    std::size_t mNumExported{0};
+    std::size_t mFlushTarget{0};
+    std::size_t mNumDropped{0};
+    bool mStop{false};
+    // Declared last, started once the other members are initialized
+    std::thread mThread;
+};
+
+} // namespace tensorrt_llm::batch_manager
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace tensorrt_llm::batch_manager
+{
+
+/// @brief W3C trace context of a request, propagated from the tracing of the caller so that the spans of the request
+/// in the batch manager join the trace of the caller.
+struct TraceContext
+{
+    // Values of the trace_context input tensor
+    static std::size_t constexpr kNbTensorValues = 4;
+
+    std::uint64_t traceIdHigh{0};
+    std::uint64_t traceIdLow{0};
+    // Span of the caller, parent of the spans of the request
+    std::uint64_t spanId{0};
+    std::uint8_t flags{0};
+
+    [[nodiscard]] bool isValid() const
+    {
+        return (traceIdHigh != 0 || traceIdLow != 0) && spanId != 0;
+    }
+
+    [[nodiscard]] bool isSampled() const
+    {
+        return (flags & 0x01) != 0;
+    }
+
+    /// @brief Parse a `traceparent` header, e.g. `00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01`
+    /// @return The context, or nullopt if the header is malformed or its ids are zero
+    [[nodiscard]] static std::optional<TraceContext> fromTraceParent(std::string_view traceParent)
+    {
+        // Versions after 00 may append fields, the first four are kept
+        if (traceParent.size() < 55 || (traceParent.size() > 55 && traceParent[55] != '-') || traceParent[2] != '-'
+            || traceParent[35] != '-' || traceParent[52] != '-' || traceParent.substr(0, 2) == "ff")
+        {
+            return std::nullopt;
+        }
+        std::uint64_t version{0};
+        std::uint64_t flags{0};
+        TraceContext context;
+        if (!parseHex(traceParent.substr(0, 2), version) || !parseHex(traceParent.substr(3, 16), context.traceIdHigh)
+            || !parseHex(traceParent.substr(19, 16), context.traceIdLow)
+            || !parseHex(traceParent.substr(36, 16), context.spanId) || !parseHex(traceParent.substr(53, 2), flags)
+            || (version == 0 && traceParent.size() != 55))
+        {
+            return std::nullopt;
+        }
+        context.flags = static_cast<std::uint8_t>(flags);
+        return context.isValid() ? std::optional<TraceContext>{context} : std::nullopt;
+    }
+
+    /// @brief Format the context as a version 00 `traceparent` header
+    [[nodiscard]] std::string toTraceParent() const
+    {
+        char traceParent[56];
+        std::snprintf(traceParent, sizeof(traceParent), "00-%016llx%016llx-%016llx-%02x",
+            static_cast<unsigned long long>(traceIdHigh), static_cast<unsigned long long>(traceIdLow),
+            static_cast<unsigned long long>(spanId), static_cast<unsigned int>(flags));
+        return traceParent;
+    }
+
+    /// @brief Read the context from a trace_context input tensor [4] (int64) of the high and low halves of the
+    /// trace id, the span id and the flags
+    [[nodiscard]] static std::optional<TraceContext> fromTensor(runtime::ITensor const& tensor)
+    {
+        if (tensor.getSize() != kNbTensorValues || tensor.getDataType() != nvinfer1::DataType::kINT64)
+        {
+            return std::nullopt;
+        }
+        auto const* values = runtime::bufferCast<std::int64_t>(tensor);
+        TraceContext context{static_cast<std::uint64_t>(values[0]), static_cast<std::uint64_t>(values[1]),
+            static_cast<std::uint64_t>(values[2]), static_cast<std::uint8_t>(values[3])};
+        return context.isValid() ? std::optional<TraceContext>{context} : std::nullopt;
+    }
+
+    /// @brief Write the context to a host tensor to set as the trace_context input tensor
+    [[nodiscard]] runtime::ITensor::SharedPtr toTensor() const
+    {
+        auto tensor = runtime::BufferManager::cpu(
+            runtime::ITensor::makeShape({static_cast<runtime::SizeType>(kNbTensorValues)}), nvinfer1::DataType::kINT64);
+        auto* values = runtime::bufferCast<std::int64_t>(*tensor);
+        values[0] = static_cast<std::int64_t>(traceIdHigh);
+        values[1] = static_cast<std::int64_t>(traceIdLow);
+        values[2] = static_cast<std::int64_t>(spanId);
+        values[3] = flags;
+        return tensor;
+    }
+
+private:
+    // Lowercase only, as required by the specification
+    static bool parseHex(std::string_view digits, std::uint64_t& value)
+    {
+        value = 0;
+        for (auto const digit : digits)
+        {
+            if (digit >= '0' && digit <= '9')
+            {
+                value = (value << 4) | static_cast<std::uint64_t>(digit - '0');
+            }
+            else if (digit >= 'a' && digit <= 'f')
+            {
+                value = (value << 4) | static_cast<std::uint64_t>(digit - 'a' + 10);
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+} // namespace tensorrt_llm::batch_manager
@@ -30,6 +30,7 @@
 #include <cstdlib>
 #include <memory>
 #include <mpi.h>
+#include <string>
 #include <type_traits>
 #include <unordered_map>
 #include <vector>
@@ -186,8 +187,12 @@ public:
 
     void wait()
     {
-        // TODO: Don't ignore return status
-        MPI_Wait(&mRequest, MPI_STATUS_IGNORE);
+        // Requests of the file bootstrap are complete when created
+        if (mRequest != MPI_REQUEST_NULL)
+        {
+            // TODO: Don't ignore return status
+            MPI_Wait(&mRequest, MPI_STATUS_IGNORE);
+        }
     }
 
     MPI_Request mRequest{};
@@ -195,10 +200,19 @@ public:
 
 MPI_Datatype getMpiDtype(MpiType dtype);
 
+std::size_t getDtypeSize(MpiType dtype);
+
+class FileGroup;
+
+// A communicator of MPI, or of a group of ranks exchanging messages through a shared directory when the environment
+// variable TRTLLM_BOOTSTRAP_DIR is set (see FileGroup). The latter bootstraps NCCL and the CUDA IPC buffers without
+// mpirun, each process being given its rank and the number of ranks by TRTLLM_BOOTSTRAP_RANK and
+// TRTLLM_BOOTSTRAP_WORLD_SIZE.
 class MpiComm
 {
 public:
     explicit MpiComm(MPI_Comm g, bool freeComm);
+    explicit MpiComm(std::shared_ptr<FileGroup> fileGroup);
     ~MpiComm() noexcept;
 
     // no copy
@@ -223,6 +237,9 @@ public:
     //! \brief Corresponds to `world()` by default, but can be overridden per process.
     static MpiComm& session();
 
+    //! \brief Returns the communicator of the ranks exchanging messages through the files of dir.
+    static MpiComm fileGroup(std::string const& dir, int rank, int size);
+
     [[nodiscard]] MpiComm split(int color, int key) const;
 
     std::shared_ptr<MpiRequest> bcastAsync(void* buffer, size_t size, MpiType dtype, int root) const;
@@ -304,7 +321,7 @@ public:
 
     bool operator==(MpiComm const& rhs) const
     {
-        return mComm == rhs.mComm;
+        return mComm == rhs.mComm && mFileGroup == rhs.mFileGroup;
     }
 
     bool operator!=(MpiComm const& rhs) const
@@ -315,6 +332,8 @@ public:
 private:
     MPI_Comm mComm;
     bool mFreeComm;
+    // Set instead of mComm when bootstrapping through files
+    std::shared_ptr<FileGroup> mFileGroup;
 };
 
 void initialize(MpiThreadSupport threadMode = MpiThreadSupport::THREAD_FUNNELED);
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+
+#include <NvInferRuntime.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief Plans the placement of tensors in a single allocation, see `BufferManager::gpu(BufferArena const&)`.
+//!
+//! Each tensor is used during a range of phases, numbered by the user, e.g. the context and the generation phases of
+//! a request. The tensors whose ranges do not overlap may share memory. The largest tensors are placed first, each at
+//! the lowest offset that does not overlap a placed tensor with an overlapping range.
+class BufferArena
+{
+public:
+    using Phase = SizeType;
+
+    //! \brief Alignment of the offsets of the tensors, in bytes.
+    static std::size_t constexpr kAlignment = 256;
+
+    //! \brief Adds a tensor of `capacity` elements used from phase `first` to phase `last`, included.
+    //!
+    //! \return The index of the tensor.
+    std::size_t add(nvinfer1::DataType type, std::size_t capacity, Phase first, Phase last);
+
+    //! \brief Computes the offsets of the tensors and the size of the allocation.
+    void plan();
+
+    [[nodiscard]] std::size_t getNbTensors() const
+    {
+        return mTensors.size();
+    }
+
+    [[nodiscard]] nvinfer1::DataType getDataType(std::size_t idx) const
+    {
+        return mTensors.at(idx).type;
+    }
+
+    [[nodiscard]] std::size_t getCapacity(std::size_t idx) const
+    {
+        return mTensors.at(idx).capacity;
+    }
+
+    //! \brief Offset of a tensor in the allocation, in bytes. Valid after `plan()`.
+    [[nodiscard]] std::size_t getOffset(std::size_t idx) const;
+
+    //! \brief Size of the allocation, in bytes. Valid after `plan()`.
+    [[nodiscard]] std::size_t getSize() const;
+
+    //! \brief Size of the tensors allocated separately, in bytes, with the same alignment.
+    [[nodiscard]] std::size_t getUnsharedSize() const;
+
+private:
+    struct Tensor
+    {
+        nvinfer1::DataType type;
+        std::size_t capacity;
+        std::size_t sizeInBytes;
+        Phase first;
+        Phase last;
+        std::size_t offset;
+    };
+
+    std::vector<Tensor> mTensors;
+    std::size_t mSize{0};
+    bool mPlanned{false};
+};
+
+} // namespace tensorrt_llm::runtime
@@ -17,19 +17,42 @@
 #pragma once
 
 #include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/runtime/bufferArena.h"
 #include "tensorrt_llm/runtime/cudaStream.h"
 #include "tensorrt_llm/runtime/iBuffer.h"
+#include "tensorrt_llm/runtime/iGpuAllocator.h"
 #include "tensorrt_llm/runtime/iTensor.h"
 #include <NvInferRuntime.h>
+#include <cuda_runtime_api.h>
 
 #include <cstdint>
+#include <limits>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 namespace tensorrt_llm::runtime
 {
+//! \brief Settings of the stream-ordered memory pool from which `BufferManager::gpu` allocates.
+struct MemoryPoolConfig
+{
+    //! Memory kept reserved by the pool when it synchronizes, instead of being released to the OS. Keeping all of it
+    //! avoids allocating again from the OS after each burst of requests.
+    std::uint64_t releaseThreshold{std::numeric_limits<std::uint64_t>::max()};
+    //! Reuse the memory freed on another stream when the allocating stream waits on an event recorded after the free.
+    bool reuseFollowEventDependencies{true};
+    //! Reuse the memory freed on another stream once the free has completed, without any dependency between the
+    //! streams.
+    bool reuseAllowOpportunistic{true};
+    //! Reuse the memory freed on another stream by making the allocating stream wait on the free.
+    bool reuseAllowInternalDependencies{true};
+    //! Allocate from a pool dedicated to the stream of the `BufferManager` instead of the default pool of the device,
+    //! so that the settings and the statistics are not shared with the other streams.
+    bool dedicatedPool{false};
+};
+
 //! \brief A helper class for managing memory on host and device.
 class BufferManager
 {
@@ -46,6 +69,19 @@ public:
     //! etc.).
     explicit BufferManager(CudaStreamPtr stream);
 
+    //! \brief Construct a BufferManager whose GPU allocations use the memory pool configured by `poolConfig`.
+    //!
+    //! The settings of the default pool of the device apply to all the streams allocating from it. A dedicated pool
+    //! is a setting of `stream`: the BufferManagers of the stream, created before or after this one, allocate from it
+    //! until the stream is destroyed or another pool is configured.
+    BufferManager(CudaStreamPtr stream, MemoryPoolConfig const& poolConfig);
+
+    //! \brief Construct a BufferManager whose GPU allocations are made by `gpuAllocator`, e.g. the caching allocator
+    //! of PyTorch. The statistics and the trimming of the memory pool then apply to `gpuAllocator`.
+    //!
+    //! Like a dedicated pool, `gpuAllocator` is a setting of `stream` used by all the BufferManagers of the stream.
+    BufferManager(CudaStreamPtr stream, IGpuAllocator::SharedPtr gpuAllocator);
+
     static auto constexpr kBYTE_TYPE = nvinfer1::DataType::kUINT8;
 
     //! \brief Allocates an `IBuffer` of the given size on the GPU.
@@ -54,6 +90,10 @@ public:
     //! \brief Allocates an `ITensor` of the given dimensions on the GPU.
     [[nodiscard]] ITensorPtr gpu(nvinfer1::Dims dims, nvinfer1::DataType type = kBYTE_TYPE) const;
 
+    //! \brief Allocates the planned `arena` on the GPU and returns its tensors, in the order they were added, with
+    //! empty shapes. They keep the allocation alive and can be reshaped up to their capacity.
+    [[nodiscard]] std::vector<ITensor::SharedPtr> gpu(BufferArena const& arena) const;
+
     //! \brief Allocates an `IBuffer` of the given size on the CPU.
     [[nodiscard]] static IBufferPtr cpu(std::size_t size, nvinfer1::DataType type = kBYTE_TYPE);
 
@@ -147,6 +187,18 @@ public:
     //! \brief Get the underlying cuda stream.
     [[nodiscard]] CudaStream const& getStream() const;
 
+    //! \brief The memory pool the GPU allocations are made from.
+    [[nodiscard]] ::cudaMemPool_t getMemoryPool() const;
+
+    //! \brief Whether the GPU allocations are made from a pool dedicated to the stream of this BufferManager.
+    [[nodiscard]] bool hasDedicatedMemoryPool() const;
+
+    //! \brief The external allocator of the GPU allocations, null when allocating from a memory pool.
+    [[nodiscard]] IGpuAllocator::SharedPtr getGpuAllocator() const;
+
+    //! \brief The memory kept reserved by the memory pool when it synchronizes.
+    [[nodiscard]] std::size_t memoryPoolReleaseThreshold() const;
+
     //! \brief The current size of the memory reserved by the memory pool.
     [[nodiscard]] std::size_t memoryPoolReserved() const;
 
@@ -156,23 +208,41 @@ public:
     //! \brief The current size of the memory free in the memory pool.
     [[nodiscard]] std::size_t memoryPoolFree() const;
 
+    //! \brief The largest size of the memory used by the memory pool since the last `memoryPoolResetUsedHigh`.
+    [[nodiscard]] std::size_t memoryPoolUsedHigh() const;
+
+    //! \brief Resets the largest size of the memory used by the memory pool to the current one.
+    void memoryPoolResetUsedHigh();
+
     //! \brief Try to trim the memory reserved by the pool to `size` bytes. This synchronizes implicitly with the
-    //! stream.
+    //! stream. An external allocator releases all of its cached memory.
     void memoryPoolTrimTo(std::size_t size);
 
 private:
+    using CudaMemPoolPtr = std::shared_ptr<std::remove_pointer_t<::cudaMemPool_t>>;
+
     void static initMemoryPool(int device);
 
-    std::size_t static memoryPoolReserved(int device);
+    void static setPeerAccess(::cudaMemPool_t memPool, int device);
+
+    void static configureMemoryPool(::cudaMemPool_t memPool, MemoryPoolConfig const& config);
+
+    CudaMemPoolPtr static createMemoryPool(int device, MemoryPoolConfig const& config);
+
+    std::size_t static memoryPoolReserved(::cudaMemPool_t memPool);
+
+    std::size_t static memoryPoolUsed(::cudaMemPool_t memPool);
+
+    std::size_t static memoryPoolUsedHigh(::cudaMemPool_t memPool);
 
-    std::size_t static memoryPoolUsed(int device);
+    void static memoryPoolResetUsedHigh(::cudaMemPool_t memPool);
 
-    std::size_t static memoryPoolFree(int device)
+    std::size_t static memoryPoolFree(::cudaMemPool_t memPool)
     {
-        return memoryPoolReserved(device) - memoryPoolUsed(device);
+        return memoryPoolReserved(memPool) - memoryPoolUsed(memPool);
     }
 
-    void static memoryPoolTrimTo(int device, std::size_t size);
+    void static memoryPoolTrimTo(::cudaMemPool_t memPool, std::size_t size);
 
     CudaStreamPtr mStream;
 };
@@ -59,6 +59,7 @@ public:
     TensorPtr badWordsList;        // [2, badWordsLength] or [batchSize, 2, badWordsLength], on gpu
     TensorPtr stopWordsList;       // [batchSize, 2, stopWordsLength], on gpu
     TensorPtr noRepeatNgramSize;   // [batchSize], on gpu
+    TensorPtr logitsBitmask;       // [batchSize, ceil(vocabSizePadded / 32)], allowed tokens of each request, on gpu
 
     // parameters for beam search
     TensorPtr cacheIndirection; // [batchSize, beamWidth, maxSeqLen] - the k/v cache index for beam search, on gpu
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief Decodes token ids to UTF-8 text with the vocabulary of a Hugging Face tokenizer.json, so that the responses
+//! can be returned as text without a Python tokenizer.
+//!
+//! Supports the byte-level BPE of GPT-2 like tokenizers and the SentencePiece BPE with byte fallback of LLaMA like
+//! tokenizers. The special tokens are skipped. The bytes of each token are looked up in a table built by the parse,
+//! and the invalid UTF-8 sequences are replaced with U+FFFD.
+class Detokenizer
+{
+public:
+    //! \brief The state of the decoding of a stream of tokens.
+    struct Stream
+    {
+        //! Bytes of a UTF-8 character that the next tokens complete
+        std::string pending;
+        bool started{false};
+    };
+
+    static Detokenizer parse(std::string const& json);
+
+    static Detokenizer parse(std::filesystem::path const& path);
+
+    //! \brief Decodes a whole sequence.
+    [[nodiscard]] std::string decode(TokenIdType const* tokens, std::size_t count) const;
+
+    //! \brief Decodes the next tokens of a stream, returns the text of the UTF-8 characters they complete.
+    [[nodiscard]] std::string decode(Stream& stream, TokenIdType const* tokens, std::size_t count) const;
+
+    //! \brief Returns the text of the bytes left in a stream, at its end.
+    [[nodiscard]] std::string finish(Stream& stream) const;
+
+    [[nodiscard]] SizeType getVocabSize() const
+    {
+        return static_cast<SizeType>(mTokens.size());
+    }
+
+private:
+    Detokenizer(std::vector<std::string> tokens, bool stripLeadingSpace)
+        : mTokens{std::move(tokens)}
+        , mStripLeadingSpace{stripLeadingSpace}
+    {
+    }
+
+    // The bytes of each token, empty for the special tokens
+    std::vector<std::string> mTokens;
+    // The SentencePiece tokenizers add a space before the first word
+    bool mStripLeadingSpace;
+};
+
+} // namespace tensorrt_llm::runtime
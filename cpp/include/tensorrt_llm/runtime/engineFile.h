@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief The contents of an engine file, held for the time of its deserialization.
+//!
+//! By default the file is memory mapped and prefaulted, so TensorRT deserializes it from the page cache without a copy
+//! in user space. Without the copy, the peak host memory of a rank is the size of its engine instead of twice the size.
+//! With kDIRECT, the file is read with O_DIRECT in large chunks, which bypasses the page cache: the fastest way to read
+//! an engine that is not cached, as on a newly started node, and it leaves the page cache to the other ranks. kAUTO
+//! chooses kDIRECT when less than half of the file is in the page cache, kMMAP otherwise. kREAD is the buffered read
+//! of utils::loadEngine. The mode is given by TRTLLM_ENGINE_LOAD_MODE (mmap, direct, auto or read), mmap by default.
+//! On Windows the file is always read.
+class EngineFile
+{
+public:
+    enum class LoadMode : std::int32_t
+    {
+        kMMAP = 0,
+        kDIRECT = 1,
+        kAUTO = 2,
+        kREAD = 3,
+    };
+
+    //! \brief Loads the file with the mode given by TRTLLM_ENGINE_LOAD_MODE.
+    explicit EngineFile(std::string const& path);
+
+    EngineFile(std::string const& path, LoadMode mode);
+
+    ~EngineFile();
+
+    EngineFile(EngineFile const&) = delete;
+    EngineFile& operator=(EngineFile const&) = delete;
+
+    [[nodiscard]] void const* data() const
+    {
+        return mData;
+    }
+
+    [[nodiscard]] std::size_t size() const
+    {
+        return mSize;
+    }
+
+    //! \brief The mode the file was loaded with, never kAUTO.
+    [[nodiscard]] LoadMode getLoadMode() const
+    {
+        return mMode;
+    }
+
+    //! \brief Parses the value of TRTLLM_ENGINE_LOAD_MODE, kMMAP if it is empty or unknown.
+    static LoadMode parseLoadMode(std::string const& name);
+
+private:
+    void map(int fd);
+    bool readDirect(std::string const& path);
+    void read(std::string const& path);
+
+    void const* mData{nullptr};
+    std::size_t mSize{0};
+    LoadMode mMode{LoadMode::kREAD};
+    void* mMapping{nullptr};
+    // Aligned buffer of a direct read
+    std::unique_ptr<std::uint8_t, void (*)(void*)> mAligned{nullptr, std::free};
+    std::vector<std::uint8_t> mBuffer;
+};
+
+} // namespace tensorrt_llm::runtime
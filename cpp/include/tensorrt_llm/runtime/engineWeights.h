@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/iBuffer.h"
+
+#include <NvInferRuntime.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+class EngineFile;
+
+//! \brief The weights of a rank read from a safetensors file, such as the rank<N>.safetensors of a checkpoint, to refit
+//! an engine built with use_refit.
+//!
+//! The names are the ones of the parameters of the network, which are the names of the refittable weights of the
+//! engine. The file is memory mapped and copied to a single pinned buffer, from which TensorRT copies the weights to
+//! the GPU. Reading the file takes most of the time of a refit and does not touch the engine, so the weights of a new
+//! fine-tune can be read while the previous ones serve.
+//!
+//! Without the pinned copy, the weights are read from the mapping of the file: the processes that load the same
+//! weights on a node, such as the ones of a weightless engine, share them in the page cache.
+class EngineWeights
+{
+public:
+    struct Weights
+    {
+        std::string name;
+        nvinfer1::DataType dataType;
+        std::vector<std::int64_t> shape;
+        //! Number of elements
+        std::int64_t count;
+        //! In the pinned buffer or in the mapping of the file
+        void const* values;
+    };
+
+    explicit EngineWeights(std::string const& path, bool pinned = true);
+
+    ~EngineWeights();
+
+    [[nodiscard]] std::vector<Weights> const& getWeights() const
+    {
+        return mWeights;
+    }
+
+    //! \brief Size of the data of the weights, in bytes.
+    [[nodiscard]] std::size_t getSizeInBytes() const
+    {
+        return mSize;
+    }
+
+    //! \brief Parses a safetensors data type, such as F16, throws if TensorRT does not support it.
+    static nvinfer1::DataType parseDataType(std::string const& name);
+
+private:
+    // Either the file is kept mapped or the weights are copied to the pinned buffer
+    std::unique_ptr<EngineFile> mFile;
+    IBuffer::UniquePtr mBuffer;
+    std::size_t mSize{0};
+    std::vector<Weights> mWeights;
+};
+
+} // namespace tensorrt_llm::runtime
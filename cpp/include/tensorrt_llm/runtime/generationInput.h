@@ -20,9 +20,12 @@
 #include "tensorrt_llm/runtime/common.h"
 #include "tensorrt_llm/runtime/iTensor.h"
 #include "tensorrt_llm/runtime/promptTuningParams.h"
+#include "tensorrt_llm/runtime/tokenConstraint.h"
 
+#include <memory>
 #include <optional>
 #include <utility>
+#include <vector>
 
 namespace tensorrt_llm::runtime
 {
@@ -74,6 +77,14 @@ public:
         : GenericGenerationInput(endId, padId, std::move(ids), std::move(lengths), packed)
     {
     }
+
+    // Host-side constraints on the generated tokens, nullptr for the unconstrained requests. See tokenConstraint.h
+    std::vector<std::shared_ptr<ITokenConstraint>> tokenConstraints; // [batchSize], optional
+
+    // Additional inputs of the engine, such as the lora_ranks_<layer> and lora_weights_pointers_<layer> of a model
+    // built with the LoRA plugin, bound at every step. Their first dimension is the batch. Names the engine does not
+    // have are ignored, so the inputs of all the layers can be given to every pipeline-parallel rank.
+    StringPtrMap<ITensor> extraInputs; // name -> [batchSize, ...], optional
 };
 
 } // namespace tensorrt_llm::runtime
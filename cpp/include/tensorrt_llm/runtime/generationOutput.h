@@ -53,6 +53,10 @@ public:
     TensorPtr contextLogits;    // [batch_size, max_input_length, vocab_size_padded], if packed, the shape will be
                                 // [packed_size, vocab_size_padded]
     TensorPtr generationLogits; // [batch_size, beam_width, max_output_length, vocab_size_padded]
+    // The numTopLogProbs most likely tokens of each generation step and their log-probabilities, computed on the
+    // device from the logits of the beams at that step.
+    TensorPtr topLogProbIds; // [batchSize, beamWidth, maxNewTokens, numTopLogProbs], must be int32_t*, on gpu
+    TensorPtr topLogProbs;   // [batchSize, beamWidth, maxNewTokens, numTopLogProbs], must be float*, on gpu
     // generation logit pointer list
     std::shared_ptr<std::vector<TensorPtr>> generationLogitsFragments;
 
@@ -21,10 +21,13 @@
 #include "tensorrt_llm/runtime/decodingInput.h"
 #include "tensorrt_llm/runtime/decodingOutput.h"
 #include "tensorrt_llm/runtime/samplingConfig.h"
+#include "tensorrt_llm/runtime/truncationConfig.h"
 #include <curand_kernel.h>
 
 #include <cstdint>
 #include <memory>
+#include <optional>
+#include <vector>
 
 #include <NvInferRuntime.h>
 
@@ -70,6 +73,15 @@ public:
 
     static std::unique_ptr<IGptDecoder> create(
         nvinfer1::DataType dtype, size_t vocabSize, size_t vocabSizePadded, BufferManager::CudaStreamPtr const& stream);
+
+    //! @brief Setup `decoder`, created by `create`, and only initialize the random states of the requests in
+    //! `seedSlots` from the seeds in `samplingConfig`. The other requests keep their random states.
+    static void setupSeedSlots(IGptDecoder& decoder, SamplingConfig const& samplingConfig, size_t batchSize,
+        SizeType maxSequenceLength, std::vector<SizeType> const& seedSlots);
+
+    //! @brief Setup `decoder`, created by `create`, to also sample with the min-p and typical-p of `truncationConfig`.
+    static void setupTruncated(IGptDecoder& decoder, SamplingConfig const& samplingConfig,
+        TruncationConfig const& truncationConfig, size_t batchSize, SizeType maxSequenceLength);
 };
 
 template <typename T>
@@ -84,6 +96,12 @@ public:
 
     void setup(SamplingConfig const& samplingConfig, size_t batchSize, SizeType maxSequenceLength) override;
 
+    //! @param truncationConfig min-p and typical-p of the requests
+    //! @param seedSlots if set, only the random states of these requests are initialized from the seeds in
+    //! `samplingConfig` and the other requests keep their random states
+    void setup(SamplingConfig const& samplingConfig, TruncationConfig const& truncationConfig, size_t batchSize,
+        SizeType maxSequenceLength, std::optional<std::vector<SizeType>> const& seedSlots = std::nullopt);
+
     bool forward(DecodingOutput& output, DecodingInput const& input) override;
 
     void forwardAsync(DecodingOutput& output, DecodingInput const& input) override;
@@ -24,6 +24,7 @@
 #include "tensorrt_llm/runtime/gptDecoder.h"
 #include "tensorrt_llm/runtime/iGptDecoderBatch.h"
 #include "tensorrt_llm/runtime/iTensor.h"
+#include "tensorrt_llm/runtime/truncationConfig.h"
 
 #include <cstdint>
 #include <memory>
@@ -55,6 +56,10 @@ public:
     void newBatch(
         GenerationInput const& inputs, GenerationOutput const& outputs, SamplingConfig const& samplingConfig) override;
 
+    //! @brief Like `newBatch`, the requests also sample with the min-p and typical-p of `truncationConfig`.
+    void newBatch(GenerationInput const& inputs, GenerationOutput const& outputs, SamplingConfig const& samplingConfig,
+        TruncationConfig const& truncationConfig);
+
     TokenPtr forwardAsync(decoder_batch::Output& output, decoder_batch::Input const& input) override;
 
     void forwardSync(decoder_batch::Token const& e) override;
@@ -161,7 +166,7 @@ private:
     //! @brief Gather final beam search results for request `batchIdx`.
     CudaEvent postProcessRequest(SizeType batchIdx) const;
 
-private:
+protected:
     std::size_t const mVocabSize;
     std::size_t const mVocabSizePadded;
     CudaStreamPtr mStream;
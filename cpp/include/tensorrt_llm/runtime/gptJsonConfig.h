@@ -33,13 +33,14 @@ class GptJsonConfig
 {
 public:
     GptJsonConfig(std::string name, std::string version, std::string precision, SizeType tensorParallelism,
-        SizeType pipelineParallelism, GptModelConfig const& modelConfig)
+        SizeType pipelineParallelism, GptModelConfig const& modelConfig, bool stripWeights = false)
         : mName(std::move(name))
         , mVersion(std::move(version))
         , mPrecision(std::move(precision))
         , mTensorParallelism{tensorParallelism}
         , mPipelineParallelism{pipelineParallelism}
         , mGptModelConfig(modelConfig)
+        , mStripWeights{stripWeights}
     {
     }
 
@@ -47,6 +48,8 @@ public:
 
     static GptJsonConfig parse(std::istream& json);
 
+    //! \brief Parses the config.json of the engines. A file that was parsed before and has the same checksum is not
+    //! parsed again, its config is copied.
     static GptJsonConfig parse(std::filesystem::path const& path);
 
     [[nodiscard]] GptModelConfig getModelConfig() const
@@ -91,6 +94,14 @@ public:
         return engineFilename(worldConfig, getName());
     }
 
+    //! \brief Whether the engines are built with `strip_weights`, their weights are then in `weightsFilename`.
+    [[nodiscard]] bool constexpr hasStrippedWeights() const
+    {
+        return mStripWeights;
+    }
+
+    [[nodiscard]] std::string weightsFilename(WorldConfig const& worldConfig) const;
+
 private:
     std::string const mName;
     std::string const mVersion;
@@ -98,6 +109,7 @@ private:
     SizeType const mTensorParallelism;
     SizeType const mPipelineParallelism;
     GptModelConfig const mGptModelConfig;
+    bool const mStripWeights;
 };
 
 } // namespace tensorrt_llm::runtime
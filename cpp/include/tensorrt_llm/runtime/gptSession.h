@@ -17,22 +17,33 @@
 #pragma once
 
 #include "tensorrt_llm/batch_manager/kvCacheConfig.h"
+#include "tensorrt_llm/common/commProfiler.h"
 #include "tensorrt_llm/runtime/bufferManager.h"
 #include "tensorrt_llm/runtime/common.h"
 #include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/engineFile.h"
+#include "tensorrt_llm/runtime/engineWeights.h"
 #include "tensorrt_llm/runtime/generationInput.h"
 #include "tensorrt_llm/runtime/generationOutput.h"
 #include "tensorrt_llm/runtime/gptModelConfig.h"
+#include "tensorrt_llm/runtime/gpuMetricsStats.h"
+#include "tensorrt_llm/runtime/iGpuAllocator.h"
 #include "tensorrt_llm/runtime/iTensor.h"
+#include "tensorrt_llm/runtime/layerProfileStats.h"
 #include "tensorrt_llm/runtime/samplingConfig.h"
+#include "tensorrt_llm/runtime/truncationConfig.h"
 #include "tensorrt_llm/runtime/worldConfig.h"
 
 #include <NvInferRuntime.h>
 
 #include <cstdint>
 #include <functional>
+#include <future>
+#include <list>
+#include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace tensorrt_llm::batch_manager
@@ -69,6 +80,13 @@ class GptSession
 public:
     using LoggerPtr = std::shared_ptr<nvinfer1::ILogger>;
 
+    //! @brief Pooling of the hidden states of a sequence into its embedding, see `encode`.
+    enum class PoolingType
+    {
+        kLAST, //!< hidden state of the last token
+        kMEAN, //!< mean of the hidden states of all the tokens
+    };
+
     //! @brief   Configuration for session execution and buffer sizes.
     //!          `generate` may be called with batch size and beam width smaller than the configured parameters.
     //! @details `maxBatchSize` will be divided by the number of micro batches to initialize each batch buffer.
@@ -92,9 +110,81 @@ public:
         std::optional<SizeType> genMicroBatchSize = std::nullopt;
     };
 
+    //! @brief   Options of the session added after the layout of `Config` was fixed by the prebuilt batch manager.
+    //! @details Passed to the constructors next to the `Config`, the defaults keep the behavior of a session created
+    //!          without them.
+    struct Options
+    {
+        //! Number of graphs kept per generation step instance in `cudaGraphMode`, one per batch size and beam width.
+        SizeType cudaGraphCacheSize{1};
+        //! Spread a batch evenly over all generation micro batches instead of filling them in order. With pipeline
+        //! parallelism, a batch smaller than `maxBatchSize` then keeps every stage busy.
+        bool balanceMicroBatches{false};
+        //! Place the device buffers of each generation micro batch in one allocation, planned before the KV cache is
+        //! sized. The buffers only used in the context phase share memory with the ones only used in generation.
+        bool bufferArenaMode{false};
+        //! Size the paged KV cache from the memory left after running a worst-case context and generation step at
+        //! setup, instead of from `kvCacheConfig.freeGpuMemoryFraction` of the free memory. The step runs a full batch
+        //! of the longest inputs, the cache gets the free memory minus the peak of the step and
+        //! `kvCacheCalibrationMargin` bytes. `kvCacheConfig.maxTokens` still bounds it.
+        bool kvCacheCalibrationMode{false};
+        std::size_t kvCacheCalibrationMargin{std::size_t{512} << 20};
+        //! Fraction of the streamable weights kept on the GPU, the others are streamed from host memory when the layers
+        //! run. Lower values fit larger models at a lower speed. Requires an engine built with weight streaming.
+        float gpuWeightsPercent{1.0F};
+        //! Weights of an engine built with `strip_weights`, refitted from the mapping of the file when the session is
+        //! created, see GptJsonConfig::weightsFilename. The file stays in the page cache of the node, where the other
+        //! processes loading it find it.
+        std::optional<std::string> weightsFile = std::nullopt;
+        //! Settings of the memory pool of the session, e.g. a dedicated pool or a lower release threshold. The default
+        //! pool of the device keeps its settings if not set.
+        std::optional<MemoryPoolConfig> memoryPoolConfig = std::nullopt;
+        //! Allocator of the GPU buffers of the session instead of a memory pool, e.g. the caching allocator of PyTorch
+        //! when the session runs in a PyTorch process, so that both share one pool. Excludes `memoryPoolConfig`.
+        IGpuAllocator::SharedPtr gpuAllocator = nullptr;
+        //! Return the logits of all the context tokens of an engine built with `gather_all_token_logits`. When false,
+        //! an engine that gathers the hidden states before the LM head computes the logits of the last tokens only.
+        bool gatherContextLogits{true};
+        //! With an engine built with KV cache online scaling (QuantMode::kvCacheOnlineScaling), the attention layers
+        //! collect the absmax of the keys and values on one step out of `kvCacheScaleSampleInterval`, and the scales
+        //! of the 8-bit KV cache are recalibrated at the end of each `generate` call, when the cache is empty. The
+        //! scale leaves a headroom of `kvCacheScaleMargin` over the absmax of the last updates. 0 keeps the static
+        //! scales of the engine.
+        SizeType kvCacheScaleSampleInterval{16};
+        float kvCacheScaleMargin{1.F};
+    };
+
+    //! @brief Acceptance of the draft tokens in the iterations of `generateSpeculative` or `generatePromptLookup`.
+    struct SpeculativeDecodingStats
+    {
+        //! Passes of the target model
+        SizeType numIterations{0};
+        //! Requests verified by the passes of the target model, a request being verified once per iteration
+        SizeType numVerifications{0};
+        //! Tokens added to the sequences, accepted draft tokens and tokens of the target model
+        SizeType numTokens{0};
+        //! Draft tokens verified and accepted at each position of the drafts, the first position being 0
+        std::vector<SizeType> numDraftTokens;
+        std::vector<SizeType> numAcceptedTokens;
+        //! Time of the drafts and the target model on the host, both synchronize at the end
+        float draftTimeMs{0.F};
+        float targetTimeMs{0.F};
+
+        //! Fraction of the draft tokens accepted at a position, among those verified at that position
+        [[nodiscard]] float getAcceptanceRate(SizeType position) const
+        {
+            return numDraftTokens.at(position) > 0
+                ? static_cast<float>(numAcceptedTokens.at(position)) / numDraftTokens.at(position)
+                : 0.F;
+        }
+    };
+
     GptSession(Config const& sessionConfig, GptModelConfig const& modelConfig, WorldConfig const& worldConfig,
         void const* engineBuffer, std::size_t engineSize, LoggerPtr logger = nullptr);
 
+    GptSession(Config const& sessionConfig, Options const& options, GptModelConfig const& modelConfig,
+        WorldConfig const& worldConfig, void const* engineBuffer, std::size_t engineSize, LoggerPtr logger = nullptr);
+
     GptSession(Config const& sessionConfig, GptModelConfig const& modelConfig, WorldConfig const& worldConfig,
         std::vector<uint8_t> const& engineBuffer, LoggerPtr logger = nullptr)
         : GptSession(
@@ -102,12 +192,37 @@ public:
     {
     }
 
+    GptSession(Config const& sessionConfig, GptModelConfig const& modelConfig, WorldConfig const& worldConfig,
+        EngineFile const& engineFile, LoggerPtr logger = nullptr)
+        : GptSession(sessionConfig, modelConfig, worldConfig, engineFile.data(), engineFile.size(), std::move(logger))
+    {
+    }
+
+    GptSession(Config const& sessionConfig, Options const& options, GptModelConfig const& modelConfig,
+        WorldConfig const& worldConfig, EngineFile const& engineFile, LoggerPtr logger = nullptr)
+        : GptSession(sessionConfig, options, modelConfig, worldConfig, engineFile.data(), engineFile.size(),
+            std::move(logger))
+    {
+    }
+
+    //! \brief Loads the engine without copying it, see EngineFile.
     GptSession(Config const& sessionConfig, GptModelConfig const& modelConfig, WorldConfig const& worldConfig,
         std::string const& engineFile, LoggerPtr logger = nullptr)
-        : GptSession(sessionConfig, modelConfig, worldConfig, utils::loadEngine(engineFile), std::move(logger))
+        : GptSession(sessionConfig, modelConfig, worldConfig, EngineFile{engineFile}, std::move(logger))
+    {
+    }
+
+    GptSession(Config const& sessionConfig, Options const& options, GptModelConfig const& modelConfig,
+        WorldConfig const& worldConfig, std::string const& engineFile, LoggerPtr logger = nullptr)
+        : GptSession(sessionConfig, options, modelConfig, worldConfig, EngineFile{engineFile}, std::move(logger))
     {
     }
 
+    GptSession(GptSession&& other) = default;
+
+    //! \brief Finishes the pending `generateAsync` calls.
+    ~GptSession();
+
     [[nodiscard]] nvinfer1::ILogger& getLogger() const;
 
     [[nodiscard]] BufferManager const& getBufferManager() const;
@@ -131,26 +246,192 @@ public:
 
     void generate(GenerationOutput& outputs, GenerationInput const& inputs, SamplingConfig const& samplingConfig);
 
+    //! @brief Like `generate`, the requests also sample with the min-p and typical-p of `truncationConfig`.
+    void generate(GenerationOutput& outputs, GenerationInput const& inputs, SamplingConfig const& samplingConfig,
+        TruncationConfig const& truncationConfig);
+
+    //! @brief   Enqueues a `generate` call and returns without waiting for it.
+    //! @details The calls run in order on a worker thread of the session, which is started by the first call. Each
+    //!          session runs on its own CUDA stream, so the calls of several sessions overlap. `outputs` must remain
+    //!          valid until the returned future is ready, which rethrows the exceptions of the call. Callbacks of
+    //!          `outputs` run on the worker thread. Do not call `generate` while an asynchronous call is pending.
+    [[nodiscard]] std::future<void> generateAsync(
+        GenerationOutput& outputs, GenerationInput const& inputs, SamplingConfig const& samplingConfig);
+
+    //! @brief   Generates with speculative decoding, `draftSession` runs the draft model.
+    //! @details Each iteration the draft model generates `numDraftTokens` tokens per request, and this session
+    //!          verifies them in a single pass of the target model. Draft tokens are accepted up to the first one that
+    //!          differs from the greedy token of the target model, which is appended in its place, so each iteration
+    //!          adds between 1 and `numDraftTokens + 1` tokens per request. Both sessions keep the keys and values of
+    //!          the sequences in their KV caches across iterations and roll back the rejected tokens, so that a pass
+    //!          only runs the new tokens: at most `numDraftTokens + 1` per request after the prompts. Both engines
+    //!          need the GPT attention plugin, packed inputs, a paged KV cache and paged context FMHA, and the target
+    //!          engine must output context logits. Both sessions must fit the longest sequence plus
+    //!          `numDraftTokens`, without a cyclic KV cache. Only greedy acceptance with beam width 1 is supported.
+    void generateSpeculative(GenerationOutput& outputs, GenerationInput const& inputs,
+        SamplingConfig const& samplingConfig, GptSession& draftSession, SizeType numDraftTokens);
+
+    //! @brief   Generates with speculative decoding, the drafts are looked up in the sequences instead of generated.
+    //! @details Each iteration the last tokens of each sequence are matched against its earlier tokens, prompt and
+    //!          output, and the up to `numDraftTokens` tokens that followed the most recent match are the draft,
+    //!          see `lookupDraftTokens`. The drafts are verified as in `generateSpeculative`, without a draft model,
+    //!          which pays off when the output copies spans of the input, e.g. summarization or code editing.
+    void generatePromptLookup(GenerationOutput& outputs, GenerationInput const& inputs,
+        SamplingConfig const& samplingConfig, SizeType numDraftTokens, SizeType maxNgramSize = 3);
+
+    //! @brief   The draft of prompt lookup decoding for `sequence`, at most `numDraftTokens` tokens.
+    //! @details The longest suffix of `sequence` of at most `maxNgramSize` tokens that occurs earlier in it is matched,
+    //!          the tokens following its most recent occurrence are the draft. Empty if no suffix occurs earlier.
+    [[nodiscard]] static std::vector<TokenIdType> lookupDraftTokens(
+        std::vector<TokenIdType> const& sequence, SizeType numDraftTokens, SizeType maxNgramSize);
+
+    //! @brief   Runs the context phase of the requests only and writes their pooled hidden states to `embeddings`, a
+    //!          float device tensor of shape [batchSize, hiddenSize].
+    //! @details The engine must be built with `output_hidden_states`, so that it skips the LM head and returns the
+    //!          hidden states of all the tokens. No logits are computed, no decoder is set up and the KV cache only
+    //!          holds the tokens of the inputs until the call returns. `embeddings` is only written on the last
+    //!          pipeline parallel rank.
+    void encode(TensorPtr const& embeddings, GenerationInput const& inputs, PoolingType pooling = PoolingType::kLAST);
+
+    //! @brief   Makes the engines of both sessions share the activation memory of their execution contexts.
+    //! @details The larger of the two activation buffers is kept, the other one is freed. The sessions must be on the
+    //!          same device and must not generate concurrently afterwards, e.g. the target and draft sessions of
+    //!          `generateSpeculative`.
+    void shareEngineWorkspace(GptSession& other);
+
+    //! @brief   Replaces the weights of the engine by the ones of a fine-tune of the same model, without rebuilding it.
+    //! @details The engine must be built with use_refit, `weights` are the ones of the rank of the session, see
+    //!          EngineWeights. Call it between `generate` calls, not while an asynchronous call is pending: the calls
+    //!          before use the previous weights and the calls after the new ones. The captured CUDA graphs are
+    //!          dropped and captured again by the next steps.
+    void refit(EngineWeights const& weights);
+
+    //! @brief Reads the weights of a safetensors file, then refits the engine with them.
+    void refit(std::string const& weightsFile)
+    {
+        refit(EngineWeights{weightsFile});
+    }
+
+    //! @brief   Saves the batch shapes this session has generated with to a JSON file, for `warmUp`.
+    //! @details Call it once the session serves its steady load, e.g. from one replica of a fleet.
+    void saveWarmUpState(std::string const& path) const;
+
+    //! @brief   Generates a few tokens from dummy inputs for each batch shape saved by `saveWarmUpState`, so that the
+    //!          first requests of a new replica of the engine run at steady-state speed.
+    //! @details The CUDA graphs of the shapes are captured, the plugins and the libraries initialize what they only
+    //!          initialize on first use and the allocations of the steps are made. Captured graphs cannot be saved,
+    //!          they are captured again. The tactics of the GEMM plugins are already cached on disk, see
+    //!          TRTLLM_GEMM_PROFILE_CACHE_DIR. The session has the limits of the one that saved the file, and all
+    //!          its ranks call it with the same file.
+    void warmUp(std::string const& path);
+
+    //! @brief   Checks whether all sequences finished only every `interval` generation steps, 1 by default, so that the
+    //!          host does not wait for the decoder at every step.
+    //! @details Up to `interval - 1` steps run after the last sequence finished. Call it between `generate` calls.
+    void setStopCheckInterval(SizeType interval);
+
+    //! @brief   Times the layers of one in every `interval` engine enqueues with the TensorRT profiler, 0 disables it.
+    //! @details Defaults to TRTLLM_LAYER_PROFILING_INTERVAL. A profiled enqueue synchronizes the stream, so that an
+    //!          interval of a few hundred steps keeps the overhead small enough to leave it on.
+    void setLayerProfilingInterval(SizeType interval);
+
+    //! @brief Duration of the layers by kind over the enqueues profiled since the last call, which clears them.
+    [[nodiscard]] LayerProfileStats collectLayerProfile();
+
+    //! @brief   Reads the DRAM bandwidth, SM and tensor core utilization of the GPU around one in every `interval`
+    //!          context and generation steps, 0 disables it.
+    //! @details Defaults to TRTLLM_GPU_METRICS_INTERVAL. The metrics are read with NVML GPU performance monitoring,
+    //!          available on Hopper and newer GPUs, and are not sampled on the others. A sampled step synchronizes the
+    //!          stream before and after the engine runs.
+    void setGpuMetricsInterval(SizeType interval);
+
+    //! @brief GPU metrics by phase over the steps sampled since the last call, which clears them.
+    [[nodiscard]] GpuMetricsStats collectGpuMetrics();
+
+    //! @brief   Statistics of the collectives of each step of the last `generate` call, the context step being 0.
+    //! @details Empty unless the `CommProfiler` is enabled, e.g. with TRTLLM_COMM_PROFILING=1. The profiler times the
+    //!          collectives of the whole process, the ones of the sessions generating at the same time are mixed.
+    [[nodiscard]] std::vector<common::CommIterationStats> const& getCommStats() const;
+
+    //! @brief   Duration on the GPU of each step of the last `generate` call, the context step being 0.
+    //! @details Empty unless the `CommProfiler` is enabled, to compare the steps with their collectives.
+    [[nodiscard]] std::vector<float> const& getStepTimes() const;
+
+    //! @brief Acceptance of the draft tokens during the last `generateSpeculative` or `generatePromptLookup` call.
+    [[nodiscard]] SpeculativeDecodingStats const& getSpeculativeDecodingStats() const;
+
 private:
     [[nodiscard]] bool useCudaGraphs()
     {
-        return !mCudaGraphInstances.empty();
+        return mCudaGraphMode;
     }
 
+    //! @brief The members of the session added after its layout was fixed by the prebuilt batch manager.
+    struct State;
+
+    [[nodiscard]] State& getState() const;
+
     void generateBatched(std::vector<GenerationOutput>& microBatchesOutputs,
         std::vector<GenerationInput> const& microBatchesInputs, SamplingConfig const& samplingConfig,
-        TokenGeneratedCallback const& onTokenGenerated);
+        TruncationConfig const& truncationConfig, TokenGeneratedCallback const& onTokenGenerated);
+
+    //! Returns the draft tokens of the active requests, given their sequences and the number of tokens they have room
+    //! for. Drafts may be shorter or empty.
+    using DraftTokensFunction = std::function<std::vector<std::vector<TokenIdType>>(std::vector<SizeType> const& active,
+        std::vector<std::vector<TokenIdType>> const& sequences, std::vector<SizeType> const& maxNumsDraftTokens)>;
+
+    void generateWithDrafts(GenerationOutput& outputs, GenerationInput const& inputs,
+        SamplingConfig const& samplingConfig, SizeType numDraftTokens, DraftTokensFunction const& draftTokensOf);
+
+    //! @brief Checks that the engine and the session support `executeCachedContextStep` for speculative decoding.
+    void checkCachedContextSteps(SizeType batchSize, SizeType numDraftTokens) const;
+
+    //! @brief   Runs `tokens[i]` of request i after the `pastLengths[i]` tokens that the KV cache holds for it in slot
+    //!          `batchSlots[i]`, and writes their keys and values after them.
+    //! @return  The logits of all the tokens if the engine outputs context logits, else of the last token of each
+    //!          request.
+    TensorPtr executeCachedContextStep(std::vector<std::vector<TokenIdType>> const& tokens,
+        std::vector<SizeType> const& pastLengths, std::vector<SizeType> const& batchSlots);
+
+    //! @brief Accepts the draft tokens of each request up to the first one that differs from the greedy token of
+    //! `logits`, see kernels::invokeAcceptDraftTokensByArgmax, row `logitsRows[i]` predicting the first draft token of
+    //! request i. Returns the accepted tokens of each request followed by the greedy token after them.
+    std::vector<std::vector<TokenIdType>> acceptDraftTokens(ITensor const& logits,
+        std::vector<SizeType> const& logitsRows, std::vector<std::vector<TokenIdType>> const& draftTokens,
+        TokenIdType padId);
 
-    void setup(Config const& sessionConfig);
+    void setup(Config const& sessionConfig, Options const& options);
+
+    //! @brief A context a phase may run on, with the shapes of the tokens input its profile accepts.
+    struct PhaseContext
+    {
+        SizeType contextId;
+        nvinfer1::Dims minShape;
+        nvinfer1::Dims maxShape;
+    };
 
     void createContexts();
-    void createBuffers(SizeType numMicroBatches);
+    //! @brief Returns the first of the contexts of a phase whose profile accepts the tokens input of the step.
+    //! @details The steps of a phase only differ in their numbers of sequences and tokens, which the tokens input
+    //! spans. The contexts are ordered by createContexts(), the step does not rank the profiles again.
+    [[nodiscard]] SizeType selectContext(
+        StringPtrMap<ITensor> const& inputBuffer, std::vector<PhaseContext> const& phaseContexts) const;
+    void createBuffers(SizeType numMicroBatches, bool useBufferArena);
     void createDecoders(SizeType batchSize, SizeType beamWidth, SizeType maxAttentionWindow, SizeType maxSequenceLength,
         nvinfer1::DataType logitsType, bool decoderPerRequest, SizeType numMicroBatches);
     void createKvCacheManager(SizeType batchSize, SizeType beamWidth, SizeType maxAttentionWindow,
         SizeType maxSequenceLength, KvCacheConfig const& config);
+    //! @brief Runs a worst-case step on a KV cache just large enough for it, then replaces the cache by one sized from
+    //! the memory left.
+    void calibrateKvCache(SizeType batchSize, SizeType beamWidth, SizeType maxAttentionWindow,
+        SizeType maxSequenceLength, SizeType inputLength, KvCacheConfig const& config, std::size_t margin);
     void createCustomAllReduceWorkspace(SizeType batchSize, SizeType beamWidth, SizeType maxSequenceLength);
 
+    void encodeBatched(TensorPtr const& embeddings, GenerationInput const& inputs, PoolingType pooling);
+
+    //! @brief Runs the engine on a context batch, `batchOffset` is the index of its first request in the KV cache.
+    void executeContextBatch(RuntimeBuffers& buffers, TensorPtr const& inputIds, TokenIdType padId,
+        KvCacheManager const* kvCacheManager, SizeType batchOffset);
     void executeContextStep(std::vector<GenerationInput> const& microBatchesInputs,
         std::vector<GenerationOutput>& microBatchesOutputs, std::vector<SizeType> const& microBatchOffsets,
         KvCacheManager const* kvCacheManager);
@@ -158,9 +439,16 @@ private:
         std::vector<GenerationOutput>& microBatchesOutputs, std::vector<SizeType> const& microBatchOffsets,
         KvCacheManager* kvCacheManager, std::vector<bool>& microBatchesFinished);
 
+    //! @brief Gather the top log probs of `step` from the logits into `outputs` when they are requested.
+    void gatherTopLogProbs(GenerationOutput& outputs, ITensor const& logits, SizeType step) const;
+
     //! @brief Execute decoder on last PP rank, receive decoder output on other PP ranks.
     void decoderStepAsync(SizeType decoderStep, SizeType microBatchId);
 
+    //! @brief Sets whether the attention layers collect the absmax of the keys and values in the next step, see
+    //! Options::kvCacheScaleSampleInterval.
+    void sampleKvCacheScales();
+
     //! @brief Synchronize with the decoder and return the `shouldStop` flag.
     bool shouldStopSync(SizeType batchSize, SizeType beamWidth, SizeType microBatchId);
 
@@ -172,7 +460,7 @@ private:
 
     //! @brief Populate outputIds and return reference to newTokens tensor
     ITensor::SharedPtr initDecoder(ITensor& outputIds, GenerationInput const& inputs, GenerationOutput const& outputs,
-        SamplingConfig const& samplingConfig, SizeType microBatchId) const;
+        SamplingConfig const& samplingConfig, TruncationConfig const& truncationConfig, SizeType microBatchId) const;
 
     TokenGeneratedCallback createOnTokenGeneratedCallback(GenerationOutput& outputs);
 
@@ -210,6 +498,38 @@ private:
         cudaGraphExec_t mInstance;
     };
 
+    //! @brief LRU cache of graph instances keyed by batch size and beam width. When the batch shape changes, the
+    //!        instance captured for that shape is updated instead of instantiating a new graph.
+    class CudaGraphExecutorCache
+    {
+    public:
+        using BatchState = std::pair<SizeType, SizeType>;
+
+        explicit CudaGraphExecutorCache(SizeType capacity)
+            : mCapacity{capacity}
+        {
+        }
+
+        //! @brief Returns the instance of state, adds an empty one if there is none.
+        CudaGraphExecutor& get(BatchState const& state);
+
+        void clear()
+        {
+            mMap.clear();
+            mCache.clear();
+        }
+
+    private:
+        using Entry = std::pair<BatchState, std::unique_ptr<CudaGraphExecutor>>;
+
+        SizeType mCapacity;
+        // most recently used first
+        std::list<Entry> mCache;
+        std::map<BatchState, std::list<Entry>::iterator> mMap;
+    };
+
+    class GenerateWorker;
+
     class MicroBatchConfig
     {
     public:
@@ -244,7 +564,7 @@ private:
     friend class batch_manager::TrtGptModelV1;
 
 private:
-    GptModelConfig const mModelConfig;
+    GptModelConfig mModelConfig;
     WorldConfig const mWorldConfig;
     int mDevice{-1};
     std::shared_ptr<NcclCommunicator> mPipelineComm;
@@ -269,7 +589,7 @@ private:
     std::vector<CudaEvent> mReceivedEvents;
 
     bool mCudaGraphMode{false};
-    // ping-pong instances
+    // ping-pong instances, unused since the instances are cached by batch shape in State::cudaGraphInstances
     std::vector<CudaGraphExecutor> mCudaGraphInstances;
 };
 
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief Phase of the engine step around which the GPU metrics are sampled.
+enum class GpuPhase : std::int32_t
+{
+    kCONTEXT = 0,
+    kGENERATION = 1,
+};
+
+std::size_t constexpr kNbGpuPhases = 2;
+
+//! \brief Hardware counters read by the GPU metrics sampler, each a percentage of the peak of the device.
+enum class GpuMetric : std::int32_t
+{
+    // DRAM bandwidth
+    kDRAM_BW_UTIL = 0,
+    // Cycles with at least one warp on the SM
+    kSM_UTIL = 1,
+    // Warps resident on the SMs out of the maximum
+    kSM_OCCUPANCY = 2,
+    // Cycles with any tensor core pipe active
+    kTENSOR_UTIL = 3,
+};
+
+std::size_t constexpr kNbGpuMetrics = 4;
+
+[[nodiscard]] char const* getGpuPhaseName(GpuPhase phase);
+
+[[nodiscard]] char const* getGpuMetricName(GpuMetric metric);
+
+//! \brief Sampled steps of one phase, their total duration and the metrics weighted by the duration of each step.
+struct GpuPhaseMetrics
+{
+    std::uint64_t numSamples{0};
+    double timeMs{0.};
+    std::array<double, kNbGpuMetrics> weightedSums{};
+
+    //! \brief Average of a metric over the sampled steps, in percent.
+    [[nodiscard]] double getAverage(GpuMetric metric) const
+    {
+        return timeMs > 0. ? weightedSums[static_cast<std::size_t>(metric)] / timeMs : 0.;
+    }
+
+    void add(double sampleTimeMs, std::array<double, kNbGpuMetrics> const& values)
+    {
+        ++numSamples;
+        timeMs += sampleTimeMs;
+        for (std::size_t metric = 0; metric < kNbGpuMetrics; ++metric)
+        {
+            weightedSums[metric] += values[metric] * sampleTimeMs;
+        }
+    }
+};
+
+//! \brief GPU hardware metrics by phase, over the steps sampled by the GPU metrics sampler of a `GptSession`.
+struct GpuMetricsStats
+{
+    std::array<GpuPhaseMetrics, kNbGpuPhases> phases{};
+
+    [[nodiscard]] GpuPhaseMetrics const& operator[](GpuPhase phase) const
+    {
+        return phases[static_cast<std::size_t>(phase)];
+    }
+
+    [[nodiscard]] GpuPhaseMetrics& operator[](GpuPhase phase)
+    {
+        return phases[static_cast<std::size_t>(phase)];
+    }
+
+    [[nodiscard]] std::uint64_t getNumSamples() const
+    {
+        std::uint64_t total{0};
+        for (auto const& phase : phases)
+        {
+            total += phase.numSamples;
+        }
+        return total;
+    }
+
+    void add(GpuMetricsStats const& other)
+    {
+        for (std::size_t phase = 0; phase < kNbGpuPhases; ++phase)
+        {
+            phases[phase].numSamples += other.phases[phase].numSamples;
+            phases[phase].timeMs += other.phases[phase].timeMs;
+            for (std::size_t metric = 0; metric < kNbGpuMetrics; ++metric)
+            {
+                phases[phase].weightedSums[metric] += other.phases[phase].weightedSums[metric];
+            }
+        }
+    }
+};
+
+} // namespace tensorrt_llm::runtime
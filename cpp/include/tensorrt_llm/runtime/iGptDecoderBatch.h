@@ -115,6 +115,9 @@ public:
     // parameters for beam search
     TensorConstPtr cacheIndirection; // [batchSize, maxBeamWidth, maxSeqLen] - indices into KV cache of different rays
                                      // within one beam for beam search, on gpu
+
+    // optional parameters, after the members of the layout of the prebuilt batch manager
+    TensorConstPtr logitsBitmask; // [batchSize, ceil(vocabSizePadded / 32)], allowed tokens of each request, on gpu
 };
 
 using Output = decoder::Output;
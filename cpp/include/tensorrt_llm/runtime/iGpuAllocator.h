@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cuda_runtime_api.h>
+
+#include <cstddef>
+#include <memory>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief An allocator of GPU memory that `BufferManager` uses instead of the stream-ordered memory pool of CUDA.
+//!
+//! When the runtime is embedded in a process with its own caching allocator, e.g. PyTorch, allocating from it keeps a
+//! single pool of GPU memory instead of two pools that hold on to their free memory and fragment the device.
+class IGpuAllocator
+{
+public:
+    using SharedPtr = std::shared_ptr<IGpuAllocator>;
+
+    virtual ~IGpuAllocator() = default;
+
+    //! \brief Allocates `size` bytes to be used on `stream`.
+    [[nodiscard]] virtual void* allocate(std::size_t size, ::cudaStream_t stream) = 0;
+
+    //! \brief Frees an allocation of `allocate`, after the work enqueued on its stream so far.
+    virtual void deallocate(void* ptr, std::size_t size, ::cudaStream_t stream) = 0;
+
+    //! \brief The current size of the memory reserved by the allocator, used or cached.
+    [[nodiscard]] virtual std::size_t reserved() const = 0;
+
+    //! \brief The current size of the memory used by the allocations.
+    [[nodiscard]] virtual std::size_t used() const = 0;
+
+    //! \brief The largest size of the memory used by the allocations since the last `resetUsedHigh`.
+    [[nodiscard]] virtual std::size_t usedHigh() const = 0;
+
+    //! \brief Resets the largest size of the memory used by the allocations to the current one.
+    virtual void resetUsedHigh() = 0;
+
+    //! \brief Releases the cached memory to the device, so that it can be allocated by others.
+    virtual void releaseCached() = 0;
+};
+
+} // namespace tensorrt_llm::runtime
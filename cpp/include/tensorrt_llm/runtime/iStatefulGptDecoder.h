@@ -51,6 +51,9 @@ public:
 
     // parameters for beam search
     TensorPtr cacheIndirection; // [batchSize, maxBeamWidth, maxSeqLen] - the k/v cache index for beam search, on gpu
+
+    // optional parameters, after the members of the layout of the prebuilt batch manager
+    TensorPtr logitsBitmask; // [batchSize, ceil(vocabSizePadded / 32)], allowed tokens of each request, on gpu
 };
 
 class Output
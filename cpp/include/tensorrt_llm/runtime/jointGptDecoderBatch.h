@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/gptDecoderBatch.h"
+
+#include <memory>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+//! GPT decoder class with support for in-flight batching that decodes the requests of all slots with one decoder call
+//! per step instead of one call per request. Requests with beam search, draft tokens, an embedding bias, bad or stop
+//! words, log probs or top P decay keep using their own decoder.
+class JointGptDecoderBatch : public GptDecoderBatch
+{
+public:
+    JointGptDecoderBatch(std::size_t vocabSize, std::size_t vocabSizePadded, CudaStreamPtr stream);
+
+    //! Setup the decoder before calling `forward()`
+    void setup(SizeType maxBatchSize, SizeType maxBeamWidth, SizeType maxAttentionWindow, SizeType maxSequenceLength,
+        SizeType maxTokensPerStep, nvinfer1::DataType dtype) override;
+
+    //! @brief Initialize the decoder at `batchIdx` with a new `request`.
+    void newRequest(
+        SizeType batchIdx, decoder_batch::Request const& request, SamplingConfig const& samplingConfig) override;
+
+    using GptDecoderBatch::forwardAsync;
+
+    TokenPtr forwardAsync(decoder_batch::Output& output, decoder_batch::Input const& input) override;
+
+private:
+    //! @brief Decode all active requests in slots of `mJointSlots` with `mJointDecoder` in one call.
+    void forwardJointAsync(decoder_batch::Input const& input, TensorPtr const& sequenceLengths);
+
+    GptDecoderPtr mJointDecoder;           // decodes the requests of mJointSlots in one call, on mStream
+    SamplingConfig mJointSamplingConfig;   // [maxBatchSize] sampling parameters of the slots of mJointDecoder
+    std::vector<SizeType> mJointSeedSlots; // slots whose random states are initialized by the next setup
+    std::vector<bool> mJointSlots;         // [maxBatchSize] true if the request of the slot uses mJointDecoder
+    TensorPtr mJointLogits;                // [maxBatchSize, 1, vocabPadded], logits gathered if not contiguous, on gpu
+    TensorPtr mJointFinished;              // [maxBatchSize, 1], finished states with skipped slots, on gpu
+    TensorPtr mJointSkipSlots;             // [maxBatchSize], slots skipped by mJointDecoder, on gpu
+    TensorPtr mSkipDecodingStates;         // [maxBatchSize], skip decoding finished states, on gpu
+};
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief Kind of a layer of the engine, derived from its name.
+enum class LayerKind : std::int32_t
+{
+    // GPT and BERT attention plugins
+    kATTENTION = 0,
+    // Matrix multiplications, plugins and native layers
+    kGEMM = 1,
+    // All-reduce, all-gather and the pipeline parallel send and receive
+    kCOLLECTIVE = 2,
+    kOTHER = 3,
+};
+
+std::size_t constexpr kNbLayerKinds = 4;
+
+[[nodiscard]] char const* getLayerKindName(LayerKind kind);
+
+//! \brief Number of layers of one kind run in the profiled enqueues and their total duration on the GPU.
+struct LayerKindStats
+{
+    std::uint64_t count{0};
+    float timeMs{0.F};
+};
+
+//! \brief Duration of the layers of the engine by kind, over the enqueues sampled by the layer profiler of a
+//! `TllmRuntime`.
+struct LayerProfileStats
+{
+    std::uint64_t numProfiledEnqueues{0};
+    std::array<LayerKindStats, kNbLayerKinds> kinds{};
+
+    [[nodiscard]] LayerKindStats const& operator[](LayerKind kind) const
+    {
+        return kinds[static_cast<std::size_t>(kind)];
+    }
+
+    [[nodiscard]] LayerKindStats& operator[](LayerKind kind)
+    {
+        return kinds[static_cast<std::size_t>(kind)];
+    }
+
+    [[nodiscard]] float getTotalTimeMs() const
+    {
+        float total{0.F};
+        for (auto const& kind : kinds)
+        {
+            total += kind.timeMs;
+        }
+        return total;
+    }
+
+    void add(LayerProfileStats const& other)
+    {
+        numProfiledEnqueues += other.numProfiledEnqueues;
+        for (std::size_t kind = 0; kind < kNbLayerKinds; ++kind)
+        {
+            kinds[kind].count += other.kinds[kind].count;
+            kinds[kind].timeMs += other.kinds[kind].timeMs;
+        }
+    }
+};
+
+} // namespace tensorrt_llm::runtime
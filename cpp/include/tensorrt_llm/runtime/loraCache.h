@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <NvInferRuntime.h>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief Keeps the weights of the most recently used LoRA adapters in a paged GPU pool, the others stay in pinned
+//! host memory.
+//!
+//! Each weight matrix of an adapter takes a page of the pool. A missing adapter is loaded on the copy stream by
+//! `tryLoad`, which evicts the least recently used adapters that no request holds. `tryLoad` never blocks: a scheduler
+//! keeps a request waiting until it returns true, and the other requests run in the meantime.
+//!
+//! Not thread safe, all the calls are meant to come from the scheduling thread.
+class LoraCache
+{
+public:
+    using TaskIdType = std::uint64_t;
+    using TensorPtr = ITensor::SharedPtr;
+
+    //! \param numPages Number of pages of the GPU pool.
+    //! \param pageSize Number of elements of a page, at least those of the largest weight matrix of an adapter.
+    //! \param type Data type of the weights.
+    //! \param copyStream Stream of the host to device copies, separate from the compute stream so that the copies
+    //! overlap the steps.
+    LoraCache(
+        SizeType numPages, std::size_t pageSize, nvinfer1::DataType type, BufferManager::CudaStreamPtr copyStream);
+
+    //! \brief Registers the weights of an adapter, one tensor in pinned memory per weight matrix. The adapter is not
+    //! loaded until `tryLoad`.
+    void put(TaskIdType taskId, std::vector<TensorPtr> hostWeights);
+
+    //! \brief Whether the adapter has been registered with `put`.
+    [[nodiscard]] bool contains(TaskIdType taskId) const
+    {
+        return mAdapters.find(taskId) != mAdapters.end();
+    }
+
+    //! \brief Whether the adapter is resident on the GPU and its weights can be used.
+    //!
+    //! Otherwise, starts loading it if enough pages are free or held by evictable adapters, and returns false. The
+    //! adapter is resident once its copy has completed, a later call returns true.
+    [[nodiscard]] bool tryLoad(TaskIdType taskId);
+
+    //! \brief Prevents the eviction of a resident adapter while a request uses it.
+    void acquire(TaskIdType taskId);
+
+    //! \brief Allows the eviction of the adapter once no request holds it. Its pages are overwritten only after the
+    //! work enqueued on `stream` until now, e.g. the last step that used the adapter.
+    void release(TaskIdType taskId, CudaStream const& stream);
+
+    //! \brief Device addresses of the weights of a resident adapter, in the order given to `put`.
+    [[nodiscard]] std::vector<void const*> getWeightPointers(TaskIdType taskId) const;
+
+    //! \brief Drops the host weights and the pages of an adapter that no request holds.
+    void erase(TaskIdType taskId);
+
+    [[nodiscard]] SizeType getNumPages() const
+    {
+        return mNumPages;
+    }
+
+    [[nodiscard]] SizeType getNumFreePages() const
+    {
+        return static_cast<SizeType>(mFreePages.size());
+    }
+
+    [[nodiscard]] std::size_t getPageSize() const
+    {
+        return mPageSize;
+    }
+
+    //! \brief Number of adapters loaded on the GPU since the construction.
+    [[nodiscard]] std::size_t getNumLoads() const
+    {
+        return mNumLoads;
+    }
+
+    //! \brief Number of adapters evicted from the GPU since the construction.
+    [[nodiscard]] std::size_t getNumEvictions() const
+    {
+        return mNumEvictions;
+    }
+
+private:
+    struct Adapter
+    {
+        std::vector<TensorPtr> hostWeights;
+        std::vector<SizeType> pages;
+        //! Recorded on the copy stream after the copies, null once they are known to be complete
+        std::unique_ptr<CudaEvent> loadEvent;
+        //! Recorded by `release` on the stream of the last use
+        std::shared_ptr<CudaEvent> lastUse;
+        SizeType refCount{0};
+        //! Position in mLru, valid while the adapter has pages
+        std::list<TaskIdType>::iterator lruIt;
+    };
+
+    [[nodiscard]] static bool hasPages(Adapter const& adapter)
+    {
+        return !adapter.pages.empty();
+    }
+
+    [[nodiscard]] bool isEvictable(Adapter const& adapter) const;
+
+    void evict(TaskIdType taskId, Adapter& adapter);
+
+    void touch(Adapter& adapter);
+
+    SizeType mNumPages;
+    std::size_t mPageSize;
+    nvinfer1::DataType mType;
+    BufferManager::CudaStreamPtr mCopyStream;
+    BufferManager mManager;
+    IBuffer::SharedPtr mPool;
+    std::vector<SizeType> mFreePages;
+    std::unordered_map<TaskIdType, Adapter> mAdapters;
+    //! Adapters with pages, the most recently used first
+    std::list<TaskIdType> mLru;
+    //! Last uses of the pages freed by evictions, waited for by the next copies
+    std::vector<std::shared_ptr<CudaEvent>> mPendingUses;
+    std::size_t mNumLoads{0};
+    std::size_t mNumEvictions{0};
+};
+
+} // namespace tensorrt_llm::runtime
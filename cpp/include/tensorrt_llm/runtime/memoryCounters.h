@@ -20,12 +20,37 @@
 #include "tensorrt_llm/runtime/iBuffer.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <string>
 
 namespace tensorrt_llm::runtime
 {
 
+//! \brief Owner of the memory of a buffer, the one of the `MemoryCounters::TagScope` in which its allocator is created.
+enum class MemoryTag : std::int32_t
+{
+    kUNTAGGED = 0,
+    // Allocated by TensorRT when the engine is deserialized, estimated by the size of the plan
+    kENGINE_WEIGHTS = 1,
+    // Activations of the execution contexts
+    kENGINE_WORKSPACE = 2,
+    kKV_CACHE = 3,
+    // Inputs and outputs of the engine, see RuntimeBuffers
+    kRUNTIME_BUFFERS = 4,
+    kDECODER = 5,
+    // Temporaries of the steps, see ScratchArena
+    kSCRATCH = 6,
+    // Weights of the resident LoRA adapters, see LoraCache
+    kLORA_CACHE = 7,
+    // Tables of the cached prompt tuning tasks, see PromptTuningTableCache
+    kPROMPT_TABLE_CACHE = 8,
+};
+
+std::size_t constexpr kNbMemoryTags = 9;
+
+[[nodiscard]] char const* getMemoryTagName(MemoryTag tag);
+
 class MemoryCounters
 {
 public:
@@ -49,6 +74,60 @@ public:
         return mPinned;
     }
 
+    //! \brief Pinned memory held by the pool of the pinned buffers of all the threads, used or kept for reuse.
+    [[nodiscard]] static SizeType getPinnedPoolReserved();
+
+    //! \brief Pinned memory of the buffers of all the threads allocated from the pool, rounded up to its size classes.
+    [[nodiscard]] static SizeType getPinnedPoolUsed();
+
+    //! \brief Number of pinned buffers that reused a block of the pool, and that allocated pinned memory.
+    [[nodiscard]] static std::uint64_t getPinnedPoolHits();
+
+    [[nodiscard]] static std::uint64_t getPinnedPoolMisses();
+
+    //! \brief Memory of the type allocated with the tag by all the threads.
+    [[nodiscard]] static SizeType getTagged(MemoryType memoryType, MemoryTag tag)
+    {
+        return getTaggedCounter(memoryType, tag).load(std::memory_order_relaxed);
+    }
+
+    //! \brief Highest memory of the type allocated with the tag since the last `resetPeaks`.
+    [[nodiscard]] static SizeType getTaggedPeak(MemoryType memoryType, MemoryTag tag);
+
+    //! \brief Highest memory of the type allocated with all the tags at once since the last `resetPeaks`.
+    [[nodiscard]] static SizeType getPeak(MemoryType memoryType);
+
+    //! \brief Restarts the peaks from the memory allocated now.
+    static void resetPeaks();
+
+    //! \brief Tag of the allocators created by the thread.
+    [[nodiscard]] static MemoryTag getCurrentTag() noexcept
+    {
+        return mCurrentTag;
+    }
+
+    //! \brief Tags the allocators created by the thread during its lifetime. Scopes are nested.
+    class TagScope
+    {
+    public:
+        explicit TagScope(MemoryTag tag) noexcept
+            : mPrevious{mCurrentTag}
+        {
+            mCurrentTag = tag;
+        }
+
+        ~TagScope()
+        {
+            mCurrentTag = mPrevious;
+        }
+
+        TagScope(TagScope const&) = delete;
+        TagScope& operator=(TagScope const&) = delete;
+
+    private:
+        MemoryTag mPrevious;
+    };
+
     [[nodiscard]] DiffType getGpuDiff() const
     {
         return mGpuDiff;
@@ -65,9 +144,10 @@ public:
     }
 
     template <MemoryType T>
-    void allocate(SizeType size)
+    void allocate(SizeType size, MemoryTag tag = MemoryTag::kUNTAGGED)
     {
         auto const sizeDiff = static_cast<DiffType>(size);
+        updateTagged(T, tag, sizeDiff);
         if constexpr (T == MemoryType::kGPU)
         {
             mGpu += size;
@@ -89,12 +169,13 @@ public:
         }
     }
 
-    void allocate(MemoryType memoryType, SizeType size);
+    void allocate(MemoryType memoryType, SizeType size, MemoryTag tag = MemoryTag::kUNTAGGED);
 
     template <MemoryType T>
-    void deallocate(SizeType size)
+    void deallocate(SizeType size, MemoryTag tag = MemoryTag::kUNTAGGED)
     {
         auto const sizeDiff = -static_cast<DiffType>(size);
+        updateTagged(T, tag, sizeDiff);
         if constexpr (T == MemoryType::kGPU)
         {
             mGpu -= std::min(size, mGpu);
@@ -116,7 +197,7 @@ public:
         }
     }
 
-    void deallocate(MemoryType memoryType, SizeType size);
+    void deallocate(MemoryType memoryType, SizeType size, MemoryTag tag = MemoryTag::kUNTAGGED);
 
     static MemoryCounters& getInstance()
     {
@@ -129,10 +210,19 @@ public:
 
     std::string toString() const;
 
+    //! \brief Memory of the type allocated by all the threads, by tag, omitting the tags without memory.
+    static std::string toTaggedString(MemoryType memoryType = MemoryType::kGPU);
+
 private:
+    static std::atomic<SizeType>& getTaggedCounter(MemoryType memoryType, MemoryTag tag);
+
+    //! \brief Updates the counter of the tag, the total of the type and their peaks.
+    static void updateTagged(MemoryType memoryType, MemoryTag tag, DiffType sizeDiff);
+
     SizeType mGpu{}, mCpu{}, mPinned{};
     DiffType mGpuDiff{}, mCpuDiff{}, mPinnedDiff{};
     static thread_local MemoryCounters mInstance;
+    static thread_local MemoryTag mCurrentTag;
 };
 
 } // namespace tensorrt_llm::runtime
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+#include "tensorrt_llm/runtime/promptTuningParams.h"
+
+#include <NvInferRuntime.h>
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief Keeps the prompt embedding tables of the most recently used prompt-tuning tasks on the GPU, so that the
+//! requests of a cached task cost no copy.
+//!
+//! The tables are slots of one pool of `numSlots * taskVocabSize` rows. The pool is the `prompt_embedding_table` input
+//! of the engine, the tasks of a batch are mapped to their slots and the lookup of the engine reads the cached rows.
+//! The copies are enqueued on the stream of the steps, so a slot is only overwritten after the steps enqueued before
+//! that read it. The engine must be built with `max_prompt_embedding_table_size` of at least
+//! `numSlots * taskVocabSize`.
+//!
+//! Not thread safe, all the calls are meant to come from the thread that prepares the batches.
+class PromptTuningTableCache
+{
+public:
+    using TaskIdType = SizeType;
+    using TensorPtr = ITensor::SharedPtr;
+    //! \brief Table of a task, [taskVocabSize, hiddenSize] on the host or the GPU, only called for the tasks that are
+    //! not cached. The table must stay valid until the stream has run the copy.
+    using TableGetter = std::function<TensorPtr(TaskIdType)>;
+
+    //! \param stream Stream of the steps that read the pool.
+    PromptTuningTableCache(SizeType numSlots, SizeType taskVocabSize, SizeType hiddenSize, nvinfer1::DataType type,
+        BufferManager::CudaStreamPtr stream);
+
+    //! \brief Replaces the task ids of the requests of a batch with prompt tuning by the slots of their tables, in
+    //! place, and sets the pool as the embedding table of `params`.
+    //!
+    //! The tables of the tasks that are not cached are copied from `getTable`, evicting the least recently used tasks
+    //! that the batch does not use. The batch can use at most `numSlots` different tasks.
+    //! \param tasksHost Task ids of the requests, [batchSize] on the host, as given to `fillTasksTensor`.
+    void mapTasks(PromptTuningParams& params, ITensor& tasksHost, TableGetter const& getTable);
+
+    [[nodiscard]] bool contains(TaskIdType taskId) const
+    {
+        return mTasks.find(taskId) != mTasks.end();
+    }
+
+    //! \brief Frees the slot of a task, e.g. when its table changes.
+    void erase(TaskIdType taskId);
+
+    //! \brief Pool of the tables, [numSlots * taskVocabSize, hiddenSize].
+    [[nodiscard]] TensorPtr const& getEmbeddingTable() const
+    {
+        return mTable;
+    }
+
+    [[nodiscard]] SizeType getNumSlots() const
+    {
+        return mNumSlots;
+    }
+
+    //! \brief Number of tables copied since the construction.
+    [[nodiscard]] std::size_t getNumLoads() const
+    {
+        return mNumLoads;
+    }
+
+    //! \brief Number of requests whose table was cached since the construction.
+    [[nodiscard]] std::size_t getNumHits() const
+    {
+        return mNumHits;
+    }
+
+private:
+    struct Task
+    {
+        SizeType slot;
+        //! Position in mLru
+        std::list<TaskIdType>::iterator lruIt;
+    };
+
+    SizeType load(TaskIdType taskId, TableGetter const& getTable);
+
+    SizeType mNumSlots;
+    SizeType mTaskVocabSize;
+    SizeType mHiddenSize;
+    nvinfer1::DataType mType;
+    BufferManager mManager;
+    TensorPtr mTable;
+    std::vector<SizeType> mFreeSlots;
+    std::unordered_map<TaskIdType, Task> mTasks;
+    //! Cached tasks, the most recently used first
+    std::list<TaskIdType> mLru;
+    std::size_t mNumLoads{0};
+    std::size_t mNumHits{0};
+};
+
+} // namespace tensorrt_llm::runtime
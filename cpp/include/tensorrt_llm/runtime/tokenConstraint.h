@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+
+#include <cstdint>
+
+namespace tensorrt_llm::runtime
+{
+
+//! Host-side state machine, e.g. of a grammar or a JSON schema, that restricts the tokens one request may generate.
+//! GptSession queries it for the tokens allowed at the next step while the engine runs, the decoder then applies them
+//! as a bitmask to the logits before sampling.
+class ITokenConstraint
+{
+public:
+    virtual ~ITokenConstraint() = default;
+
+    //! @brief Sets the tokens allowed at the next step.
+    //! @param bitmask [ceil(vocabSizePadded / 32)], cleared on entry. Set bit t % 32 of word t / 32 to allow token t.
+    virtual void fillAllowedTokens(std::uint32_t* bitmask, SizeType vocabSizePadded) = 0;
+
+    //! @brief Advances the state machine by the token generated at the last step. Not called for the steps after the
+    //! request finished.
+    virtual void acceptToken(TokenIdType token) = 0;
+};
+
+} // namespace tensorrt_llm::runtime
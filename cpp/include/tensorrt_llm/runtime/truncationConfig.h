@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+
+#include <optional>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+//! Min-p and typical-p sampling, passed to GptSession next to the SamplingConfig of a batch.
+class TruncationConfig
+{
+    using FloatType = float;
+
+    template <typename T>
+    using OptVec = std::optional<std::vector<T>>;
+
+public:
+    [[nodiscard]] bool empty() const
+    {
+        return !minP && !typicalP;
+    }
+
+    OptVec<FloatType> minP;     // [1] or [batch_size] on cpu, must between [0, 1]
+    OptVec<FloatType> typicalP; // [1] or [batch_size] on cpu, must between (0, 1]
+};
+
+} // namespace tensorrt_llm::runtime
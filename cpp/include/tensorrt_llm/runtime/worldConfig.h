@@ -75,7 +75,13 @@ public:
 
     [[nodiscard]] SizeType getDevice() const noexcept
     {
-        return mDeviceIds[mRank % getGpusPerGroup()];
+        return getDeviceOf(mRank);
+    }
+
+    //! \brief The device of the given rank, when it runs on the same node as this one.
+    [[nodiscard]] SizeType getDeviceOf(SizeType rank) const noexcept
+    {
+        return mDeviceIds[rank % getGpusPerGroup()];
     }
 
     [[nodiscard]] SizeType constexpr getPipelineParallelRank() const noexcept
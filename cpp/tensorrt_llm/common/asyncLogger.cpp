@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/asyncLogger.h"
+
+#include "tensorrt_llm/common/mpscRingBuffer.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace tensorrt_llm::common
+{
+
+namespace
+{
+
+class AsyncLoggerState
+{
+public:
+    static constexpr std::size_t kCapacity{4096};
+
+    AsyncLoggerState()
+        : mRecords{kCapacity}
+        , mThread{&AsyncLoggerState::writeLoop, this}
+    {
+        // The thread is never joined, the state is leaked so that it outlives the static objects that log
+        mThread.detach();
+    }
+
+    void push(AsyncLogger::Record const& record)
+    {
+        if (mRecords.tryPush(record))
+        {
+            mNumPushed.fetch_add(1, std::memory_order_release);
+        }
+        else
+        {
+            mNumDropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void flush()
+    {
+        auto const numPushed = mNumPushed.load(std::memory_order_acquire);
+        while (mNumWritten.load(std::memory_order_acquire) < numPushed)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    [[nodiscard]] std::uint64_t getNumDropped() const
+    {
+        return mNumDropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    void writeLoop()
+    {
+        std::uint64_t numReportedDropped{0};
+        while (true)
+        {
+            auto record = mRecords.tryPop();
+            if (record)
+            {
+                auto& out = record->toStderr ? std::cerr : std::cout;
+                out << record->text << '\n';
+                mNumWritten.fetch_add(1, std::memory_order_release);
+                continue;
+            }
+            if (auto const numDropped = getNumDropped(); numDropped > numReportedDropped)
+            {
+                std::cerr << "[TensorRT-LLM][WARNING] Dropped " << numDropped - numReportedDropped
+                          << " log messages, the async log buffer is full\n";
+                numReportedDropped = numDropped;
+            }
+            std::cout.flush();
+            std::cerr.flush();
+            // Producers do not notify, so that pushing stays lock-free
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    MpscRingBuffer<AsyncLogger::Record> mRecords;
+    std::atomic<std::uint64_t> mNumPushed{0};
+    std::atomic<std::uint64_t> mNumWritten{0};
+    std::atomic<std::uint64_t> mNumDropped{0};
+    std::thread mThread;
+};
+
+AsyncLoggerState& getState()
+{
+    static auto* state = []()
+    {
+        auto* state = new AsyncLoggerState();
+        std::atexit([]() { AsyncLogger::flush(); });
+        return state;
+    }();
+    return *state;
+}
+
+} // namespace
+
+bool AsyncLogger::isEnabled()
+{
+    static bool const enabled = []()
+    {
+        char const* env = std::getenv("TLLM_LOG_ASYNC");
+        return env != nullptr && std::string(env) == "ON";
+    }();
+    return enabled;
+}
+
+void AsyncLogger::push(Record const& record)
+{
+    getState().push(record);
+}
+
+void AsyncLogger::flush()
+{
+    getState().flush();
+}
+
+std::uint64_t AsyncLogger::getNumDropped()
+{
+    return getState().getNumDropped();
+}
+
+} // namespace tensorrt_llm::common
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace tensorrt_llm::common
+{
+
+//! \brief Backend of Logger enabled with TLLM_LOG_ASYNC=ON, for verbose logging without slowing down the caller.
+//!
+//! The callers format their messages into fixed-size records pushed to a lock-free ring buffer, a background thread
+//! writes them to stdout or stderr. The messages are truncated to kMaxMessageSize and dropped, and counted, when the
+//! buffer is full.
+class AsyncLogger
+{
+public:
+    static constexpr std::size_t kMaxMessageSize{512};
+
+    struct Record
+    {
+        bool toStderr;
+        char text[kMaxMessageSize];
+    };
+
+    //! \brief Whether TLLM_LOG_ASYNC=ON, read once.
+    [[nodiscard]] static bool isEnabled();
+
+    //! \brief Queues a record, never blocks or allocates.
+    static void push(Record const& record);
+
+    //! \brief Waits until the records pushed before the call are written.
+    static void flush();
+
+    //! \brief Number of records dropped because the buffer was full.
+    [[nodiscard]] static std::uint64_t getNumDropped();
+};
+
+} // namespace tensorrt_llm::common
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/commProfiler.h"
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/envUtils.h"
+
+#include <map>
+
+#if !defined(_WIN32)
+#include <dlfcn.h>
+#endif
+
+void* getTrtLlmCommProfiler()
+{
+    static tensorrt_llm::common::CommProfiler instance;
+    return &instance;
+}
+
+namespace tensorrt_llm::common
+{
+
+char const* getCommOpName(CommOp op)
+{
+    switch (op)
+    {
+    case CommOp::kALL_REDUCE: return "AllReduce";
+    case CommOp::kALL_GATHER: return "AllGather";
+    case CommOp::kREDUCE_SCATTER: return "ReduceScatter";
+    case CommOp::kSEND: return "Send";
+    case CommOp::kRECV: return "Recv";
+    }
+    return "Unknown";
+}
+
+CommOpStats CommIterationStats::getTotal() const
+{
+    CommOpStats total;
+    for (auto const& op : ops)
+    {
+        total.count += op.count;
+        total.bytes += op.bytes;
+        total.timeMs += op.timeMs;
+    }
+    return total;
+}
+
+CommProfiler& CommProfiler::getInstance()
+{
+    // The first library loaded globally that exports the instance provides it to all of them
+    static CommProfiler* instance = []()
+    {
+#if !defined(_WIN32)
+        using GetInstance = void* (*) ();
+        auto getShared = reinterpret_cast<GetInstance>(dlsym(RTLD_DEFAULT, "getTrtLlmCommProfiler"));
+        if (getShared != nullptr)
+        {
+            return static_cast<CommProfiler*>(getShared());
+        }
+#endif
+        return static_cast<CommProfiler*>(getTrtLlmCommProfiler());
+    }();
+    return *instance;
+}
+
+CommProfiler::CommProfiler()
+    : mEnabled{getEnvCommProfiling()}
+{
+}
+
+CommProfiler::~CommProfiler()
+{
+    // The CUDA context may already be destroyed, the errors are ignored
+    for (auto const& record : mRecords)
+    {
+        cudaEventDestroy(record.start);
+        cudaEventDestroy(record.stop);
+    }
+    for (auto event : mFreeEvents)
+    {
+        cudaEventDestroy(event);
+    }
+}
+
+void CommProfiler::setIteration(int64_t iteration)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mIteration = iteration;
+}
+
+cudaEvent_t CommProfiler::acquireEvent()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (!mFreeEvents.empty())
+        {
+            auto event = mFreeEvents.back();
+            mFreeEvents.pop_back();
+            return event;
+        }
+    }
+    cudaEvent_t event;
+    return cudaEventCreate(&event) == cudaSuccess ? event : nullptr;
+}
+
+void CommProfiler::add(CommOp op, std::size_t bytes, cudaEvent_t start, cudaEvent_t stop)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRecords.push_back(Record{mIteration, op, bytes, start, stop});
+}
+
+std::vector<CommIterationStats> CommProfiler::collect()
+{
+    std::vector<Record> records;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        records.swap(mRecords);
+    }
+
+    std::map<int64_t, CommIterationStats> iterations;
+    for (auto const& record : records)
+    {
+        float timeMs = 0.F;
+        TLLM_CUDA_CHECK(cudaEventSynchronize(record.stop));
+        TLLM_CUDA_CHECK(cudaEventElapsedTime(&timeMs, record.start, record.stop));
+        auto& stats = iterations[record.iteration];
+        stats.iteration = record.iteration;
+        auto& opStats = stats[record.op];
+        ++opStats.count;
+        opStats.bytes += record.bytes;
+        opStats.timeMs += timeMs;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto const& record : records)
+        {
+            mFreeEvents.push_back(record.start);
+            mFreeEvents.push_back(record.stop);
+        }
+    }
+
+    std::vector<CommIterationStats> stats;
+    stats.reserve(iterations.size());
+    for (auto const& [iteration, iterationStats] : iterations)
+    {
+        stats.push_back(iterationStats);
+    }
+    return stats;
+}
+
+CommProfiler::Scope::Scope(CommOp op, std::size_t bytes, cudaStream_t stream)
+    : mOp{op}
+    , mBytes{bytes}
+    , mStream{stream}
+    , mRange{nvtx::makeAttributes<nvtx::category::Communication>(getCommOpName(op), static_cast<std::int64_t>(bytes))}
+{
+    auto& profiler = CommProfiler::getInstance();
+    if (!profiler.isEnabled())
+    {
+        return;
+    }
+    cudaStreamCaptureStatus captureStatus;
+    if (cudaStreamIsCapturing(mStream, &captureStatus) != cudaSuccess || captureStatus != cudaStreamCaptureStatusNone)
+    {
+        return;
+    }
+    mStart = profiler.acquireEvent();
+    if (mStart != nullptr && cudaEventRecord(mStart, mStream) != cudaSuccess)
+    {
+        cudaEventDestroy(mStart);
+        mStart = nullptr;
+    }
+}
+
+CommProfiler::Scope::~Scope()
+{
+    if (mStart == nullptr)
+    {
+        return;
+    }
+    auto& profiler = CommProfiler::getInstance();
+    auto stop = profiler.acquireEvent();
+    if (stop == nullptr || cudaEventRecord(stop, mStream) != cudaSuccess)
+    {
+        cudaEventDestroy(mStart);
+        if (stop != nullptr)
+        {
+            cudaEventDestroy(stop);
+        }
+        return;
+    }
+    profiler.add(mOp, mBytes, mStart, stop);
+}
+
+} // namespace tensorrt_llm::common
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/common/nvtxUtils.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cuda_runtime_api.h>
+#include <mutex>
+#include <vector>
+
+// Instance of CommProfiler shared by the libraries of the process
+extern "C" void* getTrtLlmCommProfiler();
+
+namespace tensorrt_llm::common
+{
+
+enum class CommOp : int
+{
+    kALL_REDUCE = 0,
+    kALL_GATHER = 1,
+    kREDUCE_SCATTER = 2,
+    kSEND = 3,
+    kRECV = 4,
+};
+
+constexpr std::size_t kNbCommOps = 5;
+
+[[nodiscard]] char const* getCommOpName(CommOp op);
+
+//! \brief Number of collectives of one kind, the bytes of their inputs and their total duration on the GPU.
+struct CommOpStats
+{
+    uint64_t count{0};
+    uint64_t bytes{0};
+    float timeMs{0.F};
+};
+
+//! \brief Statistics of the collectives of one iteration, by kind.
+struct CommIterationStats
+{
+    int64_t iteration{0};
+    std::array<CommOpStats, kNbCommOps> ops{};
+
+    [[nodiscard]] CommOpStats const& operator[](CommOp op) const
+    {
+        return ops[static_cast<std::size_t>(op)];
+    }
+
+    [[nodiscard]] CommOpStats& operator[](CommOp op)
+    {
+        return ops[static_cast<std::size_t>(op)];
+    }
+
+    [[nodiscard]] CommOpStats getTotal() const;
+};
+
+//! \brief Times the collectives of the NCCL plugins and of the NcclCommunicator with CUDA events recorded around them
+//! on their streams, and aggregates them per iteration.
+//!
+//! Disabled unless TRTLLM_COMM_PROFILING=1 or setEnabled(true), a disabled Scope only reads a flag. The events are only
+//! read by collect(), the enqueues never synchronize. The collectives captured in CUDA graphs are not timed: their
+//! events would only be recorded when the graph is captured.
+//!
+//! The plugin library has its own copy of this code, the instance is shared through an exported symbol so that the
+//! runtime sees the collectives of the plugins.
+class CommProfiler
+{
+public:
+    static CommProfiler& getInstance();
+
+    CommProfiler(CommProfiler const&) = delete;
+    CommProfiler& operator=(CommProfiler const&) = delete;
+
+    ~CommProfiler();
+
+    [[nodiscard]] bool isEnabled() const
+    {
+        return mEnabled;
+    }
+
+    void setEnabled(bool enabled)
+    {
+        mEnabled = enabled;
+    }
+
+    //! \brief Sets the iteration the next collectives belong to.
+    void setIteration(int64_t iteration);
+
+    //! \brief Waits for the timed collectives and returns their stats by iteration, in increasing order. Clears them.
+    std::vector<CommIterationStats> collect();
+
+    //! \brief Times the collectives enqueued on stream during its lifetime. Also opens an NVTX range of the
+    //! communication category with the number of bytes as payload, whether the profiler is enabled or not.
+    class Scope
+    {
+    public:
+        Scope(CommOp op, std::size_t bytes, cudaStream_t stream);
+        ~Scope();
+
+        Scope(Scope const&) = delete;
+        Scope& operator=(Scope const&) = delete;
+
+    private:
+        CommOp mOp;
+        std::size_t mBytes;
+        cudaStream_t mStream;
+        cudaEvent_t mStart{nullptr};
+        nvtx3::scoped_range_in<nvtx::Domain> mRange;
+    };
+
+private:
+    friend void* ::getTrtLlmCommProfiler();
+
+    CommProfiler();
+
+    struct Record
+    {
+        int64_t iteration;
+        CommOp op;
+        std::size_t bytes;
+        cudaEvent_t start;
+        cudaEvent_t stop;
+    };
+
+    cudaEvent_t acquireEvent();
+
+    void add(CommOp op, std::size_t bytes, cudaEvent_t start, cudaEvent_t stop);
+
+    bool mEnabled;
+    std::mutex mMutex;
+    int64_t mIteration{0};
+    std::vector<Record> mRecords;
+    // Events of the collected records, reused by the next ones
+    std::vector<cudaEvent_t> mFreeEvents;
+};
+
+} // namespace tensorrt_llm::common
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/cpuAffinity.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace tensorrt_llm::common
+{
+
+namespace
+{
+
+std::optional<std::string> getDeviceSysfsPath(int device)
+{
+    std::array<char, 32> busId{};
+    if (cudaDeviceGetPCIBusId(busId.data(), static_cast<int>(busId.size()), device) != cudaSuccess)
+    {
+        return std::nullopt;
+    }
+    // sysfs uses lower case hex digits
+    std::string id{busId.data()};
+    std::transform(id.begin(), id.end(), id.begin(), [](unsigned char c) { return std::tolower(c); });
+    return "/sys/bus/pci/devices/" + id;
+}
+
+std::optional<std::string> readLine(std::string const& path)
+{
+    std::ifstream file(path);
+    std::string line;
+    if (!file.good() || !std::getline(file, line))
+    {
+        return std::nullopt;
+    }
+    return line;
+}
+
+} // namespace
+
+std::vector<int> parseCpuList(std::string const& cpuList)
+{
+    std::vector<int> cpus;
+    std::istringstream stream(cpuList);
+    std::string range;
+    while (std::getline(stream, range, ','))
+    {
+        if (range.find_first_not_of(" \t\n") == std::string::npos)
+        {
+            continue;
+        }
+        auto const dash = range.find('-');
+        try
+        {
+            auto const first = std::stoi(range.substr(0, dash));
+            auto const last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu)
+            {
+                cpus.push_back(cpu);
+            }
+        }
+        catch (std::exception const&)
+        {
+            TLLM_LOG_WARNING("Invalid CPU list: %s", cpuList.c_str());
+            return {};
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+std::vector<int> getDeviceLocalCpus(int device)
+{
+    auto const sysfsPath = getDeviceSysfsPath(device);
+    auto const cpuList = sysfsPath ? readLine(*sysfsPath + "/local_cpulist") : std::nullopt;
+    if (!cpuList)
+    {
+        return {};
+    }
+
+    // keep the CPUs the process may run on, e.g. in a container or under taskset
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {
+        return {};
+    }
+    auto cpus = parseCpuList(*cpuList);
+    cpus.erase(std::remove_if(cpus.begin(), cpus.end(),
+                   [&allowed](int cpu) { return cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowed); }),
+        cpus.end());
+    return cpus;
+}
+
+std::optional<int> getDeviceNumaNode(int device)
+{
+    auto const sysfsPath = getDeviceSysfsPath(device);
+    auto const numaNode = sysfsPath ? readLine(*sysfsPath + "/numa_node") : std::nullopt;
+    if (!numaNode)
+    {
+        return std::nullopt;
+    }
+    try
+    {
+        auto const node = std::stoi(*numaNode);
+        // the node is -1 on systems without NUMA
+        return node < 0 ? std::nullopt : std::optional<int>{node};
+    }
+    catch (std::exception const&)
+    {
+        return std::nullopt;
+    }
+}
+
+bool bindThreadToDevice(int device)
+{
+    auto const cpus = getDeviceLocalCpus(device);
+    if (cpus.empty())
+    {
+        TLLM_LOG_WARNING("No CPUs local to device %d found, the thread is not bound", device);
+        return false;
+    }
+
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (auto const cpu : cpus)
+    {
+        CPU_SET(cpu, &cpuSet);
+    }
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) != 0)
+    {
+        TLLM_LOG_WARNING("Failed to bind the thread to the CPUs local to device %d", device);
+        return false;
+    }
+
+    // Pages are placed on first touch, which for pinned buffers is the allocating thread. Prefer the local node.
+    if (auto const numaNode = getDeviceNumaNode(device); numaNode && *numaNode < 64)
+    {
+        auto constexpr kMpolPreferred = 1;
+        unsigned long const nodeMask = 1UL << *numaNode;
+        if (syscall(SYS_set_mempolicy, kMpolPreferred, &nodeMask, sizeof(nodeMask) * 8) != 0)
+        {
+            TLLM_LOG_WARNING("Failed to prefer NUMA node %d for host allocations", *numaNode);
+        }
+    }
+    TLLM_LOG_INFO("Bound thread to %zu CPUs local to device %d", cpus.size(), device);
+    return true;
+}
+
+} // namespace tensorrt_llm::common
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm::common
+{
+
+//! \brief Parses a Linux CPU or node list like "0-3,8,10-11" into its sorted indices.
+std::vector<int> parseCpuList(std::string const& cpuList);
+
+//! \brief The CPUs local to a CUDA device that the process may run on, empty if unknown.
+std::vector<int> getDeviceLocalCpus(int device);
+
+//! \brief The NUMA node of a CUDA device, if the system reports one.
+std::optional<int> getDeviceNumaNode(int device);
+
+//! \brief Binds the calling thread to the CPUs local to a CUDA device and prefers the device's NUMA node for the
+//! memory the thread allocates, including pinned host buffers. Threads created afterwards by the calling thread
+//! inherit the binding. Returns false and leaves the thread unchanged if the device locality is unknown.
+bool bindThreadToDevice(int device);
+
+} // namespace tensorrt_llm::common
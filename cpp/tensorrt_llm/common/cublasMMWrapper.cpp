@@ -17,7 +17,12 @@
 #include "tensorrt_llm/common/cublasMMWrapper.h"
 #include "tensorrt_llm/common/assert.h"
 #include "tensorrt_llm/common/cublasVersionCheck.h"
+#include "tensorrt_llm/common/logger.h"
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
 
 #ifndef CUDART_VERSION
 #error CUDART_VERSION Undefined!
@@ -28,6 +33,101 @@ namespace tensorrt_llm
 namespace common
 {
 
+namespace
+{
+
+struct CublasLtAlgoCache
+{
+    std::mutex mutex;
+    bool loaded{false};
+    // Algorithms used by the GEMMs of this process, std::nullopt if cuBLASLt picks the algorithm
+    std::map<std::array<int64_t, 15>, std::optional<cublasLtMatmulAlgo_t>> algos;
+    // Algorithms read from the cache file, not checked yet against the descriptors of the GEMM
+    std::map<std::array<int64_t, 15>, cublasLtMatmulAlgo_t> fileAlgos;
+};
+
+CublasLtAlgoCache& getCublasLtAlgoCache()
+{
+    static CublasLtAlgoCache cache;
+    return cache;
+}
+
+const char* getCublasLtAlgoCacheFile()
+{
+    return std::getenv("TRTLLM_CUBLASLT_ALGO_CACHE_FILE");
+}
+
+// One line per algorithm: the fields of the key followed by the words of cublasLtMatmulAlgo_t. The later lines
+// override the earlier ones.
+void loadCublasLtAlgoCache(CublasLtAlgoCache& cache)
+{
+    if (cache.loaded)
+    {
+        return;
+    }
+    cache.loaded = true;
+
+    const auto path = getCublasLtAlgoCacheFile();
+    if (path == NULL)
+    {
+        return;
+    }
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream fields(line);
+        std::array<int64_t, 15> key;
+        cublasLtMatmulAlgo_t algo;
+        bool valid = true;
+        for (auto& field : key)
+        {
+            valid = valid && static_cast<bool>(fields >> field);
+        }
+        for (auto& word : algo.data)
+        {
+            valid = valid && static_cast<bool>(fields >> word);
+        }
+        if (!valid)
+        {
+            TLLM_LOG_WARNING("Skipping malformed line of cuBLASLt algorithm cache file %s", path);
+            continue;
+        }
+        cache.fileAlgos[key] = algo;
+    }
+}
+
+void appendCublasLtAlgoCache(const std::array<int64_t, 15>& key, const cublasLtMatmulAlgo_t& algo)
+{
+    const auto path = getCublasLtAlgoCacheFile();
+    if (path == NULL)
+    {
+        return;
+    }
+    std::ostringstream line;
+    for (const auto field : key)
+    {
+        line << field << " ";
+    }
+    for (size_t i = 0; i < sizeof(algo.data) / sizeof(algo.data[0]); ++i)
+    {
+        line << algo.data[i] << (i + 1 < sizeof(algo.data) / sizeof(algo.data[0]) ? " " : "\n");
+    }
+    std::ofstream file(path, std::ios::app);
+    file << line.str();
+    if (!file)
+    {
+        TLLM_LOG_WARNING("Cannot write cuBLASLt algorithm cache file %s", path);
+    }
+}
+
+bool isSameAlgo(const cublasLtMatmulAlgo_t& a, const cublasLtMatmulAlgo_t& b)
+{
+    return std::memcmp(&a, &b, sizeof(cublasLtMatmulAlgo_t)) == 0;
+}
+
+} // namespace
+
 CublasMMWrapper::CublasMMWrapper(std::shared_ptr<cublasHandle_t> cublasHandle,
     std::shared_ptr<cublasLtHandle_t> cublasltHandle, cudaStream_t stream, void* workspace)
     : mCublasHandle(cublasHandle)
@@ -135,10 +235,17 @@ void CublasMMWrapper::Gemm(cublasOperation_t transa, cublasOperation_t transb, c
         if (hasAlgo)
         {
             hasAlgo = checkTactic(transa, transb, m, n, k, lda, ldb, ldc, algo);
+            if (hasAlgo)
+            {
+                cacheProfiledAlgo(getAlgoCacheKey(transa, transb, m, n, k, lda, ldb, ldc, workspaceSize), algo);
+            }
         }
+        const auto cachedAlgo
+            = hasAlgo ? std::nullopt : getCachedAlgo(transa, transb, m, n, k, lda, ldb, ldc, workspaceSize);
+        const cublasLtMatmulAlgo_t* algoPtr = hasAlgo ? &algo : (cachedAlgo ? &(*cachedAlgo) : NULL);
 
         check_cuda_error(cublasLtMatmul(getCublasLtHandle(), mOperationDesc, alpha, A, mADesc, B, mBDesc, beta, C,
-            mCDesc, C, mCDesc, (hasAlgo ? (&algo) : NULL), mCublasWorkspace, workspaceSize, mStream));
+            mCDesc, C, mCDesc, algoPtr, mCublasWorkspace, workspaceSize, mStream));
 
         sync_check_cuda_error();
     }
@@ -290,6 +397,77 @@ bool CublasMMWrapper::checkTactic(cublasOperation_t transa, cublasOperation_t tr
     return true;
 }
 
+CublasMMWrapper::AlgoCacheKey CublasMMWrapper::getAlgoCacheKey(cublasOperation_t transa, cublasOperation_t transb,
+    const int m, const int n, const int k, const int lda, const int ldb, const int ldc, const int workspaceSize) const
+{
+    // The algorithms are only valid for the GPU and the cuBLASLt version they were selected with
+    return {getSMVersion(), static_cast<int64_t>(cublasLtGetVersion()), transa, transb, m, n, k, lda, ldb, ldc, mAType,
+        mBType, mCType, mComputeType, workspaceSize};
+}
+
+std::optional<cublasLtMatmulAlgo_t> CublasMMWrapper::getCachedAlgo(cublasOperation_t transa,
+    cublasOperation_t transb, const int m, const int n, const int k, const int lda, const int ldb, const int ldc,
+    const int workspaceSize)
+{
+    auto& cache = getCublasLtAlgoCache();
+    const auto key = getAlgoCacheKey(transa, transb, m, n, k, lda, ldb, ldc, workspaceSize);
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    loadCublasLtAlgoCache(cache);
+
+    const auto iter = cache.algos.find(key);
+    if (iter != cache.algos.end())
+    {
+        return iter->second;
+    }
+
+    std::optional<cublasLtMatmulAlgo_t> algo;
+    const auto fileIter = cache.fileAlgos.find(key);
+    if (fileIter != cache.fileAlgos.end() && checkTactic(transa, transb, m, n, k, lda, ldb, ldc, fileIter->second))
+    {
+        algo = fileIter->second;
+    }
+#if !TLLM_CUBLAS_VER_LE(11, 4, 2)
+    else
+    {
+        // The heuristic results are sorted by expected performance
+        for (const auto& heuristic : getTactics(transa, transb, m, n, k, lda, ldb, ldc))
+        {
+            if (heuristic.state == CUBLAS_STATUS_SUCCESS
+                && heuristic.workspaceSize <= static_cast<size_t>(workspaceSize))
+            {
+                algo = heuristic.algo;
+                break;
+            }
+        }
+    }
+#endif
+    cache.algos[key] = algo;
+    return algo;
+}
+
+void CublasMMWrapper::cacheProfiledAlgo(const AlgoCacheKey& key, const cublasLtMatmulAlgo_t& algo)
+{
+    auto& cache = getCublasLtAlgoCache();
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    loadCublasLtAlgoCache(cache);
+
+    const auto iter = cache.algos.find(key);
+    if (iter != cache.algos.end() && iter->second && isSameAlgo(*iter->second, algo))
+    {
+        return;
+    }
+    cache.algos[key] = algo;
+
+    const auto fileIter = cache.fileAlgos.find(key);
+    if (fileIter == cache.fileAlgos.end() || !isSameAlgo(fileIter->second, algo))
+    {
+        cache.fileAlgos[key] = algo;
+        appendCublasLtAlgoCache(key, algo);
+    }
+}
+
 std::vector<cublasLtMatmulHeuristicResult_t> CublasMMWrapper::getTactics(cublasOperation_t transa,
     cublasOperation_t transb, const int m, const int n, const int k, const int lda, const int ldb, const int ldc)
 {
@@ -19,6 +19,7 @@
 #include "tensorrt_llm/common/cudaUtils.h"
 #include <cublasLt.h>
 #include <cublas_v2.h>
+#include <array>
 #include <cuda_runtime.h>
 #include <map>
 #include <mutex>
@@ -59,6 +60,23 @@ private:
         return mOperationDesc != NULL && mADesc != NULL && mBDesc != NULL && mCDesc != NULL;
     }
 
+    // Process-wide cache of the cuBLASLt algorithm of each GEMM, shared by all the wrappers. GEMMs run without a
+    // profiled algorithm query the heuristic once per shape instead of letting cublasLtMatmul query it on every call.
+    // If TRTLLM_CUBLASLT_ALGO_CACHE_FILE is set, the cache is loaded from that file and the profiled algorithms are
+    // appended to it, so they are also used by the GEMMs of the later runs that are not profiled.
+    using AlgoCacheKey = std::array<int64_t, 15>;
+
+    AlgoCacheKey getAlgoCacheKey(cublasOperation_t transa, cublasOperation_t transb, const int m, const int n,
+        const int k, const int lda, const int ldb, const int ldc, const int workspaceSize) const;
+
+    // Returns the cached algorithm of the GEMM, running the heuristic if the GEMM is not cached yet.
+    // The descriptors must be created.
+    std::optional<cublasLtMatmulAlgo_t> getCachedAlgo(cublasOperation_t transa, cublasOperation_t transb,
+        const int m, const int n, const int k, const int lda, const int ldb, const int ldc, const int workspaceSize);
+
+    // Records a profiled algorithm of the GEMM.
+    void cacheProfiledAlgo(const AlgoCacheKey& key, const cublasLtMatmulAlgo_t& algo);
+
 public:
     CublasMMWrapper(std::shared_ptr<cublasHandle_t> cublasHandle, std::shared_ptr<cublasLtHandle_t> cublasLtHandle,
         cudaStream_t stream, void* workspace);
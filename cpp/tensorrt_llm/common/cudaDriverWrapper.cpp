@@ -62,6 +62,26 @@ CUDADriverWrapper::CUDADriverWrapper()
     *(void**) (&_cuLinkAddData) = load_sym(handle, "cuLinkAddData_v2");
     *(void**) (&_cuLaunchCooperativeKernel) = load_sym(handle, "cuLaunchCooperativeKernel");
     *(void**) (&_cuLaunchKernel) = load_sym(handle, "cuLaunchKernel");
+    *(void**) (&_cuDeviceGet) = load_sym(handle, "cuDeviceGet");
+    *(void**) (&_cuDeviceGetAttribute) = load_sym(handle, "cuDeviceGetAttribute");
+    *(void**) (&_cuMemCreate) = load_sym(handle, "cuMemCreate");
+    *(void**) (&_cuMemRelease) = load_sym(handle, "cuMemRelease");
+    *(void**) (&_cuMemAddressReserve) = load_sym(handle, "cuMemAddressReserve");
+    *(void**) (&_cuMemAddressFree) = load_sym(handle, "cuMemAddressFree");
+    *(void**) (&_cuMemMap) = load_sym(handle, "cuMemMap");
+    *(void**) (&_cuMemUnmap) = load_sym(handle, "cuMemUnmap");
+    *(void**) (&_cuMemSetAccess) = load_sym(handle, "cuMemSetAccess");
+    *(void**) (&_cuMemGetAllocationGranularity) = load_sym(handle, "cuMemGetAllocationGranularity");
+    *(void**) (&_cuMemExportToShareableHandle) = load_sym(handle, "cuMemExportToShareableHandle");
+    *(void**) (&_cuMemImportFromShareableHandle) = load_sym(handle, "cuMemImportFromShareableHandle");
+#if CUDA_VERSION >= 12010
+    // Missing from the drivers older than 530, see hasMulticast()
+    *(void**) (&_cuMulticastCreate) = load_sym(handle, "cuMulticastCreate");
+    *(void**) (&_cuMulticastGetGranularity) = load_sym(handle, "cuMulticastGetGranularity");
+    *(void**) (&_cuMulticastAddDevice) = load_sym(handle, "cuMulticastAddDevice");
+    *(void**) (&_cuMulticastBindMem) = load_sym(handle, "cuMulticastBindMem");
+    *(void**) (&_cuMulticastUnbind) = load_sym(handle, "cuMulticastUnbind");
+#endif
 }
 
 CUDADriverWrapper::~CUDADriverWrapper()
@@ -143,5 +163,113 @@ CUresult CUDADriverWrapper::cuLaunchKernel(CUfunction f, unsigned int gridDimX,
         f, gridDimX, gridDimY, gridDimZ, blockDimX, blockDimY, blockDimZ, sharedMemBytes, hStream, kernelParams, extra);
 }
 
+CUresult CUDADriverWrapper::cuDeviceGet(CUdevice* device, int ordinal) const
+{
+    return (*_cuDeviceGet)(device, ordinal);
+}
+
+CUresult CUDADriverWrapper::cuDeviceGetAttribute(int* pi, CUdevice_attribute attrib, CUdevice dev) const
+{
+    return (*_cuDeviceGetAttribute)(pi, attrib, dev);
+}
+
+CUresult CUDADriverWrapper::cuMemCreate(
+    CUmemGenericAllocationHandle* handle, size_t size, const CUmemAllocationProp* prop, unsigned long long flags) const
+{
+    return (*_cuMemCreate)(handle, size, prop, flags);
+}
+
+CUresult CUDADriverWrapper::cuMemRelease(CUmemGenericAllocationHandle handle) const
+{
+    return (*_cuMemRelease)(handle);
+}
+
+CUresult CUDADriverWrapper::cuMemAddressReserve(
+    CUdeviceptr* ptr, size_t size, size_t alignment, CUdeviceptr addr, unsigned long long flags) const
+{
+    return (*_cuMemAddressReserve)(ptr, size, alignment, addr, flags);
+}
+
+CUresult CUDADriverWrapper::cuMemAddressFree(CUdeviceptr ptr, size_t size) const
+{
+    return (*_cuMemAddressFree)(ptr, size);
+}
+
+CUresult CUDADriverWrapper::cuMemMap(
+    CUdeviceptr ptr, size_t size, size_t offset, CUmemGenericAllocationHandle handle, unsigned long long flags) const
+{
+    return (*_cuMemMap)(ptr, size, offset, handle, flags);
+}
+
+CUresult CUDADriverWrapper::cuMemUnmap(CUdeviceptr ptr, size_t size) const
+{
+    return (*_cuMemUnmap)(ptr, size);
+}
+
+CUresult CUDADriverWrapper::cuMemSetAccess(
+    CUdeviceptr ptr, size_t size, const CUmemAccessDesc* desc, size_t count) const
+{
+    return (*_cuMemSetAccess)(ptr, size, desc, count);
+}
+
+CUresult CUDADriverWrapper::cuMemGetAllocationGranularity(
+    size_t* granularity, const CUmemAllocationProp* prop, CUmemAllocationGranularity_flags option) const
+{
+    return (*_cuMemGetAllocationGranularity)(granularity, prop, option);
+}
+
+CUresult CUDADriverWrapper::cuMemExportToShareableHandle(void* shareableHandle, CUmemGenericAllocationHandle handle,
+    CUmemAllocationHandleType handleType, unsigned long long flags) const
+{
+    return (*_cuMemExportToShareableHandle)(shareableHandle, handle, handleType, flags);
+}
+
+CUresult CUDADriverWrapper::cuMemImportFromShareableHandle(
+    CUmemGenericAllocationHandle* handle, void* osHandle, CUmemAllocationHandleType shHandleType) const
+{
+    return (*_cuMemImportFromShareableHandle)(handle, osHandle, shHandleType);
+}
+
+#if CUDA_VERSION >= 12010
+CUresult CUDADriverWrapper::cuMulticastCreate(
+    CUmemGenericAllocationHandle* mcHandle, const CUmulticastObjectProp* prop) const
+{
+    return (*_cuMulticastCreate)(mcHandle, prop);
+}
+
+CUresult CUDADriverWrapper::cuMulticastGetGranularity(
+    size_t* granularity, const CUmulticastObjectProp* prop, CUmulticastGranularity_flags option) const
+{
+    return (*_cuMulticastGetGranularity)(granularity, prop, option);
+}
+
+CUresult CUDADriverWrapper::cuMulticastAddDevice(CUmemGenericAllocationHandle mcHandle, CUdevice dev) const
+{
+    return (*_cuMulticastAddDevice)(mcHandle, dev);
+}
+
+CUresult CUDADriverWrapper::cuMulticastBindMem(CUmemGenericAllocationHandle mcHandle, size_t mcOffset,
+    CUmemGenericAllocationHandle memHandle, size_t memOffset, size_t size, unsigned long long flags) const
+{
+    return (*_cuMulticastBindMem)(mcHandle, mcOffset, memHandle, memOffset, size, flags);
+}
+
+CUresult CUDADriverWrapper::cuMulticastUnbind(
+    CUmemGenericAllocationHandle mcHandle, CUdevice dev, size_t mcOffset, size_t size) const
+{
+    return (*_cuMulticastUnbind)(mcHandle, dev, mcOffset, size);
+}
+#endif
+
+bool CUDADriverWrapper::hasMulticast() const
+{
+#if CUDA_VERSION >= 12010
+    return _cuMulticastCreate != nullptr && _cuMulticastGetGranularity != nullptr && _cuMulticastAddDevice != nullptr
+        && _cuMulticastBindMem != nullptr && _cuMulticastUnbind != nullptr;
+#else
+    return false;
+#endif
+}
+
 } // namespace common
 } // namespace tensorrt_llm
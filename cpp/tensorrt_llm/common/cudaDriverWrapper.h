@@ -70,6 +70,53 @@ public:
         unsigned int blockDimX, unsigned int blockDimY, unsigned int blockDimZ, unsigned int sharedMemBytes,
         CUstream hStream, void** kernelParams, void** extra) const;
 
+    CUresult cuDeviceGet(CUdevice* device, int ordinal) const;
+
+    CUresult cuDeviceGetAttribute(int* pi, CUdevice_attribute attrib, CUdevice dev) const;
+
+    CUresult cuMemCreate(CUmemGenericAllocationHandle* handle, size_t size, const CUmemAllocationProp* prop,
+        unsigned long long flags) const;
+
+    CUresult cuMemRelease(CUmemGenericAllocationHandle handle) const;
+
+    CUresult cuMemAddressReserve(
+        CUdeviceptr* ptr, size_t size, size_t alignment, CUdeviceptr addr, unsigned long long flags) const;
+
+    CUresult cuMemAddressFree(CUdeviceptr ptr, size_t size) const;
+
+    CUresult cuMemMap(CUdeviceptr ptr, size_t size, size_t offset, CUmemGenericAllocationHandle handle,
+        unsigned long long flags) const;
+
+    CUresult cuMemUnmap(CUdeviceptr ptr, size_t size) const;
+
+    CUresult cuMemSetAccess(CUdeviceptr ptr, size_t size, const CUmemAccessDesc* desc, size_t count) const;
+
+    CUresult cuMemGetAllocationGranularity(
+        size_t* granularity, const CUmemAllocationProp* prop, CUmemAllocationGranularity_flags option) const;
+
+    CUresult cuMemExportToShareableHandle(void* shareableHandle, CUmemGenericAllocationHandle handle,
+        CUmemAllocationHandleType handleType, unsigned long long flags) const;
+
+    CUresult cuMemImportFromShareableHandle(
+        CUmemGenericAllocationHandle* handle, void* osHandle, CUmemAllocationHandleType shHandleType) const;
+
+#if CUDA_VERSION >= 12010
+    CUresult cuMulticastCreate(CUmemGenericAllocationHandle* mcHandle, const CUmulticastObjectProp* prop) const;
+
+    CUresult cuMulticastGetGranularity(
+        size_t* granularity, const CUmulticastObjectProp* prop, CUmulticastGranularity_flags option) const;
+
+    CUresult cuMulticastAddDevice(CUmemGenericAllocationHandle mcHandle, CUdevice dev) const;
+
+    CUresult cuMulticastBindMem(CUmemGenericAllocationHandle mcHandle, size_t mcOffset,
+        CUmemGenericAllocationHandle memHandle, size_t memOffset, size_t size, unsigned long long flags) const;
+
+    CUresult cuMulticastUnbind(CUmemGenericAllocationHandle mcHandle, CUdevice dev, size_t mcOffset, size_t size) const;
+#endif
+
+    //! \brief Whether the multicast objects used by the NVLS all-reduce are provided by the driver.
+    bool hasMulticast() const;
+
 private:
     void* handle;
     CUresult (*_cuGetErrorName)(CUresult, const char**);
@@ -89,6 +136,27 @@ private:
     CUresult (*_cuLaunchKernel)(CUfunction f, unsigned int gridDimX, unsigned int gridDimY, unsigned int gridDimZ,
         unsigned int blockDimX, unsigned int blockDimY, unsigned int blockDimZ, unsigned int sharedMemBytes,
         CUstream hStream, void** kernelParams, void** extra);
+    CUresult (*_cuDeviceGet)(CUdevice*, int);
+    CUresult (*_cuDeviceGetAttribute)(int*, CUdevice_attribute, CUdevice);
+    CUresult (*_cuMemCreate)(CUmemGenericAllocationHandle*, size_t, const CUmemAllocationProp*, unsigned long long);
+    CUresult (*_cuMemRelease)(CUmemGenericAllocationHandle);
+    CUresult (*_cuMemAddressReserve)(CUdeviceptr*, size_t, size_t, CUdeviceptr, unsigned long long);
+    CUresult (*_cuMemAddressFree)(CUdeviceptr, size_t);
+    CUresult (*_cuMemMap)(CUdeviceptr, size_t, size_t, CUmemGenericAllocationHandle, unsigned long long);
+    CUresult (*_cuMemUnmap)(CUdeviceptr, size_t);
+    CUresult (*_cuMemSetAccess)(CUdeviceptr, size_t, const CUmemAccessDesc*, size_t);
+    CUresult (*_cuMemGetAllocationGranularity)(size_t*, const CUmemAllocationProp*, CUmemAllocationGranularity_flags);
+    CUresult (*_cuMemExportToShareableHandle)(
+        void*, CUmemGenericAllocationHandle, CUmemAllocationHandleType, unsigned long long);
+    CUresult (*_cuMemImportFromShareableHandle)(CUmemGenericAllocationHandle*, void*, CUmemAllocationHandleType);
+#if CUDA_VERSION >= 12010
+    CUresult (*_cuMulticastCreate)(CUmemGenericAllocationHandle*, const CUmulticastObjectProp*);
+    CUresult (*_cuMulticastGetGranularity)(size_t*, const CUmulticastObjectProp*, CUmulticastGranularity_flags);
+    CUresult (*_cuMulticastAddDevice)(CUmemGenericAllocationHandle, CUdevice);
+    CUresult (*_cuMulticastBindMem)(
+        CUmemGenericAllocationHandle, size_t, CUmemGenericAllocationHandle, size_t, size_t, unsigned long long);
+    CUresult (*_cuMulticastUnbind)(CUmemGenericAllocationHandle, CUdevice, size_t, size_t);
+#endif
 };
 
 inline void cuErrCheck_(CUresult stat, const CUDADriverWrapper& wrap, const char* file, int line)
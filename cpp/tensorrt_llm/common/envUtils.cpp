@@ -62,4 +62,344 @@ int getEnvMmhaBlocksPerSequence()
     return mmhaBlocksPerSequence;
 }
 
+// Bind the host threads of each rank to the CPUs and NUMA node local to its device.
+bool getEnvBindThreadsToDevice()
+{
+    static bool init = false;
+    static bool bindThreadsToDevice = false;
+    if (!init)
+    {
+        init = true;
+        const char* bindThreadsToDeviceEnv = std::getenv("TRTLLM_BIND_THREADS_TO_DEVICE");
+        if (bindThreadsToDeviceEnv)
+        {
+            bindThreadsToDevice = bindThreadsToDeviceEnv[0] == '1' && bindThreadsToDeviceEnv[1] == '\0';
+        }
+    }
+    return bindThreadsToDevice;
+}
+
+// Sample with the fused top K / top P kernel instead of the separate top K and top P layers.
+bool getEnvFusedSampling()
+{
+    static bool init = false;
+    static bool fusedSampling = false;
+    if (!init)
+    {
+        init = true;
+        const char* fusedSamplingEnv = std::getenv("TRTLLM_ENABLE_FUSED_SAMPLING");
+        if (fusedSamplingEnv)
+        {
+            fusedSampling = fusedSamplingEnv[0] == '1' && fusedSamplingEnv[1] == '\0';
+        }
+    }
+    return fusedSampling;
+}
+
+// Decode the requests of the GptDecoderBatch of a GptSession with one decoder instead of one decoder per request.
+bool getEnvBatchedDecoding()
+{
+    static bool init = false;
+    static bool batchedDecoding = false;
+    if (!init)
+    {
+        init = true;
+        const char* batchedDecodingEnv = std::getenv("TRTLLM_ENABLE_BATCHED_DECODING");
+        if (batchedDecodingEnv)
+        {
+            batchedDecoding = batchedDecodingEnv[0] == '1' && batchedDecodingEnv[1] == '\0';
+        }
+    }
+    return batchedDecoding;
+}
+
+// Match the stop words and bad words with an Aho-Corasick automaton instead of comparing every word each step.
+bool getEnvWordsAutomaton()
+{
+    static bool init = false;
+    static bool wordsAutomaton = false;
+    if (!init)
+    {
+        init = true;
+        const char* wordsAutomatonEnv = std::getenv("TRTLLM_ENABLE_WORDS_AUTOMATON");
+        if (wordsAutomatonEnv)
+        {
+            wordsAutomaton = wordsAutomatonEnv[0] == '1' && wordsAutomatonEnv[1] == '\0';
+        }
+    }
+    return wordsAutomaton;
+}
+
+// Apply the repetition, presence and frequency penalties from per-sequence token histograms updated every step.
+bool getEnvPenaltyHistograms()
+{
+    static bool init = false;
+    static bool penaltyHistograms = false;
+    if (!init)
+    {
+        init = true;
+        const char* penaltyHistogramsEnv = std::getenv("TRTLLM_ENABLE_PENALTY_HISTOGRAMS");
+        if (penaltyHistogramsEnv)
+        {
+            penaltyHistograms = penaltyHistogramsEnv[0] == '1' && penaltyHistogramsEnv[1] == '\0';
+        }
+    }
+    return penaltyHistograms;
+}
+
+// Draw the random numbers of sampling from the seed of each request and the token position instead of curand states.
+bool getEnvCounterBasedRng()
+{
+    static bool init = false;
+    static bool counterBasedRng = false;
+    if (!init)
+    {
+        init = true;
+        const char* counterBasedRngEnv = std::getenv("TRTLLM_ENABLE_COUNTER_BASED_RNG");
+        if (counterBasedRngEnv)
+        {
+            counterBasedRng = counterBasedRngEnv[0] == '1' && counterBasedRngEnv[1] == '\0';
+        }
+    }
+    return counterBasedRng;
+}
+
+// Ban the repeated n-grams with per-sequence n-gram indices updated every step instead of rescanning the sequences.
+bool getEnvNgramIndex()
+{
+    static bool init = false;
+    static bool ngramIndex = false;
+    if (!init)
+    {
+        init = true;
+        const char* ngramIndexEnv = std::getenv("TRTLLM_ENABLE_NGRAM_INDEX");
+        if (ngramIndexEnv)
+        {
+            ngramIndex = ngramIndexEnv[0] == '1' && ngramIndexEnv[1] == '\0';
+        }
+    }
+    return ngramIndex;
+}
+
+// Benchmark the generation attention kernels when configuring the GPT attention plugin and store the fastest per shape.
+bool getEnvProfileGenerationAttention()
+{
+    static bool init = false;
+    static bool profileGenerationAttention = false;
+    if (!init)
+    {
+        init = true;
+        const char* profileGenerationAttentionEnv = std::getenv("TRTLLM_PROFILE_GENERATION_ATTENTION");
+        if (profileGenerationAttentionEnv)
+        {
+            profileGenerationAttention
+                = profileGenerationAttentionEnv[0] == '1' && profileGenerationAttentionEnv[1] == '\0';
+        }
+    }
+    return profileGenerationAttention;
+}
+
+// Log the number of tokens routed to each expert of the MoE layers every N steps, 0 to disable.
+int getEnvMoeExpertLoadLogInterval()
+{
+    static bool init = false;
+    static int moeExpertLoadLogInterval = 0;
+    if (!init)
+    {
+        init = true;
+        const char* moeExpertLoadLogIntervalEnv = std::getenv("TRTLLM_MOE_EXPERT_LOAD_LOG_INTERVAL");
+        if (moeExpertLoadLogIntervalEnv)
+        {
+            moeExpertLoadLogInterval = std::atoi(moeExpertLoadLogIntervalEnv);
+            if (moeExpertLoadLogInterval < 0)
+            {
+                TLLM_LOG_WARNING("Invalid value for TRTLLM_MOE_EXPERT_LOAD_LOG_INTERVAL. The load will not be logged!");
+                moeExpertLoadLogInterval = 0;
+            }
+        }
+    }
+    return moeExpertLoadLogInterval;
+}
+
+// File of the all-reduce strategy table measured at startup and consulted by the AUTO strategy, empty to use the fixed
+// message size thresholds.
+std::string const& getEnvAllReduceStrategyTable()
+{
+    static bool init = false;
+    static std::string allReduceStrategyTable;
+    if (!init)
+    {
+        init = true;
+        const char* allReduceStrategyTableEnv = std::getenv("TRTLLM_ALLREDUCE_STRATEGY_TABLE");
+        if (allReduceStrategyTableEnv)
+        {
+            allReduceStrategyTable = allReduceStrategyTableEnv;
+        }
+    }
+    return allReduceStrategyTable;
+}
+
+// Shared directory through which the ranks exchange their bootstrap messages instead of MPI, empty to use MPI.
+std::string const& getEnvBootstrapDir()
+{
+    static bool init = false;
+    static std::string bootstrapDir;
+    if (!init)
+    {
+        init = true;
+        const char* bootstrapDirEnv = std::getenv("TRTLLM_BOOTSTRAP_DIR");
+        if (bootstrapDirEnv)
+        {
+            bootstrapDir = bootstrapDirEnv;
+        }
+    }
+    return bootstrapDir;
+}
+
+int getEnvBootstrapRank()
+{
+    static bool init = false;
+    static int bootstrapRank = 0;
+    if (!init)
+    {
+        init = true;
+        const char* bootstrapRankEnv = std::getenv("TRTLLM_BOOTSTRAP_RANK");
+        if (bootstrapRankEnv)
+        {
+            bootstrapRank = std::atoi(bootstrapRankEnv);
+        }
+    }
+    return bootstrapRank;
+}
+
+int getEnvBootstrapWorldSize()
+{
+    static bool init = false;
+    static int bootstrapWorldSize = 1;
+    if (!init)
+    {
+        init = true;
+        const char* bootstrapWorldSizeEnv = std::getenv("TRTLLM_BOOTSTRAP_WORLD_SIZE");
+        if (bootstrapWorldSizeEnv)
+        {
+            bootstrapWorldSize = std::atoi(bootstrapWorldSizeEnv);
+        }
+    }
+    return bootstrapWorldSize;
+}
+
+// Place the ranks of the TP groups on the devices with the fastest links between them instead of consecutive devices,
+// when the devices are not given.
+bool getEnvTopologyAwarePlacement()
+{
+    static bool init = false;
+    static bool topologyAwarePlacement = false;
+    if (!init)
+    {
+        init = true;
+        const char* topologyAwarePlacementEnv = std::getenv("TRTLLM_TOPOLOGY_AWARE_PLACEMENT");
+        if (topologyAwarePlacementEnv)
+        {
+            topologyAwarePlacement = topologyAwarePlacementEnv[0] == '1' && topologyAwarePlacementEnv[1] == '\0';
+        }
+    }
+    return topologyAwarePlacement;
+}
+
+// Time the collectives with CUDA events and aggregate their durations and sizes per iteration, see CommProfiler.
+bool getEnvCommProfiling()
+{
+    static bool init = false;
+    static bool commProfiling = false;
+    if (!init)
+    {
+        init = true;
+        const char* commProfilingEnv = std::getenv("TRTLLM_COMM_PROFILING");
+        if (commProfilingEnv)
+        {
+            commProfiling = commProfilingEnv[0] == '1' && commProfilingEnv[1] == '\0';
+        }
+    }
+    return commProfiling;
+}
+
+// Time the layers of one in every N engine enqueues with the TensorRT profiler, 0 to disable. See LayerProfiler.
+int getEnvLayerProfilingInterval()
+{
+    static bool init = false;
+    static int layerProfilingInterval = 0;
+    if (!init)
+    {
+        init = true;
+        const char* layerProfilingIntervalEnv = std::getenv("TRTLLM_LAYER_PROFILING_INTERVAL");
+        if (layerProfilingIntervalEnv)
+        {
+            layerProfilingInterval = std::atoi(layerProfilingIntervalEnv);
+            if (layerProfilingInterval < 0)
+            {
+                TLLM_LOG_WARNING("Invalid value for TRTLLM_LAYER_PROFILING_INTERVAL. The layers will not be profiled!");
+                layerProfilingInterval = 0;
+            }
+        }
+    }
+    return layerProfilingInterval;
+}
+
+// Sample the GPU hardware metrics around one in every N engine steps of each phase, 0 to disable. See
+// GpuMetricsSampler.
+int getEnvGpuMetricsInterval()
+{
+    static bool init = false;
+    static int gpuMetricsInterval = 0;
+    if (!init)
+    {
+        init = true;
+        const char* gpuMetricsIntervalEnv = std::getenv("TRTLLM_GPU_METRICS_INTERVAL");
+        if (gpuMetricsIntervalEnv)
+        {
+            gpuMetricsInterval = std::atoi(gpuMetricsIntervalEnv);
+            if (gpuMetricsInterval < 0)
+            {
+                TLLM_LOG_WARNING("Invalid value for TRTLLM_GPU_METRICS_INTERVAL. GPU metrics will not be sampled!");
+                gpuMetricsInterval = 0;
+            }
+        }
+    }
+    return gpuMetricsInterval;
+}
+
+// Allocate the pinned host buffers with cudaHostAlloc each time instead of reusing the blocks of the pinned pool.
+bool getEnvDisablePinnedPool()
+{
+    static bool init = false;
+    static bool disablePinnedPool = false;
+    if (!init)
+    {
+        init = true;
+        const char* disablePinnedPoolEnv = std::getenv("TRTLLM_DISABLE_PINNED_POOL");
+        if (disablePinnedPoolEnv)
+        {
+            disablePinnedPool = disablePinnedPoolEnv[0] == '1' && disablePinnedPoolEnv[1] == '\0';
+        }
+    }
+    return disablePinnedPool;
+}
+
+// How the engine files are loaded: mmap, direct, auto or read, empty for mmap. See EngineFile.
+std::string const& getEnvEngineLoadMode()
+{
+    static bool init = false;
+    static std::string engineLoadMode;
+    if (!init)
+    {
+        init = true;
+        const char* engineLoadModeEnv = std::getenv("TRTLLM_ENGINE_LOAD_MODE");
+        if (engineLoadModeEnv)
+        {
+            engineLoadMode = engineLoadModeEnv;
+        }
+    }
+    return engineLoadMode;
+}
+
 } // namespace tensorrt_llm::common
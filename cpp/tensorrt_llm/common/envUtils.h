@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <string>
+
 namespace tensorrt_llm::common
 {
 
@@ -25,4 +27,63 @@ bool getEnvMmhaMultiblockDebug();
 
 int getEnvMmhaBlocksPerSequence();
 
+// Bind the host threads of each rank to the CPUs and NUMA node local to its device.
+bool getEnvBindThreadsToDevice();
+
+// Sample with the fused top K / top P kernel instead of the separate top K and top P layers.
+bool getEnvFusedSampling();
+
+// Decode the requests of the GptDecoderBatch of a GptSession with one decoder instead of one decoder per request.
+bool getEnvBatchedDecoding();
+
+// Match the stop words and bad words with an Aho-Corasick automaton instead of comparing every word each step.
+bool getEnvWordsAutomaton();
+
+// Apply the repetition, presence and frequency penalties from per-sequence token histograms updated every step.
+bool getEnvPenaltyHistograms();
+
+// Draw the random numbers of sampling from the seed of each request and the token position instead of curand states.
+bool getEnvCounterBasedRng();
+
+// Ban the repeated n-grams with per-sequence n-gram indices updated every step instead of rescanning the sequences.
+bool getEnvNgramIndex();
+
+// Benchmark the generation attention kernels when configuring the GPT attention plugin and store the fastest per shape.
+bool getEnvProfileGenerationAttention();
+
+// Log the number of tokens routed to each expert of the MoE layers every N steps, 0 to disable.
+int getEnvMoeExpertLoadLogInterval();
+
+// File of the all-reduce strategy table measured at startup and consulted by the AUTO strategy, empty to use the fixed
+// message size thresholds.
+std::string const& getEnvAllReduceStrategyTable();
+
+// Shared directory through which the ranks exchange their bootstrap messages instead of MPI, empty to use MPI. The rank
+// and the number of ranks are then given by getEnvBootstrapRank() and getEnvBootstrapWorldSize().
+std::string const& getEnvBootstrapDir();
+
+int getEnvBootstrapRank();
+
+int getEnvBootstrapWorldSize();
+
+// Place the ranks of the TP groups on the devices with the fastest links between them instead of consecutive devices,
+// when the devices are not given.
+bool getEnvTopologyAwarePlacement();
+
+// Time the collectives with CUDA events and aggregate their durations and sizes per iteration, see CommProfiler.
+bool getEnvCommProfiling();
+
+// Time the layers of one in every N engine enqueues with the TensorRT profiler, 0 to disable. See LayerProfiler.
+int getEnvLayerProfilingInterval();
+
+// Sample the GPU hardware metrics around one in every N engine steps of each phase, 0 to disable. See
+// GpuMetricsSampler.
+int getEnvGpuMetricsInterval();
+
+// Allocate the pinned host buffers with cudaHostAlloc each time instead of reusing the blocks of the pinned pool.
+bool getEnvDisablePinnedPool();
+
+// How the engine files are loaded: mmap, direct, auto or read, empty for mmap. See EngineFile.
+std::string const& getEnvEngineLoadMode();
+
 } // namespace tensorrt_llm::common
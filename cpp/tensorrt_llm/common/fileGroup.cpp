@@ -0,0 +1,239 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2022-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/fileGroup.h"
+
+#include "tensorrt_llm/common/assert.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace tensorrt_llm::mpi
+{
+
+namespace
+{
+
+// Tags of the messages of the collectives, the ones of the callers are not negative
+constexpr int kBcastTag = -1;
+constexpr int kGatherTag = -2;
+
+// Receives poll the directory at growing intervals up to this one
+constexpr auto kMaxPollInterval = std::chrono::milliseconds(1);
+
+template <typename T>
+T reduceOp(T a, T b, MpiOp op)
+{
+    switch (op)
+    {
+    case MpiOp::MAX: return std::max(a, b);
+    case MpiOp::MIN: return std::min(a, b);
+    case MpiOp::SUM: return static_cast<T>(a + b);
+    case MpiOp::PROD: return static_cast<T>(a * b);
+    case MpiOp::LAND: return static_cast<T>(a && b);
+    case MpiOp::LOR: return static_cast<T>(a || b);
+    case MpiOp::LXOR: return static_cast<T>(!a != !b);
+    default: break;
+    }
+    if constexpr (std::is_integral_v<T>)
+    {
+        switch (op)
+        {
+        case MpiOp::BAND: return static_cast<T>(a & b);
+        case MpiOp::BOR: return static_cast<T>(a | b);
+        case MpiOp::BXOR: return static_cast<T>(a ^ b);
+        default: break;
+        }
+    }
+    TLLM_THROW("Reduction %d is not supported by the file bootstrap", static_cast<int>(op));
+}
+
+// Reduces the count values of each of the nbRanks ranks in values, stored one rank after the other.
+template <typename T>
+void reduceRanks(void* recvbuf, std::vector<char> const& values, int count, int nbRanks, MpiOp op)
+{
+    auto const* rankValues = reinterpret_cast<T const*>(values.data());
+    auto* result = static_cast<T*>(recvbuf);
+    std::copy(rankValues, rankValues + count, result);
+    for (int rank = 1; rank < nbRanks; ++rank)
+    {
+        for (int idx = 0; idx < count; ++idx)
+        {
+            result[idx] = reduceOp(result[idx], rankValues[rank * count + idx], op);
+        }
+    }
+}
+
+} // namespace
+
+FileGroup::FileGroup(std::string dir, int rank, int size)
+    : mDir{std::move(dir)}
+    , mRank{rank}
+    , mSize{size}
+{
+    TLLM_CHECK_WITH_INFO(0 <= mRank && mRank < mSize, "Invalid bootstrap rank %d of %d ranks", mRank, mSize);
+    fs::create_directories(mDir);
+}
+
+std::string FileGroup::messagePath(int source, int dest, int tag, std::uint64_t seq) const
+{
+    return mDir + "/" + std::to_string(source) + "_" + std::to_string(dest) + "_" + std::to_string(tag) + "_"
+        + std::to_string(seq);
+}
+
+void FileGroup::send(void const* buffer, std::size_t size, int dest, int tag)
+{
+    std::uint64_t seq;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        seq = mSendSeqs[{dest, tag}]++;
+    }
+    auto const path = messagePath(mRank, dest, tag, seq);
+    auto const tmpPath = path + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary);
+        file.write(static_cast<char const*>(buffer), static_cast<std::streamsize>(size));
+        TLLM_CHECK_WITH_INFO(file.good(), "Cannot write the bootstrap message " + tmpPath);
+    }
+    // The receiver only sees complete messages
+    fs::rename(tmpPath, path);
+}
+
+std::size_t FileGroup::recv(void* buffer, std::size_t size, int source, int tag)
+{
+    std::uint64_t seq;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        seq = mRecvSeqs[{source, tag}]++;
+    }
+    auto const path = messagePath(source, mRank, tag, seq);
+    auto interval = std::chrono::microseconds(10);
+    while (!fs::exists(path))
+    {
+        std::this_thread::sleep_for(interval);
+        interval = std::min<std::chrono::microseconds>(interval * 2, kMaxPollInterval);
+    }
+
+    auto const messageSize = static_cast<std::size_t>(fs::file_size(path));
+    TLLM_CHECK_WITH_INFO(messageSize <= size, "The bootstrap message " + path + " is larger than the receive buffer");
+    {
+        std::ifstream file(path, std::ios::binary);
+        file.read(static_cast<char*>(buffer), static_cast<std::streamsize>(messageSize));
+        TLLM_CHECK_WITH_INFO(file.good(), "Cannot read the bootstrap message " + path);
+    }
+    fs::remove(path);
+    return messageSize;
+}
+
+void FileGroup::bcast(void* buffer, std::size_t size, int root)
+{
+    if (mRank == root)
+    {
+        for (int rank = 0; rank < mSize; ++rank)
+        {
+            if (rank != root)
+            {
+                send(buffer, size, rank, kBcastTag);
+            }
+        }
+    }
+    else
+    {
+        recv(buffer, size, root, kBcastTag);
+    }
+}
+
+void FileGroup::allgather(void const* sendbuf, void* recvbuf, std::size_t size)
+{
+    // Gather on the first rank and broadcast from it
+    auto* gathered = static_cast<char*>(recvbuf);
+    std::memmove(gathered + mRank * size, sendbuf, size);
+    if (mRank == 0)
+    {
+        for (int rank = 1; rank < mSize; ++rank)
+        {
+            recv(gathered + rank * size, size, rank, kGatherTag);
+        }
+    }
+    else
+    {
+        send(sendbuf, size, 0, kGatherTag);
+    }
+    bcast(recvbuf, size * mSize, 0);
+}
+
+void FileGroup::allreduce(void const* sendbuf, void* recvbuf, int count, MpiType dtype, MpiOp op)
+{
+    auto const size = count * getDtypeSize(dtype);
+    std::vector<char> values(size * mSize);
+    allgather(sendbuf, values.data(), size);
+    switch (dtype)
+    {
+    case MpiType::kBYTE:
+    case MpiType::kUINT8: reduceRanks<std::uint8_t>(recvbuf, values, count, mSize, op); break;
+    case MpiType::kFLOAT: reduceRanks<float>(recvbuf, values, count, mSize, op); break;
+    case MpiType::kDOUBLE: reduceRanks<double>(recvbuf, values, count, mSize, op); break;
+    case MpiType::kBOOL: reduceRanks<bool>(recvbuf, values, count, mSize, op); break;
+    case MpiType::kINT8: reduceRanks<std::int8_t>(recvbuf, values, count, mSize, op); break;
+    case MpiType::kINT32: reduceRanks<std::int32_t>(recvbuf, values, count, mSize, op); break;
+    case MpiType::kUINT32: reduceRanks<std::uint32_t>(recvbuf, values, count, mSize, op); break;
+    case MpiType::kINT64: reduceRanks<std::int64_t>(recvbuf, values, count, mSize, op); break;
+    case MpiType::kUINT64: reduceRanks<std::uint64_t>(recvbuf, values, count, mSize, op); break;
+    default: TLLM_THROW("Data type %d cannot be reduced by the file bootstrap", static_cast<int>(dtype));
+    }
+}
+
+void FileGroup::barrier()
+{
+    char const token = 0;
+    std::vector<char> tokens(mSize);
+    allgather(&token, tokens.data(), sizeof(token));
+}
+
+std::shared_ptr<FileGroup> FileGroup::split(int color, int key)
+{
+    std::array<int, 3> const member{color, key, mRank};
+    std::vector<std::array<int, 3>> members(mSize);
+    allgather(member.data(), members.data(), sizeof(member));
+
+    // Same color, ordered by key then rank
+    members.erase(std::remove_if(members.begin(), members.end(), [color](auto const& m) { return m[0] != color; }),
+        members.end());
+    std::sort(members.begin(), members.end());
+    auto const newRank
+        = static_cast<int>(std::distance(members.begin(), std::find(members.begin(), members.end(), member)));
+
+    // All the ranks split the group in the same order
+    std::uint64_t splitIdx;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        splitIdx = mNbSplits++;
+    }
+    auto dir = mDir + "/split" + std::to_string(splitIdx) + "_" + std::to_string(color);
+    return std::make_shared<FileGroup>(std::move(dir), newRank, static_cast<int>(members.size()));
+}
+
+} // namespace tensorrt_llm::mpi
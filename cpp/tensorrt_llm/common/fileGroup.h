@@ -0,0 +1,88 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 2022-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/mpiUtils.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace tensorrt_llm::mpi
+{
+
+// Group of ranks that exchange their messages through the files of a directory shared by all of them, so that they
+// can be launched without mpirun. Each message is a file named after its source, destination, tag and sequence number,
+// written to a temporary file and renamed so that it appears complete, and removed by the receiver. The messages
+// between two ranks with the same tag are received in the order they are sent, like MPI's.
+//
+// It bootstraps NCCL and the CUDA IPC buffers, which only exchange a few small messages: receives poll the directory.
+// The directory must be empty when the ranks start.
+class FileGroup
+{
+public:
+    //! \param dir The directory of the group.
+    //! \param rank The rank in the group.
+    //! \param size The number of ranks of the group.
+    FileGroup(std::string dir, int rank, int size);
+
+    [[nodiscard]] int getRank() const
+    {
+        return mRank;
+    }
+
+    [[nodiscard]] int getSize() const
+    {
+        return mSize;
+    }
+
+    void send(void const* buffer, std::size_t size, int dest, int tag);
+
+    //! \brief Blocks until the message arrives, it may be shorter than size. Returns its size.
+    std::size_t recv(void* buffer, std::size_t size, int source, int tag);
+
+    void bcast(void* buffer, std::size_t size, int root);
+
+    //! \brief Gathers size bytes of every rank in recvbuf, ordered by rank.
+    void allgather(void const* sendbuf, void* recvbuf, std::size_t size);
+
+    void allreduce(void const* sendbuf, void* recvbuf, int count, MpiType dtype, MpiOp op);
+
+    void barrier();
+
+    //! \brief Groups the ranks by color, ordered by key then rank. Collective over the ranks of the group.
+    std::shared_ptr<FileGroup> split(int color, int key);
+
+private:
+    std::string messagePath(int source, int dest, int tag, std::uint64_t seq) const;
+
+    std::string mDir;
+    int mRank;
+    int mSize;
+    // Sequence numbers of the messages sent to and received from each rank, by (rank, tag)
+    std::map<std::pair<int, int>, std::uint64_t> mSendSeqs;
+    std::map<std::pair<int, int>, std::uint64_t> mRecvSeqs;
+    // Number of splits of the group, each one names the directories of its subgroups
+    std::uint64_t mNbSplits{0};
+    std::mutex mMutex;
+};
+
+} // namespace tensorrt_llm::mpi
@@ -66,6 +66,16 @@ void Logger::log(std::exception const& ex, Logger::Level level)
     log(level, "%s: %s", TllmException::demangle(typeid(ex).name()).c_str(), ex.what());
 }
 
+std::uint64_t LogRateLimiter::getLimit()
+{
+    static std::uint64_t const limit = []() -> std::uint64_t
+    {
+        char const* env = std::getenv("TLLM_LOG_RATE_LIMIT");
+        return env != nullptr ? std::strtoull(env, nullptr, 10) : 0;
+    }();
+    return limit;
+}
+
 Logger* Logger::getLogger()
 {
     thread_local Logger instance;
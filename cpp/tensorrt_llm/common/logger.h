@@ -16,12 +16,18 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <iostream>
 #include <map>
 #include <stdexcept>
 #include <string>
 
+#include "tensorrt_llm/common/asyncLogger.h"
 #include "tensorrt_llm/common/stringUtils.h"
 
 namespace tensorrt_llm::common
@@ -119,13 +125,49 @@ private:
     {
         return PREFIX + "[" + getLevelName(level) + "][" + std::to_string(rank) + "] ";
     }
+
+    // Formats into a record of AsyncLogger, without the rank if it is negative
+    template <typename... Args>
+    void logAsync(Level level, int rank, char const* format, Args const&... args);
 };
 
+template <typename... Args>
+void Logger::logAsync(Logger::Level level, int rank, char const* format, Args const&... args)
+{
+    AsyncLogger::Record record;
+    record.toStderr = level_ >= WARNING;
+    auto constexpr size = static_cast<int>(AsyncLogger::kMaxMessageSize);
+    auto const& levelName = getLevelName(level);
+    auto const prefixSize = rank < 0
+        ? std::snprintf(record.text, size, "%s[%s] ", PREFIX.c_str(), levelName.c_str())
+        : std::snprintf(record.text, size, "%s[%s][%d] ", PREFIX.c_str(), levelName.c_str(), rank);
+    auto const offset = std::clamp(prefixSize, 0, size - 1);
+    if constexpr (sizeof...(args) > 0)
+    {
+        std::snprintf(record.text + offset, size - offset, format, args...);
+    }
+    else
+    {
+        std::snprintf(record.text + offset, size - offset, "%s", format);
+    }
+    AsyncLogger::push(record);
+    if (level >= WARNING)
+    {
+        // Warnings and errors are out before the caller goes on, e.g. to throw
+        AsyncLogger::flush();
+    }
+}
+
 template <typename... Args>
 void Logger::log(Logger::Level level, char const* format, Args const&... args)
 {
     if (level_ <= level)
     {
+        if (AsyncLogger::isEnabled())
+        {
+            logAsync(level, -1, format, args...);
+            return;
+        }
         auto const fmt = getPrefix(level) + format;
         auto& out = level_ < WARNING ? std::cout : std::cerr;
         if constexpr (sizeof...(args) > 0)
@@ -145,6 +187,11 @@ void Logger::log(const Logger::Level level, const int rank, char const* format,
 {
     if (level_ <= level)
     {
+        if (AsyncLogger::isEnabled())
+        {
+            logAsync(level, rank, format, args...);
+            return;
+        }
         auto const fmt = getPrefix(level, rank) + format;
         auto& out = level_ < WARNING ? std::cout : std::cerr;
         if constexpr (sizeof...(args) > 0)
@@ -159,7 +206,70 @@ void Logger::log(const Logger::Level level, const int rank, char const* format,
     }
 }
 
-#define TLLM_LOG(level, ...) tensorrt_llm::common::Logger::getLogger()->log(level, __VA_ARGS__)
+//! \brief Limits the messages of one call site to TLLM_LOG_RATE_LIMIT per second, unlimited by default. The number
+//! of messages suppressed in a second is logged with the first message of the next one.
+class LogRateLimiter
+{
+public:
+    LogRateLimiter(char const* file, int line)
+        : mFile{file}
+        , mLine{line}
+    {
+    }
+
+    bool tryAcquire(Logger::Level level)
+    {
+        auto const limit = getLimit();
+        if (limit == 0)
+        {
+            return true;
+        }
+        auto const sinceEpoch = std::chrono::steady_clock::now().time_since_epoch();
+        auto const now = std::chrono::duration_cast<std::chrono::seconds>(sinceEpoch).count();
+        auto window = mWindow.load(std::memory_order_relaxed);
+        if (now != window && mWindow.compare_exchange_strong(window, now, std::memory_order_relaxed))
+        {
+            mCount.store(0, std::memory_order_relaxed);
+            if (auto const numSuppressed = mNumSuppressed.exchange(0, std::memory_order_relaxed); numSuppressed > 0)
+            {
+                Logger::getLogger()->log(level, "Suppressed %lu messages of %s:%d", numSuppressed, mFile, mLine);
+            }
+        }
+        if (mCount.fetch_add(1, std::memory_order_relaxed) < limit)
+        {
+            return true;
+        }
+        mNumSuppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    //! \brief TLLM_LOG_RATE_LIMIT, read once, 0 if unset.
+    static std::uint64_t getLimit();
+
+private:
+    char const* mFile;
+    int mLine;
+    std::atomic<std::int64_t> mWindow{-1};
+    std::atomic<std::uint64_t> mCount{0};
+    std::atomic<std::uint64_t> mNumSuppressed{0};
+};
+
+// The arguments are only evaluated for the messages that are logged. The limiter lives in a lambda, a static variable
+// cannot be defined in the constexpr functions that log.
+#define TLLM_LOG(level, ...)                                                                                           \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        auto* const tllmLogger = tensorrt_llm::common::Logger::getLogger();                                            \
+        if (tllmLogger->getLevel() <= (level)                                                                          \
+            && [](tensorrt_llm::common::Logger::Level tllmLevel)                                                       \
+            {                                                                                                          \
+                static tensorrt_llm::common::LogRateLimiter tllmLogRateLimiter{__FILE__, __LINE__};                    \
+                return tllmLogRateLimiter.tryAcquire(tllmLevel);                                                       \
+            }(level))                                                                                                  \
+        {                                                                                                              \
+            tllmLogger->log(level, __VA_ARGS__);                                                                       \
+        }                                                                                                              \
+    } while (0)
 #define TLLM_LOG_TRACE(...) TLLM_LOG(tensorrt_llm::common::Logger::TRACE, __VA_ARGS__)
 #define TLLM_LOG_DEBUG(...) TLLM_LOG(tensorrt_llm::common::Logger::DEBUG, __VA_ARGS__)
 #define TLLM_LOG_INFO(...) TLLM_LOG(tensorrt_llm::common::Logger::INFO, __VA_ARGS__)
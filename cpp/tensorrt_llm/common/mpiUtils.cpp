@@ -17,6 +17,8 @@
 #include "tensorrt_llm/common/mpiUtils.h"
 
 #include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/fileGroup.h"
 #include "tensorrt_llm/common/logger.h"
 #include "tensorrt_llm/runtime/common.h"
 
@@ -54,6 +56,26 @@ MPI_Datatype getMpiDtype(MpiType dtype)
     return dtype_map.at(dtype);
 }
 
+std::size_t getDtypeSize(MpiType dtype)
+{
+    static const std::unordered_map<MpiType, std::size_t> dtype_size_map{
+        {MpiType::kBYTE, 1},
+        {MpiType::kHALF, 2},
+        {MpiType::kFLOAT, 4},
+        {MpiType::kDOUBLE, 8},
+        {MpiType::kBOOL, sizeof(bool)},
+        {MpiType::kINT8, 1},
+        {MpiType::kUINT8, 1},
+        {MpiType::kINT32, 4},
+        {MpiType::kUINT32, 4},
+        {MpiType::kINT64, 8},
+        {MpiType::kUINT64, 8},
+        {MpiType::kFP8, 1},
+        {MpiType::kBF16, 2},
+    };
+    return dtype_size_map.at(dtype);
+}
+
 MPI_Op getMpiOp(MpiOp op)
 {
     static const std::unordered_map<MpiOp, MPI_Op> op_map{
@@ -111,18 +133,34 @@ void initialize(MpiThreadSupport threadMode)
 
 void MpiComm::barrier() const
 {
+    if (mFileGroup)
+    {
+        mFileGroup->barrier();
+        return;
+    }
     MPICHECK(MPI_Barrier(mComm));
 }
 
 std::shared_ptr<MpiRequest> MpiComm::bcastAsync(void* buffer, size_t size, MpiType dtype, int root) const
 {
     std::shared_ptr<MpiRequest> r = std::make_shared<MpiRequest>();
+    if (mFileGroup)
+    {
+        mFileGroup->bcast(buffer, size * getDtypeSize(dtype), root);
+        r->mRequest = MPI_REQUEST_NULL;
+        return r;
+    }
     MPICHECK(MPI_Ibcast(buffer, size, getMpiDtype(dtype), root, mComm, &r->mRequest));
     return r;
 }
 
 void MpiComm::bcast(void* buffer, size_t size, MpiType dtype, int root) const
 {
+    if (mFileGroup)
+    {
+        mFileGroup->bcast(buffer, size * getDtypeSize(dtype), root);
+        return;
+    }
     MPICHECK(MPI_Bcast(buffer, size, getMpiDtype(dtype), root, mComm));
 }
 
@@ -145,18 +183,35 @@ void MpiComm::bcast(std::vector<int64_t>& packed, int root) const
 
 void MpiComm::send(void const* buffer, size_t size, MpiType dtype, int dest, int tag) const
 {
+    if (mFileGroup)
+    {
+        mFileGroup->send(buffer, size * getDtypeSize(dtype), dest, tag);
+        return;
+    }
     MPICHECK(MPI_Send(buffer, size, getMpiDtype(dtype), dest, tag, mComm));
 }
 
 MPI_Status MpiComm::recv(void* buffer, size_t size, MpiType dtype, int source, int tag) const
 {
     MPI_Status status{};
+    if (mFileGroup)
+    {
+        mFileGroup->recv(buffer, size * getDtypeSize(dtype), source, tag);
+        status.MPI_SOURCE = source;
+        status.MPI_TAG = tag;
+        status.MPI_ERROR = MPI_SUCCESS;
+        return status;
+    }
     MPICHECK(MPI_Recv(buffer, size, getMpiDtype(dtype), source, tag, mComm, &status));
     return status;
 }
 
 MpiComm MpiComm::split(int color, int key) const
 {
+    if (mFileGroup)
+    {
+        return MpiComm{mFileGroup->split(color, key)};
+    }
     MPI_Comm splitComm;
     MPICHECK(MPI_Comm_split(mComm, color, key, &splitComm));
     return MpiComm{splitComm, true};
@@ -164,16 +219,30 @@ MpiComm MpiComm::split(int color, int key) const
 
 void MpiComm::allreduce(const void* sendbuf, void* recvbuf, int count, MpiType dtype, MpiOp op) const
 {
+    if (mFileGroup)
+    {
+        mFileGroup->allreduce(sendbuf, recvbuf, count, dtype, op);
+        return;
+    }
     MPICHECK(MPI_Allreduce(sendbuf, recvbuf, count, getMpiDtype(dtype), getMpiOp(op), mComm));
 }
 
 void MpiComm::allgather(const void* sendbuf, void* recvbuf, int count, MpiType dtype) const
 {
+    if (mFileGroup)
+    {
+        mFileGroup->allgather(sendbuf, recvbuf, count * getDtypeSize(dtype));
+        return;
+    }
     MPICHECK(MPI_Allgather(sendbuf, count, getMpiDtype(dtype), recvbuf, count, getMpiDtype(dtype), mComm));
 }
 
 int MpiComm::getRank() const
 {
+    if (mFileGroup)
+    {
+        return mFileGroup->getRank();
+    }
     int rank = 0;
     MPICHECK(MPI_Comm_rank(mComm, &rank));
     return rank;
@@ -181,6 +250,10 @@ int MpiComm::getRank() const
 
 int MpiComm::getSize() const
 {
+    if (mFileGroup)
+    {
+        return mFileGroup->getSize();
+    }
     int world_size = 1;
     MPICHECK(MPI_Comm_size(mComm, &world_size));
     return world_size;
@@ -188,16 +261,24 @@ int MpiComm::getSize() const
 
 MpiComm const& MpiComm::world()
 {
-    static MpiComm commWorld{MPI_COMM_WORLD, false};
+    static MpiComm commWorld = common::getEnvBootstrapDir().empty()
+        ? MpiComm{MPI_COMM_WORLD, false}
+        : fileGroup(common::getEnvBootstrapDir(), common::getEnvBootstrapRank(), common::getEnvBootstrapWorldSize());
     return commWorld;
 }
 
 MpiComm& MpiComm::session()
 {
-    static MpiComm commSession{world(), false};
+    static MpiComm commSession = world().mFileGroup ? MpiComm{world().mFileGroup} : MpiComm{world(), false};
     return commSession;
 }
 
+MpiComm MpiComm::fileGroup(std::string const& dir, int rank, int size)
+{
+    TLLM_LOG_INFO("Bootstrapping rank %d of %d through %s", rank, size, dir.c_str());
+    return MpiComm{std::make_shared<FileGroup>(dir + "/world", rank, size)};
+}
+
 MpiComm::MpiComm(MPI_Comm g, bool freeComm)
     : mComm{g}
     , mFreeComm{freeComm}
@@ -209,6 +290,14 @@ MpiComm::MpiComm(MPI_Comm g, bool freeComm)
     }
 }
 
+MpiComm::MpiComm(std::shared_ptr<FileGroup> fileGroup)
+    : mComm{MPI_COMM_NULL}
+    , mFreeComm{false}
+    , mFileGroup{std::move(fileGroup)}
+{
+    TLLM_CHECK(mFileGroup != nullptr);
+}
+
 MpiComm::~MpiComm() noexcept
 {
     if (mFreeComm && mComm && MPI_Comm_free(&mComm) != MPI_SUCCESS)
@@ -220,15 +309,20 @@ MpiComm::~MpiComm() noexcept
 MpiComm::MpiComm(MpiComm&& comm) noexcept
     : mComm{comm.mComm}
     , mFreeComm{comm.mFreeComm}
+    , mFileGroup{std::move(comm.mFileGroup)}
 {
     comm.mFreeComm = false;
 }
 
 MpiComm& MpiComm::operator=(MpiComm&& comm) noexcept
 {
-    this->~MpiComm();
+    if (mFreeComm && mComm && MPI_Comm_free(&mComm) != MPI_SUCCESS)
+    {
+        TLLM_LOG_ERROR("MPI_Comm_free failed");
+    }
     mComm = comm.mComm;
     mFreeComm = comm.mFreeComm;
+    mFileGroup = std::move(comm.mFileGroup);
     comm.mFreeComm = false;
     return *this;
 }
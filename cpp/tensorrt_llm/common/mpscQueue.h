@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+
+namespace tensorrt_llm::common
+{
+
+//! \brief Unbounded multi-producer single-consumer queue.
+//!
+//! push is lock-free and wait-free, one atomic exchange per element, and may be called from any thread.
+//! tryPop must only be called from a single consumer thread. Elements pushed by one producer are popped in order.
+//! A push that has exchanged the tail but not yet linked its node hides the elements behind it until it completes,
+//! so tryPop may briefly return nothing while the queue is not empty.
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue()
+        : mHead{new Node{}}
+        , mTail{mHead.load(std::memory_order_relaxed)}
+    {
+    }
+
+    ~MpscQueue()
+    {
+        auto* node = mTail;
+        while (node != nullptr)
+        {
+            auto* next = node->next.load(std::memory_order_relaxed);
+            delete node;
+            node = next;
+        }
+    }
+
+    MpscQueue(MpscQueue const&) = delete;
+    MpscQueue& operator=(MpscQueue const&) = delete;
+
+    void push(T value)
+    {
+        auto* node = new Node{std::move(value)};
+        auto* prev = mHead.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    std::optional<T> tryPop()
+    {
+        auto* next = mTail->next.load(std::memory_order_acquire);
+        if (next == nullptr)
+        {
+            return std::nullopt;
+        }
+        // next becomes the new stub, its value is moved out
+        std::optional<T> value{std::move(next->value)};
+        next->value.reset();
+        delete mTail;
+        mTail = next;
+        return value;
+    }
+
+    //! \brief Pops up to maxCount elements into out, returns the number of elements popped.
+    template <typename TContainer>
+    std::size_t popAll(TContainer& out, std::size_t maxCount = static_cast<std::size_t>(-1))
+    {
+        std::size_t count = 0;
+        while (count < maxCount)
+        {
+            auto value = tryPop();
+            if (!value)
+            {
+                break;
+            }
+            out.push_back(std::move(*value));
+            ++count;
+        }
+        return count;
+    }
+
+    //! \brief Whether the consumer sees no element. Only meaningful on the consumer thread.
+    [[nodiscard]] bool empty() const
+    {
+        return mTail->next.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    struct Node
+    {
+        Node() = default;
+
+        explicit Node(T&& _value)
+            : value{std::move(_value)}
+        {
+        }
+
+        std::optional<T> value;
+        std::atomic<Node*> next{nullptr};
+    };
+
+    // Last pushed node, shared by the producers
+    alignas(64) std::atomic<Node*> mHead;
+    // Stub node before the next element to pop, owned by the consumer
+    alignas(64) Node* mTail;
+};
+
+} // namespace tensorrt_llm::common
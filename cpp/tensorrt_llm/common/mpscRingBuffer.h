@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace tensorrt_llm::common
+{
+
+//! \brief Bounded multi-producer single-consumer ring buffer.
+//!
+//! tryPush is lock-free and may be called from any thread, tryPop must only be called from a single consumer thread.
+//! Neither allocates, the slots are allocated once, so T must be default constructible. Each slot has a sequence
+//! number telling whether it holds the element of the current lap, so a producer that has claimed a slot but not yet
+//! written it hides the elements behind it until it completes.
+template <typename T>
+class MpscRingBuffer
+{
+public:
+    //! \brief The capacity is rounded up to a power of two.
+    explicit MpscRingBuffer(std::size_t capacity)
+        : mCapacity{roundUpToPowerOfTwo(capacity)}
+        , mMask{mCapacity - 1}
+        , mSlots{std::make_unique<Slot[]>(mCapacity)}
+    {
+        for (std::size_t i = 0; i < mCapacity; ++i)
+        {
+            mSlots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRingBuffer(MpscRingBuffer const&) = delete;
+    MpscRingBuffer& operator=(MpscRingBuffer const&) = delete;
+
+    //! \brief Returns false and drops value if the buffer is full.
+    bool tryPush(T const& value)
+    {
+        auto head = mHead.load(std::memory_order_relaxed);
+        while (true)
+        {
+            auto& slot = mSlots[head & mMask];
+            auto const sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence == head)
+            {
+                if (mHead.compare_exchange_weak(head, head + 1, std::memory_order_relaxed))
+                {
+                    slot.value = value;
+                    slot.sequence.store(head + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (sequence < head)
+            {
+                // The slot still holds the element of the previous lap
+                return false;
+            }
+            else
+            {
+                head = mHead.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    std::optional<T> tryPop()
+    {
+        auto& slot = mSlots[mTail & mMask];
+        if (slot.sequence.load(std::memory_order_acquire) != mTail + 1)
+        {
+            return std::nullopt;
+        }
+        std::optional<T> value{std::move(slot.value)};
+        slot.sequence.store(mTail + mCapacity, std::memory_order_release);
+        ++mTail;
+        return value;
+    }
+
+    [[nodiscard]] std::size_t capacity() const
+    {
+        return mCapacity;
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<std::size_t> sequence{0};
+        T value{};
+    };
+
+    static std::size_t roundUpToPowerOfTwo(std::size_t value)
+    {
+        std::size_t result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    std::size_t mCapacity;
+    std::size_t mMask;
+    std::unique_ptr<Slot[]> mSlots;
+    // Next slot to claim, shared by the producers
+    alignas(64) std::atomic<std::size_t> mHead{0};
+    // Next slot to pop, only used by the consumer
+    alignas(64) std::size_t mTail{0};
+};
+
+} // namespace tensorrt_llm::common
@@ -20,6 +20,7 @@
 #include <nvtx3/nvtx3.hpp>
 
 #include <array>
+#include <cstdint>
 
 namespace tensorrt_llm::common::nvtx
 {
@@ -39,6 +40,70 @@ inline nvtx3::color nextColor()
 #endif
 }
 
+//! \brief The NVTX domain of the ranges with a category, e.g. `nsys profile --nvtx-domain-include=tensorrt_llm`.
+struct Domain
+{
+    static constexpr char const* name{"tensorrt_llm"};
+};
+
+namespace category
+{
+//! \brief Fetching and scheduling requests, the payload is a number of requests.
+struct Scheduling
+{
+    static constexpr char const* name{"Scheduling"};
+    static constexpr std::uint32_t id{1};
+};
+
+//! \brief Context phase, the payload is a number of context tokens.
+struct Context
+{
+    static constexpr char const* name{"Context"};
+    static constexpr std::uint32_t id{2};
+};
+
+//! \brief Generation phase, the payload is a number of generation requests.
+struct Generation
+{
+    static constexpr char const* name{"Generation"};
+    static constexpr std::uint32_t id{3};
+};
+
+//! \brief Sampling of the next tokens, the payload is a micro batch id or a number of requests.
+struct Decode
+{
+    static constexpr char const* name{"Decode"};
+    static constexpr std::uint32_t id{4};
+};
+
+//! \brief Collectives and point-to-point transfers, the payload is a number of bytes.
+struct Communication
+{
+    static constexpr char const* name{"Communication"};
+    static constexpr std::uint32_t id{5};
+};
+} // namespace category
+
+template <typename Category>
+nvtx3::event_attributes makeAttributes(char const* message, std::int64_t payload)
+{
+    return nvtx3::event_attributes{nvtx3::message{message}, nvtx3::named_category_in<Domain>::get<Category>(),
+        nextColor(), nvtx3::payload{payload}};
+}
+
+//! \brief Marks an instant in the tensorrt_llm domain, e.g. when the payload is only known at the end of a range.
+template <typename Category>
+void mark(char const* message, std::int64_t payload)
+{
+    nvtx3::mark_in<Domain>(makeAttributes<Category>(message, payload));
+}
+
 } // namespace tensorrt_llm::common::nvtx
 
 #define NVTX3_SCOPED_RANGE(range) ::nvtx3::scoped_range range##_range(::tensorrt_llm::common::nvtx::nextColor(), #range)
+
+//! \brief Range in the tensorrt_llm domain, with a category of tensorrt_llm::common::nvtx::category and a payload.
+#define NVTX3_SCOPED_RANGE_IN(range, cat, payload)                                                                     \
+    ::nvtx3::scoped_range_in<::tensorrt_llm::common::nvtx::Domain> range##_range(                                      \
+        ::tensorrt_llm::common::nvtx::makeAttributes<::tensorrt_llm::common::nvtx::category::cat>(                     \
+            #range, static_cast<std::int64_t>(payload)))
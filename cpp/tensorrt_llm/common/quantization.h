@@ -91,6 +91,20 @@ public:
         return QuantMode(BaseType(1u) << 8);
     }
 
+    // The 8-bit KV cache stores one scaling factor per (block, head) next to each paged block instead of
+    // using a single per-tensor scale.
+    static constexpr QuantMode kvCacheBlockScaling() noexcept
+    {
+        return QuantMode(BaseType(1u) << 9);
+    }
+
+    // The scale of the 8-bit KV cache is recalibrated at run time from the absmax of the keys and values of the
+    // requests, the static scale of the engine is only its initial value.
+    static constexpr QuantMode kvCacheOnlineScaling() noexcept
+    {
+        return QuantMode(BaseType(1u) << 10);
+    }
+
     constexpr BaseType value() const noexcept
     {
         return mValue;
@@ -156,9 +170,20 @@ public:
         return hasInt8KvCache() || hasFp8KvCache();
     }
 
+    constexpr bool hasKvCacheBlockScaling() const noexcept
+    {
+        return hasKvCacheQuant() && isSet(kvCacheBlockScaling());
+    }
+
+    constexpr bool hasKvCacheOnlineScaling() const noexcept
+    {
+        return hasKvCacheQuant() && isSet(kvCacheOnlineScaling());
+    }
+
     static constexpr QuantMode fromDescription(bool quantizeWeights = false, bool quantizeActivations = false,
         bool perToken = false, bool perChannel = false, bool useInt4Weights = false, bool useInt8KvCache = false,
-        bool useFp8KvCache = false, bool useFp8Qdq = false)
+        bool useFp8KvCache = false, bool useFp8Qdq = false, bool useKvCacheBlockScaling = false,
+        bool useKvCacheOnlineScaling = false)
     {
         QuantMode quantMode{};
         if (quantizeWeights)
@@ -198,6 +223,16 @@ public:
             quantMode += fp8Qdq();
         }
 
+        if (useKvCacheBlockScaling)
+        {
+            quantMode += kvCacheBlockScaling();
+        }
+
+        if (useKvCacheOnlineScaling)
+        {
+            quantMode += kvCacheOnlineScaling();
+        }
+
         return quantMode;
     }
 
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::common
+{
+
+//! \brief Bounded single-producer single-consumer ring buffer.
+//!
+//! tryPush and tryPop are lock-free and wait-free, and never allocate. The slots are allocated once, so T must be
+//! default constructible. tryPush must only be called from one producer thread and tryPop from one consumer thread.
+template <typename T>
+class SpscRingBuffer
+{
+public:
+    //! \brief The capacity is rounded up to a power of two.
+    explicit SpscRingBuffer(std::size_t capacity)
+        : mSlots(roundUpToPowerOfTwo(capacity))
+        , mMask{mSlots.size() - 1}
+    {
+    }
+
+    SpscRingBuffer(SpscRingBuffer const&) = delete;
+    SpscRingBuffer& operator=(SpscRingBuffer const&) = delete;
+
+    //! \brief Returns false and drops value if the buffer is full.
+    bool tryPush(T value)
+    {
+        auto const head = mHead.load(std::memory_order_relaxed);
+        if (head - mTail.load(std::memory_order_acquire) == mSlots.size())
+        {
+            return false;
+        }
+        mSlots[head & mMask] = std::move(value);
+        mHead.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::optional<T> tryPop()
+    {
+        auto const tail = mTail.load(std::memory_order_relaxed);
+        if (tail == mHead.load(std::memory_order_acquire))
+        {
+            return std::nullopt;
+        }
+        std::optional<T> value{std::move(mSlots[tail & mMask])};
+        mTail.store(tail + 1, std::memory_order_release);
+        return value;
+    }
+
+    //! \brief Pops up to maxCount elements into out, returns the number of elements popped.
+    template <typename TContainer>
+    std::size_t popAll(TContainer& out, std::size_t maxCount = static_cast<std::size_t>(-1))
+    {
+        std::size_t count = 0;
+        while (count < maxCount)
+        {
+            auto value = tryPop();
+            if (!value)
+            {
+                break;
+            }
+            out.push_back(std::move(*value));
+            ++count;
+        }
+        return count;
+    }
+
+    [[nodiscard]] std::size_t capacity() const
+    {
+        return mSlots.size();
+    }
+
+    //! \brief Number of elements, exact only when neither thread is running.
+    [[nodiscard]] std::size_t size() const
+    {
+        return mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_acquire);
+    }
+
+private:
+    static std::size_t roundUpToPowerOfTwo(std::size_t value)
+    {
+        std::size_t result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    std::vector<T> mSlots;
+    std::size_t mMask;
+    // Next slot to push, written by the producer
+    alignas(64) std::atomic<std::size_t> mHead{0};
+    // Next slot to pop, written by the consumer
+    alignas(64) std::atomic<std::size_t> mTail{0};
+};
+
+} // namespace tensorrt_llm::common
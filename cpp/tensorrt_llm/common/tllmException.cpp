@@ -16,6 +16,7 @@
 
 #include "tensorrt_llm/common/tllmException.h"
 
+#include <atomic>
 #include <cstdlib>
 #if !defined(_MSC_VER)
 #include <cxxabi.h>
@@ -30,7 +31,17 @@ namespace tensorrt_llm::common
 namespace
 {
 int constexpr VOID_PTR_SZ = 2 + sizeof(void*) * 2;
+
+std::atomic<TllmException::CreationHook> creationHook{nullptr};
+
+void callCreationHook()
+{
+    if (auto const hook = creationHook.load(std::memory_order_acquire); hook != nullptr)
+    {
+        hook();
+    }
 }
+} // namespace
 
 #if !defined(_MSC_VER)
 
@@ -41,17 +52,24 @@ TllmException::TllmException(char const* file, std::size_t line, const std::stri
     auto const trace = getTrace();
     std::runtime_error::operator=(
         std::runtime_error{fmtstr("%s (%s:%zu)\n%s", msg.c_str(), file, line, trace.c_str())});
+    callCreationHook();
 }
 #else
 TllmException::TllmException(char const* file, std::size_t line, const std::string& msg)
     : mNbFrames{}
     , std::runtime_error{fmtstr("%s (%s:%zu)", msg.c_str(), file, line)}
 {
+    callCreationHook();
 }
 #endif
 
 TllmException::~TllmException() noexcept = default;
 
+void TllmException::setCreationHook(CreationHook hook)
+{
+    creationHook.store(hook, std::memory_order_release);
+}
+
 std::string TllmException::getTrace() const
 {
 #if defined(_MSC_VER)
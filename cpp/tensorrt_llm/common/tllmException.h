@@ -42,6 +42,11 @@ public:
 
     static std::string demangle(char const* name);
 
+    using CreationHook = void (*)();
+
+    //! \brief Sets a function called by each constructor, e.g. to dump diagnostics, nullptr to remove it.
+    static void setCreationHook(CreationHook hook);
+
 private:
     std::array<void*, MAX_FRAMES> mCallstack{};
     int mNbFrames;
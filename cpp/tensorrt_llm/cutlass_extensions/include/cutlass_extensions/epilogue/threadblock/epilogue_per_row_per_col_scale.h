@@ -172,7 +172,7 @@ private:
     typename OutputTileIterator::Fragment fragment_C_;
     typename OutputTileIterator::Fragment fragment_D_;
 
-    ElementAccumulator beta_;
+    ElementCompute beta_;
 
     int column_offset_;
 
@@ -203,11 +203,6 @@ public:
     {
         beta_ = (params.elementwise.beta_ptr ? *params.elementwise.beta_ptr : params.elementwise.beta);
 
-        if (beta_ == ElementAccumulator())
-        {
-            iterator_C_.clear_mask();
-        }
-
         if (!per_channel_quant_ && (ptr_alpha_col_ != nullptr))
         {
             element_alpha_col_ = *ptr_alpha_col_;
@@ -224,6 +219,11 @@ public:
     void set_k_partition(int split_k_index, ///< Index of this threadblock within split-K partitioned scheme
         int split_k_slices)
     {                                       ///< Total number of split-K slices
+        // The source of the partitions after the first one is the partial result in D, which is added unscaled
+        if (split_k_index > 0)
+        {
+            beta_ = ElementCompute(1);
+        }
     }
 
     /// Called to set the batch index
@@ -239,6 +239,11 @@ public:
     CUTLASS_DEVICE
     void begin_epilogue()
     {
+        if (beta_ == ElementCompute())
+        {
+            iterator_C_.clear_mask();
+        }
+
         if (per_channel_quant_)
         {
             iterator_alpha_col_.load(fragment_alpha_col_);
@@ -292,6 +297,19 @@ public:
             result = per_token_scale_accumulator_(result, element_alpha_col_, element_alpha_row_);
         }
 
+        // Adds the source, e.g. the residual, to the scaled accumulators
+        if (beta_ != ElementCompute())
+        {
+            NumericArrayConverter<ElementCompute, ElementOutput, kElementsPerAccess> c_converter;
+            const OutputVector& source = reinterpret_cast<const OutputVector*>(&fragment_C_)[frag_idx];
+            ComputeFragment source_f = c_converter(source);
+            CUTLASS_PRAGMA_UNROLL
+            for (int i = 0; i < kElementsPerAccess; ++i)
+            {
+                result[i] += beta_ * source_f[i];
+            }
+        }
+
         // Convert to the output
         NumericArrayConverter<ElementOutput, ElementCompute, kElementsPerAccess> output_converter;
         OutputVector& output = reinterpret_cast<OutputVector*>(&fragment_D_)[frag_idx];
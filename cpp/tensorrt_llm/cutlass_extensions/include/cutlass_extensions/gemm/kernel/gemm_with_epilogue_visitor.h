@@ -216,6 +216,8 @@ public:
         int64_t batch_stride_A;
         int64_t batch_stride_B;
 
+        int* semaphore;
+
         typename EpilogueVisitor::Params epilogue_visitor;
 
         //
@@ -241,6 +243,7 @@ public:
             , ptr_D(nullptr)
             , batch_stride_A(0)
             , batch_stride_B(0)
+            , semaphore(nullptr)
         {
         }
 
@@ -266,6 +269,7 @@ public:
             , ptr_D(args.ref_D.data())
             , batch_stride_A(args.batch_stride_A)
             , batch_stride_B(args.batch_stride_B)
+            , semaphore(workspace_)
             , epilogue_visitor(args.epilogue_visitor)
         {
 
@@ -509,14 +513,22 @@ public:
 
         int block_idx = threadblock_tile_offset.m() + threadblock_tile_offset.n() * params.grid_tiled_shape.m();
 
+        // Serial split-K: the k partitions of an output tile run their epilogues one after the other, in order. The
+        // first one reads C, the next ones accumulate into the D written by the previous partition.
+        bool const serial_split_k = params.mode == GemmUniversalMode::kGemm && params.grid_tiled_shape.k() > 1;
+        bool const reads_partial_D = serial_split_k && threadblock_tile_offset.k() > 0;
+
+        Semaphore semaphore(params.semaphore + block_idx, thread_idx);
+
         //
         // Construct the epilogue visitor
         //
 
         EpilogueVisitor epilogue_visitor(params.epilogue_visitor, shared_storage.epilogue.visitor,
-            params.problem_size.mn(), thread_idx, warp_idx, lane_idx, params.params_alpha_col, params.params_C,
-            params.params_D, params.quant_option, params.ptr_alpha_row, params.ptr_alpha_col, params.ptr_C,
-            params.ptr_D, threadblock_offset, blockIdx.y * params.problem_size.m());
+            params.problem_size.mn(), thread_idx, warp_idx, lane_idx, params.params_alpha_col,
+            reads_partial_D ? params.params_D : params.params_C, params.params_D, params.quant_option,
+            params.ptr_alpha_row, params.ptr_alpha_col, reads_partial_D ? params.ptr_D : params.ptr_C, params.ptr_D,
+            threadblock_offset, blockIdx.y * params.problem_size.m());
 
         if (params.mode == GemmUniversalMode::kGemm)
         {
@@ -531,8 +543,29 @@ public:
         // Construct the epilogue
         Epilogue epilogue(shared_storage.epilogue.epilogue, thread_idx, warp_idx, lane_idx);
 
+        if (serial_split_k)
+        {
+            // Fetch the semaphore early, its latency is covered by the epilogue construction
+            semaphore.fetch();
+
+            // Wait for the previous partition to write its partial result
+            semaphore.wait(threadblock_tile_offset.k());
+        }
+
         // Execute the epilogue operator to update the destination tensor.
         epilogue(epilogue_visitor, accumulators);
+
+        if (serial_split_k)
+        {
+            // The last partition resets the semaphore for the next launch, the others signal the next partition
+            int lock = 0;
+            if (threadblock_tile_offset.k() + 1 < params.grid_tiled_shape.k())
+            {
+                lock = threadblock_tile_offset.k() + 1;
+            }
+
+            semaphore.release(lock);
+        }
     }
 };
 
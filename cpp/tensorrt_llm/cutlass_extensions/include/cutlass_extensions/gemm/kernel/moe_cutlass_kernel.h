@@ -34,6 +34,7 @@
 
 #include "cutlass_extensions/gemm/kernel/gemm_moe_problem_visitor.h"
 #include "cutlass_extensions/tile_interleaved_layout.h"
+#include "cutlass_extensions/weight_only_quant_op.h"
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -254,6 +255,7 @@ public:
             problem_visitor = typename ProblemVisitor::Params(
                 args.total_rows_before_expert, args.gemm_n, args.gemm_k, args.problem_count, workspace, tile_count);
             threadblock_count = args.threadblock_count;
+            group_size = args.group_size;
             output_op = args.output_op;
             ptr_A = args.ptr_A;
             ptr_B = args.ptr_B;
@@ -294,6 +296,23 @@ public:
                 CUTLASS_TRACE_HOST("MoeFCGemm::can_implement() - weight scales are required for uint8_t and uint4b_t");
                 return Status::kInvalid;
             }
+            if constexpr (use_dq_gemm<Mma>::value)
+            {
+                if constexpr (isFinegrained(Mma::QuantOp))
+                {
+                    if ((args.group_size != 64 && args.group_size != 128) || args.gemm_k % args.group_size != 0)
+                    {
+                        CUTLASS_TRACE_HOST(
+                            "MoeFCGemm::can_implement() - group size must be 64 or 128 and divide gemm_k");
+                        return Status::kInvalid;
+                    }
+                }
+                else if (args.group_size != args.gemm_k)
+                {
+                    CUTLASS_TRACE_HOST("MoeFCGemm::can_implement() - per column scales need group_size == gemm_k");
+                    return Status::kInvalid;
+                }
+            }
         }
         else if (args.weight_scales != nullptr)
         {
@@ -441,15 +460,29 @@ public:
                 __syncthreads();
 
                 // Compute threadblock-scoped matrix multiply-add
-                ElementScale* weight_scale_ptr = params.weight_scales + problem_idx * problem_size.n();
-
                 if constexpr (use_dq_gemm<Mma>::value)
                 {
-                    const MatrixCoord scale_extent = {1, problem_size.n()};
-                    typename Mma::IteratorScale iterator_scale(Mma::IteratorScale::Layout(scale_extent.column()),
-                        weight_scale_ptr, scale_extent, thread_idx, tb_offset_scale);
+                    // The scales of each expert are [gemm_k / group_size, gemm_n], a single row for per column scaling
+                    ElementScale* weight_scale_ptr
+                        = params.weight_scales + problem_idx * (gemm_k / params.group_size) * gemm_n;
+
+                    if constexpr (isFinegrained(Mma::QuantOp))
+                    {
+                        // The fine grained iterator counts the rows of scales in groups of 64
+                        const MatrixCoord scale_extent = {int(gemm_k / 64), problem_size.n()};
+                        typename Mma::IteratorScale iterator_scale(Mma::IteratorScale::Layout(scale_extent.column()),
+                            weight_scale_ptr, nullptr, scale_extent, thread_idx, tb_offset_scale, params.group_size);
+
+                        mma(gemm_k_iterations, accumulators, iterator_A, iterator_B, iterator_scale, accumulators);
+                    }
+                    else
+                    {
+                        const MatrixCoord scale_extent = {1, problem_size.n()};
+                        typename Mma::IteratorScale iterator_scale(Mma::IteratorScale::Layout(scale_extent.column()),
+                            weight_scale_ptr, scale_extent, thread_idx, tb_offset_scale);
 
-                    mma(gemm_k_iterations, accumulators, iterator_A, iterator_B, iterator_scale, accumulators);
+                        mma(gemm_k_iterations, accumulators, iterator_A, iterator_B, iterator_scale, accumulators);
+                    }
                 }
                 else
                 {
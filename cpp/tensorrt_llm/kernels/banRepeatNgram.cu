@@ -171,6 +171,162 @@ INVOKE_BAN_REPEAT_NGRAM(__nv_bfloat16)
 #endif
 #undef INVOKE_BAN_REPEAT_NGRAM
 
+NgramIndex::NgramIndex(int* data, int maxSeqLen)
+    : data(data)
+    , capacity(1)
+    , maxSeqLen(maxSeqLen)
+{
+    // At most half of the slots are used, which keeps the probe sequences short
+    while (capacity < 2 * maxSeqLen)
+    {
+        capacity *= 2;
+    }
+    stride = 2 * capacity + maxSeqLen + 2;
+}
+
+size_t NgramIndex::getSize(int batchSize, int maxSeqLen)
+{
+    return static_cast<size_t>(batchSize) * NgramIndex(nullptr, maxSeqLen).stride * sizeof(int);
+}
+
+void invokeResetNgramIndex(const NgramIndex& index, const int batchOffset, const int batchSize, cudaStream_t stream)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    const size_t stride = index.stride;
+    TLLM_CUDA_CHECK(cudaMemsetAsync(index.data + batchOffset * stride, 0, batchSize * stride * sizeof(int), stream));
+}
+
+//! FNV-1a hash of the n - 1 tokens starting at tokens[begin], with the lowest bit set so that it is never 0
+__device__ __forceinline__ int ngramPrefixKey(const int* tokens, int begin, int length)
+{
+    unsigned int hash = 2166136261u;
+    for (int i = begin; i < begin + length; ++i)
+    {
+        hash = (hash ^ static_cast<unsigned int>(tokens[i])) * 16777619u;
+    }
+    return static_cast<int>(hash | 1u);
+}
+
+template <typename T>
+__global__ void banRepeatNgramFromIndex(T* logits, NgramIndex index, const int** outputIds,
+    const FinishedState* finished, const int* sequenceLengths, const int* noRepeatNgramSizes, const int vocabSizePadded)
+{
+    const int batchIdx = blockIdx.x;
+    const int ngramSize = noRepeatNgramSizes[batchIdx];
+    if (ngramSize == 0 || (finished != nullptr && finished[batchIdx].isFinished()))
+    {
+        return;
+    }
+
+    int* keys = index.data + batchIdx * index.stride;
+    int* heads = keys + index.capacity;
+    int* next = heads + index.capacity;
+    int* indexNgramSize = next + index.maxSeqLen;
+    int* length = indexNgramSize + 1;
+    const unsigned int mask = index.capacity - 1;
+    const int* tokens = outputIds[batchIdx];
+    const int prefixLength = ngramSize - 1;
+
+    int begin = *length;
+    const int end = sequenceLengths[batchIdx];
+    if (end < begin || *indexNgramSize != ngramSize)
+    {
+        // The sequence was replaced without a reset or its n-gram size changed, rebuild its index
+        __syncthreads();
+        for (int i = threadIdx.x; i < index.stride; i += blockDim.x)
+        {
+            keys[i] = 0;
+        }
+        __syncthreads();
+        begin = 0;
+    }
+
+    // The n-gram starting at position p is complete once the token p + ngramSize - 1 is generated
+    for (int p = max(begin - prefixLength, 0) + threadIdx.x; p + prefixLength < end; p += blockDim.x)
+    {
+        const int key = ngramPrefixKey(tokens, p, prefixLength);
+        unsigned int slot = static_cast<unsigned int>(key) & mask;
+        while (true)
+        {
+            const int prev = atomicCAS(keys + slot, 0, key);
+            if (prev == 0 || prev == key)
+            {
+                next[p] = atomicExch(heads + slot, p + 1);
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    __syncthreads();
+    if (threadIdx.x != 0)
+    {
+        return;
+    }
+    *indexNgramSize = ngramSize;
+    *length = end;
+
+    // The generated length must be at least ngram_size to contain an n-gram
+    if (end < ngramSize)
+    {
+        return;
+    }
+
+    // Ban the token that follows each earlier occurrence of the last ngram_size - 1 tokens
+    const int lastBegin = end - prefixLength;
+    const int key = ngramPrefixKey(tokens, lastBegin, prefixLength);
+    unsigned int slot = static_cast<unsigned int>(key) & mask;
+    while (keys[slot] != 0 && keys[slot] != key)
+    {
+        slot = (slot + 1) & mask;
+    }
+    if (keys[slot] == 0)
+    {
+        return;
+    }
+    logits += batchIdx * vocabSizePadded;
+    for (int entry = heads[slot]; entry != 0; entry = next[entry - 1])
+    {
+        // Prefixes with the same hash are told apart by their tokens
+        const int p = entry - 1;
+        bool match = true;
+        for (int i = 0; i < prefixLength && match; ++i)
+        {
+            match = tokens[p + i] == tokens[lastBegin + i];
+        }
+        if (match)
+        {
+            logits[tokens[p + prefixLength]] = static_cast<T>(-INFINITY);
+        }
+    }
+}
+
+template <typename T>
+void invokeBanRepeatNgramFromIndex(T* logits, const NgramIndex& index, const int** outputIds,
+    const FinishedState* finished, const int* sequenceLengths, const int* noRepeatNgramSizes, const int batchSize,
+    const int vocabSizePadded, cudaStream_t stream)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    // After the first step only one n-gram per sequence is added, the first call adds the whole prompt
+    dim3 block(128);
+    dim3 grid(batchSize);
+    banRepeatNgramFromIndex<<<grid, block, 0, stream>>>(
+        logits, index, outputIds, finished, sequenceLengths, noRepeatNgramSizes, vocabSizePadded);
+    sync_check_cuda_error();
+}
+
+#define INVOKE_BAN_REPEAT_NGRAM_FROM_INDEX(T)                                                                          \
+    template void invokeBanRepeatNgramFromIndex(T* logits, const NgramIndex& index, const int** outputIds,             \
+        const FinishedState* finished, const int* sequenceLengths, const int* noRepeatNgramSizes, const int batchSize, \
+        const int vocabSizePadded, cudaStream_t stream);
+
+INVOKE_BAN_REPEAT_NGRAM_FROM_INDEX(float)
+INVOKE_BAN_REPEAT_NGRAM_FROM_INDEX(half)
+#ifdef ENABLE_BF16
+INVOKE_BAN_REPEAT_NGRAM_FROM_INDEX(__nv_bfloat16)
+#endif
+#undef INVOKE_BAN_REPEAT_NGRAM_FROM_INDEX
+
 } // namespace kernels
 
 } // namespace tensorrt_llm
@@ -30,5 +30,48 @@ void invokeBanRepeatNgram(T* logits, const int** output_ids_buf, const FinishedS
     const int* parent_ids_buf, int batch_size, int local_batch_size, int beam_width,
     const int* no_repeat_ngram_size_buf, int id_offset, int vocab_size_padded, size_t step, cudaStream_t stream);
 
+//! \brief Index of the n-grams of a batch of sequences, for banning the repeated n-grams in O(matching n-grams)
+//! instead of O(sequence length) per step. Each sequence has an open addressing hash table from the hash of the
+//! first ngram_size - 1 tokens of an n-gram to the list of the start positions of the n-grams with that hash.
+//! All fields of a sequence are stored contiguously and are empty when zeroed, in the order
+//! keys [capacity], hash of the prefix of each slot with the lowest bit set, 0 if empty
+//! heads [capacity], start position + 1 of the last n-gram inserted in each slot, 0 if none
+//! next [maxSeqLen], start position + 1 of the previous n-gram in the same slot of each n-gram, 0 if none
+//! ngramSize [1], n-gram size the index was built with
+//! length [1], number of tokens of the sequence in the index
+struct NgramIndex
+{
+    int* data;     // [batchSize, stride]
+    int capacity;  // number of slots of a table, a power of 2 at least twice maxSeqLen
+    int maxSeqLen; // maximum sequence length
+    int stride;    // number of ints of a sequence
+
+    NgramIndex(int* data, int maxSeqLen);
+
+    //! \brief Returns the size in bytes of the indices of batchSize sequences
+    static size_t getSize(int batchSize, int maxSeqLen);
+};
+
+//! \brief Empties the indices of the sequences [batchOffset, batchOffset + batchSize)
+void invokeResetNgramIndex(const NgramIndex& index, const int batchOffset, const int batchSize, cudaStream_t stream);
+
+//! \brief Adds the n-grams completed since the last call to the indices, then bans the tokens that would repeat an
+//! n-gram of the sequence. Equivalent to invokeBanRepeatNgram for beam width 1. The index of a sequence is rebuilt
+//! when its length decreases or its n-gram size changes.
+//!
+//! \param logits input/output buffer [batchSize, vocabSizePadded]
+//! \param index input/output n-gram indices
+//! \param outputIds input buffer [batchSize][maxSeqLen]. Contains pointers to rows with output tokens per request
+//! \param finished input buffer [batchSize]. Finished sequences are skipped. Ignored if nullptr
+//! \param sequenceLengths input buffer [batchSize]. Current sequence lengths of the requests
+//! \param noRepeatNgramSizes input buffer [batchSize]. N-gram size per request, 0 disables the ban
+//! \param batchSize batch size
+//! \param vocabSizePadded padded vocab size
+//! \param stream stream
+template <typename T>
+void invokeBanRepeatNgramFromIndex(T* logits, const NgramIndex& index, const int** outputIds,
+    const FinishedState* finished, const int* sequenceLengths, const int* noRepeatNgramSizes, const int batchSize,
+    const int vocabSizePadded, cudaStream_t stream);
+
 } // namespace kernels
 } // namespace tensorrt_llm
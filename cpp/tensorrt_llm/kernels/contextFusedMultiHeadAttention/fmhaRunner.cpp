@@ -85,7 +85,9 @@ public:
     {
         TLLM_CHECK_WITH_INFO(
             (sm == kSM_80 || sm == kSM_86 || sm == kSM_89 || sm == kSM_90), "Unsupported architecture");
-        TLLM_CHECK_WITH_INFO((mDataType == DATA_TYPE_FP16 || mDataType == DATA_TYPE_BF16), "Unsupported data type");
+        // The kernels are precompiled cubins (see cubin/), there are no FP8 ones nor sources to generate them from
+        TLLM_CHECK_WITH_INFO((mDataType == DATA_TYPE_FP16 || mDataType == DATA_TYPE_BF16),
+            "Unsupported data type, the fused MHA kernels only exist for FP16 and BF16");
 
         pagedKVXmmaKernel = getPagedKVXMMAKernelsV2(mDataType, sm);
         xmmaKernel = getXMMAKernelsV2(mDataType, sm);
@@ -246,7 +248,8 @@ public:
         mLaunchParams.force_unroll = true;
 
         // enable warp-specialization kernels when s > 512.
-        if (isSm90 && s_kv > 512)
+        // Those use TMA descriptors, which are only generated for some head sizes.
+        if (isSm90 && s_kv > 512 && has_paged_kv_tma_meta_info())
         {
             mLaunchParams.warp_specialization = true;
             mLaunchParams.use_tma = true;
@@ -292,6 +295,18 @@ public:
         mPagedKVParams.kv_stride_in_bytes = tokens_per_kv_block * mHeadSize * sizeof(half);
     }
 
+    bool has_paged_kv_tma_meta_info() const
+    {
+        for (unsigned int i = 0u; i < sizeof(sTmaPagedKVMetaInfo) / sizeof(sTmaPagedKVMetaInfo[0]); ++i)
+        {
+            if (static_cast<int>(sTmaPagedKVMetaInfo[i].mD) == mHeadSize)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
     // NOTE: assume that heads_interleaved = false (b, s, 3, h, d), and sequences are padded/non-padded
     // TMA descriptors are used as grid_constant parameters (remove MemCpyH2D operations)
     void set_tma_descriptors()
@@ -616,6 +631,16 @@ FusedMHARunnerV2::FusedMHARunnerV2(
 
 FusedMHARunnerV2::~FusedMHARunnerV2() = default;
 
+void FusedMHARunnerV2::loadKernels(const Data_type dataType, const int sm)
+{
+    if ((sm == kSM_80 || sm == kSM_86 || sm == kSM_89 || sm == kSM_90)
+        && (dataType == DATA_TYPE_FP16 || dataType == DATA_TYPE_BF16))
+    {
+        getPagedKVXMMAKernelsV2(dataType, sm);
+        getXMMAKernelsV2(dataType, sm);
+    }
+}
+
 void FusedMHARunnerV2::setup(const int b, const int s, const int sliding_window_size, const int total_seqlen,
     const bool has_alibi, const bool scale_alibi, const int tp_size, const int tp_rank)
 {
@@ -675,5 +700,17 @@ bool MHARunner::fmha_supported(const int headSize, const int sm)
     return false;
 }
 
+bool MHARunner::fmha_paged_kv_supported(const int headSize, const int sm)
+{
+    // Hopper falls back to the non-warp-specialized paged kv kernels for the head sizes without TMA kernels.
+    if (sm == kSM_80 || sm == kSM_86 || sm == kSM_89 || sm == kSM_90)
+    {
+        return (headSize == 16 || headSize == 32 || headSize == 40 || headSize == 64 || headSize == 80
+            || headSize == 128 || headSize == 160 || headSize == 256);
+    }
+
+    return false;
+}
+
 } // namespace kernels
 } // namespace tensorrt_llm
@@ -58,6 +58,9 @@ public:
 
     static bool fmha_supported(const int headSize, const int sm);
 
+    // The paged kv kernels (used when the queries only cover part of the kv sequence) have a wider head size coverage.
+    static bool fmha_paged_kv_supported(const int headSize, const int sm);
+
     virtual bool fmha_supported() = 0;
 
     virtual void setup_flags(const bool force_fp32_acc, const bool is_s_padded, const bool causal_mask,
@@ -90,6 +93,9 @@ public:
 
     ~FusedMHARunnerV2(); // for pimpl
 
+    // Loads the cubins of the kernels for the current device ahead of the first runner, which then finds them loaded.
+    static void loadKernels(const Data_type dataType, const int sm);
+
     void setup(const int b, const int s, const int sliding_window_size, const int total_seqlen,
         const bool has_alibi = false, const bool scale_alibi = false, const int tp_size = 1,
         const int tp_rank = 0) override;
@@ -194,6 +194,9 @@ public:
         int device_id;
         cudaGetDevice(&device_id);
         static std::unique_ptr<TFusedMHAKernelFactory<TFusedMHAKernelList>> s_factory[32] = {nullptr};
+        // The kernels can be loaded by the plugin warmup threads while the engine is deserialized
+        static std::mutex s_mutex;
+        std::lock_guard<std::mutex> lg(s_mutex);
         if (s_factory[device_id] == nullptr)
         {
             assert(device_id <= 32);
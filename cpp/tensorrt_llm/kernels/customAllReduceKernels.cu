@@ -16,6 +16,7 @@
 
 #include "customAllReduceKernels.h"
 #include "tensorrt_llm/common/cudaTypeUtils.cuh"
+#include "tensorrt_llm/common/reduceKernelUtils.cuh"
 #include <tuple>
 
 namespace tensorrt_llm::kernels
@@ -24,6 +25,8 @@ namespace tensorrt_llm::kernels
 using tensorrt_llm::common::hadd2;
 using tensorrt_llm::common::datatype_enum;
 using tensorrt_llm::common::divUp;
+using tensorrt_llm::common::blockReduceSum;
+using tensorrt_llm::common::cuda_cast;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -224,15 +227,11 @@ static __global__ void oneShotAllReduceKernel(AllReduceParams params)
     }
 }
 
+// First stage of the two shot all-reduce: each rank sums its slice [rank_offset, rank_offset + elts_per_rank) of the
+// peer buffers into its own peer buffer.
 template <typename T, int RANKS_PER_NODE>
-static __global__ void twoShotAllReduceKernel(AllReduceParams params)
+static __device__ void twoShotReduceScatter(const AllReduceParams& params, const int bidx, const int tidx)
 {
-
-    // The block index.
-    const int bidx = blockIdx.x;
-    // The thread index with the block.
-    const int tidx = threadIdx.x;
-
     // The number of elements packed into one for comms
     static constexpr int NUM_ELTS = std::is_same<T, uint32_t>::value ? 4 : 8;
 
@@ -249,14 +248,11 @@ static __global__ void twoShotAllReduceKernel(AllReduceParams params)
 
     // The source pointers. Distributed round-robin for the different warps.
     T* src_d[RANKS_PER_NODE];
-    // The destination ranks for round-robin gathering
-    size_t dst_rank[RANKS_PER_NODE];
 #pragma unroll
     for (int ii = 0; ii < RANKS_PER_NODE; ++ii)
     {
         int rank = (params.local_rank + ii) % RANKS_PER_NODE;
         src_d[ii] = reinterpret_cast<T*>(params.peer_comm_buffer_ptrs[rank]);
-        dst_rank[ii] = rank;
     }
 
     // Each block accumulates the values from the different GPUs on the same node.
@@ -282,7 +278,12 @@ static __global__ void twoShotAllReduceKernel(AllReduceParams params)
         // Store to the local buffer.
         reinterpret_cast<PackedType*>(&src_d[0][local_offset])[0] = sums;
     }
+}
 
+// Waits until the blocks with the same index of all the ranks are done with their slice.
+template <int RANKS_PER_NODE>
+static __device__ void twoShotBlockBarrier(const AllReduceParams& params, const int bidx, const int tidx)
+{
     // sync threads to make sure all block threads have the sums
     __syncthreads();
 
@@ -304,6 +305,30 @@ static __global__ void twoShotAllReduceKernel(AllReduceParams params)
 
     // sync threads to make sure all other ranks has the final partial results
     __syncthreads();
+}
+
+// Second stage of the two shot all-reduce: gathers the reduced slices of all the ranks into the output.
+template <typename T, int RANKS_PER_NODE>
+static __device__ void twoShotAllGather(const AllReduceParams& params, const int bidx, const int tidx)
+{
+    // The number of elements packed into one for comms
+    static constexpr int NUM_ELTS = std::is_same<T, uint32_t>::value ? 4 : 8;
+
+    // Packed data type for comms
+    using PackedType = typename ARTypeConverter<T>::Type;
+
+    const size_t block_offset = bidx * params.elts_per_block + tidx * NUM_ELTS;
+
+    // The source pointers and the destination ranks for round-robin gathering
+    T* src_d[RANKS_PER_NODE];
+    size_t dst_rank[RANKS_PER_NODE];
+#pragma unroll
+    for (int ii = 0; ii < RANKS_PER_NODE; ++ii)
+    {
+        int rank = (params.local_rank + ii) % RANKS_PER_NODE;
+        src_d[ii] = reinterpret_cast<T*>(params.peer_comm_buffer_ptrs[rank]);
+        dst_rank[ii] = rank;
+    }
 
     size_t max_block_offset = min(block_offset + params.elts_per_block, params.elts_per_rank);
     // Gather all needed elts from other intra-node ranks
@@ -324,6 +349,361 @@ static __global__ void twoShotAllReduceKernel(AllReduceParams params)
     }
 }
 
+template <typename T, int RANKS_PER_NODE>
+static __global__ void twoShotAllReduceKernel(AllReduceParams params)
+{
+    twoShotReduceScatter<T, RANKS_PER_NODE>(params, blockIdx.x, threadIdx.x);
+    twoShotBlockBarrier<RANKS_PER_NODE>(params, blockIdx.x, threadIdx.x);
+    twoShotAllGather<T, RANKS_PER_NODE>(params, blockIdx.x, threadIdx.x);
+}
+
+template <typename T, int RANKS_PER_NODE>
+static __global__ void reduceScatterKernel(AllReduceParams params)
+{
+    twoShotReduceScatter<T, RANKS_PER_NODE>(params, blockIdx.x, threadIdx.x);
+}
+
+// The barrier also makes sure the peers have finished what they ran on their reduced slice since the reduce-scatter.
+template <typename T, int RANKS_PER_NODE>
+static __global__ void allGatherKernel(AllReduceParams params)
+{
+    twoShotBlockBarrier<RANKS_PER_NODE>(params, blockIdx.x, threadIdx.x);
+    twoShotAllGather<T, RANKS_PER_NODE>(params, blockIdx.x, threadIdx.x);
+}
+
+#if defined(__CUDA_ARCH__) && __CUDA_ARCH__ >= 900 && CUDART_VERSION >= 12010
+#define ENABLE_MULTIMEM 1
+#endif
+
+// Sum over the ranks of the 16 bytes at addr of the multicast object, computed by the NVSwitch. The half precision
+// types are accumulated in fp32.
+template <typename T>
+static inline __device__ uint4 multimem_ld_reduce(const T* addr);
+
+template <>
+inline __device__ uint4 multimem_ld_reduce(const uint32_t* addr)
+{
+    uint4 val;
+#ifdef ENABLE_MULTIMEM
+    asm volatile("multimem.ld_reduce.relaxed.sys.global.add.v4.f32 {%0, %1, %2, %3}, [%4];"
+                 : "=r"(val.x), "=r"(val.y), "=r"(val.z), "=r"(val.w)
+                 : "l"(addr)
+                 : "memory");
+#else
+    __trap();
+#endif
+    return val;
+}
+
+template <>
+inline __device__ uint4 multimem_ld_reduce(const uint16_t* addr)
+{
+    uint4 val;
+#ifdef ENABLE_MULTIMEM
+    asm volatile("multimem.ld_reduce.relaxed.sys.global.add.acc::f32.v4.f16x2 {%0, %1, %2, %3}, [%4];"
+                 : "=r"(val.x), "=r"(val.y), "=r"(val.z), "=r"(val.w)
+                 : "l"(addr)
+                 : "memory");
+#else
+    __trap();
+#endif
+    return val;
+}
+
+#ifdef ENABLE_BF16
+template <>
+inline __device__ uint4 multimem_ld_reduce(const __nv_bfloat16* addr)
+{
+    uint4 val;
+#ifdef ENABLE_MULTIMEM
+    asm volatile("multimem.ld_reduce.relaxed.sys.global.add.acc::f32.v4.bf16x2 {%0, %1, %2, %3}, [%4];"
+                 : "=r"(val.x), "=r"(val.y), "=r"(val.z), "=r"(val.w)
+                 : "l"(addr)
+                 : "memory");
+#else
+    __trap();
+#endif
+    return val;
+}
+#endif
+
+// Stores the 16 bytes to addr in the buffers of all the ranks bound to the multicast object.
+static inline __device__ void multimem_st(void* addr, const uint4& val)
+{
+#ifdef ENABLE_MULTIMEM
+    asm volatile("multimem.st.relaxed.sys.global.v4.f32 [%0], {%1, %2, %3, %4};" ::"l"(addr), "r"(val.x),
+                 "r"(val.y), "r"(val.z), "r"(val.w)
+                 : "memory");
+#else
+    __trap();
+#endif
+}
+
+// Same slices and barriers as the two shot all-reduce. Each rank reduces its slice through the multicast address and
+// the stores broadcast the sums to the buffers of all the ranks, each rank then only reads its own buffer.
+template <typename T, int RANKS_PER_NODE>
+static __global__ void nvlsAllReduceKernel(AllReduceParams params)
+{
+    const int bidx = blockIdx.x;
+    const int tidx = threadIdx.x;
+
+    // The number of elements packed into 16 bytes
+    static constexpr int NUM_ELTS = 16 / sizeof(T);
+
+    multi_gpu_barrier(params.peer_barrier_ptrs_in, params.barrier_flag, params.local_rank, RANKS_PER_NODE, tidx, bidx);
+
+    T* mc_ptr = reinterpret_cast<T*>(params.nvls_multicast_ptr);
+    const size_t block_start = params.rank_offset + bidx * params.elts_per_block;
+    const size_t max_offset = min(block_start + params.elts_per_block, params.rank_offset + params.elts_per_rank);
+    for (size_t offset = block_start + tidx * NUM_ELTS; offset < max_offset; offset += blockDim.x * NUM_ELTS)
+    {
+        multimem_st(&mc_ptr[offset], multimem_ld_reduce(&mc_ptr[offset]));
+    }
+
+    // The stores through the multicast address must reach the peers before the flags of the barrier.
+    __threadfence_system();
+    twoShotBlockBarrier<RANKS_PER_NODE>(params, bidx, tidx);
+#ifdef ENABLE_MULTIMEM
+    // The unicast address of the buffer aliases the multicast one.
+    asm volatile("fence.proxy.alias;" ::: "memory");
+#endif
+
+    const T* uc_ptr = reinterpret_cast<const T*>(params.nvls_unicast_ptr);
+    T* dst = reinterpret_cast<T*>(params.local_output_buffer_ptr);
+    const size_t block_offset = bidx * params.elts_per_block;
+    const size_t max_block_offset = min(block_offset + params.elts_per_block, params.elts_per_rank);
+    for (size_t local_offset = block_offset + tidx * NUM_ELTS; local_offset < max_block_offset;
+         local_offset += blockDim.x * NUM_ELTS)
+    {
+#pragma unroll
+        for (int ii = 0; ii < RANKS_PER_NODE; ++ii)
+        {
+            const size_t offset_rank = ii * params.elts_per_rank + local_offset;
+            if (offset_rank >= params.elts_total)
+            {
+                continue;
+            }
+            reinterpret_cast<uint4*>(&dst[offset_rank])[0] = reinterpret_cast<const uint4*>(&uc_ptr[offset_rank])[0];
+        }
+    }
+}
+
+// Number of 16 bytes lines of a source rank in one half of the receive buffer of LOWLATENCY
+static constexpr size_t LOW_LATENCY_LINES_PER_RANK = 2 * LOW_LATENCY_MAX_SIZE / sizeof(uint4);
+
+// Writes the 8 bytes of data interleaved with two copies of the flag, a reader seeing both copies sees the data.
+static inline __device__ void st_ll_line(uint4* addr, uint32_t data0, uint32_t data1, uint32_t flag)
+{
+    asm volatile("st.volatile.global.v4.u32 [%0], {%1, %2, %3, %4};" ::"l"(addr), "r"(data0), "r"(flag), "r"(data1),
+                 "r"(flag)
+                 : "memory");
+}
+
+// Waits until both copies of the flag of the line are set, returns the 8 bytes of data.
+static inline __device__ uint2 ld_ll_line(const uint4* addr, uint32_t flag)
+{
+    uint4 line;
+    do
+    {
+        asm volatile("ld.volatile.global.v4.u32 {%0, %1, %2, %3}, [%4];"
+                     : "=r"(line.x), "=r"(line.y), "=r"(line.z), "=r"(line.w)
+                     : "l"(addr)
+                     : "memory");
+    } while (line.y != flag || line.w != flag);
+    return make_uint2(line.x, line.z);
+}
+
+// Each thread pushes 16 bytes of the input to all the ranks as two lines tagged with the flag of the invocation, then
+// waits for the same 16 bytes of all the ranks in its own receive buffer and sums them. There is no barrier: a rank
+// starts an invocation only once it has received the previous one of all its peers, which they send after having read
+// the one before, so the two halves of the receive buffer used in turn cannot be overwritten while being read.
+template <typename T, int RANKS_PER_NODE>
+static __global__ void lowLatencyAllReduceKernel(AllReduceParams params, const T* input)
+{
+    // The number of elements packed into 16 bytes
+    static constexpr int NUM_ELTS = 16 / sizeof(T);
+
+    // Packed data type for comms
+    using PackedType = typename ARTypeConverter<T>::Type;
+
+    // All the blocks read the counter before the last one done updates it.
+    const uint32_t flag = params.ll_counters[0] + 1;
+    const size_t half_offset = (flag % 2) * MAX_RANKS_PER_NODE * LOW_LATENCY_LINES_PER_RANK;
+
+    const size_t num_vecs = params.elts_total / NUM_ELTS;
+    for (size_t vec = blockIdx.x * blockDim.x + threadIdx.x; vec < num_vecs; vec += gridDim.x * blockDim.x)
+    {
+        const uint4 val = reinterpret_cast<const uint4*>(input)[vec];
+        const size_t line = half_offset + params.local_rank * LOW_LATENCY_LINES_PER_RANK + 2 * vec;
+#pragma unroll
+        for (int ii = 0; ii < RANKS_PER_NODE; ++ii)
+        {
+            // Round-robin over the peers
+            const int rank = (params.local_rank + ii) % RANKS_PER_NODE;
+            uint4* dst = reinterpret_cast<uint4*>(params.ll_buffer_ptrs[rank]) + line;
+            st_ll_line(dst, val.x, val.y, flag);
+            st_ll_line(dst + 1, val.z, val.w, flag);
+        }
+
+        // Sum the ranks in the same order on every GPU so that all of them produce the same output.
+        const uint4* src = reinterpret_cast<const uint4*>(params.ll_buffer_ptrs[params.local_rank]) + half_offset;
+        PackedType sums = init_packed_type<PackedType>();
+#pragma unroll
+        for (int rank = 0; rank < RANKS_PER_NODE; ++rank)
+        {
+            const uint4* rank_lines = src + rank * LOW_LATENCY_LINES_PER_RANK + 2 * vec;
+            const uint2 lo = ld_ll_line(rank_lines, flag);
+            const uint2 hi = ld_ll_line(rank_lines + 1, flag);
+            uint4 vals = make_uint4(lo.x, lo.y, hi.x, hi.y);
+            sums = add128b<PackedType, T>(sums, reinterpret_cast<const PackedType&>(vals));
+        }
+        reinterpret_cast<PackedType*>(params.local_output_buffer_ptr)[vec] = sums;
+    }
+
+    // The last block done moves the counter to the flag of the invocation for the next one.
+    __syncthreads();
+    if (threadIdx.x == 0)
+    {
+        __threadfence();
+        if (atomicAdd(&params.ll_counters[1], 1u) == gridDim.x - 1)
+        {
+            params.ll_counters[1] = 0;
+            params.ll_counters[0] = flag;
+        }
+    }
+}
+
+// Sums the ranks (or reads the already reduced tensor if REDUCE is false), adds the residual, writes the updated
+// residual and its RMSNorm. One block handles one row at a time so the sum of squares is a block reduction.
+// The ranks are summed in the same order on every GPU so that all of them produce the same outputs.
+template <typename T, int RANKS_PER_NODE, bool REDUCE>
+static __global__ void allReduceResidualRmsNormKernel(AllReduceParams params, const T* reduced)
+{
+    const int bidx = blockIdx.x;
+    const int tidx = threadIdx.x;
+
+    // The number of elements packed into one 128 bits load
+    static constexpr int NUM_ELTS = 16 / sizeof(T);
+
+    const AllReduceFusionParams& fusion = params.fusion_params;
+
+    const T* src_d[RANKS_PER_NODE];
+    if constexpr (REDUCE)
+    {
+        multi_gpu_barrier(
+            params.peer_barrier_ptrs_in, params.barrier_flag, params.local_rank, RANKS_PER_NODE, tidx, bidx);
+#pragma unroll
+        for (int ii = 0; ii < RANKS_PER_NODE; ++ii)
+        {
+            src_d[ii] = reinterpret_cast<const T*>(params.peer_comm_buffer_ptrs[ii]);
+        }
+    }
+    else
+    {
+        src_d[0] = reduced;
+    }
+
+    const T* residual = reinterpret_cast<const T*>(fusion.residual_buffer);
+    const T* gamma = reinterpret_cast<const T*>(fusion.weight_buffer);
+    T* residual_out = reinterpret_cast<T*>(fusion.residual_out_buffer);
+    T* normed_out = reinterpret_cast<T*>(params.local_output_buffer_ptr);
+    const bool quantize = fusion.quant_scale != nullptr;
+    const float quant_scale = quantize ? *fusion.quant_scale : 0.f;
+
+    const size_t hidden_size = fusion.hidden_size;
+    const size_t tokens = params.elts_total / hidden_size;
+
+    __shared__ float s_inv_rms;
+
+    for (size_t row = bidx; row < tokens; row += gridDim.x)
+    {
+        const size_t row_offset = row * hidden_size;
+
+        // Reduce and add the residual. Each thread later reads back the elements it wrote itself.
+        float local_sq_sum = 0.f;
+        for (size_t col = tidx * NUM_ELTS; col < hidden_size; col += blockDim.x * NUM_ELTS)
+        {
+            const size_t offset = row_offset + col;
+
+            float acc[NUM_ELTS];
+#pragma unroll
+            for (int jj = 0; jj < NUM_ELTS; ++jj)
+            {
+                acc[jj] = 0.f;
+            }
+#pragma unroll
+            for (int ii = 0; ii < RANKS_PER_NODE; ++ii)
+            {
+                alignas(16) T val[NUM_ELTS];
+                reinterpret_cast<uint4*>(val)[0] = reinterpret_cast<const uint4*>(&src_d[ii][offset])[0];
+#pragma unroll
+                for (int jj = 0; jj < NUM_ELTS; ++jj)
+                {
+                    acc[jj] += cuda_cast<float>(val[jj]);
+                }
+            }
+
+            alignas(16) T res[NUM_ELTS];
+            reinterpret_cast<uint4*>(res)[0] = reinterpret_cast<const uint4*>(&residual[offset])[0];
+
+            alignas(16) T out[NUM_ELTS];
+#pragma unroll
+            for (int jj = 0; jj < NUM_ELTS; ++jj)
+            {
+                const float val = acc[jj] + cuda_cast<float>(res[jj]);
+                // Normalize the rounded value, as the unfused residual add followed by the RMSNorm does.
+                out[jj] = cuda_cast<T>(val);
+                const float rounded = cuda_cast<float>(out[jj]);
+                local_sq_sum += rounded * rounded;
+            }
+            reinterpret_cast<uint4*>(&residual_out[offset])[0] = reinterpret_cast<const uint4*>(out)[0];
+        }
+
+        local_sq_sum = blockReduceSum<float>(local_sq_sum);
+        if (tidx == 0)
+        {
+            s_inv_rms = rsqrtf(local_sq_sum / hidden_size + fusion.eps);
+        }
+        __syncthreads();
+        const float inv_rms = s_inv_rms;
+
+        for (size_t col = tidx * NUM_ELTS; col < hidden_size; col += blockDim.x * NUM_ELTS)
+        {
+            const size_t offset = row_offset + col;
+
+            alignas(16) T val[NUM_ELTS];
+            reinterpret_cast<uint4*>(val)[0] = reinterpret_cast<const uint4*>(&residual_out[offset])[0];
+            alignas(16) T weight[NUM_ELTS];
+            reinterpret_cast<uint4*>(weight)[0] = reinterpret_cast<const uint4*>(&gamma[col])[0];
+
+            alignas(16) T out[NUM_ELTS];
+#pragma unroll
+            for (int jj = 0; jj < NUM_ELTS; ++jj)
+            {
+                const float normed = cuda_cast<float>(val[jj]) * inv_rms;
+                out[jj] = cuda_cast<T>(normed * cuda_cast<float>(weight[jj]));
+            }
+
+            if (quantize)
+            {
+#pragma unroll
+                for (int jj = 0; jj < NUM_ELTS; ++jj)
+                {
+                    fusion.quant_out_buffer[offset + jj]
+                        = cuda_cast<int8_t>(cuda_cast<float>(out[jj]) * quant_scale);
+                }
+            }
+            else
+            {
+                reinterpret_cast<uint4*>(&normed_out[offset])[0] = reinterpret_cast<const uint4*>(out)[0];
+            }
+        }
+
+        // s_inv_rms and the shared memory of blockReduceSum are reused by the next row.
+        __syncthreads();
+    }
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 std::tuple<int, int> kernelLaunchConfig(AllReduceStrategyType algo, AllReduceParams& param, size_t elts_per_thread)
@@ -425,42 +805,180 @@ void invokeOneOrTwoShotAllReduceKernel(AllReduceParams& param, AllReduceStrategy
     sync_check_cuda_error();
 }
 
+template <typename T, int RANKS_PER_NODE, bool REDUCE_SCATTER>
+void dispatchTwoShotStageKernel(AllReduceParams& param, int blocks_per_grid, int threads_per_block, cudaStream_t stream)
+{
+    if constexpr (REDUCE_SCATTER)
+    {
+        reduceScatterKernel<T, RANKS_PER_NODE><<<blocks_per_grid, threads_per_block, 0, stream>>>(param);
+    }
+    else
+    {
+        allGatherKernel<T, RANKS_PER_NODE><<<blocks_per_grid, threads_per_block, 0, stream>>>(param);
+    }
+}
+
+template <typename T, bool REDUCE_SCATTER>
+void invokeTwoShotStageKernel(AllReduceParams& param, cudaStream_t stream)
+{
+    sync_check_cuda_error();
+
+    // Both stages must split the tensor in the same slices.
+    size_t elts_per_thread = 16 / sizeof(T);
+    auto [blocks_per_grid, threads_per_block]
+        = kernelLaunchConfig(AllReduceStrategyType::TWOSHOT, param, elts_per_thread);
+    switch (param.ranks_per_node)
+    {
+    case 2: dispatchTwoShotStageKernel<T, 2, REDUCE_SCATTER>(param, blocks_per_grid, threads_per_block, stream); break;
+    case 4: dispatchTwoShotStageKernel<T, 4, REDUCE_SCATTER>(param, blocks_per_grid, threads_per_block, stream); break;
+    case 6: dispatchTwoShotStageKernel<T, 6, REDUCE_SCATTER>(param, blocks_per_grid, threads_per_block, stream); break;
+    case 8: dispatchTwoShotStageKernel<T, 8, REDUCE_SCATTER>(param, blocks_per_grid, threads_per_block, stream); break;
+    default: break;
+    }
+    sync_check_cuda_error();
+}
+
+template <typename T>
+void invokeNvlsAllReduceKernel(AllReduceParams& param, cudaStream_t stream)
+{
+    sync_check_cuda_error();
+
+    size_t elts_per_thread = 16 / sizeof(T);
+    auto [blocks_per_grid, threads_per_block]
+        = kernelLaunchConfig(AllReduceStrategyType::TWOSHOT, param, elts_per_thread);
+    switch (param.ranks_per_node)
+    {
+    case 2: nvlsAllReduceKernel<T, 2><<<blocks_per_grid, threads_per_block, 0, stream>>>(param); break;
+    case 4: nvlsAllReduceKernel<T, 4><<<blocks_per_grid, threads_per_block, 0, stream>>>(param); break;
+    case 6: nvlsAllReduceKernel<T, 6><<<blocks_per_grid, threads_per_block, 0, stream>>>(param); break;
+    case 8: nvlsAllReduceKernel<T, 8><<<blocks_per_grid, threads_per_block, 0, stream>>>(param); break;
+    default: break;
+    }
+    sync_check_cuda_error();
+}
+
+template <typename T>
+void invokeLowLatencyAllReduceKernel(AllReduceParams& param, const T* input, cudaStream_t stream)
+{
+    sync_check_cuda_error();
+
+    const size_t elts_per_thread = 16 / sizeof(T);
+    TLLM_CHECK(param.elts_total % elts_per_thread == 0);
+    TLLM_CHECK(param.elts_total * sizeof(T) <= LOW_LATENCY_MAX_SIZE);
+
+    // The blocks spin until the peers have pushed their data, keep them all resident.
+    const size_t num_vecs = param.elts_total / elts_per_thread;
+    const int threads_per_block = std::min(size_t{256}, WARP_SIZE * divUp(num_vecs, WARP_SIZE));
+    const int blocks_per_grid = std::min(MAX_ALL_REDUCE_BLOCKS, divUp(num_vecs, threads_per_block));
+    switch (param.ranks_per_node)
+    {
+    case 2: lowLatencyAllReduceKernel<T, 2><<<blocks_per_grid, threads_per_block, 0, stream>>>(param, input); break;
+    case 4: lowLatencyAllReduceKernel<T, 4><<<blocks_per_grid, threads_per_block, 0, stream>>>(param, input); break;
+    case 6: lowLatencyAllReduceKernel<T, 6><<<blocks_per_grid, threads_per_block, 0, stream>>>(param, input); break;
+    case 8: lowLatencyAllReduceKernel<T, 8><<<blocks_per_grid, threads_per_block, 0, stream>>>(param, input); break;
+    default: break;
+    }
+    sync_check_cuda_error();
+}
+
+template <typename T, int RANKS_PER_NODE, bool REDUCE>
+void dispatchResidualRmsNormKernel(AllReduceParams& param, const T* reduced, cudaStream_t stream)
+{
+    static constexpr size_t elts_per_thread = 16 / sizeof(T);
+    const size_t hidden_size = param.fusion_params.hidden_size;
+    TLLM_CHECK_WITH_INFO(hidden_size > 0 && hidden_size % elts_per_thread == 0 && param.elts_total % hidden_size == 0,
+        "The fused residual RMSNorm requires rows of a multiple of 16 bytes.");
+
+    const size_t tokens = param.elts_total / hidden_size;
+    const int threads_per_block
+        = std::min(DEFAULT_BLOCK_SIZE, WARP_SIZE * divUp(hidden_size / elts_per_thread, WARP_SIZE));
+    // The one shot kernel spins on the barrier, keep it within the number of blocks of the unfused kernel.
+    const int blocks_per_grid = REDUCE ? std::min(tokens, MAX_ALL_REDUCE_BLOCKS) : tokens;
+    allReduceResidualRmsNormKernel<T, RANKS_PER_NODE, REDUCE>
+        <<<blocks_per_grid, threads_per_block, 0, stream>>>(param, reduced);
+}
+
+template <typename T>
+void invokeOneShotAllReduceResidualRmsNormKernel(AllReduceParams& param, cudaStream_t stream)
+{
+    sync_check_cuda_error();
+    switch (param.ranks_per_node)
+    {
+    case 2: dispatchResidualRmsNormKernel<T, 2, true>(param, nullptr, stream); break;
+    case 4: dispatchResidualRmsNormKernel<T, 4, true>(param, nullptr, stream); break;
+    case 6: dispatchResidualRmsNormKernel<T, 6, true>(param, nullptr, stream); break;
+    case 8: dispatchResidualRmsNormKernel<T, 8, true>(param, nullptr, stream); break;
+    default: break;
+    }
+    sync_check_cuda_error();
+}
+
 void invokeMultiGpuBarrier(AllReduceParams& param, cudaStream_t stream)
 {
     multiGpuBarrierKernel<<<1, param.ranks_per_node, 0, stream>>>(param);
 }
 
-AllReduceParams AllReduceParams::deserialize(const int32_t* buffer, size_t tpSize, size_t tpRank, uint32_t flag_value)
+AllReduceParams AllReduceParams::deserialize(
+    const int32_t* buffer, size_t tpSize, size_t tpRank, uint32_t flag_value, size_t ranksPerNode)
 {
     void* const* buffer_ptrs = reinterpret_cast<void* const*>(buffer);
     AllReduceParams params;
 
-    for (int i = 0; i < tpSize; ++i)
+    ranksPerNode = ranksPerNode > 0 ? ranksPerNode : tpSize;
+    const size_t nodeOffset = tpRank / ranksPerNode * ranksPerNode;
+    for (int i = 0; i < ranksPerNode; ++i)
     {
-        params.peer_comm_buffer_ptrs[i] = buffer_ptrs[i];
+        params.peer_comm_buffer_ptrs[i] = buffer_ptrs[nodeOffset + i];
     }
-    for (int i = 0; i < tpSize; ++i)
+    for (int i = 0; i < ranksPerNode; ++i)
     {
-        params.peer_barrier_ptrs_in[i] = reinterpret_cast<uint32_t*>(buffer_ptrs[tpSize + i]);
+        params.peer_barrier_ptrs_in[i] = reinterpret_cast<uint32_t*>(buffer_ptrs[tpSize + nodeOffset + i]);
     }
-    for (int i = 0; i < tpSize; ++i)
+    for (int i = 0; i < ranksPerNode; ++i)
     {
-        params.peer_barrier_ptrs_out[i] = reinterpret_cast<uint32_t*>(buffer_ptrs[2 * tpSize + i]);
+        params.peer_barrier_ptrs_out[i] = reinterpret_cast<uint32_t*>(buffer_ptrs[2 * tpSize + nodeOffset + i]);
     }
     params.barrier_flag = flag_value;
-    params.ranks_per_node = tpSize;
-    params.rank = tpRank;
-    params.local_rank = tpRank;
+    params.ranks_per_node = ranksPerNode;
+    params.rank = tpRank - nodeOffset;
+    params.local_rank = tpRank - nodeOffset;
 
     return params;
 }
 
 void customAllReduce(kernels::AllReduceParams& params, void* data, size_t elts, size_t size_per_elem,
-    datatype_enum dataType, AllReduceStrategyType strat, cudaStream_t stream)
+    datatype_enum dataType, AllReduceStrategyType strat, cudaStream_t stream, AllReduceFusionOp fusionOp)
 {
     params.local_output_buffer_ptr = data;
     params.elts_total = elts;
 
+    if (fusionOp == AllReduceFusionOp::RESIDUAL_RMS_NORM && strat == AllReduceStrategyType::ONESHOT)
+    {
+        if (dataType == datatype_enum::TYPE_FP32)
+        {
+            kernels::invokeOneShotAllReduceResidualRmsNormKernel<float>(params, stream);
+        }
+        else if (dataType == datatype_enum::TYPE_FP16)
+        {
+            kernels::invokeOneShotAllReduceResidualRmsNormKernel<half>(params, stream);
+        }
+        else if (dataType == datatype_enum::TYPE_BF16)
+        {
+            kernels::invokeOneShotAllReduceResidualRmsNormKernel<__nv_bfloat16>(params, stream);
+        }
+        else
+        {
+            TLLM_THROW("Unsupported dataType for customAllReduce");
+        }
+        return;
+    }
+
+    if (fusionOp == AllReduceFusionOp::RESIDUAL_RMS_NORM)
+    {
+        // The reduced rows are split between the ranks, reduce into the residual output and normalize it afterwards.
+        params.local_output_buffer_ptr = params.fusion_params.residual_out_buffer;
+    }
+
     if (dataType == datatype_enum::TYPE_FP32)
     {
         using T = CustomARCommTypeConverter<float>::Type;
@@ -480,6 +998,145 @@ void customAllReduce(kernels::AllReduceParams& params, void* data, size_t elts,
     {
         TLLM_THROW("Unsupported dataType for customAllReduce");
     }
+
+    if (fusionOp == AllReduceFusionOp::RESIDUAL_RMS_NORM)
+    {
+        params.local_output_buffer_ptr = data;
+        residualRmsNorm(params, params.fusion_params.residual_out_buffer, elts, dataType, stream);
+    }
+}
+
+void nvlsAllReduce(kernels::AllReduceParams& params, void* data, size_t elts, datatype_enum dataType,
+    cudaStream_t stream, AllReduceFusionOp fusionOp)
+{
+    // Reduce into the residual output and normalize it afterwards, like TWOSHOT.
+    params.local_output_buffer_ptr
+        = fusionOp == AllReduceFusionOp::RESIDUAL_RMS_NORM ? params.fusion_params.residual_out_buffer : data;
+    params.elts_total = elts;
+
+    if (dataType == datatype_enum::TYPE_FP32)
+    {
+        using T = CustomARCommTypeConverter<float>::Type;
+        invokeNvlsAllReduceKernel<T>(params, stream);
+    }
+    else if (dataType == datatype_enum::TYPE_FP16)
+    {
+        using T = CustomARCommTypeConverter<half>::Type;
+        invokeNvlsAllReduceKernel<T>(params, stream);
+    }
+    else if (dataType == datatype_enum::TYPE_BF16)
+    {
+        using T = CustomARCommTypeConverter<__nv_bfloat16>::Type;
+        invokeNvlsAllReduceKernel<T>(params, stream);
+    }
+    else
+    {
+        TLLM_THROW("Unsupported dataType for nvlsAllReduce");
+    }
+
+    if (fusionOp == AllReduceFusionOp::RESIDUAL_RMS_NORM)
+    {
+        params.local_output_buffer_ptr = data;
+        residualRmsNorm(params, params.fusion_params.residual_out_buffer, elts, dataType, stream);
+    }
+}
+
+void lowLatencyAllReduce(kernels::AllReduceParams& params, const void* input, void* data, size_t elts,
+    datatype_enum dataType, cudaStream_t stream, AllReduceFusionOp fusionOp)
+{
+    // Reduce into the residual output and normalize it afterwards, like TWOSHOT.
+    params.local_output_buffer_ptr
+        = fusionOp == AllReduceFusionOp::RESIDUAL_RMS_NORM ? params.fusion_params.residual_out_buffer : data;
+    params.elts_total = elts;
+
+    if (dataType == datatype_enum::TYPE_FP32)
+    {
+        using T = CustomARCommTypeConverter<float>::Type;
+        invokeLowLatencyAllReduceKernel<T>(params, reinterpret_cast<const T*>(input), stream);
+    }
+    else if (dataType == datatype_enum::TYPE_FP16)
+    {
+        using T = CustomARCommTypeConverter<half>::Type;
+        invokeLowLatencyAllReduceKernel<T>(params, reinterpret_cast<const T*>(input), stream);
+    }
+    else if (dataType == datatype_enum::TYPE_BF16)
+    {
+        using T = CustomARCommTypeConverter<__nv_bfloat16>::Type;
+        invokeLowLatencyAllReduceKernel<T>(params, reinterpret_cast<const T*>(input), stream);
+    }
+    else
+    {
+        TLLM_THROW("Unsupported dataType for lowLatencyAllReduce");
+    }
+
+    if (fusionOp == AllReduceFusionOp::RESIDUAL_RMS_NORM)
+    {
+        params.local_output_buffer_ptr = data;
+        residualRmsNorm(params, params.fusion_params.residual_out_buffer, elts, dataType, stream);
+    }
+}
+
+template <bool REDUCE_SCATTER>
+void invokeTwoShotStage(AllReduceParams& params, datatype_enum dataType, cudaStream_t stream)
+{
+    if (dataType == datatype_enum::TYPE_FP32)
+    {
+        using T = CustomARCommTypeConverter<float>::Type;
+        invokeTwoShotStageKernel<T, REDUCE_SCATTER>(params, stream);
+    }
+    else if (dataType == datatype_enum::TYPE_FP16)
+    {
+        using T = CustomARCommTypeConverter<half>::Type;
+        invokeTwoShotStageKernel<T, REDUCE_SCATTER>(params, stream);
+    }
+    else if (dataType == datatype_enum::TYPE_BF16)
+    {
+        using T = CustomARCommTypeConverter<__nv_bfloat16>::Type;
+        invokeTwoShotStageKernel<T, REDUCE_SCATTER>(params, stream);
+    }
+    else
+    {
+        TLLM_THROW("Unsupported dataType for customAllReduce");
+    }
+}
+
+void customReduceScatter(kernels::AllReduceParams& params, size_t elts, datatype_enum dataType, cudaStream_t stream)
+{
+    params.elts_total = elts;
+    invokeTwoShotStage<true>(params, dataType, stream);
+}
+
+void customAllGather(
+    kernels::AllReduceParams& params, void* data, size_t elts, datatype_enum dataType, cudaStream_t stream)
+{
+    params.local_output_buffer_ptr = data;
+    params.elts_total = elts;
+    invokeTwoShotStage<false>(params, dataType, stream);
+}
+
+void residualRmsNorm(
+    kernels::AllReduceParams& params, const void* reduced, size_t elts, datatype_enum dataType, cudaStream_t stream)
+{
+    params.elts_total = elts;
+
+    if (dataType == datatype_enum::TYPE_FP32)
+    {
+        dispatchResidualRmsNormKernel<float, 1, false>(params, reinterpret_cast<const float*>(reduced), stream);
+    }
+    else if (dataType == datatype_enum::TYPE_FP16)
+    {
+        dispatchResidualRmsNormKernel<half, 1, false>(params, reinterpret_cast<const half*>(reduced), stream);
+    }
+    else if (dataType == datatype_enum::TYPE_BF16)
+    {
+        dispatchResidualRmsNormKernel<__nv_bfloat16, 1, false>(
+            params, reinterpret_cast<const __nv_bfloat16*>(reduced), stream);
+    }
+    else
+    {
+        TLLM_THROW("Unsupported dataType for residualRmsNorm");
+    }
+    sync_check_cuda_error();
 }
 
 } // namespace tensorrt_llm::kernels
@@ -34,6 +34,11 @@ constexpr size_t CUSTOM_AR_SIZE_THRESHOLD = 50331648;
 constexpr size_t MAX_ALL_REDUCE_BLOCKS = 24;
 constexpr size_t MAX_RANKS_PER_NODE = 8;
 constexpr size_t DEFAULT_BLOCK_SIZE = 1024;
+// Largest message of the LOWLATENCY strategy, in bytes
+constexpr size_t LOW_LATENCY_MAX_SIZE = 64 * 1024;
+// Receive buffer of the LOWLATENCY strategy per rank: lines of 8 bytes of data and two copies of the flag for each
+// source rank, in two halves used by the invocations in turn.
+constexpr size_t LOW_LATENCY_BUFFER_SIZE = 2 * MAX_RANKS_PER_NODE * 2 * LOW_LATENCY_MAX_SIZE;
 
 // Warning: python definition is in tensorrt_llm/functional.py
 // they must be kept in sync
@@ -43,6 +48,25 @@ enum class AllReduceStrategyType : int8_t
     ONESHOT = 1,
     TWOSHOT = 2,
     AUTO = 3,
+    // For TP groups spanning several nodes: intra-node reduce-scatter over IPC, NCCL all-reduce of each slice between
+    // the ranks with the same local rank on the other nodes, then intra-node all-gather over IPC.
+    HIERARCHICAL = 4,
+    // Two shot all-reduce through the multicast object of the NVSwitch (NVLink SHARP, Hopper): the switch sums the
+    // slice of each rank over the GPUs and broadcasts the sum, the GPUs do not read the buffers of their peers.
+    NVLS = 5,
+    // For the small messages of the generation phase: each rank pushes its input with the flag of the invocation
+    // interleaved in the data to the receive buffers of its peers and sums what it receives, in a single kernel without
+    // barrier (NCCL's LL protocol).
+    LOWLATENCY = 6,
+};
+
+// Warning: python definition is in tensorrt_llm/functional.py
+// they must be kept in sync
+enum class AllReduceFusionOp : int8_t
+{
+    NONE = 0,
+    // out = rmsnorm(allreduce(in) + residual) * gamma, residual_out = allreduce(in) + residual
+    RESIDUAL_RMS_NORM = 1,
 };
 
 #ifdef ENABLE_BF16
@@ -55,6 +79,24 @@ typedef struct bf168
 } bf168;
 #endif
 
+//! \brief Inputs and outputs of the operation fused after the all-reduce. The reduced tensor is [elts_total /
+//! hidden_size, hidden_size] and all the buffers are in the data type of the all-reduce except the quantized output.
+struct AllReduceFusionParams
+{
+    // [tokens, hidden_size]
+    const void* residual_buffer = nullptr;
+    // [hidden_size], gamma of the RMSNorm.
+    const void* weight_buffer = nullptr;
+    // [tokens, hidden_size], the reduced tensor plus the residual, residual input of the next layer.
+    void* residual_out_buffer = nullptr;
+    size_t hidden_size = 0;
+    float eps = 1e-6f;
+    // SmoothQuant per-tensor scale. If set, the normalized output is multiplied by *quant_scale and written as int8 to
+    // quant_out_buffer instead of local_output_buffer_ptr.
+    const float* quant_scale = nullptr;
+    int8_t* quant_out_buffer = nullptr;
+};
+
 struct AllReduceParams
 {
     size_t elts_total;
@@ -67,8 +109,19 @@ struct AllReduceParams
     uint32_t* peer_barrier_ptrs_out[MAX_RANKS_PER_NODE];
     void* peer_comm_buffer_ptrs[MAX_RANKS_PER_NODE];
     void* local_output_buffer_ptr;
-
-    static AllReduceParams deserialize(const int32_t* buffer, size_t tpSize, size_t tpRank, uint32_t flag_value);
+    AllReduceFusionParams fusion_params;
+    // NVLS: the local buffer bound to the multicast object and the multicast address of the buffers of all the ranks.
+    void* nvls_unicast_ptr = nullptr;
+    void* nvls_multicast_ptr = nullptr;
+    // LOWLATENCY: the receive buffers of the ranks, LOW_LATENCY_BUFFER_SIZE bytes each, and the local counters of the
+    // invocations and of the blocks done with the current one.
+    void* ll_buffer_ptrs[MAX_RANKS_PER_NODE] = {};
+    uint32_t* ll_counters = nullptr;
+
+    // buffer holds the buffer, barriers in and barriers out pointers of the tpSize ranks. When the group spans several
+    // nodes, ranksPerNode of them per node, only the pointers of the ranks of the node of tpRank are read.
+    static AllReduceParams deserialize(
+        const int32_t* buffer, size_t tpSize, size_t tpRank, uint32_t flag_value, size_t ranksPerNode = 0);
 };
 
 template <typename T>
@@ -96,7 +149,42 @@ struct CustomARCommTypeConverter<__nv_bfloat16>
 };
 #endif
 
+//! \brief All-reduce of the tensor copied to the local peer comm buffer, written to data. With
+//! AllReduceFusionOp::RESIDUAL_RMS_NORM, the residual add and the RMSNorm described by params.fusion_params are
+//! applied in the final reduce stage of ONESHOT, so data receives the normalized output without extra passes over the
+//! activations. TWOSHOT reduces into the residual output first and runs residualRmsNorm on it.
 void customAllReduce(kernels::AllReduceParams& params, void* data, size_t elts, size_t size_per_elem,
-    common::datatype_enum dataType, AllReduceStrategyType strat, cudaStream_t stream);
+    common::datatype_enum dataType, AllReduceStrategyType strat, cudaStream_t stream,
+    AllReduceFusionOp fusionOp = AllReduceFusionOp::NONE);
+
+//! \brief Intra-node reduce-scatter, the first stage of TWOSHOT. Leaves the sum of the node's ranks for the slice
+//! [params.rank_offset, params.rank_offset + params.elts_per_rank) in the local peer comm buffer, where it can be
+//! reduced further, e.g. between nodes, before customAllGather.
+void customReduceScatter(
+    kernels::AllReduceParams& params, size_t elts, common::datatype_enum dataType, cudaStream_t stream);
+
+//! \brief Intra-node all-gather of the slices left by customReduceScatter in the peer comm buffers, written to data.
+//! Waits for the peers to reach the same point first.
+void customAllGather(
+    kernels::AllReduceParams& params, void* data, size_t elts, common::datatype_enum dataType, cudaStream_t stream);
+
+//! \brief All-reduce of the tensor copied to params.nvls_unicast_ptr, written to data. The ranks reduce their slice
+//! with multimem loads from params.nvls_multicast_ptr and broadcast it with multimem stores, like the two stages of
+//! TWOSHOT. Requires SM 90 and elts to be a multiple of ranks_per_node 16 bytes vectors. With
+//! AllReduceFusionOp::RESIDUAL_RMS_NORM, reduces into the residual output and runs residualRmsNorm on it.
+void nvlsAllReduce(kernels::AllReduceParams& params, void* data, size_t elts, common::datatype_enum dataType,
+    cudaStream_t stream, AllReduceFusionOp fusionOp = AllReduceFusionOp::NONE);
+
+//! \brief All-reduce of input, written to data, with the LOWLATENCY strategy. elts must be a multiple of 16 bytes and
+//! at most LOW_LATENCY_MAX_SIZE bytes. With AllReduceFusionOp::RESIDUAL_RMS_NORM, reduces into the residual output and
+//! runs residualRmsNorm on it.
+void lowLatencyAllReduce(kernels::AllReduceParams& params, const void* input, void* data, size_t elts,
+    common::datatype_enum dataType, cudaStream_t stream, AllReduceFusionOp fusionOp = AllReduceFusionOp::NONE);
+
+//! \brief Applies the residual add and the RMSNorm of params.fusion_params to the already reduced tensor, writing
+//! params.local_output_buffer_ptr. reduced may alias the residual output. Used after the NCCL all-reduce and after
+//! TWOSHOT, where the reduced rows are split between the ranks.
+void residualRmsNorm(kernels::AllReduceParams& params, const void* reduced, size_t elts,
+    common::datatype_enum dataType, cudaStream_t stream);
 
 } // namespace tensorrt_llm::kernels
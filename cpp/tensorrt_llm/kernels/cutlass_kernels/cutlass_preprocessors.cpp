@@ -21,6 +21,10 @@
 
 #include "cutlass_extensions/gemm/kernel/mixed_gemm_B_layout.h"
 
+#include <algorithm>
+#include <future>
+#include <thread>
+
 using namespace tensorrt_llm::common;
 
 namespace tensorrt_llm
@@ -30,6 +34,45 @@ namespace kernels
 namespace cutlass_kernels
 {
 
+namespace
+{
+
+// Calls func(item) for every item in [0, num_items), split into contiguous ranges over the cores. Each step of the
+// preprocessing writes every output element once, so the items (experts, row tiles, columns...) are independent. On a
+// single core, the preprocessing of the INT4 weights of a 70B model takes tens of minutes. Exceptions thrown by func
+// are rethrown to the caller.
+template <typename Func>
+void parallel_for(const size_t num_items, Func&& func)
+{
+    const size_t num_threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), num_items);
+    const auto run_range = [&](size_t thread_idx)
+    {
+        const size_t begin = num_items * thread_idx / num_threads;
+        const size_t end = num_items * (thread_idx + 1) / num_threads;
+        for (size_t item = begin; item < end; ++item)
+        {
+            func(item);
+        }
+    };
+
+    std::vector<std::future<void>> futures;
+    futures.reserve(num_threads);
+    for (size_t thread_idx = 1; thread_idx < num_threads; ++thread_idx)
+    {
+        futures.push_back(std::async(std::launch::async, run_range, thread_idx));
+    }
+    if (num_threads > 0)
+    {
+        run_range(0);
+    }
+    for (auto& future : futures)
+    {
+        future.get();
+    }
+}
+
+} // namespace
+
 int get_bits_in_quant_type(QuantType quant_type)
 {
     switch (quant_type)
@@ -192,11 +235,13 @@ void permute_B_rows_for_mixed_gemm(int8_t* permuted_quantized_tensor, const int8
             MMA_SHAPE_N));
 
     // The code is written as below so it works for both int8 and packed int4.
-    for (int expert = 0; expert < num_experts; ++expert)
-    {
-        const int64_t matrix_offset = expert * int64_t(num_rows) * int64_t(num_vec_cols);
-        for (int base_row = 0; base_row < num_rows; base_row += B_ROWS_PER_MMA)
+    const size_t num_row_tiles = num_rows / B_ROWS_PER_MMA;
+    parallel_for(num_experts * num_row_tiles,
+        [&](size_t tile)
         {
+            const int64_t expert = tile / num_row_tiles;
+            const int base_row = (tile % num_row_tiles) * B_ROWS_PER_MMA;
+            const int64_t matrix_offset = expert * int64_t(num_rows) * int64_t(num_vec_cols);
             for (int tile_row = 0; tile_row < B_ROWS_PER_MMA; ++tile_row)
             {
 
@@ -214,8 +259,7 @@ void permute_B_rows_for_mixed_gemm(int8_t* permuted_quantized_tensor, const int8
                     output_byte_ptr[write_offset] = input_byte_ptr[read_offset];
                 }
             }
-        }
-    }
+        });
 }
 
 // We need to use this transpose to correctly handle packed int4 and int8 data
@@ -245,7 +289,6 @@ void subbyte_transpose_impl(
 
     static constexpr int M_TILE_L1 = 64;
     static constexpr int N_TILE_L1 = M_TILE_L1 / ELTS_PER_BYTE;
-    uint8_t cache_buf[M_TILE_L1][N_TILE_L1];
 
     static constexpr int VECTOR_WIDTH = std::min(32, N_TILE_L1);
 
@@ -260,11 +303,14 @@ void subbyte_transpose_impl(
     const int num_m_tiles = (num_rows + M_TILE_L1 - 1) / M_TILE_L1;
     const int num_n_tiles = (col_bytes + N_TILE_L1 - 1) / N_TILE_L1;
 
-    for (size_t expert = 0; expert < num_experts; ++expert)
-    {
-        const size_t matrix_offset = expert * num_rows * col_bytes;
-        for (size_t row_tile_start = 0; row_tile_start < num_rows; row_tile_start += M_TILE_L1)
+    parallel_for(num_experts * num_m_tiles,
+        [&](size_t tile)
         {
+            const size_t expert = tile / num_m_tiles;
+            const size_t row_tile_start = (tile % num_m_tiles) * M_TILE_L1;
+            const size_t matrix_offset = expert * num_rows * col_bytes;
+            uint8_t cache_buf[M_TILE_L1][N_TILE_L1];
+
             for (size_t col_tile_start_byte = 0; col_tile_start_byte < col_bytes; col_tile_start_byte += N_TILE_L1)
             {
 
@@ -357,8 +403,7 @@ void subbyte_transpose_impl(
                     }
                 }
             }
-        }
-    }
+        });
 }
 
 void subbyte_transpose(int8_t* transposed_quantized_tensor, const int8_t* quantized_tensor,
@@ -380,83 +425,98 @@ void subbyte_transpose(int8_t* transposed_quantized_tensor, const int8_t* quanti
     }
 }
 
+// Both steps below transform each 32-bit register on its own, so the tensor is split in blocks of registers which are
+// transformed in parallel.
+constexpr size_t INTERLEAVE_BLOCK_BYTES = 1 << 20;
+
 void add_bias_and_interleave_int8s_inplace(int8_t* int8_tensor, const size_t num_elts)
 {
-    for (int ii = 0; ii < num_elts; ++ii)
-    {
-        int8_tensor[ii] = int8_t(int(int8_tensor[ii]) + 128);
-    }
+    TLLM_CHECK_WITH_INFO(num_elts % 4 == 0, "Dimensions of int8 tensor must be a multiple of 4 for register relayout");
 
-    // Step 2 will transform the layout of a 32-bit register in CUDA in order to match the int4 layout. This has no
-    // performance benefit and is purely so that int4 and int8 have the same layout.
-    // Pictorially, this does the following:
-    // bit 32                                                      0
-    //      [elt_3  elt_2  elt_1  elt_0] (each elt occupies 8 bits)
-    //
-    // And it will rearrange the output 32 bit register to be the following:
-    // bit 32                                                      0
-    //      [elt_3  elt_1  elt_2  elt_0] (each elt occupies 8 bits)
+    parallel_for((num_elts + INTERLEAVE_BLOCK_BYTES - 1) / INTERLEAVE_BLOCK_BYTES,
+        [&](size_t block)
+        {
+            const size_t block_begin = block * INTERLEAVE_BLOCK_BYTES;
+            const size_t block_end = std::min(block_begin + INTERLEAVE_BLOCK_BYTES, num_elts);
+            for (size_t ii = block_begin; ii < block_end; ++ii)
+            {
+                int8_tensor[ii] = int8_t(int(int8_tensor[ii]) + 128);
+            }
 
-    TLLM_CHECK_WITH_INFO(num_elts % 4 == 0, "Dimensions of int8 tensor must be a multiple of 4 for register relayout");
-    for (size_t base = 0; base < num_elts; base += 4)
-    {
-        std::swap(int8_tensor[base + 1], int8_tensor[base + 2]);
-    }
+            // Step 2 will transform the layout of a 32-bit register in CUDA in order to match the int4 layout. This
+            // has no performance benefit and is purely so that int4 and int8 have the same layout.
+            // Pictorially, this does the following:
+            // bit 32                                                      0
+            //      [elt_3  elt_2  elt_1  elt_0] (each elt occupies 8 bits)
+            //
+            // And it will rearrange the output 32 bit register to be the following:
+            // bit 32                                                      0
+            //      [elt_3  elt_1  elt_2  elt_0] (each elt occupies 8 bits)
+            for (size_t base = block_begin; base < block_end; base += 4)
+            {
+                std::swap(int8_tensor[base + 1], int8_tensor[base + 2]);
+            }
+        });
 }
 
 void add_bias_and_interleave_int4s_inplace(int8_t* packed_int4_tensor, const size_t num_elts)
 {
-    const int num_bytes = num_elts / 2;
+    const size_t num_bytes = num_elts / 2;
 
-    // Step 1 will be to transform all the int4s to unsigned in order to make the dequantize take as little
-    // instructions as possible in the CUDA code.
-    for (size_t ii = 0; ii < num_bytes; ++ii)
-    {
-        int8_t transformed_packed_int4s = 0;
-        int8_t transformed_first_elt
-            = (int8_t(packed_int4_tensor[ii] << 4) >> 4) + 8; // The double shift here is to ensure sign extension
-        int8_t transformed_second_elt = (packed_int4_tensor[ii] >> 4) + 8;
-
-        TLLM_CHECK_WITH_INFO(
-            transformed_first_elt >= 0 && transformed_first_elt <= 15, "Illegal result for int4 transform (first elt)");
-        TLLM_CHECK_WITH_INFO(transformed_second_elt >= 0 && transformed_second_elt <= 15,
-            "Illegal result for int4 transform (second elt)");
-
-        // We don't need to mask in these ops since everything should be in the range 0-15
-        transformed_packed_int4s |= transformed_first_elt;
-        transformed_packed_int4s |= (transformed_second_elt << 4);
-        packed_int4_tensor[ii] = transformed_packed_int4s;
-    }
+    TLLM_CHECK_WITH_INFO(num_bytes % 4 == 0, "Dimensions of int4 tensor must be a multiple of 8 for register relayout");
 
-    // Step 2 will transform the layout of a 32-bit register in CUDA in order to minimize the number of shift & logical
-    // instructions That are needed to extract the int4s in the GEMM main loop. Pictorially, the loop below will do the
-    // following: Take as input a 32 bit register with layout: bit 32 0
-    //      [elt_7  elt_6  elt_5  elt_4  elt_3  elt_2  elt_1  elt_0] (each elt occupies 4 bits)
-    //
-    // And it will rearrange the output 32 bit register to be the following:
-    // bit 32                                                      0
-    //      [elt_7  elt_5  elt_3  elt_1  elt_6  elt_4  elt_2  elt_0] (each elt occupies 4 bits)
+    parallel_for((num_bytes + INTERLEAVE_BLOCK_BYTES - 1) / INTERLEAVE_BLOCK_BYTES,
+        [&](size_t block)
+        {
+            const size_t block_begin = block * INTERLEAVE_BLOCK_BYTES;
+            const size_t block_end = std::min(block_begin + INTERLEAVE_BLOCK_BYTES, num_bytes);
 
-    TLLM_CHECK_WITH_INFO(num_bytes % 4 == 0, "Dimensions of int4 tensor must be a multiple of 8 for register relayout");
-    const size_t num_registers = num_bytes / 4;
+            // Step 1 will be to transform all the int4s to unsigned in order to make the dequantize take as little
+            // instructions as possible in the CUDA code.
+            for (size_t ii = block_begin; ii < block_end; ++ii)
+            {
+                int8_t transformed_packed_int4s = 0;
+                // The double shift here is to ensure sign extension
+                int8_t transformed_first_elt = (int8_t(packed_int4_tensor[ii] << 4) >> 4) + 8;
+                int8_t transformed_second_elt = (packed_int4_tensor[ii] >> 4) + 8;
+
+                TLLM_CHECK_WITH_INFO(transformed_first_elt >= 0 && transformed_first_elt <= 15,
+                    "Illegal result for int4 transform (first elt)");
+                TLLM_CHECK_WITH_INFO(transformed_second_elt >= 0 && transformed_second_elt <= 15,
+                    "Illegal result for int4 transform (second elt)");
+
+                // We don't need to mask in these ops since everything should be in the range 0-15
+                transformed_packed_int4s |= transformed_first_elt;
+                transformed_packed_int4s |= (transformed_second_elt << 4);
+                packed_int4_tensor[ii] = transformed_packed_int4s;
+            }
 
-    uint32_t* register_ptr = reinterpret_cast<uint32_t*>(packed_int4_tensor);
-    for (size_t ii = 0; ii < num_registers; ++ii)
-    {
-        const uint32_t current_register = register_ptr[ii];
-        uint32_t transformed_register = 0;
+            // Step 2 will transform the layout of a 32-bit register in CUDA in order to minimize the number of shift &
+            // logical instructions That are needed to extract the int4s in the GEMM main loop. Pictorially, the loop
+            // below will do the following: Take as input a 32 bit register with layout: bit 32 0
+            //      [elt_7  elt_6  elt_5  elt_4  elt_3  elt_2  elt_1  elt_0] (each elt occupies 4 bits)
+            //
+            // And it will rearrange the output 32 bit register to be the following:
+            // bit 32                                                      0
+            //      [elt_7  elt_5  elt_3  elt_1  elt_6  elt_4  elt_2  elt_0] (each elt occupies 4 bits)
+            uint32_t* register_ptr = reinterpret_cast<uint32_t*>(packed_int4_tensor);
+            for (size_t ii = block_begin / 4; ii < block_end / 4; ++ii)
+            {
+                const uint32_t current_register = register_ptr[ii];
+                uint32_t transformed_register = 0;
 
-        for (int dest_idx = 0; dest_idx < 8; ++dest_idx)
-        {
-            const int src_idx = dest_idx < 4 ? 2 * dest_idx : 2 * (dest_idx - 4) + 1;
-            const int src_shift = 4 * src_idx;
-            const int dest_shift = 4 * dest_idx;
+                for (int dest_idx = 0; dest_idx < 8; ++dest_idx)
+                {
+                    const int src_idx = dest_idx < 4 ? 2 * dest_idx : 2 * (dest_idx - 4) + 1;
+                    const int src_shift = 4 * src_idx;
+                    const int dest_shift = 4 * dest_idx;
 
-            const uint32_t src_bits = (current_register >> src_shift) & 0xF;
-            transformed_register |= (src_bits << dest_shift);
-        }
-        register_ptr[ii] = transformed_register;
-    }
+                    const uint32_t src_bits = (current_register >> src_shift) & 0xF;
+                    transformed_register |= (src_bits << dest_shift);
+                }
+                register_ptr[ii] = transformed_register;
+            }
+        });
 }
 
 void add_bias_and_interleave_quantized_tensor_inplace(int8_t* tensor, const size_t num_elts, QuantType quant_type)
@@ -505,11 +565,12 @@ void interleave_column_major_tensor(int8_t* interleaved_quantized_tensor, const
     const int vec_rows_per_tile = rows_per_tile / elts_in_int32;
     const int interleave = details.columns_interleaved;
 
-    for (int expert = 0; expert < num_experts; ++expert)
-    {
-        const int64_t matrix_offset = expert * int64_t(num_vec_rows) * int64_t(num_cols);
-        for (int read_col = 0; read_col < num_cols; ++read_col)
+    parallel_for(num_experts * num_cols,
+        [&](size_t col)
         {
+            const int64_t expert = col / num_cols;
+            const int read_col = col % num_cols;
+            const int64_t matrix_offset = expert * int64_t(num_vec_rows) * int64_t(num_cols);
             const int64_t write_col = read_col / interleave;
             for (int base_vec_row = 0; base_vec_row < num_vec_rows; base_vec_row += vec_rows_per_tile)
             {
@@ -525,8 +586,7 @@ void interleave_column_major_tensor(int8_t* interleaved_quantized_tensor, const
                     output_byte_ptr[write_offset] = input_byte_ptr[read_offset];
                 }
             }
-        }
-    }
+        });
 }
 
 void preprocess_weights_for_mixed_gemm(int8_t* preprocessed_quantized_weight, const int8_t* row_major_quantized_weight,
@@ -607,6 +667,9 @@ Outputs
       must have a dimension of 1, which breaks the semantics we need for batched weights.
   */
 
+// The number of columns of which a thread finds the max, wide enough to read whole cache lines of each row.
+constexpr size_t QUANTIZE_BLOCK_COLS = 256;
+
 template <typename ComputeType, typename WeightType>
 void symmetric_quantize(int8_t* processed_quantized_weight, int8_t* unprocessed_quantized_weight,
     ComputeType* scale_ptr, const WeightType* input_weight_ptr, const std::vector<size_t>& shape, QuantType quant_type)
@@ -642,20 +705,26 @@ void symmetric_quantize(int8_t* processed_quantized_weight, int8_t* unprocessed_
         const WeightType* current_weight = input_weight_ptr + expert * input_mat_size;
         int8_t* current_quantized_weight = unprocessed_quantized_weight + expert * quantized_mat_size;
 
-        // First we find the per column max for this expert weight.
-        for (int jj = 0; jj < num_cols; ++jj)
-        {
-            per_col_max[jj] = 0.f;
-        }
-
-        for (int ii = 0; ii < num_rows; ++ii)
-        {
-            const WeightType* current_weight_row = current_weight + ii * num_cols;
-            for (int jj = 0; jj < num_cols; ++jj)
+        // First we find the per column max for this expert weight. Each block of columns reads all the rows.
+        parallel_for((num_cols + QUANTIZE_BLOCK_COLS - 1) / QUANTIZE_BLOCK_COLS,
+            [&](size_t block)
             {
-                per_col_max[jj] = std::max(per_col_max[jj], std::abs(float(current_weight_row[jj])));
-            }
-        }
+                const size_t col_begin = block * QUANTIZE_BLOCK_COLS;
+                const size_t col_end = std::min(col_begin + QUANTIZE_BLOCK_COLS, num_cols);
+                for (size_t jj = col_begin; jj < col_end; ++jj)
+                {
+                    per_col_max[jj] = 0.f;
+                }
+
+                for (size_t ii = 0; ii < num_rows; ++ii)
+                {
+                    const WeightType* current_weight_row = current_weight + ii * num_cols;
+                    for (size_t jj = col_begin; jj < col_end; ++jj)
+                    {
+                        per_col_max[jj] = std::max(per_col_max[jj], std::abs(float(current_weight_row[jj])));
+                    }
+                }
+            });
 
         // Then, we construct the scales
         ComputeType* current_scales = scale_ptr + expert * num_cols;
@@ -666,50 +735,51 @@ void symmetric_quantize(int8_t* processed_quantized_weight, int8_t* unprocessed_
         }
 
         // Finally, construct the weights.
-        for (int ii = 0; ii < num_rows; ++ii)
-        {
-            int8_t* current_quantized_weight_row = current_quantized_weight + ii * bytes_per_out_col;
-            const WeightType* current_weight_row = current_weight + ii * num_cols;
-            for (int jj = 0; jj < bytes_per_out_col; ++jj)
+        parallel_for(num_rows,
+            [&](size_t ii)
             {
-
-                if (quant_type == QuantType::INT8_WEIGHT_ONLY)
-                {
-                    const float col_scale = per_col_max[jj];
-                    const float weight_elt = float(current_weight_row[jj]);
-                    const float scaled_weight = round(weight_elt / col_scale);
-                    const int8_t clipped_weight = int8_t(std::max(-128.f, std::min(127.f, scaled_weight)));
-                    current_quantized_weight_row[jj] = clipped_weight;
-                }
-                else if (quant_type == QuantType::PACKED_INT4_WEIGHT_ONLY)
+                int8_t* current_quantized_weight_row = current_quantized_weight + ii * bytes_per_out_col;
+                const WeightType* current_weight_row = current_weight + ii * num_cols;
+                for (int jj = 0; jj < bytes_per_out_col; ++jj)
                 {
 
-                    // We will pack two int4 elements per iteration of the inner loop.
-                    int8_t packed_int4s = 0;
-                    for (int packed_idx = 0; packed_idx < 2; ++packed_idx)
+                    if (quant_type == QuantType::INT8_WEIGHT_ONLY)
+                    {
+                        const float col_scale = per_col_max[jj];
+                        const float weight_elt = float(current_weight_row[jj]);
+                        const float scaled_weight = round(weight_elt / col_scale);
+                        const int8_t clipped_weight = int8_t(std::max(-128.f, std::min(127.f, scaled_weight)));
+                        current_quantized_weight_row[jj] = clipped_weight;
+                    }
+                    else if (quant_type == QuantType::PACKED_INT4_WEIGHT_ONLY)
                     {
-                        const int input_idx = 2 * jj + packed_idx;
-                        if (input_idx < num_cols)
+
+                        // We will pack two int4 elements per iteration of the inner loop.
+                        int8_t packed_int4s = 0;
+                        for (int packed_idx = 0; packed_idx < 2; ++packed_idx)
                         {
-                            const float col_scale = per_col_max[input_idx];
-                            const float weight_elt = float(current_weight_row[input_idx]);
-                            const float scaled_weight = round(weight_elt / col_scale);
-                            int int_weight = int(scaled_weight);
-                            const int8_t clipped_weight = std::max(-8, std::min(7, int_weight));
-
-                            // Kill the sign extension bits (hence 0x0F mask) then shift to upper bits
-                            // if packing the second int4 and or the bits into the final result.
-                            packed_int4s |= ((clipped_weight & 0x0F) << (4 * packed_idx));
+                            const int input_idx = 2 * jj + packed_idx;
+                            if (input_idx < num_cols)
+                            {
+                                const float col_scale = per_col_max[input_idx];
+                                const float weight_elt = float(current_weight_row[input_idx]);
+                                const float scaled_weight = round(weight_elt / col_scale);
+                                int int_weight = int(scaled_weight);
+                                const int8_t clipped_weight = std::max(-8, std::min(7, int_weight));
+
+                                // Kill the sign extension bits (hence 0x0F mask) then shift to upper bits
+                                // if packing the second int4 and or the bits into the final result.
+                                packed_int4s |= ((clipped_weight & 0x0F) << (4 * packed_idx));
+                            }
                         }
+                        current_quantized_weight_row[jj] = packed_int4s;
+                    }
+                    else
+                    {
+                        TLLM_CHECK_WITH_INFO(false, "Unsupported quantization type");
                     }
-                    current_quantized_weight_row[jj] = packed_int4s;
-                }
-                else
-                {
-                    TLLM_CHECK_WITH_INFO(false, "Unsupported quantization type");
                 }
-            }
-        }
+            });
     }
 
     preprocess_weights_for_mixed_gemm(processed_quantized_weight, unprocessed_quantized_weight, shape, quant_type);
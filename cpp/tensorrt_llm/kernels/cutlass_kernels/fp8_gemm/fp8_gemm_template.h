@@ -0,0 +1,356 @@
+/*
+ * Copyright (c) 2020-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _WIN32
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wstrict-aliasing"
+#endif // #ifndef _WIN32
+
+// clang-format off
+#include <cutlass/gemm/device/gemm.h>
+#include <cutlass_extensions/gemm/device/gemm_universal_base_compat.h>
+#include <cutlass/gemm/kernel/default_gemm.h>
+#include <cutlass/epilogue/thread/linear_combination.h>
+#include <cutlass/epilogue/threadblock/epilogue_with_visitor.h>
+// clang-format on
+
+#include "cutlass_extensions/compute_occupancy.h"
+#include "cutlass_extensions/epilogue/threadblock/epilogue_per_row_per_col_scale.h"
+#include "cutlass_extensions/epilogue_helpers.h"
+#include "cutlass_extensions/gemm_configs.h"
+
+#include "cutlass_extensions/gemm/kernel/default_fp8_traits.h"
+#include "cutlass_extensions/gemm/kernel/gemm_with_epilogue_visitor.h"
+
+#ifndef _WIN32
+#pragma GCC diagnostic pop
+#endif // #ifndef _WIN32
+
+#include "tensorrt_llm/common/allocator.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/cutlass_kernels/cutlass_heuristic.h"
+#include "tensorrt_llm/kernels/cutlass_kernels/fp8_gemm/fp8_gemm.h"
+
+#include <sstream>
+
+namespace tk = tensorrt_llm::common;
+namespace tkc = tensorrt_llm::cutlass_extensions;
+
+#ifdef ENABLE_FP8
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+namespace cutlass_kernels
+{
+
+template <typename T, typename arch, typename ThreadblockShape, typename WarpShape, int Stages>
+void genericFp8GemmKernelLauncher(const __nv_fp8_e4m3* A, const __nv_fp8_e4m3* B, tk::QuantMode quantOption,
+    const float* alphaCol, const float* alphaRow, T* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig,
+    char* workspace, size_t workspaceBytes, cudaStream_t stream, int* occupancy = nullptr)
+{
+    TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+
+    using ElementInput = cutlass::float_e4m3_t;
+
+    using ElementOutput_ =
+        typename cutlass::platform::conditional<cutlass::platform::is_same<T, half>::value, cutlass::half_t, T>::type;
+#ifdef ENABLE_BF16
+    using ElementOutput =
+        typename cutlass::platform::conditional<cutlass::platform::is_same<ElementOutput_, __nv_bfloat16>::value,
+            cutlass::bfloat16_t, ElementOutput_>::type;
+#else
+    using ElementOutput = ElementOutput_;
+#endif
+
+    using ElementAccumulator = float;
+    using ElementCompute = float;
+
+    using ThreadblockSwizzle = cutlass::gemm::threadblock::GemmIdentityThreadblockSwizzle<>;
+
+    using ArchTraits = cutlass::gemm::kernel::Fp8GemmArchTraits<arch>;
+    using OperatorClass = typename ArchTraits::OperatorClass;
+    using InstructionShape = typename ArchTraits::InstructionShape;
+    using GemmOp = typename ArchTraits::Operator;
+
+    // The scales are applied by the epilogue visitor below, the linear combination only converts the output
+    using EpilogueOp = cutlass::epilogue::thread::LinearCombination<ElementOutput,
+        128 / cutlass::sizeof_bits<ElementOutput>::value, ElementAccumulator, ElementCompute>;
+
+    // only TN is supported (e4m3 * e4m3 + f32)
+    using GemmKernel_ = typename cutlass::gemm::kernel::DefaultGemm<ElementInput, cutlass::layout::RowMajor,
+        ArchTraits::kAlignment, ElementInput, cutlass::layout::ColumnMajor, ArchTraits::kAlignment, ElementOutput,
+        cutlass::layout::RowMajor, ElementAccumulator, OperatorClass, arch, ThreadblockShape, WarpShape,
+        InstructionShape, EpilogueOp, ThreadblockSwizzle, Stages, true, GemmOp>::GemmKernel;
+
+    using AlphaColTileIterator = cutlass::epilogue::threadblock::PredicatedTileIterator<
+        cutlass::epilogue::threadblock::OutputTileOptimalThreadMap<
+            typename GemmKernel_::Epilogue::OutputTileIterator::ThreadMap::Shape,
+            typename GemmKernel_::Epilogue::OutputTileIterator::ThreadMap::Count,
+            GemmKernel_::Epilogue::OutputTileIterator::ThreadMap::kThreads,
+            GemmKernel_::Epilogue::OutputTileIterator::kElementsPerAccess, cutlass::sizeof_bits<ElementOutput>::value>,
+        ElementCompute>;
+
+    // Epilogue visitor
+    using EpilogueVisitor = typename cutlass::epilogue::threadblock::EpilogueVisitorPerRowPerCol<ThreadblockShape,
+        GemmKernel_::kThreadCount, AlphaColTileIterator, typename GemmKernel_::Epilogue::OutputTileIterator,
+        ElementAccumulator, ElementCompute, EpilogueOp>;
+
+    /// Epilogue
+    using Epilogue = typename cutlass::epilogue::threadblock::EpilogueWithVisitorFromExistingEpilogue<EpilogueVisitor,
+        typename GemmKernel_::Epilogue>::Epilogue;
+
+    // GEMM
+    using GemmKernel
+        = cutlass::gemm::kernel::GemmWithEpilogueVisitor<typename GemmKernel_::Mma, Epilogue, ThreadblockSwizzle>;
+
+    if (occupancy != nullptr)
+    {
+        *occupancy = tensorrt_llm::cutlass_extensions::compute_occupancy_for_kernel<GemmKernel>();
+        return;
+    }
+
+    using Gemm = cutlass::gemm::device::GemmUniversalBaseCompat<GemmKernel>;
+
+    typename EpilogueOp::Params linearScalingParams;
+    typename Gemm::Arguments args{cutlass::gemm::GemmUniversalMode::kBatched, {m, n, k}, 1,
+        {reinterpret_cast<ElementInput*>(const_cast<__nv_fp8_e4m3*>(A)), k},
+        {reinterpret_cast<ElementInput*>(const_cast<__nv_fp8_e4m3*>(B)), k}, quantOption,
+        {reinterpret_cast<ElementCompute*>(const_cast<float*>(alphaCol)), 0},
+        {reinterpret_cast<ElementCompute*>(const_cast<float*>(alphaRow)), 0}, {nullptr, 0},
+        {reinterpret_cast<ElementOutput*>(C), n}, 0, 0,
+        typename EpilogueVisitor::Arguments(linearScalingParams, 0, 0, 0)};
+
+    Gemm gemm;
+    if (gemm.get_workspace_size(args) > workspaceBytes)
+    {
+        TLLM_LOG_WARNING(
+            "Requested split-k but workspace size insufficient. Falling back to non-split-k implementation.");
+        // If requested split-k factor will require more workspace bytes, revert to standard gemm.
+        args.batch_count = 1;
+    }
+
+    auto can_implement = gemm.can_implement(args);
+    if (can_implement != cutlass::Status::kSuccess)
+    {
+        std::string errMsg = "fp8gemm cutlass kernel will fail for params. Error: "
+            + std::string(cutlassGetStatusString(can_implement));
+        throw std::runtime_error("[TensorRT-LLM Error][fp8gemm Runner] " + errMsg);
+    }
+
+    auto initStatus = gemm.initialize(args, workspace, stream);
+    if (initStatus != cutlass::Status::kSuccess)
+    {
+        std::string errMsg
+            = "Failed to initialize cutlass fp8 gemm. Error: " + std::string(cutlassGetStatusString(initStatus));
+        throw std::runtime_error("[TensorRT-LLM Error][fp8gemm Runner] " + errMsg);
+    }
+
+    auto runStatus = gemm.run(stream);
+    if (runStatus != cutlass::Status::kSuccess)
+    {
+        std::string errMsg
+            = "Failed to run cutlass fp8 gemm. Error: " + std::string(cutlassGetStatusString(runStatus));
+        throw std::runtime_error("[TensorRT-LLM Error][fp8gemm Runner] " + errMsg);
+    }
+}
+
+template <typename T, typename arch, typename ThreadblockShape, typename WarpShape, int Stages, typename Enable = void>
+struct dispatchFp8Stages
+{
+    static void dispatch(const __nv_fp8_e4m3* A, const __nv_fp8_e4m3* B, tk::QuantMode quantOption,
+        const float* alphaCol, const float* alphaRow, T* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig,
+        char* workspace, size_t workspaceBytes, cudaStream_t stream, int* occupancy = nullptr)
+    {
+        TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+        std::string errMsg = "Cutlass fp8 gemm. Not instantiates for arch "
+            + std::to_string(arch::kMinComputeCapability) + " with stages set to " + std::to_string(Stages);
+        throw std::runtime_error("[TensorRT-LLM Error][dispatchFp8Stages::dispatch] " + errMsg);
+    }
+};
+
+template <typename T, typename ThreadblockShape, typename WarpShape, int Stages>
+struct dispatchFp8Stages<T, cutlass::arch::Sm89, ThreadblockShape, WarpShape, Stages,
+    typename std::enable_if<(Stages > 2)>::type>
+{
+    static void dispatch(const __nv_fp8_e4m3* A, const __nv_fp8_e4m3* B, tk::QuantMode quantOption,
+        const float* alphaCol, const float* alphaRow, T* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig,
+        char* workspace, size_t workspaceBytes, cudaStream_t stream, int* occupancy = nullptr)
+    {
+        TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+        genericFp8GemmKernelLauncher<T, cutlass::arch::Sm89, ThreadblockShape, WarpShape, Stages>(A, B, quantOption,
+            alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream, occupancy);
+    }
+};
+
+template <typename T, typename arch, typename ThreadblockShape, typename WarpShape>
+void dispatchFp8GemmConfig(const __nv_fp8_e4m3* A, const __nv_fp8_e4m3* B, tk::QuantMode quantOption,
+    const float* alphaCol, const float* alphaRow, T* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig,
+    char* workspace, size_t workspaceBytes, cudaStream_t stream, int* occupancy = nullptr)
+{
+    TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+    switch (gemmConfig.stages)
+    {
+    case 3:
+        using DispatcherStages3 = dispatchFp8Stages<T, arch, ThreadblockShape, WarpShape, 3>;
+        DispatcherStages3::dispatch(A, B, quantOption, alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace,
+            workspaceBytes, stream, occupancy);
+        break;
+    case 4:
+        using DispatcherStages4 = dispatchFp8Stages<T, arch, ThreadblockShape, WarpShape, 4>;
+        DispatcherStages4::dispatch(A, B, quantOption, alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace,
+            workspaceBytes, stream, occupancy);
+        break;
+    case 5:
+        using DispatcherStages5 = dispatchFp8Stages<T, arch, ThreadblockShape, WarpShape, 5>;
+        DispatcherStages5::dispatch(A, B, quantOption, alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace,
+            workspaceBytes, stream, occupancy);
+        break;
+    case 6:
+        using DispatcherStages6 = dispatchFp8Stages<T, arch, ThreadblockShape, WarpShape, 6>;
+        DispatcherStages6::dispatch(A, B, quantOption, alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace,
+            workspaceBytes, stream, occupancy);
+        break;
+    default:
+        std::string errMsg = "dispatchFp8GemmConfig does not support stages " + std::to_string(gemmConfig.stages);
+        throw std::runtime_error("[TensorRT-LLM Error][dispatch_gemm_config] " + errMsg);
+        break;
+    }
+}
+
+template <typename T, typename arch>
+void dispatchFp8GemmToCutlass(const __nv_fp8_e4m3* A, const __nv_fp8_e4m3* B, tk::QuantMode quantOption,
+    const float* alphaCol, const float* alphaRow, T* C, int m, int n, int k, char* workspace, size_t workspaceBytes,
+    tkc::CutlassGemmConfig gemmConfig, cudaStream_t stream, int* occupancy = nullptr)
+{
+    TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+
+    // Same tiles as the int8 GEMM, both inputs are 8-bit
+    switch (gemmConfig.tile_config)
+    {
+    case tkc::CutlassTileConfig::CtaShape128x64x64_WarpShape64x32x64:
+        dispatchFp8GemmConfig<T, arch, cutlass::gemm::GemmShape<128, 64, 64>, cutlass::gemm::GemmShape<64, 32, 64>>(A,
+            B, quantOption, alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream, occupancy);
+        break;
+    case tkc::CutlassTileConfig::CtaShape256x128x64_WarpShape64x64x64:
+        dispatchFp8GemmConfig<T, arch, cutlass::gemm::GemmShape<256, 128, 64>, cutlass::gemm::GemmShape<64, 64, 64>>(
+            A, B, quantOption, alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream,
+            occupancy);
+        break;
+    case tkc::CutlassTileConfig::CtaShape32x128x64_WarpShape32x32x64:
+        dispatchFp8GemmConfig<T, arch, cutlass::gemm::GemmShape<32, 128, 64>, cutlass::gemm::GemmShape<32, 32, 64>>(A,
+            B, quantOption, alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream, occupancy);
+        break;
+    case tkc::CutlassTileConfig::CtaShape64x128x64_WarpShape64x32x64:
+        dispatchFp8GemmConfig<T, arch, cutlass::gemm::GemmShape<64, 128, 64>, cutlass::gemm::GemmShape<64, 32, 64>>(A,
+            B, quantOption, alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream, occupancy);
+        break;
+    case tkc::CutlassTileConfig::CtaShape64x64x128_WarpShape32x64x64:
+        dispatchFp8GemmConfig<T, arch, cutlass::gemm::GemmShape<64, 64, 128>, cutlass::gemm::GemmShape<32, 64, 64>>(A,
+            B, quantOption, alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream, occupancy);
+        break;
+    case tkc::CutlassTileConfig::CtaShape128x256x64_WarpShape64x64x64:
+        dispatchFp8GemmConfig<T, arch, cutlass::gemm::GemmShape<128, 256, 64>, cutlass::gemm::GemmShape<64, 64, 64>>(
+            A, B, quantOption, alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream,
+            occupancy);
+        break;
+    case tkc::CutlassTileConfig::Undefined:
+        throw std::runtime_error("[TensorRT-LLM Error][fp8][dispatch_gemm_to_cutlass] gemm config undefined.");
+        break;
+    case tkc::CutlassTileConfig::ChooseWithHeuristic:
+        throw std::runtime_error(
+            "[TensorRT-LLM Error][fp8][dispatch_gemm_to_cutlass] gemm config should have already been set by "
+            "heuristic.");
+        break;
+    default:
+        throw std::runtime_error(
+            "[TensorRT-LLM Error][fp8][dispatch_gemm_to_cutlass] Config is invalid for fp8 GEMM.");
+        break;
+    }
+}
+
+template <typename T>
+CutlassFp8GemmRunner<T>::CutlassFp8GemmRunner()
+{
+    TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+    int device{-1};
+    tk::check_cuda_error(cudaGetDevice(&device));
+    mSm = tk::getSMVersion();
+    tk::check_cuda_error(cudaDeviceGetAttribute(&mMultiProcessorCount, cudaDevAttrMultiProcessorCount, device));
+}
+
+template <typename T>
+CutlassFp8GemmRunner<T>::~CutlassFp8GemmRunner()
+{
+    TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+}
+
+template <typename T>
+void CutlassFp8GemmRunner<T>::dispatchToArch(const __nv_fp8_e4m3* A, const __nv_fp8_e4m3* B,
+    tk::QuantMode quantOption, const float* alphaCol, const float* alphaRow, T* C, int m, int n, int k,
+    tkc::CutlassGemmConfig gemmConfig, char* workspacePtr, const size_t workspaceBytes, cudaStream_t stream,
+    int* occupancy)
+{
+    TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+    if (mSm >= 89 && mSm <= 90)
+    {
+        dispatchFp8GemmToCutlass<T, cutlass::arch::Sm89>(A, B, quantOption, alphaCol, alphaRow, C, m, n, k,
+            workspacePtr, workspaceBytes, gemmConfig, stream, occupancy);
+    }
+    else
+    {
+        throw std::runtime_error(
+            "[TensorRT-LLM Error][CutlassFp8GemmRunner][GEMM Dispatch] Arch unsupported for CUTLASS fp8 GEMM");
+    }
+}
+
+template <typename T>
+void CutlassFp8GemmRunner<T>::gemm(const __nv_fp8_e4m3* A, const __nv_fp8_e4m3* B, tk::QuantMode quantOption,
+    const float* alphaCol, const float* alphaRow, void* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig,
+    char* workspacePtr, const size_t workspaceBytes, cudaStream_t stream)
+{
+    TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+    dispatchToArch(A, B, quantOption, alphaCol, alphaRow, reinterpret_cast<T*>(C), m, n, k, gemmConfig, workspacePtr,
+        workspaceBytes, stream);
+}
+
+template <typename T>
+std::vector<tkc::CutlassGemmConfig> CutlassFp8GemmRunner<T>::getConfigs() const
+{
+    static constexpr bool isWeightOnly = false;
+    std::vector<tkc::CutlassGemmConfig> candidateConfigs
+        = get_candidate_configs(mSm, isWeightOnly, false, /* SIMT configs */
+            true, SPLIT_K_LIMIT);                         /* 8-bit configs */
+    return candidateConfigs;
+}
+
+template <typename T>
+size_t CutlassFp8GemmRunner<T>::getWorkspaceSize(const int m, const int n, const int k)
+{
+    TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
+    // These are the min tile sizes for each config, which would launch the maximum number of blocks
+    const int maxGridM = cutlass::ceil_div(m, MIN_M_TILE);
+    const int maxGridN = cutlass::ceil_div(n, MIN_N_TILE);
+    // We need 4 bytes per block in the worst case. We launch SPLIT_K_LIMIT in z dim.
+    return static_cast<size_t>(maxGridM * maxGridN * SPLIT_K_LIMIT * 4);
+}
+
+} // namespace cutlass_kernels
+} // namespace kernels
+} // namespace tensorrt_llm
+
+#endif // ENABLE_FP8
@@ -76,6 +76,9 @@ protected:
     static constexpr int SPLIT_K_LIMIT = 7;
     static constexpr int MIN_M_TILE = 32;
     static constexpr int MIN_N_TILE = 64;
+    // Deepest pipelines of the candidate configs on Ampere and Hopper
+    static constexpr int MAX_STAGES_SM80 = 4;
+    static constexpr int MAX_STAGES_SM90 = 5;
 };
 
 template <typename T, typename WeightType, cutlass::WeightOnlyQuantOp QuantOp>
@@ -282,6 +282,11 @@ void dispatch_gemm_config(const T* A, const WeightType* B, const T* weight_scale
             weight_scales, weight_zero_points, biases, C, m, n, k, group_size, gemm_config, workspace, workspace_bytes,
             stream, occupancy);
         break;
+    case 5:
+        filter_and_run_mixed_gemm<T, WeightType, arch, QuantOp, EpilogueTag, ThreadblockShape, WarpShape, 5>(A, B,
+            weight_scales, weight_zero_points, biases, C, m, n, k, group_size, gemm_config, workspace, workspace_bytes,
+            stream, occupancy);
+        break;
     default:
         std::string err_msg = "dispatch_gemm_config does not support stages " + std::to_string(gemm_config.stages);
         throw std::runtime_error("[TensorRT-LLm Error][dispatch_gemm_config] " + err_msg);
@@ -377,6 +382,7 @@ void CutlassFpAIntBGemmRunner<T, WeightType, QuantOp>::dispatch_to_arch<Epilogue
     }
     else if (sm_ >= 80 && sm_ <= 90)
     {
+        // Hopper runs the Ampere multistage mainloop, with deeper pipelines to use its larger shared memory
         dispatch_gemm_to_cutlass<T, WeightType, cutlass::arch::Sm80, QuantOp, EpilogueTag>(A, B, weight_scales,
             weight_zero_points, biases, C, m, n, k, group_size, workspace_ptr, workspace_bytes, gemm_config, stream,
             occupancy);
@@ -468,6 +474,21 @@ std::vector<tkc::CutlassGemmConfig> CutlassFpAIntBGemmRunner<T, WeightType, Quan
     static constexpr bool is_weight_only = !std::is_same<T, WeightType>::value;
     std::vector<tkc::CutlassGemmConfig> candidateConfigs
         = get_candidate_configs(sm_, is_weight_only, false, false, SPLIT_K_LIMIT);
+    if (sm_ >= 90)
+    {
+        // The 228KB of shared memory per SM of Hopper fit one more stage of the largest tiles, which hides more of the
+        // global memory latency of the weights. Configs that do not fit are skipped by the profiler.
+        const size_t numConfigs = candidateConfigs.size();
+        for (size_t i = 0; i < numConfigs; ++i)
+        {
+            if (candidateConfigs[i].stages == MAX_STAGES_SM80)
+            {
+                auto config = candidateConfigs[i];
+                config.stages = MAX_STAGES_SM90;
+                candidateConfigs.push_back(config);
+            }
+        }
+    }
     return candidateConfigs;
 }
 
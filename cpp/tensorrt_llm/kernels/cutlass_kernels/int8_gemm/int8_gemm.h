@@ -48,8 +48,8 @@ public:
     virtual ~CutlassInt8GemmRunnerInterface() {}
 
     virtual void gemm(const int8_t* A, const int8_t* B, tk::QuantMode quantOption, const float* alphaCol,
-        const float* alphaRow, void* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig, char* workspacePtr,
-        const size_t workspaceBytes, cudaStream_t stream)
+        const float* alphaRow, const void* residual, void* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig,
+        char* workspacePtr, const size_t workspaceBytes, cudaStream_t stream)
         = 0;
 
     // Returns desired workspace size in bytes.
@@ -71,7 +71,7 @@ public:
     ~CutlassInt8GemmRunner();
 
     void gemm(const int8_t* A, const int8_t* B, tk::QuantMode quantOption, const float* alphaCol, const float* alphaRow,
-        void* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig, char* workspacePtr,
+        const void* residual, void* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig, char* workspacePtr,
         const size_t workspaceBytes, cudaStream_t stream) override;
 
     // Returns desired workspace size in bytes.
@@ -81,8 +81,8 @@ public:
 
 private:
     void dispatchToArch(const int8_t* A, const int8_t* B, tk::QuantMode quantOption, const float* alphaCol,
-        const float* alphaRow, T* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig, char* workspacePtr,
-        const size_t workspaceBytes, cudaStream_t stream, int* occupancy = nullptr);
+        const float* alphaRow, const T* residual, T* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig,
+        char* workspacePtr, const size_t workspaceBytes, cudaStream_t stream, int* occupancy = nullptr);
 
     int mSm;
     int mMultiProcessorCount;
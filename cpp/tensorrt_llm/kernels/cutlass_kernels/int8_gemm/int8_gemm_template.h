@@ -61,8 +61,8 @@ namespace cutlass_kernels
 
 template <typename T, typename arch, typename ThreadblockShape, typename WarpShape, int Stages>
 void genericInt8GemmKernelLauncher(const int8_t* A, const int8_t* B, tk::QuantMode quantOption, const float* alphaCol,
-    const float* alphaRow, T* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig, char* workspace,
-    size_t workspaceBytes, cudaStream_t stream, int* occupancy = nullptr)
+    const float* alphaRow, const T* residual, T* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig,
+    char* workspace, size_t workspaceBytes, cudaStream_t stream, int* occupancy = nullptr)
 {
     TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
 
@@ -128,16 +128,23 @@ void genericInt8GemmKernelLauncher(const int8_t* A, const int8_t* B, tk::QuantMo
 
     typename EpilogueOp::Params linearScalingParams; // TODO: right now it's unused (scaling is done in
                                                      // visitor, no activation needed)
-    typename Gemm::Arguments args{cutlass::gemm::GemmUniversalMode::kBatched, {m, n, k}, 1,
+    // The visitor adds beta * C to the scaled accumulators, C is loaded only if beta is not zero
+    if (residual != nullptr)
+    {
+        linearScalingParams.beta = ElementCompute(1);
+    }
+    // Serial split-K partitions the K dimension over gridDim.z, the partitions of a tile are reduced in the epilogue
+    const int splitK = gemmConfig.split_k_style == tkc::SplitKStyle::SPLIT_K_SERIAL ? gemmConfig.split_k_factor : 1;
+    typename Gemm::Arguments args{cutlass::gemm::GemmUniversalMode::kGemm, {m, n, k}, splitK,
         {reinterpret_cast<ElementInput*>(const_cast<ElementInput*>(A)), k},
         {reinterpret_cast<ElementInput*>(const_cast<ElementInput*>(B)), k}, quantOption,
         {reinterpret_cast<ElementCompute*>(const_cast<float*>(alphaCol)), 0},
-        {reinterpret_cast<ElementCompute*>(const_cast<float*>(alphaRow)), 0}, {nullptr, 0},
+        {reinterpret_cast<ElementCompute*>(const_cast<float*>(alphaRow)), 0},
+        {reinterpret_cast<ElementOutput*>(const_cast<T*>(residual)), residual != nullptr ? n : 0},
         {reinterpret_cast<ElementOutput*>(C), n}, 0, 0,
         typename EpilogueVisitor::Arguments(linearScalingParams, 0, 0, 0)};
 
     Gemm gemm;
-    // TODO: handle that
     if (gemm.get_workspace_size(args) > workspaceBytes)
     {
         TLLM_LOG_WARNING(
@@ -175,8 +182,8 @@ template <typename T, typename arch, typename ThreadblockShape, typename WarpSha
 struct dispatchStages
 {
     static void dispatch(const int8_t* A, const int8_t* B, tk::QuantMode quantOption, const float* alphaCol,
-        const float* alphaRow, T* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig, char* workspace,
-        size_t workspaceBytes, cudaStream_t stream, int* occupancy = nullptr)
+        const float* alphaRow, const T* residual, T* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig,
+        char* workspace, size_t workspaceBytes, cudaStream_t stream, int* occupancy = nullptr)
     {
         TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
         std::string errMsg = "Cutlass int8 gemm. Not instantiates for arch "
@@ -189,12 +196,12 @@ template <typename T, typename arch, typename ThreadblockShape, typename WarpSha
 struct dispatchStages<T, arch, ThreadblockShape, WarpShape, 2>
 {
     static void dispatch(const int8_t* A, const int8_t* B, tk::QuantMode quantOption, const float* alphaCol,
-        const float* alphaRow, T* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig, char* workspace,
-        size_t workspaceBytes, cudaStream_t stream, int* occupancy = nullptr)
+        const float* alphaRow, const T* residual, T* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig,
+        char* workspace, size_t workspaceBytes, cudaStream_t stream, int* occupancy = nullptr)
     {
         TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
-        genericInt8GemmKernelLauncher<T, arch, ThreadblockShape, WarpShape, 2>(A, B, quantOption, alphaCol, alphaRow, C,
-            m, n, k, gemmConfig, workspace, workspaceBytes, stream, occupancy);
+        genericInt8GemmKernelLauncher<T, arch, ThreadblockShape, WarpShape, 2>(A, B, quantOption, alphaCol, alphaRow,
+            residual, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream, occupancy);
     }
 };
 
@@ -203,20 +210,20 @@ struct dispatchStages<T, cutlass::arch::Sm80, ThreadblockShape, WarpShape, Stage
     typename std::enable_if<(Stages > 2)>::type>
 {
     static void dispatch(const int8_t* A, const int8_t* B, tk::QuantMode quantOption, const float* alphaCol,
-        const float* alphaRow, T* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig, char* workspace,
-        size_t workspaceBytes, cudaStream_t stream, int* occupancy = nullptr)
+        const float* alphaRow, const T* residual, T* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig,
+        char* workspace, size_t workspaceBytes, cudaStream_t stream, int* occupancy = nullptr)
     {
 
         TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
         genericInt8GemmKernelLauncher<T, cutlass::arch::Sm80, ThreadblockShape, WarpShape, Stages>(A, B, quantOption,
-            alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream, occupancy);
+            alphaCol, alphaRow, residual, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream, occupancy);
     }
 };
 
 template <typename T, typename arch, typename ThreadblockShape, typename WarpShape>
 void dispatchGemmConfig(const int8_t* A, const int8_t* B, tk::QuantMode quantOption, const float* alphaCol,
-    const float* alphaRow, T* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig, char* workspace,
-    size_t workspaceBytes, cudaStream_t stream, int* occupancy = nullptr)
+    const float* alphaRow, const T* residual, T* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig,
+    char* workspace, size_t workspaceBytes, cudaStream_t stream, int* occupancy = nullptr)
 {
 
     TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
@@ -224,27 +231,27 @@ void dispatchGemmConfig(const int8_t* A, const int8_t* B, tk::QuantMode quantOpt
     {
     case 2:
         using DispatcherStages2 = dispatchStages<T, arch, ThreadblockShape, WarpShape, 2>;
-        DispatcherStages2::dispatch(A, B, quantOption, alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace,
+        DispatcherStages2::dispatch(A, B, quantOption, alphaCol, alphaRow, residual, C, m, n, k, gemmConfig, workspace,
             workspaceBytes, stream, occupancy);
         break;
     case 3:
         using DispatcherStages3 = dispatchStages<T, arch, ThreadblockShape, WarpShape, 3>;
-        DispatcherStages3::dispatch(A, B, quantOption, alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace,
+        DispatcherStages3::dispatch(A, B, quantOption, alphaCol, alphaRow, residual, C, m, n, k, gemmConfig, workspace,
             workspaceBytes, stream, occupancy);
         break;
     case 4:
         using DispatcherStages4 = dispatchStages<T, arch, ThreadblockShape, WarpShape, 4>;
-        DispatcherStages4::dispatch(A, B, quantOption, alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace,
+        DispatcherStages4::dispatch(A, B, quantOption, alphaCol, alphaRow, residual, C, m, n, k, gemmConfig, workspace,
             workspaceBytes, stream, occupancy);
         break;
     case 5:
         using DispatcherStages5 = dispatchStages<T, arch, ThreadblockShape, WarpShape, 5>;
-        DispatcherStages5::dispatch(A, B, quantOption, alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace,
+        DispatcherStages5::dispatch(A, B, quantOption, alphaCol, alphaRow, residual, C, m, n, k, gemmConfig, workspace,
             workspaceBytes, stream, occupancy);
         break;
     case 6:
         using DispatcherStages6 = dispatchStages<T, arch, ThreadblockShape, WarpShape, 6>;
-        DispatcherStages6::dispatch(A, B, quantOption, alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace,
+        DispatcherStages6::dispatch(A, B, quantOption, alphaCol, alphaRow, residual, C, m, n, k, gemmConfig, workspace,
             workspaceBytes, stream, occupancy);
         break;
     default:
@@ -256,7 +263,7 @@ void dispatchGemmConfig(const int8_t* A, const int8_t* B, tk::QuantMode quantOpt
 
 template <typename T, typename arch>
 void dispatchGemmToCutlass(const int8_t* A, const int8_t* B, tk::QuantMode quantOption, const float* alphaCol,
-    const float* alphaRow, T* C, int m, int n, int k, char* workspace, size_t workspaceBytes,
+    const float* alphaRow, const T* residual, T* C, int m, int n, int k, char* workspace, size_t workspaceBytes,
     tkc::CutlassGemmConfig gemmConfig, cudaStream_t stream, int* occupancy = nullptr)
 {
 
@@ -266,27 +273,33 @@ void dispatchGemmToCutlass(const int8_t* A, const int8_t* B, tk::QuantMode quant
     {
     case tkc::CutlassTileConfig::CtaShape128x64x64_WarpShape64x32x64:
         dispatchGemmConfig<T, arch, cutlass::gemm::GemmShape<128, 128, 64>, cutlass::gemm::GemmShape<64, 32, 64>>(A, B,
-            quantOption, alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream, occupancy);
+            quantOption, alphaCol, alphaRow, residual, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream,
+            occupancy);
         break;
     case tkc::CutlassTileConfig::CtaShape256x128x64_WarpShape64x64x64:
         dispatchGemmConfig<T, arch, cutlass::gemm::GemmShape<256, 128, 64>, cutlass::gemm::GemmShape<64, 64, 64>>(A, B,
-            quantOption, alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream, occupancy);
+            quantOption, alphaCol, alphaRow, residual, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream,
+            occupancy);
         break;
     case tkc::CutlassTileConfig::CtaShape32x128x64_WarpShape32x32x64:
         dispatchGemmConfig<T, arch, cutlass::gemm::GemmShape<32, 128, 64>, cutlass::gemm::GemmShape<32, 32, 64>>(A, B,
-            quantOption, alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream, occupancy);
+            quantOption, alphaCol, alphaRow, residual, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream,
+            occupancy);
         break;
     case tkc::CutlassTileConfig::CtaShape64x128x64_WarpShape64x32x64:
         dispatchGemmConfig<T, arch, cutlass::gemm::GemmShape<64, 128, 64>, cutlass::gemm::GemmShape<64, 32, 64>>(A, B,
-            quantOption, alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream, occupancy);
+            quantOption, alphaCol, alphaRow, residual, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream,
+            occupancy);
         break;
     case tkc::CutlassTileConfig::CtaShape64x64x128_WarpShape32x64x64:
         dispatchGemmConfig<T, arch, cutlass::gemm::GemmShape<64, 64, 128>, cutlass::gemm::GemmShape<32, 64, 64>>(A, B,
-            quantOption, alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream, occupancy);
+            quantOption, alphaCol, alphaRow, residual, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream,
+            occupancy);
         break;
     case tkc::CutlassTileConfig::CtaShape128x256x64_WarpShape64x64x64:
         dispatchGemmConfig<T, arch, cutlass::gemm::GemmShape<128, 256, 64>, cutlass::gemm::GemmShape<64, 64, 64>>(A, B,
-            quantOption, alphaCol, alphaRow, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream, occupancy);
+            quantOption, alphaCol, alphaRow, residual, C, m, n, k, gemmConfig, workspace, workspaceBytes, stream,
+            occupancy);
         break;
     case tkc::CutlassTileConfig::Undefined:
         throw std::runtime_error("[TensorRT-LLM Error][int8][dispatch_gemm_to_cutlass] gemm config undefined.");
@@ -321,29 +334,30 @@ CutlassInt8GemmRunner<T>::~CutlassInt8GemmRunner()
 
 template <typename T>
 void CutlassInt8GemmRunner<T>::dispatchToArch(const int8_t* A, const int8_t* B, tk::QuantMode quantOption,
-    const float* alphaCol, const float* alphaRow, T* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig,
-    char* workspacePtr, const size_t workspaceBytes, cudaStream_t stream, int* occupancy)
+    const float* alphaCol, const float* alphaRow, const T* residual, T* C, int m, int n, int k,
+    tkc::CutlassGemmConfig gemmConfig, char* workspacePtr, const size_t workspaceBytes, cudaStream_t stream,
+    int* occupancy)
 {
     TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
     if (mSm >= 70 && mSm < 72)
     {
-        dispatchGemmToCutlass<T, cutlass::arch::Sm70>(A, B, quantOption, alphaCol, alphaRow, C, m, n, k, workspacePtr,
-            workspaceBytes, gemmConfig, stream, occupancy);
+        dispatchGemmToCutlass<T, cutlass::arch::Sm70>(A, B, quantOption, alphaCol, alphaRow, residual, C, m, n, k,
+            workspacePtr, workspaceBytes, gemmConfig, stream, occupancy);
     }
     else if (mSm >= 72 && mSm < 75)
     {
-        dispatchGemmToCutlass<T, cutlass::arch::Sm72>(A, B, quantOption, alphaCol, alphaRow, C, m, n, k, workspacePtr,
-            workspaceBytes, gemmConfig, stream, occupancy);
+        dispatchGemmToCutlass<T, cutlass::arch::Sm72>(A, B, quantOption, alphaCol, alphaRow, residual, C, m, n, k,
+            workspacePtr, workspaceBytes, gemmConfig, stream, occupancy);
     }
     else if (mSm >= 75 && mSm < 80)
     {
-        dispatchGemmToCutlass<T, cutlass::arch::Sm75>(A, B, quantOption, alphaCol, alphaRow, C, m, n, k, workspacePtr,
-            workspaceBytes, gemmConfig, stream, occupancy);
+        dispatchGemmToCutlass<T, cutlass::arch::Sm75>(A, B, quantOption, alphaCol, alphaRow, residual, C, m, n, k,
+            workspacePtr, workspaceBytes, gemmConfig, stream, occupancy);
     }
     else if (mSm >= 80 && mSm <= 90)
     {
-        dispatchGemmToCutlass<T, cutlass::arch::Sm80>(A, B, quantOption, alphaCol, alphaRow, C, m, n, k, workspacePtr,
-            workspaceBytes, gemmConfig, stream, occupancy);
+        dispatchGemmToCutlass<T, cutlass::arch::Sm80>(A, B, quantOption, alphaCol, alphaRow, residual, C, m, n, k,
+            workspacePtr, workspaceBytes, gemmConfig, stream, occupancy);
     }
     else
     {
@@ -354,12 +368,12 @@ void CutlassInt8GemmRunner<T>::dispatchToArch(const int8_t* A, const int8_t* B,
 
 template <typename T>
 void CutlassInt8GemmRunner<T>::gemm(const int8_t* A, const int8_t* B, tk::QuantMode quantOption, const float* alphaCol,
-    const float* alphaRow, void* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig, char* workspacePtr,
-    const size_t workspaceBytes, cudaStream_t stream)
+    const float* alphaRow, const void* residual, void* C, int m, int n, int k, tkc::CutlassGemmConfig gemmConfig,
+    char* workspacePtr, const size_t workspaceBytes, cudaStream_t stream)
 {
     TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
-    dispatchToArch(A, B, quantOption, alphaCol, alphaRow, reinterpret_cast<T*>(C), m, n, k, gemmConfig, workspacePtr,
-        workspaceBytes, stream);
+    dispatchToArch(A, B, quantOption, alphaCol, alphaRow, reinterpret_cast<const T*>(residual), reinterpret_cast<T*>(C),
+        m, n, k, gemmConfig, workspacePtr, workspaceBytes, stream);
 }
 
 template <typename T>
@@ -378,7 +392,7 @@ size_t CutlassInt8GemmRunner<T>::getWorkspaceSize(const int m, const int n, cons
     TLLM_LOG_DEBUG(__PRETTY_FUNCTION__);
     // These are the min tile sizes for each config, which would launch the maximum number of blocks
     const int maxGridM = cutlass::ceil_div(m, MIN_M_TILE);
-    const int maxGridN = cutlass::ceil_div(m, MIN_N_TILE);
+    const int maxGridN = cutlass::ceil_div(n, MIN_N_TILE);
     // We need 4 bytes per block in the worst case. We launch SPLIT_K_LIMIT in z dim.
     return static_cast<size_t>(maxGridM * maxGridN * SPLIT_K_LIMIT * 4);
 }
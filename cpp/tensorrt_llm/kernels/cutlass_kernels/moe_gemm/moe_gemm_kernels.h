@@ -52,6 +52,10 @@ public:
         best_config_ = std::move(best_config);
     }
 
+    // Number of rows of B sharing a scale, with the scales laid out as [num_experts, gemm_k / group_size, gemm_n].
+    // 0 selects per column scales. Groupwise scales require SM80+ and a group size of 64 or 128.
+    void setGroupSize(int group_size);
+
     void moeGemmBiasAct(const T* A, const WeightType* B, const T* weight_scales, const T* biases, T* C,
         int64_t* total_rows_before_expert, int64_t total_rows, int64_t gemm_n, int64_t gemm_k, int num_experts,
         ActivationType activation_type, cudaStream_t stream);
@@ -76,6 +80,7 @@ private:
     int sm_;
     int multi_processor_count_;
     std::optional<cutlass_extensions::CutlassGemmConfig> best_config_{};
+    int group_size_{0};
 };
 
 } // namespace tensorrt_llm
@@ -36,6 +36,7 @@
 #include "tensorrt_llm/common/cudaUtils.h"
 #include "tensorrt_llm/kernels/cutlass_kernels/cutlass_heuristic.h"
 #include "tensorrt_llm/kernels/cutlass_kernels/moe_gemm/moe_gemm_kernels.h"
+#include <algorithm>
 #include <cuda.h>
 #include <cuda_fp16.h>
 #include <math.h>
@@ -45,12 +46,12 @@ namespace tensorrt_llm
 {
 
 // ============================= Variable batched Gemm things ===========================
-template <typename T, typename WeightType, typename arch, typename EpilogueTag, typename ThreadblockShape,
-    typename WarpShape, int Stages>
+template <typename T, typename WeightType, typename arch, cutlass::WeightOnlyQuantOp QuantOp, typename EpilogueTag,
+    typename ThreadblockShape, typename WarpShape, int Stages>
 void genericMoeGemmKernelLauncher(const T* A, const WeightType* B, const T* weight_scales, const T* biases, T* C,
     int64_t* total_rows_before_expert, int64_t num_rows, int64_t gemm_n, int64_t gemm_k, int num_experts,
-    cutlass_extensions::CutlassGemmConfig gemm_config, const int multi_processor_count, cudaStream_t stream,
-    int* kernel_occupancy = nullptr)
+    int group_size, cutlass_extensions::CutlassGemmConfig gemm_config, const int multi_processor_count,
+    cudaStream_t stream, int* kernel_occupancy = nullptr)
 {
 #ifdef ENABLE_BF16
     static_assert(cutlass::platform::is_same<T, __nv_bfloat16>::value || cutlass::platform::is_same<T, half>::value
@@ -96,6 +97,10 @@ void genericMoeGemmKernelLauncher(const T* A, const WeightType* B, const T* weig
     using EpilogueOp = typename tensorrt_llm::cutlass_extensions::Epilogue<ElementType,
         MixedGemmArchTraits::ElementsPerAccessC, ElementAccumulator, EpilogueTag>::Op;
 
+    // The quantization op is attached to the dequantizing operator, the other operators are left untouched
+    using Operator = typename MixedGemmArchTraits::Operator;
+    using TaggedOperator = typename cutlass::arch::TagOperator<Operator, QuantOp>::TaggedOperator;
+
     // Finally, set up the kernel.
     using GemmKernel_ = typename cutlass::gemm::kernel::DefaultGemmGrouped<ElementType, cutlass::layout::RowMajor,
         cutlass::ComplexTransform::kNone, MixedGemmArchTraits::ElementsPerAccessA, CutlassWeightType,
@@ -104,7 +109,7 @@ void genericMoeGemmKernelLauncher(const T* A, const WeightType* B, const T* weig
         typename MixedGemmArchTraits::OperatorClass, arch, ThreadblockShape, WarpShape,
         typename MixedGemmArchTraits::InstructionShape, EpilogueOp,
         cutlass::gemm::threadblock::GemmBatchedIdentityThreadblockSwizzle, Stages,
-        cutlass::gemm::kernel::GroupScheduleMode::kDeviceOnly, typename MixedGemmArchTraits::Operator>::GemmKernel;
+        cutlass::gemm::kernel::GroupScheduleMode::kDeviceOnly, TaggedOperator>::GemmKernel;
 
     using GemmKernel = cutlass::gemm::kernel::MoeFCGemm<typename GemmKernel_::Mma, typename GemmKernel_::Epilogue,
         typename GemmKernel_::ThreadblockSwizzle,
@@ -125,7 +130,6 @@ void genericMoeGemmKernelLauncher(const T* A, const WeightType* B, const T* weig
     typename EpilogueOp::Params epilogue_op(
         ElementAccumulator(1.f), biases ? ElementAccumulator(1.f) : ElementAccumulator(0.f));
 
-    const int group_size = gemm_k;
     typename GemmGrouped::Arguments args(num_experts, threadblock_count, group_size, epilogue_op,
         reinterpret_cast<const ElementType*>(A), reinterpret_cast<const CutlassWeightType*>(B),
         reinterpret_cast<const ElementType*>(weight_scales), reinterpret_cast<const ElementType*>(biases),
@@ -153,8 +157,8 @@ struct dispatch_stages
 {
     static void dispatch(const T* A, const WeightType* B, const T* weight_scales, const T* biases, T* C,
         int64_t* total_rows_before_expert, int64_t num_rows, int64_t gemm_n, int64_t gemm_k, int num_experts,
-        cutlass_extensions::CutlassGemmConfig gemm_config, int multi_processor_count, cudaStream_t stream,
-        int* occupancy = nullptr)
+        int group_size, cutlass_extensions::CutlassGemmConfig gemm_config, int multi_processor_count,
+        cudaStream_t stream, int* occupancy = nullptr)
     {
         TLLM_THROW("Cutlass fpA_intB gemm. Not instantiated for arch %d with stages set to %d",
             arch::kMinComputeCapability, Stages);
@@ -167,12 +171,14 @@ struct dispatch_stages<T, WeightType, arch, EpilogueTag, ThreadblockShape, WarpS
 {
     static void dispatch(const T* A, const WeightType* B, const T* weight_scales, const T* biases, T* C,
         int64_t* total_rows_before_expert, int64_t num_rows, int64_t gemm_n, int64_t gemm_k, int num_experts,
-        cutlass_extensions::CutlassGemmConfig gemm_config, int multi_processor_count, cudaStream_t stream,
-        int* occupancy = nullptr)
+        int group_size, cutlass_extensions::CutlassGemmConfig gemm_config, int multi_processor_count,
+        cudaStream_t stream, int* occupancy = nullptr)
     {
-        genericMoeGemmKernelLauncher<T, WeightType, arch, EpilogueTag, ThreadblockShape, WarpShape, 2>(A, B,
-            weight_scales, biases, C, total_rows_before_expert, num_rows, gemm_n, gemm_k, num_experts, gemm_config,
-            multi_processor_count, stream, occupancy);
+        // The pipelined mainloop only supports per column scales
+        TLLM_CHECK_WITH_INFO(group_size == gemm_k, "Groupwise MoE GEMM requires a multistage config (SM80+)");
+        genericMoeGemmKernelLauncher<T, WeightType, arch, cutlass::WeightOnlyQuantOp::PER_COLUMN_SCALE_ONLY,
+            EpilogueTag, ThreadblockShape, WarpShape, 2>(A, B, weight_scales, biases, C, total_rows_before_expert,
+            num_rows, gemm_n, gemm_k, num_experts, group_size, gemm_config, multi_processor_count, stream, occupancy);
     }
 };
 
@@ -183,11 +189,23 @@ struct dispatch_stages<T, WeightType, cutlass::arch::Sm80, EpilogueTag, Threadbl
 {
     static void dispatch(const T* A, const WeightType* B, const T* weight_scales, const T* biases, T* C,
         int64_t* total_rows_before_expert, int64_t num_rows, int64_t gemm_n, int64_t gemm_k, int num_experts,
-        cutlass_extensions::CutlassGemmConfig gemm_config, int multi_processor_count, cudaStream_t stream,
-        int* occupancy = nullptr)
+        int group_size, cutlass_extensions::CutlassGemmConfig gemm_config, int multi_processor_count,
+        cudaStream_t stream, int* occupancy = nullptr)
     {
-        genericMoeGemmKernelLauncher<T, WeightType, cutlass::arch::Sm80, EpilogueTag, ThreadblockShape, WarpShape,
-            Stages>(A, B, weight_scales, biases, C, total_rows_before_expert, num_rows, gemm_n, gemm_k, num_experts,
+        if constexpr (!std::is_same<T, WeightType>::value)
+        {
+            if (group_size != gemm_k)
+            {
+                genericMoeGemmKernelLauncher<T, WeightType, cutlass::arch::Sm80,
+                    cutlass::WeightOnlyQuantOp::FINEGRAINED_SCALE_ONLY, EpilogueTag, ThreadblockShape, WarpShape,
+                    Stages>(A, B, weight_scales, biases, C, total_rows_before_expert, num_rows, gemm_n, gemm_k,
+                    num_experts, group_size, gemm_config, multi_processor_count, stream, occupancy);
+                return;
+            }
+        }
+        genericMoeGemmKernelLauncher<T, WeightType, cutlass::arch::Sm80,
+            cutlass::WeightOnlyQuantOp::PER_COLUMN_SCALE_ONLY, EpilogueTag, ThreadblockShape, WarpShape, Stages>(A, B,
+            weight_scales, biases, C, total_rows_before_expert, num_rows, gemm_n, gemm_k, num_experts, group_size,
             gemm_config, multi_processor_count, stream, occupancy);
     }
 };
@@ -196,7 +214,7 @@ template <typename T, typename WeightType, typename arch, typename EpilogueTag,
     typename WarpShape>
 void dispatchGemmConfig(const T* A, const WeightType* B, const T* weight_scales, const T* biases, T* C,
     int64_t* total_rows_before_expert, int64_t num_rows, int64_t gemm_n, int64_t gemm_k, int num_experts,
-    cutlass_extensions::CutlassGemmConfig gemm_config, int multi_processor_count, cudaStream_t stream,
+    int group_size, cutlass_extensions::CutlassGemmConfig gemm_config, int multi_processor_count, cudaStream_t stream,
     int* occupancy = nullptr)
 {
     switch (gemm_config.stages)
@@ -204,17 +222,17 @@ void dispatchGemmConfig(const T* A, const WeightType* B, const T* weight_scales,
     case 2:
         using DispatcherStages2 = dispatch_stages<T, WeightType, arch, EpilogueTag, ThreadblockShape, WarpShape, 2>;
         DispatcherStages2::dispatch(A, B, weight_scales, biases, C, total_rows_before_expert, num_rows, gemm_n, gemm_k,
-            num_experts, gemm_config, multi_processor_count, stream, occupancy);
+            num_experts, group_size, gemm_config, multi_processor_count, stream, occupancy);
         break;
     case 3:
         using DispatcherStages3 = dispatch_stages<T, WeightType, arch, EpilogueTag, ThreadblockShape, WarpShape, 3>;
         DispatcherStages3::dispatch(A, B, weight_scales, biases, C, total_rows_before_expert, num_rows, gemm_n, gemm_k,
-            num_experts, gemm_config, multi_processor_count, stream, occupancy);
+            num_experts, group_size, gemm_config, multi_processor_count, stream, occupancy);
         break;
     case 4:
         using DispatcherStages4 = dispatch_stages<T, WeightType, arch, EpilogueTag, ThreadblockShape, WarpShape, 4>;
         DispatcherStages4::dispatch(A, B, weight_scales, biases, C, total_rows_before_expert, num_rows, gemm_n, gemm_k,
-            num_experts, gemm_config, multi_processor_count, stream, occupancy);
+            num_experts, group_size, gemm_config, multi_processor_count, stream, occupancy);
         break;
     default: TLLM_THROW("dispatchGemmConfig does not support stages %d", gemm_config.stages); break;
     }
@@ -226,25 +244,25 @@ template <typename T, typename WeightType, typename arch, typename EpilogueTag,
     typename std::enable_if<!std::is_same<T, float>::value && std::is_same<T, WeightType>::value>::type* = nullptr>
 void dispatchMoeGemmToCutlass(const T* A, const WeightType* B, const T* weight_scales, const T* biases, T* C,
     int64_t* total_rows_before_expert, int64_t total_rows, int64_t gemm_n, int64_t gemm_k, int num_experts,
-    cutlass_extensions::CutlassGemmConfig gemm_config, int sm_version, int multi_processor_count, cudaStream_t stream,
-    int* occupancy = nullptr)
+    int group_size, cutlass_extensions::CutlassGemmConfig gemm_config, int sm_version, int multi_processor_count,
+    cudaStream_t stream, int* occupancy = nullptr)
 {
     switch (gemm_config.tile_config)
     {
     case cutlass_extensions::CutlassTileConfig::CtaShape32x128x64_WarpShape32x32x64:
         dispatchGemmConfig<T, WeightType, arch, EpilogueTag, cutlass::gemm::GemmShape<32, 128, 64>,
             cutlass::gemm::GemmShape<32, 32, 64>>(A, B, weight_scales, biases, C, total_rows_before_expert, total_rows,
-            gemm_n, gemm_k, num_experts, gemm_config, multi_processor_count, stream, occupancy);
+            gemm_n, gemm_k, num_experts, group_size, gemm_config, multi_processor_count, stream, occupancy);
         break;
     case cutlass_extensions::CutlassTileConfig::CtaShape64x128x64_WarpShape32x64x64:
         dispatchGemmConfig<T, WeightType, arch, EpilogueTag, cutlass::gemm::GemmShape<64, 128, 64>,
             cutlass::gemm::GemmShape<32, 64, 64>>(A, B, weight_scales, biases, C, total_rows_before_expert, total_rows,
-            gemm_n, gemm_k, num_experts, gemm_config, multi_processor_count, stream, occupancy);
+            gemm_n, gemm_k, num_experts, group_size, gemm_config, multi_processor_count, stream, occupancy);
         break;
     case cutlass_extensions::CutlassTileConfig::CtaShape128x128x64_WarpShape64x32x64:
         dispatchGemmConfig<T, WeightType, arch, EpilogueTag, cutlass::gemm::GemmShape<128, 128, 64>,
             cutlass::gemm::GemmShape<64, 32, 64>>(A, B, weight_scales, biases, C, total_rows_before_expert, total_rows,
-            gemm_n, gemm_k, num_experts, gemm_config, multi_processor_count, stream, occupancy);
+            gemm_n, gemm_k, num_experts, group_size, gemm_config, multi_processor_count, stream, occupancy);
         break;
     case cutlass_extensions::CutlassTileConfig::Undefined: TLLM_THROW("GEMM config undefined."); break;
     case cutlass_extensions::CutlassTileConfig::ChooseWithHeuristic:
@@ -261,25 +279,25 @@ template <typename T, typename WeightType, typename arch, typename EpilogueTag,
     typename std::enable_if<!std::is_same<T, float>::value && !std::is_same<T, WeightType>::value>::type* = nullptr>
 void dispatchMoeGemmToCutlass(const T* A, const WeightType* B, const T* weight_scales, const T* biases, T* C,
     int64_t* total_rows_before_expert, int64_t total_rows, int64_t gemm_n, int64_t gemm_k, int num_experts,
-    cutlass_extensions::CutlassGemmConfig gemm_config, int sm_version, int multi_processor_count, cudaStream_t stream,
-    int* occupancy = nullptr)
+    int group_size, cutlass_extensions::CutlassGemmConfig gemm_config, int sm_version, int multi_processor_count,
+    cudaStream_t stream, int* occupancy = nullptr)
 {
     switch (gemm_config.tile_config)
     {
     case cutlass_extensions::CutlassTileConfig::CtaShape32x128x64_WarpShape32x32x64:
         dispatchGemmConfig<T, WeightType, arch, EpilogueTag, cutlass::gemm::GemmShape<32, 128, 64>,
             cutlass::gemm::GemmShape<32, 32, 64>>(A, B, weight_scales, biases, C, total_rows_before_expert, total_rows,
-            gemm_n, gemm_k, num_experts, gemm_config, multi_processor_count, stream, occupancy);
+            gemm_n, gemm_k, num_experts, group_size, gemm_config, multi_processor_count, stream, occupancy);
         break;
     case cutlass_extensions::CutlassTileConfig::CtaShape64x128x64_WarpShape64x32x64:
         dispatchGemmConfig<T, WeightType, arch, EpilogueTag, cutlass::gemm::GemmShape<64, 128, 64>,
             cutlass::gemm::GemmShape<64, 32, 64>>(A, B, weight_scales, biases, C, total_rows_before_expert, total_rows,
-            gemm_n, gemm_k, num_experts, gemm_config, multi_processor_count, stream, occupancy);
+            gemm_n, gemm_k, num_experts, group_size, gemm_config, multi_processor_count, stream, occupancy);
         break;
     case cutlass_extensions::CutlassTileConfig::CtaShape128x128x64_WarpShape128x32x64:
         dispatchGemmConfig<T, WeightType, arch, EpilogueTag, cutlass::gemm::GemmShape<128, 128, 64>,
             cutlass::gemm::GemmShape<128, 32, 64>>(A, B, weight_scales, biases, C, total_rows_before_expert, total_rows,
-            gemm_n, gemm_k, num_experts, gemm_config, multi_processor_count, stream, occupancy);
+            gemm_n, gemm_k, num_experts, group_size, gemm_config, multi_processor_count, stream, occupancy);
         break;
     case cutlass_extensions::CutlassTileConfig::Undefined: TLLM_THROW("GEMM config undefined."); break;
     case cutlass_extensions::CutlassTileConfig::ChooseWithHeuristic:
@@ -294,15 +312,15 @@ template <typename T, typename WeightType, typename arch, typename EpilogueTag,
     typename std::enable_if<std::is_same<T, float>::value>::type* = nullptr>
 void dispatchMoeGemmToCutlass(const T* A, const WeightType* B, const T* weight_scales, const T* biases, T* C,
     int64_t* total_rows_before_expert, int64_t total_rows, int64_t gemm_n, int64_t gemm_k, int num_experts,
-    cutlass_extensions::CutlassGemmConfig gemm_config, int sm_version, int multi_processor_count, cudaStream_t stream,
-    int* occupancy = nullptr)
+    int group_size, cutlass_extensions::CutlassGemmConfig gemm_config, int sm_version, int multi_processor_count,
+    cudaStream_t stream, int* occupancy = nullptr)
 {
     switch (gemm_config.tile_config)
     {
     case cutlass_extensions::CutlassTileConfig::CtaShape128x128x8_WarpShape64x64x8:
         dispatchGemmConfig<T, WeightType, arch, EpilogueTag, cutlass::gemm::GemmShape<128, 128, 8>,
             cutlass::gemm::GemmShape<64, 64, 8>>(A, B, weight_scales, biases, C, total_rows_before_expert, total_rows,
-            gemm_n, gemm_k, num_experts, gemm_config, multi_processor_count, stream, occupancy);
+            gemm_n, gemm_k, num_experts, group_size, gemm_config, multi_processor_count, stream, occupancy);
         break;
     case cutlass_extensions::CutlassTileConfig::Undefined: TLLM_THROW("GEMM config undefined."); break;
     case cutlass_extensions::CutlassTileConfig::ChooseWithHeuristic:
@@ -319,6 +337,13 @@ std::vector<cutlass_extensions::CutlassGemmConfig> MoeGemmRunner<T, WeightType>:
     static constexpr bool only_simt_configs = std::is_same<T, float>::value;
     std::vector<cutlass_extensions::CutlassGemmConfig> candidate_configs
         = kernels::cutlass_kernels::get_candidate_configs(sm_, is_weight_only, only_simt_configs);
+    if (group_size_ > 0)
+    {
+        // The groupwise scales are only supported by the multistage mainloop
+        candidate_configs.erase(std::remove_if(candidate_configs.begin(), candidate_configs.end(),
+                                    [](const auto& config) { return config.stages < 3; }),
+            candidate_configs.end());
+    }
     return candidate_configs;
 }
 
@@ -332,36 +357,49 @@ MoeGemmRunner<T, WeightType>::MoeGemmRunner()
         cudaDeviceGetAttribute(&multi_processor_count_, cudaDevAttrMultiProcessorCount, device));
 }
 
+template <typename T, typename WeightType>
+void MoeGemmRunner<T, WeightType>::setGroupSize(int group_size)
+{
+    TLLM_CHECK_WITH_INFO(group_size == 0 || !std::is_same<T, WeightType>::value,
+        "A group size is only supported for quantized weights");
+    TLLM_CHECK_WITH_INFO(group_size == 0 || group_size == 64 || group_size == 128,
+        "Only group size 64 and 128 supported for the groupwise MoE GEMM");
+    TLLM_CHECK_WITH_INFO(group_size == 0 || sm_ >= 80, "The groupwise MoE GEMM requires SM80+");
+    group_size_ = group_size;
+}
+
 template <typename T, typename WeightType>
 template <typename EpilogueTag>
 void MoeGemmRunner<T, WeightType>::dispatchToArch<EpilogueTag>(const T* A, const WeightType* B, const T* weight_scales,
     const T* biases, T* C, int64_t* total_rows_before_expert, int64_t total_rows, int64_t gemm_n, int64_t gemm_k,
     int num_experts, cutlass_extensions::CutlassGemmConfig gemm_config, cudaStream_t stream, int* occupancy)
 {
+    // Per column scales are a single group spanning gemm_k
+    const int group_size = group_size_ > 0 ? group_size_ : gemm_k;
     if (sm_ >= 70 && sm_ < 75)
     {
         dispatchMoeGemmToCutlass<T, WeightType, cutlass::arch::Sm70, EpilogueTag>(A, B, weight_scales, biases, C,
-            total_rows_before_expert, total_rows, gemm_n, gemm_k, num_experts, gemm_config, sm_, multi_processor_count_,
-            stream, occupancy);
+            total_rows_before_expert, total_rows, gemm_n, gemm_k, num_experts, group_size, gemm_config, sm_,
+            multi_processor_count_, stream, occupancy);
     }
     else if (sm_ >= 75 && sm_ < 80)
     {
         dispatchMoeGemmToCutlass<T, WeightType, cutlass::arch::Sm75, EpilogueTag>(A, B, weight_scales, biases, C,
-            total_rows_before_expert, total_rows, gemm_n, gemm_k, num_experts, gemm_config, sm_, multi_processor_count_,
-            stream, occupancy);
+            total_rows_before_expert, total_rows, gemm_n, gemm_k, num_experts, group_size, gemm_config, sm_,
+            multi_processor_count_, stream, occupancy);
     }
     else if (sm_ >= 80 && sm_ < 90)
     {
         dispatchMoeGemmToCutlass<T, WeightType, cutlass::arch::Sm80, EpilogueTag>(A, B, weight_scales, biases, C,
-            total_rows_before_expert, total_rows, gemm_n, gemm_k, num_experts, gemm_config, sm_, multi_processor_count_,
-            stream, occupancy);
+            total_rows_before_expert, total_rows, gemm_n, gemm_k, num_experts, group_size, gemm_config, sm_,
+            multi_processor_count_, stream, occupancy);
     }
     else if (sm_ >= 90)
     {
         // TODO Update the arch to Sm90 once CUTLASS hopper specialisations are available
         dispatchMoeGemmToCutlass<T, WeightType, cutlass::arch::Sm80, EpilogueTag>(A, B, weight_scales, biases, C,
-            total_rows_before_expert, total_rows, gemm_n, gemm_k, num_experts, gemm_config, sm_, multi_processor_count_,
-            stream, occupancy);
+            total_rows_before_expert, total_rows, gemm_n, gemm_k, num_experts, group_size, gemm_config, sm_,
+            multi_processor_count_, stream, occupancy);
     }
     else
     {
@@ -89,6 +89,10 @@ struct Multihead_attention_params_base
 
     // The indirections to use for cache when beam sampling.
     const int* cache_indir = nullptr;
+    // Tokens per block of the block cache indirection of the paged KV cache, 0 for the dense one. The block cache
+    // indirection has 1 + cache_indir_tokens_per_block entries per beam: the beam whose blocks hold the tokens before
+    // the current block, then the beam whose cache holds each token of the current block.
+    int cache_indir_tokens_per_block = 0;
 
     // scales
     const float* query_weight_output_scale = nullptr;
@@ -108,6 +112,14 @@ struct Multihead_attention_params_base
     int max_attention_window_size = 0;
     // Cyclic kv cache capacity (used to get the cyclic kv cache position for new tokens)
     int cyclic_attention_window_size = 0;
+    // Number of cache slots used cyclically when it is larger than cyclic_attention_window_size, which happens
+    // with the sliding window paged KV cache. Keys outside of the attention window are masked.
+    // 0 means cyclic_attention_window_size.
+    int cyclic_kv_cache_len = 0;
+    // Attention sinks: the first sink_token_length tokens keep the first slots of the cyclic KV cache and the later
+    // tokens cycle over the other slots. Once tokens were dropped, the sink keys are scored with the query rotated at
+    // the position that follows the cache, as if the kept tokens were contiguous.
+    int sink_token_length = 0;
     // The number of heads (H).
     int num_heads = 0;
     // Controls MHA/MQA/GQA
@@ -137,6 +149,10 @@ struct Multihead_attention_params_base
     // The slope per head of linear position bias to attention score (H).
     const T* linear_bias_slopes = nullptr;
 
+    // Mask the keys outside of a block-sparse pattern (AttentionMaskType::BLOCKSPARSE).
+    bool block_sparse_attention = false;
+    BlockSparseParams block_sparse_params;
+
     const T* ia3_key_weights = nullptr;
     const T* ia3_value_weights = nullptr;
     const int* ia3_tasks = nullptr;
@@ -149,6 +165,13 @@ struct Multihead_attention_params_base
 
     bool int8_kv_cache = false;
     bool fp8_kv_cache = false;
+    // The paged 8-bit KV cache carries one scale per (block, head) next to each block. The new token was already
+    // appended to the cache by invokeAppendKvCacheBlocks and the kernel only reads the cache.
+    bool kv_cache_block_scaling = false;
+    // Online recalibration of the 8-bit KV cache scale: the absmax of the new keys and values is raised into
+    // kv_cache_abs_max[0] while kv_cache_abs_max_collect[0] is not zero.
+    float* kv_cache_abs_max = nullptr;
+    const int* kv_cache_abs_max_collect = nullptr;
 
     // Multi-block setups
     mutable bool multi_block_mode = false;
@@ -45,9 +45,11 @@ inline size_t smem_size_in_bytes(const Multihead_attention_params<T, DO_CROSS_AT
 {
     using Tk = typename kernel_type_t<T>::Type;
     // The amount of shared memory needed to store the Q*K^T values in float.
+    const int cyclic_kv_cache_len
+        = params.cyclic_kv_cache_len > 0 ? params.cyclic_kv_cache_len : params.cyclic_attention_window_size;
     const int max_timesteps = DO_CROSS_ATTENTION
         ? params.cyclic_attention_window_size
-        : min((DO_MULTI_BLOCK ? params.timesteps_per_block : params.timestep), params.cyclic_attention_window_size);
+        : min((DO_MULTI_BLOCK ? params.timesteps_per_block : params.timestep), cyclic_kv_cache_len);
     const auto qk_elts = static_cast<std::size_t>(divUp(max_timesteps + 1, 4)); // explicit cast because of the sign
     const auto qk_sz = qk_elts * 16;
 
@@ -965,7 +965,8 @@ inline __device__ void Logit_value_fma(
     else if constexpr (FP8_KV_CACHE)
     {
 #ifdef MMHA_FP8_SCALE_P_INSTEAD_OF_V
-        out = fma(logit, cast_to_float(v_vec), out);
+        // The per-tensor scale is already folded into the logits, v_scale is 1 unless the scale is per block.
+        out = fma(logit * v_scale, cast_to_float(v_vec), out);
 #else
         V_vec_accum v_vec_ = mul<V_vec_accum, float, V_vec_m>(v_scale, v_vec);
         out = fma(logit, cast_to_float(v_vec_), out);
@@ -977,6 +978,16 @@ inline __device__ void Logit_value_fma(
     }
 #else // MMHA_USE_FP32_ACCUM_FOR_LOGITS
     Tk logit = is_mask ? Tk(0.f) : logits_smem[0];
+#ifdef MMHA_FP8_SCALE_P_INSTEAD_OF_V
+    if constexpr (FP8_KV_CACHE)
+    {
+        // The per-tensor scale is already folded into the logits, v_scale is 1 unless the scale is per block.
+        if (v_scale != 1.f)
+        {
+            convert_from_float(&logit, mul<float>(logit, v_scale));
+        }
+    }
+#endif // MMHA_FP8_SCALE_P_INSTEAD_OF_V
     if constexpr (INT8_KV_CACHE)
     {
         V_vec_accum v_vec_ = mul<V_vec_accum, float, V_vec_m>(v_scale, v_vec);
@@ -1158,6 +1169,43 @@ inline __device__ __host__ T div(T m, T n)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+inline __device__ float kv_elt_to_float(float u)
+{
+    return u;
+}
+
+inline __device__ float kv_elt_to_float(uint16_t u)
+{
+    return __half2float(reinterpret_cast<const half&>(u));
+}
+
+#ifdef ENABLE_BF16
+inline __device__ float kv_elt_to_float(__nv_bfloat16 u)
+{
+    return __bfloat162float(u);
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Raises abs_max[0] to the largest magnitude of the elements of a K/V vector. The values are non-negative, so their
+// bits compare like the floats.
+template <typename T, typename Vec>
+inline __device__ void update_kv_abs_max(float* abs_max, const Vec& vec)
+{
+    constexpr int NUM_ELTS = sizeof(Vec) / sizeof(T);
+    const T* elts = reinterpret_cast<const T*>(&vec);
+    float vec_abs_max = 0.f;
+#pragma unroll
+    for (int i = 0; i < NUM_ELTS; ++i)
+    {
+        vec_abs_max = fmaxf(vec_abs_max, fabsf(kv_elt_to_float(elts[i])));
+    }
+    atomicMax(reinterpret_cast<int*>(abs_max), __float_as_int(vec_abs_max));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 template <typename T>
 struct kernel_type_t
 {
@@ -1222,6 +1270,21 @@ __device__ inline constexpr uint2 chunk_index(unsigned tidx)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Returns the beam whose cache holds the token at time_idx for the beam of beam_indices.
+// With the dense cache indirection, beam_indices has one entry per token. With the block cache indirection
+// (tokens_per_block > 0), the tokens before tail_start, the first token of the current block, are read through the
+// blocks of beam_indices[0] and token i of the current block from the cache of beam_indices[1 + i].
+inline __device__ int cache_indir_beam(const int* beam_indices, int time_idx, int tokens_per_block, int tail_start)
+{
+    if (tokens_per_block == 0)
+    {
+        return beam_indices[time_idx];
+    }
+    return time_idx < tail_start ? beam_indices[0] : beam_indices[1 + time_idx - tail_start];
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 template <
     // The type of the inputs. Supported types: float, uint16_t, nv_bfloat16.
     typename T,
@@ -1275,7 +1338,12 @@ __global__ void masked_multihead_attention_kernel(
     // Note that the maximum sequence length supported by the model might be greater than this.
     // Note max_attention_window_size is maximum of cyclic_attention_window_size among all layers.
     // By default, you can assume that they are the same.
-    const auto cyclic_kv_cache_len = static_cast<unsigned>(params.cyclic_attention_window_size);
+    // With the sliding window paged KV cache, the cache is a ring of blocks longer than the attention window and the
+    // keys of the ring that are older than the window are masked.
+    const bool sliding_window_kv_cache = !DO_CROSS_ATTENTION && params.cyclic_kv_cache_len > 0
+        && params.cyclic_kv_cache_len > params.cyclic_attention_window_size;
+    const auto cyclic_kv_cache_len = static_cast<unsigned>(
+        sliding_window_kv_cache ? params.cyclic_kv_cache_len : params.cyclic_attention_window_size);
     // The current timestep (including paddings).
     // It is only used to calculate the smem stride.
     const auto timestep = static_cast<unsigned>(DO_MULTI_BLOCK ? params.timesteps_per_block : params.timestep);
@@ -1346,6 +1414,8 @@ __global__ void masked_multihead_attention_kernel(
     // Shared memory to store Q inputs.
     __shared__ __align__(mmha::const_max(sizeof(Qk_vec_k), sizeof(K_vec_k))) Tk q_smem[Dh_MAX];
     __shared__ __align__(mmha::const_max(sizeof(Qk_vec_k), sizeof(K_vec_k))) Tk k_smem[Dh_MAX];
+    // Shared memory to store the query of the sink keys, see shift_sink_positions.
+    __shared__ __align__(mmha::const_max(sizeof(Qk_vec_k), sizeof(K_vec_k))) Tk q_sink_smem[Dh_MAX];
 
     // Make sure the hidden dimension per head is a multiple of the number of threads per value.
     static_assert(Dh_MAX % THREADS_PER_VALUE == 0); // trivially satisfied since THREADS_PER_VALUE == Dh_MAX / p
@@ -1422,9 +1492,20 @@ __global__ void masked_multihead_attention_kernel(
     const int tlength = DO_CROSS_ATTENTION
         ? params.memory_length_per_sample[batch_beam_idx] - 1
         : (params.length_per_sample ? (params.length_per_sample[batch_beam_idx] - 1) : static_cast<int>(timestep));
+    // The sink tokens keep the first slots of the cache and the later tokens cycle over the remaining ones.
+    const int sink_token_len = DO_CROSS_ATTENTION ? 0 : params.sink_token_length;
+    const int cyclic_window_len = static_cast<int>(cyclic_kv_cache_len) - sink_token_len;
     // We will use cyclic kv cache when it exceeds the limit.
     // The length position for storing new key and value.
-    const int cyclic_tlength = tlength % cyclic_kv_cache_len;
+    const int cyclic_tlength
+        = tlength < sink_token_len ? tlength : sink_token_len + (tlength - sink_token_len) % cyclic_window_len;
+    // Once tokens were dropped, the rotary embedding would put the sink keys further and further from the query. They
+    // are scored with the query rotated at the position that follows the cache instead, as if the kept tokens were
+    // contiguous (StreamingLLM). The keys of the window keep their distance to the query.
+    const bool shift_sink_positions = sink_token_len > 0 && tlength > static_cast<int>(cyclic_kv_cache_len)
+        && (params.position_embedding_type == PositionEmbeddingType::kROPE_GPTJ
+            || params.position_embedding_type == PositionEmbeddingType::kROPE_GPT_NEOX);
+    const int sink_q_position = cyclic_kv_cache_len;
     // The actual kv cache length.
     // tlength is the past length actually.
     const int kv_loop_length = min(tlength, cyclic_kv_cache_len);
@@ -1447,6 +1528,12 @@ __global__ void masked_multihead_attention_kernel(
     const float kv_scale_quant_orig_f = (ENABLE_8BITS_CACHE ? params.kv_scale_quant_orig[0] : 1.0f);
     convert_from_float(&kv_scale_quant_orig, kv_scale_quant_orig_f);
     convert_from_float(&kv_scale_orig_quant, (ENABLE_8BITS_CACHE ? params.kv_scale_orig_quant[0] : 1.0f));
+    // With block scaling the scales are read from the sidecar of each paged block instead.
+    const bool kv_block_scaling = ENABLE_8BITS_CACHE && params.kv_cache_block_scaling;
+    // The absmax of the new keys and values recalibrates the cache scale on the sampled steps.
+    float* kv_abs_max = ENABLE_8BITS_CACHE && params.kv_cache_abs_max != nullptr && *params.kv_cache_abs_max_collect
+        ? params.kv_cache_abs_max
+        : nullptr;
 
     // Up to QK_VECS_PER_Dh_MAX threads load Q and K + the bias values for the current timestep.
     // Trigger the loads from the Q and K buffers.
@@ -1486,7 +1573,9 @@ __global__ void masked_multihead_attention_kernel(
         {
             const auto k_idx = QK_VEC_SIZE * tidx;
             const int inBlockIdx = kvCacheBuffer.getKVLocalIdx(cyclic_tlength, hi, Dh, k_idx);
-            Tcache* k_cache = reinterpret_cast<Tcache*>(kvCacheBuffer.getKBlockPtr(batch_beam_idx, cyclic_tlength));
+            // The cross attention cache has one row per request, shared by its beams.
+            Tcache* k_cache = reinterpret_cast<Tcache*>(
+                kvCacheBuffer.getKBlockPtr(batch_beam_idx / params.beam_width, cyclic_tlength));
 
             k = vec_conversion<Qk_vec_k, Qk_vec_m>(*reinterpret_cast<const Qk_vec_m*>(&k_cache[inBlockIdx]));
         }
@@ -1540,6 +1629,11 @@ __global__ void masked_multihead_attention_kernel(
     const auto beam_width = static_cast<unsigned>(params.beam_width);
     // The batch idx.
     const int batch_idx = batch_beam_idx / beam_width;
+    // The cache row holding the K/V shared by all beams of the request. The cross attention cache (encoder K/V) is
+    // written once per request and has no per-beam rows.
+    const int shared_kv_row_idx = DO_CROSS_ATTENTION ? batch_idx : batch_idx * beam_width;
+    // The cache row of this beam.
+    const int kv_row_idx = DO_CROSS_ATTENTION ? batch_idx : batch_beam_idx;
     // Do we apply IA3?
     const bool do_ia3 = HANDLE_KV && params.ia3_tasks != nullptr;
     // Compute the IA3 task. One per batch index.
@@ -1554,6 +1648,9 @@ __global__ void masked_multihead_attention_kernel(
                 &params.ia3_key_weights[tensorrt_llm::common::flat_index2(ia3_ti_hi, qk_vec_idx, Dh)])));
     }
 
+    // The query of the sink keys, rotated below when shift_sink_positions.
+    Qk_vec_k q_sink = q;
+
     // Note we have no paddings in KV cache now.
     switch (params.position_embedding_type)
     {
@@ -1576,6 +1673,11 @@ __global__ void masked_multihead_attention_kernel(
             apply_rotary_embedding(q, tidx, params.rotary_embedding_dim, params.rotary_embedding_base,
                 params.rotary_embedding_scale, tlength);
         }
+        if (shift_sink_positions)
+        {
+            apply_rotary_embedding(q_sink, tidx, params.rotary_embedding_dim, params.rotary_embedding_base,
+                params.rotary_embedding_scale, sink_q_position);
+        }
         break;
     }
     case PositionEmbeddingType::kROPE_GPT_NEOX:
@@ -1637,6 +1739,34 @@ __global__ void masked_multihead_attention_kernel(
         }
 
         __syncthreads();
+
+        if (shift_sink_positions)
+        {
+            // Same transposed rotation for the query of the sink keys.
+            if (do_rotary)
+            {
+                *reinterpret_cast<Qk_vec_k*>(q_smem_ + half_idx * smem_pitch + intra_half_idx) = q_sink;
+            }
+
+            __syncthreads();
+
+            if (do_rotary)
+            {
+                mmha::vec_from_smem_transpose(q_sink, q_smem_, transpose_idx, smem_pitch);
+                mmha::apply_rotary_embedding(q_sink, transpose_idx / tidx_factor, params.rotary_embedding_dim,
+                    rotary_embedding_base, rotary_embedding_scale, sink_q_position);
+                mmha::write_smem_transpose(q_sink, q_smem_, transpose_idx, smem_pitch);
+            }
+
+            __syncthreads();
+
+            if (do_rotary)
+            {
+                q_sink = *reinterpret_cast<Qk_vec_k*>(q_smem_ + half_idx * smem_pitch + intra_half_idx);
+            }
+
+            __syncthreads();
+        }
         break;
     }
     }
@@ -1656,7 +1786,7 @@ __global__ void masked_multihead_attention_kernel(
             zero(scaled_q);
             if (is_valid_qk_vec)
             {
-                scaled_q = mul<Qk_vec_k, Tk, Qk_vec_k>(kv_scale_quant_orig, q);
+                scaled_q = kv_block_scaling ? q : mul<Qk_vec_k, Tk, Qk_vec_k>(kv_scale_quant_orig, q);
             }
             reinterpret_cast<Qk_vec_k*>(&q_smem[qk_vec_idx])[0] = scaled_q;
         }
@@ -1669,6 +1799,24 @@ __global__ void masked_multihead_attention_kernel(
             reinterpret_cast<Qk_vec_k*>(&q_smem[qk_vec_idx])[0] = is_valid_qk_vec ? q : zero_q;
         }
 
+        // Store the query of the sink keys to shared memory, scaled like the query.
+        if (shift_sink_positions)
+        {
+            Qk_vec_k sink_q;
+            zero(sink_q);
+            if (is_valid_qk_vec)
+            {
+                sink_q = q_sink;
+#ifdef MMHA_FP8_SCALE_Q_INSTEAD_OF_K
+                if constexpr (FP8_KV_CACHE)
+                {
+                    sink_q = kv_block_scaling ? q_sink : mul<Qk_vec_k, Tk, Qk_vec_k>(kv_scale_quant_orig, q_sink);
+                }
+#endif
+            }
+            reinterpret_cast<Qk_vec_k*>(&q_sink_smem[qk_vec_idx])[0] = sink_q;
+        }
+
         // Store the K values to shared memory.
         // We store K values from shared memory to global memory
         //  when the target position of K cache in global memory has been accessed (in the case of cyclic kv cache)
@@ -1767,7 +1915,7 @@ __global__ void masked_multihead_attention_kernel(
     constexpr unsigned UNROLLED_K_PER_ITER = K_PER_ITER * K_LOOP_UNROLL;
 
     // Base pointer for the row of pointers to k cache blocks
-    void** k_cache_base_row_ptr = reinterpret_cast<void**>(kvCacheBuffer.getRowPtr(KVIdxType::K_IDX, batch_beam_idx));
+    void** k_cache_base_row_ptr = reinterpret_cast<void**>(kvCacheBuffer.getRowPtr(KVIdxType::K_IDX, kv_row_idx));
 
     const auto timesteps_per_block = static_cast<unsigned>(params.timesteps_per_block);
 
@@ -1798,11 +1946,16 @@ __global__ void masked_multihead_attention_kernel(
     // Iterate over the keys/timesteps to compute the various (Q*K^T)_{ti} values.
     // Note max_attention_window_size is maximum of cyclic_attention_window_size among all layers.
     // By default, you can assume that they are the same.
-    const auto bi_seq_len_offset = static_cast<std::size_t>(batch_beam_idx) * params.max_attention_window_size;
+    // The block cache indirection has 1 + tokens_per_block entries per beam, see cache_indir_beam.
+    const int indir_tokens_per_block = params.cache_indir_tokens_per_block;
+    const auto bi_seq_len_offset = static_cast<std::size_t>(batch_beam_idx)
+        * (indir_tokens_per_block > 0 ? indir_tokens_per_block + 1 : params.max_attention_window_size);
     // Beam indices are based on the max_attention_window_size while each layer may have different
     // cyclic_attention_window_size So we need to rebuild the beam_indices if max_attention_window_size is not equal to
     // cyclic_attention_window_size.
     const int* beam_indices = HAS_BEAMS ? &params.cache_indir[bi_seq_len_offset] : nullptr;
+    const int indir_tail_start
+        = indir_tokens_per_block > 0 ? tlength / indir_tokens_per_block * indir_tokens_per_block : 0;
 
     const auto c_tile_times_timesteps_per_block = c_tile * timesteps_per_block; // 0 if !MULTI_BLOCK_FLAG
 
@@ -1829,10 +1982,19 @@ __global__ void masked_multihead_attention_kernel(
 
         // The keys loaded from the key cache.
         K_vec_m k_vec_cache[K_LOOP_UNROLL][K_VECS_PER_THREAD];
+        // The dequantization scales of the keys.
+        float k_scale_cache[K_LOOP_UNROLL];
 
 #pragma unroll
         for (int k_loop = 0; k_loop < K_LOOP_UNROLL; ++k_loop)
         {
+            k_scale_cache[k_loop] = kv_scale_quant_orig_f;
+            if (kv_block_scaling)
+            {
+                const int valid_time_now = min(time_now + k_loop * K_PER_ITER, context_length - 1);
+                k_scale_cache[k_loop] = *kvCacheBuffer.getBlockScalePtr(
+                    kvCacheBuffer.getKBlockPtr(shared_kv_row_idx, valid_time_now), hi_kv, num_heads_kv, Dh);
+            }
 #pragma unroll
             for (int k_vec_i = 0; k_vec_i < K_VECS_PER_THREAD; ++k_vec_i)
             {
@@ -1841,7 +2003,7 @@ __global__ void masked_multihead_attention_kernel(
                 // Seq OOB values will be masked out when storing back to smem.
                 auto const jj = min(k_idx.y + k_vec_i * K_ELTS_PER_CHUNK, Dh - K_VEC_SIZE);
                 const int valid_time_now = min(time_now + k_loop * K_PER_ITER, context_length - 1);
-                const int seqIdx = batch_idx * beam_width;
+                const int seqIdx = shared_kv_row_idx;
 
                 // Base pointer to k cache block for beam's batch
                 Tcache* k_cache_batch = reinterpret_cast<Tcache*>(kvCacheBuffer.getKBlockPtr(seqIdx, valid_time_now));
@@ -1907,13 +2069,17 @@ __global__ void masked_multihead_attention_kernel(
             if constexpr (FP8_KV_CACHE)
             {
                 qk_ = Qk_dot<T, THREADS_PER_KEY>::dot(q_vec, k_vec) * params.inv_sqrt_dh;
+                if (kv_block_scaling)
+                {
+                    qk_ *= k_scale_cache[k_loop];
+                }
             }
             else
 #endif // MMHA_FP8_SCALE_Q_INSTEAD_OF_K
             {
                 if constexpr (ENABLE_8BITS_CACHE)
                 {
-                    qk_ = Qk_dot<T, THREADS_PER_KEY>::scale_dot(q_vec, k_vec, kv_scale_quant_orig_f)
+                    qk_ = Qk_dot<T, THREADS_PER_KEY>::scale_dot(q_vec, k_vec, k_scale_cache[k_loop])
                         * params.inv_sqrt_dh;
                 }
                 else
@@ -1940,10 +2106,35 @@ __global__ void masked_multihead_attention_kernel(
             // All the threads do the work even if it's not relevant to avoid divergence.
             qk_ += linear_bias_slope * (local_time_now - tlength) + relative_attention_bias;
 
+            // The slot holds the latest token that was written to it, i.e. the one at
+            // local_time_now + k * cyclic_window_len right below tlength, or the sink token of the slot.
+            const int local_token_pos = local_time_now < sink_token_len
+                ? local_time_now
+                : local_time_now + (tlength - 1 - local_time_now) / cyclic_window_len * cyclic_window_len;
+            // Mask the keys of the ring that slid out of the attention window.
+            const bool is_out_of_window
+                = sliding_window_kv_cache && local_token_pos < tlength - params.cyclic_attention_window_size;
+            // Mask the keys outside of the block-sparse pattern.
+            const bool is_block_sparse_masked = params.block_sparse_attention
+                && !params.block_sparse_params.computeMask(tlength, local_token_pos, hi);
+            // With block scaling, the new key was appended before the kernel ran, over the oldest key of a full cache.
+            const bool is_overwritten = kv_block_scaling && tlength >= static_cast<int>(cyclic_kv_cache_len)
+                && local_time_now == cyclic_tlength;
+
             // There's one qk value per timestep.
             // Make sure only leader threads stores qk value within the bound.
             if (is_active && is_leader)
             {
+                // The sink keys are scored by the loop that follows.
+                if (shift_sink_positions && local_time_now < sink_token_len)
+                {
+                    continue;
+                }
+                if (is_out_of_window || is_block_sparse_masked || is_overwritten)
+                {
+                    qk_smem[local_ti] = -FLT_MAX;
+                    continue;
+                }
                 // Calculate the max for softmax.
                 qk_max = fmaxf(qk_max, qk_);
                 // Store the product to shared memory.
@@ -1952,6 +2143,68 @@ __global__ void masked_multihead_attention_kernel(
         }
     }
 
+    // Score the sink keys with their query, see shift_sink_positions.
+    if (shift_sink_positions)
+    {
+        K_vec_accum q_sink_vec[K_VECS_PER_THREAD];
+#pragma unroll
+        for (unsigned ii = 0; ii < K_VECS_PER_THREAD; ++ii)
+        {
+            q_sink_vec[ii] = vec_conversion<K_vec_accum, K_vec_k>(*reinterpret_cast<const K_vec_k*>(
+                &q_sink_smem[tensorrt_llm::common::flat_index2(ii, k_idx.y, K_ELTS_PER_CHUNK)]));
+        }
+
+        // The number of sink keys in the timesteps of this block.
+        const int sink_ti_count = min(sink_token_len - static_cast<int>(c_tile_times_timesteps_per_block),
+            MULTI_BLOCK_FLAG ? static_cast<int>(timesteps_per_block) : sink_token_len);
+        const auto sink_ti_end
+            = sink_ti_count > 0 ? divUp(static_cast<unsigned>(sink_ti_count), K_PER_WARP) * K_PER_WARP : 0u;
+        for (int ti = k_idx.x; ti < sink_ti_end; ti += K_PER_ITER)
+        {
+            const int time_now = MULTI_BLOCK_FLAG ? ti + c_tile_times_timesteps_per_block : ti;
+            const int valid_time_now = min(time_now, sink_token_len - 1);
+
+            // The keys loaded from the key cache.
+            K_vec_m k_vec[K_VECS_PER_THREAD];
+            Tcache* k_cache_batch
+                = reinterpret_cast<Tcache*>(kvCacheBuffer.getKBlockPtr(shared_kv_row_idx, valid_time_now));
+#pragma unroll
+            for (int k_vec_i = 0; k_vec_i < K_VECS_PER_THREAD; ++k_vec_i)
+            {
+                const int jj = min(k_idx.y + k_vec_i * K_ELTS_PER_CHUNK, Dh - K_VEC_SIZE);
+                const int inBlockIdx = kvCacheBuffer.getKVLocalIdx(valid_time_now, hi_kv, Dh, jj);
+                k_vec[k_vec_i] = *reinterpret_cast<const K_vec_m*>(&k_cache_batch[inBlockIdx]);
+            }
+
+            // WARNING: ALL THE THREADS OF A WARP MUST ENTER!!!
+            float qk_ = 0.f;
+#ifdef MMHA_FP8_SCALE_Q_INSTEAD_OF_K
+            if constexpr (FP8_KV_CACHE)
+            {
+                qk_ = Qk_dot<T, THREADS_PER_KEY>::dot(q_sink_vec, k_vec) * params.inv_sqrt_dh;
+            }
+            else
+#endif // MMHA_FP8_SCALE_Q_INSTEAD_OF_K
+            {
+                if constexpr (ENABLE_8BITS_CACHE)
+                {
+                    qk_ = Qk_dot<T, THREADS_PER_KEY>::scale_dot(q_sink_vec, k_vec, kv_scale_quant_orig_f)
+                        * params.inv_sqrt_dh;
+                }
+                else
+                {
+                    qk_ = Qk_dot<T, THREADS_PER_KEY>::dot(q_sink_vec, k_vec) * params.inv_sqrt_dh;
+                }
+            }
+
+            if (ti < sink_ti_count && is_leader)
+            {
+                qk_max = fmaxf(qk_max, qk_);
+                qk_smem[ti] = qk_;
+            }
+        }
+    }
+
     // Handle generation key cache with beam searching.
     // Note that it may be overlapped with the context key loop, but it won't impact the corretness.
     // Can skip in cross attention mode.
@@ -1976,7 +2229,8 @@ __global__ void masked_multihead_attention_kernel(
             {
                 const int jj = min(k_idx.y + k_vec_i * K_ELTS_PER_CHUNK, Dh - K_VEC_SIZE);
                 const int valid_time_now = min(time_now, kv_loop_length - 1);
-                int beam_offset = beam_indices[valid_time_now];
+                int beam_offset
+                    = cache_indir_beam(beam_indices, valid_time_now, indir_tokens_per_block, indir_tail_start);
                 const int seqIdx = batch_idx * beam_width + beam_offset;
                 // Base pointer to k cache block for beam's batch, before offsetting with indirection buffer
                 Tcache* k_cache_batch = reinterpret_cast<Tcache*>(kvCacheBuffer.getKBlockPtr(seqIdx, valid_time_now));
@@ -1985,6 +2239,17 @@ __global__ void masked_multihead_attention_kernel(
                 k_vec[k_vec_i] = (*reinterpret_cast<const K_vec_m*>(&k_cache_batch[inBlockIdx]));
             }
 
+            float k_scale = kv_scale_quant_orig_f;
+            if (kv_block_scaling)
+            {
+                const int valid_time_now = min(time_now, kv_loop_length - 1);
+                const int beam_offset
+                    = cache_indir_beam(beam_indices, valid_time_now, indir_tokens_per_block, indir_tail_start);
+                k_scale = *kvCacheBuffer.getBlockScalePtr(
+                    kvCacheBuffer.getKBlockPtr(batch_idx * beam_width + beam_offset, valid_time_now), hi_kv,
+                    num_heads_kv, Dh);
+            }
+
             // Is it active?
             const bool is_active = time_now >= context_length && time_now < kv_loop_length;
 
@@ -2027,14 +2292,17 @@ __global__ void masked_multihead_attention_kernel(
             if constexpr (FP8_KV_CACHE)
             {
                 qk_ = Qk_dot<T, THREADS_PER_KEY>::dot(q_vec, k_vec) * params.inv_sqrt_dh;
+                if (kv_block_scaling)
+                {
+                    qk_ *= k_scale;
+                }
             }
             else
 #endif // MMHA_FP8_SCALE_Q_INSTEAD_OF_K
             {
                 if constexpr (ENABLE_8BITS_CACHE)
                 {
-                    qk_ = Qk_dot<T, THREADS_PER_KEY>::scale_dot(q_vec, k_vec, kv_scale_quant_orig_f)
-                        * params.inv_sqrt_dh;
+                    qk_ = Qk_dot<T, THREADS_PER_KEY>::scale_dot(q_vec, k_vec, k_scale) * params.inv_sqrt_dh;
                 }
                 else
                 {
@@ -2053,10 +2321,26 @@ __global__ void masked_multihead_attention_kernel(
             // All the threads perform that step to avoid divergence.
             qk_ += linear_bias_slope * (time_now - tlength) + relative_attention_bias;
 
+            // Mask the keys outside of the block-sparse pattern (see the context loop for the token position).
+            const bool is_block_sparse_masked = params.block_sparse_attention
+                && !params.block_sparse_params.computeMask(tlength,
+                    time_now
+                        + (tlength - 1 - time_now) / static_cast<int>(cyclic_kv_cache_len)
+                            * static_cast<int>(cyclic_kv_cache_len),
+                    hi);
+            // See the context loop.
+            const bool is_overwritten = kv_block_scaling && tlength >= static_cast<int>(cyclic_kv_cache_len)
+                && time_now == cyclic_tlength;
+
             // There's one qk value per timestep.
             // Make sure only leader threads stores qk value within the bound.
             if (is_active && is_leader)
             {
+                if (is_block_sparse_masked || is_overwritten)
+                {
+                    qk_smem[ti] = -FLT_MAX;
+                    continue;
+                }
                 // Calculate the max for softmax.
                 qk_max = fmaxf(qk_max, qk_);
                 // Store the product to shared memory.
@@ -2116,8 +2400,9 @@ __global__ void masked_multihead_attention_kernel(
     // more loads) + the stores are really "write and forget" since we won't need the ack before
     // the end of the kernel. There's plenty of time for the transactions to complete.
 
-    // For MQA/GQA mode, write only with the first Q head of each group per KV head.
-    if (HANDLE_KV && hi == (hi_kv * qhead_per_kv) && qk_vec_idx < Dh)
+    // For MQA/GQA mode, write only with the first Q head of each group per KV head. With block scaling, the key is
+    // already in the cache.
+    if (HANDLE_KV && hi == (hi_kv * qhead_per_kv) && qk_vec_idx < Dh && !kv_block_scaling)
     {
         // Trigger the stores to global memory.
         Qk_vec_k k_vec = *reinterpret_cast<Qk_vec_k*>(&k_smem[qk_vec_idx]);
@@ -2129,6 +2414,10 @@ __global__ void masked_multihead_attention_kernel(
         if constexpr (ENABLE_8BITS_CACHE)
         {
             store_8bits_kv_cache_vec(reinterpret_cast<Tcache*>(k_cache), k_vec, inBlockIdx, kv_scale_orig_quant);
+            if (kv_abs_max != nullptr)
+            {
+                update_kv_abs_max<T>(kv_abs_max, k_vec);
+            }
         }
         else
         {
@@ -2187,9 +2476,12 @@ __global__ void masked_multihead_attention_kernel(
 
 // Normalize the logits.
 #ifdef MMHA_FP8_SCALE_P_INSTEAD_OF_V
-    float logit_scale = (FP8_KV_CACHE ? kv_scale_quant_orig_f : 1.0f);
+    float logit_scale = (FP8_KV_CACHE && !kv_block_scaling ? kv_scale_quant_orig_f : 1.0f);
+    // The per-tensor V scale is folded into the logits.
+    const float v_fma_scale = (FP8_KV_CACHE ? 1.0f : kv_scale_quant_orig_f);
 #else
     float logit_scale = 1.f;
+    const float v_fma_scale = kv_scale_quant_orig_f;
 #endif // MMHA_FP8_SCALE_P_INSTEAD_OF_V
     float inv_sum = __fdividef(logit_scale, sum + 1.e-6f);
 
@@ -2225,11 +2517,11 @@ __global__ void masked_multihead_attention_kernel(
     // The hidden dimensions computed by this particular thread.
     const auto vi = v_idx.y;
     // Base pointer for the row of pointers to v cache blocks
-    void** v_cache_base_row_ptr = reinterpret_cast<void**>(kvCacheBuffer.getRowPtr(KVIdxType::V_IDX, batch_beam_idx));
+    void** v_cache_base_row_ptr = reinterpret_cast<void**>(kvCacheBuffer.getRowPtr(KVIdxType::V_IDX, kv_row_idx));
     // Base pointer for the row of pointers to v cache blocks for beam's batch, before offsetting with indirection
     // buffer
     void** v_cache_batch_row_ptr
-        = reinterpret_cast<void**>(kvCacheBuffer.getRowPtr(KVIdxType::V_IDX, batch_idx * beam_width));
+        = reinterpret_cast<void**>(kvCacheBuffer.getRowPtr(KVIdxType::V_IDX, shared_kv_row_idx));
 
     // The number of values processed per iteration of the loop.
     constexpr unsigned V_PER_ITER{THREADS_PER_BLOCK / THREADS_PER_VALUE};
@@ -2287,19 +2579,23 @@ __global__ void masked_multihead_attention_kernel(
         for (int ti = vo; ti < context_v_loop_end; ti += UNROLLED_V_PER_ITER)
         {
             V_vec_m v_vec_cache[V_LOOP_UNROLL];
+            float v_scale_cache[V_LOOP_UNROLL];
 #pragma unroll
             for (int v_loop = 0; v_loop < V_LOOP_UNROLL; v_loop++)
             {
                 // Fetch offset based on cache_indir when beam sampling
                 int time_idx = ti + v_loop * V_PER_ITER + (MULTI_BLOCK_FLAG ? c_tile_times_timesteps_per_block : 0);
                 time_idx = min(time_idx, kv_loop_length - 1);
-                int rowIdx = batch_idx * beam_width;
+                int rowIdx = shared_kv_row_idx;
 
                 const int inBlockIdx = kvCacheBuffer.getKVLocalIdx(time_idx, hi_kv, Dh, vi);
                 // The base pointer for the value in the cache buffer.
                 Tcache* v_cache_batch = reinterpret_cast<Tcache*>(kvCacheBuffer.getVBlockPtr(rowIdx, time_idx));
 
                 v_vec_cache[v_loop] = *reinterpret_cast<const V_vec_m*>(&v_cache_batch[inBlockIdx]);
+                v_scale_cache[v_loop] = kv_block_scaling
+                    ? *kvCacheBuffer.getBlockScalePtr(v_cache_batch, hi_kv, num_heads_kv, Dh)
+                    : v_fma_scale;
             }
 
 #pragma unroll
@@ -2316,7 +2612,7 @@ __global__ void masked_multihead_attention_kernel(
                 // Load the logits from shared memory.
                 // Note that fma will convert 8bit vec to the accumulation data type (float by default).
                 Logit_value_fma<Tk, V_vec_accum, V_vec_m, INT8_KV_CACHE, FP8_KV_CACHE>(
-                    out, reinterpret_cast<Tk*>(logits_smem + local_time_idx), v_vec, kv_scale_quant_orig_f, is_mask);
+                    out, reinterpret_cast<Tk*>(logits_smem + local_time_idx), v_vec, v_scale_cache[v_loop], is_mask);
             }
         }
 
@@ -2337,17 +2633,21 @@ __global__ void masked_multihead_attention_kernel(
                     {
                         continue;
                     }
-                    int rowIdx = batch_idx * beam_width + beam_indices[time_idx];
+                    int rowIdx = batch_idx * beam_width
+                        + cache_indir_beam(beam_indices, time_idx, indir_tokens_per_block, indir_tail_start);
 
                     const int inBlockIdx = kvCacheBuffer.getKVLocalIdx(time_idx, hi_kv, Dh, vi);
                     // The base pointer for the value in the cache buffer.
                     Tcache* v_cache_batch = reinterpret_cast<Tcache*>(kvCacheBuffer.getVBlockPtr(rowIdx, time_idx));
                     V_vec_m v_vec = reinterpret_cast<const V_vec_m*>(&v_cache_batch[inBlockIdx])[0];
+                    const float v_scale = kv_block_scaling
+                        ? *kvCacheBuffer.getBlockScalePtr(v_cache_batch, hi_kv, num_heads_kv, Dh)
+                        : v_fma_scale;
 
                     // Load the logits from shared memory.
                     // Note that fma will convert 8bit vec to the accumulation data type (float by default).
                     Logit_value_fma<Tk, V_vec_accum, V_vec_m, INT8_KV_CACHE, FP8_KV_CACHE>(
-                        out, reinterpret_cast<Tk*>(logits_smem + local_time_idx), v_vec, kv_scale_quant_orig_f, false);
+                        out, reinterpret_cast<Tk*>(logits_smem + local_time_idx), v_vec, v_scale, false);
                 }
             }
         }
@@ -2411,12 +2711,17 @@ __global__ void masked_multihead_attention_kernel(
 
         // Store the values with bias back to global memory in the cache for V.
         //*reinterpret_cast<V_vec_k*>(&v_cache[params.timestep*Dh]) = v;
-        // For MQA/GQA mode, write only with the first Q head of each group per KV head.
-        if (hi == (hi_kv * qhead_per_kv))
+        // For MQA/GQA mode, write only with the first Q head of each group per KV head. With block scaling, the value
+        // is already in the cache.
+        if (hi == (hi_kv * qhead_per_kv) && !kv_block_scaling)
         {
             if (ENABLE_8BITS_CACHE)
             {
                 store_8bits_kv_cache_vec(v_cache_base, v, inBlockIdx, kv_scale_orig_quant);
+                if (kv_abs_max != nullptr)
+                {
+                    update_kv_abs_max<T>(kv_abs_max, v);
+                }
             }
             else
             {
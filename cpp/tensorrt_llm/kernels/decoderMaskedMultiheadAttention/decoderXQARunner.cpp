@@ -275,12 +275,7 @@ public:
         }
         int num_kv_heads = xqaParams.num_kv_heads;
         int batch_size = static_cast<int>(xqaParams.batch_size);
-        int multi_block_count = 1;
-        if (xqaParams.multi_block_mode)
-        {
-            int history_length = xqaParams.timestep;
-            multi_block_count = history_length / kMinHistoryTokensPerBlock;
-        }
+        int multi_block_count = std::max(xqaParams.timestep / kMinHistoryTokensPerBlock, 1);
         int block_count = num_kv_heads * batch_size * multi_block_count;
         static constexpr float kEnableMinBlockFactor = 4.0;
         return static_cast<float>(block_count) * kEnableMinBlockFactor >= static_cast<float>(multiprocessor_count);
@@ -327,14 +322,9 @@ public:
             void* kernelParams[]
                 = {&launchParams.num_k_heads, &launchParams.output, &launchParams.qkv, &launchParams.cacheList,
                     &launchParams.batch_size, &launchParams.kv_scale_quant_orig, &launchParams.scratch, nullptr};
-            int multi_block = 1;
-            if (xqaParams.multi_block_mode)
-            {
-                multi_block
-                    = computeMultiBlockCount(xqaParams, micro_batch_size, multiprocessor_count, max_multi_block_slots);
-                cudaMemsetAsync(
-                    launchParams.scratch, 0, sizeof(int) * micro_batch_size * xqaParams.num_kv_heads, stream);
-            }
+            int const multi_block = computeMultiBlockCount(
+                xqaParams, start_batch_idx, micro_batch_size, multiprocessor_count, max_multi_block_slots);
+            cudaMemsetAsync(launchParams.scratch, 0, sizeof(int) * micro_batch_size * xqaParams.num_kv_heads, stream);
             cuErrCheck(mDriver.cuLaunchKernel(func, multi_block, xqaParams.num_kv_heads, micro_batch_size, 128, 1, 2,
                            shared_mem_bytes, stream, kernelParams, nullptr),
                 mDriver);
@@ -344,13 +334,27 @@ public:
 
     static constexpr int kMinHistoryTokensPerBlock = 512;
 
-    static int computeMultiBlockCount(
-        const XQAParams& xqaParams, int micro_batchsize, int multiprocessor_count, int max_multi_block_slots)
+    // Chooses the number of CTAs per KV head of one micro batch. Splitting the KV only pays off when the
+    // micro_batchsize * num_kv_heads CTAs do not already occupy all SMs, and each split needs enough history to
+    // amortize the reduction of the partial results.
+    static int computeMultiBlockCount(const XQAParams& xqaParams, int start_batch_idx, int micro_batchsize,
+        int multiprocessor_count, int max_multi_block_slots)
     {
         static constexpr int kTargetWaveFactor = 8;
         int multi_block_count = 1;
         int num_kv_heads = xqaParams.num_kv_heads;
+        if (micro_batchsize * num_kv_heads >= multiprocessor_count)
+        {
+            return 1;
+        }
+
+        // The longest sequence of the micro batch bounds the useful split.
         int history_length = xqaParams.timestep;
+        if (xqaParams.host_context_lengths == nullptr)
+        {
+            history_length = *std::max_element(xqaParams.host_past_key_value_lengths + start_batch_idx,
+                xqaParams.host_past_key_value_lengths + start_batch_idx + micro_batchsize);
+        }
 
         multi_block_count = history_length / kMinHistoryTokensPerBlock;
         multi_block_count = std::max(multi_block_count, 1);
@@ -372,6 +376,7 @@ public:
         }
         // add limitation on upper bound.
         multi_block_count = std::min(multiprocessor_count, multi_block_count);
+        multi_block_count = std::max(multi_block_count, 1);
 
         TLLM_CHECK_WITH_INFO(multi_block_count >= 1, "MultiBlock count should be larger than 1");
         return multi_block_count;
@@ -423,6 +428,9 @@ public:
     {
         int device_id = tensorrt_llm::common::getDevice();
         static std::unique_ptr<XQAKernelLoader> s_factory[32] = {nullptr};
+        // The kernels can be loaded by the plugin warmup threads while the engine is deserialized
+        static std::mutex s_mutex;
+        std::lock_guard<std::mutex> lg(s_mutex);
         if (s_factory[device_id] == nullptr)
         {
             assert(device_id <= 32);
@@ -486,19 +494,22 @@ void DecoderXQARunner::xqaImpl::run(const XQAParams& xqa_params, KVLinearBuffer&
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-DecoderXQARunner::DecoderXQARunner(
-    const XQADataType data_type, int num_heads, int num_kv_heads, int head_size, bool multi_block_mode)
+DecoderXQARunner::DecoderXQARunner(const XQADataType data_type, int num_heads, int num_kv_heads, int head_size)
     : pimpl(new xqaImpl(data_type, tensorrt_llm::common::getSMVersion()))
     , mNumHeads(num_heads)
     , mNumKVHeads(num_kv_heads)
     , mHeadSize(head_size)
-    , mMultiBlockMode(multi_block_mode)
 {
     mMultiProcessorCount = tensorrt_llm::common::getMultiProcessorCount();
 }
 
 DecoderXQARunner::~DecoderXQARunner() = default;
 
+void DecoderXQARunner::loadKernels(const XQADataType data_type, int sm)
+{
+    getXQAKernels(data_type, sm);
+}
+
 namespace
 {
 
@@ -518,22 +529,17 @@ constexpr inline T roundUp(T a, T b)
 
 size_t DecoderXQARunner::getWorkspaceSize()
 {
-    size_t workspace_size = 0;
-    if (mMultiBlockMode)
-    {
-        int workspaces[4];
-        const int max_num_request = kMaxBeamWidth * XQALaunchParam<true>::GetMaxBatchSizePerWave(mMultiProcessorCount);
-        uint32_t const nbSeq = mNumKVHeads * max_num_request;
-        uint32_t const nbSubSeq = kMaxNbCtaPerKVHeadFactor * nbSeq;
-        int group_size = mNumHeads / mNumKVHeads;
-        workspaces[0] = sizeof(uint32_t) * nbSeq;
-        workspaces[1] = sizeof(float) * roundUp(group_size, 32) * nbSubSeq;
-        workspaces[2] = sizeof(float) * roundUp(group_size, 32) * nbSubSeq;
-        workspaces[3] = sizeof(__half) * group_size * mHeadSize * nbSubSeq;
-        workspace_size = roundUp(workspaces[0], 128) + roundUp(workspaces[1], 128) + roundUp(workspaces[2], 128)
-            + roundUp(workspaces[3], 128);
-    }
-    return workspace_size;
+    int workspaces[4];
+    const int max_num_request = kMaxBeamWidth * XQALaunchParam<true>::GetMaxBatchSizePerWave(mMultiProcessorCount);
+    uint32_t const nbSeq = mNumKVHeads * max_num_request;
+    uint32_t const nbSubSeq = kMaxNbCtaPerKVHeadFactor * nbSeq;
+    int group_size = mNumHeads / mNumKVHeads;
+    workspaces[0] = sizeof(uint32_t) * nbSeq;
+    workspaces[1] = sizeof(float) * roundUp(group_size, 32) * nbSubSeq;
+    workspaces[2] = sizeof(float) * roundUp(group_size, 32) * nbSubSeq;
+    workspaces[3] = sizeof(__half) * group_size * mHeadSize * nbSubSeq;
+    return roundUp(workspaces[0], 128) + roundUp(workspaces[1], 128) + roundUp(workspaces[2], 128)
+        + roundUp(workspaces[3], 128);
 }
 
 bool DecoderXQARunner::shouldUseImpl(const XQAParams& xqaParams)
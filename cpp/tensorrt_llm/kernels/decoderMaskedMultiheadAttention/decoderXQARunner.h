@@ -92,7 +92,7 @@ struct XQAParams
     bool qkv_bias_enabled;
     bool cross_attention;
     int max_distance = 0;
-    bool multi_block_mode;
+    int32_t sink_token_length = 0;
 };
 
 #define SUPPORT_RETURN_FALSE(X)                                                                                        \
@@ -103,10 +103,14 @@ struct XQAParams
 class DecoderXQARunner
 {
 public:
-    DecoderXQARunner(
-        const XQADataType data_type, int num_heads, int num_kv_heads, int head_size, bool multi_block_mode);
+    // The number of CTAs per KV head (multi-block / split-KV mode) is chosen at every step from the batch size, the
+    // number of KV heads and the history length, so the workspace for the partial results is always reserved.
+    DecoderXQARunner(const XQADataType data_type, int num_heads, int num_kv_heads, int head_size);
     ~DecoderXQARunner();
 
+    // Loads the cubins of the kernels for the current device ahead of the first runner, which then finds them loaded.
+    static void loadKernels(const XQADataType data_type, int sm);
+
     template <typename T>
     bool shouldUse(const XQAParams& xqaParams)
     {
@@ -123,18 +127,23 @@ public:
             SUPPORT_RETURN_FALSE("unidirectional");
         if (xqaParams.q_scaling != 1.0f)
             SUPPORT_RETURN_FALSE("q_scaling");
-        if (xqaParams.rotary_embedding_dim != xqaParams.head_size)
-            SUPPORT_RETURN_FALSE("rotary_embedding_dim");
-        if (xqaParams.rotary_embedding_base != 10000.0f)
-            SUPPORT_RETURN_FALSE("rotary_embedding_base");
-        if (xqaParams.rotary_embedding_scale_type != tensorrt_llm::kernels::RotaryScalingType::kNONE)
-            SUPPORT_RETURN_FALSE("rotary_embedding_scale_type");
-        if (xqaParams.mask_type != tensorrt_llm::kernels::AttentionMaskType::CAUSAL)
+        // RoPE (any base, scaling and rotary dim) and the QKV bias are applied by invokeApplyBiasRopeUpdateKVCache
+        // before the XQA kernel runs, and a single generation token attends to its whole history whatever the mask
+        // type, except for the block-sparse mask. Biases added to the attention scores (ALiBi, relative attention)
+        // are not supported by the kernels.
+        if (xqaParams.mask_type == tensorrt_llm::kernels::AttentionMaskType::BLOCKSPARSE)
             SUPPORT_RETURN_FALSE("mask_type");
+        if (xqaParams.position_embedding_type == tensorrt_llm::kernels::PositionEmbeddingType::kALIBI
+            || xqaParams.position_embedding_type == tensorrt_llm::kernels::PositionEmbeddingType::kALIBI_WITH_SCALE
+            || xqaParams.position_embedding_type == tensorrt_llm::kernels::PositionEmbeddingType::kRELATIVE)
+            SUPPORT_RETURN_FALSE("position_embedding_type");
         if (xqaParams.paged_kv_cache)
             SUPPORT_RETURN_FALSE("paged_kv_cache");
-        if (xqaParams.qkv_bias_enabled)
-            SUPPORT_RETURN_FALSE("qkv_bias_enabled");
+        if (xqaParams.kv_cache_quant_mode.hasKvCacheBlockScaling())
+            SUPPORT_RETURN_FALSE("kv_cache_block_scaling");
+        // The precompiled kernels do not collect the absmax of the keys and values they write to the cache.
+        if (xqaParams.kv_cache_quant_mode.hasKvCacheOnlineScaling())
+            SUPPORT_RETURN_FALSE("kv_cache_online_scaling");
         if (xqaParams.cross_attention)
             SUPPORT_RETURN_FALSE("cross_attention");
 
@@ -144,6 +153,8 @@ public:
             SUPPORT_RETURN_FALSE("beam_width");
         if (xqaParams.cyclic_attention_window_size != xqaParams.max_attention_window_size)
             SUPPORT_RETURN_FALSE("cyclic_attention_window_size != max_attention_window_size");
+        if (xqaParams.sink_token_length > 0)
+            SUPPORT_RETURN_FALSE("sink_token_length");
         return shouldUseImpl(xqaParams);
     }
 
@@ -188,7 +199,6 @@ private:
     int mNumHeads;
     int mNumKVHeads;
     int mHeadSize;
-    bool mMultiBlockMode;
     int mMultiProcessorCount;
 };
 
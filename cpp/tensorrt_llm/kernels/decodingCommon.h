@@ -160,6 +160,32 @@ void invokeCurandInitialize(curandState_t* state, const size_t batchSize, uint64
 void invokeCurandBatchInitialize(
     curandState_t* states, const size_t batchSize, const uint64_t* randomSeeds, cudaStream_t stream);
 
+#ifdef __CUDACC__
+//! \brief Returns the uniform random number in (0, 1] a sampling kernel draws for the token at position step of the
+//! request in batch slot batchIdx.
+//! Without randomSeeds, it is drawn from the curand state of the slot, so it depends on the slot and on how many
+//! numbers were drawn from it before. With randomSeeds, it is computed by the counter-based Philox generator keyed on
+//! the seed of the request and the position, so a request samples the same tokens however it is batched and no
+//! random states are kept.
+//!
+//! \param curandStates input/output buffer [batchSize]. Curand states. Ignored if randomSeeds is not nullptr
+//! \param randomSeeds input buffer [batchSize]. Seeds of the requests for counter-based sampling. Ignored if nullptr
+//! \param batchIdx batch slot of the request
+//! \param step position of the sampled token in the sequence
+__device__ __forceinline__ float drawSamplingUniform(
+    curandState_t* curandStates, const uint64_t* randomSeeds, const int batchIdx, const int step)
+{
+    if (randomSeeds != nullptr)
+    {
+        // Each position uses its own Philox subsequence, setting it up only adds to the counter
+        curandStatePhilox4_32_10_t state;
+        curand_init(randomSeeds[batchIdx], step, 0, &state);
+        return curand_uniform(&state);
+    }
+    return curand_uniform(curandStates + batchIdx);
+}
+#endif
+
 //! \brief Applies mask, adds bias to logits and computes softmax values.
 //! Sets -MAX_FLT value for tokens in range [vocabSize; vocabSizePadded) to prevent them from being chosen.
 //! If request finished the generation, sets MAX_FLT to endId token and -MAX_FLT to all other tokens forcing to choose
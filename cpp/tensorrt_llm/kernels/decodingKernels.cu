@@ -14,6 +14,14 @@
  * limitations under the License.
  */
 
+#ifndef CUDART_VERSION
+#error CUDART_VERSION Undefined!
+#elif (CUDART_VERSION >= 11050)
+#include <cub/cub.cuh>
+#else
+#include "3rdparty/cub/cub.cuh"
+#endif
+
 #include "tensorrt_llm/common/assert.h"
 #include "tensorrt_llm/common/cudaTypeUtils.cuh"
 #include "tensorrt_llm/common/cudaUtils.h"
@@ -456,7 +464,11 @@ __global__ void copyNextStepIds(
     {
         const int batchIdx{index / beamWidth};
         const int beamIdx{index % beamWidth};
-        nextStepIds[index] = outputIdsPtr[batchIdx][beamIdx * maxSeqLen + sequenceLengths[index] - 1];
+        // Slots of a batch that have not been started yet have no tokens
+        if (sequenceLengths[index] > 0)
+        {
+            nextStepIds[index] = outputIdsPtr[batchIdx][beamIdx * maxSeqLen + sequenceLengths[index] - 1];
+        }
     }
 }
 
@@ -699,5 +711,295 @@ template void acceptDraftTokensByLogits(half* draftLogits, half* targetLogits, h
     int vocabSize, int vocabSizePadded, int maxDraftTokens, bool randomThreshold, float constantThreshold,
     cudaStream_t stream);
 
+template <typename T, int BLOCK_SIZE>
+__global__ void acceptDraftTokensByArgmaxKernel(int* targetIds, int* numsAcceptedTokens, const T* logits,
+    const int* logitsOffsets, const int* draftIds, const int* numsDraftTokens, int maxDraftTokens, int vocabSize,
+    int vocabSizePadded)
+{
+    using KeyValuePair = cub::KeyValuePair<int, float>;
+    using BlockReduce = cub::BlockReduce<KeyValuePair, BLOCK_SIZE>;
+    __shared__ typename BlockReduce::TempStorage tempStorage;
+    __shared__ bool accepted;
+
+    const auto batchIdx = blockIdx.x;
+    const auto numDraftTokens = numsDraftTokens[batchIdx];
+    const auto logitsBatch = logits + static_cast<size_t>(logitsOffsets[batchIdx]) * vocabSizePadded;
+
+    // Positions are verified in order, those after the first rejected draft token are skipped
+    for (int ti = 0; ti <= numDraftTokens; ++ti)
+    {
+        const auto logitsRow = logitsBatch + static_cast<size_t>(ti) * vocabSizePadded;
+        KeyValuePair threadMax{0, -FLT_MAX};
+        for (int vIdx = threadIdx.x; vIdx < vocabSize; vIdx += BLOCK_SIZE)
+        {
+            const auto logit = static_cast<float>(logitsRow[vIdx]);
+            if (logit > threadMax.value)
+            {
+                threadMax = {vIdx, logit};
+            }
+        }
+        const auto blockMax = BlockReduce(tempStorage).Reduce(threadMax, cub::ArgMax());
+
+        if (threadIdx.x == 0)
+        {
+            targetIds[batchIdx * (maxDraftTokens + 1) + ti] = blockMax.key;
+            accepted = ti < numDraftTokens && draftIds[batchIdx * maxDraftTokens + ti] == blockMax.key;
+            if (!accepted)
+            {
+                numsAcceptedTokens[batchIdx] = ti + 1;
+            }
+        }
+        __syncthreads();
+        const bool verifyNext = accepted;
+        // tempStorage and accepted are written again in the next iteration
+        __syncthreads();
+        if (!verifyNext)
+        {
+            break;
+        }
+    }
+}
+
+template <typename T>
+void invokeAcceptDraftTokensByArgmax(int* targetIds, int* numsAcceptedTokens, const T* logits,
+    const int* logitsOffsets, const int* draftIds, const int* numsDraftTokens, int batchSize, int maxDraftTokens,
+    int vocabSize, int vocabSizePadded, cudaStream_t stream)
+{
+    constexpr int BLOCK_SIZE = 1024;
+    dim3 block(BLOCK_SIZE);
+    dim3 grid(batchSize);
+    acceptDraftTokensByArgmaxKernel<T, BLOCK_SIZE><<<grid, block, 0, stream>>>(targetIds, numsAcceptedTokens, logits,
+        logitsOffsets, draftIds, numsDraftTokens, maxDraftTokens, vocabSize, vocabSizePadded);
+}
+
+template void invokeAcceptDraftTokensByArgmax(int* targetIds, int* numsAcceptedTokens, const float* logits,
+    const int* logitsOffsets, const int* draftIds, const int* numsDraftTokens, int batchSize, int maxDraftTokens,
+    int vocabSize, int vocabSizePadded, cudaStream_t stream);
+template void invokeAcceptDraftTokensByArgmax(int* targetIds, int* numsAcceptedTokens, const half* logits,
+    const int* logitsOffsets, const int* draftIds, const int* numsDraftTokens, int batchSize, int maxDraftTokens,
+    int vocabSize, int vocabSizePadded, cudaStream_t stream);
+
+template <typename T, int BLOCK_SIZE>
+__global__ void acceptTreeDraftTokensByArgmaxKernel(int** outputIdsPtr, int* sequenceLengths, FinishedState* finished,
+    int* acceptedPaths, int* numsAcceptedTokens, const T* logits, const int* draftIds, const int* treeParents,
+    const int* endIds, const uint32_t* sequenceLimitLength, int numNodes, int maxPathLen, int vocabSize,
+    int vocabSizePadded)
+{
+    using KeyValuePair = cub::KeyValuePair<int, float>;
+    using BlockReduce = cub::BlockReduce<KeyValuePair, BLOCK_SIZE>;
+    __shared__ typename BlockReduce::TempStorage tempStorage;
+    extern __shared__ int treeState[];
+    int* depths = treeState;               // [numNodes], depth of the accepted nodes, -1 for the others
+    int* targetIds = treeState + numNodes; // [numNodes], greedy token after each accepted node
+
+    const auto batchIdx = blockIdx.x;
+    if (finished[batchIdx].isFinished())
+    {
+        if (threadIdx.x == 0)
+        {
+            numsAcceptedTokens[batchIdx] = 0;
+        }
+        return;
+    }
+
+    for (int ni = threadIdx.x; ni < numNodes; ni += BLOCK_SIZE)
+    {
+        depths[ni] = ni == 0 ? 0 : -1;
+    }
+    __syncthreads();
+
+    const auto logitsBatch = logits + static_cast<size_t>(batchIdx) * numNodes * vocabSizePadded;
+    const auto draftIdsBatch = draftIds + batchIdx * numNodes;
+    // Parents come before their children, so a node is accepted or rejected by the time it is reached
+    for (int ni = 0; ni < numNodes; ++ni)
+    {
+        if (depths[ni] < 0)
+        {
+            continue;
+        }
+        const auto logitsRow = logitsBatch + static_cast<size_t>(ni) * vocabSizePadded;
+        KeyValuePair threadMax{0, -FLT_MAX};
+        for (int vIdx = threadIdx.x; vIdx < vocabSize; vIdx += BLOCK_SIZE)
+        {
+            const auto logit = static_cast<float>(logitsRow[vIdx]);
+            if (logit > threadMax.value)
+            {
+                threadMax = {vIdx, logit};
+            }
+        }
+        const auto blockMax = BlockReduce(tempStorage).Reduce(threadMax, cub::ArgMax());
+        if (threadIdx.x == 0)
+        {
+            targetIds[ni] = blockMax.key;
+        }
+        __syncthreads();
+        for (int ci = ni + 1 + threadIdx.x; ci < numNodes; ci += BLOCK_SIZE)
+        {
+            if (treeParents[ci] == ni && draftIdsBatch[ci] == targetIds[ni])
+            {
+                depths[ci] = depths[ni] + 1;
+            }
+        }
+        // tempStorage is written again in the next iteration
+        __syncthreads();
+    }
+
+    if (threadIdx.x == 0)
+    {
+        int lastNode = 0;
+        for (int ni = 1; ni < numNodes; ++ni)
+        {
+            if (depths[ni] > depths[lastNode])
+            {
+                lastNode = ni;
+            }
+        }
+        const int pathLen = min(depths[lastNode] + 1, maxPathLen);
+        auto path = acceptedPaths + batchIdx * maxPathLen;
+        for (int node = lastNode, pi = depths[lastNode]; pi >= 0; node = treeParents[node], --pi)
+        {
+            if (pi < maxPathLen)
+            {
+                path[pi] = node;
+            }
+        }
+
+        const int seqLen = sequenceLengths[batchIdx];
+        int numTokens = pathLen;
+        if (sequenceLimitLength != nullptr)
+        {
+            numTokens = max(0, min(numTokens, static_cast<int>(sequenceLimitLength[batchIdx]) - seqLen));
+        }
+        for (int ti = 0; ti < numTokens; ++ti)
+        {
+            const int token = ti + 1 < pathLen ? draftIdsBatch[path[ti + 1]] : targetIds[path[ti]];
+            outputIdsPtr[batchIdx][seqLen + ti] = token;
+            if (token == endIds[batchIdx])
+            {
+                // The sequence length does not include EOS
+                finished[batchIdx].setFinishedEOS();
+                numTokens = ti;
+                break;
+            }
+        }
+        sequenceLengths[batchIdx] = seqLen + numTokens;
+        numsAcceptedTokens[batchIdx] = numTokens;
+    }
+}
+
+template <typename T>
+void invokeAcceptTreeDraftTokensByArgmax(int** outputIdsPtr, int* sequenceLengths, FinishedState* finished,
+    int* acceptedPaths, int* numsAcceptedTokens, const T* logits, const int* draftIds, const int* treeParents,
+    const int* endIds, const uint32_t* sequenceLimitLength, int batchSize, int numNodes, int maxPathLen,
+    int vocabSize, int vocabSizePadded, cudaStream_t stream)
+{
+    constexpr int BLOCK_SIZE = 1024;
+    dim3 block(BLOCK_SIZE);
+    dim3 grid(batchSize);
+    const size_t smemSize = 2 * numNodes * sizeof(int);
+    acceptTreeDraftTokensByArgmaxKernel<T, BLOCK_SIZE><<<grid, block, smemSize, stream>>>(outputIdsPtr,
+        sequenceLengths, finished, acceptedPaths, numsAcceptedTokens, logits, draftIds, treeParents, endIds,
+        sequenceLimitLength, numNodes, maxPathLen, vocabSize, vocabSizePadded);
+}
+
+template void invokeAcceptTreeDraftTokensByArgmax(int** outputIdsPtr, int* sequenceLengths, FinishedState* finished,
+    int* acceptedPaths, int* numsAcceptedTokens, const float* logits, const int* draftIds, const int* treeParents,
+    const int* endIds, const uint32_t* sequenceLimitLength, int batchSize, int numNodes, int maxPathLen,
+    int vocabSize, int vocabSizePadded, cudaStream_t stream);
+template void invokeAcceptTreeDraftTokensByArgmax(int** outputIdsPtr, int* sequenceLengths, FinishedState* finished,
+    int* acceptedPaths, int* numsAcceptedTokens, const half* logits, const int* draftIds, const int* treeParents,
+    const int* endIds, const uint32_t* sequenceLimitLength, int batchSize, int numNodes, int maxPathLen,
+    int vocabSize, int vocabSizePadded, cudaStream_t stream);
+
+__global__ void buildTreeAttentionMaskKernel(int* mask, const int* treeParents, int numNodes)
+{
+    const int ni = blockIdx.x * blockDim.x + threadIdx.x;
+    if (ni >= numNodes)
+    {
+        return;
+    }
+    auto maskRow = mask + ni * numNodes;
+    for (int nj = 0; nj < numNodes; ++nj)
+    {
+        maskRow[nj] = 0;
+    }
+    for (int node = ni; node >= 0; node = treeParents[node])
+    {
+        maskRow[node] = 1;
+    }
+}
+
+void invokeBuildTreeAttentionMask(int* mask, const int* treeParents, int numNodes, cudaStream_t stream)
+{
+    dim3 block(min(numNodes, 256));
+    dim3 grid(divUp(numNodes, block.x));
+    buildTreeAttentionMaskKernel<<<grid, block, 0, stream>>>(mask, treeParents, numNodes);
+}
+
+template <typename T, typename KVCacheBuffer>
+__global__ void compactTreeKvCacheKernel(KVCacheBuffer kvCache, const int* acceptedPaths,
+    const int* numsAcceptedTokens, const int* pastKvLengths, int sizePerHead, int maxPathLen)
+{
+    extern __shared__ char compactBuffer[];
+    auto entries = reinterpret_cast<T*>(compactBuffer); // [maxPathLen, sizePerHead]
+
+    const int batchIdx = blockIdx.x;
+    const int headIdx = blockIdx.y;
+    const bool isValue = blockIdx.z == 1;
+    const int numNodes = numsAcceptedTokens[batchIdx];
+    const int pastKvLength = pastKvLengths[batchIdx];
+    const auto path = acceptedPaths + batchIdx * maxPathLen;
+
+    // A node can be moved onto the position of a later node of the path, so all of them are read first.
+    // Node 0 is always at its place.
+    for (int pi = 1; pi < numNodes; ++pi)
+    {
+        const int srcIdx = pastKvLength + path[pi];
+        const auto src = reinterpret_cast<const T*>(
+            isValue ? kvCache.getVBlockPtr(batchIdx, srcIdx) : kvCache.getKBlockPtr(batchIdx, srcIdx));
+        for (int ci = threadIdx.x; ci < sizePerHead; ci += blockDim.x)
+        {
+            entries[pi * sizePerHead + ci] = src[kvCache.getKVLocalIdx(srcIdx, headIdx, sizePerHead, ci)];
+        }
+    }
+    __syncthreads();
+    for (int pi = 1; pi < numNodes; ++pi)
+    {
+        const int dstIdx = pastKvLength + pi;
+        auto dst = reinterpret_cast<T*>(
+            isValue ? kvCache.getVBlockPtr(batchIdx, dstIdx) : kvCache.getKBlockPtr(batchIdx, dstIdx));
+        for (int ci = threadIdx.x; ci < sizePerHead; ci += blockDim.x)
+        {
+            dst[kvCache.getKVLocalIdx(dstIdx, headIdx, sizePerHead, ci)] = entries[pi * sizePerHead + ci];
+        }
+    }
+}
+
+template <typename T, typename KVCacheBuffer>
+void invokeCompactTreeKvCache(KVCacheBuffer kvCache, const int* acceptedPaths, const int* numsAcceptedTokens,
+    const int* pastKvLengths, int batchSize, int numKvHeads, int sizePerHead, int maxPathLen, cudaStream_t stream)
+{
+    dim3 block(min(sizePerHead, 256));
+    dim3 grid(batchSize, numKvHeads, 2);
+    const size_t smemSize = static_cast<size_t>(maxPathLen) * sizePerHead * sizeof(T);
+    compactTreeKvCacheKernel<T, KVCacheBuffer><<<grid, block, smemSize, stream>>>(
+        kvCache, acceptedPaths, numsAcceptedTokens, pastKvLengths, sizePerHead, maxPathLen);
+}
+
+#define INSTANTIATE_COMPACT_TREE_KV_CACHE(T, KVCacheBuffer)                                                            \
+    template void invokeCompactTreeKvCache<T, KVCacheBuffer>(KVCacheBuffer kvCache, const int* acceptedPaths,         \
+        const int* numsAcceptedTokens, const int* pastKvLengths, int batchSize, int numKvHeads, int sizePerHead,       \
+        int maxPathLen, cudaStream_t stream);
+
+INSTANTIATE_COMPACT_TREE_KV_CACHE(float, KVLinearBuffer);
+INSTANTIATE_COMPACT_TREE_KV_CACHE(float, KVBlockArray);
+INSTANTIATE_COMPACT_TREE_KV_CACHE(half, KVLinearBuffer);
+INSTANTIATE_COMPACT_TREE_KV_CACHE(half, KVBlockArray);
+#ifdef ENABLE_BF16
+INSTANTIATE_COMPACT_TREE_KV_CACHE(__nv_bfloat16, KVLinearBuffer);
+INSTANTIATE_COMPACT_TREE_KV_CACHE(__nv_bfloat16, KVBlockArray);
+#endif
+#undef INSTANTIATE_COMPACT_TREE_KV_CACHE
+
 } // namespace kernels
 } // namespace tensorrt_llm
@@ -18,6 +18,7 @@
 
 #include "gptKernels.h"
 #include "tensorrt_llm/kernels/decodingCommon.h"
+#include "tensorrt_llm/kernels/kvCacheUtils.h"
 #include <cuda_fp16.h>
 #include <cuda_runtime.h>
 #include <curand_kernel.h>
@@ -121,6 +122,84 @@ void acceptDraftTokensByLogits(T* draftLogits, T* targetLogits, T* draftProbs, T
     int vocabSize, int vocabSizePadded, int maxDraftTokens, bool randomThreshold, float constantThreshold,
     cudaStream_t stream);
 
+//! \brief Accepts draft tokens that match the greedy tokens of the target model for speculative decoding.
+//! For every request, the target token of each draft position is the argmax of its logits. Draft tokens are
+//! accepted up to the first mismatch, the target token at that position is appended, so the number of accepted
+//! tokens N satisfies 1 <= N <= numDraftTokens + 1.
+//!
+//! \param targetIds output buffer [batchSize, maxDraftTokens + 1]. Greedy tokens of the target model,
+//! the first numsAcceptedTokens of each request are valid
+//! \param numsAcceptedTokens output buffer [batchSize]. Number of tokens to append to each request
+//! \param logits input buffer [numTokens, vocabSizePadded]. Target logits, one row per token
+//! \param logitsOffsets input buffer [batchSize]. Row of the logits predicting the first draft token of a request,
+//! the rows of the following draft tokens come next
+//! \param draftIds input buffer [batchSize, maxDraftTokens]. Draft tokens
+//! \param numsDraftTokens input buffer [batchSize]. Number of draft tokens per request
+//! \param batchSize batch size
+//! \param maxDraftTokens maximum number of draft tokens
+//! \param vocabSize unpadded vocab size
+//! \param vocabSizePadded padded vocab size
+//! \param stream stream
+template <typename T>
+void invokeAcceptDraftTokensByArgmax(int* targetIds, int* numsAcceptedTokens, const T* logits,
+    const int* logitsOffsets, const int* draftIds, const int* numsDraftTokens, int batchSize, int maxDraftTokens,
+    int vocabSize, int vocabSizePadded, cudaStream_t stream);
+
+//! \brief Accepts the longest path of a static token tree whose draft tokens match the greedy tokens of the target
+//! model, e.g. the candidates of Medusa heads. Node 0 of the tree is the last token of the sequence, every other node
+//! holds a draft token and has a parent with a smaller index. A node is accepted if its parent is accepted and its
+//! draft token is the argmax of the logits of its parent. The deepest accepted node, the first one on ties, ends the
+//! path, which is appended to the sequence with the argmax of the logits of its last node. The appended tokens stop
+//! at the sequence limit length and before an end id, which finishes the request like in the sampling kernels.
+//!
+//! \param outputIdsPtr input/output buffer [batchSize][maxSeqLen]. Contains pointers to rows with output tokens
+//! \param sequenceLengths input/output buffer [batchSize]. Current sequence lengths, increased by the appended tokens
+//! \param finished input/output buffer [batchSize]. Finished states, finished requests are skipped
+//! \param acceptedPaths output buffer [batchSize, maxPathLen]. Nodes of the accepted path, starting with node 0. The
+//! first numsAcceptedTokens entries of a request are valid
+//! \param numsAcceptedTokens output buffer [batchSize]. Number of tokens appended to each request
+//! \param logits input buffer [batchSize, numNodes, vocabSizePadded]. Target logits at each node of the tree
+//! \param draftIds input buffer [batchSize, numNodes]. Draft token of each node, ignored for node 0
+//! \param treeParents input buffer [numNodes]. Parent of each node, -1 for node 0
+//! \param endIds input buffer [batchSize]. EOS token ids
+//! \param sequenceLimitLength input buffer [batchSize]. Maximum sequence lengths, optional
+//! \param batchSize batch size
+//! \param numNodes number of nodes of the tree
+//! \param maxPathLen maximum number of nodes of a path, depth of the tree plus one
+//! \param vocabSize unpadded vocab size
+//! \param vocabSizePadded padded vocab size
+//! \param stream stream
+template <typename T>
+void invokeAcceptTreeDraftTokensByArgmax(int** outputIdsPtr, int* sequenceLengths, FinishedState* finished,
+    int* acceptedPaths, int* numsAcceptedTokens, const T* logits, const int* draftIds, const int* treeParents,
+    const int* endIds, const uint32_t* sequenceLimitLength, int batchSize, int numNodes, int maxPathLen,
+    int vocabSize, int vocabSizePadded, cudaStream_t stream);
+
+//! \brief Builds the attention mask of a static token tree, every node attends to itself and to its ancestors.
+//!
+//! \param mask output buffer [numNodes, numNodes]. mask[i, j] is 1 if node i attends to node j, 0 otherwise
+//! \param treeParents input buffer [numNodes]. Parent of each node, -1 for node 0
+//! \param numNodes number of nodes of the tree
+//! \param stream stream
+void invokeBuildTreeAttentionMask(int* mask, const int* treeParents, int numNodes, cudaStream_t stream);
+
+//! \brief Moves the KV cache entries of the accepted path of a token tree next to each other. The nodes of the tree
+//! were written at pastKvLengths + node, the j-th node of the accepted path is moved to pastKvLengths + j.
+//! Not applicable to the KV caches with per-block scales.
+//!
+//! \param kvCache KV cache buffer of one layer
+//! \param acceptedPaths input buffer [batchSize, maxPathLen]. Nodes of the accepted paths
+//! \param numsAcceptedTokens input buffer [batchSize]. Number of nodes of each path, 0 for a skipped request
+//! \param pastKvLengths input buffer [batchSize]. KV cache position of node 0 of each request
+//! \param batchSize batch size
+//! \param numKvHeads number of KV heads
+//! \param sizePerHead size of each head
+//! \param maxPathLen maximum number of nodes of a path
+//! \param stream stream
+template <typename T, typename KVCacheBuffer>
+void invokeCompactTreeKvCache(KVCacheBuffer kvCache, const int* acceptedPaths, const int* numsAcceptedTokens,
+    const int* pastKvLengths, int batchSize, int numKvHeads, int sizePerHead, int maxPathLen, cudaStream_t stream);
+
 void invokeTransposeLogProbs(float* output_log_probs, float* output_log_probs_tiled, const int* sequence_lengths,
     int batch_size, int beam_width, int max_seq_len, cudaStream_t stream);
 
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/cudaTypeUtils.cuh"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/reduceKernelUtils.cuh"
+#include "tensorrt_llm/kernels/gatedActivationKernels.h"
+
+#include <algorithm>
+#include <type_traits>
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+template <typename T>
+__global__ void swiGluKernel(T* out, const T* gateUp, int64_t rows, int64_t cols)
+{
+    for (int64_t i = blockIdx.x * static_cast<int64_t>(blockDim.x) + threadIdx.x; i < rows * cols;
+         i += static_cast<int64_t>(gridDim.x) * blockDim.x)
+    {
+        const int64_t row = i / cols;
+        const int64_t col = i % cols;
+        const float gate = static_cast<float>(gateUp[row * 2 * cols + col]);
+        const float up = static_cast<float>(gateUp[row * 2 * cols + cols + col]);
+        out[i] = static_cast<T>(gate / (1.0f + __expf(-gate)) * up);
+    }
+}
+
+template <typename T>
+void invokeSwiGlu(T* out, const T* gateUp, int rows, int cols, cudaStream_t stream)
+{
+    const int64_t numElems = static_cast<int64_t>(rows) * cols;
+    const dim3 block(256);
+    const dim3 grid(std::min<int64_t>((numElems + block.x - 1) / block.x, 65536));
+    swiGluKernel<<<grid, block, 0, stream>>>(out, gateUp, rows, cols);
+}
+
+template void invokeSwiGlu<half>(half* out, const half* gateUp, int rows, int cols, cudaStream_t stream);
+#ifdef ENABLE_BF16
+template void invokeSwiGlu<__nv_bfloat16>(
+    __nv_bfloat16* out, const __nv_bfloat16* gateUp, int rows, int cols, cudaStream_t stream);
+#endif
+
+template <typename T, int kVec>
+struct alignas(sizeof(T) * kVec) AlignedVec
+{
+    T data[kVec];
+};
+
+struct SiluOp
+{
+    __device__ static float apply(float x)
+    {
+        return x / (1.0f + __expf(-x));
+    }
+};
+
+struct GeluOp
+{
+    __device__ static float apply(float x)
+    {
+        constexpr float kAlpha = 0.7978845608028654f; // sqrt(2 / pi)
+        return 0.5f * x * (1.0f + tanhf(kAlpha * (x + 0.044715f * x * x * x)));
+    }
+};
+
+template <typename ActOp, typename T, int kVec>
+__device__ inline void gatedActivationVec(
+    float (&vals)[kVec], const AlignedVec<T, kVec>& gate, const AlignedVec<T, kVec>& up, const float* smoother, int col)
+{
+#pragma unroll
+    for (int j = 0; j < kVec; ++j)
+    {
+        // Rounded to T like the output of a separate multiplication
+        vals[j] = cuda_cast<float>(
+            cuda_cast<T>(ActOp::apply(cuda_cast<float>(gate.data[j])) * cuda_cast<float>(up.data[j])));
+        if (smoother != nullptr)
+        {
+            vals[j] /= smoother[col + j];
+        }
+    }
+}
+
+/* Computes out <- act(gate) * up / smoother, quantized when QuantT is not T.
+ *
+ * One warp handles one row, the lanes stride over the row by vectors of kVec elements. With dynamic scaling, a first
+ * pass finds the amax of the row and the second one recomputes the activation from the L1 or L2 cache, rather than
+ * keeping the row in registers.
+ */
+template <typename ActOp, typename T, typename QuantT, int kVec>
+__global__ void gatedActivationKernel(QuantT* out, const T* gateUp, int rows, int cols, const float* smoother,
+    const float* scale, float* dynamicScale)
+{
+    using Vec = AlignedVec<T, kVec>;
+    using QuantVec = AlignedVec<QuantT, kVec>;
+
+    const int lane = threadIdx.x % 32;
+    const int row = blockIdx.x * (blockDim.x / 32) + threadIdx.x / 32;
+    if (row >= rows)
+    {
+        return;
+    }
+
+    const int numVecs = cols / kVec;
+    const Vec* gateVecs = reinterpret_cast<const Vec*>(gateUp) + static_cast<int64_t>(row) * 2 * numVecs;
+    const Vec* upVecs = gateVecs + numVecs;
+    QuantVec* outVecs = reinterpret_cast<QuantVec*>(out) + static_cast<int64_t>(row) * numVecs;
+
+    float outScale = (std::is_same_v<T, QuantT> || scale == nullptr) ? 1.0f : *scale;
+    if (dynamicScale != nullptr)
+    {
+        float amax = 1e-6f;
+        for (int i = lane; i < numVecs; i += 32)
+        {
+            float vals[kVec];
+            gatedActivationVec<ActOp>(vals, gateVecs[i], upVecs[i], smoother, i * kVec);
+#pragma unroll
+            for (int j = 0; j < kVec; ++j)
+            {
+                amax = fmaxf(amax, fabsf(vals[j]));
+            }
+        }
+        amax = warpReduceMax(amax);
+        outScale = 127.0f / amax;
+        if (lane == 0)
+        {
+            dynamicScale[row] = amax / 127.0f;
+        }
+    }
+
+    for (int i = lane; i < numVecs; i += 32)
+    {
+        float vals[kVec];
+        gatedActivationVec<ActOp>(vals, gateVecs[i], upVecs[i], smoother, i * kVec);
+        QuantVec res;
+#pragma unroll
+        for (int j = 0; j < kVec; ++j)
+        {
+            res.data[j] = cuda_cast<QuantT>(vals[j] * outScale);
+        }
+        outVecs[i] = res;
+    }
+}
+
+template <typename ActOp, typename T, typename QuantT>
+void launchGatedActivation(QuantT* out, const T* gateUp, int rows, int cols, cudaStream_t stream,
+    const float* smoother, const float* scale, float* dynamicScale)
+{
+    constexpr int warpsPerBlock = 4;
+    const dim3 block(32 * warpsPerBlock);
+    const dim3 grid((rows + warpsPerBlock - 1) / warpsPerBlock);
+
+    constexpr int vecSize = 16 / sizeof(T);
+    const auto isAligned = [](const void* ptr) { return reinterpret_cast<uintptr_t>(ptr) % 16 == 0; };
+    // The up half and the rows start on a vector boundary when the row size is a multiple of the vector size
+    if (cols % vecSize == 0 && isAligned(out) && isAligned(gateUp))
+    {
+        gatedActivationKernel<ActOp, T, QuantT, vecSize>
+            <<<grid, block, 0, stream>>>(out, gateUp, rows, cols, smoother, scale, dynamicScale);
+    }
+    else
+    {
+        gatedActivationKernel<ActOp, T, QuantT, 1>
+            <<<grid, block, 0, stream>>>(out, gateUp, rows, cols, smoother, scale, dynamicScale);
+    }
+}
+
+template <typename T, typename QuantT>
+void invokeGatedActivation(QuantT* out, const T* gateUp, int rows, int cols, GatedActivationType activation,
+    cudaStream_t stream, const float* smoother, const float* scale, float* dynamicScale)
+{
+    switch (activation)
+    {
+    case GatedActivationType::kSILU:
+        launchGatedActivation<SiluOp>(out, gateUp, rows, cols, stream, smoother, scale, dynamicScale);
+        break;
+    case GatedActivationType::kGELU:
+        launchGatedActivation<GeluOp>(out, gateUp, rows, cols, stream, smoother, scale, dynamicScale);
+        break;
+    }
+    sync_check_cuda_error();
+}
+
+#define INSTANTIATE_GATED_ACTIVATION(T, QuantT)                                                                        \
+    template void invokeGatedActivation(QuantT* out, const T* gateUp, int rows, int cols,                              \
+        GatedActivationType activation, cudaStream_t stream, const float* smoother, const float* scale,                \
+        float* dynamicScale);
+
+INSTANTIATE_GATED_ACTIVATION(float, float);
+INSTANTIATE_GATED_ACTIVATION(half, half);
+INSTANTIATE_GATED_ACTIVATION(float, int8_t);
+INSTANTIATE_GATED_ACTIVATION(half, int8_t);
+
+#ifdef ENABLE_BF16
+INSTANTIATE_GATED_ACTIVATION(__nv_bfloat16, __nv_bfloat16);
+INSTANTIATE_GATED_ACTIVATION(__nv_bfloat16, int8_t);
+#endif
+
+#ifdef ENABLE_FP8
+INSTANTIATE_GATED_ACTIVATION(float, __nv_fp8_e4m3);
+INSTANTIATE_GATED_ACTIVATION(half, __nv_fp8_e4m3);
+#ifdef ENABLE_BF16
+INSTANTIATE_GATED_ACTIVATION(__nv_bfloat16, __nv_fp8_e4m3);
+#endif
+#endif
+
+} // namespace kernels
+} // namespace tensorrt_llm
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+//! \brief Computes out = silu(gate) * up, where each row of the input holds the gate followed by the up.
+//!
+//! \param out [rows, cols]
+//! \param gateUp [rows, 2 * cols]
+//! \param rows number of rows
+//! \param cols number of output columns
+//! \param stream cuda stream
+template <typename T>
+void invokeSwiGlu(T* out, const T* gateUp, int rows, int cols, cudaStream_t stream);
+
+enum class GatedActivationType : int
+{
+    kSILU = 0,
+    kGELU = 1, // tanh approximation
+};
+
+//! \brief Computes out = act(gate) * up / smoother, where each row of the input holds the gate followed by the up,
+//! in one pass over the output of the [gate|up] GEMM.
+//!
+//! The output is quantized to `QuantT` when it differs from `T`, for the GEMM that follows: int8 with the per-tensor
+//! `scale` or, if `dynamicScale` is set, with a per-token scale written to `dynamicScale`, or fp8 with the per-tensor
+//! `scale`. A warp handles a row, with 16-byte accesses when the row size and the pointers allow them.
+//!
+//! \param out [rows, cols]
+//! \param gateUp [rows, 2 * cols]
+//! \param smoother [cols], the SmoothQuant divisors of the columns of the output. May be null
+//! \param scale [1], the scale of the quantized output. Ignored if `QuantT` is `T` or with `dynamicScale`
+//! \param dynamicScale [rows], the scales of the rows of the int8 output. Null for a per-tensor scale
+template <typename T, typename QuantT>
+void invokeGatedActivation(QuantT* out, const T* gateUp, int rows, int cols, GatedActivationType activation,
+    cudaStream_t stream, const float* smoother = nullptr, const float* scale = nullptr, float* dynamicScale = nullptr);
+
+} // namespace kernels
+} // namespace tensorrt_llm
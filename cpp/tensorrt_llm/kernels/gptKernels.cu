@@ -134,7 +134,7 @@ __global__ void computePaddingOffsets(int* paddingOffsets, const int* seqOffsets
 
 template <typename AttentionMaskDataType>
 __global__ void computeAttentionMask(AttentionMaskDataType* attentionMask, const int* seqOffsets, int maxSeqLength,
-    int attentionWindowSize, AttentionMaskType attentionMaskType)
+    int attentionWindowSize, AttentionMaskType attentionMaskType, BlockSparseParams blockSparseParams)
 {
     // The index of the sequence in the batch.
     int batchIdx = blockIdx.y;
@@ -213,6 +213,16 @@ __global__ void computeAttentionMask(AttentionMaskDataType* attentionMask, const
             // 1 1 1 1 0
             // 1 1 1 1 1
             break;
+        case AttentionMaskType::BLOCKSPARSE:
+            isValid = rowIdx < seqLength && colIdx < seqLength && blockSparseParams.computeMask(rowIdx, colIdx, 0);
+            // seq_length==6, max_seq_len==6, block_size==2, num_local_blocks==1, vertical_stride==2
+            // 1 0 0 0 0 0
+            // 1 1 0 0 0 0
+            // 0 0 1 0 0 0
+            // 0 0 1 1 0 0
+            // 0 0 1 1 1 0
+            // 0 0 1 1 1 1
+            break;
         }
 
         // Store the mask.
@@ -248,7 +258,7 @@ void invokeBuildDecoderInfo(const BuildDecoderInfoParams<T>& params, cudaStream_
         }
         dim3 grid(blocksPerSeq, params.batchSize);
         computeAttentionMask<<<grid, THREADS_PER_BLOCK, 0, stream>>>(params.attentionMask, params.seqQOffsets,
-            params.maxSeqLength, params.attentionWindowSize, params.attentionMaskType);
+            params.maxSeqLength, params.attentionWindowSize, params.attentionMaskType, params.blockSparseParams);
     }
 }
 
@@ -34,7 +34,40 @@ enum class AttentionMaskType
     BIDIRECTIONAL = 2,
     // See GLM-10B mask.
     // TODO: merge this mask into BIDIRECTIONAL
-    BIDIRECTIONALGLM = 3
+    BIDIRECTIONALGLM = 3,
+    // Causal mask restricted to a fixed block-sparse pattern, see BlockSparseParams.
+    BLOCKSPARSE = 4
+};
+
+struct BlockSparseParams
+{
+    // The granularity of the mask, in tokens.
+    int block_size;
+    // Whether all the heads share the same pattern. Otherwise, the vertical blocks are shifted per head.
+    bool homo_head_pattern;
+    // The number of blocks before the query (including its own block) it attends to.
+    int num_local_blocks;
+    // The query also attends to every vertical_stride-th block before it (the global blocks).
+    int vertical_stride;
+    // The number of heads of the model and the first head of this rank, to shift the pattern with tensor parallelism.
+    int num_heads;
+    int head_offset;
+
+    // Does the token at rowIdx attend to the token at colIdx? headIdx is the local head index.
+    __host__ __device__ bool computeMask(int rowIdx, int colIdx, int headIdx) const
+    {
+        if (colIdx > rowIdx)
+        {
+            return false;
+        }
+        const int blockRowIdx = rowIdx / block_size;
+        const int blockColIdx = colIdx / block_size;
+        const bool isLocal = blockRowIdx - blockColIdx < num_local_blocks;
+        const int headSlidingStep = vertical_stride / num_heads > 1 ? vertical_stride / num_heads : 1;
+        const int headShift = homo_head_pattern ? 0 : (head_offset + headIdx) * headSlidingStep;
+        const bool isVertical = (blockColIdx + headShift + 1) % vertical_stride == 0;
+        return isLocal || isVertical;
+    }
 };
 
 enum class PositionEmbeddingType : int8_t
@@ -87,6 +120,8 @@ struct BuildDecoderInfoParams
     int numTokens;
     // The type of attention.
     AttentionMaskType attentionMaskType;
+    // The pattern of the BLOCKSPARSE mask. The mask is shared by the heads, so it needs homo_head_pattern.
+    BlockSparseParams blockSparseParams;
 };
 
 template <typename T>
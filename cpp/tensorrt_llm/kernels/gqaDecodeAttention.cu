@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaTypeUtils.cuh"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/reduceKernelUtils.cuh"
+#include "tensorrt_llm/kernels/gqaDecodeAttention.h"
+
+#include <cfloat>
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+namespace
+{
+
+// Number of cached tokens loaded to shared memory at once, one per lane when computing the scores.
+static constexpr int kKVTileSize = 32;
+static constexpr int kNumWarps = 4;
+// Each warp handles the query heads warpIdx, warpIdx + kNumWarps, ... of the group.
+static constexpr int kRowsPerWarp = kGQADecodeMaxQHeadsPerKV / kNumWarps;
+
+template <typename T, int HEAD_SIZE, typename KVCacheBuffer>
+__global__ void gqaDecodeAttentionKernel(const GQADecodeAttentionParams<T> params, KVCacheBuffer kvCacheBuffer)
+{
+    static constexpr int kDimsPerLane = (HEAD_SIZE + 31) / 32;
+    // Odd number of 32-bit words per row, so lanes reading different tokens of one channel hit different banks.
+    static constexpr int kSmemStride = HEAD_SIZE + 2;
+
+    // Dynamic shared memory, as float and the large head sizes need more than 48 KB.
+    extern __shared__ char smem[];
+    auto qSmem = reinterpret_cast<T(*)[HEAD_SIZE]>(smem);
+    auto kSmem = reinterpret_cast<T(*)[kSmemStride]>(qSmem + kGQADecodeMaxQHeadsPerKV);
+    auto vSmem = kSmem + kKVTileSize;
+
+    const int kvHeadIdx = blockIdx.x;
+    const int batchIdx = blockIdx.y;
+    const int splitIdx = blockIdx.z;
+    const int qHeadsPerKV = params.numHeads / params.numKVHeads;
+    const int firstHeadIdx = kvHeadIdx * qHeadsPerKV;
+    const int warpIdx = threadIdx.x / 32;
+    const int laneIdx = threadIdx.x % 32;
+
+    const int seqLength = params.sequenceLengths[batchIdx];
+    // Position of the new token, which is already in the cache.
+    const int qPos = seqLength - 1;
+    const int numSlots = min(seqLength, params.cyclicKVCacheLength);
+    const int slotsPerSplit = divUp(divUp(numSlots, params.numSplits), kKVTileSize) * kKVTileSize;
+    const int slotBegin = splitIdx * slotsPerSplit;
+    const int slotEnd = min(numSlots, slotBegin + slotsPerSplit);
+
+    const size_t qkvStride = static_cast<size_t>(params.numHeads + 2 * params.numKVHeads) * HEAD_SIZE;
+    for (int i = threadIdx.x; i < kGQADecodeMaxQHeadsPerKV * HEAD_SIZE; i += blockDim.x)
+    {
+        const int row = i / HEAD_SIZE;
+        const int channel = i % HEAD_SIZE;
+        qSmem[row][channel] = row < qHeadsPerKV
+            ? params.qkv[batchIdx * qkvStride + static_cast<size_t>(firstHeadIdx + row) * HEAD_SIZE + channel]
+            : T(0.f);
+    }
+
+    float alibiSlope[kRowsPerWarp];
+    float rowMax[kRowsPerWarp];
+    float rowSum[kRowsPerWarp];
+    float acc[kRowsPerWarp][kDimsPerLane];
+#pragma unroll
+    for (int r = 0; r < kRowsPerWarp; ++r)
+    {
+        const int row = warpIdx + r * kNumWarps;
+        alibiSlope[r] = params.alibiSlopes != nullptr && row < qHeadsPerKV
+            ? cuda_cast<float>(params.alibiSlopes[firstHeadIdx + row])
+            : 0.f;
+        rowMax[r] = -FLT_MAX;
+        rowSum[r] = 0.f;
+#pragma unroll
+        for (int k = 0; k < kDimsPerLane; ++k)
+        {
+            acc[r][k] = 0.f;
+        }
+    }
+
+    for (int tileBegin = slotBegin; tileBegin < slotEnd; tileBegin += kKVTileSize)
+    {
+        __syncthreads();
+        if (params.maskType == AttentionMaskType::BLOCKSPARSE)
+        {
+            // Skip the tiles that no head of the group attends to without loading them.
+            bool isTileUsed = false;
+            for (int i = threadIdx.x; i < qHeadsPerKV * kKVTileSize; i += blockDim.x)
+            {
+                const int slot = tileBegin + i % kKVTileSize;
+                const int kvPos = slot + (qPos - slot) / params.cyclicKVCacheLength * params.cyclicKVCacheLength;
+                isTileUsed = isTileUsed
+                    || (slot < slotEnd
+                        && params.blockSparseParams.computeMask(qPos, kvPos, firstHeadIdx + i / kKVTileSize));
+            }
+            if (!__syncthreads_or(isTileUsed))
+            {
+                continue;
+            }
+        }
+        for (int i = threadIdx.x; i < kKVTileSize * HEAD_SIZE; i += blockDim.x)
+        {
+            const int token = i / HEAD_SIZE;
+            const int channel = i % HEAD_SIZE;
+            const int slot = tileBegin + token;
+            T k(0.f);
+            T v(0.f);
+            if (slot < slotEnd)
+            {
+                const int localIdx = kvCacheBuffer.getKVLocalIdx(slot, kvHeadIdx, HEAD_SIZE, channel);
+                k = reinterpret_cast<const T*>(kvCacheBuffer.getKBlockPtr(batchIdx, slot))[localIdx];
+                v = reinterpret_cast<const T*>(kvCacheBuffer.getVBlockPtr(batchIdx, slot))[localIdx];
+            }
+            kSmem[token][channel] = k;
+            vSmem[token][channel] = v;
+        }
+        __syncthreads();
+
+        const int slot = tileBegin + laneIdx;
+        // The latest token written to the slot of the ring.
+        const int kvPos = slot + (qPos - slot) / params.cyclicKVCacheLength * params.cyclicKVCacheLength;
+#pragma unroll
+        for (int r = 0; r < kRowsPerWarp; ++r)
+        {
+            const int row = warpIdx + r * kNumWarps;
+            if (row >= qHeadsPerKV)
+            {
+                continue;
+            }
+
+            float score = 0.f;
+#pragma unroll 8
+            for (int d = 0; d < HEAD_SIZE; ++d)
+            {
+                score += cuda_cast<float>(qSmem[row][d]) * cuda_cast<float>(kSmem[laneIdx][d]);
+            }
+            score = score * params.qkScale + alibiSlope[r] * static_cast<float>(kvPos - qPos);
+            const bool valid = slot < slotEnd
+                && (params.maskType != AttentionMaskType::BLOCKSPARSE
+                    || params.blockSparseParams.computeMask(qPos, kvPos, firstHeadIdx + row));
+            score = valid ? score : -FLT_MAX;
+
+            const float newMax = fmaxf(rowMax[r], warpReduceMax(score));
+            if (newMax == -FLT_MAX)
+            {
+                // Nothing to attend to in this tile yet.
+                continue;
+            }
+            const float p = valid ? __expf(score - newMax) : 0.f;
+            const float correction = __expf(rowMax[r] - newMax);
+            rowSum[r] = rowSum[r] * correction + warpReduceSum(p);
+            rowMax[r] = newMax;
+#pragma unroll
+            for (int k = 0; k < kDimsPerLane; ++k)
+            {
+                acc[r][k] *= correction;
+            }
+            for (int j = 0; j < kKVTileSize; ++j)
+            {
+                const float pj = __shfl_sync(FINAL_MASK, p, j);
+#pragma unroll
+                for (int k = 0; k < kDimsPerLane; ++k)
+                {
+                    const int d = laneIdx + k * 32;
+                    if (d < HEAD_SIZE)
+                    {
+                        acc[r][k] += pj * cuda_cast<float>(vSmem[j][d]);
+                    }
+                }
+            }
+        }
+    }
+
+#pragma unroll
+    for (int r = 0; r < kRowsPerWarp; ++r)
+    {
+        const int row = warpIdx + r * kNumWarps;
+        if (row >= qHeadsPerKV)
+        {
+            continue;
+        }
+        const size_t outIdx = static_cast<size_t>(batchIdx) * params.numHeads + firstHeadIdx + row;
+        const size_t partialIdx = static_cast<size_t>(splitIdx) * params.batchSize * params.numHeads + outIdx;
+        const float invSum = rowSum[r] > 0.f ? 1.f / rowSum[r] : 0.f;
+        T* out = params.numSplits > 1 ? params.partialOut + partialIdx * HEAD_SIZE : params.output + outIdx * HEAD_SIZE;
+#pragma unroll
+        for (int k = 0; k < kDimsPerLane; ++k)
+        {
+            const int d = laneIdx + k * 32;
+            if (d < HEAD_SIZE)
+            {
+                out[d] = cuda_cast<T>(acc[r][k] * invSum);
+            }
+        }
+        if (params.numSplits > 1 && laneIdx == 0)
+        {
+            params.partialSum[partialIdx] = rowSum[r];
+            params.partialMax[partialIdx] = rowMax[r];
+        }
+    }
+}
+
+// Merges the outputs of the splits of one (sequence, head), rescaling each by its share of the softmax denominator.
+template <typename T, int HEAD_SIZE>
+__global__ void gqaDecodeAttentionMergeKernel(const GQADecodeAttentionParams<T> params)
+{
+    const size_t outIdx = static_cast<size_t>(blockIdx.y) * params.numHeads + blockIdx.x;
+    const size_t splitStride = static_cast<size_t>(params.batchSize) * params.numHeads;
+
+    float globalMax = -FLT_MAX;
+    for (int s = 0; s < params.numSplits; ++s)
+    {
+        globalMax = fmaxf(globalMax, params.partialMax[s * splitStride + outIdx]);
+    }
+    float totalSum = 0.f;
+    for (int s = 0; s < params.numSplits; ++s)
+    {
+        const size_t partialIdx = s * splitStride + outIdx;
+        totalSum += params.partialSum[partialIdx] * __expf(params.partialMax[partialIdx] - globalMax);
+    }
+    const float invTotalSum = totalSum > 0.f ? 1.f / totalSum : 0.f;
+
+    for (int d = threadIdx.x; d < HEAD_SIZE; d += blockDim.x)
+    {
+        float out = 0.f;
+        for (int s = 0; s < params.numSplits; ++s)
+        {
+            const size_t partialIdx = s * splitStride + outIdx;
+            const float weight = params.partialSum[partialIdx] * __expf(params.partialMax[partialIdx] - globalMax);
+            out += weight * cuda_cast<float>(params.partialOut[partialIdx * HEAD_SIZE + d]);
+        }
+        params.output[outIdx * HEAD_SIZE + d] = cuda_cast<T>(out * invTotalSum);
+    }
+}
+
+template <typename T, int HEAD_SIZE, typename KVCacheBuffer>
+void launchGQADecodeAttention(
+    const GQADecodeAttentionParams<T>& params, const KVCacheBuffer& kvCacheBuffer, cudaStream_t stream)
+{
+    const size_t smemSize = sizeof(T) * (kGQADecodeMaxQHeadsPerKV * HEAD_SIZE + 2 * kKVTileSize * (HEAD_SIZE + 2));
+    if (smemSize >= 48 * 1024)
+    {
+        TLLM_CUDA_CHECK(cudaFuncSetAttribute(gqaDecodeAttentionKernel<T, HEAD_SIZE, KVCacheBuffer>,
+            cudaFuncAttributeMaxDynamicSharedMemorySize, smemSize));
+    }
+    const dim3 grid(params.numKVHeads, params.batchSize, params.numSplits);
+    gqaDecodeAttentionKernel<T, HEAD_SIZE, KVCacheBuffer>
+        <<<grid, kNumWarps * 32, smemSize, stream>>>(params, kvCacheBuffer);
+    if (params.numSplits > 1)
+    {
+        const dim3 mergeGrid(params.numHeads, params.batchSize);
+        gqaDecodeAttentionMergeKernel<T, HEAD_SIZE><<<mergeGrid, divUp(HEAD_SIZE, 32) * 32, 0, stream>>>(params);
+    }
+}
+
+} // namespace
+
+template <typename T, typename KVCacheBuffer>
+void invokeGQADecodeAttention(
+    const GQADecodeAttentionParams<T>& params, const KVCacheBuffer& kvCacheBuffer, cudaStream_t stream)
+{
+    TLLM_CHECK_WITH_INFO(params.numHeads % params.numKVHeads == 0, "numHeads should be multiple of numKVHeads.");
+    TLLM_CHECK_WITH_INFO(params.numHeads / params.numKVHeads <= kGQADecodeMaxQHeadsPerKV,
+        "GQA decode attention supports up to %d query heads per kv head.", kGQADecodeMaxQHeadsPerKV);
+    TLLM_CHECK_WITH_INFO(params.numSplits == 1 || params.partialOut != nullptr,
+        "GQA decode attention needs the partial buffers when splitting the cache.");
+
+    switch (params.headSize)
+    {
+    case 32: launchGQADecodeAttention<T, 32>(params, kvCacheBuffer, stream); break;
+    case 48: launchGQADecodeAttention<T, 48>(params, kvCacheBuffer, stream); break;
+    case 64: launchGQADecodeAttention<T, 64>(params, kvCacheBuffer, stream); break;
+    case 80: launchGQADecodeAttention<T, 80>(params, kvCacheBuffer, stream); break;
+    case 96: launchGQADecodeAttention<T, 96>(params, kvCacheBuffer, stream); break;
+    case 112: launchGQADecodeAttention<T, 112>(params, kvCacheBuffer, stream); break;
+    case 128: launchGQADecodeAttention<T, 128>(params, kvCacheBuffer, stream); break;
+    case 144: launchGQADecodeAttention<T, 144>(params, kvCacheBuffer, stream); break;
+    case 160: launchGQADecodeAttention<T, 160>(params, kvCacheBuffer, stream); break;
+    case 192: launchGQADecodeAttention<T, 192>(params, kvCacheBuffer, stream); break;
+    case 224: launchGQADecodeAttention<T, 224>(params, kvCacheBuffer, stream); break;
+    case 256: launchGQADecodeAttention<T, 256>(params, kvCacheBuffer, stream); break;
+    default: TLLM_THROW("GQA decode attention does not support head size %d", params.headSize);
+    }
+}
+
+#define INSTANTIATE_GQA_DECODE_ATTENTION(T, KVCacheBuffer)                                                             \
+    template void invokeGQADecodeAttention<T, KVCacheBuffer>(                                                          \
+        const GQADecodeAttentionParams<T>& params, const KVCacheBuffer& kvCacheBuffer, cudaStream_t stream);
+
+INSTANTIATE_GQA_DECODE_ATTENTION(float, KVBlockArray);
+INSTANTIATE_GQA_DECODE_ATTENTION(float, KVLinearBuffer);
+INSTANTIATE_GQA_DECODE_ATTENTION(half, KVBlockArray);
+INSTANTIATE_GQA_DECODE_ATTENTION(half, KVLinearBuffer);
+#ifdef ENABLE_BF16
+INSTANTIATE_GQA_DECODE_ATTENTION(__nv_bfloat16, KVBlockArray);
+INSTANTIATE_GQA_DECODE_ATTENTION(__nv_bfloat16, KVLinearBuffer);
+#endif
+#undef INSTANTIATE_GQA_DECODE_ATTENTION
+
+} // namespace kernels
+} // namespace tensorrt_llm
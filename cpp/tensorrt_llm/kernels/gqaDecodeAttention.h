@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/kernels/gptKernels.h"
+#include "tensorrt_llm/kernels/kvCacheUtils.h"
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+template <typename T>
+struct GQADecodeAttentionParams
+{
+    // [batchSize, (numHeads + 2 * numKVHeads) * headSize], the packed QKV of the new token of each sequence, with
+    // the bias and the rotary embedding already applied (see invokeApplyBiasRopeUpdateKVCache).
+    const T* qkv;
+    // [batchSize, numHeads, headSize]
+    T* output;
+    // [numHeads], ALiBi slopes added as slope * (kvPos - qPos). Ignored if nullptr.
+    const T* alibiSlopes;
+    // [batchSize], number of tokens per sequence including the new one.
+    const int* sequenceLengths;
+    int batchSize;
+    int numHeads;
+    int numKVHeads;
+    int headSize;
+    // Length of the ring the keys and values were written to.
+    int cyclicKVCacheLength;
+    float qkScale;
+    // Only BLOCKSPARSE changes the keys the new token attends to, the other masks attend to the whole cache.
+    AttentionMaskType maskType;
+    BlockSparseParams blockSparseParams;
+    // Number of blocks splitting the cache of each (sequence, kv head). If > 1, the partial results go to the
+    // buffers below and are merged by a second kernel.
+    int numSplits;
+    // [numSplits, batchSize, numHeads, headSize], normalized output of each split.
+    T* partialOut;
+    // [numSplits, batchSize, numHeads], softmax denominator and max of each split.
+    float* partialSum;
+    float* partialMax;
+};
+
+//! \brief Maximum number of query heads sharing one kv head supported by invokeGQADecodeAttention.
+static constexpr int kGQADecodeMaxQHeadsPerKV = 16;
+
+//! \brief Returns true if invokeGQADecodeAttention is instantiated for the head size.
+inline bool isGQADecodeAttentionSupported(int headSize)
+{
+    return headSize == 32 || headSize == 48 || headSize == 64 || headSize == 80 || headSize == 96 || headSize == 112
+        || headSize == 128 || headSize == 144 || headSize == 160 || headSize == 192 || headSize == 224
+        || headSize == 256;
+}
+
+//! \brief Generation-phase attention for grouped-query attention. One block handles all the query heads sharing a
+//! kv head, so each key and value of the cache is loaded from global memory once per group instead of once per
+//! query head as in the masked MHA kernels. The new keys and values must already be written to the cache. Supports
+//! beam width 1 and non-quantized caches only.
+//!
+//! \param params see GQADecodeAttentionParams
+//! \param kvCacheBuffer KVBlockArray or KVLinearBuffer holding the keys and values
+//! \param stream cuda stream
+template <typename T, typename KVCacheBuffer>
+void invokeGQADecodeAttention(
+    const GQADecodeAttentionParams<T>& params, const KVCacheBuffer& kvCacheBuffer, cudaStream_t stream);
+
+} // namespace kernels
+} // namespace tensorrt_llm
@@ -163,6 +163,15 @@ void groupedGemmType_(std::vector<cutlass::gemm::GemmCoord> problem_sizes, std::
 #endif
 }
 
+int64_t getGroupedGemmParamsWorkSpaceSize(int64_t problemCount)
+{
+    auto gemm_coord_size = tensorrt_llm::common::divUp(problemCount * sizeof(cutlass::gemm::GemmCoord), 16) * 16;
+    auto ptr_size = 4 * tensorrt_llm::common::divUp(problemCount * sizeof(half*), 16) * 16;
+    auto ldd_size = 4 * tensorrt_llm::common::divUp(problemCount * sizeof(int64_t), 16) * 16;
+
+    return gemm_coord_size + ptr_size + ldd_size;
+}
+
 void gropuedGemm(std::vector<cutlass::gemm::GemmCoord> problem_sizes, std::vector<void*> ptrA, std::vector<void*> ptrB,
     std::vector<void*> ptrC, std::vector<void*> ptrD, void* workspace, int64_t workSpaceSize, void* cublasWorkSpace,
     int64_t cublasWorkspaceSize, bool isLoraIn, nvinfer1::DataType dataType, cudaStream_t stream)
@@ -23,6 +23,10 @@ namespace tensorrt_llm
 namespace kernels
 {
 
+//! \brief Size of the device workspace holding the problem sizes, pointers and leading dimensions of the problems
+//! passed to gropuedGemm.
+int64_t getGroupedGemmParamsWorkSpaceSize(int64_t problemCount);
+
 void gropuedGemm(std::vector<cutlass::gemm::GemmCoord> problem_sizes, std::vector<void*> ptrA, std::vector<void*> ptrB,
     std::vector<void*> ptrC, std::vector<void*> ptrD, void* workspace, int64_t workSpaceSize, void* cublasWorkSpace,
     int64_t cublasWorkspaceSize, bool isLoraIn, nvinfer1::DataType dataType, cudaStream_t stream);
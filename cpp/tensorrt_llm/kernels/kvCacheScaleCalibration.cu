@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/cudaTypeUtils.cuh"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/reduceKernelUtils.cuh"
+#include "tensorrt_llm/kernels/kvCacheScaleCalibration.h"
+
+#include <algorithm>
+
+#if !defined(_WIN32)
+#include <dlfcn.h>
+#endif
+
+using namespace tensorrt_llm::common;
+
+void* getTrtLlmKvCacheScaleCalibrator()
+{
+    static tensorrt_llm::kernels::KvCacheScaleCalibrator instance;
+    return &instance;
+}
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+namespace
+{
+
+// Both are non-negative, so the order of their bits is the order of the floats.
+__device__ void atomicMaxAbs(float* address, float val)
+{
+    atomicMax(reinterpret_cast<int*>(address), __float_as_int(val));
+}
+
+template <typename T>
+__global__ void kvCacheAbsMaxKernel(float* absMax, int const* collect, T const* kSrc, T const* vSrc,
+    int const* cuSeqLens, int const* sequenceLengths, int headNum, int sizePerHead, int srcBatchStride,
+    int srcTokenStride, int srcHeadStride)
+{
+    // One CTA reduces the keys and values of one token.
+    int const tokenIdx = blockIdx.x;
+    int const batchIdx = blockIdx.y;
+    if (*collect == 0 || tokenIdx >= sequenceLengths[batchIdx])
+    {
+        return;
+    }
+
+    int64_t const tokenOffset = (cuSeqLens != nullptr ? static_cast<int64_t>(cuSeqLens[batchIdx]) * srcTokenStride
+                                                       : static_cast<int64_t>(batchIdx) * srcBatchStride)
+        + static_cast<int64_t>(tokenIdx) * srcTokenStride;
+    int const numElems = headNum * sizePerHead;
+
+    float localMax = 0.f;
+    for (int i = threadIdx.x; i < 2 * numElems; i += blockDim.x)
+    {
+        int const elemIdx = i % numElems;
+        T const* src = i < numElems ? kSrc : vSrc;
+        auto const val = src[tokenOffset + (elemIdx / sizePerHead) * srcHeadStride + elemIdx % sizePerHead];
+        localMax = fmaxf(localMax, fabsf(cuda_cast<float>(val)));
+    }
+    localMax = blockReduceMax<float>(localMax);
+
+    if (threadIdx.x == 0)
+    {
+        atomicMaxAbs(absMax, localMax);
+    }
+}
+
+__global__ void updateKvCacheScaleKernel(float* buffer, float quantMax, float margin)
+{
+    float* absMax = buffer;
+    float* scaleOrigQuant = buffer + 1;
+    float* scaleQuantOrig = buffer + 2;
+    float* history = buffer + 3;
+
+    float const newAbsMax = *absMax;
+    if (newAbsMax <= 0.f)
+    {
+        return;
+    }
+
+    float maxAbsMax = newAbsMax;
+    for (int i = KvCacheScaleCalibration::kAbsMaxHistoryLength - 1; i > 0; --i)
+    {
+        history[i] = history[i - 1];
+        maxAbsMax = fmaxf(maxAbsMax, history[i]);
+    }
+    history[0] = newAbsMax;
+    *absMax = 0.f;
+
+    float const scale = quantMax / (margin * maxAbsMax);
+    *scaleOrigQuant = scale;
+    *scaleQuantOrig = 1.f / scale;
+}
+
+} // namespace
+
+KvCacheScaleCalibration::KvCacheScaleCalibration(float quantMax, int const* collect)
+    : mQuantMax{quantMax}
+    , mCollect{collect}
+{
+}
+
+KvCacheScaleCalibration::~KvCacheScaleCalibration()
+{
+    // The CUDA context may already be destroyed, the error is ignored
+    if (mBuffer != nullptr)
+    {
+        cudaFree(mBuffer);
+    }
+}
+
+void KvCacheScaleCalibration::seed(float const* scaleOrigQuant, float const* scaleQuantOrig, cudaStream_t stream)
+{
+    std::call_once(mSeeded,
+        [&]()
+        {
+            auto constexpr bufferSize = (3 + kAbsMaxHistoryLength) * sizeof(float);
+            TLLM_CUDA_CHECK(cudaMalloc(&mBuffer, bufferSize));
+            TLLM_CUDA_CHECK(cudaMemsetAsync(mBuffer, 0, bufferSize, stream));
+            TLLM_CUDA_CHECK(
+                cudaMemcpyAsync(mBuffer + 1, scaleOrigQuant, sizeof(float), cudaMemcpyDeviceToDevice, stream));
+            TLLM_CUDA_CHECK(
+                cudaMemcpyAsync(mBuffer + 2, scaleQuantOrig, sizeof(float), cudaMemcpyDeviceToDevice, stream));
+        });
+}
+
+void KvCacheScaleCalibration::update(float margin, cudaStream_t stream)
+{
+    if (mBuffer == nullptr)
+    {
+        return;
+    }
+    updateKvCacheScaleKernel<<<1, 1, 0, stream>>>(mBuffer, mQuantMax, margin);
+    sync_check_cuda_error();
+}
+
+KvCacheScaleCalibrator& KvCacheScaleCalibrator::getInstance()
+{
+    // The first library loaded globally that exports the instance provides it to all of them
+    static KvCacheScaleCalibrator* instance = []()
+    {
+#if !defined(_WIN32)
+        using GetInstance = void* (*) ();
+        auto getShared = reinterpret_cast<GetInstance>(dlsym(RTLD_DEFAULT, "getTrtLlmKvCacheScaleCalibrator"));
+        if (getShared != nullptr)
+        {
+            return static_cast<KvCacheScaleCalibrator*>(getShared());
+        }
+#endif
+        return static_cast<KvCacheScaleCalibrator*>(getTrtLlmKvCacheScaleCalibrator());
+    }();
+    return *instance;
+}
+
+KvCacheScaleCalibrator::~KvCacheScaleCalibrator()
+{
+    // The CUDA context may already be destroyed, the error is ignored
+    if (mCollect != nullptr)
+    {
+        cudaFree(mCollect);
+    }
+}
+
+std::shared_ptr<KvCacheScaleCalibration> KvCacheScaleCalibrator::addLayer(float quantMax)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mCollect == nullptr)
+    {
+        TLLM_CUDA_CHECK(cudaMalloc(&mCollect, sizeof(int)));
+        TLLM_CUDA_CHECK(cudaMemset(mCollect, 0, sizeof(int)));
+        mCollecting = false;
+    }
+    auto layer = std::make_shared<KvCacheScaleCalibration>(quantMax, mCollect);
+    mLayers.emplace_back(layer);
+    return layer;
+}
+
+bool KvCacheScaleCalibrator::hasLayers()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mLayers.erase(std::remove_if(mLayers.begin(), mLayers.end(), [](auto const& layer) { return layer.expired(); }),
+        mLayers.end());
+    return !mLayers.empty();
+}
+
+void KvCacheScaleCalibrator::setCollecting(bool collecting, cudaStream_t stream)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mCollect == nullptr || collecting == mCollecting)
+    {
+        return;
+    }
+    // The kernels only test the flag against zero
+    TLLM_CUDA_CHECK(cudaMemsetAsync(mCollect, collecting ? 1 : 0, sizeof(int), stream));
+    mCollecting = collecting;
+}
+
+void KvCacheScaleCalibrator::update(float margin, cudaStream_t stream)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto const& weakLayer : mLayers)
+    {
+        if (auto layer = weakLayer.lock())
+        {
+            layer->update(margin, stream);
+        }
+    }
+}
+
+template <typename T>
+void invokeKvCacheAbsMax(float* absMax, int const* collect, T const* k_src, T const* v_src, int const* cu_seqlens,
+    int const* sequence_lengths, int local_batch_size, int seq_len, int size_per_head, int local_head_num,
+    int src_batch_stride, int src_token_stride, int src_head_stride, cudaStream_t stream)
+{
+    dim3 const blockSz(std::min(1024, roundUp(2 * local_head_num * size_per_head, 32)));
+    dim3 const gridSz(seq_len, local_batch_size);
+    kvCacheAbsMaxKernel<T><<<gridSz, blockSz, 0, stream>>>(absMax, collect, k_src, v_src, cu_seqlens,
+        sequence_lengths, local_head_num, size_per_head, src_batch_stride, src_token_stride, src_head_stride);
+}
+
+#define INSTANTIATE_KV_CACHE_ABS_MAX(T)                                                                                \
+    template void invokeKvCacheAbsMax(float* absMax, int const* collect, T const* k_src, T const* v_src,               \
+        int const* cu_seqlens, int const* sequence_lengths, int local_batch_size, int seq_len, int size_per_head,      \
+        int local_head_num, int src_batch_stride, int src_token_stride, int src_head_stride, cudaStream_t stream)
+
+INSTANTIATE_KV_CACHE_ABS_MAX(float);
+INSTANTIATE_KV_CACHE_ABS_MAX(half);
+#ifdef ENABLE_BF16
+INSTANTIATE_KV_CACHE_ABS_MAX(__nv_bfloat16);
+#endif
+
+#undef INSTANTIATE_KV_CACHE_ABS_MAX
+
+} // namespace kernels
+} // namespace tensorrt_llm
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cuda_runtime_api.h>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Instance of KvCacheScaleCalibrator shared by the libraries of the process
+extern "C" void* getTrtLlmKvCacheScaleCalibrator();
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+//! \brief Device state of the online recalibration of the 8-bit KV cache scale of one attention layer.
+//!
+//! While the collect flag of the calibrator is set, the attention kernels raise getAbsMax() to the largest magnitude
+//! of the keys and values they write to the cache. The layer quantizes the cache with getScaleOrigQuant() and
+//! getScaleQuantOrig(), seeded from the static scales of the engine and recomputed by KvCacheScaleCalibrator::update.
+//! The buffers are allocated by the first call to seed(), so that a plugin that is only built allocates nothing.
+class KvCacheScaleCalibration
+{
+public:
+    //! Number of updates whose absmax bounds the scale
+    static constexpr int kAbsMaxHistoryLength = 16;
+
+    //! \param quantMax Largest magnitude of the cache type, 127 for INT8 and 448 for FP8 E4M3.
+    KvCacheScaleCalibration(float quantMax, int const* collect);
+
+    ~KvCacheScaleCalibration();
+
+    KvCacheScaleCalibration(KvCacheScaleCalibration const&) = delete;
+    KvCacheScaleCalibration& operator=(KvCacheScaleCalibration const&) = delete;
+
+    //! \brief Copies the static scales of the engine the first time it is called, the later calls do nothing. Must
+    //! not be captured in a CUDA graph.
+    void seed(float const* scaleOrigQuant, float const* scaleQuantOrig, cudaStream_t stream);
+
+    [[nodiscard]] float* getAbsMax() const
+    {
+        return mBuffer;
+    }
+
+    [[nodiscard]] float const* getScaleOrigQuant() const
+    {
+        return mBuffer + 1;
+    }
+
+    [[nodiscard]] float const* getScaleQuantOrig() const
+    {
+        return mBuffer + 2;
+    }
+
+    [[nodiscard]] int const* getCollectFlag() const
+    {
+        return mCollect;
+    }
+
+    //! \brief Pushes the absmax to the history and recomputes the scales as quantMax / (margin * max(history)).
+    //! Nothing changes if no value was collected since the last update.
+    void update(float margin, cudaStream_t stream);
+
+private:
+    float const mQuantMax;
+    int const* mCollect;
+    // absmax, scaleOrigQuant, scaleQuantOrig, then the absmax of the last updates
+    float* mBuffer{nullptr};
+    std::once_flag mSeeded;
+};
+
+//! \brief The attention layers that recalibrate their 8-bit KV cache scale from the keys and values of the requests
+//! (QuantMode::kvCacheOnlineScaling).
+//!
+//! The runtime samples the steps that collect the absmax with setCollecting() and updates the scales with update()
+//! between them. A flag read on the device keeps CUDA graphs valid when it changes.
+//!
+//! The plugin library has its own copy of this code, the instance is shared through an exported symbol so that the
+//! runtime sees the layers of the plugins.
+class KvCacheScaleCalibrator
+{
+public:
+    static KvCacheScaleCalibrator& getInstance();
+
+    KvCacheScaleCalibrator(KvCacheScaleCalibrator const&) = delete;
+    KvCacheScaleCalibrator& operator=(KvCacheScaleCalibrator const&) = delete;
+
+    ~KvCacheScaleCalibrator();
+
+    //! \brief Creates the state of an attention layer, updated by update() as long as it lives.
+    std::shared_ptr<KvCacheScaleCalibration> addLayer(float quantMax);
+
+    [[nodiscard]] bool hasLayers();
+
+    //! \brief Sets whether the attention kernels enqueued next on stream collect the absmax.
+    void setCollecting(bool collecting, cudaStream_t stream);
+
+    //! \brief Updates the scales of all the layers from the absmax collected since the last update. The KV cache must
+    //! not hold values quantized with the previous scales, unless it stores per-block scales.
+    void update(float margin, cudaStream_t stream);
+
+private:
+    friend void* ::getTrtLlmKvCacheScaleCalibrator();
+
+    KvCacheScaleCalibrator() = default;
+
+    std::mutex mMutex;
+    std::vector<std::weak_ptr<KvCacheScaleCalibration>> mLayers;
+    int* mCollect{nullptr};
+    bool mCollecting{false};
+};
+
+//! \brief Raises absMax to the largest magnitude of the keys and values of a context if *collect is set. Element
+//! (b, t, h, d) is read at (cu_seqlens ? cu_seqlens[b] * src_token_stride : b * src_batch_stride)
+//! + t * src_token_stride + h * src_head_stride + d, like in invokeQuantizeKvCacheBlocks.
+template <typename T>
+void invokeKvCacheAbsMax(float* absMax, int const* collect, T const* k_src, T const* v_src, int const* cu_seqlens,
+    int const* sequence_lengths, int local_batch_size, int seq_len, int size_per_head, int local_head_num,
+    int src_batch_stride, int src_token_stride, int src_head_stride, cudaStream_t stream);
+
+} // namespace kernels
+} // namespace tensorrt_llm
@@ -116,6 +116,15 @@ struct KVBlockArray
         // NOTE: we have remapped K layout as the same of V.
         return headIdx * mTokensPerBlock * dimsPerHead + getLocalIdx(globalTokenIdx) * dimsPerHead + channelIdx;
     }
+
+    __host__ __device__ inline float* getBlockScalePtr(void* blockPtr, int32_t headIdx, int32_t numHeads,
+        int32_t dimsPerHead)
+    {
+        // With KV cache block scaling, each 8-bit K or V block is followed by a sidecar holding one fp32
+        // dequantization scale per head: [numHeads, tokensPerBlock, hiddenSizePerHead] int8 | [numHeads] fp32.
+        return reinterpret_cast<float*>(reinterpret_cast<int8_t*>(blockPtr) + numHeads * mTokensPerBlock * dimsPerHead)
+            + headIdx;
+    }
 };
 
 struct KVLinearBuffer
@@ -175,11 +184,23 @@ struct KVLinearBuffer
         return reinterpret_cast<void*>(getRowPtr(KVIdxType::V_IDX, seqIdx));
     }
 
+    __host__ __device__ inline int32_t getLocalIdx(int32_t globalIdx)
+    {
+        return globalIdx;
+    }
+
     __host__ __device__ inline int32_t getKVLocalIdx(
         int32_t tokenIdx, int32_t headIdx, int32_t dimsPerHead, int32_t channelIdx)
     {
         return headIdx * mMaxSeqLen * dimsPerHead + tokenIdx * dimsPerHead + channelIdx;
     }
+
+    __host__ __device__ inline float* getBlockScalePtr(
+        void* /*blockPtr*/, int32_t /*headIdx*/, int32_t /*numHeads*/, int32_t /*dimsPerHead*/)
+    {
+        // Per-block scales are only supported by the paged KV cache.
+        return nullptr;
+    }
 };
 
 } // namespace kernels
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CUDART_VERSION
+#error CUDART_VERSION Undefined!
+#elif (CUDART_VERSION >= 11050)
+#include <cub/cub.cuh>
+#else
+#include "3rdparty/cub/cub.cuh"
+#endif
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/reduceKernelUtils.cuh"
+#include "tensorrt_llm/kernels/lmHeadTopK.h"
+
+#if ENABLE_BF16
+#include <cuda_bf16.h>
+#endif
+
+#include <cfloat>
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+template <typename T, int BLOCK_SIZE>
+__global__ void lmHeadTopKMerge(T* chunkLogits, int chunkSize, int validSize, int vocabOffset, float* topKLogits,
+    int* topKIds, int topK, bool firstChunk, T* fullLogits, int fullLogitsStride, const int* fullLogitsMask)
+{
+    typedef cub::BlockReduce<TopK_2<float>, BLOCK_SIZE> BlockReduce;
+    __shared__ typename BlockReduce::TempStorage tempStorage;
+    __shared__ float candidateLogits[kLmHeadMaxTopK];
+    __shared__ int candidateIds[kLmHeadMaxTopK];
+    __shared__ float selectedLogits[kLmHeadMaxTopK];
+    __shared__ int selectedIds[kLmHeadMaxTopK];
+
+    const int row = blockIdx.x;
+    const int tid = threadIdx.x;
+    T* rowLogits = chunkLogits + static_cast<size_t>(row) * chunkSize;
+    float* rowTopKLogits = topKLogits + row * topK;
+    int* rowTopKIds = topKIds + row * topK;
+
+    if (fullLogits != nullptr && fullLogitsMask[row] != 0)
+    {
+        T* rowFullLogits = fullLogits + static_cast<size_t>(row) * fullLogitsStride;
+        for (int i = tid; i < chunkSize; i += BLOCK_SIZE)
+        {
+            rowFullLogits[i] = rowLogits[i];
+        }
+    }
+    for (int i = tid; i < topK; i += BLOCK_SIZE)
+    {
+        candidateLogits[i] = firstChunk ? -FLT_MAX : rowTopKLogits[i];
+        candidateIds[i] = firstChunk ? -1 : rowTopKIds[i];
+    }
+    __syncthreads();
+
+    // The candidates take the indices after the chunk
+    for (int k = 0; k < topK; ++k)
+    {
+        TopK_2<float> partial;
+        for (int i = tid; i < validSize; i += BLOCK_SIZE)
+        {
+            partial.insert(static_cast<float>(rowLogits[i]), i);
+        }
+        for (int i = tid; i < topK; i += BLOCK_SIZE)
+        {
+            partial.insert(candidateLogits[i], chunkSize + i);
+        }
+        const TopK_2<float> total = BlockReduce(tempStorage).Reduce(partial, reduce_topk_op_2<float>);
+
+        if (tid == 0)
+        {
+            if (total.p < 0)
+            {
+                selectedLogits[k] = -FLT_MAX;
+                selectedIds[k] = -1;
+            }
+            else if (total.p < chunkSize)
+            {
+                selectedLogits[k] = total.u;
+                selectedIds[k] = vocabOffset + total.p;
+                rowLogits[total.p] = static_cast<T>(-INFINITY);
+            }
+            else
+            {
+                selectedLogits[k] = total.u;
+                selectedIds[k] = candidateIds[total.p - chunkSize];
+                candidateLogits[total.p - chunkSize] = -INFINITY;
+            }
+        }
+        __syncthreads();
+    }
+
+    for (int i = tid; i < topK; i += BLOCK_SIZE)
+    {
+        rowTopKLogits[i] = selectedLogits[i];
+        rowTopKIds[i] = selectedIds[i];
+    }
+}
+
+template <typename T>
+void invokeLmHeadTopKMerge(T* chunkLogits, int numRows, int chunkSize, int validSize, int vocabOffset,
+    float* topKLogits, int* topKIds, int topK, bool firstChunk, T* fullLogits, int fullLogitsStride,
+    const int* fullLogitsMask, cudaStream_t stream)
+{
+    TLLM_CHECK_WITH_INFO(0 < topK && topK <= kLmHeadMaxTopK, "The LM head keeps between 1 and %d candidates, got %d",
+        kLmHeadMaxTopK, topK);
+    constexpr int kBlockSize = 256;
+    lmHeadTopKMerge<T, kBlockSize><<<numRows, kBlockSize, 0, stream>>>(chunkLogits, chunkSize, validSize, vocabOffset,
+        topKLogits, topKIds, topK, firstChunk, fullLogits, fullLogitsStride, fullLogitsMask);
+    sync_check_cuda_error();
+}
+
+#define INSTANTIATE_LM_HEAD_TOP_K_MERGE(T)                                                                             \
+    template void invokeLmHeadTopKMerge<T>(T * chunkLogits, int numRows, int chunkSize, int validSize,                 \
+        int vocabOffset, float* topKLogits, int* topKIds, int topK, bool firstChunk, T* fullLogits,                   \
+        int fullLogitsStride, const int* fullLogitsMask, cudaStream_t stream)
+
+INSTANTIATE_LM_HEAD_TOP_K_MERGE(float);
+INSTANTIATE_LM_HEAD_TOP_K_MERGE(half);
+#ifdef ENABLE_BF16
+INSTANTIATE_LM_HEAD_TOP_K_MERGE(__nv_bfloat16);
+#endif
+
+} // namespace kernels
+} // namespace tensorrt_llm
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cuda_fp16.h>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+//! \brief Largest number of candidates kept per row by invokeLmHeadTopKMerge.
+constexpr int kLmHeadMaxTopK = 128;
+
+//! \brief Merges a chunk of the logits of the LM head into the running top K candidates of each row, so that the LM
+//! head can be computed chunk by chunk of the vocabulary without materializing the logits of the whole vocabulary.
+//!
+//! One block handles a row and selects the K largest values of the chunk and of the current candidates, in K passes
+//! over the chunk. The selected logits of the chunk are overwritten with -INFINITY.
+//!
+//! \param chunkLogits input/output buffer [numRows, chunkSize], logits of the tokens [vocabOffset, vocabOffset +
+//! chunkSize)
+//! \param numRows number of rows
+//! \param chunkSize size of the chunk
+//! \param validSize number of tokens of the chunk that may be selected, the rest is padding of the vocabulary
+//! \param vocabOffset id of the first token of the chunk
+//! \param topKLogits input/output buffer [numRows, topK], candidate logits in decreasing order, -FLT_MAX if there are
+//! fewer than topK tokens so far
+//! \param topKIds input/output buffer [numRows, topK], candidate token ids, -1 if there are fewer than topK tokens so
+//! far
+//! \param topK number of candidates per row, at most kLmHeadMaxTopK
+//! \param firstChunk the candidates are not initialized yet
+//! \param fullLogits output buffer [numRows, fullLogitsStride], pointing to the column of the first token of the chunk.
+//! The chunk is copied to the rows of fullLogitsMask before the selection. Ignored if nullptr
+//! \param fullLogitsStride stride of the rows of fullLogits
+//! \param fullLogitsMask input buffer [numRows], non zero for the rows whose full logits are required
+//! \param stream stream
+template <typename T>
+void invokeLmHeadTopKMerge(T* chunkLogits, int numRows, int chunkSize, int validSize, int vocabOffset,
+    float* topKLogits, int* topKIds, int topK, bool firstChunk, T* fullLogits, int fullLogitsStride,
+    const int* fullLogitsMask, cudaStream_t stream);
+
+} // namespace kernels
+} // namespace tensorrt_llm
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/logitsBitmask.h"
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+template <typename T>
+__global__ void applyLogitsBitmask(T* logits, const uint32_t* bitmask, int beamWidth, int vocabSizePadded)
+{
+    // One thread per word of the bitmask, the tokens of a word are contiguous in the logits
+    const int wordIdx = blockIdx.x * blockDim.x + threadIdx.x;
+    const int bitmaskSize = getLogitsBitmaskSize(vocabSizePadded);
+    if (wordIdx >= bitmaskSize)
+    {
+        return;
+    }
+
+    const int batchIdx = blockIdx.y / beamWidth;
+    const uint32_t word = bitmask[batchIdx * bitmaskSize + wordIdx];
+    if (word == 0xffffffffu)
+    {
+        return;
+    }
+
+    T* beamLogits = logits + static_cast<size_t>(blockIdx.y) * vocabSizePadded;
+    const int tokenEnd = min(vocabSizePadded, (wordIdx + 1) * 32);
+    for (int token = wordIdx * 32; token < tokenEnd; ++token)
+    {
+        if (((word >> (token % 32)) & 1u) == 0)
+        {
+            beamLogits[token] = static_cast<T>(-INFINITY);
+        }
+    }
+}
+
+template <typename T>
+void invokeApplyLogitsBitmask(
+    T* logits, const uint32_t* bitmask, int batchSize, int beamWidth, int vocabSizePadded, cudaStream_t stream)
+{
+    const int bitmaskSize = getLogitsBitmaskSize(vocabSizePadded);
+    dim3 block(min(256, ((bitmaskSize + 32 - 1) / 32) * 32));
+    dim3 grid((bitmaskSize + block.x - 1) / block.x, batchSize * beamWidth);
+
+    applyLogitsBitmask<<<grid, block, 0, stream>>>(logits, bitmask, beamWidth, vocabSizePadded);
+    sync_check_cuda_error();
+}
+
+template void invokeApplyLogitsBitmask(
+    float* logits, const uint32_t* bitmask, int batchSize, int beamWidth, int vocabSizePadded, cudaStream_t stream);
+template void invokeApplyLogitsBitmask(
+    half* logits, const uint32_t* bitmask, int batchSize, int beamWidth, int vocabSizePadded, cudaStream_t stream);
+#ifdef ENABLE_BF16
+template void invokeApplyLogitsBitmask(__nv_bfloat16* logits, const uint32_t* bitmask, int batchSize, int beamWidth,
+    int vocabSizePadded, cudaStream_t stream);
+#endif
+
+} // namespace kernels
+} // namespace tensorrt_llm
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cuda_fp16.h>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+//! \brief Returns the number of 32 bit words of the bitmask of one request.
+__host__ __device__ inline int getLogitsBitmaskSize(int vocabSizePadded)
+{
+    return (vocabSizePadded + 31) / 32;
+}
+
+//! \brief Sets the logits of the tokens that are not allowed by the bitmask of their request to -INFINITY.
+//!
+//! \param logits input/output buffer [batchSize, beamWidth, vocabSizePadded]
+//! \param bitmask input buffer [batchSize, getLogitsBitmaskSize(vocabSizePadded)]. Bit t % 32 of word t / 32 is set if
+//! token t is allowed. All the beams of a request share its bitmask
+//! \param batchSize batch size
+//! \param beamWidth beam width
+//! \param vocabSizePadded padded vocab size
+//! \param stream stream
+template <typename T>
+void invokeApplyLogitsBitmask(
+    T* logits, const uint32_t* bitmask, int batchSize, int beamWidth, int vocabSizePadded, cudaStream_t stream);
+
+} // namespace kernels
+} // namespace tensorrt_llm
@@ -17,6 +17,9 @@
 #include "tensorrt_llm/common/cudaTypeUtils.cuh"
 #include "tensorrt_llm/kernels/lookupKernels.h"
 
+#include <algorithm>
+#include <iterator>
+
 using namespace tensorrt_llm::common;
 
 namespace tensorrt_llm
@@ -69,6 +72,76 @@ void invokeLookUp(T* out, const Idx* input, const T* weight, const Idx batch_siz
     lookup_kernel<T, Idx><<<grid, block, 0, stream>>>(out, input, weight, batch_size, offset, size, n_embed);
 }
 
+/* Vocabulary parallel version of lookup_kernel: a block handles a token and, if the token is in the shard of the rank,
+writes its row to the comm buffers of all the ranks of the node, 16 bytes at a time when the rows are aligned. The
+tokens of the other shards are left to their owners, so no rank writes zeros and no reduction is needed.
+ */
+template <typename T, typename Idx, typename VecT>
+__global__ void vocab_parallel_lookup_kernel(AllReduceParams params, const Idx* input, const T* weight,
+    const Idx batch_size, const Idx offset, const Idx size, const int n_embed)
+{
+    static constexpr int kEltsPerVec = sizeof(VecT) / sizeof(T);
+    const int n_vecs = n_embed / kEltsPerVec;
+    for (int token = blockIdx.x; token < batch_size; token += gridDim.x)
+    {
+        const int word_index = input[token] - offset;
+        if (word_index < 0 || word_index >= size)
+        {
+            continue;
+        }
+        const VecT* src = reinterpret_cast<const VecT*>(weight + static_cast<size_t>(word_index) * n_embed);
+        for (int col = threadIdx.x; col < n_vecs; col += blockDim.x)
+        {
+            const VecT val = src[col];
+            for (int rank = 0; rank < params.ranks_per_node; ++rank)
+            {
+                // Start with the next rank so that the ranks do not all write to the same peer at once
+                const int peer = (params.local_rank + rank) % params.ranks_per_node;
+                VecT* dst = reinterpret_cast<VecT*>(
+                    static_cast<T*>(params.peer_comm_buffer_ptrs[peer]) + static_cast<size_t>(token) * n_embed);
+                dst[col] = val;
+            }
+        }
+    }
+}
+
+template <typename T, typename Idx>
+void invokeVocabParallelLookUp(AllReduceParams& params, T* out, const Idx* input, const T* weight, const Idx batch_size,
+    const Idx offset, const Idx size, const int n_embed, cudaStream_t stream)
+{
+    // Make sure all GPUs have finished using their peer_comm_buffer_ptrs in previous invocations
+    invokeMultiGpuBarrier(params, stream);
+
+    bool aligned = (n_embed * sizeof(T)) % sizeof(uint4) == 0
+        && reinterpret_cast<uintptr_t>(weight) % sizeof(uint4) == 0;
+    for (int rank = 0; rank < params.ranks_per_node; ++rank)
+    {
+        aligned = aligned && reinterpret_cast<uintptr_t>(params.peer_comm_buffer_ptrs[rank]) % sizeof(uint4) == 0;
+    }
+    dim3 grid(min(batch_size, 65536));
+    if (aligned)
+    {
+        dim3 block(min(n_embed / static_cast<int>(sizeof(uint4) / sizeof(T)), 512));
+        vocab_parallel_lookup_kernel<T, Idx, uint4>
+            <<<grid, block, 0, stream>>>(params, input, weight, batch_size, offset, size, n_embed);
+    }
+    else
+    {
+        dim3 block(min(n_embed, 512));
+        vocab_parallel_lookup_kernel<T, Idx, T>
+            <<<grid, block, 0, stream>>>(params, input, weight, batch_size, offset, size, n_embed);
+    }
+
+    // Wait for the rows of the other shards, with the second set of flags like the all-reduce kernels
+    AllReduceParams arrived = params;
+    std::copy(std::begin(params.peer_barrier_ptrs_in), std::end(params.peer_barrier_ptrs_in),
+        std::begin(arrived.peer_barrier_ptrs_out));
+    invokeMultiGpuBarrier(arrived, stream);
+    cudaMemcpyAsync(out, params.peer_comm_buffer_ptrs[params.local_rank],
+        static_cast<size_t>(batch_size) * n_embed * sizeof(T), cudaMemcpyDeviceToDevice, stream);
+    sync_check_cuda_error();
+}
+
 #define INSTANTIATE_LOOK_UP(T, Idx)                                                                                    \
     template void invokeLookUp<T, Idx>(T * out, const Idx* input, const T* weight, const Idx batch_size,               \
         const Idx offset, const Idx size, const int n_embed, cudaStream_t stream)
@@ -80,5 +153,16 @@ INSTANTIATE_LOOK_UP(half, int);
 INSTANTIATE_LOOK_UP(__nv_bfloat16, int);
 #endif
 
+#define INSTANTIATE_VOCAB_PARALLEL_LOOK_UP(T, Idx)                                                                     \
+    template void invokeVocabParallelLookUp<T, Idx>(AllReduceParams & params, T * out, const Idx* input,               \
+        const T* weight, const Idx batch_size, const Idx offset, const Idx size, const int n_embed, cudaStream_t stream)
+
+INSTANTIATE_VOCAB_PARALLEL_LOOK_UP(float, int);
+INSTANTIATE_VOCAB_PARALLEL_LOOK_UP(half, int);
+
+#ifdef ENABLE_BF16
+INSTANTIATE_VOCAB_PARALLEL_LOOK_UP(__nv_bfloat16, int);
+#endif
+
 } // namespace kernels
 } // namespace tensorrt_llm
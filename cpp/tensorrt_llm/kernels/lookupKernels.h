@@ -17,6 +17,7 @@
 #pragma once
 
 #include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/customAllReduceKernels.h"
 #include <assert.h>
 #include <cuda_fp16.h>
 #include <cuda_runtime.h>
@@ -29,5 +30,16 @@ template <typename T, typename Idx>
 void invokeLookUp(T* out, const Idx* input, const T* weight, const Idx batch_size, const Idx offset, const Idx size,
     const int n_embed, cudaStream_t stream = 0);
 
+//! \brief Lookup in an embedding table split along the vocabulary between the ranks of a node, combined through the
+//! peer comm buffers of the custom all-reduce instead of an all-reduce of zero-filled lookups.
+//!
+//! Each rank pushes only the rows of the tokens of its shard, [offset, offset + size), to the comm buffers of all the
+//! ranks, so every row crosses NVLink once per peer and nothing is summed. After a barrier, every rank copies the
+//! complete [batch_size, n_embed] embedding from its comm buffer to out. params must have been deserialized from the
+//! all-reduce workspace of the node, which must hold all the ranks of the group.
+template <typename T, typename Idx>
+void invokeVocabParallelLookUp(AllReduceParams& params, T* out, const Idx* input, const T* weight, const Idx batch_size,
+    const Idx offset, const Idx size, const int n_embed, cudaStream_t stream = 0);
+
 } // namespace kernels
 } // namespace tensorrt_llm
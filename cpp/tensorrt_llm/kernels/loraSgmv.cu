@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/cudaTypeUtils.cuh"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/reduceKernelUtils.cuh"
+#include "tensorrt_llm/kernels/loraSgmv.h"
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+namespace
+{
+constexpr int kSgmvBlockSize = 128;
+constexpr int kSgmvNumWarps = kSgmvBlockSize / 32;
+// Output columns computed by a warp of the expand phase
+constexpr int kExpandColsPerWarp = 8;
+constexpr int kExpandColsPerBlock = kSgmvNumWarps * kExpandColsPerWarp;
+} // namespace
+
+template <typename T>
+__global__ void loraSgmvShrink(LoraSgmvProblem const* problems, int inHiddenSize, int lowRankStride)
+{
+    LoraSgmvProblem const& problem = problems[blockIdx.x];
+    const int row = blockIdx.y;
+    if (row >= problem.numRows)
+    {
+        return;
+    }
+
+    const T* input = static_cast<const T*>(problem.input) + static_cast<size_t>(row) * inHiddenSize;
+    const T* weight = static_cast<const T*>(problem.inWeight);
+    T* lowRank = static_cast<T*>(problem.lowRank) + static_cast<size_t>(row) * lowRankStride;
+
+    // One warp per rank, the lanes stride over the hidden size so that the loads of a row are coalesced
+    const int warpIdx = threadIdx.x / 32;
+    const int laneIdx = threadIdx.x % 32;
+    for (int r = warpIdx; r < problem.rank; r += kSgmvNumWarps)
+    {
+        const T* weightRow = weight + static_cast<size_t>(r) * inHiddenSize;
+        float sum = 0.f;
+        for (int k = laneIdx; k < inHiddenSize; k += 32)
+        {
+            sum += cuda_cast<float>(input[k]) * cuda_cast<float>(weightRow[k]);
+        }
+        sum = warpReduceSum(sum);
+        if (laneIdx == 0)
+        {
+            lowRank[r] = cuda_cast<T>(sum);
+        }
+    }
+}
+
+template <typename T>
+__global__ void loraSgmvExpand(LoraSgmvProblem const* problems, int lowRankStride)
+{
+    LoraSgmvProblem const& problem = problems[blockIdx.x];
+    const int row = blockIdx.y;
+    const int colBegin = blockIdx.z * kExpandColsPerBlock;
+    if (row >= problem.numRows || colBegin >= problem.outHiddenSize)
+    {
+        return;
+    }
+
+    const T* lowRank = static_cast<const T*>(problem.lowRank) + static_cast<size_t>(row) * lowRankStride;
+    const T* weight = static_cast<const T*>(problem.outWeight);
+    T* output = static_cast<T*>(problem.output) + static_cast<size_t>(row) * problem.outHiddenSize;
+
+    // The lanes stride over the rank, a warp computes a few columns of the output
+    const int warpIdx = threadIdx.x / 32;
+    const int laneIdx = threadIdx.x % 32;
+    const int colEnd = min(colBegin + (warpIdx + 1) * kExpandColsPerWarp, problem.outHiddenSize);
+    for (int col = colBegin + warpIdx * kExpandColsPerWarp; col < colEnd; ++col)
+    {
+        const T* weightRow = weight + static_cast<size_t>(col) * problem.rank;
+        float sum = 0.f;
+        for (int r = laneIdx; r < problem.rank; r += 32)
+        {
+            sum += cuda_cast<float>(lowRank[r]) * cuda_cast<float>(weightRow[r]);
+        }
+        sum = warpReduceSum(sum);
+        if (laneIdx == 0)
+        {
+            output[col] = cuda_cast<T>(sum);
+        }
+    }
+}
+
+template <typename T>
+void invokeLoraSgmv(LoraSgmvProblem const* problems, int numProblems, int maxNumRows, int maxOutHiddenSize,
+    int inHiddenSize, int lowRankStride, cudaStream_t stream)
+{
+    if (numProblems == 0 || maxNumRows == 0)
+    {
+        return;
+    }
+    dim3 block(kSgmvBlockSize);
+
+    dim3 shrinkGrid(numProblems, maxNumRows);
+    loraSgmvShrink<T><<<shrinkGrid, block, 0, stream>>>(problems, inHiddenSize, lowRankStride);
+    sync_check_cuda_error();
+
+    dim3 expandGrid(numProblems, maxNumRows, divUp(maxOutHiddenSize, kExpandColsPerBlock));
+    loraSgmvExpand<T><<<expandGrid, block, 0, stream>>>(problems, lowRankStride);
+    sync_check_cuda_error();
+}
+
+template void invokeLoraSgmv<float>(LoraSgmvProblem const* problems, int numProblems, int maxNumRows,
+    int maxOutHiddenSize, int inHiddenSize, int lowRankStride, cudaStream_t stream);
+template void invokeLoraSgmv<half>(LoraSgmvProblem const* problems, int numProblems, int maxNumRows,
+    int maxOutHiddenSize, int inHiddenSize, int lowRankStride, cudaStream_t stream);
+#ifdef ENABLE_BF16
+template void invokeLoraSgmv<__nv_bfloat16>(LoraSgmvProblem const* problems, int numProblems, int maxNumRows,
+    int maxOutHiddenSize, int inHiddenSize, int lowRankStride, cudaStream_t stream);
+#endif
+
+} // namespace kernels
+} // namespace tensorrt_llm
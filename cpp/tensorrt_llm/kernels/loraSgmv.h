@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+//! \brief One request and one LoRA module of a segmented gather-matmul: the rows of the request go through the low
+//! rank projections of its own adapter.
+struct LoraSgmvProblem
+{
+    //! First row of the request in the input [numTokens, inHiddenSize]
+    void const* input;
+    //! First row of the request in the low rank buffer, at the column of the module
+    void* lowRank;
+    //! First row of the request in the output of the module [numTokens, outHiddenSize]
+    void* output;
+    //! Weights of the first projection [rank, inHiddenSize]
+    void const* inWeight;
+    //! Weights of the second projection [outHiddenSize, rank]
+    void const* outWeight;
+    int32_t numRows;
+    int32_t rank;
+    int32_t outHiddenSize;
+};
+
+//! \brief Runs the LoRA projections of all the problems, each with its own adapter weights, in one launch for the
+//! shrink phase (input to low rank) and one for the expand phase (low rank to output).
+//!
+//! Meant for the requests with a few rows, e.g. in the generation phase, where a GEMM per request would be a launch
+//! with a mostly empty tile.
+//!
+//! \param problems input buffer [numProblems] on the device
+//! \param numProblems number of problems
+//! \param maxNumRows largest number of rows of the problems
+//! \param maxOutHiddenSize largest output hidden size of the problems
+//! \param inHiddenSize input hidden size, shared by all the problems
+//! \param lowRankStride number of elements between two rows of the low rank buffer
+//! \param stream stream
+template <typename T>
+void invokeLoraSgmv(LoraSgmvProblem const* problems, int numProblems, int maxNumRows, int maxOutHiddenSize,
+    int inHiddenSize, int lowRankStride, cudaStream_t stream);
+
+} // namespace kernels
+} // namespace tensorrt_llm
@@ -0,0 +1,272 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cuda_fp16.h>
+
+// Ignore CUTLASS warnings about type punning
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wstrict-aliasing"
+
+#include "cutlass/epilogue/thread/activation.h"
+
+#pragma GCC diagnostic pop
+
+#include "tensorrt_llm/common/cudaBf16Wrapper.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/mixtureOfExperts/moe_gemv_kernels.h"
+
+#ifndef CUDART_VERSION
+#error CUDART_VERSION Undefined!
+#elif (CUDART_VERSION >= 11050)
+#include <cub/cub.cuh>
+#else
+#include "3rdparty/cub/cub.cuh"
+#endif
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm::kernels
+{
+
+// The work list starts with the number of items, padded to keep the items aligned
+static constexpr int WORK_LIST_HEADER_BYTES = 16;
+
+static int getMoeGemvMaxItems(const int num_rows, const int num_experts)
+{
+    // Each expert has at most one partial chunk
+    return ceilDiv(num_rows, MOE_GEMV_ROWS_PER_ITEM) + num_experts;
+}
+
+size_t getMoeGemvWorkListSize(const int num_rows, const int num_experts)
+{
+    return WORK_LIST_HEADER_BYTES + getMoeGemvMaxItems(num_rows, num_experts) * sizeof(int2);
+}
+
+template <int BLOCK_SIZE>
+__global__ void buildMoeGemvWorkListKernel(
+    const int64_t* total_rows_before_expert, const int num_experts, int* num_items, int2* items)
+{
+    using BlockScan = cub::BlockScan<int, BLOCK_SIZE>;
+    __shared__ typename BlockScan::TempStorage temp_storage;
+
+    int offset = 0;
+    for (int first_expert = 0; first_expert < num_experts; first_expert += BLOCK_SIZE)
+    {
+        const int expert = first_expert + threadIdx.x;
+        int64_t row_begin = 0;
+        int64_t row_end = 0;
+        if (expert < num_experts)
+        {
+            row_begin = expert == 0 ? 0 : total_rows_before_expert[expert - 1];
+            row_end = total_rows_before_expert[expert];
+        }
+        const int expert_items = ceilDiv(row_end - row_begin, int64_t{MOE_GEMV_ROWS_PER_ITEM});
+
+        int first_item;
+        int block_items;
+        BlockScan(temp_storage).ExclusiveSum(expert_items, first_item, block_items);
+        for (int i = 0; i < expert_items; ++i)
+        {
+            items[offset + first_item + i] = make_int2(expert, row_begin + i * MOE_GEMV_ROWS_PER_ITEM);
+        }
+        offset += block_items;
+        // The temp storage is reused by the next experts
+        __syncthreads();
+    }
+
+    if (threadIdx.x == 0)
+    {
+        *num_items = offset;
+    }
+}
+
+void buildMoeGemvWorkList(
+    const int64_t* total_rows_before_expert, const int num_experts, void* work_list, cudaStream_t stream)
+{
+    static constexpr int BLOCK_SIZE = 256;
+    auto* num_items = static_cast<int*>(work_list);
+    auto* items = reinterpret_cast<int2*>(static_cast<char*>(work_list) + WORK_LIST_HEADER_BYTES);
+    buildMoeGemvWorkListKernel<BLOCK_SIZE>
+        <<<1, BLOCK_SIZE, 0, stream>>>(total_rows_before_expert, num_experts, num_items, items);
+}
+
+template <typename T>
+bool isMoeGemvSupported(const int64_t gemm_n, const int64_t gemm_k)
+{
+    static constexpr int VEC_SIZE = 16 / sizeof(T);
+    return gemm_n > 0 && gemm_k % VEC_SIZE == 0;
+}
+
+template <typename T, typename ActFn, bool GATED, int WARPS>
+__global__ void __launch_bounds__(WARPS * 32) moeGemvKernel(const T* A, const T* B, const T* biases, T* C,
+    const int64_t* total_rows_before_expert, const int* num_items, const int2* items, const int64_t gemm_n,
+    const int64_t gemm_k)
+{
+    static constexpr int VEC_SIZE = 16 / sizeof(T);
+    static constexpr int ROWS = MOE_GEMV_ROWS_PER_ITEM;
+
+    const int warp = threadIdx.x / 32;
+    const int lane = threadIdx.x % 32;
+    const int64_t b_cols = GATED ? 2 * gemm_n : gemm_n;
+    const int64_t col_tiles = ceilDiv(gemm_n, int64_t{WARPS});
+    const int64_t num_work = *num_items * col_tiles;
+
+    // Each warp computes one output column for all the rows of an item, the warps of a block are independent
+    for (int64_t work = blockIdx.x; work < num_work; work += gridDim.x)
+    {
+        const int2 item = items[work / col_tiles];
+        const int64_t col = (work % col_tiles) * WARPS + warp;
+        if (col >= gemm_n)
+        {
+            continue;
+        }
+        const int expert = item.x;
+        const int64_t row_begin = item.y;
+        const int num_rows = min(static_cast<int64_t>(ROWS), total_rows_before_expert[expert] - row_begin);
+
+        const T* b_ptr = B + expert * gemm_k * b_cols + col * gemm_k;
+        const T* b_gate_ptr = b_ptr + gemm_n * gemm_k;
+        const T* a_ptr = A + row_begin * gemm_k;
+
+        float acc[ROWS] = {};
+        float acc_gate[ROWS] = {};
+        for (int64_t k = lane * VEC_SIZE; k < gemm_k; k += 32 * VEC_SIZE)
+        {
+            T b_vals[VEC_SIZE];
+            T b_gate_vals[VEC_SIZE];
+            *reinterpret_cast<uint4*>(b_vals) = *reinterpret_cast<const uint4*>(b_ptr + k);
+            if constexpr (GATED)
+            {
+                *reinterpret_cast<uint4*>(b_gate_vals) = *reinterpret_cast<const uint4*>(b_gate_ptr + k);
+            }
+#pragma unroll
+            for (int r = 0; r < ROWS; ++r)
+            {
+                if (r < num_rows)
+                {
+                    T a_vals[VEC_SIZE];
+                    *reinterpret_cast<uint4*>(a_vals) = *reinterpret_cast<const uint4*>(a_ptr + r * gemm_k + k);
+#pragma unroll
+                    for (int v = 0; v < VEC_SIZE; ++v)
+                    {
+                        const float a = static_cast<float>(a_vals[v]);
+                        acc[r] += a * static_cast<float>(b_vals[v]);
+                        if constexpr (GATED)
+                        {
+                            acc_gate[r] += a * static_cast<float>(b_gate_vals[v]);
+                        }
+                    }
+                }
+            }
+        }
+
+#pragma unroll
+        for (int r = 0; r < ROWS; ++r)
+        {
+#pragma unroll
+            for (int mask = 16; mask > 0; mask >>= 1)
+            {
+                acc[r] += __shfl_xor_sync(0xffffffff, acc[r], mask);
+                if constexpr (GATED)
+                {
+                    acc_gate[r] += __shfl_xor_sync(0xffffffff, acc_gate[r], mask);
+                }
+            }
+        }
+
+        if (lane == 0)
+        {
+            ActFn fn{};
+            const T* bias_ptr = biases ? biases + expert * b_cols : nullptr;
+            const float bias = bias_ptr ? static_cast<float>(bias_ptr[col]) : 0.f;
+            const float bias_gate = GATED && bias_ptr ? static_cast<float>(bias_ptr[col + gemm_n]) : 0.f;
+            for (int r = 0; r < num_rows; ++r)
+            {
+                const float value = acc[r] + bias;
+                const float output = GATED ? value * fn(acc_gate[r] + bias_gate) : fn(value);
+                C[(row_begin + r) * gemm_n + col] = static_cast<T>(output);
+            }
+        }
+    }
+}
+
+template <typename T, typename ActFn, bool GATED>
+void moeGemvLauncher(const T* A, const T* B, const T* biases, T* C, const int64_t* total_rows_before_expert,
+    const void* work_list, const int64_t gemm_n, const int64_t gemm_k, const int multi_processor_count,
+    cudaStream_t stream)
+{
+    static constexpr int WARPS = 8;
+    // Enough persistent blocks to fill the GPU, the ones without work exit immediately
+    static constexpr int BLOCKS_PER_SM = 4;
+    const auto* num_items = static_cast<const int*>(work_list);
+    const auto* items = reinterpret_cast<const int2*>(static_cast<const char*>(work_list) + WORK_LIST_HEADER_BYTES);
+    moeGemvKernel<T, ActFn, GATED, WARPS><<<multi_processor_count * BLOCKS_PER_SM, WARPS * 32, 0, stream>>>(
+        A, B, biases, C, total_rows_before_expert, num_items, items, gemm_n, gemm_k);
+}
+
+template <typename T>
+void moeGemvBiasAct(const T* A, const T* B, const T* biases, T* C, const int64_t* total_rows_before_expert,
+    const void* work_list, const int64_t gemm_n, const int64_t gemm_k, ActivationType activation_type,
+    const int multi_processor_count, cudaStream_t stream)
+{
+    using namespace cutlass::epilogue::thread;
+    switch (activation_type)
+    {
+    case ActivationType::Relu:
+        moeGemvLauncher<T, ReLu<float>, false>(A, B, biases, C, total_rows_before_expert, work_list, gemm_n, gemm_k,
+            multi_processor_count, stream);
+        break;
+    case ActivationType::Gelu:
+        moeGemvLauncher<T, GELU_taylor<float>, false>(A, B, biases, C, total_rows_before_expert, work_list, gemm_n,
+            gemm_k, multi_processor_count, stream);
+        break;
+    case ActivationType::Silu:
+        moeGemvLauncher<T, SiLu<float>, false>(A, B, biases, C, total_rows_before_expert, work_list, gemm_n, gemm_k,
+            multi_processor_count, stream);
+        break;
+    case ActivationType::Identity:
+        moeGemvLauncher<T, Identity<float>, false>(A, B, biases, C, total_rows_before_expert, work_list, gemm_n,
+            gemm_k, multi_processor_count, stream);
+        break;
+    case ActivationType::Swiglu:
+        moeGemvLauncher<T, SiLu<float>, true>(A, B, biases, C, total_rows_before_expert, work_list, gemm_n, gemm_k,
+            multi_processor_count, stream);
+        break;
+    case ActivationType::Geglu:
+        moeGemvLauncher<T, GELU<float>, true>(A, B, biases, C, total_rows_before_expert, work_list, gemm_n, gemm_k,
+            multi_processor_count, stream);
+        break;
+    default: TLLM_THROW("Invalid activation type."); break;
+    }
+    sync_check_cuda_error();
+}
+
+#define INSTANTIATE_MOE_GEMV(T)                                                                                        \
+    template bool isMoeGemvSupported<T>(const int64_t gemm_n, const int64_t gemm_k);                                   \
+    template void moeGemvBiasAct<T>(const T* A, const T* B, const T* biases, T* C,                                     \
+        const int64_t* total_rows_before_expert, const void* work_list, const int64_t gemm_n, const int64_t gemm_k,    \
+        ActivationType activation_type, const int multi_processor_count, cudaStream_t stream)
+
+INSTANTIATE_MOE_GEMV(float);
+INSTANTIATE_MOE_GEMV(half);
+#ifdef ENABLE_BF16
+INSTANTIATE_MOE_GEMV(__nv_bfloat16);
+#endif
+
+#undef INSTANTIATE_MOE_GEMV
+
+} // namespace tensorrt_llm::kernels
@@ -0,0 +1,70 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#include "tensorrt_llm/kernels/cutlass_kernels/moe_gemm/moe_gemm_kernels.h"
+#include <cuda_runtime_api.h>
+
+namespace tensorrt_llm::kernels
+{
+
+/*
+  Persistent grouped GEMV for the MoE layers at decode batch sizes, where most experts get no or a handful of rows and
+  the tiles of the grouped GEMM are mostly idle.
+
+  The work list is built on the device from total_rows_before_expert: one item per chunk of at most
+  MOE_GEMV_ROWS_PER_ITEM rows of an expert, so the experts without rows have no item. A fixed grid of persistent
+  blocks then loops over the items and the output columns, the host never reads the number of rows per expert.
+*/
+
+// Largest number of expanded rows (num_rows x k) the runner uses the GEMV for
+static constexpr int MOE_GEMV_MAX_ROWS = 32;
+static constexpr int MOE_GEMV_ROWS_PER_ITEM = 8;
+
+// Size in bytes of the work list of a problem with num_rows expanded rows
+size_t getMoeGemvWorkListSize(const int num_rows, const int num_experts);
+
+/*
+  Params:
+  total_rows_before_expert - [num_experts] index one past the last row of each expert, as for MoeGemmRunner
+  work_list - buffer of getMoeGemvWorkListSize bytes
+*/
+void buildMoeGemvWorkList(
+    const int64_t* total_rows_before_expert, const int num_experts, void* work_list, cudaStream_t stream);
+
+// The weights are [num_experts, gemm_n, gemm_k] (column major B as for the non-quantized MoeGemmRunner), and the K
+// dimension must be a multiple of 16 bytes.
+template <typename T>
+bool isMoeGemvSupported(const int64_t gemm_n, const int64_t gemm_k);
+
+/*
+  C = act(A * B + biases) for the rows of each expert. For the gated activations B holds 2 * gemm_n columns, and the
+  output is the first half times the activated second half, as doGatedActivation.
+
+  Params:
+  A - [total_rows, gemm_k] rows sorted by expert
+  B - [num_experts, gemm_n (x2 if gated), gemm_k]
+  biases - [num_experts, gemm_n (x2 if gated)] or nullptr
+  C - [total_rows, gemm_n]
+  work_list - built by buildMoeGemvWorkList
+*/
+template <typename T>
+void moeGemvBiasAct(const T* A, const T* B, const T* biases, T* C, const int64_t* total_rows_before_expert,
+    const void* work_list, const int64_t gemm_n, const int64_t gemm_k, ActivationType activation_type,
+    const int multi_processor_count, cudaStream_t stream);
+
+} // namespace tensorrt_llm::kernels
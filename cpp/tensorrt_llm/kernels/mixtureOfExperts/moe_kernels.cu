@@ -634,6 +634,275 @@ void expandInputRowsKernelLauncher(const T* unpermuted_input, T* permuted_output
         expanded_source_row_to_expanded_dest_row, num_rows, num_valid_tokens_ptr, cols);
 }
 
+// ========================== Fused routing things =======================================
+
+// Single launch replacing the top-k softmax, the sort, the rows-before-expert search and the row expansion when the
+// batch is small. Every block computes the routing of the whole batch in shared memory, so no grid-wide sync is needed
+// before the blocks copy their share of the rows. Only used with few rows and small power of 2 numbers of experts,
+// where this redundant work is cheaper than the extra launches.
+static constexpr int FUSED_ROUTING_TPB = 256;
+static constexpr int FUSED_ROUTING_MAX_EXPANDED_ROWS = 256;
+static constexpr int FUSED_ROUTING_MAX_BLOCKS = 32;
+
+static bool isFusedMoeRoutingSupported(const int num_rows, const int num_experts, const int k)
+{
+    const bool supported_experts = num_experts == 8 || num_experts == 16 || num_experts == 64;
+    return supported_experts && num_rows * k <= FUSED_ROUTING_MAX_EXPANDED_ROWS;
+}
+
+template <typename T, int NUM_EXPERTS>
+__launch_bounds__(FUSED_ROUTING_TPB) __global__ void fusedMoeRoutingKernel(const float* gating_output,
+    const bool* finished, const T* unpermuted_input, T* permuted_output, float* expert_scales,
+    int* expert_for_source_row, int* expanded_source_row_to_expanded_dest_row, int64_t* total_rows_before_expert,
+    const int num_rows, const int cols, const int k, const int start_expert, const int end_expert,
+    const int num_experts_per_node, const int num_active_expanded_rows)
+{
+    static_assert(NUM_EXPERTS % 4 == 0, "The gating rows are loaded as float4");
+
+    __shared__ int selected_experts[FUSED_ROUTING_MAX_EXPANDED_ROWS];
+    __shared__ int expanded_dest_row_to_expanded_source_row[FUSED_ROUTING_MAX_EXPANDED_ROWS];
+    // One more bucket for the rows this node does not process
+    __shared__ int expert_offsets[NUM_EXPERTS + 1];
+    __shared__ int num_dest_rows;
+
+    // Only the first block writes the routing, the others keep it in shared memory
+    const bool write_routing = blockIdx.x == 0;
+    const int num_expanded_rows = num_rows * k;
+
+    for (int expert = threadIdx.x; expert <= NUM_EXPERTS; expert += FUSED_ROUTING_TPB)
+    {
+        expert_offsets[expert] = 0;
+    }
+    __syncthreads();
+
+    // Softmax and top-k, one thread per row
+    for (int row = threadIdx.x; row < num_rows; row += FUSED_ROUTING_TPB)
+    {
+        float row_vals[NUM_EXPERTS];
+        const auto* row_ptr = reinterpret_cast<const float4*>(gating_output + row * NUM_EXPERTS);
+#pragma unroll
+        for (int ii = 0; ii < NUM_EXPERTS / 4; ++ii)
+        {
+            const float4 vals = row_ptr[ii];
+            row_vals[4 * ii] = vals.x;
+            row_vals[4 * ii + 1] = vals.y;
+            row_vals[4 * ii + 2] = vals.z;
+            row_vals[4 * ii + 3] = vals.w;
+        }
+
+        float max_val = row_vals[0];
+#pragma unroll
+        for (int ii = 1; ii < NUM_EXPERTS; ++ii)
+        {
+            max_val = max(max_val, row_vals[ii]);
+        }
+
+        float row_sum = 0;
+#pragma unroll
+        for (int ii = 0; ii < NUM_EXPERTS; ++ii)
+        {
+            row_vals[ii] = expf(row_vals[ii] - max_val);
+            row_sum += row_vals[ii];
+        }
+
+        const float reciprocal_row_sum = 1.f / row_sum;
+#pragma unroll
+        for (int ii = 0; ii < NUM_EXPERTS; ++ii)
+        {
+            row_vals[ii] = row_vals[ii] * reciprocal_row_sum;
+        }
+
+        const bool row_is_active = finished ? !finished[row] : true;
+        for (int k_idx = 0; k_idx < k; ++k_idx)
+        {
+            // Lower indices win the ties, as in topkGatingSoftmax
+            float max_prob = -1.f;
+            int expert = 0;
+#pragma unroll
+            for (int ii = 0; ii < NUM_EXPERTS; ++ii)
+            {
+                if (row_vals[ii] > max_prob)
+                {
+                    max_prob = row_vals[ii];
+                    expert = ii;
+                }
+            }
+#pragma unroll
+            for (int ii = 0; ii < NUM_EXPERTS; ++ii)
+            {
+                // Safe to set to any negative value since the probabilities are between 0 and 1
+                row_vals[ii] = ii == expert ? -10000.f : row_vals[ii];
+            }
+
+            const bool node_uses_expert = expert >= start_expert && expert < end_expert;
+            const bool should_process_row = row_is_active && node_uses_expert;
+            const int selected_expert = should_process_row ? (expert - start_expert) : NUM_EXPERTS;
+
+            const int idx = k * row + k_idx;
+            selected_experts[idx] = selected_expert;
+            atomicAdd(&expert_offsets[selected_expert], 1);
+            if (write_routing)
+            {
+                expert_scales[idx] = max_prob;
+                expert_for_source_row[idx] = selected_expert;
+            }
+        }
+    }
+    __syncthreads();
+
+    if (threadIdx.x == 0)
+    {
+        // Turn the counts into offsets. The rows beyond the active ones are not processed, as with
+        // computeTotalRowsBeforeExpert
+        int offset = 0;
+        for (int expert = 0; expert <= NUM_EXPERTS; ++expert)
+        {
+            const int count = expert_offsets[expert];
+            expert_offsets[expert] = offset;
+            offset += count;
+            if (write_routing && expert < num_experts_per_node)
+            {
+                total_rows_before_expert[expert] = min(offset, num_active_expanded_rows);
+            }
+            if (expert == num_experts_per_node - 1)
+            {
+                num_dest_rows = min(offset, num_active_expanded_rows);
+            }
+        }
+    }
+    __syncthreads();
+
+    // Stable ranks within each expert, so the rows are in the same order as after the radix sort
+    for (int idx = threadIdx.x; idx < num_expanded_rows; idx += FUSED_ROUTING_TPB)
+    {
+        const int expert = selected_experts[idx];
+        int rank = 0;
+        for (int prior_idx = 0; prior_idx < idx; ++prior_idx)
+        {
+            rank += selected_experts[prior_idx] == expert;
+        }
+
+        const int expanded_dest_row = expert_offsets[expert] + rank;
+        const int expanded_source_row = (idx % k) * num_rows + idx / k;
+        expanded_dest_row_to_expanded_source_row[expanded_dest_row] = expanded_source_row;
+        if (write_routing)
+        {
+            expanded_source_row_to_expanded_dest_row[expanded_source_row] = expanded_dest_row;
+        }
+    }
+    __syncthreads();
+
+    // Duplicate and permute the rows of the experts of this node
+    for (int expanded_dest_row = blockIdx.x; expanded_dest_row < num_dest_rows; expanded_dest_row += gridDim.x)
+    {
+        const int source_row = expanded_dest_row_to_expanded_source_row[expanded_dest_row] % num_rows;
+
+        const T* source_row_ptr = unpermuted_input + source_row * cols;
+        T* dest_row_ptr = permuted_output + expanded_dest_row * cols;
+
+        for (int tid = threadIdx.x; tid < cols; tid += FUSED_ROUTING_TPB)
+        {
+            dest_row_ptr[tid] = source_row_ptr[tid];
+        }
+    }
+}
+
+template <typename T>
+void fusedMoeRoutingKernelLauncher(const float* gating_output, const bool* finished, const T* unpermuted_input,
+    T* permuted_output, float* expert_scales, int* expert_for_source_row, int* expanded_source_row_to_expanded_dest_row,
+    int64_t* total_rows_before_expert, const int num_rows, const int cols, const int num_experts, const int k,
+    const int start_expert, const int end_expert, const int num_active_expanded_rows, cudaStream_t stream)
+{
+    const int blocks = std::min(num_rows * k, FUSED_ROUTING_MAX_BLOCKS);
+    const int num_experts_per_node = end_expert - start_expert;
+
+    auto func = &fusedMoeRoutingKernel<T, 8>;
+    switch (num_experts)
+    {
+    case 8: func = &fusedMoeRoutingKernel<T, 8>; break;
+    case 16: func = &fusedMoeRoutingKernel<T, 16>; break;
+    case 64: func = &fusedMoeRoutingKernel<T, 64>; break;
+    default: TLLM_THROW("Unsupported number of experts for the fused routing: %d", num_experts);
+    }
+    func<<<blocks, FUSED_ROUTING_TPB, 0, stream>>>(gating_output, finished, unpermuted_input, permuted_output,
+        expert_scales, expert_for_source_row, expanded_source_row_to_expanded_dest_row, total_rows_before_expert,
+        num_rows, cols, k, start_expert, end_expert, num_experts_per_node, num_active_expanded_rows);
+}
+
+// ========================== Expert load things =======================================
+
+// Keeps the rows of the experts this node processes and maps them to their index in the local weights, the other rows
+// select expert num_experts as in topkGatingSoftmax. The rows of a replicated expert are split round-robin between
+// the nodes by token, all the nodes see the same tokens so they agree on the split without communicating.
+__global__ void assignReplicatedExpertsKernel(int* expert_for_source_row, const int num_expanded_rows,
+    const int num_experts, const int k, const int num_experts_per_node, const int ep_size, const int ep_rank,
+    const MOEExpertReplication replication)
+{
+    const int expanded_row = blockIdx.x * blockDim.x + threadIdx.x;
+    if (expanded_row >= num_expanded_rows)
+    {
+        return;
+    }
+
+    const int expert = expert_for_source_row[expanded_row];
+    if (expert >= num_experts)
+    {
+        // Finished row
+        return;
+    }
+
+    int replica = -1;
+    for (int i = 0; i < replication.num_replicated_experts; ++i)
+    {
+        replica = replication.replicated_experts[i] == expert ? i : replica;
+    }
+
+    const int owner = expert / num_experts_per_node;
+    int local_expert = num_experts;
+    if (replica < 0 && owner == ep_rank)
+    {
+        local_expert = expert - ep_rank * num_experts_per_node;
+    }
+    else if (replica >= 0 && (expanded_row / k) % ep_size == ep_rank)
+    {
+        // The owner processes its share with its own copy
+        local_expert = owner == ep_rank ? expert - ep_rank * num_experts_per_node : num_experts_per_node + replica;
+    }
+    expert_for_source_row[expanded_row] = local_expert;
+}
+
+void assignReplicatedExpertsKernelLauncher(int* expert_for_source_row, const int num_rows, const int num_experts,
+    const int k, MOEParallelismConfig parallelism_config, const MOEExpertReplication& replication, cudaStream_t stream)
+{
+    const int num_expanded_rows = num_rows * k;
+    const int threads = 256;
+    const int blocks = ceilDiv(num_expanded_rows, threads);
+    assignReplicatedExpertsKernel<<<blocks, threads, 0, stream>>>(expert_for_source_row, num_expanded_rows,
+        num_experts, k, num_experts / parallelism_config.ep_size, parallelism_config.ep_size,
+        parallelism_config.ep_rank, replication);
+}
+
+__global__ void accumulateExpertLoadKernel(
+    const int64_t* total_rows_before_expert, int64_t* expert_load_counts, const int num_experts)
+{
+    const int expert = blockIdx.x * blockDim.x + threadIdx.x;
+    if (expert >= num_experts)
+    {
+        return;
+    }
+    const int64_t row_begin = expert == 0 ? 0 : total_rows_before_expert[expert - 1];
+    expert_load_counts[expert] += total_rows_before_expert[expert] - row_begin;
+}
+
+void accumulateExpertLoadKernelLauncher(
+    const int64_t* total_rows_before_expert, int64_t* expert_load_counts, const int num_experts, cudaStream_t stream)
+{
+    const int threads = std::min(1024, num_experts);
+    const int blocks = ceilDiv(num_experts, threads);
+    accumulateExpertLoadKernel<<<blocks, threads, 0, stream>>>(
+        total_rows_before_expert, expert_load_counts, num_experts);
+}
+
 enum class ScaleMode : int
 {
     NO_SCALE = 0,
@@ -831,9 +1100,15 @@ void doGatedActivation(T* output, const T* gemm_result, const int64_t* num_valid
     fn<<<blocks, threads, 0, stream>>>(output, gemm_result, num_valid_tokens_ptr, inter_size);
 }
 
+template <typename T, typename WeightType, typename Enable>
+CutlassMoeFCRunner<T, WeightType, Enable>::CutlassMoeFCRunner()
+    : multi_processor_count_(tensorrt_llm::common::getMultiProcessorCount())
+{
+}
+
 template <typename T, typename WeightType, typename Enable>
 std::vector<size_t> CutlassMoeFCRunner<T, WeightType, Enable>::getWorkspaceBufferSizes(const int num_rows,
-    const int hidden_size, const int inter_size, const int num_experts, const int num_experts_per_node, const int k,
+    const int hidden_size, const int inter_size, const int num_experts, const int num_local_experts, const int k,
     ActivationType activation_type) const
 {
     const size_t num_moe_inputs = k * num_rows;
@@ -852,11 +1127,15 @@ std::vector<size_t> CutlassMoeFCRunner<T, WeightType, Enable>::getWorkspaceBuffe
     size_t permuted_rows_size = num_moe_inputs * sizeof(int);
     size_t permuted_experts_size = num_moe_inputs * sizeof(int);
     size_t permuted_data_size = buf_size * sizeof(T);
-    size_t total_rows_before_expert_size = num_experts_per_node * sizeof(int64_t);
+    size_t total_rows_before_expert_size = num_local_experts * sizeof(int64_t);
     size_t softmax_out_size = num_softmax_outs * sizeof(float);
     size_t glu_inter_size = glu_inter_elems * sizeof(T);
     size_t fc1_result_size = interbuf_elems * sizeof(T);
     size_t sorter_size = CubKeyValueSorter::getWorkspaceSize(num_rows, num_experts);
+    // The GEMV only runs the problems with few rows, the work list does not need to cover num_moe_inputs
+    size_t moe_gemv_work_list_size = std::is_same_v<T, WeightType>
+        ? getMoeGemvWorkListSize(std::min<int>(num_moe_inputs, MOE_GEMV_MAX_ROWS), num_local_experts)
+        : 0;
 
     std::vector<size_t> workspace{
         source_rows_size,
@@ -868,6 +1147,7 @@ std::vector<size_t> CutlassMoeFCRunner<T, WeightType, Enable>::getWorkspaceBuffe
         glu_inter_size,
         // These pointers reuse the same memory
         std::max(fc1_result_size, sorter_size),
+        moe_gemv_work_list_size,
     };
     return workspace;
 }
@@ -879,18 +1159,33 @@ size_t CutlassMoeFCRunner<T, WeightType, Enable>::getWorkspaceSize(const int num
 {
     const int ep_size = parallelism_config.ep_size;
     TLLM_CHECK_WITH_INFO(num_experts % ep_size == 0, "Number of experts must be a multiple of tp size");
-    auto workspace = getWorkspaceBufferSizes(
-        num_rows, hidden_size, inter_size, num_experts, num_experts / ep_size, k, activation_type);
+    auto workspace = getWorkspaceBufferSizes(num_rows, hidden_size, inter_size, num_experts,
+        getNumLocalExperts(num_experts, parallelism_config), k, activation_type);
     return tensorrt_llm::common::calculateTotalWorkspaceSize(workspace.data(), workspace.size());
 }
 
+template <typename T, typename WeightType, typename Enable>
+int CutlassMoeFCRunner<T, WeightType, Enable>::getNumLocalExperts(
+    const int num_experts, MOEParallelismConfig parallelism_config) const
+{
+    const int num_experts_per_node = num_experts / parallelism_config.ep_size;
+    if (parallelism_config.ep_size == 1)
+    {
+        return num_experts_per_node;
+    }
+    // The local experts must sort before the rows of the other nodes, which select expert num_experts
+    TLLM_CHECK_WITH_INFO(num_experts_per_node + replication_.num_replicated_experts <= num_experts,
+        "Too many replicated experts");
+    return num_experts_per_node + replication_.num_replicated_experts;
+}
+
 template <typename T, typename WeightType, typename Enable>
 void CutlassMoeFCRunner<T, WeightType, Enable>::configureWsPtrs(char* ws_ptr, const int num_rows, const int hidden_size,
-    const int inter_size, const int num_experts, const int num_experts_per_node, const int k,
+    const int inter_size, const int num_experts, const int num_local_experts, const int k,
     ActivationType activation_type)
 {
     auto workspace = getWorkspaceBufferSizes(
-        num_rows, hidden_size, inter_size, num_experts, num_experts_per_node, k, activation_type);
+        num_rows, hidden_size, inter_size, num_experts, num_local_experts, k, activation_type);
 
     std::vector<int8_t*> ws_sliced{(int8_t*) ws_ptr};
     for (auto size : workspace)
@@ -917,6 +1212,8 @@ void CutlassMoeFCRunner<T, WeightType, Enable>::configureWsPtrs(char* ws_ptr, co
     // These pointers are aliased. Since the sort ws can be overwritten after it is finished
     sorter_ws_ = (char*) ws_sliced[7];
     fc1_result_ = (T*) ws_sliced[7];
+
+    moe_gemv_work_list_ = (void*) ws_sliced[8];
 }
 
 template <typename T, typename WeightType, typename Enable>
@@ -968,60 +1265,124 @@ void CutlassMoeFCRunner<T, WeightType, Enable>::runMoe(const void* input_activat
     const int num_experts_per_node = num_experts / parallelism_config.ep_size;
     const int start_expert = num_experts_per_node * parallelism_config.ep_rank;
     const int end_expert = start_expert + num_experts_per_node;
+    const int num_local_experts = getNumLocalExperts(num_experts, parallelism_config);
+    const bool replicate_experts = num_local_experts != num_experts_per_node;
 
     configureWsPtrs(
-        workspace_ptr, num_rows, hidden_size, inter_size, num_experts, num_experts_per_node, k, fc1_activation_type);
-    topkGatingSoftmaxKernelLauncher(gating_output, finished, expert_scales, softmax_out_, expert_for_source_row,
-        source_rows_, num_rows, num_experts, k, start_expert, end_expert, stream);
-
-    sync_check_cuda_error();
-
-    sorter_.updateNumExperts(num_experts);
-    const int sorter_ws_size_bytes = pad_to_multiple_of_16(sorter_.getWorkspaceSize(k * num_rows, num_experts));
-    sorter_.run((void*) sorter_ws_, sorter_ws_size_bytes, expert_for_source_row, permuted_experts_, source_rows_,
-        permuted_rows_, k * num_rows, stream);
+        workspace_ptr, num_rows, hidden_size, inter_size, num_experts, num_local_experts, k, fc1_activation_type);
 
-    sync_check_cuda_error();
+    auto recordPhase = [&](MOEPhase phase)
+    {
+        if (phase_events_)
+        {
+            check_cuda_error(cudaEventRecord(phase_events_[static_cast<int>(phase)], stream));
+        }
+    };
 
     // Upper bound on number of expanded rows
     const int expanded_active_expert_rows = k * active_rows;
-    computeTotalRowsBeforeExpert(
-        permuted_experts_, expanded_active_expert_rows, num_experts_per_node, total_rows_before_expert_, stream);
-
-    sync_check_cuda_error();
-
     const bool needs_num_valid = finished || parallelism_config.ep_size > 1;
     const int64_t* num_valid_tokens_ptr
-        = needs_num_valid ? total_rows_before_expert_ + num_experts_per_node - 1 : nullptr;
-    expandInputRowsKernelLauncher(input_activations, permuted_data_, permuted_rows_,
-        expanded_source_row_to_expanded_dest_row, num_rows, num_valid_tokens_ptr, hidden_size, k, stream);
-
-    sync_check_cuda_error();
+        = needs_num_valid ? total_rows_before_expert_ + num_local_experts - 1 : nullptr;
 
-    if (!isGatedActivation(fc1_activation_type))
+    if (use_fused_routing_ && !replicate_experts && isFusedMoeRoutingSupported(num_rows, num_experts, k))
     {
-        moe_gemm_runner_.moeGemmBiasAct(permuted_data_, fc1_expert_weights, fc1_scales, fc1_expert_biases, fc1_result_,
-            total_rows_before_expert_, expanded_active_expert_rows, inter_size, hidden_size, num_experts_per_node,
-            fc1_activation_type, stream);
+        fusedMoeRoutingKernelLauncher(gating_output, finished, input_activations, permuted_data_, expert_scales,
+            expert_for_source_row, expanded_source_row_to_expanded_dest_row, total_rows_before_expert_, num_rows,
+            hidden_size, num_experts, k, start_expert, end_expert, expanded_active_expert_rows, stream);
     }
     else
     {
-        const size_t fc1_out_size = inter_size * 2;
-        // Run the GEMM with activation function overridden with `Identity`, we do the activation separately
-        moe_gemm_runner_.moeGemmBiasAct(permuted_data_, fc1_expert_weights, fc1_scales, fc1_expert_biases,
-            glu_inter_result_, total_rows_before_expert_, expanded_active_expert_rows, fc1_out_size, hidden_size,
-            num_experts_per_node, ActivationType::Identity, stream);
+        if (replicate_experts)
+        {
+            // Select among all the experts, then keep the ones this node processes
+            topkGatingSoftmaxKernelLauncher(gating_output, finished, expert_scales, softmax_out_,
+                expert_for_source_row, source_rows_, num_rows, num_experts, k, 0, num_experts, stream);
+            assignReplicatedExpertsKernelLauncher(expert_for_source_row, num_rows, num_experts, k, parallelism_config,
+                replication_, stream);
+        }
+        else
+        {
+            topkGatingSoftmaxKernelLauncher(gating_output, finished, expert_scales, softmax_out_,
+                expert_for_source_row, source_rows_, num_rows, num_experts, k, start_expert, end_expert, stream);
+        }
 
         sync_check_cuda_error();
 
-        doGatedActivation<T>(fc1_result_, glu_inter_result_, num_valid_tokens_ptr, inter_size, num_rows * k,
-            fc1_activation_type, stream);
+        sorter_.updateNumExperts(num_experts);
+        const int sorter_ws_size_bytes = pad_to_multiple_of_16(sorter_.getWorkspaceSize(k * num_rows, num_experts));
+        sorter_.run((void*) sorter_ws_, sorter_ws_size_bytes, expert_for_source_row, permuted_experts_, source_rows_,
+            permuted_rows_, k * num_rows, stream);
+
+        sync_check_cuda_error();
+
+        computeTotalRowsBeforeExpert(
+            permuted_experts_, expanded_active_expert_rows, num_local_experts, total_rows_before_expert_, stream);
+
+        sync_check_cuda_error();
+
+        expandInputRowsKernelLauncher(input_activations, permuted_data_, permuted_rows_,
+            expanded_source_row_to_expanded_dest_row, num_rows, num_valid_tokens_ptr, hidden_size, k, stream);
     }
 
     sync_check_cuda_error();
 
-    moe_gemm_runner_.moeGemm(fc1_result_, fc2_expert_weights, fc2_scales, fc2_result, total_rows_before_expert_,
-        expanded_active_expert_rows, hidden_size, inter_size, num_experts_per_node, stream);
+    if (expert_load_counts_)
+    {
+        accumulateExpertLoadKernelLauncher(total_rows_before_expert_, expert_load_counts_, num_local_experts, stream);
+    }
+    recordPhase(MOEPhase::ROUTING);
+
+    bool use_moe_gemv = false;
+    if constexpr (std::is_same_v<T, WeightType>)
+    {
+        use_moe_gemv = use_moe_gemv_ && expanded_active_expert_rows <= MOE_GEMV_MAX_ROWS
+            && isMoeGemvSupported<T>(inter_size, hidden_size) && isMoeGemvSupported<T>(hidden_size, inter_size);
+        if (use_moe_gemv)
+        {
+            // FC1 and FC2 stay two launches: the rows of FC2 need all the columns of FC1. The bias and the
+            // activation, gated or not, are applied by FC1 directly
+            buildMoeGemvWorkList(total_rows_before_expert_, num_local_experts, moe_gemv_work_list_, stream);
+            moeGemvBiasAct<T>(permuted_data_, fc1_expert_weights, fc1_expert_biases, fc1_result_,
+                total_rows_before_expert_, moe_gemv_work_list_, inter_size, hidden_size, fc1_activation_type,
+                multi_processor_count_, stream);
+            recordPhase(MOEPhase::FC1);
+            moeGemvBiasAct<T>(fc1_result_, fc2_expert_weights, nullptr, fc2_result, total_rows_before_expert_,
+                moe_gemv_work_list_, hidden_size, inter_size, ActivationType::Identity, multi_processor_count_,
+                stream);
+            recordPhase(MOEPhase::FC2);
+        }
+    }
+
+    if (!use_moe_gemv)
+    {
+        if (!isGatedActivation(fc1_activation_type))
+        {
+            moe_gemm_runner_.moeGemmBiasAct(permuted_data_, fc1_expert_weights, fc1_scales, fc1_expert_biases,
+                fc1_result_, total_rows_before_expert_, expanded_active_expert_rows, inter_size, hidden_size,
+                num_local_experts, fc1_activation_type, stream);
+        }
+        else
+        {
+            const size_t fc1_out_size = inter_size * 2;
+            // Run the GEMM with activation function overridden with `Identity`, we do the activation separately
+            moe_gemm_runner_.moeGemmBiasAct(permuted_data_, fc1_expert_weights, fc1_scales, fc1_expert_biases,
+                glu_inter_result_, total_rows_before_expert_, expanded_active_expert_rows, fc1_out_size, hidden_size,
+                num_local_experts, ActivationType::Identity, stream);
+
+            sync_check_cuda_error();
+
+            doGatedActivation<T>(fc1_result_, glu_inter_result_, num_valid_tokens_ptr, inter_size, num_rows * k,
+                fc1_activation_type, stream);
+        }
+
+        sync_check_cuda_error();
+        recordPhase(MOEPhase::FC1);
+
+        moe_gemm_runner_.moeGemm(fc1_result_, fc2_expert_weights, fc2_scales, fc2_result, total_rows_before_expert_,
+            expanded_active_expert_rows, hidden_size, inter_size, num_local_experts, stream);
+        recordPhase(MOEPhase::FC2);
+    }
 
     sync_check_cuda_error();
 
@@ -1030,6 +1391,7 @@ void CutlassMoeFCRunner<T, WeightType, Enable>::runMoe(const void* input_activat
         nullptr, nullptr, fc2_expert_biases, expert_scales, expanded_source_row_to_expanded_dest_row,
         expert_for_source_row, num_rows, hidden_size, k, num_valid_tokens_ptr, parallelism_config, normalization_mode,
         stream);
+    recordPhase(MOEPhase::FINALIZE);
 
     sync_check_cuda_error();
 }
@@ -1045,6 +1407,212 @@ void CutlassMoeFCRunner<T, WeightType, Enable>::computeTotalRowsBeforeExpert(con
         sorted_indices, total_indices, num_experts, total_rows_before_expert);
 }
 
+// ============================== All-to-all dispatch =================================
+
+void moeAllToAllTopK(const float* gating_output, const bool* finished, float* expert_scales, float* softmax_temp_out,
+    int* expert_for_source_row, int* source_rows, const int num_rows, const int num_experts, const int k,
+    cudaStream_t stream)
+{
+    // Select among all the experts, the tokens are sent to the ranks owning them afterwards
+    topkGatingSoftmaxKernelLauncher(gating_output, finished, expert_scales, softmax_temp_out, expert_for_source_row,
+        source_rows, num_rows, num_experts, k, 0, num_experts, stream);
+}
+
+__global__ void computeMoeDestRanksKernel(const int* expert_for_source_row, int* dest_ranks, int* expanded_rows,
+    const int num_expanded_rows, const int num_experts, const int num_experts_per_node, const int ep_size)
+{
+    const int expanded_row = blockIdx.x * blockDim.x + threadIdx.x;
+    if (expanded_row >= num_expanded_rows)
+    {
+        return;
+    }
+    // Finished rows select expert num_experts, they are sorted after the rows of the last rank and never sent
+    const int expert = expert_for_source_row[expanded_row];
+    dest_ranks[expanded_row] = expert < num_experts ? expert / num_experts_per_node : ep_size;
+    expanded_rows[expanded_row] = expanded_row;
+}
+
+__global__ void computeMoeSendCountsKernel(
+    const int* sorted_dest_ranks, const int num_expanded_rows, const int ep_size, int* send_counts)
+{
+    const int rank = blockIdx.x * blockDim.x + threadIdx.x;
+    if (rank >= ep_size)
+    {
+        return;
+    }
+    send_counts[rank] = findTotalEltsLeqTarget(sorted_dest_ranks, num_expanded_rows, rank)
+        - findTotalEltsLeqTarget(sorted_dest_ranks, num_expanded_rows, rank - 1);
+}
+
+template <typename T>
+__global__ void gatherMoeSendRowsKernel(const T* input, const int* sorted_dest_ranks, const int* sorted_expanded_rows,
+    const int* expert_for_source_row, T* send_rows, int* send_experts, int* expanded_row_to_send_row, const int cols,
+    const int k, const int num_experts_per_node, const int ep_size)
+{
+    const int send_row = blockIdx.x;
+    const int expanded_row = sorted_expanded_rows[send_row];
+    const int rank = sorted_dest_ranks[send_row];
+    if (rank >= ep_size)
+    {
+        if (threadIdx.x == 0)
+        {
+            expanded_row_to_send_row[expanded_row] = -1;
+        }
+        return;
+    }
+
+    if (threadIdx.x == 0)
+    {
+        expanded_row_to_send_row[expanded_row] = send_row;
+        // Index of the expert on the rank owning it
+        send_experts[send_row] = expert_for_source_row[expanded_row] - rank * num_experts_per_node;
+    }
+
+    const T* source_row_ptr = input + static_cast<int64_t>(expanded_row / k) * cols;
+    T* dest_row_ptr = send_rows + static_cast<int64_t>(send_row) * cols;
+    for (int tid = threadIdx.x; tid < cols; tid += blockDim.x)
+    {
+        dest_row_ptr[tid] = source_row_ptr[tid];
+    }
+}
+
+size_t getMoeAllToAllSorterWorkspaceSize(const int num_expanded_rows, const int ep_size)
+{
+    // One more key for the rows that are not sent
+    return CubKeyValueSorter::getWorkspaceSize(num_expanded_rows, ep_size + 1);
+}
+
+template <typename T>
+void moeAllToAllPrepareSend(const T* input, const int* expert_for_source_row, int* dest_ranks, int* expanded_rows,
+    int* sorted_dest_ranks, int* sorted_expanded_rows, void* sorter_ws, T* send_rows, int* send_experts,
+    int* expanded_row_to_send_row, int* send_counts, const int num_rows, const int hidden_size, const int num_experts,
+    const int k, const int ep_size, cudaStream_t stream)
+{
+    const int num_expanded_rows = num_rows * k;
+    const int num_experts_per_node = num_experts / ep_size;
+    if (num_expanded_rows == 0)
+    {
+        check_cuda_error(cudaMemsetAsync(send_counts, 0, ep_size * sizeof(int), stream));
+        return;
+    }
+
+    const int threads = 256;
+    const int blocks = ceilDiv(num_expanded_rows, threads);
+    computeMoeDestRanksKernel<<<blocks, threads, 0, stream>>>(expert_for_source_row, dest_ranks, expanded_rows,
+        num_expanded_rows, num_experts, num_experts_per_node, ep_size);
+
+    // The radix sort is stable, the rows sent to a rank keep the order of the tokens
+    CubKeyValueSorter sorter(ep_size + 1);
+    sorter.run(sorter_ws, getMoeAllToAllSorterWorkspaceSize(num_expanded_rows, ep_size), dest_ranks,
+        sorted_dest_ranks, expanded_rows, sorted_expanded_rows, num_expanded_rows, stream);
+
+    computeMoeSendCountsKernel<<<ceilDiv(ep_size, threads), threads, 0, stream>>>(
+        sorted_dest_ranks, num_expanded_rows, ep_size, send_counts);
+
+    gatherMoeSendRowsKernel<<<num_expanded_rows, std::min(hidden_size, 1024), 0, stream>>>(input, sorted_dest_ranks,
+        sorted_expanded_rows, expert_for_source_row, send_rows, send_experts, expanded_row_to_send_row, hidden_size, k,
+        num_experts_per_node, ep_size);
+
+    sync_check_cuda_error();
+}
+
+__global__ void makeMoeOneHotRoutingKernel(
+    const int* experts, float* routing, const int num_rows, const int num_experts, const int start_expert)
+{
+    const int row = blockIdx.x * blockDim.x + threadIdx.x;
+    if (row >= num_rows)
+    {
+        return;
+    }
+    routing[static_cast<int64_t>(row) * num_experts + start_expert + experts[row]] = 1.f;
+}
+
+void moeAllToAllMakeRouting(const int* recv_experts, float* routing, const int num_rows, const int num_experts,
+    const int start_expert, cudaStream_t stream)
+{
+    if (num_rows == 0)
+    {
+        return;
+    }
+    check_cuda_error(cudaMemsetAsync(routing, 0, static_cast<size_t>(num_rows) * num_experts * sizeof(float), stream));
+
+    const int threads = 256;
+    makeMoeOneHotRoutingKernel<<<ceilDiv(num_rows, threads), threads, 0, stream>>>(
+        recv_experts, routing, num_rows, num_experts, start_expert);
+
+    sync_check_cuda_error();
+}
+
+template <typename T, bool RENORMALIZE>
+__global__ void combineMoeReturnedRowsKernel(const T* returned_rows, const float* expert_scales,
+    const int* expanded_row_to_send_row, T* output, const int cols, const int k)
+{
+    const int row = blockIdx.x;
+    T* output_row_ptr = output + static_cast<int64_t>(row) * cols;
+    for (int tid = threadIdx.x; tid < cols; tid += blockDim.x)
+    {
+        float thread_output = 0.f;
+        float row_rescale = 0.f;
+        bool has_rows = false;
+        for (int k_idx = 0; k_idx < k; ++k_idx)
+        {
+            const int expanded_row = row * k + k_idx;
+            const float row_scale = expert_scales[expanded_row];
+            row_rescale += row_scale;
+
+            const int send_row = expanded_row_to_send_row[expanded_row];
+            if (send_row < 0)
+            {
+                continue;
+            }
+            has_rows = true;
+            thread_output += row_scale * static_cast<float>(returned_rows[static_cast<int64_t>(send_row) * cols + tid]);
+        }
+
+        if (RENORMALIZE && has_rows)
+        {
+            thread_output /= row_rescale;
+        }
+        output_row_ptr[tid] = static_cast<T>(thread_output);
+    }
+}
+
+template <typename T>
+void moeAllToAllCombine(const T* returned_rows, const float* expert_scales, const int* expanded_row_to_send_row,
+    T* output, const int num_rows, const int hidden_size, const int k,
+    MOEExpertScaleNormalizationMode normalization_mode, cudaStream_t stream)
+{
+    if (num_rows == 0)
+    {
+        return;
+    }
+    const int threads = std::min(hidden_size, 1024);
+    auto* func = normalization_mode == MOEExpertScaleNormalizationMode::RENORMALIZE
+        ? &combineMoeReturnedRowsKernel<T, true>
+        : &combineMoeReturnedRowsKernel<T, false>;
+    func<<<num_rows, threads, 0, stream>>>(
+        returned_rows, expert_scales, expanded_row_to_send_row, output, hidden_size, k);
+
+    sync_check_cuda_error();
+}
+
+#define INSTANTIATE_MOE_ALL_TO_ALL(T)                                                                                  \
+    template void moeAllToAllPrepareSend<T>(const T* input, const int* expert_for_source_row, int* dest_ranks,         \
+        int* expanded_rows, int* sorted_dest_ranks, int* sorted_expanded_rows, void* sorter_ws, T* send_rows,          \
+        int* send_experts, int* expanded_row_to_send_row, int* send_counts, const int num_rows, const int hidden_size, \
+        const int num_experts, const int k, const int ep_size, cudaStream_t stream);                                   \
+    template void moeAllToAllCombine<T>(const T* returned_rows, const float* expert_scales,                            \
+        const int* expanded_row_to_send_row, T* output, const int num_rows, const int hidden_size, const int k,        \
+        MOEExpertScaleNormalizationMode normalization_mode, cudaStream_t stream)
+
+INSTANTIATE_MOE_ALL_TO_ALL(float);
+INSTANTIATE_MOE_ALL_TO_ALL(half);
+#ifdef ENABLE_BF16
+INSTANTIATE_MOE_ALL_TO_ALL(__nv_bfloat16);
+#endif
+
+#undef INSTANTIATE_MOE_ALL_TO_ALL
+
 // ==================== Helper for getting load balanced routing for profiling ==================================
 
 template <class T>
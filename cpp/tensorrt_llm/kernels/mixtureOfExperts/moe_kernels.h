@@ -19,6 +19,7 @@
 #include "cutlass/gemm/gemm.h"
 #include "tensorrt_llm/common/assert.h"
 #include "tensorrt_llm/kernels/cutlass_kernels/moe_gemm/moe_gemm_kernels.h"
+#include "tensorrt_llm/kernels/mixtureOfExperts/moe_gemv_kernels.h"
 #include "tensorrt_llm/plugins/common/gemmPluginProfiler.h"
 #include <cuda_runtime_api.h>
 #include <optional>
@@ -87,6 +88,16 @@ enum class MOEExpertScaleNormalizationMode : int
                  //!< the topk selected experts
 };
 
+//! Phases of CutlassMoeFCRunner::runMoe, see CutlassMoeFCRunner::setPhaseEvents
+enum class MOEPhase : int
+{
+    ROUTING = 0, //!< Top-k selection, sort and expansion of the rows
+    FC1,         //!< First GEMM and its activation
+    FC2,         //!< Second GEMM
+    FINALIZE,    //!< Reduction of the expert rows to the output
+    NUM_PHASES,
+};
+
 /**
  * \brief Describes what parallelism mode the MoE is using
  *
@@ -107,6 +118,10 @@ enum class MOEExpertScaleNormalizationMode : int
  * Regardless of parallelism mode:
  *  * The input routing values must be the complete routing for all tokens/experts (required for softmax)
  *  * An allreduce must be run on the result to combine the results from different nodes if parallelism > 1
+ *
+ * Expert Parallelism can instead dispatch the tokens with an all-to-all (see the moeAllToAll* helpers below and the
+ * ep_group field of MixtureOfExpertsPlugin). Each node routes a slice of the tokens and only sends each token to the
+ * nodes owning its selected experts, which compute them with CutlassMoeFCRunner and send the results back.
  */
 struct MOEParallelismConfig
 {
@@ -126,6 +141,22 @@ struct MOEParallelismConfig
     const int ep_rank = 0;
 };
 
+/**
+ * \brief Hot experts replicated on all the nodes with expert parallelism
+ *
+ * Each node holds the weights of its own experts followed by a copy of the replicated experts, in the order of
+ * replicated_experts. The tokens routed to a replicated expert are split round-robin between the nodes, so the node
+ * owning a hot expert does not have to process all its tokens while the others wait for it. Ignored without expert
+ * parallelism.
+ */
+struct MOEExpertReplication
+{
+    static constexpr int MAX_REPLICATED_EXPERTS = 16;
+
+    int num_replicated_experts = 0;
+    int replicated_experts[MAX_REPLICATED_EXPERTS]{};
+};
+
 class CutlassMoeFCRunnerInterface
 {
 public:
@@ -136,6 +167,13 @@ public:
         = 0;
     virtual void setTactic(std::optional<cutlass_extensions::CutlassGemmConfig> gemm_config) = 0;
     virtual std::vector<cutlass_extensions::CutlassGemmConfig> getTactics() = 0;
+    // Number of weight rows sharing a scale for quantized weights, the scales of each GEMM are then
+    // [num_experts, gemm_k / group_size, gemm_n]. 0 means per column scales [num_experts, gemm_n].
+    virtual void setGroupSize(int group_size) = 0;
+    virtual void setExpertReplication(const MOEExpertReplication& replication) = 0;
+    // Adds the number of rows processed by each expert of the node to expert_load_counts, [experts per node plus the
+    // replicated experts]. Disabled if nullptr.
+    virtual void setExpertLoadCounts(int64_t* expert_load_counts) = 0;
 
     virtual void runMoe(const void* input_activations, const float* gating_output, const void* fc1_expert_weights,
         const void* fc1_scales, const void* fc1_expert_biases, ActivationType fc1_activation_type,
@@ -157,7 +195,7 @@ template <typename T,    /*The type used for activations/scales/compute*/
 class CutlassMoeFCRunner : public CutlassMoeFCRunnerInterface
 {
 public:
-    CutlassMoeFCRunner() = default;
+    CutlassMoeFCRunner();
     ~CutlassMoeFCRunner() override = default;
 
     size_t getWorkspaceSize(const int num_rows, const int hidden_size, const int fc1_output_size, const int num_experts,
@@ -173,6 +211,42 @@ public:
         return moe_gemm_runner_.getConfigs();
     }
 
+    void setGroupSize(int group_size) override
+    {
+        moe_gemm_runner_.setGroupSize(group_size);
+    }
+
+    void setExpertReplication(const MOEExpertReplication& replication) override
+    {
+        replication_ = replication;
+    }
+
+    void setExpertLoadCounts(int64_t* expert_load_counts) override
+    {
+        expert_load_counts_ = expert_load_counts;
+    }
+
+    // Use the grouped GEMV instead of the grouped GEMM when there are at most MOE_GEMV_MAX_ROWS expanded rows.
+    // Only the non-quantized weights are supported, the quantized ones always run the grouped GEMM.
+    void setUseMoeGemv(bool use_moe_gemv)
+    {
+        use_moe_gemv_ = use_moe_gemv;
+    }
+
+    // Compute the routing and permute the rows in a single launch when the batch is small and the number of experts is
+    // 8, 16 or 64. The result is the same as with the separate top-k, sort and expansion kernels.
+    void setUseFusedRouting(bool use_fused_routing)
+    {
+        use_fused_routing_ = use_fused_routing;
+    }
+
+    // Record phase_events[MOEPhase::NUM_PHASES] on the stream at the end of each phase of runMoe, to time them.
+    // Disabled if nullptr.
+    void setPhaseEvents(const cudaEvent_t* phase_events)
+    {
+        phase_events_ = phase_events;
+    }
+
     void runMoe(const void* input_activations, const float* gating_output, const void* fc1_expert_weights,
         const void* fc1_scales, const void* fc1_expert_biases, ActivationType fc1_activation_type,
         const void* fc2_expert_weights, const void* fc2_scales, const void* fc2_expert_biases, const int num_rows,
@@ -185,10 +259,11 @@ public:
 private:
     void computeTotalRowsBeforeExpert(const int* sorted_indices, const int total_indices, const int num_experts,
         int64_t* total_rows_before_expert, cudaStream_t stream);
+    int getNumLocalExperts(const int num_experts, MOEParallelismConfig parallelism_config) const;
     std::vector<size_t> getWorkspaceBufferSizes(const int num_rows, const int hidden_size, const int inter_size,
-        const int num_experts, const int num_experts_per_node, const int k, ActivationType activation_type) const;
+        const int num_experts, const int num_local_experts, const int k, ActivationType activation_type) const;
     void configureWsPtrs(char* ws_ptr, const int num_rows, const int hidden_size, const int inter_size,
-        const int num_experts, const int num_experts_per_node, const int k, ActivationType activation_type);
+        const int num_experts, const int num_local_experts, const int k, ActivationType activation_type);
 
 private:
     CubKeyValueSorter sorter_;
@@ -206,6 +281,15 @@ private:
 
     T* fc1_result_;
     T* glu_inter_result_;
+    void* moe_gemv_work_list_;
+
+    MOEExpertReplication replication_{};
+    int64_t* expert_load_counts_{};
+    const cudaEvent_t* phase_events_{};
+
+    bool use_moe_gemv_{true};
+    bool use_fused_routing_{true};
+    int multi_processor_count_;
 };
 
 template <typename WeightType>
@@ -226,6 +310,21 @@ public:
         return;
     }
 
+    void setGroupSize(int group_size) override
+    {
+        return;
+    }
+
+    void setExpertReplication(const MOEExpertReplication& replication) override
+    {
+        return;
+    }
+
+    void setExpertLoadCounts(int64_t* expert_load_counts) override
+    {
+        return;
+    }
+
     void runMoe(const void* input_activations, const float* gating_output, const void* fc1_expert_weights,
         const void* fc1_scales, const void* fc1_expert_biases, ActivationType fc1_activation_type,
         const void* fc2_expert_weights, const void* fc2_scales, const void* fc2_expert_biases, const int num_rows,
@@ -239,6 +338,45 @@ public:
     }
 };
 
+/*
+  Helpers of the all-to-all token dispatch of expert parallelism. The rows of the tokens are expanded to num_rows x k,
+  one per selected expert, and the expanded row of token t and expert slot j is t * k + j.
+
+  moeAllToAllTopK - selects the top-k experts among all of them, as opposed to runMoe which only keeps the experts of
+  its node. Finished rows select expert num_experts.
+
+  moeAllToAllPrepareSend - sorts the expanded rows by the rank owning their expert and gathers them to send_rows.
+  send_counts - [ep_size] number of rows sent to each rank, the rows of rank r start at the sum of the previous counts.
+  send_experts - [num_rows x k] index of the expert of each sent row on the rank owning it.
+  expanded_row_to_send_row - [num_rows x k] row of send_rows of each expanded row, -1 if it is not sent.
+  sorter_ws - workspace of getMoeAllToAllSorterWorkspaceSize bytes.
+
+  moeAllToAllMakeRouting - writes the routing [num_rows x num_experts] selecting expert start_expert + recv_experts[i]
+  for row i, to run the received rows through runMoe with k = 1.
+
+  moeAllToAllCombine - reduces the rows returned by the ranks to output [num_rows x hidden_size] with the scales of
+  moeAllToAllTopK. Finished rows are set to zero.
+*/
+void moeAllToAllTopK(const float* gating_output, const bool* finished, float* expert_scales, float* softmax_temp_out,
+    int* expert_for_source_row, int* source_rows, const int num_rows, const int num_experts, const int k,
+    cudaStream_t stream);
+
+size_t getMoeAllToAllSorterWorkspaceSize(const int num_expanded_rows, const int ep_size);
+
+template <typename T>
+void moeAllToAllPrepareSend(const T* input, const int* expert_for_source_row, int* dest_ranks, int* expanded_rows,
+    int* sorted_dest_ranks, int* sorted_expanded_rows, void* sorter_ws, T* send_rows, int* send_experts,
+    int* expanded_row_to_send_row, int* send_counts, const int num_rows, const int hidden_size, const int num_experts,
+    const int k, const int ep_size, cudaStream_t stream);
+
+void moeAllToAllMakeRouting(const int* recv_experts, float* routing, const int num_rows, const int num_experts,
+    const int start_expert, cudaStream_t stream);
+
+template <typename T>
+void moeAllToAllCombine(const T* returned_rows, const float* expert_scales, const int* expanded_row_to_send_row,
+    T* output, const int num_rows, const int hidden_size, const int k,
+    MOEExpertScaleNormalizationMode normalization_mode, cudaStream_t stream);
+
 void makeLoadBalancedRoutingConfiguration(
     void* data_void, int num_experts, int num_tokens, int k, nvinfer1::DataType type, cudaStream_t stream);
 
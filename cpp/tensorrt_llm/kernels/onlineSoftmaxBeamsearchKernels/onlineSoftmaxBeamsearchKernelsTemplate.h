@@ -593,6 +593,306 @@ void beam_online_softmax_topk_stage2_kernelLauncher(const float* temp_storage, c
     assert(0);
 }
 
+// Beams wider than this select their candidates with the streaming kernels below. The register based TopK of the
+// kernels above inserts every element in O(MAX_K) and spills to local memory for large MAX_K.
+static const int BEAM_STREAMING_TOPK_MIN_BEAM_WIDTH = 16;
+static const int BEAM_STREAMING_TOPK_STAGE1_THREADBLOCK_SIZE = 256;
+static const int BEAM_STREAMING_TOPK_STAGE2_THREADBLOCK_SIZE = 128;
+static const int BEAM_STREAMING_TOPK_ITEMS_PER_THREAD = 4;
+
+// Orders by descending value and ascending id like TopK::insert, the empty slots (id -1) come last
+__device__ __forceinline__ bool beam_streaming_topk_is_better(float val_a, int id_a, float val_b, int id_b)
+{
+    if (id_a < 0 || id_b < 0)
+    {
+        return id_a >= 0 && id_b < 0;
+    }
+    return val_a > val_b || (val_a == val_b && id_a < id_b);
+}
+
+// Bitonic sort of the candidate buffer in shared memory, size must be a power of 2
+__device__ __forceinline__ void beam_streaming_topk_sort(float* vals, int* ids, int size)
+{
+    for (int k = 2; k <= size; k <<= 1)
+    {
+        for (int j = k >> 1; j > 0; j >>= 1)
+        {
+            for (int i = threadIdx.x; i < size; i += blockDim.x)
+            {
+                const int partner = i ^ j;
+                if (partner > i)
+                {
+                    const bool descending = (i & k) == 0;
+                    if (descending == beam_streaming_topk_is_better(vals[partner], ids[partner], vals[i], ids[i]))
+                    {
+                        const float val = vals[i];
+                        const int id = ids[i];
+                        vals[i] = vals[partner];
+                        ids[i] = ids[partner];
+                        vals[partner] = val;
+                        ids[partner] = id;
+                    }
+                }
+            }
+            __syncthreads();
+        }
+    }
+}
+
+// Sorts the candidate buffer, keeps its best K candidates and raises the threshold to the worst of them once there
+// are K of them. Called by all threads of the block.
+__device__ __forceinline__ void beam_streaming_topk_compact(
+    float* vals, int* ids, int size, int K, int* __restrict count, float* __restrict threshold)
+{
+    for (int i = *count + threadIdx.x; i < size; i += blockDim.x)
+    {
+        vals[i] = -FLT_MAX;
+        ids[i] = -1;
+    }
+    __syncthreads();
+    beam_streaming_topk_sort(vals, ids, size);
+    if (threadIdx.x == 0)
+    {
+        if (*count >= K)
+        {
+            *threshold = vals[K - 1];
+        }
+        *count = min(*count, K);
+    }
+    __syncthreads();
+}
+
+// Returns the size of the candidate buffer, it has to fit K candidates plus one tile of new elements
+__host__ __device__ __forceinline__ int beam_streaming_topk_buffer_size(int K, int threadblock_size)
+{
+    int size = 1;
+    while (size < K + BEAM_STREAMING_TOPK_ITEMS_PER_THREAD * threadblock_size)
+    {
+        size <<= 1;
+    }
+    return size;
+}
+
+// One pass over a section of the logits of a beam. Computes the maximum and the softmax denominator of the section
+// like beam_online_softmax_topk_stage1_kernel, but keeps the candidates in shared memory: an element is appended to
+// the buffer when it is not below the worst of the best K candidates seen so far, and the buffer is cut back to K
+// candidates whenever the next tile might overflow it. The packed layout of the output is the one of stage 1 with
+// MAX_K = K.
+template <typename T, int THREADBLOCK_SIZE>
+__launch_bounds__(THREADBLOCK_SIZE) __global__
+    void beam_streaming_topk_stage1_kernel(const T* __restrict x, const T* __restrict b,
+        const FinishedState* __restrict finished, float* __restrict t, int V, int K, int beam_width,
+        const int* __restrict end_ids)
+{
+    const int thread_id = threadIdx.x;
+    const int vector_id = blockIdx.x; // batch beam index.
+    const int packed_size = 2 * K + 2;
+    constexpr int TILE_SIZE = BEAM_STREAMING_TOPK_ITEMS_PER_THREAD * THREADBLOCK_SIZE;
+
+    const bool IS_FP16 = std::is_same<T, half>::value;
+    const float MAX_T_VAL = (IS_FP16) ? HALF_FLT_MAX : FLT_MAX;
+
+    const int v_local = (V + gridDim.y - 1) / gridDim.y;
+    const int section_start = v_local * blockIdx.y;
+    const int section_end = min(section_start + v_local, V);
+
+    x += vector_id * V;
+
+    const int buffer_size = beam_streaming_topk_buffer_size(K, THREADBLOCK_SIZE);
+    extern __shared__ char buf_s_[];
+    float* s_vals = reinterpret_cast<float*>(buf_s_);
+    int* s_ids = reinterpret_cast<int*>(s_vals + buffer_size);
+
+    typedef cub::BlockReduce<MD, THREADBLOCK_SIZE> BlockReduce;
+    __shared__ typename BlockReduce::TempStorage temp_storage;
+    __shared__ int s_count;
+    __shared__ float s_threshold;
+
+    if (thread_id == 0)
+    {
+        s_count = 0;
+        s_threshold = -INFINITY;
+    }
+    __syncthreads();
+
+    const bool finish = finished[vector_id].isFinished();
+    const int end_id = end_ids[vector_id / beam_width];
+    MD partial;
+    partial.m = -MAX_T_VAL;
+    partial.d = 0.0F;
+
+    for (int tile_start = section_start; tile_start < section_end; tile_start += TILE_SIZE)
+    {
+        const float threshold = s_threshold;
+#pragma unroll
+        for (int item = 0; item < BEAM_STREAMING_TOPK_ITEMS_PER_THREAD; ++item)
+        {
+            const int elem_id = tile_start + item * THREADBLOCK_SIZE + thread_id;
+            if (elem_id < section_end)
+            {
+                float elem;
+                if (finish)
+                {
+                    elem = (elem_id == end_id) ? MAX_T_VAL : -MAX_T_VAL;
+                }
+                else
+                {
+                    elem = (float) x[elem_id] + (b == nullptr ? 0.0f : (float) b[elem_id]);
+                }
+                partial = reduce_md_op(partial, MD{elem, 1.0F});
+                if (elem >= threshold)
+                {
+                    const int pos = atomicAdd(&s_count, 1);
+                    s_vals[pos] = elem;
+                    s_ids[pos] = elem_id;
+                }
+            }
+        }
+        __syncthreads();
+        const bool is_full = s_count > buffer_size - TILE_SIZE;
+        __syncthreads();
+        if (is_full)
+        {
+            beam_streaming_topk_compact(s_vals, s_ids, buffer_size, K, &s_count, &s_threshold);
+        }
+    }
+    beam_streaming_topk_compact(s_vals, s_ids, buffer_size, K, &s_count, &s_threshold);
+
+    const MD total = BlockReduce(temp_storage).Reduce(partial, reduce_md_op);
+
+    t += (blockIdx.x * gridDim.y + blockIdx.y) * packed_size;
+    for (int i = thread_id; i < K; i += THREADBLOCK_SIZE)
+    {
+        const int id = s_ids[i];
+        reinterpret_cast<int*>(t)[i] = id < 0 ? -1 : id + vector_id * V; // faster transformer needs absolute id
+        t[K + i] = s_vals[i];
+    }
+    if (thread_id == 0)
+    {
+        t[2 * K] = total.d;
+        t[2 * K + 1] = total.m;
+    }
+}
+
+// Merges the sections of a beam. The softmax of the beam is only known once all of its sections are, so the
+// candidates are selected on the logits and turned into cumulative log probabilities when they are written.
+template <typename T, int THREADBLOCK_SIZE>
+__launch_bounds__(THREADBLOCK_SIZE) __global__ void beam_streaming_topk_stage2_kernel(const float* __restrict x,
+    const float* __restrict c, int* __restrict z, T* __restrict v, int K, int parts_per_beam)
+{
+    const int vector_id = blockIdx.x;
+    const int thread_id = threadIdx.x;
+    const int packed_size = 2 * K + 2;
+    constexpr int TILE_SIZE = BEAM_STREAMING_TOPK_ITEMS_PER_THREAD * THREADBLOCK_SIZE;
+
+    const int buffer_size = beam_streaming_topk_buffer_size(K, THREADBLOCK_SIZE);
+    extern __shared__ char buf_s_[];
+    float* s_vals = reinterpret_cast<float*>(buf_s_);
+    int* s_ids = reinterpret_cast<int*>(s_vals + buffer_size);
+
+    typedef cub::BlockReduce<MD, THREADBLOCK_SIZE> BlockReduce;
+    __shared__ typename BlockReduce::TempStorage temp_storage;
+    __shared__ int s_count;
+    __shared__ float s_threshold;
+    __shared__ float s_log_normalizer;
+
+    x += vector_id * packed_size * parts_per_beam;
+
+    MD partial;
+    partial.m = -FLT_MAX;
+    partial.d = 0.0F;
+    for (int part = thread_id; part < parts_per_beam; part += THREADBLOCK_SIZE)
+    {
+        const float* part_x = x + part * packed_size;
+        partial = reduce_md_op(partial, MD{part_x[2 * K + 1], part_x[2 * K]});
+    }
+    const MD total = BlockReduce(temp_storage).Reduce(partial, reduce_md_op);
+    if (thread_id == 0)
+    {
+        s_log_normalizer = total.m + logf(total.d);
+        s_count = 0;
+        s_threshold = -INFINITY;
+    }
+    __syncthreads();
+
+    const int num_candidates = parts_per_beam * K;
+    for (int tile_start = 0; tile_start < num_candidates; tile_start += TILE_SIZE)
+    {
+        const float threshold = s_threshold;
+#pragma unroll
+        for (int item = 0; item < BEAM_STREAMING_TOPK_ITEMS_PER_THREAD; ++item)
+        {
+            const int candidate = tile_start + item * THREADBLOCK_SIZE + thread_id;
+            if (candidate < num_candidates)
+            {
+                const float* part_x = x + (candidate / K) * packed_size;
+                const int idx = candidate % K;
+                const int id = reinterpret_cast<const int*>(part_x)[idx];
+                const float elem = part_x[K + idx];
+                if (id >= 0 && elem >= threshold)
+                {
+                    const int pos = atomicAdd(&s_count, 1);
+                    s_vals[pos] = elem;
+                    s_ids[pos] = id;
+                }
+            }
+        }
+        __syncthreads();
+        const bool is_full = s_count > buffer_size - TILE_SIZE;
+        __syncthreads();
+        if (is_full)
+        {
+            beam_streaming_topk_compact(s_vals, s_ids, buffer_size, K, &s_count, &s_threshold);
+        }
+    }
+    beam_streaming_topk_compact(s_vals, s_ids, buffer_size, K, &s_count, &s_threshold);
+
+    z += vector_id * K;
+    v += vector_id * K;
+    for (int i = thread_id; i < K; i += THREADBLOCK_SIZE)
+    {
+        z[i] = s_ids[i];
+        v[i] = (T) (s_vals[i] - s_log_normalizer + c[vector_id]);
+    }
+}
+
+// Computes the 2 * beam_width candidates of each beam, with their cumulative log probabilities, in the layout of
+// beam_online_softmax_topk_stage2_kernel
+template <typename T>
+void beam_streaming_topk_kernelLauncher(const T* log_probs, const T* bias, const FinishedState* finished,
+    const float* cum_log_probs, int* ids, T* vals, float* temp_storage, size_t temp_storage_bytes, int batch_size,
+    int beam_width, int vocab_size, const int* end_ids, cudaStream_t stream)
+{
+    const int num_vectors = batch_size * beam_width;
+    const int K = 2 * beam_width;
+    const size_t packed_bytes = (2 * K + 2) * sizeof(float);
+
+    // Same number of sections as the register based kernels, as far as the workspace allows
+    int voc_parts = 4;
+    if (num_vectors < 256)
+    {
+        voc_parts = (240 + num_vectors - 1) / num_vectors;
+        voc_parts = std::min(128, voc_parts);
+    }
+    voc_parts = std::min(voc_parts, static_cast<int>(temp_storage_bytes / (num_vectors * packed_bytes)));
+    TLLM_CHECK_WITH_INFO(voc_parts > 0, "Workspace of beam search is too small for beam_width=%d", beam_width);
+
+    const int stage1_smem_size = beam_streaming_topk_buffer_size(K, BEAM_STREAMING_TOPK_STAGE1_THREADBLOCK_SIZE)
+        * (sizeof(float) + sizeof(int));
+    dim3 grid(num_vectors, voc_parts);
+    beam_streaming_topk_stage1_kernel<T, BEAM_STREAMING_TOPK_STAGE1_THREADBLOCK_SIZE>
+        <<<grid, BEAM_STREAMING_TOPK_STAGE1_THREADBLOCK_SIZE, stage1_smem_size, stream>>>(
+            log_probs, bias, finished, temp_storage, vocab_size, K, beam_width, end_ids);
+    sync_check_cuda_error();
+
+    const int stage2_smem_size = beam_streaming_topk_buffer_size(K, BEAM_STREAMING_TOPK_STAGE2_THREADBLOCK_SIZE)
+        * (sizeof(float) + sizeof(int));
+    beam_streaming_topk_stage2_kernel<T, BEAM_STREAMING_TOPK_STAGE2_THREADBLOCK_SIZE>
+        <<<num_vectors, BEAM_STREAMING_TOPK_STAGE2_THREADBLOCK_SIZE, stage2_smem_size, stream>>>(
+            temp_storage, cum_log_probs, ids, vals, K, voc_parts);
+    sync_check_cuda_error();
+}
+
 template <typename T, int MAX_K>
 void topK_softMax_kernelLauncher(const T* log_probs, const T* bias, const FinishedState* finished,
     const int* sequence_lengths, float* cum_log_probs, float* output_log_probs, int** output_ids_ptr,
@@ -614,31 +914,41 @@ void topK_softMax_kernelLauncher(const T* log_probs, const T* bias, const Finish
     T* topk_tmp_val_buf = reinterpret_cast<T*>(topk_tmp_id_buf + topk_buf_offset);
     float* tmp_buffer = reinterpret_cast<float*>(topk_tmp_val_buf + topk_buf_offset);
 
-#ifdef DO_SPLIT_SMALL_TOP_K_SOFTMAX
-    int voc_parts = 4;
-    if (batch_size * beam_width < 256)
+    if constexpr (MAX_K >= BEAM_STREAMING_TOPK_MIN_BEAM_WIDTH)
     {
-        // Volta has 80 SMs, so we aim for three waves
-        voc_parts = (240 + batch_size * beam_width - 1) / (batch_size * beam_width);
-        voc_parts = std::min(128, voc_parts); // we implement up to 128
+        auto const temp_storage_bytes = static_cast<size_t>(temp_storage_size) * sizeof(float)
+            - (reinterpret_cast<char*>(tmp_buffer) - reinterpret_cast<char*>(temp_storage));
+        beam_streaming_topk_kernelLauncher<T>(log_probs, bias, finished, cum_log_probs, topk_tmp_id_buf,
+            topk_tmp_val_buf, tmp_buffer, temp_storage_bytes, batch_size, beam_width, vocab_size, end_ids, stream);
     }
-    dim3 grid(batch_size * beam_width, voc_parts);
-    cudaFuncSetAttribute(beam_online_softmax_topk_stage1_kernel<T, items_per_thread, 2 * MAX_K, block_sz>,
-        cudaFuncAttributePreferredSharedMemoryCarveout, cudaSharedmemCarveoutMaxL1);
-    beam_online_softmax_topk_stage1_kernel<T, items_per_thread, 2 * MAX_K, block_sz>
-        <<<grid, block_sz, 0, stream>>>(log_probs, bias, finished, tmp_buffer, vocab_size, beam_width, end_ids);
-    sync_check_cuda_error();
+    else
+    {
+#ifdef DO_SPLIT_SMALL_TOP_K_SOFTMAX
+        int voc_parts = 4;
+        if (batch_size * beam_width < 256)
+        {
+            // Volta has 80 SMs, so we aim for three waves
+            voc_parts = (240 + batch_size * beam_width - 1) / (batch_size * beam_width);
+            voc_parts = std::min(128, voc_parts); // we implement up to 128
+        }
+        dim3 grid(batch_size * beam_width, voc_parts);
+        cudaFuncSetAttribute(beam_online_softmax_topk_stage1_kernel<T, items_per_thread, 2 * MAX_K, block_sz>,
+            cudaFuncAttributePreferredSharedMemoryCarveout, cudaSharedmemCarveoutMaxL1);
+        beam_online_softmax_topk_stage1_kernel<T, items_per_thread, 2 * MAX_K, block_sz>
+            <<<grid, block_sz, 0, stream>>>(log_probs, bias, finished, tmp_buffer, vocab_size, beam_width, end_ids);
+        sync_check_cuda_error();
 #endif
 
 #ifdef DO_SPLIT_SMALL_TOP_K_SOFTMAX
-    beam_online_softmax_topk_stage2_kernelLauncher<T, 2 * MAX_K>(
-        tmp_buffer, cum_log_probs, topk_tmp_id_buf, topk_tmp_val_buf, batch_size, beam_width, voc_parts, stream);
-    sync_check_cuda_error();
+        beam_online_softmax_topk_stage2_kernelLauncher<T, 2 * MAX_K>(
+            tmp_buffer, cum_log_probs, topk_tmp_id_buf, topk_tmp_val_buf, batch_size, beam_width, voc_parts, stream);
+        sync_check_cuda_error();
 #else
-    beam_online_softmax_topk_kernel<T, items_per_thread, MAX_K, block_sz>
-        <<<batch_size * beam_width, block_sz, 0, stream>>>(log_probs, bias, cum_log_probs, finished, topk_tmp_id_buf,
-            topk_tmp_val_buf, vocab_size, beam_width, end_ids);
+        beam_online_softmax_topk_kernel<T, items_per_thread, MAX_K, block_sz>
+            <<<batch_size * beam_width, block_sz, 0, stream>>>(log_probs, bias, cum_log_probs, finished,
+                topk_tmp_id_buf, topk_tmp_val_buf, vocab_size, beam_width, end_ids);
 #endif
+    }
 
     // We need 2*MAX_K candidates because at most k candidates are finished, and
     // we will not put them into next iteration
@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaTypeUtils.cuh"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/reduceKernelUtils.cuh"
+#include "tensorrt_llm/kernels/pagedContextAttention.h"
+
+#include <cfloat>
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+namespace
+{
+
+// Number of queries of one head handled by one block.
+static constexpr int kQRowsPerBlock = 16;
+// Number of cached tokens loaded to shared memory at once, one per lane when computing the scores.
+static constexpr int kKVTileSize = 32;
+static constexpr int kNumWarps = 4;
+static constexpr int kRowsPerWarp = kQRowsPerBlock / kNumWarps;
+
+template <typename T>
+__device__ inline bool isKVIdxValid(
+    const PagedContextAttentionParams<T>& params, int headIdx, int qIdx, int kvIdx, int kvSeqLength)
+{
+    // Same masks as invokeBuildDecoderInfo, in the coordinates of the kv sequence.
+    switch (params.maskType)
+    {
+    case AttentionMaskType::PADDING: return true;
+    case AttentionMaskType::CAUSAL: return kvIdx <= qIdx && kvIdx >= qIdx - params.attentionWindowSize;
+    case AttentionMaskType::BIDIRECTIONAL:
+    case AttentionMaskType::BIDIRECTIONALGLM:
+        return kvIdx < kvSeqLength - 1 || (qIdx == kvSeqLength - 1 && kvIdx == kvSeqLength - 1);
+    case AttentionMaskType::BLOCKSPARSE: return params.blockSparseParams.computeMask(qIdx, kvIdx, headIdx);
+    }
+    return false;
+}
+
+template <typename T, int HEAD_SIZE, typename KVCacheBuffer>
+__global__ void pagedContextAttentionKernel(const PagedContextAttentionParams<T> params, KVCacheBuffer kvCacheBuffer)
+{
+    static constexpr int kDimsPerLane = (HEAD_SIZE + 31) / 32;
+    // Odd number of 32-bit words per row, so lanes reading different tokens of one channel hit different banks.
+    static constexpr int kSmemStride = HEAD_SIZE + 2;
+
+    __shared__ T qSmem[kQRowsPerBlock][HEAD_SIZE];
+    __shared__ T kSmem[kKVTileSize][kSmemStride];
+    __shared__ T vSmem[kKVTileSize][kSmemStride];
+
+    const int batchIdx = blockIdx.z;
+    const int headIdx = blockIdx.y;
+    const int qTileBegin = blockIdx.x * kQRowsPerBlock;
+    const int qSeqLength = params.qSeqLengths[batchIdx];
+    if (qTileBegin >= qSeqLength)
+    {
+        return;
+    }
+    const int kvSeqLength = params.kvSeqLengths[batchIdx];
+    // The new tokens are the last ones of the kv sequence.
+    const int pastLength = kvSeqLength - qSeqLength;
+    const int kvHeadIdx = headIdx / (params.numHeads / params.numKVHeads);
+    const int tokenOffset = params.cuQSeqLengths ? params.cuQSeqLengths[batchIdx] : batchIdx * params.maxQSeqLength;
+    const int warpIdx = threadIdx.x / 32;
+    const int laneIdx = threadIdx.x % 32;
+
+    for (int i = threadIdx.x; i < kQRowsPerBlock * HEAD_SIZE; i += blockDim.x)
+    {
+        const int row = i / HEAD_SIZE;
+        const int channel = i % HEAD_SIZE;
+        const int qIdx = qTileBegin + row;
+        qSmem[row][channel] = qIdx < qSeqLength
+            ? params.q[(static_cast<size_t>(tokenOffset + qIdx) * params.numHeads + headIdx) * HEAD_SIZE + channel]
+            : T(0.f);
+    }
+
+    // Range of the kv sequence some query of the block can attend to.
+    int kvBegin = 0;
+    int kvEnd = kvSeqLength;
+    if (params.maskType == AttentionMaskType::CAUSAL || params.maskType == AttentionMaskType::BLOCKSPARSE)
+    {
+        kvEnd = pastLength + min(qTileBegin + kQRowsPerBlock, qSeqLength);
+    }
+    if (params.maskType == AttentionMaskType::CAUSAL)
+    {
+        kvBegin = max(0, pastLength + qTileBegin - params.attentionWindowSize);
+    }
+
+    const float alibiSlope = params.alibiSlopes != nullptr ? cuda_cast<float>(params.alibiSlopes[headIdx]) : 0.f;
+
+    float rowMax[kRowsPerWarp];
+    float rowSum[kRowsPerWarp];
+    float acc[kRowsPerWarp][kDimsPerLane];
+#pragma unroll
+    for (int r = 0; r < kRowsPerWarp; ++r)
+    {
+        rowMax[r] = -FLT_MAX;
+        rowSum[r] = 0.f;
+#pragma unroll
+        for (int k = 0; k < kDimsPerLane; ++k)
+        {
+            acc[r][k] = 0.f;
+        }
+    }
+
+    for (int tileBegin = kvBegin; tileBegin < kvEnd; tileBegin += kKVTileSize)
+    {
+        __syncthreads();
+        if (params.maskType == AttentionMaskType::BLOCKSPARSE)
+        {
+            // Skip the tiles that no query of the block attends to without loading them.
+            bool isTileUsed = false;
+            for (int i = threadIdx.x; i < kQRowsPerBlock * kKVTileSize; i += blockDim.x)
+            {
+                const int qIdx = qTileBegin + i / kKVTileSize;
+                const int kvIdx = tileBegin + i % kKVTileSize;
+                isTileUsed = isTileUsed
+                    || (qIdx < qSeqLength && kvIdx < kvEnd
+                        && isKVIdxValid(params, headIdx, pastLength + qIdx, kvIdx, kvSeqLength));
+            }
+            if (!__syncthreads_or(isTileUsed))
+            {
+                continue;
+            }
+        }
+        for (int i = threadIdx.x; i < kKVTileSize * HEAD_SIZE; i += blockDim.x)
+        {
+            const int token = i / HEAD_SIZE;
+            const int channel = i % HEAD_SIZE;
+            const int kvIdx = tileBegin + token;
+            T k(0.f);
+            T v(0.f);
+            if (kvIdx < kvEnd)
+            {
+                const int cacheIdx = kvIdx % params.cyclicKVCacheLength;
+                const int localIdx = kvCacheBuffer.getKVLocalIdx(cacheIdx, kvHeadIdx, HEAD_SIZE, channel);
+                k = reinterpret_cast<const T*>(kvCacheBuffer.getKBlockPtr(batchIdx, cacheIdx))[localIdx];
+                v = reinterpret_cast<const T*>(kvCacheBuffer.getVBlockPtr(batchIdx, cacheIdx))[localIdx];
+            }
+            kSmem[token][channel] = k;
+            vSmem[token][channel] = v;
+        }
+        __syncthreads();
+
+#pragma unroll
+        for (int r = 0; r < kRowsPerWarp; ++r)
+        {
+            const int row = warpIdx + r * kNumWarps;
+            const int qIdx = qTileBegin + row;
+            if (qIdx >= qSeqLength)
+            {
+                continue;
+            }
+            const int qPos = pastLength + qIdx;
+            const int kvIdx = tileBegin + laneIdx;
+
+            float score = 0.f;
+#pragma unroll 8
+            for (int d = 0; d < HEAD_SIZE; ++d)
+            {
+                score += cuda_cast<float>(qSmem[row][d]) * cuda_cast<float>(kSmem[laneIdx][d]);
+            }
+            score = score * params.qkScale + alibiSlope * static_cast<float>(kvIdx - qPos);
+            const bool valid = kvIdx < kvEnd && isKVIdxValid(params, headIdx, qPos, kvIdx, kvSeqLength);
+            score = valid ? score : -FLT_MAX;
+
+            const float newMax = fmaxf(rowMax[r], warpReduceMax(score));
+            if (newMax == -FLT_MAX)
+            {
+                // Nothing to attend to in this tile yet.
+                continue;
+            }
+            const float p = valid ? __expf(score - newMax) : 0.f;
+            const float correction = __expf(rowMax[r] - newMax);
+            rowSum[r] = rowSum[r] * correction + warpReduceSum(p);
+            rowMax[r] = newMax;
+#pragma unroll
+            for (int k = 0; k < kDimsPerLane; ++k)
+            {
+                acc[r][k] *= correction;
+            }
+            for (int j = 0; j < kKVTileSize; ++j)
+            {
+                const float pj = __shfl_sync(FINAL_MASK, p, j);
+#pragma unroll
+                for (int k = 0; k < kDimsPerLane; ++k)
+                {
+                    const int d = laneIdx + k * 32;
+                    if (d < HEAD_SIZE)
+                    {
+                        acc[r][k] += pj * cuda_cast<float>(vSmem[j][d]);
+                    }
+                }
+            }
+        }
+    }
+
+#pragma unroll
+    for (int r = 0; r < kRowsPerWarp; ++r)
+    {
+        const int qIdx = qTileBegin + warpIdx + r * kNumWarps;
+        if (qIdx >= qSeqLength)
+        {
+            continue;
+        }
+        const float invSum = rowSum[r] > 0.f ? 1.f / rowSum[r] : 0.f;
+        T* out = params.output + (static_cast<size_t>(tokenOffset + qIdx) * params.numHeads + headIdx) * HEAD_SIZE;
+#pragma unroll
+        for (int k = 0; k < kDimsPerLane; ++k)
+        {
+            const int d = laneIdx + k * 32;
+            if (d < HEAD_SIZE)
+            {
+                out[d] = cuda_cast<T>(acc[r][k] * invSum);
+            }
+        }
+    }
+}
+
+template <typename T, int HEAD_SIZE, typename KVCacheBuffer>
+void launchPagedContextAttention(
+    const PagedContextAttentionParams<T>& params, const KVCacheBuffer& kvCacheBuffer, cudaStream_t stream)
+{
+    const dim3 grid(divUp(params.maxQSeqLength, kQRowsPerBlock), params.numHeads, params.batchSize);
+    pagedContextAttentionKernel<T, HEAD_SIZE, KVCacheBuffer>
+        <<<grid, kNumWarps * 32, 0, stream>>>(params, kvCacheBuffer);
+}
+
+} // namespace
+
+template <typename T, typename KVCacheBuffer>
+void invokePagedContextAttention(
+    const PagedContextAttentionParams<T>& params, const KVCacheBuffer& kvCacheBuffer, cudaStream_t stream)
+{
+    TLLM_CHECK_WITH_INFO(params.numHeads % params.numKVHeads == 0, "numHeads should be multiple of numKVHeads.");
+    TLLM_CHECK_WITH_INFO(params.maxKVSeqLength <= params.cyclicKVCacheLength,
+        "The context tokens wrap around the cyclic KV cache (%d > %d), which the context attention cannot read back.",
+        params.maxKVSeqLength, params.cyclicKVCacheLength);
+
+    switch (params.headSize)
+    {
+    case 32: launchPagedContextAttention<T, 32>(params, kvCacheBuffer, stream); break;
+    case 48: launchPagedContextAttention<T, 48>(params, kvCacheBuffer, stream); break;
+    case 64: launchPagedContextAttention<T, 64>(params, kvCacheBuffer, stream); break;
+    case 80: launchPagedContextAttention<T, 80>(params, kvCacheBuffer, stream); break;
+    case 96: launchPagedContextAttention<T, 96>(params, kvCacheBuffer, stream); break;
+    case 112: launchPagedContextAttention<T, 112>(params, kvCacheBuffer, stream); break;
+    case 128: launchPagedContextAttention<T, 128>(params, kvCacheBuffer, stream); break;
+    case 144: launchPagedContextAttention<T, 144>(params, kvCacheBuffer, stream); break;
+    case 160: launchPagedContextAttention<T, 160>(params, kvCacheBuffer, stream); break;
+    case 192: launchPagedContextAttention<T, 192>(params, kvCacheBuffer, stream); break;
+    case 224: launchPagedContextAttention<T, 224>(params, kvCacheBuffer, stream); break;
+    case 256: launchPagedContextAttention<T, 256>(params, kvCacheBuffer, stream); break;
+    default: TLLM_THROW("Paged context attention does not support head size %d", params.headSize);
+    }
+}
+
+#define INSTANTIATE_PAGED_CONTEXT_ATTENTION(T, KVCacheBuffer)                                                          \
+    template void invokePagedContextAttention<T, KVCacheBuffer>(                                                       \
+        const PagedContextAttentionParams<T>& params, const KVCacheBuffer& kvCacheBuffer, cudaStream_t stream);
+
+INSTANTIATE_PAGED_CONTEXT_ATTENTION(half, KVBlockArray);
+INSTANTIATE_PAGED_CONTEXT_ATTENTION(half, KVLinearBuffer);
+#ifdef ENABLE_BF16
+INSTANTIATE_PAGED_CONTEXT_ATTENTION(__nv_bfloat16, KVBlockArray);
+INSTANTIATE_PAGED_CONTEXT_ATTENTION(__nv_bfloat16, KVLinearBuffer);
+#endif
+#undef INSTANTIATE_PAGED_CONTEXT_ATTENTION
+
+} // namespace kernels
+} // namespace tensorrt_llm
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/kernels/gptKernels.h"
+#include "tensorrt_llm/kernels/kvCacheUtils.h"
+#include <cuda_runtime.h>
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+template <typename T>
+struct PagedContextAttentionParams
+{
+    // [numTokens, numHeads, headSize], the rotated queries of the new tokens (see invokeApplyBiasRopeUpdateKVCache).
+    const T* q;
+    // [numTokens, numHeads, headSize]
+    T* output;
+    // [numHeads], ALiBi slopes added as slope * (kvIdx - qIdx). Ignored if nullptr.
+    const T* alibiSlopes;
+    // [batchSize], number of new tokens per sequence.
+    const int* qSeqLengths;
+    // [batchSize], number of tokens per sequence including the cached ones (qSeqLength <= kvSeqLength).
+    const int* kvSeqLengths;
+    // [batchSize + 1], offsets of the sequences in q and output when the input is packed. If nullptr, the sequences
+    // are padded to maxQSeqLength.
+    const int* cuQSeqLengths;
+    int batchSize;
+    int maxQSeqLength;
+    int maxKVSeqLength;
+    int numHeads;
+    int numKVHeads;
+    int headSize;
+    // Keys older than (qIdx - attentionWindowSize) are masked for the causal mask.
+    int attentionWindowSize;
+    // Length of the ring the keys and values were written to, see invokeApplyBiasRopeUpdateKVCache.
+    int cyclicKVCacheLength;
+    float qkScale;
+    AttentionMaskType maskType;
+    // The pattern of the BLOCKSPARSE mask, in the coordinates of the kv sequence.
+    BlockSparseParams blockSparseParams;
+};
+
+//! \brief Returns true if invokePagedContextAttention is instantiated for the head size.
+inline bool isPagedContextAttentionSupported(int headSize)
+{
+    return headSize == 32 || headSize == 48 || headSize == 64 || headSize == 80 || headSize == 96 || headSize == 112
+        || headSize == 128 || headSize == 144 || headSize == 160 || headSize == 192 || headSize == 224
+        || headSize == 256;
+}
+
+//! \brief Context attention of the new tokens of each sequence against all its keys and values in the KV cache,
+//! including the tokens that were already cached (e.g. a reused prefix). The keys and values of the new tokens must
+//! already be written to the cache. The softmax is computed online over tiles of the cache, so the memory footprint
+//! does not depend on the sequence length. Complements the precompiled fused MHA kernels for the head sizes they do
+//! not cover. Supports non-quantized caches only.
+//!
+//! \param params see PagedContextAttentionParams
+//! \param kvCacheBuffer KVBlockArray or KVLinearBuffer holding the keys and values
+//! \param stream cuda stream
+template <typename T, typename KVCacheBuffer>
+void invokePagedContextAttention(
+    const PagedContextAttentionParams<T>& params, const KVCacheBuffer& kvCacheBuffer, cudaStream_t stream);
+
+} // namespace kernels
+} // namespace tensorrt_llm
@@ -103,13 +103,64 @@ void apply_per_channel_scale_kernel_launcher(
     }
 }
 
+template <typename T, int kElems>
+__global__ void apply_per_channel_scale_and_permutation(
+    T* smoothed_act, const T* act, const T* per_channel_scale, const int* permutation, int cols)
+{
+    using AccessType = std::conditional_t<kElems == 1, T, float4>;
+    // One row per block, each thread writes kElems consecutive columns gathered from the row
+    int col_offset = (blockIdx.y * blockDim.x + threadIdx.x) * kElems;
+    if (col_offset >= cols)
+        return;
+    act += static_cast<int64_t>(blockIdx.x) * cols;
+    smoothed_act += static_cast<int64_t>(blockIdx.x) * cols;
+    T act_vec[kElems];
+#pragma unroll
+    for (int j = 0; j < kElems; ++j)
+    {
+        float val = static_cast<float>(act[permutation[col_offset + j]]);
+        if (per_channel_scale != nullptr)
+        {
+            val *= static_cast<float>(per_channel_scale[col_offset + j]);
+        }
+        act_vec[j] = static_cast<T>(val);
+    }
+    *reinterpret_cast<AccessType*>(smoothed_act + col_offset) = *reinterpret_cast<AccessType*>(act_vec);
+}
+
+template <typename T>
+void apply_per_channel_scale_and_permutation_kernel_launcher(T* smoothed_act, const T* act,
+    const T* per_channel_scale, const int* permutation, int rows, int cols, cudaStream_t stream)
+{
+    static constexpr int kVecElems = sizeof(float4) / sizeof(T);
+    dim3 block(128);
+    if (cols % kVecElems == 0)
+    {
+        dim3 grid(rows, (cols / kVecElems + block.x - 1) / block.x);
+        apply_per_channel_scale_and_permutation<T, kVecElems>
+            <<<grid, block, 0, stream>>>(smoothed_act, act, per_channel_scale, permutation, cols);
+    }
+    else
+    {
+        dim3 grid(rows, (cols + block.x - 1) / block.x);
+        apply_per_channel_scale_and_permutation<T, 1>
+            <<<grid, block, 0, stream>>>(smoothed_act, act, per_channel_scale, permutation, cols);
+    }
+}
+
 #define INSTANTIATE_PREQUANT_SCALE(T)                                                                                  \
     template void apply_per_channel_scale_kernel_launcher<T>(                                                          \
         T * smoothed_act, const T* act, const T* per_channel_scale, int rows, int cols, cudaStream_t stream)
 
+#define INSTANTIATE_PREQUANT_SCALE_AND_PERMUTATION(T)                                                                  \
+    template void apply_per_channel_scale_and_permutation_kernel_launcher<T>(T * smoothed_act, const T* act,           \
+        const T* per_channel_scale, const int* permutation, int rows, int cols, cudaStream_t stream)
+
 INSTANTIATE_PREQUANT_SCALE(half);
+INSTANTIATE_PREQUANT_SCALE_AND_PERMUTATION(half);
 #if defined(ENABLE_BF16)
 INSTANTIATE_PREQUANT_SCALE(__nv_bfloat16);
+INSTANTIATE_PREQUANT_SCALE_AND_PERMUTATION(__nv_bfloat16);
 #endif
 
 } // namespace kernels
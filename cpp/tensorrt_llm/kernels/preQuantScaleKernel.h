@@ -36,5 +36,17 @@ template <typename T>
 void apply_per_channel_scale_kernel_launcher(
     T* smoothed_act, const T* act, const T* per_channel_scale, int rows, int cols, cudaStream_t stream = 0);
 
+//! \brief Gathers the columns of the activations in the order of `permutation` and applies the optional per channel
+//! scale, i.e. smoothed_act[r, c] = act[r, permutation[c]] * per_channel_scale[c].
+//!
+//! Used for the GPTQ checkpoints quantized with act-order, whose K dimension is sorted by group when the weights are
+//! loaded, so that the activations match the reordered weights in the same pass as the pre-quant scale.
+//!
+//! \param per_channel_scale [cols], in the permuted order. May be null
+//! \param permutation [cols], the column of `act` of each column of `smoothed_act`
+template <typename T>
+void apply_per_channel_scale_and_permutation_kernel_launcher(T* smoothed_act, const T* act,
+    const T* per_channel_scale, const int* permutation, int rows, int cols, cudaStream_t stream = 0);
+
 } // namespace kernels
 } // namespace tensorrt_llm
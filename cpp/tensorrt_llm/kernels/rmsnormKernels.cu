@@ -205,6 +205,159 @@ void invokeGeneralRmsNorm(T* out, const T* input, const T* gamma, const T* beta,
     }
 }
 
+template <typename T, int kVec>
+struct alignas(sizeof(T) * kVec) AlignedVec
+{
+    T data[kVec];
+};
+
+template <typename T, typename QuantT>
+__device__ inline QuantT cast_rmsnorm_output(float val, float scale)
+{
+    if constexpr (std::is_same_v<T, QuantT>)
+    {
+        return cuda_cast<T>(val);
+    }
+    else
+    {
+        return cuda_cast<QuantT>(val * scale);
+    }
+}
+
+/* Computes residual_out <- input + residual and out <- gamma * residual_out / Sqrt(E[residual_out²] + eps).
+ *
+ * One warp handles one row, the lanes stride over the row by vectors of kVec elements. The second pass reads back
+ * the sum written by the same lane, from the L1 or L2 cache. With dynamic scaling, a third pass finds the amax of the
+ * row before writing the int8 output.
+ */
+template <typename T, typename QuantT, int kVec>
+__global__ void residualRmsNorm(QuantT* out, T* residual_out, const T* input, const T* residual, const T* gamma,
+    const float eps, int tokens, int hidden_dim, const float* scale, float* dynamic_scale)
+{
+    using Vec = AlignedVec<T, kVec>;
+    using QuantVec = AlignedVec<QuantT, kVec>;
+
+    const int lane = threadIdx.x % 32;
+    const int row = blockIdx.x * (blockDim.x / 32) + threadIdx.x / 32;
+    if (row >= tokens)
+    {
+        return;
+    }
+
+    const int n_vecs = hidden_dim / kVec;
+    const size_t row_offset = static_cast<size_t>(row) * n_vecs;
+    const Vec* input_vecs = reinterpret_cast<const Vec*>(input) + row_offset;
+    const Vec* residual_vecs = reinterpret_cast<const Vec*>(residual) + row_offset;
+    Vec* residual_out_vecs = reinterpret_cast<Vec*>(residual_out) + row_offset;
+    const Vec* gamma_vecs = reinterpret_cast<const Vec*>(gamma);
+    QuantVec* out_vecs = reinterpret_cast<QuantVec*>(out) + row_offset;
+
+    float sum_sq = 0.f;
+    for (int i = lane; i < n_vecs; i += 32)
+    {
+        const Vec in = input_vecs[i];
+        const Vec res = residual_vecs[i];
+        Vec sum;
+#pragma unroll
+        for (int j = 0; j < kVec; ++j)
+        {
+            sum.data[j] = cuda_cast<T>(cuda_cast<float>(in.data[j]) + cuda_cast<float>(res.data[j]));
+            // The norm is the one of the rounded sum, like with a separate residual connection
+            const float val = cuda_cast<float>(sum.data[j]);
+            sum_sq += val * val;
+        }
+        residual_out_vecs[i] = sum;
+    }
+    const float inv_rms = rsqrtf(warpReduceSum(sum_sq) / hidden_dim + eps);
+
+    float out_scale = (scale != nullptr) ? *scale : 1.f;
+    if (dynamic_scale != nullptr)
+    {
+        float amax = 1e-6f;
+        for (int i = lane; i < n_vecs; i += 32)
+        {
+            const Vec sum = residual_out_vecs[i];
+            const Vec g = gamma_vecs[i];
+#pragma unroll
+            for (int j = 0; j < kVec; ++j)
+            {
+                amax = fmaxf(amax, fabsf(cuda_cast<float>(sum.data[j]) * inv_rms * cuda_cast<float>(g.data[j])));
+            }
+        }
+        amax = warpReduceMax(amax);
+        out_scale = 127.f / amax;
+        if (lane == 0)
+        {
+            dynamic_scale[row] = amax / 127.f;
+        }
+    }
+
+    for (int i = lane; i < n_vecs; i += 32)
+    {
+        const Vec sum = residual_out_vecs[i];
+        const Vec g = gamma_vecs[i];
+        QuantVec normed;
+#pragma unroll
+        for (int j = 0; j < kVec; ++j)
+        {
+            normed.data[j] = cast_rmsnorm_output<T, QuantT>(
+                cuda_cast<float>(sum.data[j]) * inv_rms * cuda_cast<float>(g.data[j]), out_scale);
+        }
+        out_vecs[i] = normed;
+    }
+}
+
+template <typename T, typename QuantT>
+void invokeResidualRmsNorm(QuantT* out, T* residual_out, const T* input, const T* residual, const T* gamma,
+    const float eps, const int tokens, const int hidden_dim, cudaStream_t stream, const float* scale,
+    float* dynamic_scale)
+{
+    constexpr int warps_per_block = 4;
+    dim3 block(32 * warps_per_block);
+    dim3 grid((tokens + warps_per_block - 1) / warps_per_block);
+
+    constexpr int vec_size = 16 / sizeof(T);
+    const auto is_aligned = [](const void* ptr) { return reinterpret_cast<uintptr_t>(ptr) % 16 == 0; };
+    // The output vectors are narrower when quantized, their alignment follows from the one of the row size
+    const bool use_vec_type = (hidden_dim % vec_size == 0) && is_aligned(out) && is_aligned(residual_out)
+        && is_aligned(input) && is_aligned(residual) && is_aligned(gamma);
+
+    if (use_vec_type)
+    {
+        residualRmsNorm<T, QuantT, vec_size><<<grid, block, 0, stream>>>(
+            out, residual_out, input, residual, gamma, eps, tokens, hidden_dim, scale, dynamic_scale);
+    }
+    else
+    {
+        residualRmsNorm<T, QuantT, 1><<<grid, block, 0, stream>>>(
+            out, residual_out, input, residual, gamma, eps, tokens, hidden_dim, scale, dynamic_scale);
+    }
+    sync_check_cuda_error();
+}
+
+#define INSTANTIATE_RESIDUAL_RMSNORM(T, QuantT)                                                                        \
+    template void invokeResidualRmsNorm(QuantT* out, T* residual_out, const T* input, const T* residual,               \
+        const T* gamma, const float eps, const int tokens, const int hidden_dim, cudaStream_t stream,                  \
+        const float* scale, float* dynamic_scale);
+
+INSTANTIATE_RESIDUAL_RMSNORM(float, float);
+INSTANTIATE_RESIDUAL_RMSNORM(half, half);
+INSTANTIATE_RESIDUAL_RMSNORM(float, int8_t);
+INSTANTIATE_RESIDUAL_RMSNORM(half, int8_t);
+
+#ifdef ENABLE_BF16
+INSTANTIATE_RESIDUAL_RMSNORM(__nv_bfloat16, __nv_bfloat16);
+INSTANTIATE_RESIDUAL_RMSNORM(__nv_bfloat16, int8_t);
+#endif
+
+#ifdef ENABLE_FP8
+INSTANTIATE_RESIDUAL_RMSNORM(float, __nv_fp8_e4m3);
+INSTANTIATE_RESIDUAL_RMSNORM(half, __nv_fp8_e4m3);
+#ifdef ENABLE_BF16
+INSTANTIATE_RESIDUAL_RMSNORM(__nv_bfloat16, __nv_fp8_e4m3);
+#endif
+#endif
+
 #define INSTANTIATE_GENERAL_RMSNORM(T)                                                                                 \
     template void invokeGeneralRmsNorm(T* out, const T* input, const T* gamma, const T* beta, const float eps,         \
         const int tokens, const int hidden_dim, cudaStream_t stream, const float* scale, float* dynamic_scale,         \
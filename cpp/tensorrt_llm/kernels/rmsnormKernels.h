@@ -31,5 +31,24 @@ void invokeGeneralRmsNorm(T* out, const T* input, const T* gamma, const T* beta,
     const int hidden_dim, cudaStream_t stream = 0, const float* scale = nullptr, float* dynamic_scale = nullptr,
     int8_t* out_quant = nullptr);
 
+//! \brief Adds the residual to the input and normalizes the sum, the residual connection and the RMS norm that follows
+//! it in one pass over the activations.
+//!
+//! One warp handles a row, with 16-byte accesses when the hidden size and the pointers allow them. The output is
+//! quantized to `QuantT` when it differs from `T`: int8 with the per-tensor `scale` or, if `dynamic_scale` is set,
+//! with a per-token scale written to `dynamic_scale`, or fp8 with the per-tensor `scale`.
+//!
+//! \param out output buffer [tokens, hidden_dim], gamma * (input + residual) / rms(input + residual)
+//! \param residual_out output buffer [tokens, hidden_dim], input + residual. May be `residual`
+//! \param input input buffer [tokens, hidden_dim]
+//! \param residual input buffer [tokens, hidden_dim]
+//! \param gamma input buffer [hidden_dim]
+//! \param scale input buffer [1], the scale of the quantized output. Ignored if `QuantT` is `T`
+//! \param dynamic_scale output buffer [tokens], the scales of the rows of the int8 output. Null for a per-tensor scale
+template <typename T, typename QuantT>
+void invokeResidualRmsNorm(QuantT* out, T* residual_out, const T* input, const T* residual, const T* gamma,
+    const float eps, const int tokens, const int hidden_dim, cudaStream_t stream = 0, const float* scale = nullptr,
+    float* dynamic_scale = nullptr);
+
 } // namespace kernels
 } // namespace tensorrt_llm
@@ -0,0 +1,465 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CUDART_VERSION
+#error CUDART_VERSION Undefined!
+#elif (CUDART_VERSION >= 11050)
+#include <cub/cub.cuh>
+#else
+#include "3rdparty/cub/cub.cuh"
+#endif
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/samplingFusedKernels.h"
+
+#include <climits>
+#include <float.h>
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+namespace
+{
+
+constexpr int FUSED_SAMPLING_BLOCK_SIZE = 512;
+// The 32 bit keys are selected in three passes over the bits [31, 21], [20, 10] and [10, 0].
+// Bit 10 is already fixed when the last pass runs.
+constexpr int RADIX_BITS = 11;
+constexpr int RADIX_BINS = 1 << RADIX_BITS;
+constexpr int RADIX_PASSES = 3;
+
+// Maps a float to an unsigned key with the same order
+__device__ __forceinline__ uint32_t orderedKey(float x)
+{
+    uint32_t const bits = __float_as_uint(x);
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+struct MaxSum
+{
+    float max;
+    float sum;
+    int argMax;
+};
+
+struct MaxSumOp
+{
+    __device__ __forceinline__ MaxSum operator()(MaxSum const& a, MaxSum const& b) const
+    {
+        MaxSum out;
+        out.max = fmaxf(a.max, b.max);
+        out.sum = a.sum * __expf(a.max - out.max) + b.sum * __expf(b.max - out.max);
+        out.argMax = (a.max > b.max || (a.max == b.max && a.argMax < b.argMax)) ? a.argMax : b.argMax;
+        return out;
+    }
+};
+
+template <typename T>
+struct RunningPrefixOp
+{
+    T runningTotal;
+
+    __device__ RunningPrefixOp(T runningTotal)
+        : runningTotal(runningTotal)
+    {
+    }
+
+    __device__ T operator()(T blockAggregate)
+    {
+        T const oldPrefix = runningTotal;
+        runningTotal += blockAggregate;
+        return oldPrefix;
+    }
+};
+
+// The tokens selected for sampling are those with (key & mask) > prefix, followed by the first tieCount tokens
+// in index order with (key & mask) == prefix. Keys are ordered like the logits.
+struct RadixSelection
+{
+    uint32_t prefix;
+    uint32_t mask;
+    int tieCount;
+    float mass;
+};
+
+template <int BLOCK_SIZE>
+struct FusedSamplingTempStorage
+{
+    static constexpr int BINS_PER_THREAD = RADIX_BINS / BLOCK_SIZE;
+
+    union
+    {
+        typename cub::BlockReduce<MaxSum, BLOCK_SIZE>::TempStorage reduceMaxSum;
+        typename cub::BlockReduce<int, BLOCK_SIZE>::TempStorage reduceInt;
+        typename cub::BlockScan<int, BLOCK_SIZE>::TempStorage scanInt;
+        typename cub::BlockScan<float, BLOCK_SIZE>::TempStorage scanFloat;
+    };
+
+    int counts[RADIX_BINS];
+    float masses[RADIX_BINS];
+
+    int selectedDigit;
+    float aboveMass;
+    int binCount;
+    float binMass;
+    float remaining;
+    RadixSelection selection;
+};
+
+//! \brief Selects the tokens with the highest logits until either their number reaches target (byMass == false) or
+//! their probability reaches target (byMass == true). Must be called by all threads of the block, the result is
+//! written to storage.selection.
+template <int BLOCK_SIZE, typename LogitFn>
+__device__ void radixSelect(FusedSamplingTempStorage<BLOCK_SIZE>& storage, bool byMass, float target, int vocabSize,
+    float maxLogit, float invSum, LogitFn const& logitAt)
+{
+    constexpr int BINS_PER_THREAD = FusedSamplingTempStorage<BLOCK_SIZE>::BINS_PER_THREAD;
+    static_assert(BINS_PER_THREAD * BLOCK_SIZE == RADIX_BINS, "The radix bins must be spread evenly over the block");
+    const int tid = threadIdx.x;
+
+    uint32_t prefix = 0;
+    uint32_t mask = 0;
+    float mass = 0.0f;
+    float remaining = target;
+
+    for (int pass = 0; pass < RADIX_PASSES; ++pass)
+    {
+        const int shift = max(32 - RADIX_BITS * (pass + 1), 0);
+        for (int i = tid; i < RADIX_BINS; i += BLOCK_SIZE)
+        {
+            storage.counts[i] = 0;
+            storage.masses[i] = 0.0f;
+        }
+        __syncthreads();
+
+        for (int vi = tid; vi < vocabSize; vi += BLOCK_SIZE)
+        {
+            float const logit = logitAt(vi);
+            uint32_t const key = orderedKey(logit);
+            if ((key & mask) == prefix)
+            {
+                int const digit = (key >> shift) & (RADIX_BINS - 1);
+                atomicAdd(&storage.counts[digit], 1);
+                atomicAdd(&storage.masses[digit], __expf(logit - maxLogit) * invSum);
+            }
+        }
+        __syncthreads();
+
+        // Thread tid scans the bins from the highest digit down, so exclusive sums give what lies above each bin
+        int counts[BINS_PER_THREAD];
+        float masses[BINS_PER_THREAD];
+#pragma unroll
+        for (int j = 0; j < BINS_PER_THREAD; ++j)
+        {
+            int const digit = RADIX_BINS - 1 - (tid * BINS_PER_THREAD + j);
+            counts[j] = storage.counts[digit];
+            masses[j] = storage.masses[digit];
+        }
+        int countsAbove[BINS_PER_THREAD];
+        float massesAbove[BINS_PER_THREAD];
+        int countTotal;
+        float massTotal;
+        cub::BlockScan<int, BLOCK_SIZE>(storage.scanInt).ExclusiveSum(counts, countsAbove, countTotal);
+        __syncthreads();
+        cub::BlockScan<float, BLOCK_SIZE>(storage.scanFloat).ExclusiveSum(masses, massesAbove, massTotal);
+
+        // Clamp the target for rounding errors and for requests selecting more tokens than there are
+        float const goal = byMass ? fminf(remaining, massTotal) : fminf(remaining, static_cast<float>(countTotal));
+#pragma unroll
+        for (int j = 0; j < BINS_PER_THREAD; ++j)
+        {
+            float const above = byMass ? massesAbove[j] : static_cast<float>(countsAbove[j]);
+            float const upTo = above + (byMass ? masses[j] : static_cast<float>(counts[j]));
+            // Exactly one bin crosses the goal. Empty bins never do.
+            if (above < goal && goal <= upTo)
+            {
+                storage.selectedDigit = RADIX_BINS - 1 - (tid * BINS_PER_THREAD + j);
+                storage.aboveMass = massesAbove[j];
+                storage.binCount = counts[j];
+                storage.binMass = masses[j];
+                storage.remaining = goal - above;
+            }
+        }
+        __syncthreads();
+
+        prefix |= static_cast<uint32_t>(storage.selectedDigit) << shift;
+        mask |= static_cast<uint32_t>(RADIX_BINS - 1) << shift;
+        mass += storage.aboveMass;
+        remaining = storage.remaining;
+        int const binCount = storage.binCount;
+        float const binMass = storage.binMass;
+
+        bool const wholeBin = binCount == 1 || (!byMass && remaining == static_cast<float>(binCount));
+        bool const lastPass = pass == RADIX_PASSES - 1;
+        if (wholeBin || lastPass)
+        {
+            int tieCount = binCount;
+            if (!wholeBin)
+            {
+                // All the keys of the last bin are equal, so are the probabilities of its tokens
+                float const tokenMass = binMass / binCount;
+                tieCount = byMass ? min(binCount, max(1, static_cast<int>(ceilf(remaining / tokenMass))))
+                                  : static_cast<int>(remaining);
+                mass += tieCount * tokenMass;
+            }
+            else
+            {
+                mass += binMass;
+            }
+            if (tid == 0)
+            {
+                storage.selection = RadixSelection{prefix, mask, tieCount, mass};
+            }
+            __syncthreads();
+            return;
+        }
+    }
+}
+
+template <typename T, int BLOCK_SIZE>
+__launch_bounds__(BLOCK_SIZE) __global__ void fusedSampling(int** ids, int* sequenceLengths,
+    const FinishedState* finishedInput, FinishedState* finishedOutput, float* cumLogProbs, float* outputLogProbs,
+    const T* logits, const T* bias, const float* temperatures, const int* topKs, const float* topPs,
+    curandState_t* curandState, const int* endIds, const int vocabSize, const int vocabSizePadded,
+    const bool* skipDecode, const bool normalizeLogProbs, const uint64_t* randomSeeds)
+{
+    const int tid = threadIdx.x;
+    const int batchId = blockIdx.x;
+    const FinishedState finishState = finishedInput != nullptr ? finishedInput[batchId] : FinishedState::empty();
+    if ((skipDecode != nullptr && skipDecode[batchId]) || finishState.isSkipDecoding())
+    {
+        return;
+    }
+
+    if (finishState.isFinished())
+    {
+        if (tid == 0)
+        {
+            if (finishedOutput != nullptr)
+            {
+                finishedOutput[batchId] = finishState;
+            }
+            ids[batchId][sequenceLengths[batchId]] = endIds[batchId];
+        }
+        return;
+    }
+
+    __shared__ FusedSamplingTempStorage<BLOCK_SIZE> storage;
+    __shared__ float sMaxLogit;
+    __shared__ float sSum;
+    __shared__ int sArgMax;
+    __shared__ float sRandNum;
+    __shared__ int sSelectedId;
+
+    // Same as batchApplyTemperaturePenalty
+    const float invTemperature = temperatures != nullptr ? 1.0f / (temperatures[batchId] + 1e-6f) : 1.0f;
+    const T* rowLogits = logits + batchId * vocabSizePadded;
+    auto const logitAt = [&](int vi)
+    {
+        float logit = static_cast<float>(rowLogits[vi]);
+        if (bias != nullptr)
+        {
+            logit += static_cast<float>(bias[vi]);
+        }
+        return logit * invTemperature;
+    };
+
+    // Online softmax normalizer, the argmax is the answer for greedy requests
+    MaxSum partial{-FLT_MAX, 0.0f, INT_MAX};
+    for (int vi = tid; vi < vocabSize; vi += BLOCK_SIZE)
+    {
+        float const logit = logitAt(vi);
+        if (logit > partial.max)
+        {
+            partial.sum = partial.sum * __expf(partial.max - logit) + 1.0f;
+            partial.max = logit;
+            partial.argMax = vi;
+        }
+        else
+        {
+            partial.sum += __expf(logit - partial.max);
+        }
+    }
+    MaxSum const total = cub::BlockReduce<MaxSum, BLOCK_SIZE>(storage.reduceMaxSum).Reduce(partial, MaxSumOp{});
+    if (tid == 0)
+    {
+        sMaxLogit = total.max;
+        sSum = total.sum;
+        sArgMax = total.argMax;
+    }
+    __syncthreads();
+
+    const float maxLogit = sMaxLogit;
+    const float invSum = 1.0f / sSum;
+    const int topK = topKs != nullptr ? topKs[batchId] : 0;
+    const float topP = topPs != nullptr ? topPs[batchId] : 1.0f;
+    const bool useTopK = topK > 0 && topK < vocabSize;
+    const bool useTopP = topP < 1.0f;
+
+    int selectedId;
+    float topKMass = 1.0f;
+    if (topK == 1)
+    {
+        selectedId = sArgMax;
+        topKMass = invSum;
+    }
+    else
+    {
+        RadixSelection selection{0u, 0u, INT_MAX, 1.0f};
+        if (useTopK)
+        {
+            radixSelect(storage, false, static_cast<float>(topK), vocabSize, maxLogit, invSum, logitAt);
+            selection = storage.selection;
+            topKMass = selection.mass;
+        }
+        if (useTopP)
+        {
+            RadixSelection const topKSelection = selection;
+            radixSelect(storage, true, topP * topKSelection.mass, vocabSize, maxLogit, invSum, logitAt);
+            selection = storage.selection;
+            if (useTopK && selection.prefix == topKSelection.prefix && selection.mask == topKSelection.mask)
+            {
+                // The top P tokens are a prefix of the top K tokens, up to rounding in the last bin
+                selection.tieCount = min(selection.tieCount, topKSelection.tieCount);
+            }
+        }
+
+        if (tid == 0)
+        {
+            sRandNum
+                = drawSamplingUniform(curandState, randomSeeds, batchId, sequenceLengths[batchId]) * selection.mass;
+            sSelectedId = INT_MAX;
+        }
+        __syncthreads();
+        const float randNum = sRandNum;
+
+        // Draw from the selected tokens in index order, the categorical distribution does not depend on the order
+        RunningPrefixOp<int> tiePrefixOp(0);
+        RunningPrefixOp<float> massPrefixOp(0.0f);
+        int lastSelectable = -1;
+        for (int base = 0; base < vocabSize; base += BLOCK_SIZE)
+        {
+            const int vi = base + tid;
+            float const logit = vi < vocabSize ? logitAt(vi) : -FLT_MAX;
+            uint32_t const maskedKey = orderedKey(logit) & selection.mask;
+            bool const isTie = vi < vocabSize && maskedKey == selection.prefix;
+            int tieRank;
+            cub::BlockScan<int, BLOCK_SIZE>(storage.scanInt).ExclusiveSum(isTie ? 1 : 0, tieRank, tiePrefixOp);
+            __syncthreads();
+
+            bool const selectable
+                = vi < vocabSize && (maskedKey > selection.prefix || (isTie && tieRank < selection.tieCount));
+            float const prob = selectable ? __expf(logit - maxLogit) * invSum : 0.0f;
+            float cumProb;
+            cub::BlockScan<float, BLOCK_SIZE>(storage.scanFloat).InclusiveSum(prob, cumProb, massPrefixOp);
+            if (selectable)
+            {
+                lastSelectable = vi;
+                if (cumProb >= randNum)
+                {
+                    atomicMin(&sSelectedId, vi);
+                }
+            }
+            __syncthreads();
+            if (sSelectedId != INT_MAX)
+            {
+                break;
+            }
+        }
+
+        if (sSelectedId == INT_MAX)
+        {
+            // The random number exceeded the summed probabilities by a rounding error
+            int const last = cub::BlockReduce<int, BLOCK_SIZE>(storage.reduceInt).Reduce(lastSelectable, cub::Max());
+            if (tid == 0)
+            {
+                sSelectedId = last;
+            }
+            __syncthreads();
+        }
+        selectedId = sSelectedId;
+    }
+
+    if (tid == 0)
+    {
+        const int currentStep = sequenceLengths[batchId];
+        ids[batchId][currentStep] = selectedId;
+        if (cumLogProbs != nullptr || outputLogProbs != nullptr)
+        {
+            float logProb = logitAt(selectedId) - maxLogit - __logf(sSum);
+            if (normalizeLogProbs && topK > 0)
+            {
+                logProb -= __logf(topKMass);
+            }
+            if (cumLogProbs != nullptr)
+            {
+                cumLogProbs[batchId] += logProb;
+            }
+            if (outputLogProbs != nullptr)
+            {
+                outputLogProbs[batchId] = logProb;
+            }
+        }
+        if (sequenceLengths != nullptr && finishedOutput != nullptr)
+        {
+            if (selectedId == endIds[batchId])
+            {
+                finishedOutput[batchId].setFinishedEOS();
+                // Do not increase seq len when EOS is generated. Seq len should always contain only tokens to be
+                // outputted
+            }
+            else
+            {
+                // We don't need to set output finished state as it is assumed to be in non finished state
+                sequenceLengths[batchId] += 1;
+            }
+        }
+    }
+}
+
+} // namespace
+
+template <typename T>
+void invokeBatchFusedSampling(int** outputIds, int* sequenceLengths, const FinishedState* finishedInput,
+    FinishedState* finishedOutput, float* cumLogProbs, float* outputLogProbs, const T* logits, const T* bias,
+    const float* temperatures, const int* topKs, const float* topPs, curandState_t* curandState, const int* endIds,
+    const int batchSize, const int vocabSize, const int vocabSizePadded, const bool* skipDecode,
+    const bool normalizeLogProbs, cudaStream_t stream, const uint64_t* randomSeeds)
+{
+    dim3 grid(batchSize);
+    dim3 block(FUSED_SAMPLING_BLOCK_SIZE);
+    fusedSampling<T, FUSED_SAMPLING_BLOCK_SIZE><<<grid, block, 0, stream>>>(outputIds, sequenceLengths, finishedInput,
+        finishedOutput, cumLogProbs, outputLogProbs, logits, bias, temperatures, topKs, topPs, curandState, endIds,
+        vocabSize, vocabSizePadded, skipDecode, normalizeLogProbs, randomSeeds);
+}
+
+template void invokeBatchFusedSampling(int** outputIds, int* sequenceLengths, const FinishedState* finishedInput,
+    FinishedState* finishedOutput, float* cumLogProbs, float* outputLogProbs, const float* logits, const float* bias,
+    const float* temperatures, const int* topKs, const float* topPs, curandState_t* curandState, const int* endIds,
+    const int batchSize, const int vocabSize, const int vocabSizePadded, const bool* skipDecode,
+    const bool normalizeLogProbs, cudaStream_t stream, const uint64_t* randomSeeds);
+
+template void invokeBatchFusedSampling(int** outputIds, int* sequenceLengths, const FinishedState* finishedInput,
+    FinishedState* finishedOutput, float* cumLogProbs, float* outputLogProbs, const half* logits, const half* bias,
+    const float* temperatures, const int* topKs, const float* topPs, curandState_t* curandState, const int* endIds,
+    const int batchSize, const int vocabSize, const int vocabSizePadded, const bool* skipDecode,
+    const bool normalizeLogProbs, cudaStream_t stream, const uint64_t* randomSeeds);
+
+} // namespace kernels
+} // namespace tensorrt_llm
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/kernels/decodingCommon.h"
+#include <curand_kernel.h>
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+// clang-format off
+//! \brief Given raw logits, applies the embedding bias and the temperature and performs top K and/or top P sampling
+//! in a single kernel. Fills sampled tokens to outputIds. Computes sequenceLength, finished state, cumLogProbs inplace.
+//! One block handles one request. The softmax is computed on the fly and the top K / top P sets are found with a
+//! radix select over the logits instead of a sort, so the logits are only read and never written.
+//! Requests with topK == 1 are decoded greedily in a single pass over the logits.
+//! A request with both topK > 0 and topP < 1 samples from the smallest prefix of its top K tokens holding topP of
+//! their probability, as invokeBatchTopKSampling does.
+//!
+//! \param outputIds output buffer [batchSize][maxSeqLen]. Contains pointers to rows with output tokens per request
+//! \param sequenceLengths input/output buffer [batchSize]. Current sequence length of the request up to, but excluding endId token
+//! \param finishedInput input buffer [batchSize]. Flag if sequence has finished.
+//! \param finishedOutput output buffer [batchSize]. Flag if sequence has finished.
+//! \param cumLogProbs input/output buffer [batchSize]. Cumulative log probability of selected tokens. Ignored if nullptr
+//! \param outputLogProbs output buffer [batchSize]. Log probs of the selected tokens under the full vocab softmax.
+//! If normalizeLogProbs is set, requests with topK > 0 normalize it by the probability of their top K tokens.
+//! Ignored if nullptr
+//! \param logits input buffer [batchSize, vocabSizePadded]. Logits after the penalties, without bias and temperature
+//! \param bias input buffer [vocabSizePadded]. Embedding bias added to the logits. Ignored if nullptr
+//! \param temperatures input buffer [batchSize]. Temperature per request. Ignored if nullptr
+//! \param topKs input buffer [batchSize]. K for top K sampling per request, 0 disables top K. If nullptr, top K is disabled
+//! \param topPs input buffer [batchSize]. P for top P sampling per request in range (0.0; 1.0], 1.0 disables top P.
+//! If nullptr, top P is disabled
+//! \param curandState input buffer [batchSize]. Curand states properly
+//! initialized using invokeCurandInitialize per request.
+//! \param endIds input buffer [batchSize]. EOS token ids per request
+//! \param batchSize batch size
+//! \param vocabSize size of the vocabulary
+//! \param vocabSizePadded size of the padded vocab
+//! \param skipDecode input buffer [batchSize]. Flags whether to skip decoding per request. Ignored if nullptr
+//! \param normalizeLogProbs normalize the log probs of the top K requests
+//! \param stream cuda stream
+//! \param randomSeeds input buffer [batchSize]. Seeds per request for counter-based random numbers, see
+//! drawSamplingUniform. If nullptr, curandState is used
+// clang-format on
+template <typename T>
+void invokeBatchFusedSampling(int** outputIds, int* sequenceLengths, const FinishedState* finishedInput,
+    FinishedState* finishedOutput, float* cumLogProbs, float* outputLogProbs, const T* logits, const T* bias,
+    const float* temperatures, const int* topKs, const float* topPs, curandState_t* curandState, const int* endIds,
+    const int batchSize, const int vocabSize, const int vocabSizePadded, const bool* skipDecode,
+    const bool normalizeLogProbs, cudaStream_t stream, const uint64_t* randomSeeds = nullptr);
+
+} // namespace kernels
+} // namespace tensorrt_llm
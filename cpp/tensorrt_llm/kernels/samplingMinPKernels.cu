@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CUDART_VERSION
+#error CUDART_VERSION Undefined!
+#elif (CUDART_VERSION >= 11050)
+#include <cub/cub.cuh>
+#else
+#include "3rdparty/cub/cub.cuh"
+#endif
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/samplingMinPKernels.h"
+
+#include <climits>
+#include <float.h>
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+namespace
+{
+
+constexpr int MIN_P_SAMPLING_BLOCK_SIZE = 256;
+
+struct MinPPrefixOp
+{
+    float runningTotal;
+
+    __device__ MinPPrefixOp(float runningTotal)
+        : runningTotal(runningTotal)
+    {
+    }
+
+    // Called by the first warp, returns the prefix of the current tile
+    __device__ float operator()(float blockAggregate)
+    {
+        float const prefix = runningTotal;
+        runningTotal += blockAggregate;
+        return prefix;
+    }
+};
+
+template <typename T, int BLOCK_SIZE>
+__launch_bounds__(BLOCK_SIZE) __global__ void minPSampling(int** ids, int* sequenceLengths,
+    const FinishedState* finishedInput, FinishedState* finishedOutput, float* cumLogProbs, float* outputLogProbs,
+    const T* probs, const float* minPs, curandState_t* curandState, const uint64_t* randomSeeds, const int* endIds,
+    const int vocabSizePadded, const bool* skipDecode)
+{
+    const int tid = threadIdx.x;
+    const int batchId = blockIdx.x;
+    const FinishedState finishState = finishedInput != nullptr ? finishedInput[batchId] : FinishedState::empty();
+    if ((skipDecode != nullptr && skipDecode[batchId]) || finishState.isSkipDecoding())
+    {
+        return;
+    }
+
+    const int currentStep = sequenceLengths[batchId];
+    if (finishState.isFinished())
+    {
+        if (tid == 0)
+        {
+            if (finishedOutput != nullptr)
+            {
+                finishedOutput[batchId] = finishState;
+            }
+            ids[batchId][currentStep] = endIds[batchId];
+        }
+        return;
+    }
+
+    probs += batchId * vocabSizePadded;
+
+    using ArgMax = cub::KeyValuePair<int, float>;
+    typedef cub::BlockReduce<ArgMax, BLOCK_SIZE> BlockArgMaxReduce;
+    typedef cub::BlockReduce<float, BLOCK_SIZE> BlockReduce;
+    typedef cub::BlockScan<float, BLOCK_SIZE> BlockScan;
+    __shared__ union
+    {
+        typename BlockArgMaxReduce::TempStorage argMax;
+        typename BlockReduce::TempStorage reduce;
+        typename BlockScan::TempStorage scan;
+    } tempStorage;
+    __shared__ int sMaxId;
+    __shared__ float sThreshold;
+    __shared__ float sRandNum;
+    __shared__ int sSelectedId;
+
+    // Pass 1. The most likely token sets the threshold
+    ArgMax threadMax{0, -1.0f};
+    for (int vi = tid; vi < vocabSizePadded; vi += BLOCK_SIZE)
+    {
+        const float prob = (float) probs[vi];
+        if (prob > threadMax.value)
+        {
+            threadMax = ArgMax{vi, prob};
+        }
+    }
+    const ArgMax blockMax = BlockArgMaxReduce(tempStorage.argMax).Reduce(threadMax, cub::ArgMax());
+    if (tid == 0)
+    {
+        sMaxId = blockMax.key;
+        sThreshold = minPs[batchId] * blockMax.value;
+        sSelectedId = INT_MAX;
+    }
+    __syncthreads();
+    const float threshold = sThreshold;
+
+    // Pass 2. Probability of the kept tokens
+    float threadMass = 0.0f;
+    for (int vi = tid; vi < vocabSizePadded; vi += BLOCK_SIZE)
+    {
+        const float prob = (float) probs[vi];
+        threadMass += prob >= threshold ? prob : 0.0f;
+    }
+    const float mass = BlockReduce(tempStorage.reduce).Sum(threadMass);
+    if (tid == 0)
+    {
+        sRandNum = drawSamplingUniform(curandState, randomSeeds, batchId, currentStep) * mass;
+    }
+    __syncthreads();
+    const float randNum = sRandNum;
+
+    // Pass 3. The first kept token whose cumulative probability reaches the random number is selected
+    MinPPrefixOp prefixOp(0.0f);
+    const int end = (vocabSizePadded + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+    for (int vi = tid; vi < end; vi += BLOCK_SIZE)
+    {
+        const float prob = vi < vocabSizePadded ? (float) probs[vi] : 0.0f;
+        const float kept = prob >= threshold ? prob : 0.0f;
+        float cumProb;
+        BlockScan(tempStorage.scan).InclusiveSum(kept, cumProb, prefixOp);
+        const bool crossed = kept > 0.0f && cumProb >= randNum;
+        if (crossed)
+        {
+            atomicMin(&sSelectedId, vi);
+        }
+        if (__syncthreads_or(crossed))
+        {
+            break;
+        }
+    }
+    __syncthreads();
+
+    if (tid == 0)
+    {
+        // Rounding may keep the scan below the random number, fall back to the most likely token then
+        const int selectedId = sSelectedId != INT_MAX ? sSelectedId : sMaxId;
+        ids[batchId][currentStep] = selectedId;
+        if (cumLogProbs != nullptr || outputLogProbs != nullptr)
+        {
+            const float lprob = logf((float) probs[selectedId]);
+            if (cumLogProbs != nullptr)
+            {
+                cumLogProbs[batchId] += lprob;
+            }
+            if (outputLogProbs != nullptr)
+            {
+                outputLogProbs[batchId] = lprob;
+            }
+        }
+        if (sequenceLengths != nullptr && finishedOutput != nullptr)
+        {
+            if (selectedId == endIds[batchId])
+            {
+                finishedOutput[batchId].setFinishedEOS();
+                // Do not increase seq len when EOS is generated. Seq len should always contain only tokens to be
+                // outputted
+            }
+            else
+            {
+                sequenceLengths[batchId] += 1;
+            }
+        }
+    }
+}
+
+} // namespace
+
+template <typename T>
+void invokeBatchMinPSampling(int** outputIds, int* sequenceLengths, const FinishedState* finishedInput,
+    FinishedState* finishedOutput, float* cumLogProbs, float* outputLogProbs, const T* probs, const float* minPs,
+    curandState_t* curandState, const uint64_t* randomSeeds, const int* endIds, const int batchSize,
+    const int vocabSizePadded, const bool* skipDecode, cudaStream_t stream)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    dim3 grid(batchSize);
+    dim3 block(MIN_P_SAMPLING_BLOCK_SIZE);
+    minPSampling<T, MIN_P_SAMPLING_BLOCK_SIZE><<<grid, block, 0, stream>>>(outputIds, sequenceLengths, finishedInput,
+        finishedOutput, cumLogProbs, outputLogProbs, probs, minPs, curandState, randomSeeds, endIds, vocabSizePadded,
+        skipDecode);
+}
+
+template void invokeBatchMinPSampling(int** outputIds, int* sequenceLengths, const FinishedState* finishedInput,
+    FinishedState* finishedOutput, float* cumLogProbs, float* outputLogProbs, const float* probs, const float* minPs,
+    curandState_t* curandState, const uint64_t* randomSeeds, const int* endIds, const int batchSize,
+    const int vocabSizePadded, const bool* skipDecode, cudaStream_t stream);
+
+template void invokeBatchMinPSampling(int** outputIds, int* sequenceLengths, const FinishedState* finishedInput,
+    FinishedState* finishedOutput, float* cumLogProbs, float* outputLogProbs, const half* probs, const float* minPs,
+    curandState_t* curandState, const uint64_t* randomSeeds, const int* endIds, const int batchSize,
+    const int vocabSizePadded, const bool* skipDecode, cudaStream_t stream);
+
+} // namespace kernels
+} // namespace tensorrt_llm
@@ -322,6 +322,167 @@ template void invokeBatchApplyRepetitionPenalty(half* logits, const float* repet
     const bool use_presence, const bool use_frequency, const int** outputIds, const int* sequenceLengths,
     const int batchSize, const int vocabSize, int maxSeqLen, cudaStream_t stream);
 
+TokenHistograms::TokenHistograms(int* data, int maxSeqLen)
+    : data(data)
+    , capacity(1)
+    , maxSeqLen(maxSeqLen)
+{
+    // At most half of the slots are used, which keeps the probe sequences short
+    while (capacity < 2 * maxSeqLen)
+    {
+        capacity *= 2;
+    }
+    stride = 2 * capacity + maxSeqLen + 2;
+}
+
+size_t TokenHistograms::getSize(int batchSize, int maxSeqLen)
+{
+    return static_cast<size_t>(batchSize) * TokenHistograms(nullptr, maxSeqLen).stride * sizeof(int);
+}
+
+void invokeResetTokenHistograms(
+    const TokenHistograms& histograms, const int batchOffset, const int batchSize, cudaStream_t stream)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    const size_t stride = histograms.stride;
+    TLLM_CUDA_CHECK(cudaMemsetAsync(
+        histograms.data + batchOffset * stride, 0, batchSize * stride * sizeof(int), stream));
+}
+
+__device__ __forceinline__ unsigned int tokenHistogramHash(int token)
+{
+    // Fibonacci hashing spreads consecutive token ids over the table
+    return static_cast<unsigned int>(token) * 2654435769u;
+}
+
+__global__ void updateTokenHistograms(
+    TokenHistograms histograms, const int** outputIds, const int* sequenceLengths, const int vocabSize)
+{
+    const int batchIdx = blockIdx.x;
+    int* keys = histograms.data + batchIdx * histograms.stride;
+    int* counts = keys + histograms.capacity;
+    int* uniqueSlots = counts + histograms.capacity;
+    int* numUnique = uniqueSlots + histograms.maxSeqLen;
+    int* length = numUnique + 1;
+    const unsigned int mask = histograms.capacity - 1;
+
+    int begin = *length;
+    const int end = sequenceLengths[batchIdx];
+    if (end < begin)
+    {
+        // The sequence was replaced by a shorter one without a reset, rebuild its histogram
+        __syncthreads();
+        for (int index = threadIdx.x; index < histograms.stride; index += blockDim.x)
+        {
+            keys[index] = 0;
+        }
+        __syncthreads();
+        begin = 0;
+    }
+    for (int index = begin + threadIdx.x; index < end; index += blockDim.x)
+    {
+        const int token = outputIds[batchIdx][index];
+        if (token < 0 || token >= vocabSize)
+        {
+            continue;
+        }
+        const int key = token + 1;
+        unsigned int slot = tokenHistogramHash(token) & mask;
+        while (true)
+        {
+            const int prev = atomicCAS(keys + slot, 0, key);
+            if (prev == 0)
+            {
+                uniqueSlots[atomicAdd(numUnique, 1)] = slot;
+            }
+            if (prev == 0 || prev == key)
+            {
+                atomicAdd(counts + slot, 1);
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    __syncthreads();
+    if (threadIdx.x == 0 && end != begin)
+    {
+        *length = end;
+    }
+}
+
+void invokeUpdateTokenHistograms(const TokenHistograms& histograms, const int** outputIds,
+    const int* sequenceLengths, const int batchSize, const int vocabSize, cudaStream_t stream)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    // After the first step only one token per sequence is added, the first update adds the whole prompt
+    dim3 block(128);
+    dim3 grid(batchSize);
+    updateTokenHistograms<<<grid, block, 0, stream>>>(histograms, outputIds, sequenceLengths, vocabSize);
+}
+
+template <typename T>
+__global__ void batchApplyRepetitionPenaltyFromHistograms(T* logits, const float* repetition_penalties,
+    const float* presence_penalties, const float* frequency_penalties, const bool use_repetition,
+    const bool use_presence, const bool use_frequency, TokenHistograms histograms, const int vocabSize)
+{
+    const int batchIdx = blockIdx.x;
+    const int* keys = histograms.data + batchIdx * histograms.stride;
+    const int* counts = keys + histograms.capacity;
+    const int* uniqueSlots = counts + histograms.capacity;
+    const int numUnique = uniqueSlots[histograms.maxSeqLen];
+
+    const float repetition_penalty = use_repetition ? repetition_penalties[batchIdx] : 1.0f;
+    const float presence_penalty = use_presence ? presence_penalties[batchIdx] : 0.0f;
+    const float frequency_penalty = use_frequency ? frequency_penalties[batchIdx] : 0.0f;
+
+    logits += batchIdx * vocabSize;
+
+    // Every distinct token is owned by one thread, so no atomics are needed
+    for (int index = threadIdx.x; index < numUnique; index += blockDim.x)
+    {
+        const int slot = uniqueSlots[index];
+        const int token = keys[slot] - 1;
+        float logit = (float) logits[token];
+        if (use_repetition)
+        {
+            logit = logit < 0.0f ? logit * repetition_penalty : logit / repetition_penalty;
+        }
+        if (use_presence)
+        {
+            logit -= presence_penalty;
+        }
+        if (use_frequency)
+        {
+            logit -= counts[slot] * frequency_penalty;
+        }
+        logits[token] = logit;
+    }
+}
+
+template <typename T>
+void invokeBatchApplyRepetitionPenaltyFromHistograms(T* logits, const float* repetition_penalties,
+    const float* presence_penalties, const float* frequency_penalties, const bool use_repetition,
+    const bool use_presence, const bool use_frequency, const TokenHistograms& histograms, const int batchSize,
+    const int vocabSize, cudaStream_t stream)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    dim3 block(min(histograms.maxSeqLen, 256));
+    dim3 grid(batchSize);
+    batchApplyRepetitionPenaltyFromHistograms<T><<<grid, block, 0, stream>>>(logits, repetition_penalties,
+        presence_penalties, frequency_penalties, use_repetition, use_presence, use_frequency, histograms, vocabSize);
+}
+
+template void invokeBatchApplyRepetitionPenaltyFromHistograms(float* logits, const float* repetition_penalties,
+    const float* presence_penalties, const float* frequency_penalties, const bool use_repetition,
+    const bool use_presence, const bool use_frequency, const TokenHistograms& histograms, const int batchSize,
+    const int vocabSize, cudaStream_t stream);
+
+template void invokeBatchApplyRepetitionPenaltyFromHistograms(half* logits, const float* repetition_penalties,
+    const float* presence_penalties, const float* frequency_penalties, const bool use_repetition,
+    const bool use_presence, const bool use_frequency, const TokenHistograms& histograms, const int batchSize,
+    const int vocabSize, cudaStream_t stream);
+
 template <typename T>
 __global__ void batchApplyMinLengthPenalty(T* logits, const int* minLengths, const int* endIds,
     const int* sequenceLengths, const int* contextLengths, const int vocabSizePaddeded)
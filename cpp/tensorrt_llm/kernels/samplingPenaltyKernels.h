@@ -47,6 +47,65 @@ void invokeBatchApplyRepetitionPenalty(T* logits, const float* repetition_penalt
     const int** outputIds, const int* sequenceLengths, const int batchSize, const int vocabSize, int maxSeqLen,
     cudaStream_t stream);
 
+//! \brief Sparse histograms of the tokens of a batch of sequences, for applying the penalties in O(unique tokens)
+//! instead of O(sequence length) per step. Each sequence has an open addressing hash table from token to count and
+//! the list of the table slots of its distinct tokens. All fields of a sequence are stored contiguously and are empty
+//! when zeroed, in the order
+//! keys [capacity], token + 1 of each slot, 0 if empty
+//! counts [capacity], occurrences of the token of each slot
+//! uniqueSlots [maxSeqLen], slots of the distinct tokens in the order they were inserted
+//! numUnique [1], number of distinct tokens
+//! length [1], number of tokens of the sequence in the histogram
+struct TokenHistograms
+{
+    int* data;      // [batchSize, stride]
+    int capacity;   // number of slots of a table, a power of 2 at least twice maxSeqLen
+    int maxSeqLen;  // maximum sequence length
+    int stride;     // number of ints of a sequence
+
+    TokenHistograms(int* data, int maxSeqLen);
+
+    //! \brief Returns the size in bytes of the histograms of batchSize sequences
+    static size_t getSize(int batchSize, int maxSeqLen);
+};
+
+//! \brief Empties the histograms of the sequences [batchOffset, batchOffset + batchSize)
+void invokeResetTokenHistograms(
+    const TokenHistograms& histograms, const int batchOffset, const int batchSize, cudaStream_t stream);
+
+//! \brief Adds the tokens generated since the last update to the histograms. The histogram of a sequence holds its
+//! tokens [0, sequenceLength), tokens equal or greater than vocabSize are not counted.
+//!
+//! \param histograms input/output histograms
+//! \param outputIds input buffer [batchSize][maxSeqLen]. Contains pointers to rows [1, maxSeqLen]
+//! with output tokens per request
+//! \param sequenceLengths input buffer [batchSize]. Current sequence lengths of the request tokens
+//! \param batchSize batch size
+//! \param vocabSize padded vocab size
+//! \param stream stream
+void invokeUpdateTokenHistograms(const TokenHistograms& histograms, const int** outputIds,
+    const int* sequenceLengths, const int batchSize, const int vocabSize, cudaStream_t stream);
+
+//! \brief Applies penalty to logits of the tokens that were generated, reading the tokens from the histograms.
+//! Equivalent to invokeBatchApplyRepetitionPenalty once the histograms are updated to the current sequence lengths.
+//!
+//! \param logits input/output buffer [batchSize, vocabSizePadded]. Logits to be modified by inplace.
+//! \param repetition_penalties input buffer [batchSize]. Repetition penalties per request
+//! \param presence_penalties input buffer [batchSize]. Presence penalties per request
+//! \param frequency_penalties input buffer [batchSize]. Frequency penalties per request
+//! \param use_repetition whether using the repetition penalty
+//! \param use_presence whether using the presence penalty
+//! \param use_frequency whether using the frequency penalty
+//! \param histograms input histograms
+//! \param batchSize batch size
+//! \param vocabSize padded vocab size
+//! \param stream stream
+template <typename T>
+void invokeBatchApplyRepetitionPenaltyFromHistograms(T* logits, const float* repetition_penalties,
+    const float* presence_penalties, const float* frequency_penalties, const bool use_repetition,
+    const bool use_presence, const bool use_frequency, const TokenHistograms& histograms, const int batchSize,
+    const int vocabSize, cudaStream_t stream);
+
 //! \brief Applies temperature penalty logits' = (logit + bias) / temperature. Sets -MAX_FLOAT to padded logits
 //!
 //! \param logits input/output buffer [batchSize, vocabSizePadded]. Logits to be modified by inplace.
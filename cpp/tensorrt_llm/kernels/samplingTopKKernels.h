@@ -58,20 +58,24 @@ namespace kernels
 //! \param stream cuda stream
 //! \param batchSize batch size
 //! \param skipDecode input buffer [batchSize]. Flags whether to skip decoding per request
+//! \param normalizeLogProbs normalize the log probs by the probability of the top K tokens
+//! \param randomSeeds input buffer [batchSize]. Seeds per request for counter-based random numbers, see
+//! drawSamplingUniform. If nullptr, curandstate is used
 // clang-format on
 template <typename T>
 void invokeBatchTopKSampling(void* workspace, size_t& workspaceSize, const T* logProbs, int** ids, int* sequenceLengths,
     const FinishedState* finishedInput, FinishedState* finishedOutput, float* cumLogProbs, float* outputLogProbs,
     curandState_t* curandstate, const int maxTopK, const int* topKs, const float topP, const float* topPs,
     const int vocabSizePadded, const int* endIds, cudaStream_t stream, const int batchSize, const bool* skipDecode,
-    const bool normalizeLogProbs);
+    const bool normalizeLogProbs, const uint64_t* randomSeeds = nullptr);
 
 //! \brief Specialization of invokeBatchTopKSampling with topPs=nullptr and topKs=nullptr
 template <typename T>
 void invokeTopKSampling(void* workspace, size_t& workspaceSize, const T* logProbs, int** outputIds, int* sequenceLength,
     const FinishedState* finishedInput, FinishedState* finishedOutput, float* cumLogProbs, float* outputLogProbs,
     curandState_t* curandstate, const int topK, const float topP, const int vocabSizePadded, const int* endIds,
-    cudaStream_t stream, const int batchSize, const bool* skipDecode, const bool normalizeLogProbs);
+    cudaStream_t stream, const int batchSize, const bool* skipDecode, const bool normalizeLogProbs,
+    const uint64_t* randomSeeds = nullptr);
 
 //! \brief Applies mask and bias to logits. Sets -MAX_FLT value for tokens in range [vocabSize; vocabSizePadded) to
 //! prevent them being chosen If request finished the generation, sets MAX_FLT to endId token and -MAX_FLT to all other
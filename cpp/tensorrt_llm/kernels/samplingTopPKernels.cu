@@ -197,7 +197,7 @@ template <typename T, int blockSize>
 __global__ void topPSsampling(T* sortedLogProbs, int* sortedIdVals, int** ids, int* sequenceLength,
     const FinishedState* finishedInput, FinishedState* finishedOutput, float* cumLogProbs, float* outputLogProbs,
     const int* beginOffsetBuf, const int* offsetBuf, const int vocabSize, curandState_t* curandstate, const float topP,
-    const float* topPs, const int* endIds, const int batchSize, const bool* skipDecode)
+    const float* topPs, const int* endIds, const int batchSize, const bool* skipDecode, const uint64_t* randomSeeds)
 {
     /**
      * Each block processes one request row sorted in descending order by probabilities.
@@ -240,7 +240,7 @@ __global__ void topPSsampling(T* sortedLogProbs, int* sortedIdVals, int** ids, i
     // will choose the token which probability makes cumulative probability sum to exceed P'
     if (threadIdx.x == 0)
     {
-        randNumS = curand_uniform(curandstate + blockIdx.x) * probThreshold;
+        randNumS = drawSamplingUniform(curandstate, randomSeeds, batchId, currentStep) * probThreshold;
     }
 
     // if beginOffsetBuf and offsetBuf of sorting have same value,
@@ -302,7 +302,8 @@ void invokeBatchTopPSampling(void* workspace, size_t& workspaceSize, size_t& cub
     int* sequenceLength, const FinishedState* finishedInput, FinishedState* finishedOutput, float* cumLogProbs,
     float* outputLogProbs, const T* logProbs, const int* idVals, int* offsetBuf, int* beginOffsetBuf,
     curandState_t* curandstate, const int batchSize, const size_t vocabSizePadded, const int* endIds,
-    const float maxTopP, const float* topPs, cudaStream_t stream, const bool* skipDecode)
+    const float maxTopP, const float* topPs, cudaStream_t stream, const bool* skipDecode,
+    const uint64_t* randomSeeds)
 {
     // Here, we put batch size as an argument because the batch size of
     // initialization and inference may be different due to pipeline parallelism.
@@ -347,44 +348,46 @@ void invokeBatchTopPSampling(void* workspace, size_t& workspaceSize, size_t& cub
     // Sample with Top P given sorted tokens
     topPSsampling<T, SAMPLING_BLOCK_SIZE><<<grid, SAMPLING_BLOCK_SIZE, 0, stream>>>(sortedLogProbs, sortedIdVals,
         outputIds, sequenceLength, finishedInput, finishedOutput, cumLogProbs, outputLogProbs, beginOffsetBuf,
-        offsetBuf + 1, vocabSize, curandstate, maxTopP, topPs, endIds, batchSize, skipDecode);
+        offsetBuf + 1, vocabSize, curandstate, maxTopP, topPs, endIds, batchSize, skipDecode, randomSeeds);
 }
 
 template void invokeBatchTopPSampling(void* workspace, size_t& workspaceSize, size_t& cubTempStorageSize,
     int** outputIds, int* sequenceLength, const FinishedState* finishedInput, FinishedState* finishedOutput,
     float* cumLogProbs, float* outputLogProbs, const float* logProbs, const int* idVals, int* offsetBuf,
     int* beginOffsetBuf, curandState_t* curandstate, const int batchSize, const size_t vocabSizePadded,
-    const int* endIds, const float maxTopP, const float* topPs, cudaStream_t stream, const bool* skipDecode);
+    const int* endIds, const float maxTopP, const float* topPs, cudaStream_t stream, const bool* skipDecode,
+    const uint64_t* randomSeeds);
 
 template void invokeBatchTopPSampling(void* workspace, size_t& workspaceSize, size_t& cubTempStorageSize,
     int** outputIds, int* sequenceLength, const FinishedState* finishedInput, FinishedState* finishedOutput,
     float* cumLogProbs, float* outputLogProbs, const half* logProbs, const int* idVals, int* offsetBuf,
     int* beginOffsetBuf, curandState_t* curandstate, const int batchSize, const size_t vocabSizePadded,
-    const int* endIds, const float maxTopP, const float* topPs, cudaStream_t stream, const bool* skipDecode);
+    const int* endIds, const float maxTopP, const float* topPs, cudaStream_t stream, const bool* skipDecode,
+    const uint64_t* randomSeeds);
 
 template <typename T>
 void invokeTopPSampling(void* workspace, size_t& workspaceSize, size_t& cubTempStorageSize, int** outputIds,
     int* sequenceLength, const FinishedState* finishedInput, FinishedState* finishedOutput, float* cumLogProbs,
     float* outputLogProbs, const T* logProbs, const int* idVals, int* offsetBuf, int* beginOffsetBuf,
     curandState_t* curandstate, const int batchSize, const size_t vocabSizePadded, const int* endIds, const float topP,
-    cudaStream_t stream, const bool* skipDecode)
+    cudaStream_t stream, const bool* skipDecode, const uint64_t* randomSeeds)
 {
     invokeBatchTopPSampling(workspace, workspaceSize, cubTempStorageSize, outputIds, sequenceLength, finishedInput,
         finishedOutput, cumLogProbs, outputLogProbs, logProbs, idVals, offsetBuf, beginOffsetBuf, curandstate,
-        batchSize, vocabSizePadded, endIds, topP, nullptr, stream, skipDecode);
+        batchSize, vocabSizePadded, endIds, topP, nullptr, stream, skipDecode, randomSeeds);
 }
 
 template void invokeTopPSampling(void* workspace, size_t& workspaceSize, size_t& cubTempStorageSize, int** outputIds,
     int* sequenceLength, const FinishedState* finishedInput, FinishedState* finishedOutput, float* cumLogProbs,
     float* outputLogProbs, const float* logProbs, const int* idVals, int* offsetBuf, int* beginOffsetBuf,
     curandState_t* curandstate, const int batchSize, const size_t vocabSizePadded, const int* endIds, const float topP,
-    cudaStream_t stream, const bool* skipDecode);
+    cudaStream_t stream, const bool* skipDecode, const uint64_t* randomSeeds);
 
 template void invokeTopPSampling(void* workspace, size_t& workspaceSize, size_t& cubTempStorageSize, int** outputIds,
     int* sequenceLength, const FinishedState* finishedInput, FinishedState* finishedOutput, float* cumLogProbs,
     float* outputLogProbs, const half* logProbs, const int* idVals, int* offsetBuf, int* beginOffsetBuf,
     curandState_t* curandstate, const int batchSize, const size_t vocabSizePadded, const int* endIds, const float topP,
-    cudaStream_t stream, const bool* skipDecode);
+    cudaStream_t stream, const bool* skipDecode, const uint64_t* randomSeeds);
 
 __global__ void computeToppDecay(float* runtimeTopP, const float* runtimeInitialTopP, const int** outputIds,
     const float* topPDecay, const float* topPMin, const int32_t* topPResetIds, const int* sequenceLengths)
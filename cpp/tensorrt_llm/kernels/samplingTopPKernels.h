@@ -75,13 +75,16 @@ nullptr.
 //! \param stream cuda stream
 //! \param cudaDeviceProp
 //! \param skipDecode input buffer [batchSize]. Flags whether to skip decoding per request
+//! \param randomSeeds input buffer [batchSize]. Seeds per request for counter-based random numbers, see
+//! drawSamplingUniform. If nullptr, curandstate is used
  */
 template <typename T>
 void invokeBatchTopPSampling(void* workspace, size_t& workspaceSize, size_t& cubTempStorageSize, int** outputIds,
     int* sequenceLength, const FinishedState* finishedInput, FinishedState* finishedOutput, float* cumLogProbs,
     float* outputLogProbs, const T* logProbs, const int* idVals, int* offsetBuf, int* beginOffsetBuf,
     curandState_t* curandstate, const int batchSize, const size_t vocabSizePadded, const int* endIds,
-    const float maxTopP, const float* topPs, cudaStream_t stream, const bool* skipDecode);
+    const float maxTopP, const float* topPs, cudaStream_t stream, const bool* skipDecode,
+    const uint64_t* randomSeeds = nullptr);
 
 //! \brief Specialization of invokeBatchTopPSampling with topPs=nullptr
 template <typename T>
@@ -89,7 +92,7 @@ void invokeTopPSampling(void* workspace, size_t& workspaceSize, size_t& cubTempS
     int* sequenceLength, const FinishedState* finishedInput, FinishedState* finishedOutput, float* cumLogProbs,
     float* outputLogProbs, const T* logProbs, const int* idVals, int* offsetBuf, int* beginOffsetBuf,
     curandState_t* curandstate, const int batchSize, const size_t vocabSizePadded, const int* endIds, const float topPp,
-    cudaStream_t stream, const bool* skipDecode);
+    cudaStream_t stream, const bool* skipDecode, const uint64_t* randomSeeds = nullptr);
 
 //! \brief Compute the topp decay by https://arxiv.org/pdf/2206.04624.pdf
 //!        In short, the formula is
@@ -0,0 +1,279 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CUDART_VERSION
+#error CUDART_VERSION Undefined!
+#elif (CUDART_VERSION >= 11050)
+#include <cub/cub.cuh>
+#else
+#include "3rdparty/cub/cub.cuh"
+#endif
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/samplingTypicalKernels.h"
+
+#include <climits>
+#include <float.h>
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+namespace
+{
+
+constexpr int TYPICAL_SAMPLING_BLOCK_SIZE = 256;
+
+struct TypicalPrefixOp
+{
+    float runningTotal;
+
+    __device__ TypicalPrefixOp(float runningTotal)
+        : runningTotal(runningTotal)
+    {
+    }
+
+    // Called by the first warp, returns the prefix of the current tile
+    __device__ float operator()(float blockAggregate)
+    {
+        float const prefix = runningTotal;
+        runningTotal += blockAggregate;
+        return prefix;
+    }
+};
+
+__device__ __forceinline__ bool isTypicalSamplingSkipped(
+    const FinishedState* finishedInput, const bool* skipDecode, int batchId)
+{
+    const FinishedState finishState = finishedInput != nullptr ? finishedInput[batchId] : FinishedState::empty();
+    return (skipDecode != nullptr && skipDecode[batchId]) || finishState.isSkipDecoding() || finishState.isFinished();
+}
+
+//! Computes the distance of the information content of each token to the entropy, the sort key of the tokens.
+//! The segments of skipped requests are made empty so that the sort leaves them out.
+template <typename T, int BLOCK_SIZE>
+__launch_bounds__(BLOCK_SIZE) __global__ void typicalScores(const T* probs, float* scores, int* idVals,
+    int* beginOffsets, int* endOffsets, const FinishedState* finishedInput, const int vocabSizePadded,
+    const bool* skipDecode)
+{
+    const int tid = threadIdx.x;
+    const int batchId = blockIdx.x;
+    const int offset = batchId * vocabSizePadded;
+    const bool skipped = isTypicalSamplingSkipped(finishedInput, skipDecode, batchId);
+    if (tid == 0)
+    {
+        beginOffsets[batchId] = skipped ? offset + vocabSizePadded : offset;
+        endOffsets[batchId] = offset + vocabSizePadded;
+    }
+    if (skipped)
+    {
+        return;
+    }
+
+    probs += offset;
+
+    typedef cub::BlockReduce<float, BLOCK_SIZE> BlockReduce;
+    __shared__ typename BlockReduce::TempStorage tempStorage;
+    __shared__ float sEntropy;
+
+    float threadEntropy = 0.0f;
+    for (int vi = tid; vi < vocabSizePadded; vi += BLOCK_SIZE)
+    {
+        const float prob = (float) probs[vi];
+        threadEntropy -= prob > 0.0f ? prob * logf(prob) : 0.0f;
+    }
+    const float entropy = BlockReduce(tempStorage).Sum(threadEntropy);
+    if (tid == 0)
+    {
+        sEntropy = entropy;
+    }
+    __syncthreads();
+
+    for (int vi = tid; vi < vocabSizePadded; vi += BLOCK_SIZE)
+    {
+        const float prob = (float) probs[vi];
+        // Tokens that cannot be sampled go last
+        scores[offset + vi] = prob > 0.0f ? fabsf(-logf(prob) - sEntropy) : FLT_MAX;
+        idVals[offset + vi] = vi;
+    }
+}
+
+template <typename T, int BLOCK_SIZE>
+__launch_bounds__(BLOCK_SIZE) __global__ void typicalSampling(int** ids, int* sequenceLengths,
+    const FinishedState* finishedInput, FinishedState* finishedOutput, float* cumLogProbs, float* outputLogProbs,
+    const T* probs, const int* sortedIds, const float* typicalPs, curandState_t* curandState,
+    const uint64_t* randomSeeds, const int* endIds, const int vocabSizePadded, const bool* skipDecode)
+{
+    const int tid = threadIdx.x;
+    const int batchId = blockIdx.x;
+    const FinishedState finishState = finishedInput != nullptr ? finishedInput[batchId] : FinishedState::empty();
+    if ((skipDecode != nullptr && skipDecode[batchId]) || finishState.isSkipDecoding())
+    {
+        return;
+    }
+
+    const int currentStep = sequenceLengths[batchId];
+    if (finishState.isFinished())
+    {
+        if (tid == 0)
+        {
+            if (finishedOutput != nullptr)
+            {
+                finishedOutput[batchId] = finishState;
+            }
+            ids[batchId][currentStep] = endIds[batchId];
+        }
+        return;
+    }
+
+    probs += batchId * vocabSizePadded;
+    sortedIds += batchId * vocabSizePadded;
+
+    typedef cub::BlockScan<float, BLOCK_SIZE> BlockScan;
+    __shared__ typename BlockScan::TempStorage tempStorage;
+    __shared__ float sRandNum;
+    __shared__ int sSelected;
+
+    if (tid == 0)
+    {
+        sRandNum = drawSamplingUniform(curandState, randomSeeds, batchId, currentStep) * typicalPs[batchId];
+        sSelected = INT_MAX;
+    }
+    __syncthreads();
+    const float randNum = sRandNum;
+
+    // The first token in the typical order whose cumulative probability reaches the random number is selected
+    TypicalPrefixOp prefixOp(0.0f);
+    const int end = (vocabSizePadded + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE;
+    for (int vi = tid; vi < end; vi += BLOCK_SIZE)
+    {
+        const float prob = vi < vocabSizePadded ? (float) probs[sortedIds[vi]] : 0.0f;
+        float cumProb;
+        BlockScan(tempStorage).InclusiveSum(prob, cumProb, prefixOp);
+        const bool crossed = prob > 0.0f && cumProb >= randNum;
+        if (crossed)
+        {
+            atomicMin(&sSelected, vi);
+        }
+        if (__syncthreads_or(crossed))
+        {
+            break;
+        }
+    }
+    __syncthreads();
+
+    if (tid == 0)
+    {
+        // Rounding may keep the scan below the random number, fall back to the most typical token then
+        const int selectedId = sortedIds[sSelected != INT_MAX ? sSelected : 0];
+        ids[batchId][currentStep] = selectedId;
+        if (cumLogProbs != nullptr || outputLogProbs != nullptr)
+        {
+            const float lprob = logf((float) probs[selectedId]);
+            if (cumLogProbs != nullptr)
+            {
+                cumLogProbs[batchId] += lprob;
+            }
+            if (outputLogProbs != nullptr)
+            {
+                outputLogProbs[batchId] = lprob;
+            }
+        }
+        if (sequenceLengths != nullptr && finishedOutput != nullptr)
+        {
+            if (selectedId == endIds[batchId])
+            {
+                finishedOutput[batchId].setFinishedEOS();
+                // Do not increase seq len when EOS is generated. Seq len should always contain only tokens to be
+                // outputted
+            }
+            else
+            {
+                sequenceLengths[batchId] += 1;
+            }
+        }
+    }
+}
+
+} // namespace
+
+template <typename T>
+void invokeBatchTypicalSampling(void* workspace, size_t& workspaceSize, int** outputIds, int* sequenceLengths,
+    const FinishedState* finishedInput, FinishedState* finishedOutput, float* cumLogProbs, float* outputLogProbs,
+    const T* probs, const float* typicalPs, curandState_t* curandState, const uint64_t* randomSeeds,
+    const int* endIds, const int batchSize, const int vocabSizePadded, const bool* skipDecode, cudaStream_t stream)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    const int numItems = batchSize * vocabSizePadded;
+    const size_t scoresBufSize = divUp(sizeof(float) * numItems, 256) * 256;
+    const size_t idsBufSize = divUp(sizeof(int) * numItems, 256) * 256;
+    const size_t offsetsBufSize = divUp(sizeof(int) * batchSize, 256) * 256;
+
+    size_t cubTempStorageSize = 0;
+    check_cuda_error(cub::DeviceSegmentedRadixSort::SortPairs(nullptr, cubTempStorageSize, (float*) nullptr,
+        (float*) nullptr, (int*) nullptr, (int*) nullptr, numItems, batchSize, (int*) nullptr, (int*) nullptr,
+        0,                 // begin_bit
+        sizeof(float) * 8, // end_bit
+        stream));
+    cubTempStorageSize = divUp(cubTempStorageSize, 256) * 256;
+
+    if (workspace == nullptr)
+    {
+        workspaceSize = cubTempStorageSize + 2 * scoresBufSize + 2 * idsBufSize + 2 * offsetsBufSize;
+        return;
+    }
+
+    auto* cubTempStorage = reinterpret_cast<char*>(workspace);
+    auto* scores = reinterpret_cast<float*>(cubTempStorage + cubTempStorageSize);
+    auto* sortedScores = reinterpret_cast<float*>(reinterpret_cast<char*>(scores) + scoresBufSize);
+    auto* idVals = reinterpret_cast<int*>(reinterpret_cast<char*>(sortedScores) + scoresBufSize);
+    auto* sortedIds = reinterpret_cast<int*>(reinterpret_cast<char*>(idVals) + idsBufSize);
+    auto* beginOffsets = reinterpret_cast<int*>(reinterpret_cast<char*>(sortedIds) + idsBufSize);
+    auto* endOffsets = reinterpret_cast<int*>(reinterpret_cast<char*>(beginOffsets) + offsetsBufSize);
+
+    dim3 grid(batchSize);
+    dim3 block(TYPICAL_SAMPLING_BLOCK_SIZE);
+    typicalScores<T, TYPICAL_SAMPLING_BLOCK_SIZE><<<grid, block, 0, stream>>>(
+        probs, scores, idVals, beginOffsets, endOffsets, finishedInput, vocabSizePadded, skipDecode);
+
+    // Sort tokens by typicality in ascending order of the distance to the entropy
+    check_cuda_error(cub::DeviceSegmentedRadixSort::SortPairs(cubTempStorage, cubTempStorageSize, scores,
+        sortedScores, idVals, sortedIds, numItems, batchSize, beginOffsets, endOffsets,
+        0,                 // begin_bit
+        sizeof(float) * 8, // end_bit
+        stream));
+
+    typicalSampling<T, TYPICAL_SAMPLING_BLOCK_SIZE><<<grid, block, 0, stream>>>(outputIds, sequenceLengths,
+        finishedInput, finishedOutput, cumLogProbs, outputLogProbs, probs, sortedIds, typicalPs, curandState,
+        randomSeeds, endIds, vocabSizePadded, skipDecode);
+}
+
+template void invokeBatchTypicalSampling(void* workspace, size_t& workspaceSize, int** outputIds,
+    int* sequenceLengths, const FinishedState* finishedInput, FinishedState* finishedOutput, float* cumLogProbs,
+    float* outputLogProbs, const float* probs, const float* typicalPs, curandState_t* curandState,
+    const uint64_t* randomSeeds, const int* endIds, const int batchSize, const int vocabSizePadded,
+    const bool* skipDecode, cudaStream_t stream);
+
+template void invokeBatchTypicalSampling(void* workspace, size_t& workspaceSize, int** outputIds,
+    int* sequenceLengths, const FinishedState* finishedInput, FinishedState* finishedOutput, float* cumLogProbs,
+    float* outputLogProbs, const half* probs, const float* typicalPs, curandState_t* curandState,
+    const uint64_t* randomSeeds, const int* endIds, const int batchSize, const int vocabSizePadded,
+    const bool* skipDecode, cudaStream_t stream);
+
+} // namespace kernels
+} // namespace tensorrt_llm
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/kernels/decodingCommon.h"
+#include <curand_kernel.h>
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+// clang-format off
+//! \brief Given probabilities, performs locally typical sampling (https://arxiv.org/abs/2202.00666).
+//! Fills sampled tokens to outputIds. Computes sequenceLength, finished state, cumLogProbs inplace.
+//! The tokens of a request are sorted by the distance of their information content -log(p) to the entropy of the
+//! distribution, and the request samples from the smallest prefix of them holding typicalP of the probability, the
+//! same way invokeBatchTopPSampling samples from the most likely tokens.
+//! Function sets workspaceSize and exits early if workspace is nullptr.
+//!
+//! \param workspace pointer to the workspace. Has to be pre-allocated by caller. Function does not take ownership of the
+//! buffer.
+//! \param workspaceSize size of the workspace in bytes
+//! \param outputIds output buffer [batchSize][maxSeqLen]. Contains pointers to rows with output tokens per request
+//! \param sequenceLengths input/output buffer [batchSize]. Current sequence length of the request up to, but excluding endId token
+//! \param finishedInput input buffer [batchSize]. Exit early if true.
+//! \param finishedOutput output buffer [batchSize]. Set flag if sequence has finished (if finished || outputId == endId).
+//! \param cumLogProbs input/output buffer [batchSize]. Cumulative log probability of selected tokens. Ignored if nullptr
+//! \param outputLogProbs output buffer [batchSize]. Log probs of the selected tokens under the full vocab softmax.
+//! Ignored if nullptr
+//! \param probs input buffer [batchSize, vocabSizePadded]. Probabilities of each token in the vocab, see invokeAddBiasSoftMax
+//! \param typicalPs input buffer [batchSize]. Typical P per request in range (0.0; 1.0]
+//! \param curandState input buffer [batchSize]. Curand states properly initialized using invokeCurandInitialize per request.
+//! \param randomSeeds input buffer [batchSize]. Seeds per request for counter-based random numbers, see
+//! drawSamplingUniform. If nullptr, curandState is used
+//! \param endIds input buffer [batchSize]. EOS token ids per request
+//! \param batchSize batch size
+//! \param vocabSizePadded size of padded vocab
+//! \param skipDecode input buffer [batchSize]. Flags whether to skip decoding per request. Ignored if nullptr
+//! \param stream cuda stream
+// clang-format on
+template <typename T>
+void invokeBatchTypicalSampling(void* workspace, size_t& workspaceSize, int** outputIds, int* sequenceLengths,
+    const FinishedState* finishedInput, FinishedState* finishedOutput, float* cumLogProbs, float* outputLogProbs,
+    const T* probs, const float* typicalPs, curandState_t* curandState, const uint64_t* randomSeeds,
+    const int* endIds, const int batchSize, const int vocabSizePadded, const bool* skipDecode, cudaStream_t stream);
+
+} // namespace kernels
+} // namespace tensorrt_llm
@@ -1564,7 +1564,7 @@ INSTANTIATE_TRANSPOSE_4D(half);
 template <typename T, typename T_cache, typename KVCacheBuffer>
 __global__ void transpose4dBatchMajorKVCache(const T* kSrc, const T* vSrc, KVCacheBuffer kvCacheBuffer,
     const int headNum, const int sizePerHead, const int seqLen, const int attentionWindowSize,
-    const float* kvScaleOrigQuant, const int* sequence_lengths)
+    const float* kvScaleOrigQuant, const int* sequence_lengths, const int sinkTokenLength)
 {
     // We allow only fp32/fp16/bf16 as input types
     static_assert(sizeof(T) == 4 || sizeof(T) == 2, "");
@@ -1592,16 +1592,21 @@ __global__ void transpose4dBatchMajorKVCache(const T* kSrc, const T* vSrc, KVCac
     int tokenIdx = idx / sizePerHeadDivX;
     // Apply cyclic kv cache if tokenIdx >= max_attention_window_size.
     // which means we will drop the tokens in the beginning if seqLen > max_attention_window_size.
-    const int tokenIdxLowerBound = max(sequence_lengths[batchIdx] - attentionWindowSize, 0);
+    // The sink tokens are kept in the first slots and the others cycle over the remaining ones.
+    const int cyclicWindowSize = attentionWindowSize - sinkTokenLength;
+    const int tokenIdxLowerBound = max(sequence_lengths[batchIdx] - cyclicWindowSize, 0);
     // Get channel index
     const int channelIdx = idx % sizePerHeadDivX;
-    if (tokenIdx >= sequence_lengths[batchIdx] || tokenIdx < tokenIdxLowerBound)
+    if (tokenIdx >= sequence_lengths[batchIdx] || (tokenIdx >= sinkTokenLength && tokenIdx < tokenIdxLowerBound))
     {
         return;
     }
 
     // Apply cyclic kv cache if tokenIdx >= max_attention_window_size.
-    tokenIdx = tokenIdx % attentionWindowSize;
+    if (tokenIdx >= sinkTokenLength)
+    {
+        tokenIdx = sinkTokenLength + (tokenIdx - sinkTokenLength) % cyclicWindowSize;
+    }
 
     // Get pointer to the dst block given sequence, head and token ids
     auto valDst = handle_k ? reinterpret_cast<T_dst*>(kvCacheBuffer.getKBlockPtr(batchIdx, tokenIdx))
@@ -1638,7 +1643,8 @@ __global__ void transpose4dBatchMajorKVCache(const T* kSrc, const T* vSrc, KVCac
 template <typename T, typename KVCacheBuffer>
 void invokeTranspose4dBatchMajor(const T* kSrc, const T* vSrc, KVCacheBuffer& kvTable, const int localBatchSize,
     const int seqLen, const int attentionWindowSize, const int sizePerHead, const int localHeadNum,
-    const KvCacheDataType cache_type, const float* kvScaleOrigQuant, const int* sequence_lengths, cudaStream_t stream)
+    const KvCacheDataType cache_type, const float* kvScaleOrigQuant, const int* sequence_lengths, cudaStream_t stream,
+    const int sinkTokenLength)
 {
     // Block handles both K and V tile.
     dim3 blockSz(128, 2);
@@ -1650,19 +1656,22 @@ void invokeTranspose4dBatchMajor(const T* kSrc, const T* vSrc, KVCacheBuffer& kv
     if (cache_type == KvCacheDataType::INT8)
     {
         transpose4dBatchMajorKVCache<T, int8_t, KVCacheBuffer><<<gridSz, blockSz, 0, stream>>>(kSrc, vSrc, kvTable,
-            localHeadNum, sizePerHead, seqLen, attentionWindowSize, kvScaleOrigQuant, sequence_lengths);
+            localHeadNum, sizePerHead, seqLen, attentionWindowSize, kvScaleOrigQuant, sequence_lengths,
+            sinkTokenLength);
     }
 #ifdef ENABLE_FP8
     else if (cache_type == KvCacheDataType::FP8)
     {
         transpose4dBatchMajorKVCache<T, __nv_fp8_e4m3, KVCacheBuffer><<<gridSz, blockSz, 0, stream>>>(kSrc, vSrc,
-            kvTable, localHeadNum, sizePerHead, seqLen, attentionWindowSize, kvScaleOrigQuant, sequence_lengths);
+            kvTable, localHeadNum, sizePerHead, seqLen, attentionWindowSize, kvScaleOrigQuant, sequence_lengths,
+            sinkTokenLength);
     }
 #endif // ENABLE_FP8
     else
     {
         transpose4dBatchMajorKVCache<T, T, KVCacheBuffer><<<gridSz, blockSz, 0, stream>>>(kSrc, vSrc, kvTable,
-            localHeadNum, sizePerHead, seqLen, attentionWindowSize, kvScaleOrigQuant, sequence_lengths);
+            localHeadNum, sizePerHead, seqLen, attentionWindowSize, kvScaleOrigQuant, sequence_lengths,
+            sinkTokenLength);
     }
 }
 
@@ -1670,7 +1679,7 @@ void invokeTranspose4dBatchMajor(const T* kSrc, const T* vSrc, KVCacheBuffer& kv
     template void invokeTranspose4dBatchMajor(const T* kSrc, const T* vSrc, KVCacheBuffer& kvTable,                    \
         const int localBatchSize, const int seqLen, const int attentionWindowSize, const int sizePerHead,              \
         const int localHeadNum, const KvCacheDataType cache_type, const float* kvScaleOrigQuant,                       \
-        const int* sequence_lengths, cudaStream_t stream)
+        const int* sequence_lengths, cudaStream_t stream, const int sinkTokenLength)
 
 #define INSTANTIATE_TRANSPOSE_4D_BATCH_MAJOR(T)                                                                        \
     INSTANTIATE_TRANSPOSE_4D_BATCH_MAJOR_KV_CACHE_TYPE(T, KVBlockArray);                                               \
@@ -1685,6 +1694,280 @@ INSTANTIATE_TRANSPOSE_4D_BATCH_MAJOR(__nv_bfloat16);
 #undef INSTANTIATE_TRANSPOSE_4D_BATCH_MAJOR_KV_CACHE_TYPE
 #undef INSTANTIATE_TRANSPOSE_4D_BATCH_MAJOR
 
+template <typename T_cache>
+struct KvCacheQuantMax;
+
+template <>
+struct KvCacheQuantMax<int8_t>
+{
+    static constexpr float value = 127.f;
+};
+
+#ifdef ENABLE_FP8
+template <>
+struct KvCacheQuantMax<__nv_fp8_e4m3>
+{
+    static constexpr float value = 448.f;
+};
+#endif // ENABLE_FP8
+
+inline __device__ void quantizeKvCacheElem(int8_t* dst, float val)
+{
+    *dst = static_cast<int8_t>(max(-128, min(127, __float2int_rn(val))));
+}
+
+#ifdef ENABLE_FP8
+inline __device__ void quantizeKvCacheElem(__nv_fp8_e4m3* dst, float val)
+{
+    *dst = __nv_fp8_e4m3(val);
+}
+#endif // ENABLE_FP8
+
+template <typename T, typename T_cache, typename KVCacheBuffer>
+__global__ void quantizeKvCacheBlocks(const T* kSrc, const T* vSrc, KVCacheBuffer kvCacheBuffer,
+    const int* cuSeqLens, const int* sequenceLengths, const int headNum, const int sizePerHead,
+    const int attentionWindowSize, const int srcBatchStride, const int srcTokenStride, const int srcHeadStride)
+{
+    // One CTA quantizes the K (even blockIdx.z) or V (odd blockIdx.z) slice of one head in one cache block.
+    const int batchIdx = blockIdx.y;
+    const int headIdx = blockIdx.z >> 1;
+    const bool handleK = (blockIdx.z & 1) == 0;
+
+    // With cyclic kv cache only the last attentionWindowSize tokens are kept, slot = tokenIdx % attentionWindowSize.
+    const int seqLen = sequenceLengths[batchIdx];
+    const int numSlots = min(seqLen, attentionWindowSize);
+    const int firstSlot = blockIdx.x * kvCacheBuffer.mTokensPerBlock;
+    if (firstSlot >= numSlots)
+    {
+        return;
+    }
+    const int numElems = min(kvCacheBuffer.mTokensPerBlock, numSlots - firstSlot) * sizePerHead;
+
+    const int64_t batchOffset = cuSeqLens != nullptr ? static_cast<int64_t>(cuSeqLens[batchIdx]) * srcTokenStride
+                                                     : static_cast<int64_t>(batchIdx) * srcBatchStride;
+    const T* src = (handleK ? kSrc : vSrc) + batchOffset + headIdx * srcHeadStride;
+
+    // The most recent token stored at the given slot.
+    auto const slotToToken
+        = [&](int slot) { return slot + attentionWindowSize * ((seqLen - 1 - slot) / attentionWindowSize); };
+
+    float absMax = 0.f;
+    for (int i = threadIdx.x; i < numElems; i += blockDim.x)
+    {
+        const int tokenIdx = slotToToken(firstSlot + i / sizePerHead);
+        absMax = fmaxf(absMax, fabsf(cuda_cast<float>(src[tokenIdx * srcTokenStride + i % sizePerHead])));
+    }
+    absMax = blockReduceMax<float>(absMax);
+
+    __shared__ float sScaleOrigQuant;
+    void* blockPtr = handleK ? kvCacheBuffer.getKBlockPtr(batchIdx, firstSlot)
+                             : kvCacheBuffer.getVBlockPtr(batchIdx, firstSlot);
+    if (threadIdx.x == 0)
+    {
+        const float scaleQuantOrig = absMax > 0.f ? absMax / KvCacheQuantMax<T_cache>::value : 1.f;
+        *kvCacheBuffer.getBlockScalePtr(blockPtr, headIdx, headNum, sizePerHead) = scaleQuantOrig;
+        sScaleOrigQuant = 1.f / scaleQuantOrig;
+    }
+    __syncthreads();
+
+    T_cache* dst = reinterpret_cast<T_cache*>(blockPtr);
+    for (int i = threadIdx.x; i < numElems; i += blockDim.x)
+    {
+        const int slot = firstSlot + i / sizePerHead;
+        const int channelIdx = i % sizePerHead;
+        const float val = cuda_cast<float>(src[slotToToken(slot) * srcTokenStride + channelIdx]);
+        quantizeKvCacheElem(&dst[kvCacheBuffer.getKVLocalIdx(slot, headIdx, sizePerHead, channelIdx)],
+            val * sScaleOrigQuant);
+    }
+}
+
+template <typename T, typename KVCacheBuffer>
+void invokeQuantizeKvCacheBlocks(const T* k_src, const T* v_src, KVCacheBuffer& kvTable, const int* cu_seqlens,
+    const int* sequence_lengths, const int local_batch_size, const int seq_len, const int attention_window_size,
+    const int size_per_head, const int local_head_num, const int src_batch_stride, const int src_token_stride,
+    const int src_head_stride, const KvCacheDataType cache_type, cudaStream_t stream)
+{
+    const int max_blocks_per_seq
+        = (std::min(seq_len, attention_window_size) + kvTable.mTokensPerBlock - 1) / kvTable.mTokensPerBlock;
+    dim3 blockSz(128);
+    dim3 gridSz(max_blocks_per_seq, local_batch_size, local_head_num * 2);
+
+    if (cache_type == KvCacheDataType::INT8)
+    {
+        quantizeKvCacheBlocks<T, int8_t, KVCacheBuffer><<<gridSz, blockSz, 0, stream>>>(k_src, v_src, kvTable,
+            cu_seqlens, sequence_lengths, local_head_num, size_per_head, attention_window_size, src_batch_stride,
+            src_token_stride, src_head_stride);
+    }
+#ifdef ENABLE_FP8
+    else if (cache_type == KvCacheDataType::FP8)
+    {
+        quantizeKvCacheBlocks<T, __nv_fp8_e4m3, KVCacheBuffer><<<gridSz, blockSz, 0, stream>>>(k_src, v_src, kvTable,
+            cu_seqlens, sequence_lengths, local_head_num, size_per_head, attention_window_size, src_batch_stride,
+            src_token_stride, src_head_stride);
+    }
+#endif // ENABLE_FP8
+    else
+    {
+        TLLM_CHECK_WITH_INFO(false, "KV cache block scaling requires an INT8 or FP8 KV cache.");
+    }
+}
+
+#define INSTANTIATE_QUANTIZE_KV_CACHE_BLOCKS_KV_CACHE_TYPE(T, KVCacheBuffer)                                          \
+    template void invokeQuantizeKvCacheBlocks(const T* k_src, const T* v_src, KVCacheBuffer& kvTable,                  \
+        const int* cu_seqlens, const int* sequence_lengths, const int local_batch_size, const int seq_len,            \
+        const int attention_window_size, const int size_per_head, const int local_head_num,                            \
+        const int src_batch_stride, const int src_token_stride, const int src_head_stride,                             \
+        const KvCacheDataType cache_type, cudaStream_t stream)
+
+#define INSTANTIATE_QUANTIZE_KV_CACHE_BLOCKS(T)                                                                        \
+    INSTANTIATE_QUANTIZE_KV_CACHE_BLOCKS_KV_CACHE_TYPE(T, KVBlockArray);                                               \
+    INSTANTIATE_QUANTIZE_KV_CACHE_BLOCKS_KV_CACHE_TYPE(T, KVLinearBuffer);
+
+INSTANTIATE_QUANTIZE_KV_CACHE_BLOCKS(float)
+INSTANTIATE_QUANTIZE_KV_CACHE_BLOCKS(half)
+#ifdef ENABLE_BF16
+INSTANTIATE_QUANTIZE_KV_CACHE_BLOCKS(__nv_bfloat16);
+#endif
+
+#undef INSTANTIATE_QUANTIZE_KV_CACHE_BLOCKS_KV_CACHE_TYPE
+#undef INSTANTIATE_QUANTIZE_KV_CACHE_BLOCKS
+
+template <typename T, typename T_cache, typename KVCacheBuffer>
+__global__ void appendKvCacheBlocks(const T* kSrc, const T* vSrc, KVCacheBuffer kvCacheBuffer,
+    const int* sequenceLengths, const int headNum, const int sizePerHead, const int cyclicKvCacheLen,
+    const bool freshWrappedBlocks, const int srcTokenStride)
+{
+    // One CTA appends the K (even blockIdx.y) or V (odd blockIdx.y) of one head of one sequence.
+    const int seqIdx = blockIdx.x;
+    const int headIdx = blockIdx.y >> 1;
+    const bool handleK = (blockIdx.y & 1) == 0;
+
+    // The sequence length includes the new token.
+    const int tokenIdx = sequenceLengths[seqIdx] - 1;
+    const int slot = tokenIdx % cyclicKvCacheLen;
+    const int localSlot = kvCacheBuffer.getLocalIdx(slot);
+    const int firstSlot = slot - localSlot;
+    const bool wrapped = tokenIdx >= cyclicKvCacheLen;
+    // The first token of a block sets its scale, unless the block still holds the tokens of the previous lap of the
+    // cyclic KV cache. The sliding window KV cache gets its blocks back from the pool instead.
+    const bool opensBlock = localSlot == 0 && (!wrapped || freshWrappedBlocks);
+
+    const T* src = (handleK ? kSrc : vSrc) + static_cast<int64_t>(seqIdx) * srcTokenStride + headIdx * sizePerHead;
+    float absMax = 0.f;
+    for (int i = threadIdx.x; i < sizePerHead; i += blockDim.x)
+    {
+        absMax = fmaxf(absMax, fabsf(cuda_cast<float>(src[i])));
+    }
+    absMax = blockReduceMax<float>(absMax);
+
+    __shared__ float sScaleQuantOrig;
+    __shared__ float sRescale;
+    void* blockPtr = handleK ? kvCacheBuffer.getKBlockPtr(seqIdx, slot) : kvCacheBuffer.getVBlockPtr(seqIdx, slot);
+    if (threadIdx.x == 0)
+    {
+        float* scalePtr = kvCacheBuffer.getBlockScalePtr(blockPtr, headIdx, headNum, sizePerHead);
+        const float tokenScale = absMax / KvCacheQuantMax<T_cache>::value;
+        const float oldScale = opensBlock ? 0.f : *scalePtr;
+        const float newScale = opensBlock ? (absMax > 0.f ? tokenScale : 1.f) : fmaxf(oldScale, tokenScale);
+        *scalePtr = newScale;
+        sScaleQuantOrig = newScale;
+        sRescale = opensBlock ? 1.f : oldScale / newScale;
+    }
+    __syncthreads();
+
+    T_cache* dst = reinterpret_cast<T_cache*>(blockPtr);
+    if (sRescale < 1.f)
+    {
+        // The token outgrows the scale of the block, the tokens already in the block move to the new scale.
+        const int numFilled = wrapped && !freshWrappedBlocks
+            ? min(kvCacheBuffer.mTokensPerBlock, cyclicKvCacheLen - firstSlot)
+            : localSlot;
+        for (int i = threadIdx.x; i < numFilled * sizePerHead; i += blockDim.x)
+        {
+            T_cache* elem = &dst[kvCacheBuffer.getKVLocalIdx(firstSlot + i / sizePerHead, headIdx, sizePerHead,
+                i % sizePerHead)];
+            quantizeKvCacheElem(elem, static_cast<float>(*elem) * sRescale);
+        }
+        __syncthreads();
+    }
+
+    const float scaleOrigQuant = 1.f / sScaleQuantOrig;
+    for (int i = threadIdx.x; i < sizePerHead; i += blockDim.x)
+    {
+        quantizeKvCacheElem(&dst[kvCacheBuffer.getKVLocalIdx(slot, headIdx, sizePerHead, i)],
+            cuda_cast<float>(src[i]) * scaleOrigQuant);
+    }
+}
+
+template <typename T, typename KVCacheBuffer>
+void invokeAppendKvCacheBlocks(const T* k_src, const T* v_src, KVCacheBuffer& kvTable, const int* sequence_lengths,
+    const int batch_beam, const int cyclic_kv_cache_len, const bool fresh_wrapped_blocks, const int size_per_head,
+    const int local_head_num, const int src_token_stride, const KvCacheDataType cache_type, cudaStream_t stream)
+{
+    dim3 blockSz(128);
+    dim3 gridSz(batch_beam, local_head_num * 2);
+
+    if (cache_type == KvCacheDataType::INT8)
+    {
+        appendKvCacheBlocks<T, int8_t, KVCacheBuffer><<<gridSz, blockSz, 0, stream>>>(k_src, v_src, kvTable,
+            sequence_lengths, local_head_num, size_per_head, cyclic_kv_cache_len, fresh_wrapped_blocks,
+            src_token_stride);
+    }
+#ifdef ENABLE_FP8
+    else if (cache_type == KvCacheDataType::FP8)
+    {
+        appendKvCacheBlocks<T, __nv_fp8_e4m3, KVCacheBuffer><<<gridSz, blockSz, 0, stream>>>(k_src, v_src, kvTable,
+            sequence_lengths, local_head_num, size_per_head, cyclic_kv_cache_len, fresh_wrapped_blocks,
+            src_token_stride);
+    }
+#endif // ENABLE_FP8
+    else
+    {
+        TLLM_CHECK_WITH_INFO(false, "KV cache block scaling requires an INT8 or FP8 KV cache.");
+    }
+}
+
+#define INSTANTIATE_APPEND_KV_CACHE_BLOCKS_KV_CACHE_TYPE(T, KVCacheBuffer)                                             \
+    template void invokeAppendKvCacheBlocks(const T* k_src, const T* v_src, KVCacheBuffer& kvTable,                    \
+        const int* sequence_lengths, const int batch_beam, const int cyclic_kv_cache_len,                              \
+        const bool fresh_wrapped_blocks, const int size_per_head, const int local_head_num,                            \
+        const int src_token_stride, const KvCacheDataType cache_type, cudaStream_t stream)
+
+#define INSTANTIATE_APPEND_KV_CACHE_BLOCKS(T)                                                                          \
+    INSTANTIATE_APPEND_KV_CACHE_BLOCKS_KV_CACHE_TYPE(T, KVBlockArray);                                                 \
+    INSTANTIATE_APPEND_KV_CACHE_BLOCKS_KV_CACHE_TYPE(T, KVLinearBuffer);
+
+INSTANTIATE_APPEND_KV_CACHE_BLOCKS(float)
+INSTANTIATE_APPEND_KV_CACHE_BLOCKS(half)
+#ifdef ENABLE_BF16
+INSTANTIATE_APPEND_KV_CACHE_BLOCKS(__nv_bfloat16);
+#endif
+
+#undef INSTANTIATE_APPEND_KV_CACHE_BLOCKS_KV_CACHE_TYPE
+#undef INSTANTIATE_APPEND_KV_CACHE_BLOCKS
+
+// Bucket of the implicit relative attention bias of T5, see bert_preprocess_kernels.cu::buildRelativeAttentionBias
+inline __device__ int relativeAttentionBucket(
+    int relative_position, int num_buckets, int max_distance, bool bidirectional)
+{
+    int relative_buckets = 0;
+    if (bidirectional)
+    { // special logic in T5 relative attention, both encoder & decoder use this, because rel pos bias is
+        // pre-computed once and passed around
+        num_buckets /= 2;
+        relative_buckets += relative_position > 0 ? num_buckets : 0;
+    }
+    relative_position = abs(relative_position);
+
+    int max_exact = num_buckets / 2;
+    bool is_small = relative_position < max_exact;
+    int relative_position_if_large = max_exact
+        + (int) (logf(relative_position * 1.0f / max_exact) / logf((float) max_distance / max_exact)
+            * (num_buckets - max_exact));
+    relative_position_if_large = min(relative_position_if_large, num_buckets - 1);
+    return relative_buckets + (is_small ? relative_position : relative_position_if_large);
+}
+
 template <typename T, typename BT>
 __global__ void addRelativeAttentionBiasUnaligned(T* qk_buf, const BT* relative_attention_bias, const int batch_size,
     const int head_num, const int seq_len, int max_seq_len, bool implicit, int num_buckets, int max_distance,
@@ -1703,24 +1986,8 @@ __global__ void addRelativeAttentionBiasUnaligned(T* qk_buf, const BT* relative_
 
         if (implicit)
         {
-            // compute bias value on the fly (see bert_preprocess_kernels.cu::buildRelativeAttentionBias)
-            int relative_buckets = 0;
-            int relative_position = seq_j - seq_i;
-            if (bidirectional)
-            { // special logic in T5 relative attention, both encoder & decoder use this, because rel pos bias is
-                // pre-computed once and passed around
-                num_buckets /= 2;
-                relative_buckets += relative_position > 0 ? num_buckets : 0;
-            }
-            relative_position = abs(relative_position);
-
-            int max_exact = num_buckets / 2;
-            bool is_small = relative_position < max_exact;
-            int relative_position_if_large = max_exact
-                + (int) (logf(relative_position * 1.0f / max_exact) / logf((float) max_distance / max_exact)
-                    * (num_buckets - max_exact));
-            relative_position_if_large = min(relative_position_if_large, num_buckets - 1);
-            relative_buckets += is_small ? relative_position : relative_position_if_large;
+            // compute bias value on the fly
+            int relative_buckets = relativeAttentionBucket(seq_j - seq_i, num_buckets, max_distance, bidirectional);
             BT rel_attn_bias = relative_attention_bias[head_id * rel_attn_table_stride + relative_buckets];
             qk_buf[qk_index] = (T) add((T) rel_attn_bias, qk_buf[qk_index]);
         }
@@ -1759,5 +2026,129 @@ INSTANTIATE_ADD_RELATIVE_ATTENTION_BIAS_UNALIGNED(float, __nv_bfloat16);
 #endif
 #undef INSTANTIATE_ADD_RELATIVE_ATTENTION_BIAS_UNALIGNED
 
+template <typename T>
+__global__ void packedAttention(T* output, const T* qkv, const int* cu_seqlens, const int* padding_offset,
+    const T* relative_attention_bias, const int max_seq_len, const int head_num, const int size_per_head,
+    const float qk_scale, const bool implicit, const int relative_attention_bias_dim, const int max_distance)
+{
+    // One block per query token and head, the keys are those of its sequence only
+    extern __shared__ float smem[];
+    float* q_smem = smem;                      // [size_per_head]
+    float* scores_smem = smem + size_per_head; // [seq_len]
+
+    const int token_idx = blockIdx.x;
+    const int head_idx = blockIdx.y;
+    const int padded_idx = token_idx + padding_offset[token_idx];
+    const int batch_idx = padded_idx / max_seq_len;
+    const int seq_i = padded_idx % max_seq_len;
+    const int seq_start = cu_seqlens[batch_idx];
+    const int seq_len = cu_seqlens[batch_idx + 1] - seq_start;
+
+    const int hidden_units = head_num * size_per_head;
+    const int qkv_stride = 3 * hidden_units;
+    const T* q = qkv + static_cast<size_t>(token_idx) * qkv_stride + head_idx * size_per_head;
+    const T* k = qkv + static_cast<size_t>(seq_start) * qkv_stride + hidden_units + head_idx * size_per_head;
+    const T* v = k + hidden_units;
+
+    for (int d = threadIdx.x; d < size_per_head; d += blockDim.x)
+    {
+        q_smem[d] = static_cast<float>(q[d]);
+    }
+    __syncthreads();
+
+    // Q.K, one warp per key
+    const int warp_id = threadIdx.x / 32;
+    const int lane_id = threadIdx.x % 32;
+    const int num_warps = blockDim.x / 32;
+    float local_max = -1e20f;
+    for (int seq_j = warp_id; seq_j < seq_len; seq_j += num_warps)
+    {
+        const T* k_j = k + static_cast<size_t>(seq_j) * qkv_stride;
+        float dot = 0.0f;
+        for (int d = lane_id; d < size_per_head; d += 32)
+        {
+            dot += q_smem[d] * static_cast<float>(k_j[d]);
+        }
+        dot = warpReduceSum(dot);
+        if (lane_id == 0)
+        {
+            float score = dot * qk_scale;
+            if (relative_attention_bias != nullptr)
+            {
+                const int bias_index = implicit
+                    ? head_idx * relative_attention_bias_dim
+                        + relativeAttentionBucket(seq_j - seq_i, relative_attention_bias_dim, max_distance, true)
+                    : (head_idx * relative_attention_bias_dim + seq_i) * relative_attention_bias_dim + seq_j;
+                score += static_cast<float>(relative_attention_bias[bias_index]);
+            }
+            scores_smem[seq_j] = score;
+            local_max = fmaxf(local_max, score);
+        }
+    }
+    __shared__ float s_max, s_sum;
+    const float max_val = blockReduceMax<float>(local_max);
+    if (threadIdx.x == 0)
+    {
+        s_max = max_val;
+    }
+    __syncthreads();
+
+    float local_sum = 0.0f;
+    for (int seq_j = threadIdx.x; seq_j < seq_len; seq_j += blockDim.x)
+    {
+        const float p = __expf(scores_smem[seq_j] - s_max);
+        scores_smem[seq_j] = p;
+        local_sum += p;
+    }
+    local_sum = blockReduceSum<float>(local_sum);
+    if (threadIdx.x == 0)
+    {
+        s_sum = local_sum;
+    }
+    __syncthreads();
+    const float inv_sum = 1.0f / (s_sum + 1e-6f);
+
+    // P.V, one thread per channel so that the loads of V are coalesced
+    T* out = output + static_cast<size_t>(token_idx) * hidden_units + head_idx * size_per_head;
+    for (int d = threadIdx.x; d < size_per_head; d += blockDim.x)
+    {
+        float acc = 0.0f;
+        for (int seq_j = 0; seq_j < seq_len; ++seq_j)
+        {
+            acc += scores_smem[seq_j] * static_cast<float>(v[static_cast<size_t>(seq_j) * qkv_stride + d]);
+        }
+        out[d] = static_cast<T>(acc * inv_sum);
+    }
+}
+
+template <typename T>
+void invokePackedAttention(T* output, const T* qkv, const int* cu_seqlens, const int* padding_offset,
+    const T* relative_attention_bias, const int num_tokens, const int max_seq_len, const int head_num,
+    const int size_per_head, const float qk_scale, const bool implicit, const int relative_attention_bias_dim,
+    const int max_distance, cudaStream_t stream)
+{
+    // qkv: [num_tokens, 3, head_num, size_per_head], output: [num_tokens, head_num, size_per_head]
+    const size_t smem_size = sizeof(float) * (size_per_head + max_seq_len);
+    TLLM_CHECK_WITH_INFO(smem_size <= 48 * 1024, "Packed attention supports sequences of up to %d tokens",
+        static_cast<int>(48 * 1024 / sizeof(float)) - size_per_head);
+    dim3 grid(num_tokens, head_num);
+    dim3 block(128);
+    packedAttention<<<grid, block, smem_size, stream>>>(output, qkv, cu_seqlens, padding_offset,
+        relative_attention_bias, max_seq_len, head_num, size_per_head, qk_scale, implicit, relative_attention_bias_dim,
+        max_distance);
+}
+
+#define INSTANTIATE_PACKED_ATTENTION(T)                                                                                \
+    template void invokePackedAttention(T* output, const T* qkv, const int* cu_seqlens, const int* padding_offset,     \
+        const T* relative_attention_bias, const int num_tokens, const int max_seq_len, const int head_num,             \
+        const int size_per_head, const float qk_scale, const bool implicit, const int relative_attention_bias_dim,     \
+        const int max_distance, cudaStream_t stream)
+INSTANTIATE_PACKED_ATTENTION(float);
+INSTANTIATE_PACKED_ATTENTION(half);
+#ifdef ENABLE_BF16
+INSTANTIATE_PACKED_ATTENTION(__nv_bfloat16);
+#endif
+#undef INSTANTIATE_PACKED_ATTENTION
+
 } // namespace kernels
 } // namespace tensorrt_llm
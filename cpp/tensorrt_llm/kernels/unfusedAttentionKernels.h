@@ -104,9 +104,32 @@ void invokeAddFusedQKVBiasTranspose(T* q_buf, T* k_buf, T* v_buf, T* QKV, const
 template <typename T, typename KVCacheBuffer>
 void invokeTranspose4dBatchMajor(const T* k_src, const T* v_src, KVCacheBuffer& kvTable, const int local_batch_size,
     const int seq_len, const int max_attention_window_size, const int size_per_head, const int local_head_num,
-    const KvCacheDataType cache_type, const float* kvScaleOrigQuant, const int* sequence_lengths, cudaStream_t stream);
+    const KvCacheDataType cache_type, const float* kvScaleOrigQuant, const int* sequence_lengths, cudaStream_t stream,
+    const int sink_token_length = 0);
+
+// Quantizes the context K/V of each paged block with its own per-head scale (KV cache block scaling) and writes
+// the dequantization scales to the sidecar that follows every block. Source element (b, t, h, d) is read at
+// (cu_seqlens ? cu_seqlens[b] * src_token_stride : b * src_batch_stride) + t * src_token_stride
+// + h * src_head_stride + d.
+template <typename T, typename KVCacheBuffer>
+void invokeQuantizeKvCacheBlocks(const T* k_src, const T* v_src, KVCacheBuffer& kvTable, const int* cu_seqlens,
+    const int* sequence_lengths, const int local_batch_size, const int seq_len, const int attention_window_size,
+    const int size_per_head, const int local_head_num, const int src_batch_stride, const int src_token_stride,
+    const int src_head_stride, const KvCacheDataType cache_type, cudaStream_t stream);
+
+// Appends the K/V of the generated token of each sequence to a paged KV cache with block scaling. The first token of
+// a block sets the scale of the block and a token that exceeds it grows the scale, re-quantizing the tokens already in
+// the block. Source element (b, h, d) is read at b * src_token_stride + h * size_per_head + d. The blocks the cyclic
+// KV cache wraps to are empty with fresh_wrapped_blocks, as with the sliding window KV cache.
+template <typename T, typename KVCacheBuffer>
+void invokeAppendKvCacheBlocks(const T* k_src, const T* v_src, KVCacheBuffer& kvTable, const int* sequence_lengths,
+    const int batch_beam, const int cyclic_kv_cache_len, const bool fresh_wrapped_blocks, const int size_per_head,
+    const int local_head_num, const int src_token_stride, const KvCacheDataType cache_type, cudaStream_t stream);
 
 // NOTE: this kernel is in-place, QKV will be modified, if other kernels need that, may need copy or use before it.
+// With enable_paged_kv_fmha, the rotated Q is written to Q and QKV is left untouched. Without bias and RoPE, the
+// values do not change, so only the KV cache is written. The first sink_token_length tokens keep the first slots of
+// the cyclic KV cache.
 template <typename T, typename KVCacheBuffer, bool IsGenerate = false>
 void invokeApplyBiasRopeUpdateKVCache(T* QKV, T* Q, KVCacheBuffer& kvTable, const T* qkv_bias, const int* seq_lens,
     const int* kv_seq_lens, const int* padding_offset, const int batch_size, const int seq_len,
@@ -115,12 +138,23 @@ void invokeApplyBiasRopeUpdateKVCache(T* QKV, T* Q, KVCacheBuffer& kvTable, cons
     const RotaryScalingType rotary_scale_type, const float rotary_embedding_scale,
     const int rotary_embedding_max_positions, const PositionEmbeddingType position_embedding_type, const float* scale,
     const int int8_mode, const KvCacheDataType cache_type, const float* kvScaleOrigQuant,
-    const bool enable_paged_kv_fmha, cudaStream_t stream, int beam_width = 1);
+    const bool enable_paged_kv_fmha, cudaStream_t stream, int beam_width = 1, const int sink_token_length = 0);
 
 template <typename T, typename BT>
 void invokeAddRelativeAttentionBiasUnaligned(T* qk_buf, const BT* relative_attention_bias, const int batch_size,
     const int head_num, const int seq_len, const int max_seq_len, cudaStream_t stream, bool implicit = false,
     int num_buckets = 0, int max_distance = 0, bool bidirectional = true);
 
+// Attention of packed sequences without padding, for encoders. Each query attends to all the keys of its sequence.
+// qkv is [num_tokens, 3, head_num, size_per_head] and output [num_tokens, head_num, size_per_head], a token's sequence
+// is found from padding_offset and max_seq_len as built by invokeBuildDecoderInfo. The optional relative attention
+// bias is either the table [head_num, num_buckets] of T5 (implicit) or [head_num, max_len, max_len], where
+// relative_attention_bias_dim is num_buckets or max_len.
+template <typename T>
+void invokePackedAttention(T* output, const T* qkv, const int* cu_seqlens, const int* padding_offset,
+    const T* relative_attention_bias, const int num_tokens, const int max_seq_len, const int head_num,
+    const int size_per_head, const float qk_scale, const bool implicit, const int relative_attention_bias_dim,
+    const int max_distance, cudaStream_t stream);
+
 } // namespace kernels
 } // namespace tensorrt_llm
@@ -68,7 +68,7 @@ __global__ void applyBiasRopeUpdateKVCache(T* QKV, T* Q, KVCacheBuffer kvCacheBu
     const int batch_size, const int seq_len, const int cyclic_kv_cache_len, const int head_num, const int kv_head_num,
     const int size_per_head, const int rotary_embedding_dim, float rotary_embedding_base,
     RotaryScalingType const rotary_scale_type, float rotary_embedding_scale, const int rotary_embedding_max_positions,
-    PositionEmbeddingType const position_embedding_type, int beam_width)
+    PositionEmbeddingType const position_embedding_type, int beam_width, const int sink_token_length)
 {
     // This kernel add bias to QKV, which has shape [batch_size, seq_len, 3, head_num, size_per_head], and
     // QKV split to 3 split buffer q, k, v and transpose them to [batch_size, head_num, seq_len, size_per_head].
@@ -146,8 +146,9 @@ __global__ void applyBiasRopeUpdateKVCache(T* QKV, T* Q, KVCacheBuffer kvCacheBu
     Vec_t q_bias, k_bias, v_bias;
     if (valid_seq)
     {
+        // Like the masked MHA kernel, the generation phase scales with the past kv length (without the new token).
         mmha::update_rotary_base_n_scale(rotary_embedding_base, rotary_embedding_scale, rotary_scale_type,
-            rotary_embedding_dim, rotary_embedding_max_positions, actual_seq_len);
+            rotary_embedding_dim, rotary_embedding_max_positions, IsGenerate ? actual_seq_len - 1 : actual_seq_len);
     }
 
 #pragma unroll
@@ -229,9 +230,13 @@ __global__ void applyBiasRopeUpdateKVCache(T* QKV, T* Q, KVCacheBuffer kvCacheBu
     }
 
     const int channelIdx{tidx};
+    // The sink tokens keep the first slots, the following tokens are written cyclically over the remaining ones.
+    const int cyclic_window_len = cyclic_kv_cache_len - sink_token_length;
     const bool valid_kv_cache_pos = kvCacheBuffer.data != nullptr // In KV-cache-less mode. No need to store KV values
-        && token_idx_in_seq >= (actual_seq_len - cyclic_kv_cache_len);
-    const int token_idx_in_kv_cache = token_idx_in_seq % cyclic_kv_cache_len;
+        && (token_idx_in_seq < sink_token_length || token_idx_in_seq >= (actual_seq_len - cyclic_window_len));
+    const int token_idx_in_kv_cache = token_idx_in_seq < sink_token_length
+        ? token_idx_in_seq
+        : sink_token_length + (token_idx_in_seq - sink_token_length) % cyclic_window_len;
     auto kDst = reinterpret_cast<T_dst*>(kvCacheBuffer.getKBlockPtr(batch_beam_idx, token_idx_in_kv_cache));
     auto vDst = reinterpret_cast<T_dst*>(kvCacheBuffer.getVBlockPtr(batch_beam_idx, token_idx_in_kv_cache));
     int inBlockIdx = kvCacheBuffer.getKVLocalIdx(token_idx_in_kv_cache, kv_head_idx, sizePerHeadDivX, channelIdx);
@@ -241,7 +246,7 @@ __global__ void applyBiasRopeUpdateKVCache(T* QKV, T* Q, KVCacheBuffer kvCacheBu
         {
             *reinterpret_cast<Vec_t*>(&QKV[src_q_idx]) = q;
         }
-        else
+        else if (Q != nullptr)
         {
             *reinterpret_cast<Vec_t*>(&Q[token_idx * head_num * size_per_head + hidden_idx]) = q;
         }
@@ -281,7 +286,7 @@ __global__ void applyBiasRopeUpdateKVCache(T* QKV, T* Q, KVCacheBuffer kvCacheBu
         <<<grid, block, smem_size, stream>>>(QKV, Q, kvTable, qkv_bias, seq_lens, kv_seq_lens, padding_offset,         \
             kvScaleOrigQuant, batch_size, seq_len, cyclic_kv_cache_len, head_num, kv_head_num, size_per_head,          \
             rotary_embedding_dim, rotary_embedding_base, rotary_scale_type, rotary_embedding_scale,                    \
-            rotary_embedding_max_positions, position_embedding_type, beam_width);
+            rotary_embedding_max_positions, position_embedding_type, beam_width, sink_token_length);
 
 template <typename T, typename T_cache, typename KVCacheBuffer, bool IsGenerate>
 void invokeApplyBiasRopeUpdateKVCacheDispatch(T* QKV, T* Q, KVCacheBuffer& kvTable, const T* qkv_bias,
@@ -291,7 +296,7 @@ void invokeApplyBiasRopeUpdateKVCacheDispatch(T* QKV, T* Q, KVCacheBuffer& kvTab
     const RotaryScalingType rotary_scale_type, const float rotary_embedding_scale,
     const int rotary_embedding_max_positions, const PositionEmbeddingType position_embedding_type, const float* scale,
     const float* kvScaleOrigQuant, const int int8_mode, const bool enable_paged_kv_fmha, cudaStream_t stream,
-    int beam_width)
+    int beam_width, const int sink_token_length)
 {
     TLLM_CHECK_WITH_INFO(int8_mode != 2, "w8a8 not yet implemented with RoPE"); // TODO
     if constexpr (!IsGenerate)
@@ -313,7 +318,14 @@ void invokeApplyBiasRopeUpdateKVCacheDispatch(T* QKV, T* Q, KVCacheBuffer& kvTab
 
     // Launch template parameters.
     const bool add_bias = qkv_bias != nullptr;
-    const bool store_qkv = !enable_paged_kv_fmha;
+    const bool has_rope = position_embedding_type == PositionEmbeddingType::kROPE_GPTJ
+        || position_embedding_type == PositionEmbeddingType::kROPE_GPT_NEOX;
+    // Without bias and RoPE the packed QKV is left unchanged, so only the KV cache is written (and Q if requested).
+    const bool store_qkv = !enable_paged_kv_fmha && (add_bias || has_rope);
+    if (!enable_paged_kv_fmha && !store_qkv)
+    {
+        Q = nullptr;
+    }
 
     // NOTE: add offset for rotary embedding
     if (add_bias)
@@ -348,7 +360,7 @@ void invokeApplyBiasRopeUpdateKVCache(T* QKV, T* Q, KVCacheBuffer& kvTable, cons
     const RotaryScalingType rotary_scale_type, const float rotary_embedding_scale,
     const int rotary_embedding_max_positions, const PositionEmbeddingType position_embedding_type, const float* scale,
     const int int8_mode, const KvCacheDataType cache_type, const float* kvScaleOrigQuant,
-    const bool enable_paged_kv_fmha, cudaStream_t stream, int beam_width)
+    const bool enable_paged_kv_fmha, cudaStream_t stream, int beam_width, const int sink_token_length)
 {
     // Block handles both K and V tile.
     constexpr int x = (sizeof(T) == 4) ? 4 : 8;
@@ -360,7 +372,7 @@ void invokeApplyBiasRopeUpdateKVCache(T* QKV, T* Q, KVCacheBuffer& kvTable, cons
             seq_lens, kv_seq_lens, padding_offset, batch_size, seq_len, cyclic_kv_cache_len, token_num, head_num,
             kv_head_num, size_per_head, rotary_embedding_dim, rotary_embedding_base, rotary_scale_type,
             rotary_embedding_scale, rotary_embedding_max_positions, position_embedding_type, scale, kvScaleOrigQuant,
-            int8_mode, enable_paged_kv_fmha, stream, beam_width);
+            int8_mode, enable_paged_kv_fmha, stream, beam_width, sink_token_length);
     }
 #ifdef ENABLE_FP8
     else if (cache_type == KvCacheDataType::FP8)
@@ -369,7 +381,7 @@ void invokeApplyBiasRopeUpdateKVCache(T* QKV, T* Q, KVCacheBuffer& kvTable, cons
             seq_lens, kv_seq_lens, padding_offset, batch_size, seq_len, cyclic_kv_cache_len, token_num, head_num,
             kv_head_num, size_per_head, rotary_embedding_dim, rotary_embedding_base, rotary_scale_type,
             rotary_embedding_scale, rotary_embedding_max_positions, position_embedding_type, scale, kvScaleOrigQuant,
-            int8_mode, enable_paged_kv_fmha, stream, beam_width);
+            int8_mode, enable_paged_kv_fmha, stream, beam_width, sink_token_length);
     }
 #endif // ENABLE_FP8
     else
@@ -378,7 +390,7 @@ void invokeApplyBiasRopeUpdateKVCache(T* QKV, T* Q, KVCacheBuffer& kvTable, cons
             kv_seq_lens, padding_offset, batch_size, seq_len, cyclic_kv_cache_len, token_num, head_num, kv_head_num,
             size_per_head, rotary_embedding_dim, rotary_embedding_base, rotary_scale_type, rotary_embedding_scale,
             rotary_embedding_max_positions, position_embedding_type, scale, kvScaleOrigQuant, int8_mode,
-            enable_paged_kv_fmha, stream, beam_width);
+            enable_paged_kv_fmha, stream, beam_width, sink_token_length);
     }
 }
 
@@ -391,7 +403,7 @@ void invokeApplyBiasRopeUpdateKVCache(T* QKV, T* Q, KVCacheBuffer& kvTable, cons
         const float rotary_embedding_scale, const int rotary_embedding_max_positions,                                  \
         const PositionEmbeddingType position_embedding_type, const float* scale, const int int8_mode,                  \
         const KvCacheDataType cache_type, const float* kvScaleOrigQuant, const bool enable_paged_kv_fmha,              \
-        cudaStream_t stream, int beam_width)
+        cudaStream_t stream, int beam_width, const int sink_token_length)
 
 INSTANTIATE_ADDFUSEDQKVBIAS_TRANSPOSE(float, KVBlockArray, false);
 INSTANTIATE_ADDFUSEDQKVBIAS_TRANSPOSE(float, KVLinearBuffer, false);
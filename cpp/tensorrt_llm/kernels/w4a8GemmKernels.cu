@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaTypeUtils.cuh"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/w4a8GemmKernels.h"
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+namespace
+{
+constexpr int kGemvWarpsPerBlock = 4;
+
+// Nibble j of the packed word is element j, sign-extended by the arithmetic shift.
+__device__ __forceinline__ int8_t unpackInt4(uint32_t packed, int j)
+{
+    return static_cast<int8_t>(static_cast<int32_t>(packed << (28 - 4 * j)) >> 28);
+}
+} // namespace
+
+__global__ void unpackInt4ToInt8Kernel(char2* dst, const uint8_t* src, int64_t numBytes)
+{
+    for (int64_t idx = blockIdx.x * static_cast<int64_t>(blockDim.x) + threadIdx.x; idx < numBytes;
+         idx += static_cast<int64_t>(gridDim.x) * blockDim.x)
+    {
+        const uint32_t packed = src[idx];
+        dst[idx] = make_char2(unpackInt4(packed, 0), unpackInt4(packed, 1));
+    }
+}
+
+void invokeUnpackInt4ToInt8(int8_t* dst, const int8_t* src, int n, int k, cudaStream_t stream)
+{
+    TLLM_CHECK_WITH_INFO(k % 2 == 0, "The int4 weights must have an even number of columns.");
+    const int64_t numBytes = static_cast<int64_t>(n) * k / 2;
+    const dim3 block(256);
+    const dim3 grid(std::min<int64_t>((numBytes + block.x - 1) / block.x, 65536));
+    unpackInt4ToInt8Kernel<<<grid, block, 0, stream>>>(
+        reinterpret_cast<char2*>(dst), reinterpret_cast<const uint8_t*>(src), numBytes);
+}
+
+// One warp per output channel. Each lane reads 8 int4 weights per step and reuses them for the M rows.
+template <typename T, int M>
+__global__ void w4a8BatchedGemvKernel(T* out, const int8_t* act, const int8_t* weight, bool perTokenScaling,
+    bool perChannelScaling, const float* alphaRow, const float* alphaCol, int n, int k)
+{
+    const int warpIdx = threadIdx.x / 32;
+    const int laneIdx = threadIdx.x % 32;
+    const int col = blockIdx.x * kGemvWarpsPerBlock + warpIdx;
+    if (col >= n)
+    {
+        return;
+    }
+
+    const uint32_t* weightRow = reinterpret_cast<const uint32_t*>(weight + static_cast<int64_t>(col) * k / 2);
+    int32_t acc[M] = {0};
+    for (int i = laneIdx; i < k / 8; i += 32)
+    {
+        const uint32_t packed = weightRow[i];
+        int8_t w[8];
+#pragma unroll
+        for (int j = 0; j < 8; ++j)
+        {
+            w[j] = unpackInt4(packed, j);
+        }
+        const int32_t w0 = *reinterpret_cast<const int32_t*>(w);
+        const int32_t w1 = *reinterpret_cast<const int32_t*>(w + 4);
+#pragma unroll
+        for (int m = 0; m < M; ++m)
+        {
+            const int2 a = reinterpret_cast<const int2*>(act + static_cast<int64_t>(m) * k)[i];
+            acc[m] = __dp4a(a.x, w0, acc[m]);
+            acc[m] = __dp4a(a.y, w1, acc[m]);
+        }
+    }
+
+#pragma unroll
+    for (int m = 0; m < M; ++m)
+    {
+#pragma unroll
+        for (int mask = 16; mask > 0; mask >>= 1)
+        {
+            acc[m] += __shfl_xor_sync(0xffffffff, acc[m], mask);
+        }
+    }
+
+    if (laneIdx == 0)
+    {
+        const float scaleCol = perChannelScaling ? alphaCol[col] : alphaCol[0];
+#pragma unroll
+        for (int m = 0; m < M; ++m)
+        {
+            const float scaleRow = perTokenScaling ? alphaRow[m] : alphaRow[0];
+            out[static_cast<int64_t>(m) * n + col] = cuda_cast<T>(static_cast<float>(acc[m]) * scaleRow * scaleCol);
+        }
+    }
+}
+
+template <typename T, int M>
+void w4a8BatchedGemvLauncher(T* out, const int8_t* act, const int8_t* weight, QuantMode quantMode,
+    const float* alphaRow, const float* alphaCol, int n, int k, cudaStream_t stream)
+{
+    const dim3 block(kGemvWarpsPerBlock * 32);
+    const dim3 grid((n + kGemvWarpsPerBlock - 1) / kGemvWarpsPerBlock);
+    w4a8BatchedGemvKernel<T, M><<<grid, block, 0, stream>>>(out, act, weight, quantMode.hasPerTokenScaling(),
+        quantMode.hasPerChannelScaling(), alphaRow, alphaCol, n, k);
+}
+
+template <typename T>
+void invokeW4A8BatchedGemv(T* out, const int8_t* act, const int8_t* weight, QuantMode quantMode,
+    const float* alphaRow, const float* alphaCol, int m, int n, int k, cudaStream_t stream)
+{
+    TLLM_CHECK_WITH_INFO(k % 8 == 0, "The W4A8 GEMV requires the hidden size to be a multiple of 8.");
+    switch (m)
+    {
+    case 1:
+        w4a8BatchedGemvLauncher<T, 1>(out, act, weight, quantMode, alphaRow, alphaCol, n, k, stream);
+        break;
+    case 2:
+        w4a8BatchedGemvLauncher<T, 2>(out, act, weight, quantMode, alphaRow, alphaCol, n, k, stream);
+        break;
+    case 3:
+        w4a8BatchedGemvLauncher<T, 3>(out, act, weight, quantMode, alphaRow, alphaCol, n, k, stream);
+        break;
+    case 4:
+        w4a8BatchedGemvLauncher<T, 4>(out, act, weight, quantMode, alphaRow, alphaCol, n, k, stream);
+        break;
+    default:
+        TLLM_THROW("The W4A8 GEMV supports at most %d rows.", kW4A8GemvMaxM);
+    }
+}
+
+#define INSTANTIATE_W4A8_BATCHED_GEMV(T)                                                                               \
+    template void invokeW4A8BatchedGemv<T>(T * out, const int8_t* act, const int8_t* weight, QuantMode quantMode,      \
+        const float* alphaRow, const float* alphaCol, int m, int n, int k, cudaStream_t stream)
+
+INSTANTIATE_W4A8_BATCHED_GEMV(float);
+INSTANTIATE_W4A8_BATCHED_GEMV(half);
+#ifdef ENABLE_BF16
+INSTANTIATE_W4A8_BATCHED_GEMV(__nv_bfloat16);
+#endif
+
+} // namespace kernels
+} // namespace tensorrt_llm
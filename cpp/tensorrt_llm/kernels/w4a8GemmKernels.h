@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+#pragma once
+
+#include "tensorrt_llm/common/quantization.h"
+#include <cuda_runtime.h>
+#include <stdint.h>
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+//! \brief Largest number of rows handled by invokeW4A8BatchedGemv. Larger batches unpack the weights with
+//! invokeUnpackInt4ToInt8 and run the int8 tensor core GEMM.
+static constexpr int kW4A8GemvMaxM = 4;
+
+//! \brief Sign-extends packed int4 weights to int8. Element 2i of a row is in the low nibble of byte i.
+//!
+//! \param dst [n, k] int8 weights
+//! \param src [n, k / 2] packed int4 weights
+//! \param n number of rows (output channels)
+//! \param k number of columns, must be even
+//! \param stream cuda stream
+void invokeUnpackInt4ToInt8(int8_t* dst, const int8_t* src, int n, int k, cudaStream_t stream);
+
+//! \brief out = (act @ unpack(weight)^T) * alphaRow * alphaCol for small batches. The int4 weights are unpacked in
+//! registers and accumulated against the int8 activations with dp4a, so each weight byte is read once per call.
+//!
+//! \param out [m, n] output
+//! \param act [m, k] int8 activations
+//! \param weight [n, k / 2] packed int4 weights, see invokeUnpackInt4ToInt8
+//! \param quantMode per-token scaling selects alphaRow[m] over alphaRow[0], per-channel scaling alphaCol[n] over
+//! alphaCol[0]
+//! \param alphaRow activation scales
+//! \param alphaCol weight scales
+//! \param m number of rows, at most kW4A8GemvMaxM
+//! \param n number of output channels
+//! \param k hidden size, must be a multiple of 8
+//! \param stream cuda stream
+template <typename T>
+void invokeW4A8BatchedGemv(T* out, const int8_t* act, const int8_t* weight, tensorrt_llm::common::QuantMode quantMode,
+    const float* alphaRow, const float* alphaCol, int m, int n, int k, cudaStream_t stream);
+
+} // namespace kernels
+} // namespace tensorrt_llm
@@ -50,6 +50,8 @@ enum class WeightOnlyActivationFunctionType
     Gelu,
     Relu,
     Identity,
+    // silu(gate) * up, with the weights of the n gate columns followed by the weights of the n up columns
+    SwiGlu,
     InvalidType
 };
 
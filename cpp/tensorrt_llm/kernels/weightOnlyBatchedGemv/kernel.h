@@ -297,6 +297,10 @@ __device__ void weight_only_batched_gemv(const uint8_t* qweight, const ActType*
     const ActType* in, const ActType* act_scale, const ActType* bias, ActType* out, const int n, const int k)
 {
     static_assert(NPerBlock == 1 || (NPerBlock % 2 == 0));
+    // Gated activations read the gate and the up weights of the NPerBlock * Interleave columns of the block, the up
+    // weights being n columns after the gate weights
+    constexpr bool kGated = IsGatedActivation<ActOp>::value;
+    constexpr int kNWeights = kGated ? NPerBlock * 2 : NPerBlock;
     using ActType2 = typename ActTypeDetails<ActType>::Vec2;
     using Details = WeightOnlyKernelDetails<ActType, QType>;
 
@@ -308,7 +312,7 @@ __device__ void weight_only_batched_gemv(const uint8_t* qweight, const ActType*
     extern __shared__ uint8_t shmem[];
     constexpr int Interleave = Details::kInterleave;
     constexpr int WarpSize = 32;
-    constexpr int Num = Batch * NPerBlock;
+    constexpr int Num = Batch * kNWeights;
     const int tid = threadIdx.x;
     const int bid = blockIdx.x;
     const int n_start_id = bid * NPerBlock * Interleave;
@@ -316,7 +320,7 @@ __device__ void weight_only_batched_gemv(const uint8_t* qweight, const ActType*
     const int interleave_n_id = (tid / Details::kThreadsNumPerTile) % Interleave;
 
     qweight += n_start_id * k / Details::kElemsPerByte;
-    ScaleLoader scale_loader(scales, zeros, n_start_id + interleave_n_id, n);
+    ScaleLoader scale_loader(scales, zeros, n_start_id + interleave_n_id, kGated ? 2 * n : n);
 
     float(*sm)[Num * Interleave] = reinterpret_cast<float(*)[Num * Interleave]>(shmem);
 
@@ -332,16 +336,18 @@ __device__ void weight_only_batched_gemv(const uint8_t* qweight, const ActType*
     for (int local_k = tid * Details::kElemsPerThread; local_k < k * Interleave;
          local_k += BlockSize * Details::kElemsPerThread)
     {
-        ActType weights_f16[Details::kElemsPerThread * NPerBlock];
-        ActType scale[NPerBlock], zero[NPerBlock];
+        ActType weights_f16[Details::kElemsPerThread * kNWeights];
+        ActType scale[kNWeights], zero[kNWeights];
 #pragma unroll
-        for (int idx = 0; idx < NPerBlock; ++idx)
+        for (int idx = 0; idx < kNWeights; ++idx)
         {
+            // Interleaved row of the weights, the up weights of gated activations start at row n / Interleave
+            const int row = idx < NPerBlock ? idx : idx - NPerBlock + n / Interleave;
             // Load quantized weight and scales/zeros
             uint8_t weights_quantized[Details::kBytePerThread];
             load<AccType>(weights_quantized,
-                qweight + idx * Interleave * k / Details::kElemsPerByte + local_k / Details::kElemsPerByte);
-            scale_loader.load(scale[idx], zero[idx], idx);
+                qweight + row * Interleave * k / Details::kElemsPerByte + local_k / Details::kElemsPerByte);
+            scale_loader.load(scale[idx], zero[idx], row);
             ActType weights_vec[Details::kElemsPerThread];
 #pragma unroll
             for (int i = 0; i < Details::kConvertIters; ++i)
@@ -365,12 +371,12 @@ __device__ void weight_only_batched_gemv(const uint8_t* qweight, const ActType*
                         v, ActTypeDetails<ActType>::to_vec2(scale[idx]), ActTypeDetails<ActType>::to_vec2(zero[idx]));
                     weights_f16[(i * Details::kShuffleStrided * Details::kShuffleBasicTile
                                     + j * Details::kShuffleBasicTile + 0)
-                            * NPerBlock
+                            * kNWeights
                         + idx]
                         = v.x;
                     weights_f16[(i * Details::kShuffleStrided * Details::kShuffleBasicTile
                                     + j * Details::kShuffleBasicTile + 1)
-                            * NPerBlock
+                            * kNWeights
                         + idx]
                         = v.y;
                 }
@@ -408,7 +414,7 @@ __device__ void weight_only_batched_gemv(const uint8_t* qweight, const ActType*
                 }
             }
             // Perform vector inner product and accumulate
-            if constexpr (NPerBlock == 1)
+            if constexpr (kNWeights == 1)
             {
                 ActType2 v = ActTypeDetails<ActType>::to_vec2(static_cast<ActType>(0.f));
 #pragma unroll
@@ -422,15 +428,15 @@ __device__ void weight_only_batched_gemv(const uint8_t* qweight, const ActType*
             else
             {
 #pragma unroll
-                for (int x = 0; x < NPerBlock / 2; ++x)
+                for (int x = 0; x < kNWeights / 2; ++x)
                 {
 #pragma unroll
                     for (int y = 0; y < Details::kElemsPerThread; ++y)
                     {
-                        *reinterpret_cast<ActType2*>(accumulator + b * NPerBlock + x * 2)
-                            = __hfma2(*reinterpret_cast<ActType2*>(weights_f16 + y * NPerBlock + x * 2),
+                        *reinterpret_cast<ActType2*>(accumulator + b * kNWeights + x * 2)
+                            = __hfma2(*reinterpret_cast<ActType2*>(weights_f16 + y * kNWeights + x * 2),
                                 ActTypeDetails<ActType>::to_vec2(in_v[y]),
-                                *reinterpret_cast<ActType2*>(accumulator + b * NPerBlock + x * 2));
+                                *reinterpret_cast<ActType2*>(accumulator + b * kNWeights + x * 2));
                     }
                 }
             }
@@ -448,6 +454,31 @@ __device__ void weight_only_batched_gemv(const uint8_t* qweight, const ActType*
     // corresponding address in shared memory
     Details::Layout::sync<Num, WarpSize>(reses, sm);
 
+    if constexpr (kGated)
+    {
+        // Each thread is responsible for the accumulation of the gate and the up of one element and its store
+        constexpr int kOutPerBatch = NPerBlock * Interleave;
+        for (int i = tid; i < Batch * kOutPerBatch; i += BlockSize)
+        {
+            int b = i / kOutPerBatch;
+            int nid = i % kOutPerBatch;
+            int gate_id = b * kNWeights * Interleave + nid;
+            float gate = 0.f, up = 0.f;
+            for (int j = 0; j < BlockSize / WarpSize; ++j)
+            {
+                gate += sm[j][gate_id];
+                up += sm[j][gate_id + kOutPerBatch];
+            }
+            if constexpr (Bias)
+            {
+                gate += static_cast<float>(bias[n_start_id + nid]);
+                up += static_cast<float>(bias[n + n_start_id + nid]);
+            }
+            out[b * n + n_start_id + nid] = static_cast<ActType>(ActOp<float>::apply(gate) * up);
+        }
+        return;
+    }
+
     // Each thread is responsible for the accumulation and store to global memory of one element
     for (int i = tid; i < Num * Interleave; i += BlockSize)
     {
@@ -490,6 +521,9 @@ template <WeightOnlyQuantType QType, typename WeightOnlyFlag, template <typename
     int NPerBlock, int Batch, int BlockSize>
 struct WeightOnlyBatchedGemvKernelLauncher
 {
+    // Gated activations read two weights per output column
+    static constexpr int kWeightsPerColumn = IsGatedActivation<ActOp>::value ? 2 : 1;
+
     static void run(const WeightOnlyParams& params, cudaStream_t stream)
     {
         if (params.act_type == WeightOnlyActivationType::FP16)
@@ -497,7 +531,7 @@ struct WeightOnlyBatchedGemvKernelLauncher
             constexpr int kInterleave = WeightOnlyDetails<half, QType>::kInterleave;
             dim3 grid(params.n / NPerBlock / kInterleave);
             dim3 block(BlockSize);
-            int size = sizeof(float) * BlockSize / 32 * Batch * NPerBlock * kInterleave;
+            int size = sizeof(float) * BlockSize / 32 * Batch * NPerBlock * kInterleave * kWeightsPerColumn;
             if (params.act_scale != nullptr)
             {
                 weight_only_batched_gemv_wrapper<half, QType, WeightOnlyFlag, ActOp, Zero, Bias, true, NPerBlock, Batch,
@@ -523,7 +557,7 @@ struct WeightOnlyBatchedGemvKernelLauncher
             constexpr int kInterleave = WeightOnlyDetails<nv_bfloat16, QType>::kInterleave;
             dim3 grid(params.n / NPerBlock / kInterleave);
             dim3 block(BlockSize);
-            int size = sizeof(float) * BlockSize / 32 * Batch * NPerBlock * kInterleave;
+            int size = sizeof(float) * BlockSize / 32 * Batch * NPerBlock * kInterleave * kWeightsPerColumn;
             if (params.act_scale != nullptr)
             {
                 weight_only_batched_gemv_wrapper<__nv_bfloat16, QType, WeightOnlyFlag, ActOp, Zero, Bias, true,
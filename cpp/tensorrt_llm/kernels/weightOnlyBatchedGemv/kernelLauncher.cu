@@ -119,8 +119,149 @@ void select_groupwise_weight_only(const WeightOnlyParams& params, cudaStream_t s
     }
 }
 
+// Per-channel weights with 5 to kWeightOnlyBatchedGemvMaxM rows, where each block still reads its weights once for
+// all the rows.
+template <WeightOnlyQuantType QType, int BLOCK_SIZE>
+void select_per_channel_large_batch(const WeightOnlyParams& params, cudaStream_t stream)
+{
+    switch (params.m)
+    {
+    case 5:
+    {
+        WeightOnlyBatchedGemvKernelLauncher<QType, WeightOnlyPerChannel, IdentityActivation, false, false, 2, 5,
+            BLOCK_SIZE>::run(params, stream);
+        break;
+    }
+    case 6:
+    {
+        WeightOnlyBatchedGemvKernelLauncher<QType, WeightOnlyPerChannel, IdentityActivation, false, false, 2, 6,
+            BLOCK_SIZE>::run(params, stream);
+        break;
+    }
+    case 7:
+    {
+        WeightOnlyBatchedGemvKernelLauncher<QType, WeightOnlyPerChannel, IdentityActivation, false, false, 2, 7,
+            BLOCK_SIZE>::run(params, stream);
+        break;
+    }
+    case 8:
+    {
+        WeightOnlyBatchedGemvKernelLauncher<QType, WeightOnlyPerChannel, IdentityActivation, false, false, 2, 8,
+            BLOCK_SIZE>::run(params, stream);
+        break;
+    }
+    case 9:
+    {
+        WeightOnlyBatchedGemvKernelLauncher<QType, WeightOnlyPerChannel, IdentityActivation, false, false, 2, 9,
+            BLOCK_SIZE>::run(params, stream);
+        break;
+    }
+    case 10:
+    {
+        WeightOnlyBatchedGemvKernelLauncher<QType, WeightOnlyPerChannel, IdentityActivation, false, false, 2, 10,
+            BLOCK_SIZE>::run(params, stream);
+        break;
+    }
+    case 11:
+    {
+        WeightOnlyBatchedGemvKernelLauncher<QType, WeightOnlyPerChannel, IdentityActivation, false, false, 2, 11,
+            BLOCK_SIZE>::run(params, stream);
+        break;
+    }
+    case 12:
+    {
+        WeightOnlyBatchedGemvKernelLauncher<QType, WeightOnlyPerChannel, IdentityActivation, false, false, 2, 12,
+            BLOCK_SIZE>::run(params, stream);
+        break;
+    }
+    case 13:
+    {
+        WeightOnlyBatchedGemvKernelLauncher<QType, WeightOnlyPerChannel, IdentityActivation, false, false, 2, 13,
+            BLOCK_SIZE>::run(params, stream);
+        break;
+    }
+    case 14:
+    {
+        WeightOnlyBatchedGemvKernelLauncher<QType, WeightOnlyPerChannel, IdentityActivation, false, false, 2, 14,
+            BLOCK_SIZE>::run(params, stream);
+        break;
+    }
+    case 15:
+    {
+        WeightOnlyBatchedGemvKernelLauncher<QType, WeightOnlyPerChannel, IdentityActivation, false, false, 2, 15,
+            BLOCK_SIZE>::run(params, stream);
+        break;
+    }
+    case 16:
+    {
+        WeightOnlyBatchedGemvKernelLauncher<QType, WeightOnlyPerChannel, IdentityActivation, false, false, 2, 16,
+            BLOCK_SIZE>::run(params, stream);
+        break;
+    }
+    default:
+    {
+        throw std::runtime_error("Weight only cuda kernel only supported bs <= 16 for per-channel weights");
+        break;
+    }
+    }
+}
+
+// Per-channel weights with the SwiGLU gated activation, for 1 to 4 rows. Each block reads the gate and the up weights
+// of one interleaved row, which keeps the register usage of the ungated kernels reading two rows.
+template <WeightOnlyQuantType QType>
+void select_per_channel_swiglu(const WeightOnlyParams& params, cudaStream_t stream)
+{
+    switch (params.m)
+    {
+    case 1:
+    {
+        WeightOnlyBatchedGemvKernelLauncher<QType, WeightOnlyPerChannel, SwiGluActivation, false, false, 1, 1,
+            256>::run(params, stream);
+        break;
+    }
+    case 2:
+    {
+        WeightOnlyBatchedGemvKernelLauncher<QType, WeightOnlyPerChannel, SwiGluActivation, false, false, 1, 2,
+            256>::run(params, stream);
+        break;
+    }
+    case 3:
+    {
+        WeightOnlyBatchedGemvKernelLauncher<QType, WeightOnlyPerChannel, SwiGluActivation, false, false, 1, 3,
+            256>::run(params, stream);
+        break;
+    }
+    case 4:
+    {
+        WeightOnlyBatchedGemvKernelLauncher<QType, WeightOnlyPerChannel, SwiGluActivation, false, false, 1, 4,
+            256>::run(params, stream);
+        break;
+    }
+    default:
+    {
+        throw std::runtime_error("Weight only cuda kernel only supported bs <= 4 for the SwiGLU activation");
+        break;
+    }
+    }
+}
+
 void weight_only_batched_gemv_launcher(const WeightOnlyParams& params, cudaStream_t stream)
 {
+    if (params.act_func_type == WeightOnlyActivationFunctionType::SwiGlu)
+    {
+        assert(params.weight_only_type == WeightOnlyType::PerChannel && params.bias == nullptr
+            && params.zeros == nullptr);
+        if (params.quant_type == WeightOnlyQuantType::Int4b)
+        {
+            select_per_channel_swiglu<WeightOnlyQuantType::Int4b>(params, stream);
+        }
+        else
+        {
+            select_per_channel_swiglu<WeightOnlyQuantType::Int8b>(params, stream);
+        }
+        return;
+    }
+
     assert(params.act_func_type == WeightOnlyActivationFunctionType::Identity);
     assert(params.weight_only_type == WeightOnlyType::GroupWise
         || (params.weight_only_type == WeightOnlyType::PerChannel && params.bias == nullptr
@@ -157,7 +298,7 @@ void weight_only_batched_gemv_launcher(const WeightOnlyParams& params, cudaStrea
             }
             default:
             {
-                throw std::runtime_error("Weight only cuda kernel only supported bs <= 4");
+                select_per_channel_large_batch<WeightOnlyQuantType::Int4b, 128>(params, stream);
                 break;
             }
             }
@@ -192,7 +333,7 @@ void weight_only_batched_gemv_launcher(const WeightOnlyParams& params, cudaStrea
             }
             default:
             {
-                throw std::runtime_error("Weight only cuda kernel only supported bs <= 4");
+                select_per_channel_large_batch<WeightOnlyQuantType::Int8b, 256>(params, stream);
                 break;
             }
             }
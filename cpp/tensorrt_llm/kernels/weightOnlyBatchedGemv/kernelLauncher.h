@@ -20,6 +20,12 @@ namespace tensorrt_llm
 {
 namespace kernels
 {
+// Largest M supported by weight_only_batched_gemv_launcher for per-channel weights. Group-wise weights support M <= 4.
+constexpr int kWeightOnlyBatchedGemvMaxM = 16;
+
+// Per-channel weights with the SwiGLU activation support M <= kWeightOnlyBatchedGemvMaxSwiGluM.
+constexpr int kWeightOnlyBatchedGemvMaxSwiGluM = 4;
+
 void weight_only_batched_gemv_launcher(const WeightOnlyParams& params, cudaStream_t stream);
 }
 } // namespace tensorrt_llm
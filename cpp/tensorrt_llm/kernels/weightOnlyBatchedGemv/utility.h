@@ -78,6 +78,29 @@ struct IdentityActivation
     }
 };
 
+// Gated activation: the weights hold the gate columns followed by as many up columns, and the output is
+// silu(gate) * up. apply is the activation of the gate.
+template <typename T>
+struct SwiGluActivation
+{
+    static __device__ __forceinline__ T apply(const T& val)
+    {
+        return val / (1.0f + __expf(-val));
+    }
+};
+
+template <template <typename T> class ActOp>
+struct IsGatedActivation
+{
+    static constexpr bool value = false;
+};
+
+template <>
+struct IsGatedActivation<SwiGluActivation>
+{
+    static constexpr bool value = true;
+};
+
 template <typename VecType, typename T0, typename T1>
 __device__ __forceinline__ void load(T0* dst, T1* src, size_t offset = 0)
 {
@@ -0,0 +1,376 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/wordsAutomatonKernels.h"
+
+#include <algorithm>
+#include <map>
+#include <queue>
+
+using namespace tensorrt_llm::common;
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+WordsAutomaton WordsAutomatonHost::view(const int* deviceData) const
+{
+    WordsAutomaton automaton;
+    const int* ptr = deviceData;
+    automaton.edgeOffsets = ptr;
+    ptr += numStates + 1;
+    automaton.edgeTokens = ptr;
+    ptr += numEdges;
+    automaton.edgeTargets = ptr;
+    ptr += numEdges;
+    automaton.failures = ptr;
+    ptr += numStates;
+    automaton.matches = ptr;
+    ptr += numStates;
+    automaton.banOffsets = ptr;
+    ptr += numStates + 1;
+    automaton.banTokens = ptr;
+    ptr += numBans;
+    automaton.banLinks = ptr;
+    ptr += numStates;
+    automaton.roots = ptr;
+    automaton.maxDepth = maxDepth;
+    return automaton;
+}
+
+WordsAutomatonHost buildWordsAutomaton(const int* words, int numLists, size_t wordsLen, int batchSize, bool isBadWords)
+{
+    TLLM_CHECK_WITH_INFO(numLists == 1 || numLists == batchSize,
+        "The number of words lists (%d) must be 1 or equal to the batch size (%d).", numLists, batchSize);
+
+    std::vector<std::map<int, int>> children;
+    std::vector<int> depths;
+    std::vector<int> failures;
+    std::vector<int> matches;
+    std::vector<std::vector<int>> bans;
+    std::vector<int> banLinks;
+    auto const addState = [&](int depth)
+    {
+        children.emplace_back();
+        depths.push_back(depth);
+        failures.push_back(0);
+        matches.push_back(0);
+        bans.emplace_back();
+        banLinks.push_back(-1);
+        return static_cast<int>(depths.size()) - 1;
+    };
+
+    std::vector<int> listRoots(numLists);
+    for (int li = 0; li < numLists; ++li)
+    {
+        int const root = addState(0);
+        listRoots[li] = root;
+        failures[root] = root;
+
+        const int* tokens = words + li * 2 * wordsLen;
+        const int* offsets = tokens + wordsLen;
+        for (size_t id = 0; id < wordsLen; ++id)
+        {
+            if (offsets[id] < 0)
+            {
+                continue;
+            }
+            int const itemEnd = offsets[id];
+            int const itemStart = (id > 0) ? offsets[id - 1] : 0;
+            int const itemSize = itemEnd - itemStart;
+            if (itemSize <= 0)
+            {
+                continue;
+            }
+
+            // The trie of bad words only holds the prefix before the banned token
+            int state = root;
+            for (int ti = 0; ti < (isBadWords ? itemSize - 1 : itemSize); ++ti)
+            {
+                int const token = tokens[itemStart + ti];
+                auto const it = children[state].find(token);
+                if (it != children[state].end())
+                {
+                    state = it->second;
+                }
+                else
+                {
+                    int const child = addState(depths[state] + 1);
+                    children[state][token] = child;
+                    state = child;
+                }
+            }
+            if (isBadWords)
+            {
+                bans[state].push_back(tokens[itemEnd - 1]);
+            }
+            else
+            {
+                matches[state] = 1;
+            }
+        }
+
+        // Breadth first, so that the failure of a state is complete before its children are visited
+        std::queue<int> queue;
+        queue.push(root);
+        while (!queue.empty())
+        {
+            int const state = queue.front();
+            queue.pop();
+            for (auto const& [token, child] : children[state])
+            {
+                int failure = root;
+                if (state != root)
+                {
+                    int suffix = failures[state];
+                    while (suffix != root && children[suffix].count(token) == 0)
+                    {
+                        suffix = failures[suffix];
+                    }
+                    auto const it = children[suffix].find(token);
+                    failure = it != children[suffix].end() ? it->second : root;
+                }
+                failures[child] = failure;
+                matches[child] |= matches[failure];
+                banLinks[child] = bans[failure].empty() ? banLinks[failure] : failure;
+                queue.push(child);
+            }
+        }
+    }
+
+    WordsAutomatonHost automaton;
+    automaton.numStates = static_cast<int>(depths.size());
+    automaton.numEdges = 0;
+    automaton.numBans = 0;
+    automaton.batchSize = batchSize;
+    automaton.maxDepth = 0;
+    for (int state = 0; state < automaton.numStates; ++state)
+    {
+        automaton.numEdges += static_cast<int>(children[state].size());
+        automaton.numBans += static_cast<int>(bans[state].size());
+        automaton.maxDepth = std::max(automaton.maxDepth, depths[state]);
+    }
+
+    auto& data = automaton.data;
+    data.reserve(5 * automaton.numStates + 2 + 2 * automaton.numEdges + automaton.numBans + batchSize);
+    data.push_back(0);
+    for (int state = 0; state < automaton.numStates; ++state)
+    {
+        data.push_back(data.back() + static_cast<int>(children[state].size()));
+    }
+    for (int state = 0; state < automaton.numStates; ++state)
+    {
+        for (auto const& edge : children[state])
+        {
+            data.push_back(edge.first);
+        }
+    }
+    for (int state = 0; state < automaton.numStates; ++state)
+    {
+        for (auto const& edge : children[state])
+        {
+            data.push_back(edge.second);
+        }
+    }
+    data.insert(data.end(), failures.begin(), failures.end());
+    data.insert(data.end(), matches.begin(), matches.end());
+    data.push_back(0);
+    for (int state = 0; state < automaton.numStates; ++state)
+    {
+        data.push_back(data.back() + static_cast<int>(bans[state].size()));
+    }
+    for (int state = 0; state < automaton.numStates; ++state)
+    {
+        data.insert(data.end(), bans[state].begin(), bans[state].end());
+    }
+    data.insert(data.end(), banLinks.begin(), banLinks.end());
+    for (int bi = 0; bi < batchSize; ++bi)
+    {
+        data.push_back(listRoots[numLists == 1 ? 0 : bi]);
+    }
+    return automaton;
+}
+
+__device__ int nextWordsAutomatonState(const WordsAutomaton& automaton, int state, int root, int token)
+{
+    while (true)
+    {
+        int lo = automaton.edgeOffsets[state];
+        int const end = automaton.edgeOffsets[state + 1];
+        int hi = end;
+        while (lo < hi)
+        {
+            int const mid = (lo + hi) / 2;
+            if (automaton.edgeTokens[mid] < token)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        if (lo < end && automaton.edgeTokens[lo] == token)
+        {
+            return automaton.edgeTargets[lo];
+        }
+        if (state == root)
+        {
+            return root;
+        }
+        state = automaton.failures[state];
+    }
+}
+
+//! One block per request and one thread per beam. All threads of the block must call it.
+__device__ int advanceWordsAutomaton(const WordsAutomaton& automaton, int* states, int* stateLengths,
+    const int** outputIds, const int** parentIds, const int* sequenceLengths, int beamWidth, int maxSeqLen)
+{
+    const int batchIdx = blockIdx.x;
+    const int beamIdx = threadIdx.x;
+    const bool isBeam = beamIdx < beamWidth;
+    const int index = batchIdx * beamWidth + beamIdx;
+
+    int state = 0;
+    int length = 0;
+    if (isBeam)
+    {
+        const int root = automaton.roots[batchIdx];
+        const int* ids = outputIds[batchIdx] + beamIdx * maxSeqLen;
+        length = sequenceLengths[index];
+        if (stateLengths[index] == length)
+        {
+            state = states[index];
+        }
+        else
+        {
+            int parentIndex = index;
+            if (beamWidth > 1 && length > 0)
+            {
+                const int parentId
+                    = parentIds == nullptr ? 0 : parentIds[batchIdx][beamIdx * maxSeqLen + length - 1];
+                parentIndex = (parentId >= 0 && parentId < beamWidth) ? batchIdx * beamWidth + parentId : -1;
+            }
+            if (length > 0 && parentIndex >= 0 && stateLengths[parentIndex] == length - 1)
+            {
+                state = nextWordsAutomatonState(automaton, states[parentIndex], root, ids[length - 1]);
+            }
+            else
+            {
+                // No state to continue from, the state only depends on the last maxDepth tokens
+                state = root;
+                for (int pos = max(0, length - automaton.maxDepth); pos < length; ++pos)
+                {
+                    state = nextWordsAutomatonState(automaton, state, root, ids[pos]);
+                }
+            }
+        }
+    }
+    // The beams read the states of their parents before they are overwritten
+    __syncthreads();
+    if (isBeam)
+    {
+        states[index] = state;
+        stateLengths[index] = length;
+    }
+    return state;
+}
+
+template <typename T>
+__global__ void banBadWordsAutomaton(T* logits, const WordsAutomaton automaton, int* states, int* stateLengths,
+    const int** outputIds, const int** parentIds, const int* sequenceLengths, int beamWidth, int vocabSizePadded,
+    int maxSeqLen)
+{
+    const int state = advanceWordsAutomaton(
+        automaton, states, stateLengths, outputIds, parentIds, sequenceLengths, beamWidth, maxSeqLen);
+    if (threadIdx.x >= beamWidth)
+    {
+        return;
+    }
+
+    T* beamLogits = logits + static_cast<size_t>(blockIdx.x * beamWidth + threadIdx.x) * vocabSizePadded;
+    int banState = automaton.banOffsets[state] < automaton.banOffsets[state + 1] ? state : automaton.banLinks[state];
+    for (; banState >= 0; banState = automaton.banLinks[banState])
+    {
+        for (int bi = automaton.banOffsets[banState]; bi < automaton.banOffsets[banState + 1]; ++bi)
+        {
+            const int bannedToken = automaton.banTokens[bi];
+            if (0 < bannedToken && bannedToken < vocabSizePadded)
+            {
+                beamLogits[bannedToken] = static_cast<T>(-INFINITY);
+            }
+        }
+    }
+}
+
+__global__ void stopWordsAutomatonCriterion(const WordsAutomaton automaton, int* states, int* stateLengths,
+    const int** outputIds, const int** parentIds, FinishedState* finished, const int* sequenceLengths, int beamWidth,
+    int maxSeqLen)
+{
+    const int state = advanceWordsAutomaton(
+        automaton, states, stateLengths, outputIds, parentIds, sequenceLengths, beamWidth, maxSeqLen);
+    if (threadIdx.x < beamWidth && automaton.matches[state])
+    {
+        finished[blockIdx.x * beamWidth + threadIdx.x].setFinishedStopWords();
+    }
+}
+
+namespace
+{
+dim3 wordsAutomatonBlock(int beamWidth)
+{
+    constexpr int maxBlockSize{1024};
+    TLLM_CHECK_WITH_INFO(beamWidth <= maxBlockSize, "Beam width %d is larger than %d.", beamWidth, maxBlockSize);
+    return dim3(((beamWidth + 32 - 1) / 32) * 32);
+}
+} // namespace
+
+template <typename T>
+void invokeBanBadWordsAutomaton(T* logits, const WordsAutomaton& automaton, int* states, int* stateLengths,
+    const int** outputIds, const int** parentIds, const int* sequenceLengths, int batchSize, int beamWidth,
+    int vocabSizePadded, int maxSeqLen, cudaStream_t stream)
+{
+    banBadWordsAutomaton<<<batchSize, wordsAutomatonBlock(beamWidth), 0, stream>>>(logits, automaton, states,
+        stateLengths, outputIds, parentIds, sequenceLengths, beamWidth, vocabSizePadded, maxSeqLen);
+    sync_check_cuda_error();
+}
+
+template void invokeBanBadWordsAutomaton(float* logits, const WordsAutomaton& automaton, int* states,
+    int* stateLengths, const int** outputIds, const int** parentIds, const int* sequenceLengths, int batchSize,
+    int beamWidth, int vocabSizePadded, int maxSeqLen, cudaStream_t stream);
+template void invokeBanBadWordsAutomaton(half* logits, const WordsAutomaton& automaton, int* states,
+    int* stateLengths, const int** outputIds, const int** parentIds, const int* sequenceLengths, int batchSize,
+    int beamWidth, int vocabSizePadded, int maxSeqLen, cudaStream_t stream);
+#ifdef ENABLE_BF16
+template void invokeBanBadWordsAutomaton(__nv_bfloat16* logits, const WordsAutomaton& automaton, int* states,
+    int* stateLengths, const int** outputIds, const int** parentIds, const int* sequenceLengths, int batchSize,
+    int beamWidth, int vocabSizePadded, int maxSeqLen, cudaStream_t stream);
+#endif
+
+void invokeStopWordsAutomatonCriterion(const WordsAutomaton& automaton, int* states, int* stateLengths,
+    const int** outputIds, const int** parentIds, FinishedState* finished, const int* sequenceLengths, int batchSize,
+    int beamWidth, int maxSeqLen, cudaStream_t stream)
+{
+    stopWordsAutomatonCriterion<<<batchSize, wordsAutomatonBlock(beamWidth), 0, stream>>>(
+        automaton, states, stateLengths, outputIds, parentIds, finished, sequenceLengths, beamWidth, maxSeqLen);
+    sync_check_cuda_error();
+}
+
+} // namespace kernels
+} // namespace tensorrt_llm
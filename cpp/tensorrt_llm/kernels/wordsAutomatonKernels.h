@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/kernels/decodingCommon.h"
+#include <cuda_runtime.h>
+#include <vector>
+
+namespace tensorrt_llm
+{
+namespace kernels
+{
+
+//! \brief Aho-Corasick automaton over the stop words or bad words of a batch, with one trie per request.
+//! All arrays are indexed by the global state id, the tries of the requests are stored one after another.
+//! For stop words the trie holds the words, for bad words it holds the words without their last token, which is
+//! banned whenever the prefix before it is a suffix of the sequence.
+struct WordsAutomaton
+{
+    const int* edgeOffsets;  // [numStates + 1], edges of a state, sorted by token
+    const int* edgeTokens;   // [numEdges]
+    const int* edgeTargets;  // [numEdges]
+    const int* failures;     // [numStates], longest proper suffix of a state in the trie, the root for a root
+    const int* matches;      // [numStates], 1 if a stop word is a suffix of the state
+    const int* banOffsets;   // [numStates + 1], tokens banned by the bad words ending at a state
+    const int* banTokens;    // [numBans]
+    const int* banLinks;     // [numStates], closest proper suffix of a state that bans tokens, -1 if none
+    const int* roots;        // [batchSize], root state of each request
+    int maxDepth;            // depth of the deepest state
+};
+
+//! \brief Host side copy of a WordsAutomaton. All arrays are packed into data, in the order of the WordsAutomaton
+//! members, so that they can be uploaded with a single copy.
+struct WordsAutomatonHost
+{
+    std::vector<int> data;
+    int numStates;
+    int numEdges;
+    int numBans;
+    int batchSize;
+    int maxDepth;
+
+    //! \brief Returns the automaton with its arrays pointing into deviceData, a device copy of data.
+    WordsAutomaton view(const int* deviceData) const;
+};
+
+//! \brief Compiles a words list into an automaton.
+//!
+//! \param words host buffer [numLists, 2, wordsLen]. For each list the first row is the token ids of the words and
+//! the second row is the inclusive prefix sum of the word lengths, padded with -1.
+//! \param numLists number of words lists, 1 if all requests share the same list
+//! \param wordsLen cumulative length of all words of a list
+//! \param batchSize batch size. The requests use list bi or list 0 if numLists is 1
+//! \param isBadWords build a bad words automaton instead of a stop words one
+WordsAutomatonHost buildWordsAutomaton(const int* words, int numLists, size_t wordsLen, int batchSize, bool isBadWords);
+
+//! \brief Moves the automaton state of each beam to the end of its sequence and bans the tokens that complete a bad
+//! word, by setting their logits to -INFINITY. Equivalent to invokeBanBadWords.
+//! The states are tracked across steps together with the sequence lengths they belong to. A beam that got one new
+//! token since the last call takes one transition from the state of its parent, a beam without a state for its
+//! length, e.g. at the first step, walks the last maxDepth tokens of its sequence.
+//!
+//! \param logits input/output buffer [batchSize, beamWidth, vocabSizePadded]
+//! \param automaton bad words automaton
+//! \param states input/output buffer [batchSize, beamWidth]. Automaton state of each beam
+//! \param stateLengths input/output buffer [batchSize, beamWidth]. Sequence length the states belong to, -1 if unknown
+//! \param outputIds input buffer [batchSize][beamWidth, maxSeqLen]. Contains pointers to rows with output tokens
+//! \param parentIds input buffer [batchSize][beamWidth, maxSeqLen]. Contains pointers to rows with parent ids.
+//! Applicable when beamWidth > 1
+//! \param sequenceLengths input buffer [batchSize, beamWidth]. Current sequence lengths
+//! \param batchSize batch size
+//! \param beamWidth beam width
+//! \param vocabSizePadded padded vocab size
+//! \param maxSeqLen maximum length of the sequence
+//! \param stream stream
+template <typename T>
+void invokeBanBadWordsAutomaton(T* logits, const WordsAutomaton& automaton, int* states, int* stateLengths,
+    const int** outputIds, const int** parentIds, const int* sequenceLengths, int batchSize, int beamWidth,
+    int vocabSizePadded, int maxSeqLen, cudaStream_t stream);
+
+//! \brief Moves the automaton state of each beam to the end of its sequence, as invokeBanBadWordsAutomaton does, and
+//! sets the finished state to FinishedState::FINISHED_STOP_WORDS if the sequence ends with a stop word.
+//! Equivalent to invokeStopWordsCriterion.
+//!
+//! \param automaton stop words automaton
+//! \param states input/output buffer [batchSize, beamWidth]. Automaton state of each beam
+//! \param stateLengths input/output buffer [batchSize, beamWidth]. Sequence length the states belong to, -1 if unknown
+//! \param outputIds input buffer [batchSize][beamWidth, maxSeqLen]. Contains pointers to rows with output tokens
+//! \param parentIds input buffer [batchSize][beamWidth, maxSeqLen]. Contains pointers to rows with parent ids.
+//! Applicable when beamWidth > 1
+//! \param finished input/output buffer [batchSize, beamWidth]. Finished states
+//! \param sequenceLengths input buffer [batchSize, beamWidth]. Current sequence lengths
+//! \param batchSize batch size
+//! \param beamWidth beam width
+//! \param maxSeqLen maximum length of the sequence
+//! \param stream stream
+void invokeStopWordsAutomatonCriterion(const WordsAutomaton& automaton, int* states, int* stateLengths,
+    const int** outputIds, const int** parentIds, FinishedState* finished, const int* sequenceLengths, int batchSize,
+    int beamWidth, int maxSeqLen, cudaStream_t stream);
+
+} // namespace kernels
+} // namespace tensorrt_llm
@@ -73,6 +73,46 @@ void update_indir_cache_kernelLauncher(int* tgt_indir_cache, const int* src_indi
         sequence_lengths, input_lengths, batch_dim, local_batch_size, beam_width, max_attention_window, max_seq_len);
 }
 
+// The block cache indirection of the paged KV cache has 1 + tokens_per_block entries per beam: the beam whose blocks
+// hold the tokens before the current block, then the beam whose cache holds each token of the current block. A beam
+// takes the entries of its parent and reads the token of the current step from its own cache. The KV cache manager
+// rebases the entries onto the beams' own blocks whenever a block is complete, so the entries never span two blocks.
+__global__ void update_block_indir_cache_kernel(int* tgt_indir_cache, const int* src_indir_cache,
+    const int** parent_ids, const FinishedState* finished, const int* sequence_lengths, int local_batch_size,
+    int beam_width, int tokens_per_block, int max_seq_len)
+{
+    const int bb_id = blockIdx.x;
+    if (bb_id >= beam_width * local_batch_size)
+    {
+        return;
+    }
+    const int current_step{sequence_lengths[bb_id] - 1}; // the sequence_lengths is updated, need to minus 1
+    const int batch_id = bb_id / beam_width;
+    const int beam_id = bb_id % beam_width;
+    const int indir_len = tokens_per_block + 1;
+    // Finished beams keep their entries.
+    const bool is_finished = finished[bb_id].isFinished();
+    const int src_beam = is_finished ? beam_id : parent_ids[batch_id][beam_id * max_seq_len + current_step];
+    const int current_idx = 1 + current_step % tokens_per_block;
+
+    int* tgt = tgt_indir_cache + static_cast<std::size_t>(bb_id) * indir_len;
+    const int* src = src_indir_cache + static_cast<std::size_t>(batch_id * beam_width + src_beam) * indir_len;
+    for (int idx = threadIdx.x; idx < indir_len; idx += blockDim.x)
+    {
+        tgt[idx] = (idx == current_idx && !is_finished) ? beam_id : src[idx];
+    }
+}
+
+void update_block_indir_cache_kernelLauncher(int* tgt_indir_cache, const int* src_indir_cache, const int** parent_ids,
+    const FinishedState* finished, const int* sequence_lengths, int local_batch_size, int beam_width,
+    int tokens_per_block, int max_seq_len, cudaStream_t stream)
+{
+    const dim3 block(std::min(tokens_per_block + 1, 256));
+    const dim3 grid(local_batch_size * beam_width);
+    update_block_indir_cache_kernel<<<grid, block, 0, stream>>>(tgt_indir_cache, src_indir_cache, parent_ids, finished,
+        sequence_lengths, local_batch_size, beam_width, tokens_per_block, max_seq_len);
+}
+
 template <typename T>
 BaseBeamSearchLayer<T>::BaseBeamSearchLayer(size_t vocab_size, size_t vocab_size_padded, cudaStream_t stream,
     std::shared_ptr<IAllocator> allocator, bool is_free_buffer_after_forward)
@@ -192,7 +232,19 @@ void BaseBeamSearchLayer<T>::forward(BeamSearchOutputParams& outputs, ForwardPar
 
     invokeSoftMax(outputs, params);
 
-    if (beam_width > 1)
+    // The block cache indirection is shorter than the attention window, which spans more than one block with it.
+    const auto indir_len = static_cast<std::int32_t>(outputs.tgt_cache_indirection.shape[2]);
+    if (beam_width > 1 && indir_len < params.max_attention_window)
+    {
+        update_block_indir_cache_kernelLauncher(outputs.tgt_cache_indirection.template getPtr<int>(),
+            params.src_cache_indirection.template getPtr<const int>(),
+            outputs.parent_ids_ptr.template getPtr<const int*>(),
+            reinterpret_cast<const FinishedState*>(
+                outputs.finished->template getPtr<const FinishedState::UnderlyingType>()),
+            sequence_length, local_batch_size, beam_width, indir_len - 1, max_seq_len, stream_);
+        sync_check_cuda_error();
+    }
+    else if (beam_width > 1)
     {
         update_indir_cache_kernelLauncher(outputs.tgt_cache_indirection.template getPtr<int>(),
             params.src_cache_indirection.template getPtr<const int>(),
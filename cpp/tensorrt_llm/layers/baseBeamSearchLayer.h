@@ -67,7 +67,9 @@ public:
         // mandatory parameters
         int max_attention_window;
         int max_seq_len;
-        tc::Tensor src_cache_indirection; // [local_batch_size, beam_width, max_seq_len]
+        tc::Tensor src_cache_indirection; // [local_batch_size, beam_width, max_seq_len], or
+                                          // [local_batch_size, beam_width, 1 + tokens_per_block] for the block
+                                          // cache indirection of the paged KV cache
 
         // optional parameters
         std::optional<tc::Tensor> embedding_bias; // [vocab_size_padded]
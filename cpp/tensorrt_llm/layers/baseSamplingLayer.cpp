@@ -17,6 +17,7 @@
 
 #include "tensorrt_llm/layers/baseSamplingLayer.h"
 #include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/envUtils.h"
 #include "tensorrt_llm/common/memoryUtils.h"
 #include "tensorrt_llm/kernels/samplingPenaltyKernels.h"
 #include "tensorrt_llm/kernels/samplingTopKKernels.h"
@@ -34,7 +35,10 @@ template <typename T>
 void BaseSamplingLayer<T>::allocateBuffer(size_t batch_size)
 {
     TLLM_LOG_TRACE(__PRETTY_FUNCTION__);
-    curandstate_buf_ = allocator_->reMalloc(curandstate_buf_, sizeof(curandState_t) * batch_size, false);
+    if (!counter_based_rng_)
+    {
+        curandstate_buf_ = allocator_->reMalloc(curandstate_buf_, sizeof(curandState_t) * batch_size, false);
+    }
     random_seeds_buf_ = allocator_->reMalloc(random_seeds_buf_, sizeof(uint64_t) * batch_size, false);
     temperature_buf_ = allocator_->reMalloc(temperature_buf_, sizeof(float) * batch_size, false);
     repetition_penalty_buf_ = allocator_->reMalloc(repetition_penalty_buf_, sizeof(float) * batch_size, false);
@@ -57,7 +61,10 @@ void BaseSamplingLayer<T>::freeBuffer()
     TLLM_LOG_TRACE(__PRETTY_FUNCTION__);
     if (is_allocate_buffer_)
     {
-        allocator_->free((void**) (&curandstate_buf_));
+        if (curandstate_buf_ != nullptr)
+        {
+            allocator_->free((void**) (&curandstate_buf_));
+        }
         allocator_->free((void**) (&random_seeds_buf_));
         allocator_->free((void**) (&temperature_buf_));
         allocator_->free((void**) (&repetition_penalty_buf_));
@@ -66,6 +73,11 @@ void BaseSamplingLayer<T>::freeBuffer()
         allocator_->free((void**) (&min_lengths_buf_));
         allocator_->free((void**) (&runtime_logits_buf_));
         allocator_->free((void**) (&skip_decode_buf_));
+        if (token_histograms_buf_ != nullptr)
+        {
+            allocator_->free((void**) (&token_histograms_buf_));
+            token_histograms_reset_all_ = true;
+        }
         std::free(skip_decode_);
         is_allocate_buffer_ = false;
     }
@@ -77,6 +89,7 @@ BaseSamplingLayer<T>::BaseSamplingLayer(size_t vocab_size, size_t vocab_size_pad
     : BaseLayer(stream, std::move(allocator), is_free_buffer_after_forward, cuda_device_prop)
     , vocab_size_(vocab_size)
     , vocab_size_padded_(vocab_size_padded)
+    , counter_based_rng_(getEnvCounterBasedRng())
 {
 }
 
@@ -86,6 +99,7 @@ BaseSamplingLayer<T>::BaseSamplingLayer(BaseSamplingLayer const& sampling_layer)
     , vocab_size_(sampling_layer.vocab_size_)
     , vocab_size_padded_(sampling_layer.vocab_size_padded_)
     , sampling_workspace_size_(sampling_layer.sampling_workspace_size_)
+    , counter_based_rng_(sampling_layer.counter_based_rng_)
 {
 }
 
@@ -105,7 +119,53 @@ void BaseSamplingLayer<T>::setupBase(const size_t batch_size, SetupParams const&
     // [batch_size] random seeds, initializing the random table by different
     // random seeds respectively. If no random seed, initialize the random table
     // of all sentences by 0 directly.
-    if (setupParams.randomSeed)
+    if (counter_based_rng_)
+    {
+        // The random numbers are computed from the seeds, there are no states to initialize
+        auto const& randomSeed = setupParams.randomSeed;
+        TLLM_CHECK_WITH_INFO(!randomSeed || randomSeed->size() == 1 || randomSeed->size() == batch_size,
+            "Random seed vector size mismatch.");
+        mRandomSeeds.resize(batch_size, 0);
+        auto setSeed = [&randomSeed, this](size_t slot)
+        {
+            mRandomSeeds[slot]
+                = !randomSeed ? 0 : (randomSeed->size() == 1 ? randomSeed->front() : randomSeed->at(slot));
+        };
+        if (setupParams.random_seed_slots)
+        {
+            for (auto const slot : setupParams.random_seed_slots.value())
+            {
+                TLLM_CHECK(0 <= slot && static_cast<size_t>(slot) < batch_size);
+                setSeed(slot);
+                token_histograms_reset_slots_.push_back(slot);
+            }
+        }
+        else
+        {
+            for (size_t slot = 0; slot < batch_size; ++slot)
+            {
+                setSeed(slot);
+            }
+        }
+        cudaAutoCpy(random_seeds_buf_, mRandomSeeds.data(), batch_size, stream_);
+    }
+    else if (setupParams.random_seed_slots)
+    {
+        // Only the listed requests are (re)started, the random states of the others keep advancing.
+        auto const& randomSeed = setupParams.randomSeed;
+        TLLM_CHECK_WITH_INFO(!randomSeed || randomSeed->size() == 1 || randomSeed->size() == batch_size,
+            "Random seed vector size mismatch.");
+        for (auto const slot : setupParams.random_seed_slots.value())
+        {
+            TLLM_CHECK(0 <= slot && static_cast<size_t>(slot) < batch_size);
+            uint64_t const seed
+                = !randomSeed ? 0 : (randomSeed->size() == 1 ? randomSeed->front() : randomSeed->at(slot));
+            invokeCurandInitialize(curandstate_buf_ + slot, 1, seed, stream_);
+            token_histograms_reset_slots_.push_back(slot);
+        }
+        sync_check_cuda_error();
+    }
+    else if (setupParams.randomSeed)
     {
         if (setupParams.randomSeed->size() == 1)
         {
@@ -125,6 +185,10 @@ void BaseSamplingLayer<T>::setupBase(const size_t batch_size, SetupParams const&
         // Initialize curand states using the default seed 0.
         invokeCurandInitialize(curandstate_buf_, batch_size, 0, stream_);
     }
+    if (!setupParams.random_seed_slots)
+    {
+        token_histograms_reset_all_ = true;
+    }
 
     // Setup penalties.
     auto fillBuffers
@@ -147,6 +211,30 @@ void BaseSamplingLayer<T>::setupBase(const size_t batch_size, SetupParams const&
         cudaAutoCpy(deviceBuffer, hostBuffer.data(), batch_size, stream_);
     };
 
+    // Sampling modes, only kept on the host.
+    auto fillHostBuffer = [&batch_size](auto const& optParam, auto const defaultValue, auto& hostBuffer)
+    {
+        hostBuffer.assign(batch_size, defaultValue);
+        if (optParam && optParam->size() == 1)
+        {
+            std::fill(std::begin(hostBuffer), std::end(hostBuffer), optParam->front());
+        }
+        else if (optParam)
+        {
+            TLLM_CHECK_WITH_INFO(optParam->size() == batch_size, "Argument vector size mismatch.");
+            std::copy(optParam->begin(), optParam->end(), std::begin(hostBuffer));
+        }
+    };
+    fillHostBuffer(setupParams.runtime_min_p, 0.0f, mMinP);
+    fillHostBuffer(setupParams.runtime_typical_p, 1.0f, mTypicalP);
+    for (size_t bi = 0; bi < batch_size; ++bi)
+    {
+        TLLM_CHECK_WITH_INFO(0.0f <= mMinP[bi] && mMinP[bi] <= 1.0f,
+            "min_p (%f) of request %lu is out of range [0.0, 1.0].", mMinP[bi], bi);
+        TLLM_CHECK_WITH_INFO(0.0f < mTypicalP[bi] && mTypicalP[bi] <= 1.0f,
+            "typical_p (%f) of request %lu is out of range (0.0, 1.0].", mTypicalP[bi], bi);
+    }
+
     fillBuffers(setupParams.temperature, 1.0f, mTemperature, temperature_buf_);
     fillBuffers(setupParams.min_length, 0, mMinLengths, min_lengths_buf_);
 
@@ -170,6 +258,25 @@ void BaseSamplingLayer<T>::setupBase(const size_t batch_size, SetupParams const&
     }
 }
 
+template <typename T>
+void BaseSamplingLayer<T>::skipMinPAndTypicalRequests(size_t batch_size)
+{
+    TLLM_LOG_TRACE(__PRETTY_FUNCTION__);
+    bool skipped = false;
+    for (size_t bi = 0; bi < batch_size; ++bi)
+    {
+        if (!skip_decode_[bi] && (isTypicalRequest(bi) || isMinPRequest(bi)))
+        {
+            skip_decode_[bi] = true;
+            skipped = true;
+        }
+    }
+    if (skipped)
+    {
+        cudaAutoCpy(skip_decode_buf_, skip_decode_, batch_size, stream_);
+    }
+}
+
 template <typename T>
 void BaseSamplingLayer<T>::forward(DecodingOutputParams& outputs, ForwardParams const& params)
 {
@@ -204,8 +311,9 @@ void BaseSamplingLayer<T>::forward(DecodingOutputParams& outputs, ForwardParams
     }
 
     auto* embedding_bias = params.embedding_bias ? params.embedding_bias->template getPtr<T const>() : nullptr;
-    if (embedding_bias != nullptr
-        || !ALL_OF(std::begin(mTemperature) + ite * local_batch_size, local_batch_size, float, 1.0f))
+    if (!isTemperatureFused()
+        && (embedding_bias != nullptr
+            || !ALL_OF(std::begin(mTemperature) + ite * local_batch_size, local_batch_size, float, 1.0f)))
     {
         invokeBatchApplyTemperaturePenalty(logits, embedding_bias, temperature_buf_ + ite * local_batch_size,
             local_batch_size, vocab_size_, vocab_size_padded_, stream_);
@@ -224,7 +332,16 @@ void BaseSamplingLayer<T>::forward(DecodingOutputParams& outputs, ForwardParams
             && (!ALL_OF(std::begin(mFrequencyPenalty) + ite * local_batch_size, local_batch_size, float,
                 getDefaultPenaltyValue(RepetitionPenaltyType::Frequency)));
 
-        if (use_repetition || use_presence || use_frequency)
+        if ((use_repetition || use_presence || use_frequency) && getEnvPenaltyHistograms())
+        {
+            updateTokenHistograms(outputs, batch_size, params.max_seq_len);
+            invokeBatchApplyRepetitionPenaltyFromHistograms(logits, repetition_penalty_buf_ + ite * local_batch_size,
+                presence_penalty_buf_ + ite * local_batch_size, frequency_penalty_buf_ + ite * local_batch_size,
+                use_repetition, use_presence, use_frequency, TokenHistograms(token_histograms_buf_, params.max_seq_len),
+                batch_size, vocab_size_padded_, stream_);
+            sync_check_cuda_error();
+        }
+        else if (use_repetition || use_presence || use_frequency)
         {
             invokeBatchApplyRepetitionPenalty(logits, repetition_penalty_buf_ + ite * local_batch_size,
                 presence_penalty_buf_ + ite * local_batch_size, frequency_penalty_buf_ + ite * local_batch_size,
@@ -251,6 +368,42 @@ void BaseSamplingLayer<T>::forward(DecodingOutputParams& outputs, ForwardParams
     TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
 }
 
+template <typename T>
+void BaseSamplingLayer<T>::updateTokenHistograms(DecodingOutputParams& outputs, size_t batch_size, int max_seq_len)
+{
+    TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+    if (token_histograms_buf_ == nullptr || token_histograms_batch_size_ != batch_size
+        || token_histograms_max_seq_len_ != max_seq_len)
+    {
+        token_histograms_buf_ = allocator_->reMalloc(
+            token_histograms_buf_, TokenHistograms::getSize(batch_size, max_seq_len), false);
+        token_histograms_batch_size_ = batch_size;
+        token_histograms_max_seq_len_ = max_seq_len;
+        token_histograms_reset_all_ = true;
+    }
+
+    // The histograms of restarted requests are rebuilt from their whole sequences by the update
+    TokenHistograms const histograms(token_histograms_buf_, max_seq_len);
+    if (token_histograms_reset_all_)
+    {
+        invokeResetTokenHistograms(histograms, 0, batch_size, stream_);
+    }
+    else
+    {
+        for (auto const slot : token_histograms_reset_slots_)
+        {
+            invokeResetTokenHistograms(histograms, slot, 1, stream_);
+        }
+    }
+    token_histograms_reset_all_ = false;
+    token_histograms_reset_slots_.clear();
+
+    invokeUpdateTokenHistograms(histograms, outputs.output_ids_ptr.template getPtr<const int*>(),
+        outputs.sequence_length->getPtr<const int>(), batch_size, vocab_size_padded_, stream_);
+    sync_check_cuda_error();
+    TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
+}
+
 template class BaseSamplingLayer<float>;
 template class BaseSamplingLayer<half>;
 
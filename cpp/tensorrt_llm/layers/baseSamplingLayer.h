@@ -46,12 +46,15 @@ public:
     class SetupParams : public DecodingSetupParams
     {
     public:
-        std::optional<std::vector<std::uint32_t>> runtime_top_k;  // [1] or [batch_size] on cpu
-        std::optional<std::vector<float>> runtime_top_p;          // [1] or [batch_size] on cpu
-        std::optional<std::vector<uint64_t>> randomSeed;          // [1] or [batch_size] on cpu
-        std::optional<std::vector<float>> top_p_decay;            // [batch_size], must between [0, 1]
-        std::optional<std::vector<float>> top_p_min;              // [batch_size], must between [0, 1]
-        std::optional<std::vector<std::int32_t>> top_p_reset_ids; // [batch_size]
+        std::optional<std::vector<std::uint32_t>> runtime_top_k;    // [1] or [batch_size] on cpu
+        std::optional<std::vector<float>> runtime_top_p;            // [1] or [batch_size] on cpu
+        std::optional<std::vector<uint64_t>> randomSeed;            // [1] or [batch_size] on cpu
+        std::optional<std::vector<std::int32_t>> random_seed_slots; // [n] on cpu, only these random states are reset
+        std::optional<std::vector<float>> top_p_decay;              // [batch_size], must between [0, 1]
+        std::optional<std::vector<float>> top_p_min;                // [batch_size], must between [0, 1]
+        std::optional<std::vector<std::int32_t>> top_p_reset_ids;   // [batch_size]
+        std::optional<std::vector<float>> runtime_min_p;            // [1] or [batch_size] on cpu, must between [0, 1]
+        std::optional<std::vector<float>> runtime_typical_p;        // [1] or [batch_size] on cpu, must between (0, 1]
         std::optional<bool> normalize_log_probs;
     };
 
@@ -93,11 +96,14 @@ protected:
     bool* skip_decode_buf_ = nullptr;
     T* runtime_logits_buf_ = nullptr;
 
+    std::vector<uint64_t> mRandomSeeds;
     std::vector<float> mTemperature;
     std::vector<float> mRepetitionPenalty;
     std::vector<float> mPresencePenalty;
     std::vector<float> mFrequencyPenalty;
     std::vector<int32_t> mMinLengths;
+    std::vector<float> mMinP;
+    std::vector<float> mTypicalP;
     bool* skip_decode_ = nullptr;
     bool skip_any_ = false;
 
@@ -105,6 +111,51 @@ protected:
     bool use_presence_penalty_ = false;
     bool use_frequency_penalty_ = false;
 
+    // Token histograms of the sequences, used instead of scanning the sequences when getEnvPenaltyHistograms is set
+    int* token_histograms_buf_ = nullptr;
+    size_t token_histograms_batch_size_ = 0;
+    int token_histograms_max_seq_len_ = 0;
+    bool token_histograms_reset_all_ = true;
+    std::vector<int32_t> token_histograms_reset_slots_; // requests restarted since the last update
+
+    // Counter-based random numbers keyed on the seed and the token position, see drawSamplingUniform. The curand
+    // states are neither allocated nor initialized
+    bool counter_based_rng_ = false;
+
+    curandState_t* getCurandStates(size_t offset) const
+    {
+        return counter_based_rng_ ? nullptr : curandstate_buf_ + offset;
+    }
+
+    uint64_t const* getRandomSeeds(size_t offset) const
+    {
+        return counter_based_rng_ ? random_seeds_buf_ + offset : nullptr;
+    }
+
+    // A request with typical P below 1 is sampled by TypicalSamplingLayer, otherwise a request with min P above 0 is
+    // sampled by MinPSamplingLayer. Both take precedence over top-K and top-P
+    bool isTypicalRequest(size_t slot) const
+    {
+        return mTypicalP[slot] < 1.0f;
+    }
+
+    bool isMinPRequest(size_t slot) const
+    {
+        return !isTypicalRequest(slot) && mMinP[slot] > 0.0f;
+    }
+
+    // Called by the top-K and top-P layers at the end of their setup
+    void skipMinPAndTypicalRequests(size_t batch_size);
+
+    // Set by layers whose sampling kernel applies the embedding bias and temperature itself
+    bool fuse_temperature_ = false;
+
+    // The penalties are applied to the scaled logits, so they prevent fusing the temperature into the sampling
+    bool isTemperatureFused() const
+    {
+        return fuse_temperature_ && !use_repetition_penalty_ && !use_presence_penalty_ && !use_frequency_penalty_;
+    }
+
     virtual void runSampling(DecodingOutputParams& outputs, DecodingParams const& params) = 0;
 
     virtual void freeBuffer();
@@ -113,6 +164,7 @@ protected:
 private:
     void allocateBuffer(size_t batch_size);
     bool isValidBatchSize(size_t batch_size);
+    void updateTokenHistograms(DecodingOutputParams& outputs, size_t batch_size, int max_seq_len);
 };
 
 } // namespace layers
@@ -15,10 +15,13 @@
  */
 
 #include "tensorrt_llm/layers/dynamicDecodeLayer.h"
+#include "tensorrt_llm/common/envUtils.h"
 #include "tensorrt_llm/kernels/banBadWords.h"
 #include "tensorrt_llm/kernels/banRepeatNgram.h"
 #include "tensorrt_llm/kernels/decodingKernels.h"
+#include "tensorrt_llm/kernels/logitsBitmask.h"
 #include "tensorrt_llm/kernels/stopCriteriaKernels.h"
+#include "tensorrt_llm/kernels/wordsAutomatonKernels.h"
 #include "tensorrt_llm/layers/baseBeamSearchLayer.h"
 #include "tensorrt_llm/layers/onlineBeamSearchLayer.h"
 #include "tensorrt_llm/layers/topKSamplingLayer.h"
@@ -47,6 +50,19 @@ void DynamicDecodeLayer<T>::initialize()
     mTopPDecode = std::make_unique<TopPSamplingLayer<T>>(
         vocab_size_, vocab_size_padded_, stream_, allocator_, false, cuda_device_prop_);
 
+    if (getEnvFusedSampling())
+    {
+        mFusedSamplingDecode
+            = std::make_unique<FusedSamplingLayer<T>>(vocab_size_, vocab_size_padded_, stream_, allocator_, false);
+    }
+
+    mMinPDecode = std::make_unique<MinPSamplingLayer<T>>(vocab_size_, vocab_size_padded_, stream_, allocator_, false);
+    mTypicalDecode
+        = std::make_unique<TypicalSamplingLayer<T>>(vocab_size_, vocab_size_padded_, stream_, allocator_, false);
+
+    use_words_automaton_ = getEnvWordsAutomaton();
+    use_ngram_index_ = getEnvNgramIndex();
+
     mIdsPtrHost = runtime::BufferManager::pinned(ITensor::makeShape({}), runtime::TRTDataType<int*>::value);
 }
 
@@ -119,6 +135,20 @@ void DynamicDecodeLayer<T>::setup(size_t batch_size, size_t beam_width, SetupPar
 {
     TLLM_LOG_TRACE(__PRETTY_FUNCTION__);
 
+    // A new setup starts new requests, which may come with new words lists
+    mBadWordsAutomaton.stale = true;
+    mStopWordsAutomaton.stale = true;
+    // The n-gram indices of the started requests are rebuilt from their whole sequences
+    if (setupParams.random_seed_slots)
+    {
+        auto const& slots = setupParams.random_seed_slots.value();
+        mNgramIndex.reset_slots.insert(mNgramIndex.reset_slots.end(), slots.begin(), slots.end());
+    }
+    else
+    {
+        mNgramIndex.reset_all = true;
+    }
+
     if (beam_width == 1)
     { // sampling layers
         typename TopPSamplingLayer<T>::SetupParams samplingParams;
@@ -132,14 +162,31 @@ void DynamicDecodeLayer<T>::setup(size_t batch_size, size_t beam_width, SetupPar
         samplingParams.runtime_top_k = setupParams.runtime_top_k;
         samplingParams.runtime_top_p = setupParams.runtime_top_p;
         samplingParams.randomSeed = setupParams.randomSeed;
+        samplingParams.random_seed_slots = setupParams.random_seed_slots;
 
         samplingParams.top_p_decay = setupParams.top_p_decay;
         samplingParams.top_p_min = setupParams.top_p_min;
         samplingParams.top_p_reset_ids = setupParams.top_p_reset_ids;
+        samplingParams.runtime_min_p = setupParams.runtime_min_p;
+        samplingParams.runtime_typical_p = setupParams.runtime_typical_p;
         samplingParams.normalize_log_probs = setupParams.normalize_log_probs;
 
-        mTopKDecode->setup(batch_size, samplingParams);
-        mTopPDecode->setup(batch_size, samplingParams);
+        if (mFusedSamplingDecode)
+        {
+            mFusedSamplingDecode->setup(batch_size, samplingParams);
+        }
+        else
+        {
+            mTopKDecode->setup(batch_size, samplingParams);
+            mTopPDecode->setup(batch_size, samplingParams);
+        }
+
+        use_min_p_or_typical_ = setupParams.runtime_min_p || setupParams.runtime_typical_p;
+        if (use_min_p_or_typical_)
+        {
+            mMinPDecode->setup(batch_size, samplingParams);
+            mTypicalDecode->setup(batch_size, samplingParams);
+        }
     }
     else
     { // beam search layer
@@ -172,6 +219,75 @@ void DynamicDecodeLayer<T>::freeBuffer()
 {
     TLLM_LOG_TRACE(__PRETTY_FUNCTION__);
     allocator_->free((void**) &zero_parent_ids);
+    for (auto* buffers : {&mBadWordsAutomaton, &mStopWordsAutomaton})
+    {
+        allocator_->free((void**) &buffers->data);
+        allocator_->free((void**) &buffers->states);
+        allocator_->free((void**) &buffers->state_lengths);
+        buffers->stale = true;
+    }
+    allocator_->free((void**) &mNgramIndex.data);
+    mNgramIndex.reset_all = true;
+}
+
+template <typename T>
+void DynamicDecodeLayer<T>::prepareWordsAutomaton(WordsAutomatonBuffers& buffers, Tensor const& words,
+    size_t num_lists, size_t batch_size, size_t beam_width, bool is_bad_words)
+{
+    TLLM_LOG_TRACE(__PRETTY_FUNCTION__);
+    if (!buffers.stale && buffers.batch_size == batch_size && buffers.beam_width == beam_width)
+    {
+        return;
+    }
+
+    // The words lists stay the same until the next setup, so they are compiled on the host only once
+    auto const words_len = words.shape.back();
+    std::vector<int> words_host(num_lists * 2 * words_len);
+    cudaAutoCpy(words_host.data(), words.template getPtr<const int>(), words_host.size(), stream_);
+    check_cuda_error(cudaStreamSynchronize(stream_));
+    auto const automaton = buildWordsAutomaton(words_host.data(), static_cast<int>(num_lists), words_len,
+        static_cast<int>(batch_size), is_bad_words);
+
+    buffers.data = allocator_->reMalloc(buffers.data, sizeof(int) * automaton.data.size(), false);
+    cudaAutoCpy(buffers.data, automaton.data.data(), automaton.data.size(), stream_);
+    buffers.automaton = automaton.view(buffers.data);
+
+    buffers.states = allocator_->reMalloc(buffers.states, sizeof(int) * batch_size * beam_width, false);
+    buffers.state_lengths = allocator_->reMalloc(buffers.state_lengths, sizeof(int) * batch_size * beam_width, false);
+    // Unknown lengths make the beams walk their sequences at the first step
+    check_cuda_error(cudaMemsetAsync(buffers.state_lengths, 0xff, sizeof(int) * batch_size * beam_width, stream_));
+
+    buffers.stale = false;
+    buffers.batch_size = batch_size;
+    buffers.beam_width = beam_width;
+}
+
+template <typename T>
+void DynamicDecodeLayer<T>::prepareNgramIndex(size_t batch_size, size_t max_seq_len)
+{
+    TLLM_LOG_TRACE(__PRETTY_FUNCTION__);
+    if (mNgramIndex.data == nullptr || mNgramIndex.batch_size != batch_size || mNgramIndex.max_seq_len != max_seq_len)
+    {
+        mNgramIndex.data = allocator_->reMalloc(mNgramIndex.data, NgramIndex::getSize(batch_size, max_seq_len), false);
+        mNgramIndex.batch_size = batch_size;
+        mNgramIndex.max_seq_len = max_seq_len;
+        mNgramIndex.reset_all = true;
+    }
+
+    NgramIndex const index(mNgramIndex.data, max_seq_len);
+    if (mNgramIndex.reset_all)
+    {
+        invokeResetNgramIndex(index, 0, batch_size, stream_);
+    }
+    else
+    {
+        for (auto const slot : mNgramIndex.reset_slots)
+        {
+            invokeResetNgramIndex(index, slot, 1, stream_);
+        }
+    }
+    mNgramIndex.reset_all = false;
+    mNgramIndex.reset_slots.clear();
 }
 
 template <typename T>
@@ -185,7 +301,8 @@ void DynamicDecodeLayer<T>::forward(OutputParams& outputs, ForwardParams const&
     TLLM_CHECK(logits.shape.size() == 3);
 
     auto const batch_size = logits.shape[0];
-    auto const beam_width = logits.shape[1];
+    // The second dimension holds the nodes of the draft tree in tree verification
+    auto const beam_width = params.tree_parents ? 1 : logits.shape[1];
     auto const local_batch_size = static_cast<std::size_t>(params.local_batch_size);
 
     auto const max_seq_len = outputs.output_ids.shape[outputs.output_ids.shape.size() - 1];
@@ -217,7 +334,35 @@ void DynamicDecodeLayer<T>::forward(OutputParams& outputs, ForwardParams const&
     outputs.parent_ids_ptr
         = Tensor(MEMORY_GPU, DataType::TYPE_INT32_PTR, {batch_size, beam_width, max_seq_len}, idsPtrHost + batch_size);
 
-    if (params.no_repeat_ngram_size)
+    if (params.tree_parents)
+    {
+        forwardTreeVerification(outputs, params, idsPtrHost, max_seq_len);
+        return;
+    }
+
+    if (params.logits_bitmask)
+    {
+        auto const& logits_bitmask = params.logits_bitmask.value();
+        TLLM_CHECK_WITH_INFO(logits_bitmask.shape.size() == 2 && logits_bitmask.shape[0] == batch_size
+                && logits_bitmask.shape[1] == static_cast<size_t>(getLogitsBitmaskSize(vocab_size_padded_)),
+            "Logits bitmask must have shape [batch_size, ceil(vocab_size_padded / 32)].");
+        invokeApplyLogitsBitmask(logits.template getPtr<T>(),
+            reinterpret_cast<const uint32_t*>(logits_bitmask.template getPtr<const int>()), batch_size, beam_width,
+            vocab_size_padded_, stream_);
+    }
+
+    if (params.no_repeat_ngram_size && use_ngram_index_ && beam_width == 1)
+    {
+        TLLM_CHECK_WITH_INFO(local_batch_size == batch_size, "The n-gram index needs the whole batch at once.");
+        prepareNgramIndex(batch_size, max_seq_len);
+        invokeBanRepeatNgramFromIndex(logits.template getPtr<T>(), NgramIndex(mNgramIndex.data, max_seq_len),
+            outputs.output_ids_ptr.template getPtr<const int*>(),
+            reinterpret_cast<FinishedState*>(
+                params.finished.value_or(Tensor{}).template getPtr<FinishedState::UnderlyingType>()),
+            outputs.sequence_length->template getPtr<const int>(),
+            params.no_repeat_ngram_size->template getPtr<const int>(), batch_size, vocab_size_padded_, stream_);
+    }
+    else if (params.no_repeat_ngram_size)
     {
         const size_t id_offset = ite * local_batch_size * beam_width;
 
@@ -258,15 +403,30 @@ void DynamicDecodeLayer<T>::forward(OutputParams& outputs, ForwardParams const&
         const int id_offset = ite * local_batch_size;
         const int decode_vocab_size_units_offset = id_offset * vocab_size_padded_;
 
-        invokeBanBadWords((T*) logits.getPtrWithOffset(decode_vocab_size_units_offset),
-            outputs.output_ids_ptr.template getPtr<const int*>(),
-            beam_width > 1 ? outputs.parent_ids_ptr.template getPtr<const int*>() : nullptr, batch_size,
-            local_batch_size, beam_width,
-            shared_bad_words
-                ? bad_words_ptr
-                : bad_words.template getPtrWithOffset<const int>(ite * local_batch_size * 2 * bad_words_len),
-            shared_bad_words, bad_words_len, vocab_size_padded_, outputs.sequence_length->template getPtr<int>(),
-            max_seq_len, stream_);
+        if (use_words_automaton_)
+        {
+            TLLM_CHECK_WITH_INFO(local_batch_size == batch_size, "The words automaton needs the whole batch at once.");
+            prepareWordsAutomaton(
+                mBadWordsAutomaton, bad_words, shared_bad_words ? 1 : batch_size, batch_size, beam_width, true);
+            invokeBanBadWordsAutomaton(logits.template getPtr<T>(), mBadWordsAutomaton.automaton,
+                mBadWordsAutomaton.states, mBadWordsAutomaton.state_lengths,
+                outputs.output_ids_ptr.template getPtr<const int*>(),
+                beam_width > 1 ? outputs.parent_ids_ptr.template getPtr<const int*>() : nullptr,
+                outputs.sequence_length->template getPtr<const int>(), batch_size, beam_width, vocab_size_padded_,
+                max_seq_len, stream_);
+        }
+        else
+        {
+            invokeBanBadWords((T*) logits.getPtrWithOffset(decode_vocab_size_units_offset),
+                outputs.output_ids_ptr.template getPtr<const int*>(),
+                beam_width > 1 ? outputs.parent_ids_ptr.template getPtr<const int*>() : nullptr, batch_size,
+                local_batch_size, beam_width,
+                shared_bad_words
+                    ? bad_words_ptr
+                    : bad_words.template getPtrWithOffset<const int>(ite * local_batch_size * 2 * bad_words_len),
+                shared_bad_words, bad_words_len, vocab_size_padded_, outputs.sequence_length->template getPtr<int>(),
+                max_seq_len, stream_);
+        }
     }
 
     // common inputs
@@ -387,8 +547,23 @@ void DynamicDecodeLayer<T>::forward(OutputParams& outputs, ForwardParams const&
         // then topk_decode handles [4, x, 4 + 0.5]
         //      topp_decode handles [x, 0.5, x]
         // where "x" are skipped.
-        mTopKDecode->forward(decode_outputs, decode_input_tensors);
-        mTopPDecode->forward(decode_outputs, decode_input_tensors);
+        // The fused sampling layer handles all of them in a single kernel.
+        // The requests with a min_p or a typical_p are skipped by these layers and handled by the min-p and
+        // typical-p layers.
+        if (mFusedSamplingDecode)
+        {
+            mFusedSamplingDecode->forward(decode_outputs, decode_input_tensors);
+        }
+        else
+        {
+            mTopKDecode->forward(decode_outputs, decode_input_tensors);
+            mTopPDecode->forward(decode_outputs, decode_input_tensors);
+        }
+        if (use_min_p_or_typical_)
+        {
+            mMinPDecode->forward(decode_outputs, decode_input_tensors);
+            mTypicalDecode->forward(decode_outputs, decode_input_tensors);
+        }
     }
 
     if (params.stop_words_list)
@@ -396,14 +571,29 @@ void DynamicDecodeLayer<T>::forward(OutputParams& outputs, ForwardParams const&
         const size_t id_offset = ite * local_batch_size * beam_width;
         const size_t stop_words_length = params.stop_words_list->shape[2];
 
-        invokeStopWordsCriterion(outputs.output_ids_ptr.template getPtr<const int*>(),
-            outputs.parent_ids_ptr.template getPtr<const int*>(),
-            params.stop_words_list->template getPtrWithOffset<const int>(
-                ite * local_batch_size * 2 * stop_words_length),
-            reinterpret_cast<FinishedState*>(
-                outputs.finished->template getPtrWithOffset<FinishedState::UnderlyingType>(id_offset)),
-            outputs.sequence_length->template getPtr<int>(), stop_words_length, batch_size, beam_width, max_seq_len,
-            stream_);
+        if (use_words_automaton_)
+        {
+            TLLM_CHECK_WITH_INFO(local_batch_size == batch_size, "The words automaton needs the whole batch at once.");
+            prepareWordsAutomaton(mStopWordsAutomaton, *params.stop_words_list, params.stop_words_list->shape[0],
+                batch_size, beam_width, false);
+            invokeStopWordsAutomatonCriterion(mStopWordsAutomaton.automaton, mStopWordsAutomaton.states,
+                mStopWordsAutomaton.state_lengths, outputs.output_ids_ptr.template getPtr<const int*>(),
+                beam_width > 1 ? outputs.parent_ids_ptr.template getPtr<const int*>() : nullptr,
+                reinterpret_cast<FinishedState*>(
+                    outputs.finished->template getPtr<FinishedState::UnderlyingType>()),
+                outputs.sequence_length->template getPtr<const int>(), batch_size, beam_width, max_seq_len, stream_);
+        }
+        else
+        {
+            invokeStopWordsCriterion(outputs.output_ids_ptr.template getPtr<const int*>(),
+                outputs.parent_ids_ptr.template getPtr<const int*>(),
+                params.stop_words_list->template getPtrWithOffset<const int>(
+                    ite * local_batch_size * 2 * stop_words_length),
+                reinterpret_cast<FinishedState*>(
+                    outputs.finished->template getPtrWithOffset<FinishedState::UnderlyingType>(id_offset)),
+                outputs.sequence_length->template getPtr<int>(), stop_words_length, batch_size, beam_width,
+                max_seq_len, stream_);
+        }
     }
 
     if (params.sequence_limit_length)
@@ -432,6 +622,49 @@ void DynamicDecodeLayer<T>::forward(OutputParams& outputs, ForwardParams const&
     sync_check_cuda_error();
 }
 
+template <typename T>
+void DynamicDecodeLayer<T>::forwardTreeVerification(
+    OutputParams& outputs, ForwardParams const& params, int** ids_ptr_host, size_t max_seq_len)
+{
+    TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+    auto const& logits = params.logits;
+    auto const batch_size = logits.shape[0];
+    auto const num_nodes = logits.shape[1];
+    TLLM_CHECK_WITH_INFO(params.tree_draft_ids && outputs.finished && outputs.accepted_paths
+            && outputs.num_accepted_tokens,
+        "Tree verification needs tree_draft_ids, finished, accepted_paths and num_accepted_tokens.");
+    TLLM_CHECK_WITH_INFO(params.tree_parents->shape[0] == num_nodes && params.tree_draft_ids->shape[0] == batch_size
+            && params.tree_draft_ids->shape[1] == num_nodes,
+        "The draft tree must have as many nodes as the logits.");
+    TLLM_CHECK_WITH_INFO(static_cast<size_t>(params.local_batch_size) == batch_size,
+        "Tree verification needs the whole batch at once.");
+    auto const max_path_len = outputs.accepted_paths->shape[1];
+
+    auto* finished
+        = reinterpret_cast<FinishedState*>(outputs.finished->template getPtr<FinishedState::UnderlyingType>());
+    auto* sequence_lengths = outputs.sequence_length->template getPtr<int>();
+    invokeAcceptTreeDraftTokensByArgmax(outputs.output_ids_ptr.template getPtr<int*>(), sequence_lengths, finished,
+        outputs.accepted_paths->template getPtr<int>(), outputs.num_accepted_tokens->template getPtr<int>(),
+        logits.template getPtr<const T>(), params.tree_draft_ids->template getPtr<const int>(),
+        params.tree_parents->template getPtr<const int>(), params.end_ids.template getPtr<const int>(),
+        params.sequence_limit_length ? params.sequence_limit_length->template getPtr<const uint32_t>() : nullptr,
+        batch_size, num_nodes, max_path_len, vocab_size_, vocab_size_padded_, stream_);
+    sync_check_cuda_error();
+
+    if (params.sequence_limit_length)
+    {
+        invokeLengthCriterion(finished, outputs.finished_sum ? outputs.finished_sum->template getPtr<int>() : nullptr,
+            params.sequence_limit_length->template getPtr<const uint32_t>(), sequence_lengths, batch_size, 1,
+            stream_);
+        sync_check_cuda_error();
+    }
+
+    invokeCopyNextStepIds(
+        outputs.newTokens.template getPtr<int>(), ids_ptr_host, sequence_lengths, batch_size, 1, max_seq_len, stream_);
+    sync_check_cuda_error();
+    TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
+}
+
 template class DynamicDecodeLayer<float>;
 template class DynamicDecodeLayer<half>;
 
@@ -18,10 +18,14 @@
 
 #include "tensorrt_llm/common/tensor.h"
 #include "tensorrt_llm/kernels/beamSearchTopkKernels.h"
+#include "tensorrt_llm/kernels/wordsAutomatonKernels.h"
 #include "tensorrt_llm/layers/baseLayer.h"
+#include "tensorrt_llm/layers/fusedSamplingLayer.h"
+#include "tensorrt_llm/layers/minPSamplingLayer.h"
 #include "tensorrt_llm/layers/onlineBeamSearchLayer.h"
 #include "tensorrt_llm/layers/topKSamplingLayer.h"
 #include "tensorrt_llm/layers/topPSamplingLayer.h"
+#include "tensorrt_llm/layers/typicalSamplingLayer.h"
 #include "tensorrt_llm/runtime/cudaStream.h"
 #include "tensorrt_llm/runtime/iTensor.h"
 
@@ -64,12 +68,19 @@ public:
         std::optional<std::vector<std::uint32_t>> runtime_top_k; // [1] or [batch_size] on cpu
         std::optional<std::vector<float>> runtime_top_p;         // [1] or [batch_size] on cpu
         std::optional<std::vector<uint64_t>> randomSeed;         // [1] or [batch_size] on cpu
+        // [n] on cpu, reset only the random states of these requests and keep the others, e.g. when a request joins a
+        // running batch
+        std::optional<std::vector<std::int32_t>> random_seed_slots;
 
         // topPSamplingLayer
         std::optional<std::vector<float>> top_p_decay;            // [batch_size], must between [0, 1]
         std::optional<std::vector<float>> top_p_min;              // [batch_size], must between [0, 1]
         std::optional<std::vector<std::int32_t>> top_p_reset_ids; // [batch_size]
 
+        // minPSamplingLayer and typicalSamplingLayer, take precedence over top_k and top_p
+        std::optional<std::vector<float>> runtime_min_p;     // [1] or [batch_size] on cpu, must between [0, 1]
+        std::optional<std::vector<float>> runtime_typical_p; // [1] or [batch_size] on cpu, must between (0, 1]
+
         // omlineBeamSearchLayer
         std::optional<std::vector<float>> beam_search_diversity_rate;
         std::optional<std::vector<float>> length_penalty;
@@ -113,6 +124,12 @@ public:
         std::optional<tc::Tensor> bad_words_list;  // [2, bad_words_length] or [batch_size, 2, bad_words_length], on gpu
         std::optional<tc::Tensor> stop_words_list; // [batch_size, 2, stop_words_length], on gpu
         std::optional<tc::Tensor> no_repeat_ngram_size; // [batch_size], optional
+        // [batch_size, ceil(vocab_size_padded / 32)], int32 on gpu, bit t % 32 of word t / 32 allows token t, optional
+        std::optional<tc::Tensor> logits_bitmask;
+        // Verifies a static tree of draft tokens, e.g. the candidates of Medusa heads, instead of sampling. The logits
+        // are [batch_size, num_nodes, vocab_size_padded] then, see invokeAcceptTreeDraftTokensByArgmax
+        std::optional<tc::Tensor> tree_parents;   // [num_nodes], on gpu
+        std::optional<tc::Tensor> tree_draft_ids; // [batch_size, num_nodes], on gpu
     };
 
     class OutputParams
@@ -140,6 +157,8 @@ public:
             tgt_cache_indirection;  // [local_batch_size, beam_width, max_seq_len], the k/v cache index for beam search
         std::shared_ptr<kernels::BeamHypotheses>
             beamHypotheses;         // a special structure which maintains some pointers of beam search
+        std::optional<tc::Tensor> accepted_paths;      // [batch_size, max_path_len], mandatory in tree verification
+        std::optional<tc::Tensor> num_accepted_tokens; // [batch_size], mandatory in tree verification
 
         tc::Tensor output_ids_ptr;  // [batch_size] int* (2-d array), each int* has [beam_width, max_seq_len]
         tc::Tensor parent_ids_ptr;  // [batch_size] int* (2-d array), each int* has [beam_width, max_seq_len]
@@ -150,11 +169,53 @@ public:
     void freeBuffer();
 
 private:
+    // Aho-Corasick automaton of a words list, compiled at the first forward after setup
+    struct WordsAutomatonBuffers
+    {
+        bool stale = true;
+        size_t batch_size = 0;
+        size_t beam_width = 0;
+        kernels::WordsAutomaton automaton{};
+        int* data = nullptr;          // packed automaton arrays
+        int* states = nullptr;        // [batch_size, beam_width]
+        int* state_lengths = nullptr; // [batch_size, beam_width]
+    };
+
+    // Per-sequence n-gram indices, updated with the new tokens at every forward
+    struct NgramIndexBuffers
+    {
+        bool reset_all = true;
+        size_t batch_size = 0;
+        size_t max_seq_len = 0;
+        int* data = nullptr;
+        std::vector<std::int32_t> reset_slots; // requests restarted since the last forward
+    };
+
     void initialize();
+    void forwardTreeVerification(
+        OutputParams& outputs, ForwardParams const& params, int** ids_ptr_host, size_t max_seq_len);
+    void prepareWordsAutomaton(WordsAutomatonBuffers& buffers, tc::Tensor const& words, size_t num_lists,
+        size_t batch_size, size_t beam_width, bool is_bad_words);
+    void prepareNgramIndex(size_t batch_size, size_t max_seq_len);
 
     std::unique_ptr<OnlineBeamSearchLayer<T>> mOnlineBeamsearchDecode;
     std::unique_ptr<TopKSamplingLayer<T>> mTopKDecode;
     std::unique_ptr<TopPSamplingLayer<T>> mTopPDecode;
+    // Replaces mTopKDecode and mTopPDecode when TRTLLM_ENABLE_FUSED_SAMPLING=1
+    std::unique_ptr<FusedSamplingLayer<T>> mFusedSamplingDecode;
+    // Sample the requests with a min_p or a typical_p, only set up when some request has one
+    std::unique_ptr<MinPSamplingLayer<T>> mMinPDecode;
+    std::unique_ptr<TypicalSamplingLayer<T>> mTypicalDecode;
+    bool use_min_p_or_typical_ = false;
+
+    // Match the words lists with mBadWordsAutomaton and mStopWordsAutomaton when TRTLLM_ENABLE_WORDS_AUTOMATON=1
+    bool use_words_automaton_ = false;
+    WordsAutomatonBuffers mBadWordsAutomaton;
+    WordsAutomatonBuffers mStopWordsAutomaton;
+
+    // Ban the repeated n-grams with mNgramIndex when TRTLLM_ENABLE_NGRAM_INDEX=1, for beam width 1
+    bool use_ngram_index_ = false;
+    NgramIndexBuffers mNgramIndex;
 
     size_t vocab_size_;
     size_t vocab_size_padded_;
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/memoryUtils.h"
+#include "tensorrt_llm/kernels/samplingFusedKernels.h"
+#include "tensorrt_llm/kernels/samplingTopPKernels.h"
+#include "tensorrt_llm/layers/fusedSamplingLayer.h"
+
+#include <algorithm>
+
+using namespace tensorrt_llm::common;
+using namespace tensorrt_llm::kernels;
+
+namespace tensorrt_llm
+{
+namespace layers
+{
+
+static __global__ void set_fused_runtime_args(int batch_size, std::int32_t top_k, std::int32_t* top_ks,
+    int top_ks_size, float top_p, float* top_ps, int top_ps_size, float* initial_top_p_buf, float* top_p_decay_buf,
+    float* top_p_min_buf)
+{
+    int index = blockIdx.x * blockDim.x + threadIdx.x;
+    for (int i = index; i < batch_size; i += gridDim.x * blockDim.x)
+    {
+        std::int32_t k = top_ks_size > 1 ? top_ks[i] : top_k;
+        float p = top_ps_size > 1 ? top_ps[i] : top_p;
+        // Same conventions as TopKSamplingLayer and TopPSamplingLayer: topk = 0 and topp = 0 is greedy search,
+        // topk > 0 and topp = 0 is top K sampling.
+        if (k == 0 && p == 0.0f)
+        {
+            k = 1;
+        }
+        if (k > 0 && p == 0.0f)
+        {
+            p = 1.0f;
+        }
+        top_ks[i] = k < 0 ? 0 : k;
+        // Clip p value if it is out of range. range = [0.0, 1.0].
+        top_ps[i] = p < 0.0f ? 0.0f : (p > 1.0f ? 1.0f : p);
+        if (p < 0.0f || p > 1.0f)
+        {
+            printf(
+                "[WARNING] topp (%f) is out of range ([0.0, 1.0f]) for token %d"
+                " clip to closest number %f.\n",
+                p, i, top_ps[i]);
+        }
+
+        initial_top_p_buf[i] = top_ps[i];
+        if (k > 0)
+        {
+            // The top P decay only applies to top P sampling, keep P constant for top K requests
+            top_p_decay_buf[i] = 1.0f;
+            top_p_min_buf[i] = top_ps[i];
+            continue;
+        }
+        if (top_p_decay_buf[i] > 1.0f || top_p_decay_buf[i] <= 0.0f)
+        {
+            printf(
+                "[WARNING] top_p_decay_buf (%f) is out of range ([0.0, 1.0f]) for "
+                "token %d,"
+                " change to 1.0f.\n",
+                top_p_decay_buf[i], i);
+            top_p_decay_buf[i] = 1.0f;
+        }
+        if (top_p_min_buf[i] > 1.0f || top_p_min_buf[i] <= 0.0f)
+        {
+            printf(
+                "[WARNING] top_p_min_buf (%f) is out of range ([0.0, 1.0f]) for "
+                "token %d,"
+                " change to 0.5f.\n",
+                top_p_min_buf[i], i);
+            top_p_min_buf[i] = 0.5f;
+        }
+    }
+}
+
+template <typename T>
+void FusedSamplingLayer<T>::allocateBuffer(std::size_t batch_size)
+{
+    TLLM_LOG_TRACE(__PRETTY_FUNCTION__);
+    runtime_top_k_buf_ = allocator_->reMalloc(runtime_top_k_buf_, sizeof(std::int32_t) * batch_size, false);
+    runtime_top_p_buf_ = allocator_->reMalloc(runtime_top_p_buf_, sizeof(float) * batch_size, false);
+    initial_top_p_buf_ = allocator_->reMalloc(initial_top_p_buf_, sizeof(float) * batch_size, false);
+    top_p_decay_buf_ = allocator_->reMalloc(top_p_decay_buf_, sizeof(float) * batch_size, false);
+    top_p_min_buf_ = allocator_->reMalloc(top_p_min_buf_, sizeof(float) * batch_size, false);
+    top_p_reset_ids_buf_ = allocator_->reMalloc(top_p_reset_ids_buf_, sizeof(std::int32_t) * batch_size, false);
+    is_allocate_buffer_ = true;
+}
+
+template <typename T>
+void FusedSamplingLayer<T>::freeBuffer()
+{
+    TLLM_LOG_TRACE(__PRETTY_FUNCTION__);
+    if (is_allocate_buffer_)
+    {
+        allocator_->free((void**) (&runtime_top_k_buf_));
+        allocator_->free((void**) (&runtime_top_p_buf_));
+        allocator_->free((void**) (&initial_top_p_buf_));
+        allocator_->free((void**) (&top_p_decay_buf_));
+        allocator_->free((void**) (&top_p_min_buf_));
+        allocator_->free((void**) (&top_p_reset_ids_buf_));
+    }
+    BaseSamplingLayer<T>::freeBuffer();
+    is_allocate_buffer_ = false;
+}
+
+template <typename T>
+void FusedSamplingLayer<T>::setup(std::size_t const batch_size, SetupParams const& setupParams)
+{
+    TLLM_LOG_TRACE(__PRETTY_FUNCTION__);
+    BaseSamplingLayer<T>::setupBase(batch_size, setupParams);
+    allocateBuffer(batch_size);
+
+    std::uint32_t const default_top_k = 0;
+    auto const runtime_top_k = setupParams.runtime_top_k.value_or(std::vector<uint32_t>{default_top_k});
+    auto const runtime_top_p = setupParams.runtime_top_p.value_or(std::vector<float>{0.0f});
+    normalize_log_probs = setupParams.normalize_log_probs.has_value() && setupParams.normalize_log_probs.value();
+
+    std::size_t const runtime_top_k_size = runtime_top_k.size();
+    std::size_t const runtime_top_p_size = runtime_top_p.size();
+
+    if (runtime_top_k_size > 1)
+    {
+        TLLM_CHECK_WITH_INFO(runtime_top_k.size() == batch_size,
+            fmtstr(
+                "runtime_top_k.size() (%lu) == batch_size (%lu) is not satisfied!", runtime_top_k.size(), batch_size));
+        std::vector<std::int32_t> const top_ks(runtime_top_k.begin(), runtime_top_k.end());
+        cudaAutoCpy(runtime_top_k_buf_, top_ks.data(), batch_size, stream_);
+    }
+    if (runtime_top_p_size > 1)
+    {
+        TLLM_CHECK_WITH_INFO(runtime_top_p.size() == batch_size,
+            fmtstr(
+                "runtime_top_p.size() (%lu) == batch_size (%lu) is not satisfied!", runtime_top_p.size(), batch_size));
+        cudaAutoCpy(runtime_top_p_buf_, runtime_top_p.data(), batch_size, stream_);
+    }
+
+    auto fillBuffers = [this, &batch_size](std::string name, auto const& vector, auto& deviceBuffer)
+    {
+        TLLM_CHECK_WITH_INFO(vector.size() == batch_size,
+            fmtstr("%s.size() (%lu) == batch_size (%lu) is not satisfied!", name.c_str(), vector.size(), batch_size));
+        cudaAutoCpy(deviceBuffer, vector.data(), batch_size, stream_);
+    };
+
+    float const defaultTopPDecay{1.0f};
+    fillBuffers("top_p_decay", setupParams.top_p_decay.value_or(std::vector<float>(batch_size, defaultTopPDecay)),
+        top_p_decay_buf_);
+
+    float const defaultTopPMin{1e-6f}; // prevent topp becoming 0.0
+    fillBuffers(
+        "top_p_min", setupParams.top_p_min.value_or(std::vector<float>(batch_size, defaultTopPMin)), top_p_min_buf_);
+
+    std::int32_t const defaultTopPResetId{-1};
+    fillBuffers("top_p_reset_ids",
+        setupParams.top_p_reset_ids.value_or(std::vector<std::int32_t>(batch_size, defaultTopPResetId)),
+        top_p_reset_ids_buf_);
+    use_top_p_decay_ = setupParams.top_p_decay || setupParams.top_p_min || setupParams.top_p_reset_ids;
+
+    dim3 block(std::min((int) batch_size, 256));
+    dim3 grid(divUp((int) batch_size, (int) block.x));
+    set_fused_runtime_args<<<grid, block, 0, stream_>>>(batch_size, static_cast<std::int32_t>(runtime_top_k.front()),
+        runtime_top_k_buf_, runtime_top_k_size, runtime_top_p.front(), runtime_top_p_buf_, runtime_top_p_size,
+        initial_top_p_buf_, top_p_decay_buf_, top_p_min_buf_);
+    sync_check_cuda_error();
+
+    // Every request but the min-p and typical-p ones is sampled by this layer
+    cudaMemsetAsync(skip_decode_buf_, 0, sizeof(bool) * batch_size, stream_);
+    std::fill_n(skip_decode_, batch_size, false);
+    this->skipMinPAndTypicalRequests(batch_size);
+}
+
+template <typename T>
+void FusedSamplingLayer<T>::runSampling(DecodingOutputParams& outputs, DecodingParams const& params)
+{
+    TLLM_LOG_TRACE("%s start", __PRETTY_FUNCTION__);
+
+    auto const local_batch_size = params.logits.shape[0];
+    auto const ite = params.ite;
+
+    // BaseSamplingLayer::forward always passes its ForwardParams
+    auto const& forward_params = static_cast<typename Base::ForwardParams const&>(params);
+    bool const fuse_temperature = Base::isTemperatureFused();
+    auto const* embedding_bias = fuse_temperature && forward_params.embedding_bias
+        ? forward_params.embedding_bias->template getPtr<T const>()
+        : nullptr;
+    auto const* temperatures = fuse_temperature ? temperature_buf_ + ite * local_batch_size : nullptr;
+
+    auto const* logits = params.logits.template getPtr<T const>();
+    auto const* end_ids = params.end_ids.template getPtr<const int>();
+
+    FinishedState* finished_input = (params.finished)
+        ? reinterpret_cast<FinishedState*>(params.finished->template getPtr<FinishedState::UnderlyingType>())
+        : nullptr;
+    FinishedState* finished_output = (outputs.finished)
+        ? reinterpret_cast<FinishedState*>(outputs.finished->template getPtr<FinishedState::UnderlyingType>())
+        : nullptr;
+    float* cum_log_probs = (outputs.cum_log_probs) ? outputs.cum_log_probs->template getPtr<float>() : nullptr;
+    float* output_log_probs = (outputs.output_log_probs) ? outputs.output_log_probs->template getPtr<float>() : nullptr;
+    int* sequence_length = (outputs.sequence_length) ? outputs.sequence_length->template getPtr<int>() : nullptr;
+
+    invokeBatchFusedSampling(outputs.output_ids_ptr.template getPtr<int*>(), sequence_length, finished_input,
+        finished_output, cum_log_probs, output_log_probs, logits, embedding_bias, temperatures,
+        runtime_top_k_buf_ + ite * local_batch_size, runtime_top_p_buf_ + ite * local_batch_size,
+        this->getCurandStates(ite * local_batch_size), end_ids, local_batch_size, vocab_size_, vocab_size_padded_,
+        skip_decode_buf_ + ite * local_batch_size, normalize_log_probs, stream_,
+        this->getRandomSeeds(ite * local_batch_size));
+    sync_check_cuda_error();
+
+    if (use_top_p_decay_)
+    {
+        invokeComputeToppDecay(runtime_top_p_buf_ + ite * local_batch_size,
+            initial_top_p_buf_ + ite * local_batch_size, outputs.output_ids_ptr.template getPtr<const int*>(),
+            top_p_decay_buf_ + ite * local_batch_size, top_p_min_buf_ + ite * local_batch_size,
+            top_p_reset_ids_buf_ + ite * local_batch_size, sequence_length, local_batch_size, stream_);
+        sync_check_cuda_error();
+    }
+    TLLM_LOG_TRACE("%s stop", __PRETTY_FUNCTION__);
+}
+
+template <typename T>
+FusedSamplingLayer<T>::FusedSamplingLayer(std::size_t vocab_size, std::size_t vocab_size_padded, cudaStream_t stream,
+    std::shared_ptr<IAllocator> allocator, bool is_free_buffer_after_forward)
+    : BaseSamplingLayer<T>(
+        vocab_size, vocab_size_padded, stream, std::move(allocator), is_free_buffer_after_forward, nullptr)
+{
+    fuse_temperature_ = true;
+}
+
+template <typename T>
+FusedSamplingLayer<T>::FusedSamplingLayer(FusedSamplingLayer<T> const& fused_sampling_layer)
+    : BaseSamplingLayer<T>(fused_sampling_layer)
+{
+    fuse_temperature_ = true;
+}
+
+template <typename T>
+FusedSamplingLayer<T>::~FusedSamplingLayer()
+{
+    TLLM_LOG_TRACE(__PRETTY_FUNCTION__);
+    freeBuffer();
+}
+
+template class FusedSamplingLayer<float>;
+template class FusedSamplingLayer<half>;
+
+} // namespace layers
+} // namespace tensorrt_llm
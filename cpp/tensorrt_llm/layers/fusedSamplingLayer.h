@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/tensor.h"
+#include "tensorrt_llm/kernels/decodingCommon.h"
+#include "tensorrt_llm/layers/baseSamplingLayer.h"
+
+namespace tensorrt_llm
+{
+namespace layers
+{
+
+//! \brief Samples every request of the batch, whatever its top K and top P, with one fused kernel.
+//! Replaces the pair of TopKSamplingLayer and TopPSamplingLayer: the logits are neither copied nor rewritten by a
+//! softmax, and without penalties the embedding bias and temperature are applied inside the sampling kernel.
+template <typename T>
+class FusedSamplingLayer : public BaseSamplingLayer<T>
+{
+public:
+    using Base = BaseSamplingLayer<T>;
+    using SetupParams = typename Base::SetupParams;
+
+    FusedSamplingLayer(std::size_t vocab_size, std::size_t vocab_size_padded, cudaStream_t stream,
+        std::shared_ptr<tensorrt_llm::common::IAllocator> allocator, bool is_free_buffer_after_forward);
+    FusedSamplingLayer(FusedSamplingLayer<T> const& fused_sampling_layer);
+    ~FusedSamplingLayer();
+
+    void setup(std::size_t batch_size, SetupParams const& setupParams) override;
+
+protected:
+    void runSampling(DecodingOutputParams& outputs, DecodingParams const& params) override;
+    void freeBuffer() override;
+
+    bool normalize_log_probs = true;
+    bool use_top_p_decay_ = false;
+    std::int32_t* runtime_top_k_buf_ = nullptr;
+    float* runtime_top_p_buf_ = nullptr;
+    float* initial_top_p_buf_ = nullptr;
+    float* top_p_decay_buf_ = nullptr;
+    float* top_p_min_buf_ = nullptr;
+    std::int32_t* top_p_reset_ids_buf_ = nullptr;
+
+    using Base::vocab_size_;
+    using Base::vocab_size_padded_;
+
+    using Base::curandstate_buf_;
+    using Base::temperature_buf_;
+    using Base::skip_decode_buf_;
+    using Base::skip_decode_;
+    using Base::fuse_temperature_;
+
+    using Base::stream_;
+    using Base::allocator_;
+    using Base::is_allocate_buffer_;
+
+private:
+    void allocateBuffer(std::size_t batch_size);
+};
+
+} // namespace layers
+} // namespace tensorrt_llm
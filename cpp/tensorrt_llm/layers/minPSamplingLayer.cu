@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/memoryUtils.h"
+#include "tensorrt_llm/kernels/decodingCommon.h"
+#include "tensorrt_llm/kernels/samplingMinPKernels.h"
+#include "tensorrt_llm/layers/minPSamplingLayer.h"
+
+#include <algorithm>
+
+using namespace tensorrt_llm::common;
+using namespace tensorrt_llm::kernels;
+
+namespace tensorrt_llm
+{
+namespace layers
+{
+
+template <typename T>
+void MinPSamplingLayer<T>::allocateBuffer(std::size_t batch_size)
+{
+    TLLM_LOG_TRACE(__PRETTY_FUNCTION__);
+    runtime_min_p_buf_ = allocator_->reMalloc(runtime_min_p_buf_, sizeof(float) * batch_size, false);
+    is_allocate_buffer_ = true;
+}
+
+template <typename T>
+void MinPSamplingLayer<T>::freeBuffer()
+{
+    TLLM_LOG_TRACE(__PRETTY_FUNCTION__);
+    if (is_allocate_buffer_)
+    {
+        allocator_->free((void**) (&runtime_min_p_buf_));
+    }
+    BaseSamplingLayer<T>::freeBuffer();
+    is_allocate_buffer_ = false;
+}
+
+template <typename T>
+void MinPSamplingLayer<T>::setup(std::size_t const batch_size, SetupParams const& setupParams)
+{
+    TLLM_LOG_TRACE(__PRETTY_FUNCTION__);
+    BaseSamplingLayer<T>::setupBase(batch_size, setupParams);
+    allocateBuffer(batch_size);
+
+    cudaAutoCpy(runtime_min_p_buf_, mMinP.data(), batch_size, stream_);
+    for (std::size_t bi = 0; bi < batch_size; ++bi)
+    {
+        skip_decode_[bi] = !this->isMinPRequest(bi);
+    }
+    cudaAutoCpy(skip_decode_buf_, skip_decode_, batch_size, stream_);
+}
+
+template <typename T>
+void MinPSamplingLayer<T>::runSampling(DecodingOutputParams& outputs, DecodingParams const& params)
+{
+    TLLM_LOG_TRACE(__PRETTY_FUNCTION__);
+
+    auto const local_batch_size = params.logits.shape[0];
+    auto const ite = params.ite;
+
+    // in case of skip any, the logit value is already copied and processed.
+    auto* logits = !skip_any_ ? params.logits.template getPtr<T>() : runtime_logits_buf_;
+    auto* end_ids = params.end_ids.template getPtr<const int>();
+
+    FinishedState* finished_input = (params.finished)
+        ? reinterpret_cast<FinishedState*>(params.finished->template getPtr<FinishedState::UnderlyingType>())
+        : nullptr;
+    FinishedState* finished_output = (outputs.finished)
+        ? reinterpret_cast<FinishedState*>(outputs.finished->template getPtr<FinishedState::UnderlyingType>())
+        : nullptr;
+    invokeAddBiasSoftMax(logits, logits, (T*) (nullptr), end_ids, finished_input, local_batch_size, vocab_size_,
+        vocab_size_padded_, stream_);
+    sync_check_cuda_error();
+
+    float* cum_log_probs = (outputs.cum_log_probs) ? outputs.cum_log_probs->template getPtr<float>() : nullptr;
+    float* output_log_probs = (outputs.output_log_probs) ? outputs.output_log_probs->template getPtr<float>() : nullptr;
+    int* sequence_length = (outputs.sequence_length) ? outputs.sequence_length->template getPtr<int>() : nullptr;
+
+    invokeBatchMinPSampling<T>(outputs.output_ids_ptr.template getPtr<int*>(), sequence_length, finished_input,
+        finished_output, cum_log_probs, output_log_probs, logits, runtime_min_p_buf_ + ite * local_batch_size,
+        this->getCurandStates(ite * local_batch_size), this->getRandomSeeds(ite * local_batch_size), end_ids,
+        local_batch_size, vocab_size_padded_, skip_decode_buf_ + ite * local_batch_size, stream_);
+    sync_check_cuda_error();
+}
+
+template <typename T>
+MinPSamplingLayer<T>::MinPSamplingLayer(std::size_t vocab_size, std::size_t vocab_size_padded, cudaStream_t stream,
+    std::shared_ptr<IAllocator> allocator, bool is_free_buffer_after_forward)
+    : BaseSamplingLayer<T>(
+        vocab_size, vocab_size_padded, stream, std::move(allocator), is_free_buffer_after_forward, nullptr)
+{
+}
+
+template <typename T>
+MinPSamplingLayer<T>::MinPSamplingLayer(MinPSamplingLayer<T> const& min_p_sampling_layer)
+    : BaseSamplingLayer<T>(min_p_sampling_layer)
+{
+}
+
+template <typename T>
+MinPSamplingLayer<T>::~MinPSamplingLayer()
+{
+    TLLM_LOG_TRACE(__PRETTY_FUNCTION__);
+    freeBuffer();
+}
+
+template class MinPSamplingLayer<float>;
+template class MinPSamplingLayer<half>;
+
+} // namespace layers
+} // namespace tensorrt_llm
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/tensor.h"
+#include "tensorrt_llm/kernels/decodingCommon.h"
+#include "tensorrt_llm/layers/baseSamplingLayer.h"
+
+namespace tc = tensorrt_llm::common;
+
+namespace tensorrt_llm
+{
+namespace layers
+{
+
+//! Samples the requests with a min P above 0 from the tokens whose probability is at least min P times the
+//! probability of the most likely token, see invokeBatchMinPSampling.
+template <typename T>
+class MinPSamplingLayer : public BaseSamplingLayer<T>
+{
+public:
+    using Base = BaseSamplingLayer<T>;
+    using SetupParams = typename Base::SetupParams;
+
+    MinPSamplingLayer(std::size_t vocab_size, std::size_t vocab_size_padded, cudaStream_t stream,
+        std::shared_ptr<tensorrt_llm::common::IAllocator> allocator, bool is_free_buffer_after_forward);
+    MinPSamplingLayer(MinPSamplingLayer<T> const& min_p_sampling_layer);
+    ~MinPSamplingLayer();
+
+    void setup(std::size_t batch_size, SetupParams const& setupParams) override;
+
+protected:
+    void runSampling(DecodingOutputParams& outputs, DecodingParams const& params) override;
+    void freeBuffer() override;
+
+    float* runtime_min_p_buf_ = nullptr;
+
+    using Base::vocab_size_;
+    using Base::vocab_size_padded_;
+
+    using Base::skip_decode_buf_;
+    using Base::skip_decode_;
+    using Base::skip_any_;
+    using Base::runtime_logits_buf_;
+    using Base::mMinP;
+
+    using Base::stream_;
+    using Base::allocator_;
+    using Base::is_allocate_buffer_;
+
+private:
+    void allocateBuffer(std::size_t batch_size);
+};
+
+} // namespace layers
+} // namespace tensorrt_llm
@@ -161,6 +161,8 @@ void TopKSamplingLayer<T>::setup(size_t const batch_size, SetupParams const& set
     std::vector<uint32_t> runtime_top_ks(batch_size);
     cudaAutoCpy(runtime_top_ks.data(), runtime_top_k_buf_, batch_size, stream_);
     runtime_max_top_k_ = *std::max_element(std::begin(runtime_top_ks), std::end(runtime_top_ks));
+
+    this->skipMinPAndTypicalRequests(batch_size);
 }
 
 template <typename T>
@@ -200,14 +202,14 @@ void TopKSamplingLayer<T>::runSampling(DecodingOutputParams& outputs, DecodingPa
 
     invokeBatchTopKSampling(sampling_workspace_, sampling_workspace_size_, logits,
         outputs.output_ids_ptr.template getPtr<int*>(), sequence_length, finished_input, finished_output, cum_log_probs,
-        output_log_probs, curandstate_buf_ + ite * local_batch_size,
+        output_log_probs, this->getCurandStates(ite * local_batch_size),
         (int) runtime_max_top_k_, // useless because runtime_top_k_buf_ is never
                                   // nullptr. Keep for legacy.
         (int*) (runtime_top_k_buf_ + ite * local_batch_size),
         1.0f,                     // useless because runtime_top_p_buf_ is never nullptr. Keep for
                                   // legacy.
         runtime_top_p_buf_ + ite * local_batch_size, vocab_size_padded_, end_ids, stream_, local_batch_size,
-        skip_decode_buf_ + ite * local_batch_size, normalize_log_probs);
+        skip_decode_buf_ + ite * local_batch_size, normalize_log_probs, this->getRandomSeeds(ite * local_batch_size));
     sync_check_cuda_error();
 }
 
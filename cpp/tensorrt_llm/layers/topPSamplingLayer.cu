@@ -224,6 +224,8 @@ void TopPSamplingLayer<T>::setup(std::size_t const batch_size, SetupParams const
     std::vector<float> runtime_top_ps(batch_size);
     cudaAutoCpy(runtime_top_ps.data(), runtime_top_p_buf_, batch_size, stream_);
     runtime_max_top_p_ = *std::max_element(std::begin(runtime_top_ps), std::end(runtime_top_ps));
+
+    this->skipMinPAndTypicalRequests(batch_size);
 }
 
 template <typename T>
@@ -260,8 +262,9 @@ void TopPSamplingLayer<T>::runSampling(DecodingOutputParams& outputs, DecodingPa
     invokeBatchTopPSampling<T>(sampling_workspace_, sampling_workspace_size_, cub_temp_storage_size_,
         outputs.output_ids_ptr.template getPtr<int*>(), sequence_length, finished_input, finished_output, cum_log_probs,
         output_log_probs, logits, topp_id_vals_buf_, topp_offset_buf_, begin_topp_offset_buf_,
-        curandstate_buf_ + ite * local_batch_size, local_batch_size, vocab_size_padded_, end_ids, runtime_max_top_p_,
-        runtime_top_p_buf_ + ite * local_batch_size, stream_, skip_decode_buf_ + ite * local_batch_size);
+        this->getCurandStates(ite * local_batch_size), local_batch_size, vocab_size_padded_, end_ids,
+        runtime_max_top_p_, runtime_top_p_buf_ + ite * local_batch_size, stream_,
+        skip_decode_buf_ + ite * local_batch_size, this->getRandomSeeds(ite * local_batch_size));
     sync_check_cuda_error();
 
     invokeComputeToppDecay(runtime_top_p_buf_ + ite * local_batch_size, initial_top_p_buf_ + ite * local_batch_size,
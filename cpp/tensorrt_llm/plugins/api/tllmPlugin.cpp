@@ -16,35 +16,52 @@
  */
 #include "tllmPlugin.h"
 
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
 #include "tensorrt_llm/common/stringUtils.h"
+#include "tensorrt_llm/kernels/contextFusedMultiHeadAttention/fmhaRunner.h"
+#include "tensorrt_llm/kernels/decoderMaskedMultiheadAttention/decoderXQARunner.h"
+#include "tensorrt_llm/plugins/common/plugin.h"
 #include "tensorrt_llm/runtime/tllmLogger.h"
 
 #include "tensorrt_llm/plugins/bertAttentionPlugin/bertAttentionPlugin.h"
+#include "tensorrt_llm/plugins/fp8GemmPlugin/fp8GemmPlugin.h"
 #include "tensorrt_llm/plugins/gemmPlugin/gemmPlugin.h"
+#include "tensorrt_llm/plugins/gatedActivationPlugin/gatedActivationPlugin.h"
 #include "tensorrt_llm/plugins/gptAttentionPlugin/gptAttentionPlugin.h"
+#include "tensorrt_llm/plugins/groupedGemmPlugin/groupedGemmPlugin.h"
 #include "tensorrt_llm/plugins/identityPlugin/identityPlugin.h"
 #include "tensorrt_llm/plugins/layernormPlugin/layernormPlugin.h"
 #include "tensorrt_llm/plugins/layernormQuantizationPlugin/layernormQuantizationPlugin.h"
+#include "tensorrt_llm/plugins/lmHeadTopKPlugin/lmHeadTopKPlugin.h"
 #include "tensorrt_llm/plugins/lookupPlugin/lookupPlugin.h"
 #include "tensorrt_llm/plugins/loraPlugin/loraPlugin.h"
 #include "tensorrt_llm/plugins/mixtureOfExperts/mixtureOfExpertsPlugin.h"
 #if ENABLE_MULTI_DEVICE
 #include "tensorrt_llm/plugins/ncclPlugin/allgatherPlugin.h"
 #include "tensorrt_llm/plugins/ncclPlugin/allreducePlugin.h"
+#include "tensorrt_llm/plugins/ncclPlugin/gemmAllreducePlugin.h"
 #include "tensorrt_llm/plugins/ncclPlugin/recvPlugin.h"
 #include "tensorrt_llm/plugins/ncclPlugin/reduceScatterPlugin.h"
 #include "tensorrt_llm/plugins/ncclPlugin/sendPlugin.h"
 #endif // ENABLE_MULTI_DEVICE
 #include "tensorrt_llm/plugins/quantizePerTokenPlugin/quantizePerTokenPlugin.h"
 #include "tensorrt_llm/plugins/quantizeTensorPlugin/quantizeTensorPlugin.h"
+#include "tensorrt_llm/plugins/residualRmsnormPlugin/residualRmsnormPlugin.h"
 #include "tensorrt_llm/plugins/rmsnormPlugin/rmsnormPlugin.h"
 #include "tensorrt_llm/plugins/rmsnormQuantizationPlugin/rmsnormQuantizationPlugin.h"
 #include "tensorrt_llm/plugins/smoothQuantGemmPlugin/smoothQuantGemmPlugin.h"
+#include "tensorrt_llm/plugins/w4a8GemmPlugin/w4a8GemmPlugin.h"
 #include "tensorrt_llm/plugins/weightOnlyGroupwiseQuantMatmulPlugin/weightOnlyGroupwiseQuantMatmulPlugin.h"
 #include "tensorrt_llm/plugins/weightOnlyQuantMatmulPlugin/weightOnlyQuantMatmulPlugin.h"
 
+#include <algorithm>
 #include <array>
 #include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <string>
 
 #include <NvInferRuntime.h>
 
@@ -88,6 +105,38 @@ void initOnLoad()
 
 bool pluginsInitialized = false;
 
+using Clock = std::chrono::steady_clock;
+
+struct WarmupResult
+{
+    // Kept alive until the plugins share it
+    std::shared_ptr<void> handle;
+    double timeMs;
+    Clock::time_point end;
+};
+
+double elapsedMs(Clock::time_point start, Clock::time_point end = Clock::now())
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Runs a part of the warmup on a thread of its own, once the CUDA context of the device exists
+template <typename Func>
+std::future<WarmupResult> launchWarmup(int device, Func func)
+{
+    return std::async(std::launch::async,
+        [device, func]()
+        {
+            TLLM_CUDA_CHECK(cudaSetDevice(device));
+            // The context is created by the first thread, the others wait for it
+            TLLM_CUDA_CHECK(cudaFree(nullptr));
+            auto const start = Clock::now();
+            auto handle = func();
+            auto const end = Clock::now();
+            return WarmupResult{std::move(handle), elapsedMs(start, end), end};
+        });
+}
+
 } // namespace
 
 // New Plugin APIs
@@ -144,19 +193,28 @@ extern "C"
         static tensorrt_llm::plugins::AllreducePluginCreator allreducePluginCreator;
         static tensorrt_llm::plugins::AllgatherPluginCreator allgatherPluginCreator;
         static tensorrt_llm::plugins::ReduceScatterPluginCreator reduceScatterPluginCreator;
+        static tensorrt_llm::plugins::GemmAllreducePluginCreator gemmAllreducePluginCreator;
 #endif // ENABLE_MULTI_DEVICE
         static tensorrt_llm::plugins::LayernormPluginCreator layernormPluginCreator;
         static tensorrt_llm::plugins::RmsnormPluginCreator rmsnormPluginCreator;
         static tensorrt_llm::plugins::SmoothQuantGemmPluginCreator smoothQuantGemmPluginCreator;
+#ifdef ENABLE_FP8
+        static tensorrt_llm::plugins::Fp8GemmPluginCreator fp8GemmPluginCreator;
+#endif // ENABLE_FP8
         static tensorrt_llm::plugins::LayernormQuantizationPluginCreator layernormQuantizationPluginCreator;
         static tensorrt_llm::plugins::QuantizePerTokenPluginCreator quantizePerTokenPluginCreator;
         static tensorrt_llm::plugins::QuantizeTensorPluginCreator quantizeTensorPluginCreator;
         static tensorrt_llm::plugins::RmsnormQuantizationPluginCreator rmsnormQuantizationPluginCreator;
+        static tensorrt_llm::plugins::ResidualRmsnormPluginCreator residualRmsnormPluginCreator;
+        static tensorrt_llm::plugins::GatedActivationPluginCreator gatedActivationPluginCreator;
         static tensorrt_llm::plugins::WeightOnlyGroupwiseQuantMatmulPluginCreator
             weightOnlyGroupwiseQuantMatmulPluginCreator;
         static tensorrt_llm::plugins::WeightOnlyQuantMatmulPluginCreator weightOnlyQuantMatmulPluginCreator;
+        static tensorrt_llm::plugins::W4A8GemmPluginCreator w4a8GemmPluginCreator;
         static tensorrt_llm::plugins::LookupPluginCreator lookupPluginCreator;
         static tensorrt_llm::plugins::LoraPluginCreator loraPluginCreator;
+        static tensorrt_llm::plugins::LmHeadTopKPluginCreator lmHeadTopKPluginCreator;
+        static tensorrt_llm::plugins::GroupedGemmPluginCreator groupedGemmPluginCreator;
 
         static std::array pluginCreators
             = { creatorPtr(identityPluginCreator),
@@ -170,18 +228,27 @@ extern "C"
                   creatorPtr(allreducePluginCreator),
                   creatorPtr(allgatherPluginCreator),
                   creatorPtr(reduceScatterPluginCreator),
+                  creatorPtr(gemmAllreducePluginCreator),
 #endif // ENABLE_MULTI_DEVICE
                   creatorPtr(layernormPluginCreator),
                   creatorPtr(rmsnormPluginCreator),
                   creatorPtr(smoothQuantGemmPluginCreator),
+#ifdef ENABLE_FP8
+                  creatorPtr(fp8GemmPluginCreator),
+#endif // ENABLE_FP8
                   creatorPtr(layernormQuantizationPluginCreator),
                   creatorPtr(quantizePerTokenPluginCreator),
                   creatorPtr(quantizeTensorPluginCreator),
                   creatorPtr(rmsnormQuantizationPluginCreator),
+                  creatorPtr(residualRmsnormPluginCreator),
+                  creatorPtr(gatedActivationPluginCreator),
                   creatorPtr(weightOnlyGroupwiseQuantMatmulPluginCreator),
                   creatorPtr(weightOnlyQuantMatmulPluginCreator),
+                  creatorPtr(w4a8GemmPluginCreator),
                   creatorPtr(lookupPluginCreator),
                   creatorPtr(loraPluginCreator),
+                  creatorPtr(lmHeadTopKPluginCreator),
+                  creatorPtr(groupedGemmPluginCreator),
               };
         nbCreators = pluginCreators.size();
         return pluginCreators.data();
@@ -215,4 +282,87 @@ nvinfer1::ILogger* LoggerFinder::findLogger()
     }
     return nullptr;
 }
+
+struct PluginWarmup::Task
+{
+    char const* name;
+    std::future<WarmupResult> result;
+};
+
+PluginWarmup::PluginWarmup(int device)
+    : mStart{Clock::now()}
+{
+    namespace tk = tensorrt_llm::kernels;
+
+    mTasks.push_back(Task{"CUDA context",
+        std::async(std::launch::async,
+            [device, start = mStart]()
+            {
+                TLLM_CUDA_CHECK(cudaSetDevice(device));
+                TLLM_CUDA_CHECK(cudaFree(nullptr));
+                auto const end = Clock::now();
+                return WarmupResult{nullptr, elapsedMs(start, end), end};
+            })});
+    mTasks.push_back(
+        Task{"cuBLAS", launchWarmup(device, []() -> std::shared_ptr<void> { return getCublasHandle(); })});
+    mTasks.push_back(
+        Task{"cuBLASLt", launchWarmup(device, []() -> std::shared_ptr<void> { return getCublasLtHandle(); })});
+    mTasks.push_back(Task{"FMHA kernels",
+        launchWarmup(device,
+            []() -> std::shared_ptr<void>
+            {
+                auto const sm = tc::getSMVersion();
+                for (auto const dataType : {tk::DATA_TYPE_FP16, tk::DATA_TYPE_BF16})
+                {
+                    tk::FusedMHARunnerV2::loadKernels(dataType, sm);
+                }
+                return nullptr;
+            })});
+    // The GPT attention plugin only uses the XQA kernels with TRTLLM_ENABLE_XQA=1, for FP16
+    auto const* const enableXqa = std::getenv("TRTLLM_ENABLE_XQA");
+    if (enableXqa != nullptr && std::strcmp(enableXqa, "1") == 0)
+    {
+        mTasks.push_back(Task{"XQA kernels",
+            launchWarmup(device,
+                []() -> std::shared_ptr<void>
+                {
+                    tk::DecoderXQARunner::loadKernels(tk::DATA_TYPE_FP16, tc::getSMVersion());
+                    return nullptr;
+                })});
+    }
+}
+
+PluginWarmup::~PluginWarmup() = default;
+
+void PluginWarmup::wait()
+{
+    std::string times;
+    auto end = mStart;
+    for (auto& task : mTasks)
+    {
+        if (!task.result.valid())
+        {
+            continue;
+        }
+        try
+        {
+            auto result = task.result.get();
+            if (result.handle)
+            {
+                mHandles.push_back(std::move(result.handle));
+            }
+            times += tc::fmtstr(", %s %.0f ms", task.name, result.timeMs);
+            end = std::max(end, result.end);
+        }
+        catch (std::exception const& e)
+        {
+            TLLM_LOG_WARNING("Plugin warmup of the %s failed: %s", task.name, e.what());
+        }
+    }
+    if (!times.empty())
+    {
+        TLLM_LOG_INFO("Warmed up the plugins in %.0f ms%s", elapsedMs(mStart, end), times.c_str());
+    }
+}
+
 } // namespace tensorrt_llm::plugins::api
@@ -17,7 +17,10 @@
 #pragma once
 
 #include <NvInferRuntime.h>
+#include <chrono>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 namespace tensorrt_llm::plugins::api
 {
@@ -42,6 +45,34 @@ private:
     std::mutex mMutex;
 };
 
+//! Initializes on worker threads what the plugins of an engine otherwise initialize one after the other on the main
+//! thread when the engine is deserialized: the CUDA context of the device, the cuBLAS and cuBLASLt handles shared by
+//! the plugins and the cubins of the FMHA and XQA kernels. Created before a GptSession or a GptManager, it overlaps
+//! with the deserialization of the engine and the allocation of the KV cache, and the plugins find everything ready.
+//! The handles are kept until destruction, so that they are not destroyed before the plugins take them.
+class PluginWarmup
+{
+public:
+    explicit PluginWarmup(int device);
+
+    //! Waits for the warmup without reporting.
+    ~PluginWarmup();
+
+    PluginWarmup(PluginWarmup const&) = delete;
+    PluginWarmup& operator=(PluginWarmup const&) = delete;
+
+    //! Waits for the warmup and logs the time of each of its parts. A part that fails is logged as a warning, the
+    //! plugins initialize it again when they need it.
+    void wait();
+
+private:
+    struct Task;
+
+    std::vector<Task> mTasks;
+    std::vector<std::shared_ptr<void>> mHandles;
+    std::chrono::steady_clock::time_point mStart;
+};
+
 } // namespace tensorrt_llm::plugins::api
 
 extern "C"
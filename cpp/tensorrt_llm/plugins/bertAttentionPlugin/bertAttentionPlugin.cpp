@@ -47,8 +47,8 @@ BertAttentionPlugin::BertAttentionPlugin(int num_heads, int head_size, float q_s
     , mRemovePadding(remove_padding)
 {
     // pre-check whether FMHA is supported in order to save memory allocation
-    mEnableContextFMHA = mEnableContextFMHA && (mType == DataType::kHALF) && MHARunner::fmha_supported(mHeadSize, mSM)
-        && !mRelativeAttention;
+    mEnableContextFMHA = mEnableContextFMHA && (mType == DataType::kHALF || mType == DataType::kBF16)
+        && MHARunner::fmha_supported(mHeadSize, mSM) && !mRelativeAttention;
 }
 
 // Parameterized constructor
@@ -135,16 +135,18 @@ size_t BertAttentionPlugin::getWorkspaceSize(const nvinfer1::PluginTensorDesc* i
     const int local_hidden_units_ = inputs[0].dims.d[mRemovePadding ? 1 : 2] / 3;
 
     auto const size = tensorrt_llm::runtime::BufferDataType(inputs[0].type).getSize();
+    // packed inputs run the fused or the packed attention, only padded inputs need the buffers of the unfused one
+    const bool padded_buffers = !mEnableContextFMHA && !mRemovePadding;
 
-    const size_t attention_mask_size = mEnableContextFMHA ? 0 : size * batch_size * input_seq_len * input_seq_len;
+    const size_t attention_mask_size = padded_buffers ? size * batch_size * input_seq_len * input_seq_len : 0;
     const size_t cu_seqlens_size = sizeof(int) * (batch_size + 1);
-    const size_t q_buf_2_size = mEnableContextFMHA ? 0 : size * batch_size * input_seq_len * local_hidden_units_;
-    const size_t k_buf_2_size = mEnableContextFMHA ? 0 : size * batch_size * input_seq_len * local_hidden_units_;
-    const size_t v_buf_2_size = mEnableContextFMHA ? 0 : size * batch_size * input_seq_len * local_hidden_units_;
-    const size_t qk_buf_size = mEnableContextFMHA ? 0 : size * batch_size * mNumHeads * input_seq_len * input_seq_len;
-    const size_t qkv_buf_2_size = mEnableContextFMHA ? 0 : size * batch_size * input_seq_len * local_hidden_units_;
+    const size_t q_buf_2_size = padded_buffers ? size * batch_size * input_seq_len * local_hidden_units_ : 0;
+    const size_t k_buf_2_size = padded_buffers ? size * batch_size * input_seq_len * local_hidden_units_ : 0;
+    const size_t v_buf_2_size = padded_buffers ? size * batch_size * input_seq_len * local_hidden_units_ : 0;
+    const size_t qk_buf_size = padded_buffers ? size * batch_size * mNumHeads * input_seq_len * input_seq_len : 0;
+    const size_t qkv_buf_2_size = padded_buffers ? size * batch_size * input_seq_len * local_hidden_units_ : 0;
     const size_t qk_buf_float_size
-        = mEnableContextFMHA ? 0 : sizeof(float) * batch_size * mNumHeads * input_seq_len * input_seq_len;
+        = padded_buffers ? sizeof(float) * batch_size * mNumHeads * input_seq_len * input_seq_len : 0;
     const size_t padding_offset_size = sizeof(int) * batch_size * input_seq_len;
 
     const int NUM_BUFFERS = 10;
@@ -212,16 +214,17 @@ int BertAttentionPlugin::enqueueImpl(const nvinfer1::PluginTensorDesc* inputDesc
     }
 #endif
 
-    const size_t attention_mask_size = mEnableContextFMHA ? 0 : sizeof(T) * batch_size * input_seq_len * input_seq_len;
+    const bool padded_buffers = !mEnableContextFMHA && !mRemovePadding;
+    const size_t attention_mask_size = padded_buffers ? sizeof(T) * batch_size * input_seq_len * input_seq_len : 0;
     const size_t cu_seqlens_size = sizeof(int) * (batch_size + 1);
-    const size_t q_buf_2_size = mEnableContextFMHA ? 0 : sizeof(T) * batch_size * input_seq_len * local_hidden_units_;
-    const size_t k_buf_2_size = mEnableContextFMHA ? 0 : sizeof(T) * batch_size * input_seq_len * local_hidden_units_;
-    const size_t v_buf_2_size = mEnableContextFMHA ? 0 : sizeof(T) * batch_size * input_seq_len * local_hidden_units_;
+    const size_t q_buf_2_size = padded_buffers ? sizeof(T) * batch_size * input_seq_len * local_hidden_units_ : 0;
+    const size_t k_buf_2_size = padded_buffers ? sizeof(T) * batch_size * input_seq_len * local_hidden_units_ : 0;
+    const size_t v_buf_2_size = padded_buffers ? sizeof(T) * batch_size * input_seq_len * local_hidden_units_ : 0;
     const size_t qk_buf_size
-        = mEnableContextFMHA ? 0 : sizeof(T) * batch_size * mNumHeads * input_seq_len * input_seq_len;
-    const size_t qkv_buf_2_size = mEnableContextFMHA ? 0 : sizeof(T) * batch_size * input_seq_len * local_hidden_units_;
+        = padded_buffers ? sizeof(T) * batch_size * mNumHeads * input_seq_len * input_seq_len : 0;
+    const size_t qkv_buf_2_size = padded_buffers ? sizeof(T) * batch_size * input_seq_len * local_hidden_units_ : 0;
     const size_t qk_buf_float_size
-        = mEnableContextFMHA ? 0 : sizeof(float) * batch_size * mNumHeads * input_seq_len * input_seq_len;
+        = padded_buffers ? sizeof(float) * batch_size * mNumHeads * input_seq_len * input_seq_len : 0;
     const size_t padding_offset_size = sizeof(int) * batch_size * input_seq_len;
 
     // Workspace pointer shift
@@ -269,19 +272,25 @@ int BertAttentionPlugin::enqueueImpl(const nvinfer1::PluginTensorDesc* inputDesc
 
     // FMHA doesn't apply to MHA with relative attention bias, i.e. softmax(QK + bias) * V
     // We update mEnableContextFMHA in constructor to check this condition
-    if (mEnableContextFMHA)
+    if (mEnableContextFMHA && (!mRemovePadding || mFMHARunner->isValid(request_seq_len)))
     {
         // b, max_seqlen, actual_total_seqlen
-        mFMHARunner->setup(request_batch_size, request_seq_len, request_seq_len, request_batch_size * request_seq_len);
+        mFMHARunner->setup(request_batch_size, request_seq_len, request_seq_len, num_tokens);
         mFMHARunner->run(const_cast<T*>(attention_input), cu_seqlens, context_buf_, stream);
     }
+    else if (mRemovePadding)
+    {
+        // without padding for the relative attention, the head sizes and the SMs the cubins don't cover
+        invokePackedAttention(context_buf_, attention_input, cu_seqlens, padding_offset, relative_attn_table,
+            num_tokens, input_seq_len, mNumHeads, mHeadSize, qk_scale, mMaxDistance > 0,
+            mRelativeAttention ? inputDesc[3].dims.d[1] : 0, mMaxDistance, stream);
+    }
     else
     {
         // only non-FMHA path needs to split Q,K,V from QKV
         invokeAddFusedQKVBiasTranspose(q_buf_2_, k_buf_2_, v_buf_2_, const_cast<T*>(attention_input), input_lengths,
-            mRemovePadding ? padding_offset : nullptr, batch_size, input_seq_len, num_tokens, mNumHeads, mNumHeads,
-            mHeadSize, 0, 0.0f, RotaryScalingType::kNONE, 0.0f, 0, PositionEmbeddingType::kLEARNED_ABSOLUTE,
-            (float*) nullptr, 0, stream);
+            nullptr, batch_size, input_seq_len, num_tokens, mNumHeads, mNumHeads, mHeadSize, 0, 0.0f,
+            RotaryScalingType::kNONE, 0.0f, 0, PositionEmbeddingType::kLEARNED_ABSOLUTE, (float*) nullptr, 0, stream);
 
         if (!mQKHalfAccum && gemm_data_type != CUDA_R_32F)
         {
@@ -365,16 +374,8 @@ int BertAttentionPlugin::enqueueImpl(const nvinfer1::PluginTensorDesc* inputDesc
             attention_seq_len_1 * attention_seq_len_2, qkv_buf_2_, mHeadSize, attention_seq_len_1 * mHeadSize,
             request_batch_size * mNumHeads);
 
-        if (!mRemovePadding)
-        {
-            invokeTransposeQKV(context_buf_, qkv_buf_2_, request_batch_size, attention_seq_len_1, mNumHeads, mHeadSize,
-                (float*) nullptr, 0, stream);
-        }
-        else
-        {
-            invokeTransposeAttentionOutRemovePadding(qkv_buf_2_, context_buf_, num_tokens, request_batch_size,
-                request_seq_len, mNumHeads, mHeadSize, padding_offset, (float*) nullptr, 0, stream);
-        }
+        invokeTransposeQKV(context_buf_, qkv_buf_2_, request_batch_size, attention_seq_len_1, mNumHeads, mHeadSize,
+            (float*) nullptr, 0, stream);
     }
     return 0;
 }
@@ -446,9 +447,10 @@ int BertAttentionPlugin::initialize() noexcept
     mCublasWrapper.reset(new tc::CublasMMWrapper(cublasHandle, cublasLtHandle, nullptr, nullptr));
     if (mEnableContextFMHA)
     {
-        mFMHARunner.reset(new FusedMHARunnerV2(DATA_TYPE_FP16, mNumHeads, mHeadSize, mQScaling));
+        auto const dataType = mType == DataType::kBF16 ? DATA_TYPE_BF16 : DATA_TYPE_FP16;
+        mFMHARunner.reset(new FusedMHARunnerV2(dataType, mNumHeads, mHeadSize, mQScaling));
         // set flags: force_fp32_acc, is_s_padded, causal_mask, num_kv_heads = num_heads
-        mFMHARunner->setup_flags(mFMHAForceFP32Acc, true, false, mNumHeads);
+        mFMHARunner->setup_flags(mFMHAForceFP32Acc, !mRemovePadding, false, mNumHeads);
     }
 
     return 0;
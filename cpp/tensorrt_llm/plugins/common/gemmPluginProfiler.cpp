@@ -17,13 +17,29 @@
 
 #include "tensorrt_llm/plugins/common/gemmPluginProfiler.h"
 #include "tensorrt_llm/common/cublasMMWrapper.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/kernels/cutlass_kernels/fp8_gemm/fp8_gemm.h"
 #include "tensorrt_llm/kernels/cutlass_kernels/fpA_intB_gemm/fpA_intB_gemm.h"
 #include "tensorrt_llm/kernels/cutlass_kernels/int8_gemm/int8_gemm.h"
 #include "tensorrt_llm/plugins/mixtureOfExperts/mixtureOfExpertsPlugin.h"
 
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <functional>
+#include <sys/file.h>
+#include <typeinfo>
+#include <unistd.h>
+
 namespace tensorrt_llm::plugins
 {
 
+namespace
+{
+// Bump when the layout of the cache files or the meaning of the cached configs changes.
+constexpr int kGemmProfileCacheVersion = 1;
+} // namespace
+
 template <typename Config, typename RunnerPtr, typename GemmIdType, typename GemmIdHashType>
 GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::GemmPluginProfiler()
 {
@@ -38,6 +54,14 @@ GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::GemmPluginPro
             "SKIP_GEMM_PLUGIN_PROFILINGS is set. Skipping GEMM plugin profilings. It could result in runtime error "
             "if default tactic is not defined.");
     }
+
+    // set TRTLLM_GEMM_PROFILE_CACHE_DIR=<dir> to reuse the tactics profiled by earlier builds and to look up the
+    // Ms missing from the engine at runtime
+    const auto cacheDirEnv = std::getenv("TRTLLM_GEMM_PROFILE_CACHE_DIR");
+    if (cacheDirEnv != NULL)
+    {
+        mCacheDir = cacheDirEnv;
+    }
 }
 
 template <typename Config, typename RunnerPtr, typename GemmIdType, typename GemmIdHashType>
@@ -123,29 +147,53 @@ void GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::profileT
 
     auto mProfileMap = mMNKProfileMap->getMProfileMap(gemmId);
 
-    auto profileTactics = [&mProfileMap, this](int m, int n, int k)
+    std::string cacheKey;
+    if (!mCacheDir.empty())
+    {
+        cacheKey = getCacheKey(gemmId);
+        for (const auto& pair : readCache(cacheKey))
+        {
+            mProfileMap->insert(pair);
+        }
+    }
+
+    std::vector<int> msToProfile;
+    const int startMinMRounded = nextPowerOfTwo(dims.minM);
+    for (int m = startMinMRounded; m < maxM; m *= 2)
     {
         if (mProfileMap->count(m) == 0)
         {
-            initTmpData(m, n, k, mWorkspaceTmp, mTmpWorkspaceSizeInBytes, cudaStreamDefault);
-            const auto tactics = this->getTactics(m, n, k);
-            // Profile different tactics for particular m and insert best config to the map
-            mProfileMap->insert({m, this->profileTacticsForProblem(m, n, k, tactics)});
+            msToProfile.push_back(m);
         }
-    };
+    }
+    if (mProfileMap->count(maxM) == 0)
+    {
+        msToProfile.push_back(maxM);
+    }
+
+    if (msToProfile.empty())
+    {
+        return;
+    }
 
     // Allocate tmp data to run GEMMs
     allocateTmpData();
 
-    const int startMinMRounded = nextPowerOfTwo(dims.minM);
-    for (int m = startMinMRounded; m < maxM; m *= 2)
+    for (const int m : msToProfile)
     {
-        profileTactics(m, dims.n, dims.k);
+        initTmpData(m, dims.n, dims.k, mWorkspaceTmp, mTmpWorkspaceSizeInBytes, cudaStreamDefault);
+        const auto tactics = getTactics(m, dims.n, dims.k);
+        // Profile different tactics for particular m and insert best config to the map
+        mProfileMap->insert({m, profileTacticsForProblem(m, dims.n, dims.k, tactics)});
     }
 
-    profileTactics(maxM, dims.n, dims.k);
     // Free tmp data
     freeTmpData();
+
+    if (!mCacheDir.empty())
+    {
+        writeCache(cacheKey, *mProfileMap);
+    }
 }
 
 template <typename Config, typename RunnerPtr, typename GemmIdType, typename GemmIdHashType>
@@ -160,7 +208,129 @@ std::optional<Config> GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHa
     }
 
     const int mRounded = std::min(nextPowerOfTwo(m), MAX_PROFILE_M);
-    return mMNKProfileMap->getMProfileMap(gemmId)->at(mRounded);
+    const auto profileMap = mMNKProfileMap->getMProfileMap(gemmId);
+    if (profileMap->count(mRounded) == 0 && !mCacheDir.empty())
+    {
+        // The engine was built for smaller Ms, the tactic may have been profiled by another build
+        for (const auto& pair : readCache(getCacheKey(gemmId)))
+        {
+            profileMap->insert(pair);
+        }
+    }
+    return profileMap->at(mRounded);
+}
+
+template <typename Config, typename RunnerPtr, typename GemmIdType, typename GemmIdHashType>
+std::string GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::getCacheKey(
+    const GemmIdType& gemmId) const
+{
+    // The configs are only valid for the same kind of runner, GPU and libraries they were profiled with
+    std::ostringstream key;
+    key << "profiler=" << typeid(*this).name() << "; tag=" << getCacheTag() << "; id=" << gemmId
+        << "; sm=" << tensorrt_llm::common::getSMVersion() << "; cuda=" << CUDART_VERSION
+        << "; trt=" << NV_TENSORRT_MAJOR << "." << NV_TENSORRT_MINOR << "." << NV_TENSORRT_PATCH
+        << "; config=" << sizeof(Config) << "; version=" << kGemmProfileCacheVersion;
+    return key.str();
+}
+
+template <typename Config, typename RunnerPtr, typename GemmIdType, typename GemmIdHashType>
+std::string GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::getCachePath(
+    const std::string& key) const
+{
+    std::ostringstream path;
+    path << mCacheDir << "/gemm_tactics_" << std::hex << std::hash<std::string>{}(key) << ".bin";
+    return path.str();
+}
+
+template <typename Config, typename RunnerPtr, typename GemmIdType, typename GemmIdHashType>
+typename GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::MProfileMap
+GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::readCache(const std::string& key) const
+{
+    MProfileMap profileMap;
+    std::ifstream file(getCachePath(key), std::ios::binary);
+    if (!file)
+    {
+        return profileMap;
+    }
+
+    // File layout: [key size][key][number of profiles][pairs of M and the best config]
+    size_t keySize = 0;
+    file.read(reinterpret_cast<char*>(&keySize), sizeof(keySize));
+    if (!file || keySize != key.size())
+    {
+        return profileMap;
+    }
+    std::string fileKey(keySize, '\0');
+    file.read(fileKey.data(), fileKey.size());
+    if (!file || fileKey != key)
+    {
+        // Written by another configuration whose key has the same hash, or truncated
+        return profileMap;
+    }
+
+    int numProfiles = 0;
+    file.read(reinterpret_cast<char*>(&numProfiles), sizeof(numProfiles));
+    for (int ii = 0; ii < numProfiles && file; ++ii)
+    {
+        std::pair<int, std::optional<Config>> config;
+        file.read(reinterpret_cast<char*>(&config), sizeof(config));
+        if (file)
+        {
+            profileMap.insert(config);
+        }
+    }
+    TLLM_LOG_DEBUG("Read %d GEMM tactics from %s", static_cast<int>(profileMap.size()), getCachePath(key).c_str());
+    return profileMap;
+}
+
+template <typename Config, typename RunnerPtr, typename GemmIdType, typename GemmIdHashType>
+void GemmPluginProfiler<Config, RunnerPtr, GemmIdType, GemmIdHashType>::writeCache(
+    const std::string& key, const MProfileMap& profileMap) const
+{
+    const auto path = getCachePath(key);
+    // Builds running concurrently merge their tactics one after the other, none of them are lost
+    const auto lockPath = path + ".lock";
+    const auto lockFd = open(lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (lockFd >= 0)
+    {
+        flock(lockFd, LOCK_EX);
+    }
+
+    // Keep the Ms profiled by other builds since the file was read
+    auto mergedMap = readCache(key);
+    for (const auto& pair : profileMap)
+    {
+        mergedMap.insert_or_assign(pair.first, pair.second);
+    }
+
+    // Write to a file private to this process and rename it so readers never see a partial file
+    std::ostringstream tmpPath;
+    tmpPath << path << ".tmp." << getpid() << "." << this;
+    bool written = false;
+    {
+        std::ofstream file(tmpPath.str(), std::ios::binary | std::ios::trunc);
+        const size_t keySize = key.size();
+        const int numProfiles = static_cast<int>(mergedMap.size());
+        file.write(reinterpret_cast<const char*>(&keySize), sizeof(keySize));
+        file.write(key.data(), key.size());
+        file.write(reinterpret_cast<const char*>(&numProfiles), sizeof(numProfiles));
+        for (const auto& pair : mergedMap)
+        {
+            const std::pair<int, std::optional<Config>> config{pair.first, pair.second};
+            file.write(reinterpret_cast<const char*>(&config), sizeof(config));
+        }
+        written = static_cast<bool>(file);
+    }
+    if (!written || std::rename(tmpPath.str().c_str(), path.c_str()) != 0)
+    {
+        TLLM_LOG_WARNING("Cannot write the GEMM tactic cache %s", path.c_str());
+        std::remove(tmpPath.str().c_str());
+    }
+    if (lockFd >= 0)
+    {
+        // Closing the file releases the lock
+        close(lockFd);
+    }
 }
 
 template <typename Config, typename RunnerPtr, typename GemmIdType, typename GemmIdHashType>
@@ -280,6 +450,12 @@ template class GemmPluginProfiler<tensorrt_llm::cutlass_extensions::CutlassGemmC
     std::shared_ptr<tensorrt_llm::kernels::cutlass_kernels::CutlassFpAIntBGemmRunnerInterface>, GemmIdCore,
     GemmIdCoreHash>;
 
+#ifdef ENABLE_FP8
+template class GemmPluginProfiler<tensorrt_llm::cutlass_extensions::CutlassGemmConfig,
+    std::shared_ptr<tensorrt_llm::kernels::cutlass_kernels::CutlassFp8GemmRunnerInterface>, GemmIdCore,
+    GemmIdCoreHash>;
+#endif // ENABLE_FP8
+
 template class GemmPluginProfiler<cublasLtMatmulHeuristicResult_t,
     std::shared_ptr<tensorrt_llm::common::CublasMMWrapper>, GemmIdCublas, GemmIdCublasHash>;
 
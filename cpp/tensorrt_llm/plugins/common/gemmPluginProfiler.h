@@ -20,8 +20,10 @@
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <shared_mutex>
 #include <sstream>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -251,6 +253,13 @@ protected:
 
     virtual void initTmpData(int m, int n, int k, char* workspace, size_t size, cudaStream_t stream){};
 
+    // Extra state the tactics depend on besides the GEMM ID, e.g. the weight type or the library version.
+    // Part of the key of the on-disk tactic cache.
+    virtual std::string getCacheTag() const
+    {
+        return "";
+    }
+
 private:
     void allocateTmpData();
 
@@ -260,6 +269,16 @@ private:
 
     float profileTacticForProblem(int m, int n, int k, const Config& tactic);
 
+    // On-disk tactic cache enabled with TRTLLM_GEMM_PROFILE_CACHE_DIR. One file per cache key holding the best config
+    // for each profiled M, shared by all the plugins, engine builds and runs using the same directory.
+    std::string getCacheKey(const GemmIdType& gemmId) const;
+
+    std::string getCachePath(const std::string& key) const;
+
+    MProfileMap readCache(const std::string& key) const;
+
+    void writeCache(const std::string& key, const MProfileMap& profileMap) const;
+
     int nextPowerOfTwo(int v) const
     {
         --v;
@@ -286,6 +305,8 @@ private:
     GemmDims mDims{};
 
     bool mSkip{false};
+
+    std::string mCacheDir{};
 };
 
 template <typename GemmPluginProfilerType>
@@ -0,0 +1,340 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gatedActivationPlugin.h"
+#include "tensorrt_llm/common/assert.h"
+
+#include <cstring>
+#include <optional>
+
+using namespace nvinfer1;
+using namespace tensorrt_llm::kernels;
+using namespace tensorrt_llm::common;
+using tensorrt_llm::plugins::GatedActivationPluginCreator;
+using tensorrt_llm::plugins::GatedActivationPlugin;
+
+static const char* GATED_ACTIVATION_PLUGIN_VERSION{"1"};
+static const char* GATED_ACTIVATION_PLUGIN_NAME{"GatedActivation"};
+PluginFieldCollection GatedActivationPluginCreator::mFC{};
+std::vector<nvinfer1::PluginField> GatedActivationPluginCreator::mPluginAttributes;
+
+GatedActivationPlugin::GatedActivationPlugin(nvinfer1::DataType type, nvinfer1::DataType outType,
+    GatedActivationType activation, bool hasSmoother, bool dynamicActivationScaling)
+    : mType(type)
+    , mOutType(outType)
+    , mActivation(activation)
+    , mHasSmoother(hasSmoother)
+    , mDynActScaling(dynamicActivationScaling)
+{
+    TLLM_CHECK_WITH_INFO(mOutType == mType || mOutType == DataType::kINT8 || mOutType == DataType::kFP8,
+        "The output of the gated activation must have the type of the input, int8 or fp8");
+    TLLM_CHECK_WITH_INFO(!mDynActScaling || mOutType == DataType::kINT8, "Dynamic scaling requires an int8 output");
+    TLLM_CHECK_WITH_INFO(mActivation == GatedActivationType::kSILU || mActivation == GatedActivationType::kGELU,
+        "Unsupported gated activation %d", static_cast<int>(mActivation));
+}
+
+// Parameterized constructor
+GatedActivationPlugin::GatedActivationPlugin(const void* data, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(data), *a = d;
+    read(d, mType);
+    read(d, mOutType);
+    read(d, mActivation);
+    read(d, mHasSmoother);
+    read(d, mDynActScaling);
+    TLLM_CHECK(d == a + length);
+}
+
+// IPluginV2DynamicExt Methods
+nvinfer1::IPluginV2DynamicExt* GatedActivationPlugin::clone() const noexcept
+{
+    auto* plugin = new GatedActivationPlugin(mType, mOutType, mActivation, mHasSmoother, mDynActScaling);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+nvinfer1::DimsExprs GatedActivationPlugin::getOutputDimensions(
+    int outputIndex, const nvinfer1::DimsExprs* inputs, int nbInputs, nvinfer1::IExprBuilder& exprBuilder) noexcept
+{
+    try
+    {
+        TLLM_CHECK(outputIndex < getNbOutputs());
+        DimsExprs ret = inputs[0];
+        auto const last = ret.nbDims - 1;
+        // The output has half the columns of [gate|up], the dynamic scales one per row
+        ret.d[last] = outputIndex == 0
+            ? exprBuilder.operation(DimensionOperation::kFLOOR_DIV, *inputs[0].d[last], *exprBuilder.constant(2))
+            : exprBuilder.constant(1);
+        return ret;
+    }
+    catch (const std::exception& e)
+    {
+        caughtError(e);
+    }
+    return DimsExprs{};
+}
+
+bool GatedActivationPlugin::supportsFormatCombination(
+    int pos, const nvinfer1::PluginTensorDesc* inOut, int nbInputs, int nbOutputs) noexcept
+{
+    TLLM_CHECK(nbInputs == getNbInputs());
+    TLLM_CHECK(0 <= pos && pos < nbInputs + getNbOutputs());
+    if (inOut[pos].format != TensorFormat::kLINEAR)
+    {
+        return false;
+    }
+    if (pos == 0)
+    {
+        // gate_up
+        return inOut[pos].type == mType;
+    }
+    if (pos < nbInputs)
+    {
+        // Smoother and scale of the quantized output
+        return inOut[pos].type == DataType::kFLOAT;
+    }
+    return inOut[pos].type == (pos == nbInputs ? mOutType : DataType::kFLOAT);
+}
+
+void GatedActivationPlugin::configurePlugin(const nvinfer1::DynamicPluginTensorDesc* in, int nbInputs,
+    const nvinfer1::DynamicPluginTensorDesc* out, int nbOutputs) noexcept
+{
+}
+
+size_t GatedActivationPlugin::getWorkspaceSize(const nvinfer1::PluginTensorDesc* inputs, int nbInputs,
+    const nvinfer1::PluginTensorDesc* outputs, int nbOutputs) const noexcept
+{
+    return 0;
+}
+
+template <typename T>
+void GatedActivationPlugin::enqueueForType(
+    const nvinfer1::PluginTensorDesc* inputDesc, const void* const* inputs, void* const* outputs, cudaStream_t stream)
+{
+    int m = 1;
+    for (int i = 0; i < inputDesc[0].dims.nbDims - 1; ++i)
+    {
+        m *= inputDesc[0].dims.d[i];
+    }
+    const int n = inputDesc[0].dims.d[inputDesc[0].dims.nbDims - 1] / 2;
+
+    const T* gateUp = reinterpret_cast<const T*>(inputs[0]);
+    int inputIdx = 1;
+    const float* smoother = mHasSmoother ? reinterpret_cast<const float*>(inputs[inputIdx++]) : nullptr;
+    const float* scale = hasStaticScale() ? reinterpret_cast<const float*>(inputs[inputIdx++]) : nullptr;
+    float* dynamicScale = mDynActScaling ? reinterpret_cast<float*>(outputs[1]) : nullptr;
+
+    if (mOutType == DataType::kINT8)
+    {
+        invokeGatedActivation(reinterpret_cast<int8_t*>(outputs[0]), gateUp, m, n, mActivation, stream, smoother,
+            scale, dynamicScale);
+    }
+#ifdef ENABLE_FP8
+    else if (mOutType == DataType::kFP8)
+    {
+        invokeGatedActivation(
+            reinterpret_cast<__nv_fp8_e4m3*>(outputs[0]), gateUp, m, n, mActivation, stream, smoother, scale);
+    }
+#endif
+    else
+    {
+        invokeGatedActivation(reinterpret_cast<T*>(outputs[0]), gateUp, m, n, mActivation, stream, smoother);
+    }
+}
+
+int GatedActivationPlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc,
+    const nvinfer1::PluginTensorDesc* outputDesc, const void* const* inputs, void* const* outputs, void* workspace,
+    cudaStream_t stream) noexcept
+{
+    // inputs
+    //     gate_up [M(*), 2 * N], the gate followed by the up of each row
+    //     smoother [N] (optional)
+    //     scale_to_quant [1] (if the output is quantized without dynamic scaling)
+    // outputs
+    //     output [M(*), N], act(gate) * up / smoother
+    //     dynamic_scaling [M(*), 1] (optional output)
+
+    if (mType == DataType::kHALF)
+    {
+        enqueueForType<half>(inputDesc, inputs, outputs, stream);
+    }
+    else if (mType == DataType::kFLOAT)
+    {
+        enqueueForType<float>(inputDesc, inputs, outputs, stream);
+    }
+#ifdef ENABLE_BF16
+    else if (mType == DataType::kBF16)
+    {
+        enqueueForType<__nv_bfloat16>(inputDesc, inputs, outputs, stream);
+    }
+#endif
+
+    return 0;
+}
+
+// IPluginV2Ext Methods
+nvinfer1::DataType GatedActivationPlugin::getOutputDataType(
+    int index, const nvinfer1::DataType* inputTypes, int nbInputs) const noexcept
+{
+    assert(index < getNbOutputs());
+    return index == 0 ? mOutType : DataType::kFLOAT;
+}
+
+// IPluginV2 Methods
+
+const char* GatedActivationPlugin::getPluginType() const noexcept
+{
+    return GATED_ACTIVATION_PLUGIN_NAME;
+}
+
+const char* GatedActivationPlugin::getPluginVersion() const noexcept
+{
+    return GATED_ACTIVATION_PLUGIN_VERSION;
+}
+
+int GatedActivationPlugin::getNbOutputs() const noexcept
+{
+    return 1 + static_cast<int>(mDynActScaling);
+}
+
+int GatedActivationPlugin::initialize() noexcept
+{
+    return 0;
+}
+
+void GatedActivationPlugin::terminate() noexcept {}
+
+size_t GatedActivationPlugin::getSerializationSize() const noexcept
+{
+    return sizeof(mType) + sizeof(mOutType) + sizeof(mActivation) + sizeof(mHasSmoother) + sizeof(mDynActScaling);
+}
+
+void GatedActivationPlugin::serialize(void* buffer) const noexcept
+{
+    char *d = static_cast<char*>(buffer), *a = d;
+    write(d, mType);
+    write(d, mOutType);
+    write(d, mActivation);
+    write(d, mHasSmoother);
+    write(d, mDynActScaling);
+    assert(d == a + getSerializationSize());
+}
+
+void GatedActivationPlugin::destroy() noexcept
+{
+    // This gets called when the network containing plugin is destroyed
+    delete this;
+}
+
+///////////////
+
+GatedActivationPluginCreator::GatedActivationPluginCreator()
+{
+    // Fill PluginFieldCollection with PluginField arguments metadata
+    mPluginAttributes.clear();
+    mPluginAttributes.emplace_back(PluginField("type_id", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("out_type_id", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("activation", nullptr, PluginFieldType::kINT32, 0));
+    mPluginAttributes.emplace_back(PluginField("has_smoother", nullptr, PluginFieldType::kINT32, 0));
+    mPluginAttributes.emplace_back(PluginField("dyn_act_scaling", nullptr, PluginFieldType::kINT32, 0));
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* GatedActivationPluginCreator::getPluginName() const noexcept
+{
+    return GATED_ACTIVATION_PLUGIN_NAME;
+}
+
+const char* GatedActivationPluginCreator::getPluginVersion() const noexcept
+{
+    return GATED_ACTIVATION_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* GatedActivationPluginCreator::getFieldNames() noexcept
+{
+    return &mFC;
+}
+
+IPluginV2* GatedActivationPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc) noexcept
+{
+    const PluginField* fields = fc->fields;
+    nvinfer1::DataType type{};
+    std::optional<nvinfer1::DataType> outType;
+    GatedActivationType activation{GatedActivationType::kSILU};
+    bool hasSmoother{false};
+    bool dynamicActivationScaling{false};
+    // Read configurations from each fields
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "type_id"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            type = static_cast<nvinfer1::DataType>(*(static_cast<const nvinfer1::DataType*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "out_type_id"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            outType = static_cast<nvinfer1::DataType>(*(static_cast<const nvinfer1::DataType*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "activation"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            activation = static_cast<GatedActivationType>(*(static_cast<const int32_t*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "has_smoother"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            hasSmoother = static_cast<bool>(*(static_cast<const int32_t*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "dyn_act_scaling"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            dynamicActivationScaling = static_cast<bool>(*(static_cast<const int32_t*>(fields[i].data)));
+        }
+    }
+    try
+    {
+        auto* obj = new GatedActivationPlugin(
+            type, outType.value_or(type), activation, hasSmoother, dynamicActivationScaling);
+        obj->setPluginNamespace(mNamespace.c_str());
+        return obj;
+    }
+    catch (const std::exception& e)
+    {
+        caughtError(e);
+    }
+    return nullptr;
+}
+
+IPluginV2* GatedActivationPluginCreator::deserializePlugin(
+    const char* name, const void* serialData, size_t serialLength) noexcept
+{
+    // This object will be deleted when the network is destroyed, which will
+    // call GatedActivationPlugin::destroy()
+    try
+    {
+        auto* obj = new GatedActivationPlugin(serialData, serialLength);
+        obj->setPluginNamespace(mNamespace.c_str());
+        return obj;
+    }
+    catch (const std::exception& e)
+    {
+        caughtError(e);
+    }
+    return nullptr;
+}
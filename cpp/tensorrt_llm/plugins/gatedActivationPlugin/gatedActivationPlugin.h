@@ -0,0 +1,118 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/kernels/gatedActivationKernels.h"
+#include "tensorrt_llm/plugins/common/plugin.h"
+#include <cassert>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm::plugins
+{
+
+//! \brief Gated activation of the output of a [gate|up] GEMM: writes act(gate) * up, optionally divided by the
+//! SmoothQuant smoother and quantized to int8 or fp8 for the next GEMM, in one kernel.
+class GatedActivationPlugin : public BasePlugin
+{
+public:
+    GatedActivationPlugin(nvinfer1::DataType type, nvinfer1::DataType outType,
+        kernels::GatedActivationType activation, bool hasSmoother, bool dynamicActivationScaling);
+
+    GatedActivationPlugin(const void* data, size_t length);
+
+    ~GatedActivationPlugin() override = default;
+
+    // IPluginV2DynamicExt Methods
+    nvinfer1::IPluginV2DynamicExt* clone() const noexcept override;
+    nvinfer1::DimsExprs getOutputDimensions(int outputIndex, const nvinfer1::DimsExprs* inputs, int nbInputs,
+        nvinfer1::IExprBuilder& exprBuilder) noexcept override;
+    bool supportsFormatCombination(
+        int pos, const nvinfer1::PluginTensorDesc* inOut, int nbInputs, int nbOutputs) noexcept override;
+    void configurePlugin(const nvinfer1::DynamicPluginTensorDesc* in, int nbInputs,
+        const nvinfer1::DynamicPluginTensorDesc* out, int nbOutputs) noexcept override;
+    size_t getWorkspaceSize(const nvinfer1::PluginTensorDesc* inputs, int nbInputs,
+        const nvinfer1::PluginTensorDesc* outputs, int nbOutputs) const noexcept override;
+    int enqueue(const nvinfer1::PluginTensorDesc* inputDesc, const nvinfer1::PluginTensorDesc* outputDesc,
+        const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream) noexcept override;
+
+    // IPluginV2Ext Methods
+    nvinfer1::DataType getOutputDataType(
+        int index, const nvinfer1::DataType* inputTypes, int nbInputs) const noexcept override;
+
+    // IPluginV2 Methods
+    const char* getPluginType() const noexcept override;
+    const char* getPluginVersion() const noexcept override;
+    int getNbOutputs() const noexcept override;
+    int initialize() noexcept override;
+    void terminate() noexcept override;
+    size_t getSerializationSize() const noexcept override;
+    void serialize(void* buffer) const noexcept override;
+    void destroy() noexcept override;
+
+private:
+    bool isQuantized() const
+    {
+        return mOutType != mType;
+    }
+
+    bool hasStaticScale() const
+    {
+        return isQuantized() && !mDynActScaling;
+    }
+
+    int getNbInputs() const
+    {
+        // gate_up, the smoother and the static scale of the quantized output
+        return 1 + static_cast<int>(mHasSmoother) + static_cast<int>(hasStaticScale());
+    }
+
+    template <typename T>
+    void enqueueForType(const nvinfer1::PluginTensorDesc* inputDesc, const void* const* inputs, void* const* outputs,
+        cudaStream_t stream);
+
+    nvinfer1::DataType mType;
+    nvinfer1::DataType mOutType;
+    kernels::GatedActivationType mActivation;
+    bool mHasSmoother;
+    bool mDynActScaling;
+
+    const std::string mLayerName;
+};
+
+class GatedActivationPluginCreator : public BaseCreator
+{
+public:
+    GatedActivationPluginCreator();
+
+    const char* getPluginName() const noexcept override;
+
+    const char* getPluginVersion() const noexcept override;
+
+    const nvinfer1::PluginFieldCollection* getFieldNames() noexcept override;
+
+    nvinfer1::IPluginV2* createPlugin(const char* name, const nvinfer1::PluginFieldCollection* fc) noexcept override;
+
+    nvinfer1::IPluginV2* deserializePlugin(
+        const char* name, const void* serialData, size_t serialLength) noexcept override;
+
+private:
+    static nvinfer1::PluginFieldCollection mFC;
+    static std::vector<nvinfer1::PluginField> mPluginAttributes;
+};
+
+} // namespace tensorrt_llm::plugins
@@ -51,6 +51,12 @@ protected:
 
     std::vector<Config> getTactics(int m, int n, int k) const override;
 
+    // The algos returned by the heuristic are opaque to other cuBLASLt versions
+    std::string getCacheTag() const override
+    {
+        return "cublasLt=" + std::to_string(cublasLtGetVersion());
+    }
+
 private:
     bool mTransA;
     bool mTransB;
@@ -20,12 +20,20 @@
 #include "tensorrt_llm/kernels/decoderMaskedMultiheadAttention.h"
 #include "tensorrt_llm/kernels/decoderMaskedMultiheadAttention/decoderXQARunner.h"
 #include "tensorrt_llm/kernels/gptKernels.h"
+#include "tensorrt_llm/kernels/gqaDecodeAttention.h"
+#include "tensorrt_llm/kernels/pagedContextAttention.h"
 #include "tensorrt_llm/kernels/unfusedAttentionKernels.h"
 #include "tensorrt_llm/plugins/common/checkMacrosPlugin.h"
 #include "tensorrt_llm/runtime/iBuffer.h"
 #include <NvInferRuntimePlugin.h>
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <tuple>
 #include <type_traits>
 
 using namespace nvinfer1;
@@ -87,6 +95,7 @@ struct FusedQKVMaskedAttentionDispatchParams
     PositionEmbeddingType position_embedding_type;
     int max_attention_window;
     int cyclic_attention_window_size;
+    int cyclic_kv_cache_len;
     const int* input_lengths;
     int step;
     float q_scaling;
@@ -114,6 +123,12 @@ struct FusedQKVMaskedAttentionDispatchParams
     bool cross_attention = false;
     const int* memory_length_per_sample = nullptr;
     int max_distance = 0;
+    bool block_sparse_attention = false;
+    BlockSparseParams block_sparse_params;
+    int cache_indir_tokens_per_block = 0;
+    int sink_token_length = 0;
+    float* kv_cache_abs_max = nullptr;
+    const int* kv_cache_abs_max_collect = nullptr;
 };
 
 template <typename T, typename KVCacheBuffer>
@@ -163,7 +178,7 @@ bool GPTAttentionPluginCommon::convertMMHAParamsToXQAParams(
     xqaParams.qkv_bias_enabled = mQKVBiasEnabled;
     xqaParams.cross_attention = mCrossAttention;
     xqaParams.max_distance = mMaxDistance;
-    xqaParams.multi_block_mode = mMultiBlockMode;
+    xqaParams.sink_token_length = mSinkTokenLength;
 
     if (mKVCacheQuantMode.hasInt8KvCache())
     {
@@ -232,10 +247,13 @@ void fusedQKV_masked_attention_dispatch(Multihead_attention_params<T_MMHA, CROSS
 
     params.int8_kv_cache = input_params.kv_cache_quant_mode.hasInt8KvCache();
     params.fp8_kv_cache = input_params.kv_cache_quant_mode.hasFp8KvCache();
+    params.kv_cache_block_scaling = input_params.kv_cache_quant_mode.hasKvCacheBlockScaling();
     if (input_params.kv_cache_quant_mode.hasKvCacheQuant())
     {
         params.kv_scale_orig_quant = input_params.kv_scale_orig_quant;
         params.kv_scale_quant_orig = input_params.kv_scale_quant_orig;
+        params.kv_cache_abs_max = input_params.kv_cache_abs_max;
+        params.kv_cache_abs_max_collect = input_params.kv_cache_abs_max_collect;
     }
 
     params.stride = hidden_units + 2 * hidden_units_kv;
@@ -246,6 +264,7 @@ void fusedQKV_masked_attention_dispatch(Multihead_attention_params<T_MMHA, CROSS
     params.beam_width = input_params.beam_width;
     params.max_attention_window_size = input_params.max_attention_window;
     params.cyclic_attention_window_size = input_params.cyclic_attention_window_size;
+    params.cyclic_kv_cache_len = input_params.cyclic_kv_cache_len;
     params.length_per_sample = input_params.sequence_lengths; // max_input_length + current output length
     // timestep for shared memory size calculation and rotary embedding computation
     params.timestep = input_params.step - 1;
@@ -264,6 +283,10 @@ void fusedQKV_masked_attention_dispatch(Multihead_attention_params<T_MMHA, CROSS
     params.relative_attention_bias = reinterpret_cast<const DataType*>(input_params.relative_attention_bias);
     params.relative_attention_bias_stride = input_params.relative_attention_bias_stride;
     params.max_distance = input_params.max_distance;
+    params.block_sparse_attention = input_params.block_sparse_attention;
+    params.block_sparse_params = input_params.block_sparse_params;
+    params.cache_indir_tokens_per_block = input_params.cache_indir_tokens_per_block;
+    params.sink_token_length = input_params.sink_token_length;
 
     // The slope of linear position bias per head, e.g., ALiBi.
     if (input_params.linear_bias_slopes != nullptr)
@@ -329,7 +352,8 @@ GPTAttentionPluginCommon::GPTAttentionPluginCommon(int num_heads, int num_kv_hea
     tensorrt_llm::kernels::ContextFMHAType context_fmha_type, bool multi_block_mode, int kv_cache_quant_mode,
     bool remove_input_padding, tensorrt_llm::kernels::AttentionMaskType mask_type, bool paged_kv_cache,
     int tokens_per_block, nvinfer1::DataType type, int32_t max_context_length, bool qkv_bias_enabled,
-    bool cross_attention, int max_distance, bool use_paged_context_fmha, bool use_cache)
+    bool cross_attention, int max_distance, bool use_paged_context_fmha, bool use_cache, bool sliding_window_kv_cache,
+    tensorrt_llm::kernels::BlockSparseParams block_sparse_params, bool block_cache_indirection, int sink_token_length)
     : mNumHeads(num_heads)
     , mNumKVHeads(num_kv_heads)
     , mHeadSize(head_size)
@@ -360,18 +384,82 @@ GPTAttentionPluginCommon::GPTAttentionPluginCommon(int num_heads, int num_kv_hea
     , mMaxDistance(max_distance)
     , mPagedContextFMHA(use_paged_context_fmha)
     , mUseKVCache(use_cache)
+    , mSlidingWindowKVCache(sliding_window_kv_cache)
+    , mBlockSparseParams(block_sparse_params)
+    , mBlockCacheIndirection(block_cache_indirection)
+    , mSinkTokenLength(sink_token_length)
 {
+    mBlockSparseParams.num_heads = mNumHeads * mTpSize;
+    mBlockSparseParams.head_offset = mNumHeads * mTpRank;
+
     // pre-check whether FMHA is supported in order to save memory allocation
     mEnableContextFMHA = mEnableContextFMHA
         && (mType == nvinfer1::DataType::kHALF || mType == nvinfer1::DataType::kBF16)
-        && MHARunner::fmha_supported(getHeadSize(), mSM) && !mCrossAttention
+        && (isContextFMHACubinSupported() || canUsePagedContextAttention()) && !mCrossAttention
         && mPositionEmbeddingType != tensorrt_llm::kernels::PositionEmbeddingType::kRELATIVE;
 
     TLLM_CHECK(isRoPE() == (rotary_embedding_dim != 0));
+    // The per-block scales live next to the paged blocks and are written by the non-paged context kernels only.
+    TLLM_CHECK_WITH_INFO(!mKVCacheQuantMode.hasKvCacheBlockScaling()
+            || (mPagedKVCache && !mPagedContextFMHA && !mCrossAttention),
+        "KV cache block scaling requires the paged KV cache without paged context FMHA and cross attention");
+    // The context kernels and the paged context FMHA index the cache linearly up to the attention window.
+    TLLM_CHECK_WITH_INFO(!mSlidingWindowKVCache || (mPagedKVCache && !mPagedContextFMHA && !mCrossAttention),
+        "Sliding window KV cache requires the paged KV cache without paged context FMHA and cross attention");
+    TLLM_CHECK_WITH_INFO(!(mEnableContextFMHA && mPagedKVCache && mPagedContextFMHA) || usePagedContextAttention()
+            || mTokensPerBlock >= 128,
+        "Paged context FMHA needs tokens_per_block >= 128 (got %d)", mTokensPerBlock);
+    // The fused MHA kernels have no block-sparse variant. invokePagedContextAttention applies any pattern, the
+    // unfused path only a pattern shared by the heads.
+    TLLM_CHECK_WITH_INFO(mMaskType != tensorrt_llm::kernels::AttentionMaskType::BLOCKSPARSE
+            || (mBlockSparseParams.block_size > 0 && mBlockSparseParams.vertical_stride > 0 && !mCrossAttention
+                && !mSlidingWindowKVCache && (usePagedContextAttention() || mBlockSparseParams.homo_head_pattern)),
+        "The block-sparse mask needs positive block_size and vertical_stride, self attention without sliding window "
+        "KV cache, and either a homogeneous head pattern or a context FMHA that can fall back to the paged context "
+        "attention kernel");
+    // The beams read the blocks before the current one through the block pointers of another beam, so the blocks
+    // must be whole, unquantized per block and not reused cyclically.
+    TLLM_CHECK_WITH_INFO(!mBlockCacheIndirection
+            || (mPagedKVCache && !mCrossAttention && !mSlidingWindowKVCache
+                && !mKVCacheQuantMode.hasKvCacheBlockScaling()),
+        "The block cache indirection requires the paged KV cache without cross attention, sliding window KV cache "
+        "and KV cache block scaling");
+    // The sink tokens keep their slots of a cache written in place, which only the non-paged context kernels and
+    // the masked MHA kernel map.
+    TLLM_CHECK_WITH_INFO(mSinkTokenLength == 0
+            || (mSinkTokenLength > 0 && mUseKVCache && !mCrossAttention && !mSlidingWindowKVCache
+                && !mBlockCacheIndirection && !mPagedContextFMHA && !mKVCacheQuantMode.hasKvCacheBlockScaling()
+                && mMaskType != tensorrt_llm::kernels::AttentionMaskType::BLOCKSPARSE),
+        "Attention sinks require the KV cache without cross attention, sliding window KV cache, block cache "
+        "indirection, paged context FMHA, KV cache block scaling and block-sparse mask");
     TLLM_CHECK_WITH_INFO((mSM >= 80) || (mType != nvinfer1::DataType::kBF16),
         "Unsupported data type, pre SM 80 GPUs do not support bfloat16");
 }
 
+bool GPTAttentionPluginCommon::isContextFMHACubinSupported() const
+{
+    if (mMaskType == tensorrt_llm::kernels::AttentionMaskType::BLOCKSPARSE)
+    {
+        return false;
+    }
+    return mPagedKVCache && mPagedContextFMHA ? MHARunner::fmha_paged_kv_supported(getHeadSize(), mSM)
+                                              : MHARunner::fmha_supported(getHeadSize(), mSM);
+}
+
+bool GPTAttentionPluginCommon::canUsePagedContextAttention() const
+{
+    // The kernel reads the non-quantized keys/values of the whole sequence back from the cache.
+    return isPagedContextAttentionSupported(getHeadSize()) && mUseKVCache && !mSlidingWindowKVCache
+        && !mKVCacheQuantMode.hasKvCacheQuant() && mSinkTokenLength == 0;
+}
+
+bool GPTAttentionPluginCommon::canUseGQADecodeAttention() const
+{
+    return !mCrossAttention && mNumKVHeads < mNumHeads && mNumHeads / mNumKVHeads <= kGQADecodeMaxQHeadsPerKV
+        && isGQADecodeAttentionSupported(getHeadSize()) && mUseKVCache && !mKVCacheQuantMode.hasKvCacheQuant()
+        && !mSlidingWindowKVCache && !isRelativePosition() && mSinkTokenLength == 0;
+}
+
 const int GPTAttentionPluginCommon::getHeadSize(bool checkInit) const
 {
     if (checkInit)
@@ -416,8 +504,19 @@ GPTAttentionPluginCommon::GPTAttentionPluginCommon(const void* data, size_t leng
     read(d, mMaxDistance);
     read(d, mPagedContextFMHA);
     read(d, mUseKVCache);
+    read(d, mSlidingWindowKVCache);
+    read(d, mBlockSparseParams);
+    read(d, mBlockCacheIndirection);
+    read(d, mSinkTokenLength);
+    read(d, mGenerationKernelsProfiled);
+    read(d, mGenerationKernels);
 
     mKVCacheQuantMode = tc::QuantMode(kvCacheQuantMode);
+    if (mUseKVCache && mKVCacheQuantMode.hasKvCacheOnlineScaling())
+    {
+        mKvCacheScaleCalibration = KvCacheScaleCalibrator::getInstance().addLayer(
+            mKVCacheQuantMode.hasFp8KvCache() ? 448.f : 127.f);
+    }
 
     TLLM_CHECK(d == a + length);
     TLLM_CHECK_WITH_INFO((mSM >= 80) || (mType != nvinfer1::DataType::kBF16),
@@ -439,7 +538,8 @@ size_t GPTAttentionPluginCommon::getWorkspaceSizeForContext(nvinfer1::DataType t
         ? 0
         : size * batch_size * input_seq_length * (isCrossAttention() ? cross_qkv_length : input_seq_length);
     const size_t cu_seqlens_size = sizeof(int) * (batch_size + 1);
-    const size_t q_buf_2_size = (mEnableContextFMHA && mPagedKVCache && mPagedContextFMHA) || !mEnableContextFMHA
+    const size_t q_buf_2_size
+        = !mEnableContextFMHA || (mPagedKVCache && mPagedContextFMHA) || usePagedContextAttention()
         ? size * batch_size * input_seq_length * local_hidden_units_qo
         : 0;
     const size_t k_buf_2_size = mEnableContextFMHA
@@ -562,6 +662,12 @@ int GPTAttentionPluginCommon::enqueueContext(const EnqueueContextParams<T, KVCac
             num_kv_heads * head_size * elem_size);
         kv_cache_buffer.data = reinterpret_cast<BufferDataType*>(params.key_value_cache);
     }
+    // Number of cache slots the new tokens are written to cyclically.
+    // The attention itself still only covers cyclic_attention_window_size tokens.
+    const int cyclic_kv_cache_len = mSlidingWindowKVCache ? params.max_blocks_per_sequence * mTokensPerBlock
+                                                          : params.cyclic_attention_window_size;
+    TLLM_CHECK_WITH_INFO(mSinkTokenLength == 0 || mSinkTokenLength < cyclic_kv_cache_len,
+        "sink_token_length (%d) must be below the attention window (%d)", mSinkTokenLength, cyclic_kv_cache_len);
 
     const auto quant_option = tc::QuantMode::fromDescription();
     const float* qkv_scale_out = nullptr;
@@ -601,7 +707,8 @@ int GPTAttentionPluginCommon::enqueueContext(const EnqueueContextParams<T, KVCac
                                                           : sizeof(T) * params.batch_size * params.input_seq_length
             * (isCrossAttention() ? params.cross_qkv_length : params.input_seq_length);
     const size_t cu_seqlens_size = sizeof(int) * (params.batch_size + 1);
-    const size_t q_buf_2_size = (mEnableContextFMHA && mPagedKVCache && mPagedContextFMHA) || !mEnableContextFMHA
+    const size_t q_buf_2_size
+        = !mEnableContextFMHA || (mPagedKVCache && mPagedContextFMHA) || usePagedContextAttention()
         ? sizeof(T) * params.batch_size * params.input_seq_length * local_hidden_units_qo
         : 0;
     const size_t k_buf_2_size = mEnableContextFMHA ? 0
@@ -621,7 +728,11 @@ int GPTAttentionPluginCommon::enqueueContext(const EnqueueContextParams<T, KVCac
     const size_t padding_offset_size
         = sizeof(int) * params.batch_size * (isCrossAttention() ? params.cross_qkv_length : params.input_seq_length);
     // It is assumed that the number of tokens per paged kv block should be >= 128.
-    const size_t blocks_per_context_sequence = mPagedKVCache ? tc::divUp(params.input_seq_length, mTokensPerBlock) : 0;
+    // The queries only cover the new tokens while the keys/values also cover the cached prefix (s_q <= s_kv), so the
+    // paged context FMHA needs the blocks of the whole kv sequence.
+    const size_t blocks_per_context_sequence = mPagedKVCache
+        ? tc::divUp(std::max(params.input_seq_length, params.max_past_kv_len), mTokensPerBlock)
+        : 0;
     const size_t paged_kv_tma_desc_size = mPagedKVCache && mPagedContextFMHA
         ? params.batch_size * 2 * TMA_DESC_SIZE_IN_BYTE * blocks_per_context_sequence
         : 0;
@@ -662,6 +773,7 @@ int GPTAttentionPluginCommon::enqueueContext(const EnqueueContextParams<T, KVCac
     decoder_params.attentionWindowSize = params.cyclic_attention_window_size;
     decoder_params.numTokens = params.num_tokens;
     decoder_params.attentionMaskType = mMaskType;
+    decoder_params.blockSparseParams = mBlockSparseParams;
     invokeBuildDecoderInfo(decoder_params, stream);
     sync_check_cuda_error();
 
@@ -717,17 +829,74 @@ int GPTAttentionPluginCommon::enqueueContext(const EnqueueContextParams<T, KVCac
     if (mEnableContextFMHA)
     {
         const bool enablePagedKVContextFMHA = mPagedKVCache && mPagedContextFMHA;
-        invokeApplyBiasRopeUpdateKVCache(const_cast<T*>(params.attention_input), q_buf_2_, kv_cache_buffer,
+        // With block scaling, the cache is written by invokeQuantizeKvCacheBlocks below, from the rotated K/V that are
+        // stored back to the packed QKV buffer.
+        KVCacheBuffer rope_kv_cache_buffer = kv_cache_buffer;
+        if (mKVCacheQuantMode.hasKvCacheBlockScaling())
+        {
+            rope_kv_cache_buffer.data = nullptr;
+        }
+        invokeApplyBiasRopeUpdateKVCache(const_cast<T*>(params.attention_input), q_buf_2_, rope_kv_cache_buffer,
             const_cast<T*>(params.qkv_bias), params.q_seq_lengths, params.kv_seq_lengths,
-            mRemovePadding ? padding_offset : nullptr, params.batch_size, params.input_seq_length,
-            params.cyclic_attention_window_size, params.num_tokens, mNumHeads, mNumKVHeads, getHeadSize(),
+            mRemovePadding ? padding_offset : nullptr, params.batch_size, params.input_seq_length, cyclic_kv_cache_len,
+            params.num_tokens, mNumHeads, mNumKVHeads, getHeadSize(),
             mRotaryEmbeddingDim, mRotaryEmbeddingBase, mRotaryEmbeddingScaleType, mRotaryEmbeddingScale,
             mRotaryEmbeddingMaxPositions, position_embedding_type, (float*) nullptr, 0, cache_type,
-            params.kv_scale_orig_quant, enablePagedKVContextFMHA, stream);
+            params.kv_scale_orig_quant, enablePagedKVContextFMHA || usePagedContextAttention(), stream, 1,
+            mSinkTokenLength);
         sync_check_cuda_error();
 
+        if (mKVCacheQuantMode.hasKvCacheBlockScaling())
+        {
+            const int qkv_token_stride = (mNumHeads + 2 * mNumKVHeads) * getHeadSize();
+            const T* k_src = params.attention_input + mNumHeads * getHeadSize();
+            const T* v_src = k_src + mNumKVHeads * getHeadSize();
+            invokeQuantizeKvCacheBlocks(k_src, v_src, kv_cache_buffer, mRemovePadding ? cu_q_seqlens : nullptr,
+                params.q_seq_lengths, params.batch_size, params.input_seq_length, cyclic_kv_cache_len, getHeadSize(),
+                mNumKVHeads,
+                params.input_seq_length * qkv_token_stride, qkv_token_stride, getHeadSize(), cache_type, stream);
+            sync_check_cuda_error();
+        }
+
+        if (mKvCacheScaleCalibration)
+        {
+            // The rotated K/V were also stored back to the packed QKV buffer.
+            const int qkv_token_stride = (mNumHeads + 2 * mNumKVHeads) * getHeadSize();
+            const T* k_src = params.attention_input + mNumHeads * getHeadSize();
+            const T* v_src = k_src + mNumKVHeads * getHeadSize();
+            invokeKvCacheAbsMax(mKvCacheScaleCalibration->getAbsMax(), mKvCacheScaleCalibration->getCollectFlag(),
+                k_src, v_src, mRemovePadding ? cu_q_seqlens : nullptr, params.q_seq_lengths, params.batch_size,
+                params.input_seq_length, getHeadSize(), mNumKVHeads, params.input_seq_length * qkv_token_stride,
+                qkv_token_stride, getHeadSize(), stream);
+            sync_check_cuda_error();
+        }
+
+        if (usePagedContextAttention())
+        {
+            // No fused MHA kernel for this head size: attend from q_buf_2_ to the keys/values just written to the
+            // cache, which also holds any reused prefix.
+            PagedContextAttentionParams<T> attentionParams;
+            attentionParams.q = q_buf_2_;
+            attentionParams.output = params.context_buf;
+            attentionParams.alibiSlopes = isALiBi() ? params.alibi_slopes : nullptr;
+            attentionParams.qSeqLengths = params.q_seq_lengths;
+            attentionParams.kvSeqLengths = params.kv_seq_lengths;
+            attentionParams.cuQSeqLengths = mRemovePadding ? cu_q_seqlens : nullptr;
+            attentionParams.batchSize = params.batch_size;
+            attentionParams.maxQSeqLength = params.input_seq_length;
+            attentionParams.maxKVSeqLength = std::max(params.input_seq_length, params.max_past_kv_len);
+            attentionParams.numHeads = mNumHeads;
+            attentionParams.numKVHeads = mNumKVHeads;
+            attentionParams.headSize = getHeadSize();
+            attentionParams.attentionWindowSize = params.cyclic_attention_window_size;
+            attentionParams.cyclicKVCacheLength = cyclic_kv_cache_len;
+            attentionParams.qkScale = qk_scale;
+            attentionParams.maskType = mMaskType;
+            attentionParams.blockSparseParams = mBlockSparseParams;
+            invokePagedContextAttention(attentionParams, kv_cache_buffer, stream);
+        }
         //  It is not needed with packed QKV input.
-        if (enablePagedKVContextFMHA)
+        else if (enablePagedKVContextFMHA)
         {
             // to enable chunked attention,
             // 1. make sure you call setup_paged_kv(batch_size, max_query_length, max_kv_length, ....)
@@ -739,6 +908,8 @@ int GPTAttentionPluginCommon::enqueueContext(const EnqueueContextParams<T, KVCac
             //    - kv_cache_buffer: paged kv buffer
             //    - cu_q_seqlens: the cumulative query sequence lengths, needed for variable sequence length.
             //    - cu_kv_seqlens: the cumulative kv sequence lengths, needed for variable sequence length.
+            // q_buf_2_ only holds the new tokens of each sequence while the paged kv cache also holds the reused
+            // prefix blocks, so a cached prefix is attended to without recomputing its keys/values.
 
             // the token will pay attention to previous tokens while starting from max(0, rowIdx -
             // cyclic_attention_window_size);
@@ -797,13 +968,29 @@ int GPTAttentionPluginCommon::enqueueContext(const EnqueueContextParams<T, KVCac
         sync_check_cuda_error();
 
         // write KV to cache
-        if (useKVCache())
+        if (useKVCache() && mKVCacheQuantMode.hasKvCacheBlockScaling())
+        {
+            const int seq_len = params.input_seq_length;
+            invokeQuantizeKvCacheBlocks(k_buf_2_, v_buf_2_, kv_cache_buffer, (const int*) nullptr,
+                params.q_seq_lengths, params.batch_size, seq_len, cyclic_kv_cache_len, getHeadSize(), mNumKVHeads,
+                mNumKVHeads * seq_len * getHeadSize(), getHeadSize(), seq_len * getHeadSize(), cache_type, stream);
+        }
+        else if (useKVCache())
         {
             invokeTranspose4dBatchMajor(k_buf_2_, v_buf_2_, kv_cache_buffer, params.batch_size,
                 isCrossAttention() ? params.cross_qkv_length : params.input_seq_length,
-                isCrossAttention() ? params.cross_qkv_length : params.cyclic_attention_window_size, getHeadSize(),
-                mNumKVHeads, cache_type, params.kv_scale_orig_quant,
-                isCrossAttention() ? params.encoder_input_lengths : params.q_seq_lengths, stream);
+                isCrossAttention() ? params.cross_qkv_length : cyclic_kv_cache_len, getHeadSize(), mNumKVHeads,
+                cache_type, params.kv_scale_orig_quant,
+                isCrossAttention() ? params.encoder_input_lengths : params.q_seq_lengths, stream, mSinkTokenLength);
+        }
+        if (useKVCache() && mKvCacheScaleCalibration)
+        {
+            const int kv_seq_len = isCrossAttention() ? params.cross_qkv_length : params.input_seq_length;
+            invokeKvCacheAbsMax(mKvCacheScaleCalibration->getAbsMax(), mKvCacheScaleCalibration->getCollectFlag(),
+                k_buf_2_, v_buf_2_, (const int*) nullptr,
+                isCrossAttention() ? params.encoder_input_lengths : params.q_seq_lengths, params.batch_size,
+                kv_seq_len, getHeadSize(), mNumKVHeads, mNumKVHeads * kv_seq_len * getHeadSize(), getHeadSize(),
+                kv_seq_len * getHeadSize(), stream);
         }
         sync_check_cuda_error();
 
@@ -1090,8 +1277,13 @@ int GPTAttentionPluginCommon::enqueueGeneration(
         }
     }
     sync_check_cuda_error();
+    const GenerationAttentionKernel selected_kernel = mForcedGenerationKernel != GenerationAttentionKernel::kHEURISTIC
+        ? mForcedGenerationKernel
+        : getGenerationKernel(params.beam_width, batch_beam, params.past_kv_length);
     // Try XQA optimization first.
-    if (!mCrossAttention)
+    const bool try_xqa = selected_kernel == GenerationAttentionKernel::kHEURISTIC
+        || selected_kernel == GenerationAttentionKernel::kXQA;
+    if (!mCrossAttention && try_xqa)
     {
         // self attn
         XQAParams xqaParams{};
@@ -1100,13 +1292,25 @@ int GPTAttentionPluginCommon::enqueueGeneration(
             && mDecoderXQARunner->template shouldUse<T>(xqaParams))
         {
             mDecoderXQARunner->template dispatch<KVCacheBuffer>(xqaParams, kv_cache_buffer, stream);
+            mLastGenerationKernel = GenerationAttentionKernel::kXQA;
             return 0;
         }
     }
 
+    // Keys older than cyclic_attention_window_size stay in the ring until their block is released, so the
+    // kernel loops over the whole ring and masks them.
+    const int cyclic_kv_cache_len = mSlidingWindowKVCache ? params.max_blocks_per_sequence * mTokensPerBlock
+                                                          : params.cyclic_attention_window_size;
+    TLLM_CHECK_WITH_INFO(!mSlidingWindowKVCache || params.beam_width == 1,
+        "Sliding window KV cache does not support beam search");
+    // The cache indirection of beam search follows the plain cyclic KV cache.
+    TLLM_CHECK_WITH_INFO(mSinkTokenLength == 0 || (params.beam_width == 1 && mSinkTokenLength < cyclic_kv_cache_len),
+        "Attention sinks require beam width 1 and sink_token_length (%d) below the attention window (%d)",
+        mSinkTokenLength, cyclic_kv_cache_len);
+
     int timestep = params.past_kv_length;
-    const int max_timesteps = mCrossAttention ? params.cyclic_attention_window_size
-                                              : std::min(timestep, params.cyclic_attention_window_size);
+    const int max_timesteps
+        = mCrossAttention ? params.cyclic_attention_window_size : std::min(timestep, cyclic_kv_cache_len);
     int estimated_min_multi_block_count
         = estimate_min_multi_block_count<T>(max_timesteps, mMaxSharedMemoryPerBlockOptin - 2048);
 
@@ -1124,8 +1328,9 @@ int GPTAttentionPluginCommon::enqueueGeneration(
     // Runtime check to see the actual number of blocks per sequence we need.
     int32_t const max_num_seq_len_tiles = std::max(getMaxNumSeqLenTile(batch_beam), estimated_min_multi_block_count);
     int32_t const min_num_seq_len_tiles = std::max(1, estimated_min_multi_block_count);
-    const bool enable_multi_block
-        = (mMultiBlockMode && max_num_seq_len_tiles > 1) || estimated_min_multi_block_count > 1;
+    const bool enable_multi_block = (mMultiBlockMode && max_num_seq_len_tiles > 1
+                                        && selected_kernel != GenerationAttentionKernel::kMMHA)
+        || estimated_min_multi_block_count > 1;
     const size_t partial_out_size
         = enable_multi_block ? sizeof(T) * batch_beam * mNumHeads * mHeadSize * max_num_seq_len_tiles : 0;
     const size_t partial_sum_size
@@ -1144,11 +1349,76 @@ int GPTAttentionPluginCommon::enqueueGeneration(
         TLLM_CUDA_CHECK(cudaMemsetAsync(block_counter, 0, block_counter_size, stream));
     }
 
+    // Grouped-query attention that XQA does not cover (e.g. float or its missing head sizes): one block loads each
+    // kv head once for all the query heads of its group, where MMHA reloads it once per query head.
+    const bool use_gqa_decode_attention = params.beam_width == 1 && canUseGQADecodeAttention()
+        && (selected_kernel == GenerationAttentionKernel::kHEURISTIC
+            || selected_kernel == GenerationAttentionKernel::kGQA_DECODE);
+    if (use_gqa_decode_attention)
+    {
+        invokeApplyBiasRopeUpdateKVCache<T, KVCacheBuffer, true>(const_cast<T*>(params.attention_input), nullptr,
+            kv_cache_buffer, params.qkv_bias, params.sequence_lengths, nullptr, nullptr, batch_beam, 1,
+            cyclic_kv_cache_len, batch_beam, mNumHeads, mNumKVHeads, getHeadSize(), mRotaryEmbeddingDim,
+            mRotaryEmbeddingBase, mRotaryEmbeddingScaleType, mRotaryEmbeddingScale, mRotaryEmbeddingMaxPositions,
+            mPositionEmbeddingType, (float*) nullptr, 0, KvCacheDataType::BASE, nullptr, false, stream);
+        sync_check_cuda_error();
+
+        GQADecodeAttentionParams<T> gqa_params;
+        gqa_params.qkv = params.attention_input;
+        gqa_params.output = params.context_buf;
+        gqa_params.alibiSlopes = isALiBi() ? params.alibi_slopes : nullptr;
+        gqa_params.sequenceLengths = params.sequence_lengths;
+        gqa_params.batchSize = batch_beam;
+        gqa_params.numHeads = mNumHeads;
+        gqa_params.numKVHeads = mNumKVHeads;
+        gqa_params.headSize = getHeadSize();
+        gqa_params.cyclicKVCacheLength = cyclic_kv_cache_len;
+        gqa_params.qkScale = 1.f / (sqrtf(static_cast<float>(getHeadSize())) * q_scaling);
+        gqa_params.maskType = mMaskType;
+        gqa_params.blockSparseParams = mBlockSparseParams;
+        // Split the cache over the multi-block workspace only when the kv heads alone do not fill the GPU, keeping
+        // a few tiles of the cache per block.
+        gqa_params.numSplits = enable_multi_block
+            ? std::max(1,
+                std::min({max_num_seq_len_tiles, tc::divUp(max_timesteps, 128),
+                    tc::divUp(mMultiProcessorCount, batch_beam * mNumKVHeads)}))
+            : 1;
+        gqa_params.partialOut = partial_out;
+        gqa_params.partialSum = partial_sum;
+        gqa_params.partialMax = partial_max;
+        invokeGQADecodeAttention(gqa_params, kv_cache_buffer, stream);
+        sync_check_cuda_error();
+        mLastGenerationKernel = GenerationAttentionKernel::kGQA_DECODE;
+        return 0;
+    }
+
+    // With KV cache block scaling, the new tokens are appended before the masked MHA kernel. A token that outgrows
+    // the scale of its block re-quantizes the block, which the kernels of the other query heads could be reading. The
+    // bias and RoPE are applied in place first, so the kernel gets the final Q/K/V.
+    const bool append_kv_block_scaled = useKVCache() && !mCrossAttention && mKVCacheQuantMode.hasKvCacheBlockScaling();
+    if (append_kv_block_scaled)
+    {
+        KVCacheBuffer rope_kv_cache_buffer = kv_cache_buffer;
+        rope_kv_cache_buffer.data = nullptr;
+        invokeApplyBiasRopeUpdateKVCache<T, KVCacheBuffer, true>(const_cast<T*>(params.attention_input), nullptr,
+            rope_kv_cache_buffer, params.qkv_bias, params.sequence_lengths, nullptr, nullptr, batch_beam, 1,
+            cyclic_kv_cache_len, batch_beam, mNumHeads, mNumKVHeads, getHeadSize(), mRotaryEmbeddingDim,
+            mRotaryEmbeddingBase, mRotaryEmbeddingScaleType, mRotaryEmbeddingScale, mRotaryEmbeddingMaxPositions,
+            mPositionEmbeddingType, (float*) nullptr, 0, KvCacheDataType::BASE, nullptr, false, stream);
+        const int qkv_token_stride = (mNumHeads + 2 * mNumKVHeads) * getHeadSize();
+        const T* k_src = params.attention_input + mNumHeads * getHeadSize();
+        const T* v_src = k_src + mNumKVHeads * getHeadSize();
+        invokeAppendKvCacheBlocks(k_src, v_src, kv_cache_buffer, params.sequence_lengths, batch_beam,
+            cyclic_kv_cache_len, mSlidingWindowKVCache, getHeadSize(), mNumKVHeads, qkv_token_stride,
+            mKVCacheQuantMode.hasInt8KvCache() ? KvCacheDataType::INT8 : KvCacheDataType::FP8, stream);
+        sync_check_cuda_error();
+    }
+
     FusedQKVMaskedAttentionDispatchParams<T, KVCacheBuffer> dispatch_params;
     memset(&dispatch_params, 0, sizeof(dispatch_params));
     dispatch_params.mUnfuseQkvGemm = mUnfuseQkvGemm;
     dispatch_params.qkv_buf = params.attention_input;
-    dispatch_params.qkv_bias = params.qkv_bias;
+    dispatch_params.qkv_bias = append_kv_block_scaled ? nullptr : params.qkv_bias;
     dispatch_params.relative_attention_bias = relative_attention_bias;
     dispatch_params.relative_attention_bias_stride = relative_attention_bias_stride;
     dispatch_params.max_distance = max_distance;
@@ -1164,9 +1434,12 @@ int GPTAttentionPluginCommon::enqueueGeneration(
     dispatch_params.kv_head_num = mNumKVHeads;
     dispatch_params.size_per_head = getHeadSize();
     dispatch_params.rotary_embedding_dim = mRotaryEmbeddingDim;
-    dispatch_params.position_embedding_type = mPositionEmbeddingType;
+    dispatch_params.position_embedding_type = append_kv_block_scaled && isRoPE()
+        ? PositionEmbeddingType::kLEARNED_ABSOLUTE
+        : mPositionEmbeddingType;
     dispatch_params.max_attention_window = params.max_attention_window;
     dispatch_params.cyclic_attention_window_size = params.cyclic_attention_window_size;
+    dispatch_params.cyclic_kv_cache_len = cyclic_kv_cache_len;
     dispatch_params.input_lengths = params.context_lengths;
     dispatch_params.step = step;
     dispatch_params.q_scaling = q_scaling;
@@ -1195,6 +1468,15 @@ int GPTAttentionPluginCommon::enqueueGeneration(
     dispatch_params.rotary_embedding_max_positions = mRotaryEmbeddingMaxPositions;
     dispatch_params.cross_attention = mCrossAttention;
     dispatch_params.memory_length_per_sample = params.encoder_input_lengths;
+    dispatch_params.block_sparse_attention = mMaskType == AttentionMaskType::BLOCKSPARSE;
+    dispatch_params.block_sparse_params = mBlockSparseParams;
+    dispatch_params.cache_indir_tokens_per_block = mBlockCacheIndirection ? mTokensPerBlock : 0;
+    dispatch_params.sink_token_length = mSinkTokenLength;
+    if (mKvCacheScaleCalibration)
+    {
+        dispatch_params.kv_cache_abs_max = mKvCacheScaleCalibration->getAbsMax();
+        dispatch_params.kv_cache_abs_max_collect = mKvCacheScaleCalibration->getCollectFlag();
+    }
 
     using DataType = typename SATypeConverter<T>::Type;
     if (!mCrossAttention)
@@ -1209,6 +1491,8 @@ int GPTAttentionPluginCommon::enqueueGeneration(
         Cross_multihead_attention_params<DataType> mmhca_params;
         fusedQKV_masked_attention_dispatch(mmhca_params, dispatch_params, stream);
     }
+    mLastGenerationKernel
+        = enable_multi_block ? GenerationAttentionKernel::kMMHA_MULTI_BLOCK : GenerationAttentionKernel::kMMHA;
 
     return 0;
 }
@@ -1235,6 +1519,284 @@ template int GPTAttentionPluginCommon::enqueueGeneration<__nv_bfloat16, KVBlockA
     const EnqueueGenerationParams<__nv_bfloat16, KVBlockArray>& params, cudaStream_t stream);
 #endif
 
+namespace
+{
+
+int ceilLog2(int32_t v)
+{
+    int log2 = 0;
+    while ((1 << log2) < v)
+    {
+        ++log2;
+    }
+    return log2;
+}
+
+// Buckets whose synthetic KV cache would be larger are not profiled and keep the heuristic selection.
+constexpr size_t kMaxProfileKVCacheBytes = size_t{1} << 30;
+
+// The layers sharing a configuration share their profiled kernels, so each shape is benchmarked once per process.
+using GenerationKernelProfileKey = std::tuple<int, int, int, int, int, int, int, bool, bool, bool, int32_t, int32_t>;
+std::mutex gGenerationKernelProfilesMutex;
+std::map<GenerationKernelProfileKey, std::vector<int8_t>> gGenerationKernelProfiles;
+
+} // namespace
+
+GPTAttentionPluginCommon::GenerationAttentionKernel GPTAttentionPluginCommon::getGenerationKernel(
+    int32_t beam_width, int32_t batch_beam, int32_t num_cached_tokens) const
+{
+    if (!mGenerationKernelsProfiled || beam_width != 1)
+    {
+        return GenerationAttentionKernel::kHEURISTIC;
+    }
+    const int batch_bucket = ceilLog2(batch_beam);
+    const int length_bucket = ceilLog2(tc::divUp(std::max(num_cached_tokens, 1), kGenerationKernelMinLength));
+    if (batch_bucket >= kGenerationKernelBatchBuckets || length_bucket >= kGenerationKernelLengthBuckets)
+    {
+        return GenerationAttentionKernel::kHEURISTIC;
+    }
+    return mGenerationKernels[batch_bucket][length_bucket];
+}
+
+template <typename T, typename KVCacheBuffer>
+void GPTAttentionPluginCommon::profileGenerationKernelsImpl(int32_t max_batch_beam, int32_t max_attention_window)
+{
+    std::vector<GenerationAttentionKernel> candidates{GenerationAttentionKernel::kMMHA};
+    if (mMultiBlockMode)
+    {
+        candidates.push_back(GenerationAttentionKernel::kMMHA_MULTI_BLOCK);
+    }
+    if (tensorrt_llm::kernels::XQADispatchHelper<T, KVCacheBuffer>::CanSupport && mDecoderXQARunner.get() != nullptr)
+    {
+        candidates.push_back(GenerationAttentionKernel::kXQA);
+    }
+    if (canUseGQADecodeAttention())
+    {
+        candidates.push_back(GenerationAttentionKernel::kGQA_DECODE);
+    }
+    if (candidates.size() < 2)
+    {
+        return;
+    }
+
+    const int head_size = getHeadSize();
+    const int max_batch_bucket = std::min(ceilLog2(max_batch_beam), kGenerationKernelBatchBuckets - 1);
+    const int max_length_bucket = std::min(
+        ceilLog2(tc::divUp(max_attention_window, kGenerationKernelMinLength)), kGenerationKernelLengthBuckets - 1);
+    const int32_t max_batch = 1 << max_batch_bucket;
+    const int32_t max_length = kGenerationKernelMinLength << max_length_bucket;
+    const size_t kv_bytes_per_token = sizeof(T) * mNumKVHeads * head_size;
+    // Bytes of the keys and values of batch sequences of length tokens, rounded up to whole blocks when paged.
+    auto const get_kv_cache_bytes = [&](int32_t batch, int32_t length)
+    {
+        const size_t num_tokens = mPagedKVCache ? tc::divUp(length, mTokensPerBlock) * mTokensPerBlock : length;
+        return 2 * kv_bytes_per_token * batch * num_tokens;
+    };
+    const size_t kv_cache_bytes = std::min(kMaxProfileKVCacheBytes, get_kv_cache_bytes(max_batch, max_length));
+    const size_t qkv_size = static_cast<size_t>(mNumHeads + 2 * mNumKVHeads) * head_size;
+    const size_t workspace_size = getWorkspaceSizeForGeneration(mType, max_batch);
+
+    // Synthetic inputs: the timings of the kernels do not depend on the values.
+    T* qkv = nullptr;
+    T* qkv_bias = nullptr;
+    T* alibi_slopes = nullptr;
+    T* output = nullptr;
+    int32_t* sequence_lengths = nullptr;
+    int8_t* kv_cache = nullptr;
+    int64_t* block_pointers = nullptr;
+    void* workspace = nullptr;
+    const int32_t max_blocks_per_sequence = tc::divUp(max_length, mTokensPerBlock);
+    TLLM_CUDA_CHECK(cudaMalloc(&qkv, sizeof(T) * max_batch * qkv_size));
+    TLLM_CUDA_CHECK(cudaMalloc(&qkv_bias, sizeof(T) * qkv_size));
+    TLLM_CUDA_CHECK(cudaMalloc(&alibi_slopes, sizeof(T) * mNumHeads));
+    TLLM_CUDA_CHECK(cudaMalloc(&output, sizeof(T) * max_batch * mNumHeads * head_size));
+    TLLM_CUDA_CHECK(cudaMalloc(&sequence_lengths, sizeof(int32_t) * max_batch));
+    TLLM_CUDA_CHECK(cudaMalloc(&kv_cache, kv_cache_bytes));
+    TLLM_CUDA_CHECK(cudaMalloc(&workspace, workspace_size));
+    TLLM_CUDA_CHECK(cudaMemset(qkv, 0, sizeof(T) * max_batch * qkv_size));
+    TLLM_CUDA_CHECK(cudaMemset(qkv_bias, 0, sizeof(T) * qkv_size));
+    TLLM_CUDA_CHECK(cudaMemset(alibi_slopes, 0, sizeof(T) * mNumHeads));
+    TLLM_CUDA_CHECK(cudaMemset(kv_cache, 0, kv_cache_bytes));
+    if (mPagedKVCache)
+    {
+        TLLM_CUDA_CHECK(cudaMalloc(&block_pointers, sizeof(int64_t) * max_batch * 2 * max_blocks_per_sequence));
+    }
+
+    cudaStream_t stream;
+    cudaEvent_t start;
+    cudaEvent_t stop;
+    TLLM_CUDA_CHECK(cudaStreamCreate(&stream));
+    TLLM_CUDA_CHECK(cudaEventCreate(&start));
+    TLLM_CUDA_CHECK(cudaEventCreate(&stop));
+
+    constexpr int warmup = 2;
+    constexpr int runs = 5;
+    for (int batch_bucket = 0; batch_bucket <= max_batch_bucket; ++batch_bucket)
+    {
+        for (int length_bucket = 0; length_bucket <= max_length_bucket; ++length_bucket)
+        {
+            const int32_t batch = 1 << batch_bucket;
+            const int32_t length = kGenerationKernelMinLength << length_bucket;
+            if (get_kv_cache_bytes(batch, length) > kv_cache_bytes)
+            {
+                continue;
+            }
+
+            // Every sequence holds length - 1 cached tokens plus the new one.
+            const std::vector<int32_t> host_sequence_lengths(batch, length);
+            const std::vector<int32_t> host_past_kv_lengths(batch, length - 1);
+            TLLM_CUDA_CHECK(cudaMemcpy(sequence_lengths, host_sequence_lengths.data(), sizeof(int32_t) * batch,
+                cudaMemcpyHostToDevice));
+            const int32_t blocks_per_sequence = tc::divUp(length, mTokensPerBlock);
+            if (mPagedKVCache)
+            {
+                const size_t block_bytes = kv_bytes_per_token * mTokensPerBlock;
+                std::vector<int64_t> host_block_pointers(static_cast<size_t>(batch) * 2 * blocks_per_sequence);
+                for (size_t i = 0; i < host_block_pointers.size(); ++i)
+                {
+                    host_block_pointers[i] = reinterpret_cast<int64_t>(kv_cache + i * block_bytes);
+                }
+                TLLM_CUDA_CHECK(cudaMemcpy(block_pointers, host_block_pointers.data(),
+                    sizeof(int64_t) * host_block_pointers.size(), cudaMemcpyHostToDevice));
+            }
+
+            EnqueueGenerationParams<T, KVCacheBuffer> params{};
+            params.attention_input = qkv;
+            params.qkv_bias = qkv_bias;
+            params.sequence_lengths = sequence_lengths;
+            params.past_kv_length = length - 1;
+            params.beam_width = 1;
+            params.context_lengths = sequence_lengths;
+            params.alibi_slopes = alibi_slopes;
+            params.context_buf = output;
+            params.key_value_cache = kv_cache;
+            params.block_pointers = block_pointers;
+            params.max_attention_window = length;
+            params.cyclic_attention_window_size = length;
+            params.num_requests = batch;
+            params.max_blocks_per_sequence = blocks_per_sequence;
+            params.workspace = workspace;
+            params.host_past_key_value_lengths = host_past_kv_lengths.data();
+
+            float best_time = std::numeric_limits<float>::max();
+            GenerationAttentionKernel best_kernel = GenerationAttentionKernel::kHEURISTIC;
+            for (const auto candidate : candidates)
+            {
+                mForcedGenerationKernel = candidate;
+                mLastGenerationKernel = GenerationAttentionKernel::kHEURISTIC;
+                try
+                {
+                    enqueueGeneration<T, KVCacheBuffer>(params, stream);
+                    if (mLastGenerationKernel != candidate)
+                    {
+                        // The kernel does not apply to this shape and another one ran instead.
+                        continue;
+                    }
+                    for (int i = 1; i < warmup; ++i)
+                    {
+                        enqueueGeneration<T, KVCacheBuffer>(params, stream);
+                    }
+                    TLLM_CUDA_CHECK(cudaEventRecord(start, stream));
+                    for (int i = 0; i < runs; ++i)
+                    {
+                        enqueueGeneration<T, KVCacheBuffer>(params, stream);
+                    }
+                    TLLM_CUDA_CHECK(cudaEventRecord(stop, stream));
+                    TLLM_CUDA_CHECK(cudaEventSynchronize(stop));
+                }
+                catch (const std::exception& e)
+                {
+                    std::ostringstream msg;
+                    msg << "Cannot profile generation attention kernel " << static_cast<int>(candidate)
+                        << " (for batch_beam=" << batch << ", length=" << length << "), reason: \"" << e.what()
+                        << "\". Skipped";
+                    TLLM_LOG_WARNING(msg.str());
+                    continue;
+                }
+                float elapsed;
+                TLLM_CUDA_CHECK(cudaEventElapsedTime(&elapsed, start, stop));
+                if (elapsed < best_time)
+                {
+                    best_time = elapsed;
+                    best_kernel = candidate;
+                }
+            }
+            mGenerationKernels[batch_bucket][length_bucket] = best_kernel;
+        }
+    }
+    mForcedGenerationKernel = GenerationAttentionKernel::kHEURISTIC;
+
+    TLLM_CUDA_CHECK(cudaEventDestroy(start));
+    TLLM_CUDA_CHECK(cudaEventDestroy(stop));
+    TLLM_CUDA_CHECK(cudaStreamDestroy(stream));
+    TLLM_CUDA_CHECK(cudaFree(qkv));
+    TLLM_CUDA_CHECK(cudaFree(qkv_bias));
+    TLLM_CUDA_CHECK(cudaFree(alibi_slopes));
+    TLLM_CUDA_CHECK(cudaFree(output));
+    TLLM_CUDA_CHECK(cudaFree(sequence_lengths));
+    TLLM_CUDA_CHECK(cudaFree(kv_cache));
+    TLLM_CUDA_CHECK(cudaFree(workspace));
+    if (block_pointers != nullptr)
+    {
+        TLLM_CUDA_CHECK(cudaFree(block_pointers));
+    }
+}
+
+template <typename T>
+void GPTAttentionPluginCommon::profileGenerationKernelsDispatchKVCacheType(
+    int32_t max_batch_beam, int32_t max_attention_window)
+{
+    if (mPagedKVCache)
+    {
+        profileGenerationKernelsImpl<T, KVBlockArray>(max_batch_beam, max_attention_window);
+    }
+    else
+    {
+        profileGenerationKernelsImpl<T, KVLinearBuffer>(max_batch_beam, max_attention_window);
+    }
+}
+
+void GPTAttentionPluginCommon::profileGenerationKernels(int32_t max_batch_beam, int32_t max_attention_window)
+{
+    if (mGenerationKernelsProfiled || mCrossAttention || !mUseKVCache || mKVCacheQuantMode.hasKvCacheQuant()
+        || max_batch_beam <= 0 || max_attention_window <= 0)
+    {
+        return;
+    }
+
+    const GenerationKernelProfileKey key{static_cast<int>(mType), mNumHeads, mNumKVHeads, getHeadSize(),
+        static_cast<int>(mMaskType), static_cast<int>(mPositionEmbeddingType), mTokensPerBlock, mPagedKVCache,
+        mMultiBlockMode, mSlidingWindowKVCache, max_batch_beam, max_attention_window};
+    std::lock_guard<std::mutex> lock(gGenerationKernelProfilesMutex);
+    const auto iter = gGenerationKernelProfiles.find(key);
+    if (iter != gGenerationKernelProfiles.end())
+    {
+        std::memcpy(&mGenerationKernels, iter->second.data(), sizeof(mGenerationKernels));
+        mGenerationKernelsProfiled = true;
+        return;
+    }
+
+    if (mType == nvinfer1::DataType::kHALF)
+    {
+        profileGenerationKernelsDispatchKVCacheType<half>(max_batch_beam, max_attention_window);
+    }
+    else if (mType == nvinfer1::DataType::kFLOAT)
+    {
+        profileGenerationKernelsDispatchKVCacheType<float>(max_batch_beam, max_attention_window);
+    }
+#ifdef ENABLE_BF16
+    else if (mType == nvinfer1::DataType::kBF16)
+    {
+        profileGenerationKernelsDispatchKVCacheType<__nv_bfloat16>(max_batch_beam, max_attention_window);
+    }
+#endif
+    mGenerationKernelsProfiled = true;
+
+    std::vector<int8_t> profile(sizeof(mGenerationKernels));
+    std::memcpy(profile.data(), &mGenerationKernels, sizeof(mGenerationKernels));
+    gGenerationKernelProfiles.emplace(key, std::move(profile));
+}
+
 int GPTAttentionPluginCommon::initialize() noexcept
 {
     auto cublasHandle = getCublasHandle();
@@ -1245,7 +1807,7 @@ int GPTAttentionPluginCommon::initialize() noexcept
     getEnvMmhaBlocksPerSequence();
 
     mCublasWrapper.reset(new tc::CublasMMWrapper(cublasHandle, cublasLtHandle, nullptr, nullptr));
-    if (mEnableContextFMHA)
+    if (mEnableContextFMHA && !usePagedContextAttention())
     {
         // Pre-checked during constructing.
         Data_type data_type;
@@ -1282,8 +1844,7 @@ int GPTAttentionPluginCommon::initialize() noexcept
         }
         if (use_xqa)
         {
-            mDecoderXQARunner.reset(
-                new DecoderXQARunner(xqa_runner_data_type, mNumHeads, mNumKVHeads, mHeadSize, mMultiBlockMode));
+            mDecoderXQARunner.reset(new DecoderXQARunner(xqa_runner_data_type, mNumHeads, mNumKVHeads, mHeadSize));
         }
     }
 
@@ -1304,7 +1865,9 @@ size_t GPTAttentionPluginCommon::getCommonSerializationSize() noexcept
         + sizeof(mMultiBlockMode) + sizeof(unsigned int) // mKVCacheQuantMode
         + sizeof(mRemovePadding) + sizeof(mMaskType) + sizeof(mPagedKVCache) + sizeof(mTokensPerBlock) + sizeof(mType)
         + sizeof(mMaxContextLength) + sizeof(mQKVBiasEnabled) + sizeof(mCrossAttention) + sizeof(mMaxDistance)
-        + sizeof(mPagedContextFMHA) + sizeof(mUseKVCache) + sizeof(mUnfuseQkvGemm);
+        + sizeof(mPagedContextFMHA) + sizeof(mUseKVCache) + sizeof(mUnfuseQkvGemm) + sizeof(mSlidingWindowKVCache)
+        + sizeof(mBlockSparseParams) + sizeof(mBlockCacheIndirection) + sizeof(mSinkTokenLength)
+        + sizeof(mGenerationKernelsProfiled) + sizeof(mGenerationKernels);
 }
 
 void GPTAttentionPluginCommon::serializeCommon(void* buffer) const noexcept
@@ -1339,6 +1902,12 @@ void GPTAttentionPluginCommon::serializeCommon(void* buffer) const noexcept
     write(d, mMaxDistance);
     write(d, mPagedContextFMHA);
     write(d, mUseKVCache);
+    write(d, mSlidingWindowKVCache);
+    write(d, mBlockSparseParams);
+    write(d, mBlockCacheIndirection);
+    write(d, mSinkTokenLength);
+    write(d, mGenerationKernelsProfiled);
+    write(d, mGenerationKernels);
     assert(d == a + getCommonSerializationSize());
 }
 
@@ -1381,6 +1950,13 @@ GPTAttentionPluginCreatorCommon::GPTAttentionPluginCreatorCommon()
     mPluginAttributes.emplace_back(PluginField("max_distance", nullptr, PluginFieldType::kINT32, 0));
     mPluginAttributes.emplace_back(PluginField("use_paged_context_fmha", nullptr, PluginFieldType::kINT8, 0));
     mPluginAttributes.emplace_back(PluginField("use_cache", nullptr, PluginFieldType::kINT32, 0));
+    mPluginAttributes.emplace_back(PluginField("sliding_window_kv_cache", nullptr, PluginFieldType::kINT8, 0));
+    mPluginAttributes.emplace_back(PluginField("block_sparse_block_size", nullptr, PluginFieldType::kINT32, 0));
+    mPluginAttributes.emplace_back(PluginField("block_sparse_homo_head_pattern", nullptr, PluginFieldType::kINT8, 0));
+    mPluginAttributes.emplace_back(PluginField("block_sparse_num_local_blocks", nullptr, PluginFieldType::kINT32, 0));
+    mPluginAttributes.emplace_back(PluginField("block_sparse_vertical_stride", nullptr, PluginFieldType::kINT32, 0));
+    mPluginAttributes.emplace_back(PluginField("block_cache_indirection", nullptr, PluginFieldType::kINT8, 0));
+    mPluginAttributes.emplace_back(PluginField("sink_token_length", nullptr, PluginFieldType::kINT32, 0));
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
 }
@@ -22,8 +22,11 @@
 #include "tensorrt_llm/kernels/contextFusedMultiHeadAttention/fused_multihead_attention_common.h"
 #include "tensorrt_llm/kernels/decoderMaskedMultiheadAttention/decoderXQARunner.h"
 #include "tensorrt_llm/kernels/gptKernels.h"
+#include "tensorrt_llm/kernels/kvCacheScaleCalibration.h"
 #include "tensorrt_llm/plugins/common/plugin.h"
+#include <array>
 #include <cassert>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -45,7 +48,10 @@ public:
         tensorrt_llm::kernels::ContextFMHAType context_fmha_type, bool multi_block_mode, int kv_cache_quant_mode,
         bool remove_input_padding, tensorrt_llm::kernels::AttentionMaskType mask_type, bool paged_kv_cache,
         int tokens_per_block, nvinfer1::DataType type, int32_t max_context_length, bool qkv_bias_enabled,
-        bool cross_attention = false, int max_distance = 0, bool use_paged_context_fmha = false, bool use_cache = true);
+        bool cross_attention = false, int max_distance = 0, bool use_paged_context_fmha = false, bool use_cache = true,
+        bool sliding_window_kv_cache = false,
+        tensorrt_llm::kernels::BlockSparseParams block_sparse_params = tensorrt_llm::kernels::BlockSparseParams{},
+        bool block_cache_indirection = false, int sink_token_length = 0);
 
     GPTAttentionPluginCommon(const void* data, size_t length);
 
@@ -74,7 +80,40 @@ public:
     void serializeCommon(void* buffer) const noexcept;
     const int getHeadSize(bool checkInit = true) const;
 
+    //! Benchmarks the generation kernels eligible for this layer on synthetic inputs, for each bucket of
+    //! batch_size * beam_width and of cached tokens up to the given sizes, and keeps the fastest of each bucket.
+    //! The choices are serialized with the plugin. Runs once per plugin configuration.
+    void profileGenerationKernels(int32_t max_batch_beam, int32_t max_attention_window);
+
 protected:
+    // Kernels the generation phase chooses between. kHEURISTIC keeps the hand-written selection of enqueueGeneration.
+    enum class GenerationAttentionKernel : int8_t
+    {
+        kHEURISTIC = 0,
+        kMMHA = 1,
+        kMMHA_MULTI_BLOCK = 2,
+        kXQA = 3,
+        kGQA_DECODE = 4,
+    };
+
+    // The profiled choices are bucketed by powers of two of batch_size * beam_width (1 to 512) and of the number of
+    // cached tokens (up to 256, 512, ..., 128K).
+    static constexpr int kGenerationKernelBatchBuckets = 10;
+    static constexpr int kGenerationKernelLengthBuckets = 10;
+    static constexpr int kGenerationKernelMinLength = 256;
+    using GenerationKernelTable = std::array<std::array<GenerationAttentionKernel, kGenerationKernelLengthBuckets>,
+        kGenerationKernelBatchBuckets>;
+
+    // The profiled kernel for the shape, or kHEURISTIC if the shape was not profiled. Beam search is not profiled.
+    GenerationAttentionKernel getGenerationKernel(
+        int32_t beam_width, int32_t batch_beam, int32_t num_cached_tokens) const;
+
+    template <typename T>
+    void profileGenerationKernelsDispatchKVCacheType(int32_t max_batch_beam, int32_t max_attention_window);
+
+    template <typename T, typename KVCacheBuffer>
+    void profileGenerationKernelsImpl(int32_t max_batch_beam, int32_t max_attention_window);
+
     int getMaxNumSeqLenTile(int batch_beam_size = 1) const;
     size_t getWorkspaceSizeForContext(nvinfer1::DataType type, int32_t nbReq, int32_t max_input_length,
         int32_t max_kv_cache_len, int32_t cross_qkv_length = 0) const noexcept;
@@ -188,11 +227,26 @@ protected:
         return mCrossAttention;
     }
 
+    // Whether the precompiled fused MHA kernels cover the head size for the contiguous or paged context path.
+    bool isContextFMHACubinSupported() const;
+
+    // Whether invokePagedContextAttention can replace the fused MHA kernels, reading K/V back from the KV cache.
+    bool canUsePagedContextAttention() const;
+
+    // Context FMHA is enabled but falls back to invokePagedContextAttention for this head size.
+    bool usePagedContextAttention() const
+    {
+        return mEnableContextFMHA && !isContextFMHACubinSupported();
+    }
+
     bool useKVCache() const
     {
         return mUseKVCache;
     }
 
+    // Whether the layer can use invokeGQADecodeAttention in the generation phase with beam width 1.
+    bool canUseGQADecodeAttention() const;
+
 protected:
     static constexpr int kReservedMaxSeqLenTilePerSeq = 64;
 
@@ -241,6 +295,25 @@ protected:
     // The default copy constructor will leave it as nullptr. clone() shall initialize it.
     UniqPtrWNullCopy<tensorrt_llm::common::CublasMMWrapper> mCublasWrapper;
     bool mUseKVCache = true;
+    // The paged blocks of a sequence form a ring longer than the attention window, so blocks that slide out of
+    // the window can be released by the KV cache manager instead of being overwritten in place.
+    bool mSlidingWindowKVCache = false;
+    // The pattern of the BLOCKSPARSE mask.
+    tensorrt_llm::kernels::BlockSparseParams mBlockSparseParams{};
+    // The cache indirection of beam search is [batch, beam, 1 + tokens_per_block]: the beam whose block pointers
+    // hold the blocks before the current one, then the beam whose cache holds each token of the current block.
+    bool mBlockCacheIndirection = false;
+    // Attention sinks: the first sink_token_length tokens keep the first slots of the cyclic KV cache, the following
+    // ones roll over the remaining slots. The sink keys are scored at positions that follow the cache.
+    int mSinkTokenLength = 0;
+    // The recalibrated scales of the 8-bit KV cache with kvCacheOnlineScaling, shared by the clones of the plugin.
+    std::shared_ptr<tensorrt_llm::kernels::KvCacheScaleCalibration> mKvCacheScaleCalibration;
+    // The generation kernel chosen by profileGenerationKernels for each shape bucket.
+    bool mGenerationKernelsProfiled = false;
+    GenerationKernelTable mGenerationKernels{};
+    // Only used while profiling: the kernel enqueueGeneration is asked to run and the one it ran.
+    GenerationAttentionKernel mForcedGenerationKernel = GenerationAttentionKernel::kHEURISTIC;
+    GenerationAttentionKernel mLastGenerationKernel = GenerationAttentionKernel::kHEURISTIC;
 };
 
 class GPTAttentionPluginCreatorCommon : public BaseCreator
@@ -15,6 +15,8 @@
  * limitations under the License.
  */
 #include "gptAttentionPlugin.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/nvtxUtils.h"
 #include "tensorrt_llm/kernels/decoderMaskedMultiheadAttention.h"
 #include "tensorrt_llm/kernels/gptKernels.h"
 #include "tensorrt_llm/kernels/unfusedAttentionKernels.h"
@@ -45,12 +47,14 @@ GPTAttentionPlugin::GPTAttentionPlugin(int num_heads, int num_kv_heads, int head
     tensorrt_llm::kernels::ContextFMHAType context_fmha_type, bool multi_block_mode, int kv_cache_quant_mode,
     bool remove_input_padding, tensorrt_llm::kernels::AttentionMaskType mask_type, bool paged_kv_cache,
     int tokens_per_block, nvinfer1::DataType type, int32_t max_context_length, bool qkv_bias_enabled,
-    bool cross_attention, int max_distance, bool use_paged_context_fmha, bool use_cache)
+    bool cross_attention, int max_distance, bool use_paged_context_fmha, bool use_cache, bool sliding_window_kv_cache,
+    tensorrt_llm::kernels::BlockSparseParams block_sparse_params, bool block_cache_indirection, int sink_token_length)
     : GPTAttentionPluginCommon(num_heads, num_kv_heads, head_size, unidirectional, q_scaling, position_embedding_type,
         rotary_embedding_dim, rotary_embedding_base, rotary_embedding_scale_type, rotary_embedding_scale,
         rotary_embedding_max_positions, tp_size, tp_rank, unfuse_qkv_gemm, context_fmha_type, multi_block_mode,
         kv_cache_quant_mode, remove_input_padding, mask_type, paged_kv_cache, tokens_per_block, type,
-        max_context_length, qkv_bias_enabled, cross_attention, max_distance, use_paged_context_fmha, use_cache)
+        max_context_length, qkv_bias_enabled, cross_attention, max_distance, use_paged_context_fmha, use_cache,
+        sliding_window_kv_cache, block_sparse_params, block_cache_indirection, sink_token_length)
 {
     initEntryIdx();
 }
@@ -108,6 +112,11 @@ GPTAttentionPlugin::IndexType GPTAttentionPlugin::getIdx(const IdxEntry& entry)
     return mEntryIdx[static_cast<size_t>(entry)];
 }
 
+int GPTAttentionPlugin::getBlockCacheIndirectionWindow(nvinfer1::Dims const& blockPointersDims) const
+{
+    return blockPointersDims.d[blockPointersDims.nbDims - 1] * mTokensPerBlock;
+}
+
 // IPluginV2DynamicExt Methods
 GPTAttentionPlugin* GPTAttentionPlugin::clone() const noexcept
 {
@@ -196,6 +205,21 @@ void GPTAttentionPlugin::configurePlugin(const nvinfer1::DynamicPluginTensorDesc
     const nvinfer1::DynamicPluginTensorDesc* out, int nbOutputs) noexcept
 {
     TLLM_CHECK(mHeadSize > 0);
+    if (tensorrt_llm::common::getEnvProfileGenerationAttention() && useKVCache() && !isCrossAttention())
+    {
+        try
+        {
+            const int max_batch_beam = in[getIdx(IdxEntry::CONTEXT_LENGTHS)].max.d[0];
+            const int max_attention_window = mBlockCacheIndirection
+                ? getBlockCacheIndirectionWindow(in[getIdx(IdxEntry::KV_CACHE_BLOCK_POINTERS)].max)
+                : in[getIdx(IdxEntry::CACHE_INDIR)].max.d[2];
+            profileGenerationKernels(max_batch_beam, max_attention_window);
+        }
+        catch (const std::exception& e)
+        {
+            caughtError(e);
+        }
+    }
 }
 
 size_t GPTAttentionPlugin::getWorkspaceSize(const nvinfer1::PluginTensorDesc* inputs, int nbInputs,
@@ -205,8 +229,16 @@ size_t GPTAttentionPlugin::getWorkspaceSize(const nvinfer1::PluginTensorDesc* in
     const int cross_qkv_length = isCrossAttention() ? inputs[getIdx(IdxEntry::CROSS_QKV_LENGTH)].dims.d[0] : 0;
     const int nbReq = inputs[getIdx(IdxEntry::CONTEXT_LENGTHS)].dims.d[0];
     auto const type = inputs[getIdx(IdxEntry::QKV_TENSOR)].type;
-    const int max_kv_cache_length
-        = isCrossAttention() ? cross_qkv_length : (useKVCache() ? inputs[getIdx(IdxEntry::CACHE_INDIR)].dims.d[2] : 0);
+    const int max_kv_cache_length = [&]()
+    {
+        if (isCrossAttention() || !useKVCache())
+        {
+            return cross_qkv_length;
+        }
+        return mBlockCacheIndirection
+            ? getBlockCacheIndirectionWindow(inputs[getIdx(IdxEntry::KV_CACHE_BLOCK_POINTERS)].dims)
+            : inputs[getIdx(IdxEntry::CACHE_INDIR)].dims.d[2];
+    }();
     size_t const context_workspace_size
         = getWorkspaceSizeForContext(type, nbReq, max_context_length, max_kv_cache_length, cross_qkv_length);
 
@@ -275,6 +307,7 @@ int GPTAttentionPlugin::enqueueImpl(const nvinfer1::PluginTensorDesc* inputDesc,
         auto seqIdxBeg = 0;
         auto tokenIdxBeg = 0;
         auto localNbTokens = contextTokenIdxEnd;
+        NVTX3_SCOPED_RANGE_IN(context_attention, Context, localNbTokens);
         enqueueSome<T, KVCacheBuffer>(seqIdxBeg, nbContextRequests, tokenIdxBeg, localNbTokens, inputDesc, outputDesc,
             inputs, outputs, workspace, stream);
     }
@@ -284,6 +317,7 @@ int GPTAttentionPlugin::enqueueImpl(const nvinfer1::PluginTensorDesc* inputDesc,
         auto seqIdxBeg = nbContextRequests;
         auto tokenIdxBeg = contextTokenIdxEnd;
         auto localNbTokens = nbGenerationSeq;
+        NVTX3_SCOPED_RANGE_IN(generation_attention, Generation, nbGenerationSeq);
         enqueueSome<T, KVCacheBuffer>(seqIdxBeg, nbGenerationSeq, tokenIdxBeg, localNbTokens, inputDesc, outputDesc,
             inputs, outputs, workspace, stream);
     }
@@ -374,13 +408,23 @@ int GPTAttentionPlugin::enqueueSome(int32_t seqIdxBeg, int32_t localNbSeq, int32
     // -- max_encoder_context_len: len of encoder input (in cross attn). Also called encoder_input_seq_length
 
     const int beamWidth = useKVCache() ? inputDesc[getIdx(IdxEntry::CACHE_INDIR)].dims.d[1] : 1;
+    TLLM_CHECK_WITH_INFO(!mBlockCacheIndirection || beamWidth == 1
+            || inputDesc[getIdx(IdxEntry::CACHE_INDIR)].dims.d[2] == 1 + mTokensPerBlock,
+        "The block cache indirection must have 1 + tokens_per_block (%d) entries per beam", 1 + mTokensPerBlock);
 
     // Commonly, cyclic_attention_window_size, and max_attention_window_size will be the same
     // unless each layer has different attention window sizes.
     // the kv_cache capacity.
-    const int max_attention_window_size = isCrossAttention()
-        ? max_encoder_context_len
-        : (useKVCache() ? inputDesc[getIdx(IdxEntry::CACHE_INDIR)].dims.d[2] : 0);
+    const int max_attention_window_size = [&]()
+    {
+        if (isCrossAttention() || !useKVCache())
+        {
+            return max_encoder_context_len;
+        }
+        return mBlockCacheIndirection
+            ? getBlockCacheIndirectionWindow(inputDesc[getIdx(IdxEntry::KV_CACHE_BLOCK_POINTERS)].dims)
+            : inputDesc[getIdx(IdxEntry::CACHE_INDIR)].dims.d[2];
+    }();
     // The cyclic_attention_window_size will determine the cyclic kv cache position of new tokens.
     // Note that this cyclic_attention_window_size might be smaller than the actual kv cache capactity.
     const int cyclic_attention_window_size = isCrossAttention()
@@ -395,6 +439,13 @@ int GPTAttentionPlugin::enqueueSome(int32_t seqIdxBeg, int32_t localNbSeq, int32
         assert(inputDesc[getIdx(IdxEntry::KV_CACHE_DEQUANTIZATION_SCALE)].type == nvinfer1::DataType::kFLOAT);
         kv_scale_orig_quant = reinterpret_cast<const float*>(inputs[getIdx(IdxEntry::KV_CACHE_QUANTIZATION_SCALE)]);
         kv_scale_quant_orig = reinterpret_cast<const float*>(inputs[getIdx(IdxEntry::KV_CACHE_DEQUANTIZATION_SCALE)]);
+        if (mKvCacheScaleCalibration)
+        {
+            // The static scales of the engine only seed the ones recalibrated from the keys and values.
+            mKvCacheScaleCalibration->seed(kv_scale_orig_quant, kv_scale_quant_orig, stream);
+            kv_scale_orig_quant = mKvCacheScaleCalibration->getScaleOrigQuant();
+            kv_scale_quant_orig = mKvCacheScaleCalibration->getScaleQuantOrig();
+        }
     }
 
     int max_blocks_per_sequence = 0;
@@ -627,6 +678,12 @@ IPluginV2* GPTAttentionPluginCreator::createPlugin(const char* name, const Plugi
 
     try
     {
+        BlockSparseParams block_sparse_params{};
+        block_sparse_params.block_size = p.getScalar<int32_t>("block_sparse_block_size").value();
+        block_sparse_params.homo_head_pattern
+            = static_cast<bool>(p.getScalar<int8_t>("block_sparse_homo_head_pattern").value());
+        block_sparse_params.num_local_blocks = p.getScalar<int32_t>("block_sparse_num_local_blocks").value();
+        block_sparse_params.vertical_stride = p.getScalar<int32_t>("block_sparse_vertical_stride").value();
         auto* obj = new GPTAttentionPlugin(p.getScalar<int32_t>("num_heads").value(),
             p.getScalar<int32_t>("num_kv_heads").value(), p.getScalar<int32_t>("head_size").value(),
             p.getScalar<int32_t>("unidirectional").value(), p.getScalar<float>("q_scaling").value(),
@@ -651,7 +708,10 @@ IPluginV2* GPTAttentionPluginCreator::createPlugin(const char* name, const Plugi
             static_cast<bool>(p.getScalar<int8_t>("do_cross_attention").value()),
             static_cast<int32_t>(p.getScalar<int32_t>("max_distance").value()),
             static_cast<bool>(p.getScalar<int8_t>("use_paged_context_fmha").value()),
-            static_cast<bool>(p.getScalar<int32_t>("use_cache").value()));
+            static_cast<bool>(p.getScalar<int32_t>("use_cache").value()),
+            static_cast<bool>(p.getScalar<int8_t>("sliding_window_kv_cache").value()), block_sparse_params,
+            static_cast<bool>(p.getScalar<int8_t>("block_cache_indirection").value()),
+            p.getScalar<int32_t>("sink_token_length").value());
         obj->setPluginNamespace(mNamespace.c_str());
         return obj;
     }
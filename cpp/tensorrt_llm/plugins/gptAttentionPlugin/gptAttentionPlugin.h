@@ -48,7 +48,8 @@ namespace tensorrt_llm::plugins
 //     2.  host_past_key_value_lengths [batch_size] (int32) (optional)
 //     3.  host_max_attention_window_sizes [1] (int32)
 //     4.  context_lengths [batch_size]
-//     5.  cache_indir [num_gen_requests, beam_width, memory_max_len] (required in beamsearch) (optional)
+//     5.  cache_indir [num_gen_requests, beam_width, memory_max_len] (required in beamsearch) (optional), or
+//                      [num_gen_requests, beam_width, 1 + tokens_per_block] with block_cache_indirection
 //     6.  host_request_types [batch_size] int32. 0: context; 1: generation: 2: none. When not in inflight-batching
 //     mode,
 //                      all elements must be identical.
@@ -78,7 +79,10 @@ public:
         tensorrt_llm::kernels::ContextFMHAType context_fmha_type, bool multi_block_mode, int kv_cache_quant_mode,
         bool remove_input_padding, tensorrt_llm::kernels::AttentionMaskType mask_type, bool paged_kv_cache,
         int tokens_per_block, nvinfer1::DataType type, int32_t max_context_length, bool qkv_bias_enabled,
-        bool cross_attention = false, int max_distance = 0, bool use_paged_context_fmha = false, bool use_cache = true);
+        bool cross_attention = false, int max_distance = 0, bool use_paged_context_fmha = false, bool use_cache = true,
+        bool sliding_window_kv_cache = false,
+        tensorrt_llm::kernels::BlockSparseParams block_sparse_params = tensorrt_llm::kernels::BlockSparseParams{},
+        bool block_cache_indirection = false, int sink_token_length = 0);
 
     GPTAttentionPlugin(const void* data, size_t length);
 
@@ -166,6 +170,10 @@ private:
     bool isEntryUsed(const IdxEntry& entry) const;
     void initEntryIdx();
     IndexType getIdx(const IdxEntry& entry) const;
+
+    // The KV cache capacity of a sequence is the last dimension of the cache indirection. The block cache indirection
+    // only covers one block, so the capacity is given by the block pointers instead.
+    int getBlockCacheIndirectionWindow(nvinfer1::Dims const& blockPointersDims) const;
 };
 
 class GPTAttentionPluginCreator : public GPTAttentionPluginCreatorCommon
@@ -0,0 +1,264 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "groupedGemmPlugin.h"
+#include "tensorrt_llm/kernels/groupGemm.h"
+#include "tensorrt_llm/runtime/iBuffer.h"
+
+using namespace nvinfer1;
+using namespace tensorrt_llm::common;
+using tensorrt_llm::plugins::GroupedGemmPluginCreator;
+using tensorrt_llm::plugins::GroupedGemmPlugin;
+using tensorrt_llm::plugins::read;
+using tensorrt_llm::plugins::write;
+
+static const char* GROUPED_GEMM_PLUGIN_VERSION{"1"};
+static const char* GROUPED_GEMM_PLUGIN_NAME{"GroupedGemm"};
+PluginFieldCollection GroupedGemmPluginCreator::mFC{};
+std::vector<nvinfer1::PluginField> GroupedGemmPluginCreator::mPluginAttributes;
+
+GroupedGemmPlugin::GroupedGemmPlugin(int nbGemms, nvinfer1::DataType type)
+    : mNbGemms(nbGemms)
+    , mType(type)
+{
+    TLLM_CHECK_WITH_INFO(mType == nvinfer1::DataType::kHALF || mType == nvinfer1::DataType::kBF16,
+        "Grouped GEMM supports fp16 and bf16 only");
+}
+
+// Parameterized constructor
+GroupedGemmPlugin::GroupedGemmPlugin(const void* data, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(data), *a = d;
+    read(d, mNbGemms);
+    read(d, mType);
+    TLLM_CHECK(d == a + length);
+}
+
+// IPluginV2DynamicExt Methods
+nvinfer1::IPluginV2DynamicExt* GroupedGemmPlugin::clone() const noexcept
+{
+    auto* plugin = new GroupedGemmPlugin(*this);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+nvinfer1::DimsExprs GroupedGemmPlugin::getOutputDimensions(
+    int outputIndex, const nvinfer1::DimsExprs* inputs, int nbInputs, nvinfer1::IExprBuilder& exprBuilder) noexcept
+{
+    try
+    {
+        TLLM_CHECK(nbInputs == mNbGemms + 1);
+        TLLM_CHECK(outputIndex < mNbGemms);
+        const int nbDimsA = inputs[0].nbDims;
+        TLLM_CHECK(nbDimsA >= 2);
+        DimsExprs ret = inputs[0];
+        ret.d[nbDimsA - 1] = inputs[outputIndex + 1].d[0];
+        return ret;
+    }
+    catch (const std::exception& e)
+    {
+        caughtError(e);
+    }
+    return DimsExprs{};
+}
+
+bool GroupedGemmPlugin::supportsFormatCombination(
+    int pos, const nvinfer1::PluginTensorDesc* inOut, int nbInputs, int nbOutputs) noexcept
+{
+    // input, weights and outputs all have the plugin type
+    assert(0 <= pos && pos < 2 * mNbGemms + 1);
+    return inOut[pos].type == mType && inOut[pos].format == TensorFormat::kLINEAR;
+}
+
+void GroupedGemmPlugin::configurePlugin(const nvinfer1::DynamicPluginTensorDesc* in, int nbInputs,
+    const nvinfer1::DynamicPluginTensorDesc* out, int nbOutputs) noexcept
+{
+}
+
+size_t GroupedGemmPlugin::getWorkspaceSize(const nvinfer1::PluginTensorDesc* inputs, int nbInputs,
+    const nvinfer1::PluginTensorDesc* outputs, int nbOutputs) const noexcept
+{
+    return tensorrt_llm::kernels::getGroupedGemmParamsWorkSpaceSize(mNbGemms);
+}
+
+int GroupedGemmPlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc,
+    const nvinfer1::PluginTensorDesc* outputDesc, const void* const* inputs, void* const* outputs, void* workspace,
+    cudaStream_t stream) noexcept
+{
+    // inputs
+    //     input     [M(*), K]
+    //     weights_i [N_i, K]
+    // outputs
+    //     output_i  [M(*), N_i]
+    int m = 1;
+    for (int ii = 0; ii < inputDesc[0].dims.nbDims - 1; ++ii)
+    {
+        m *= inputDesc[0].dims.d[ii];
+    }
+    if (m == 0)
+    {
+        return 0;
+    }
+    const int k = inputDesc[0].dims.d[inputDesc[0].dims.nbDims - 1];
+
+    std::vector<cutlass::gemm::GemmCoord> problemSizes;
+    std::vector<void*> ptrA, ptrB, ptrC, ptrD;
+    for (int i = 0; i < mNbGemms; ++i)
+    {
+        const int n = inputDesc[i + 1].dims.d[0];
+        problemSizes.emplace_back(m, n, k);
+        ptrA.push_back(const_cast<void*>(inputs[0]));
+        ptrB.push_back(const_cast<void*>(inputs[i + 1]));
+        // beta is 0, C is not read
+        ptrC.push_back(outputs[i]);
+        ptrD.push_back(outputs[i]);
+    }
+
+    // The device-side scheduler needs no extra workspace besides the problem descriptions
+    tensorrt_llm::kernels::gropuedGemm(problemSizes, ptrA, ptrB, ptrC, ptrD, workspace,
+        tensorrt_llm::kernels::getGroupedGemmParamsWorkSpaceSize(mNbGemms), nullptr, 0, false, mType, stream);
+    sync_check_cuda_error();
+    return 0;
+}
+
+// IPluginV2Ext Methods
+nvinfer1::DataType GroupedGemmPlugin::getOutputDataType(
+    int index, const nvinfer1::DataType* inputTypes, int nbInputs) const noexcept
+{
+    TLLM_CHECK(index < mNbGemms);
+    return mType;
+}
+
+// IPluginV2 Methods
+
+const char* GroupedGemmPlugin::getPluginType() const noexcept
+{
+    return GROUPED_GEMM_PLUGIN_NAME;
+}
+
+const char* GroupedGemmPlugin::getPluginVersion() const noexcept
+{
+    return GROUPED_GEMM_PLUGIN_VERSION;
+}
+
+int GroupedGemmPlugin::getNbOutputs() const noexcept
+{
+    return mNbGemms;
+}
+
+int GroupedGemmPlugin::initialize() noexcept
+{
+    return 0;
+}
+
+void GroupedGemmPlugin::terminate() noexcept {}
+
+size_t GroupedGemmPlugin::getSerializationSize() const noexcept
+{
+    return sizeof(mNbGemms) + sizeof(mType);
+}
+
+void GroupedGemmPlugin::serialize(void* buffer) const noexcept
+{
+    char *d = static_cast<char*>(buffer), *a = d;
+    write(d, mNbGemms);
+    write(d, mType);
+    assert(d == a + getSerializationSize());
+}
+
+void GroupedGemmPlugin::destroy() noexcept
+{
+    // This gets called when the network containing plugin is destroyed
+    delete this;
+}
+
+///////////////
+
+GroupedGemmPluginCreator::GroupedGemmPluginCreator()
+{
+    // Fill PluginFieldCollection with PluginField arguments metadata
+    mPluginAttributes.clear();
+    mPluginAttributes.emplace_back(PluginField("num_gemms", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("type_id", nullptr, PluginFieldType::kINT32, 1));
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* GroupedGemmPluginCreator::getPluginName() const noexcept
+{
+    return GROUPED_GEMM_PLUGIN_NAME;
+}
+
+const char* GroupedGemmPluginCreator::getPluginVersion() const noexcept
+{
+    return GROUPED_GEMM_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* GroupedGemmPluginCreator::getFieldNames() noexcept
+{
+    return &mFC;
+}
+
+IPluginV2* GroupedGemmPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc) noexcept
+{
+    const PluginField* fields = fc->fields;
+    int nbGemms = 0;
+    nvinfer1::DataType type;
+    // Read configurations from each fields
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "num_gemms"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            nbGemms = *(static_cast<const int*>(fields[i].data));
+        }
+        else if (!strcmp(attrName, "type_id"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            type = static_cast<nvinfer1::DataType>(*(static_cast<const nvinfer1::DataType*>(fields[i].data)));
+        }
+    }
+    try
+    {
+        auto* obj = new GroupedGemmPlugin(nbGemms, type);
+        obj->setPluginNamespace(mNamespace.c_str());
+        return obj;
+    }
+    catch (const std::exception& e)
+    {
+        caughtError(e);
+    }
+    return nullptr;
+}
+
+IPluginV2* GroupedGemmPluginCreator::deserializePlugin(
+    const char* name, const void* serialData, size_t serialLength) noexcept
+{
+    // This object will be deleted when the network is destroyed, which will
+    // call GroupedGemmPlugin::destroy()
+    try
+    {
+        auto* obj = new GroupedGemmPlugin(serialData, serialLength);
+        obj->setPluginNamespace(mNamespace.c_str());
+        return obj;
+    }
+    catch (const std::exception& e)
+    {
+        caughtError(e);
+    }
+    return nullptr;
+}
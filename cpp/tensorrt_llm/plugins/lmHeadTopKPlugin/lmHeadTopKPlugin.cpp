@@ -0,0 +1,398 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "lmHeadTopKPlugin.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/dataType.h"
+#include "tensorrt_llm/kernels/lmHeadTopK.h"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+
+using namespace nvinfer1;
+using namespace tensorrt_llm::kernels;
+using namespace tensorrt_llm::common;
+using tensorrt_llm::plugins::LmHeadTopKPluginCreator;
+using tensorrt_llm::plugins::LmHeadTopKPlugin;
+
+static const char* LM_HEAD_TOP_K_PLUGIN_VERSION{"1"};
+static const char* LM_HEAD_TOP_K_PLUGIN_NAME{"LmHeadTopK"};
+PluginFieldCollection LmHeadTopKPluginCreator::mFC{};
+std::vector<nvinfer1::PluginField> LmHeadTopKPluginCreator::mPluginAttributes;
+
+LmHeadTopKPlugin::LmHeadTopKPlugin(
+    nvinfer1::DataType type, int topK, int vocabSize, int vocabOffset, int chunkSize, bool fullLogits)
+    : mType(type)
+    , mTopK(topK)
+    , mVocabSize(vocabSize)
+    , mVocabOffset(vocabOffset)
+    , mChunkSize(chunkSize)
+    , mFullLogits(fullLogits)
+{
+    TLLM_CHECK_WITH_INFO(0 < mTopK && mTopK <= kLmHeadMaxTopK, "The LM head keeps between 1 and %d candidates, got %d",
+        kLmHeadMaxTopK, mTopK);
+    TLLM_CHECK_WITH_INFO(mChunkSize > 0, "The vocabulary chunk of the LM head must not be empty");
+    init();
+}
+
+// Parameterized constructor
+LmHeadTopKPlugin::LmHeadTopKPlugin(const void* data, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(data), *a = d;
+    read(d, mType);
+    read(d, mTopK);
+    read(d, mVocabSize);
+    read(d, mVocabOffset);
+    read(d, mChunkSize);
+    read(d, mFullLogits);
+    init();
+    TLLM_CHECK(d == a + length);
+}
+
+void LmHeadTopKPlugin::init()
+{
+    auto cublasHandle = getCublasHandle();
+    auto cublasLtHandle = getCublasLtHandle();
+    mCublasWrapper = std::make_shared<CublasMMWrapper>(cublasHandle, cublasLtHandle, nullptr, nullptr);
+    if (mType == DataType::kHALF)
+    {
+        mCublasWrapper->setFP16GemmConfig();
+    }
+    else if (mType == DataType::kFLOAT)
+    {
+        mCublasWrapper->setFP32GemmConfig();
+    }
+#ifdef ENABLE_BF16
+    else if (mType == DataType::kBF16)
+    {
+        mCublasWrapper->setBF16GemmConfig();
+    }
+#endif
+}
+
+// IPluginV2DynamicExt Methods
+nvinfer1::IPluginV2DynamicExt* LmHeadTopKPlugin::clone() const noexcept
+{
+    auto* plugin = new LmHeadTopKPlugin(*this);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+nvinfer1::DimsExprs LmHeadTopKPlugin::getOutputDimensions(
+    int outputIndex, const nvinfer1::DimsExprs* inputs, int nbInputs, nvinfer1::IExprBuilder& exprBuilder) noexcept
+{
+    try
+    {
+        TLLM_CHECK(outputIndex < getNbOutputs());
+        // Top K logits and ids [..., topK], full logits [..., localVocabSize]
+        DimsExprs ret = inputs[0];
+        ret.d[ret.nbDims - 1] = outputIndex < 2 ? exprBuilder.constant(mTopK) : inputs[1].d[0];
+        return ret;
+    }
+    catch (const std::exception& e)
+    {
+        caughtError(e);
+    }
+    return DimsExprs{};
+}
+
+bool LmHeadTopKPlugin::supportsFormatCombination(
+    int pos, const nvinfer1::PluginTensorDesc* inOut, int nbInputs, int nbOutputs) noexcept
+{
+    TLLM_CHECK(nbInputs == 2 + static_cast<int>(mFullLogits));
+    if (inOut[pos].format != TensorFormat::kLINEAR)
+    {
+        return false;
+    }
+    if (pos < 2)
+    {
+        // hidden states and weight
+        return inOut[pos].type == mType;
+    }
+    if (pos < nbInputs)
+    {
+        // Mask of the rows that need the full logits
+        return inOut[pos].type == DataType::kINT32;
+    }
+    switch (pos - nbInputs)
+    {
+    case 0: return inOut[pos].type == DataType::kFLOAT;
+    case 1: return inOut[pos].type == DataType::kINT32;
+    default: return inOut[pos].type == mType;
+    }
+}
+
+void LmHeadTopKPlugin::configurePlugin(const nvinfer1::DynamicPluginTensorDesc* in, int nbInputs,
+    const nvinfer1::DynamicPluginTensorDesc* out, int nbOutputs) noexcept
+{
+}
+
+size_t LmHeadTopKPlugin::getWorkspaceSize(const nvinfer1::PluginTensorDesc* inputs, int nbInputs,
+    const nvinfer1::PluginTensorDesc* outputs, int nbOutputs) const noexcept
+{
+    size_t numRows = 1;
+    for (int i = 0; i < inputs[0].dims.nbDims - 1; ++i)
+    {
+        numRows *= inputs[0].dims.d[i];
+    }
+    const size_t chunkSize = std::min(mChunkSize, static_cast<int>(inputs[1].dims.d[0]));
+    return CUBLAS_WORKSPACE_SIZE + numRows * chunkSize * tensorrt_llm::common::getDTypeSize(mType);
+}
+
+template <typename T>
+void LmHeadTopKPlugin::enqueueForType(int numRows, int hiddenSize, int localVocabSize, const void* const* inputs,
+    void* const* outputs, void* workspace, cudaStream_t stream)
+{
+    const T* hidden = reinterpret_cast<const T*>(inputs[0]);
+    const T* weight = reinterpret_cast<const T*>(inputs[1]);
+    const int* fullLogitsMask = mFullLogits ? reinterpret_cast<const int*>(inputs[2]) : nullptr;
+    float* topKLogits = reinterpret_cast<float*>(outputs[0]);
+    int* topKIds = reinterpret_cast<int*>(outputs[1]);
+    T* fullLogits = mFullLogits ? reinterpret_cast<T*>(outputs[2]) : nullptr;
+    T* chunkLogits = reinterpret_cast<T*>(static_cast<char*>(workspace) + CUBLAS_WORKSPACE_SIZE);
+    const int vocabSize = mVocabSize > 0 ? mVocabSize : localVocabSize;
+
+    mCublasWrapper->setStream(stream);
+    mCublasWrapper->setWorkspace(workspace);
+    for (int chunkStart = 0; chunkStart < localVocabSize; chunkStart += mChunkSize)
+    {
+        const int chunkSize = std::min(mChunkSize, localVocabSize - chunkStart);
+        const int validSize = std::clamp(vocabSize - chunkStart, 0, chunkSize);
+
+        // chunkLogits [numRows, chunkSize] = hidden [numRows, hiddenSize] x weight [chunk, hiddenSize]^T
+        mCublasWrapper->createDescriptors(
+            CUBLAS_OP_T, CUBLAS_OP_N, chunkSize, numRows, hiddenSize, hiddenSize, hiddenSize, chunkSize);
+        mCublasWrapper->Gemm(CUBLAS_OP_T, CUBLAS_OP_N, chunkSize, numRows, hiddenSize,
+            weight + static_cast<size_t>(chunkStart) * hiddenSize, hiddenSize, hidden, hiddenSize, chunkLogits,
+            chunkSize, std::nullopt);
+        mCublasWrapper->destroyDescriptors();
+
+        invokeLmHeadTopKMerge(chunkLogits, numRows, chunkSize, validSize, mVocabOffset + chunkStart, topKLogits,
+            topKIds, mTopK, chunkStart == 0, fullLogits ? fullLogits + chunkStart : nullptr, localVocabSize,
+            fullLogitsMask, stream);
+    }
+}
+
+int LmHeadTopKPlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc,
+    const nvinfer1::PluginTensorDesc* outputDesc, const void* const* inputs, void* const* outputs, void* workspace,
+    cudaStream_t stream) noexcept
+{
+    // inputs
+    //     hidden [M(*), K]
+    //     weight [N, K], the shard of the LM head
+    //     full_logits_mask [M(*)] (if fullLogits)
+    // outputs
+    //     top_k_logits [M(*), topK], float
+    //     top_k_ids [M(*), topK], token ids
+    //     logits [M(*), N] (if fullLogits), only written for the rows of the mask
+
+    int numRows = 1;
+    for (int i = 0; i < inputDesc[0].dims.nbDims - 1; ++i)
+    {
+        numRows *= inputDesc[0].dims.d[i];
+    }
+    const int hiddenSize = inputDesc[0].dims.d[inputDesc[0].dims.nbDims - 1];
+    const int localVocabSize = inputDesc[1].dims.d[0];
+    if (numRows == 0)
+    {
+        return 0;
+    }
+
+    if (mType == DataType::kHALF)
+    {
+        enqueueForType<half>(numRows, hiddenSize, localVocabSize, inputs, outputs, workspace, stream);
+    }
+    else if (mType == DataType::kFLOAT)
+    {
+        enqueueForType<float>(numRows, hiddenSize, localVocabSize, inputs, outputs, workspace, stream);
+    }
+#ifdef ENABLE_BF16
+    else if (mType == DataType::kBF16)
+    {
+        enqueueForType<__nv_bfloat16>(numRows, hiddenSize, localVocabSize, inputs, outputs, workspace, stream);
+    }
+#endif
+
+    return 0;
+}
+
+// IPluginV2Ext Methods
+nvinfer1::DataType LmHeadTopKPlugin::getOutputDataType(
+    int index, const nvinfer1::DataType* inputTypes, int nbInputs) const noexcept
+{
+    assert(index < getNbOutputs());
+    switch (index)
+    {
+    case 0: return DataType::kFLOAT;
+    case 1: return DataType::kINT32;
+    default: return mType;
+    }
+}
+
+// IPluginV2 Methods
+
+const char* LmHeadTopKPlugin::getPluginType() const noexcept
+{
+    return LM_HEAD_TOP_K_PLUGIN_NAME;
+}
+
+const char* LmHeadTopKPlugin::getPluginVersion() const noexcept
+{
+    return LM_HEAD_TOP_K_PLUGIN_VERSION;
+}
+
+int LmHeadTopKPlugin::getNbOutputs() const noexcept
+{
+    return 2 + static_cast<int>(mFullLogits);
+}
+
+int LmHeadTopKPlugin::initialize() noexcept
+{
+    return 0;
+}
+
+void LmHeadTopKPlugin::terminate() noexcept {}
+
+size_t LmHeadTopKPlugin::getSerializationSize() const noexcept
+{
+    return sizeof(mType) + sizeof(mTopK) + sizeof(mVocabSize) + sizeof(mVocabOffset) + sizeof(mChunkSize)
+        + sizeof(mFullLogits);
+}
+
+void LmHeadTopKPlugin::serialize(void* buffer) const noexcept
+{
+    char *d = static_cast<char*>(buffer), *a = d;
+    write(d, mType);
+    write(d, mTopK);
+    write(d, mVocabSize);
+    write(d, mVocabOffset);
+    write(d, mChunkSize);
+    write(d, mFullLogits);
+    assert(d == a + getSerializationSize());
+}
+
+void LmHeadTopKPlugin::destroy() noexcept
+{
+    // This gets called when the network containing plugin is destroyed
+    delete this;
+}
+
+///////////////
+
+LmHeadTopKPluginCreator::LmHeadTopKPluginCreator()
+{
+    // Fill PluginFieldCollection with PluginField arguments metadata
+    mPluginAttributes.clear();
+    mPluginAttributes.emplace_back(PluginField("type_id", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("top_k", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("vocab_size", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("vocab_offset", nullptr, PluginFieldType::kINT32, 0));
+    mPluginAttributes.emplace_back(PluginField("chunk_size", nullptr, PluginFieldType::kINT32, 16384));
+    mPluginAttributes.emplace_back(PluginField("full_logits", nullptr, PluginFieldType::kINT32, 0));
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* LmHeadTopKPluginCreator::getPluginName() const noexcept
+{
+    return LM_HEAD_TOP_K_PLUGIN_NAME;
+}
+
+const char* LmHeadTopKPluginCreator::getPluginVersion() const noexcept
+{
+    return LM_HEAD_TOP_K_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* LmHeadTopKPluginCreator::getFieldNames() noexcept
+{
+    return &mFC;
+}
+
+IPluginV2* LmHeadTopKPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc) noexcept
+{
+    const PluginField* fields = fc->fields;
+    nvinfer1::DataType type{};
+    int topK{1};
+    int vocabSize{0};
+    int vocabOffset{0};
+    int chunkSize{16384};
+    bool fullLogits{false};
+    // Read configurations from each fields
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "type_id"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            type = static_cast<nvinfer1::DataType>(*(static_cast<const nvinfer1::DataType*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "top_k"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            topK = *(static_cast<const int*>(fields[i].data));
+        }
+        else if (!strcmp(attrName, "vocab_size"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            vocabSize = *(static_cast<const int*>(fields[i].data));
+        }
+        else if (!strcmp(attrName, "vocab_offset"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            vocabOffset = *(static_cast<const int*>(fields[i].data));
+        }
+        else if (!strcmp(attrName, "chunk_size"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            chunkSize = *(static_cast<const int*>(fields[i].data));
+        }
+        else if (!strcmp(attrName, "full_logits"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            fullLogits = static_cast<bool>(*(static_cast<const int*>(fields[i].data)));
+        }
+    }
+    try
+    {
+        auto* obj = new LmHeadTopKPlugin(type, topK, vocabSize, vocabOffset, chunkSize, fullLogits);
+        obj->setPluginNamespace(mNamespace.c_str());
+        return obj;
+    }
+    catch (const std::exception& e)
+    {
+        caughtError(e);
+    }
+    return nullptr;
+}
+
+IPluginV2* LmHeadTopKPluginCreator::deserializePlugin(
+    const char* name, const void* serialData, size_t serialLength) noexcept
+{
+    // This object will be deleted when the network is destroyed, which will
+    // call LmHeadTopKPlugin::destroy()
+    try
+    {
+        auto* obj = new LmHeadTopKPlugin(serialData, serialLength);
+        obj->setPluginNamespace(mNamespace.c_str());
+        return obj;
+    }
+    catch (const std::exception& e)
+    {
+        caughtError(e);
+    }
+    return nullptr;
+}
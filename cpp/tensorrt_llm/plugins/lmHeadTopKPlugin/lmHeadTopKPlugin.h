@@ -0,0 +1,118 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/common/cublasMMWrapper.h"
+#include "tensorrt_llm/plugins/common/plugin.h"
+#include <cassert>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tensorrt_llm::plugins
+{
+
+//! \brief LM head that returns the top K logits of each row and their token ids instead of the logits of the whole
+//! vocabulary, for greedy and top K decoding.
+//!
+//! The GEMM runs on chunks of the vocabulary and each chunk is merged into the running candidates, see
+//! invokeLmHeadTopKMerge, so only a [rows, chunk] tile of logits is written and read back. With fullLogits, the
+//! rows flagged by the mask input also get the logits of the whole vocabulary, for the requests that need log probs
+//! or penalties. The other rows of that output are not written.
+class LmHeadTopKPlugin : public BasePlugin
+{
+public:
+    using CublasGemmWrapperPtr = std::shared_ptr<tensorrt_llm::common::CublasMMWrapper>;
+
+    LmHeadTopKPlugin() = delete;
+
+    //! \param vocabSize number of tokens of the shard of the weight that may be selected, the rest is padding. The
+    //! whole shard if not positive
+    //! \param vocabOffset id of the first token of the shard of the weight
+    LmHeadTopKPlugin(nvinfer1::DataType type, int topK, int vocabSize, int vocabOffset, int chunkSize, bool fullLogits);
+
+    LmHeadTopKPlugin(const void* data, size_t length);
+
+    ~LmHeadTopKPlugin() override = default;
+
+    // IPluginV2DynamicExt Methods
+    nvinfer1::IPluginV2DynamicExt* clone() const noexcept override;
+    nvinfer1::DimsExprs getOutputDimensions(int outputIndex, const nvinfer1::DimsExprs* inputs, int nbInputs,
+        nvinfer1::IExprBuilder& exprBuilder) noexcept override;
+    bool supportsFormatCombination(
+        int pos, const nvinfer1::PluginTensorDesc* inOut, int nbInputs, int nbOutputs) noexcept override;
+    void configurePlugin(const nvinfer1::DynamicPluginTensorDesc* in, int nbInputs,
+        const nvinfer1::DynamicPluginTensorDesc* out, int nbOutputs) noexcept override;
+    size_t getWorkspaceSize(const nvinfer1::PluginTensorDesc* inputs, int nbInputs,
+        const nvinfer1::PluginTensorDesc* outputs, int nbOutputs) const noexcept override;
+    int enqueue(const nvinfer1::PluginTensorDesc* inputDesc, const nvinfer1::PluginTensorDesc* outputDesc,
+        const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream) noexcept override;
+
+    // IPluginV2Ext Methods
+    nvinfer1::DataType getOutputDataType(
+        int index, const nvinfer1::DataType* inputTypes, int nbInputs) const noexcept override;
+
+    // IPluginV2 Methods
+    const char* getPluginType() const noexcept override;
+    const char* getPluginVersion() const noexcept override;
+    int getNbOutputs() const noexcept override;
+    int initialize() noexcept override;
+    void terminate() noexcept override;
+    size_t getSerializationSize() const noexcept override;
+    void serialize(void* buffer) const noexcept override;
+    void destroy() noexcept override;
+
+private:
+    void init();
+
+    template <typename T>
+    void enqueueForType(int numRows, int hiddenSize, int localVocabSize, const void* const* inputs,
+        void* const* outputs, void* workspace, cudaStream_t stream);
+
+    const std::string mLayerName;
+    nvinfer1::DataType mType;
+    int mTopK;
+    int mVocabSize;
+    int mVocabOffset;
+    int mChunkSize;
+    bool mFullLogits;
+
+    CublasGemmWrapperPtr mCublasWrapper;
+};
+
+class LmHeadTopKPluginCreator : public BaseCreator
+{
+public:
+    LmHeadTopKPluginCreator();
+
+    const char* getPluginName() const noexcept override;
+
+    const char* getPluginVersion() const noexcept override;
+
+    const nvinfer1::PluginFieldCollection* getFieldNames() noexcept override;
+
+    nvinfer1::IPluginV2* createPlugin(const char* name, const nvinfer1::PluginFieldCollection* fc) noexcept override;
+
+    nvinfer1::IPluginV2* deserializePlugin(
+        const char* name, const void* serialData, size_t serialLength) noexcept override;
+
+private:
+    static nvinfer1::PluginFieldCollection mFC;
+    static std::vector<nvinfer1::PluginField> mPluginAttributes;
+};
+
+} // namespace tensorrt_llm::plugins
@@ -32,9 +32,10 @@ static const char* LOOKUP_PLUGIN_NAME{"Lookup"};
 PluginFieldCollection LookupPluginCreator::mFC{};
 std::vector<nvinfer1::PluginField> LookupPluginCreator::mPluginAttributes;
 
-LookupPlugin::LookupPlugin(nvinfer1::DataType type, int rank)
+LookupPlugin::LookupPlugin(nvinfer1::DataType type, int rank, int32_t counter)
     : mType(type)
     , mRank(rank)
+    , mCounter(counter)
 {
 }
 
@@ -44,6 +45,7 @@ LookupPlugin::LookupPlugin(const void* data, size_t length)
     const char *d = reinterpret_cast<const char*>(data), *a = d;
     read(d, mType);
     read(d, mRank);
+    read(d, mCounter);
     TLLM_CHECK(d == a + length);
 }
 
@@ -61,7 +63,7 @@ nvinfer1::DimsExprs LookupPlugin::getOutputDimensions(
 {
     try
     {
-        TLLM_CHECK(nbInputs == 2);
+        TLLM_CHECK(nbInputs == 2 + static_cast<int>(isVocabParallel()));
         TLLM_CHECK(outputIndex == 0);
         DimsExprs ret;
         const int nbDimsInput = inputs[0].nbDims;
@@ -86,12 +88,19 @@ nvinfer1::DimsExprs LookupPlugin::getOutputDimensions(
 bool LookupPlugin::supportsFormatCombination(
     int pos, const nvinfer1::PluginTensorDesc* inOut, int nbInputs, int nbOutputs) noexcept
 {
+    if (isVocabParallel() && pos == 2)
+    {
+        // All-reduce workspace
+        return (inOut[2].type == DataType::kINT64) && (inOut[2].format == TensorFormat::kLINEAR);
+    }
+
     bool res = false;
     switch (pos)
     {
     case 0: res = ((inOut[0].type == DataType::kINT32) && (inOut[0].format == TensorFormat::kLINEAR)); break;
-    case 1: res = ((inOut[1].type == mType) && (inOut[1].format == TensorFormat::kLINEAR)); break;
-    case 2: res = ((inOut[2].type == mType) && (inOut[2].format == TensorFormat::kLINEAR)); break;
+    case 1:
+    case 2:
+    case 3: res = ((inOut[pos].type == mType) && (inOut[pos].format == TensorFormat::kLINEAR)); break;
     default: // should NOT be here!
         res = false;
     }
@@ -116,6 +125,7 @@ int LookupPlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc, const nvi
     // inputs
     //     input  [batchSize]
     //     weight [localVocabSize, hidden]
+    //     workspace [3 * nRanks] (vocab parallel)
     // outputs
     //     embedding [batchSize, hidden]
 
@@ -131,6 +141,29 @@ int LookupPlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc, const nvi
 
     int offset = mRank * localVocabSize;
 
+    if (isVocabParallel())
+    {
+        const int nRanks = inputDesc[2].dims.d[0] / 3;
+        auto params = AllReduceParams::deserialize(
+            reinterpret_cast<const int32_t*>(inputs[2]), nRanks, mRank % nRanks, mCounter);
+        if (mType == DataType::kHALF)
+        {
+            invokeVocabParallelLookUp<half, int>(params, reinterpret_cast<half*>(outputs[0]), input,
+                reinterpret_cast<const half*>(inputs[1]), batchSize, offset, localVocabSize, hidden, stream);
+        }
+        else if (mType == DataType::kFLOAT)
+        {
+            invokeVocabParallelLookUp<float, int>(params, reinterpret_cast<float*>(outputs[0]), input,
+                reinterpret_cast<const float*>(inputs[1]), batchSize, offset, localVocabSize, hidden, stream);
+        }
+        else if (mType == DataType::kBF16)
+        {
+            invokeVocabParallelLookUp<__nv_bfloat16, int>(params, reinterpret_cast<__nv_bfloat16*>(outputs[0]), input,
+                reinterpret_cast<const __nv_bfloat16*>(inputs[1]), batchSize, offset, localVocabSize, hidden, stream);
+        }
+        return 0;
+    }
+
     if (mType == DataType::kHALF)
     {
         const half* weight = reinterpret_cast<const half*>(inputs[1]);
@@ -190,7 +223,7 @@ void LookupPlugin::destroy() noexcept
 
 size_t LookupPlugin::getSerializationSize() const noexcept
 {
-    return sizeof(mType) + sizeof(mRank);
+    return sizeof(mType) + sizeof(mRank) + sizeof(mCounter);
 }
 
 void LookupPlugin::serialize(void* buffer) const noexcept
@@ -198,6 +231,7 @@ void LookupPlugin::serialize(void* buffer) const noexcept
     char *d = static_cast<char*>(buffer), *a = d;
     write(d, mType);
     write(d, mRank);
+    write(d, mCounter);
 
     assert(d == a + getSerializationSize());
 }
@@ -212,6 +246,7 @@ LookupPluginCreator::LookupPluginCreator()
     mPluginAttributes.clear();
     mPluginAttributes.emplace_back(PluginField("type_id", nullptr, PluginFieldType::kINT32, 1));
     mPluginAttributes.emplace_back(PluginField("rank", nullptr, PluginFieldType::kINT32, 0));
+    mPluginAttributes.emplace_back(PluginField("counter", nullptr, PluginFieldType::kINT32, 0));
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
 }
@@ -236,6 +271,7 @@ IPluginV2* LookupPluginCreator::createPlugin(const char* name, const PluginField
     const PluginField* fields = fc->fields;
     nvinfer1::DataType type;
     int rank;
+    int32_t counter{0};
     // Read configurations from each fields
     for (int i = 0; i < fc->nbFields; ++i)
     {
@@ -250,10 +286,15 @@ IPluginV2* LookupPluginCreator::createPlugin(const char* name, const PluginField
             TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
             rank = static_cast<int>(*(static_cast<const int*>(fields[i].data)));
         }
+        else if (!strcmp(attrName, "counter"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            counter = *(static_cast<const int32_t*>(fields[i].data));
+        }
     }
     try
     {
-        auto* obj = new LookupPlugin(type, rank);
+        auto* obj = new LookupPlugin(type, rank, counter);
         obj->setPluginNamespace(mNamespace.c_str());
         return obj;
     }
@@ -30,7 +30,10 @@ class LookupPlugin : public BasePlugin
 public:
     LookupPlugin() = delete;
 
-    LookupPlugin(nvinfer1::DataType type, int rank);
+    //! \param counter Flag of the barriers on the all-reduce workspace, the instance id of the custom all-reduce plus
+    //! one. If not 0, the lookup takes the workspace as third input and combines the shards through the comm buffers of
+    //! the ranks itself, see invokeVocabParallelLookUp. Otherwise the shards must be summed by an all-reduce.
+    LookupPlugin(nvinfer1::DataType type, int rank, int32_t counter = 0);
 
     LookupPlugin(const void* data, size_t length);
 
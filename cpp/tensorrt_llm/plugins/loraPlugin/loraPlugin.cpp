@@ -18,6 +18,7 @@
 #include "tensorrt_llm/common/cudaUtils.h"
 #include "tensorrt_llm/common/memoryUtils.h"
 #include "tensorrt_llm/kernels/groupGemm.h"
+#include "tensorrt_llm/kernels/loraSgmv.h"
 #include "tensorrt_llm/runtime/iBuffer.h"
 
 #include "tensorrt_llm/common/assert.h"
@@ -306,11 +307,12 @@ int64_t getLowRankWorkSpaceSize(
 
 int64_t getCutlassWorkSpaceSize(int64_t nbReq)
 {
-    auto gemm_coord_size = divUp(nbReq * sizeof(cutlass::gemm::GemmCoord), 16) * 16;
-    auto ptr_size = 4 * divUp(nbReq * sizeof(half*), 16) * 16;
-    auto ldd_size = 4 * divUp(nbReq * sizeof(int64_t), 16) * 16;
+    return tensorrt_llm::kernels::getGroupedGemmParamsWorkSpaceSize(nbReq);
+}
 
-    return gemm_coord_size + ptr_size + ldd_size;
+int64_t getSgmvWorkSpaceSize(int64_t nbProblems)
+{
+    return divUp(nbProblems * static_cast<int64_t>(sizeof(tensorrt_llm::kernels::LoraSgmvProblem)), 16) * 16;
 }
 
 size_t LoraPlugin::getWorkspaceSize(const nvinfer1::PluginTensorDesc* inputs, int nbInputs,
@@ -323,7 +325,42 @@ size_t LoraPlugin::getWorkspaceSize(const nvinfer1::PluginTensorDesc* inputs, in
 
     return (size_t) CUBLAS_WORKSPACE_SIZE
         + getLowRankWorkSpaceSize(nbReq, mMaxContextLength, mNumLoraModules, mMaxLowRank, typeSize)
-        + getCutlassWorkSpaceSize(nbReq * mNumLoraModules);
+        + getCutlassWorkSpaceSize(nbReq * mNumLoraModules) + getSgmvWorkSpaceSize(nbReq * mNumLoraModules);
+}
+
+void runLoraSgmv(std::vector<tensorrt_llm::kernels::LoraSgmvProblem> const& problems, int maxOutHiddenSize,
+    int inHiddenSize, int lowRankStride, nvinfer1::DataType type, void* workspace, cudaStream_t stream)
+{
+    using tensorrt_llm::kernels::LoraSgmvProblem;
+    if (problems.empty())
+    {
+        return;
+    }
+    auto const problemsSize = problems.size() * sizeof(LoraSgmvProblem);
+    cudaAutoCpy(
+        static_cast<int8_t*>(workspace), reinterpret_cast<int8_t const*>(problems.data()), problemsSize, stream);
+    auto const* problemsDevice = static_cast<LoraSgmvProblem const*>(workspace);
+    auto const numProblems = static_cast<int>(problems.size());
+    // Only the requests in the generation phase are batched, they have a single row
+    int constexpr maxNumRows = 1;
+    switch (type)
+    {
+    case nvinfer1::DataType::kFLOAT:
+        tensorrt_llm::kernels::invokeLoraSgmv<float>(
+            problemsDevice, numProblems, maxNumRows, maxOutHiddenSize, inHiddenSize, lowRankStride, stream);
+        break;
+    case nvinfer1::DataType::kHALF:
+        tensorrt_llm::kernels::invokeLoraSgmv<half>(
+            problemsDevice, numProblems, maxNumRows, maxOutHiddenSize, inHiddenSize, lowRankStride, stream);
+        break;
+#ifdef ENABLE_BF16
+    case nvinfer1::DataType::kBF16:
+        tensorrt_llm::kernels::invokeLoraSgmv<__nv_bfloat16>(
+            problemsDevice, numProblems, maxNumRows, maxOutHiddenSize, inHiddenSize, lowRankStride, stream);
+        break;
+#endif
+    default: TLLM_THROW("Unsupported data type for the LoRA projections");
+    }
 }
 
 void runCublasGemmEx(const int M, const int N, const int K, const bool transA, const bool transB, const void* act,
@@ -372,6 +409,7 @@ int LoraPlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc, const nvinf
     void* cutlassWorkSpace = static_cast<char*>(lowRankWorkSpace)
         + getLowRankWorkSpaceSize(batch_size, mMaxContextLength, mNumLoraModules, mMaxLowRank, typeSize);
     int64_t cutlassWorkSpaceSize = getCutlassWorkSpaceSize(batch_size * mNumLoraModules);
+    void* sgmvWorkSpace = static_cast<char*>(cutlassWorkSpace) + cutlassWorkSpaceSize;
     size_t handled_token_num = 0;
 
     const int nbDimsA = inputDesc[0].dims.nbDims;
@@ -468,6 +506,12 @@ int LoraPlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc, const nvinf
         std::vector<void*> ptrD_2;
         ptrD_2.reserve(batch_size * mNumLoraModules);
 
+        // The requests in the generation phase have a single row, a GEMM each would mostly compute padding. They all
+        // go through the segmented kernel instead, in one launch per projection.
+        std::vector<tensorrt_llm::kernels::LoraSgmvProblem> sgmvProblems;
+        sgmvProblems.reserve(batch_size * mNumLoraModules);
+        int sgmvMaxOutHiddenSize = 0;
+
         for (int batchIdx = 0; batchIdx < batch_size; batchIdx++)
         {
             const RequestType reqType = reqTypes[batchIdx];
@@ -491,6 +535,20 @@ int LoraPlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc, const nvinf
                     const auto K
                         = mTransA ? inputDesc[0].dims.d[0] : inputDesc[0].dims.d[nbDimsA - 1]; // input hidden size
 
+                    if (reqType != RequestType::kCONTEXT)
+                    {
+                        const auto N2 = outputDesc[loraModuleIdx].dims.d[nbDimsA - 1];
+                        sgmvProblems.push_back({static_cast<char const*>(inputs[0]) + handled_token_num * K * typeSize,
+                            static_cast<char*>(lowRankWorkSpace)
+                                + (handled_token_num * mNumLoraModules * mMaxLowRank + loraModuleIdx * mMaxLowRank)
+                                    * typeSize,
+                            static_cast<char*>(outputs[loraModuleIdx]) + handled_token_num * N2 * typeSize,
+                            reinterpret_cast<void const*>(lora_weights_ptr[batchIdx * 2]),
+                            reinterpret_cast<void const*>(lora_weights_ptr[batchIdx * 2 + 1]), M, N, N2});
+                        sgmvMaxOutHiddenSize = std::max(sgmvMaxOutHiddenSize, N2);
+                        continue;
+                    }
+
                     cutlass::gemm::GemmCoord problem(M, N, K);
                     problem_sizes.push_back(problem);
 
@@ -519,12 +577,18 @@ int LoraPlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc, const nvinf
             }
             handled_token_num += M;
         }
-        tensorrt_llm::kernels::gropuedGemm(problem_sizes, ptrA, ptrB, ptrC, ptrD, cutlassWorkSpace,
-            cutlassWorkSpaceSize, cublasWorkSpace, CUBLAS_WORKSPACE_SIZE, true, mType, stream);
-        sync_check_cuda_error();
-        tensorrt_llm::kernels::gropuedGemm(problem_sizes_2, ptrA_2, ptrB_2, ptrC_2, ptrD_2, cutlassWorkSpace,
-            cutlassWorkSpaceSize, cublasWorkSpace, CUBLAS_WORKSPACE_SIZE, false, mType, stream);
-        sync_check_cuda_error();
+        if (!problem_sizes.empty())
+        {
+            tensorrt_llm::kernels::gropuedGemm(problem_sizes, ptrA, ptrB, ptrC, ptrD, cutlassWorkSpace,
+                cutlassWorkSpaceSize, cublasWorkSpace, CUBLAS_WORKSPACE_SIZE, true, mType, stream);
+            sync_check_cuda_error();
+            tensorrt_llm::kernels::gropuedGemm(problem_sizes_2, ptrA_2, ptrB_2, ptrC_2, ptrD_2, cutlassWorkSpace,
+                cutlassWorkSpaceSize, cublasWorkSpace, CUBLAS_WORKSPACE_SIZE, false, mType, stream);
+            sync_check_cuda_error();
+        }
+        auto const lowRankStride = mNumLoraModules * mMaxLowRank;
+        const auto inHiddenSize = mTransA ? inputDesc[0].dims.d[0] : inputDesc[0].dims.d[nbDimsA - 1];
+        runLoraSgmv(sgmvProblems, sgmvMaxOutHiddenSize, inHiddenSize, lowRankStride, mType, sgmvWorkSpace, stream);
     }
 
     TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
@@ -17,6 +17,7 @@
 #include "tensorrt_llm/plugins/mixtureOfExperts/mixtureOfExpertsPlugin.h"
 #include "tensorrt_llm/common/cudaBf16Wrapper.h"
 #include "tensorrt_llm/common/dataType.h"
+#include "tensorrt_llm/common/envUtils.h"
 #include "tensorrt_llm/common/quantization.h"
 #include <numeric>
 
@@ -39,7 +40,8 @@ std::vector<nvinfer1::PluginField> MixtureOfExpertsPluginCreator::mPluginAttribu
 MixtureOfExpertsPlugin::MixtureOfExpertsPlugin(int number_of_experts, int top_k, int expert_hidden_size,
     int expert_inter_size, tensorrt_llm::ActivationType activation_type, nvinfer1::DataType type,
     nvinfer1::DataType weight_type, QuantMode quant_mode, bool use_finished, bool use_bias, int tp_size, int tp_rank,
-    MOEParallelismMode parallelism_mode, MOEExpertScaleNormalizationMode normalization_mode,
+    MOEParallelismMode parallelism_mode, MOEExpertScaleNormalizationMode normalization_mode, std::set<int> ep_group,
+    std::vector<int> replicated_experts, int group_size, bool overlap_all_to_all,
     MixtureOfExpertsPluginProfilerPtr plugin_profiler_ptr)
     : mNumExperts(number_of_experts)
     , mK(top_k)
@@ -55,6 +57,10 @@ MixtureOfExpertsPlugin::MixtureOfExpertsPlugin(int number_of_experts, int top_k,
     , mTPRank(tp_rank)
     , mParallelismMode(parallelism_mode)
     , mNormalizationMode(normalization_mode)
+    , mEPGroup(std::move(ep_group))
+    , mReplicatedExperts(std::move(replicated_experts))
+    , mGroupSize(group_size)
+    , mOverlapAllToAll(overlap_all_to_all)
     , mPluginProfiler(std::move(plugin_profiler_ptr))
 {
     init();
@@ -76,6 +82,10 @@ tensorrt_llm::plugins::MixtureOfExpertsPlugin::MixtureOfExpertsPlugin(const Mixt
     , mTPRank(other.mTPRank)
     , mParallelismMode(other.mParallelismMode)
     , mNormalizationMode(other.mNormalizationMode)
+    , mEPGroup(other.mEPGroup)
+    , mReplicatedExperts(other.mReplicatedExperts)
+    , mGroupSize(other.mGroupSize)
+    , mOverlapAllToAll(other.mOverlapAllToAll)
     , mDims(other.mDims)
     , mGemmId(other.mGemmId)
     , mPluginProfiler(other.mPluginProfiler)
@@ -90,7 +100,10 @@ size_t MixtureOfExpertsPlugin::getSerializationSize() const noexcept
     return sizeof(mNumExperts) + sizeof(mK) + sizeof(mExpertHiddenSize) + sizeof(mExpertInterSize)
         + sizeof(mActivationType) + sizeof(mType) + sizeof(mWeightType) + sizeof(QuantMode::BaseType)
         + sizeof(mUseFinished) + sizeof(mUseBias) + sizeof(mTPSize) + sizeof(mTPRank) + sizeof(mParallelismMode)
-        + sizeof(mNormalizationMode) + sizeof(mDims) + mPluginProfiler->getSerializationSize(mGemmId);
+        + sizeof(mNormalizationMode) + sizeof(int) + sizeof(int) * mEPGroup.size() + sizeof(int)
+        + sizeof(int) * mReplicatedExperts.size() + sizeof(mGroupSize) + sizeof(mOverlapAllToAll)
+        + sizeof(mDims)
+        + mPluginProfiler->getSerializationSize(mGemmId);
 }
 
 MixtureOfExpertsPlugin::MixtureOfExpertsPlugin(
@@ -115,6 +128,23 @@ MixtureOfExpertsPlugin::MixtureOfExpertsPlugin(
     read(d, mTPRank);
     read(d, mParallelismMode);
     read(d, mNormalizationMode);
+    int ep_group_size{};
+    read(d, ep_group_size);
+    for (int i = 0; i < ep_group_size; ++i)
+    {
+        int rank{};
+        read(d, rank);
+        mEPGroup.insert(rank);
+    }
+    int num_replicated_experts{};
+    read(d, num_replicated_experts);
+    mReplicatedExperts.resize(num_replicated_experts);
+    for (int& expert : mReplicatedExperts)
+    {
+        read(d, expert);
+    }
+    read(d, mGroupSize);
+    read(d, mOverlapAllToAll);
     read(d, mDims);
 
     init();
@@ -141,6 +171,18 @@ void MixtureOfExpertsPlugin::serialize(void* buffer) const noexcept
     write(d, mTPRank);
     write(d, mParallelismMode);
     write(d, mNormalizationMode);
+    write(d, static_cast<int>(mEPGroup.size()));
+    for (int rank : mEPGroup)
+    {
+        write(d, rank);
+    }
+    write(d, static_cast<int>(mReplicatedExperts.size()));
+    for (int expert : mReplicatedExperts)
+    {
+        write(d, expert);
+    }
+    write(d, mGroupSize);
+    write(d, mOverlapAllToAll);
     write(d, mDims);
 
     mPluginProfiler->serialize(d, mGemmId);
@@ -191,8 +233,37 @@ void MixtureOfExpertsPlugin::init()
         TLLM_THROW("Could not construct the mixture of experts plugin with the requested input combination");
     }
 
+    if (useAllToAll())
+    {
+        TLLM_CHECK_WITH_INFO(mParallelismMode == MOEParallelismMode::EXPERT_PARALLELISM,
+            "The all-to-all dispatch requires expert parallelism");
+        TLLM_CHECK_WITH_INFO(static_cast<int>(mEPGroup.size()) == mTPSize, "The EP group must hold tp_size ranks");
+    }
+    TLLM_CHECK_WITH_INFO(!mOverlapAllToAll || useAllToAll(), "Overlapping the all-to-all requires the all-to-all");
+
+    if (!mReplicatedExperts.empty())
+    {
+        TLLM_CHECK_WITH_INFO(mParallelismMode == MOEParallelismMode::EXPERT_PARALLELISM,
+            "Replicating experts requires expert parallelism");
+        TLLM_CHECK_WITH_INFO(!useAllToAll(), "Replicating experts is not supported with the all-to-all dispatch");
+        TLLM_CHECK_WITH_INFO(mReplicatedExperts.size() <= MOEExpertReplication::MAX_REPLICATED_EXPERTS,
+            "Too many replicated experts");
+        MOEExpertReplication replication{};
+        replication.num_replicated_experts = mReplicatedExperts.size();
+        std::copy(mReplicatedExperts.begin(), mReplicatedExperts.end(), replication.replicated_experts);
+        mMOERunner->setExpertReplication(replication);
+    }
+
+    if (mGroupSize > 0)
+    {
+        TLLM_CHECK_WITH_INFO(hasExpertQuantScales(), "A group size requires quantized expert weights");
+        TLLM_CHECK_WITH_INFO(mExpertHiddenSize % mGroupSize == 0 && mExpertInterSize % mGroupSize == 0,
+            "The hidden and inter sizes must be multiples of the group size");
+        mMOERunner->setGroupSize(mGroupSize);
+    }
+
     mGemmId = GemmIDMoe{mNumExperts, mK, mExpertHiddenSize, mExpertInterSize, mActivationType, mType, mWeightType,
-        mQuantMode, mParallelismMode};
+        mQuantMode, mParallelismMode, mGroupSize};
 }
 
 // IPluginV2DynamicExt Methods
@@ -270,7 +341,7 @@ void MixtureOfExpertsPlugin::configurePlugin(const nvinfer1::DynamicPluginTensor
         mDims = {minM, maxM, maxN, maxK};
     }
     mGemmId = GemmIDMoe{mNumExperts, mK, mExpertHiddenSize, mExpertInterSize, mActivationType, mType, mWeightType,
-        mQuantMode, mParallelismMode};
+        mQuantMode, mParallelismMode, mGroupSize};
 }
 
 auto MixtureOfExpertsPlugin::setupWorkspace(void* base_ptr, int num_tokens) const -> WorkspaceInfo
@@ -316,6 +387,102 @@ auto MixtureOfExpertsPlugin::setupWorkspace(void* base_ptr, int num_tokens) cons
     return info;
 }
 
+int MixtureOfExpertsPlugin::getAllToAllMaxRecvRows(int num_tokens) const
+{
+    const int ep_size = mTPSize;
+    const int tokens_per_rank = tensorrt_llm::common::ceilDiv(num_tokens, ep_size);
+    return ep_size * tokens_per_rank * std::min(mK, mNumExperts / ep_size);
+}
+
+int MixtureOfExpertsPlugin::getAllToAllTacticTokens(int num_recv_rows) const
+{
+    const int ep_size = mTPSize;
+    const int num_tokens = tensorrt_llm::common::ceilDiv(num_recv_rows * ep_size, mK);
+    // A skewed routing can send more rows to this rank than the largest profile
+    return std::max(1, std::min(num_tokens, mDims.maxM));
+}
+
+auto MixtureOfExpertsPlugin::setupAllToAllWorkspace(void* base_ptr, int num_tokens) const -> AllToAllWorkspaceInfo
+{
+    const size_t dtype_size = tensorrt_llm::common::getDTypeSize(mType);
+    const int ep_size = mTPSize;
+    const size_t tokens_per_rank = tensorrt_llm::common::ceilDiv(num_tokens, ep_size);
+    const size_t expanded_rows = tokens_per_rank * mK;
+    const size_t max_recv_rows = getAllToAllMaxRecvRows(num_tokens);
+    const size_t hidden_size = mExpertHiddenSize;
+
+    // The received rows go through runMoe with k = 1
+    size_t moe_workspace_size = mMOERunner->getWorkspaceSize(max_recv_rows, mExpertHiddenSize, mExpertInterSize,
+        mNumExperts, 1, mActivationType, getParallelismConfig());
+
+    std::vector<size_t> workspaces{
+        expanded_rows * sizeof(float),                             // expert_scales
+        tokens_per_rank * mNumExperts * sizeof(float),             // softmax_temp
+        expanded_rows * sizeof(int),                               // expert_for_source_row
+        expanded_rows * sizeof(int),                               // source_rows
+        expanded_rows * sizeof(int),                               // dest_ranks
+        expanded_rows * sizeof(int),                               // expanded_rows
+        expanded_rows * sizeof(int),                               // sorted_dest_ranks
+        expanded_rows * sizeof(int),                               // sorted_expanded_rows
+        getMoeAllToAllSorterWorkspaceSize(expanded_rows, ep_size), // sorter_workspace
+        expanded_rows * sizeof(int),                               // expanded_row_to_send_row
+        2 * ep_size * sizeof(int),                                 // counts
+        expanded_rows * hidden_size * dtype_size,                  // send_rows
+        expanded_rows * sizeof(int),                               // send_experts
+        max_recv_rows * hidden_size * dtype_size,                  // recv_rows
+        max_recv_rows * sizeof(int),                               // recv_experts
+        max_recv_rows * mNumExperts * sizeof(float),               // recv_routing
+        moe_workspace_size,                                        // moe.workspace
+        max_recv_rows * mNumExperts * sizeof(float),               // moe.scale_probs
+        max_recv_rows * hidden_size * dtype_size,                  // moe.fc2_output
+        max_recv_rows * sizeof(int),                               // moe.src_to_dest_map
+        max_recv_rows * sizeof(int),                               // moe.selected_experts
+        max_recv_rows * hidden_size * dtype_size,                  // expert_output
+        expanded_rows * hidden_size * dtype_size,                  // returned_rows
+        ep_size * tokens_per_rank * hidden_size * dtype_size,      // gathered_output
+    };
+
+    AllToAllWorkspaceInfo info{};
+    info.size = calculateTotalWorkspaceSize(workspaces.data(), workspaces.size());
+
+    if (base_ptr)
+    {
+        std::vector<void*> ptrs{base_ptr};
+        for (size_t i = 0; i + 1 < workspaces.size(); ++i)
+        {
+            ptrs.push_back(nextWorkspacePtr(static_cast<int8_t*>(ptrs.back()), workspaces[i]));
+        }
+        auto it = ptrs.begin();
+        info.expert_scales = *it++;
+        info.softmax_temp = *it++;
+        info.expert_for_source_row = *it++;
+        info.source_rows = *it++;
+        info.dest_ranks = *it++;
+        info.expanded_rows = *it++;
+        info.sorted_dest_ranks = *it++;
+        info.sorted_expanded_rows = *it++;
+        info.sorter_workspace = *it++;
+        info.expanded_row_to_send_row = *it++;
+        info.counts = *it++;
+        info.send_rows = *it++;
+        info.send_experts = *it++;
+        info.recv_rows = *it++;
+        info.recv_experts = *it++;
+        info.recv_routing = *it++;
+        info.moe.workspace = *it++;
+        info.moe.scale_probs = *it++;
+        info.moe.fc2_output = *it++;
+        info.moe.src_to_dest_map = *it++;
+        info.moe.selected_experts = *it++;
+        info.expert_output = *it++;
+        info.returned_rows = *it++;
+        info.gathered_output = *it++;
+        assert(it == ptrs.end());
+    }
+
+    return info;
+}
+
 int MixtureOfExpertsPlugin::getNumTokens(const nvinfer1::PluginTensorDesc* input_tensors) const
 {
     int num_sequences = input_tensors[getInputTensorIndex()].dims.d[0];
@@ -327,6 +494,10 @@ size_t MixtureOfExpertsPlugin::getWorkspaceSize(const nvinfer1::PluginTensorDesc
     const nvinfer1::PluginTensorDesc* outputs, int nbOutputs) const noexcept
 {
     const int num_tokens = getNumTokens(inputs);
+    if (useAllToAll())
+    {
+        return setupAllToAllWorkspace(nullptr, num_tokens).size;
+    }
     return setupWorkspace(nullptr, num_tokens).size;
 }
 
@@ -344,6 +515,36 @@ MOEParallelismConfig MixtureOfExpertsPlugin::getParallelismConfig() const
     return {};
 }
 
+int MixtureOfExpertsPlugin::getNumLocalExperts() const
+{
+    const auto parallelism_config = getParallelismConfig();
+    const int experts_per_node = mNumExperts / parallelism_config.ep_size;
+    return parallelism_config.ep_size > 1 ? experts_per_node + static_cast<int>(mReplicatedExperts.size())
+                                          : experts_per_node;
+}
+
+void MixtureOfExpertsPlugin::logExpertLoad(cudaStream_t stream)
+{
+    const int num_local_experts = getNumLocalExperts();
+    std::vector<int64_t> counts(num_local_experts);
+    TLLM_CUDA_CHECK(cudaMemcpyAsync(
+        counts.data(), mExpertLoadCounts, num_local_experts * sizeof(int64_t), cudaMemcpyDeviceToHost, stream));
+    TLLM_CUDA_CHECK(cudaStreamSynchronize(stream));
+    TLLM_CUDA_CHECK(cudaMemsetAsync(mExpertLoadCounts, 0, num_local_experts * sizeof(int64_t), stream));
+
+    const auto parallelism_config = getParallelismConfig();
+    const int experts_per_node = mNumExperts / parallelism_config.ep_size;
+    std::stringstream ss;
+    for (int i = 0; i < num_local_experts; ++i)
+    {
+        const int expert = i < experts_per_node ? parallelism_config.ep_rank * experts_per_node + i
+                                                : mReplicatedExperts[i - experts_per_node];
+        ss << (i ? ", " : "") << expert << ":" << counts[i];
+    }
+    TLLM_LOG_INFO("MoE layer %p, rank %d, rows per expert over %d steps: %s", this, mTPRank, mExpertLoadLogInterval,
+        ss.str().c_str());
+}
+
 int MixtureOfExpertsPlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc,
     const nvinfer1::PluginTensorDesc* outputDesc, const void* const* inputs, void* const* outputs, void* workspace_ptr,
     cudaStream_t stream) noexcept
@@ -357,10 +558,10 @@ int MixtureOfExpertsPlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc,
     auto w1_desc = inputDesc[getExpertWeights1Index()];
     auto w2_desc = inputDesc[getExpertWeights2Index()];
     TLLM_CHECK(w1_desc.dims.nbDims == 3);
-    size_t experts_per_node = mNumExperts / parallelism_config.ep_size;
-    TLLM_CHECK(w1_desc.dims.d[0] == experts_per_node);
+    const int num_local_experts = getNumLocalExperts();
+    TLLM_CHECK(w1_desc.dims.d[0] == num_local_experts);
     TLLM_CHECK(w2_desc.dims.nbDims == 3);
-    TLLM_CHECK(w2_desc.dims.d[0] == experts_per_node);
+    TLLM_CHECK(w2_desc.dims.d[0] == num_local_experts);
 
     int packed_elements = getWeightPackedElements();
     int inner_dim_idx = getGemmShapeInnerDimIndex();
@@ -378,22 +579,252 @@ int MixtureOfExpertsPlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc,
     TLLM_CHECK(w2_desc.dims.d[inner_dim_idx] == mExpertInterSize);
     TLLM_CHECK(w2_desc.dims.d[outer_dim_idx] * packed_elements == mExpertHiddenSize);
 
-    mMOERunner->setTactic(mPluginProfiler->getBestConfig(num_tokens, mGemmId));
-    mMOERunner->runMoe(inputs[getInputTensorIndex()], static_cast<const float*>(inputs[getRoutingTensorIndex()]),
-        inputs[getExpertWeights1Index()], hasExpertQuantScales() ? inputs[getExpertQuantScale1Index()] : nullptr,
-        hasBias() ? inputs[getExpertBias1Index()] : nullptr, mActivationType, inputs[getExpertWeights2Index()],
-        hasExpertQuantScales() ? inputs[getExpertQuantScale2Index()] : nullptr,
-        hasBias() ? inputs[getExpertBias2Index()] : nullptr, num_tokens, mExpertHiddenSize, mExpertInterSize,
-        mNumExperts, mK, static_cast<char*>(workspace.workspace),
-        // Outputs
-        outputs[getOutputTensorIndex()], workspace.fc2_output,
-        hasFinishedTensor() ? static_cast<const bool*>(inputs[getFinishedTensorIndex()]) : nullptr, num_not_finished,
-        workspace.scale_probs, static_cast<int*>(workspace.src_to_dest_map),
-        static_cast<int*>(workspace.selected_experts), parallelism_config, mNormalizationMode, stream);
+    if (mGroupSize > 0)
+    {
+        // Groupwise scales are [experts, gemm_k / group_size, gemm_n]
+        auto s1_desc = inputDesc[getExpertQuantScale1Index()];
+        auto s2_desc = inputDesc[getExpertQuantScale2Index()];
+        TLLM_CHECK(s1_desc.dims.nbDims == 3 && s1_desc.dims.d[1] == mExpertHiddenSize / mGroupSize);
+        TLLM_CHECK(s2_desc.dims.nbDims == 3 && s2_desc.dims.d[1] == mExpertInterSize / mGroupSize);
+    }
+
+    if (useAllToAll())
+    {
+        if (mType == DataType::kHALF)
+        {
+            enqueueAllToAll<half>(inputDesc, inputs, outputs, workspace_ptr, stream);
+        }
+        else if (mType == DataType::kFLOAT)
+        {
+            enqueueAllToAll<float>(inputDesc, inputs, outputs, workspace_ptr, stream);
+        }
+#ifdef ENABLE_BF16
+        else if (mType == DataType::kBF16)
+        {
+            enqueueAllToAll<__nv_bfloat16>(inputDesc, inputs, outputs, workspace_ptr, stream);
+        }
+#endif
+    }
+    else
+    {
+        mMOERunner->setTactic(mPluginProfiler->getBestConfig(num_tokens, mGemmId));
+        mMOERunner->runMoe(inputs[getInputTensorIndex()], static_cast<const float*>(inputs[getRoutingTensorIndex()]),
+            inputs[getExpertWeights1Index()], hasExpertQuantScales() ? inputs[getExpertQuantScale1Index()] : nullptr,
+            hasBias() ? inputs[getExpertBias1Index()] : nullptr, mActivationType, inputs[getExpertWeights2Index()],
+            hasExpertQuantScales() ? inputs[getExpertQuantScale2Index()] : nullptr,
+            hasBias() ? inputs[getExpertBias2Index()] : nullptr, num_tokens, mExpertHiddenSize, mExpertInterSize,
+            mNumExperts, mK, static_cast<char*>(workspace.workspace),
+            // Outputs
+            outputs[getOutputTensorIndex()], workspace.fc2_output,
+            hasFinishedTensor() ? static_cast<const bool*>(inputs[getFinishedTensorIndex()]) : nullptr,
+            num_not_finished, workspace.scale_probs, static_cast<int*>(workspace.src_to_dest_map),
+            static_cast<int*>(workspace.selected_experts), parallelism_config, mNormalizationMode, stream);
+    }
+
+    if (mExpertLoadCounts && ++mNumEnqueues % mExpertLoadLogInterval == 0)
+    {
+        logExpertLoad(stream);
+    }
 
     return 0;
 }
 
+template <typename T>
+void MixtureOfExpertsPlugin::enqueueAllToAll(const nvinfer1::PluginTensorDesc* inputDesc, const void* const* inputs,
+    void* const* outputs, void* workspace_ptr, cudaStream_t stream)
+{
+#if ENABLE_MULTI_DEVICE
+    const int num_tokens = getNumTokens(inputDesc);
+    const int ep_size = mTPSize;
+    const int ep_rank = mTPRank;
+    const int experts_per_node = mNumExperts / ep_size;
+    const size_t hidden_size = mExpertHiddenSize;
+    auto parallelism_config = getParallelismConfig();
+    auto comm = (*getCommMap())[mEPGroup];
+    auto nccl_type = (*getDtypeMap())[mType];
+
+    // The tokens are replicated on all the ranks of the group, each rank dispatches a contiguous slice of them
+    const int tokens_per_rank = tensorrt_llm::common::ceilDiv(num_tokens, ep_size);
+    const int row_begin = std::min(num_tokens, ep_rank * tokens_per_rank);
+    const int num_rows = std::min(num_tokens, row_begin + tokens_per_rank) - row_begin;
+
+    auto workspace = setupAllToAllWorkspace(workspace_ptr, num_tokens);
+    const T* input = static_cast<const T*>(inputs[getInputTensorIndex()]) + row_begin * hidden_size;
+    const float* routing = static_cast<const float*>(inputs[getRoutingTensorIndex()]) + row_begin * mNumExperts;
+    const bool* finished
+        = hasFinishedTensor() ? static_cast<const bool*>(inputs[getFinishedTensorIndex()]) + row_begin : nullptr;
+
+    auto* expert_scales = static_cast<float*>(workspace.expert_scales);
+    auto* expert_for_source_row = static_cast<int*>(workspace.expert_for_source_row);
+    auto* expanded_row_to_send_row = static_cast<int*>(workspace.expanded_row_to_send_row);
+    auto* counts = static_cast<int*>(workspace.counts);
+    auto* send_rows = static_cast<T*>(workspace.send_rows);
+    auto* send_experts = static_cast<int*>(workspace.send_experts);
+    auto* recv_rows = static_cast<T*>(workspace.recv_rows);
+    auto* recv_experts = static_cast<int*>(workspace.recv_experts);
+    auto* expert_output = static_cast<T*>(workspace.expert_output);
+    auto* returned_rows = static_cast<T*>(workspace.returned_rows);
+
+    if (num_rows > 0)
+    {
+        moeAllToAllTopK(routing, finished, expert_scales, static_cast<float*>(workspace.softmax_temp),
+            expert_for_source_row, static_cast<int*>(workspace.source_rows), num_rows, mNumExperts, mK, stream);
+    }
+    moeAllToAllPrepareSend<T>(input, expert_for_source_row, static_cast<int*>(workspace.dest_ranks),
+        static_cast<int*>(workspace.expanded_rows), static_cast<int*>(workspace.sorted_dest_ranks),
+        static_cast<int*>(workspace.sorted_expanded_rows), workspace.sorter_workspace, send_rows, send_experts,
+        expanded_row_to_send_row, counts, num_rows, mExpertHiddenSize, mNumExperts, mK, ep_size, stream);
+
+    // Exchange the number of rows, the host needs them to size the transfers
+    NCCLCHECK(ncclGroupStart());
+    for (int peer = 0; peer < ep_size; ++peer)
+    {
+        NCCLCHECK(ncclSend(counts + peer, 1, ncclInt32, peer, comm, stream));
+        NCCLCHECK(ncclRecv(counts + ep_size + peer, 1, ncclInt32, peer, comm, stream));
+    }
+    NCCLCHECK(ncclGroupEnd());
+
+    std::vector<int> host_counts(2 * ep_size);
+    check_cuda_error(
+        cudaMemcpyAsync(host_counts.data(), counts, host_counts.size() * sizeof(int), cudaMemcpyDeviceToHost, stream));
+    check_cuda_error(cudaStreamSynchronize(stream));
+
+    std::vector<size_t> send_offsets(ep_size + 1, 0);
+    std::vector<size_t> recv_offsets(ep_size + 1, 0);
+    for (int peer = 0; peer < ep_size; ++peer)
+    {
+        send_offsets[peer + 1] = send_offsets[peer] + host_counts[peer];
+        recv_offsets[peer + 1] = recv_offsets[peer] + host_counts[ep_size + peer];
+    }
+    const int num_recv_rows = recv_offsets[ep_size];
+    TLLM_CHECK(num_recv_rows <= getAllToAllMaxRecvRows(num_tokens));
+
+    // Dispatch the rows to the ranks owning their experts
+    NCCLCHECK(ncclGroupStart());
+    for (int peer = 0; peer < ep_size; ++peer)
+    {
+        const size_t send_count = send_offsets[peer + 1] - send_offsets[peer];
+        const size_t recv_count = recv_offsets[peer + 1] - recv_offsets[peer];
+        if (send_count > 0)
+        {
+            NCCLCHECK(ncclSend(
+                send_rows + send_offsets[peer] * hidden_size, send_count * hidden_size, nccl_type, peer, comm, stream));
+            NCCLCHECK(ncclSend(send_experts + send_offsets[peer], send_count, ncclInt32, peer, comm, stream));
+        }
+        if (recv_count > 0)
+        {
+            NCCLCHECK(ncclRecv(
+                recv_rows + recv_offsets[peer] * hidden_size, recv_count * hidden_size, nccl_type, peer, comm, stream));
+            NCCLCHECK(ncclRecv(recv_experts + recv_offsets[peer], recv_count, ncclInt32, peer, comm, stream));
+        }
+    }
+    NCCLCHECK(ncclGroupEnd());
+
+    // Each received row selects one expert of this rank
+    auto* recv_routing = static_cast<float*>(workspace.recv_routing);
+    if (num_recv_rows > 0)
+    {
+        moeAllToAllMakeRouting(
+            recv_experts, recv_routing, num_recv_rows, mNumExperts, ep_rank * experts_per_node, stream);
+    }
+
+    // Runs the experts on the received rows [begin, begin + count)
+    auto runExperts = [&](size_t begin, int count)
+    {
+        mMOERunner->setTactic(mPluginProfiler->getBestConfig(getAllToAllTacticTokens(count), mGemmId));
+        mMOERunner->runMoe(recv_rows + begin * hidden_size, recv_routing + begin * mNumExperts,
+            inputs[getExpertWeights1Index()], hasExpertQuantScales() ? inputs[getExpertQuantScale1Index()] : nullptr,
+            hasBias() ? inputs[getExpertBias1Index()] : nullptr, mActivationType, inputs[getExpertWeights2Index()],
+            hasExpertQuantScales() ? inputs[getExpertQuantScale2Index()] : nullptr,
+            hasBias() ? inputs[getExpertBias2Index()] : nullptr, count, mExpertHiddenSize, mExpertInterSize,
+            mNumExperts, 1, static_cast<char*>(workspace.moe.workspace),
+            // Outputs
+            expert_output + begin * hidden_size, workspace.moe.fc2_output, nullptr, count, workspace.moe.scale_probs,
+            static_cast<int*>(workspace.moe.src_to_dest_map), static_cast<int*>(workspace.moe.selected_experts),
+            parallelism_config, MOEExpertScaleNormalizationMode::RENORMALIZE, stream);
+    };
+
+    if (mOverlapAllToAll)
+    {
+        // Pipeline the experts with the return of their results. At step s, this rank computes the rows of peer
+        // (rank + s) and sends them back on the comm stream while the next step computes, and receives its results
+        // from peer (rank - s), which computed them at the same step.
+        for (int step = 0; step < ep_size; ++step)
+        {
+            const int send_peer = (ep_rank + step) % ep_size;
+            const int recv_peer = (ep_rank - step + ep_size) % ep_size;
+            const size_t recv_count = recv_offsets[send_peer + 1] - recv_offsets[send_peer];
+            const size_t send_count = send_offsets[recv_peer + 1] - send_offsets[recv_peer];
+            if (recv_count > 0)
+            {
+                runExperts(recv_offsets[send_peer], recv_count);
+            }
+            TLLM_CUDA_CHECK(cudaEventRecord(mCommEvents[step], stream));
+            TLLM_CUDA_CHECK(cudaStreamWaitEvent(mCommStream, mCommEvents[step]));
+
+            NCCLCHECK(ncclGroupStart());
+            if (recv_count > 0)
+            {
+                NCCLCHECK(ncclSend(expert_output + recv_offsets[send_peer] * hidden_size, recv_count * hidden_size,
+                    nccl_type, send_peer, comm, mCommStream));
+            }
+            if (send_count > 0)
+            {
+                NCCLCHECK(ncclRecv(returned_rows + send_offsets[recv_peer] * hidden_size, send_count * hidden_size,
+                    nccl_type, recv_peer, comm, mCommStream));
+            }
+            NCCLCHECK(ncclGroupEnd());
+        }
+        TLLM_CUDA_CHECK(cudaEventRecord(mCommEvents[ep_size], mCommStream));
+        TLLM_CUDA_CHECK(cudaStreamWaitEvent(stream, mCommEvents[ep_size]));
+    }
+    else
+    {
+        if (num_recv_rows > 0)
+        {
+            runExperts(0, num_recv_rows);
+        }
+
+        // Return the results to the ranks that sent the rows
+        NCCLCHECK(ncclGroupStart());
+        for (int peer = 0; peer < ep_size; ++peer)
+        {
+            const size_t send_count = send_offsets[peer + 1] - send_offsets[peer];
+            const size_t recv_count = recv_offsets[peer + 1] - recv_offsets[peer];
+            if (recv_count > 0)
+            {
+                NCCLCHECK(ncclSend(expert_output + recv_offsets[peer] * hidden_size, recv_count * hidden_size,
+                    nccl_type, peer, comm, stream));
+            }
+            if (send_count > 0)
+            {
+                NCCLCHECK(ncclRecv(returned_rows + send_offsets[peer] * hidden_size, send_count * hidden_size,
+                    nccl_type, peer, comm, stream));
+            }
+        }
+        NCCLCHECK(ncclGroupEnd());
+    }
+
+    // Reduce the expert results of the slice of this rank and gather the slices of all the ranks. The output is used
+    // directly when the tokens are evenly divided.
+    auto* output = static_cast<T*>(outputs[getOutputTensorIndex()]);
+    const bool gather_to_output = tokens_per_rank * ep_size == num_tokens;
+    auto* gathered_output = gather_to_output ? output : static_cast<T*>(workspace.gathered_output);
+    const size_t slice_size = tokens_per_rank * hidden_size;
+    moeAllToAllCombine<T>(returned_rows, expert_scales, expanded_row_to_send_row,
+        gathered_output + ep_rank * slice_size, num_rows, mExpertHiddenSize, mK, mNormalizationMode, stream);
+    NCCLCHECK(ncclAllGather(
+        gathered_output + ep_rank * slice_size, gathered_output, slice_size, nccl_type, comm, stream));
+    if (!gather_to_output)
+    {
+        check_cuda_error(cudaMemcpyAsync(
+            output, gathered_output, num_tokens * hidden_size * sizeof(T), cudaMemcpyDeviceToDevice, stream));
+    }
+#else
+    TLLM_THROW("The all-to-all dispatch of the MoE plugin requires multi-device support");
+#endif // ENABLE_MULTI_DEVICE
+}
+
 // IPluginV2Ext Methods
 nvinfer1::DataType MixtureOfExpertsPlugin::getOutputDataType(
     int index, const nvinfer1::DataType* inputTypes, int nbInputs) const noexcept
@@ -416,11 +847,71 @@ const char* MixtureOfExpertsPlugin::getPluginVersion() const noexcept
 
 int MixtureOfExpertsPlugin::initialize() noexcept
 {
+#if ENABLE_MULTI_DEVICE
+    if (useAllToAll())
+    {
+        initCommMap(mEPGroup);
+    }
+#endif // ENABLE_MULTI_DEVICE
+    if (mOverlapAllToAll && mCommStream == nullptr)
+    {
+        TLLM_CUDA_CHECK(cudaStreamCreateWithFlags(&mCommStream, cudaStreamNonBlocking));
+        // One event per pipeline step and one for the end of the returns
+        mCommEvents.resize(mTPSize + 1);
+        for (auto& event : mCommEvents)
+        {
+            TLLM_CUDA_CHECK(cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+        }
+    }
     mPluginProfiler->profileTactics(this, mType, mDims, mGemmId);
+
+    // Enabled after the profiling so only the inference is counted
+    mExpertLoadLogInterval = tensorrt_llm::common::getEnvMoeExpertLoadLogInterval();
+    if (mExpertLoadLogInterval > 0 && !isBuilding() && mExpertLoadCounts == nullptr)
+    {
+        const int num_local_experts = getNumLocalExperts();
+        TLLM_CUDA_CHECK(cudaMalloc(&mExpertLoadCounts, num_local_experts * sizeof(int64_t)));
+        TLLM_CUDA_CHECK(cudaMemset(mExpertLoadCounts, 0, num_local_experts * sizeof(int64_t)));
+        mMOERunner->setExpertLoadCounts(mExpertLoadCounts);
+    }
     return 0;
 }
 
-void MixtureOfExpertsPlugin::terminate() noexcept {}
+void MixtureOfExpertsPlugin::terminate() noexcept
+{
+    if (mExpertLoadCounts)
+    {
+        mMOERunner->setExpertLoadCounts(nullptr);
+        TLLM_CUDA_CHECK(cudaFree(mExpertLoadCounts));
+        mExpertLoadCounts = nullptr;
+    }
+
+    if (mCommStream)
+    {
+        for (auto event : mCommEvents)
+        {
+            TLLM_CUDA_CHECK(cudaEventDestroy(event));
+        }
+        mCommEvents.clear();
+        TLLM_CUDA_CHECK(cudaStreamDestroy(mCommStream));
+        mCommStream = nullptr;
+    }
+
+#if ENABLE_MULTI_DEVICE
+    if (!useAllToAll())
+    {
+        return;
+    }
+    auto* commMap = getCommMap();
+    // [] operator inserts T() if it does not exist
+    if (isBuilding() || (*commMap)[mEPGroup] == nullptr)
+    {
+        return;
+    }
+    NCCLCHECK(ncclCommDestroy((*commMap)[mEPGroup]));
+    (*commMap)[mEPGroup] = nullptr;
+#endif // ENABLE_MULTI_DEVICE
+}
 
 void MixtureOfExpertsPlugin::destroy() noexcept
 {
@@ -480,6 +971,10 @@ MixtureOfExpertsPluginCreator::MixtureOfExpertsPluginCreator()
         "parallelism_mode", nullptr, PluginFieldType::kINT32, static_cast<int>(MOEParallelismMode::NONE)));
     mPluginAttributes.emplace_back(nvinfer1::PluginField("normalization_mode", nullptr, PluginFieldType::kINT32,
         static_cast<int>(MOEExpertScaleNormalizationMode::NONE)));
+    mPluginAttributes.emplace_back(nvinfer1::PluginField("ep_group", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(nvinfer1::PluginField("replicated_experts", nullptr, PluginFieldType::kINT32, 0));
+    mPluginAttributes.emplace_back(nvinfer1::PluginField("group_size", nullptr, PluginFieldType::kINT32, 0));
+    mPluginAttributes.emplace_back(nvinfer1::PluginField("overlap_all_to_all", nullptr, PluginFieldType::kINT32, 0));
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
 }
@@ -502,6 +997,10 @@ IPluginV2* MixtureOfExpertsPluginCreator::createPlugin(
     int mTPRank{};
     int mParallelismMode{};
     int mNormalizationMode{};
+    std::set<int> mEPGroup{};
+    std::vector<int> mReplicatedExperts{};
+    int mGroupSize{};
+    int mOverlapAllToAll{};
 
     // Read configurations from each fields
     using MapPair = std::pair<const char*, std::reference_wrapper<int>>;
@@ -520,10 +1019,29 @@ IPluginV2* MixtureOfExpertsPluginCreator::createPlugin(
         MapPair{"tp_rank", std::ref(mTPRank)},
         MapPair{"parallelism_mode", std::ref(mParallelismMode)},
         MapPair{"normalization_mode", std::ref(mNormalizationMode)},
+        MapPair{"group_size", std::ref(mGroupSize)},
+        MapPair{"overlap_all_to_all", std::ref(mOverlapAllToAll)},
     };
     for (int i = 0; i < fc->nbFields; ++i)
     {
         const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "ep_group"))
+        {
+            TLLM_CHECK(fields[i].type == nvinfer1::PluginFieldType::kINT32);
+            const auto* ranks = static_cast<const int*>(fields[i].data);
+            for (int j = 0; j < fields[i].length; ++j)
+            {
+                mEPGroup.insert(ranks[j]);
+            }
+            continue;
+        }
+        if (!strcmp(attrName, "replicated_experts"))
+        {
+            TLLM_CHECK(fields[i].type == nvinfer1::PluginFieldType::kINT32);
+            const auto* experts = static_cast<const int*>(fields[i].data);
+            mReplicatedExperts.assign(experts, experts + fields[i].length);
+            continue;
+        }
         for (const auto& item : input_map)
         {
             if (!strcmp(item.first, attrName))
@@ -542,7 +1060,8 @@ IPluginV2* MixtureOfExpertsPluginCreator::createPlugin(
             static_cast<tensorrt_llm::ActivationType>(mActivationType), static_cast<nvinfer1::DataType>(mType),
             static_cast<nvinfer1::DataType>(mWeightType), QuantMode(mQuantMode), mUseFinished != 0, mUseBias != 0,
             mTPSize, mTPRank, static_cast<MOEParallelismMode>(mParallelismMode),
-            static_cast<MOEExpertScaleNormalizationMode>(mNormalizationMode), pluginProfiler);
+            static_cast<MOEExpertScaleNormalizationMode>(mNormalizationMode), mEPGroup, mReplicatedExperts, mGroupSize,
+            mOverlapAllToAll != 0, pluginProfiler);
         obj->setPluginNamespace(mNamespace.c_str());
         return obj;
     }
@@ -602,12 +1121,16 @@ std::vector<size_t> MixtureOfExpertsGemmProfiler::getProfilerWorkspaces(int maxM
 
     size_t weights_1 = hidden_size * inter_size * num_experts * weight_bytes;
 
-    size_t quant_1 = plugin.hasExpertQuantScales() ? inter_size * num_experts * dtype_bytes : 0;
+    // One row of scales per group of the GEMM K dimension, a single row for per column scales
+    size_t scale_rows_1 = plugin.mGroupSize > 0 ? hidden_size / plugin.mGroupSize : 1;
+    size_t scale_rows_2 = plugin.mGroupSize > 0 ? inter_size / plugin.mGroupSize : 1;
+
+    size_t quant_1 = plugin.hasExpertQuantScales() ? scale_rows_1 * inter_size * num_experts * dtype_bytes : 0;
     size_t bias_1 = plugin.hasBias() ? inter_size * num_experts * dtype_bytes : 0;
 
     size_t weights_2 = hidden_size * inter_size * num_experts * weight_bytes;
 
-    size_t quant_2 = plugin.hasExpertQuantScales() ? hidden_size * num_experts * dtype_bytes : 0;
+    size_t quant_2 = plugin.hasExpertQuantScales() ? scale_rows_2 * hidden_size * num_experts * dtype_bytes : 0;
     size_t bias_2 = plugin.hasBias() ? hidden_size * num_experts * dtype_bytes : 0;
 
     size_t output = hidden_size * num_tokens * dtype_bytes;
@@ -43,20 +43,21 @@ struct GemmIDMoe
     nvinfer1::DataType wdtype{};
     tensorrt_llm::common::QuantMode quant_mode;
     tensorrt_llm::kernels::MOEParallelismMode parallelism_mode{};
+    int group_size{};
 
     bool operator==(const GemmIDMoe& id) const
     {
         return id.num_experts == num_experts && id.moe_k == moe_k && id.hidden == hidden && id.inter == inter
             && id.actfn == actfn && id.dtype == dtype && id.wdtype == wdtype && id.quant_mode == quant_mode
-            && id.parallelism_mode == parallelism_mode;
+            && id.parallelism_mode == parallelism_mode && id.group_size == group_size;
     }
 
     friend std::ostream& operator<<(std::ostream& out, const GemmIDMoe& id)
     {
-        out << "experts, k, hidden, inter, actfn, dtype, weight type, parallelism mode=" << id.num_experts << ","
-            << id.moe_k << "," << id.hidden << "," << id.inter << "," << static_cast<int>(id.actfn) << ","
+        out << "experts, k, hidden, inter, actfn, dtype, weight type, parallelism mode, group size=" << id.num_experts
+            << "," << id.moe_k << "," << id.hidden << "," << id.inter << "," << static_cast<int>(id.actfn) << ","
             << static_cast<int>(id.dtype) << "," << static_cast<int>(id.wdtype) << "," << id.quant_mode.value() << ","
-            << static_cast<int>(id.parallelism_mode);
+            << static_cast<int>(id.parallelism_mode) << "," << id.group_size;
         return out;
     }
 };
@@ -75,6 +76,7 @@ struct GemmIDMoeHash
         hash ^= std::hash<int>{}(static_cast<int>(id.wdtype));
         hash ^= std::hash<int>{}(static_cast<int>(id.quant_mode.value()));
         hash ^= std::hash<int>{}(static_cast<int>(id.parallelism_mode));
+        hash ^= std::hash<int>{}(id.group_size);
         return hash;
     }
 };
@@ -90,6 +92,7 @@ public:
         tensorrt_llm::ActivationType activation_type, nvinfer1::DataType type, nvinfer1::DataType weight_type,
         tensorrt_llm::common::QuantMode quant_mode, bool use_finished, bool use_bias, int tp_size, int tp_rank,
         MOEParallelismMode parallelism_mode, MOEExpertScaleNormalizationMode normalization_mode,
+        std::set<int> ep_group, std::vector<int> replicated_experts, int group_size, bool overlap_all_to_all,
         MixtureOfExpertsPluginProfilerPtr plugin_profiler_ptr);
     MixtureOfExpertsPlugin(const void* data, size_t length, MixtureOfExpertsPluginProfilerPtr plugin_profiler_ptr);
     MixtureOfExpertsPlugin(const MixtureOfExpertsPlugin&);
@@ -149,6 +152,14 @@ private:
     int mTPRank{};
     MOEParallelismMode mParallelismMode{};
     MOEExpertScaleNormalizationMode mNormalizationMode{};
+    // Ranks of the expert parallel group, only set to dispatch the tokens with an all-to-all
+    std::set<int> mEPGroup{};
+    // Experts replicated on all the ranks with expert parallelism, see MOEExpertReplication
+    std::vector<int> mReplicatedExperts{};
+    // Number of weight rows sharing a quantization scale, 0 for per column scales
+    int mGroupSize{};
+    // Return the results of the all-to-all to each rank while the experts compute the rows of the next one
+    bool mOverlapAllToAll{};
 
     GemmDims mDims{};
 
@@ -157,6 +168,15 @@ private:
 
     MixtureOfExpertsPluginProfilerPtr mPluginProfiler;
 
+    // Number of rows of each local expert since the last log, allocated if TRTLLM_MOE_EXPERT_LOAD_LOG_INTERVAL is set
+    int64_t* mExpertLoadCounts{};
+    int mExpertLoadLogInterval{};
+    int64_t mNumEnqueues{};
+
+    // Stream returning the results with mOverlapAllToAll, and the events ordering it with the enqueue stream
+    cudaStream_t mCommStream{};
+    std::vector<cudaEvent_t> mCommEvents{};
+
     const std::string mLayerName{};
     std::string mNamespace{};
 
@@ -170,11 +190,62 @@ private:
         size_t size{};
     };
 
+    struct AllToAllWorkspaceInfo
+    {
+        // Routing of the tokens of this rank
+        void* expert_scales{};
+        void* softmax_temp{};
+        void* expert_for_source_row{};
+        void* source_rows{};
+        void* dest_ranks{};
+        void* expanded_rows{};
+        void* sorted_dest_ranks{};
+        void* sorted_expanded_rows{};
+        void* sorter_workspace{};
+        void* expanded_row_to_send_row{};
+        // [2 * ep_size], the number of rows sent to and received from each rank
+        void* counts{};
+        void* send_rows{};
+        void* send_experts{};
+        // Rows received from the other ranks, computed by the experts of this rank
+        void* recv_rows{};
+        void* recv_experts{};
+        void* recv_routing{};
+        WorkspaceInfo moe{};
+        void* expert_output{};
+        // Results of the rows sent by this rank and gathered output of all the ranks
+        void* returned_rows{};
+        void* gathered_output{};
+        size_t size{};
+    };
+
     int getNumTokens(const nvinfer1::PluginTensorDesc* input_tensor) const;
     WorkspaceInfo setupWorkspace(void* base_ptr, int num_tokens) const;
 
+    bool useAllToAll() const
+    {
+        return mEPGroup.size() > 1;
+    }
+
+    // Each rank dispatches ceil(num_tokens / ep_size) of the tokens, and receives at most min(k, experts per rank)
+    // rows for each token of each rank.
+    int getAllToAllMaxRecvRows(int num_tokens) const;
+    // The tactics are profiled for num_tokens tokens routed to mK experts each, so each rank gets num_tokens * mK /
+    // ep_size rows on average. Returns the number of tokens of the profile with as many rows per local expert as the
+    // received rows, the profiled tactic for it fits the GEMM shapes of this step.
+    int getAllToAllTacticTokens(int num_recv_rows) const;
+    AllToAllWorkspaceInfo setupAllToAllWorkspace(void* base_ptr, int num_tokens) const;
+
+    template <typename T>
+    void enqueueAllToAll(const nvinfer1::PluginTensorDesc* inputDesc, const void* const* inputs, void* const* outputs,
+        void* workspace_ptr, cudaStream_t stream);
+
     kernels::MOEParallelismConfig getParallelismConfig() const;
 
+    // Experts of this rank followed by the replicated experts with expert parallelism
+    int getNumLocalExperts() const;
+    void logExpertLoad(cudaStream_t stream);
+
     using IndexType = std::int32_t;
 
     // Inputs
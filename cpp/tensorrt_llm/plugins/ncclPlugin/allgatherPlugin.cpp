@@ -16,6 +16,9 @@
  */
 #include "allgatherPlugin.h"
 
+#include "tensorrt_llm/common/commProfiler.h"
+#include "tensorrt_llm/common/dataType.h"
+
 #include <nccl.h>
 
 using namespace nvinfer1;
@@ -96,6 +99,8 @@ int AllgatherPlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc, const
         size *= inputDesc[0].dims.d[i];
     }
 
+    tensorrt_llm::common::CommProfiler::Scope const profile(tensorrt_llm::common::CommOp::kALL_GATHER,
+        static_cast<size_t>(size) * tensorrt_llm::common::getDTypeSize(inputDesc[0].type), stream);
     NCCLCHECK(ncclAllGather(
         inputs[0], outputs[0], size, (*getDtypeMap())[inputDesc[0].type], (*getCommMap())[mGroup], stream));
 
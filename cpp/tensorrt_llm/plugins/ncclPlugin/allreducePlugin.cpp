@@ -16,26 +16,86 @@
  */
 #include "allreducePlugin.h"
 
+#include "tensorrt_llm/common/commProfiler.h"
 #include "tensorrt_llm/common/mpiUtils.h"
 #include <nccl.h>
 
+#include <algorithm>
+#include <array>
+#include <map>
+#include <unistd.h>
+
 using namespace nvinfer1;
 using tensorrt_llm::plugins::AllreducePluginCreator;
 using tensorrt_llm::plugins::AllreducePlugin;
 using tensorrt_llm::kernels::AllReduceStrategyType;
+using tensorrt_llm::kernels::AllReduceFusionOp;
 
 static const char* ALLREDUCE_PLUGIN_VERSION{"1"};
 static const char* ALLREDUCE_PLUGIN_NAME{"AllReduce"};
 PluginFieldCollection AllreducePluginCreator::mFC{};
 std::vector<nvinfer1::PluginField> AllreducePluginCreator::mPluginAttributes;
 
-AllreducePlugin::AllreducePlugin(
-    std::set<int> group, nvinfer1::DataType type, AllReduceStrategyType strategy, int32_t counter)
+namespace
+{
+
+// Number of ranks of the group on the node of this rank, the ranks of a group spanning several nodes are split between
+// the nodes in order. The first rank of the group gathers the host names, the way initCommMap() sends the NCCL id.
+int32_t getRanksPerNode(std::set<int> const& group)
+{
+    static std::map<std::set<int>, int32_t> ranksPerNodeMap;
+    if (auto const it = ranksPerNodeMap.find(group); it != ranksPerNodeMap.end())
+    {
+        return it->second;
+    }
+
+    using HostName = std::array<char, 256>;
+    HostName hostName{};
+    gethostname(hostName.data(), hostName.size() - 1);
+    auto& comm = COMM_SESSION;
+    auto const root = *group.begin();
+    int32_t ranksPerNode{0};
+    if (comm.getRank() == root)
+    {
+        std::vector<HostName> hostNames{hostName};
+        for (auto it = std::next(group.begin()); it != group.end(); ++it)
+        {
+            comm.recv(hostNames.emplace_back(), *it, 0);
+        }
+        auto const firstOtherNode = std::find_if(
+            hostNames.begin(), hostNames.end(), [&hostName](HostName const& name) { return name != hostName; });
+        ranksPerNode = static_cast<int32_t>(std::distance(hostNames.begin(), firstOtherNode));
+        for (auto it = std::next(group.begin()); it != group.end(); ++it)
+        {
+            comm.send(ranksPerNode, *it, 0);
+        }
+    }
+    else
+    {
+        comm.send(hostName, root, 0);
+        comm.recv(ranksPerNode, root, 0);
+    }
+    TLLM_CHECK_WITH_INFO(group.size() % ranksPerNode == 0,
+        "The ranks of an all-reduce group spanning several nodes must be split evenly between the nodes.");
+    ranksPerNodeMap[group] = ranksPerNode;
+    return ranksPerNode;
+}
+
+} // namespace
+
+AllreducePlugin::AllreducePlugin(std::set<int> group, nvinfer1::DataType type, AllReduceStrategyType strategy,
+    int32_t counter, int32_t ranksPerNode, AllReduceFusionOp fusionOp, float eps, bool quantOutput)
     : mGroup(std::move(group))
     , mType(type)
     , mStrategy(strategy)
     , mCounter(counter)
+    , mRanksPerNode(ranksPerNode)
+    , mFusionOp(fusionOp)
+    , mEps(eps)
+    , mQuantOutput(quantOutput)
 {
+    TLLM_CHECK_WITH_INFO(!mQuantOutput || mFusionOp != AllReduceFusionOp::NONE,
+        "The quantized output of the all-reduce requires a fused normalization.");
 }
 
 // Parameterized constructor
@@ -45,6 +105,10 @@ AllreducePlugin::AllreducePlugin(const void* data, size_t length)
     read(d, mType);
     read(d, mStrategy);
     read(d, mCounter);
+    read(d, mRanksPerNode);
+    read(d, mFusionOp);
+    read(d, mEps);
+    read(d, mQuantOutput);
     mGroup.clear();
     int groupItem = 0;
     while (d != a + length)
@@ -66,29 +130,43 @@ nvinfer1::IPluginV2DynamicExt* AllreducePlugin::clone() const noexcept
 nvinfer1::DimsExprs AllreducePlugin::getOutputDimensions(
     int outputIndex, const nvinfer1::DimsExprs* inputs, int nbInputs, nvinfer1::IExprBuilder& exprBuilder) noexcept
 {
+    // The normalized output and the updated residual both have the shape of the input.
     return inputs[0];
 }
 
 bool AllreducePlugin::supportsFormatCombination(
     int pos, const nvinfer1::PluginTensorDesc* inOut, int nbInputs, int nbOutputs) noexcept
 {
+    const int nbFusionInputs = getNbFusionInputs();
     if (mStrategy == AllReduceStrategyType::RING)
     {
-        TLLM_CHECK_WITH_INFO(nbInputs == 1, "RING (aka. NCCL) strategy only accepts one input.");
+        TLLM_CHECK_WITH_INFO(
+            nbInputs == 1 + nbFusionInputs, "RING (aka. NCCL) strategy only accepts one input and the fusion inputs.");
     }
     else
     {
-        TLLM_CHECK_WITH_INFO(nbInputs == 2, "Non-RING (aka. NCCL) strategies require a workspace tensor.");
+        TLLM_CHECK_WITH_INFO(
+            nbInputs == 2 + nbFusionInputs, "Non-RING (aka. NCCL) strategies require a workspace tensor.");
     }
 
-    if (nbInputs == 2 && pos == 1)
+    if (inOut[pos].format != TensorFormat::kLINEAR)
     {
-        return (inOut[pos].type == nvinfer1::DataType::kINT64) && (inOut[pos].format == TensorFormat::kLINEAR);
+        return false;
     }
-    else
+    if (mStrategy != AllReduceStrategyType::RING && pos == 1)
     {
-        return (inOut[pos].type == mType) && (inOut[pos].format == TensorFormat::kLINEAR);
+        return inOut[pos].type == nvinfer1::DataType::kINT64;
     }
+    if (mQuantOutput && pos == nbInputs - 1)
+    {
+        // SmoothQuant scale
+        return inOut[pos].type == nvinfer1::DataType::kFLOAT;
+    }
+    if (mQuantOutput && pos == nbInputs)
+    {
+        return inOut[pos].type == nvinfer1::DataType::kINT8;
+    }
+    return inOut[pos].type == mType;
 }
 
 void AllreducePlugin::configurePlugin(const nvinfer1::DynamicPluginTensorDesc* in, int nbInputs,
@@ -104,6 +182,12 @@ size_t AllreducePlugin::getWorkspaceSize(const nvinfer1::PluginTensorDesc* input
 
 AllReduceStrategyType AllreducePlugin::selectImplementation(size_t messageSize, int worldSize) const noexcept
 {
+    // The small messages of the generation phase spend more time in the barriers than moving data.
+    if (mLowLatencyBuffer && messageSize <= kernels::LOW_LATENCY_MAX_SIZE)
+    {
+        return AllReduceStrategyType::LOWLATENCY;
+    }
+
     if (worldSize <= 2)
     {
         if (messageSize < 16 * 1000 * 1000)
@@ -173,16 +257,85 @@ int AllreducePlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc, const
     default: break;
     }
 
+    const bool multiNode = isMultiNode();
     auto runtimeStrategy = mStrategy;
+    if ((runtimeStrategy == AllReduceStrategyType::NVLS && !canUseNvls(size, sizePerElem))
+        || (runtimeStrategy == AllReduceStrategyType::LOWLATENCY && !canUseLowLatency(size, sizePerElem)))
+    {
+        runtimeStrategy = AllReduceStrategyType::AUTO;
+    }
     if (runtimeStrategy == AllReduceStrategyType::AUTO)
     {
-        runtimeStrategy = selectImplementation(size * sizePerElem, mGroup.size());
+        if (multiNode)
+        {
+            runtimeStrategy = AllReduceStrategyType::HIERARCHICAL;
+        }
+        else
+        {
+            runtimeStrategy = mStrategyTable ? mStrategyTable->select(size * sizePerElem)
+                                             : selectImplementation(size * sizePerElem, mGroup.size());
+            // The table and the thresholds are for the plain all-reduce. ONESHOT keeps the fused normalization in the
+            // reduce kernel and takes precedence over LOWLATENCY and NVLS when it is fused.
+            const bool fused = mFusionOp != AllReduceFusionOp::NONE;
+            if (runtimeStrategy == AllReduceStrategyType::LOWLATENCY && (fused || !canUseLowLatency(size, sizePerElem)))
+            {
+                runtimeStrategy = AllReduceStrategyType::ONESHOT;
+            }
+            // The switch reduces the data instead of the GPUs, halving the NVLink traffic of ONESHOT and TWOSHOT.
+            const bool fusedOneShot = fused && runtimeStrategy == AllReduceStrategyType::ONESHOT;
+            if (runtimeStrategy != AllReduceStrategyType::RING && runtimeStrategy != AllReduceStrategyType::LOWLATENCY
+                && !fusedOneShot && canUseNvls(size, sizePerElem))
+            {
+                runtimeStrategy = AllReduceStrategyType::NVLS;
+            }
+        }
     }
+    if (runtimeStrategy == AllReduceStrategyType::HIERARCHICAL)
+    {
+        // The slices of the intra-node reduce-scatter are made of whole 16 bytes vectors.
+        const size_t eltsPerVector = 16 / sizePerElem;
+        if (!multiNode)
+        {
+            runtimeStrategy = AllReduceStrategyType::TWOSHOT;
+        }
+        else if (size % (mRanksPerNode * eltsPerVector) != 0)
+        {
+            runtimeStrategy = AllReduceStrategyType::RING;
+        }
+    }
+
+    // Inputs of the fused residual RMSNorm follow the all-reduce input and the workspace.
+    const int fusionInputIdx = mStrategy == AllReduceStrategyType::RING ? 1 : 2;
+    tensorrt_llm::kernels::AllReduceFusionParams fusionParams;
+    if (mFusionOp == AllReduceFusionOp::RESIDUAL_RMS_NORM)
+    {
+        fusionParams.residual_buffer = inputs[fusionInputIdx];
+        fusionParams.weight_buffer = inputs[fusionInputIdx + 1];
+        fusionParams.residual_out_buffer = outputs[1];
+        fusionParams.hidden_size = inputDesc[0].dims.d[inputDesc[0].dims.nbDims - 1];
+        fusionParams.eps = mEps;
+        if (mQuantOutput)
+        {
+            fusionParams.quant_scale = reinterpret_cast<const float*>(inputs[fusionInputIdx + 2]);
+            fusionParams.quant_out_buffer = reinterpret_cast<int8_t*>(outputs[0]);
+        }
+    }
+    // Unless fused in the ONESHOT kernel, reduce into the residual output and normalize it afterwards.
+    void* reduceOutput = mFusionOp == AllReduceFusionOp::NONE ? outputs[0] : outputs[1];
 
+    tensorrt_llm::common::CommProfiler::Scope const profile(
+        tensorrt_llm::common::CommOp::kALL_REDUCE, size * sizePerElem, stream);
     if (runtimeStrategy == AllReduceStrategyType::RING)
     {
-        NCCLCHECK(ncclAllReduce(inputs[0], outputs[0], size, (*getDtypeMap())[inputDesc[0].type], ncclSum,
+        NCCLCHECK(ncclAllReduce(inputs[0], reduceOutput, size, (*getDtypeMap())[inputDesc[0].type], ncclSum,
             (*getCommMap())[mGroup], stream));
+        if (mFusionOp == AllReduceFusionOp::RESIDUAL_RMS_NORM)
+        {
+            tensorrt_llm::kernels::AllReduceParams params{};
+            params.local_output_buffer_ptr = outputs[0];
+            params.fusion_params = fusionParams;
+            tensorrt_llm::kernels::residualRmsNorm(params, outputs[1], size, type, stream);
+        }
     }
     else
     {
@@ -191,15 +344,52 @@ int AllreducePlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc, const
         // FIXME: pass world config here
         myRank = myRank % nRanks;
 
+        // The workspace holds the pointers of the whole group, only those of the ranks of the node are set.
         auto params = tensorrt_llm::kernels::AllReduceParams::deserialize(
-            reinterpret_cast<const int32_t*>(inputs[1]), nRanks, myRank, mCounter);
+            reinterpret_cast<const int32_t*>(inputs[1]), nRanks, myRank, mCounter, mRanksPerNode);
+        myRank = params.local_rank;
+        params.fusion_params = fusionParams;
+
+        if (runtimeStrategy == AllReduceStrategyType::LOWLATENCY)
+        {
+            // Neither barrier nor copy to the comm buffer, the kernel pushes the input to the peers.
+            mLowLatencyBuffer->setParams(params);
+            tensorrt_llm::kernels::lowLatencyAllReduce(params, inputs[0], outputs[0], size, type, stream, mFusionOp);
+            return 0;
+        }
 
         // Make sure all GPUs have finished using their peer_comm_buffer_ptrs in previous invocations
         tensorrt_llm::kernels::invokeMultiGpuBarrier(params, stream);
-        cudaMemcpyAsync(
-            params.peer_comm_buffer_ptrs[myRank], inputs[0], size * sizePerElem, cudaMemcpyDeviceToDevice, stream);
+        void* commBuffer = runtimeStrategy == AllReduceStrategyType::NVLS ? mMulticastBuffer->unicastPtr()
+                                                                          : params.peer_comm_buffer_ptrs[myRank];
+        cudaMemcpyAsync(commBuffer, inputs[0], size * sizePerElem, cudaMemcpyDeviceToDevice, stream);
 
-        tensorrt_llm::kernels::customAllReduce(params, outputs[0], size, sizePerElem, type, runtimeStrategy, stream);
+        if (runtimeStrategy == AllReduceStrategyType::NVLS)
+        {
+            params.nvls_unicast_ptr = mMulticastBuffer->unicastPtr();
+            params.nvls_multicast_ptr = mMulticastBuffer->multicastPtr();
+            tensorrt_llm::kernels::nvlsAllReduce(params, outputs[0], size, type, stream, mFusionOp);
+        }
+        else if (runtimeStrategy == AllReduceStrategyType::HIERARCHICAL)
+        {
+            // Each rank reduces its slice over the node, then with the ranks holding the same slice on the other
+            // nodes, so only 1 / mRanksPerNode of the tensor goes through the network.
+            tensorrt_llm::kernels::customReduceScatter(params, size, type, stream);
+            auto* slice = static_cast<char*>(params.peer_comm_buffer_ptrs[myRank]) + params.rank_offset * sizePerElem;
+            NCCLCHECK(ncclAllReduce(slice, slice, params.elts_per_rank, (*getDtypeMap())[inputDesc[0].type], ncclSum,
+                (*getCommMap())[mInterNodeGroup], stream));
+            tensorrt_llm::kernels::customAllGather(params, reduceOutput, size, type, stream);
+            if (mFusionOp == AllReduceFusionOp::RESIDUAL_RMS_NORM)
+            {
+                params.local_output_buffer_ptr = outputs[0];
+                tensorrt_llm::kernels::residualRmsNorm(params, outputs[1], size, type, stream);
+            }
+        }
+        else
+        {
+            tensorrt_llm::kernels::customAllReduce(
+                params, outputs[0], size, sizePerElem, type, runtimeStrategy, stream, mFusionOp);
+        }
     }
 
     return 0;
@@ -209,7 +399,11 @@ int AllreducePlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc, const
 nvinfer1::DataType AllreducePlugin::getOutputDataType(
     int index, const nvinfer1::DataType* inputTypes, int nbInputs) const noexcept
 {
-    assert(index == 0);
+    assert(index < getNbOutputs());
+    if (index == 0 && mQuantOutput)
+    {
+        return nvinfer1::DataType::kINT8;
+    }
     return inputTypes[0];
 }
 
@@ -227,7 +421,17 @@ const char* AllreducePlugin::getPluginVersion() const noexcept
 
 int AllreducePlugin::getNbOutputs() const noexcept
 {
-    return 1;
+    return mFusionOp == AllReduceFusionOp::NONE ? 1 : 2;
+}
+
+int AllreducePlugin::getNbFusionInputs() const noexcept
+{
+    if (mFusionOp == AllReduceFusionOp::NONE)
+    {
+        return 0;
+    }
+    // residual, gamma and the optional SmoothQuant scale
+    return 2 + static_cast<int>(mQuantOutput);
 }
 
 bool AllreducePlugin::isCustomAllReduceSuported(int ranks_per_node) const noexcept
@@ -243,35 +447,106 @@ bool AllreducePlugin::isCustomAllReduceSuported(int ranks_per_node) const noexce
         && (ranks_per_node > 0);
 }
 
+bool AllreducePlugin::canUseNvls(size_t size, size_t sizePerElem) const noexcept
+{
+    // The slices of the ranks are made of whole 16 bytes vectors, like TWOSHOT.
+    const size_t eltsPerVector = 16 / sizePerElem;
+    return mMulticastBuffer && size * sizePerElem <= mMulticastBuffer->size()
+        && size % (mGroup.size() * eltsPerVector) == 0;
+}
+
+bool AllreducePlugin::canUseLowLatency(size_t size, size_t sizePerElem) const noexcept
+{
+    // Each thread pushes one 16 bytes vector.
+    const size_t eltsPerVector = 16 / sizePerElem;
+    return mLowLatencyBuffer && size * sizePerElem <= kernels::LOW_LATENCY_MAX_SIZE && size % eltsPerVector == 0;
+}
+
+bool AllreducePlugin::isMultiNode() const noexcept
+{
+    return mRanksPerNode > 0 && static_cast<int32_t>(mGroup.size()) > mRanksPerNode;
+}
+
+std::set<int> AllreducePlugin::getInterNodeGroup() const
+{
+    // The ranks of the group are split between the nodes in order, mRanksPerNode per node.
+    const int myRank = COMM_SESSION.getRank();
+    const auto myIdx = std::distance(mGroup.begin(), mGroup.find(myRank));
+    std::set<int> interNodeGroup;
+    int idx = 0;
+    for (int rank : mGroup)
+    {
+        if (idx % mRanksPerNode == myIdx % mRanksPerNode)
+        {
+            interNodeGroup.insert(rank);
+        }
+        ++idx;
+    }
+    return interNodeGroup;
+}
+
 int AllreducePlugin::initialize() noexcept
 {
-    if (isBuilding() || mStrategy == AllReduceStrategyType::ONESHOT || mStrategy == AllReduceStrategyType::TWOSHOT)
+    if (isBuilding())
+    {
+        return 0;
+    }
+    if (mRanksPerNode == 0)
+    {
+        mRanksPerNode = getRanksPerNode(mGroup);
+    }
+    if (mStrategy == AllReduceStrategyType::ONESHOT || mStrategy == AllReduceStrategyType::TWOSHOT)
     {
         return 0;
     }
 
+    // HIERARCHICAL and AUTO fall back to RING for the sizes the reduce-scatter cannot split. NVLS falls back to AUTO
+    // for the sizes the multicast buffer does not fit or when the GPUs do not support multicast objects, LOWLATENCY
+    // for the messages larger than LOW_LATENCY_MAX_SIZE.
+    const bool autoSelect = mStrategy == AllReduceStrategyType::AUTO || mStrategy == AllReduceStrategyType::NVLS
+        || mStrategy == AllReduceStrategyType::LOWLATENCY;
     initCommMap(mGroup);
+    if (isMultiNode() && (mStrategy == AllReduceStrategyType::HIERARCHICAL || autoSelect))
+    {
+        mInterNodeGroup = getInterNodeGroup();
+        initCommMap(mInterNodeGroup);
+    }
+    else if (autoSelect && isCustomAllReduceSuported(mGroup.size()))
+    {
+        // Before the table, whose measurement uses the same LOWLATENCY buffers
+        mLowLatencyBuffer = LowLatencyBuffer::get(mGroup);
+        mStrategyTable = AllReduceStrategyTable::get(mGroup, (*getCommMap())[mGroup]);
+        mMulticastBuffer = MulticastBuffer::get(mGroup);
+    }
     return 0;
 }
 
 void AllreducePlugin::terminate() noexcept
 {
-    if (mStrategy == AllReduceStrategyType::RING || mStrategy == AllReduceStrategyType::AUTO)
+    mMulticastBuffer.reset();
+    mLowLatencyBuffer.reset();
+    if (mStrategy == AllReduceStrategyType::RING || mStrategy == AllReduceStrategyType::AUTO
+        || mStrategy == AllReduceStrategyType::HIERARCHICAL || mStrategy == AllReduceStrategyType::NVLS
+        || mStrategy == AllReduceStrategyType::LOWLATENCY)
     {
         auto* commMap = getCommMap();
-        // [] operator inserts T() if it does not exist
-        if (isBuilding() || (*commMap)[mGroup] == nullptr)
+        for (auto const& group : {mGroup, mInterNodeGroup})
         {
-            return;
+            // [] operator inserts T() if it does not exist
+            if (isBuilding() || group.empty() || (*commMap)[group] == nullptr)
+            {
+                continue;
+            }
+            NCCLCHECK(ncclCommDestroy((*commMap)[group]));
+            (*commMap)[group] = nullptr;
         }
-        NCCLCHECK(ncclCommDestroy((*commMap)[mGroup]));
-        (*commMap)[mGroup] = nullptr;
     }
 }
 
 size_t AllreducePlugin::getSerializationSize() const noexcept
 {
-    return sizeof(int) * mGroup.size() + sizeof(mType) + sizeof(mStrategy) + sizeof(mCounter);
+    return sizeof(int) * mGroup.size() + sizeof(mType) + sizeof(mStrategy) + sizeof(mCounter) + sizeof(mRanksPerNode)
+        + sizeof(mFusionOp) + sizeof(mEps) + sizeof(mQuantOutput);
 }
 
 void AllreducePlugin::serialize(void* buffer) const noexcept
@@ -280,6 +555,10 @@ void AllreducePlugin::serialize(void* buffer) const noexcept
     write(d, mType);
     write(d, mStrategy);
     write(d, mCounter);
+    write(d, mRanksPerNode);
+    write(d, mFusionOp);
+    write(d, mEps);
+    write(d, mQuantOutput);
     for (auto it = mGroup.begin(); it != mGroup.end(); ++it)
     {
         write(d, *it);
@@ -303,6 +582,10 @@ AllreducePluginCreator::AllreducePluginCreator()
     mPluginAttributes.emplace_back(PluginField("type_id", nullptr, PluginFieldType::kINT32, 1));
     mPluginAttributes.emplace_back(PluginField("strategy", nullptr, PluginFieldType::kINT8, 1));
     mPluginAttributes.emplace_back(PluginField("counter", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("ranks_per_node", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("fusion_op", nullptr, PluginFieldType::kINT8, 1));
+    mPluginAttributes.emplace_back(PluginField("eps", nullptr, PluginFieldType::kFLOAT32, 1));
+    mPluginAttributes.emplace_back(PluginField("quant_output", nullptr, PluginFieldType::kINT32, 1));
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
 }
@@ -329,6 +612,10 @@ IPluginV2* AllreducePluginCreator::createPlugin(const char* name, const PluginFi
     nvinfer1::DataType type;
     AllReduceStrategyType strategy;
     int32_t counter;
+    int32_t ranksPerNode = 0;
+    AllReduceFusionOp fusionOp = AllReduceFusionOp::NONE;
+    float eps = 1e-6f;
+    bool quantOutput = false;
     // Read configurations from each fields
     for (int i = 0; i < fc->nbFields; ++i)
     {
@@ -358,11 +645,31 @@ IPluginV2* AllreducePluginCreator::createPlugin(const char* name, const PluginFi
             TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
             counter = *static_cast<const int32_t*>(fields[i].data);
         }
+        else if (!strcmp(attrName, "ranks_per_node"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            ranksPerNode = *static_cast<const int32_t*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "fusion_op"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT8);
+            fusionOp = static_cast<AllReduceFusionOp>(*static_cast<const int8_t*>(fields[i].data));
+        }
+        else if (!strcmp(attrName, "eps"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kFLOAT32);
+            eps = *static_cast<const float*>(fields[i].data);
+        }
+        else if (!strcmp(attrName, "quant_output"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            quantOutput = static_cast<bool>(*static_cast<const int32_t*>(fields[i].data));
+        }
     }
 
     try
     {
-        auto* obj = new AllreducePlugin(group, type, strategy, counter);
+        auto* obj = new AllreducePlugin(group, type, strategy, counter, ranksPerNode, fusionOp, eps, quantOutput);
         obj->setPluginNamespace(mNamespace.c_str());
         return obj;
     }
@@ -16,6 +16,9 @@
  */
 #pragma once
 
+#include "allreduceStrategyTable.h"
+#include "lowLatencyBuffer.h"
+#include "multicastBuffer.h"
 #include "tensorrt_llm/kernels/customAllReduceKernels.h"
 #include "tensorrt_llm/plugins/common/plugin.h"
 
@@ -31,8 +34,10 @@ namespace tensorrt_llm::plugins
 class AllreducePlugin : public BasePlugin
 {
 public:
-    AllreducePlugin(
-        std::set<int> group, nvinfer1::DataType type, kernels::AllReduceStrategyType strategy, int32_t counter);
+    AllreducePlugin(std::set<int> group, nvinfer1::DataType type, kernels::AllReduceStrategyType strategy,
+        int32_t counter, int32_t ranksPerNode = 0,
+        kernels::AllReduceFusionOp fusionOp = kernels::AllReduceFusionOp::NONE, float eps = 1e-6f,
+        bool quantOutput = false);
 
     AllreducePlugin(const void* data, size_t length);
 
@@ -69,11 +74,35 @@ public:
 
 private:
     kernels::AllReduceStrategyType selectImplementation(size_t messageSize, int worldSize) const noexcept;
+    bool canUseNvls(size_t size, size_t sizePerElem) const noexcept;
+    bool canUseLowLatency(size_t size, size_t sizePerElem) const noexcept;
+    int getNbFusionInputs() const noexcept;
+    bool isMultiNode() const noexcept;
+    std::set<int> getInterNodeGroup() const;
     const std::string mLayerName;
     std::set<int> mGroup;
     nvinfer1::DataType mType;
     kernels::AllReduceStrategyType mStrategy;
     int32_t mCounter;
+    // Number of ranks of the group per node, which share the IPC workspace. The group spans several nodes if it is
+    // larger. Set by initialize() from the host names of the ranks unless given.
+    int32_t mRanksPerNode;
+    // Ranks of the group with the same local rank as this one, created by initialize() for HIERARCHICAL.
+    std::set<int> mInterNodeGroup;
+    // Measured AUTO strategies of a single node group, set by initialize() if TRTLLM_ALLREDUCE_STRATEGY_TABLE is set.
+    std::shared_ptr<AllReduceStrategyTable const> mStrategyTable;
+    // Buffer of the NVLS all-reduce shared by the plugins of a single node group, set by initialize() for NVLS and
+    // AUTO if the GPUs support multicast objects.
+    std::shared_ptr<MulticastBuffer> mMulticastBuffer;
+    // Receive buffers of the LOWLATENCY all-reduce shared by the plugins of a single node group, set by initialize()
+    // for LOWLATENCY and AUTO.
+    std::shared_ptr<LowLatencyBuffer> mLowLatencyBuffer;
+    // With RESIDUAL_RMS_NORM, the inputs following the all-reduce input (and the workspace) are the residual, the
+    // gamma of the RMSNorm and, if mQuantOutput, the SmoothQuant scale. The outputs are the normalized tensor (int8
+    // if mQuantOutput) and the updated residual.
+    kernels::AllReduceFusionOp mFusionOp;
+    float mEps;
+    bool mQuantOutput;
 };
 
 class AllreducePluginCreator : public BaseCreator
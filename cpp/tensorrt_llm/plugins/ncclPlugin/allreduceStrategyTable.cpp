@@ -0,0 +1,425 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "allreduceStrategyTable.h"
+#include "lowLatencyBuffer.h"
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/mpiUtils.h"
+#include "tensorrt_llm/plugins/common/plugin.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+using tensorrt_llm::kernels::AllReduceStrategyType;
+using tensorrt_llm::plugins::AllReduceStrategyTable;
+
+namespace
+{
+
+// MPI tags of the exchanges between the ranks of the group, distinct from the tag of the NCCL unique id
+constexpr int kNeedMeasureTag = 1001;
+constexpr int kIpcHandlesTag = 1002;
+constexpr int kMeasureDoneTag = 1003;
+constexpr int kTableTag = 1004;
+
+// Message sizes of the sweep in bytes, from 4 KB to 32 MB
+constexpr int kMinLog2MessageSize = 12;
+constexpr int kMaxLog2MessageSize = 25;
+constexpr int kWarmupIterations = 3;
+constexpr int kTimedIterations = 10;
+
+// TWOSHOT splits the message in whole 16 bytes vectors per rank
+size_t sweepMessageSize(int log2MessageSize, int nRanks)
+{
+    const size_t granularity = 16 * nRanks;
+    return tensorrt_llm::common::divUp(size_t{1} << log2MessageSize, granularity) * granularity;
+}
+
+} // namespace
+
+std::shared_ptr<AllReduceStrategyTable const> AllReduceStrategyTable::get(std::set<int> const& group, ncclComm_t comm)
+{
+    static std::mutex mutex;
+    static std::map<std::set<int>, std::shared_ptr<AllReduceStrategyTable const>> tables;
+
+    auto const& path = common::getEnvAllReduceStrategyTable();
+    if (path.empty())
+    {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (auto const it = tables.find(group); it != tables.end())
+    {
+        return it->second;
+    }
+
+    auto const& session = COMM_SESSION;
+    const int myRank = session.getRank();
+    const int leader = *group.begin();
+
+    Entries entries;
+    std::string key;
+    int needMeasure = 0;
+    if (myRank == leader)
+    {
+        key = getTopologyKey(group);
+        entries = readFile(path, key);
+        needMeasure = entries.empty();
+        for (auto it = std::next(group.begin()); it != group.end(); ++it)
+        {
+            session.send(needMeasure, *it, kNeedMeasureTag);
+        }
+    }
+    else
+    {
+        session.recv(needMeasure, leader, kNeedMeasureTag);
+    }
+
+    if (needMeasure)
+    {
+        TLLM_LOG_INFO("Measuring the all-reduce strategies of %d GPUs for %s", static_cast<int>(group.size()),
+            path.c_str());
+        entries = measure(group, comm);
+        if (myRank == leader)
+        {
+            writeFile(path, key, entries);
+        }
+    }
+
+    // The ranks must all select the same strategy, use the table of the first one
+    std::vector<int64_t> packed;
+    if (myRank == leader)
+    {
+        for (auto const& [messageSize, strategy] : entries)
+        {
+            packed.push_back(static_cast<int64_t>(messageSize));
+            packed.push_back(static_cast<int64_t>(strategy));
+        }
+        int64_t packedSize = static_cast<int64_t>(packed.size());
+        for (auto it = std::next(group.begin()); it != group.end(); ++it)
+        {
+            session.send(packedSize, *it, kTableTag);
+            session.send(packed.data(), packed.size() * sizeof(int64_t), mpi::MpiType::kBYTE, *it, kTableTag);
+        }
+    }
+    else
+    {
+        int64_t packedSize = 0;
+        session.recv(packedSize, leader, kTableTag);
+        packed.resize(packedSize);
+        session.recv(packed.data(), packed.size() * sizeof(int64_t), mpi::MpiType::kBYTE, leader, kTableTag);
+        entries.clear();
+        for (size_t ii = 0; ii + 1 < packed.size(); ii += 2)
+        {
+            entries.emplace_back(static_cast<size_t>(packed[ii]), static_cast<AllReduceStrategyType>(packed[ii + 1]));
+        }
+    }
+    TLLM_CHECK_WITH_INFO(!entries.empty(), "Empty all-reduce strategy table.");
+
+    auto table = std::make_shared<AllReduceStrategyTable const>(std::move(entries));
+    tables.emplace(group, table);
+    return table;
+}
+
+AllReduceStrategyType AllReduceStrategyTable::select(size_t messageSize) const
+{
+    for (auto const& [maxMessageSize, strategy] : mEntries)
+    {
+        if (messageSize <= maxMessageSize)
+        {
+            return strategy;
+        }
+    }
+    return mEntries.back().second;
+}
+
+std::string AllReduceStrategyTable::getTopologyKey(std::set<int> const& group)
+{
+    int device = 0;
+    TLLM_CUDA_CHECK(cudaGetDevice(&device));
+    cudaDeviceProp prop;
+    TLLM_CUDA_CHECK(cudaGetDeviceProperties(&prop, device));
+    int deviceCount = 0;
+    TLLM_CUDA_CHECK(cudaGetDeviceCount(&deviceCount));
+
+    // Tells NVLink or P2P capable PCIe boxes from the ones going through the host
+    bool peerAccess = true;
+    for (int src = 0; src < deviceCount; ++src)
+    {
+        for (int dst = 0; dst < deviceCount; ++dst)
+        {
+            int canAccessPeer = 1;
+            if (src != dst)
+            {
+                TLLM_CUDA_CHECK(cudaDeviceCanAccessPeer(&canAccessPeer, src, dst));
+            }
+            peerAccess = peerAccess && canAccessPeer;
+        }
+    }
+
+    std::ostringstream key;
+    key << prop.name << ";ranks=" << group.size() << ";gpus=" << deviceCount << ";p2p=" << peerAccess
+        << ";nccl=" << NCCL_VERSION_CODE << ";cuda=" << CUDART_VERSION
+        << ";lowlatency=" << kernels::LOW_LATENCY_MAX_SIZE;
+    return key.str();
+}
+
+AllReduceStrategyTable::Entries AllReduceStrategyTable::readFile(std::string const& path, std::string const& key)
+{
+    // One entry per line: [topology key]\t[message size]\t[strategy]
+    Entries entries;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        const auto keyEnd = line.find('\t');
+        if (keyEnd == std::string::npos || line.compare(0, keyEnd, key) != 0 || keyEnd != key.size())
+        {
+            continue;
+        }
+        std::istringstream values(line.substr(keyEnd + 1));
+        size_t messageSize = 0;
+        int strategy = 0;
+        if (values >> messageSize >> strategy)
+        {
+            entries.emplace_back(messageSize, static_cast<AllReduceStrategyType>(strategy));
+        }
+    }
+    std::sort(entries.begin(), entries.end());
+    return entries;
+}
+
+void AllReduceStrategyTable::writeFile(std::string const& path, std::string const& key, Entries const& entries)
+{
+    // Keep the tables of the other topologies and replace the file at once, other processes may read it
+    std::ostringstream content;
+    {
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.compare(0, key.size() + 1, key + '\t') != 0)
+            {
+                content << line << '\n';
+            }
+        }
+    }
+    for (auto const& [messageSize, strategy] : entries)
+    {
+        content << key << '\t' << messageSize << '\t' << static_cast<int>(strategy) << '\n';
+    }
+
+    const auto tmpPath = path + ".tmp" + std::to_string(COMM_SESSION.getRank());
+    {
+        std::ofstream file(tmpPath);
+        file << content.str();
+        if (!file)
+        {
+            TLLM_LOG_WARNING("Cannot write the all-reduce strategy table to %s", path.c_str());
+            return;
+        }
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    {
+        TLLM_LOG_WARNING("Cannot write the all-reduce strategy table to %s", path.c_str());
+        std::remove(tmpPath.c_str());
+    }
+}
+
+AllReduceStrategyTable::Entries AllReduceStrategyTable::measure(std::set<int> const& group, ncclComm_t comm)
+{
+    auto const& session = COMM_SESSION;
+    const int myRank = session.getRank();
+    const int leader = *group.begin();
+    const int nRanks = static_cast<int>(group.size());
+    const int myIdx = static_cast<int>(std::distance(group.begin(), group.find(myRank)));
+
+    // Same layout as the workspace of the plugin: the comm buffers, the input barriers and the output barriers of all
+    // the ranks, opened through CUDA IPC.
+    const size_t maxMessageSize = sweepMessageSize(kMaxLog2MessageSize, nRanks);
+    const size_t barrierSize = (kernels::MAX_ALL_REDUCE_BLOCKS + 1) * kernels::MAX_RANKS_PER_NODE * sizeof(uint32_t);
+    const std::array<size_t, 3> bufferSizes{maxMessageSize, barrierSize, barrierSize};
+    std::array<void*, 3> localBuffers{};
+    std::vector<void*> workspace(3 * nRanks);
+    for (int ii = 0; ii < 3; ++ii)
+    {
+        TLLM_CUDA_CHECK(cudaMalloc(&localBuffers[ii], bufferSizes[ii]));
+        TLLM_CUDA_CHECK(cudaMemset(localBuffers[ii], 0, bufferSizes[ii]));
+        std::vector<cudaIpcMemHandle_t> handles(nRanks);
+        TLLM_CUDA_CHECK(cudaIpcGetMemHandle(&handles[myIdx], localBuffers[ii]));
+
+        // Gather the handles on the first rank and send them all back
+        const size_t handlesSize = handles.size() * sizeof(cudaIpcMemHandle_t);
+        if (myRank == leader)
+        {
+            int idx = 1;
+            for (auto it = std::next(group.begin()); it != group.end(); ++it, ++idx)
+            {
+                session.recv(&handles[idx], sizeof(cudaIpcMemHandle_t), mpi::MpiType::kBYTE, *it, kIpcHandlesTag);
+            }
+            for (auto it = std::next(group.begin()); it != group.end(); ++it)
+            {
+                session.send(handles.data(), handlesSize, mpi::MpiType::kBYTE, *it, kIpcHandlesTag);
+            }
+        }
+        else
+        {
+            session.send(&handles[myIdx], sizeof(cudaIpcMemHandle_t), mpi::MpiType::kBYTE, leader, kIpcHandlesTag);
+            session.recv(handles.data(), handlesSize, mpi::MpiType::kBYTE, leader, kIpcHandlesTag);
+        }
+
+        for (int idx = 0; idx < nRanks; ++idx)
+        {
+            auto& ptr = workspace[ii * nRanks + idx];
+            if (idx == myIdx)
+            {
+                ptr = localBuffers[ii];
+            }
+            else
+            {
+                TLLM_CUDA_CHECK(cudaIpcOpenMemHandle(&ptr, handles[idx], cudaIpcMemLazyEnablePeerAccess));
+            }
+        }
+    }
+
+    void* input = nullptr;
+    void* output = nullptr;
+    TLLM_CUDA_CHECK(cudaMalloc(&input, maxMessageSize));
+    TLLM_CUDA_CHECK(cudaMalloc(&output, maxMessageSize));
+    TLLM_CUDA_CHECK(cudaMemset(input, 0, maxMessageSize));
+    cudaStream_t stream;
+    TLLM_CUDA_CHECK(cudaStreamCreate(&stream));
+    cudaEvent_t start;
+    cudaEvent_t stop;
+    TLLM_CUDA_CHECK(cudaEventCreate(&start));
+    TLLM_CUDA_CHECK(cudaEventCreate(&stop));
+
+    auto params = kernels::AllReduceParams::deserialize(
+        reinterpret_cast<const int32_t*>(workspace.data()), nRanks, myIdx, 0);
+    uint32_t flag = 0;
+    // Shared with the plugins of the group, its flags advance with every LOWLATENCY all-reduce of the ranks
+    auto const lowLatencyBuffer = LowLatencyBuffer::get(group);
+    // Same sequence as AllreducePlugin::enqueue
+    auto runAllReduce = [&](AllReduceStrategyType strategy, size_t elts)
+    {
+        if (strategy == AllReduceStrategyType::RING)
+        {
+            NCCLCHECK(ncclAllReduce(input, output, elts, ncclHalf, ncclSum, comm, stream));
+            return;
+        }
+        if (strategy == AllReduceStrategyType::LOWLATENCY)
+        {
+            lowLatencyBuffer->setParams(params);
+            kernels::lowLatencyAllReduce(params, input, output, elts, common::datatype_enum::TYPE_FP16, stream);
+            return;
+        }
+        // A new flag for every all-reduce, the barriers would let the ranks through otherwise
+        params.barrier_flag = ++flag;
+        kernels::invokeMultiGpuBarrier(params, stream);
+        TLLM_CUDA_CHECK(cudaMemcpyAsync(
+            params.peer_comm_buffer_ptrs[myIdx], input, elts * sizeof(half), cudaMemcpyDeviceToDevice, stream));
+        kernels::customAllReduce(
+            params, output, elts, sizeof(half), common::datatype_enum::TYPE_FP16, strategy, stream);
+    };
+
+    // The ranks are synchronized by the all-reduces, the times of the first one are representative of the group
+    Entries entries;
+    constexpr std::array<AllReduceStrategyType, 4> strategies{AllReduceStrategyType::RING,
+        AllReduceStrategyType::ONESHOT, AllReduceStrategyType::TWOSHOT, AllReduceStrategyType::LOWLATENCY};
+    for (int log2MessageSize = kMinLog2MessageSize; log2MessageSize <= kMaxLog2MessageSize; ++log2MessageSize)
+    {
+        const size_t messageSize = sweepMessageSize(log2MessageSize, nRanks);
+        const size_t elts = messageSize / sizeof(half);
+        float bestTime = std::numeric_limits<float>::max();
+        auto bestStrategy = AllReduceStrategyType::RING;
+        for (auto const strategy : strategies)
+        {
+            if (strategy == AllReduceStrategyType::LOWLATENCY && messageSize > kernels::LOW_LATENCY_MAX_SIZE)
+            {
+                continue;
+            }
+            for (int iter = 0; iter < kWarmupIterations; ++iter)
+            {
+                runAllReduce(strategy, elts);
+            }
+            TLLM_CUDA_CHECK(cudaEventRecord(start, stream));
+            for (int iter = 0; iter < kTimedIterations; ++iter)
+            {
+                runAllReduce(strategy, elts);
+            }
+            TLLM_CUDA_CHECK(cudaEventRecord(stop, stream));
+            TLLM_CUDA_CHECK(cudaEventSynchronize(stop));
+            float time = 0.f;
+            TLLM_CUDA_CHECK(cudaEventElapsedTime(&time, start, stop));
+            TLLM_LOG_DEBUG("All-reduce of %zu bytes with strategy %d: %f ms", messageSize, static_cast<int>(strategy),
+                time / kTimedIterations);
+            if (time < bestTime)
+            {
+                bestTime = time;
+                bestStrategy = strategy;
+            }
+        }
+        entries.emplace_back(messageSize, bestStrategy);
+    }
+    TLLM_CUDA_CHECK(cudaStreamSynchronize(stream));
+
+    // The peers may still read the buffers of this rank until they are all done
+    int done = 1;
+    if (myRank == leader)
+    {
+        for (auto it = std::next(group.begin()); it != group.end(); ++it)
+        {
+            session.recv(done, *it, kMeasureDoneTag);
+        }
+        for (auto it = std::next(group.begin()); it != group.end(); ++it)
+        {
+            session.send(done, *it, kMeasureDoneTag);
+        }
+    }
+    else
+    {
+        session.send(done, leader, kMeasureDoneTag);
+        session.recv(done, leader, kMeasureDoneTag);
+    }
+
+    TLLM_CUDA_CHECK(cudaEventDestroy(start));
+    TLLM_CUDA_CHECK(cudaEventDestroy(stop));
+    TLLM_CUDA_CHECK(cudaStreamDestroy(stream));
+    TLLM_CUDA_CHECK(cudaFree(input));
+    TLLM_CUDA_CHECK(cudaFree(output));
+    for (int ii = 0; ii < 3; ++ii)
+    {
+        for (int idx = 0; idx < nRanks; ++idx)
+        {
+            if (idx != myIdx)
+            {
+                TLLM_CUDA_CHECK(cudaIpcCloseMemHandle(workspace[ii * nRanks + idx]));
+            }
+        }
+        TLLM_CUDA_CHECK(cudaFree(localBuffers[ii]));
+    }
+    return entries;
+}
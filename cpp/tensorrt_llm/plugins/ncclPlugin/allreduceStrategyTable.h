@@ -0,0 +1,67 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/kernels/customAllReduceKernels.h"
+
+#include <memory>
+#include <nccl.h>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::plugins
+{
+
+// Fastest all-reduce strategy per message size for a group of GPUs of one node, measured on the actual topology
+// instead of the fixed thresholds of AllreducePlugin::selectImplementation.
+//
+// With TRTLLM_ALLREDUCE_STRATEGY_TABLE=<file>, the first rank of the group loads the table of its topology from the
+// file. If the file has none, all the ranks time RING, ONESHOT, TWOSHOT and, up to kernels::LOW_LATENCY_MAX_SIZE,
+// LOWLATENCY over a sweep of message sizes with their own IPC buffers and the first rank appends the result to the
+// file. The first rank then sends the table to the others so that all of them select the same strategy.
+class AllReduceStrategyTable
+{
+public:
+    // Sorted by message size, the strategy is used up to the size
+    using Entries = std::vector<std::pair<size_t, kernels::AllReduceStrategyType>>;
+
+    explicit AllReduceStrategyTable(Entries entries)
+        : mEntries(std::move(entries))
+    {
+    }
+
+    // Table shared by the plugins of the group, nullptr if TRTLLM_ALLREDUCE_STRATEGY_TABLE is not set.
+    // Collective over the ranks of the group, comm is their NCCL communicator.
+    static std::shared_ptr<AllReduceStrategyTable const> get(std::set<int> const& group, ncclComm_t comm);
+
+    kernels::AllReduceStrategyType select(size_t messageSize) const;
+
+private:
+    static std::string getTopologyKey(std::set<int> const& group);
+
+    static Entries readFile(std::string const& path, std::string const& key);
+
+    static void writeFile(std::string const& path, std::string const& key, Entries const& entries);
+
+    static Entries measure(std::set<int> const& group, ncclComm_t comm);
+
+    Entries mEntries;
+};
+
+} // namespace tensorrt_llm::plugins
@@ -0,0 +1,380 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "gemmAllreducePlugin.h"
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include <algorithm>
+#include <cassert>
+#include <nccl.h>
+
+using namespace nvinfer1;
+using namespace tensorrt_llm::common;
+using tensorrt_llm::plugins::GemmAllreducePluginCreator;
+using tensorrt_llm::plugins::GemmAllreducePlugin;
+
+static const char* GEMM_ALLREDUCE_PLUGIN_VERSION{"1"};
+static const char* GEMM_ALLREDUCE_PLUGIN_NAME{"GemmAllReduce"};
+PluginFieldCollection GemmAllreducePluginCreator::mFC{};
+std::vector<nvinfer1::PluginField> GemmAllreducePluginCreator::mPluginAttributes;
+
+GemmAllreducePlugin::GemmAllreducePlugin(std::set<int> group, nvinfer1::DataType type, int32_t numChunks)
+    : mGroup(std::move(group))
+    , mType(type)
+    , mNumChunks(numChunks)
+{
+    TLLM_CHECK_WITH_INFO(mNumChunks > 0, "The GEMM + all-reduce requires at least one chunk.");
+    init();
+}
+
+// Parameterized constructor
+GemmAllreducePlugin::GemmAllreducePlugin(const void* data, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(data), *a = d;
+    read(d, mType);
+    read(d, mNumChunks);
+    mGroup.clear();
+    int groupItem = 0;
+    while (d != a + length)
+    {
+        read(d, groupItem);
+        mGroup.insert(groupItem);
+    }
+    TLLM_CHECK(d == a + length);
+    init();
+}
+
+void GemmAllreducePlugin::init()
+{
+    mCublasWrapper = std::make_shared<CublasMMWrapper>(getCublasHandle(), getCublasLtHandle(), nullptr, nullptr);
+}
+
+void GemmAllreducePlugin::setGemmConfig()
+{
+    if (mType == DataType::kHALF)
+    {
+        mCublasWrapper->setFP16GemmConfig();
+    }
+    else if (mType == DataType::kFLOAT)
+    {
+        mCublasWrapper->setFP32GemmConfig();
+    }
+#ifdef ENABLE_BF16
+    else if (mType == DataType::kBF16)
+    {
+        mCublasWrapper->setBF16GemmConfig();
+    }
+#endif
+}
+
+// IPluginV2DynamicExt Methods
+nvinfer1::IPluginV2DynamicExt* GemmAllreducePlugin::clone() const noexcept
+{
+    auto* plugin = new GemmAllreducePlugin(*this);
+    // The clone creates its own streams and events in initialize()
+    plugin->mCommStream = nullptr;
+    plugin->mGemmEvents.clear();
+    plugin->mCommEvent = nullptr;
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+nvinfer1::DimsExprs GemmAllreducePlugin::getOutputDimensions(
+    int outputIndex, const nvinfer1::DimsExprs* inputs, int nbInputs, nvinfer1::IExprBuilder& exprBuilder) noexcept
+{
+    try
+    {
+        TLLM_CHECK(nbInputs == 2);
+        TLLM_CHECK(outputIndex == 0);
+        DimsExprs ret = inputs[0];
+        ret.d[ret.nbDims - 1] = inputs[1].d[0];
+        return ret;
+    }
+    catch (const std::exception& e)
+    {
+        caughtError(e);
+    }
+    return DimsExprs{};
+}
+
+bool GemmAllreducePlugin::supportsFormatCombination(
+    int pos, const nvinfer1::PluginTensorDesc* inOut, int nbInputs, int nbOutputs) noexcept
+{
+    return (inOut[pos].type == mType) && (inOut[pos].format == TensorFormat::kLINEAR);
+}
+
+void GemmAllreducePlugin::configurePlugin(const nvinfer1::DynamicPluginTensorDesc* in, int nbInputs,
+    const nvinfer1::DynamicPluginTensorDesc* out, int nbOutputs) noexcept
+{
+}
+
+size_t GemmAllreducePlugin::getWorkspaceSize(const nvinfer1::PluginTensorDesc* inputs, int nbInputs,
+    const nvinfer1::PluginTensorDesc* outputs, int nbOutputs) const noexcept
+{
+    return CUBLAS_WORKSPACE_SIZE;
+}
+
+int GemmAllreducePlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc,
+    const nvinfer1::PluginTensorDesc* outputDesc, const void* const* inputs, void* const* outputs, void* workspace,
+    cudaStream_t stream) noexcept
+{
+    // inputs
+    //     act [M, K]
+    //     weight [N, K]
+    // outputs
+    //     mat [M, N]
+    if (isBuilding())
+    {
+        return 0;
+    }
+
+    const int nbDims = inputDesc[0].dims.nbDims;
+    int M = 1;
+    for (int i = 0; i < nbDims - 1; ++i)
+    {
+        M *= inputDesc[0].dims.d[i];
+    }
+    const int K = inputDesc[0].dims.d[nbDims - 1];
+    const int N = inputDesc[1].dims.d[0];
+    if (M == 0)
+    {
+        return 0;
+    }
+
+    setGemmConfig();
+    mCublasWrapper->setStream(stream);
+    mCublasWrapper->setWorkspace(workspace);
+
+    const size_t elemSize = mType == DataType::kFLOAT ? sizeof(float) : sizeof(half);
+    const auto* act = reinterpret_cast<const char*>(inputs[0]);
+    auto* output = reinterpret_cast<char*>(outputs[0]);
+    auto comm = (*getCommMap())[mGroup];
+    const auto ncclType = (*getDtypeMap())[mType];
+
+    // The side stream must not start reducing a chunk before the previous plugins of the stream are done with it
+    TLLM_CUDA_CHECK(cudaEventRecord(mCommEvent, stream));
+    TLLM_CUDA_CHECK(cudaStreamWaitEvent(mCommStream, mCommEvent));
+
+    const int numChunks = std::min(mNumChunks, M);
+    const int rowsPerChunk = divUp(M, numChunks);
+    for (int chunk = 0, row = 0; row < M; ++chunk, row += rowsPerChunk)
+    {
+        const int rows = std::min(rowsPerChunk, M - row);
+        // Column major cuBLAS computes mat^T [N, rows] = weight^T [N, K] x act^T [K, rows]
+        mCublasWrapper->createDescriptors(CUBLAS_OP_T, CUBLAS_OP_N, N, rows, K, K, K, N);
+        void* chunkOutput = output + static_cast<size_t>(row) * N * elemSize;
+        mCublasWrapper->Gemm(CUBLAS_OP_T, CUBLAS_OP_N, N, rows, K, inputs[1], K,
+            act + static_cast<size_t>(row) * K * elemSize, K, chunkOutput, N);
+        mCublasWrapper->destroyDescriptors();
+
+        TLLM_CUDA_CHECK(cudaEventRecord(mGemmEvents[chunk], stream));
+        TLLM_CUDA_CHECK(cudaStreamWaitEvent(mCommStream, mGemmEvents[chunk]));
+        NCCLCHECK(ncclAllReduce(
+            chunkOutput, chunkOutput, static_cast<size_t>(rows) * N, ncclType, ncclSum, comm, mCommStream));
+    }
+
+    TLLM_CUDA_CHECK(cudaEventRecord(mCommEvent, mCommStream));
+    TLLM_CUDA_CHECK(cudaStreamWaitEvent(stream, mCommEvent));
+    return 0;
+}
+
+// IPluginV2Ext Methods
+nvinfer1::DataType GemmAllreducePlugin::getOutputDataType(
+    int index, const nvinfer1::DataType* inputTypes, int nbInputs) const noexcept
+{
+    TLLM_CHECK(index == 0);
+    return inputTypes[0];
+}
+
+// IPluginV2 Methods
+
+const char* GemmAllreducePlugin::getPluginType() const noexcept
+{
+    return GEMM_ALLREDUCE_PLUGIN_NAME;
+}
+
+const char* GemmAllreducePlugin::getPluginVersion() const noexcept
+{
+    return GEMM_ALLREDUCE_PLUGIN_VERSION;
+}
+
+int GemmAllreducePlugin::getNbOutputs() const noexcept
+{
+    return 1;
+}
+
+int GemmAllreducePlugin::initialize() noexcept
+{
+    if (isBuilding())
+    {
+        return 0;
+    }
+    initCommMap(mGroup);
+    TLLM_CUDA_CHECK(cudaStreamCreateWithFlags(&mCommStream, cudaStreamNonBlocking));
+    mGemmEvents.resize(mNumChunks);
+    for (auto& event : mGemmEvents)
+    {
+        TLLM_CUDA_CHECK(cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+    }
+    TLLM_CUDA_CHECK(cudaEventCreateWithFlags(&mCommEvent, cudaEventDisableTiming));
+    return 0;
+}
+
+void GemmAllreducePlugin::terminate() noexcept
+{
+    if (isBuilding())
+    {
+        return;
+    }
+    for (auto& event : mGemmEvents)
+    {
+        TLLM_CUDA_CHECK(cudaEventDestroy(event));
+    }
+    mGemmEvents.clear();
+    if (mCommEvent != nullptr)
+    {
+        TLLM_CUDA_CHECK(cudaEventDestroy(mCommEvent));
+        mCommEvent = nullptr;
+    }
+    if (mCommStream != nullptr)
+    {
+        TLLM_CUDA_CHECK(cudaStreamDestroy(mCommStream));
+        mCommStream = nullptr;
+    }
+
+    auto* commMap = getCommMap();
+    // [] operator inserts T() if it does not exist
+    if ((*commMap)[mGroup] == nullptr)
+    {
+        return;
+    }
+    NCCLCHECK(ncclCommDestroy((*commMap)[mGroup]));
+    (*commMap)[mGroup] = nullptr;
+}
+
+size_t GemmAllreducePlugin::getSerializationSize() const noexcept
+{
+    return sizeof(int) * mGroup.size() + sizeof(mType) + sizeof(mNumChunks);
+}
+
+void GemmAllreducePlugin::serialize(void* buffer) const noexcept
+{
+    char *d = static_cast<char*>(buffer), *a = d;
+    write(d, mType);
+    write(d, mNumChunks);
+    for (auto it = mGroup.begin(); it != mGroup.end(); ++it)
+    {
+        write(d, *it);
+    }
+    assert(d == a + getSerializationSize());
+}
+
+void GemmAllreducePlugin::destroy() noexcept
+{
+    // This gets called when the network containing plugin is destroyed
+    delete this;
+}
+
+///////////////
+
+GemmAllreducePluginCreator::GemmAllreducePluginCreator()
+{
+    // Fill PluginFieldCollection with PluginField arguments metadata
+    mPluginAttributes.clear();
+    mPluginAttributes.emplace_back(PluginField("group", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("type_id", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("num_chunks", nullptr, PluginFieldType::kINT32, 1));
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* GemmAllreducePluginCreator::getPluginName() const noexcept
+{
+    return GEMM_ALLREDUCE_PLUGIN_NAME;
+}
+
+const char* GemmAllreducePluginCreator::getPluginVersion() const noexcept
+{
+    return GEMM_ALLREDUCE_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* GemmAllreducePluginCreator::getFieldNames() noexcept
+{
+    return &mFC;
+}
+
+IPluginV2* GemmAllreducePluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc) noexcept
+{
+    const PluginField* fields = fc->fields;
+    std::set<int> group;
+    nvinfer1::DataType type;
+    int32_t numChunks = 4;
+    // Read configurations from each fields
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "group"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            const auto* r = static_cast<const int*>(fields[i].data);
+            for (int j = 0; j < fields[i].length; ++j)
+            {
+                group.insert(*r);
+                ++r;
+            }
+        }
+        else if (!strcmp(attrName, "type_id"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            type = static_cast<nvinfer1::DataType>(*(static_cast<const nvinfer1::DataType*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "num_chunks"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            numChunks = *static_cast<const int32_t*>(fields[i].data);
+        }
+    }
+
+    try
+    {
+        auto* obj = new GemmAllreducePlugin(group, type, numChunks);
+        obj->setPluginNamespace(mNamespace.c_str());
+        return obj;
+    }
+    catch (const std::exception& e)
+    {
+        caughtError(e);
+    }
+    return nullptr;
+}
+
+IPluginV2* GemmAllreducePluginCreator::deserializePlugin(
+    const char* name, const void* serialData, size_t serialLength) noexcept
+{
+    // This object will be deleted when the network is destroyed, which will
+    // call GemmAllreducePlugin::destroy()
+    try
+    {
+        auto* obj = new GemmAllreducePlugin(serialData, serialLength);
+        obj->setPluginNamespace(mNamespace.c_str());
+        return obj;
+    }
+    catch (const std::exception& e)
+    {
+        caughtError(e);
+    }
+    return nullptr;
+}
@@ -0,0 +1,129 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "lowLatencyBuffer.h"
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/mpiUtils.h"
+
+#include <map>
+#include <mutex>
+
+using tensorrt_llm::plugins::LowLatencyBuffer;
+
+namespace
+{
+
+// MPI tag of the exchange of the IPC handles, distinct from the tags of the strategy table and the multicast buffer
+constexpr int kIpcHandlesTag = 1201;
+
+// Number of counters: the flag of the last invocation and the number of blocks done with the current one
+constexpr size_t kNbCounters = 2;
+
+} // namespace
+
+std::shared_ptr<LowLatencyBuffer> LowLatencyBuffer::get(std::set<int> const& group)
+{
+    static std::mutex mutex;
+    static std::map<std::set<int>, std::weak_ptr<LowLatencyBuffer>> buffers;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (auto buffer = buffers[group].lock())
+    {
+        return buffer;
+    }
+    std::shared_ptr<LowLatencyBuffer> buffer(new LowLatencyBuffer(group));
+    buffers[group] = buffer;
+    return buffer;
+}
+
+LowLatencyBuffer::LowLatencyBuffer(std::set<int> const& group)
+    : mRankIdx(static_cast<int>(std::distance(group.begin(), group.find(COMM_SESSION.getRank()))))
+    , mBuffers(group.size(), nullptr)
+{
+    auto const& session = COMM_SESSION;
+    const int myRank = session.getRank();
+    const int leader = *group.begin();
+    const int nRanks = static_cast<int>(group.size());
+
+    // The flags start at 1, the zeroed lines are never mistaken for data.
+    TLLM_CUDA_CHECK(cudaMalloc(&mBuffers[mRankIdx], kernels::LOW_LATENCY_BUFFER_SIZE));
+    TLLM_CUDA_CHECK(cudaMemset(mBuffers[mRankIdx], 0, kernels::LOW_LATENCY_BUFFER_SIZE));
+    TLLM_CUDA_CHECK(cudaMalloc(&mCounters, kNbCounters * sizeof(uint32_t)));
+    TLLM_CUDA_CHECK(cudaMemset(mCounters, 0, kNbCounters * sizeof(uint32_t)));
+    // The peers may push to the buffer as soon as they have its handle
+    TLLM_CUDA_CHECK(cudaDeviceSynchronize());
+
+    std::vector<cudaIpcMemHandle_t> handles(nRanks);
+    TLLM_CUDA_CHECK(cudaIpcGetMemHandle(&handles[mRankIdx], mBuffers[mRankIdx]));
+
+    // Gather the handles on the first rank and send them all back
+    const size_t handlesSize = handles.size() * sizeof(cudaIpcMemHandle_t);
+    if (myRank == leader)
+    {
+        int idx = 1;
+        for (auto it = std::next(group.begin()); it != group.end(); ++it, ++idx)
+        {
+            session.recv(&handles[idx], sizeof(cudaIpcMemHandle_t), mpi::MpiType::kBYTE, *it, kIpcHandlesTag);
+        }
+        for (auto it = std::next(group.begin()); it != group.end(); ++it)
+        {
+            session.send(handles.data(), handlesSize, mpi::MpiType::kBYTE, *it, kIpcHandlesTag);
+        }
+    }
+    else
+    {
+        session.send(&handles[mRankIdx], sizeof(cudaIpcMemHandle_t), mpi::MpiType::kBYTE, leader, kIpcHandlesTag);
+        session.recv(handles.data(), handlesSize, mpi::MpiType::kBYTE, leader, kIpcHandlesTag);
+    }
+
+    for (int idx = 0; idx < nRanks; ++idx)
+    {
+        if (idx != mRankIdx)
+        {
+            TLLM_CUDA_CHECK(cudaIpcOpenMemHandle(&mBuffers[idx], handles[idx], cudaIpcMemLazyEnablePeerAccess));
+        }
+    }
+}
+
+LowLatencyBuffer::~LowLatencyBuffer()
+{
+    for (int idx = 0; idx < static_cast<int>(mBuffers.size()); ++idx)
+    {
+        if (mBuffers[idx] == nullptr)
+        {
+            continue;
+        }
+        if (idx == mRankIdx)
+        {
+            cudaFree(mBuffers[idx]);
+        }
+        else
+        {
+            cudaIpcCloseMemHandle(mBuffers[idx]);
+        }
+    }
+    cudaFree(mCounters);
+}
+
+void LowLatencyBuffer::setParams(kernels::AllReduceParams& params) const
+{
+    for (size_t idx = 0; idx < mBuffers.size(); ++idx)
+    {
+        params.ll_buffer_ptrs[idx] = mBuffers[idx];
+    }
+    params.ll_counters = mCounters;
+}
@@ -0,0 +1,55 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/kernels/customAllReduceKernels.h"
+
+#include <memory>
+#include <set>
+#include <vector>
+
+namespace tensorrt_llm::plugins
+{
+
+// Receive buffers of the LOWLATENCY all-reduce of a single node group. Each rank allocates
+// kernels::LOW_LATENCY_BUFFER_SIZE bytes that its peers write to through CUDA IPC, and the counters of the flags of
+// the invocations, which only it uses. The plugins of the group share them so that the flags of the ranks advance
+// together.
+class LowLatencyBuffer
+{
+public:
+    // Buffers shared by the plugins of the group. Collective over the ranks of the group.
+    static std::shared_ptr<LowLatencyBuffer> get(std::set<int> const& group);
+
+    ~LowLatencyBuffer();
+
+    LowLatencyBuffer(LowLatencyBuffer const&) = delete;
+    LowLatencyBuffer& operator=(LowLatencyBuffer const&) = delete;
+
+    //! \brief Sets the buffer pointers and the counters of the LOWLATENCY strategy in params.
+    void setParams(kernels::AllReduceParams& params) const;
+
+private:
+    explicit LowLatencyBuffer(std::set<int> const& group);
+
+    int mRankIdx;
+    // Of all the ranks of the group, the one of this rank is allocated and the others are opened through CUDA IPC.
+    std::vector<void*> mBuffers;
+    uint32_t* mCounters{nullptr};
+};
+
+} // namespace tensorrt_llm::plugins
@@ -0,0 +1,272 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "multicastBuffer.h"
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/common/mpiUtils.h"
+
+#include <array>
+#include <map>
+#include <mutex>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+#ifndef SYS_pidfd_getfd
+#define SYS_pidfd_getfd 438
+#endif
+
+using tensorrt_llm::plugins::MulticastBuffer;
+
+namespace
+{
+
+// MPI tags of the exchanges between the ranks of the group, distinct from the tags of the strategy table
+constexpr int kSupportedTag = 1101;
+constexpr int kHandleTag = 1102;
+constexpr int kImportedTag = 1103;
+constexpr int kDeviceAddedTag = 1104;
+constexpr int kBoundTag = 1105;
+
+// Whether ok is true on all the ranks of the group. Collective over the ranks of the group.
+bool allRanksAgree(std::set<int> const& group, bool ok, int tag)
+{
+    auto const& session = COMM_SESSION;
+    const int myRank = session.getRank();
+    const int leader = *group.begin();
+
+    int agreed = ok;
+    if (myRank == leader)
+    {
+        for (auto it = std::next(group.begin()); it != group.end(); ++it)
+        {
+            int peerOk = 0;
+            session.recv(peerOk, *it, tag);
+            agreed = agreed && peerOk;
+        }
+        for (auto it = std::next(group.begin()); it != group.end(); ++it)
+        {
+            session.send(agreed, *it, tag);
+        }
+    }
+    else
+    {
+        session.send(agreed, leader, tag);
+        session.recv(agreed, leader, tag);
+    }
+    return agreed;
+}
+
+// Duplicates the file descriptor fd of the process pid into this process, -1 on failure.
+int getPeerFd(int64_t pid, int64_t fd)
+{
+    const int pidFd = static_cast<int>(syscall(SYS_pidfd_open, static_cast<pid_t>(pid), 0));
+    if (pidFd < 0)
+    {
+        return -1;
+    }
+    const int localFd = static_cast<int>(syscall(SYS_pidfd_getfd, pidFd, static_cast<int>(fd), 0));
+    close(pidFd);
+    return localFd;
+}
+
+} // namespace
+
+std::shared_ptr<MulticastBuffer> MulticastBuffer::get(std::set<int> const& group)
+{
+    static std::mutex mutex;
+    static std::map<std::set<int>, std::weak_ptr<MulticastBuffer>> buffers;
+    static std::set<std::set<int>> unsupportedGroups;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (unsupportedGroups.count(group) != 0)
+    {
+        return nullptr;
+    }
+    if (auto buffer = buffers[group].lock())
+    {
+        return buffer;
+    }
+
+    std::shared_ptr<MulticastBuffer> buffer(new MulticastBuffer());
+    if (!buffer->init(group))
+    {
+        TLLM_LOG_INFO("Multicast objects are not supported by the %d GPUs, the NVLS all-reduce is disabled",
+            static_cast<int>(group.size()));
+        unsupportedGroups.insert(group);
+        return nullptr;
+    }
+    buffers[group] = buffer;
+    return buffer;
+}
+
+bool MulticastBuffer::init(std::set<int> const& group)
+{
+#if CUDA_VERSION >= 12010
+    auto const& session = COMM_SESSION;
+    const int myRank = session.getRank();
+    const int leader = *group.begin();
+
+    TLLM_CUDA_CHECK(cudaGetDevice(&mDeviceId));
+    int multicastSupported = 0;
+    bool ok = mDriver.hasMulticast() && check(mDriver.cuDeviceGet(&mDevice, mDeviceId), "cuDeviceGet")
+        && check(mDriver.cuDeviceGetAttribute(&multicastSupported, CU_DEVICE_ATTRIBUTE_MULTICAST_SUPPORTED, mDevice),
+            "cuDeviceGetAttribute")
+        && multicastSupported;
+    if (!allRanksAgree(group, ok, kSupportedTag))
+    {
+        return false;
+    }
+
+    CUmulticastObjectProp multicastProp{};
+    multicastProp.numDevices = group.size();
+    multicastProp.handleTypes = CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR;
+    multicastProp.size = kMaxMessageSize;
+    ok = check(mDriver.cuMulticastGetGranularity(&mGranularity, &multicastProp, CU_MULTICAST_GRANULARITY_MINIMUM),
+        "cuMulticastGetGranularity");
+
+    // The first rank creates the multicast object, the others import it from its file descriptor
+    int fd = -1;
+    if (myRank == leader)
+    {
+        mSize = common::divUp(kMaxMessageSize, mGranularity) * mGranularity;
+        multicastProp.size = mSize;
+        ok = ok && check(mDriver.cuMulticastCreate(&mMulticastHandle, &multicastProp), "cuMulticastCreate")
+            && check(mDriver.cuMemExportToShareableHandle(
+                         &fd, mMulticastHandle, CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR, 0),
+                "cuMemExportToShareableHandle");
+        const std::array<int64_t, 4> handle{ok, getpid(), fd, static_cast<int64_t>(mSize)};
+        for (auto it = std::next(group.begin()); it != group.end(); ++it)
+        {
+            session.send(handle.data(), sizeof(handle), mpi::MpiType::kBYTE, *it, kHandleTag);
+        }
+    }
+    else
+    {
+        std::array<int64_t, 4> handle{};
+        session.recv(handle.data(), sizeof(handle), mpi::MpiType::kBYTE, leader, kHandleTag);
+        mSize = static_cast<size_t>(handle[3]);
+        fd = handle[0] ? getPeerFd(handle[1], handle[2]) : -1;
+        if (ok && handle[0] && fd < 0)
+        {
+            TLLM_LOG_WARNING("Cannot duplicate the file descriptor of the multicast object of rank %d", leader);
+        }
+        ok = ok && fd >= 0
+            && check(mDriver.cuMemImportFromShareableHandle(&mMulticastHandle,
+                         reinterpret_cast<void*>(static_cast<uintptr_t>(fd)), CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR),
+                "cuMemImportFromShareableHandle");
+    }
+    // The first rank keeps its file descriptor open until all the others have imported it
+    const bool imported = allRanksAgree(group, ok, kImportedTag);
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    if (!imported)
+    {
+        return false;
+    }
+
+    // All the devices must be added before the memory is bound
+    ok = check(mDriver.cuMulticastAddDevice(mMulticastHandle, mDevice), "cuMulticastAddDevice");
+    if (!allRanksAgree(group, ok, kDeviceAddedTag))
+    {
+        return false;
+    }
+
+    CUmemAllocationProp unicastProp{};
+    unicastProp.type = CU_MEM_ALLOCATION_TYPE_PINNED;
+    unicastProp.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    unicastProp.location.id = mDeviceId;
+    ok = check(mDriver.cuMemCreate(&mUnicastHandle, mSize, &unicastProp, 0), "cuMemCreate");
+    if (ok)
+    {
+        mBound = check(
+            mDriver.cuMulticastBindMem(mMulticastHandle, 0, mUnicastHandle, 0, mSize, 0), "cuMulticastBindMem");
+        ok = mBound && map(mUnicastHandle, mUnicastPtr) && map(mMulticastHandle, mMulticastPtr);
+    }
+    // The peers may store to the buffer as soon as they are all bound
+    return allRanksAgree(group, ok, kBoundTag);
+#else
+    return false;
+#endif
+}
+
+MulticastBuffer::~MulticastBuffer()
+{
+#if CUDA_VERSION >= 12010
+    unmap(mMulticastPtr);
+    unmap(mUnicastPtr);
+    if (mBound)
+    {
+        cuErrCheck(mDriver.cuMulticastUnbind(mMulticastHandle, mDevice, 0, mSize), mDriver);
+    }
+    if (mUnicastHandle != 0)
+    {
+        cuErrCheck(mDriver.cuMemRelease(mUnicastHandle), mDriver);
+    }
+    if (mMulticastHandle != 0)
+    {
+        cuErrCheck(mDriver.cuMemRelease(mMulticastHandle), mDriver);
+    }
+#endif
+}
+
+bool MulticastBuffer::map(CUmemGenericAllocationHandle handle, CUdeviceptr& ptr)
+{
+    if (!check(mDriver.cuMemAddressReserve(&ptr, mSize, mGranularity, 0, 0), "cuMemAddressReserve"))
+    {
+        ptr = 0;
+        return false;
+    }
+    CUmemAccessDesc access{};
+    access.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    access.location.id = mDeviceId;
+    access.flags = CU_MEM_ACCESS_FLAGS_PROT_READWRITE;
+    if (!check(mDriver.cuMemMap(ptr, mSize, 0, handle, 0), "cuMemMap"))
+    {
+        cuErrCheck(mDriver.cuMemAddressFree(ptr, mSize), mDriver);
+        ptr = 0;
+        return false;
+    }
+    // Mapped from here, unmap() releases it
+    return check(mDriver.cuMemSetAccess(ptr, mSize, &access, 1), "cuMemSetAccess");
+}
+
+void MulticastBuffer::unmap(CUdeviceptr ptr)
+{
+    if (ptr != 0)
+    {
+        cuErrCheck(mDriver.cuMemUnmap(ptr, mSize), mDriver);
+        cuErrCheck(mDriver.cuMemAddressFree(ptr, mSize), mDriver);
+    }
+}
+
+bool MulticastBuffer::check(CUresult result, char const* call) const
+{
+    if (result != CUDA_SUCCESS)
+    {
+        char const* name = nullptr;
+        mDriver.cuGetErrorName(result, &name);
+        TLLM_LOG_WARNING("%s failed with %s, the NVLS all-reduce is disabled", call, name ? name : "an unknown error");
+        return false;
+    }
+    return true;
+}
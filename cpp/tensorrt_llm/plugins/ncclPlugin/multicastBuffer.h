@@ -0,0 +1,89 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/common/cudaDriverWrapper.h"
+
+#include <cuda.h>
+#include <memory>
+#include <set>
+
+namespace tensorrt_llm::plugins
+{
+
+// Buffer of each GPU of a single node group, bound to a multicast object of the NVSwitch for the NVLS all-reduce.
+// A load-reduce from the multicast address sums the buffers of all the GPUs in the switch and a store to it writes
+// the buffers of all the GPUs.
+//
+// The first rank of the group creates the multicast object and the others import it through a duplicate of its file
+// descriptor (pidfd_getfd). If the driver, the GPUs or the system does not support it on any of the ranks, none of
+// them gets a buffer and the all-reduce falls back to the other strategies.
+class MulticastBuffer
+{
+public:
+    // Larger all-reduces use the other strategies
+    static constexpr size_t kMaxMessageSize = size_t{32} << 20;
+
+    // Buffer shared by the plugins of the group, nullptr if multicast is not supported. Collective over the ranks of
+    // the group.
+    static std::shared_ptr<MulticastBuffer> get(std::set<int> const& group);
+
+    ~MulticastBuffer();
+
+    MulticastBuffer(MulticastBuffer const&) = delete;
+    MulticastBuffer& operator=(MulticastBuffer const&) = delete;
+
+    void* unicastPtr() const
+    {
+        return reinterpret_cast<void*>(mUnicastPtr);
+    }
+
+    void* multicastPtr() const
+    {
+        return reinterpret_cast<void*>(mMulticastPtr);
+    }
+
+    size_t size() const
+    {
+        return mSize;
+    }
+
+private:
+    MulticastBuffer() = default;
+
+    bool init(std::set<int> const& group);
+
+    // Reserves an address range for the handle and maps it read-write for the device.
+    bool map(CUmemGenericAllocationHandle handle, CUdeviceptr& ptr);
+
+    void unmap(CUdeviceptr ptr);
+
+    bool check(CUresult result, char const* call) const;
+
+    common::CUDADriverWrapper mDriver;
+    int mDeviceId{0};
+    CUdevice mDevice{0};
+    size_t mSize{0};
+    size_t mGranularity{0};
+    CUmemGenericAllocationHandle mMulticastHandle{0};
+    CUmemGenericAllocationHandle mUnicastHandle{0};
+    bool mBound{false};
+    CUdeviceptr mUnicastPtr{0};
+    CUdeviceptr mMulticastPtr{0};
+};
+
+} // namespace tensorrt_llm::plugins
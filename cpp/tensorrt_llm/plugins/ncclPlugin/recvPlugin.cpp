@@ -16,6 +16,8 @@
  */
 #include "recvPlugin.h"
 
+#include "tensorrt_llm/common/commProfiler.h"
+#include "tensorrt_llm/common/dataType.h"
 #include "tensorrt_llm/common/mpiUtils.h"
 
 #include <nccl.h>
@@ -87,6 +89,8 @@ int RecvPlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc, const nvinf
     {
         size *= inputDesc[0].dims.d[i];
     }
+    tensorrt_llm::common::CommProfiler::Scope const profile(tensorrt_llm::common::CommOp::kRECV,
+        static_cast<size_t>(size) * tensorrt_llm::common::getDTypeSize(inputDesc[0].type), stream);
     NCCLCHECK(ncclRecv(outputs[0], size, (*getDtypeMap())[inputDesc[0].type], 0, mComm, stream));
 
     return 0;
@@ -16,6 +16,9 @@
  */
 #include "reduceScatterPlugin.h"
 
+#include "tensorrt_llm/common/commProfiler.h"
+#include "tensorrt_llm/common/dataType.h"
+
 #include <cassert>
 #include <nccl.h>
 
@@ -97,6 +100,8 @@ int ReduceScatterPlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc,
         size *= outputDesc[0].dims.d[i];
     }
 
+    tensorrt_llm::common::CommProfiler::Scope const profile(tensorrt_llm::common::CommOp::kREDUCE_SCATTER,
+        static_cast<size_t>(size) * mGroup.size() * tensorrt_llm::common::getDTypeSize(inputDesc[0].type), stream);
     NCCLCHECK(ncclReduceScatter(
         inputs[0], outputs[0], size, (*getDtypeMap())[inputDesc[0].type], ncclSum, (*getCommMap())[mGroup], stream));
 
@@ -16,6 +16,8 @@
  */
 #include "sendPlugin.h"
 
+#include "tensorrt_llm/common/commProfiler.h"
+#include "tensorrt_llm/common/dataType.h"
 #include "tensorrt_llm/common/mpiUtils.h"
 
 #include <cassert>
@@ -24,12 +26,38 @@
 using namespace nvinfer1;
 using tensorrt_llm::plugins::SendPluginCreator;
 using tensorrt_llm::plugins::SendPlugin;
+using tensorrt_llm::plugins::SendStagingBuffers;
 
 static const char* SEND_PLUGIN_VERSION{"1"};
 static const char* SEND_PLUGIN_NAME{"Send"};
 PluginFieldCollection SendPluginCreator::mFC{};
 std::vector<nvinfer1::PluginField> SendPluginCreator::mPluginAttributes;
 
+SendStagingBuffers::SendStagingBuffers(size_t size)
+    : size(size)
+{
+    TLLM_CUDA_CHECK(cudaStreamCreateWithFlags(&stream, cudaStreamNonBlocking));
+    for (int i = 0; i < kNbBuffers; ++i)
+    {
+        TLLM_CUDA_CHECK(cudaMalloc(&buffers[i], size));
+        TLLM_CUDA_CHECK(cudaEventCreateWithFlags(&copiedEvents[i], cudaEventDisableTiming));
+        TLLM_CUDA_CHECK(cudaEventCreateWithFlags(&sentEvents[i], cudaEventDisableTiming));
+    }
+}
+
+SendStagingBuffers::~SendStagingBuffers()
+{
+    // The last sends may still read the buffers
+    TLLM_CUDA_CHECK(cudaStreamSynchronize(stream));
+    for (int i = 0; i < kNbBuffers; ++i)
+    {
+        TLLM_CUDA_CHECK(cudaFree(buffers[i]));
+        TLLM_CUDA_CHECK(cudaEventDestroy(copiedEvents[i]));
+        TLLM_CUDA_CHECK(cudaEventDestroy(sentEvents[i]));
+    }
+    TLLM_CUDA_CHECK(cudaStreamDestroy(stream));
+}
+
 SendPlugin::SendPlugin(int tgtRank, nvinfer1::DataType type)
     : mTgtRank(tgtRank)
     , mType(type)
@@ -68,6 +96,28 @@ bool SendPlugin::supportsFormatCombination(
 void SendPlugin::configurePlugin(const nvinfer1::DynamicPluginTensorDesc* in, int nbInputs,
     const nvinfer1::DynamicPluginTensorDesc* out, int nbOutputs) noexcept
 {
+    if (isBuilding())
+    {
+        return;
+    }
+    size_t maxSize = tensorrt_llm::common::getDTypeSize(mType);
+    for (int i = 0; i < in[0].max.nbDims; ++i)
+    {
+        maxSize *= in[0].max.d[i];
+    }
+    if (!mStaging || mStaging->size < maxSize)
+    {
+        try
+        {
+            mStaging = std::make_shared<SendStagingBuffers>(maxSize);
+        }
+        catch (const std::exception& e)
+        {
+            // Send from the input on the stream of the engine instead
+            caughtError(e);
+            mStaging.reset();
+        }
+    }
 }
 
 size_t SendPlugin::getWorkspaceSize(const nvinfer1::PluginTensorDesc* inputs, int nbInputs,
@@ -89,7 +139,40 @@ int SendPlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc, const nvinf
         size *= inputDesc[0].dims.d[i];
     }
 
-    NCCLCHECK(ncclSend(inputs[0], size, (*getDtypeMap())[inputDesc[0].type], 1, mComm, stream));
+    const auto ncclType = (*getDtypeMap())[inputDesc[0].type];
+    const size_t bytes = static_cast<size_t>(size) * tensorrt_llm::common::getDTypeSize(inputDesc[0].type);
+    // A graph capture cannot end with the send stream forked from the captured one
+    cudaStreamCaptureStatus captureStatus;
+    TLLM_CUDA_CHECK(cudaStreamIsCapturing(stream, &captureStatus));
+    if (!mStaging || bytes > mStaging->size || captureStatus != cudaStreamCaptureStatusNone)
+    {
+        if (mStaging && captureStatus == cudaStreamCaptureStatusNone)
+        {
+            // Keep the order of the sends on mComm
+            for (auto const& event : mStaging->sentEvents)
+            {
+                TLLM_CUDA_CHECK(cudaStreamWaitEvent(stream, event));
+            }
+        }
+        tensorrt_llm::common::CommProfiler::Scope const profile(tensorrt_llm::common::CommOp::kSEND, bytes, stream);
+        NCCLCHECK(ncclSend(inputs[0], size, ncclType, 1, mComm, stream));
+        return 0;
+    }
+
+    auto& staging = *mStaging;
+    const int idx = staging.next;
+    staging.next = (staging.next + 1) % SendStagingBuffers::kNbBuffers;
+    // Wait for the send of the micro batch that used this buffer before
+    TLLM_CUDA_CHECK(cudaStreamWaitEvent(stream, staging.sentEvents[idx]));
+    TLLM_CUDA_CHECK(cudaMemcpyAsync(staging.buffers[idx], inputs[0], bytes, cudaMemcpyDeviceToDevice, stream));
+    TLLM_CUDA_CHECK(cudaEventRecord(staging.copiedEvents[idx], stream));
+    TLLM_CUDA_CHECK(cudaStreamWaitEvent(staging.stream, staging.copiedEvents[idx]));
+    {
+        tensorrt_llm::common::CommProfiler::Scope const profile(
+            tensorrt_llm::common::CommOp::kSEND, bytes, staging.stream);
+        NCCLCHECK(ncclSend(staging.buffers[idx], size, ncclType, 1, mComm, staging.stream));
+    }
+    TLLM_CUDA_CHECK(cudaEventRecord(staging.sentEvents[idx], staging.stream));
     return 0;
 }
 
@@ -138,6 +221,10 @@ void SendPlugin::terminate() noexcept
     {
         return;
     }
+    if (mStaging)
+    {
+        TLLM_CUDA_CHECK(cudaStreamSynchronize(mStaging->stream));
+    }
     NCCLCHECK(ncclCommDestroy(mComm));
 }
 
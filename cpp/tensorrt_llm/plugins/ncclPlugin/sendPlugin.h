@@ -17,12 +17,33 @@
 #pragma once
 
 #include "tensorrt_llm/plugins/common/plugin.h"
+#include <array>
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace tensorrt_llm::plugins
 {
 
+// The input is copied to one of two staging buffers and sent from there on a separate stream, so that the stream of
+// the engine does not wait for the receiving stage. The copy of the next micro batch only waits for the send of the
+// micro batch before, which used the other buffer.
+struct SendStagingBuffers
+{
+    static constexpr int kNbBuffers = 2;
+
+    explicit SendStagingBuffers(size_t size);
+
+    ~SendStagingBuffers();
+
+    size_t size;
+    cudaStream_t stream{nullptr};
+    std::array<void*, kNbBuffers> buffers{};
+    std::array<cudaEvent_t, kNbBuffers> copiedEvents{};
+    std::array<cudaEvent_t, kNbBuffers> sentEvents{};
+    int next{0};
+};
+
 class SendPlugin : public BasePlugin
 {
 public:
@@ -63,6 +84,9 @@ private:
     ncclComm_t mComm; // TODO: Remove this
     int mTgtRank;
     nvinfer1::DataType mType;
+    // Created by configurePlugin() and shared with the clones of the execution contexts, so that the sends on mComm
+    // are all issued in order on the same stream.
+    std::shared_ptr<SendStagingBuffers> mStaging;
 };
 
 class SendPluginCreator : public BaseCreator
@@ -0,0 +1,350 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2022 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "residualRmsnormPlugin.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/kernels/rmsnormKernels.h"
+
+#include <cstring>
+#include <optional>
+
+using namespace nvinfer1;
+using namespace tensorrt_llm::kernels;
+using namespace tensorrt_llm::common;
+using tensorrt_llm::plugins::ResidualRmsnormPluginCreator;
+using tensorrt_llm::plugins::ResidualRmsnormPlugin;
+
+static const char* RESIDUAL_RMSNORM_PLUGIN_VERSION{"1"};
+static const char* RESIDUAL_RMSNORM_PLUGIN_NAME{"ResidualRmsnorm"};
+PluginFieldCollection ResidualRmsnormPluginCreator::mFC{};
+std::vector<nvinfer1::PluginField> ResidualRmsnormPluginCreator::mPluginAttributes;
+
+ResidualRmsnormPlugin::ResidualRmsnormPlugin(
+    float eps, nvinfer1::DataType type, nvinfer1::DataType outType, bool dynamicActivationScaling)
+    : mEps(eps)
+    , mType(type)
+    , mOutType(outType)
+    , mDynActScaling(dynamicActivationScaling)
+{
+    TLLM_CHECK_WITH_INFO(mOutType == mType || mOutType == DataType::kINT8 || mOutType == DataType::kFP8,
+        "The output of the residual RMS norm must have the type of the input, int8 or fp8");
+    TLLM_CHECK_WITH_INFO(!mDynActScaling || mOutType == DataType::kINT8, "Dynamic scaling requires an int8 output");
+}
+
+// Parameterized constructor
+ResidualRmsnormPlugin::ResidualRmsnormPlugin(const void* data, size_t length)
+{
+    const char *d = reinterpret_cast<const char*>(data), *a = d;
+    read(d, mEps);
+    read(d, mType);
+    read(d, mOutType);
+    read(d, mDynActScaling);
+    TLLM_CHECK(d == a + length);
+}
+
+// IPluginV2DynamicExt Methods
+nvinfer1::IPluginV2DynamicExt* ResidualRmsnormPlugin::clone() const noexcept
+{
+    auto* plugin = new ResidualRmsnormPlugin(mEps, mType, mOutType, mDynActScaling);
+    plugin->setPluginNamespace(mNamespace.c_str());
+    return plugin;
+}
+
+nvinfer1::DimsExprs ResidualRmsnormPlugin::getOutputDimensions(
+    int outputIndex, const nvinfer1::DimsExprs* inputs, int nbInputs, nvinfer1::IExprBuilder& exprBuilder) noexcept
+{
+    if (outputIndex < 2)
+    {
+        // Normalized output and new residual
+        return inputs[0];
+    }
+
+    // Dynamic scaling output if enabled
+    try
+    {
+        TLLM_CHECK(outputIndex == 2);
+        DimsExprs ret;
+        ret.nbDims = inputs[0].nbDims;
+        for (int di = 0; di < ret.nbDims - 1; ++di)
+        {
+            ret.d[di] = inputs[0].d[di];
+        }
+        ret.d[ret.nbDims - 1] = exprBuilder.constant(1);
+        return ret;
+    }
+    catch (const std::exception& e)
+    {
+        caughtError(e);
+    }
+    return DimsExprs{};
+}
+
+bool ResidualRmsnormPlugin::supportsFormatCombination(
+    int pos, const nvinfer1::PluginTensorDesc* inOut, int nbInputs, int nbOutputs) noexcept
+{
+    TLLM_CHECK(nbInputs == getNbInputs());
+    TLLM_CHECK(0 <= pos && pos < nbInputs + getNbOutputs());
+    if (inOut[pos].format != TensorFormat::kLINEAR)
+    {
+        return false;
+    }
+    if (pos < 3)
+    {
+        // input, residual and weight
+        return inOut[pos].type == mType;
+    }
+    if (pos < nbInputs)
+    {
+        // Scale of the quantized output
+        return inOut[pos].type == DataType::kFLOAT;
+    }
+    switch (pos - nbInputs)
+    {
+    case 0: return inOut[pos].type == mOutType;
+    case 1: return inOut[pos].type == mType;
+    default: return inOut[pos].type == DataType::kFLOAT;
+    }
+}
+
+void ResidualRmsnormPlugin::configurePlugin(const nvinfer1::DynamicPluginTensorDesc* in, int nbInputs,
+    const nvinfer1::DynamicPluginTensorDesc* out, int nbOutputs) noexcept
+{
+}
+
+size_t ResidualRmsnormPlugin::getWorkspaceSize(const nvinfer1::PluginTensorDesc* inputs, int nbInputs,
+    const nvinfer1::PluginTensorDesc* outputs, int nbOutputs) const noexcept
+{
+    return 0;
+}
+
+template <typename T>
+void ResidualRmsnormPlugin::enqueueForType(
+    const nvinfer1::PluginTensorDesc* inputDesc, const void* const* inputs, void* const* outputs, cudaStream_t stream)
+{
+    int m = 1;
+    for (int i = 0; i < inputDesc[0].dims.nbDims - 1; ++i)
+    {
+        m *= inputDesc[0].dims.d[i];
+    }
+    const int n = inputDesc[2].dims.d[0];
+
+    const T* input = reinterpret_cast<const T*>(inputs[0]);
+    const T* residual = reinterpret_cast<const T*>(inputs[1]);
+    const T* weight = reinterpret_cast<const T*>(inputs[2]);
+    const float* scale = isQuantized() ? reinterpret_cast<const float*>(inputs[3]) : nullptr;
+    T* residualOut = reinterpret_cast<T*>(outputs[1]);
+    float* dynamicScale = mDynActScaling ? reinterpret_cast<float*>(outputs[2]) : nullptr;
+
+    if (mOutType == DataType::kINT8)
+    {
+        invokeResidualRmsNorm(reinterpret_cast<int8_t*>(outputs[0]), residualOut, input, residual, weight, mEps, m, n,
+            stream, scale, dynamicScale);
+    }
+#ifdef ENABLE_FP8
+    else if (mOutType == DataType::kFP8)
+    {
+        invokeResidualRmsNorm(reinterpret_cast<__nv_fp8_e4m3*>(outputs[0]), residualOut, input, residual, weight, mEps,
+            m, n, stream, scale);
+    }
+#endif
+    else
+    {
+        invokeResidualRmsNorm(
+            reinterpret_cast<T*>(outputs[0]), residualOut, input, residual, weight, mEps, m, n, stream);
+    }
+}
+
+int ResidualRmsnormPlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc,
+    const nvinfer1::PluginTensorDesc* outputDesc, const void* const* inputs, void* const* outputs, void* workspace,
+    cudaStream_t stream) noexcept
+{
+    // inputs
+    //     input [M(*), N]
+    //     residual [M(*), N]
+    //     weight [N, ]
+    //     scale_to_quant [1] (if the output is quantized)
+    // outputs
+    //     output [M(*), N], normalized input + residual
+    //     residual_output [M(*), N], input + residual
+    //     dynamic_scaling [M(*), 1] (optional output)
+
+    if (mType == DataType::kHALF)
+    {
+        enqueueForType<half>(inputDesc, inputs, outputs, stream);
+    }
+    else if (mType == DataType::kFLOAT)
+    {
+        enqueueForType<float>(inputDesc, inputs, outputs, stream);
+    }
+#ifdef ENABLE_BF16
+    else if (mType == DataType::kBF16)
+    {
+        enqueueForType<__nv_bfloat16>(inputDesc, inputs, outputs, stream);
+    }
+#endif
+
+    return 0;
+}
+
+// IPluginV2Ext Methods
+nvinfer1::DataType ResidualRmsnormPlugin::getOutputDataType(
+    int index, const nvinfer1::DataType* inputTypes, int nbInputs) const noexcept
+{
+    assert(index < getNbOutputs());
+    switch (index)
+    {
+    case 0: return mOutType;
+    case 1: return mType;
+    default: return DataType::kFLOAT;
+    }
+}
+
+// IPluginV2 Methods
+
+const char* ResidualRmsnormPlugin::getPluginType() const noexcept
+{
+    return RESIDUAL_RMSNORM_PLUGIN_NAME;
+}
+
+const char* ResidualRmsnormPlugin::getPluginVersion() const noexcept
+{
+    return RESIDUAL_RMSNORM_PLUGIN_VERSION;
+}
+
+int ResidualRmsnormPlugin::getNbOutputs() const noexcept
+{
+    return 2 + static_cast<int>(mDynActScaling);
+}
+
+int ResidualRmsnormPlugin::initialize() noexcept
+{
+    return 0;
+}
+
+void ResidualRmsnormPlugin::terminate() noexcept {}
+
+size_t ResidualRmsnormPlugin::getSerializationSize() const noexcept
+{
+    return sizeof(mEps) + sizeof(mType) + sizeof(mOutType) + sizeof(mDynActScaling);
+}
+
+void ResidualRmsnormPlugin::serialize(void* buffer) const noexcept
+{
+    char *d = static_cast<char*>(buffer), *a = d;
+    write(d, mEps);
+    write(d, mType);
+    write(d, mOutType);
+    write(d, mDynActScaling);
+    assert(d == a + getSerializationSize());
+}
+
+void ResidualRmsnormPlugin::destroy() noexcept
+{
+    // This gets called when the network containing plugin is destroyed
+    delete this;
+}
+
+///////////////
+
+ResidualRmsnormPluginCreator::ResidualRmsnormPluginCreator()
+{
+    // Fill PluginFieldCollection with PluginField arguments metadata
+    mPluginAttributes.clear();
+    mPluginAttributes.emplace_back(PluginField("eps", nullptr, PluginFieldType::kFLOAT32, 1e-5f));
+    mPluginAttributes.emplace_back(PluginField("type_id", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("out_type_id", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("dyn_act_scaling", nullptr, PluginFieldType::kINT32, 0));
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* ResidualRmsnormPluginCreator::getPluginName() const noexcept
+{
+    return RESIDUAL_RMSNORM_PLUGIN_NAME;
+}
+
+const char* ResidualRmsnormPluginCreator::getPluginVersion() const noexcept
+{
+    return RESIDUAL_RMSNORM_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* ResidualRmsnormPluginCreator::getFieldNames() noexcept
+{
+    return &mFC;
+}
+
+IPluginV2* ResidualRmsnormPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc) noexcept
+{
+    const PluginField* fields = fc->fields;
+    float eps{1e-5f};
+    nvinfer1::DataType type{};
+    std::optional<nvinfer1::DataType> outType;
+    bool dynamicActivationScaling{false};
+    // Read configurations from each fields
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "eps"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kFLOAT32);
+            eps = static_cast<float>(*(static_cast<const float*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "type_id"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            type = static_cast<nvinfer1::DataType>(*(static_cast<const nvinfer1::DataType*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "out_type_id"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            outType = static_cast<nvinfer1::DataType>(*(static_cast<const nvinfer1::DataType*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "dyn_act_scaling"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            dynamicActivationScaling = static_cast<bool>(*(static_cast<const int32_t*>(fields[i].data)));
+        }
+    }
+    try
+    {
+        auto* obj = new ResidualRmsnormPlugin(eps, type, outType.value_or(type), dynamicActivationScaling);
+        obj->setPluginNamespace(mNamespace.c_str());
+        return obj;
+    }
+    catch (const std::exception& e)
+    {
+        caughtError(e);
+    }
+    return nullptr;
+}
+
+IPluginV2* ResidualRmsnormPluginCreator::deserializePlugin(
+    const char* name, const void* serialData, size_t serialLength) noexcept
+{
+    // This object will be deleted when the network is destroyed, which will
+    // call ResidualRmsnormPlugin::destroy()
+    try
+    {
+        auto* obj = new ResidualRmsnormPlugin(serialData, serialLength);
+        obj->setPluginNamespace(mNamespace.c_str());
+        return obj;
+    }
+    catch (const std::exception& e)
+    {
+        caughtError(e);
+    }
+    return nullptr;
+}
@@ -46,8 +46,8 @@ void SmoothQuantGemmPluginProfiler::runTactic(int m, int n, int k, const SmoothQ
 
     const int wsSize = mRunner->getWorkspaceSize(m, n, k);
 
-    mRunner->gemm(
-        aTmp, bTmp, mQuantMode, alphaColTmp, alphaRowTmp, cTmp, m, n, k, tactic, workspaceTmp, wsSize, stream);
+    mRunner->gemm(aTmp, bTmp, mQuantMode, alphaColTmp, alphaRowTmp, nullptr, cTmp, m, n, k, tactic, workspaceTmp,
+        wsSize, stream);
 }
 
 void SmoothQuantGemmPluginProfiler::computeTmpSize(int maxM, int n, int k)
@@ -69,10 +69,11 @@ std::vector<SmoothQuantGemmPluginProfiler::Config> SmoothQuantGemmPluginProfiler
     return mRunner->getConfigs();
 }
 
-SmoothQuantGemmPlugin::SmoothQuantGemmPlugin(
-    QuantMode quantMode, nvinfer1::DataType type, const SmoothQuantGemmPlugin::PluginProfilerPtr& pluginProfiler)
+SmoothQuantGemmPlugin::SmoothQuantGemmPlugin(QuantMode quantMode, nvinfer1::DataType type, bool hasResidual,
+    const SmoothQuantGemmPlugin::PluginProfilerPtr& pluginProfiler)
     : mQuantMode(quantMode)
     , mPluginProfiler(pluginProfiler)
+    , mHasResidual(hasResidual)
 {
     init(type);
 }
@@ -88,6 +89,7 @@ SmoothQuantGemmPlugin::SmoothQuantGemmPlugin(
     unsigned int quantMode;
     read(d, quantMode);
     read(d, type);
+    read(d, mHasResidual);
     read(d, mDims);
 
     mQuantMode = QuantMode(quantMode);
@@ -137,7 +139,7 @@ nvinfer1::DimsExprs SmoothQuantGemmPlugin::getOutputDimensions(
 {
     try
     {
-        TLLM_CHECK(nbInputs == 4);
+        TLLM_CHECK(nbInputs == (mHasResidual ? 5 : 4));
         TLLM_CHECK(outputIndex == 0);
         const int nbDimsA = inputs[0].nbDims;
         TLLM_CHECK(nbDimsA >= 2);
@@ -175,6 +177,8 @@ bool SmoothQuantGemmPlugin::supportsFormatCombination(
         // scales tokens
         return inOut[pos].type == nvinfer1::DataType::kFLOAT && inOut[pos].format == TensorFormat::kLINEAR;
     case 4:
+        // residual if has_residual, else out
+    case 5:
         // out
         return inOut[pos].type == mType && inOut[pos].format == TensorFormat::kLINEAR;
     default:
@@ -222,6 +226,7 @@ int SmoothQuantGemmPlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc,
     //     mat2           [N, K]
     //     scale_tokens   [M, 1] if has_per_token_scaling else [1, 1]
     //     scale_channels [1, N] if has_per_channel_scaling else [1, 1]
+    //     residual       [M(*), N] if has_residual
     // outputs
     //     mat [M(*), N]
     int m = 1;
@@ -235,8 +240,9 @@ int SmoothQuantGemmPlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc,
 
     const auto& bestTactic = mPluginProfiler->getBestConfig(m, mGemmId);
     TLLM_CHECK_WITH_INFO(bestTactic, "No valid SQ GEMM tactic");
+    const void* residual = mHasResidual ? inputs[4] : nullptr;
     m_sqGemmRunner->gemm(reinterpret_cast<const int8_t*>(inputs[0]), reinterpret_cast<const int8_t*>(inputs[1]),
-        mQuantMode, reinterpret_cast<const float*>(inputs[3]), reinterpret_cast<const float*>(inputs[2]),
+        mQuantMode, reinterpret_cast<const float*>(inputs[3]), reinterpret_cast<const float*>(inputs[2]), residual,
         reinterpret_cast<void*>(outputs[0]), m, n, k, *bestTactic, reinterpret_cast<char*>(workspace), wsSize, stream);
 
     return 0;
@@ -279,6 +285,7 @@ size_t SmoothQuantGemmPlugin::getSerializationSize() const noexcept
 {
     return sizeof(unsigned int) +                       // QuantMode
         sizeof(nvinfer1::DataType) +                    // dtype
+        sizeof(bool) +                                  // mHasResidual
         sizeof(mDims) +                                 // Dimensions
         mPluginProfiler->getSerializationSize(mGemmId); // selected tactics container size
 }
@@ -288,6 +295,7 @@ void SmoothQuantGemmPlugin::serialize(void* buffer) const noexcept
     char *d = static_cast<char*>(buffer), *a = d;
     write(d, mQuantMode.value());
     write(d, mType);
+    write(d, mHasResidual);
     write(d, mDims);
 
     mPluginProfiler->serialize(d, mGemmId);
@@ -314,6 +322,7 @@ SmoothQuantGemmPluginCreator::SmoothQuantGemmPluginCreator()
     mPluginAttributes.emplace_back(PluginField("has_per_channel_scaling", nullptr, PluginFieldType::kINT32, 1));
     mPluginAttributes.emplace_back(PluginField("has_per_token_scaling", nullptr, PluginFieldType::kINT32, 1));
     mPluginAttributes.emplace_back(PluginField("type_id", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("has_residual", nullptr, PluginFieldType::kINT32, 1));
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
 }
@@ -338,6 +347,7 @@ IPluginV2* SmoothQuantGemmPluginCreator::createPlugin(const char* name, const Pl
     const PluginField* fields = fc->fields;
     bool perTokenScaling, perChannelScaling;
     nvinfer1::DataType type;
+    bool hasResidual = false;
     // Read configurations from each fields
     for (int i = 0; i < fc->nbFields; ++i)
     {
@@ -357,6 +367,11 @@ IPluginV2* SmoothQuantGemmPluginCreator::createPlugin(const char* name, const Pl
             TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
             type = static_cast<nvinfer1::DataType>(*(static_cast<const nvinfer1::DataType*>(fields[i].data)));
         }
+        else if (!strcmp(attrName, "has_residual"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            hasResidual = static_cast<bool>(*(static_cast<const int*>(fields[i].data)));
+        }
     }
     try
     {
@@ -364,7 +379,7 @@ IPluginV2* SmoothQuantGemmPluginCreator::createPlugin(const char* name, const Pl
         // Create plugin profiler with shared tactics map
         auto pluginProfiler = gemmPluginProfileManager.createGemmPluginProfiler(/* inference */ false);
         QuantMode quantMode = QuantMode::fromDescription(true, true, perTokenScaling, perChannelScaling);
-        auto* obj = new SmoothQuantGemmPlugin(quantMode, type, pluginProfiler);
+        auto* obj = new SmoothQuantGemmPlugin(quantMode, type, hasResidual, pluginProfiler);
         obj->setPluginNamespace(mNamespace.c_str());
         return obj;
     }
@@ -50,6 +50,11 @@ protected:
 
     std::vector<Config> getTactics(int m, int n, int k) const override;
 
+    std::string getCacheTag() const override
+    {
+        return "quant=" + std::to_string(mQuantMode.value());
+    }
+
 private:
     tensorrt_llm::common::QuantMode mQuantMode;
 };
@@ -61,8 +66,8 @@ public:
 
     SmoothQuantGemmPlugin() = delete;
 
-    SmoothQuantGemmPlugin(
-        tensorrt_llm::common::QuantMode quantMode, nvinfer1::DataType type, const PluginProfilerPtr& pluginProfiler);
+    SmoothQuantGemmPlugin(tensorrt_llm::common::QuantMode quantMode, nvinfer1::DataType type, bool hasResidual,
+        const PluginProfilerPtr& pluginProfiler);
 
     SmoothQuantGemmPlugin(const void* data, size_t length, const PluginProfilerPtr& pluginProfiler);
 
@@ -113,6 +118,9 @@ private:
     PluginProfilerPtr mPluginProfiler;
 
     nvinfer1::DataType mType;
+
+    // The residual [M, N] is added to the output in the GEMM epilogue
+    bool mHasResidual{false};
 };
 
 class SmoothQuantGemmPluginCreator : public BaseCreator
@@ -0,0 +1,427 @@
+/*
+ * SPDX-FileCopyrightText: Copyright (c) 1993-2023 NVIDIA CORPORATION &
+ * AFFILIATES. All rights reserved. SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "w4a8GemmPlugin.h"
+#include "tensorrt_llm/kernels/preQuantScaleKernel.h"
+#include "tensorrt_llm/kernels/quantization.h"
+#include "tensorrt_llm/kernels/w4a8GemmKernels.h"
+#include <numeric>
+
+using namespace nvinfer1;
+using namespace tensorrt_llm::common;
+using namespace tensorrt_llm::kernels;
+using namespace tensorrt_llm::kernels::cutlass_kernels;
+using tensorrt_llm::plugins::W4A8GemmPluginCreator;
+using tensorrt_llm::plugins::W4A8GemmPlugin;
+using tensorrt_llm::plugins::read;
+using tensorrt_llm::plugins::write;
+
+static const char* W4A8_GEMM_PLUGIN_VERSION{"1"};
+static const char* W4A8_GEMM_PLUGIN_NAME{"W4A8Gemm"};
+PluginFieldCollection W4A8GemmPluginCreator::mFC{};
+std::vector<nvinfer1::PluginField> W4A8GemmPluginCreator::mPluginAttributes;
+
+W4A8GemmPlugin::W4A8GemmPlugin(QuantMode quantMode, nvinfer1::DataType type, bool hasPreQuantScale,
+    const W4A8GemmPlugin::PluginProfilerPtr& pluginProfiler)
+    : mQuantMode(quantMode)
+    , mHasPreQuantScale(hasPreQuantScale)
+    , mPluginProfiler(pluginProfiler)
+{
+    init(type);
+}
+
+// Parameterized constructor
+W4A8GemmPlugin::W4A8GemmPlugin(
+    const void* data, size_t length, const W4A8GemmPlugin::PluginProfilerPtr& pluginProfiler)
+    : mPluginProfiler(pluginProfiler)
+{
+    const char *d = reinterpret_cast<const char*>(data), *a = d;
+    nvinfer1::DataType type;
+    unsigned int quantMode;
+    read(d, quantMode);
+    read(d, type);
+    read(d, mHasPreQuantScale);
+    read(d, mDims);
+
+    mQuantMode = QuantMode(quantMode);
+
+    init(type);
+
+    mPluginProfiler->deserialize(d, mDims, mGemmId);
+
+    TLLM_CHECK(d == a + length);
+}
+
+void W4A8GemmPlugin::init(nvinfer1::DataType type)
+{
+    mType = type;
+    if (mType == nvinfer1::DataType::kHALF)
+    {
+        mGemmRunner = std::make_shared<CutlassInt8GemmRunner<half>>();
+    }
+#ifdef ENABLE_BF16
+    else if (mType == nvinfer1::DataType::kBF16)
+    {
+        mGemmRunner = std::make_shared<CutlassInt8GemmRunner<__nv_bfloat16>>();
+    }
+#endif
+    else
+    {
+        TLLM_THROW("Unsupported data type for the W4A8 GEMM plugin");
+    }
+
+    mPluginProfiler->setQuantMode(mQuantMode);
+
+    mGemmId = GemmIdCore(mDims.n, mDims.k, mType);
+}
+
+// IPluginV2DynamicExt Methods
+nvinfer1::IPluginV2DynamicExt* W4A8GemmPlugin::clone() const noexcept
+{
+    auto* plugin = new W4A8GemmPlugin(*this);
+    return plugin;
+}
+
+nvinfer1::DimsExprs W4A8GemmPlugin::getOutputDimensions(
+    int outputIndex, const nvinfer1::DimsExprs* inputs, int nbInputs, nvinfer1::IExprBuilder& exprBuilder) noexcept
+{
+    try
+    {
+        TLLM_CHECK(nbInputs == (mHasPreQuantScale ? 4 : 3));
+        TLLM_CHECK(outputIndex == 0);
+        const int nbDimsA = inputs[0].nbDims;
+        TLLM_CHECK(nbDimsA >= 2);
+        DimsExprs ret;
+        ret.nbDims = nbDimsA;
+        for (int ii = 0; ii < nbDimsA - 1; ++ii)
+        {
+            ret.d[ii] = inputs[0].d[ii];
+        }
+        ret.d[nbDimsA - 1] = inputs[1].d[0];
+        return ret;
+    }
+    catch (const std::exception& e)
+    {
+        caughtError(e);
+    }
+    return DimsExprs{};
+}
+
+bool W4A8GemmPlugin::supportsFormatCombination(
+    int pos, const nvinfer1::PluginTensorDesc* inOut, int nbInputs, int nbOutputs) noexcept
+{
+    const int outputPos = nbInputs;
+    if (pos == 0 || pos == outputPos)
+    {
+        // activation and out
+        return inOut[pos].type == mType && inOut[pos].format == TensorFormat::kLINEAR;
+    }
+    switch (pos)
+    {
+    case 1:
+        // weights, two int4 values per int8 element
+        return inOut[pos].type == nvinfer1::DataType::kINT8 && inOut[pos].format == TensorFormat::kLINEAR;
+    case 2:
+        // scales channels
+        return inOut[pos].type == nvinfer1::DataType::kFLOAT && inOut[pos].format == TensorFormat::kLINEAR;
+    case 3:
+        // pre-quant scales
+        return inOut[pos].type == mType && inOut[pos].format == TensorFormat::kLINEAR;
+    default:
+        // Never should be here
+        assert(false);
+        return false;
+    }
+}
+
+size_t W4A8GemmPlugin::getWorkspaceSizeImpl(int m, int n, int k) const
+{
+    const bool useGemm = m > kW4A8GemvMaxM;
+    std::vector<size_t> workspaces = {
+        mHasPreQuantScale ? static_cast<size_t>(m) * k * 2 : 0, // smoothed activation
+        static_cast<size_t>(m) * k,                             // int8 activation
+        m * sizeof(float),                                      // scales tokens
+        useGemm ? static_cast<size_t>(n) * k : 0,               // unpacked weights
+        useGemm ? mGemmRunner->getWorkspaceSize(m, n, k) : 0    // GEMM workspace
+    };
+    return calculateTotalWorkspaceSize(workspaces.data(), workspaces.size());
+}
+
+void W4A8GemmPlugin::configurePlugin(const nvinfer1::DynamicPluginTensorDesc* in, int nbInputs,
+    const nvinfer1::DynamicPluginTensorDesc* out, int nbOutputs) noexcept
+{
+    const auto minM = std::accumulate(in[0].min.d, in[0].min.d + in[0].min.nbDims - 1, 1, std::multiplies<int>());
+    const auto maxM = std::accumulate(in[0].max.d, in[0].max.d + in[0].max.nbDims - 1, 1, std::multiplies<int>());
+
+    const int maxK = in[0].max.d[in[0].max.nbDims - 1];
+    const int maxN = in[1].max.d[0];
+    const int minK = in[0].min.d[in[0].min.nbDims - 1];
+    const int minN = in[1].min.d[0];
+
+    TLLM_CHECK_WITH_INFO(minN == maxN, "Variable out channels is not allowed");
+    TLLM_CHECK_WITH_INFO(minK == maxK, "Variable in channels is not allowed");
+    TLLM_CHECK_WITH_INFO(maxK % 8 == 0, "The hidden size of the W4A8 GEMM must be a multiple of 8");
+
+    if (!mDims.isInitialized())
+    {
+        // Only the batches above kW4A8GemvMaxM run the tensor core GEMM
+        mDims = {std::max(minM, kW4A8GemvMaxM + 1), std::max(maxM, kW4A8GemvMaxM + 1), maxN, maxK};
+    }
+    mGemmId = {maxN, maxK, mType};
+
+    mWorkspaceMaxSize = getWorkspaceSizeImpl(maxM, maxN, maxK);
+}
+
+size_t W4A8GemmPlugin::getWorkspaceSize(const nvinfer1::PluginTensorDesc* inputs, int nbInputs,
+    const nvinfer1::PluginTensorDesc* outputs, int nbOutputs) const noexcept
+{
+    return mWorkspaceMaxSize;
+}
+
+template <typename T>
+void W4A8GemmPlugin::enqueueImpl(
+    const void* const* inputs, void* output, int m, int n, int k, char* workspace, cudaStream_t stream)
+{
+    const T* act = reinterpret_cast<const T*>(inputs[0]);
+    const int8_t* weight = reinterpret_cast<const int8_t*>(inputs[1]);
+    const float* scaleChannels = reinterpret_cast<const float*>(inputs[2]);
+
+    T* smoothedAct = reinterpret_cast<T*>(workspace);
+    int8_t* quantizedAct = nextWorkspacePtr(
+        reinterpret_cast<int8_t*>(smoothedAct), mHasPreQuantScale ? static_cast<size_t>(m) * k * sizeof(T) : 0);
+    float* scaleTokens = reinterpret_cast<float*>(nextWorkspacePtr(quantizedAct, static_cast<size_t>(m) * k));
+
+    // AWQ-style smoothing before the quantization of the activations
+    if (mHasPreQuantScale)
+    {
+        apply_per_channel_scale_kernel_launcher<T>(
+            smoothedAct, act, reinterpret_cast<const T*>(inputs[3]), m, k, stream);
+        act = smoothedAct;
+    }
+    invokePerTokenQuantization<T>(quantizedAct, act, m, k, scaleTokens, stream);
+
+    if (m <= kW4A8GemvMaxM)
+    {
+        invokeW4A8BatchedGemv<T>(reinterpret_cast<T*>(output), quantizedAct, weight, mQuantMode, scaleTokens,
+            scaleChannels, m, n, k, stream);
+        return;
+    }
+
+    int8_t* unpackedWeight
+        = nextWorkspacePtr(reinterpret_cast<int8_t*>(scaleTokens), static_cast<size_t>(m) * sizeof(float));
+    char* gemmWorkspace = reinterpret_cast<char*>(nextWorkspacePtr(unpackedWeight, static_cast<size_t>(n) * k));
+    invokeUnpackInt4ToInt8(unpackedWeight, weight, n, k, stream);
+
+    const int wsSize = mGemmRunner->getWorkspaceSize(m, n, k);
+    const auto& bestTactic = mPluginProfiler->getBestConfig(m, mGemmId);
+    TLLM_CHECK_WITH_INFO(bestTactic, "No valid W4A8 GEMM tactic");
+    mGemmRunner->gemm(quantizedAct, unpackedWeight, mQuantMode, scaleChannels, scaleTokens, nullptr, output, m, n,
+        k, *bestTactic, gemmWorkspace, wsSize, stream);
+}
+
+int W4A8GemmPlugin::enqueue(const nvinfer1::PluginTensorDesc* inputDesc, const nvinfer1::PluginTensorDesc* outputDesc,
+    const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream) noexcept
+{
+    // inputs
+    //     mat1           [M(*), K]
+    //     mat2           [N, K / 2], packed int4
+    //     scale_channels [1, N] if has_per_channel_scaling else [1, 1]
+    //     pre_quant_scale [1, K] if has_pre_quant_scale
+    // outputs
+    //     mat [M(*), N]
+    int m = 1;
+    for (int ii = 0; ii < inputDesc[0].dims.nbDims - 1; ++ii)
+    {
+        m *= inputDesc[0].dims.d[ii];
+    }
+    const int n = inputDesc[1].dims.d[0];
+    const int k = inputDesc[0].dims.d[inputDesc[0].dims.nbDims - 1];
+    if (m == 0)
+    {
+        return 0;
+    }
+
+    if (mType == nvinfer1::DataType::kHALF)
+    {
+        enqueueImpl<half>(inputs, outputs[0], m, n, k, reinterpret_cast<char*>(workspace), stream);
+    }
+#ifdef ENABLE_BF16
+    else if (mType == nvinfer1::DataType::kBF16)
+    {
+        enqueueImpl<__nv_bfloat16>(inputs, outputs[0], m, n, k, reinterpret_cast<char*>(workspace), stream);
+    }
+#endif
+
+    return 0;
+}
+
+// IPluginV2Ext Methods
+nvinfer1::DataType W4A8GemmPlugin::getOutputDataType(
+    int index, const nvinfer1::DataType* inputTypes, int nbInputs) const noexcept
+{
+    TLLM_CHECK(index == 0);
+    return mType;
+}
+
+// IPluginV2 Methods
+
+const char* W4A8GemmPlugin::getPluginType() const noexcept
+{
+    return W4A8_GEMM_PLUGIN_NAME;
+}
+
+const char* W4A8GemmPlugin::getPluginVersion() const noexcept
+{
+    return W4A8_GEMM_PLUGIN_VERSION;
+}
+
+int W4A8GemmPlugin::getNbOutputs() const noexcept
+{
+    return 1;
+}
+
+int W4A8GemmPlugin::initialize() noexcept
+{
+    configGemm();
+    return 0;
+}
+
+void W4A8GemmPlugin::terminate() noexcept {}
+
+size_t W4A8GemmPlugin::getSerializationSize() const noexcept
+{
+    return sizeof(unsigned int) +                       // QuantMode
+        sizeof(nvinfer1::DataType) +                    // dtype
+        sizeof(mHasPreQuantScale) +                     // has pre-quant scale
+        sizeof(mDims) +                                 // Dimensions
+        mPluginProfiler->getSerializationSize(mGemmId); // selected tactics container size
+}
+
+void W4A8GemmPlugin::serialize(void* buffer) const noexcept
+{
+    char *d = static_cast<char*>(buffer), *a = d;
+    write(d, mQuantMode.value());
+    write(d, mType);
+    write(d, mHasPreQuantScale);
+    write(d, mDims);
+
+    mPluginProfiler->serialize(d, mGemmId);
+    assert(d == a + getSerializationSize());
+}
+
+void W4A8GemmPlugin::destroy() noexcept
+{
+    // This gets called when the network containing plugin is destroyed
+    delete this;
+}
+
+void W4A8GemmPlugin::configGemm()
+{
+    mPluginProfiler->profileTactics(mGemmRunner, mType, mDims, mGemmId);
+}
+
+///////////////
+
+W4A8GemmPluginCreator::W4A8GemmPluginCreator()
+{
+    // Fill PluginFieldCollection with PluginField arguments metadata
+    mPluginAttributes.clear();
+    mPluginAttributes.emplace_back(PluginField("has_per_channel_scaling", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("has_pre_quant_scale", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("type_id", nullptr, PluginFieldType::kINT32, 1));
+    mFC.nbFields = mPluginAttributes.size();
+    mFC.fields = mPluginAttributes.data();
+}
+
+const char* W4A8GemmPluginCreator::getPluginName() const noexcept
+{
+    return W4A8_GEMM_PLUGIN_NAME;
+}
+
+const char* W4A8GemmPluginCreator::getPluginVersion() const noexcept
+{
+    return W4A8_GEMM_PLUGIN_VERSION;
+}
+
+const PluginFieldCollection* W4A8GemmPluginCreator::getFieldNames() noexcept
+{
+    return &mFC;
+}
+
+IPluginV2* W4A8GemmPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc) noexcept
+{
+    const PluginField* fields = fc->fields;
+    bool perChannelScaling = false;
+    bool hasPreQuantScale = false;
+    nvinfer1::DataType type;
+    // Read configurations from each fields
+    for (int i = 0; i < fc->nbFields; ++i)
+    {
+        const char* attrName = fields[i].name;
+        if (!strcmp(attrName, "has_per_channel_scaling"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            perChannelScaling = static_cast<bool>(*(static_cast<const int*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "has_pre_quant_scale"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            hasPreQuantScale = static_cast<bool>(*(static_cast<const int*>(fields[i].data)));
+        }
+        else if (!strcmp(attrName, "type_id"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            type = static_cast<nvinfer1::DataType>(*(static_cast<const nvinfer1::DataType*>(fields[i].data)));
+        }
+    }
+    try
+    {
+        // W4A8GemmPluginCreator is unique and shared for an engine generation
+        // Create plugin profiler with shared tactics map
+        auto pluginProfiler = gemmPluginProfileManager.createGemmPluginProfiler(/* inference */ false);
+        // The activations are always quantized per token in the plugin
+        QuantMode quantMode = QuantMode::fromDescription(true, true, /* perToken */ true, perChannelScaling,
+            /* useInt4Weights */ true);
+        auto* obj = new W4A8GemmPlugin(quantMode, type, hasPreQuantScale, pluginProfiler);
+        obj->setPluginNamespace(mNamespace.c_str());
+        return obj;
+    }
+    catch (const std::exception& e)
+    {
+        caughtError(e);
+    }
+    return nullptr;
+}
+
+IPluginV2* W4A8GemmPluginCreator::deserializePlugin(
+    const char* name, const void* serialData, size_t serialLength) noexcept
+{
+    // This object will be deleted when the network is destroyed, which will
+    // call W4A8GemmPlugin::destroy()
+    try
+    {
+        // Create plugin profiler with private tactics map which is read from the serialized engine
+        auto pluginProfiler = gemmPluginProfileManager.createGemmPluginProfiler(/* inference */ true);
+        auto* obj = new W4A8GemmPlugin(serialData, serialLength, pluginProfiler);
+        obj->setPluginNamespace(mNamespace.c_str());
+        return obj;
+    }
+    catch (const std::exception& e)
+    {
+        caughtError(e);
+    }
+    return nullptr;
+}
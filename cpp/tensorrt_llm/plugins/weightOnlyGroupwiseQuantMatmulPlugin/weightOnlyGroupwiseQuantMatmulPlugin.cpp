@@ -25,11 +25,13 @@ using tensorrt_llm::plugins::WeightOnlyGroupwiseQuantMatmulPlugin;
 using tensorrt_llm::plugins::WeightOnlyGroupwiseQuantGemmPluginProfiler;
 
 // Flags for indicating whether the corresponding inputs are applied in mQuantAlgo
-// mQuantAlgo = pre_quant_scale * PRE_QUANT_SCALE + zero * ZERO + bias * BIAS
-// Here pre_quant_scale, zero and bias are boolean type
+// mQuantAlgo = act_order * ACT_ORDER + pre_quant_scale * PRE_QUANT_SCALE + zero * ZERO + bias * BIAS
+// Here act_order, pre_quant_scale, zero and bias are boolean type
 static constexpr int BIAS = int(1) << 0;
 static constexpr int ZERO = int(1) << 1;
 static constexpr int PRE_QUANT_SCALE = int(1) << 2;
+// GPTQ act-order: the K dimension of the weights is sorted by group, the activations are permuted to match
+static constexpr int ACT_ORDER = int(1) << 3;
 using tensorrt_llm::plugins::read;
 using tensorrt_llm::plugins::write;
 
@@ -127,9 +129,10 @@ void WeightOnlyGroupwiseQuantMatmulPlugin::init(nvinfer1::DataType type, int qua
     mQuantAlgo = quant_algo;
     mGroupSize = group_size;
 
-    // quant_algo = pre_quant_scale * 4 + zero * 2 + bias
+    // quant_algo = act_order * 8 + pre_quant_scale * 4 + zero * 2 + bias
     mPreQuantScaleInputIdx = (quant_algo & PRE_QUANT_SCALE) ? 1 : 0;
-    mWeightInputIdx = mPreQuantScaleInputIdx + 1;
+    mActOrderPermInputIdx = (quant_algo & ACT_ORDER) ? mPreQuantScaleInputIdx + 1 : mPreQuantScaleInputIdx;
+    mWeightInputIdx = mActOrderPermInputIdx + 1;
     mScalesInputIdx = mWeightInputIdx + 1;
     mZerosInputIdx = (quant_algo & ZERO) ? mScalesInputIdx + 1 : mScalesInputIdx;
     mBiasesInputIdx = (quant_algo & BIAS) ? mZerosInputIdx + 1 : mZerosInputIdx;
@@ -201,10 +204,11 @@ nvinfer1::DimsExprs WeightOnlyGroupwiseQuantMatmulPlugin::getOutputDimensions(
     // inputs
     //   0 activations      [M, K]
     //   1 pre-quant scales [K] (optional)
-    //   2 weights          [K, N/2]
-    //   3 scales           [K // group_size, N]
-    //   4 zeros            [K // group_size, N] (optional)
-    //   5 biases           [M] (optional)
+    //   2 act-order perm   [K] (optional)
+    //   3 weights          [K, N/2]
+    //   4 scales           [K // group_size, N]
+    //   5 zeros            [K // group_size, N] (optional)
+    //   6 biases           [M] (optional)
 
     try
     {
@@ -244,6 +248,11 @@ bool WeightOnlyGroupwiseQuantMatmulPlugin::supportsFormatCombination(
             return inOut[mWeightInputIdx].type == nvinfer1::DataType::kINT8
                 && inOut[mWeightInputIdx].format == TensorFormat::kLINEAR;
         }
+        else if ((mQuantAlgo & ACT_ORDER) && pos == mActOrderPermInputIdx)
+        {
+            // act-order permutation
+            return inOut[pos].type == nvinfer1::DataType::kINT32 && inOut[pos].format == TensorFormat::kLINEAR;
+        }
         else
         {
             return inOut[pos].type == mType && inOut[pos].format == TensorFormat::kLINEAR;
@@ -294,10 +303,11 @@ int WeightOnlyGroupwiseQuantMatmulPlugin::enqueue(const nvinfer1::PluginTensorDe
     // inputs
     //   0 activations      [M, K]
     //   1 pre-quant scales [K]
-    //   2 weights          [K, N/2]
-    //   3 scales           [K // group_size, N]
-    //   4 zeros            [K // group_size, N]
-    //   5 biases           [M]
+    //   2 act-order perm   [K]
+    //   3 weights          [K, N/2]
+    //   4 scales           [K // group_size, N]
+    //   5 zeros            [K // group_size, N]
+    //   6 biases           [M]
     // outputs
     //   mat                [M, N]
 
@@ -310,12 +320,37 @@ int WeightOnlyGroupwiseQuantMatmulPlugin::enqueue(const nvinfer1::PluginTensorDe
     const int k = inputDesc[0].dims.d[inputDesc[0].dims.nbDims - 1];
     bool use_cuda_kernel = m < SMALL_M_FAST_PATH && mCudaKernelEnabled;
     bool use_pre_quant_scale = mQuantAlgo & PRE_QUANT_SCALE;
+    bool use_act_order = mQuantAlgo & ACT_ORDER;
 
     const half* zeros_ptr = (mQuantAlgo & ZERO) ? reinterpret_cast<const half*>(inputs[mZerosInputIdx]) : nullptr;
     const half* biases_ptr = (mQuantAlgo & BIAS) ? reinterpret_cast<const half*>(inputs[mBiasesInputIdx]) : nullptr;
     const half* act_ptr = reinterpret_cast<const half*>(inputs[0]);
 
-    if (use_pre_quant_scale && !use_cuda_kernel)
+    if (use_act_order)
+    {
+        // Permute the activations like the K dimension of the weights, applying the pre-quant scale in the same pass
+        // for both the CUDA and the cutlass kernels
+        act_ptr = reinterpret_cast<const half*>(workspace);
+        const int* perm = reinterpret_cast<const int*>(inputs[mActOrderPermInputIdx]);
+        if (mType == nvinfer1::DataType::kHALF)
+        {
+            tensorrt_llm::kernels::apply_per_channel_scale_and_permutation_kernel_launcher<half>(
+                reinterpret_cast<half*>(workspace), reinterpret_cast<const half*>(inputs[0]),
+                use_pre_quant_scale ? reinterpret_cast<const half*>(inputs[mPreQuantScaleInputIdx]) : nullptr, perm,
+                m, k, stream);
+        }
+#if defined(ENABLE_BF16)
+        else if (mType == nvinfer1::DataType::kBF16)
+        {
+            tensorrt_llm::kernels::apply_per_channel_scale_and_permutation_kernel_launcher<__nv_bfloat16>(
+                reinterpret_cast<__nv_bfloat16*>(workspace), reinterpret_cast<const __nv_bfloat16*>(inputs[0]),
+                use_pre_quant_scale ? reinterpret_cast<const __nv_bfloat16*>(inputs[mPreQuantScaleInputIdx])
+                                    : nullptr,
+                perm, m, k, stream);
+        }
+#endif
+    }
+    else if (use_pre_quant_scale && !use_cuda_kernel)
     {
         // Apply pre-quant per channel scale on activations
         act_ptr = reinterpret_cast<const half*>(workspace);
@@ -358,7 +393,7 @@ int WeightOnlyGroupwiseQuantMatmulPlugin::enqueue(const nvinfer1::PluginTensorDe
         // The CUDA kernel is designed for ColumnMajorTileInterleave weight layout used in fpAIntB cutlass kernel
         // when sm >= 75 and the preprocessing of cutlass on sm70 does not interleave the weights.
         const void* pre_quant_scale = nullptr;
-        if (use_pre_quant_scale)
+        if (use_pre_quant_scale && !use_act_order)
             pre_quant_scale = inputs[mPreQuantScaleInputIdx];
         tensorrt_llm::kernels::WeightOnlyParams params{reinterpret_cast<const uint8_t*>(inputs[mWeightInputIdx]),
             inputs[mScalesInputIdx], zeros_ptr, act_ptr, pre_quant_scale, biases_ptr, outputs[0], m, real_n, k,
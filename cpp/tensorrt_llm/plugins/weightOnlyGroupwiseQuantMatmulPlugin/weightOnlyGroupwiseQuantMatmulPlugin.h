@@ -66,6 +66,11 @@ protected:
 
     std::vector<Config> getTactics(int m, int n, int k) const override;
 
+    std::string getCacheTag() const override
+    {
+        return "algo=" + std::to_string(mQuantAlgo) + ",group=" + std::to_string(mGroupSize);
+    }
+
 private:
     int mQuantAlgo;
     int mGroupSize;
@@ -135,6 +140,7 @@ private:
     int mGroupSize;
 
     int mPreQuantScaleInputIdx;
+    int mActOrderPermInputIdx;
     int mWeightInputIdx;
     int mScalesInputIdx;
     int mZerosInputIdx;
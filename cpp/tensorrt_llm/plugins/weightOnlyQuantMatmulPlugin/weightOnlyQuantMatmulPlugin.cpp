@@ -45,6 +45,22 @@ void WeightOnlyQuantGemmPluginProfiler::runTactic(int m, int n, int k,
     char* workspacePtr
         = reinterpret_cast<char*>(nextWorkspacePtr(reinterpret_cast<int8_t*>(outputPtr), m * originalN * sizeof(half)));
 
+    if (isBatchedGemvTactic(tactic))
+    {
+        const auto weightOnlyQuantType = mWeightTypeId == WeightTypeId::INT8
+            ? tensorrt_llm::kernels::WeightOnlyQuantType::Int8b
+            : tensorrt_llm::kernels::WeightOnlyQuantType::Int4b;
+        const auto weightOnlyActType = mType == nvinfer1::DataType::kBF16
+            ? tensorrt_llm::kernels::WeightOnlyActivationType::BF16
+            : tensorrt_llm::kernels::WeightOnlyActivationType::FP16;
+        tensorrt_llm::kernels::WeightOnlyParams params{reinterpret_cast<const uint8_t*>(weightPtr), scalesPtr, nullptr,
+            actPtr, nullptr, nullptr, outputPtr, m, originalN, k, 0, weightOnlyQuantType,
+            tensorrt_llm::kernels::WeightOnlyType::PerChannel,
+            tensorrt_llm::kernels::WeightOnlyActivationFunctionType::Identity, weightOnlyActType};
+        tensorrt_llm::kernels::weight_only_batched_gemv_launcher(params, stream);
+        return;
+    }
+
     const int wsSize = mRunner->getWorkspaceSize(m, n, k);
 
     if (mWeightTypeId == WeightTypeId::INT8)
@@ -75,14 +91,19 @@ void WeightOnlyQuantGemmPluginProfiler::computeTmpSize(int maxM, int n, int k)
 std::vector<WeightOnlyQuantGemmPluginProfiler::Config> WeightOnlyQuantGemmPluginProfiler::getTactics(
     int m, int n, int k) const
 {
-    return mRunner->getConfigs();
+    auto tactics = mRunner->getConfigs();
+    if (mCudaKernelEnabled && m <= tensorrt_llm::kernels::kWeightOnlyBatchedGemvMaxM)
+    {
+        tactics.push_back(getBatchedGemvTactic());
+    }
+    return tactics;
 }
 
 WeightOnlyQuantMatmulPlugin::WeightOnlyQuantMatmulPlugin(nvinfer1::DataType type, WeightTypeId weightTypeId,
-    const WeightOnlyQuantMatmulPlugin::PluginProfilerPtr& pluginProfiler)
+    bool swiGlu, const WeightOnlyQuantMatmulPlugin::PluginProfilerPtr& pluginProfiler)
     : mPluginProfiler(pluginProfiler)
 {
-    init(type, weightTypeId);
+    init(type, weightTypeId, swiGlu);
 }
 
 // Parameterized constructor
@@ -93,21 +114,24 @@ WeightOnlyQuantMatmulPlugin::WeightOnlyQuantMatmulPlugin(
     const char *d = reinterpret_cast<const char*>(data), *a = d;
     nvinfer1::DataType type;
     WeightTypeId weightTypeId;
+    bool swiGlu;
     read(d, type);
     read(d, weightTypeId);
+    read(d, swiGlu);
     read(d, mDims);
 
-    init(type, weightTypeId);
+    init(type, weightTypeId, swiGlu);
 
     mPluginProfiler->deserialize(d, mDims, mGemmId);
 
     TLLM_CHECK(d == a + length);
 }
 
-void WeightOnlyQuantMatmulPlugin::init(nvinfer1::DataType type, WeightTypeId weightTypeId)
+void WeightOnlyQuantMatmulPlugin::init(nvinfer1::DataType type, WeightTypeId weightTypeId, bool swiGlu)
 {
     mType = type;
     mWeightTypeId = weightTypeId;
+    mSwiGlu = swiGlu;
     if (mWeightTypeId == WeightTypeId::INT8)
     {
         if (mType == nvinfer1::DataType::kHALF)
@@ -157,6 +181,7 @@ void WeightOnlyQuantMatmulPlugin::init(nvinfer1::DataType type, WeightTypeId wei
     }
 
     mPluginProfiler->setWeightTypeId(mWeightTypeId);
+    mPluginProfiler->setCudaKernelEnabled(mCudaKernelEnabled);
 
     mGemmId = GemmIdCore(mDims.n, mDims.k, mType);
 }
@@ -193,15 +218,18 @@ nvinfer1::DimsExprs WeightOnlyQuantMatmulPlugin::getOutputDimensions(
         {
             ret.d[ii] = inputs[0].d[ii];
         }
+        // The gate and the up of SwiGLU make one output column
+        const int outputDivisor = mSwiGlu ? 2 : 1;
         if (mWeightTypeId == WeightTypeId::INT8)
         {
             // int8 weight only quant
-            ret.d[nbDimsA - 1] = exprBuilder.constant(inputs[1].d[1]->getConstantValue());
+            ret.d[nbDimsA - 1] = exprBuilder.constant(inputs[1].d[1]->getConstantValue() / outputDivisor);
         }
         else
         {
             // int4 weight only quant
-            ret.d[nbDimsA - 1] = exprBuilder.constant(inputs[1].d[1]->getConstantValue() * INT8_INT4_RATIO);
+            ret.d[nbDimsA - 1]
+                = exprBuilder.constant(inputs[1].d[1]->getConstantValue() * INT8_INT4_RATIO / outputDivisor);
         }
         return ret;
     }
@@ -258,6 +286,12 @@ void WeightOnlyQuantMatmulPlugin::configurePlugin(const nvinfer1::DynamicPluginT
     mGemmId = {N, K, mType};
 
     m_workspaceMaxSize = m_weightOnlyGemmRunner->getWorkspaceSize(maxM, maxN, maxK);
+    if (mSwiGlu)
+    {
+        // Unless the fused batched GEMV is used, the gate and the up are written to the workspace before SwiGLU
+        std::vector<size_t> workspaces = {maxM * maxN * sizeof(half), m_workspaceMaxSize};
+        m_workspaceMaxSize = calculateTotalWorkspaceSize(workspaces.data(), workspaces.size());
+    }
 }
 
 size_t WeightOnlyQuantMatmulPlugin::getWorkspaceSize(const nvinfer1::PluginTensorDesc* inputs, int nbInputs,
@@ -285,7 +319,16 @@ int WeightOnlyQuantMatmulPlugin::enqueue(const nvinfer1::PluginTensorDesc* input
     const int n = inputDesc[1].dims.d[1];
     const int k = inputDesc[0].dims.d[inputDesc[0].dims.nbDims - 1];
 
-    const bool use_cuda_kernel = m < SMALL_M_FAST_PATH && mCudaKernelEnabled;
+    bool use_cuda_kernel = m < SMALL_M_FAST_PATH && mCudaKernelEnabled;
+    std::optional<WeightOnlyQuantGemmPluginProfiler::Config> bestTactic;
+    if (!use_cuda_kernel)
+    {
+        bestTactic = mPluginProfiler->getBestConfig(m, mGemmId);
+        // Beyond batch 4 the CUDA kernel is only used where it was measured faster than cutlass, or when the
+        // profiling was skipped.
+        use_cuda_kernel = mCudaKernelEnabled && m <= tensorrt_llm::kernels::kWeightOnlyBatchedGemvMaxM
+            && (!bestTactic || WeightOnlyQuantGemmPluginProfiler::isBatchedGemvTactic(*bestTactic));
+    }
 #if defined(ENABLE_BF16)
     TLLM_CHECK_WITH_INFO(mType == nvinfer1::DataType::kHALF || mType == nvinfer1::DataType::kBF16,
         "No valid weightOnlyQuantMatmul configuration");
@@ -314,13 +357,34 @@ int WeightOnlyQuantMatmulPlugin::enqueue(const nvinfer1::PluginTensorDesc* input
         weight_only_quant_type = tensorrt_llm::kernels::WeightOnlyQuantType::Int4b;
         real_n = n * INT8_INT4_RATIO;
     }
+    if (mSwiGlu && use_cuda_kernel && m <= tensorrt_llm::kernels::kWeightOnlyBatchedGemvMaxSwiGluM)
+    {
+        // The batched GEMV reads the gate and the up weights in one pass and writes silu(gate) * up
+        tensorrt_llm::kernels::WeightOnlyParams params{reinterpret_cast<const uint8_t*>(inputs[1]), inputs[2], nullptr,
+            inputs[0], nullptr, nullptr, outputs[0], m, real_n / 2, k, 0, weight_only_quant_type,
+            tensorrt_llm::kernels::WeightOnlyType::PerChannel,
+            tensorrt_llm::kernels::WeightOnlyActivationFunctionType::SwiGlu, weight_only_act_type};
+        tensorrt_llm::kernels::weight_only_batched_gemv_launcher(params, stream);
+        return 0;
+    }
+
+    // Otherwise, SwiGLU is applied to the gate and the up written to the workspace
+    void* gemm_out = outputs[0];
+    char* gemm_workspace = reinterpret_cast<char*>(workspace);
+    if (mSwiGlu)
+    {
+        gemm_out = workspace;
+        gemm_workspace = reinterpret_cast<char*>(
+            nextWorkspacePtr(reinterpret_cast<int8_t*>(workspace), static_cast<size_t>(m) * real_n * sizeof(half)));
+    }
+
     if (use_cuda_kernel)
     {
         // Use CUDA kernels for small batch size
         // The CUDA kernel is designed for ColumnMajorTileInterleave weight layout used in fpAIntB cutlass
         // kernel when sm >= 75 and the preprocessing of cutlass on sm70 does not interleave the weights.
         tensorrt_llm::kernels::WeightOnlyParams params{reinterpret_cast<const uint8_t*>(inputs[1]), inputs[2], nullptr,
-            inputs[0], nullptr, nullptr, outputs[0], m, real_n, k, 0, weight_only_quant_type,
+            inputs[0], nullptr, nullptr, gemm_out, m, real_n, k, 0, weight_only_quant_type,
             tensorrt_llm::kernels::WeightOnlyType::PerChannel,
             tensorrt_llm::kernels::WeightOnlyActivationFunctionType::Identity, weight_only_act_type};
         tensorrt_llm::kernels::weight_only_batched_gemv_launcher(params, stream);
@@ -329,14 +393,29 @@ int WeightOnlyQuantMatmulPlugin::enqueue(const nvinfer1::PluginTensorDesc* input
     {
         const int ws_size = m_weightOnlyGemmRunner->getWorkspaceSize(m, real_n, k);
 
-        const auto& bestTactic = mPluginProfiler->getBestConfig(m, mGemmId);
         TLLM_CHECK_WITH_INFO(bestTactic,
             "No valid weight only per-channel GEMM tactic(It is usually caused by the failure to execute all candidate "
             "configurations of the CUTLASS kernel, please pay attention to the warning information when building the "
             "engine.)");
 
-        m_weightOnlyGemmRunner->gemm(inputs[0], inputs[1], inputs[2], outputs[0], m, real_n, k, *bestTactic,
-            reinterpret_cast<char*>(workspace), ws_size, stream);
+        m_weightOnlyGemmRunner->gemm(inputs[0], inputs[1], inputs[2], gemm_out, m, real_n, k, *bestTactic,
+            gemm_workspace, ws_size, stream);
+    }
+
+    if (mSwiGlu)
+    {
+        if (mType == nvinfer1::DataType::kHALF)
+        {
+            tensorrt_llm::kernels::invokeSwiGlu(reinterpret_cast<half*>(outputs[0]),
+                reinterpret_cast<const half*>(gemm_out), m, real_n / 2, stream);
+        }
+#if defined(ENABLE_BF16)
+        else if (mType == nvinfer1::DataType::kBF16)
+        {
+            tensorrt_llm::kernels::invokeSwiGlu(reinterpret_cast<__nv_bfloat16*>(outputs[0]),
+                reinterpret_cast<const __nv_bfloat16*>(gemm_out), m, real_n / 2, stream);
+        }
+#endif
     }
 
     return 0;
@@ -379,6 +458,7 @@ size_t WeightOnlyQuantMatmulPlugin::getSerializationSize() const noexcept
 {
     return sizeof(mWeightTypeId) +                      // mWeightTypeId
         sizeof(nvinfer1::DataType) +                    // mType
+        sizeof(mSwiGlu) +                               // mSwiGlu
         sizeof(mDims) +                                 // Dimensions
         mPluginProfiler->getSerializationSize(mGemmId); // selected tactics container size
 }
@@ -388,6 +468,7 @@ void WeightOnlyQuantMatmulPlugin::serialize(void* buffer) const noexcept
     char *d = static_cast<char*>(buffer), *a = d;
     write(d, mType);
     write(d, mWeightTypeId);
+    write(d, mSwiGlu);
     write(d, mDims);
 
     mPluginProfiler->serialize(d, mGemmId);
@@ -408,6 +489,7 @@ WeightOnlyQuantMatmulPluginCreator::WeightOnlyQuantMatmulPluginCreator()
     mPluginAttributes.clear();
     mPluginAttributes.emplace_back(PluginField("type_id", nullptr, PluginFieldType::kINT32, 1));
     mPluginAttributes.emplace_back(PluginField("weight_type_id", nullptr, PluginFieldType::kINT32, 1));
+    mPluginAttributes.emplace_back(PluginField("swiglu", nullptr, PluginFieldType::kINT32, 1));
     mFC.nbFields = mPluginAttributes.size();
     mFC.fields = mPluginAttributes.data();
 }
@@ -432,6 +514,7 @@ IPluginV2* WeightOnlyQuantMatmulPluginCreator::createPlugin(const char* name, co
     const PluginField* fields = fc->fields;
     nvinfer1::DataType type;
     WeightTypeId weightTypeId;
+    bool swiGlu = false;
     // Read configurations from each fields
     for (int i = 0; i < fc->nbFields; ++i)
     {
@@ -446,13 +529,18 @@ IPluginV2* WeightOnlyQuantMatmulPluginCreator::createPlugin(const char* name, co
             TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
             type = static_cast<nvinfer1::DataType>(*(static_cast<const nvinfer1::DataType*>(fields[i].data)));
         }
+        else if (!strcmp(attrName, "swiglu"))
+        {
+            TLLM_CHECK(fields[i].type == PluginFieldType::kINT32);
+            swiGlu = static_cast<bool>(*(static_cast<const int*>(fields[i].data)));
+        }
     }
     try
     {
         // WeightOnlyGroupwiseQuantMatmulPluginCreator is unique and shared for an engine generation
         // Create plugin profiler with shared tactics map
         auto pluginProfiler = gemmPluginProfileManager.createGemmPluginProfiler(/* inference */ false);
-        auto* obj = new WeightOnlyQuantMatmulPlugin(type, weightTypeId, pluginProfiler);
+        auto* obj = new WeightOnlyQuantMatmulPlugin(type, weightTypeId, swiGlu, pluginProfiler);
         obj->setPluginNamespace(mNamespace.c_str());
         return obj;
     }
@@ -18,6 +18,7 @@
 
 #include "tensorrt_llm/common/quantization.h"
 #include "tensorrt_llm/kernels/cutlass_kernels/fpA_intB_gemm/fpA_intB_gemm.h"
+#include "tensorrt_llm/kernels/gatedActivationKernels.h"
 #include "tensorrt_llm/kernels/weightOnlyBatchedGemv/kernelLauncher.h"
 #include "tensorrt_llm/plugins/common/gemmPluginProfiler.h"
 #include "tensorrt_llm/plugins/common/plugin.h"
@@ -64,6 +65,25 @@ public:
         mWeightTypeId = weightId;
     }
 
+    void setCudaKernelEnabled(bool enabled)
+    {
+        mCudaKernelEnabled = enabled;
+    }
+
+    // The batched GEMV CUDA kernel competes with the CUTLASS configs up to kWeightOnlyBatchedGemvMaxM rows, so the
+    // crossover between the two is measured. It is stored as a config with an undefined tile.
+    static Config getBatchedGemvTactic()
+    {
+        Config config;
+        config.tile_config = tensorrt_llm::cutlass_extensions::CutlassTileConfig::Undefined;
+        return config;
+    }
+
+    static bool isBatchedGemvTactic(const Config& config)
+    {
+        return config.tile_config == tensorrt_llm::cutlass_extensions::CutlassTileConfig::Undefined;
+    }
+
 protected:
     void runTactic(int m, int n, int k, const Config& tactic, char* workspace, const cudaStream_t& stream) override;
 
@@ -71,8 +91,15 @@ protected:
 
     std::vector<Config> getTactics(int m, int n, int k) const override;
 
+    std::string getCacheTag() const override
+    {
+        return "weight=" + std::to_string(static_cast<int>(mWeightTypeId))
+            + ",gemv=" + std::to_string(mCudaKernelEnabled);
+    }
+
 private:
     WeightTypeId mWeightTypeId;
+    bool mCudaKernelEnabled{false};
 };
 
 class WeightOnlyQuantMatmulPlugin : public BasePlugin
@@ -81,7 +108,8 @@ public:
     using PluginProfilerPtr = std::shared_ptr<WeightOnlyQuantGemmPluginProfiler>;
     WeightOnlyQuantMatmulPlugin() = delete;
 
-    WeightOnlyQuantMatmulPlugin(nvinfer1::DataType type, WeightTypeId weightTypeId, const PluginProfilerPtr& profiler);
+    WeightOnlyQuantMatmulPlugin(
+        nvinfer1::DataType type, WeightTypeId weightTypeId, bool swiGlu, const PluginProfilerPtr& profiler);
 
     WeightOnlyQuantMatmulPlugin(const void* data, size_t length, const PluginProfilerPtr& profiler);
 
@@ -115,7 +143,7 @@ public:
     void destroy() noexcept override;
 
 private:
-    void init(nvinfer1::DataType type, WeightTypeId weightTypeId);
+    void init(nvinfer1::DataType type, WeightTypeId weightTypeId, bool swiGlu);
 
     void configGemm();
 
@@ -127,9 +155,12 @@ private:
     nvinfer1::DataType mType;
     WeightTypeId mWeightTypeId;
     bool mCudaKernelEnabled;
+    // The weights hold the gate columns followed by the up columns and the output is silu(gate) * up
+    bool mSwiGlu;
 
     // When M is smaller than this value, we trigger a fast path
     // I.e. a tailored kernel instead of cutlass.
+    // Up to kWeightOnlyBatchedGemvMaxM, the tailored kernel is used where the profiler found it faster than cutlass.
     static constexpr int SMALL_M_FAST_PATH = 5;
 
     GemmDims mDims{};
@@ -19,7 +19,9 @@
 #include "namedTensor.h"
 #include "tensorrt_llm/batch_manager/GptManager.h"
 #include "tensorrt_llm/batch_manager/callbacks.h"
+#include "tensorrt_llm/common/assert.h"
 #include "tensorrt_llm/pybind/utils/pathCaster.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
 
 #include <pybind11/functional.h>
 #include <pybind11/operators.h>
@@ -29,10 +31,14 @@
 #include <ATen/ATen.h>
 
 #include <ATen/ops/tensor.h>
+#include <algorithm>
+#include <cstring>
 #include <memory>
 #include <optional>
+#include <unordered_set>
 
 namespace tb = tensorrt_llm::batch_manager;
+namespace tr = tensorrt_llm::runtime;
 
 namespace tensorrt_llm::pybind::batch_manager
 {
@@ -41,9 +47,30 @@ GptManager::GptManager(std::filesystem::path const& trtEnginePath, tb::TrtGptMod
     tb::batch_scheduler::SchedulerPolicy schedulerPolicy, GetInferenceRequestsCallback getInferenceRequestsCb,
     SendResponseCallback sendResponseCb, tb::PollStopSignalCallback pollStopSignalCb,
     tb::ReturnBatchManagerStatsCallback returnBatchManagerStatsCb, const tb::TrtGptModelOptionalParams& optionalParams,
-    std::optional<uint64_t> terminateReqId)
-    : tb::GptManager(trtEnginePath, modelType, maxBeamWidth, schedulerPolicy, callbackAdapter(getInferenceRequestsCb),
-        callbackAdapter(sendResponseCb), pollStopSignalCb, returnBatchManagerStatsCb, optionalParams, terminateReqId)
+    std::optional<uint64_t> terminateReqId, SendResponsesCallback sendResponsesCb,
+    std::optional<std::filesystem::path> const& tokenizerPath,
+    std::optional<std::filesystem::path> const& traceFilePath)
+    : GptManager(trtEnginePath, modelType, maxBeamWidth, schedulerPolicy, std::move(getInferenceRequestsCb),
+        std::move(sendResponseCb), std::move(pollStopSignalCb), std::move(returnBatchManagerStatsCb), optionalParams,
+        terminateReqId, std::make_shared<RequestQueue>(), std::make_shared<ResponseText>(tokenizerPath),
+        std::make_shared<ResponseTimeline>(traceFilePath), std::make_shared<ResponseBatch>(std::move(sendResponsesCb)))
+{
+}
+
+GptManager::GptManager(std::filesystem::path const& trtEnginePath, tb::TrtGptModelType modelType, int32_t maxBeamWidth,
+    tb::batch_scheduler::SchedulerPolicy schedulerPolicy, GetInferenceRequestsCallback getInferenceRequestsCb,
+    SendResponseCallback sendResponseCb, tb::PollStopSignalCallback pollStopSignalCb,
+    tb::ReturnBatchManagerStatsCallback returnBatchManagerStatsCb, const tb::TrtGptModelOptionalParams& optionalParams,
+    std::optional<uint64_t> terminateReqId, std::shared_ptr<RequestQueue> requests, std::shared_ptr<ResponseText> text,
+    std::shared_ptr<ResponseTimeline> timeline, std::shared_ptr<ResponseBatch> responses)
+    : tb::GptManager(trtEnginePath, modelType, maxBeamWidth, schedulerPolicy,
+        callbackAdapter(getInferenceRequestsCb, requests, text, timeline, responses),
+        callbackAdapter(sendResponseCb, text, timeline, responses),
+        callbackAdapter(pollStopSignalCb, requests, responses), returnBatchManagerStatsCb, optionalParams,
+        terminateReqId)
+    , mRequests{std::move(requests)}
+    , mTimeline{std::move(timeline)}
+    , mResponses{std::move(responses)}
 {
 }
 
@@ -61,32 +88,332 @@ void GptManager::exit(py::handle type, py::handle value, py::handle traceback)
     shutdown();
 }
 
-tb::GetInferenceRequestsCallback callbackAdapter(GetInferenceRequestsCallback callback)
+tb::BatchManagerErrorCode_t GptManager::shutdown()
+{
+    auto const status = tb::GptManager::shutdown();
+    // The loop has stopped, nothing is pushed anymore
+    mResponses->flush();
+    return status;
+}
+
+void GptManager::enqueue(InferenceRequest const& request)
+{
+    auto trtLlmRequest = request.toTrtLlm();
+    // Arrives now, not when the execution loop fetches it
+    mTimeline->addRequest(*trtLlmRequest);
+    mRequests->push(std::move(trtLlmRequest));
+}
+
+void GptManager::stopRequest(uint64_t requestId)
+{
+    mRequests->stop(requestId);
+}
+
+std::vector<Response> GptManager::pollResponses()
+{
+    return mResponses->pop();
+}
+
+void RequestQueue::push(std::shared_ptr<tb::InferenceRequest> request)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRequests.push_back(std::move(request));
+}
+
+void RequestQueue::stop(uint64_t id)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopped.insert(id);
+}
+
+std::list<std::shared_ptr<tb::InferenceRequest>> RequestQueue::pop(int32_t maxSequences)
+{
+    std::list<std::shared_ptr<tb::InferenceRequest>> requests;
+    std::lock_guard<std::mutex> lock(mMutex);
+    while (!mRequests.empty() && static_cast<int32_t>(requests.size()) < maxSequences)
+    {
+        requests.push_back(std::move(mRequests.front()));
+        mRequests.pop_front();
+    }
+    return requests;
+}
+
+std::unordered_set<uint64_t> RequestQueue::popStopped()
+{
+    std::unordered_set<uint64_t> stopped;
+    std::lock_guard<std::mutex> lock(mMutex);
+    stopped.swap(mStopped);
+    return stopped;
+}
+
+ResponseText::ResponseText(std::optional<std::filesystem::path> const& tokenizerPath)
+{
+    if (tokenizerPath)
+    {
+        mDetokenizer = tr::Detokenizer::parse(*tokenizerPath);
+    }
+}
+
+void ResponseText::addRequest(tb::InferenceRequest const& request)
 {
-    return [callback](int32_t max_sequences)
+    if (!isEnabled())
+    {
+        return;
+    }
+    auto const inputLength = static_cast<tr::SizeType>(request.getInputIds()->getSize());
+    mRequests[request.getRequestId()] = Request{inputLength, request.isStreaming(), {}};
+}
+
+void ResponseText::decode(uint64_t id, std::list<tb::NamedTensor>& tensors, bool isFinal)
+{
+    auto const it = mRequests.find(id);
+    if (it == mRequests.end())
+    {
+        return;
+    }
+    auto& request = it->second;
+
+    tr::ITensor::SharedPtr outputIds;
+    tr::ITensor::SharedPtr sequenceLengths;
+    for (auto const& tensor : tensors)
     {
-        std::list<InferenceRequest> pythonResults = callback(max_sequences);
-        std::list<std::shared_ptr<tb::InferenceRequest>> cppResults{};
+        if (tensor.name == tb::inference_request::kOutputIdsTensorName)
+        {
+            outputIds = tensor.tensor;
+        }
+        else if (tensor.name == tb::inference_request::kSequenceLengthTensorName)
+        {
+            sequenceLengths = tensor.tensor;
+        }
+    }
+    if (outputIds && sequenceLengths)
+    {
+        TLLM_CHECK_WITH_INFO(outputIds->getMemoryType() != tr::MemoryType::kGPU
+                && sequenceLengths->getMemoryType() != tr::MemoryType::kGPU,
+            "The output ids are expected on the host");
+        // [1, beamWidth, maxLength], the new tokens of a streamed response, the input and the output otherwise
+        auto const& shape = outputIds->getShape();
+        auto const beamWidth = static_cast<tr::SizeType>(shape.d[1]);
+        auto const maxLength = static_cast<tr::SizeType>(shape.d[2]);
+        auto const* ids = tr::bufferCast<tr::TokenIdType>(*outputIds);
+        auto const* lengths = tr::bufferCast<tr::SizeType>(*sequenceLengths);
+
+        request.beams.resize(beamWidth);
+        std::vector<std::string> texts(beamWidth);
+        std::size_t maxTextLength = 0;
+        for (tr::SizeType beam = 0; beam < beamWidth; ++beam)
+        {
+            auto const begin = request.streaming ? 0 : std::min(request.inputLength, maxLength);
+            auto const end = std::max(begin, std::min(lengths[beam], maxLength));
+            auto& stream = request.beams[beam];
+            texts[beam] = mDetokenizer->decode(stream, ids + beam * maxLength + begin, end - begin);
+            if (isFinal)
+            {
+                texts[beam] += mDetokenizer->finish(stream);
+            }
+            maxTextLength = std::max(maxTextLength, texts[beam].size());
+        }
 
-        for (const auto& ir : pythonResults)
+        auto text = tr::BufferManager::cpu(
+            tr::ITensor::makeShape({beamWidth, static_cast<tr::SizeType>(maxTextLength)}), nvinfer1::DataType::kUINT8);
+        auto* data = tr::bufferCast<std::uint8_t>(*text);
+        std::memset(data, 0, text->getSizeInBytes());
+        for (tr::SizeType beam = 0; beam < beamWidth; ++beam)
         {
-            cppResults.push_back(ir.toTrtLlm());
+            std::memcpy(data + beam * maxTextLength, texts[beam].data(), texts[beam].size());
         }
+        tensors.emplace_back(std::move(text), kOutputTextTensorName);
+    }
+
+    if (isFinal)
+    {
+        mRequests.erase(it);
+    }
+}
 
+namespace
+{
+
+// The value of a host tensor of one element, if the request sets it
+template <typename T>
+std::optional<T> getHostValue(tr::ITensor::SharedPtr const& tensor)
+{
+    if (!tensor || tensor->getDataType() != tr::TRTDataType<T>::value || tensor->getMemoryType() == tr::MemoryType::kGPU
+        || tensor->getSize() == 0)
+    {
+        return std::nullopt;
+    }
+    return *tr::bufferCast<T>(*tensor);
+}
+
+} // namespace
+
+ResponseTimeline::ResponseTimeline(std::optional<std::filesystem::path> const& traceFilePath)
+{
+    if (traceFilePath)
+    {
+        mTracer = std::make_unique<tb::RequestTracer>(tb::RequestTracer::fileExporter(traceFilePath->string()));
+    }
+}
+
+void ResponseTimeline::addRequest(tb::InferenceRequest const& request)
+{
+    auto const id = request.getRequestId();
+    auto tracked = false;
+    if (getHostValue<bool>(request.getReturnTimelineUnchecked()).value_or(false))
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mReturnTimeline.insert(id);
+        tracked = true;
+    }
+    if (auto const traceContext = request.getTraceContextUnchecked();
+        mTracer && traceContext && traceContext->getMemoryType() != tr::MemoryType::kGPU)
+    {
+        if (auto const context = tb::TraceContext::fromTensor(*traceContext))
+        {
+            auto const promptLen = static_cast<std::int64_t>(request.getInputIds()->getSize());
+            auto const beamWidth = getHostValue<std::int32_t>(request.getBeamWidthUnchecked()).value_or(1);
+            tracked |= mTracer->startRequest(id, *context, promptLen, beamWidth);
+        }
+    }
+    if (tracked)
+    {
+        mTimelines.add(id);
+    }
+}
+
+void ResponseTimeline::recordScheduled(uint64_t id)
+{
+    mTimelines.recordScheduled(id);
+}
+
+void ResponseTimeline::addTimeline(
+    uint64_t id, std::list<tb::NamedTensor>& tensors, bool isFinal, std::string const& errMsg)
+{
+    mTimelines.recordResponse(id, isFinal);
+    if (!isFinal)
+    {
+        return;
+    }
+    auto const timeline = mTimelines.take(id);
+    if (!timeline)
+    {
+        return;
+    }
+    if (mTracer)
+    {
+        mTracer->endRequest(id, *timeline, !errMsg.empty());
+    }
+    auto returnTimeline = false;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        returnTimeline = mReturnTimeline.erase(id) > 0;
+    }
+    if (returnTimeline)
+    {
+        tensors.emplace_back(timeline->toTensor(), tb::inference_request::kRequestTimelineTensorName);
+    }
+}
+
+void ResponseBatch::push(uint64_t id, std::list<tb::NamedTensor> const& tensors, bool isOk, std::string const& errMsg)
+{
+    std::list<NamedTensor> pythonList{};
+    for (const auto& cppNamedTensor : tensors)
+    {
+        pythonList.push_back(NamedTensor{cppNamedTensor});
+    }
+    std::lock_guard<std::mutex> lock(mMutex);
+    mResponses.emplace_back(id, std::move(pythonList), isOk, errMsg);
+}
+
+void ResponseBatch::flush()
+{
+    if (!mCallback)
+    {
+        return;
+    }
+    auto const responses = pop();
+    if (!responses.empty())
+    {
+        py::gil_scoped_acquire acquire;
+        mCallback(responses);
+    }
+}
+
+std::vector<Response> ResponseBatch::pop()
+{
+    std::vector<Response> responses;
+    std::lock_guard<std::mutex> lock(mMutex);
+    responses.swap(mResponses);
+    return responses;
+}
+
+tb::GetInferenceRequestsCallback callbackAdapter(GetInferenceRequestsCallback callback,
+    std::shared_ptr<RequestQueue> requests, std::shared_ptr<ResponseText> text,
+    std::shared_ptr<ResponseTimeline> timeline, std::shared_ptr<ResponseBatch> responses)
+{
+    return [callback, requests, text, timeline, responses](int32_t max_sequences)
+    {
+        // The responses of the previous iteration, if the stop signal was not polled after them
+        responses->flush();
+        auto cppResults = requests->pop(max_sequences);
+        auto const remaining = max_sequences - static_cast<int32_t>(cppResults.size());
+        if (callback && remaining > 0)
+        {
+            std::list<InferenceRequest> pythonResults = callback(remaining);
+            for (const auto& ir : pythonResults)
+            {
+                cppResults.push_back(ir.toTrtLlm());
+                timeline->addRequest(*cppResults.back());
+            }
+        }
+
+        for (auto const& ir : cppResults)
+        {
+            text->addRequest(*ir);
+            timeline->recordScheduled(ir->getRequestId());
+        }
         return cppResults;
     };
 }
 
-tb::SendResponseCallback callbackAdapter(SendResponseCallback callback)
+tb::SendResponseCallback callbackAdapter(SendResponseCallback callback, std::shared_ptr<ResponseText> text,
+    std::shared_ptr<ResponseTimeline> timeline, std::shared_ptr<ResponseBatch> responses)
 {
-    return [callback](uint64_t id, std::list<tb::NamedTensor> const& cppTensors, bool isOk, const std::string& errMsg)
+    return [callback, text, timeline, responses](
+               uint64_t id, std::list<tb::NamedTensor> const& responseTensors, bool isFinal, const std::string& errMsg)
     {
+        auto cppTensors = responseTensors;
+        text->decode(id, cppTensors, isFinal);
+        timeline->addTimeline(id, cppTensors, isFinal, errMsg);
+        // Sent in a batch or polled
+        if (responses->isEnabled() || !callback)
+        {
+            responses->push(id, cppTensors, isFinal, errMsg);
+            return;
+        }
         std::list<NamedTensor> pythonList{};
         for (const auto& cppNamedTensor : cppTensors)
         {
             pythonList.push_back(NamedTensor{cppNamedTensor});
         }
-        callback(id, pythonList, isOk, errMsg);
+        callback(id, pythonList, isFinal, errMsg);
+    };
+}
+
+tb::PollStopSignalCallback callbackAdapter(tb::PollStopSignalCallback callback,
+    std::shared_ptr<RequestQueue> requests, std::shared_ptr<ResponseBatch> responses)
+{
+    // Polled at the end of each iteration, after its responses
+    return [callback, requests, responses]()
+    {
+        responses->flush();
+        auto stopped = requests->popStopped();
+        if (callback)
+        {
+            stopped.merge(callback());
+        }
+        return stopped;
     };
 }
 
@@ -95,12 +422,16 @@ void GptManager::initBindings(py::module_& m)
     py::class_<GptManager>(m, "GptManager")
         .def(py::init<std::filesystem::path const&, tb::TrtGptModelType, int32_t, tb::batch_scheduler::SchedulerPolicy,
                  GetInferenceRequestsCallback, SendResponseCallback, tb::PollStopSignalCallback,
-                 tb::ReturnBatchManagerStatsCallback, const tb::TrtGptModelOptionalParams&, std::optional<uint64_t>>(),
+                 tb::ReturnBatchManagerStatsCallback, const tb::TrtGptModelOptionalParams&, std::optional<uint64_t>,
+                 SendResponsesCallback, std::optional<std::filesystem::path> const&,
+                 std::optional<std::filesystem::path> const&>(),
             py::arg("trt_engine_path"), py::arg("model_type"), py::arg("max_beam_width"), py::arg("scheduler_policy"),
-            py::arg("get_inference_requests_cb"), py::arg("send_response_cb"), py::arg("poll_stop_signal_cb") = nullptr,
+            py::arg("get_inference_requests_cb") = nullptr, py::arg("send_response_cb") = nullptr,
+            py::arg("poll_stop_signal_cb") = nullptr,
             py::arg("return_batch_manager_stats_cb") = nullptr,
             py::arg_v("optional_params", tb::TrtGptModelOptionalParams(), "TrtGptModelOptionalParams"),
-            py::arg("terminate_req_id") = std::nullopt)
+            py::arg("terminate_req_id") = std::nullopt, py::arg("send_responses_cb") = nullptr,
+            py::arg("tokenizer_path") = std::nullopt, py::arg("trace_file") = std::nullopt)
 
         // Note: attempting to bind &GptManager::shutdown() will result in a compiler error:
         //
@@ -112,7 +443,10 @@ void GptManager::initBindings(py::module_& m)
         // To resolve, we can add something like:
         //
         //  py::class_<tensorrt_llm::batch_manager::GptManager>(m, "_GptManagerBase");
-        .def("shutdown", [](GptManager& self) { self.shutdown(); })
+        .def("shutdown", [](GptManager& self) { self.shutdown(); }, py::call_guard<py::gil_scoped_release>())
+        .def("enqueue", &GptManager::enqueue, py::arg("request"))
+        .def("stop_request", &GptManager::stopRequest, py::arg("request_id"))
+        .def("poll_responses", &GptManager::pollResponses)
         .def("__enter__", &GptManager::enter)
         .def("__exit__", &GptManager::exit);
 }
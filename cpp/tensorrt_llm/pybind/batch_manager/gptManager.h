@@ -20,36 +20,192 @@
 #include "namedTensor.h"
 #include "tensorrt_llm/batch_manager/GptManager.h"
 #include "tensorrt_llm/batch_manager/callbacks.h"
+#include "tensorrt_llm/batch_manager/requestTimeline.h"
+#include "tensorrt_llm/batch_manager/requestTracer.h"
+#include "tensorrt_llm/runtime/detokenizer.h"
 #include <pybind11/functional.h>
 
 #include <ATen/ops/tensor.h>
+#include <deque>
+#include <filesystem>
 #include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace tensorrt_llm::pybind::batch_manager
 {
 
 using GetInferenceRequestsCallback = std::function<std::list<InferenceRequest>(int32_t)>;
 using SendResponseCallback = std::function<void(uint64_t, std::list<NamedTensor> const&, bool, const std::string&)>;
+// The arguments of SendResponseCallback for each response
+using Response = std::tuple<uint64_t, std::list<NamedTensor>, bool, std::string>;
+using SendResponsesCallback = std::function<void(std::vector<Response> const&)>;
 
-tensorrt_llm::batch_manager::GetInferenceRequestsCallback callbackAdapter(GetInferenceRequestsCallback callback);
-tensorrt_llm::batch_manager::SendResponseCallback callbackAdapter(SendResponseCallback callback);
+// Queues the responses of an iteration without the GIL, then sends them to SendResponsesCallback in one call, so the
+// GIL is taken once per iteration instead of once per response. The tensors are views of the ones of the batch
+// manager, without copies.
+class ResponseBatch
+{
+public:
+    explicit ResponseBatch(SendResponsesCallback callback)
+        : mCallback{std::move(callback)}
+    {
+    }
+
+    [[nodiscard]] bool isEnabled() const
+    {
+        return static_cast<bool>(mCallback);
+    }
+
+    void push(uint64_t id, std::list<tensorrt_llm::batch_manager::NamedTensor> const& tensors, bool isOk,
+        std::string const& errMsg);
+
+    // Sends the queued responses, takes the GIL only if there are some
+    void flush();
+
+    // Returns the queued responses, when there is no SendResponsesCallback to send them to
+    std::vector<Response> pop();
+
+private:
+    SendResponsesCallback mCallback;
+    std::mutex mMutex;
+    std::vector<Response> mResponses;
+};
+
+// Requests and stop signals enqueued from Python, which the execution loop reads without the GIL.
+class RequestQueue
+{
+public:
+    void push(std::shared_ptr<tensorrt_llm::batch_manager::InferenceRequest> request);
+
+    void stop(uint64_t id);
+
+    std::list<std::shared_ptr<tensorrt_llm::batch_manager::InferenceRequest>> pop(int32_t maxSequences);
+
+    std::unordered_set<uint64_t> popStopped();
+
+private:
+    std::mutex mMutex;
+    std::deque<std::shared_ptr<tensorrt_llm::batch_manager::InferenceRequest>> mRequests;
+    std::unordered_set<uint64_t> mStopped;
+};
+
+// [beamWidth, maxTextLength] (uint8), the UTF-8 text of the output ids of each beam, padded with zeros
+auto constexpr kOutputTextTensorName = "output_text";
+
+// Adds the text of the output ids to the responses, when GptManager is given a tokenizer.json. The text is decoded by
+// the execution loop without the GIL, and a streamed response holds the text of its new tokens.
+class ResponseText
+{
+public:
+    explicit ResponseText(std::optional<std::filesystem::path> const& tokenizerPath);
+
+    [[nodiscard]] bool isEnabled() const
+    {
+        return mDetokenizer.has_value();
+    }
+
+    void addRequest(tensorrt_llm::batch_manager::InferenceRequest const& request);
+
+    void decode(uint64_t id, std::list<tensorrt_llm::batch_manager::NamedTensor>& tensors, bool isFinal);
+
+private:
+    struct Request
+    {
+        runtime::SizeType inputLength;
+        bool streaming;
+        std::vector<runtime::Detokenizer::Stream> beams;
+    };
+
+    std::optional<runtime::Detokenizer> mDetokenizer;
+    // Only used by the execution loop
+    std::unordered_map<uint64_t, Request> mRequests;
+};
+
+// Adds the request_timeline tensor to the final response of the requests that set return_timeline, and records the
+// spans of the requests that carry a sampled trace_context when GptManager is given a trace file. The batch manager
+// is prebuilt, so the timelines and the trace contexts are kept apart from its requests and the events are the ones
+// seen by the callbacks: the arrival of the request, its handover to the batch manager, its first response and its
+// final response.
+class ResponseTimeline
+{
+public:
+    explicit ResponseTimeline(std::optional<std::filesystem::path> const& traceFilePath);
+
+    // Starts the timeline of a request that sets return_timeline or is traced, does nothing for the others
+    void addRequest(tensorrt_llm::batch_manager::InferenceRequest const& request);
+
+    void recordScheduled(uint64_t id);
+
+    void addTimeline(uint64_t id, std::list<tensorrt_llm::batch_manager::NamedTensor>& tensors, bool isFinal,
+        std::string const& errMsg);
+
+private:
+    std::unique_ptr<tensorrt_llm::batch_manager::RequestTracer> mTracer;
+    tensorrt_llm::batch_manager::RequestTimelines mTimelines;
+    std::mutex mMutex;
+    // The requests that set return_timeline
+    std::unordered_set<uint64_t> mReturnTimeline;
+};
+
+tensorrt_llm::batch_manager::GetInferenceRequestsCallback callbackAdapter(GetInferenceRequestsCallback callback,
+    std::shared_ptr<RequestQueue> requests, std::shared_ptr<ResponseText> text,
+    std::shared_ptr<ResponseTimeline> timeline, std::shared_ptr<ResponseBatch> responses);
+tensorrt_llm::batch_manager::SendResponseCallback callbackAdapter(SendResponseCallback callback,
+    std::shared_ptr<ResponseText> text, std::shared_ptr<ResponseTimeline> timeline,
+    std::shared_ptr<ResponseBatch> responses);
+tensorrt_llm::batch_manager::PollStopSignalCallback callbackAdapter(
+    tensorrt_llm::batch_manager::PollStopSignalCallback callback, std::shared_ptr<RequestQueue> requests,
+    std::shared_ptr<ResponseBatch> responses);
 
 class GptManager : tensorrt_llm::batch_manager::GptManager
 {
 public:
     GptManager(std::filesystem::path const& trtEnginePath, tensorrt_llm::batch_manager::TrtGptModelType modelType,
         int32_t maxBeamWidth, tensorrt_llm::batch_manager::batch_scheduler::SchedulerPolicy schedulerPolicy,
-        GetInferenceRequestsCallback getInferenceRequestsCb, SendResponseCallback sendResponseCb,
+        GetInferenceRequestsCallback getInferenceRequestsCb = nullptr, SendResponseCallback sendResponseCb = nullptr,
         tensorrt_llm::batch_manager::PollStopSignalCallback pollStopSignalCb = nullptr,
         tensorrt_llm::batch_manager::ReturnBatchManagerStatsCallback returnBatchManagerStatsCb = nullptr,
         const tensorrt_llm::batch_manager::TrtGptModelOptionalParams& optionalParams
         = tensorrt_llm::batch_manager::TrtGptModelOptionalParams(),
-        std::optional<uint64_t> terminateReqId = std::nullopt);
+        std::optional<uint64_t> terminateReqId = std::nullopt, SendResponsesCallback sendResponsesCb = nullptr,
+        std::optional<std::filesystem::path> const& tokenizerPath = std::nullopt,
+        std::optional<std::filesystem::path> const& traceFilePath = std::nullopt);
 
     pybind11::object enter();
     void exit(pybind11::handle type, pybind11::handle value, pybind11::handle traceback);
+    // Shuts down the execution loop, then sends its last responses
+    tensorrt_llm::batch_manager::BatchManagerErrorCode_t shutdown();
+
+    // The enqueued requests are fetched before the ones of GetInferenceRequestsCallback, and the responses are polled
+    // when there is no callback to send them to. Without Python callbacks, the execution loop never takes the GIL.
+    void enqueue(InferenceRequest const& request);
+    void stopRequest(uint64_t requestId);
+    std::vector<Response> pollResponses();
 
     static void initBindings(pybind11::module_& m);
+
+private:
+    GptManager(std::filesystem::path const& trtEnginePath, tensorrt_llm::batch_manager::TrtGptModelType modelType,
+        int32_t maxBeamWidth, tensorrt_llm::batch_manager::batch_scheduler::SchedulerPolicy schedulerPolicy,
+        GetInferenceRequestsCallback getInferenceRequestsCb, SendResponseCallback sendResponseCb,
+        tensorrt_llm::batch_manager::PollStopSignalCallback pollStopSignalCb,
+        tensorrt_llm::batch_manager::ReturnBatchManagerStatsCallback returnBatchManagerStatsCb,
+        const tensorrt_llm::batch_manager::TrtGptModelOptionalParams& optionalParams,
+        std::optional<uint64_t> terminateReqId, std::shared_ptr<RequestQueue> requests,
+        std::shared_ptr<ResponseText> text, std::shared_ptr<ResponseTimeline> timeline,
+        std::shared_ptr<ResponseBatch> responses);
+
+    std::shared_ptr<RequestQueue> mRequests;
+    std::shared_ptr<ResponseTimeline> mTimeline;
+    std::shared_ptr<ResponseBatch> mResponses;
 };
 
 } // namespace tensorrt_llm::pybind::batch_manager
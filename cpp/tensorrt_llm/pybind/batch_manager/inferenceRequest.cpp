@@ -91,6 +91,10 @@ void InferenceRequest::initBindings(py::module_& m)
         .def_property("random_seed", &InferenceRequest::getRandomSeedUnchecked, &InferenceRequest::setRandomSeed)
         .def_property(
             "return_log_probs", &InferenceRequest::getReturnLogProbsUnchecked, &InferenceRequest::setReturnLogProbs)
+        .def_property(
+            "return_timeline", &InferenceRequest::getReturnTimelineUnchecked, &InferenceRequest::setReturnTimeline)
+        .def_property(
+            "trace_context", &InferenceRequest::getTraceContextUnchecked, &InferenceRequest::setTraceContext)
         .def_property("prompt_embedding_table", &InferenceRequest::getPromptEmbeddingTableUnchecked,
             &InferenceRequest::setPromptEmbeddingTable)
         .def_property(
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "kvCacheManager.h"
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/samplingConfig.h"
+#include "tensorrt_llm/runtime/torch.h"
+#include "tensorrt_llm/runtime/torchView.h"
+
+#include <pybind11/stl.h>
+#include <torch/extension.h>
+
+#include <c10/cuda/CUDAFunctions.h>
+#include <c10/cuda/CUDAStream.h>
+
+namespace tb = tensorrt_llm::batch_manager;
+namespace tbk = tensorrt_llm::batch_manager::kv_cache_manager;
+namespace tr = tensorrt_llm::runtime;
+namespace py = pybind11;
+
+namespace tensorrt_llm::pybind::batch_manager
+{
+
+KVCacheManager::KVCacheManager(SizeType numLayers, SizeType numHeads, SizeType numKvHeads, SizeType hiddenSize,
+    SizeType tokensPerBlock, SizeType maxNumBlocks, SizeType maxNumSequences, SizeType maxBeamWidth,
+    SizeType maxBlocksPerSeq, SizeType maxAttentionWindow, nvinfer1::DataType dtype, bool enableBlockReuse)
+{
+    // The pools are allocated and the blocks copied on the stream of the Python runtime, which owns it
+    auto stream = std::make_shared<tr::CudaStream>(
+        at::cuda::getCurrentCUDAStream().stream(), static_cast<int>(c10::cuda::current_device()), false);
+    mManager = std::make_shared<tbk::KVCacheManager>(numLayers, numHeads, numKvHeads, hiddenSize, tokensPerBlock,
+        maxNumBlocks, maxNumSequences, maxBeamWidth, maxBlocksPerSeq, maxAttentionWindow, dtype, std::move(stream),
+        enableBlockReuse);
+}
+
+void KVCacheManager::addSequence(
+    SizeType seqSlotIdx, SizeType inputLength, SizeType beamWidth, std::optional<VecTokens> const& inputTokens)
+{
+    TLLM_CHECK_WITH_INFO(mRequests.find(seqSlotIdx) == mRequests.end(), "Sequence slot %d is in use", seqSlotIdx);
+    std::shared_ptr<tb::LlmRequest> llmRequest;
+    if (inputTokens && mManager->isEnableBlockReuse())
+    {
+        TLLM_CHECK_WITH_INFO(static_cast<SizeType>(inputTokens->size()) == inputLength,
+            "Got %zu input tokens for an input length of %d", inputTokens->size(), inputLength);
+        llmRequest = std::make_shared<tb::LlmRequest>(mNextRequestId++, 1,
+            std::make_shared<VecTokens>(*inputTokens), tr::SamplingConfig{beamWidth}, false);
+    }
+    mManager->addSequence(seqSlotIdx, inputLength, beamWidth, llmRequest);
+    mRequests.emplace(seqSlotIdx, std::move(llmRequest));
+}
+
+void KVCacheManager::addToken(SizeType seqSlotIdx)
+{
+    mManager->addToken(seqSlotIdx);
+}
+
+void KVCacheManager::removeSequence(SizeType seqSlotIdx)
+{
+    auto const it = mRequests.find(seqSlotIdx);
+    TLLM_CHECK_WITH_INFO(it != mRequests.end(), "Sequence slot %d is not in use", seqSlotIdx);
+    mManager->removeSequence(seqSlotIdx, it->second);
+    mRequests.erase(it);
+}
+
+void KVCacheManager::getBlockPointersOfBatch(
+    at::Tensor const& pointers, SizeType firstSeqSlotIdx, SizeType batchSize, SizeType beamWidth) const
+{
+    TLLM_CHECK_WITH_INFO(pointers.device().is_cpu() && pointers.scalar_type() == at::ScalarType::Long,
+        "The block pointers must be a host int64 tensor");
+    TLLM_CHECK_WITH_INFO(pointers.is_contiguous() && pointers.dim() == 4 && pointers.size(1) == batchSize * beamWidth,
+        "The block pointers must be a contiguous tensor of [numLayers, batchSize * beamWidth, 2, maxBlocksPerSeq]");
+    auto view = tr::TorchView::of(pointers);
+    mManager->getBlockPointersOfBatch(*view, firstSeqSlotIdx, batchSize, beamWidth);
+}
+
+std::vector<at::Tensor> KVCacheManager::getMemoryPools() const
+{
+    std::vector<at::Tensor> pools;
+    for (auto const& pool : mManager->getMemoryPools())
+    {
+        pools.push_back(tr::Torch::tensor(pool));
+    }
+    return pools;
+}
+
+void KVCacheManager::initBindings(py::module_& m)
+{
+    py::class_<tbk::KvCacheStats>(m, "KvCacheStats")
+        .def_readonly("max_num_blocks", &tbk::KvCacheStats::maxNumBlocks)
+        .def_readonly("free_num_blocks", &tbk::KvCacheStats::freeNumBlocks)
+        .def_readonly("used_num_blocks", &tbk::KvCacheStats::usedNumBlocks)
+        .def_readonly("tokens_per_block", &tbk::KvCacheStats::toksPerBlock);
+
+    py::class_<tbk::KvCacheReuseStats>(m, "KvCacheReuseStats")
+        .def_readonly("alloc_total_blocks", &tbk::KvCacheReuseStats::allocTotalBlocks)
+        .def_readonly("alloc_new_blocks", &tbk::KvCacheReuseStats::allocNewBlocks)
+        .def_readonly("reused_blocks", &tbk::KvCacheReuseStats::reusedBlocks);
+
+    py::class_<KVCacheManager>(m, "KVCacheManager")
+        .def(py::init<SizeType, SizeType, SizeType, SizeType, SizeType, SizeType, SizeType, SizeType, SizeType,
+                 SizeType, nvinfer1::DataType, bool>(),
+            py::arg("num_layers"), py::arg("num_heads"), py::arg("num_kv_heads"), py::arg("hidden_size"),
+            py::arg("tokens_per_block"), py::arg("max_num_blocks"), py::arg("max_num_sequences"),
+            py::arg("max_beam_width"), py::arg("max_blocks_per_seq"), py::arg("max_attention_window"),
+            py::arg("dtype"), py::arg("enable_block_reuse") = false)
+        .def("add_sequence", &KVCacheManager::addSequence, py::arg("seq_slot_idx"), py::arg("input_length"),
+            py::arg("beam_width"), py::arg("input_tokens") = std::nullopt)
+        .def("add_token", &KVCacheManager::addToken, py::arg("seq_slot_idx"))
+        .def("remove_sequence", &KVCacheManager::removeSequence, py::arg("seq_slot_idx"))
+        .def("get_block_pointers_of_batch", &KVCacheManager::getBlockPointersOfBatch, py::arg("pointers"),
+            py::arg("first_seq_slot_idx"), py::arg("batch_size"), py::arg("beam_width"))
+        .def(
+            "get_num_prepopulated_tokens",
+            [](KVCacheManager const& self, SizeType seqSlotIdx, SizeType beamIdx)
+            { return self.get().getNumPrepopulatedTokens(seqSlotIdx, beamIdx); },
+            py::arg("seq_slot_idx"), py::arg("beam_idx") = 0)
+        .def("get_kv_cache_stats", [](KVCacheManager const& self) { return self.get().getKvCacheStats(); })
+        .def("get_kv_cache_reuse_stats",
+            [](KVCacheManager const& self) { return tbk::getKvCacheReuseStats(self.get()); })
+        .def_property_readonly("memory_pools", &KVCacheManager::getMemoryPools)
+        .def_property_readonly(
+            "tokens_per_block", [](KVCacheManager const& self) { return self.get().getTokensPerBlock(); })
+        .def_property_readonly(
+            "max_num_blocks", [](KVCacheManager const& self) { return self.get().getMaxNumBlocks(); })
+        .def_property_readonly(
+            "num_free_blocks", [](KVCacheManager const& self) { return self.get().getNumFreeBlocks(); })
+        .def_property_readonly(
+            "enable_block_reuse", [](KVCacheManager const& self) { return self.get().isEnableBlockReuse(); });
+}
+
+} // namespace tensorrt_llm::pybind::batch_manager
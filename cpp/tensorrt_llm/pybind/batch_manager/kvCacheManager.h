@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/batch_manager/llmRequest.h"
+#include "tensorrt_llm/runtime/common.h"
+
+#include <ATen/ATen.h>
+#include <NvInferRuntime.h>
+#include <pybind11/pybind11.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace tensorrt_llm::pybind::batch_manager
+{
+
+// The KV cache manager of the C++ runtime for the Python runtime. The pools are allocated on the current torch stream,
+// and the block pointers of a batch are written into a torch tensor by a single call instead of being gathered in
+// Python.
+class KVCacheManager
+{
+public:
+    using SizeType = tensorrt_llm::runtime::SizeType;
+    using VecTokens = tensorrt_llm::batch_manager::LlmRequest::VecTokens;
+
+    KVCacheManager(SizeType numLayers, SizeType numHeads, SizeType numKvHeads, SizeType hiddenSize,
+        SizeType tokensPerBlock, SizeType maxNumBlocks, SizeType maxNumSequences, SizeType maxBeamWidth,
+        SizeType maxBlocksPerSeq, SizeType maxAttentionWindow, nvinfer1::DataType dtype, bool enableBlockReuse);
+
+    // With block reuse, the blocks of the earlier sequences matching a prefix of inputTokens are reused
+    void addSequence(
+        SizeType seqSlotIdx, SizeType inputLength, SizeType beamWidth, std::optional<VecTokens> const& inputTokens);
+
+    void addToken(SizeType seqSlotIdx);
+
+    // With block reuse, the blocks of the input tokens are kept for the later sequences
+    void removeSequence(SizeType seqSlotIdx);
+
+    // pointers is a host int64 tensor of [numLayers, batchSize * beamWidth, 2, maxBlocksPerSeq]
+    void getBlockPointersOfBatch(
+        at::Tensor const& pointers, SizeType firstSeqSlotIdx, SizeType batchSize, SizeType beamWidth) const;
+
+    [[nodiscard]] std::vector<at::Tensor> getMemoryPools() const;
+
+    [[nodiscard]] tensorrt_llm::batch_manager::kv_cache_manager::KVCacheManager const& get() const
+    {
+        return *mManager;
+    }
+
+    static void initBindings(pybind11::module_& m);
+
+private:
+    std::shared_ptr<tensorrt_llm::batch_manager::kv_cache_manager::KVCacheManager> mManager;
+    // The requests of the sequences added with their input tokens, which the reuse looks up
+    std::unordered_map<SizeType, std::shared_ptr<tensorrt_llm::batch_manager::LlmRequest>> mRequests;
+    std::uint64_t mNextRequestId{0};
+};
+
+} // namespace tensorrt_llm::pybind::batch_manager
@@ -24,6 +24,7 @@
 
 #include "tensorrt_llm/pybind/batch_manager/gptManager.h"
 #include "tensorrt_llm/pybind/batch_manager/inferenceRequest.h"
+#include "tensorrt_llm/pybind/batch_manager/kvCacheManager.h"
 #include "tensorrt_llm/pybind/batch_manager/llmRequest.h"
 #include "tensorrt_llm/pybind/batch_manager/namedTensor.h"
 #include "tensorrt_llm/pybind/runtime/generationInput.h"
@@ -33,12 +34,17 @@
 #include "tensorrt_llm/batch_manager/BatchManager.h"
 #include "tensorrt_llm/batch_manager/batchScheduler.h"
 #include "tensorrt_llm/batch_manager/kvCacheConfig.h"
+#include "tensorrt_llm/batch_manager/requestTimeline.h"
 #include "tensorrt_llm/batch_manager/trtGptModelOptionalParams.h"
 #include "tensorrt_llm/common/quantization.h"
 #include "tensorrt_llm/runtime/common.h"
 #include "tensorrt_llm/runtime/gptJsonConfig.h"
 #include "tensorrt_llm/runtime/gptSession.h"
+#include "tensorrt_llm/runtime/memoryCounters.h"
 #include "tensorrt_llm/runtime/samplingConfig.h"
+#include "tensorrt_llm/runtime/torchView.h"
+#include "tensorrt_llm/runtime/truncationConfig.h"
+#include "tensorrt_llm/thop/torchAllocator.h"
 
 namespace py = pybind11;
 namespace tb = tensorrt_llm::batch_manager;
@@ -71,6 +77,14 @@ PYBIND11_MODULE(TRTLLM_PYBIND_MODULE, m)
         .def_readwrite("free_gpu_memory_fraction", &tbk::KvCacheConfig::freeGpuMemoryFraction)
         .def_readwrite("enable_block_reuse", &tbk::KvCacheConfig::enableBlockReuse);
 
+    py::class_<tr::MemoryPoolConfig>(m, "MemoryPoolConfig")
+        .def(py::init<>())
+        .def_readwrite("release_threshold", &tr::MemoryPoolConfig::releaseThreshold)
+        .def_readwrite("reuse_follow_event_dependencies", &tr::MemoryPoolConfig::reuseFollowEventDependencies)
+        .def_readwrite("reuse_allow_opportunistic", &tr::MemoryPoolConfig::reuseAllowOpportunistic)
+        .def_readwrite("reuse_allow_internal_dependencies", &tr::MemoryPoolConfig::reuseAllowInternalDependencies)
+        .def_readwrite("dedicated_pool", &tr::MemoryPoolConfig::dedicatedPool);
+
     py::class_<tr::GptSession::Config>(m, "GptSessionConfig")
         .def(py::init<SizeType, SizeType, SizeType>(), py::arg("max_batch_size"), py::arg("max_beam_width"),
             py::arg("max_sequence_length"))
@@ -83,6 +97,29 @@ PYBIND11_MODULE(TRTLLM_PYBIND_MODULE, m)
         .def_readwrite("gen_micro_batch_size", &tr::GptSession::Config::genMicroBatchSize)
         .def_readwrite("kv_cache_config", &tr::GptSession::Config::kvCacheConfig);
 
+    py::class_<tr::GptSession::Options>(m, "GptSessionOptions")
+        .def(py::init<>())
+        .def_readwrite("cuda_graph_cache_size", &tr::GptSession::Options::cudaGraphCacheSize)
+        .def_readwrite("balance_micro_batches", &tr::GptSession::Options::balanceMicroBatches)
+        .def_readwrite("buffer_arena_mode", &tr::GptSession::Options::bufferArenaMode)
+        .def_readwrite("kv_cache_calibration_mode", &tr::GptSession::Options::kvCacheCalibrationMode)
+        .def_readwrite("kv_cache_calibration_margin", &tr::GptSession::Options::kvCacheCalibrationMargin)
+        .def_readwrite("gpu_weights_percent", &tr::GptSession::Options::gpuWeightsPercent)
+        .def_readwrite("weights_file", &tr::GptSession::Options::weightsFile)
+        .def_readwrite("memory_pool_config", &tr::GptSession::Options::memoryPoolConfig)
+        // The session allocates from the caching allocator of PyTorch, which the Python process already uses
+        .def_property(
+            "use_torch_allocator",
+            [](tr::GptSession::Options const& options) { return static_cast<bool>(options.gpuAllocator); },
+            [](tr::GptSession::Options& options, bool useTorchAllocator)
+            {
+                options.gpuAllocator
+                    = useTorchAllocator ? std::make_shared<tensorrt_llm::thop::TorchGpuAllocator>() : nullptr;
+            })
+        .def_readwrite("gather_context_logits", &tr::GptSession::Options::gatherContextLogits)
+        .def_readwrite("kv_cache_scale_sample_interval", &tr::GptSession::Options::kvCacheScaleSampleInterval)
+        .def_readwrite("kv_cache_scale_margin", &tr::GptSession::Options::kvCacheScaleMargin);
+
     py::enum_<nvinfer1::DataType>(m, "DataType")
         .value("FLOAT", nvinfer1::DataType::kFLOAT)
         .value("HALF", nvinfer1::DataType::kHALF)
@@ -99,6 +136,21 @@ PYBIND11_MODULE(TRTLLM_PYBIND_MODULE, m)
         .value("GPT", tr::GptModelConfig::ModelVariant::kGpt)
         .value("GLM", tr::GptModelConfig::ModelVariant::kGlm);
 
+    py::enum_<tr::MemoryTag>(m, "MemoryTag")
+        .value("UNTAGGED", tr::MemoryTag::kUNTAGGED)
+        .value("ENGINE_WEIGHTS", tr::MemoryTag::kENGINE_WEIGHTS)
+        .value("ENGINE_WORKSPACE", tr::MemoryTag::kENGINE_WORKSPACE)
+        .value("KV_CACHE", tr::MemoryTag::kKV_CACHE)
+        .value("RUNTIME_BUFFERS", tr::MemoryTag::kRUNTIME_BUFFERS)
+        .value("DECODER", tr::MemoryTag::kDECODER)
+        .value("SCRATCH", tr::MemoryTag::kSCRATCH)
+        .value("LORA_CACHE", tr::MemoryTag::kLORA_CACHE)
+        .value("PROMPT_TABLE_CACHE", tr::MemoryTag::kPROMPT_TABLE_CACHE);
+
+    m.def(
+        "get_gpu_memory_by_tag",
+        [](tr::MemoryTag tag) { return tr::MemoryCounters::getTagged(tr::MemoryType::kGPU, tag); }, py::arg("tag"));
+
     py::class_<tc::QuantMode>(m, "QuantMode")
         .def_static("none", &tc::QuantMode::none)
         .def_static("int4_weights", &tc::QuantMode::int4Weights)
@@ -110,6 +162,8 @@ PYBIND11_MODULE(TRTLLM_PYBIND_MODULE, m)
         .def_static("int8_kv_cache", &tc::QuantMode::int8KvCache)
         .def_static("fp8_kv_cache", &tc::QuantMode::fp8KvCache)
         .def_static("fp8_qdq", &tc::QuantMode::fp8Qdq)
+        .def_static("kv_cache_block_scaling", &tc::QuantMode::kvCacheBlockScaling)
+        .def_static("kv_cache_online_scaling", &tc::QuantMode::kvCacheOnlineScaling)
         .def_property_readonly("value", &tc::QuantMode::value)
         .def("is_set", &tc::QuantMode::isSet, py::arg("mode"))
         .def_property_readonly("has_int4_weights", &tc::QuantMode::hasInt4Weights)
@@ -123,10 +177,13 @@ PYBIND11_MODULE(TRTLLM_PYBIND_MODULE, m)
         .def_property_readonly("has_fp8_kv_cache", &tc::QuantMode::hasFp8KvCache)
         .def_property_readonly("has_fp8_qdq", &tc::QuantMode::hasFp8Qdq)
         .def_property_readonly("has_kv_cache_quant", &tc::QuantMode::hasKvCacheQuant)
+        .def_property_readonly("has_kv_cache_block_scaling", &tc::QuantMode::hasKvCacheBlockScaling)
+        .def_property_readonly("has_kv_cache_online_scaling", &tc::QuantMode::hasKvCacheOnlineScaling)
         .def_static("from_description", &tc::QuantMode::fromDescription, py::arg("quantize_weights") = false,
             py::arg("quantize_activations") = false, py::arg("per_token") = false, py::arg("per_channel") = false,
             py::arg("use_int4_weights") = false, py::arg("use_int8_kv_cache") = false,
-            py::arg("use_fp8_kv_kache") = false, py::arg("use_fp8_qdq") = false)
+            py::arg("use_fp8_kv_kache") = false, py::arg("use_fp8_qdq") = false,
+            py::arg("use_kv_cache_block_scaling") = false, py::arg("use_kv_cache_online_scaling") = false)
         .def(py::self + py::self)
         .def(py::self += py::self)
         .def(py::self - py::self)
@@ -212,6 +269,11 @@ PYBIND11_MODULE(TRTLLM_PYBIND_MODULE, m)
         .def_readwrite("beam_search_diversity_rate", &tr::SamplingConfig::beamSearchDiversityRate)
         .def_readwrite("length_penalty", &tr::SamplingConfig::lengthPenalty);
 
+    py::class_<tr::TruncationConfig>(m, "TruncationConfig")
+        .def(py::init())
+        .def_readwrite("min_p", &tr::TruncationConfig::minP)
+        .def_readwrite("typical_p", &tr::TruncationConfig::typicalP);
+
     py::class_<tr::GptJsonConfig>(m, "GptJsonConfig")
         .def(py::init<std::string, std::string, std::string, SizeType, SizeType, tr::GptModelConfig>(), py::arg("name"),
             py::arg("version"), py::arg("precision"), py::arg("tensor_parallelism"), py::arg("pipeline_parallelism"),
@@ -226,6 +288,8 @@ PYBIND11_MODULE(TRTLLM_PYBIND_MODULE, m)
         .def_property_readonly("tensor_parallelism", &tr::GptJsonConfig::getTensorParallelism)
         .def_property_readonly("pipeline_parallelism", &tr::GptJsonConfig::getPipelineParallelism)
         .def_property_readonly("world_size", &tr::GptJsonConfig::getWorldSize)
+        .def_property_readonly("strip_weights", &tr::GptJsonConfig::hasStrippedWeights)
+        .def("weights_filename", &tr::GptJsonConfig::weightsFilename, py::arg("world_config"))
         .def("engine_filename",
             py::overload_cast<const tr::WorldConfig&, const std::string&>(
                 &tr::GptJsonConfig::engineFilename, py::const_),
@@ -234,6 +298,10 @@ PYBIND11_MODULE(TRTLLM_PYBIND_MODULE, m)
             py::overload_cast<const tr::WorldConfig&>(&tr::GptJsonConfig::engineFilename, py::const_),
             py::arg("world_config"));
 
+    py::enum_<tr::GptSession::PoolingType>(m, "PoolingType")
+        .value("LAST", tr::GptSession::PoolingType::kLAST)
+        .value("MEAN", tr::GptSession::PoolingType::kMEAN);
+
     py::class_<tr::GptSession>(m, "GptSession")
         .def(py::init(
                  [](tr::GptSession::Config const& config, tr::GptModelConfig const& modelConfig,
@@ -245,15 +313,68 @@ PYBIND11_MODULE(TRTLLM_PYBIND_MODULE, m)
             py::arg("config"), py::arg("model_config"), py::arg("world_config"), py::arg("engine_buffer"))
         .def(py::init<tr::GptSession::Config, tr::GptModelConfig, tr::WorldConfig, std::string>(), py::arg("config"),
             py::arg("model_config"), py::arg("world_config"), py::arg("engine_file"))
+        .def(py::init(
+                 [](tr::GptSession::Config const& config, tr::GptSession::Options const& options,
+                     tr::GptModelConfig const& modelConfig, tr::WorldConfig const& worldConfig,
+                     py::bytearray const& bytes)
+                 {
+                     auto buf = static_cast<std::string>(bytes);
+                     return tr::GptSession{config, options, modelConfig, worldConfig, buf.data(), buf.size()};
+                 }),
+            py::arg("config"), py::arg("options"), py::arg("model_config"), py::arg("world_config"),
+            py::arg("engine_buffer"))
+        .def(py::init<tr::GptSession::Config, tr::GptSession::Options, tr::GptModelConfig, tr::WorldConfig,
+                 std::string>(),
+            py::arg("config"), py::arg("options"), py::arg("model_config"), py::arg("world_config"),
+            py::arg("engine_file"))
         .def_property_readonly("model_config", &tr::GptSession::getModelConfig)
         .def_property_readonly("world_config", &tr::GptSession::getWorldConfig)
         .def_property_readonly("device", &tr::GptSession::getDevice)
+        .def("set_stop_check_interval", &tr::GptSession::setStopCheckInterval, py::arg("interval"))
         .def(
             "generate",
             [](tr::GptSession& self, tpr::GenerationOutput& outputs, tpr::GenerationInput const& inputs,
                 tr::SamplingConfig const& samplingConfig)
             { self.generate(*outputs.toTrtLlm(), *inputs.toTrtLlm(), samplingConfig); },
-            py::arg("outputs"), py::arg("inputs"), py::arg("sampling_config"));
+            py::arg("outputs"), py::arg("inputs"), py::arg("sampling_config"))
+        .def(
+            "generate",
+            [](tr::GptSession& self, tpr::GenerationOutput& outputs, tpr::GenerationInput const& inputs,
+                tr::SamplingConfig const& samplingConfig, tr::TruncationConfig const& truncationConfig)
+            { self.generate(*outputs.toTrtLlm(), *inputs.toTrtLlm(), samplingConfig, truncationConfig); },
+            py::arg("outputs"), py::arg("inputs"), py::arg("sampling_config"), py::arg("truncation_config"))
+        .def(
+            "generate_speculative",
+            [](tr::GptSession& self, tpr::GenerationOutput& outputs, tpr::GenerationInput const& inputs,
+                tr::SamplingConfig const& samplingConfig, tr::GptSession& draftSession, tr::SizeType numDraftTokens)
+            {
+                self.generateSpeculative(
+                    *outputs.toTrtLlm(), *inputs.toTrtLlm(), samplingConfig, draftSession, numDraftTokens);
+            },
+            py::arg("outputs"), py::arg("inputs"), py::arg("sampling_config"), py::arg("draft_session"),
+            py::arg("num_draft_tokens"))
+        .def(
+            "generate_prompt_lookup",
+            [](tr::GptSession& self, tpr::GenerationOutput& outputs, tpr::GenerationInput const& inputs,
+                tr::SamplingConfig const& samplingConfig, tr::SizeType numDraftTokens, tr::SizeType maxNgramSize)
+            {
+                self.generatePromptLookup(
+                    *outputs.toTrtLlm(), *inputs.toTrtLlm(), samplingConfig, numDraftTokens, maxNgramSize);
+            },
+            py::arg("outputs"), py::arg("inputs"), py::arg("sampling_config"), py::arg("num_draft_tokens"),
+            py::arg("max_ngram_size") = 3)
+        .def(
+            "encode",
+            [](tr::GptSession& self, at::Tensor const& embeddings, tpr::GenerationInput const& inputs,
+                tr::GptSession::PoolingType pooling)
+            { self.encode(tr::TorchView::of(embeddings), *inputs.toTrtLlm(), pooling); },
+            py::arg("embeddings"), py::arg("inputs"), py::arg("pooling") = tr::GptSession::PoolingType::kLAST)
+        .def("share_engine_workspace", &tr::GptSession::shareEngineWorkspace, py::arg("other"))
+        .def(
+            "refit", [](tr::GptSession& self, std::string const& weightsFile) { self.refit(weightsFile); },
+            py::arg("weights_file"), py::call_guard<py::gil_scoped_release>())
+        .def("save_warm_up_state", &tr::GptSession::saveWarmUpState, py::arg("path"))
+        .def("warm_up", &tr::GptSession::warmUp, py::arg("path"), py::call_guard<py::gil_scoped_release>());
 
     py::enum_<tb::LlmRequestState_t>(m, "LlmRequestState")
         .value("REQUEST_STATE_UNKNOWN", tb::LlmRequestState_t::REQUEST_STATE_UNKNOWN)
@@ -261,8 +382,15 @@ PYBIND11_MODULE(TRTLLM_PYBIND_MODULE, m)
         .value("REQUEST_STATE_GENERATION_IN_PROGRESS", tb::LlmRequestState_t::REQUEST_STATE_GENERATION_IN_PROGRESS)
         .value("REQUEST_STATE_GENERATION_COMPLETE", tb::LlmRequestState_t::REQUEST_STATE_GENERATION_COMPLETE);
 
+    py::enum_<tb::RequestTimelineEvent>(m, "RequestTimelineEvent")
+        .value("ARRIVAL", tb::RequestTimelineEvent::kArrival)
+        .value("SCHEDULED", tb::RequestTimelineEvent::kScheduled)
+        .value("FIRST_TOKEN", tb::RequestTimelineEvent::kFirstToken)
+        .value("COMPLETION", tb::RequestTimelineEvent::kCompletion);
+
     tpb::NamedTensor::initBindings(m);
     tpb::LlmRequest::initBindings(m);
+    tpb::KVCacheManager::initBindings(m);
 
     auto tensorNames = m.def_submodule("tensor_names");
     // Input tensor names
@@ -286,6 +414,8 @@ PYBIND11_MODULE(TRTLLM_PYBIND_MODULE, m)
     tensorNames.attr("FREQUENCY_PENALTY") = py::str(tb::inference_request::kFrequencyPenaltyTensorName);
     tensorNames.attr("RANDOM_SEED") = py::str(tb::inference_request::kRandomSeedTensorName);
     tensorNames.attr("RETURN_LOG_PROBS") = py::str(tb::inference_request::kReturnLogProbsTensorName);
+    tensorNames.attr("RETURN_TIMELINE") = py::str(tb::inference_request::kReturnTimelineTensorName);
+    tensorNames.attr("TRACE_CONTEXT") = py::str(tb::inference_request::kTraceContextTensorName);
     tensorNames.attr("PROMPT_EMBEDDING_TABLE") = py::str(tb::inference_request::kPromptEmbeddingTableName);
     tensorNames.attr("PROMPT_VOCAB_SIZE") = py::str(tb::inference_request::kPromptVocabSizeName);
 
@@ -294,6 +424,7 @@ PYBIND11_MODULE(TRTLLM_PYBIND_MODULE, m)
     tensorNames.attr("SEQUENCE_LENGTH") = py::str(tb::inference_request::kSequenceLengthTensorName);
     tensorNames.attr("OUTPUT_LOG_PROBS") = py::str(tb::inference_request::kLogProbsTensorName);
     tensorNames.attr("CUM_LOG_PROBS") = py::str(tb::inference_request::kCumLogProbsTensorName);
+    tensorNames.attr("REQUEST_TIMELINE") = py::str(tb::inference_request::kRequestTimelineTensorName);
 
     tpb::InferenceRequest::initBindings(m);
 
@@ -64,6 +64,8 @@ std::shared_ptr<tr::GenerationInput> GenerationInput::toTrtLlm() const
         input->stopWordsList = tr::TorchView::of(stopWordsList.value());
     input->maxNewTokens = maxNewTokens;
     input->promptTuningParams = *promptTuningParams.toTrtLlm();
+    for (auto const& [name, tensor] : extraInputs)
+        input->extraInputs.insert_or_assign(name, tr::TorchView::of(tensor));
     return input;
 
     return input;
@@ -83,5 +85,6 @@ void GenerationInput::initBindings(pybind11::module_& m)
         .def_readwrite("bad_words_list", &GenerationInput::badWordsList)
         .def_readwrite("stop_words_list", &GenerationInput::stopWordsList)
         .def_readwrite("max_new_tokens", &GenerationInput::maxNewTokens)
-        .def_readwrite("prompt_tuning_params", &GenerationInput::promptTuningParams);
+        .def_readwrite("prompt_tuning_params", &GenerationInput::promptTuningParams)
+        .def_readwrite("extra_inputs", &GenerationInput::extraInputs);
 }
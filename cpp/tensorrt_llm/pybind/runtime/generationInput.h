@@ -22,8 +22,10 @@
 
 #include <ATen/ATen.h>
 #include <ATen/ops/tensor.h>
+#include <map>
 #include <memory>
 #include <optional>
+#include <string>
 #include <pybind11/pybind11.h>
 
 namespace tensorrt_llm::pybind::runtime
@@ -63,5 +65,7 @@ public:
 
     [[nodiscard]] std::shared_ptr<tensorrt_llm::runtime::GenerationInput> toTrtLlm() const;
     static void initBindings(pybind11::module_& m);
+
+    std::map<std::string, at::Tensor> extraInputs;
 };
 } // namespace tensorrt_llm::pybind::runtime
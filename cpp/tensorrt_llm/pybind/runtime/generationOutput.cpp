@@ -44,6 +44,14 @@ std::shared_ptr<tr::GenerationOutput> GenerationOutput::toTrtLlm() const
     {
         output->generationLogits = tr::TorchView::of(generationLogits.value());
     }
+    if (topLogProbIds)
+    {
+        output->topLogProbIds = tr::TorchView::of(topLogProbIds.value());
+    }
+    if (topLogProbs)
+    {
+        output->topLogProbs = tr::TorchView::of(topLogProbs.value());
+    }
 
     if (onTokenGenerated)
     {
@@ -63,5 +71,7 @@ void GenerationOutput::initBindings(py::module_& m)
         .def_readwrite("log_probs", &GenerationOutput::logProbs)
         .def_readwrite("context_logits", &GenerationOutput::contextLogits)
         .def_readwrite("generation_logits", &GenerationOutput::generationLogits)
+        .def_readwrite("top_log_prob_ids", &GenerationOutput::topLogProbIds)
+        .def_readwrite("top_log_probs", &GenerationOutput::topLogProbs)
         .def_readwrite("on_token_generated", &GenerationOutput::onTokenGenerated);
 }
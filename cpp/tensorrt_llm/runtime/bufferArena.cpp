@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/bufferArena.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/runtime/iBuffer.h"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+std::size_t alignSize(std::size_t size)
+{
+    return (size + BufferArena::kAlignment - 1) / BufferArena::kAlignment * BufferArena::kAlignment;
+}
+
+} // namespace
+
+std::size_t BufferArena::add(nvinfer1::DataType type, std::size_t capacity, Phase first, Phase last)
+{
+    TLLM_CHECK_WITH_INFO(first <= last, "The first phase of a tensor must not be after its last phase");
+    auto const sizeInBytes = alignSize(capacity * BufferDataType(type).getSize());
+    mTensors.push_back(Tensor{type, capacity, sizeInBytes, first, last, 0});
+    mPlanned = false;
+    return mTensors.size() - 1;
+}
+
+void BufferArena::plan()
+{
+    std::vector<std::size_t> order(mTensors.size());
+    std::iota(order.begin(), order.end(), 0);
+    // Largest first, a stable sort keeps the placement deterministic
+    std::stable_sort(order.begin(), order.end(),
+        [this](std::size_t lhs, std::size_t rhs) { return mTensors[lhs].sizeInBytes > mTensors[rhs].sizeInBytes; });
+
+    mSize = 0;
+    std::vector<std::size_t> placed;
+    placed.reserve(order.size());
+    for (auto const idx : order)
+    {
+        auto& tensor = mTensors[idx];
+        // Placed tensors live at the same time as this one, by increasing offset
+        std::vector<Tensor const*> conflicts;
+        for (auto const other : placed)
+        {
+            auto const& placedTensor = mTensors[other];
+            if (placedTensor.first <= tensor.last && tensor.first <= placedTensor.last)
+            {
+                conflicts.push_back(&placedTensor);
+            }
+        }
+        std::sort(conflicts.begin(), conflicts.end(),
+            [](Tensor const* lhs, Tensor const* rhs) { return lhs->offset < rhs->offset; });
+
+        // Lowest gap between them that is large enough
+        std::size_t offset = 0;
+        for (auto const* conflict : conflicts)
+        {
+            if (offset + tensor.sizeInBytes <= conflict->offset)
+            {
+                break;
+            }
+            offset = std::max(offset, conflict->offset + conflict->sizeInBytes);
+        }
+        tensor.offset = offset;
+        mSize = std::max(mSize, offset + tensor.sizeInBytes);
+        placed.push_back(idx);
+    }
+    mPlanned = true;
+}
+
+std::size_t BufferArena::getOffset(std::size_t idx) const
+{
+    TLLM_CHECK_WITH_INFO(mPlanned, "The arena is not planned");
+    return mTensors.at(idx).offset;
+}
+
+std::size_t BufferArena::getSize() const
+{
+    TLLM_CHECK_WITH_INFO(mPlanned, "The arena is not planned");
+    return mSize;
+}
+
+std::size_t BufferArena::getUnsharedSize() const
+{
+    return std::accumulate(mTensors.begin(), mTensors.end(), std::size_t{0},
+        [](std::size_t size, Tensor const& tensor) { return size + tensor.sizeInBytes; });
+}
@@ -17,16 +17,115 @@
 #include "tensorrt_llm/common/assert.h"
 #include "tllmBuffers.h"
 
+#include <atomic>
 #include <cstring>
 #include <cuda_runtime_api.h>
+#include <iterator>
 #include <limits>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <unordered_set>
 
 using namespace tensorrt_llm::runtime;
 
 namespace tc = tensorrt_llm::common;
 
+namespace
+{
+
+// Keeps the pooled pinned blocks of an asynchronous copy from being reused before it ran
+void recordPinnedCopy(void const* src, MemoryType srcType, void const* dst, MemoryType dstType, cudaStream_t stream)
+{
+    if (srcType == MemoryType::kPINNED)
+    {
+        PinnedPool::getInstance().recordStream(src, stream);
+    }
+    if (dstType == MemoryType::kPINNED)
+    {
+        PinnedPool::getInstance().recordStream(dst, stream);
+    }
+}
+
+using CudaMemPoolPtr = std::shared_ptr<std::remove_pointer_t<::cudaMemPool_t>>;
+
+// Where the GPU allocations made on a stream come from when it is not the default pool of the device. It is a setting
+// of the stream shared by all its BufferManagers, because the prebuilt batch manager fixes the layout of BufferManager.
+struct GpuMemorySource
+{
+    // Dedicated pool, null when allocating from the default pool of the device
+    CudaMemPoolPtr memPool;
+    // External allocator, null when allocating from a pool
+    IGpuAllocator::SharedPtr gpuAllocator;
+
+    [[nodiscard]] bool empty() const
+    {
+        return !memPool && !gpuAllocator;
+    }
+};
+
+// The sources of the streams that do not allocate from the default pool of the device
+class GpuMemorySources
+{
+public:
+    static GpuMemorySources& getInstance()
+    {
+        static GpuMemorySources instance;
+        return instance;
+    }
+
+    void set(std::shared_ptr<CudaStream> const& stream, GpuMemorySource source)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        eraseExpired();
+        if (source.empty())
+        {
+            mSources.erase(stream.get());
+        }
+        else
+        {
+            mSources[stream.get()] = Entry{stream, std::move(source)};
+        }
+        mEmpty = mSources.empty();
+    }
+
+    [[nodiscard]] GpuMemorySource get(CudaStream const& stream)
+    {
+        if (mEmpty)
+        {
+            return {};
+        }
+        std::lock_guard<std::mutex> lock(mMutex);
+        eraseExpired();
+        mEmpty = mSources.empty();
+        auto const it = mSources.find(&stream);
+        return it != mSources.end() ? it->second.source : GpuMemorySource{};
+    }
+
+private:
+    struct Entry
+    {
+        // Expires with the stream, a stream created later at the same address does not inherit the source
+        std::weak_ptr<CudaStream> stream;
+        GpuMemorySource source;
+    };
+
+    // Releases the sources of the destroyed streams
+    void eraseExpired()
+    {
+        for (auto it = mSources.begin(); it != mSources.end();)
+        {
+            it = it->second.stream.expired() ? mSources.erase(it) : std::next(it);
+        }
+    }
+
+    std::mutex mMutex;
+    std::unordered_map<CudaStream const*, Entry> mSources;
+    std::atomic<bool> mEmpty{true};
+};
+
+} // namespace
+
 BufferManager::BufferManager(CudaStreamPtr stream)
     : mStream{std::move(stream)}
 {
@@ -40,14 +139,74 @@ BufferManager::BufferManager(CudaStreamPtr stream)
     }
 }
 
+BufferManager::BufferManager(CudaStreamPtr stream, MemoryPoolConfig const& poolConfig)
+    : BufferManager{std::move(stream)}
+{
+    auto const device = mStream->getDevice();
+    GpuMemorySource source;
+    if (poolConfig.dedicatedPool)
+    {
+        source.memPool = createMemoryPool(device, poolConfig);
+    }
+    else
+    {
+        ::cudaMemPool_t memPool;
+        TLLM_CUDA_CHECK(cudaDeviceGetDefaultMemPool(&memPool, device));
+        configureMemoryPool(memPool, poolConfig);
+    }
+    GpuMemorySources::getInstance().set(mStream, std::move(source));
+}
+
+BufferManager::BufferManager(CudaStreamPtr stream, IGpuAllocator::SharedPtr gpuAllocator)
+    : BufferManager{std::move(stream)}
+{
+    TLLM_CHECK_WITH_INFO(static_cast<bool>(gpuAllocator), "Undefined GPU allocator");
+    GpuMemorySource source;
+    source.gpuAllocator = std::move(gpuAllocator);
+    GpuMemorySources::getInstance().set(mStream, std::move(source));
+}
+
 BufferManager::IBufferPtr BufferManager::gpu(std::size_t size, nvinfer1::DataType type) const
 {
-    return std::make_unique<DeviceBuffer>(size, type, CudaAllocatorAsync{mStream});
+    auto const source = GpuMemorySources::getInstance().get(*mStream);
+    return std::make_unique<DeviceBuffer>(size, type, CudaAllocatorAsync{mStream, source.memPool, source.gpuAllocator});
 }
 
 BufferManager::ITensorPtr BufferManager::gpu(nvinfer1::Dims dims, nvinfer1::DataType type) const
 {
-    return std::make_unique<DeviceTensor>(dims, type, CudaAllocatorAsync{mStream});
+    auto const source = GpuMemorySources::getInstance().get(*mStream);
+    return std::make_unique<DeviceTensor>(dims, type, CudaAllocatorAsync{mStream, source.memPool, source.gpuAllocator});
+}
+
+std::vector<ITensor::SharedPtr> BufferManager::gpu(BufferArena const& arena) const
+{
+    // The tensors borrow the memory of the arena and share the ownership of it
+    struct ArenaTensor
+    {
+        IBuffer::SharedPtr arena;
+        ITensor::UniquePtr tensor;
+    };
+
+    IBuffer::SharedPtr buffer = gpu(arena.getSize());
+    auto* const base = static_cast<std::uint8_t*>(buffer->data());
+    auto const shape = ITensor::makeShape({0});
+    std::vector<ITensor::SharedPtr> tensors;
+    tensors.reserve(arena.getNbTensors());
+    for (std::size_t idx = 0; idx < arena.getNbTensors(); ++idx)
+    {
+        auto const type = arena.getDataType(idx);
+        auto const capacity = arena.getCapacity(idx);
+        if (capacity == 0)
+        {
+            tensors.emplace_back(gpu(shape, type));
+            continue;
+        }
+        auto arenaTensor = std::make_shared<ArenaTensor>(
+            ArenaTensor{buffer, ITensor::wrap(base + arena.getOffset(idx), type, shape, capacity)});
+        auto* tensor = arenaTensor->tensor.get();
+        tensors.emplace_back(std::move(arenaTensor), tensor);
+    }
+    return tensors;
 }
 
 BufferManager::IBufferPtr BufferManager::cpu(std::size_t size, nvinfer1::DataType type)
@@ -93,6 +252,7 @@ void BufferManager::copy(void const* src, IBuffer& dst, MemoryType srcType) cons
         else
         {
             TLLM_CUDA_CHECK(cudaMemcpyAsync(dst.data(), src, dst.getSizeInBytes(), cudaMemcpyDefault, mStream->get()));
+            recordPinnedCopy(src, srcType, dst.data(), dst.getMemoryType(), mStream->get());
         }
     }
 }
@@ -108,6 +268,7 @@ void BufferManager::copy(IBuffer const& src, void* dst, MemoryType dstType) cons
         else
         {
             TLLM_CUDA_CHECK(cudaMemcpyAsync(dst, src.data(), src.getSizeInBytes(), cudaMemcpyDefault, mStream->get()));
+            recordPinnedCopy(src.data(), src.getMemoryType(), dst, dstType, mStream->get());
         }
     }
 }
@@ -166,9 +327,16 @@ CudaStream const& BufferManager::getStream() const
 
 void BufferManager::initMemoryPool(int device)
 {
-    auto const deviceCount = tc::getDeviceCount();
     ::cudaMemPool_t memPool;
     TLLM_CUDA_CHECK(cudaDeviceGetDefaultMemPool(&memPool, device));
+    setPeerAccess(memPool, device);
+    // set memory pool threshold to avoid shrinking the pool
+    configureMemoryPool(memPool, MemoryPoolConfig{});
+}
+
+void BufferManager::setPeerAccess(::cudaMemPool_t memPool, int device)
+{
+    auto const deviceCount = tc::getDeviceCount();
     for (auto peerDevice = 0; peerDevice < deviceCount; ++peerDevice)
     {
         if (peerDevice == device)
@@ -189,53 +357,144 @@ void BufferManager::initMemoryPool(int device)
         desc.flags = cudaMemAccessFlagsProtReadWrite;
         TLLM_CUDA_CHECK(cudaMemPoolSetAccess(memPool, &desc, 1));
     }
-    // set memory pool threshold to avoid shrinking the pool
-    auto maxThreshold = std::numeric_limits<std::uint64_t>::max();
-    TLLM_CUDA_CHECK(cudaMemPoolSetAttribute(memPool, cudaMemPoolAttrReleaseThreshold, &maxThreshold));
 }
 
-std::size_t BufferManager::memoryPoolReserved(int device)
+void BufferManager::configureMemoryPool(::cudaMemPool_t memPool, MemoryPoolConfig const& config)
 {
+    auto releaseThreshold = config.releaseThreshold;
+    TLLM_CUDA_CHECK(cudaMemPoolSetAttribute(memPool, cudaMemPoolAttrReleaseThreshold, &releaseThreshold));
+    int reuse = config.reuseFollowEventDependencies ? 1 : 0;
+    TLLM_CUDA_CHECK(cudaMemPoolSetAttribute(memPool, cudaMemPoolReuseFollowEventDependencies, &reuse));
+    reuse = config.reuseAllowOpportunistic ? 1 : 0;
+    TLLM_CUDA_CHECK(cudaMemPoolSetAttribute(memPool, cudaMemPoolReuseAllowOpportunistic, &reuse));
+    reuse = config.reuseAllowInternalDependencies ? 1 : 0;
+    TLLM_CUDA_CHECK(cudaMemPoolSetAttribute(memPool, cudaMemPoolReuseAllowInternalDependencies, &reuse));
+}
+
+BufferManager::CudaMemPoolPtr BufferManager::createMemoryPool(int device, MemoryPoolConfig const& config)
+{
+    ::cudaMemPoolProps props{};
+    props.allocType = cudaMemAllocationTypePinned;
+    props.handleTypes = cudaMemHandleTypeNone;
+    props.location.type = cudaMemLocationTypeDevice;
+    props.location.id = device;
     ::cudaMemPool_t memPool;
-    TLLM_CUDA_CHECK(cudaDeviceGetDefaultMemPool(&memPool, device));
+    TLLM_CUDA_CHECK(cudaMemPoolCreate(&memPool, &props));
+    // The pool is released once the allocations still pending are freed
+    CudaMemPoolPtr pool{memPool, [](::cudaMemPool_t handle) { cudaMemPoolDestroy(handle); }};
+    setPeerAccess(memPool, device);
+    configureMemoryPool(memPool, config);
+    return pool;
+}
+
+::cudaMemPool_t BufferManager::getMemoryPool() const
+{
+    // The pool outlives the call as long as the stream does
+    if (auto const source = GpuMemorySources::getInstance().get(*mStream); source.memPool)
+    {
+        return source.memPool.get();
+    }
+    ::cudaMemPool_t memPool;
+    TLLM_CUDA_CHECK(cudaDeviceGetDefaultMemPool(&memPool, mStream->getDevice()));
+    return memPool;
+}
+
+bool BufferManager::hasDedicatedMemoryPool() const
+{
+    return static_cast<bool>(GpuMemorySources::getInstance().get(*mStream).memPool);
+}
+
+IGpuAllocator::SharedPtr BufferManager::getGpuAllocator() const
+{
+    return GpuMemorySources::getInstance().get(*mStream).gpuAllocator;
+}
+
+std::size_t BufferManager::memoryPoolReleaseThreshold() const
+{
+    std::uint64_t releaseThreshold = 0;
+    TLLM_CUDA_CHECK(cudaMemPoolGetAttribute(getMemoryPool(), cudaMemPoolAttrReleaseThreshold, &releaseThreshold));
+    return static_cast<std::size_t>(releaseThreshold);
+}
+
+std::size_t BufferManager::memoryPoolReserved(::cudaMemPool_t memPool)
+{
     std::size_t reserved = 0;
     TLLM_CUDA_CHECK(cudaMemPoolGetAttribute(memPool, cudaMemPoolAttrReservedMemCurrent, &reserved));
     return reserved;
 }
 
-std::size_t BufferManager::memoryPoolUsed(int device)
+std::size_t BufferManager::memoryPoolUsed(::cudaMemPool_t memPool)
 {
-    ::cudaMemPool_t memPool;
-    TLLM_CUDA_CHECK(cudaDeviceGetDefaultMemPool(&memPool, device));
     std::size_t used = 0;
     TLLM_CUDA_CHECK(cudaMemPoolGetAttribute(memPool, cudaMemPoolAttrUsedMemCurrent, &used));
     return used;
 }
 
-void BufferManager::memoryPoolTrimTo(int device, std::size_t size)
+std::size_t BufferManager::memoryPoolUsedHigh(::cudaMemPool_t memPool)
+{
+    std::size_t usedHigh = 0;
+    TLLM_CUDA_CHECK(cudaMemPoolGetAttribute(memPool, cudaMemPoolAttrUsedMemHigh, &usedHigh));
+    return usedHigh;
+}
+
+void BufferManager::memoryPoolResetUsedHigh(::cudaMemPool_t memPool)
+{
+    // Only zero is accepted, it resets the high watermark to the current usage
+    std::size_t usedHigh = 0;
+    TLLM_CUDA_CHECK(cudaMemPoolSetAttribute(memPool, cudaMemPoolAttrUsedMemHigh, &usedHigh));
+}
+
+void BufferManager::memoryPoolTrimTo(::cudaMemPool_t memPool, std::size_t size)
 {
-    ::cudaMemPool_t memPool;
-    TLLM_CUDA_CHECK(cudaDeviceGetDefaultMemPool(&memPool, device));
     TLLM_CUDA_CHECK(cudaMemPoolTrimTo(memPool, size));
 }
 
 std::size_t BufferManager::memoryPoolReserved() const
 {
-    return memoryPoolReserved(mStream->getDevice());
+    auto const gpuAllocator = getGpuAllocator();
+    return gpuAllocator ? gpuAllocator->reserved() : memoryPoolReserved(getMemoryPool());
 }
 
 std::size_t BufferManager::memoryPoolUsed() const
 {
-    return memoryPoolUsed(mStream->getDevice());
+    auto const gpuAllocator = getGpuAllocator();
+    return gpuAllocator ? gpuAllocator->used() : memoryPoolUsed(getMemoryPool());
 }
 
 std::size_t BufferManager::memoryPoolFree() const
 {
-    return memoryPoolFree(mStream->getDevice());
+    auto const gpuAllocator = getGpuAllocator();
+    return gpuAllocator ? gpuAllocator->reserved() - gpuAllocator->used() : memoryPoolFree(getMemoryPool());
+}
+
+std::size_t BufferManager::memoryPoolUsedHigh() const
+{
+    auto const gpuAllocator = getGpuAllocator();
+    return gpuAllocator ? gpuAllocator->usedHigh() : memoryPoolUsedHigh(getMemoryPool());
+}
+
+void BufferManager::memoryPoolResetUsedHigh()
+{
+    mStream->synchronize();
+    if (auto const gpuAllocator = getGpuAllocator())
+    {
+        gpuAllocator->resetUsedHigh();
+    }
+    else
+    {
+        memoryPoolResetUsedHigh(getMemoryPool());
+    }
 }
 
 void BufferManager::memoryPoolTrimTo(std::size_t size)
 {
     mStream->synchronize();
-    memoryPoolTrimTo(mStream->getDevice(), size);
+    if (auto const gpuAllocator = getGpuAllocator())
+    {
+        gpuAllocator->releaseCached();
+    }
+    else
+    {
+        memoryPoolTrimTo(getMemoryPool(), size);
+    }
 }
@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/detokenizer.h"
+
+#include "tensorrt_llm/common/assert.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+using Json = typename nlohmann::json::basic_json;
+
+auto constexpr kReplacementCharacter = "\xEF\xBF\xBD";
+// U+2581, which SentencePiece puts in place of the spaces
+auto constexpr kMetaspace = "\xE2\x96\x81";
+
+enum class DecoderKind
+{
+    kNone,
+    kByteLevel,
+    kMetaspace,
+};
+
+struct DecoderConfig
+{
+    DecoderKind kind{DecoderKind::kNone};
+    bool byteFallback{false};
+    bool stripLeadingSpace{false};
+};
+
+void parseDecoder(Json const& decoder, DecoderConfig& config)
+{
+    auto const type = decoder.at("type").template get<std::string>();
+    if (type == "Sequence")
+    {
+        for (auto const& child : decoder.at("decoders"))
+        {
+            parseDecoder(child, config);
+        }
+    }
+    else if (type == "ByteLevel")
+    {
+        config.kind = DecoderKind::kByteLevel;
+    }
+    else if (type == "Metaspace")
+    {
+        config.kind = DecoderKind::kMetaspace;
+        auto const prependScheme = decoder.value("prepend_scheme", std::string{"always"});
+        config.stripLeadingSpace = decoder.value("add_prefix_space", true) && prependScheme != "never";
+    }
+    else if (type == "Replace")
+    {
+        // The Replace of the spaces of the LLaMA tokenizers
+        auto const& pattern = decoder.at("pattern");
+        auto const it = pattern.find("String");
+        TLLM_CHECK_WITH_INFO(it != pattern.end() && it->template get<std::string>() == kMetaspace
+                && decoder.at("content").template get<std::string>() == " ",
+            "Only the Replace decoder of %s with spaces is supported", kMetaspace);
+        config.kind = DecoderKind::kMetaspace;
+    }
+    else if (type == "ByteFallback")
+    {
+        config.byteFallback = true;
+    }
+    else if (type == "Strip")
+    {
+        TLLM_CHECK_WITH_INFO(decoder.value("content", std::string{" "}) == " " && decoder.value("stop", 0) == 0
+                && decoder.value("start", 0) <= 1,
+            "Only the Strip decoder of the leading space is supported");
+        config.stripLeadingSpace = decoder.value("start", 0) == 1;
+    }
+    else if (type != "Fuse")
+    {
+        TLLM_THROW("Tokenizer decoder %s is not supported", type.c_str());
+    }
+}
+
+// The byte-level BPE maps each byte to a printable character, see bytes_to_unicode in GPT-2
+std::unordered_map<char32_t, char> byteLevelTable()
+{
+    std::unordered_map<char32_t, char> table;
+    char32_t next = 256;
+    for (int byte = 0; byte < 256; ++byte)
+    {
+        auto const printable = (byte >= '!' && byte <= '~') || (byte >= 0xA1 && byte <= 0xAC) || byte >= 0xAE;
+        table.emplace(printable ? static_cast<char32_t>(byte) : next++, static_cast<char>(byte));
+    }
+    return table;
+}
+
+// Number of bytes of the UTF-8 character starting at text[pos], or 0 if the bytes there are not a valid character.
+// A character cut by the end of the text is valid, its length is larger than the remaining bytes.
+std::size_t utf8CharLength(std::string const& text, std::size_t pos)
+{
+    auto const byte = [&](std::size_t i) { return static_cast<unsigned char>(text[i]); };
+    auto const lead = byte(pos);
+    std::size_t length = 0;
+    unsigned char min = 0x80;
+    unsigned char max = 0xBF;
+    if (lead < 0x80)
+    {
+        return 1;
+    }
+    if (lead >= 0xC2 && lead <= 0xDF)
+    {
+        length = 2;
+    }
+    else if (lead >= 0xE0 && lead <= 0xEF)
+    {
+        length = 3;
+        // No overlong encodings and no surrogates
+        min = lead == 0xE0 ? 0xA0 : min;
+        max = lead == 0xED ? 0x9F : max;
+    }
+    else if (lead >= 0xF0 && lead <= 0xF4)
+    {
+        length = 4;
+        min = lead == 0xF0 ? 0x90 : min;
+        max = lead == 0xF4 ? 0x8F : max;
+    }
+    else
+    {
+        return 0;
+    }
+    for (std::size_t i = 1; i < length && pos + i < text.size(); ++i)
+    {
+        auto const continuation = byte(pos + i);
+        if (i == 1 ? continuation < min || continuation > max : continuation < 0x80 || continuation > 0xBF)
+        {
+            return 0;
+        }
+    }
+    return length;
+}
+
+// Appends the characters of text[0, end) to the output, the invalid ones replaced
+void appendValidUtf8(std::string& output, std::string const& text, std::size_t end)
+{
+    for (std::size_t pos = 0; pos < end;)
+    {
+        auto const length = utf8CharLength(text, pos);
+        if (length == 0 || pos + length > end)
+        {
+            output += kReplacementCharacter;
+            ++pos;
+        }
+        else
+        {
+            output.append(text, pos, length);
+            pos += length;
+        }
+    }
+}
+
+// Decodes the code points of a UTF-8 string, nullopt if it is not valid
+std::optional<std::u32string> codePoints(std::string const& text)
+{
+    std::u32string result;
+    for (std::size_t pos = 0; pos < text.size();)
+    {
+        auto const length = utf8CharLength(text, pos);
+        if (length == 0 || pos + length > text.size())
+        {
+            return std::nullopt;
+        }
+        auto const lead = static_cast<unsigned char>(text[pos]);
+        char32_t codePoint = length == 1 ? lead : lead & (0x7F >> length);
+        for (std::size_t i = 1; i < length; ++i)
+        {
+            codePoint = (codePoint << 6) | (static_cast<unsigned char>(text[pos + i]) & 0x3F);
+        }
+        result.push_back(codePoint);
+        pos += length;
+    }
+    return result;
+}
+
+std::string byteLevelBytes(std::string const& token, std::unordered_map<char32_t, char> const& table)
+{
+    auto const chars = codePoints(token);
+    if (!chars)
+    {
+        return token;
+    }
+    std::string bytes;
+    for (auto const c : *chars)
+    {
+        auto const it = table.find(c);
+        if (it == table.end())
+        {
+            // Not produced by the byte-level BPE, kept as it is
+            return token;
+        }
+        bytes.push_back(it->second);
+    }
+    return bytes;
+}
+
+std::string metaspaceBytes(std::string const& token, bool byteFallback)
+{
+    // <0xAB>, a byte that is not in the vocabulary
+    if (byteFallback && token.size() == 6 && token.compare(0, 3, "<0x") == 0 && token.back() == '>')
+    {
+        return std::string(1, static_cast<char>(std::stoi(token.substr(3, 2), nullptr, 16)));
+    }
+    std::string bytes;
+    std::string_view const metaspace{kMetaspace};
+    for (std::size_t pos = 0; pos < token.size();)
+    {
+        if (token.compare(pos, metaspace.size(), metaspace) == 0)
+        {
+            bytes.push_back(' ');
+            pos += metaspace.size();
+        }
+        else
+        {
+            bytes.push_back(token[pos++]);
+        }
+    }
+    return bytes;
+}
+
+} // namespace
+
+Detokenizer Detokenizer::parse(std::string const& json)
+{
+    auto const tokenizer = nlohmann::json::parse(json);
+
+    DecoderConfig config;
+    auto const decoder = tokenizer.find("decoder");
+    if (decoder != tokenizer.end() && !decoder->is_null())
+    {
+        parseDecoder(*decoder, config);
+    }
+
+    // The vocabulary of BPE is a map of the tokens to their ids, the one of Unigram a list of tokens and scores
+    std::unordered_map<SizeType, std::string> vocab;
+    SizeType vocabSize = 0;
+    auto const& model = tokenizer.at("model");
+    auto const& modelVocab = model.at("vocab");
+    if (modelVocab.is_object())
+    {
+        for (auto const& [token, id] : modelVocab.items())
+        {
+            vocab.emplace(id.template get<SizeType>(), token);
+        }
+    }
+    else
+    {
+        for (auto const& entry : modelVocab)
+        {
+            vocab.emplace(static_cast<SizeType>(vocab.size()), entry.at(0).template get<std::string>());
+        }
+    }
+    config.byteFallback = config.byteFallback || model.value("byte_fallback", false);
+    for (auto const& [id, token] : vocab)
+    {
+        vocabSize = std::max(vocabSize, id + 1);
+    }
+
+    // The added tokens are decoded as they are
+    std::unordered_map<SizeType, std::optional<std::string>> added;
+    auto const addedTokens = tokenizer.find("added_tokens");
+    if (addedTokens != tokenizer.end() && addedTokens->is_array())
+    {
+        for (auto const& token : *addedTokens)
+        {
+            auto const id = token.at("id").template get<SizeType>();
+            auto content = token.at("content").template get<std::string>();
+            added[id] = token.value("special", false) ? std::nullopt : std::make_optional(std::move(content));
+            vocabSize = std::max(vocabSize, id + 1);
+        }
+    }
+
+    auto const table = config.kind == DecoderKind::kByteLevel ? byteLevelTable() : decltype(byteLevelTable()){};
+    std::vector<std::string> tokens(vocabSize);
+    for (auto const& [id, token] : vocab)
+    {
+        switch (config.kind)
+        {
+        case DecoderKind::kByteLevel: tokens[id] = byteLevelBytes(token, table); break;
+        case DecoderKind::kMetaspace: tokens[id] = metaspaceBytes(token, config.byteFallback); break;
+        case DecoderKind::kNone: tokens[id] = token; break;
+        }
+    }
+    for (auto const& [id, content] : added)
+    {
+        tokens[id] = content.value_or(std::string{});
+    }
+
+    return Detokenizer{std::move(tokens), config.stripLeadingSpace};
+}
+
+Detokenizer Detokenizer::parse(std::filesystem::path const& path)
+{
+    TLLM_CHECK_WITH_INFO(std::filesystem::exists(path), std::string("File does not exist: ") + path.string());
+    std::ifstream file(path);
+    std::string const json{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    return parse(json);
+}
+
+std::string Detokenizer::decode(TokenIdType const* tokens, std::size_t count) const
+{
+    Stream stream;
+    auto text = decode(stream, tokens, count);
+    return text + finish(stream);
+}
+
+std::string Detokenizer::decode(Stream& stream, TokenIdType const* tokens, std::size_t count) const
+{
+    auto& bytes = stream.pending;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto const id = tokens[i];
+        if (id < 0 || id >= getVocabSize())
+        {
+            continue;
+        }
+        auto const& token = mTokens[id];
+        auto const strip = mStripLeadingSpace && !stream.started && !token.empty() && token.front() == ' ';
+        bytes.append(token, strip ? 1 : 0);
+        stream.started = stream.started || !token.empty();
+    }
+
+    // Keeps the last character if the next tokens may complete it
+    auto end = bytes.size();
+    for (std::size_t back = 1; back <= std::min<std::size_t>(3, bytes.size()); ++back)
+    {
+        auto const pos = bytes.size() - back;
+        auto const lead = static_cast<unsigned char>(bytes[pos]);
+        if ((lead & 0xC0) != 0x80)
+        {
+            if (utf8CharLength(bytes, pos) > back)
+            {
+                end = pos;
+            }
+            break;
+        }
+    }
+
+    std::string text;
+    appendValidUtf8(text, bytes, end);
+    bytes.erase(0, end);
+    return text;
+}
+
+std::string Detokenizer::finish(Stream& stream) const
+{
+    std::string text;
+    appendValidUtf8(text, stream.pending, stream.pending.size());
+    stream.pending.clear();
+    return text;
+}
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/engineFile.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/utils/sessionUtils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#if !defined(_WIN32)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace tensorrt_llm::runtime;
+namespace tc = tensorrt_llm::common;
+
+namespace
+{
+
+char const* getLoadModeName(EngineFile::LoadMode mode)
+{
+    switch (mode)
+    {
+    case EngineFile::LoadMode::kMMAP: return "mmap";
+    case EngineFile::LoadMode::kDIRECT: return "direct";
+    case EngineFile::LoadMode::kAUTO: return "auto";
+    case EngineFile::LoadMode::kREAD: return "read";
+    }
+    return "unknown";
+}
+
+#if !defined(_WIN32)
+
+// Whether at least half of the file is in the page cache
+bool isCached(int fd, std::size_t size)
+{
+    auto const pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    // Checked in chunks to bound the residency vector
+    std::size_t constexpr kChunkSize = std::size_t{1} << 30;
+    std::vector<unsigned char> residency;
+    std::size_t numPages = 0;
+    std::size_t numCached = 0;
+    for (std::size_t offset = 0; offset < size; offset += kChunkSize)
+    {
+        auto const length = std::min(kChunkSize, size - offset);
+        auto* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(offset));
+        if (mapping == MAP_FAILED)
+        {
+            return true;
+        }
+        residency.resize((length + pageSize - 1) / pageSize);
+        auto const status = mincore(mapping, length, residency.data());
+        munmap(mapping, length);
+        if (status != 0)
+        {
+            return true;
+        }
+        numPages += residency.size();
+        numCached += static_cast<std::size_t>(
+            std::count_if(residency.begin(), residency.end(), [](unsigned char page) { return (page & 1) != 0; }));
+    }
+    return 2 * numCached >= numPages;
+}
+
+#endif
+
+} // namespace
+
+EngineFile::LoadMode EngineFile::parseLoadMode(std::string const& name)
+{
+    for (auto const mode : {LoadMode::kMMAP, LoadMode::kDIRECT, LoadMode::kAUTO, LoadMode::kREAD})
+    {
+        if (name == getLoadModeName(mode))
+        {
+            return mode;
+        }
+    }
+    if (!name.empty())
+    {
+        TLLM_LOG_WARNING("Unknown engine load mode %s, the engine is memory mapped", name.c_str());
+    }
+    return LoadMode::kMMAP;
+}
+
+EngineFile::EngineFile(std::string const& path)
+    : EngineFile(path, parseLoadMode(tc::getEnvEngineLoadMode()))
+{
+}
+
+EngineFile::EngineFile(std::string const& path, LoadMode mode)
+{
+    auto const start = std::chrono::steady_clock::now();
+#if defined(_WIN32)
+    mode = LoadMode::kREAD;
+#endif
+    if (mode == LoadMode::kREAD)
+    {
+        read(path);
+    }
+#if !defined(_WIN32)
+    else
+    {
+        auto const fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        TLLM_CHECK_WITH_INFO(fd >= 0, "Error opening engine file %s: %s", path.c_str(), std::strerror(errno));
+        struct stat status;
+        if (fstat(fd, &status) != 0 || status.st_size <= 0)
+        {
+            close(fd);
+            TLLM_THROW("Error loading engine file %s: the file is empty or cannot be read", path.c_str());
+        }
+        mSize = static_cast<std::size_t>(status.st_size);
+        if (mode == LoadMode::kAUTO)
+        {
+            mode = isCached(fd, mSize) ? LoadMode::kMMAP : LoadMode::kDIRECT;
+        }
+        if (mode != LoadMode::kDIRECT || !readDirect(path))
+        {
+            map(fd);
+        }
+        close(fd);
+    }
+#endif
+    auto const timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    TLLM_LOG_INFO("Loaded engine file %s (%zu MiB) with %s in %.0f ms", path.c_str(), mSize >> 20,
+        getLoadModeName(mMode), timeMs);
+}
+
+EngineFile::~EngineFile()
+{
+#if !defined(_WIN32)
+    if (mMapping != nullptr)
+    {
+        munmap(mMapping, mSize);
+    }
+#endif
+}
+
+void EngineFile::map([[maybe_unused]] int fd)
+{
+#if !defined(_WIN32)
+    // The pages are read ahead and mapped now, instead of faulted one by one while TensorRT deserializes the engine
+    auto flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+    flags |= MAP_POPULATE;
+#endif
+    auto* mapping = mmap(nullptr, mSize, PROT_READ, flags, fd, 0);
+    TLLM_CHECK_WITH_INFO(mapping != MAP_FAILED, "Error mapping engine file: %s", std::strerror(errno));
+    // The engine is read once from start to end, its pages can be reclaimed after they are read
+    madvise(mapping, mSize, MADV_SEQUENTIAL);
+    mMapping = mapping;
+    mData = mapping;
+    mMode = LoadMode::kMMAP;
+#endif
+}
+
+bool EngineFile::readDirect([[maybe_unused]] std::string const& path)
+{
+#if defined(_WIN32)
+    return false;
+#else
+    // Some file systems, such as tmpfs, do not support O_DIRECT
+    auto const fd = open(path.c_str(), O_RDONLY | O_DIRECT | O_CLOEXEC);
+    if (fd < 0)
+    {
+        TLLM_LOG_WARNING("Cannot open engine file %s with O_DIRECT, it is memory mapped: %s", path.c_str(),
+            std::strerror(errno));
+        return false;
+    }
+    // O_DIRECT needs the buffer, the offsets and the sizes aligned to the logical block size
+    std::size_t constexpr kAlignment = 4096;
+    std::size_t constexpr kChunkSize = std::size_t{64} << 20;
+    auto const capacity = (mSize + kAlignment - 1) / kAlignment * kAlignment;
+    void* buffer = nullptr;
+    if (posix_memalign(&buffer, kAlignment, capacity) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    mAligned.reset(static_cast<std::uint8_t*>(buffer));
+    std::size_t offset = 0;
+    while (offset < mSize)
+    {
+        auto const count = pread(fd, mAligned.get() + offset, std::min(kChunkSize, capacity - offset),
+            static_cast<off_t>(offset));
+        if (count < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (count <= 0)
+        {
+            break;
+        }
+        offset += static_cast<std::size_t>(count);
+    }
+    auto const error = errno;
+    close(fd);
+    if (offset < mSize)
+    {
+        TLLM_LOG_WARNING("Error reading engine file %s with O_DIRECT, it is memory mapped: %s", path.c_str(),
+            std::strerror(error));
+        mAligned.reset();
+        return false;
+    }
+    mData = mAligned.get();
+    mMode = LoadMode::kDIRECT;
+    return true;
+#endif
+}
+
+void EngineFile::read(std::string const& path)
+{
+    mBuffer = utils::loadEngine(path);
+    mData = mBuffer.data();
+    mSize = mBuffer.size();
+    mMode = LoadMode::kREAD;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/engineWeights.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/engineFile.h"
+
+#include <chrono>
+#include <cstring>
+#include <nlohmann/json.hpp>
+#include <utility>
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+// The safetensors types TensorRT can refit
+std::pair<char const*, nvinfer1::DataType> constexpr kDataTypes[] = {
+    {"F32", nvinfer1::DataType::kFLOAT},
+    {"F16", nvinfer1::DataType::kHALF},
+    {"BF16", nvinfer1::DataType::kBF16},
+    {"F8_E4M3", nvinfer1::DataType::kFP8},
+    {"I32", nvinfer1::DataType::kINT32},
+    {"I8", nvinfer1::DataType::kINT8},
+    {"U8", nvinfer1::DataType::kUINT8},
+    {"BOOL", nvinfer1::DataType::kBOOL},
+};
+
+} // namespace
+
+nvinfer1::DataType EngineWeights::parseDataType(std::string const& name)
+{
+    for (auto const& [typeName, dataType] : kDataTypes)
+    {
+        if (name == typeName)
+        {
+            return dataType;
+        }
+    }
+    TLLM_THROW("Weights of type %s cannot be refitted", name.c_str());
+}
+
+EngineWeights::EngineWeights(std::string const& path, bool pinned)
+{
+    auto const start = std::chrono::steady_clock::now();
+    // A safetensors file is the size of its header as a little endian uint64, the header in JSON, then the data
+    mFile = std::make_unique<EngineFile>(path, EngineFile::LoadMode::kMMAP);
+    auto const* const bytes = static_cast<std::uint8_t const*>(mFile->data());
+    std::uint64_t headerSize{0};
+    TLLM_CHECK_WITH_INFO(mFile->size() >= sizeof(headerSize), "%s is not a safetensors file", path.c_str());
+    std::memcpy(&headerSize, bytes, sizeof(headerSize));
+    TLLM_CHECK_WITH_INFO(headerSize <= mFile->size() - sizeof(headerSize),
+        "The header of the safetensors file %s is truncated", path.c_str());
+    auto const* const data = bytes + sizeof(headerSize) + headerSize;
+    auto const dataSize = mFile->size() - sizeof(headerSize) - headerSize;
+    auto const header = nlohmann::json::parse(bytes + sizeof(headerSize), data);
+    mSize = dataSize;
+
+    auto const* values = data;
+    if (pinned)
+    {
+        mBuffer = BufferManager::pinned(dataSize);
+        std::memcpy(mBuffer->data(), data, dataSize);
+        values = static_cast<std::uint8_t const*>(mBuffer->data());
+        mFile.reset();
+    }
+
+    mWeights.reserve(header.size());
+    for (auto const& [name, info] : header.items())
+    {
+        if (name == "__metadata__")
+        {
+            continue;
+        }
+        auto const dataType = parseDataType(info.at("dtype").get<std::string>());
+        auto shape = info.at("shape").get<std::vector<std::int64_t>>();
+        auto const offsets = info.at("data_offsets").get<std::vector<std::size_t>>();
+        std::int64_t count{1};
+        for (auto const dim : shape)
+        {
+            count *= dim;
+        }
+        TLLM_CHECK_WITH_INFO(offsets.size() == 2 && offsets[0] <= offsets[1] && offsets[1] <= dataSize
+                && offsets[1] - offsets[0] == static_cast<std::size_t>(count) * BufferDataType(dataType).getSize(),
+            "The data of weights %s are out of the safetensors file %s", name.c_str(), path.c_str());
+        mWeights.push_back(Weights{name, dataType, std::move(shape), count, values + offsets[0]});
+    }
+
+    auto const timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    TLLM_LOG_INFO(
+        "Read %zu weights (%zu MiB) from %s in %.0f ms", mWeights.size(), dataSize >> 20, path.c_str(), timeMs);
+}
+
+EngineWeights::~EngineWeights() = default;
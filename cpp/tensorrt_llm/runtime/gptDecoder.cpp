@@ -49,12 +49,20 @@ GptDecoder<T>::GptDecoder(size_t vocabSize, size_t vocabSizePadded, CudaStreamPt
 
 template <typename T>
 void GptDecoder<T>::setup(SamplingConfig const& samplingConfig, size_t batchSize, SizeType maxSequenceLength)
+{
+    setup(samplingConfig, TruncationConfig{}, batchSize, maxSequenceLength);
+}
+
+template <typename T>
+void GptDecoder<T>::setup(SamplingConfig const& samplingConfig, TruncationConfig const& truncationConfig,
+    size_t batchSize, SizeType maxSequenceLength, std::optional<std::vector<SizeType>> const& seedSlots)
 {
     mSamplingConfig = samplingConfig;
 
     typename layers::DynamicDecodeLayer<T>::SetupParams setupParams;
 
     setupParams.randomSeed = samplingConfig.randomSeed;
+    setupParams.random_seed_slots = seedSlots;
 
     setupParams.repetition_penalty = samplingConfig.repetitionPenalty;
     setupParams.presence_penalty = samplingConfig.presencePenalty;
@@ -74,6 +82,8 @@ void GptDecoder<T>::setup(SamplingConfig const& samplingConfig, size_t batchSize
     setupParams.top_p_decay = samplingConfig.topPDecay;
     setupParams.top_p_min = samplingConfig.topPMin;
     setupParams.top_p_reset_ids = samplingConfig.topPResetIds;
+    setupParams.runtime_min_p = truncationConfig.minP;
+    setupParams.runtime_typical_p = truncationConfig.typicalP;
 
     setupParams.beam_search_diversity_rate = samplingConfig.beamSearchDiversityRate;
     setupParams.length_penalty = samplingConfig.lengthPenalty;
@@ -140,6 +150,11 @@ typename tl::DynamicDecodeLayer<T>::ForwardParams prepareInputs(DecodingInput co
         forwardParams.finished = tcc::toTllmTensor(*input.finished);
     }
 
+    if (input.logitsBitmask)
+    {
+        forwardParams.logits_bitmask = tcc::toTllmTensor(*input.logitsBitmask);
+    }
+
     return forwardParams;
 }
 
@@ -444,3 +459,37 @@ void IGptDecoder::acceptDraftTokensByLogits(ITensor& draftLogits, const ITensor&
 
     TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
 }
+
+namespace
+{
+//! The setups that are not part of the IGptDecoder interface are reached through the GptDecoder types of `create`.
+void setupGptDecoder(IGptDecoder& decoder, SamplingConfig const& samplingConfig,
+    TruncationConfig const& truncationConfig, size_t batchSize, SizeType maxSequenceLength,
+    std::optional<std::vector<SizeType>> const& seedSlots)
+{
+    if (auto* floatDecoder = dynamic_cast<GptDecoder<float>*>(&decoder))
+    {
+        floatDecoder->setup(samplingConfig, truncationConfig, batchSize, maxSequenceLength, seedSlots);
+    }
+    else if (auto* halfDecoder = dynamic_cast<GptDecoder<half>*>(&decoder))
+    {
+        halfDecoder->setup(samplingConfig, truncationConfig, batchSize, maxSequenceLength, seedSlots);
+    }
+    else
+    {
+        TLLM_THROW("The decoder must be created by IGptDecoder::create");
+    }
+}
+} // namespace
+
+void IGptDecoder::setupSeedSlots(IGptDecoder& decoder, SamplingConfig const& samplingConfig, size_t batchSize,
+    SizeType maxSequenceLength, std::vector<SizeType> const& seedSlots)
+{
+    setupGptDecoder(decoder, samplingConfig, TruncationConfig{}, batchSize, maxSequenceLength, seedSlots);
+}
+
+void IGptDecoder::setupTruncated(IGptDecoder& decoder, SamplingConfig const& samplingConfig,
+    TruncationConfig const& truncationConfig, size_t batchSize, SizeType maxSequenceLength)
+{
+    setupGptDecoder(decoder, samplingConfig, truncationConfig, batchSize, maxSequenceLength, std::nullopt);
+}
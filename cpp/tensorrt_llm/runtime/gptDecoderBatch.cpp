@@ -16,10 +16,12 @@
 #include "tensorrt_llm/runtime/gptDecoderBatch.h"
 
 #include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/nvtxUtils.h"
 #include "tensorrt_llm/kernels/decodingCommon.h"
 #include "tensorrt_llm/runtime/bufferManager.h"
 #include "tensorrt_llm/runtime/cudaEvent.h"
 #include "tensorrt_llm/runtime/runtimeKernels.h"
+#include "tensorrt_llm/runtime/tensorSpan.h"
 
 #include <algorithm>
 #include <memory>
@@ -69,6 +71,27 @@ SamplingConfig extractSamplingConfig(SamplingConfig const& batchSamplingConfig,
     return samplingConfig;
 }
 
+TruncationConfig extractTruncationConfig(TruncationConfig const& batchTruncationConfig, SizeType batchIdx)
+{
+    TruncationConfig truncationConfig;
+
+    auto extractOptional = [&batchIdx](auto& single, auto const& batch)
+    {
+        using T = typename std::remove_reference_t<decltype(batch)>::value_type;
+        if (batch)
+        {
+            if (batch->size() > 1)
+                single.emplace(T{batch->at(batchIdx)});
+            else
+                single.emplace(T{batch->at(0)});
+        }
+    };
+
+    extractOptional(truncationConfig.minP, batchTruncationConfig.minP);
+    extractOptional(truncationConfig.typicalP, batchTruncationConfig.typicalP);
+    return truncationConfig;
+}
+
 } // namespace
 
 GptDecoderBatch::GptDecoderBatch(
@@ -382,6 +405,7 @@ GptDecoderBatch::TokenPtr GptDecoderBatch::forwardAsync(
     decoder_batch::Output& output, decoder_batch::Input const& input)
 {
     TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    NVTX3_SCOPED_RANGE_IN(decoder_forward, Decode, mActualBatchSize);
     auto& allTargetLogits = input.logits;
 
     // TODO(nkorobov): check logits shape considering draft tokens
@@ -431,29 +455,27 @@ GptDecoderBatch::TokenPtr GptDecoderBatch::forwardAsync(
 
         if (mGeneratedTokensPerStep[bi] > 1 && mAcceptByLogits[bi])
         {
-            auto numDraftTokens = ITensor::slice(mNumDraftTokens, bi, singleRequest);
-            auto const curandStatesView = ITensor::slice(mCurandStates, bi, singleRequest);
-            auto curandState = reinterpret_cast<curandState_t*>(bufferCast<int8_t>(*curandStatesView));
+            TensorSpan numDraftTokens(*mNumDraftTokens, bi, singleRequest);
+            TensorSpan curandStatesView(*mCurandStates, bi, singleRequest);
+            auto curandState = reinterpret_cast<curandState_t*>(bufferCast<int8_t>(curandStatesView));
             auto const& samplingConfig = decoder.getSamplingConfig();
             const bool useRandomAcceptanceThreshold = !samplingConfig.draftAcceptanceThreshold.has_value();
             const float randomAcceptanceThreshold
                 = useRandomAcceptanceThreshold ? 0 : samplingConfig.draftAcceptanceThreshold.value()[0];
 
-            TensorPtr draftProbs = ITensor::slice(mDraftProbs, bi, singleRequest);
-            TensorPtr targetProbs = ITensor::slice(mTargetProbs, bi, singleRequest);
-            draftProbs = ITensor::view(draftProbs,
-                ITensor::makeShape(
-                    {mMaxTokensPerStep - 1, singleRequest, mBeamWidths[bi], static_cast<SizeType>(mVocabSizePadded)}));
-            targetProbs = ITensor::view(targetProbs,
-                ITensor::makeShape(
-                    {mMaxTokensPerStep, singleRequest, mBeamWidths[bi], static_cast<SizeType>(mVocabSizePadded)}));
+            TensorSpan draftProbs(*mDraftProbs, bi, singleRequest);
+            TensorSpan targetProbs(*mTargetProbs, bi, singleRequest);
+            draftProbs.reshape(ITensor::makeShape(
+                {mMaxTokensPerStep - 1, singleRequest, mBeamWidths[bi], static_cast<SizeType>(mVocabSizePadded)}));
+            targetProbs.reshape(ITensor::makeShape(
+                {mMaxTokensPerStep, singleRequest, mBeamWidths[bi], static_cast<SizeType>(mVocabSizePadded)}));
 
             IGptDecoder::acceptDraftTokensByLogits(
                 /* [num_draft_tokens, bs, bw, vocabPadded] */ *mDraftLogits[bi],
                 /* [num_draft_tokens+1, bs, bw, vocabPadded] */ *targetLogits,
-                /* [max_draft_tokens, bs, bw, vocabPadded] */ *draftProbs,
-                /* [max_tokens_per_step, bs, bw, vocabPadded] */ *targetProbs,
-                /* [bs, bw] */ *numDraftTokens,
+                /* [max_draft_tokens, bs, bw, vocabPadded] */ draftProbs,
+                /* [max_tokens_per_step, bs, bw, vocabPadded] */ targetProbs,
+                /* [bs, bw] */ numDraftTokens,
                 /* [max_tokens_per_step, bs, bw] */ *finishedSteps, static_cast<SizeType>(mVocabSize),
                 static_cast<SizeType>(mVocabSizePadded), useRandomAcceptanceThreshold, randomAcceptanceThreshold,
                 curandState, stream);
@@ -471,6 +493,7 @@ GptDecoderBatch::TokenPtr GptDecoderBatch::forwardAsync(
 
         auto sequenceLengthsView = std::shared_ptr(ITensor::slice(sequenceLengths, bi, singleRequest));
         dOutput.lengths = ITensor::view(sequenceLengthsView, ITensor::makeShape({singleRequest, mBeamWidths[bi]}));
+        dInput.logitsBitmask = input.logitsBitmask ? ITensor::slice(input.logitsBitmask, bi, singleRequest) : nullptr;
 
         for (std::int32_t di = 0; di < mGeneratedTokensPerStep[bi]; ++di)
         {
@@ -489,17 +512,17 @@ GptDecoderBatch::TokenPtr GptDecoderBatch::forwardAsync(
         if (mGeneratedTokensPerStep[bi] > 1 && !mAcceptByLogits[bi])
         {
             auto draftTokenIds = mDraftTokenIds[bi];
-            auto numDraftTokens = ITensor::slice(mNumDraftTokens, bi, singleRequest);
+            TensorSpan numDraftTokens(*mNumDraftTokens, bi, singleRequest);
             // Update finished state for 0th step
-            auto finishedFinal = ITensor::slice(finishedSteps, 0, 1);
+            TensorSpan finishedFinal(*finishedSteps, 0, 1);
             IGptDecoder::acceptDraftTokensByIds(
                 /* [bs=1, bw=1, max_seq_len] */ *dOutput.ids,
                 /* [bs, bw, max_draft_tokens] */ *draftTokenIds,
                 /* [bs, bw] */ *dInput.lengths,
-                /* [bs, bw] */ *numDraftTokens,
+                /* [bs, bw] */ numDraftTokens,
                 /* [bs, bw] */ *dOutput.lengths,
                 /* [max_tokens_per_step, bs, bw] */ *finishedSteps,
-                /* [bs, bw] */ *finishedFinal,
+                /* [bs, bw] */ finishedFinal,
                 /* [1] */ *dOutput.finishedSum, stream);
         }
 
@@ -526,7 +549,7 @@ void GptDecoderBatch::forwardSync(decoder_batch::Token const& token)
             auto& dOutput = *mDecodingOutputs[i];
             mFinished[i] = mFinished[i]
                 // This condition requires the synchronization above
-                || *bufferCast<SizeType>(*dOutput.finishedSum) == static_cast<SizeType>(dOutput.lengths->getSize());
+                || *bufferCast<SizeType>(*dOutput.finishedSum) == mBeamWidths[i];
         }
     }
     TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
@@ -631,6 +654,24 @@ void GptDecoderBatch::newBatch(
     TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
 }
 
+void GptDecoderBatch::newBatch(GenerationInput const& inputs, GenerationOutput const& outputs,
+    SamplingConfig const& samplingConfig, TruncationConfig const& truncationConfig)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    newBatch(inputs, outputs, samplingConfig);
+    if (!truncationConfig.empty())
+    {
+        // the decoders of the new requests are set up again with their min-p and typical-p
+        for (SizeType batchIdx = 0; batchIdx < mActualBatchSize; ++batchIdx)
+        {
+            auto& decoder = *mDecoders[batchIdx];
+            IGptDecoder::setupTruncated(decoder, decoder.getSamplingConfig(),
+                extractTruncationConfig(truncationConfig, batchIdx), 1, mMaxSequenceLength);
+        }
+    }
+    TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
+}
+
 void GptDecoderBatch::forwardAsync(decoder::Output& output, decoder::Input const& input)
 {
     TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
@@ -649,6 +690,7 @@ void GptDecoderBatch::forwardAsync(decoder::Output& output, decoder::Input const
 
     decoder_batch::Input batchInput{logits};
     batchInput.cacheIndirection = input.cacheIndirection;
+    batchInput.logitsBitmask = input.logitsBitmask;
 
     decoder_batch::Output batchOutput;
     batchOutput.cacheIndirection = output.cacheIndirection;
@@ -656,7 +698,8 @@ void GptDecoderBatch::forwardAsync(decoder::Output& output, decoder::Input const
 
     mForwardToken = forwardAsync(batchOutput, batchInput);
     mBufferManager.setZero(*mFinishedSum);
-    kernels::reduce(*mFinishedSum, *ITensor::slice(mJointDecodingOutput->finishedSum, 0, mActualBatchSize), *mStream);
+    TensorSpan const finishedSum(*mJointDecodingOutput->finishedSum, 0, mActualBatchSize);
+    kernels::reduce(*mFinishedSum, finishedSum, *mStream);
     mStream->record(mForwardEvent);
 
     TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
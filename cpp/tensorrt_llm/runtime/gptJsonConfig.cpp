@@ -17,11 +17,16 @@
 #include "tensorrt_llm/runtime/gptJsonConfig.h"
 
 #include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
 #include "tensorrt_llm/common/stringUtils.h"
 
 #include <fstream>
+#include <functional>
+#include <iterator>
+#include <mutex>
 #include <nlohmann/json.hpp>
 #include <string_view>
+#include <unordered_map>
 
 using namespace tensorrt_llm::runtime;
 namespace tc = tensorrt_llm::common;
@@ -30,41 +35,38 @@ namespace
 {
 using Json = typename nlohmann::json::basic_json;
 
+// Missing fields are looked up instead of caught, an exception per missing field makes a parse slow
 template <typename FieldType>
 FieldType parseJsonFieldOr(Json const& json, std::string_view name, FieldType defaultValue)
 {
-    auto value = defaultValue;
-    try
+    auto const it = json.find(name);
+    if (it == json.end())
     {
-        value = json.at(name).template get<FieldType>();
+        TLLM_LOG_WARNING("Parameter %s cannot be read from json", std::string(name).c_str());
+        return defaultValue;
     }
-    catch (nlohmann::json::out_of_range& e)
-    {
-        TLLM_LOG_WARNING("Parameter %s cannot be read from json:", std::string(name).c_str());
-        TLLM_LOG_WARNING(e.what());
-    }
-    return value;
+    return it->template get<FieldType>();
 }
 
 template <typename FieldType>
 std::optional<FieldType> parseJsonFieldOptional(Json const& json, std::string_view name)
 {
-    std::optional<FieldType> value = std::nullopt;
-    try
+    auto const it = json.find(name);
+    if (it == json.end() || it->is_null())
     {
-        value = json.at(name).template get<FieldType>();
+        TLLM_LOG_WARNING("Optional value for parameter %s will not be set.", std::string(name).c_str());
+        return std::nullopt;
     }
-    catch (const nlohmann::json::out_of_range& e)
+    try
     {
-        TLLM_LOG_WARNING(e.what());
-        TLLM_LOG_WARNING("Optional value for parameter %s will not be set.", std::string(name).c_str());
+        return it->template get<FieldType>();
     }
     catch (const nlohmann::json::type_error& e)
     {
         TLLM_LOG_WARNING(e.what());
         TLLM_LOG_WARNING("Optional value for parameter %s will not be set.", std::string(name).c_str());
     }
-    return value;
+    return std::nullopt;
 }
 
 template <typename InputType>
@@ -125,6 +127,12 @@ GptJsonConfig parseJson(InputType&& i)
         auto const useContextFMHAForGeneration
             = pluginConfig.at("use_context_fmha_for_generation").template get<bool>();
         auto const pagedContextFMHA = pluginConfig.at("use_paged_context_fmha").template get<bool>();
+        // The blocks that slide out of the attention window are only released by the Python KV cache manager.
+        TLLM_CHECK_WITH_INFO(!parseJsonFieldOr(pluginConfig, "sliding_window_kv_cache", false),
+            "The sliding window KV cache is not supported by the C++ runtime");
+        // The blocks of the beams are only rebuilt from the block cache indirection by the Python KV cache manager.
+        TLLM_CHECK_WITH_INFO(!parseJsonFieldOr(pluginConfig, "block_cache_indirection", false),
+            "The block cache indirection is not supported by the C++ runtime");
 
         auto modelConfig = GptModelConfig{vocabSize, numLayers, numHeads, hiddenSize, dataType};
         modelConfig.useGptAttentionPlugin(useGptAttentionPlugin);
@@ -226,6 +234,7 @@ GptJsonConfig parseJson(InputType&& i)
 
         auto const computeContextLogits = parseJsonFieldOr(buildConfig, "gather_all_token_logits", false);
         auto const computeGenerationLogits = parseJsonFieldOr(buildConfig, "gather_all_token_logits", false);
+        auto const stripWeights = parseJsonFieldOr(buildConfig, "strip_weights", false);
 
         auto const& pluginConfig = buildConfig.at("plugin_config");
         auto const pagedKvCache = pluginConfig.at("paged_kv_cache");
@@ -264,7 +273,7 @@ GptJsonConfig parseJson(InputType&& i)
             // kGlm is only for ChatGLM-6B and GLM-10B
         }
 
-        return GptJsonConfig{name, engine_version, dtype, tpSize, ppSize, modelConfig};
+        return GptJsonConfig{name, engine_version, dtype, tpSize, ppSize, modelConfig, stripWeights};
     }
 }
 
@@ -287,6 +296,12 @@ std::string GptJsonConfig::engineFilename(WorldConfig const& worldConfig, std::s
     }
 }
 
+std::string GptJsonConfig::weightsFilename(WorldConfig const& worldConfig) const
+{
+    TLLM_CHECK_WITH_INFO(hasStrippedWeights(), "The engines are not built with strip_weights");
+    return "rank" + std::to_string(worldConfig.getRank()) + ".safetensors";
+}
+
 GptJsonConfig GptJsonConfig::parse(std::string const& json)
 {
     return parseJson(json);
@@ -300,6 +315,34 @@ GptJsonConfig GptJsonConfig::parse(std::istream& json)
 GptJsonConfig GptJsonConfig::parse(std::filesystem::path const& path)
 {
     TLLM_CHECK_WITH_INFO(std::filesystem::exists(path), std::string("File does not exist: ") + path.string());
-    std::ifstream json(path);
-    return parse(json);
+    std::ifstream file(path);
+    std::string const json{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+
+    // The configs parsed before are kept with the checksum of their file, a file parsed again, as by the sessions of
+    // each rank and of each model of a process, is only read and checksummed
+    struct CachedConfig
+    {
+        std::size_t size;
+        std::size_t checksum;
+        GptJsonConfig config;
+    };
+
+    static std::mutex mutex;
+    static std::unordered_map<std::string, CachedConfig> cache;
+    auto const key = std::filesystem::absolute(path).lexically_normal().string();
+    auto const checksum = std::hash<std::string>{}(json);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto const it = cache.find(key);
+        if (it != cache.end() && it->second.size == json.size() && it->second.checksum == checksum)
+        {
+            return it->second.config;
+        }
+    }
+
+    auto config = parseJson(json);
+    std::lock_guard<std::mutex> lock(mutex);
+    cache.erase(key);
+    cache.emplace(key, CachedConfig{json.size(), checksum, config});
+    return config;
 }
@@ -21,28 +21,128 @@
 
 #include "iBuffer.h"
 #include "tensorrt_llm/batch_manager/kvCacheManager.h"
+#include "tensorrt_llm/common/cpuAffinity.h"
+#include "tensorrt_llm/common/envUtils.h"
+#include "tensorrt_llm/common/nvtxUtils.h"
 #include "tensorrt_llm/common/stringUtils.h"
 #include "tensorrt_llm/kernels/decodingKernels.h"
+#include "tensorrt_llm/kernels/kvCacheScaleCalibration.h"
 #include "tensorrt_llm/runtime/gptDecoderBatch.h"
+#include "tensorrt_llm/runtime/gpuMetricsSampler.h"
 #include "tensorrt_llm/runtime/ipcUtils.h"
+#include "tensorrt_llm/runtime/jointGptDecoderBatch.h"
+#include "tensorrt_llm/runtime/memoryCounters.h"
 #include "tensorrt_llm/runtime/ncclCommunicator.h"
 #include "tensorrt_llm/runtime/runtimeBuffers.h"
 #include "tensorrt_llm/runtime/runtimeKernels.h"
+#include "tensorrt_llm/runtime/scratchArena.h"
 #include "tensorrt_llm/runtime/statefulGptDecoder.h"
+#include "tensorrt_llm/runtime/tensorSpan.h"
 #include "tensorrt_llm/runtime/tllmLogger.h"
+#include "tensorrt_llm/runtime/tokenConstraintMasks.h"
 #include "tensorrt_llm/runtime/tllmRuntime.h"
 #include "tensorrt_llm/runtime/utils/sessionUtils.h"
 
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <set>
+#include <thread>
+#include <unordered_map>
 
 using namespace tensorrt_llm::runtime;
 
 namespace tc = tensorrt_llm::common;
+namespace tk = tensorrt_llm::kernels;
 namespace bmkv = tensorrt_llm::batch_manager::kv_cache_manager;
 
+struct GptSession::State
+{
+    // input_ids, or hidden_states_input after the first pipeline stage
+    std::string tokensTensorName;
+    // in the order TllmRuntime::selectProfile() tries the profiles for the phase
+    std::vector<PhaseContext> contextPhaseContexts;
+    std::vector<PhaseContext> generationPhaseContexts;
+    // temporaries of the steps, shared by the micro batches
+    std::shared_ptr<ScratchArena> scratch;
+    // for each micro batch
+    std::vector<std::shared_ptr<TokenConstraintMasks>> tokenConstraintMasks;
+
+    SizeType stopCheckInterval{1};
+    bool balanceMicroBatches{false};
+    // 0 unless the engine recalibrates its KV cache scales
+    SizeType kvCacheScaleSampleInterval{0};
+    float kvCacheScaleMargin{1.F};
+    // steps run since the session was created, to sample the ones that collect the absmax
+    SizeType kvCacheScaleStep{0};
+    // ping-pong instances
+    std::vector<CudaGraphExecutorCache> cudaGraphInstances;
+    // The (batch size, beam width) of the generate calls, for saveWarmUpState
+    std::set<CudaGraphExecutorCache::BatchState> batchStates;
+
+    std::vector<common::CommIterationStats> commStats;
+    std::vector<float> stepTimesMs;
+    std::shared_ptr<GpuMetricsSampler> gpuMetricsSampler;
+    SpeculativeDecodingStats speculativeDecodingStats;
+
+    std::shared_ptr<GenerateWorker> generateWorker;
+};
+
+namespace
+{
+//! The states of the sessions, by the runtime of the session, which moves with it.
+template <typename State>
+class SessionStates
+{
+public:
+    static SessionStates& getInstance()
+    {
+        static SessionStates instance;
+        return instance;
+    }
+
+    void add(TllmRuntime const* runtime)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStates[runtime] = std::make_unique<State>();
+    }
+
+    [[nodiscard]] State& get(TllmRuntime const* runtime)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return *mStates.at(runtime);
+    }
+
+    //! The state is returned to be destroyed without the lock.
+    std::unique_ptr<State> remove(TllmRuntime const* runtime)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto const it = mStates.find(runtime);
+        auto state = std::move(it->second);
+        mStates.erase(it);
+        return state;
+    }
+
+private:
+    std::mutex mMutex;
+    std::unordered_map<TllmRuntime const*, std::unique_ptr<State>> mStates;
+};
+} // namespace
+
 GptSession::GptSession(Config const& sessionConfig, GptModelConfig const& modelConfig, WorldConfig const& worldConfig,
     void const* engineBuffer, std::size_t engineSize, LoggerPtr logger)
+    : GptSession(sessionConfig, Options{}, modelConfig, worldConfig, engineBuffer, engineSize, std::move(logger))
+{
+}
+
+GptSession::GptSession(Config const& sessionConfig, Options const& options, GptModelConfig const& modelConfig,
+    WorldConfig const& worldConfig, void const* engineBuffer, std::size_t engineSize, LoggerPtr logger)
     : mModelConfig{modelConfig}
     , mWorldConfig{worldConfig}
     , mDevice{utils::initDevice(worldConfig)}
@@ -52,6 +152,8 @@ GptSession::GptSession(Config const& sessionConfig, GptModelConfig const& modelC
     , mBuffers{}
     , mCudaGraphInstances{}
 {
+    SessionStates<State>::getInstance().add(mRuntime.get());
+
     if (mWorldConfig.isPipelineParallel())
     {
         mPipelineComm = std::make_shared<NcclCommunicator>(mWorldConfig);
@@ -63,7 +165,25 @@ GptSession::GptSession(Config const& sessionConfig, GptModelConfig const& modelC
 
     // TODO compare expected and runtime tensor names?
 
-    setup(sessionConfig);
+    setGpuMetricsInterval(tc::getEnvGpuMetricsInterval());
+    setup(sessionConfig, options);
+}
+
+GptSession::~GptSession()
+{
+    // moved from
+    if (!mRuntime)
+    {
+        return;
+    }
+    // Finish the pending calls before the other members are destroyed
+    getState().generateWorker.reset();
+    SessionStates<State>::getInstance().remove(mRuntime.get());
+}
+
+GptSession::State& GptSession::getState() const
+{
+    return SessionStates<State>::getInstance().get(mRuntime.get());
 }
 
 nvinfer1::ILogger& GptSession::getLogger() const
@@ -87,26 +207,74 @@ void GptSession::createContexts()
     mRuntime->clearContexts();
 
     auto const numProfiles = mRuntime->getNbProfiles();
-    TLLM_CHECK_WITH_INFO(
-        numProfiles == 1 || numProfiles == 2, "GPT only expects one optimization profile or two optimization profiles");
+    TLLM_CHECK_WITH_INFO(numProfiles >= 1, "GPT expects at least one optimization profile");
 
-    // Instantiate 1 execution context for each profile
+    // Instantiate 1 execution context for each profile, the context index is the profile index.
+    // Each step runs on the context of the profile that fits its input shapes best.
     for (auto contextId = 0; contextId < numProfiles; ++contextId)
     {
         mRuntime->addContext(contextId);
     }
 
+    // The profiles are ranked once, the steps only check the shape of their tokens
+    auto& state = getState();
+    state.contextPhaseContexts.clear();
+    state.generationPhaseContexts.clear();
+    if (numProfiles > 1)
+    {
+        state.tokensTensorName = mWorldConfig.isFirstPipelineParallelRank() ? "input_ids" : "hidden_states_input";
+        auto const& profileShapes = mRuntime->getProfileShapes(state.tokensTensorName);
+        auto const addPhaseContexts
+            = [this, &profileShapes](std::vector<PhaseContext>& phaseContexts, SizeType preferredProfile)
+        {
+            for (auto const profile : mRuntime->getProfileOrder(preferredProfile))
+            {
+                auto const& [minShape, maxShape] = profileShapes.at(profile);
+                phaseContexts.push_back(PhaseContext{profile, minShape, maxShape});
+            }
+        };
+        // the first profile is built for the context phase, the last one for the generation phase
+        addPhaseContexts(state.contextPhaseContexts, 0);
+        addPhaseContexts(state.generationPhaseContexts, numProfiles - 1);
+    }
+
     TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
 }
 
-void GptSession::createBuffers(SizeType numMicroBatches)
+SizeType GptSession::selectContext(
+    StringPtrMap<ITensor> const& inputBuffer, std::vector<PhaseContext> const& phaseContexts) const
+{
+    if (phaseContexts.empty())
+    {
+        return 0;
+    }
+    auto const shape = inputBuffer.at(getState().tokensTensorName)->getShape();
+    for (auto const& [contextId, minShape, maxShape] : phaseContexts)
+    {
+        auto fits = shape.nbDims == maxShape.nbDims;
+        for (std::int32_t i = 0; fits && i < shape.nbDims; ++i)
+        {
+            fits = minShape.d[i] <= shape.d[i] && shape.d[i] <= maxShape.d[i];
+        }
+        if (fits)
+        {
+            return contextId;
+        }
+    }
+    TLLM_THROW("No optimization profile of the engine fits the input shapes");
+}
+
+void GptSession::createBuffers(SizeType numMicroBatches, bool useBufferArena)
 {
     TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    MemoryCounters::TagScope const tagScope{MemoryTag::kRUNTIME_BUFFERS};
     mBuffers.clear();
 
     for (SizeType i = 0; i < numMicroBatches; ++i)
     {
         mBuffers.emplace_back(std::make_shared<RuntimeBuffers>());
+        mBuffers.back()->useArena = useBufferArena;
+        mBuffers.back()->scratch = getState().scratch;
         mBuffers.back()->create(*mRuntime, mModelConfig, mWorldConfig);
     }
     TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
@@ -119,15 +287,26 @@ void GptSession::createDecoders(SizeType batchSize, SizeType beamWidth, SizeType
     auto const vocabSize = mModelConfig.getVocabSize();
     auto const vocabSizePadded = mModelConfig.getVocabSizePadded(mWorldConfig.getSize());
     auto const& stream = mRuntime->getStreamPtr();
+    MemoryCounters::TagScope const tagScope{MemoryTag::kDECODER};
 
     mDecoders.clear();
 
     for (SizeType i = 0; i < numMicroBatches; ++i)
     {
-        if (decoderPerRequest)
+        if (decoderPerRequest && tc::getEnvBatchedDecoding())
+        {
+            mDecoders.emplace_back(std::make_shared<JointGptDecoderBatch>(vocabSize, vocabSizePadded, stream));
+        }
+        else if (decoderPerRequest)
+        {
             mDecoders.emplace_back(std::make_shared<GptDecoderBatch>(vocabSize, vocabSizePadded, stream));
+        }
         else
-            mDecoders.emplace_back(std::make_shared<StatefulGptDecoder>(vocabSize, vocabSizePadded, stream));
+        {
+            auto decoder = std::make_shared<StatefulGptDecoder>(vocabSize, vocabSizePadded, stream);
+            decoder->setScratchArena(getState().scratch);
+            mDecoders.emplace_back(std::move(decoder));
+        }
         constexpr SizeType maxTokensPerStep = 1;
         mDecoders.back()->setup(
             batchSize, beamWidth, maxAttentionWindow, maxSequenceLength, maxTokensPerStep, logitsType);
@@ -136,6 +315,22 @@ void GptSession::createDecoders(SizeType batchSize, SizeType beamWidth, SizeType
     TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
 }
 
+namespace
+{
+nvinfer1::DataType getKvCacheDataType(GptModelConfig const& modelConfig)
+{
+    if (modelConfig.getQuantMode().hasFp8KvCache())
+    {
+        return nvinfer1::DataType::kFP8;
+    }
+    if (modelConfig.getQuantMode().hasInt8KvCache())
+    {
+        return nvinfer1::DataType::kINT8;
+    }
+    return modelConfig.getDataType();
+}
+} // namespace
+
 void GptSession::createKvCacheManager(SizeType batchSize, SizeType beamWidth, SizeType maxAttentionWindow,
     SizeType maxSequenceLength, KvCacheConfig const& config)
 {
@@ -146,32 +341,86 @@ void GptSession::createKvCacheManager(SizeType batchSize, SizeType beamWidth, Si
     auto const hiddenSize = mModelConfig.getHiddenSize();
     auto const tokensPerBlock = mModelConfig.getTokensPerBlock();
 
-    nvinfer1::DataType kvDtype;
-    if (mModelConfig.getQuantMode().hasFp8KvCache())
-    {
-        kvDtype = nvinfer1::DataType::kFP8;
-    }
-    else if (mModelConfig.getQuantMode().hasInt8KvCache())
-    {
-        kvDtype = nvinfer1::DataType::kINT8;
-    }
-    else
+    auto const kvDtype = getKvCacheDataType(mModelConfig);
+    auto maxNumTokens
+        = bmkv::KVCacheManager::getMaxNumTokens(config, kvDtype, mModelConfig, mWorldConfig, getBufferManager());
+
+    // With KV cache block scaling, every K and V block is followed by one fp32 scale per KV head. Allocating the
+    // blocks with one extra element per head and token reserves numKvHeads * tokensPerBlock bytes for that sidecar.
+    auto kvHiddenSize = hiddenSize;
+    if (mModelConfig.getQuantMode().hasKvCacheBlockScaling())
     {
-        kvDtype = mModelConfig.getDataType();
+        TLLM_CHECK_WITH_INFO(tokensPerBlock >= static_cast<SizeType>(sizeof(float)),
+            "KV cache block scaling requires at least %zu tokens per block", sizeof(float));
+        auto const sizePerHead = mModelConfig.getSizePerHead();
+        kvHiddenSize = hiddenSize + nbHeads;
+        maxNumTokens = maxNumTokens * sizePerHead / (sizePerHead + 1);
     }
-
-    auto const maxNumTokens
-        = bmkv::KVCacheManager::getMaxNumTokens(config, kvDtype, mModelConfig, mWorldConfig, getBufferManager());
     TLLM_LOG_INFO("Using %d tokens in paged KV cache.", maxNumTokens);
     auto const maxNumBlocks = tc::ceilDiv(maxNumTokens, tokensPerBlock);
     auto const maxBlocksPerSeq = tc::ceilDiv(std::min(maxSequenceLength, maxAttentionWindow), tokensPerBlock);
 
+    MemoryCounters::TagScope const tagScope{MemoryTag::kKV_CACHE};
     mKvCacheManager
-        = std::make_shared<bmkv::KVCacheManager>(localNbLayers, nbHeads, nbKvHeads, hiddenSize, tokensPerBlock,
+        = std::make_shared<bmkv::KVCacheManager>(localNbLayers, nbHeads, nbKvHeads, kvHiddenSize, tokensPerBlock,
             maxNumBlocks, batchSize, beamWidth, maxBlocksPerSeq, maxAttentionWindow, kvDtype, mRuntime->getStreamPtr());
     TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
 }
 
+void GptSession::calibrateKvCache(SizeType batchSize, SizeType beamWidth, SizeType maxAttentionWindow,
+    SizeType maxSequenceLength, SizeType inputLength, KvCacheConfig const& config, std::size_t margin)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    auto& manager = mRuntime->getBufferManager();
+    auto const& stream = mRuntime->getStream();
+
+    // A full batch of the longest inputs, the end id is never sampled so that a generation step follows the context
+    std::size_t transientSize{0};
+    {
+        std::vector<SizeType> inputLengthsHost(batchSize, inputLength);
+        auto inputLengths = manager.copyFrom(inputLengthsHost, ITensor::makeShape({batchSize}), MemoryType::kGPU);
+        auto inputIds = manager.gpu(ITensor::makeShape({batchSize, inputLength}), nvinfer1::DataType::kINT32);
+        manager.setZero(*inputIds);
+        GenerationInput inputs{-1, 0, std::move(inputIds), std::move(inputLengths), false};
+        inputs.maxNewTokens = 2;
+        GenerationOutput outputs{manager.emptyTensor(MemoryType::kGPU, nvinfer1::DataType::kINT32),
+            manager.emptyTensor(MemoryType::kGPU, nvinfer1::DataType::kINT32)};
+
+        manager.memoryPoolResetUsedHigh();
+        generate(outputs, inputs, SamplingConfig{beamWidth});
+        stream.synchronize();
+        // The buffers grown by the step stay allocated, only the memory freed during the step is needed again
+        transientSize = manager.memoryPoolUsedHigh() - manager.memoryPoolUsed();
+    }
+
+    mKvCacheManager.reset();
+    manager.memoryPoolTrimTo(0);
+    std::size_t freeMem{0};
+    std::size_t totalMem{0};
+    TLLM_CUDA_CHECK(cudaMemGetInfo(&freeMem, &totalMem));
+    TLLM_CHECK_WITH_INFO(freeMem > transientSize + margin,
+        "No memory left for the KV cache: %s free, the worst-case step needs %s and the margin is %s",
+        MemoryCounters::bytesToString(freeMem).c_str(), MemoryCounters::bytesToString(transientSize).c_str(),
+        MemoryCounters::bytesToString(margin).c_str());
+
+    auto const cacheSizePerToken = bmkv::KVCacheManager::calculateCacheSizePerToken(mModelConfig, mWorldConfig);
+    auto const bytesPerToken
+        = static_cast<std::size_t>(cacheSizePerToken) * BufferDataType(getKvCacheDataType(mModelConfig)).getSize();
+    auto const calibratedTokens = static_cast<SizeType>(std::min<std::size_t>(
+        (freeMem - transientSize - margin) / bytesPerToken, std::numeric_limits<SizeType>::max()));
+    TLLM_LOG_INFO("KV cache calibration: %s free after the worst-case step, which needs %s more, %d tokens fit",
+        MemoryCounters::bytesToString(freeMem).c_str(), MemoryCounters::bytesToString(transientSize).c_str(),
+        calibratedTokens);
+
+    // The whole free memory, maxTokens is the bound
+    auto calibratedConfig = config;
+    calibratedConfig.maxTokens
+        = config.maxTokens.has_value() ? std::min(config.maxTokens.value(), calibratedTokens) : calibratedTokens;
+    calibratedConfig.freeGpuMemoryFraction = 1.0F;
+    createKvCacheManager(batchSize, beamWidth, maxAttentionWindow, maxSequenceLength, calibratedConfig);
+    TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
+}
+
 void GptSession::createCustomAllReduceWorkspace(
     SizeType maxBatchSize, SizeType maxBeamWidth, SizeType maxSequenceLength)
 {
@@ -220,11 +469,29 @@ GptSession::MicroBatchConfig::MicroBatchConfig(SizeType maxBatchSize, SizeType p
     }
 }
 
-void GptSession::setup(Config const& sessionConfig)
+void GptSession::setup(Config const& sessionConfig, Options const& options)
 {
     TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
 
+    auto& state = getState();
     mCudaGraphMode = sessionConfig.cudaGraphMode;
+    state.balanceMicroBatches = options.balanceMicroBatches;
+    if (mModelConfig.getQuantMode().hasKvCacheOnlineScaling())
+    {
+        TLLM_CHECK_WITH_INFO(options.kvCacheScaleSampleInterval >= 0 && options.kvCacheScaleMargin > 0.F,
+            "KV cache scale sample interval must not be negative and the margin must be positive");
+        state.kvCacheScaleSampleInterval = options.kvCacheScaleSampleInterval;
+        state.kvCacheScaleMargin = options.kvCacheScaleMargin;
+    }
+
+    if (!options.gatherContextLogits && mModelConfig.computeContextLogits())
+    {
+        // the engine then gets the positions of the last tokens, as if built without gather_all_token_logits
+        TLLM_CHECK_WITH_INFO(!mWorldConfig.isLastPipelineParallelRank()
+                || mRuntime->getEngine().getTensorIOMode("last_token_ids") == nvinfer1::TensorIOMode::kINPUT,
+            "The engine computes the logits of all the context tokens, rebuild it with packed inputs to skip them");
+        mModelConfig.computeContextLogits(false);
+    }
 
     auto const maxBatchSize = sessionConfig.maxBatchSize;
     auto const maxBeamWidth = sessionConfig.maxBeamWidth;
@@ -238,11 +505,58 @@ void GptSession::setup(Config const& sessionConfig)
 
     if (sessionConfig.cudaGraphMode)
     {
+        TLLM_CHECK_WITH_INFO(options.cudaGraphCacheSize > 0, "CUDA graph cache size must be positive");
         // Instantiate 2 graph instances for flip-flopping of each generation batch
-        mCudaGraphInstances.resize(2 * mMicroBatchConfig.numGenBatches);
+        auto const numInstances = 2 * mMicroBatchConfig.numGenBatches;
+        state.cudaGraphInstances.reserve(numInstances);
+        for (SizeType i = 0; i < numInstances; ++i)
+        {
+            state.cudaGraphInstances.emplace_back(options.cudaGraphCacheSize);
+        }
+    }
+    TLLM_CHECK_WITH_INFO(!options.memoryPoolConfig || !options.gpuAllocator,
+        "A memory pool config and a GPU allocator cannot be used together");
+    if (options.memoryPoolConfig)
+    {
+        mRuntime->setMemoryPoolConfig(*options.memoryPoolConfig);
+    }
+    if (options.gpuAllocator)
+    {
+        mRuntime->setGpuAllocator(options.gpuAllocator);
+    }
+    if (options.weightsFile)
+    {
+        mRuntime->refit(EngineWeights{*options.weightsFile, false});
+    }
+    if (options.gpuWeightsPercent < 1.0F)
+    {
+        mRuntime->setGpuWeightsPercent(options.gpuWeightsPercent);
     }
     createContexts();
-    createBuffers(mMicroBatchConfig.numGenBatches);
+    {
+        MemoryCounters::TagScope const tagScope{MemoryTag::kSCRATCH};
+        state.scratch = std::make_shared<ScratchArena>(mRuntime->getBufferManager());
+    }
+    createBuffers(mMicroBatchConfig.numGenBatches, options.bufferArenaMode);
+
+    auto const reshapeBuffers = [this, maxBeamWidth, maxAttentionWindow, maxSequenceLength]()
+    {
+        auto const& manager = mRuntime->getBufferManager();
+        MemoryCounters::TagScope const tagScope{MemoryTag::kRUNTIME_BUFFERS};
+        for (auto& buffers : mBuffers)
+        {
+            // we don't know maxInputLength yet and ignore it for pre-allocation
+            buffers->generationConfig = RuntimeBuffers::GenerationConfig{
+                mMicroBatchConfig.genBatchSize, maxBeamWidth, 0, maxAttentionWindow, maxSequenceLength};
+            buffers->reshape(manager, mModelConfig, mWorldConfig);
+        }
+    };
+    // The arena is allocated before the KV cache manager sizes the cache from the free memory, so that the cache gets
+    // the memory the arena saves
+    if (options.bufferArenaMode)
+    {
+        reshapeBuffers();
+    }
 
     // Store this param related to decoder buffer size and kv cache manager to check against
     // the input shape with the params given in generate().
@@ -251,13 +565,38 @@ void GptSession::setup(Config const& sessionConfig)
     mDecoderMaxSequenceLength = maxSequenceLength;
     mDecoderMaxAttentionWindow = maxAttentionWindow;
 
-    if (mModelConfig.usePagedKvCache())
+    auto const calibrateKvCacheSize = mModelConfig.usePagedKvCache() && options.kvCacheCalibrationMode;
+    auto const maxInputLength = mModelConfig.getMaxInputLen();
+    auto const calibrationInputLength
+        = std::min(maxInputLength > 0 ? maxInputLength : maxSequenceLength, maxSequenceLength - 2);
+    if (calibrateKvCacheSize)
+    {
+        TLLM_CHECK_WITH_INFO(calibrationInputLength > 0,
+            "KV cache calibration needs a max sequence length of at least 3, got %d", maxSequenceLength);
+        // Only the blocks of the worst-case step, the cache is sized by calibrateKvCache at the end of the setup
+        auto const tokensPerBlock = mModelConfig.getTokensPerBlock();
+        auto const blocksPerSequence
+            = tc::ceilDiv(std::min(calibrationInputLength + 2, maxAttentionWindow), tokensPerBlock);
+        auto calibrationTokens = maxBatchSize * maxBeamWidth * blocksPerSequence * tokensPerBlock;
+        if (mModelConfig.getQuantMode().hasKvCacheBlockScaling())
+        {
+            // createKvCacheManager leaves a part of the tokens to the scales
+            auto const sizePerHead = mModelConfig.getSizePerHead();
+            calibrationTokens = tc::ceilDiv(calibrationTokens * (sizePerHead + 1), sizePerHead);
+        }
+        auto calibrationConfig = sessionConfig.kvCacheConfig;
+        calibrationConfig.maxTokens = calibrationTokens;
+        calibrationConfig.freeGpuMemoryFraction = 1.0F;
+        createKvCacheManager(maxBatchSize, maxBeamWidth, maxAttentionWindow, maxSequenceLength, calibrationConfig);
+    }
+    else if (mModelConfig.usePagedKvCache())
     {
         createKvCacheManager(
             maxBatchSize, maxBeamWidth, maxAttentionWindow, maxSequenceLength, sessionConfig.kvCacheConfig);
     }
 
-    if (mWorldConfig.isLastPipelineParallelRank())
+    // Engines that skip the LM head only encode, they need no decoder
+    if (mWorldConfig.isLastPipelineParallelRank() && !mBuffers.front()->returnsHiddenStates)
     {
         auto const logitsType = mRuntime->getEngine().getTensorDataType("logits");
         createDecoders(mMicroBatchConfig.genBatchSize, maxBeamWidth, maxAttentionWindow, maxSequenceLength, logitsType,
@@ -276,12 +615,15 @@ void GptSession::setup(Config const& sessionConfig)
         createCustomAllReduceWorkspace(mMicroBatchConfig.genBatchSize, maxBeamWidth, maxSequenceLength);
     }
 
-    for (auto& buffers : mBuffers)
+    if (!options.bufferArenaMode)
     {
-        // we don't know maxInputLength yet and ignore it for pre-allocation
-        buffers->generationConfig = RuntimeBuffers::GenerationConfig{
-            mMicroBatchConfig.genBatchSize, maxBeamWidth, 0, maxAttentionWindow, maxSequenceLength};
-        buffers->reshape(mModelConfig, mWorldConfig);
+        reshapeBuffers();
+    }
+
+    if (calibrateKvCacheSize)
+    {
+        calibrateKvCache(maxBatchSize, maxBeamWidth, maxAttentionWindow, maxSequenceLength, calibrationInputLength,
+            sessionConfig.kvCacheConfig, options.kvCacheCalibrationMargin);
     }
     TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
 }
@@ -303,12 +645,27 @@ void GptSession::kvCacheAddSequences(SizeType beamWidth, SizeType microBatchId,
 }
 
 ITensor::SharedPtr GptSession::initDecoder(ITensor& outputIds, GenerationInput const& inputs,
-    GenerationOutput const& outputs, SamplingConfig const& samplingConfig, SizeType microBatchId) const
+    GenerationOutput const& outputs, SamplingConfig const& samplingConfig, TruncationConfig const& truncationConfig,
+    SizeType microBatchId) const
 {
     if (mWorldConfig.isLastPipelineParallelRank())
     {
         auto& decoder = mDecoders.at(microBatchId);
-        decoder->newBatch(inputs, outputs, samplingConfig);
+        if (truncationConfig.empty())
+        {
+            decoder->newBatch(inputs, outputs, samplingConfig);
+        }
+        else if (auto decoderBatch = std::dynamic_pointer_cast<GptDecoderBatch>(decoder))
+        {
+            TLLM_CHECK_WITH_INFO(!std::dynamic_pointer_cast<JointGptDecoderBatch>(decoder),
+                "Min-p and typical-p sampling is not supported with TRTLLM_ENABLE_BATCHED_DECODING=1");
+            decoderBatch->newBatch(inputs, outputs, samplingConfig, truncationConfig);
+        }
+        else
+        {
+            std::static_pointer_cast<StatefulGptDecoder>(decoder)->newBatch(
+                inputs, outputs, samplingConfig, truncationConfig);
+        }
         return decoder->getNewTokens();
     }
     else if (mWorldConfig.isFirstPipelineParallelRank())
@@ -328,7 +685,8 @@ ITensor::SharedPtr GptSession::initDecoder(ITensor& outputIds, GenerationInput c
         {
             inputOffsets->reshape(ITensor::makeShape({batchSize + 1}));
             manager.setZero(*inputOffsets);
-            kernels::invokeInclusiveSum(*ITensor::slice(inputOffsets, 1), *inputLengths, manager, *stream);
+            TensorSpan inputOffsetsEnd(*inputOffsets, 1);
+            kernels::invokeInclusiveSum(inputOffsetsEnd, *inputLengths, manager, *stream);
         }
 
         kernels::initOutputIds(outputIds, *inputs.ids, *inputLengths, *inputOffsets, inputs.padId, inputs.endId,
@@ -397,11 +755,45 @@ std::tuple<std::vector<ITensor::SharedPtr>, std::vector<ITensor::SharedPtr>, std
     return {inputIds, inputLengths, microBatchOffsets};
 }
 
+//! @brief Removes the padding of inputs, so the context phase runs on the tokens of all requests.
+GenerationInput packInputs(GenerationInput const& inputs, BufferManager& manager)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    auto const& stream = manager.getStream();
+    auto const batchSize = static_cast<SizeType>(inputs.lengths->getSize());
+
+    ITensor::SharedPtr inputOffsets = manager.gpu(ITensor::makeShape({batchSize + 1}), TRTDataType<SizeType>::value);
+    manager.setZero(*inputOffsets);
+    TensorSpan inputOffsetsEnd(*inputOffsets, 1);
+    kernels::invokeInclusiveSum(inputOffsetsEnd, *inputs.lengths, manager, stream);
+
+    auto const inputLengthsHost = manager.copyFrom(*inputs.lengths, MemoryType::kCPU);
+    auto const inputLengthsRange = BufferRange<SizeType>(*inputLengthsHost);
+    auto const numTokens = std::accumulate(inputLengthsRange.begin(), inputLengthsRange.end(), 0);
+
+    ITensor::SharedPtr packedIds = manager.gpu(ITensor::makeShape({numTokens}), inputs.ids->getDataType());
+    kernels::invokeCopyInputToPacked(*packedIds, *inputs.ids, *inputOffsets, stream);
+
+    auto packedInputs = inputs;
+    packedInputs.ids = std::move(packedIds);
+    packedInputs.packed = true;
+    TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
+    return packedInputs;
+}
+
 std::vector<GenerationInput> splitInputs(GenerationInput const& inputs, SizeType microBatchSize, BufferManager& manager)
 {
     TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
     auto [inputIds, inputLengths, microBatchOffsets] = splitInputIds(inputs, microBatchSize, manager);
 
+    auto const numRequests = microBatchOffsets.back();
+    for (auto const& [name, tensor] : inputs.extraInputs)
+    {
+        auto const& shape = tensor->getShape();
+        TLLM_CHECK_WITH_INFO(shape.nbDims >= 1 && shape.d[0] == numRequests,
+            "The first dimension of the extra input %s must be the batch size %d", name.c_str(), numRequests);
+    }
+
     std::vector<GenerationInput> inputBatches;
     for (std::size_t batchId = 0; batchId < inputIds.size(); ++batchId)
     {
@@ -437,6 +829,9 @@ std::vector<GenerationInput> splitInputs(GenerationInput const& inputs, SizeType
         }
         if (inputs.maxNewTokens)
             batch.maxNewTokens = inputs.maxNewTokens;
+        if (!inputs.tokenConstraints.empty())
+            batch.tokenConstraints = std::vector<std::shared_ptr<ITokenConstraint>>(
+                inputs.tokenConstraints.begin() + offset, inputs.tokenConstraints.begin() + offset + batchSize);
 
         if (inputs.promptTuningParams.embeddingTable)
             batch.promptTuningParams.embeddingTable = inputs.promptTuningParams.embeddingTable;
@@ -444,6 +839,11 @@ std::vector<GenerationInput> splitInputs(GenerationInput const& inputs, SizeType
             batch.promptTuningParams.tasks = ITensor::slice(inputs.promptTuningParams.tasks, offset, batchSize);
         if (inputs.promptTuningParams.vocabSize)
             batch.promptTuningParams.vocabSize = inputs.promptTuningParams.vocabSize;
+
+        for (auto const& [name, tensor] : inputs.extraInputs)
+        {
+            batch.extraInputs.insert_or_assign(name, ITensor::slice(tensor, offset, batchSize));
+        }
     }
 
     TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
@@ -481,6 +881,11 @@ std::vector<GenerationOutput> splitOutputs(GenerationOutput& outputs, SizeType m
             outputBatches.back().generationLogitsHost
                 = ITensor::slice(outputs.generationLogitsHost, batchOffset, batchSize);
         }
+        if (outputs.topLogProbs)
+        {
+            outputBatches.back().topLogProbIds = ITensor::slice(outputs.topLogProbIds, batchOffset, batchSize);
+            outputBatches.back().topLogProbs = ITensor::slice(outputs.topLogProbs, batchOffset, batchSize);
+        }
     }
 
     return outputBatches;
@@ -501,11 +906,22 @@ void updateOutputIds(ITensor::SharedPtr const& outputIds, ITensor::SharedPtr con
 
 void GptSession::generate(
     GenerationOutput& outputs, GenerationInput const& inputs, SamplingConfig const& samplingConfig)
+{
+    generate(outputs, inputs, samplingConfig, TruncationConfig{});
+}
+
+void GptSession::generate(GenerationOutput& outputs, GenerationInput const& inputs,
+    SamplingConfig const& samplingConfig, TruncationConfig const& truncationConfig)
 {
     TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
 
+    if (mModelConfig.usePackedInput() && !inputs.packed)
+    {
+        generate(outputs, packInputs(inputs, mRuntime->getBufferManager()), samplingConfig, truncationConfig);
+        return;
+    }
     TLLM_CHECK_WITH_INFO(inputs.packed == mModelConfig.usePackedInput(),
-        "The chosen model requires a packed input tensor (did you set packed?).");
+        "The chosen model requires a padded input tensor (did you set packed?).");
     auto const& inputLengths = inputs.lengths;
     TLLM_CHECK_WITH_INFO(inputLengths->getShape().nbDims == 1, "Input lengths tensor must be one-dimensional.");
 
@@ -513,6 +929,7 @@ void GptSession::generate(
 
     auto const batchSize = static_cast<SizeType>(inputLengths->getSize());
     auto const beamWidth = samplingConfig.beamWidth;
+    getState().batchStates.emplace(batchSize, beamWidth);
     outputs.ids->reshape(ITensor::makeShape({batchSize, beamWidth, mDecoderMaxSequenceLength}));
     outputs.lengths->reshape(ITensor::makeShape({batchSize, beamWidth}));
     if (mWorldConfig.isLastPipelineParallelRank())
@@ -529,6 +946,17 @@ void GptSession::generate(
                 outputs.logProbs, "outputs.logProbs is nullptr. It must be allocated when computeLogProbs is true");
             outputs.logProbs->reshape(ITensor::makeShape({batchSize, beamWidth, mDecoderMaxSequenceLength}));
         }
+        if (outputs.topLogProbs)
+        {
+            TLLM_CHECK_WITH_INFO(outputs.topLogProbIds, "outputs.topLogProbIds must be set with outputs.topLogProbs");
+            auto const topLogProbsShape = outputs.topLogProbs->getShape();
+            TLLM_CHECK_WITH_INFO(topLogProbsShape.nbDims == 4 && topLogProbsShape.d[0] == batchSize
+                    && topLogProbsShape.d[1] == beamWidth,
+                "outputs.topLogProbs must have shape [batchSize, beamWidth, maxNewTokens, numTopLogProbs]");
+            TLLM_CHECK_WITH_INFO(outputs.topLogProbIds->getSize() == outputs.topLogProbs->getSize(),
+                "outputs.topLogProbIds and outputs.topLogProbs must have the same shape");
+            outputs.topLogProbIds->reshape(topLogProbsShape);
+        }
         if (mModelConfig.computeContextLogits() || mModelConfig.computeGenerationLogits())
         {
             auto const vocabSizePadded = mModelConfig.getVocabSizePadded(mWorldConfig.getSize());
@@ -583,19 +1011,830 @@ void GptSession::generate(
     // callbacks
     auto const onTokenGenerated = createOnTokenGeneratedCallback(outputs);
 
-    if (batchSize <= mMicroBatchConfig.genBatchSize)
+    auto microBatchSize = mMicroBatchConfig.genBatchSize;
+    if (getState().balanceMicroBatches)
+    {
+        auto const numMicroBatches = std::min(mMicroBatchConfig.numGenBatches, batchSize);
+        microBatchSize = tc::ceilDiv(batchSize, numMicroBatches);
+    }
+
+    if (batchSize <= microBatchSize)
     {
         std::vector<GenerationInput> microBatchesInputs{inputs};
         std::vector<GenerationOutput> microBatchesOutputs{outputs};
-        generateBatched(microBatchesOutputs, microBatchesInputs, samplingConfig, onTokenGenerated);
+        generateBatched(microBatchesOutputs, microBatchesInputs, samplingConfig, truncationConfig, onTokenGenerated);
     }
     else
     {
-        auto const microBatchesInputs = splitInputs(inputs, mMicroBatchConfig.genBatchSize, manager);
-        auto microBatchesOutputs = splitOutputs(outputs, mMicroBatchConfig.genBatchSize, manager);
-        generateBatched(microBatchesOutputs, microBatchesInputs, samplingConfig, onTokenGenerated);
+        auto const microBatchesInputs = splitInputs(inputs, microBatchSize, manager);
+        auto microBatchesOutputs = splitOutputs(outputs, microBatchSize, manager);
+        generateBatched(microBatchesOutputs, microBatchesInputs, samplingConfig, truncationConfig, onTokenGenerated);
+    }
+
+    TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
+}
+
+void GptSession::encode(TensorPtr const& embeddings, GenerationInput const& inputs, PoolingType pooling)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+
+    if (mModelConfig.usePackedInput() && !inputs.packed)
+    {
+        encode(embeddings, packInputs(inputs, mRuntime->getBufferManager()), pooling);
+        return;
+    }
+    TLLM_CHECK_WITH_INFO(inputs.packed == mModelConfig.usePackedInput(),
+        "The chosen model requires a padded input tensor (did you set packed?).");
+    TLLM_CHECK_WITH_INFO(inputs.lengths->getShape().nbDims == 1, "Input lengths tensor must be one-dimensional.");
+    // the context step only shapes the hidden states with the attention plugin
+    TLLM_CHECK_WITH_INFO(mModelConfig.useGptAttentionPlugin(), "encode requires the GPT attention plugin");
+
+    auto& manager = mRuntime->getBufferManager();
+    auto const batchSize = static_cast<SizeType>(inputs.lengths->getSize());
+    if (mWorldConfig.isLastPipelineParallelRank())
+    {
+        TLLM_CHECK_WITH_INFO(mBuffers.front()->returnsHiddenStates,
+            "encode requires an engine built with output_hidden_states, which skips the LM head");
+        TLLM_CHECK_WITH_INFO(embeddings, "embeddings must be allocated");
+        auto const hiddenSize = mModelConfig.getHiddenSize() * mWorldConfig.getTensorParallelism();
+        embeddings->reshape(ITensor::makeShape({batchSize, hiddenSize}));
+    }
+
+    auto const microBatchSize = mMicroBatchConfig.genBatchSize;
+    if (batchSize <= microBatchSize)
+    {
+        encodeBatched(embeddings, inputs, pooling);
+    }
+    else
+    {
+        SizeType offset{0};
+        for (auto const& microBatchInputs : splitInputs(inputs, microBatchSize, manager))
+        {
+            auto const numRequests = static_cast<SizeType>(microBatchInputs.lengths->getSize());
+            auto const microBatchEmbeddings
+                = mWorldConfig.isLastPipelineParallelRank() ? ITensor::slice(embeddings, offset, numRequests) : nullptr;
+            encodeBatched(microBatchEmbeddings, microBatchInputs, pooling);
+            offset += numRequests;
+        }
+    }
+
+    manager.getStream().synchronize();
+    TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
+}
+
+void GptSession::encodeBatched(TensorPtr const& embeddings, GenerationInput const& inputs, PoolingType pooling)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    auto& manager = mRuntime->getBufferManager();
+    auto constexpr microBatchId = 0;
+    auto constexpr beamWidth = 1;
+
+    auto& buffers = *mBuffers.at(microBatchId);
+    {
+        MemoryCounters::TagScope const tagScope{MemoryTag::kRUNTIME_BUFFERS};
+        buffers.initFromInput(*inputs.ids, inputs.lengths, inputs.packed, beamWidth, mDecoderMaxAttentionWindow,
+            mDecoderMaxSequenceLength, manager);
+        buffers.reshape(manager, mModelConfig, mWorldConfig);
+        buffers.reset(manager);
+    }
+    if (mModelConfig.usePromptTuning())
+    {
+        buffers.promptTuningParams = inputs.promptTuningParams;
+    }
+    buffers.extraInputs = inputs.extraInputs;
+
+    // the KV cache only holds the tokens of the inputs, it is released once they are encoded
+    kvCacheAddSequences(beamWidth, microBatchId, 0);
+    auto kvCacheManager = mModelConfig.usePagedKvCache() ? mKvCacheManager.get() : nullptr;
+
+    auto const contextBatchSize = mMicroBatchConfig.ctxBatchSize;
+    auto [inputIds, inputLengths, contextBatchOffsets] = splitInputIds(inputs, contextBatchSize, manager);
+    auto contextBuffers = buffers.split(contextBatchSize, mModelConfig, mWorldConfig);
+    TLLM_CHECK(inputIds.size() == contextBuffers.size());
+    for (std::size_t contextBatchId = 0; contextBatchId < contextBuffers.size(); ++contextBatchId)
+    {
+        auto& contextBatchBuffers = contextBuffers.at(contextBatchId);
+        auto const batchOffset = contextBatchOffsets.at(contextBatchId);
+        executeContextBatch(
+            contextBatchBuffers, inputIds.at(contextBatchId), inputs.padId, kvCacheManager, batchOffset);
+        if (mWorldConfig.isLastPipelineParallelRank())
+        {
+            auto const contextBatchEmbeddings
+                = ITensor::slice(embeddings, batchOffset, contextBatchBuffers.generationConfig.batchSize);
+            kernels::poolHiddenStates(*contextBatchEmbeddings, *contextBatchBuffers.hiddenStates,
+                *contextBatchBuffers.contextLengthsDevice, pooling == PoolingType::kMEAN, manager.getStream());
+        }
     }
 
+    if (kvCacheManager)
+    {
+        // the context batches are enqueued, the blocks can be reused by the next ones
+        auto const batchSize = buffers.generationConfig.batchSize;
+        for (auto batchIdx = 0; batchIdx < batchSize; ++batchIdx)
+        {
+            mKvCacheManager->removeSequence(batchIdx);
+        }
+    }
+    TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
+}
+
+//! Runs the enqueued tasks in order on one thread, the pending tasks are run before the thread ends.
+class GptSession::GenerateWorker
+{
+public:
+    //! initThread runs first on the worker thread.
+    explicit GenerateWorker(std::function<void()> initThread)
+        : mThread{&GenerateWorker::run, this, std::move(initThread)}
+    {
+    }
+
+    GenerateWorker(GenerateWorker const&) = delete;
+    GenerateWorker& operator=(GenerateWorker const&) = delete;
+
+    ~GenerateWorker()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mShutdown = true;
+        }
+        mCv.notify_one();
+        mThread.join();
+    }
+
+    std::future<void> enqueue(std::function<void()> task)
+    {
+        std::packaged_task<void()> packagedTask{std::move(task)};
+        auto future = packagedTask.get_future();
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTasks.push_back(std::move(packagedTask));
+        }
+        mCv.notify_one();
+        return future;
+    }
+
+private:
+    void run(std::function<void()> const& initThread)
+    {
+        initThread();
+        while (true)
+        {
+            std::packaged_task<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCv.wait(lock, [this] { return mShutdown || !mTasks.empty(); });
+                if (mTasks.empty())
+                {
+                    break;
+                }
+                task = std::move(mTasks.front());
+                mTasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::mutex mMutex;
+    std::condition_variable mCv;
+    std::deque<std::packaged_task<void()>> mTasks;
+    bool mShutdown{false};
+    // Started last, after the members it uses
+    std::thread mThread;
+};
+
+std::future<void> GptSession::generateAsync(
+    GenerationOutput& outputs, GenerationInput const& inputs, SamplingConfig const& samplingConfig)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    auto& state = getState();
+    if (!state.generateWorker)
+    {
+        state.generateWorker = std::make_shared<GenerateWorker>(
+            [device = mDevice]()
+            {
+                if (tc::getEnvBindThreadsToDevice())
+                {
+                    tc::bindThreadToDevice(device);
+                }
+            });
+    }
+    // inputs and sampling config are copied, the input tensors are shared
+    auto future = state.generateWorker->enqueue(
+        [this, &outputs, inputs, samplingConfig]()
+        {
+            TLLM_CUDA_CHECK(cudaSetDevice(mDevice));
+            generate(outputs, inputs, samplingConfig);
+        });
+    TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
+    return future;
+}
+
+void GptSession::shareEngineWorkspace(GptSession& other)
+{
+    TLLM_CHECK_WITH_INFO(mDevice == other.mDevice, "Sessions on different devices cannot share memory");
+    mRuntime->shareEngineWorkspace(*other.mRuntime);
+    TLLM_LOG_INFO("Sessions share an engine workspace of %zu bytes", mRuntime->getEngineWorkspaceSize());
+}
+
+void GptSession::refit(EngineWeights const& weights)
+{
+    mRuntime->refit(weights);
+    // The graphs may have captured kernels that read the previous weights
+    for (auto& cudaGraphInstance : getState().cudaGraphInstances)
+    {
+        cudaGraphInstance.clear();
+    }
+}
+
+namespace
+{
+auto constexpr kWarmUpStateVersion = 1;
+} // namespace
+
+void GptSession::saveWarmUpState(std::string const& path) const
+{
+    auto const& batchStates = getState().batchStates;
+    auto batchShapes = nlohmann::json::array();
+    for (auto const& [batchSize, beamWidth] : batchStates)
+    {
+        batchShapes.push_back({{"batch_size", batchSize}, {"beam_width", beamWidth}});
+    }
+    nlohmann::json const state{{"version", kWarmUpStateVersion}, {"batch_shapes", std::move(batchShapes)}};
+    std::ofstream file{path};
+    TLLM_CHECK_WITH_INFO(file.good(), "Cannot write the warm-up state %s", path.c_str());
+    file << state.dump(4);
+    TLLM_LOG_INFO("Saved %zu batch shapes to the warm-up state %s", batchStates.size(), path.c_str());
+}
+
+void GptSession::warmUp(std::string const& path)
+{
+    auto const start = std::chrono::steady_clock::now();
+    std::ifstream file{path};
+    TLLM_CHECK_WITH_INFO(file.good(), "Cannot read the warm-up state %s", path.c_str());
+    auto const state = nlohmann::json::parse(file);
+    TLLM_CHECK_WITH_INFO(state.value("version", 0) == kWarmUpStateVersion,
+        "The warm-up state %s is of another version", path.c_str());
+
+    // A few generation steps capture the graph of a shape and the inputs are short, a graph captured for an input
+    // length is updated for the others
+    auto constexpr kNewTokens = 4;
+    auto const inputLength = std::min(8, mDecoderMaxSequenceLength - kNewTokens);
+    TLLM_CHECK_WITH_INFO(inputLength > 0, "The sequences are too short to warm up");
+    auto const packed = mModelConfig.usePackedInput();
+    auto& manager = mRuntime->getBufferManager();
+    SizeType numShapes{0};
+    for (auto const& shape : state.at("batch_shapes"))
+    {
+        auto const batchSize = shape.at("batch_size").get<SizeType>();
+        auto const beamWidth = shape.at("beam_width").get<SizeType>();
+        // Token 0 is the end and the padding token, the minimum length makes every step run
+        std::vector<SizeType> const ids(batchSize * inputLength, 0);
+        auto inputIds = packed ? manager.copyFrom(ids, ITensor::makeShape({batchSize * inputLength}), MemoryType::kGPU)
+                               : manager.copyFrom(ids, ITensor::makeShape({batchSize, inputLength}), MemoryType::kGPU);
+        std::vector<SizeType> const lengths(batchSize, inputLength);
+        auto inputLengths = manager.copyFrom(lengths, ITensor::makeShape({batchSize}), MemoryType::kGPU);
+        GenerationInput inputs{0, 0, std::move(inputIds), std::move(inputLengths), packed};
+        inputs.maxNewTokens = kNewTokens;
+        GenerationOutput outputs{manager.emptyTensor(MemoryType::kGPU, nvinfer1::DataType::kINT32),
+            manager.emptyTensor(MemoryType::kGPU, nvinfer1::DataType::kINT32)};
+        SamplingConfig samplingConfig{beamWidth};
+        samplingConfig.minLength = std::vector{kNewTokens};
+        generate(outputs, inputs, samplingConfig);
+        ++numShapes;
+    }
+    manager.getStream().synchronize();
+    auto const timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    TLLM_LOG_INFO("Warmed up %d batch shapes from %s in %.0f ms", numShapes, path.c_str(), timeMs);
+}
+
+void GptSession::setStopCheckInterval(SizeType interval)
+{
+    TLLM_CHECK_WITH_INFO(interval > 0, "Stop check interval must be positive");
+    getState().stopCheckInterval = interval;
+}
+
+void GptSession::setLayerProfilingInterval(SizeType interval)
+{
+    mRuntime->setLayerProfilingInterval(interval);
+}
+
+LayerProfileStats GptSession::collectLayerProfile()
+{
+    return mRuntime->collectLayerProfile();
+}
+
+void GptSession::setGpuMetricsInterval(SizeType interval)
+{
+    TLLM_CHECK_WITH_INFO(interval >= 0, "The GPU metrics sampling interval must not be negative");
+    getState().gpuMetricsSampler = interval > 0 ? std::make_shared<GpuMetricsSampler>(interval, mDevice) : nullptr;
+}
+
+GpuMetricsStats GptSession::collectGpuMetrics()
+{
+    auto const& gpuMetricsSampler = getState().gpuMetricsSampler;
+    return gpuMetricsSampler ? gpuMetricsSampler->collect() : GpuMetricsStats{};
+}
+
+std::vector<tc::CommIterationStats> const& GptSession::getCommStats() const
+{
+    return getState().commStats;
+}
+
+std::vector<float> const& GptSession::getStepTimes() const
+{
+    return getState().stepTimesMs;
+}
+
+GptSession::SpeculativeDecodingStats const& GptSession::getSpeculativeDecodingStats() const
+{
+    return getState().speculativeDecodingStats;
+}
+
+namespace
+{
+
+// Tokens of the requests in the KV cache of a session across the passes of speculative decoding, request bi being in
+// slot bi. Rejected tokens are rolled back by forgetting them, the next pass overwrites their keys and values. Blocks
+// are only added while a request grows and are released with its sequence.
+class CachedSequences
+{
+public:
+    CachedSequences(bmkv::KVCacheManager& kvCacheManager, SizeType batchSize)
+        : mKvCacheManager{kvCacheManager}
+        , mTokens(batchSize)
+        , mNumReserved(batchSize, 0)
+    {
+    }
+
+    CachedSequences(CachedSequences const&) = delete;
+    CachedSequences& operator=(CachedSequences const&) = delete;
+
+    ~CachedSequences()
+    {
+        for (SizeType bi = 0; bi < static_cast<SizeType>(mNumReserved.size()); ++bi)
+        {
+            if (mNumReserved[bi] > 0)
+            {
+                mKvCacheManager.removeSequence(bi);
+            }
+        }
+    }
+
+    // Forgets the cached tokens of request bi from the first one that differs from sequence, returns the number kept.
+    // The last token of sequence is never kept, a pass runs it to get the logits of the next one.
+    SizeType rollBack(SizeType bi, std::vector<TokenIdType> const& sequence)
+    {
+        auto& tokens = mTokens[bi];
+        auto const length = std::min(tokens.size(), sequence.size() - 1);
+        tokens.erase(std::mismatch(tokens.begin(), tokens.begin() + length, sequence.begin()).first, tokens.end());
+        return static_cast<SizeType>(tokens.size());
+    }
+
+    // Adds the blocks of newTokens after the cached tokens of request bi, before a pass writes them
+    void append(SizeType bi, std::vector<TokenIdType> const& newTokens)
+    {
+        auto& tokens = mTokens[bi];
+        tokens.insert(tokens.end(), newTokens.begin(), newTokens.end());
+        auto const length = static_cast<SizeType>(tokens.size());
+        if (mNumReserved[bi] == 0)
+        {
+            mKvCacheManager.addSequence(bi, length, 1);
+            mNumReserved[bi] = length;
+        }
+        for (; mNumReserved[bi] < length; ++mNumReserved[bi])
+        {
+            mKvCacheManager.addToken(bi);
+        }
+    }
+
+private:
+    bmkv::KVCacheManager& mKvCacheManager;
+    std::vector<std::vector<TokenIdType>> mTokens;
+    std::vector<SizeType> mNumReserved;
+};
+
+} // namespace
+
+void GptSession::checkCachedContextSteps(SizeType batchSize, SizeType numDraftTokens) const
+{
+    TLLM_CHECK_WITH_INFO(mModelConfig.supportsInflightBatching() && mModelConfig.getPagedContextFMHA(),
+        "Speculative decoding requires engines with the GPT attention plugin, packed inputs, a paged KV cache and "
+        "paged context FMHA, to run passes after the tokens in the KV cache");
+    TLLM_CHECK_WITH_INFO(!mModelConfig.usePromptTuning(), "Speculative decoding does not support prompt tuning");
+    TLLM_CHECK_WITH_INFO(
+        !mWorldConfig.isPipelineParallel(), "Speculative decoding does not support pipeline parallelism");
+    TLLM_CHECK_WITH_INFO(mMicroBatchConfig.numCtxBatches == 1 && mMicroBatchConfig.numGenBatches == 1,
+        "Speculative decoding does not support micro batching");
+    TLLM_CHECK_WITH_INFO(batchSize <= mMicroBatchConfig.genBatchSize,
+        "Batch size %d exceeds the max batch size %d of the session", batchSize, mMicroBatchConfig.genBatchSize);
+    // rejected tokens are overwritten in place, which a cyclic KV cache would have wrapped around
+    TLLM_CHECK_WITH_INFO(mDecoderMaxAttentionWindow >= mDecoderMaxSequenceLength,
+        "Speculative decoding does not support a max attention window shorter than the max sequence length");
+    TLLM_CHECK_WITH_INFO(numDraftTokens + 1 <= mModelConfig.getMaxInputLen(),
+        "numDraftTokens + 1 (%d) exceeds the max input length %d of the engine", numDraftTokens + 1,
+        mModelConfig.getMaxInputLen());
+}
+
+GptSession::TensorPtr GptSession::executeCachedContextStep(std::vector<std::vector<TokenIdType>> const& tokens,
+    std::vector<SizeType> const& pastLengths, std::vector<SizeType> const& batchSlots)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    auto& manager = mRuntime->getBufferManager();
+    auto& buffers = *mBuffers.front();
+    auto const batchSize = static_cast<SizeType>(tokens.size());
+
+    std::vector<TokenIdType> ids;
+    std::vector<SizeType> lengths(batchSize);
+    for (SizeType bi = 0; bi < batchSize; ++bi)
+    {
+        ids.insert(ids.end(), tokens[bi].begin(), tokens[bi].end());
+        lengths[bi] = static_cast<SizeType>(tokens[bi].size());
+        TLLM_CHECK_WITH_INFO(lengths[bi] > 0 && lengths[bi] <= mModelConfig.getMaxInputLen(),
+            "A context step runs 1 to %d tokens per request, not %d", mModelConfig.getMaxInputLen(), lengths[bi]);
+    }
+    auto const numTokens = static_cast<SizeType>(ids.size());
+    NVTX3_SCOPED_RANGE_IN(cached_context_step, Context, numTokens);
+    TensorPtr const inputIds{manager.copyFrom(ids, ITensor::makeShape({numTokens}), MemoryType::kGPU)};
+    TensorPtr const inputLengths{manager.copyFrom(lengths, ITensor::makeShape({batchSize}), MemoryType::kGPU)};
+    {
+        MemoryCounters::TagScope const tagScope{MemoryTag::kRUNTIME_BUFFERS};
+        auto constexpr inputPacked = true;
+        auto constexpr beamWidth = 1;
+        buffers.initFromInput(*inputIds, inputLengths, inputPacked, beamWidth, mDecoderMaxAttentionWindow,
+            mDecoderMaxSequenceLength, manager);
+        buffers.reshape(manager, mModelConfig, mWorldConfig);
+        buffers.reset(manager);
+    }
+    if (mModelConfig.computeContextLogits())
+    {
+        auto const vocabSizePadded = mModelConfig.getVocabSizePadded(mWorldConfig.getSize());
+        buffers.logits = buffers.cacheContextLogits;
+        buffers.logits->reshape(ITensor::makeShape({numTokens, vocabSizePadded}));
+    }
+
+    auto constexpr step = 0;
+    auto& inputBuffer = buffers.inputBuffers[0];
+    auto& outputBuffer = buffers.outputBuffers[0];
+    buffers.prepareCachedContextStep(
+        inputIds, pastLengths, batchSlots, manager, *mKvCacheManager, mModelConfig, mWorldConfig);
+    buffers.getRuntimeBuffers(inputBuffer, outputBuffer, step, inputIds, mCommPtrs, mModelConfig, mWorldConfig);
+    auto const contextId = selectContext(inputBuffer, getState().contextPhaseContexts);
+    mRuntime->setInputTensors(contextId, inputBuffer);
+    mRuntime->setOutputTensors(contextId, outputBuffer);
+    TLLM_CHECK_WITH_INFO(mRuntime->executeContext(contextId), "Executing TRT engine in context step failed!");
+    sync_check_cuda_error();
+    TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
+    return buffers.logits;
+}
+
+std::vector<std::vector<TokenIdType>> GptSession::acceptDraftTokens(ITensor const& logits,
+    std::vector<SizeType> const& logitsRows, std::vector<std::vector<TokenIdType>> const& draftTokens,
+    TokenIdType padId)
+{
+    auto& manager = mRuntime->getBufferManager();
+    auto& stream = manager.getStream();
+    auto const batchSize = static_cast<SizeType>(draftTokens.size());
+    auto const vocabSize = mModelConfig.getVocabSize();
+    auto const vocabSizePadded = mModelConfig.getVocabSizePadded(mWorldConfig.getSize());
+
+    // the draft ids have room for at least one token, the kernel reads none of a request without draft tokens
+    SizeType maxNumDraftTokens = 1;
+    std::vector<SizeType> numsDraftTokens(batchSize);
+    for (SizeType bi = 0; bi < batchSize; ++bi)
+    {
+        numsDraftTokens[bi] = static_cast<SizeType>(draftTokens[bi].size());
+        maxNumDraftTokens = std::max(maxNumDraftTokens, numsDraftTokens[bi]);
+    }
+    std::vector<TokenIdType> draftIds(batchSize * maxNumDraftTokens, padId);
+    for (SizeType bi = 0; bi < batchSize; ++bi)
+    {
+        std::copy(draftTokens[bi].begin(), draftTokens[bi].end(), draftIds.begin() + bi * maxNumDraftTokens);
+    }
+
+    auto& scratch = *getState().scratch;
+    ScratchArena::Frame const scratchFrame{scratch};
+    auto const logitsRowsDevice = scratch.allocate(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT32);
+    manager.copy(logitsRows.data(), *logitsRowsDevice);
+    auto const numsDraftTokensDevice = scratch.allocate(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT32);
+    manager.copy(numsDraftTokens.data(), *numsDraftTokensDevice);
+    auto const draftIdsDevice
+        = scratch.allocate(ITensor::makeShape({batchSize, maxNumDraftTokens}), nvinfer1::DataType::kINT32);
+    manager.copy(draftIds.data(), *draftIdsDevice);
+    auto const targetIds
+        = scratch.allocate(ITensor::makeShape({batchSize, maxNumDraftTokens + 1}), nvinfer1::DataType::kINT32);
+    auto const numsAcceptedTokens = scratch.allocate(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT32);
+
+    if (logits.getDataType() == nvinfer1::DataType::kFLOAT)
+    {
+        kernels::invokeAcceptDraftTokensByArgmax(bufferCast<SizeType>(*targetIds),
+            bufferCast<SizeType>(*numsAcceptedTokens), bufferCast<float>(logits),
+            bufferCast<SizeType>(*logitsRowsDevice), bufferCast<SizeType>(*draftIdsDevice),
+            bufferCast<SizeType>(*numsDraftTokensDevice), batchSize, maxNumDraftTokens, vocabSize, vocabSizePadded,
+            stream.get());
+    }
+    else
+    {
+        TLLM_CHECK(logits.getDataType() == nvinfer1::DataType::kHALF);
+        kernels::invokeAcceptDraftTokensByArgmax(bufferCast<SizeType>(*targetIds),
+            bufferCast<SizeType>(*numsAcceptedTokens), bufferCast<half>(logits),
+            bufferCast<SizeType>(*logitsRowsDevice), bufferCast<SizeType>(*draftIdsDevice),
+            bufferCast<SizeType>(*numsDraftTokensDevice), batchSize, maxNumDraftTokens, vocabSize, vocabSizePadded,
+            stream.get());
+    }
+    sync_check_cuda_error();
+
+    auto const targetIdsHost = manager.copyFrom(*targetIds, MemoryType::kCPU);
+    auto const numsAcceptedTokensHost = manager.copyFrom(*numsAcceptedTokens, MemoryType::kCPU);
+    stream.synchronize();
+    auto const* targetIdsPtr = bufferCast<TokenIdType>(*targetIdsHost);
+    auto const* numsAcceptedTokensPtr = bufferCast<SizeType>(*numsAcceptedTokensHost);
+    std::vector<std::vector<TokenIdType>> acceptedTokens(batchSize);
+    for (SizeType bi = 0; bi < batchSize; ++bi)
+    {
+        auto const* begin = targetIdsPtr + bi * (maxNumDraftTokens + 1);
+        acceptedTokens[bi].assign(begin, begin + numsAcceptedTokensPtr[bi]);
+    }
+    return acceptedTokens;
+}
+
+void GptSession::generateSpeculative(GenerationOutput& outputs, GenerationInput const& inputs,
+    SamplingConfig const& samplingConfig, GptSession& draftSession, SizeType numDraftTokens)
+{
+    auto const batchSize = static_cast<SizeType>(inputs.lengths->getSize());
+    draftSession.checkCachedContextSteps(batchSize, numDraftTokens);
+    TLLM_CHECK_WITH_INFO(draftSession.mDecoderMaxSequenceLength >= mDecoderMaxSequenceLength,
+        "The max sequence length of the draft session must be at least the one of the target session");
+    CachedSequences draftCache{*draftSession.mKvCacheManager, batchSize};
+
+    // Draft greedily with the draft model, each pass after the first one runs the last draft token
+    auto draftTokensOf = [&](std::vector<SizeType> const& active,
+                             std::vector<std::vector<TokenIdType>> const& sequences,
+                             std::vector<SizeType> const& maxNumsDraftTokens)
+    {
+        auto const numActive = static_cast<SizeType>(active.size());
+        std::vector<std::vector<TokenIdType>> draftTokens(numActive);
+        std::vector<SizeType> cachedLengths(numActive);
+        for (SizeType ai = 0; ai < numActive; ++ai)
+        {
+            cachedLengths[ai] = draftCache.rollBack(active[ai], sequences[active[ai]]);
+        }
+        while (true)
+        {
+            std::vector<SizeType> drafting;
+            std::vector<SizeType> batchSlots;
+            std::vector<SizeType> pastLengths;
+            std::vector<std::vector<TokenIdType>> passTokens;
+            for (SizeType ai = 0; ai < numActive; ++ai)
+            {
+                auto const& draft = draftTokens[ai];
+                // draft tokens after the end token are not verified
+                if (static_cast<SizeType>(draft.size()) >= maxNumsDraftTokens[ai]
+                    || (!draft.empty() && draft.back() == inputs.endId))
+                {
+                    continue;
+                }
+                auto const bi = active[ai];
+                auto const& sequence = sequences[bi];
+                auto const numSequenceCached = std::min(cachedLengths[ai], static_cast<SizeType>(sequence.size()));
+                auto& tokens = passTokens.emplace_back(sequence.begin() + numSequenceCached, sequence.end());
+                tokens.insert(tokens.end(), draft.begin() + (cachedLengths[ai] - numSequenceCached), draft.end());
+                drafting.push_back(ai);
+                batchSlots.push_back(bi);
+                pastLengths.push_back(cachedLengths[ai]);
+                draftCache.append(bi, tokens);
+                cachedLengths[ai] += static_cast<SizeType>(tokens.size());
+            }
+            if (drafting.empty())
+            {
+                break;
+            }
+
+            auto const logits = draftSession.executeCachedContextStep(passTokens, pastLengths, batchSlots);
+            auto const numDrafting = static_cast<SizeType>(drafting.size());
+            std::vector<SizeType> logitsRows(numDrafting);
+            for (SizeType di = 0, offset = 0; di < numDrafting; ++di)
+            {
+                auto const numTokens = static_cast<SizeType>(passTokens[di].size());
+                // the logits of the last token of a request predict its next token
+                logitsRows[di] = draftSession.mModelConfig.computeContextLogits() ? offset + numTokens - 1 : di;
+                offset += numTokens;
+            }
+            auto const nextTokens = draftSession.acceptDraftTokens(
+                *logits, logitsRows, std::vector<std::vector<TokenIdType>>(numDrafting), inputs.padId);
+            for (SizeType di = 0; di < numDrafting; ++di)
+            {
+                draftTokens[drafting[di]].push_back(nextTokens[di].front());
+            }
+        }
+        return draftTokens;
+    };
+    generateWithDrafts(outputs, inputs, samplingConfig, numDraftTokens, draftTokensOf);
+}
+
+void GptSession::generatePromptLookup(GenerationOutput& outputs, GenerationInput const& inputs,
+    SamplingConfig const& samplingConfig, SizeType numDraftTokens, SizeType maxNgramSize)
+{
+    TLLM_CHECK_WITH_INFO(maxNgramSize > 0, "maxNgramSize must be positive");
+    auto draftTokensOf = [maxNgramSize](std::vector<SizeType> const& active,
+                             std::vector<std::vector<TokenIdType>> const& sequences,
+                             std::vector<SizeType> const& maxNumsDraftTokens)
+    {
+        std::vector<std::vector<TokenIdType>> draftTokens;
+        draftTokens.reserve(active.size());
+        for (std::size_t ai = 0; ai < active.size(); ++ai)
+        {
+            draftTokens.push_back(lookupDraftTokens(sequences[active[ai]], maxNumsDraftTokens[ai], maxNgramSize));
+        }
+        return draftTokens;
+    };
+    generateWithDrafts(outputs, inputs, samplingConfig, numDraftTokens, draftTokensOf);
+}
+
+std::vector<TokenIdType> GptSession::lookupDraftTokens(
+    std::vector<TokenIdType> const& sequence, SizeType numDraftTokens, SizeType maxNgramSize)
+{
+    auto const length = static_cast<SizeType>(sequence.size());
+    if (numDraftTokens <= 0)
+    {
+        return {};
+    }
+    // Longer n-grams match more selectively, shorter ones more often
+    for (auto ngramSize = std::min(maxNgramSize, length - 1); ngramSize > 0; --ngramSize)
+    {
+        auto const suffix = sequence.end() - ngramSize;
+        // the most recent occurrence followed by at least one token
+        for (auto start = length - ngramSize - 1; start >= 0; --start)
+        {
+            if (std::equal(suffix, sequence.end(), sequence.begin() + start))
+            {
+                auto const draftBegin = sequence.begin() + start + ngramSize;
+                auto const draftLength = std::min(numDraftTokens, static_cast<SizeType>(sequence.end() - draftBegin));
+                return {draftBegin, draftBegin + draftLength};
+            }
+        }
+    }
+    return {};
+}
+
+void GptSession::generateWithDrafts(GenerationOutput& outputs, GenerationInput const& inputs,
+    SamplingConfig const& samplingConfig, SizeType numDraftTokens, DraftTokensFunction const& draftTokensOf)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    TLLM_CHECK_WITH_INFO(numDraftTokens > 0, "numDraftTokens must be positive");
+    TLLM_CHECK_WITH_INFO(samplingConfig.beamWidth == 1, "Speculative decoding does not support beam search");
+    TLLM_CHECK_WITH_INFO(inputs.tokenConstraints.empty(), "Speculative decoding does not support token constraints");
+    TLLM_CHECK_WITH_INFO(!outputs.topLogProbs, "Speculative decoding does not support top log probs");
+    TLLM_CHECK_WITH_INFO(mModelConfig.computeContextLogits(),
+        "Speculative decoding requires a target engine that outputs context logits (gather_all_token_logits)");
+    TLLM_CHECK_WITH_INFO(!mBuffers.front()->returnsHiddenStates,
+        "The engine skips the LM head and returns the hidden states, use encode instead of generate");
+
+    auto& manager = mRuntime->getBufferManager();
+    auto& stream = manager.getStream();
+
+    // Sequences are kept on the host, each iteration extends them by the accepted tokens
+    auto const batchSize = static_cast<SizeType>(inputs.lengths->getSize());
+    checkCachedContextSteps(batchSize, numDraftTokens);
+    auto const inputLengthsHost = manager.copyFrom(*inputs.lengths, MemoryType::kCPU);
+    auto const inputIdsHost = manager.copyFrom(*inputs.ids, MemoryType::kCPU);
+    stream.synchronize();
+    auto const inputLengthsRange = BufferRange<SizeType>(*inputLengthsHost);
+    auto const* inputIdsPtr = bufferCast<TokenIdType>(*inputIdsHost);
+    auto const maxInputLength = *std::max_element(inputLengthsRange.begin(), inputLengthsRange.end());
+
+    std::vector<std::vector<TokenIdType>> sequences(batchSize);
+    for (SizeType bi = 0, offset = 0; bi < batchSize; ++bi)
+    {
+        auto const inputLength = inputLengthsRange[bi];
+        TLLM_CHECK_WITH_INFO(inputLength > 0, "Speculative decoding requires non-empty inputs");
+        auto const* begin = inputIdsPtr + (inputs.packed ? offset : bi * maxInputLength);
+        sequences[bi].assign(begin, begin + inputLength);
+        offset += inputLength;
+    }
+    auto const maxNewTokens = inputs.maxNewTokens.value_or(mDecoderMaxSequenceLength - maxInputLength);
+    std::vector<SizeType> numNewTokens(batchSize, 0);
+    std::vector<bool> finished(batchSize, false);
+
+    // The target model keeps the KV of the accepted tokens, each pass only runs the new tokens and the drafts
+    CachedSequences targetCache{*mKvCacheManager, batchSize};
+    auto& stats = getState().speculativeDecodingStats;
+    stats = SpeculativeDecodingStats{};
+    stats.numDraftTokens.resize(numDraftTokens, 0);
+    stats.numAcceptedTokens.resize(numDraftTokens, 0);
+    while (true)
+    {
+        std::vector<SizeType> active;
+        for (SizeType bi = 0; bi < batchSize; ++bi)
+        {
+            if (!finished[bi])
+            {
+                active.push_back(bi);
+            }
+        }
+        if (active.empty())
+        {
+            break;
+        }
+        auto const numActive = static_cast<SizeType>(active.size());
+
+        // The rejected drafts of the previous iteration are rolled back. Drafts are cut to the tokens the requests
+        // have room for, one more token comes from the target model, and to the max input length of a pass.
+        auto const draftStart = std::chrono::steady_clock::now();
+        std::vector<SizeType> pastLengths(numActive);
+        std::vector<SizeType> maxNumsDraftTokens(numActive);
+        for (SizeType ai = 0; ai < numActive; ++ai)
+        {
+            auto const bi = active[ai];
+            auto const length = static_cast<SizeType>(sequences[bi].size());
+            pastLengths[ai] = targetCache.rollBack(bi, sequences[bi]);
+            auto const maxNumTokens = std::min({maxNewTokens - numNewTokens[bi], mDecoderMaxSequenceLength - length,
+                mModelConfig.getMaxInputLen() - (length - pastLengths[ai]) + 1});
+            maxNumsDraftTokens[ai] = std::max(std::min(numDraftTokens, maxNumTokens - 1), 0);
+        }
+        auto draftTokens = draftTokensOf(active, sequences, maxNumsDraftTokens);
+        TLLM_CHECK(static_cast<SizeType>(draftTokens.size()) == numActive);
+        for (SizeType ai = 0; ai < numActive; ++ai)
+        {
+            draftTokens[ai].resize(
+                std::min(draftTokens[ai].size(), static_cast<std::size_t>(maxNumsDraftTokens[ai])));
+        }
+
+        auto const targetStart = std::chrono::steady_clock::now();
+        stats.draftTimeMs += std::chrono::duration<float, std::milli>(targetStart - draftStart).count();
+
+        // Verify all draft tokens of all requests in one pass of the target model after the tokens in its KV cache,
+        // which runs at most numDraftTokens + 1 tokens per request after the one of the prompts
+        std::vector<std::vector<TokenIdType>> passTokens(numActive);
+        for (SizeType ai = 0; ai < numActive; ++ai)
+        {
+            auto const bi = active[ai];
+            auto const& sequence = sequences[bi];
+            passTokens[ai].assign(sequence.begin() + pastLengths[ai], sequence.end());
+            passTokens[ai].insert(passTokens[ai].end(), draftTokens[ai].begin(), draftTokens[ai].end());
+            targetCache.append(bi, passTokens[ai]);
+        }
+        auto const logits = executeCachedContextStep(passTokens, pastLengths, active);
+
+        // the logits of the last sequence token predict the first draft token
+        std::vector<SizeType> logitsRows(numActive);
+        for (SizeType ai = 0, offset = 0; ai < numActive; ++ai)
+        {
+            auto const numTokens = static_cast<SizeType>(passTokens[ai].size());
+            logitsRows[ai] = offset + numTokens - static_cast<SizeType>(draftTokens[ai].size()) - 1;
+            offset += numTokens;
+        }
+        auto const acceptedTokens = acceptDraftTokens(*logits, logitsRows, draftTokens, inputs.padId);
+        stats.targetTimeMs
+            += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - targetStart).count();
+        ++stats.numIterations;
+        stats.numVerifications += numActive;
+        for (SizeType ai = 0; ai < numActive; ++ai)
+        {
+            // the last token appended is the one of the target model
+            auto const numAcceptedDraftTokens = static_cast<SizeType>(acceptedTokens[ai].size()) - 1;
+            for (SizeType di = 0; di < static_cast<SizeType>(draftTokens[ai].size()); ++di)
+            {
+                ++stats.numDraftTokens[di];
+                stats.numAcceptedTokens[di] += di < numAcceptedDraftTokens ? 1 : 0;
+            }
+        }
+        for (SizeType ai = 0; ai < numActive; ++ai)
+        {
+            auto const bi = active[ai];
+            for (auto const token : acceptedTokens[ai])
+            {
+                // the end token is not part of the output sequence
+                finished[bi] = token == inputs.endId;
+                if (finished[bi])
+                {
+                    break;
+                }
+                sequences[bi].push_back(token);
+                ++numNewTokens[bi];
+                ++stats.numTokens;
+                finished[bi] = numNewTokens[bi] >= maxNewTokens
+                    || static_cast<SizeType>(sequences[bi].size()) >= mDecoderMaxSequenceLength;
+                if (finished[bi])
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    // Output ids are padded with the end token, like the output of generate
+    std::vector<TokenIdType> outputIds(batchSize * mDecoderMaxSequenceLength, inputs.endId);
+    std::vector<SizeType> outputLengths(batchSize);
+    for (SizeType bi = 0; bi < batchSize; ++bi)
+    {
+        std::copy(sequences[bi].begin(), sequences[bi].end(), outputIds.begin() + bi * mDecoderMaxSequenceLength);
+        outputLengths[bi] = static_cast<SizeType>(sequences[bi].size());
+    }
+    outputs.ids->reshape(ITensor::makeShape({batchSize, 1, mDecoderMaxSequenceLength}));
+    outputs.lengths->reshape(ITensor::makeShape({batchSize, 1}));
+    manager.copy(outputIds.data(), *outputs.ids);
+    manager.copy(outputLengths.data(), *outputs.lengths);
+    stream.synchronize();
     TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
 }
 
@@ -617,7 +1856,7 @@ GptSession::TokenGeneratedCallback GptSession::createOnTokenGeneratedCallback(Ge
 
 void GptSession::generateBatched(std::vector<GenerationOutput>& microBatchesOutputs,
     std::vector<GenerationInput> const& microBatchesInputs, SamplingConfig const& samplingConfig,
-    TokenGeneratedCallback const& onTokenGenerated)
+    TruncationConfig const& truncationConfig, TokenGeneratedCallback const& onTokenGenerated)
 {
     TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
 
@@ -626,19 +1865,41 @@ void GptSession::generateBatched(std::vector<GenerationOutput>& microBatchesOutp
     auto const numMicroBatches = static_cast<SizeType>(microBatchesInputs.size());
     TLLM_CHECK(numMicroBatches > 0);
     TLLM_CHECK(numMicroBatches <= mMicroBatchConfig.numGenBatches);
+    TLLM_CHECK_WITH_INFO(!mBuffers.front()->returnsHiddenStates,
+        "The engine skips the LM head and returns the hidden states, use encode instead of generate");
     SizeType const beamWidth{samplingConfig.beamWidth};
 
     // Initialize and reshape buffers
     for (auto microBatchId = 0; microBatchId < numMicroBatches; ++microBatchId)
     {
+        MemoryCounters::TagScope const tagScope{MemoryTag::kRUNTIME_BUFFERS};
         auto const& microBatchInputs = microBatchesInputs.at(microBatchId);
         auto& buffers = *mBuffers.at(microBatchId);
         buffers.initFromInput(*microBatchInputs.ids, microBatchInputs.lengths, microBatchInputs.packed, beamWidth,
             mDecoderMaxAttentionWindow, mDecoderMaxSequenceLength, manager);
-        buffers.reshape(mModelConfig, mWorldConfig);
+        buffers.reshape(manager, mModelConfig, mWorldConfig);
         buffers.reset(manager);
     }
 
+    auto& state = getState();
+    state.tokenConstraintMasks.assign(numMicroBatches, nullptr);
+    if (mWorldConfig.isLastPipelineParallelRank())
+    {
+        auto const vocabSizePadded = mModelConfig.getVocabSizePadded(mWorldConfig.getSize());
+        for (auto microBatchId = 0; microBatchId < numMicroBatches; ++microBatchId)
+        {
+            auto const& tokenConstraints = microBatchesInputs.at(microBatchId).tokenConstraints;
+            if (tokenConstraints.empty())
+                continue;
+            TLLM_CHECK_WITH_INFO(beamWidth == 1, "Token constraints do not support beam search.");
+            TLLM_CHECK_WITH_INFO(static_cast<SizeType>(tokenConstraints.size())
+                    == mBuffers.at(microBatchId)->generationConfig.batchSize,
+                "Token constraints must be given for each request of the batch.");
+            state.tokenConstraintMasks[microBatchId]
+                = std::make_shared<TokenConstraintMasks>(tokenConstraints, vocabSizePadded, manager);
+        }
+    }
+
     std::vector<SizeType> microBatchOffsets(1, 0);
     microBatchOffsets.reserve(numMicroBatches + 1);
     for (auto microBatchId = 0; microBatchId < numMicroBatches; ++microBatchId)
@@ -656,8 +1917,8 @@ void GptSession::generateBatched(std::vector<GenerationOutput>& microBatchesOutp
         auto& microBatchOutputs = microBatchesOutputs.at(microBatchId);
         buffers.outputIds = microBatchOutputs.ids;
         buffers.outputLengths = microBatchOutputs.lengths;
-        buffers.newTokens
-            = initDecoder(*buffers.outputIds, microBatchInputs, microBatchOutputs, samplingConfig, microBatchId);
+        buffers.newTokens = initDecoder(
+            *buffers.outputIds, microBatchInputs, microBatchOutputs, samplingConfig, truncationConfig, microBatchId);
 
         if (mWorldConfig.isLastPipelineParallelRank())
         {
@@ -680,19 +1941,26 @@ void GptSession::generateBatched(std::vector<GenerationOutput>& microBatchesOutp
         {
             buffers.promptTuningParams = microBatchInputs.promptTuningParams;
         }
+        buffers.extraInputs = microBatchInputs.extraInputs;
     }
 
-    if (useCudaGraphs())
+    auto kvCacheManager = mModelConfig.usePagedKvCache() ? mKvCacheManager.get() : nullptr;
+
+    auto& commProfiler = tc::CommProfiler::getInstance();
+    // Events at the boundaries of the steps, to compare their durations with the ones of their collectives
+    std::vector<CudaEvent> stepEvents;
+    auto const recordStep = [&stepEvents, &manager, timeSteps = commProfiler.isEnabled()]()
     {
-        for (auto& instance : mCudaGraphInstances)
+        if (timeSteps)
         {
-            instance.clear();
+            manager.getStream().record(stepEvents.emplace_back(cudaEventDefault));
         }
-    }
-
-    auto kvCacheManager = mModelConfig.usePagedKvCache() ? mKvCacheManager.get() : nullptr;
-
+    };
+    recordStep();
+    commProfiler.setIteration(0);
+    sampleKvCacheScales();
     executeContextStep(microBatchesInputs, microBatchesOutputs, microBatchOffsets, kvCacheManager);
+    recordStep();
 
     std::vector<bool> microBatchesFinished(numMicroBatches, false);
     SizeType numBatchesFinished{0};
@@ -700,8 +1968,11 @@ void GptSession::generateBatched(std::vector<GenerationOutput>& microBatchesOutp
     while (numBatchesFinished < numMicroBatches)
     {
         ++step;
+        commProfiler.setIteration(step);
+        sampleKvCacheScales();
         numBatchesFinished += executeGenerationStep(
             step, microBatchesInputs, microBatchesOutputs, microBatchOffsets, kvCacheManager, microBatchesFinished);
+        recordStep();
 
         onTokenGenerated(step - 1, numBatchesFinished == numMicroBatches);
     }
@@ -759,10 +2030,55 @@ void GptSession::generateBatched(std::vector<GenerationOutput>& microBatchesOutp
         }
     }
 
+    if (state.kvCacheScaleSampleInterval > 0)
+    {
+        // No sequence holds values quantized with the current scales any more
+        auto& calibrator = tk::KvCacheScaleCalibrator::getInstance();
+        calibrator.setCollecting(false, manager.getStream().get());
+        calibrator.update(state.kvCacheScaleMargin, manager.getStream().get());
+    }
+
     manager.getStream().synchronize();
+    if (commProfiler.isEnabled())
+    {
+        state.commStats = commProfiler.collect();
+        state.stepTimesMs.clear();
+        for (std::size_t i = 1; i < stepEvents.size(); ++i)
+        {
+            float timeMs = 0.F;
+            TLLM_CUDA_CHECK(cudaEventElapsedTime(&timeMs, stepEvents[i - 1].get(), stepEvents[i].get()));
+            state.stepTimesMs.push_back(timeMs);
+        }
+    }
     TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
 }
 
+void GptSession::executeContextBatch(RuntimeBuffers& buffers, TensorPtr const& inputIds, TokenIdType padId,
+    KvCacheManager const* kvCacheManager, SizeType batchOffset)
+{
+    NVTX3_SCOPED_RANGE_IN(context_step, Context, inputIds->getSize());
+    auto& manager = mRuntime->getBufferManager();
+    auto constexpr step = 0;
+    auto& inputBuffer = buffers.inputBuffers[0];
+    auto& outputBuffer = buffers.outputBuffers[0];
+
+    buffers.prepareContextStep(inputIds, padId, manager, kvCacheManager, batchOffset, mModelConfig, mWorldConfig);
+    buffers.getRuntimeBuffers(inputBuffer, outputBuffer, step, inputIds, mCommPtrs, mModelConfig, mWorldConfig);
+    auto& state = getState();
+    auto const contextId = selectContext(inputBuffer, state.contextPhaseContexts);
+    mRuntime->setInputTensors(contextId, inputBuffer);
+    mRuntime->setOutputTensors(contextId, outputBuffer);
+
+    auto const sampled
+        = state.gpuMetricsSampler && state.gpuMetricsSampler->begin(GpuPhase::kCONTEXT, mRuntime->getStream());
+    TLLM_CHECK_WITH_INFO(mRuntime->executeContext(contextId), "Executing TRT engine in context step failed!");
+    if (sampled)
+    {
+        state.gpuMetricsSampler->end(mRuntime->getStream());
+    }
+    sync_check_cuda_error();
+}
+
 void GptSession::executeContextStep(std::vector<GenerationInput> const& microBatchesInputs,
     std::vector<GenerationOutput>& microBatchesOutputs, std::vector<SizeType> const& generationBatchOffsets,
     KvCacheManager const* kvCacheManager)
@@ -772,9 +2088,9 @@ void GptSession::executeContextStep(std::vector<GenerationInput> const& microBat
 
     auto const numGenerationBatches = static_cast<SizeType>(microBatchesInputs.size());
     auto constexpr step = 0;
-    auto constexpr contextId = 0;
     for (auto generationBatchId = 0; generationBatchId < numGenerationBatches; ++generationBatchId)
     {
+        NVTX3_SCOPED_RANGE_IN(context_micro_batch, Context, generationBatchId);
         auto const& generationBatchInputs = microBatchesInputs.at(generationBatchId);
         auto& generationBuffers = *mBuffers.at(generationBatchId);
 
@@ -788,19 +2104,8 @@ void GptSession::executeContextStep(std::vector<GenerationInput> const& microBat
         for (auto contextBatchId = 0; contextBatchId < numContextBatches; ++contextBatchId)
         {
             auto batchOffset = generationBatchOffsets.at(generationBatchId) + contextBatchOffsets.at(contextBatchId);
-            auto& buffers = contextBuffers.at(contextBatchId);
-            auto& inputBuffer = buffers.inputBuffers[0];
-            auto& outputBuffer = buffers.outputBuffers[0];
-
-            buffers.prepareContextStep(inputIds.at(contextBatchId), generationBatchInputs.padId, manager,
-                kvCacheManager, batchOffset, mModelConfig, mWorldConfig);
-            buffers.getRuntimeBuffers(
-                inputBuffer, outputBuffer, step, inputIds.at(contextBatchId), mCommPtrs, mModelConfig, mWorldConfig);
-            mRuntime->setInputTensors(contextId, inputBuffer);
-            mRuntime->setOutputTensors(contextId, outputBuffer);
-
-            TLLM_CHECK_WITH_INFO(mRuntime->executeContext(contextId), "Executing TRT engine in context step failed!");
-            sync_check_cuda_error();
+            executeContextBatch(contextBuffers.at(contextBatchId), inputIds.at(contextBatchId),
+                generationBatchInputs.padId, kvCacheManager, batchOffset);
         }
 
         generationBuffers.postContextStep(contextBuffers, manager, mModelConfig, mWorldConfig);
@@ -819,6 +2124,7 @@ void GptSession::executeContextStep(std::vector<GenerationInput> const& microBat
             auto& outputs = microBatchesOutputs.at(generationBatchId);
             outputs.generationLogitsFragments->push_back(generationBuffers.logits);
         }
+        gatherTopLogProbs(microBatchesOutputs.at(generationBatchId), *generationBuffers.logits, step);
 
         std::swap(generationBuffers.cacheIndirectionDecoderInput, generationBuffers.cacheIndirectionDecoderOutput);
 
@@ -835,6 +2141,18 @@ void GptSession::executeContextStep(std::vector<GenerationInput> const& microBat
     TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
 }
 
+void GptSession::gatherTopLogProbs(GenerationOutput& outputs, ITensor const& logits, SizeType step) const
+{
+    // Only the last pipeline parallel rank has logits, steps past the output are not recorded
+    if (!outputs.topLogProbs || !mWorldConfig.isLastPipelineParallelRank()
+        || step >= outputs.topLogProbs->getShape().d[2])
+    {
+        return;
+    }
+    kernels::gatherTopLogProbs(*outputs.topLogProbIds, *outputs.topLogProbs, logits, step,
+        mModelConfig.getVocabSize(), mRuntime->getStream());
+}
+
 SizeType GptSession::executeGenerationStep(SizeType step, std::vector<GenerationInput> const& microBatchesInputs,
     std::vector<GenerationOutput>& microBatchesOutputs, std::vector<SizeType> const& microBatchOffsets,
     KvCacheManager* kvCacheManager, std::vector<bool>& microBatchesFinished)
@@ -842,12 +2160,12 @@ SizeType GptSession::executeGenerationStep(SizeType step, std::vector<Generation
     TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
     TLLM_CHECK(microBatchesInputs.size() == microBatchesOutputs.size());
     auto& manager = mRuntime->getBufferManager();
+    auto& state = getState();
 
     auto const numMicroBatches = static_cast<SizeType>(microBatchesInputs.size());
     SizeType numBatchesFinished{0};
 
     auto const flipFlopId = step % 2;
-    auto const contextId = mRuntime->getNbProfiles() - 1;
     for (auto generationBatchId = 0; generationBatchId < numMicroBatches; ++generationBatchId)
     {
         if (microBatchesFinished.at(generationBatchId))
@@ -855,24 +2173,30 @@ SizeType GptSession::executeGenerationStep(SizeType step, std::vector<Generation
 
         auto& buffers = *mBuffers.at(generationBatchId);
         auto const& generationConfig = buffers.generationConfig;
+        NVTX3_SCOPED_RANGE_IN(generation_step, Generation, generationConfig.batchSize);
 
         auto const graphId = mMicroBatchConfig.getGenGraphId(flipFlopId, generationBatchId);
+        auto const batchState
+            = CudaGraphExecutorCache::BatchState{generationConfig.batchSize, generationConfig.beamWidth};
         auto& inputBuffer = buffers.inputBuffers[flipFlopId];
         auto& outputBuffer = buffers.outputBuffers[flipFlopId];
 
         auto nextInputIds = buffers.prepareNextStep(
             step - 1, manager, kvCacheManager, microBatchOffsets.at(generationBatchId), mModelConfig, mWorldConfig);
         buffers.getRuntimeBuffers(inputBuffer, outputBuffer, step, nextInputIds, mCommPtrs, mModelConfig, mWorldConfig);
+        auto const contextId = selectContext(inputBuffer, state.generationPhaseContexts);
         mRuntime->setInputTensors(contextId, inputBuffer);
         mRuntime->setOutputTensors(contextId, outputBuffer);
 
         if (useCudaGraphs())
         {
-            mCudaGraphInstances.at(graphId).prepareNextGraph(*mRuntime, contextId);
+            state.cudaGraphInstances.at(graphId).get(batchState).prepareNextGraph(*mRuntime, contextId);
         }
 
-        // check decoder result of previous iteration
-        if (shouldStopSync(generationConfig.batchSize, generationConfig.beamWidth, generationBatchId))
+        // check decoder result of previous iteration, always once the maximum sequence length is reached
+        auto const checkStop = (step - 1) % state.stopCheckInterval == 0
+            || generationConfig.maxInputLength + step >= generationConfig.maxSeqLength;
+        if (checkStop && shouldStopSync(generationConfig.batchSize, generationConfig.beamWidth, generationBatchId))
         {
             mLogger->log(nvinfer1::ILogger::Severity::kVERBOSE,
                 tc::fmtstr("GPT decoding finished for step %d and microBatchId %d", step, generationBatchId).c_str());
@@ -881,9 +2205,11 @@ SizeType GptSession::executeGenerationStep(SizeType step, std::vector<Generation
             continue;
         }
 
+        auto const sampled
+            = state.gpuMetricsSampler && state.gpuMetricsSampler->begin(GpuPhase::kGENERATION, mRuntime->getStream());
         if (useCudaGraphs())
         {
-            auto& cudaGraphInstance = mCudaGraphInstances.at(graphId);
+            auto& cudaGraphInstance = state.cudaGraphInstances.at(graphId).get(batchState);
             TLLM_CHECK(cudaGraphInstance.hasInstance());
             cudaGraphInstance.launch(mRuntime->getStream());
         }
@@ -892,6 +2218,10 @@ SizeType GptSession::executeGenerationStep(SizeType step, std::vector<Generation
             TLLM_CHECK_WITH_INFO(
                 mRuntime->executeContext(contextId), tc::fmtstr("Executing TRT engine in step %d failed!", step));
         }
+        if (sampled)
+        {
+            state.gpuMetricsSampler->end(mRuntime->getStream());
+        }
         sync_check_cuda_error();
 
         if (mModelConfig.computeGenerationLogits())
@@ -899,6 +2229,7 @@ SizeType GptSession::executeGenerationStep(SizeType step, std::vector<Generation
             auto& outputs = microBatchesOutputs.at(generationBatchId);
             outputs.generationLogitsFragments->push_back(buffers.logits);
         }
+        gatherTopLogProbs(microBatchesOutputs.at(generationBatchId), *buffers.logits, step);
         sync_check_cuda_error();
 
         std::swap(buffers.cacheIndirectionDecoderInput, buffers.cacheIndirectionDecoderOutput);
@@ -921,6 +2252,7 @@ SizeType GptSession::executeGenerationStep(SizeType step, std::vector<Generation
 void GptSession::decoderStepAsync(SizeType decoderStep, SizeType microBatchId)
 {
     TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    NVTX3_SCOPED_RANGE_IN(decoder_step, Decode, microBatchId);
     auto& stream = mRuntime->getStream();
     auto& buffers = *mBuffers.at(microBatchId);
     auto const& outputIds = buffers.outputIds;
@@ -936,7 +2268,19 @@ void GptSession::decoderStepAsync(SizeType decoderStep, SizeType microBatchId)
         decodingOutput.cacheIndirection = buffers.cacheIndirectionDecoderOutput;
         decodingOutput.sequenceLengths = buffers.sequenceLengths;
 
+        auto const& tokenConstraintMasks = getState().tokenConstraintMasks.at(microBatchId);
+        if (tokenConstraintMasks)
+        {
+            // The engine of this step is already enqueued, the constraints run on the host meanwhile
+            tokenConstraintMasks->update();
+            decodingInput.logitsBitmask = tokenConstraintMasks->getBitmasks();
+        }
+
         decoder.forwardAsync(decodingOutput, decodingInput);
+        if (tokenConstraintMasks)
+        {
+            tokenConstraintMasks->recordTokens(*decoder.getNewTokens(), *buffers.sequenceLengths);
+        }
         if (mWorldConfig.isPipelineParallel())
         { // send shouldStop to all previous ranks and newTokens to the first rank
             stream.record(mCommEvent.get());
@@ -992,6 +2336,17 @@ void GptSession::decoderStepAsync(SizeType decoderStep, SizeType microBatchId)
     TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
 }
 
+void GptSession::sampleKvCacheScales()
+{
+    auto& state = getState();
+    if (state.kvCacheScaleSampleInterval == 0)
+    {
+        return;
+    }
+    auto const collecting = state.kvCacheScaleStep++ % state.kvCacheScaleSampleInterval == 0;
+    tk::KvCacheScaleCalibrator::getInstance().setCollecting(collecting, mRuntime->getStream().get());
+}
+
 bool GptSession::shouldStopSync(SizeType batchSize, SizeType beamWidth, SizeType microBatchId)
 {
     TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
@@ -1164,3 +2519,21 @@ void GptSession::CudaGraphExecutor::prepareNextGraph(TllmRuntime const& runtime,
     uploadToStream(stream);
     TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
 }
+
+GptSession::CudaGraphExecutor& GptSession::CudaGraphExecutorCache::get(BatchState const& state)
+{
+    auto it = mMap.find(state);
+    if (it != mMap.end())
+    {
+        mCache.splice(mCache.begin(), mCache, it->second);
+        return *mCache.front().second;
+    }
+    if (static_cast<SizeType>(mCache.size()) == mCapacity)
+    {
+        mMap.erase(mCache.back().first);
+        mCache.pop_back();
+    }
+    mCache.emplace_front(state, std::make_unique<CudaGraphExecutor>());
+    mMap[state] = mCache.begin();
+    return *mCache.front().second;
+}
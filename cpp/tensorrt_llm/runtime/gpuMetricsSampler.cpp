@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/gpuMetricsSampler.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
+
+#if !defined(_WIN32)
+#include <dlfcn.h>
+#include <nvml.h>
+#endif
+
+using namespace tensorrt_llm::runtime;
+
+namespace tensorrt_llm::runtime
+{
+
+char const* getGpuPhaseName(GpuPhase phase)
+{
+    switch (phase)
+    {
+    case GpuPhase::kCONTEXT: return "Context";
+    case GpuPhase::kGENERATION: return "Generation";
+    }
+    return "Unknown";
+}
+
+char const* getGpuMetricName(GpuMetric metric)
+{
+    switch (metric)
+    {
+    case GpuMetric::kDRAM_BW_UTIL: return "DRAM BW Util";
+    case GpuMetric::kSM_UTIL: return "SM Util";
+    case GpuMetric::kSM_OCCUPANCY: return "SM Occupancy";
+    case GpuMetric::kTENSOR_UTIL: return "Tensor Util";
+    }
+    return "Unknown";
+}
+
+} // namespace tensorrt_llm::runtime
+
+#if defined(_WIN32)
+
+struct GpuMetricsSampler::Nvml
+{
+    static std::unique_ptr<Nvml> open(int /* device */)
+    {
+        return nullptr;
+    }
+
+    bool sampleBefore()
+    {
+        return false;
+    }
+
+    bool getMetrics(std::array<double, kNbGpuMetrics>& /* values */)
+    {
+        return false;
+    }
+};
+
+#else
+
+namespace
+{
+
+// GPM metrics in the order of GpuMetric
+std::array<unsigned int, kNbGpuMetrics> constexpr kGpmMetricIds{NVML_GPM_METRIC_DRAM_BW_UTIL, NVML_GPM_METRIC_SM_UTIL,
+    NVML_GPM_METRIC_SM_OCCUPANCY, NVML_GPM_METRIC_ANY_TENSOR_UTIL};
+
+} // namespace
+
+struct GpuMetricsSampler::Nvml
+{
+    void* handle{nullptr};
+    decltype(&nvmlShutdown) shutdown{nullptr};
+    decltype(&nvmlGpmSampleGet) sampleGet{nullptr};
+    decltype(&nvmlGpmSampleFree) sampleFree{nullptr};
+    decltype(&nvmlGpmMetricsGet) metricsGet{nullptr};
+    nvmlDevice_t device{};
+    nvmlGpmSample_t before{nullptr};
+    nvmlGpmSample_t after{nullptr};
+
+    ~Nvml()
+    {
+        if (before != nullptr)
+        {
+            sampleFree(before);
+        }
+        if (after != nullptr)
+        {
+            sampleFree(after);
+        }
+        if (shutdown != nullptr)
+        {
+            shutdown();
+        }
+        dlclose(handle);
+    }
+
+    // Returns nullptr when NVML is not available or does not support GPM on the device
+    static std::unique_ptr<Nvml> open(int device)
+    {
+        auto* handle = dlopen("libnvidia-ml.so.1", RTLD_LAZY);
+        if (handle == nullptr)
+        {
+            return nullptr;
+        }
+        auto nvml = std::make_unique<Nvml>();
+        nvml->handle = handle;
+
+        decltype(&nvmlInit_v2) init;
+        decltype(&nvmlShutdown) shutdown;
+        decltype(&nvmlDeviceGetHandleByPciBusId_v2) getHandleByPciBusId;
+        decltype(&nvmlGpmQueryDeviceSupport) queryDeviceSupport;
+        decltype(&nvmlGpmSampleAlloc) sampleAlloc;
+        *(void**) (&init) = dlsym(handle, "nvmlInit_v2");
+        *(void**) (&shutdown) = dlsym(handle, "nvmlShutdown");
+        *(void**) (&getHandleByPciBusId) = dlsym(handle, "nvmlDeviceGetHandleByPciBusId_v2");
+        *(void**) (&queryDeviceSupport) = dlsym(handle, "nvmlGpmQueryDeviceSupport");
+        *(void**) (&sampleAlloc) = dlsym(handle, "nvmlGpmSampleAlloc");
+        *(void**) (&nvml->sampleGet) = dlsym(handle, "nvmlGpmSampleGet");
+        *(void**) (&nvml->sampleFree) = dlsym(handle, "nvmlGpmSampleFree");
+        *(void**) (&nvml->metricsGet) = dlsym(handle, "nvmlGpmMetricsGet");
+        // The drivers older than the GPM API do not have its functions
+        if (init == nullptr || shutdown == nullptr || getHandleByPciBusId == nullptr || queryDeviceSupport == nullptr
+            || sampleAlloc == nullptr || nvml->sampleGet == nullptr || nvml->sampleFree == nullptr
+            || nvml->metricsGet == nullptr || init() != NVML_SUCCESS)
+        {
+            return nullptr;
+        }
+        nvml->shutdown = shutdown;
+
+        char busId[32];
+        TLLM_CUDA_CHECK(cudaDeviceGetPCIBusId(busId, sizeof(busId), device));
+        nvmlGpmSupport_t support{};
+        support.version = NVML_GPM_SUPPORT_VERSION;
+        if (getHandleByPciBusId(busId, &nvml->device) != NVML_SUCCESS
+            || queryDeviceSupport(nvml->device, &support) != NVML_SUCCESS || !support.isSupportedDevice
+            || sampleAlloc(&nvml->before) != NVML_SUCCESS || sampleAlloc(&nvml->after) != NVML_SUCCESS)
+        {
+            return nullptr;
+        }
+        return nvml;
+    }
+
+    bool sampleBefore()
+    {
+        return sampleGet(device, before) == NVML_SUCCESS;
+    }
+
+    // Samples the counters again and computes the metrics since sampleBefore
+    bool getMetrics(std::array<double, kNbGpuMetrics>& values)
+    {
+        if (sampleGet(device, after) != NVML_SUCCESS)
+        {
+            return false;
+        }
+        nvmlGpmMetricsGet_t metrics{};
+        metrics.version = NVML_GPM_METRICS_GET_VERSION;
+        metrics.numMetrics = kNbGpuMetrics;
+        metrics.sample1 = before;
+        metrics.sample2 = after;
+        for (std::size_t metric = 0; metric < kNbGpuMetrics; ++metric)
+        {
+            metrics.metrics[metric].metricId = kGpmMetricIds[metric];
+        }
+        if (metricsGet(&metrics) != NVML_SUCCESS)
+        {
+            return false;
+        }
+        for (std::size_t metric = 0; metric < kNbGpuMetrics; ++metric)
+        {
+            if (metrics.metrics[metric].nvmlReturn != NVML_SUCCESS)
+            {
+                return false;
+            }
+            values[metric] = metrics.metrics[metric].value;
+        }
+        return true;
+    }
+};
+
+#endif
+
+GpuMetricsSampler::GpuMetricsSampler(SizeType interval, int device)
+    : mInterval{interval}
+    , mNvml{Nvml::open(device)}
+{
+    TLLM_CHECK_WITH_INFO(interval > 0, "The GPU metrics sampling interval must be positive");
+    if (!mNvml)
+    {
+        TLLM_LOG_WARNING("NVML GPU performance monitoring is not supported on device %d, GPU metrics are not sampled",
+            device);
+    }
+}
+
+GpuMetricsSampler::~GpuMetricsSampler() = default;
+
+bool GpuMetricsSampler::sample(GpuPhase phase)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mNumSteps[static_cast<std::size_t>(phase)]++ % mInterval == 0;
+}
+
+bool GpuMetricsSampler::begin(GpuPhase phase, CudaStream const& stream)
+{
+    if (!mNvml || !sample(phase))
+    {
+        return false;
+    }
+    stream.synchronize();
+    if (!mNvml->sampleBefore())
+    {
+        return false;
+    }
+    mPhase = phase;
+    mStart = std::chrono::steady_clock::now();
+    return true;
+}
+
+void GpuMetricsSampler::end(CudaStream const& stream)
+{
+    stream.synchronize();
+    auto const timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mStart).count();
+    std::array<double, kNbGpuMetrics> values{};
+    if (mNvml->getMetrics(values))
+    {
+        add(mPhase, timeMs, values);
+    }
+}
+
+void GpuMetricsSampler::add(GpuPhase phase, double timeMs, std::array<double, kNbGpuMetrics> const& values)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStats[phase].add(timeMs, values);
+}
+
+GpuMetricsStats GpuMetricsSampler::collect()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto stats = mStats;
+    mStats = GpuMetricsStats{};
+    return stats;
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/gpuMetricsStats.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief Reads the DRAM bandwidth, SM activity, SM occupancy and tensor core activity of the device around one in
+//! every `interval` engine steps of each phase.
+//!
+//! The counters are read with the GPU Performance Monitoring (GPM) API of NVML, which is opened at runtime so that it
+//! is not a dependency of the library. GPM needs a Hopper or newer device, on the others the sampler is not supported
+//! and does nothing. A sampled step synchronizes the stream before and after the engine runs, the other steps run
+//! unchanged. The counters are the ones of the whole device, including the work of other streams and processes.
+class GpuMetricsSampler
+{
+public:
+    GpuMetricsSampler(SizeType interval, int device);
+
+    ~GpuMetricsSampler();
+
+    GpuMetricsSampler(GpuMetricsSampler const&) = delete;
+    GpuMetricsSampler& operator=(GpuMetricsSampler const&) = delete;
+
+    [[nodiscard]] SizeType getInterval() const
+    {
+        return mInterval;
+    }
+
+    //! \brief Whether NVML is available and supports GPM on the device.
+    [[nodiscard]] bool isSupported() const
+    {
+        return mNvml != nullptr;
+    }
+
+    //! \brief Counts a step of phase, returns whether it is sampled.
+    bool sample(GpuPhase phase);
+
+    //! \brief Counts a step of phase and, if it is sampled, reads the counters once the work already on stream is
+    //! done. Returns whether end must be called after the engine is enqueued.
+    bool begin(GpuPhase phase, CudaStream const& stream);
+
+    //! \brief Reads the counters again once the step is done and adds the metrics of the step.
+    void end(CudaStream const& stream);
+
+    //! \brief Adds the metrics of a step of phase that lasted timeMs.
+    void add(GpuPhase phase, double timeMs, std::array<double, kNbGpuMetrics> const& values);
+
+    //! \brief Returns the stats since the last call and clears them.
+    GpuMetricsStats collect();
+
+private:
+    struct Nvml;
+
+    SizeType mInterval;
+    std::unique_ptr<Nvml> mNvml;
+    std::mutex mMutex;
+    std::array<std::uint64_t, kNbGpuPhases> mNumSteps{};
+    GpuMetricsStats mStats;
+    // Phase and start of the step between begin and end
+    GpuPhase mPhase{GpuPhase::kCONTEXT};
+    std::chrono::steady_clock::time_point mStart;
+};
+
+} // namespace tensorrt_llm::runtime
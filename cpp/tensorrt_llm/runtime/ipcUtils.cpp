@@ -15,32 +15,68 @@
  */
 #include "tensorrt_llm/runtime/ipcUtils.h"
 #include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
 #include "tensorrt_llm/common/mpiUtils.h"
 
+#include <algorithm>
+
 namespace tensorrt_llm::runtime
 {
 
+namespace
+{
+
+// The ranks of a TP group spanning several nodes are split between the nodes in order. Only the ranks of the same
+// node share their buffers.
+SizeType getLocalTensorParallelism(WorldConfig const& worldConfig)
+{
+    return std::min(worldConfig.getTensorParallelism(), worldConfig.getGpusPerNode());
+}
+
+SizeType getLocalTensorParallelRank(WorldConfig const& worldConfig)
+{
+    return worldConfig.getTensorParallelRank() % getLocalTensorParallelism(worldConfig);
+}
+
+// TP rank of the first rank of the group on this node
+SizeType getNodeTensorParallelRank(WorldConfig const& worldConfig)
+{
+    return worldConfig.getTensorParallelRank() - getLocalTensorParallelRank(worldConfig);
+}
+
+} // namespace
+
 void setPeerAccess(WorldConfig worldConfig, bool enable)
 {
-    const auto srcNode = worldConfig.getTensorParallelRank();
+    // The peers are the ranks of the TP group on this node, on the devices given by the world config
+    auto const localTp = getLocalTensorParallelism(worldConfig);
+    auto const firstPeer = worldConfig.getPipelineParallelRank() * worldConfig.getTensorParallelism()
+        + worldConfig.getTensorParallelRank() / localTp * localTp;
+    const auto srcDevice = worldConfig.getDevice();
 
-    for (SizeType destNode = 0; destNode < worldConfig.getTensorParallelism(); destNode++)
+    for (SizeType peer = firstPeer; peer < firstPeer + localTp; peer++)
     {
-        if (destNode == srcNode)
+        const auto destDevice = worldConfig.getDeviceOf(peer);
+        if (destDevice == srcDevice)
         {
             continue;
         }
 
         int canAccessPeer;
-        TLLM_CUDA_CHECK(cudaDeviceCanAccessPeer(&canAccessPeer, srcNode, destNode));
+        TLLM_CUDA_CHECK(cudaDeviceCanAccessPeer(&canAccessPeer, srcDevice, destDevice));
+        if (!canAccessPeer)
+        {
+            TLLM_LOG_WARNING("Device %d cannot access the memory of device %d", srcDevice, destDevice);
+            continue;
+        }
 
         if (enable)
         {
-            cudaDeviceEnablePeerAccess(destNode, 0);
+            cudaDeviceEnablePeerAccess(destDevice, 0);
         }
         else
         {
-            cudaDeviceDisablePeerAccess(destNode);
+            cudaDeviceDisablePeerAccess(destDevice);
         }
         const auto error = cudaGetLastError();
         if (error != cudaErrorPeerAccessAlreadyEnabled && error != cudaErrorPeerAccessNotEnabled)
@@ -52,7 +88,7 @@ void setPeerAccess(WorldConfig worldConfig, bool enable)
 
 IpcMemory::IpcMemory(WorldConfig worldConfig, std::size_t bufferSize)
     : mWorldConfig(worldConfig)
-    , mCommPtrs(worldConfig.getTensorParallelism())
+    , mCommPtrs(worldConfig.getTensorParallelism(), nullptr)
     , mBufferSize(bufferSize)
 {
     allocateIpcMemory();
@@ -68,28 +104,33 @@ void IpcMemory::allocateIpcMemory()
 
     const auto tpRank = mWorldConfig.getTensorParallelRank();
     const auto ppRank = mWorldConfig.getPipelineParallelRank();
-    auto const comm = COMM_SESSION.split(ppRank, tpRank);
-    std::vector<char> serialHandles(CUDA_IPC_HANDLE_SIZE * mWorldConfig.getTensorParallelism(), 0);
+    const auto localTpSize = getLocalTensorParallelism(mWorldConfig);
+    const auto nodeIdx = tpRank / localTpSize;
+    auto const comm = COMM_SESSION.split(ppRank * mWorldConfig.getTensorParallelism() + nodeIdx, tpRank);
+    std::vector<char> serialHandles(CUDA_IPC_HANDLE_SIZE * localTpSize, 0);
     comm.allgather(&localHandle.reserved, serialHandles.data(), CUDA_IPC_HANDLE_SIZE, mpi::MpiType::kBYTE);
 
-    std::vector<cudaIpcMemHandle_t> handles(mWorldConfig.getTensorParallelism());
+    std::vector<cudaIpcMemHandle_t> handles(localTpSize);
     for (size_t i = 0; i < handles.size(); ++i)
     {
         memcpy(handles[i].reserved, &serialHandles[i * CUDA_IPC_HANDLE_SIZE], CUDA_IPC_HANDLE_SIZE);
     }
 
+    // The pointers keep one entry per TP rank, as the GptManager lays out the all-reduce workspace. The entries of the
+    // ranks on other nodes stay null.
+    const auto nodeTpRank = getNodeTensorParallelRank(mWorldConfig);
     for (size_t nodeId = 0; nodeId < handles.size(); nodeId++)
     {
-        if ((int) nodeId == mWorldConfig.getTensorParallelRank())
+        if ((int) nodeId == getLocalTensorParallelRank(mWorldConfig))
         {
-            mCommPtrs[nodeId] = mBufferPtr;
+            mCommPtrs[nodeTpRank + nodeId] = mBufferPtr;
         }
         else
         {
             uint8_t* foreignBuffer;
             TLLM_CUDA_CHECK(cudaIpcOpenMemHandle(
                 reinterpret_cast<void**>(&foreignBuffer), handles[nodeId], cudaIpcMemLazyEnablePeerAccess));
-            mCommPtrs[nodeId] = foreignBuffer;
+            mCommPtrs[nodeTpRank + nodeId] = foreignBuffer;
         }
     }
 }
@@ -101,15 +142,16 @@ IpcMemory::~IpcMemory()
 
 void IpcMemory::destroyIpcMemory()
 {
-    for (SizeType nodeId = 0; nodeId < mWorldConfig.getTensorParallelism(); ++nodeId)
+    const auto nodeTpRank = getNodeTensorParallelRank(mWorldConfig);
+    for (SizeType nodeId = 0; nodeId < getLocalTensorParallelism(mWorldConfig); ++nodeId)
     {
-        if ((int) nodeId == mWorldConfig.getTensorParallelRank())
+        if ((int) nodeId == getLocalTensorParallelRank(mWorldConfig))
         {
-            TLLM_CUDA_CHECK(cudaFree(mCommPtrs[nodeId]));
+            TLLM_CUDA_CHECK(cudaFree(mCommPtrs[nodeTpRank + nodeId]));
         }
         else
         {
-            TLLM_CUDA_CHECK(cudaIpcCloseMemHandle(mCommPtrs[nodeId]));
+            TLLM_CUDA_CHECK(cudaIpcCloseMemHandle(mCommPtrs[nodeTpRank + nodeId]));
         }
     }
     cudaFree(mBufferPtr);
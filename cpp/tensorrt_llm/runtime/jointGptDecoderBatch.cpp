@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/jointGptDecoderBatch.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/nvtxUtils.h"
+#include "tensorrt_llm/kernels/decodingCommon.h"
+#include "tensorrt_llm/kernels/penaltyTypes.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/runtimeKernels.h"
+#include "tensorrt_llm/runtime/tensorSpan.h"
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace tensorrt_llm::runtime;
+
+namespace tc = tensorrt_llm::common;
+namespace tk = tensorrt_llm::kernels;
+
+namespace
+{
+//! Sets the parameters of slot `batchIdx` in the per slot vectors of `batchSamplingConfig` to `samplingConfig`.
+void mergeSamplingConfig(
+    SamplingConfig& batchSamplingConfig, SamplingConfig const& samplingConfig, SizeType batchIdx, SizeType batchSize)
+{
+    auto mergeOptional = [batchIdx, batchSize](auto& batch, auto const& single, auto const defaultValue)
+    {
+        using T = typename std::remove_reference_t<decltype(batch)>::value_type::value_type;
+        if (single)
+        {
+            if (!batch)
+            {
+                batch.emplace(batchSize, static_cast<T>(defaultValue));
+            }
+            batch->at(batchIdx) = single->at(0);
+        }
+        else if (batch)
+        {
+            batch->at(batchIdx) = static_cast<T>(defaultValue);
+        }
+    };
+
+    // the defaults of the sampling layers, topK == 0 and topP == 0 is greedy search
+    mergeOptional(batchSamplingConfig.temperature, samplingConfig.temperature, 1.0f);
+    mergeOptional(batchSamplingConfig.minLength, samplingConfig.minLength, 0);
+    mergeOptional(batchSamplingConfig.repetitionPenalty, samplingConfig.repetitionPenalty,
+        tk::getDefaultPenaltyValue(tk::RepetitionPenaltyType::Repetition));
+    mergeOptional(batchSamplingConfig.presencePenalty, samplingConfig.presencePenalty,
+        tk::getDefaultPenaltyValue(tk::RepetitionPenaltyType::Presence));
+    mergeOptional(batchSamplingConfig.frequencyPenalty, samplingConfig.frequencyPenalty,
+        tk::getDefaultPenaltyValue(tk::RepetitionPenaltyType::Frequency));
+    mergeOptional(batchSamplingConfig.topK, samplingConfig.topK, 0);
+    mergeOptional(batchSamplingConfig.topP, samplingConfig.topP, 0.0f);
+    mergeOptional(batchSamplingConfig.randomSeed, samplingConfig.randomSeed, 0);
+}
+
+//! Requests that need per request tensors or per request state that is reset by a setup keep their own decoder.
+bool isBatchable(decoder_batch::Request const& request, SamplingConfig const& samplingConfig)
+{
+    return samplingConfig.beamWidth == 1 && request.generatedTokensPerStep() == 1 && !request.embeddingBias
+        && !request.badWordsList && !request.stopWordsList && !request.computeLogProbs && !samplingConfig.topPDecay
+        && !samplingConfig.topPMin && !samplingConfig.topPResetIds && !samplingConfig.normalizeLogProbs.value_or(false);
+}
+
+} // namespace
+
+JointGptDecoderBatch::JointGptDecoderBatch(
+    std::size_t vocabSize, std::size_t vocabSizePadded, JointGptDecoderBatch::CudaStreamPtr stream)
+    : GptDecoderBatch(vocabSize, vocabSizePadded, std::move(stream))
+{
+}
+
+void JointGptDecoderBatch::setup(SizeType maxBatchSize, SizeType maxBeamWidth, SizeType maxAttentionWindow,
+    SizeType maxSequenceLength, SizeType maxTokensPerStep, nvinfer1::DataType dtype)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    GptDecoderBatch::setup(maxBatchSize, maxBeamWidth, maxAttentionWindow, maxSequenceLength, maxTokensPerStep, dtype);
+
+    mJointSlots.assign(maxBatchSize, false);
+    mJointSeedSlots.clear();
+    mJointLogits.reset();
+    if (maxBeamWidth == 1 && maxTokensPerStep == 1)
+    {
+        auto const maxBatchSizeShape = ITensor::makeShape({maxBatchSize});
+        mJointDecoder = IGptDecoder::create(dtype, mVocabSize, mVocabSizePadded, mStream);
+        mJointSamplingConfig = SamplingConfig{maxBeamWidth};
+        mJointFinished
+            = mBufferManager.gpu(ITensor::makeShape({maxBatchSize, maxBeamWidth}), mFinishedSteps->getDataType());
+        mJointSkipSlots = mBufferManager.gpu(maxBatchSizeShape, nvinfer1::DataType::kINT32);
+        std::vector<tk::FinishedState> const skipDecodingStates(maxBatchSize, tk::FinishedState::skipDecoding());
+        mSkipDecodingStates = mBufferManager.gpu(maxBatchSizeShape, mFinishedSteps->getDataType());
+        mBufferManager.copy(skipDecodingStates.data(), *mSkipDecodingStates);
+    }
+    else
+    {
+        mJointDecoder.reset();
+    }
+    TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
+}
+
+void JointGptDecoderBatch::newRequest(
+    SizeType batchIdx, decoder_batch::Request const& request, SamplingConfig const& samplingConfig)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    TLLM_CHECK(0 <= batchIdx && batchIdx < static_cast<SizeType>(mJointSlots.size()));
+    auto& stream = mStreams[batchIdx];
+    if (mJointDecoder)
+    {
+        // previous steps of the joint decoder on mStream may still use the slot
+        CudaEvent event{};
+        mStream->record(event);
+        stream->wait(event.get());
+    }
+
+    GptDecoderBatch::newRequest(batchIdx, request, samplingConfig);
+
+    mJointSlots[batchIdx] = mJointDecoder && isBatchable(request, samplingConfig);
+    if (mJointSlots[batchIdx])
+    {
+        auto const batchSize = static_cast<SizeType>(mJointSlots.size());
+        mergeSamplingConfig(mJointSamplingConfig, samplingConfig, batchIdx, batchSize);
+        mJointSeedSlots.push_back(batchIdx);
+        // the joint decoder runs on mStream
+        CudaEvent event{};
+        stream->record(event);
+        mStream->wait(event);
+    }
+    TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
+}
+
+JointGptDecoderBatch::TokenPtr JointGptDecoderBatch::forwardAsync(
+    decoder_batch::Output& output, decoder_batch::Input const& input)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    if (!mJointDecoder)
+    {
+        return GptDecoderBatch::forwardAsync(output, input);
+    }
+
+    // the requests with their own decoders run first
+    auto perRequestInput = input;
+    for (SizeType bi = 0; bi < mActualBatchSize; ++bi)
+    {
+        perRequestInput.active.at(bi) = perRequestInput.active.at(bi) && !mJointSlots[bi];
+    }
+    GptDecoderBatch::forwardAsync(output, perRequestInput);
+
+    // runs after the requests with their own decoders, it rewrites their finished states and new tokens unchanged
+    auto const maxBeamWidth = mJointDecodingOutput->ids->getShape().d[1];
+    TensorPtr sequenceLengths
+        = ITensor::view(output.sequenceLengths, ITensor::makeShape({mActualBatchSize, maxBeamWidth}));
+    forwardJointAsync(input, sequenceLengths);
+
+    CudaEvent eventStop{};
+    mStream->record(eventStop);
+    TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
+    return std::make_unique<decoder_batch::Token>(std::move(eventStop), input.active);
+}
+
+void JointGptDecoderBatch::forwardJointAsync(decoder_batch::Input const& input, TensorPtr const& sequenceLengths)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    std::vector<SizeType> decodedSlots;
+    std::vector<SizeType> skippedSlots;
+    SizeType step{0};
+    bool computeCumLogProbs{false};
+    for (SizeType bi = 0; bi < mActualBatchSize; ++bi)
+    {
+        if (mJointSlots[bi] && !mFinished[bi] && input.active.at(bi))
+        {
+            decodedSlots.push_back(bi);
+            step = std::max(step, mDecodingInputs[bi]->step);
+            computeCumLogProbs |= static_cast<bool>(mDecodingOutputs[bi]->cumLogProbs);
+        }
+        else
+        {
+            skippedSlots.push_back(bi);
+        }
+    }
+    if (decodedSlots.empty())
+    {
+        TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
+        return;
+    }
+    NVTX3_SCOPED_RANGE_IN(batched_decoding, Decode, decodedSlots.size());
+
+    // one setup for all requests added since the last step, the random states of the running requests are kept
+    if (!mJointSeedSlots.empty())
+    {
+        auto const maxBatchSize = static_cast<SizeType>(mJointSlots.size());
+        IGptDecoder::setupSeedSlots(
+            *mJointDecoder, mJointSamplingConfig, maxBatchSize, mMaxSequenceLength, mJointSeedSlots);
+        mJointSeedSlots.clear();
+    }
+
+    // the logits of consecutive slots are used in place, e.g. when they come from one tensor
+    auto const& firstLogits = input.logits.at(decodedSlots.front());
+    auto const logitsType = firstLogits->getDataType();
+    auto const rowSizeInBytes = firstLogits->getSizeInBytes();
+    auto const jointLogitsShape = ITensor::makeShape({mActualBatchSize, 1, static_cast<SizeType>(mVocabSizePadded)});
+    auto const* logitsBase
+        = static_cast<std::uint8_t const*>(firstLogits->data()) - decodedSlots.front() * rowSizeInBytes;
+    bool contiguous = static_cast<SizeType>(input.logits.size()) >= mActualBatchSize;
+    for (SizeType bi = 0; bi < mActualBatchSize && contiguous; ++bi)
+    {
+        contiguous = input.logits[bi] && input.logits[bi]->data() == logitsBase + bi * rowSizeInBytes;
+    }
+    for (auto const bi : decodedSlots)
+    {
+        auto const& logitsShape = input.logits.at(bi)->getShape();
+        TLLM_CHECK_WITH_INFO(logitsShape.d[0] == 1 && logitsShape.d[1] == 1,
+            tc::fmtstr("Logits of batched request %d must have shape [1, 1, vocabSizePadded]", bi));
+        TLLM_CHECK(static_cast<std::size_t>(logitsShape.d[2]) == mVocabSizePadded);
+    }
+    TensorPtr logits;
+    if (contiguous)
+    {
+        logits = ITensor::wrap(const_cast<std::uint8_t*>(logitsBase), logitsType, jointLogitsShape);
+    }
+    else
+    {
+        if (!mJointLogits || mJointLogits->getDataType() != logitsType)
+        {
+            auto const maxBatchSize = static_cast<SizeType>(mJointSlots.size());
+            mJointLogits = mBufferManager.gpu(
+                ITensor::makeShape({maxBatchSize, 1, static_cast<SizeType>(mVocabSizePadded)}), logitsType);
+        }
+        for (auto const bi : decodedSlots)
+        {
+            TensorSpan jointLogits(*mJointLogits, bi, 1);
+            mBufferManager.copy(*input.logits[bi], jointLogits);
+        }
+        logits = ITensor::slice(mJointLogits, 0, mActualBatchSize);
+    }
+
+    TensorPtr finished = ITensor::view(ITensor::slice(mFinishedSteps, 0, mActualBatchSize),
+        ITensor::makeShape({mActualBatchSize, 1}));
+    TensorPtr finishedInput = finished;
+    if (!skippedSlots.empty())
+    {
+        finishedInput = ITensor::slice(mJointFinished, 0, mActualBatchSize);
+        mBufferManager.copy(*finished, *finishedInput);
+        auto const numSkipped = static_cast<SizeType>(skippedSlots.size());
+        auto skippedSlotsView = ITensor::slice(mJointSkipSlots, 0, numSkipped);
+        mBufferManager.copy(skippedSlots.data(), *skippedSlotsView);
+        TensorSpan skipDecodingStates(*mSkipDecodingStates, 0, numSkipped);
+        kernels::invokeFillBatch<tk::FinishedState::UnderlyingType>(
+            *finishedInput, *skippedSlotsView, 1, skipDecodingStates, *mStream);
+    }
+
+    // input
+    auto& dJointInput = *mJointDecodingInput;
+    TensorPtr endIds = ITensor::slice(constPointerCast(dJointInput.endIds), 0, mActualBatchSize);
+    DecodingInput dInput{step, mMaxAttentionWindow, mActualBatchSize, logits, endIds};
+    dInput.finished = finishedInput;
+    dInput.sequenceLimitLength = ITensor::slice(constPointerCast(dJointInput.sequenceLimitLength), 0, mActualBatchSize);
+    dInput.lengths = ITensor::slice(constPointerCast(dJointInput.lengths), 0, mActualBatchSize);
+    if (input.logitsBitmask)
+    {
+        dInput.logitsBitmask = ITensor::slice(input.logitsBitmask, 0, mActualBatchSize);
+    }
+
+    // output
+    auto& dJointOutput = *mJointDecodingOutput;
+    DecodingOutput dOutput{ITensor::slice(dJointOutput.ids, 0, mActualBatchSize)};
+    TensorPtr newTokensView = std::move(ITensor::slice(dJointOutput.newTokensSteps, 0, 1));
+    newTokensView->squeeze(0);
+    dOutput.newTokens = ITensor::slice(newTokensView, 0, mActualBatchSize);
+    dOutput.finished = finished;
+    dOutput.lengths = sequenceLengths;
+    if (computeCumLogProbs)
+    {
+        dOutput.cumLogProbs = ITensor::slice(dJointOutput.cumLogProbs, 0, mActualBatchSize);
+    }
+
+    mJointDecoder->forwardAsync(dOutput, dInput);
+    // the per request finishedSum is not written by the joint decoder
+    TensorSpan finishedSum(*dJointOutput.finishedSum, 0, mActualBatchSize);
+    kernels::countFinished(finishedSum, *finished, *mStream);
+
+    for (auto const bi : decodedSlots)
+    {
+        mNbSteps[bi] += 1;
+        mFinished[bi] = mNbSteps[bi] >= mMaxNewTokens[bi];
+        mDecodingInputs[bi]->step += 1;
+    }
+    TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
+}
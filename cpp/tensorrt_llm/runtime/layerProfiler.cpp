@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/layerProfiler.h"
+
+#include "tensorrt_llm/common/assert.h"
+
+#include <array>
+
+using namespace tensorrt_llm::runtime;
+
+namespace tensorrt_llm::runtime
+{
+
+char const* getLayerKindName(LayerKind kind)
+{
+    switch (kind)
+    {
+    case LayerKind::kATTENTION: return "Attention";
+    case LayerKind::kGEMM: return "GEMM";
+    case LayerKind::kCOLLECTIVE: return "Collective";
+    case LayerKind::kOTHER: return "Other";
+    }
+    return "Unknown";
+}
+
+} // namespace tensorrt_llm::runtime
+
+LayerProfiler::LayerProfiler(SizeType interval)
+    : mInterval{interval}
+{
+    TLLM_CHECK_WITH_INFO(interval > 0, "The layer profiling interval must be positive");
+}
+
+bool LayerProfiler::sample()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto const profiled = mNumEnqueues++ % mInterval == 0;
+    if (profiled)
+    {
+        ++mStats.numProfiledEnqueues;
+    }
+    return profiled;
+}
+
+void LayerProfiler::reportLayerTime(char const* layerName, float ms) noexcept
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mLayerKinds.find(layerName);
+    if (it == mLayerKinds.end())
+    {
+        it = mLayerKinds.emplace(layerName, getLayerKind(layerName)).first;
+    }
+    auto& kindStats = mStats[it->second];
+    ++kindStats.count;
+    kindStats.timeMs += ms;
+}
+
+LayerProfileStats LayerProfiler::collect()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto stats = mStats;
+    mStats = LayerProfileStats{};
+    return stats;
+}
+
+LayerKind LayerProfiler::getLayerKind(std::string_view layerName)
+{
+    // A layer fused by TensorRT is named after the layers it fuses, joined by " + ", and classified by the first one
+    auto const first = layerName.substr(0, layerName.find(" + "));
+    auto const separator = first.rfind('/');
+    auto const name = separator == std::string_view::npos ? first : first.substr(separator + 1);
+    auto const contains = [name](std::string_view part) { return name.find(part) != std::string_view::npos; };
+
+    static std::array<std::string_view, 5> constexpr kCollectives{
+        "AllReduce", "AllGather", "ReduceScatter", "PLUGIN_V2_Send", "PLUGIN_V2_Recv"};
+    static std::array<std::string_view, 2> constexpr kAttentions{"GPTAttention", "BertAttention"};
+    static std::array<std::string_view, 5> constexpr kGemms{
+        "Gemm", "QuantMatmul", "Lora", "MATRIX_MULTIPLY", "FULLY_CONNECTED"};
+    for (auto const part : kCollectives)
+    {
+        if (contains(part))
+        {
+            return LayerKind::kCOLLECTIVE;
+        }
+    }
+    for (auto const part : kAttentions)
+    {
+        if (contains(part))
+        {
+            return LayerKind::kATTENTION;
+        }
+    }
+    for (auto const part : kGemms)
+    {
+        if (contains(part))
+        {
+            return LayerKind::kGEMM;
+        }
+    }
+    return LayerKind::kOTHER;
+}
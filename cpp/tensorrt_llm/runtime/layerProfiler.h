@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/layerProfileStats.h"
+
+#include <NvInferRuntime.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief Times the layers of one in every `interval` enqueues with the TensorRT profiler and aggregates them by kind.
+//!
+//! TensorRT synchronizes the stream at the end of a profiled enqueue to report the layer times, the other enqueues run
+//! without profiling. The layer names come from the engine, built with the default profiling verbosity.
+class LayerProfiler : public nvinfer1::IProfiler
+{
+public:
+    explicit LayerProfiler(SizeType interval);
+
+    [[nodiscard]] SizeType getInterval() const
+    {
+        return mInterval;
+    }
+
+    //! \brief Counts an enqueue, returns whether it is profiled.
+    bool sample();
+
+    void reportLayerTime(char const* layerName, float ms) noexcept override;
+
+    //! \brief Returns the stats since the last call and clears them.
+    LayerProfileStats collect();
+
+    //! \brief Classifies a layer by the last component of its name, e.g. `PLUGIN_V2_GPTAttention_0` in
+    //! `transformer/layers/0/attention/PLUGIN_V2_GPTAttention_0`, not by the module it belongs to.
+    [[nodiscard]] static LayerKind getLayerKind(std::string_view layerName);
+
+private:
+    SizeType mInterval;
+    std::uint64_t mNumEnqueues{0};
+    std::mutex mMutex;
+    LayerProfileStats mStats;
+    // The names of the layers are the same for every profiled enqueue
+    std::unordered_map<std::string, LayerKind> mLayerKinds;
+};
+
+} // namespace tensorrt_llm::runtime
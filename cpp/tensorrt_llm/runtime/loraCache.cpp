@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/loraCache.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/runtime/memoryCounters.h"
+
+#include <iterator>
+
+namespace tensorrt_llm::runtime
+{
+
+LoraCache::LoraCache(
+    SizeType numPages, std::size_t pageSize, nvinfer1::DataType type, BufferManager::CudaStreamPtr copyStream)
+    : mNumPages{numPages}
+    , mPageSize{pageSize}
+    , mType{type}
+    , mCopyStream{std::move(copyStream)}
+    , mManager{mCopyStream}
+{
+    TLLM_CHECK_WITH_INFO(numPages > 0 && pageSize > 0, "The LoRA cache needs at least one non-empty page");
+    {
+        MemoryCounters::TagScope const tagScope{MemoryTag::kLORA_CACHE};
+        mPool = mManager.gpu(static_cast<std::size_t>(numPages) * pageSize, type);
+    }
+    mFreePages.reserve(numPages);
+    for (auto page = numPages - 1; page >= 0; --page)
+    {
+        mFreePages.push_back(page);
+    }
+}
+
+void LoraCache::put(TaskIdType taskId, std::vector<TensorPtr> hostWeights)
+{
+    TLLM_CHECK_WITH_INFO(!contains(taskId), "LoRA adapter %lu is already registered", taskId);
+    TLLM_CHECK_WITH_INFO(static_cast<SizeType>(hostWeights.size()) <= mNumPages,
+        "LoRA adapter %lu has %zu weights, more than the %d pages of the cache", taskId, hostWeights.size(), mNumPages);
+    for (auto const& weight : hostWeights)
+    {
+        TLLM_CHECK_WITH_INFO(weight->getMemoryType() == MemoryType::kPINNED,
+            "The weights of the LoRA adapters must be in pinned memory to be copied asynchronously");
+        TLLM_CHECK(weight->getDataType() == mType);
+        TLLM_CHECK_WITH_INFO(weight->getSize() <= mPageSize, "LoRA weights of %zu elements exceed the page size %zu",
+            weight->getSize(), mPageSize);
+    }
+    mAdapters[taskId].hostWeights = std::move(hostWeights);
+}
+
+bool LoraCache::tryLoad(TaskIdType taskId)
+{
+    auto& adapter = mAdapters.at(taskId);
+    if (hasPages(adapter))
+    {
+        if (adapter.loadEvent)
+        {
+            auto const status = ::cudaEventQuery(adapter.loadEvent->get());
+            if (status == cudaErrorNotReady)
+            {
+                return false;
+            }
+            TLLM_CUDA_CHECK(status);
+            adapter.loadEvent.reset();
+        }
+        touch(adapter);
+        return true;
+    }
+
+    auto const numNeeded = static_cast<SizeType>(adapter.hostWeights.size());
+    if (getNumFreePages() < numNeeded)
+    {
+        // Do not evict anything unless enough pages can be freed
+        SizeType numEvictable = 0;
+        for (auto const id : mLru)
+        {
+            auto const& other = mAdapters.at(id);
+            numEvictable += isEvictable(other) ? static_cast<SizeType>(other.pages.size()) : 0;
+        }
+        if (getNumFreePages() + numEvictable < numNeeded)
+        {
+            return false;
+        }
+        for (auto it = mLru.end(); getNumFreePages() < numNeeded && it != mLru.begin();)
+        {
+            auto const current = --it;
+            auto& other = mAdapters.at(*current);
+            if (isEvictable(other))
+            {
+                it = std::next(current);
+                evict(*current, other);
+            }
+        }
+    }
+
+    // The freed pages may still be read by the steps that used the evicted adapters
+    for (auto const& lastUse : mPendingUses)
+    {
+        mCopyStream->wait(*lastUse);
+    }
+    mPendingUses.clear();
+
+    auto* pool = static_cast<std::uint8_t*>(mPool->data());
+    auto const pageSizeInBytes = mPageSize * BufferDataType(mType).getSize();
+    for (auto const& weight : adapter.hostWeights)
+    {
+        auto const page = mFreePages.back();
+        mFreePages.pop_back();
+        adapter.pages.push_back(page);
+        mManager.copy(*weight, pool + static_cast<std::size_t>(page) * pageSizeInBytes, MemoryType::kGPU);
+    }
+    adapter.loadEvent = std::make_unique<CudaEvent>();
+    mCopyStream->record(*adapter.loadEvent);
+    mLru.push_front(taskId);
+    adapter.lruIt = mLru.begin();
+    ++mNumLoads;
+    return false;
+}
+
+void LoraCache::acquire(TaskIdType taskId)
+{
+    auto& adapter = mAdapters.at(taskId);
+    TLLM_CHECK_WITH_INFO(hasPages(adapter) && !adapter.loadEvent, "LoRA adapter %lu is not resident", taskId);
+    ++adapter.refCount;
+    touch(adapter);
+}
+
+void LoraCache::release(TaskIdType taskId, CudaStream const& stream)
+{
+    auto& adapter = mAdapters.at(taskId);
+    TLLM_CHECK_WITH_INFO(adapter.refCount > 0, "LoRA adapter %lu is not held", taskId);
+    --adapter.refCount;
+    adapter.lastUse = std::make_shared<CudaEvent>();
+    stream.record(*adapter.lastUse);
+}
+
+std::vector<void const*> LoraCache::getWeightPointers(TaskIdType taskId) const
+{
+    auto const& adapter = mAdapters.at(taskId);
+    TLLM_CHECK_WITH_INFO(hasPages(adapter) && !adapter.loadEvent, "LoRA adapter %lu is not resident", taskId);
+    auto const* pool = static_cast<std::uint8_t const*>(mPool->data());
+    auto const pageSizeInBytes = mPageSize * BufferDataType(mType).getSize();
+    std::vector<void const*> pointers;
+    pointers.reserve(adapter.pages.size());
+    for (auto const page : adapter.pages)
+    {
+        pointers.push_back(pool + static_cast<std::size_t>(page) * pageSizeInBytes);
+    }
+    return pointers;
+}
+
+void LoraCache::erase(TaskIdType taskId)
+{
+    auto it = mAdapters.find(taskId);
+    TLLM_CHECK_WITH_INFO(it != mAdapters.end(), "LoRA adapter %lu is not registered", taskId);
+    TLLM_CHECK_WITH_INFO(it->second.refCount == 0, "LoRA adapter %lu is held by a request", taskId);
+    if (hasPages(it->second))
+    {
+        evict(taskId, it->second);
+    }
+    mAdapters.erase(it);
+}
+
+bool LoraCache::isEvictable(Adapter const& adapter) const
+{
+    // A loading adapter is kept until tryLoad sees its copies complete
+    return hasPages(adapter) && adapter.refCount == 0 && !adapter.loadEvent;
+}
+
+void LoraCache::evict(TaskIdType taskId, Adapter& adapter)
+{
+    TLLM_LOG_DEBUG("Evicting LoRA adapter %lu", taskId);
+    mFreePages.insert(mFreePages.end(), adapter.pages.begin(), adapter.pages.end());
+    adapter.pages.clear();
+    adapter.loadEvent.reset();
+    if (adapter.lastUse)
+    {
+        mPendingUses.push_back(std::move(adapter.lastUse));
+    }
+    mLru.erase(adapter.lruIt);
+    ++mNumEvictions;
+}
+
+void LoraCache::touch(Adapter& adapter)
+{
+    mLru.splice(mLru.begin(), mLru, adapter.lruIt);
+}
+
+} // namespace tensorrt_llm::runtime
@@ -17,8 +17,10 @@
 #include "tensorrt_llm/runtime/memoryCounters.h"
 
 #include "tensorrt_llm/common/stringUtils.h"
+#include "tensorrt_llm/runtime/pinnedPool.h"
 
 #include <array>
+#include <atomic>
 #include <cmath>
 
 namespace tc = tensorrt_llm::common;
@@ -28,6 +30,8 @@ namespace
 
 auto constexpr kByteUnits = std::array{"B", "KB", "MB", "GB", "TB", "PB", "EB"};
 
+std::size_t constexpr kNbMemoryTypes = 3;
+
 std::string doubleBytesToString(double bytes, int precision)
 {
     std::uint32_t unitIdx{0};
@@ -41,11 +45,113 @@ std::string doubleBytesToString(double bytes, int precision)
     return tc::fmtstr(format.c_str(), bytes, kByteUnits[unitIdx]);
 }
 
+void updateMax(std::atomic<std::size_t>& peak, std::size_t value)
+{
+    auto current = peak.load(std::memory_order_relaxed);
+    while (current < value && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+// Peaks of the tagged counters, and totals of each memory type over the tags with their peaks
+struct PeakCounters
+{
+    using TaggedCounters = std::array<std::atomic<std::size_t>, tensorrt_llm::runtime::kNbMemoryTags>;
+
+    std::array<TaggedCounters, kNbMemoryTypes> taggedPeaks{};
+    std::array<std::atomic<std::size_t>, kNbMemoryTypes> totals{};
+    std::array<std::atomic<std::size_t>, kNbMemoryTypes> totalPeaks{};
+};
+
+PeakCounters& getPeakCounters()
+{
+    static PeakCounters counters;
+    return counters;
+}
+
 } // namespace
 
 namespace tensorrt_llm::runtime
 {
 thread_local MemoryCounters MemoryCounters::mInstance;
+thread_local MemoryTag MemoryCounters::mCurrentTag{MemoryTag::kUNTAGGED};
+
+char const* getMemoryTagName(MemoryTag tag)
+{
+    switch (tag)
+    {
+    case MemoryTag::kUNTAGGED: return "Untagged";
+    case MemoryTag::kENGINE_WEIGHTS: return "Engine weights";
+    case MemoryTag::kENGINE_WORKSPACE: return "Engine workspace";
+    case MemoryTag::kKV_CACHE: return "KV cache";
+    case MemoryTag::kRUNTIME_BUFFERS: return "Runtime buffers";
+    case MemoryTag::kDECODER: return "Decoder";
+    case MemoryTag::kSCRATCH: return "Scratch";
+    case MemoryTag::kLORA_CACHE: return "LoRA cache";
+    case MemoryTag::kPROMPT_TABLE_CACHE: return "Prompt table cache";
+    }
+    return "Unknown";
+}
+
+std::atomic<MemoryCounters::SizeType>& MemoryCounters::getTaggedCounter(MemoryType memoryType, MemoryTag tag)
+{
+    // Shared by the threads, a buffer may be freed by another thread than the one that allocated it
+    static std::array<std::array<std::atomic<SizeType>, kNbMemoryTags>, kNbMemoryTypes> counters{};
+    auto const typeIdx = static_cast<std::size_t>(memoryType);
+    auto const tagIdx = static_cast<std::size_t>(tag);
+    TLLM_CHECK(typeIdx < kNbMemoryTypes && tagIdx < kNbMemoryTags);
+    return counters[typeIdx][tagIdx];
+}
+
+void MemoryCounters::updateTagged(MemoryType memoryType, MemoryTag tag, DiffType sizeDiff)
+{
+    auto& counter = getTaggedCounter(memoryType, tag);
+    auto& peaks = getPeakCounters();
+    auto const typeIdx = static_cast<std::size_t>(memoryType);
+    auto const tagIdx = static_cast<std::size_t>(tag);
+    if (sizeDiff >= 0)
+    {
+        auto const size = static_cast<SizeType>(sizeDiff);
+        updateMax(peaks.taggedPeaks[typeIdx][tagIdx], counter.fetch_add(size, std::memory_order_relaxed) + size);
+        updateMax(peaks.totalPeaks[typeIdx], peaks.totals[typeIdx].fetch_add(size, std::memory_order_relaxed) + size);
+    }
+    else
+    {
+        auto const size = static_cast<SizeType>(-sizeDiff);
+        counter.fetch_sub(size, std::memory_order_relaxed);
+        peaks.totals[typeIdx].fetch_sub(size, std::memory_order_relaxed);
+    }
+}
+
+MemoryCounters::SizeType MemoryCounters::getTaggedPeak(MemoryType memoryType, MemoryTag tag)
+{
+    auto const typeIdx = static_cast<std::size_t>(memoryType);
+    auto const tagIdx = static_cast<std::size_t>(tag);
+    TLLM_CHECK(typeIdx < kNbMemoryTypes && tagIdx < kNbMemoryTags);
+    return getPeakCounters().taggedPeaks[typeIdx][tagIdx].load(std::memory_order_relaxed);
+}
+
+MemoryCounters::SizeType MemoryCounters::getPeak(MemoryType memoryType)
+{
+    auto const typeIdx = static_cast<std::size_t>(memoryType);
+    TLLM_CHECK(typeIdx < kNbMemoryTypes);
+    return getPeakCounters().totalPeaks[typeIdx].load(std::memory_order_relaxed);
+}
+
+void MemoryCounters::resetPeaks()
+{
+    auto& peaks = getPeakCounters();
+    for (std::size_t typeIdx = 0; typeIdx < kNbMemoryTypes; ++typeIdx)
+    {
+        for (std::size_t tagIdx = 0; tagIdx < kNbMemoryTags; ++tagIdx)
+        {
+            peaks.taggedPeaks[typeIdx][tagIdx].store(
+                getTagged(static_cast<MemoryType>(typeIdx), static_cast<MemoryTag>(tagIdx)), std::memory_order_relaxed);
+        }
+        peaks.totalPeaks[typeIdx].store(
+            peaks.totals[typeIdx].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
 
 std::string MemoryCounters::bytesToString(SizeType bytes, int precision)
 {
@@ -57,30 +163,70 @@ std::string MemoryCounters::bytesToString(DiffType bytes, int precision)
     return doubleBytesToString(static_cast<double>(bytes), precision);
 }
 
+MemoryCounters::SizeType MemoryCounters::getPinnedPoolReserved()
+{
+    return PinnedPool::getInstance().getReserved();
+}
+
+MemoryCounters::SizeType MemoryCounters::getPinnedPoolUsed()
+{
+    return PinnedPool::getInstance().getUsed();
+}
+
+std::uint64_t MemoryCounters::getPinnedPoolHits()
+{
+    return PinnedPool::getInstance().getNumHits();
+}
+
+std::uint64_t MemoryCounters::getPinnedPoolMisses()
+{
+    return PinnedPool::getInstance().getNumMisses();
+}
+
 std::string MemoryCounters::toString() const
 {
-    return tensorrt_llm::common::fmtstr("[MemUsage] GPU %s, CPU %s, Pinned %s", bytesToString(this->getGpu()).c_str(),
-        bytesToString(this->getCpu()).c_str(), bytesToString(this->getPinned()).c_str());
+    return tensorrt_llm::common::fmtstr("[MemUsage] GPU %s, CPU %s, Pinned %s, Pinned pool %s (used %s)",
+        bytesToString(this->getGpu()).c_str(), bytesToString(this->getCpu()).c_str(),
+        bytesToString(this->getPinned()).c_str(), bytesToString(getPinnedPoolReserved()).c_str(),
+        bytesToString(getPinnedPoolUsed()).c_str());
+}
+
+std::string MemoryCounters::toTaggedString(MemoryType memoryType)
+{
+    std::string result;
+    for (std::size_t tagIdx = 0; tagIdx < kNbMemoryTags; ++tagIdx)
+    {
+        auto const tag = static_cast<MemoryTag>(tagIdx);
+        auto const size = getTagged(memoryType, tag);
+        if (size > 0)
+        {
+            result += tc::fmtstr("%s%s %s", result.empty() ? "" : ", ", getMemoryTagName(tag),
+                bytesToString(size).c_str());
+        }
+    }
+    auto const* const typeName
+        = memoryType == MemoryType::kGPU ? "GPU" : (memoryType == MemoryType::kCPU ? "CPU" : "Pinned");
+    return tc::fmtstr("[MemUsage] %s by owner: %s", typeName, result.empty() ? "none" : result.c_str());
 }
 
-void MemoryCounters::allocate(MemoryType memoryType, MemoryCounters::SizeType size)
+void MemoryCounters::allocate(MemoryType memoryType, MemoryCounters::SizeType size, MemoryTag tag)
 {
     switch (memoryType)
     {
-    case MemoryType::kGPU: allocate<MemoryType::kGPU>(size); break;
-    case MemoryType::kCPU: allocate<MemoryType::kCPU>(size); break;
-    case MemoryType::kPINNED: allocate<MemoryType::kPINNED>(size); break;
+    case MemoryType::kGPU: allocate<MemoryType::kGPU>(size, tag); break;
+    case MemoryType::kCPU: allocate<MemoryType::kCPU>(size, tag); break;
+    case MemoryType::kPINNED: allocate<MemoryType::kPINNED>(size, tag); break;
     default: TLLM_THROW("Unknown memory type");
     }
 }
 
-void MemoryCounters::deallocate(MemoryType memoryType, MemoryCounters::SizeType size)
+void MemoryCounters::deallocate(MemoryType memoryType, MemoryCounters::SizeType size, MemoryTag tag)
 {
     switch (memoryType)
     {
-    case MemoryType::kGPU: deallocate<MemoryType::kGPU>(size); break;
-    case MemoryType::kCPU: deallocate<MemoryType::kCPU>(size); break;
-    case MemoryType::kPINNED: deallocate<MemoryType::kPINNED>(size); break;
+    case MemoryType::kGPU: deallocate<MemoryType::kGPU>(size, tag); break;
+    case MemoryType::kCPU: deallocate<MemoryType::kCPU>(size, tag); break;
+    case MemoryType::kPINNED: deallocate<MemoryType::kPINNED>(size, tag); break;
     default: TLLM_THROW("Unknown memory type");
     }
 }
@@ -16,6 +16,8 @@
 
 #include "tensorrt_llm/runtime/ncclCommunicator.h"
 
+#include "tensorrt_llm/common/commProfiler.h"
+#include "tensorrt_llm/common/dataType.h"
 #include "tensorrt_llm/common/logger.h"
 #include "tensorrt_llm/runtime/utils/multiDeviceUtils.h"
 
@@ -24,6 +26,7 @@
 #endif // ENABLE_MULTI_DEVICE
 
 using namespace tensorrt_llm::runtime;
+namespace tc = tensorrt_llm::common;
 
 namespace
 {
@@ -53,6 +56,7 @@ void NcclCommunicator::send(
     void const* sendbuff, size_t count, nvinfer1::DataType dataType, int peer, CudaStream const& stream) const
 {
 #if ENABLE_MULTI_DEVICE
+    tc::CommProfiler::Scope const profile(tc::CommOp::kSEND, count * tc::getDTypeSize(dataType), stream.get());
     TLLM_NCCL_CHECK(ncclSend(sendbuff, count, toNcclType(dataType), peer, mComm, stream.get()));
 #else
     TLLM_THROW("Multi device support is disabled.");
@@ -63,6 +67,7 @@ void NcclCommunicator::receive(
     void* sendbuff, size_t count, nvinfer1::DataType dataType, int peer, CudaStream const& stream) const
 {
 #if ENABLE_MULTI_DEVICE
+    tc::CommProfiler::Scope const profile(tc::CommOp::kRECV, count * tc::getDTypeSize(dataType), stream.get());
     TLLM_NCCL_CHECK(ncclRecv(sendbuff, count, toNcclType(dataType), peer, mComm, stream.get()));
 #else
     TLLM_THROW("Multi device support is disabled.");
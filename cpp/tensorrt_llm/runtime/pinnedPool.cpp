@@ -0,0 +1,439 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/pinnedPool.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/envUtils.h"
+
+#include <algorithm>
+#include <cuda_runtime_api.h>
+#include <iterator>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+
+// Number of size classes per power of two
+std::size_t constexpr kClassesPerPowerOfTwo = 4;
+
+std::size_t constexpr kMinBlockBit = 8;
+static_assert(PinnedPool::kMinBlockSize == std::size_t{1} << kMinBlockBit);
+
+// Index of the highest bit set in value, which is not 0
+std::size_t constexpr highestBit(std::size_t value)
+{
+    std::size_t bit = 0;
+    while (value >>= 1)
+    {
+        ++bit;
+    }
+    return bit;
+}
+
+std::size_t constexpr classOf(std::size_t size)
+{
+    if (size <= PinnedPool::kMinBlockSize)
+    {
+        return 0;
+    }
+    // size is in (2^bit, 2^(bit + 1)], split in classes of 2^(bit - 2) bytes
+    auto const bit = highestBit(size - 1);
+    auto const step = std::size_t{1} << (bit - 2);
+    auto const steps = (size - 1) / step + 1;
+    return (bit - kMinBlockBit) * kClassesPerPowerOfTwo + (steps - kClassesPerPowerOfTwo);
+}
+
+static_assert(classOf(PinnedPool::kMaxBlockSize) + 1 == PinnedPool::kNbClasses);
+
+} // namespace
+
+//! Small blocks freed by a thread, given back to the pool when the thread ends.
+class PinnedPool::ThreadCache
+{
+public:
+    explicit ThreadCache(PinnedPool& pool)
+        : mPool{pool}
+    {
+    }
+
+    ~ThreadCache()
+    {
+        for (std::size_t sizeClass = 0; sizeClass < kNbCachedClasses; ++sizeClass)
+        {
+            mPool.releaseBlocks(sizeClass, mBlocks[sizeClass].data(), mNbBlocks[sizeClass]);
+        }
+    }
+
+    static bool isCached(std::size_t sizeClass)
+    {
+        return sizeClass < kNbCachedClasses;
+    }
+
+    void* pop(std::size_t sizeClass)
+    {
+        auto& nbBlocks = mNbBlocks[sizeClass];
+        return nbBlocks > 0 ? mBlocks[sizeClass][--nbBlocks] : nullptr;
+    }
+
+    // Gives all the blocks back to the pool
+    void flush()
+    {
+        for (std::size_t sizeClass = 0; sizeClass < kNbCachedClasses; ++sizeClass)
+        {
+            mPool.releaseBlocks(sizeClass, mBlocks[sizeClass].data(), mNbBlocks[sizeClass]);
+            mNbBlocks[sizeClass] = 0;
+        }
+    }
+
+    void push(std::size_t sizeClass, void* block)
+    {
+        auto& nbBlocks = mNbBlocks[sizeClass];
+        if (nbBlocks == kThreadCacheBlocks)
+        {
+            // Keep the most recently freed half, they are more likely to be in the CPU caches
+            auto constexpr nbReleased = kThreadCacheBlocks / 2;
+            mPool.releaseBlocks(sizeClass, mBlocks[sizeClass].data(), nbReleased);
+            std::copy(mBlocks[sizeClass].begin() + nbReleased, mBlocks[sizeClass].end(), mBlocks[sizeClass].begin());
+            nbBlocks -= nbReleased;
+        }
+        mBlocks[sizeClass][nbBlocks++] = block;
+    }
+
+private:
+    static std::size_t constexpr kNbCachedClasses = classOf(kMaxSmallBlockSize) + 1;
+
+    PinnedPool& mPool;
+    std::array<std::array<void*, kThreadCacheBlocks>, kNbCachedClasses> mBlocks{};
+    std::array<std::size_t, kNbCachedClasses> mNbBlocks{};
+};
+
+PinnedPool& PinnedPool::getInstance()
+{
+    // Never destroyed, the caches of the threads ending after the static destructors give their blocks back to it
+    static auto* instance = new PinnedPool();
+    return *instance;
+}
+
+PinnedPool::PinnedPool()
+    : mEnabled{!common::getEnvDisablePinnedPool()}
+{
+}
+
+PinnedPool::ThreadCache& PinnedPool::getThreadCache()
+{
+    thread_local ThreadCache cache{*this};
+    return cache;
+}
+
+std::size_t PinnedPool::getClass(std::size_t size)
+{
+    return size > kMaxBlockSize ? kNbClasses : classOf(size);
+}
+
+std::size_t PinnedPool::getClassSize(std::size_t sizeClass)
+{
+    if (sizeClass == 0)
+    {
+        return kMinBlockSize;
+    }
+    auto const bit = (sizeClass - 1) / kClassesPerPowerOfTwo + kMinBlockBit;
+    auto const steps = (sizeClass - 1) % kClassesPerPowerOfTwo + kClassesPerPowerOfTwo + 1;
+    return steps << (bit - 2);
+}
+
+void* PinnedPool::allocate(std::size_t size)
+{
+    auto const sizeClass = mEnabled ? getClass(size) : kNbClasses;
+    if (sizeClass == kNbClasses)
+    {
+        void* ptr{};
+        TLLM_CUDA_CHECK(::cudaHostAlloc(&ptr, size, cudaHostAllocDefault));
+        mReserved.fetch_add(size, std::memory_order_relaxed);
+        mUsed.fetch_add(size, std::memory_order_relaxed);
+        mNumMisses.fetch_add(1, std::memory_order_relaxed);
+        if (mEnabled)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            addLiveBlock(ptr, size);
+        }
+        return ptr;
+    }
+
+    void* block = nullptr;
+    if (ThreadCache::isCached(sizeClass))
+    {
+        block = getThreadCache().pop(sizeClass);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (block == nullptr)
+        {
+            reclaimPendingBlocks();
+            auto& freeBlocks = mFreeBlocks[sizeClass];
+            if (!freeBlocks.empty())
+            {
+                block = freeBlocks.back();
+                freeBlocks.pop_back();
+            }
+        }
+        if (block != nullptr)
+        {
+            addLiveBlock(block, size);
+        }
+    }
+    if (block == nullptr)
+    {
+        block = allocateBlock(sizeClass);
+        std::lock_guard<std::mutex> lock(mMutex);
+        addLiveBlock(block, size);
+    }
+    else
+    {
+        mNumHits.fetch_add(1, std::memory_order_relaxed);
+    }
+    mUsed.fetch_add(getClassSize(sizeClass), std::memory_order_relaxed);
+    return block;
+}
+
+void PinnedPool::deallocate(void* ptr, std::size_t size)
+{
+    auto const sizeClass = mEnabled ? getClass(size) : kNbClasses;
+    if (sizeClass == kNbClasses)
+    {
+        if (mEnabled)
+        {
+            // cudaFreeHost waits for the copies of the block
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto const events = removeLiveBlock(ptr, size);
+            mFreeEvents.insert(mFreeEvents.end(), events.begin(), events.end());
+        }
+        TLLM_CUDA_CHECK(::cudaFreeHost(ptr));
+        mReserved.fetch_sub(size, std::memory_order_relaxed);
+        mUsed.fetch_sub(size, std::memory_order_relaxed);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto events = removeLiveBlock(ptr, size);
+        if (!events.empty())
+        {
+            mUsed.fetch_sub(getClassSize(sizeClass), std::memory_order_relaxed);
+            mPendingBlocks.push_back(PendingBlock{ptr, sizeClass, std::move(events)});
+            return;
+        }
+    }
+    mUsed.fetch_sub(getClassSize(sizeClass), std::memory_order_relaxed);
+    if (ThreadCache::isCached(sizeClass))
+    {
+        getThreadCache().push(sizeClass, ptr);
+    }
+    else
+    {
+        releaseBlocks(sizeClass, &ptr, 1);
+    }
+}
+
+void PinnedPool::recordStream(void const* ptr, cudaStream_t stream)
+{
+    if (!mEnabled)
+    {
+        return;
+    }
+    auto const address = reinterpret_cast<std::uintptr_t>(ptr);
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mLiveBlocks.upper_bound(address);
+    if (it == mLiveBlocks.begin())
+    {
+        return;
+    }
+    --it;
+    auto& liveBlock = it->second;
+    if (address >= it->first + liveBlock.size)
+    {
+        return;
+    }
+    // One event per stream, recorded again after each use of the block
+    auto use = std::find_if(liveBlock.uses.begin(), liveBlock.uses.end(),
+        [stream](auto const& streamUse) { return streamUse.first == stream; });
+    if (use == liveBlock.uses.end())
+    {
+        use = liveBlock.uses.emplace(liveBlock.uses.end(), stream, getEvent());
+    }
+    TLLM_CUDA_CHECK(::cudaEventRecord(use->second, stream));
+}
+
+void PinnedPool::trim()
+{
+    if (!mEnabled)
+    {
+        return;
+    }
+    getThreadCache().flush();
+    std::lock_guard<std::mutex> lock(mMutex);
+    reclaimPendingBlocks();
+    for (std::size_t sizeClass = 0; sizeClass < kNbClasses; ++sizeClass)
+    {
+        auto const classSize = getClassSize(sizeClass);
+        if (classSize <= kMaxSmallBlockSize)
+        {
+            trimSlabs(sizeClass);
+            continue;
+        }
+        auto& freeBlocks = mFreeBlocks[sizeClass];
+        for (auto* block : freeBlocks)
+        {
+            TLLM_CUDA_CHECK(::cudaFreeHost(block));
+        }
+        mReserved.fetch_sub(freeBlocks.size() * classSize, std::memory_order_relaxed);
+        freeBlocks.clear();
+        freeBlocks.shrink_to_fit();
+    }
+}
+
+void PinnedPool::trimSlabs(std::size_t sizeClass)
+{
+    auto& freeBlocks = mFreeBlocks[sizeClass];
+    auto const slabOf = [this](void const* block)
+    { return std::prev(mSlabs.upper_bound(reinterpret_cast<std::uintptr_t>(block))); };
+
+    // A slab is freed when all its blocks are in the free list, none is allocated, pending or cached by a thread
+    std::map<std::uintptr_t, std::size_t> nbFreeBlocks;
+    for (auto* block : freeBlocks)
+    {
+        ++nbFreeBlocks[slabOf(block)->first];
+    }
+    std::vector<std::uintptr_t> freeSlabs;
+    for (auto const& [slab, nbFree] : nbFreeBlocks)
+    {
+        if (nbFree == mSlabs.at(slab).nbBlocks)
+        {
+            freeSlabs.push_back(slab);
+        }
+    }
+    if (freeSlabs.empty())
+    {
+        return;
+    }
+    freeBlocks.erase(std::remove_if(freeBlocks.begin(), freeBlocks.end(),
+                         [&](void* block)
+                         { return std::binary_search(freeSlabs.begin(), freeSlabs.end(), slabOf(block)->first); }),
+        freeBlocks.end());
+    for (auto const slab : freeSlabs)
+    {
+        TLLM_CUDA_CHECK(::cudaFreeHost(reinterpret_cast<void*>(slab)));
+        mReserved.fetch_sub(mSlabs.at(slab).size, std::memory_order_relaxed);
+        mSlabs.erase(slab);
+    }
+}
+
+void* PinnedPool::allocateBlock(std::size_t sizeClass)
+{
+    mNumMisses.fetch_add(1, std::memory_order_relaxed);
+    auto const classSize = getClassSize(sizeClass);
+    if (classSize > kMaxSmallBlockSize)
+    {
+        void* block{};
+        TLLM_CUDA_CHECK(::cudaHostAlloc(&block, classSize, cudaHostAllocDefault));
+        mReserved.fetch_add(classSize, std::memory_order_relaxed);
+        return block;
+    }
+
+    // Carve the slab in blocks, return the first one and keep the others
+    auto const slabSize = std::clamp(classSize * kBlocksPerSlab, kMinSlabSize, kMaxSlabSize);
+    void* slab{};
+    TLLM_CUDA_CHECK(::cudaHostAlloc(&slab, slabSize, cudaHostAllocDefault));
+    mReserved.fetch_add(slabSize, std::memory_order_relaxed);
+    auto const nbBlocks = slabSize / classSize;
+    std::lock_guard<std::mutex> lock(mMutex);
+    mSlabs.emplace(reinterpret_cast<std::uintptr_t>(slab), Slab{slabSize, nbBlocks});
+    auto& freeBlocks = mFreeBlocks[sizeClass];
+    for (auto idx = nbBlocks - 1; idx > 0; --idx)
+    {
+        freeBlocks.push_back(static_cast<char*>(slab) + idx * classSize);
+    }
+    return slab;
+}
+
+void PinnedPool::releaseBlocks(std::size_t sizeClass, void* const* blocks, std::size_t nbBlocks)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mFreeBlocks[sizeClass].insert(mFreeBlocks[sizeClass].end(), blocks, blocks + nbBlocks);
+}
+
+void PinnedPool::addLiveBlock(void* ptr, std::size_t size)
+{
+    mLiveBlocks.emplace(reinterpret_cast<std::uintptr_t>(ptr), LiveBlock{size, {}});
+}
+
+std::vector<cudaEvent_t> PinnedPool::removeLiveBlock(void* ptr, std::size_t size)
+{
+    auto const it = mLiveBlocks.find(reinterpret_cast<std::uintptr_t>(ptr));
+    TLLM_CHECK_WITH_INFO(
+        it != mLiveBlocks.end(), "Pinned memory %p is not allocated by the pool or already freed", ptr);
+    TLLM_CHECK_WITH_INFO(it->second.size == size, "Pinned memory %p of %zu bytes freed with a size of %zu bytes", ptr,
+        it->second.size, size);
+    std::vector<cudaEvent_t> events;
+    events.reserve(it->second.uses.size());
+    for (auto const& use : it->second.uses)
+    {
+        events.push_back(use.second);
+    }
+    mLiveBlocks.erase(it);
+    return events;
+}
+
+cudaEvent_t PinnedPool::getEvent()
+{
+    if (mFreeEvents.empty())
+    {
+        cudaEvent_t event{};
+        TLLM_CUDA_CHECK(::cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+        return event;
+    }
+    auto* event = mFreeEvents.back();
+    mFreeEvents.pop_back();
+    return event;
+}
+
+void PinnedPool::reclaimPendingBlocks()
+{
+    auto const isDone = [](cudaEvent_t event)
+    {
+        auto const status = ::cudaEventQuery(event);
+        if (status == cudaErrorNotReady)
+        {
+            return false;
+        }
+        TLLM_CUDA_CHECK(status);
+        return true;
+    };
+    auto const pending = std::stable_partition(mPendingBlocks.begin(), mPendingBlocks.end(),
+        [&isDone](PendingBlock const& block)
+        { return !std::all_of(block.events.begin(), block.events.end(), isDone); });
+    for (auto it = pending; it != mPendingBlocks.end(); ++it)
+    {
+        mFreeBlocks[it->sizeClass].push_back(it->block);
+        mFreeEvents.insert(mFreeEvents.end(), it->events.begin(), it->events.end());
+    }
+    mPendingBlocks.erase(pending, mPendingBlocks.end());
+}
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cuda_runtime_api.h>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief Pool of the pinned host memory of PinnedAllocator, cudaHostAlloc and cudaFreeHost serialize with the driver.
+//!
+//! The sizes are rounded up to size classes, four per power of two from kMinBlockSize to kMaxBlockSize, wasting at most
+//! a quarter of the block. The blocks freed are kept for the next allocations of their class: the small ones in a cache
+//! of the thread that frees them, then in the lists of the pool. The small blocks, up to kMaxSmallBlockSize, are carved
+//! from slabs of kBlocksPerSlab blocks, from kMinSlabSize to kMaxSlabSize bytes. The sizes above kMaxBlockSize are
+//! allocated and freed directly.
+//!
+//! cudaFreeHost waits for the device, a pooled block may still be read or written by an asynchronous copy when it is
+//! freed. The uses of a block by a stream are recorded with recordStream(), BufferManager records its copies. A block
+//! freed after such uses goes back to the free lists once the events recorded after them completed, until then the
+//! allocations of its class take other blocks. Freeing a block that is not allocated throws.
+//!
+//! The memory is only returned to the driver by trim(). Disabled with TRTLLM_DISABLE_PINNED_POOL=1.
+class PinnedPool
+{
+public:
+    static std::size_t constexpr kMinBlockSize = std::size_t{1} << 8;
+    static std::size_t constexpr kMaxBlockSize = std::size_t{1} << 26;
+    static std::size_t constexpr kMaxSmallBlockSize = std::size_t{1} << 18;
+    static std::size_t constexpr kBlocksPerSlab = 32;
+    static std::size_t constexpr kMinSlabSize = std::size_t{1} << 16;
+    static std::size_t constexpr kMaxSlabSize = std::size_t{1} << 21;
+    // Number of small blocks of each class kept by a thread
+    static std::size_t constexpr kThreadCacheBlocks = 4;
+
+    static PinnedPool& getInstance();
+
+    PinnedPool(PinnedPool const&) = delete;
+    PinnedPool& operator=(PinnedPool const&) = delete;
+
+    void* allocate(std::size_t size);
+
+    //! \brief size must be the one given to allocate.
+    void deallocate(void* ptr, std::size_t size);
+
+    //! \brief Orders the reuse of the block containing ptr after the work enqueued on stream until it is freed. Does
+    //! nothing for memory not allocated by the pool.
+    void recordStream(void const* ptr, cudaStream_t stream);
+
+    //! \brief Frees the blocks kept by the pool and the slabs whose blocks are all kept by it. The blocks in the caches
+    //! of the other threads are kept.
+    void trim();
+
+    //! \brief Pinned memory allocated by the pool, used or kept for reuse.
+    [[nodiscard]] std::size_t getReserved() const
+    {
+        return mReserved.load(std::memory_order_relaxed);
+    }
+
+    //! \brief Pinned memory of the allocated blocks, rounded up to their classes.
+    [[nodiscard]] std::size_t getUsed() const
+    {
+        return mUsed.load(std::memory_order_relaxed);
+    }
+
+    //! \brief Allocations served with a block kept by the pool.
+    [[nodiscard]] std::uint64_t getNumHits() const
+    {
+        return mNumHits.load(std::memory_order_relaxed);
+    }
+
+    //! \brief Allocations that allocated pinned memory.
+    [[nodiscard]] std::uint64_t getNumMisses() const
+    {
+        return mNumMisses.load(std::memory_order_relaxed);
+    }
+
+    //! \brief Size class of size, kNbClasses when it is not pooled.
+    static std::size_t getClass(std::size_t size);
+
+    static std::size_t getClassSize(std::size_t sizeClass);
+
+    static std::size_t constexpr kNbClasses = 73;
+
+private:
+    class ThreadCache;
+
+    //! An allocated block and the events recorded after its last use on each stream.
+    struct LiveBlock
+    {
+        std::size_t size;
+        std::vector<std::pair<cudaStream_t, cudaEvent_t>> uses;
+    };
+
+    //! A freed block waiting for the work of its streams.
+    struct PendingBlock
+    {
+        void* block;
+        std::size_t sizeClass;
+        std::vector<cudaEvent_t> events;
+    };
+
+    struct Slab
+    {
+        std::size_t size;
+        std::size_t nbBlocks;
+    };
+
+    PinnedPool();
+
+    ThreadCache& getThreadCache();
+
+    void* allocateBlock(std::size_t sizeClass);
+
+    void releaseBlocks(std::size_t sizeClass, void* const* blocks, std::size_t nbBlocks);
+
+    //! \brief Registers an allocated block, under the lock.
+    void addLiveBlock(void* ptr, std::size_t size);
+
+    //! \brief Unregisters a block being freed and returns the events of its uses, throws if it is not allocated.
+    std::vector<cudaEvent_t> removeLiveBlock(void* ptr, std::size_t size);
+
+    //! \brief An event to record, under the lock.
+    cudaEvent_t getEvent();
+
+    //! \brief Moves the pending blocks whose events completed to the free lists, under the lock.
+    void reclaimPendingBlocks();
+
+    void trimSlabs(std::size_t sizeClass);
+
+    bool const mEnabled;
+    std::mutex mMutex;
+    std::array<std::vector<void*>, kNbClasses> mFreeBlocks;
+    std::map<std::uintptr_t, LiveBlock> mLiveBlocks;
+    std::vector<PendingBlock> mPendingBlocks;
+    std::vector<cudaEvent_t> mFreeEvents;
+    std::map<std::uintptr_t, Slab> mSlabs;
+    std::atomic<std::size_t> mReserved{0};
+    std::atomic<std::size_t> mUsed{0};
+    std::atomic<std::uint64_t> mNumHits{0};
+    std::atomic<std::uint64_t> mNumMisses{0};
+};
+
+} // namespace tensorrt_llm::runtime
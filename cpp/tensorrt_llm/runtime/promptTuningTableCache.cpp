@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/promptTuningTableCache.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/memoryCounters.h"
+
+#include <unordered_set>
+#include <utility>
+
+namespace tensorrt_llm::runtime
+{
+
+PromptTuningTableCache::PromptTuningTableCache(SizeType numSlots, SizeType taskVocabSize, SizeType hiddenSize,
+    nvinfer1::DataType type, BufferManager::CudaStreamPtr stream)
+    : mNumSlots{numSlots}
+    , mTaskVocabSize{taskVocabSize}
+    , mHiddenSize{hiddenSize}
+    , mType{type}
+    , mManager{std::move(stream)}
+{
+    TLLM_CHECK_WITH_INFO(numSlots > 0 && taskVocabSize > 0 && hiddenSize > 0,
+        "The prompt tuning table cache needs at least one non-empty slot");
+    {
+        MemoryCounters::TagScope const tagScope{MemoryTag::kPROMPT_TABLE_CACHE};
+        mTable = mManager.gpu(ITensor::makeShape({numSlots * taskVocabSize, hiddenSize}), type);
+    }
+    mFreeSlots.reserve(numSlots);
+    for (auto slot = numSlots - 1; slot >= 0; --slot)
+    {
+        mFreeSlots.push_back(slot);
+    }
+}
+
+void PromptTuningTableCache::mapTasks(PromptTuningParams& params, ITensor& tasksHost, TableGetter const& getTable)
+{
+    auto const batchSize = static_cast<SizeType>(tasksHost.getSize());
+    TLLM_CHECK_WITH_INFO(static_cast<SizeType>(params.promptTuningEnabled.size()) == batchSize,
+        "promptTuningEnabled must have one entry per task");
+    auto* tasks = bufferCast<SizeType>(tasksHost);
+
+    // The cached tasks of the batch move to the front first, so the loads below evict none of them
+    std::unordered_set<TaskIdType> batchTasks;
+    std::vector<TaskIdType> missing;
+    for (SizeType bid = 0; bid < batchSize; ++bid)
+    {
+        if (!params.promptTuningEnabled[bid])
+        {
+            continue;
+        }
+        auto const taskId = tasks[bid];
+        if (!batchTasks.insert(taskId).second)
+        {
+            ++mNumHits;
+            continue;
+        }
+        auto it = mTasks.find(taskId);
+        if (it != mTasks.end())
+        {
+            mLru.splice(mLru.begin(), mLru, it->second.lruIt);
+            ++mNumHits;
+        }
+        else
+        {
+            missing.push_back(taskId);
+        }
+    }
+    TLLM_CHECK_WITH_INFO(static_cast<SizeType>(batchTasks.size()) <= mNumSlots,
+        "The batch uses %zu prompt tuning tasks, more than the %d slots of the cache", batchTasks.size(), mNumSlots);
+
+    for (auto const taskId : missing)
+    {
+        load(taskId, getTable);
+    }
+
+    for (SizeType bid = 0; bid < batchSize; ++bid)
+    {
+        if (params.promptTuningEnabled[bid])
+        {
+            tasks[bid] = mTasks.at(tasks[bid]).slot;
+        }
+    }
+    params.embeddingTable = mTable;
+}
+
+void PromptTuningTableCache::erase(TaskIdType taskId)
+{
+    auto it = mTasks.find(taskId);
+    TLLM_CHECK_WITH_INFO(it != mTasks.end(), "Prompt tuning task %d is not cached", taskId);
+    mFreeSlots.push_back(it->second.slot);
+    mLru.erase(it->second.lruIt);
+    mTasks.erase(it);
+}
+
+SizeType PromptTuningTableCache::load(TaskIdType taskId, TableGetter const& getTable)
+{
+    auto const table = getTable(taskId);
+    TLLM_CHECK_WITH_INFO(table && table->getDataType() == mType
+            && table->getSize() == static_cast<std::size_t>(mTaskVocabSize) * mHiddenSize,
+        "The table of prompt tuning task %d must have %d x %d elements of the type of the cache", taskId,
+        mTaskVocabSize, mHiddenSize);
+
+    SizeType slot;
+    if (!mFreeSlots.empty())
+    {
+        slot = mFreeSlots.back();
+        mFreeSlots.pop_back();
+    }
+    else
+    {
+        // The least recently used task is not in the batch, mapTasks checked that the batch fits
+        auto const evicted = mLru.back();
+        TLLM_LOG_DEBUG("Evicting the table of prompt tuning task %d", evicted);
+        slot = mTasks.at(evicted).slot;
+        mTasks.erase(evicted);
+        mLru.pop_back();
+    }
+
+    auto dst = ITensor::slice(mTable, slot * mTaskVocabSize, mTaskVocabSize);
+    mManager.copy(*table, *dst);
+    mLru.push_front(taskId);
+    mTasks.emplace(taskId, Task{slot, mLru.begin()});
+    ++mNumLoads;
+    return slot;
+}
+
+} // namespace tensorrt_llm::runtime
@@ -23,6 +23,7 @@
 #include "tensorrt_llm/runtime/utils/sessionUtils.h"
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 
 using namespace tensorrt_llm::runtime;
@@ -88,12 +89,15 @@ void RuntimeBuffers::clear()
     attentionMask = nullptr;
     positionIds = nullptr;
     lastTokenIds = nullptr;
+    contextTokenIds = nullptr;
     requestTypes = nullptr;
 
     presentKeysVals.clear();
     presentKeysValsAlt.clear();
     kvCacheBlockPointersHost = nullptr;
     kvCacheBlockPointersDevice = nullptr;
+    kvCacheBlockPointersStaging = {};
+    kvCacheBlockPointersUploaded = {};
 
     cacheIndirectionDecoderInput = nullptr;
     cacheIndirectionDecoderOutput = nullptr;
@@ -102,6 +106,11 @@ void RuntimeBuffers::clear()
     logProbs = nullptr;
 
     hiddenStates = nullptr;
+    returnsHiddenStates = false;
+
+    contextPositionIds = nullptr;
+    generationPositionIds = nullptr;
+    mArenaTensors.clear();
 
     allocated = false;
     TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
@@ -123,7 +132,10 @@ void RuntimeBuffers::create(TllmRuntime& runtime, GptModelConfig const& modelCon
     auto& manager = runtime.getBufferManager();
     auto& engine = runtime.getEngine();
 
-    if (worldConfig.isLastPipelineParallelRank())
+    // Engines built with output_hidden_states skip the LM head and return the hidden states of all the tokens
+    returnsHiddenStates = worldConfig.isLastPipelineParallelRank()
+        && engine.getTensorIOMode("logits") != nvinfer1::TensorIOMode::kOUTPUT;
+    if (worldConfig.isLastPipelineParallelRank() && !returnsHiddenStates)
     {
         auto const logitsType = engine.getTensorDataType("logits");
         logits = manager.emptyTensor(MemoryType::kGPU, logitsType);
@@ -146,6 +158,13 @@ void RuntimeBuffers::create(TllmRuntime& runtime, GptModelConfig const& modelCon
 
     contextLengthsHost = manager.emptyTensor(MemoryType::kPINNED, nvinfer1::DataType::kINT32);
     lastTokenIds = manager.emptyTensor(MemoryType::kGPU, nvinfer1::DataType::kINT32);
+    // Engines built with packed inputs gather the hidden states before the LM head even when they return the context
+    // logits, the context step then selects the rows of all the tokens
+    if (worldConfig.isLastPipelineParallelRank() && modelConfig.computeContextLogits() && modelConfig.usePackedInput()
+        && engine.getTensorIOMode("last_token_ids") == nvinfer1::TensorIOMode::kINPUT)
+    {
+        contextTokenIds = manager.emptyTensor(MemoryType::kGPU, nvinfer1::DataType::kINT32);
+    }
 
     auto const localNbLayers = modelConfig.getNbLayers(worldConfig.getPipelineParallelism());
     auto const firstLayerId = worldConfig.getPipelineParallelRank() * localNbLayers;
@@ -179,6 +198,11 @@ void RuntimeBuffers::create(TllmRuntime& runtime, GptModelConfig const& modelCon
             = engine.getTensorDataType(("kv_cache_block_pointers_" + std::to_string(firstLayerId)).c_str());
         kvCacheBlockPointersHost = manager.emptyTensor(MemoryType::kCPU, kvCacheBlockPointersType);
         kvCacheBlockPointersDevice = manager.emptyTensor(MemoryType::kGPU, kvCacheBlockPointersType);
+        for (std::size_t i = 0; i < kvCacheBlockPointersStaging.size(); ++i)
+        {
+            kvCacheBlockPointersStaging[i] = manager.emptyTensor(MemoryType::kPINNED, kvCacheBlockPointersType);
+            kvCacheBlockPointersUploaded[i] = std::make_shared<CudaEvent>();
+        }
     }
     else
     {
@@ -190,6 +214,11 @@ void RuntimeBuffers::create(TllmRuntime& runtime, GptModelConfig const& modelCon
         pastKeyValueLengths = manager.emptyTensor(MemoryType::kCPU, nvinfer1::DataType::kINT32);
         maxAttentionWindows
             = utils::createBufferVector(runtime, localNbLayers, MemoryType::kCPU, nvinfer1::DataType::kINT32);
+        if (useArena)
+        {
+            contextPositionIds = manager.emptyTensor(MemoryType::kGPU, nvinfer1::DataType::kINT32);
+            generationPositionIds = manager.emptyTensor(MemoryType::kGPU, nvinfer1::DataType::kINT32);
+        }
     }
     else
     {
@@ -206,7 +235,7 @@ void RuntimeBuffers::create(TllmRuntime& runtime, GptModelConfig const& modelCon
 
     nbFinished = BufferManager::pinned(ITensor::makeShape({1}), nvinfer1::DataType::kINT32);
 
-    if (worldConfig.isPipelineParallel())
+    if (worldConfig.isPipelineParallel() || returnsHiddenStates)
     {
         hiddenStates = manager.emptyTensor(MemoryType::kGPU, modelConfig.getDataType());
     }
@@ -226,7 +255,8 @@ void RuntimeBuffers::initFromInput(ITensor const& inputIds, TensorPtr const& inp
         inputIds, *contextLengthsHost, inputPacked, beamWidth, maxAttentionWindow, maxSequenceLength);
 }
 
-void RuntimeBuffers::reshape(GptModelConfig const& modelConfig, WorldConfig const& worldConfig)
+void RuntimeBuffers::reshape(
+    BufferManager const& manager, GptModelConfig const& modelConfig, WorldConfig const& worldConfig)
 {
     TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
 
@@ -236,27 +266,67 @@ void RuntimeBuffers::reshape(GptModelConfig const& modelConfig, WorldConfig cons
     auto const maxAttentionWindow = generationConfig.maxAttentionWindow;
     auto const vocabSizePadded = modelConfig.getVocabSizePadded(worldConfig.getSize());
 
-    if (worldConfig.isLastPipelineParallelRank())
+    // Without the arena, the device tensors are reshaped in place. With it, their shapes are recorded and they are
+    // placed in one allocation at the end. A tensor reshaped twice keeps the capacity of the largest shape.
+    std::vector<ArenaTensor> arenaTensors;
+    auto reshapeDevice = [this, &arenaTensors](TensorPtr& tensor, nvinfer1::Dims const& shape,
+                             BufferArena::Phase first, BufferArena::Phase last)
+    {
+        if (!useArena)
+        {
+            tensor->reshape(shape);
+            return;
+        }
+        auto const capacity = ITensor::volumeNonNegative(shape);
+        auto it = std::find_if(arenaTensors.begin(), arenaTensors.end(),
+            [&tensor](ArenaTensor const& arenaTensor) { return arenaTensor.tensor == &tensor; });
+        if (it == arenaTensors.end())
+        {
+            arenaTensors.push_back(ArenaTensor{&tensor, tensor->getDataType(), shape, capacity, first, last});
+        }
+        else
+        {
+            it->shape = shape;
+            it->capacity = std::max(it->capacity, capacity);
+        }
+    };
+    auto reshapeDeviceVector = [&reshapeDevice](std::vector<TensorPtr>& tensors, nvinfer1::Dims const& shape)
+    {
+        for (auto& tensor : tensors)
+        {
+            reshapeDevice(tensor, shape, kContextPhase, kGenerationPhase);
+        }
+    };
+
+    if (worldConfig.isLastPipelineParallelRank() && !returnsHiddenStates)
     {
         if (!modelConfig.computeContextLogits())
         {
-            logits->reshape(ITensor::makeShape({batchSize, 1, vocabSizePadded}));
+            reshapeDevice(
+                logits, ITensor::makeShape({batchSize, 1, vocabSizePadded}), kContextPhase, kGenerationPhase);
         }
 
         if (modelConfig.computeGenerationLogits())
         {
-            allGenerationLogits->reshape(
+            reshapeDevice(allGenerationLogits,
                 ITensor::makeShape({(generationConfig.maxSeqLength - generationConfig.maxInputLength), batchSize,
-                    beamWidth, vocabSizePadded}));
+                    beamWidth, vocabSizePadded}),
+                kContextPhase, kGenerationPhase);
 
-            cacheGenerationFragmentPointerDevice->reshape(
-                ITensor::makeShape({batchSize, (generationConfig.maxSeqLength - generationConfig.maxInputLength)}));
+            reshapeDevice(cacheGenerationFragmentPointerDevice,
+                ITensor::makeShape({batchSize, (generationConfig.maxSeqLength - generationConfig.maxInputLength)}),
+                kGenerationPhase, kGenerationPhase);
             cacheGenerationFragmentPointerHost->reshape(
                 ITensor::makeShape({batchSize, (generationConfig.maxSeqLength - generationConfig.maxInputLength)}));
         }
     }
 
-    lastTokenIds->reshape(ITensor::makeShape({batchSize}));
+    reshapeDevice(lastTokenIds, ITensor::makeShape({batchSize}), kContextPhase, kGenerationPhase);
+    if (contextTokenIds)
+    {
+        // shared by the context batches, not placed in the arena
+        contextTokenIds->reshape(ITensor::makeShape({batchSize * maxInputLength}));
+    }
 
     auto kvCacheReserve = ITensor::makeShape(
         {batchSize, 2, modelConfig.getNbKvHeads(), maxAttentionWindow, modelConfig.getSizePerHead()});
@@ -271,14 +341,14 @@ void RuntimeBuffers::reshape(GptModelConfig const& modelConfig, WorldConfig cons
         // reserve batchSize * beamWidth and resize to batchSize
         auto cacheBlockPointersShape = ITensor::makeShape({localNbLayers, batchSize * beamWidth, 2, maxBlocksPerSeq});
         kvCacheBlockPointersHost->reshape(cacheBlockPointersShape);
-        kvCacheBlockPointersDevice->reshape(cacheBlockPointersShape);
+        reshapeDevice(kvCacheBlockPointersDevice, cacheBlockPointersShape, kContextPhase, kGenerationPhase);
         cacheBlockPointersShape.d[1] = batchSize;
         kvCacheBlockPointersHost->reshape(cacheBlockPointersShape);
-        kvCacheBlockPointersDevice->reshape(cacheBlockPointersShape);
+        reshapeDevice(kvCacheBlockPointersDevice, cacheBlockPointersShape, kContextPhase, kGenerationPhase);
     }
     else
     {
-        utils::reshapeBufferVector(presentKeysVals, kvCacheReserve);
+        reshapeDeviceVector(presentKeysVals, kvCacheReserve);
     }
 
     if (modelConfig.useGptAttentionPlugin())
@@ -286,33 +356,91 @@ void RuntimeBuffers::reshape(GptModelConfig const& modelConfig, WorldConfig cons
         pastKeyValueLengths->reshape(ITensor::makeShape({batchSize}));
         requestTypes->reshape(ITensor::makeShape({batchSize}));
         utils::reshapeBufferVector(maxAttentionWindows, ITensor::makeShape({1}));
+
+        if (useArena)
+        {
+            // GLM has two position ids per token
+            auto const nbPositionIds = modelConfig.getModelVariant() == GptModelConfig::ModelVariant::kGlm ? 2 : 1;
+            reshapeDevice(contextPositionIds, ITensor::makeShape({nbPositionIds * batchSize * maxInputLength}),
+                kContextPhase, kContextPhase);
+            reshapeDevice(generationPositionIds, ITensor::makeShape({nbPositionIds * batchSize * beamWidth}),
+                kGenerationPhase, kGenerationPhase);
+        }
     }
     else
     {
-        utils::reshapeBufferVector(presentKeysValsAlt, kvCacheReserve);
+        reshapeDeviceVector(presentKeysValsAlt, kvCacheReserve);
         // present KV cache tensors will be reshaped by shape inference.
         // reshape to the required shape here to make context batch slicing work correctly.
-        utils::reshapeBufferVector(presentKeysVals, kvCacheShape);
+        reshapeDeviceVector(presentKeysVals, kvCacheShape);
     }
 
     auto const cacheIndirShape = ITensor::makeShape({batchSize, beamWidth, maxAttentionWindow});
-    cacheIndirectionDecoderInput->reshape(cacheIndirShape);
-    cacheIndirectionDecoderOutput->reshape(cacheIndirShape);
+    reshapeDevice(cacheIndirectionDecoderInput, cacheIndirShape, kContextPhase, kGenerationPhase);
+    reshapeDevice(cacheIndirectionDecoderOutput, cacheIndirShape, kContextPhase, kGenerationPhase);
 
-    if (worldConfig.isPipelineParallel())
+    if (worldConfig.isPipelineParallel() || returnsHiddenStates)
     {
         // reserve max size
         auto const maxNumTokens = std::max(beamWidth, maxInputLength);
         auto const hiddenSize = modelConfig.getHiddenSize() * worldConfig.getTensorParallelism();
         auto const hiddenStatesShape = ITensor::makeShape(
             {batchSize, maxNumTokens, hiddenSize}); // reserve space in traditional [bs, seq_len, hidden_state] way.
-        hiddenStates->reshape(hiddenStatesShape);
+        reshapeDevice(hiddenStates, hiddenStatesShape, kContextPhase, kGenerationPhase);
+    }
+
+    if (useArena)
+    {
+        placeInArena(manager, arenaTensors);
     }
 
     allocated = true;
     TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
 }
 
+void RuntimeBuffers::placeInArena(BufferManager const& manager, std::vector<ArenaTensor> const& arenaTensors)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    // Keep the current allocation if the tensors still fit, they only grow
+    auto const sameTensors = mArenaTensors.size() == arenaTensors.size();
+    auto fits = sameTensors;
+    for (std::size_t i = 0; fits && i < arenaTensors.size(); ++i)
+    {
+        fits = arenaTensors[i].capacity <= mArenaTensors[i]->getCapacity();
+    }
+
+    if (!fits)
+    {
+        BufferArena arena;
+        for (std::size_t i = 0; i < arenaTensors.size(); ++i)
+        {
+            auto const& arenaTensor = arenaTensors[i];
+            auto const capacity = sameTensors ? std::max(arenaTensor.capacity, mArenaTensors[i]->getCapacity())
+                                              : arenaTensor.capacity;
+            arena.add(arenaTensor.type, capacity, arenaTensor.first, arenaTensor.last);
+        }
+        arena.plan();
+
+        // Release the previous allocation before the new one
+        mArenaTensors.clear();
+        for (auto const& arenaTensor : arenaTensors)
+        {
+            *arenaTensor.tensor = nullptr;
+        }
+        mArenaTensors = manager.gpu(arena);
+        TLLM_LOG_DEBUG("Runtime buffers arena of %zu bytes instead of %zu bytes", arena.getSize(),
+            arena.getUnsharedSize());
+    }
+
+    // Replaced tensors, e.g. the tiled logits, are reset to the ones of the arena
+    for (std::size_t i = 0; i < arenaTensors.size(); ++i)
+    {
+        mArenaTensors[i]->reshape(arenaTensors[i].shape);
+        *arenaTensors[i].tensor = mArenaTensors[i];
+    }
+    TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
+}
+
 void RuntimeBuffers::reset(BufferManager& manager)
 {
     clearTensorMaps();
@@ -338,18 +466,23 @@ std::vector<RuntimeBuffers> RuntimeBuffers::split(
         {
             auto const batchSize = std::min(contextBatchSize, generationBatchSize - offset);
             auto& buffers = bufferSlices.emplace_back();
+            buffers.scratch = scratch;
             buffers.generationConfig = generationConfig;
             buffers.generationConfig.batchSize = batchSize;
 
             buffers.contextLengthsHost = ITensor::slice(contextLengthsHost, offset, batchSize);
             buffers.contextLengthsDevice = ITensor::slice(contextLengthsDevice, offset, batchSize);
 
-            if (worldConfig.isLastPipelineParallelRank() && !modelConfig.computeContextLogits())
+            if (worldConfig.isLastPipelineParallelRank() && !modelConfig.computeContextLogits() && logits)
             {
                 buffers.logits = ITensor::slice(logits, offset, batchSize);
             }
 
             buffers.lastTokenIds = ITensor::slice(lastTokenIds, offset, batchSize);
+            if (contextTokenIds)
+            {
+                buffers.contextTokenIds = ITensor::view(contextTokenIds);
+            }
 
             if (modelConfig.usePagedKvCache())
             {
@@ -382,13 +515,16 @@ std::vector<RuntimeBuffers> RuntimeBuffers::split(
                 buffers.pastKeyValueLengths = ITensor::slice(pastKeyValueLengths, offset, batchSize);
                 buffers.maxAttentionWindows = maxAttentionWindows;
                 buffers.requestTypes = ITensor::slice(requestTypes, offset, batchSize);
+                // the context batches run one after the other on the stream
+                buffers.contextPositionIds = contextPositionIds;
             }
             else
             {
                 buffers.presentKeysValsAlt = utils::sliceBufferVector(presentKeysValsAlt, offset, batchSize);
             }
 
-            if (worldConfig.isPipelineParallel())
+            buffers.returnsHiddenStates = returnsHiddenStates;
+            if (worldConfig.isPipelineParallel() || returnsHiddenStates)
             {
                 TLLM_CHECK_WITH_INFO(hiddenStates->getShape().nbDims == 3,
                     "Invalid shape for hiddenStates."); // Expect hiddens states shape to be [bs, seq_len, hidden_size]
@@ -406,6 +542,11 @@ std::vector<RuntimeBuffers> RuntimeBuffers::split(
 
                 buffers.promptTuningParams.tasks = ITensor::slice(promptTuningParams.tasks, offset, batchSize);
             }
+
+            for (auto const& [name, tensor] : extraInputs)
+            {
+                buffers.extraInputs.insert_or_assign(name, ITensor::slice(tensor, offset, batchSize));
+            }
         }
     }
 
@@ -519,7 +660,8 @@ void RuntimeBuffers::postContextStep(std::vector<RuntimeBuffers> const& contextB
     }
 
     // TODO(rkobus) handle this more gracefully
-    positionIds = manager.emptyTensor(MemoryType::kGPU, nvinfer1::DataType::kINT32);
+    positionIds = generationPositionIds ? ITensor::view(generationPositionIds)
+                                        : manager.emptyTensor(MemoryType::kGPU, nvinfer1::DataType::kINT32);
 
     if (modelConfig.computeContextLogits())
     {
@@ -606,7 +748,7 @@ void RuntimeBuffers::prepareContextStep(TensorPtr const& inputIds, TokenIdType c
                 std::iota(begin, end, 0);
                 begin = end;
             }
-            positionIds = manager.copyFrom(positionIdsVec, inputShape, MemoryType::kGPU);
+            setPositionIds(positionIdsVec, inputShape, contextPositionIds, manager);
         }
         else if (modelVariant == GptModelConfig::ModelVariant::kGlm)
         {
@@ -616,12 +758,12 @@ void RuntimeBuffers::prepareContextStep(TensorPtr const& inputIds, TokenIdType c
             {
                 int num_tokens = (int) positionIdsVec.size() / 2;
                 auto const positionIdsShape = ITensor::makeShape({2, num_tokens});
-                positionIds = manager.copyFrom(positionIdsVec, positionIdsShape, MemoryType::kGPU);
+                setPositionIds(positionIdsVec, positionIdsShape, contextPositionIds, manager);
             }
             else
             {
                 auto const positionIdsShape = ITensor::makeShape({batchSize, 2, maxInputLength});
-                positionIds = manager.copyFrom(positionIdsVec, positionIdsShape, MemoryType::kGPU);
+                setPositionIds(positionIdsVec, positionIdsShape, contextPositionIds, manager);
             }
         }
         else
@@ -634,7 +776,7 @@ void RuntimeBuffers::prepareContextStep(TensorPtr const& inputIds, TokenIdType c
             pastKeyValueLengthsPtr[i] = contextLengthsHostPtr[i];
         }
 
-        if (worldConfig.isPipelineParallel())
+        if (worldConfig.isPipelineParallel() || returnsHiddenStates)
         {
             auto const hiddenSize
                 = hiddenStates->getShape().nbDims == 2 ? hiddenStates->getShape().d[1] : hiddenStates->getShape().d[2];
@@ -688,16 +830,89 @@ void RuntimeBuffers::prepareContextStep(TensorPtr const& inputIds, TokenIdType c
         manager.copy(*kvCacheBlockPointersHost, *kvCacheBlockPointersDevice);
     }
 
+    setContextTokenIds(inputIds, manager, modelConfig);
+    TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
+}
+
+void RuntimeBuffers::prepareCachedContextStep(TensorPtr const& inputIds, std::vector<SizeType> const& pastLengths,
+    std::vector<SizeType> const& batchSlots, BufferManager& manager, KvCacheManager const& kvCacheManager,
+    GptModelConfig const& modelConfig, WorldConfig const& worldConfig)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    SizeType const batchSize = generationConfig.batchSize;
+    TLLM_CHECK(modelConfig.useGptAttentionPlugin() && modelConfig.usePackedInput() && modelConfig.usePagedKvCache());
+    TLLM_CHECK_WITH_INFO(modelConfig.getModelVariant() == GptModelConfig::ModelVariant::kGpt,
+        "A context step after cached tokens only supports GPT position ids");
+    TLLM_CHECK(static_cast<SizeType>(pastLengths.size()) == batchSize);
+    TLLM_CHECK(static_cast<SizeType>(batchSlots.size()) == batchSize);
+
+    std::fill_n(bufferCast<int32_t>(*requestTypes), batchSize, 0);
+    auto const localNbLayers = modelConfig.getNbLayers(worldConfig.getPipelineParallelism());
+    for (auto layer = 0; layer < localNbLayers; ++layer)
+    {
+        bufferCast<SizeType>(*maxAttentionWindows[layer])[0] = generationConfig.maxAttentionWindow;
+    }
+
+    // The new tokens of a request follow its tokens in the KV cache and attend to all of them
+    auto const contextLengthsHostPtr = bufferCast<SizeType const>(*contextLengthsHost);
+    auto pastKeyValueLengthsPtr = bufferCast<SizeType>(*pastKeyValueLengths);
+    std::vector<SizeType> kvLengths(batchSize);
+    std::vector<SizeType> positionIdsVec(inputIds->getSize());
+    auto begin = std::begin(positionIdsVec);
+    for (SizeType i = 0; i < batchSize; ++i)
+    {
+        kvLengths[i] = pastLengths[i] + contextLengthsHostPtr[i];
+        pastKeyValueLengthsPtr[i] = kvLengths[i];
+        auto end = begin + contextLengthsHostPtr[i];
+        std::iota(begin, end, pastLengths[i]);
+        begin = end;
+    }
+    setPositionIds(positionIdsVec, inputIds->getShape(), contextPositionIds, manager);
+    sequenceLengths = manager.copyFrom(kvLengths, ITensor::makeShape({batchSize}), MemoryType::kGPU);
+
+    for (SizeType i = 0; i < batchSize; ++i)
+    {
+        kvCacheManager.copyBlockPointers(*kvCacheBlockPointersHost, i, batchSlots[i], 1);
+    }
+    manager.copy(*kvCacheBlockPointersHost, *kvCacheBlockPointersDevice);
+
+    setContextTokenIds(inputIds, manager, modelConfig);
+    TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
+}
+
+void RuntimeBuffers::setContextTokenIds(
+    TensorPtr const& inputIds, BufferManager& manager, GptModelConfig const& modelConfig)
+{
+    auto& stream = manager.getStream();
     if (modelConfig.usePackedInput())
     {
-        kernels::invokeInclusiveSum(*lastTokenIds, *contextLengthsDevice, manager, stream);
+        if (scratch)
+        {
+            kernels::invokeInclusiveSum(*lastTokenIds, *contextLengthsDevice, *scratch);
+        }
+        else
+        {
+            kernels::invokeInclusiveSum(*lastTokenIds, *contextLengthsDevice, manager, stream);
+        }
     }
     else
     {
         manager.copy(*contextLengthsDevice, *lastTokenIds);
     }
 
-    TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
+    if (contextTokenIds)
+    {
+        contextTokenIds->reshape(ITensor::makeShape({static_cast<SizeType>(inputIds->getSize())}));
+        kernels::invokeFill(*contextTokenIds, 1, stream);
+        if (scratch)
+        {
+            kernels::invokeInclusiveSum(*contextTokenIds, *contextTokenIds, *scratch);
+        }
+        else
+        {
+            kernels::invokeInclusiveSum(*contextTokenIds, *contextTokenIds, manager, stream);
+        }
+    }
 }
 
 RuntimeBuffers::TensorPtr RuntimeBuffers::prepareNextStep(SizeType const step, BufferManager& manager,
@@ -749,12 +964,12 @@ RuntimeBuffers::TensorPtr RuntimeBuffers::prepareNextStep(SizeType const step, B
             if (modelConfig.usePackedInput())
             {
                 auto const positionIdsShape = ITensor::makeShape({2, batchSize * beamWidth});
-                positionIds = manager.copyFrom(positionIdsVec, positionIdsShape, MemoryType::kGPU);
+                setPositionIds(positionIdsVec, positionIdsShape, generationPositionIds, manager);
             }
             else
             {
                 auto const positionIdsShape = ITensor::makeShape({batchSize * beamWidth, 2, 1});
-                positionIds = manager.copyFrom(positionIdsVec, positionIdsShape, MemoryType::kGPU);
+                setPositionIds(positionIdsVec, positionIdsShape, generationPositionIds, manager);
             }
         }
         else
@@ -811,18 +1026,56 @@ RuntimeBuffers::TensorPtr RuntimeBuffers::prepareNextStep(SizeType const step, B
             kvCacheManager->addToken(batchIdx);
         }
         kvCacheManager->getBlockPointersOfBatch(*kvCacheBlockPointersHost, firstBatchSlotIdx, batchSize, beamWidth);
-        manager.copy(*kvCacheBlockPointersHost, *kvCacheBlockPointersDevice);
+        uploadKvCacheBlockPointers(step, manager);
     }
 
     kernels::invokeFill(*lastTokenIds, 1, stream);
     if (modelConfig.usePackedInput())
     {
-        kernels::invokeInclusiveSum(*lastTokenIds, *lastTokenIds, manager, stream);
+        if (scratch)
+        {
+            kernels::invokeInclusiveSum(*lastTokenIds, *lastTokenIds, *scratch);
+        }
+        else
+        {
+            kernels::invokeInclusiveSum(*lastTokenIds, *lastTokenIds, manager, stream);
+        }
     }
     TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
     return nextInputIds;
 }
 
+void RuntimeBuffers::setPositionIds(std::vector<SizeType> const& positionIdsVec, nvinfer1::Dims const& shape,
+    TensorPtr const& arenaTensor, BufferManager& manager)
+{
+    if (arenaTensor)
+    {
+        TLLM_CHECK(positionIdsVec.size() == ITensor::volumeNonNegative(shape));
+        positionIds = ITensor::view(arenaTensor, shape);
+        manager.copy(positionIdsVec.data(), *positionIds);
+    }
+    else
+    {
+        positionIds = manager.copyFrom(positionIdsVec, shape, MemoryType::kGPU);
+    }
+}
+
+void RuntimeBuffers::uploadKvCacheBlockPointers(SizeType const step, BufferManager& manager)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    // A copy from pageable memory synchronizes the stream, which would keep the host from enqueueing steps ahead.
+    // Stage through two pinned buffers instead, and reuse one only once its previous copy has run.
+    auto const stagingId = static_cast<std::size_t>(step) % kvCacheBlockPointersStaging.size();
+    auto& staging = *kvCacheBlockPointersStaging[stagingId];
+    auto const& uploaded = *kvCacheBlockPointersUploaded[stagingId];
+    uploaded.synchronize();
+    staging.reshape(kvCacheBlockPointersHost->getShape());
+    std::memcpy(staging.data(), kvCacheBlockPointersHost->data(), kvCacheBlockPointersHost->getSizeInBytes());
+    manager.copy(staging, *kvCacheBlockPointersDevice);
+    manager.getStream().record(uploaded);
+    TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
+}
+
 void RuntimeBuffers::getRuntimeBuffers(TensorMap& inputBuffers, TensorMap& outputBuffers, SizeType const step,
     TensorPtr const& inputIds, TensorPtr const& commPtrs, GptModelConfig const& modelConfig,
     WorldConfig const& worldConfig) const
@@ -831,7 +1084,7 @@ void RuntimeBuffers::getRuntimeBuffers(TensorMap& inputBuffers, TensorMap& outpu
     inputBuffers.clear();
     outputBuffers.clear();
 
-    if (worldConfig.isLastPipelineParallelRank())
+    if (worldConfig.isLastPipelineParallelRank() && !returnsHiddenStates)
     {
         // feed a view to TensorRT runtime so reshaping does not change logits buffer
         outputBuffers.insert_or_assign("logits", ITensor::view(logits));
@@ -855,6 +1108,10 @@ void RuntimeBuffers::getRuntimeBuffers(TensorMap& inputBuffers, TensorMap& outpu
     {
         inputBuffers.insert_or_assign("last_token_ids", lastTokenIds);
     }
+    else if (contextTokenIds)
+    {
+        inputBuffers.insert_or_assign("last_token_ids", step == 0 ? contextTokenIds : lastTokenIds);
+    }
     inputBuffers.insert_or_assign("position_ids", positionIds);
 
     auto const localNbLayers = modelConfig.getNbLayers(worldConfig.getPipelineParallelism());
@@ -922,6 +1179,11 @@ void RuntimeBuffers::getRuntimeBuffers(TensorMap& inputBuffers, TensorMap& outpu
         inputBuffers.insert_or_assign("tasks", promptTuningParams.tasks);
         inputBuffers.insert_or_assign("prompt_vocab_size", promptTuningParams.vocabSize);
     }
+
+    for (auto const& [name, tensor] : extraInputs)
+    {
+        inputBuffers.insert_or_assign(name, tensor);
+    }
     TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
 }
 
@@ -17,12 +17,15 @@
 #pragma once
 
 #include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
 #include "tensorrt_llm/runtime/gptModelConfig.h"
 #include "tensorrt_llm/runtime/iTensor.h"
 #include "tensorrt_llm/runtime/promptTuningParams.h"
+#include "tensorrt_llm/runtime/scratchArena.h"
 #include "tensorrt_llm/runtime/worldConfig.h"
 
 #include <array>
+#include <memory>
 #include <vector>
 
 namespace tensorrt_llm::batch_manager::kv_cache_manager
@@ -86,6 +89,7 @@ public:
     TensorPtr attentionMask;       // without attention plugin
     TensorPtr positionIds;
     TensorPtr lastTokenIds;
+    TensorPtr contextTokenIds;     // with context logits, gathered before the LM head. Positions of all the tokens
     TensorPtr requestTypes;        // with attention plugin. Host tensor
     TensorPtr allGenerationLogits; // pre-allocate a buffer to save all generation logits, device tensor
 
@@ -94,6 +98,9 @@ public:
     std::vector<TensorPtr> maxAttentionWindows; // with attention plugin, host tensor
     TensorPtr kvCacheBlockPointersHost;         // [numLayers, batchSize * beamWidth, 2, maxBlocksPerSeq * 2]
     TensorPtr kvCacheBlockPointersDevice;       // [numLayers, batchSize * beamWidth, 2, maxBlocksPerSeq * 2]
+    // pinned copies of kvCacheBlockPointersHost, uploaded without synchronizing the stream in generation steps
+    std::array<TensorPtr, 2> kvCacheBlockPointersStaging;
+    std::array<std::shared_ptr<CudaEvent>, 2> kvCacheBlockPointersUploaded;
 
     // References to tmp buffers
     TensorPtr newTokens;
@@ -111,13 +118,17 @@ public:
     TensorPtr cumLogProbs;
     TensorPtr logProbs;
 
-    // pipeline parallelism
+    // pipeline parallelism, and engines that skip the LM head
     TensorPtr hiddenStates;
+    bool returnsHiddenStates{false}; // the engine of the last rank returns hiddenStates instead of the logits
 
     // Prompt tuning
     PromptTuningParams promptTuningParams;
     TensorPtr promptTuningTasksHost; // Tensor to hold tasks on host
 
+    // Additional engine inputs, see GenerationInput::extraInputs
+    TensorMap extraInputs;
+
     // Context and generation logits buffer
     TensorPtr cacheContextLogits;
     TensorPtr cacheContextLogitsHost;
@@ -126,6 +137,14 @@ public:
     TensorPtr cacheGenerationFragmentPointerDevice;
     TensorPtr cacheGenerationFragmentPointerHost;
 
+    // Place the device tensors in one allocation, see placeInArena. Set before create.
+    bool useArena{false};
+    TensorPtr contextPositionIds;    // with attention plugin and arena, shared by the context batches
+    TensorPtr generationPositionIds; // with attention plugin and arena
+
+    // Temporaries of the kernels of the steps, on the stream of the runtime. Allocated separately when not set.
+    std::shared_ptr<ScratchArena> scratch;
+
     bool allocated{false};
 
 public:
@@ -138,7 +157,7 @@ public:
         SizeType maxAttentionWindow, SizeType maxSequenceLength, BufferManager& manager);
 
     //! \brief Reshape buffers based on current GenerationConfig
-    void reshape(GptModelConfig const& modelConfig, WorldConfig const& worldConfig);
+    void reshape(BufferManager const& manager, GptModelConfig const& modelConfig, WorldConfig const& worldConfig);
 
     void reset(BufferManager& manager);
 
@@ -153,12 +172,43 @@ public:
         WorldConfig const& worldConfig);
     TensorPtr prepareNextStep(SizeType step, BufferManager& manager, KvCacheManager* kvCacheManager,
         SizeType firstBatchSlotIdx, GptModelConfig const& modelConfig, WorldConfig const& worldConfig);
+    //! \brief Prepares a context step of packed `inputIds` that follow `pastLengths` tokens already in the KV cache,
+    //! e.g. to verify speculative drafts. Request i is in KV cache slot `batchSlots[i]`.
+    void prepareCachedContextStep(TensorPtr const& inputIds, std::vector<SizeType> const& pastLengths,
+        std::vector<SizeType> const& batchSlots, BufferManager& manager, KvCacheManager const& kvCacheManager,
+        GptModelConfig const& modelConfig, WorldConfig const& worldConfig);
 
     void getRuntimeBuffers(TensorMap& inputBuffers, TensorMap& outputBuffers, SizeType const step,
         TensorPtr const& inputIds, TensorPtr const& commPtrs, GptModelConfig const& modelConfig,
         WorldConfig const& worldConfig) const;
 
 private:
+    // Phases of the lifetimes of the tensors in the arena
+    static BufferArena::Phase constexpr kContextPhase{0};
+    static BufferArena::Phase constexpr kGenerationPhase{1};
+
+    struct ArenaTensor
+    {
+        TensorPtr* tensor;
+        nvinfer1::DataType type;
+        nvinfer1::Dims shape;
+        std::size_t capacity;
+        BufferArena::Phase first;
+        BufferArena::Phase last;
+    };
+
+    //! \brief Places the tensors in a BufferArena where the ones only used in the context phase share memory with the
+    //! ones only used in the generation phase. The arena is only reallocated when a tensor grows.
+    void placeInArena(BufferManager const& manager, std::vector<ArenaTensor> const& arenaTensors);
+
+    void setPositionIds(std::vector<SizeType> const& positionIdsVec, nvinfer1::Dims const& shape,
+        TensorPtr const& arenaTensor, BufferManager& manager);
+
+    void uploadKvCacheBlockPointers(SizeType step, BufferManager& manager);
+
+    //! \brief Sets the last token ids and context token ids of a context step from the context lengths.
+    void setContextTokenIds(TensorPtr const& inputIds, BufferManager& manager, GptModelConfig const& modelConfig);
+
     void gatherLastTokenLogits(
         BufferManager& manager, GptModelConfig const& modelConfig, WorldConfig const& worldConfig);
 
@@ -174,6 +224,9 @@ private:
     static std::vector<SizeType> getPositionIdsGenerationPhaseGlm(const SizeType& batchSize, const SizeType& beamSize,
         const SizeType& step, const SizeType* pInputLengths, const bool useGptAttentionPlugin,
         const bool usePackedInput);
+
+    // Tensors of the arena, in the order they were placed
+    std::vector<TensorPtr> mArenaTensors;
 };
 
 } // namespace tensorrt_llm::runtime
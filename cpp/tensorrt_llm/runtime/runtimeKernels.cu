@@ -18,6 +18,7 @@
 #include "tensorrt_llm/common/cudaUtils.h"
 #include "tensorrt_llm/common/memoryUtils.h"
 #include "tensorrt_llm/common/reduceKernelUtils.cuh"
+#include "tensorrt_llm/kernels/decodingCommon.h"
 #include "tensorrt_llm/runtime/runtimeKernels.h"
 
 #include <cub/cub.cuh>
@@ -107,6 +108,7 @@ void invokeFillBatch(IBuffer& buffer, IBuffer const& slotIndices, std::size_t sl
 template void invokeFillBatch<float>(IBuffer&, IBuffer const&, std::size_t, IBuffer const&, CudaStream const&);
 template void invokeFillBatch<std::int8_t>(IBuffer&, IBuffer const&, std::size_t, IBuffer const&, CudaStream const&);
 template void invokeFillBatch<std::int32_t>(IBuffer&, IBuffer const&, std::size_t, IBuffer const&, CudaStream const&);
+template void invokeFillBatch<std::uint8_t>(IBuffer&, IBuffer const&, std::size_t, IBuffer const&, CudaStream const&);
 
 namespace
 {
@@ -176,6 +178,66 @@ void invokeCopyBatch(IBuffer const& srcBuffer, IBuffer& dstBuffer, IBuffer const
         srcDataPtr, dstDataPtr, srcOffsetsPtr, dstOffsetsPtr, sizesPtr, static_cast<int32_t>(dataTypeSize));
 }
 
+namespace
+{
+template <typename VecT>
+__global__ void copyBlocks(
+    uint8_t* poolData, std::int32_t const* srcBlockIds, std::int32_t const* dstBlockIds, std::size_t blockSizeInBytes)
+{
+    constexpr auto VEC_ELTS = sizeof(VecT);
+    auto const srcStartIdx = static_cast<std::size_t>(srcBlockIds[blockIdx.y]) * blockSizeInBytes;
+    auto const dstStartIdx = static_cast<std::size_t>(dstBlockIds[blockIdx.y]) * blockSizeInBytes;
+    auto const tidx = (static_cast<std::size_t>(blockIdx.x) * blockDim.x + threadIdx.x) * VEC_ELTS;
+    auto const stride = static_cast<std::size_t>(blockDim.x) * gridDim.x * VEC_ELTS;
+
+    for (auto idx = tidx; idx < blockSizeInBytes; idx += stride)
+    {
+        *reinterpret_cast<VecT*>(&poolData[dstStartIdx + idx])
+            = *reinterpret_cast<const VecT*>(&poolData[srcStartIdx + idx]);
+    }
+}
+} // namespace
+
+void invokeCopyBlocks(IBuffer& pool, IBuffer const& srcBlockIds, IBuffer const& dstBlockIds, std::size_t blockStride,
+    CudaStream const& stream)
+{
+    TLLM_CHECK_WITH_INFO(srcBlockIds.getSize() == dstBlockIds.getSize(), "Block id buffers must have the same size");
+    auto const numBlocks = srcBlockIds.getSize();
+    if (numBlocks == 0)
+    {
+        return;
+    }
+    auto poolDataPtr = reinterpret_cast<uint8_t*>(pool.data());
+    auto srcBlockIdsPtr = bufferCast<std::int32_t>(srcBlockIds);
+    auto dstBlockIdsPtr = bufferCast<std::int32_t>(dstBlockIds);
+    auto const blockSizeInBytes = blockStride * BufferDataType(pool.getDataType()).getSize();
+
+    auto copyBlocksInvocation = copyBlocks<uint8_t>;
+    std::size_t vectorSize = 1;
+    if (blockSizeInBytes % 16 == 0)
+    {
+        vectorSize = 16;
+        copyBlocksInvocation = copyBlocks<uint4>;
+    }
+    else if (blockSizeInBytes % 8 == 0)
+    {
+        vectorSize = 8;
+        copyBlocksInvocation = copyBlocks<uint2>;
+    }
+    else if (blockSizeInBytes % 4 == 0)
+    {
+        vectorSize = 4;
+        copyBlocksInvocation = copyBlocks<uint32_t>;
+    }
+
+    dim3 const blockSize{256};
+    std::size_t const gridx{tc::ceilDiv(blockSizeInBytes / vectorSize, blockSize.x)};
+    std::size_t const gridMax{std::numeric_limits<std::uint32_t>::max()};
+    dim3 const gridSize{static_cast<std::uint32_t>(std::min(gridx, gridMax)), static_cast<std::uint32_t>(numBlocks)};
+    copyBlocksInvocation<<<gridSize, blockSize, 0, stream.get()>>>(
+        poolDataPtr, srcBlockIdsPtr, dstBlockIdsPtr, blockSizeInBytes);
+}
+
 namespace
 {
 template <typename T>
@@ -265,6 +327,47 @@ void reduce(IBuffer& output, IBuffer const& input, CudaStream const& stream)
     }
 }
 
+namespace
+{
+__global__ void countFinished(SizeType* finishedSum, tensorrt_llm::kernels::FinishedState const* finished,
+    SizeType const batchSize, SizeType const beamWidth)
+{
+    for (auto batchIdx = static_cast<SizeType>(blockIdx.x * blockDim.x + threadIdx.x); batchIdx < batchSize;
+         batchIdx += blockDim.x * gridDim.x)
+    {
+        SizeType count = 0;
+        for (SizeType beamIdx = 0; beamIdx < beamWidth; ++beamIdx)
+        {
+            count += finished[batchIdx * beamWidth + beamIdx].isFinished() ? 1 : 0;
+        }
+        finishedSum[batchIdx] = count;
+    }
+}
+} // namespace
+
+void countFinished(IBuffer& finishedSum, ITensor const& finished, CudaStream const& stream)
+{
+    using FinishedState = tensorrt_llm::kernels::FinishedState;
+    auto const& shape = finished.getShape();
+    TLLM_CHECK_WITH_INFO(shape.nbDims == 2, "finished must have shape [batchSize, beamWidth]");
+    auto const batchSize = static_cast<SizeType>(shape.d[0]);
+    auto const beamWidth = static_cast<SizeType>(shape.d[1]);
+    TLLM_CHECK_WITH_INFO(finishedSum.getSize() == static_cast<std::size_t>(batchSize),
+        common::fmtstr("finishedSum size (%ld) has to be the batch size (%d)", finishedSum.getSize(), batchSize));
+    if (batchSize == 0)
+    {
+        return;
+    }
+
+    auto finishedSumPtr = bufferCast<SizeType>(finishedSum);
+    auto finishedPtr = reinterpret_cast<FinishedState const*>(bufferCast<FinishedState::UnderlyingType>(finished));
+
+    dim3 const blockSize{256};
+    dim3 const gridSize{static_cast<std::uint32_t>(tc::ceilDiv(batchSize, blockSize.x))};
+
+    countFinished<<<gridSize, blockSize, 0, stream.get()>>>(finishedSumPtr, finishedPtr, batchSize, beamWidth);
+}
+
 namespace
 {
 __global__ void transpose(SizeType* output, SizeType const* input, SizeType const batchSize, SizeType const rowSize)
@@ -417,6 +520,21 @@ void invokeInclusiveSum(IBuffer& output, IBuffer const& input, BufferManager con
     cub::DeviceScan::InclusiveSum(tempStorageData, tempStorageBytes, inputData, outputData, size, stream.get());
 }
 
+void invokeInclusiveSum(IBuffer& output, IBuffer const& input, ScratchArena& scratch)
+{
+    auto const size = input.getSize();
+    auto const* inputData = bufferCast<SizeType>(input);
+    auto* outputData = bufferCast<SizeType>(output);
+    auto const& stream = scratch.getBufferManager().getStream();
+
+    std::size_t tempStorageBytes{0};
+    cub::DeviceScan::InclusiveSum(nullptr, tempStorageBytes, inputData, outputData, size, stream.get());
+    ScratchArena::Frame const frame{scratch};
+    auto tempStorage = scratch.allocate(tempStorageBytes);
+    auto* tempStorageData = bufferCast<std::uint8_t>(*tempStorage);
+    cub::DeviceScan::InclusiveSum(tempStorageData, tempStorageBytes, inputData, outputData, size, stream.get());
+}
+
 namespace
 {
 __global__ void buildTokenMask(SizeType* tokenMask, SizeType const* inputLengths, SizeType const batchSize,
@@ -748,6 +866,52 @@ void invokeCopyPackedInputToOutput(ITensor& outputIds, ITensor const& inputIds,
         maxInputLength, maxSeqLength);
 }
 
+namespace
+{
+__global__ void copyInputToPacked(SizeType* packedIds, SizeType const* inputIds, SizeType const* inputOffsets,
+    SizeType const batchSize, SizeType const maxInputLength)
+{
+    SizeType const tidx = blockIdx.x * blockDim.x + threadIdx.x;
+    SizeType const tidy = blockIdx.y * blockDim.y + threadIdx.y;
+
+    for (SizeType batchIdx = tidy; batchIdx < batchSize; batchIdx += blockDim.y * gridDim.y)
+    {
+        auto const tokenBegin = inputOffsets[batchIdx];
+        auto const tokenEnd = inputOffsets[batchIdx + 1];
+        auto const inputLength = tokenEnd - tokenBegin;
+
+        for (SizeType tokenIdx = tidx; tokenIdx < inputLength; tokenIdx += blockDim.x * gridDim.x)
+        {
+            packedIds[tokenBegin + tokenIdx] = inputIds[batchIdx * maxInputLength + tokenIdx];
+        }
+    }
+}
+} // namespace
+
+void invokeCopyInputToPacked(
+    ITensor& packedIds, ITensor const& inputIds, ITensor const& inputOffsets, CudaStream const& stream)
+{
+    TLLM_CHECK_WITH_INFO(
+        inputIds.getDataType() == packedIds.getDataType(), "Input and output have different data types");
+
+    auto const& inputShape = inputIds.getShape();
+    TLLM_CHECK_WITH_INFO(
+        inputShape.nbDims == 2, common::fmtstr("Input shape must have 2 dimensions, but has %d", inputShape.nbDims));
+
+    auto const batchSize = static_cast<SizeType>(inputOffsets.getSize()) - 1;
+    SizeType const maxInputLength = inputShape.d[1];
+
+    TLLM_CHECK_WITH_INFO(batchSize == inputShape.d[0],
+        common::fmtstr(
+            "Input ids batch size (%d) does not match inputOffsets batch size (%d)", inputShape.d[0], batchSize));
+
+    dim3 const blockSize(256, 1);
+    dim3 const gridSize((maxInputLength + blockSize.x - 1) / blockSize.x, batchSize);
+
+    copyInputToPacked<<<gridSize, blockSize, 0, stream.get()>>>(bufferCast<SizeType>(packedIds),
+        bufferCast<SizeType const>(inputIds), bufferCast<SizeType const>(inputOffsets), batchSize, maxInputLength);
+}
+
 void initOutputIds(ITensor& outputIds, ITensor const& inputIds, ITensor const& inputLengths,
     ITensor const& inputOffsets, TokenIdType const padId, TokenIdType const endId, SizeType const maxInputLength,
     bool const inputPacked, CudaStream const& stream)
@@ -1111,4 +1275,232 @@ void mergeLogitsFragments(BufferManager const& bufferManager, ITensor& output, s
     }
 }
 
+namespace
+{
+
+struct TopLogProbCandidate
+{
+    float value;
+    SizeType id; // -1 if no candidate
+};
+
+// Orders the candidates by decreasing value, then by increasing id so that they are all distinct.
+__device__ __forceinline__ bool isBefore(TopLogProbCandidate const& a, TopLogProbCandidate const& b)
+{
+    if (b.id < 0)
+    {
+        return a.id >= 0;
+    }
+    return a.id >= 0 && (a.value > b.value || (a.value == b.value && a.id < b.id));
+}
+
+struct TopLogProbFirst
+{
+    __device__ __forceinline__ TopLogProbCandidate operator()(
+        TopLogProbCandidate const& a, TopLogProbCandidate const& b) const
+    {
+        return isBefore(b, a) ? b : a;
+    }
+};
+
+// In the following kernel, we launch a grid with batchSize * beamWidth blocks of threads. Each thread block selects
+// the top tokens of a row of logits with one pass over the vocabulary per token, which only reads the logits.
+template <typename T, int BLOCK_SIZE>
+__global__ void gatherTopLogProbsKernel(SizeType* topLogProbIds, float* topLogProbs, T const* logits, SizeType step,
+    SizeType maxNewTokens, SizeType numTopLogProbs, SizeType vocabSize, SizeType vocabSizePadded)
+{
+    using BlockReduceCandidate = cub::BlockReduce<TopLogProbCandidate, BLOCK_SIZE>;
+    using BlockReduceFloat = cub::BlockReduce<float, BLOCK_SIZE>;
+    __shared__ union
+    {
+        typename BlockReduceCandidate::TempStorage candidate;
+        typename BlockReduceFloat::TempStorage sum;
+    } tempStorage;
+    __shared__ TopLogProbCandidate selected;
+    __shared__ float logSumExp;
+
+    auto const row = static_cast<std::size_t>(blockIdx.x);
+    T const* rowLogits = logits + row * vocabSizePadded;
+    auto const outputOffset = (row * maxNewTokens + step) * numTopLogProbs;
+
+    TopLogProbCandidate previous{0.f, -1};
+    for (SizeType k = 0; k < numTopLogProbs; ++k)
+    {
+        TopLogProbCandidate best{0.f, -1};
+        for (SizeType id = threadIdx.x; id < vocabSize; id += BLOCK_SIZE)
+        {
+            TopLogProbCandidate const candidate{static_cast<float>(rowLogits[id]), id};
+            if ((k == 0 || isBefore(previous, candidate)) && isBefore(candidate, best))
+            {
+                best = candidate;
+            }
+        }
+        best = BlockReduceCandidate(tempStorage.candidate).Reduce(best, TopLogProbFirst{});
+        if (threadIdx.x == 0)
+        {
+            selected = best;
+        }
+        __syncthreads();
+        previous = selected;
+
+        if (k == 0)
+        {
+            // The first token has the largest logit
+            float sum = 0.f;
+            for (SizeType id = threadIdx.x; id < vocabSize; id += BLOCK_SIZE)
+            {
+                sum += __expf(static_cast<float>(rowLogits[id]) - previous.value);
+            }
+            sum = BlockReduceFloat(tempStorage.sum).Sum(sum);
+            if (threadIdx.x == 0)
+            {
+                logSumExp = previous.value + __logf(sum);
+            }
+            __syncthreads();
+        }
+
+        if (threadIdx.x == 0)
+        {
+            topLogProbIds[outputOffset + k] = previous.id;
+            topLogProbs[outputOffset + k] = previous.id < 0 ? -FLT_MAX : previous.value - logSumExp;
+        }
+    }
+}
+
+template <typename T>
+void invokeGatherTopLogProbs(ITensor& topLogProbIds, ITensor& topLogProbs, ITensor const& logits, SizeType step,
+    SizeType vocabSize, CudaStream const& stream)
+{
+    auto const& outputShape = topLogProbs.getShape();
+    TLLM_CHECK_WITH_INFO(outputShape.nbDims == 4, "Invalid top log probs shape, expected 4 dimensions");
+    TLLM_CHECK_WITH_INFO(
+        topLogProbIds.getSize() == topLogProbs.getSize(), "The top log prob ids and values sizes differ");
+    auto const numRows = static_cast<SizeType>(outputShape.d[0] * outputShape.d[1]);
+    auto const maxNewTokens = static_cast<SizeType>(outputShape.d[2]);
+    auto const numTopLogProbs = static_cast<SizeType>(outputShape.d[3]);
+    TLLM_CHECK_WITH_INFO(0 <= step && step < maxNewTokens, "Invalid step %d", step);
+
+    auto const& logitsShape = logits.getShape();
+    auto const vocabSizePadded = static_cast<SizeType>(logitsShape.d[logitsShape.nbDims - 1]);
+    TLLM_CHECK_WITH_INFO(static_cast<SizeType>(logits.getSize() / vocabSizePadded) == numRows,
+        "The logits and the top log probs have different numbers of rows");
+    TLLM_CHECK_WITH_INFO(vocabSize <= vocabSizePadded, "Invalid vocab size %d", vocabSize);
+
+    constexpr int kBlockSize = 256;
+    gatherTopLogProbsKernel<T, kBlockSize><<<numRows, kBlockSize, 0, stream.get()>>>(
+        bufferCast<SizeType>(topLogProbIds), bufferCast<float>(topLogProbs), bufferCast<T>(logits), step, maxNewTokens,
+        numTopLogProbs, vocabSize, vocabSizePadded);
+}
+
+} // namespace
+
+void gatherTopLogProbs(ITensor& topLogProbIds, ITensor& topLogProbs, ITensor const& logits, SizeType step,
+    SizeType vocabSize, CudaStream const& stream)
+{
+    switch (logits.getDataType())
+    {
+    case nvinfer1::DataType::kFLOAT:
+        invokeGatherTopLogProbs<float>(topLogProbIds, topLogProbs, logits, step, vocabSize, stream);
+        break;
+    case nvinfer1::DataType::kHALF:
+        invokeGatherTopLogProbs<half>(topLogProbIds, topLogProbs, logits, step, vocabSize, stream);
+        break;
+    case nvinfer1::DataType::kBF16:
+        invokeGatherTopLogProbs<__nv_bfloat16>(topLogProbIds, topLogProbs, logits, step, vocabSize, stream);
+        break;
+    default: TLLM_CHECK_WITH_INFO(false, "data type not supported");
+    }
+}
+
+namespace
+{
+
+// In the following kernel, we launch a grid with batchSize x ceilDiv(hiddenSize, BLOCK_SIZE) blocks of threads. Each
+// thread pools one column of the hidden states of a sequence. maxInputLength is 0 for packed hidden states, the first
+// token of a sequence then follows the tokens of the sequences before it.
+template <typename T, int BLOCK_SIZE>
+__global__ void poolHiddenStatesKernel(float* embeddings, T const* hiddenStates, SizeType const* contextLengths,
+    SizeType hiddenSize, SizeType maxInputLength, bool meanPooling)
+{
+    auto const batchIdx = static_cast<SizeType>(blockIdx.x);
+    auto const column = static_cast<SizeType>(blockIdx.y * BLOCK_SIZE + threadIdx.x);
+    if (column >= hiddenSize)
+    {
+        return;
+    }
+
+    std::size_t firstToken = 0;
+    if (maxInputLength > 0)
+    {
+        firstToken = static_cast<std::size_t>(batchIdx) * maxInputLength;
+    }
+    else
+    {
+        for (SizeType bi = 0; bi < batchIdx; ++bi)
+        {
+            firstToken += contextLengths[bi];
+        }
+    }
+    auto const length = contextLengths[batchIdx];
+    T const* sequence = hiddenStates + firstToken * hiddenSize + column;
+
+    float embedding = 0.f;
+    if (meanPooling)
+    {
+        for (SizeType ti = 0; ti < length; ++ti)
+        {
+            embedding += static_cast<float>(sequence[static_cast<std::size_t>(ti) * hiddenSize]);
+        }
+        embedding = length > 0 ? embedding / static_cast<float>(length) : 0.f;
+    }
+    else if (length > 0)
+    {
+        embedding = static_cast<float>(sequence[static_cast<std::size_t>(length - 1) * hiddenSize]);
+    }
+    embeddings[static_cast<std::size_t>(batchIdx) * hiddenSize + column] = embedding;
+}
+
+template <typename T>
+void invokePoolHiddenStates(ITensor& embeddings, ITensor const& hiddenStates, ITensor const& contextLengths,
+    bool meanPooling, CudaStream const& stream)
+{
+    auto const& hiddenStatesShape = hiddenStates.getShape();
+    TLLM_CHECK_WITH_INFO(hiddenStatesShape.nbDims == 2 || hiddenStatesShape.nbDims == 3,
+        "Invalid hidden states shape, expected 2 or 3 dimensions");
+    auto const batchSize = static_cast<SizeType>(contextLengths.getSize());
+    auto const hiddenSize = static_cast<SizeType>(hiddenStatesShape.d[hiddenStatesShape.nbDims - 1]);
+    auto const maxInputLength = hiddenStatesShape.nbDims == 3 ? static_cast<SizeType>(hiddenStatesShape.d[1]) : 0;
+    TLLM_CHECK_WITH_INFO(hiddenStatesShape.nbDims == 2 || hiddenStatesShape.d[0] == batchSize,
+        "The hidden states and the context lengths have different batch sizes");
+    TLLM_CHECK_WITH_INFO(embeddings.getDataType() == nvinfer1::DataType::kFLOAT, "Embeddings must be of type float");
+    TLLM_CHECK_WITH_INFO(embeddings.getSize() == static_cast<std::size_t>(batchSize) * hiddenSize,
+        "Invalid embeddings size, expected [batchSize, hiddenSize]");
+
+    constexpr int kBlockSize = 256;
+    dim3 const grid{
+        static_cast<std::uint32_t>(batchSize), static_cast<std::uint32_t>(tc::ceilDiv(hiddenSize, kBlockSize))};
+    poolHiddenStatesKernel<T, kBlockSize><<<grid, kBlockSize, 0, stream.get()>>>(bufferCast<float>(embeddings),
+        bufferCast<T>(hiddenStates), bufferCast<SizeType>(contextLengths), hiddenSize, maxInputLength, meanPooling);
+}
+
+} // namespace
+
+void poolHiddenStates(ITensor& embeddings, ITensor const& hiddenStates, ITensor const& contextLengths, bool meanPooling,
+    CudaStream const& stream)
+{
+    switch (hiddenStates.getDataType())
+    {
+    case nvinfer1::DataType::kFLOAT:
+        invokePoolHiddenStates<float>(embeddings, hiddenStates, contextLengths, meanPooling, stream);
+        break;
+    case nvinfer1::DataType::kHALF:
+        invokePoolHiddenStates<half>(embeddings, hiddenStates, contextLengths, meanPooling, stream);
+        break;
+    case nvinfer1::DataType::kBF16:
+        invokePoolHiddenStates<__nv_bfloat16>(embeddings, hiddenStates, contextLengths, meanPooling, stream);
+        break;
+    default: TLLM_CHECK_WITH_INFO(false, "data type not supported");
+    }
+}
+
 } // namespace tensorrt_llm::runtime::kernels
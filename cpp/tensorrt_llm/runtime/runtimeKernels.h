@@ -20,6 +20,7 @@
 #include "tensorrt_llm/runtime/common.h"
 #include "tensorrt_llm/runtime/cudaStream.h"
 #include "tensorrt_llm/runtime/iTensor.h"
+#include "tensorrt_llm/runtime/scratchArena.h"
 
 namespace tensorrt_llm::runtime::kernels
 {
@@ -36,11 +37,20 @@ void invokeFillBatch(
 void invokeCopyBatch(IBuffer const& srcBuffer, IBuffer& dstBuffer, IBuffer const& srcOffsets, IBuffer const& dstOffsets,
     IBuffer const& sizes, std::size_t maxStride, CudaStream const& stream);
 
+//! \brief Copies the blocks srcBlockIds[i] of a KV cache pool to the blocks dstBlockIds[i] in one launch, e.g. to fork
+//! copy-on-write blocks shared by beams. Each block is a row of blockStride elements of pool.
+void invokeCopyBlocks(IBuffer& pool, IBuffer const& srcBlockIds, IBuffer const& dstBlockIds, std::size_t blockStride,
+    CudaStream const& stream);
+
 template <typename T>
 void invokeAdd(IBuffer& buffer, T value, CudaStream const& stream);
 
 void reduce(IBuffer& output, IBuffer const& input, CudaStream const& stream);
 
+//! \brief Sets finishedSum[bi] to the number of finished beams of request bi.
+//! \param finished [batchSize, beamWidth] finished states
+void countFinished(IBuffer& finishedSum, ITensor const& finished, CudaStream const& stream);
+
 void invokeTranspose(ITensor& output, ITensor const& input, CudaStream const& stream);
 
 void invokeTransposeWithOutputOffset(
@@ -51,6 +61,9 @@ void invokeTransposeWithInputOffset(
 
 void invokeInclusiveSum(IBuffer& output, IBuffer const& input, BufferManager const& manager, CudaStream const& stream);
 
+//! \brief Allocates the temporary storage in `scratch` and runs on its stream.
+void invokeInclusiveSum(IBuffer& output, IBuffer const& input, ScratchArena& scratch);
+
 void invokeBuildTokenMask(
     ITensor& tokenMask, ITensor const& inputLengths, SizeType maxInputLength, CudaStream const& stream);
 
@@ -70,6 +83,9 @@ void invokeCopyInputToOutput(
 void invokeCopyPackedInputToOutput(ITensor& outputIds, ITensor const& inputIds, ITensor const& inputOffsets,
     SizeType maxInputLength, SizeType padId, CudaStream const& stream);
 
+void invokeCopyInputToPacked(
+    ITensor& packedIds, ITensor const& inputIds, ITensor const& inputOffsets, CudaStream const& stream);
+
 void initOutputIds(ITensor& outputIds, ITensor const& inputIds, ITensor const& inputLengths,
     ITensor const& inputOffsets, TokenIdType padId, TokenIdType endId, SizeType maxInputLength, bool inputPacked,
     CudaStream const& stream);
@@ -90,4 +106,18 @@ void mergeLogitsFragments(BufferManager const& bufferManager, ITensor& output, s
     ITensor& cachePointerDevice, ITensor& cachePointerHost, SizeType firstBatchSlotIdx, SizeType const microBatchSize,
     SizeType const beamWidth, CudaStream const& stream, int stepOffset);
 
+//! \brief Writes the numTopLogProbs most likely tokens of the logits [batchSize, beamWidth, vocabSizePadded] and their
+//! log-probabilities into topLogProbIds and topLogProbs [batchSize, beamWidth, maxNewTokens, numTopLogProbs] at step.
+//! Only the first vocabSize logits are considered. The log-softmax is computed on the device, so that only the top
+//! tokens need to be copied to the host.
+void gatherTopLogProbs(ITensor& topLogProbIds, ITensor& topLogProbs, ITensor const& logits, SizeType step,
+    SizeType vocabSize, CudaStream const& stream);
+
+//! \brief Pools the hidden states of each sequence into embeddings [batchSize, hiddenSize] of type float. The hidden
+//! states are packed [numTokens, hiddenSize] or padded [batchSize, maxInputLength, hiddenSize], contextLengths
+//! [batchSize] gives the number of tokens of each sequence. The embedding is the hidden state of the last token, or the
+//! mean of the hidden states of all the tokens if meanPooling.
+void poolHiddenStates(ITensor& embeddings, ITensor const& hiddenStates, ITensor const& contextLengths, bool meanPooling,
+    CudaStream const& stream);
+
 } // namespace tensorrt_llm::runtime::kernels
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/scratchArena.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+
+#include <algorithm>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+std::size_t align(std::size_t size)
+{
+    return (size + ScratchArena::kAlignment - 1) / ScratchArena::kAlignment * ScratchArena::kAlignment;
+}
+} // namespace
+
+ScratchArena::ScratchArena(BufferManager manager, std::size_t size)
+    : mManager{std::move(manager)}
+    , mBuffer{mManager.gpu(align(size))}
+{
+}
+
+ScratchArena::Frame::Frame(ScratchArena& arena)
+    : mArena{arena}
+    , mOffset{arena.mOffset}
+    , mOverflowsBegin{arena.mOverflows.size()}
+{
+    mArena.begin();
+}
+
+ScratchArena::Frame::~Frame()
+{
+    mArena.end(mOffset, mOverflowsBegin);
+}
+
+std::size_t ScratchArena::getCapacity() const
+{
+    return mBuffer->getSizeInBytes();
+}
+
+ScratchArena::TensorPtr ScratchArena::allocate(ITensor::Shape const& dims, nvinfer1::DataType type)
+{
+    TLLM_CHECK_WITH_INFO(mDepth > 0, "Temporaries must be allocated in a frame");
+    auto const capacity = ITensor::volumeNonNegative(dims);
+    auto const sizeInBytes = align(capacity * BufferDataType(type).getSize());
+
+    TensorPtr tensor;
+    if (mOffset + sizeInBytes <= getCapacity())
+    {
+        auto* data = static_cast<std::uint8_t*>(mBuffer->data()) + mOffset;
+        tensor = ITensor::wrap(data, type, dims, capacity);
+        mOffset += sizeInBytes;
+    }
+    else
+    {
+        // The addresses would change when the arena grows
+        TLLM_CHECK_WITH_INFO(!isCapturing(),
+            "Scratch arena of %zu bytes is full during a stream capture, %zu bytes are needed", getCapacity(),
+            mOffset + mOverflowSize + sizeInBytes);
+        tensor = mManager.gpu(dims, type);
+        mOverflows.push_back(tensor);
+        mOverflowSize += sizeInBytes;
+        ++mNbOverflows;
+    }
+    mPeak = std::max(mPeak, getUsed());
+    return tensor;
+}
+
+void ScratchArena::begin()
+{
+    if (mDepth++ == 0 && mPeak > getCapacity() && !isCapturing())
+    {
+        // The memory is freed in stream order, after the temporaries of the previous frames are used
+        mBuffer.reset();
+        mBuffer = mManager.gpu(mPeak);
+    }
+}
+
+void ScratchArena::end(std::size_t offset, std::size_t overflowsBegin)
+{
+    TLLM_CHECK(mDepth > 0);
+    --mDepth;
+    mOffset = offset;
+    for (auto it = mOverflows.begin() + static_cast<std::ptrdiff_t>(overflowsBegin); it != mOverflows.end(); ++it)
+    {
+        mOverflowSize -= align((*it)->getSizeInBytes());
+    }
+    mOverflows.resize(overflowsBegin);
+}
+
+bool ScratchArena::isCapturing() const
+{
+    cudaStreamCaptureStatus captureStatus;
+    TLLM_CUDA_CHECK(cudaStreamIsCapturing(mManager.getStream().get(), &captureStatus));
+    return captureStatus != cudaStreamCaptureStatusNone;
+}
+
+} // namespace tensorrt_llm::runtime
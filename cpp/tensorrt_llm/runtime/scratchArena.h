@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief Preallocated GPU memory for the temporaries of a step, allocated with a bump pointer on the stream of the
+//! buffer manager.
+//!
+//! The temporaries are allocated in a `Frame` and released together when it ends. They are only used by the work
+//! enqueued on the stream of the arena, so their memory can be reused by the next frame without synchronization. The
+//! same sequence of allocations gets the same addresses at each step, which keeps them valid in a captured CUDA graph.
+//!
+//! When the arena is full, the temporary is allocated separately and the arena grows to the largest size used when the
+//! next outermost frame begins. A stream being captured cannot allocate, the arena must be large enough beforehand.
+class ScratchArena
+{
+public:
+    using TensorPtr = ITensor::SharedPtr;
+
+    //! \brief Alignment of the temporaries, in bytes.
+    static std::size_t constexpr kAlignment = 256;
+
+    explicit ScratchArena(BufferManager manager, std::size_t size = 0);
+
+    ScratchArena(ScratchArena const&) = delete;
+    ScratchArena& operator=(ScratchArena const&) = delete;
+
+    //! \brief Releases the temporaries allocated during its lifetime. Frames are nested.
+    class Frame
+    {
+    public:
+        explicit Frame(ScratchArena& arena);
+
+        ~Frame();
+
+        Frame(Frame const&) = delete;
+        Frame& operator=(Frame const&) = delete;
+
+    private:
+        ScratchArena& mArena;
+        std::size_t mOffset;
+        std::size_t mOverflowsBegin;
+    };
+
+    //! \brief Allocates a temporary, valid until the end of the current frame.
+    [[nodiscard]] TensorPtr allocate(ITensor::Shape const& dims, nvinfer1::DataType type);
+
+    [[nodiscard]] TensorPtr allocate(std::size_t size, nvinfer1::DataType type = BufferManager::kBYTE_TYPE)
+    {
+        return allocate(ITensor::makeShape({static_cast<SizeType>(size)}), type);
+    }
+
+    [[nodiscard]] BufferManager const& getBufferManager() const
+    {
+        return mManager;
+    }
+
+    //! \brief Size of the arena, in bytes.
+    [[nodiscard]] std::size_t getCapacity() const;
+
+    //! \brief Size of the temporaries of the current frames, in bytes.
+    [[nodiscard]] std::size_t getUsed() const
+    {
+        return mOffset + mOverflowSize;
+    }
+
+    //! \brief Largest size used by the temporaries, in bytes.
+    [[nodiscard]] std::size_t getPeak() const
+    {
+        return mPeak;
+    }
+
+    //! \brief Number of temporaries allocated separately because the arena was full.
+    [[nodiscard]] std::size_t getNbOverflows() const
+    {
+        return mNbOverflows;
+    }
+
+private:
+    void begin();
+
+    void end(std::size_t offset, std::size_t overflowsBegin);
+
+    [[nodiscard]] bool isCapturing() const;
+
+    BufferManager mManager;
+    BufferManager::IBufferPtr mBuffer;
+    std::size_t mOffset{0};
+    std::size_t mPeak{0};
+    std::size_t mDepth{0};
+    std::vector<IBuffer::SharedPtr> mOverflows;
+    std::size_t mOverflowSize{0};
+    std::size_t mNbOverflows{0};
+};
+
+} // namespace tensorrt_llm::runtime
@@ -22,6 +22,7 @@
 #include "tensorrt_llm/common/memoryUtils.h"
 #include "tensorrt_llm/kernels/decodingCommon.h"
 #include "tensorrt_llm/runtime/runtimeKernels.h"
+#include "tensorrt_llm/runtime/tensorSpan.h"
 
 namespace tc = tensorrt_llm::common;
 namespace tk = tensorrt_llm::kernels;
@@ -127,6 +128,12 @@ void StatefulGptDecoder::reshapeBuffers(
 
 void StatefulGptDecoder::newBatch(
     GenerationInput const& inputs, GenerationOutput const& outputs, SamplingConfig const& samplingConfig)
+{
+    newBatch(inputs, outputs, samplingConfig, TruncationConfig{});
+}
+
+void StatefulGptDecoder::newBatch(GenerationInput const& inputs, GenerationOutput const& outputs,
+    SamplingConfig const& samplingConfig, TruncationConfig const& truncationConfig)
 {
     TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
     auto& manager = mBufferManager;
@@ -138,7 +145,7 @@ void StatefulGptDecoder::newBatch(
     auto const beamWidth = samplingConfig.beamWidth;
 
     reshapeBuffers(batchSize, beamWidth, mMaxAttentionWindow, mMaxSequenceLength);
-    mDecoder->setup(samplingConfig, batchSize, mMaxSequenceLength);
+    IGptDecoder::setupTruncated(*mDecoder, samplingConfig, truncationConfig, batchSize, mMaxSequenceLength);
 
     // sanity checks, should always be true after reshape
     auto const& outputIdsShape = mDecodingOutput->ids->getShape();
@@ -152,12 +159,26 @@ void StatefulGptDecoder::newBatch(
     auto const* inputLengthsData = bufferCast<SizeType>(*inputLengthsHost);
     SizeType const maxInputLength = *std::max_element(inputLengthsData, inputLengthsData + inputLengths->getSize());
 
+    std::optional<ScratchArena::Frame> scratchFrame;
     TensorPtr inputOffsets = manager.emptyTensor(MemoryType::kGPU, TRTDataType<SizeType>::value);
     if (inputs.packed)
     {
-        inputOffsets->reshape(ITensor::makeShape({batchSize + 1}));
-        manager.setZero(*inputOffsets);
-        kernels::invokeInclusiveSum(*ITensor::slice(inputOffsets, 1), *inputLengths, manager, *stream);
+        auto const inputOffsetsShape = ITensor::makeShape({batchSize + 1});
+        if (mScratch)
+        {
+            scratchFrame.emplace(*mScratch);
+            inputOffsets = mScratch->allocate(inputOffsetsShape, TRTDataType<SizeType>::value);
+            manager.setZero(*inputOffsets);
+            TensorSpan inputOffsetsEnd(*inputOffsets, 1);
+            kernels::invokeInclusiveSum(inputOffsetsEnd, *inputLengths, *mScratch);
+        }
+        else
+        {
+            inputOffsets->reshape(inputOffsetsShape);
+            manager.setZero(*inputOffsets);
+            TensorSpan inputOffsetsEnd(*inputOffsets, 1);
+            kernels::invokeInclusiveSum(inputOffsetsEnd, *inputLengths, manager, *stream);
+        }
     }
 
     TLLM_CHECK(inputIds->getDataType() == TRTDataType<TokenIdType>::value);
@@ -258,6 +279,7 @@ void StatefulGptDecoder::forwardAsync(decoder::Output& output, decoder::Input co
     auto& dInput = *mDecodingInput;
     auto& dOutput = *mDecodingOutput;
     dInput.logits = logits;
+    dInput.logitsBitmask = input.logitsBitmask;
     if (srcCacheIndirection && tgtCacheIndirection)
     {
         dInput.cacheIndirection = srcCacheIndirection;
@@ -285,7 +307,17 @@ void StatefulGptDecoder::finalize() const
     // TODO (rkobus) can we do this inplace?
     TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
     auto& outputIds = mDecodingOutput->ids;
-    auto finalOutputIds = mBufferManager.gpu(outputIds->getShape(), outputIds->getDataType());
+    std::optional<ScratchArena::Frame> scratchFrame;
+    TensorPtr finalOutputIds;
+    if (mScratch)
+    {
+        scratchFrame.emplace(*mScratch);
+        finalOutputIds = mScratch->allocate(outputIds->getShape(), outputIds->getDataType());
+    }
+    else
+    {
+        finalOutputIds = mBufferManager.gpu(outputIds->getShape(), outputIds->getDataType());
+    }
     mDecoder->gatherTree(*finalOutputIds, *mDecodingOutput, *mDecodingInput, mBufferManager);
     mBufferManager.copy(*finalOutputIds, *outputIds);
     TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
@@ -22,6 +22,8 @@
 #include "tensorrt_llm/runtime/gptDecoder.h"
 #include "tensorrt_llm/runtime/iStatefulGptDecoder.h"
 #include "tensorrt_llm/runtime/iTensor.h"
+#include "tensorrt_llm/runtime/scratchArena.h"
+#include "tensorrt_llm/runtime/truncationConfig.h"
 
 #include <cstdint>
 #include <memory>
@@ -46,6 +48,10 @@ public:
     void newBatch(
         GenerationInput const& input, GenerationOutput const& output, SamplingConfig const& samplingConfig) override;
 
+    //! @brief Like `newBatch`, the requests also sample with the min-p and typical-p of `truncationConfig`.
+    void newBatch(GenerationInput const& input, GenerationOutput const& output, SamplingConfig const& samplingConfig,
+        TruncationConfig const& truncationConfig);
+
     void forwardAsync(decoder::Output& output, decoder::Input const& input) override;
 
     void forwardSync() override;
@@ -97,6 +103,12 @@ public:
         return mDecodingOutput->finishedSum;
     }
 
+    //! @brief Allocate the temporaries of newBatch and finalize in `scratch`, which must use the stream of the decoder.
+    void setScratchArena(std::shared_ptr<ScratchArena> scratch)
+    {
+        mScratch = std::move(scratch);
+    }
+
 private:
     void reshapeBuffers(
         SizeType batchSize, SizeType beamWidth, SizeType mMaxAttentionWindow, SizeType maxSequenceLength);
@@ -114,6 +126,7 @@ private:
     using DecodingOutputPtr = std::unique_ptr<DecodingOutput>;
     DecodingOutputPtr mDecodingOutput;
     CudaEvent mDecodedEvent{};
+    std::shared_ptr<ScratchArena> mScratch;
 
     SizeType mNbSteps;
     SizeType mMaxSequenceLength{};
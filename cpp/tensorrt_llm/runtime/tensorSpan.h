@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+
+#include <stdexcept>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief Non-owning view on a tensor, for the slices and views used during a single call on the hot paths.
+//!
+//! Unlike `ITensor::slice` and `ITensor::view`, it lives on the stack and does not copy the shared pointer of the
+//! tensor, so it neither allocates nor changes the reference count. The tensor must outlive it. Use `ITensor::slice`
+//! and `ITensor::view` for the views that are stored.
+class TensorSpan : virtual public ITensor
+{
+public:
+    //! \brief Slice of `size` elements of dimension 0 of `tensor`, from `offset`.
+    TensorSpan(ITensor& tensor, std::size_t offset, std::size_t size)
+        : mTensor{tensor}
+        , mDims{tensor.getShape()}
+    {
+        auto const dim0 = static_cast<std::size_t>((mDims.nbDims > 0 && mDims.d[0] >= 0) ? mDims.d[0] : 0);
+        if (offset > dim0 || size > dim0 - offset)
+        {
+            throw std::out_of_range("slice exceeds dimension 0");
+        }
+        auto const sizeDim0 = dim0 > 0 ? ITensor::volume(mDims) / dim0 : 0;
+        mOffset = offset * sizeDim0;
+        mDims.d[0] = static_cast<DimType>(size);
+        mSize = size * sizeDim0;
+    }
+
+    //! \brief Slice of dimension 0 of `tensor`, from `offset` to the end.
+    TensorSpan(ITensor& tensor, std::size_t offset)
+        : TensorSpan{tensor, offset, static_cast<std::size_t>(tensor.getShape().d[0]) - offset}
+    {
+    }
+
+    //! \brief View on `tensor` with another shape, which must fit its capacity.
+    TensorSpan(ITensor& tensor, Shape const& dims)
+        : mTensor{tensor}
+        , mOffset{0}
+    {
+        reshape(dims);
+    }
+
+    ~TensorSpan() override = default;
+
+    void* data() override
+    {
+        return mSize > 0 ? mTensor.data(mOffset) : nullptr;
+    }
+
+    [[nodiscard]] void const* data() const override
+    {
+        return mSize > 0 ? static_cast<ITensor const&>(mTensor).data(mOffset) : nullptr;
+    }
+
+    [[nodiscard]] std::size_t getSize() const override
+    {
+        return mSize;
+    }
+
+    [[nodiscard]] std::size_t getCapacity() const override
+    {
+        return mTensor.getCapacity() - mOffset;
+    }
+
+    [[nodiscard]] nvinfer1::DataType getDataType() const override
+    {
+        return mTensor.getDataType();
+    }
+
+    [[nodiscard]] MemoryType getMemoryType() const override
+    {
+        return mTensor.getMemoryType();
+    }
+
+    [[nodiscard]] Shape const& getShape() const override
+    {
+        return mDims;
+    }
+
+    void reshape(Shape const& dims) override
+    {
+        auto const newSize = ITensor::volumeNonNegative(dims);
+        TLLM_CHECK(newSize <= getCapacity());
+        mDims = dims;
+        mSize = newSize;
+    }
+
+    void resize(std::size_t newSize) override
+    {
+        ITensor::resize(newSize);
+    }
+
+    void release() override
+    {
+        mDims.nbDims = 0;
+        mSize = 0;
+    }
+
+private:
+    ITensor& mTensor;
+    Shape mDims{};
+    std::size_t mOffset{0};
+    std::size_t mSize{0};
+};
+
+} // namespace tensorrt_llm::runtime
@@ -22,8 +22,10 @@
 #include "tensorrt_llm/runtime/common.h"
 #include "tensorrt_llm/runtime/cudaStream.h"
 #include "tensorrt_llm/runtime/iBuffer.h"
+#include "tensorrt_llm/runtime/iGpuAllocator.h"
 #include "tensorrt_llm/runtime/iTensor.h"
 #include "tensorrt_llm/runtime/memoryCounters.h"
+#include "tensorrt_llm/runtime/pinnedPool.h"
 
 #include <NvInferRuntime.h>
 #include <cuda_runtime_api.h>
@@ -49,7 +51,7 @@ public:
     {
         PointerType ptr{};
         static_cast<TDerived*>(this)->allocateImpl(&ptr, n);
-        MemoryCounters::getInstance().allocate<memoryType>(n);
+        MemoryCounters::getInstance().allocate<memoryType>(n, mTag);
         return ptr;
     }
 
@@ -58,7 +60,7 @@ public:
         if (ptr)
         {
             static_cast<TDerived*>(this)->deallocateImpl(ptr, n);
-            MemoryCounters::getInstance().deallocate<memoryType>(n);
+            MemoryCounters::getInstance().deallocate<memoryType>(n, mTag);
         }
     }
 
@@ -66,6 +68,15 @@ public:
     {
         return memoryType;
     }
+
+    [[nodiscard]] MemoryTag getMemoryTag() const
+    {
+        return mTag;
+    }
+
+private:
+    // The buffer keeps its owner when it is resized
+    MemoryTag mTag{MemoryCounters::getCurrentTag()};
 };
 
 class CudaAllocator : public BaseAllocator<CudaAllocator, MemoryType::kGPU>
@@ -95,8 +106,16 @@ class CudaAllocatorAsync : public BaseAllocator<CudaAllocatorAsync, MemoryType::
 public:
     using CudaStreamPtr = std::shared_ptr<CudaStream>;
 
-    explicit CudaAllocatorAsync(CudaStreamPtr stream)
+    using CudaMemPoolPtr = std::shared_ptr<std::remove_pointer_t<::cudaMemPool_t>>;
+
+    //! \param memPool The pool to allocate from, the default pool of the device if null. The allocations share its
+    //! ownership, it is destroyed after the last one is freed.
+    //! \param gpuAllocator An external allocator used instead of the pools if not null, also shared by the allocations.
+    explicit CudaAllocatorAsync(
+        CudaStreamPtr stream, CudaMemPoolPtr memPool = nullptr, IGpuAllocator::SharedPtr gpuAllocator = nullptr)
         : mCudaStream(std::move(stream))
+        , mMemPool(std::move(memPool))
+        , mGpuAllocator(std::move(gpuAllocator))
     {
         TLLM_CHECK_WITH_INFO(static_cast<bool>(mCudaStream), "Undefined CUDA stream");
     }
@@ -109,16 +128,36 @@ public:
 protected:
     void allocateImpl(PointerType* ptr, SizeType n)
     {
-        TLLM_CUDA_CHECK(::cudaMallocAsync(ptr, n, mCudaStream->get()));
+        if (mGpuAllocator)
+        {
+            *ptr = mGpuAllocator->allocate(n, mCudaStream->get());
+        }
+        else if (mMemPool)
+        {
+            TLLM_CUDA_CHECK(::cudaMallocFromPoolAsync(ptr, n, mMemPool.get(), mCudaStream->get()));
+        }
+        else
+        {
+            TLLM_CUDA_CHECK(::cudaMallocAsync(ptr, n, mCudaStream->get()));
+        }
     }
 
-    void deallocateImpl(PointerType ptr, [[gnu::unused]] SizeType n)
+    void deallocateImpl(PointerType ptr, SizeType n)
     {
-        TLLM_CUDA_CHECK(::cudaFreeAsync(ptr, mCudaStream->get()));
+        if (mGpuAllocator)
+        {
+            mGpuAllocator->deallocate(ptr, n, mCudaStream->get());
+        }
+        else
+        {
+            TLLM_CUDA_CHECK(::cudaFreeAsync(ptr, mCudaStream->get()));
+        }
     }
 
 private:
     CudaStreamPtr mCudaStream;
+    CudaMemPoolPtr mMemPool;
+    IGpuAllocator::SharedPtr mGpuAllocator;
 };
 
 class PinnedAllocator : public BaseAllocator<PinnedAllocator, MemoryType::kPINNED>
@@ -131,13 +170,13 @@ public:
 protected:
     void allocateImpl(PointerType* ptr, SizeType n) // NOLINT(readability-convert-member-functions-to-static)
     {
-        TLLM_CUDA_CHECK(::cudaHostAlloc(ptr, n, cudaHostAllocDefault));
+        *ptr = PinnedPool::getInstance().allocate(n);
     }
 
     void deallocateImpl( // NOLINT(readability-convert-member-functions-to-static)
-        PointerType ptr, [[gnu::unused]] SizeType n)
+        PointerType ptr, SizeType n)
     {
-        TLLM_CUDA_CHECK(::cudaFreeHost(ptr));
+        PinnedPool::getInstance().deallocate(ptr, n);
     }
 };
 
@@ -15,13 +15,23 @@
  */
 #include "tllmRuntime.h"
 #include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/envUtils.h"
 #include "tensorrt_llm/common/nvtxUtils.h"
 #include "tensorrt_llm/common/stringUtils.h"
+#include "tensorrt_llm/runtime/layerProfiler.h"
 #include "tllmBuffers.h"
 #include "tllmLogger.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
 #include <limits>
+#include <mutex>
+#include <numeric>
+#include <string>
 #include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 
 using namespace tensorrt_llm::runtime;
 
@@ -48,6 +58,11 @@ nvinfer1::Dims shapeToDims(std::vector<std::size_t> const& shape)
     return dims;
 }
 
+bool equalDims(nvinfer1::Dims const& lhs, nvinfer1::Dims const& rhs)
+{
+    return lhs.nbDims == rhs.nbDims && std::equal(lhs.d, lhs.d + lhs.nbDims, rhs.d);
+}
+
 std::vector<std::size_t> dimsToShape(nvinfer1::Dims const& dims)
 {
     TLLM_CHECK(dims.nbDims >= 0);
@@ -62,8 +77,84 @@ std::vector<std::size_t> dimsToShape(nvinfer1::Dims const& dims)
 
 tensorrt_llm::runtime::TllmLogger defaultLogger{};
 
+//! The impls of the live runtimes, keyed by their engine, which moves along with the runtime.
+template <typename Impl>
+class RuntimeImpls
+{
+public:
+    static RuntimeImpls& getInstance()
+    {
+        static RuntimeImpls instance;
+        return instance;
+    }
+
+    void add(nvinfer1::ICudaEngine const* engine, std::unique_ptr<Impl> impl)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mImpls[engine] = std::move(impl);
+    }
+
+    [[nodiscard]] Impl& get(nvinfer1::ICudaEngine const* engine)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return *mImpls.at(engine);
+    }
+
+    //! The impl is returned to be destroyed without the lock.
+    std::unique_ptr<Impl> remove(nvinfer1::ICudaEngine const* engine)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto const it = mImpls.find(engine);
+        auto impl = std::move(it->second);
+        mImpls.erase(it);
+        return impl;
+    }
+
+private:
+    std::mutex mMutex;
+    std::unordered_map<nvinfer1::ICudaEngine const*, std::unique_ptr<Impl>> mImpls;
+};
+
 } // namespace
 
+struct TllmRuntime::Impl
+{
+    //! @brief Properties of an engine IO tensor, queried once.
+    struct IOTensor
+    {
+        std::string name;
+        bool isInput;
+        bool isShapeInferenceIO;
+        nvinfer1::DataType dataType;
+        nvinfer1::Dims shape;
+        // [numProfiles], minimum and maximum shapes of inputs other than shape inference inputs
+        std::vector<std::pair<nvinfer1::Dims, nvinfer1::Dims>> profileShapes;
+    };
+
+    //! @brief Address and shape last set for an IO tensor of a context. Unchanged bindings are not set again.
+    struct Binding
+    {
+        void const* data{nullptr};
+        nvinfer1::Dims shape{-1, {}};
+    };
+
+    explicit Impl(nvinfer1::ILogger& logger)
+        : logger{logger}
+    {
+    }
+
+    nvinfer1::ILogger& logger;
+    // Activation memory of the contexts once shared with another runtime
+    IBuffer::SharedPtr sharedEngineBuffer;
+    // Counted as MemoryTag::kENGINE_WEIGHTS
+    std::size_t engineWeightsSize{0};
+    std::vector<IOTensor> ioTensors;
+    // [numContexts, numIOTensors]
+    std::vector<std::vector<Binding>> bindings;
+    // Null unless the layers are profiled
+    std::unique_ptr<LayerProfiler> layerProfiler;
+};
+
 TllmRuntime::TllmRuntime(void const* engineData, std::size_t engineSize, nvinfer1::ILogger& logger)
     : mStream(std::make_shared<CudaStream>())
     , mBufferManager{mStream}
@@ -71,8 +162,47 @@ TllmRuntime::TllmRuntime(void const* engineData, std::size_t engineSize, nvinfer
     , mEngine{mRuntime->deserializeCudaEngine(engineData, engineSize)}
 {
     TLLM_CHECK_WITH_INFO(mEngine != nullptr, "Failed to deserialize cuda engine");
+    RuntimeImpls<Impl>::getInstance().add(mEngine.get(), std::make_unique<Impl>(logger));
+    auto& impl = getImpl();
+    // The weights are allocated by TensorRT, the plan is mostly made of them
+    impl.engineWeightsSize = engineSize;
+    MemoryCounters::getInstance().allocate(MemoryType::kGPU, impl.engineWeightsSize, MemoryTag::kENGINE_WEIGHTS);
     auto const devMemorySize = mEngine->getDeviceMemorySize();
-    mEngineBuffer = mBufferManager.gpu(devMemorySize);
+    {
+        MemoryCounters::TagScope const tagScope{MemoryTag::kENGINE_WORKSPACE};
+        mEngineBuffer = mBufferManager.gpu(devMemorySize);
+    }
+
+    auto const nbIOTensors = mEngine->getNbIOTensors();
+    impl.ioTensors.reserve(nbIOTensors);
+    for (std::int32_t i = 0; i < nbIOTensors; ++i)
+    {
+        auto const* const name = mEngine->getIOTensorName(i);
+        auto& ioTensor = impl.ioTensors.emplace_back(
+            Impl::IOTensor{name, mEngine->getTensorIOMode(name) == nvinfer1::TensorIOMode::kINPUT,
+                mEngine->isShapeInferenceIO(name), mEngine->getTensorDataType(name), mEngine->getTensorShape(name)});
+        if (ioTensor.isInput && !ioTensor.isShapeInferenceIO)
+        {
+            auto const nbProfiles = mEngine->getNbOptimizationProfiles();
+            ioTensor.profileShapes.reserve(nbProfiles);
+            for (std::int32_t profile = 0; profile < nbProfiles; ++profile)
+            {
+                auto const minShape = mEngine->getProfileShape(name, profile, nvinfer1::OptProfileSelector::kMIN);
+                auto const maxShape = mEngine->getProfileShape(name, profile, nvinfer1::OptProfileSelector::kMAX);
+                // static inputs have no profile shapes
+                if (minShape.nbDims < 0 || maxShape.nbDims < 0)
+                {
+                    ioTensor.profileShapes.emplace_back(ioTensor.shape, ioTensor.shape);
+                }
+                else
+                {
+                    ioTensor.profileShapes.emplace_back(minShape, maxShape);
+                }
+            }
+        }
+    }
+
+    setLayerProfilingInterval(tc::getEnvLayerProfilingInterval());
 }
 
 TllmRuntime::TllmRuntime(void const* engineData, std::size_t engineSize)
@@ -80,16 +210,243 @@ TllmRuntime::TllmRuntime(void const* engineData, std::size_t engineSize)
 {
 }
 
+TllmRuntime::~TllmRuntime()
+{
+    // The contexts go before the activation memory they use, which the impl may hold
+    mContexts.clear();
+    auto const impl = RuntimeImpls<Impl>::getInstance().remove(mEngine.get());
+    MemoryCounters::getInstance().deallocate(MemoryType::kGPU, impl->engineWeightsSize, MemoryTag::kENGINE_WEIGHTS);
+}
+
+TllmRuntime::Impl& TllmRuntime::getImpl() const
+{
+    return RuntimeImpls<Impl>::getInstance().get(mEngine.get());
+}
+
+IBuffer& TllmRuntime::getEngineBuffer() const
+{
+    return mEngineBuffer ? *mEngineBuffer : *getImpl().sharedEngineBuffer;
+}
+
+std::size_t TllmRuntime::getEngineWorkspaceSize() const
+{
+    return getEngineBuffer().getSizeInBytes();
+}
+
 nvinfer1::IExecutionContext& TllmRuntime::addContext(std::int32_t profileIndex)
 {
     TLLM_CHECK(0 <= profileIndex && profileIndex < mEngine->getNbOptimizationProfiles());
     mContexts.emplace_back(mEngine->createExecutionContextWithoutDeviceMemory());
+    auto& impl = getImpl();
+    impl.bindings.emplace_back(impl.ioTensors.size());
     auto& context = *mContexts.back();
-    context.setDeviceMemory(mEngineBuffer->data());
+    context.setDeviceMemory(getEngineBuffer().data());
     context.setOptimizationProfileAsync(profileIndex, mStream->get());
     return context;
 }
 
+void TllmRuntime::setGpuAllocator(IGpuAllocator::SharedPtr gpuAllocator)
+{
+    TLLM_CHECK_WITH_INFO(mContexts.empty(), "The allocator must be set before the contexts are added");
+    TLLM_CHECK_WITH_INFO(mEngineBuffer != nullptr, "The activation memory is shared with another runtime");
+    mBufferManager = BufferManager{mStream, std::move(gpuAllocator)};
+    // The activation buffer is the largest allocation of the runtime, it moves to the allocator too
+    auto const size = mEngineBuffer->getSizeInBytes();
+    mEngineBuffer.reset();
+    MemoryCounters::TagScope const tagScope{MemoryTag::kENGINE_WORKSPACE};
+    mEngineBuffer = mBufferManager.gpu(size);
+}
+
+void TllmRuntime::setGpuWeightsPercent(float gpuWeightsPercent)
+{
+    TLLM_CHECK_WITH_INFO(0.0F <= gpuWeightsPercent && gpuWeightsPercent <= 1.0F,
+        "The fraction of the weights on the GPU must be in [0, 1], got %f", gpuWeightsPercent);
+    TLLM_CHECK_WITH_INFO(mContexts.empty(), "The weights must be placed before the contexts are added");
+#if NV_TENSORRT_MAJOR >= 10
+    auto const streamableSize = mEngine->getStreamableWeightsSize();
+    TLLM_CHECK_WITH_INFO(streamableSize > 0, "The engine is not built with weight streaming");
+    auto const minBudget = mEngine->getMinimumWeightStreamingBudget();
+    auto const budget
+        = std::max(minBudget, static_cast<std::int64_t>(gpuWeightsPercent * static_cast<float>(streamableSize)));
+    TLLM_CHECK_WITH_INFO(mEngine->setWeightStreamingBudget(budget),
+        "Failed to set a weight streaming budget of %ld bytes", static_cast<long>(budget));
+    TLLM_LOG_INFO("Weight streaming keeps %ld of %ld bytes of streamable weights on the GPU", static_cast<long>(budget),
+        static_cast<long>(streamableSize));
+
+    // The weights left in host memory are not counted
+    auto& memoryCounters = MemoryCounters::getInstance();
+    auto& weightsSize = getImpl().engineWeightsSize;
+    memoryCounters.deallocate(MemoryType::kGPU, weightsSize, MemoryTag::kENGINE_WEIGHTS);
+    weightsSize -= std::min(weightsSize, static_cast<std::size_t>(streamableSize - budget));
+    memoryCounters.allocate(MemoryType::kGPU, weightsSize, MemoryTag::kENGINE_WEIGHTS);
+
+    // The activation memory includes the staging buffers of the streamed weights
+    TLLM_CHECK_WITH_INFO(mEngineBuffer != nullptr, "The activation memory is shared with another runtime");
+    mEngineBuffer.reset();
+    MemoryCounters::TagScope const tagScope{MemoryTag::kENGINE_WORKSPACE};
+    mEngineBuffer = mBufferManager.gpu(mEngine->getDeviceMemorySize());
+#else
+    TLLM_CHECK_WITH_INFO(gpuWeightsPercent == 1.0F, "Weight streaming requires TensorRT 10");
+#endif
+}
+
+void TllmRuntime::refit(EngineWeights const& weights)
+{
+    TLLM_CHECK_WITH_INFO(isRefittable(), "The engine is not built with use_refit");
+    auto const start = std::chrono::steady_clock::now();
+    std::unique_ptr<nvinfer1::IRefitter> refitter{nvinfer1::createInferRefitter(*mEngine, getImpl().logger)};
+    TLLM_CHECK_WITH_INFO(refitter != nullptr, "Failed to create a refitter");
+
+    auto const nbRefittable = refitter->getAllWeights(0, nullptr);
+    std::vector<char const*> refittableNames(nbRefittable);
+    refitter->getAllWeights(nbRefittable, refittableNames.data());
+    std::unordered_set<std::string> const refittable(refittableNames.begin(), refittableNames.end());
+
+    // Weights that are not parameters of the engine, such as the ones folded while building, are skipped
+    std::size_t nbSet{0};
+    for (auto const& w : weights.getWeights())
+    {
+        if (refittable.count(w.name) == 0)
+        {
+            TLLM_LOG_DEBUG("Weights %s are not refittable, skipped", w.name.c_str());
+            continue;
+        }
+        // Rejected if the type or the number of values differs from the weights of the engine
+        auto const accepted
+            = refitter->setNamedWeights(w.name.c_str(), nvinfer1::Weights{w.dataType, w.values, w.count});
+        TLLM_CHECK_WITH_INFO(accepted, "Weights %s do not fit the engine", w.name.c_str());
+        ++nbSet;
+    }
+    auto const nbMissing = refitter->getMissingWeights(0, nullptr);
+    if (nbMissing > 0)
+    {
+        std::vector<char const*> missingNames(nbMissing);
+        refitter->getMissingWeights(nbMissing, missingNames.data());
+        TLLM_THROW("Weights %s are needed to refit the engine, along with %d others", missingNames.front(),
+            nbMissing - 1);
+    }
+
+    // TensorRT must not read the weights while they are replaced
+    mStream->synchronize();
+    TLLM_CHECK_WITH_INFO(refitter->refitCudaEngine(), "Failed to refit the engine");
+    auto const timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    TLLM_LOG_INFO("Refitted %zu of %zu weights of the engine in %.0f ms", nbSet, refittable.size(), timeMs);
+}
+
+IBuffer::SharedPtr TllmRuntime::shareEngineBuffer()
+{
+    auto& impl = getImpl();
+    if (mEngineBuffer)
+    {
+        impl.sharedEngineBuffer = std::move(mEngineBuffer);
+    }
+    return impl.sharedEngineBuffer;
+}
+
+void TllmRuntime::shareEngineWorkspace(TllmRuntime& other)
+{
+    if (&getEngineBuffer() == &other.getEngineBuffer())
+    {
+        return;
+    }
+    mStream->synchronize();
+    other.mStream->synchronize();
+
+    auto const buffer
+        = getEngineWorkspaceSize() >= other.getEngineWorkspaceSize() ? shareEngineBuffer() : other.shareEngineBuffer();
+    for (auto* runtime : {this, &other})
+    {
+        runtime->mEngineBuffer.reset();
+        runtime->getImpl().sharedEngineBuffer = buffer;
+        for (auto& context : runtime->mContexts)
+        {
+            context->setDeviceMemory(buffer->data());
+        }
+    }
+}
+
+std::vector<SizeType> TllmRuntime::getProfileOrder(SizeType preferredProfile) const
+{
+    auto const nbProfiles = getNbProfiles();
+    TLLM_CHECK(0 <= preferredProfile && preferredProfile < nbProfiles);
+    std::vector<double> volumes(nbProfiles, 0);
+    for (auto const& ioTensor : getImpl().ioTensors)
+    {
+        for (SizeType profile = 0; profile < static_cast<SizeType>(ioTensor.profileShapes.size()); ++profile)
+        {
+            auto const& maxShape = ioTensor.profileShapes[profile].second;
+            double maxVolume{1};
+            for (std::int32_t j = 0; j < maxShape.nbDims; ++j)
+            {
+                maxVolume *= maxShape.d[j];
+            }
+            volumes[profile] += maxVolume;
+        }
+    }
+    std::vector<SizeType> profiles(nbProfiles);
+    std::iota(profiles.begin(), profiles.end(), 0);
+    std::stable_sort(profiles.begin(), profiles.end(),
+        [&volumes, preferredProfile](SizeType lhs, SizeType rhs)
+        {
+            return std::make_pair(volumes[lhs], std::abs(lhs - preferredProfile))
+                < std::make_pair(volumes[rhs], std::abs(rhs - preferredProfile));
+        });
+    return profiles;
+}
+
+std::vector<std::pair<nvinfer1::Dims, nvinfer1::Dims>> const& TllmRuntime::getProfileShapes(
+    std::string const& name) const
+{
+    auto const& ioTensors = getImpl().ioTensors;
+    auto const pos = std::find_if(ioTensors.begin(), ioTensors.end(),
+        [&name](Impl::IOTensor const& ioTensor) { return ioTensor.name == name; });
+    TLLM_CHECK_WITH_INFO(pos != ioTensors.end() && !pos->profileShapes.empty(),
+        "%s is not an input of the engine with profile shapes", name.c_str());
+    return pos->profileShapes;
+}
+
+SizeType TllmRuntime::selectProfile(TensorMap const& tensorMap, SizeType preferredProfile) const
+{
+    auto const& ioTensors = getImpl().ioTensors;
+    auto const fits = [&ioTensors, &tensorMap](SizeType profile)
+    {
+        for (auto const& ioTensor : ioTensors)
+        {
+            if (ioTensor.profileShapes.empty())
+            {
+                continue;
+            }
+            auto pos = tensorMap.find(ioTensor.name);
+            if (pos == tensorMap.end())
+            {
+                continue;
+            }
+            auto const shape = pos->second->getShape();
+            auto const& [minShape, maxShape] = ioTensor.profileShapes[profile];
+            if (shape.nbDims != maxShape.nbDims)
+            {
+                return false;
+            }
+            for (std::int32_t j = 0; j < shape.nbDims; ++j)
+            {
+                if (shape.d[j] < minShape.d[j] || maxShape.d[j] < shape.d[j])
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+    for (auto const profile : getProfileOrder(preferredProfile))
+    {
+        if (fits(profile))
+        {
+            return profile;
+        }
+    }
+    return -1;
+}
+
 void TllmRuntime::clearContexts()
 {
     for (auto& context : mContexts)
@@ -97,44 +454,103 @@ void TllmRuntime::clearContexts()
         context.reset();
     }
     mContexts.clear();
+    getImpl().bindings.clear();
 }
 
 bool TllmRuntime::executeContext(SizeType contextIndex) const
 {
     NVTX3_FUNC_RANGE();
     auto& context = getContext(contextIndex);
+    if (auto* const layerProfiler = getImpl().layerProfiler.get())
+    {
+        cudaStreamCaptureStatus captureStatus{};
+        TLLM_CUDA_CHECK(cudaStreamIsCapturing(mStream->get(), &captureStatus));
+        if (captureStatus == cudaStreamCaptureStatusNone && layerProfiler->sample())
+        {
+            // The layer times are reported to the profiler before enqueueV3 returns
+            context.setProfiler(layerProfiler);
+            auto const success = context.enqueueV3(mStream->get());
+            context.setProfiler(nullptr);
+            return success;
+        }
+    }
     return context.enqueueV3(mStream->get());
 }
 
+void TllmRuntime::setLayerProfilingInterval(SizeType interval)
+{
+    TLLM_CHECK_WITH_INFO(interval >= 0, "The layer profiling interval must not be negative");
+    getImpl().layerProfiler = interval > 0 ? std::make_unique<LayerProfiler>(interval) : nullptr;
+}
+
+SizeType TllmRuntime::getLayerProfilingInterval() const
+{
+    auto const& layerProfiler = getImpl().layerProfiler;
+    return layerProfiler ? layerProfiler->getInterval() : 0;
+}
+
+LayerProfileStats TllmRuntime::collectLayerProfile()
+{
+    auto const& layerProfiler = getImpl().layerProfiler;
+    return layerProfiler ? layerProfiler->collect() : LayerProfileStats{};
+}
+
 void TllmRuntime::setInputTensors(SizeType contextIndex, TensorMap const& tensorMap)
 {
     NVTX3_FUNC_RANGE();
     TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
     auto& context = getContext(contextIndex);
-    for (std::int32_t i = 0; i < mEngine->getNbIOTensors(); ++i)
+    auto& impl = getImpl();
+    auto& bindings = impl.bindings.at(contextIndex);
+    bool shapesChanged{false};
+    for (std::size_t i = 0; i < impl.ioTensors.size(); ++i)
     {
-        auto const name = mEngine->getIOTensorName(i);
-        if (mEngine->getTensorIOMode(name) == nvinfer1::TensorIOMode::kINPUT)
+        auto const& ioTensor = impl.ioTensors[i];
+        if (!ioTensor.isInput)
         {
-            NVTX3_SCOPED_RANGE(input_tensor);
-            auto pos = tensorMap.find(name);
-            if (pos == tensorMap.end())
+            continue;
+        }
+        NVTX3_SCOPED_RANGE(input_tensor);
+        auto const* const name = ioTensor.name.c_str();
+        auto pos = tensorMap.find(ioTensor.name);
+        if (pos == tensorMap.end())
+        {
+            TLLM_THROW(
+                "Input tensor '%s' not found; expected shape: %s", name, ITensor::toString(ioTensor.shape).c_str());
+        }
+        auto const& tensor = pos->second;
+        auto const shapeProvided = tensor->getShape();
+        auto* data = tensor->data();
+        if (!data)
+        {
+            TLLM_CHECK_WITH_INFO(tensor->getSize() == 0, std::string("Invalid data for tensor: ") + name);
+            // TensorRT runtime does not support nullptr.
+            if (!mDummyTensor)
             {
-                auto expectedShape = mEngine->getTensorShape(name);
-                TLLM_THROW(
-                    "Input tensor '%s' not found; expected shape: %s", name, ITensor::toString(expectedShape).c_str());
+                mDummyTensor = mBufferManager.gpu(ITensor::makeShape({1}));
             }
-            auto const& tensor = pos->second;
-            auto const tensorDtype = tensor->getDataType();
-            auto const engineDtype = mEngine->getTensorDataType(name);
-            // WAR: TRT does not support mixed FP8 and FP16 input, so engine expects FP16 tensors.
-            TLLM_CHECK_WITH_INFO(tensorDtype == engineDtype
-                    || (tensorDtype == nvinfer1::DataType::kFP8 && engineDtype == nvinfer1::DataType::kHALF),
-                "%s: expected type %d, provided type %d", name, static_cast<std::int32_t>(engineDtype),
-                static_cast<std::int32_t>(tensorDtype));
+            data = mDummyTensor->data();
+        }
+
+        auto& binding = bindings[i];
+        // the values of shape inference inputs may change without their address
+        auto const shapeChanged = ioTensor.isShapeInferenceIO || !equalDims(binding.shape, shapeProvided);
+        if (!shapeChanged && binding.data == data)
+        {
+            continue;
+        }
+
+        auto const tensorDtype = tensor->getDataType();
+        auto const engineDtype = ioTensor.dataType;
+        // WAR: TRT does not support mixed FP8 and FP16 input, so engine expects FP16 tensors.
+        TLLM_CHECK_WITH_INFO(tensorDtype == engineDtype
+                || (tensorDtype == nvinfer1::DataType::kFP8 && engineDtype == nvinfer1::DataType::kHALF),
+            "%s: expected type %d, provided type %d", name, static_cast<std::int32_t>(engineDtype),
+            static_cast<std::int32_t>(tensorDtype));
 
-            auto const shapeExpected = mEngine->getTensorShape(name);
-            auto const shapeProvided = tensor->getShape();
+        if (shapeChanged)
+        {
+            auto const& shapeExpected = ioTensor.shape;
             TLLM_CHECK_WITH_INFO(shapeExpected.nbDims == shapeProvided.nbDims, "%s: expected %d dims, provided %d dims",
                 name, shapeExpected.nbDims, shapeProvided.nbDims);
             for (SizeType j = 0; j < shapeExpected.nbDims; ++j)
@@ -150,77 +566,84 @@ void TllmRuntime::setInputTensors(SizeType contextIndex, TensorMap const& tensor
             TLLM_CHECK_WITH_INFO(context.setInputShape(name, shapeProvided),
                 "Tensor '%s' has invalid shape %s, expected %s", name, ITensor::toString(shapeProvided).c_str(),
                 ITensor::toString(shapeExpected).c_str());
-            auto* const data = tensor->data();
-            if (data)
-            {
-                context.setInputTensorAddress(name, data);
-            }
-            else
-            {
-                TLLM_CHECK_WITH_INFO(tensor->getSize() == 0, std::string("Invalid data for tensor: ") + name);
-                // TensorRT runtime does not support nullptr.
-                if (!mDummyTensor)
-                {
-                    mDummyTensor = mBufferManager.gpu(ITensor::makeShape({1}));
-                }
-                context.setInputTensorAddress(name, mDummyTensor->data());
-            }
+            binding.shape = shapeProvided;
+            shapesChanged = true;
+        }
+        if (binding.data != data)
+        {
+            context.setInputTensorAddress(name, data);
+            binding.data = data;
         }
     }
 
+    if (shapesChanged)
     {
-        NVTX3_SCOPED_RANGE(infer_shapes);
-        char const* missing;
-        auto const nbMissing = context.inferShapes(1, &missing);
-        if (nbMissing > 0)
         {
-            TLLM_THROW("Input shape not specified: %s", missing);
+            NVTX3_SCOPED_RANGE(infer_shapes);
+            char const* missing;
+            auto const nbMissing = context.inferShapes(1, &missing);
+            if (nbMissing > 0)
+            {
+                TLLM_THROW("Input shape not specified: %s", missing);
+            }
+            else if (nbMissing < 0)
+            {
+                TLLM_THROW("Invalid input shape");
+            }
         }
-        else if (nbMissing < 0)
+
         {
-            TLLM_THROW("Invalid input shape");
+            NVTX3_SCOPED_RANGE(final_checks);
+            TLLM_CHECK_WITH_INFO(context.allInputDimensionsSpecified(), "Input dimensions not specified");
+            TLLM_CHECK_WITH_INFO(context.allInputShapesSpecified(), "Input shapes not specified");
         }
     }
-
-    {
-        NVTX3_SCOPED_RANGE(final_checks);
-        TLLM_CHECK_WITH_INFO(context.allInputDimensionsSpecified(), "Input dimensions not specified");
-        TLLM_CHECK_WITH_INFO(context.allInputShapesSpecified(), "Input shapes not specified");
-    }
+    TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
 }
 
 void TllmRuntime::setOutputTensors(SizeType contextIndex, TensorMap& tensorMap)
 {
     NVTX3_FUNC_RANGE();
     auto& context = getContext(contextIndex);
-    for (std::int32_t i = 0; i < mEngine->getNbIOTensors(); ++i)
+    auto& impl = getImpl();
+    auto& bindings = impl.bindings.at(contextIndex);
+    for (std::size_t i = 0; i < impl.ioTensors.size(); ++i)
     {
-        auto const name = mEngine->getIOTensorName(i);
-        if (mEngine->getTensorIOMode(name) == nvinfer1::TensorIOMode::kOUTPUT)
+        auto const& ioTensor = impl.ioTensors[i];
+        if (ioTensor.isInput)
         {
-            NVTX3_SCOPED_RANGE(output_tensor);
-            auto const dims = context.getTensorShape(name);
-            auto const engineDtype = mEngine->getTensorDataType(name);
-            auto pos = tensorMap.find(name);
-            if (pos != tensorMap.end())
-            {
-                auto const& tensor = pos->second;
-                auto const tensorDtype = tensor->getDataType();
-                // WAR: TRT does not support mixed FP8 and FP16 input, so engine expects FP16 tensors.
-                TLLM_CHECK_WITH_INFO(tensorDtype == engineDtype
-                        || (tensorDtype == nvinfer1::DataType::kFP8 && engineDtype == nvinfer1::DataType::kHALF),
-                    "%s: expected type %d, provided type %d", name, static_cast<std::int32_t>(engineDtype),
-                    static_cast<std::int32_t>(tensorDtype));
-
-                tensor->reshape(dims);
-                context.setTensorAddress(name, tensor->data());
-            }
-            else
-            {
-                auto tensor = ITensor::SharedPtr(mBufferManager.gpu(dims, engineDtype));
-                tensorMap.insert(pos, std::make_pair(name, tensor));
-                context.setTensorAddress(name, tensor->data());
-            }
+            continue;
+        }
+        NVTX3_SCOPED_RANGE(output_tensor);
+        auto const* const name = ioTensor.name.c_str();
+        auto const dims = context.getTensorShape(name);
+        auto const engineDtype = ioTensor.dataType;
+        auto pos = tensorMap.find(ioTensor.name);
+        ITensor::SharedPtr tensor;
+        if (pos != tensorMap.end())
+        {
+            tensor = pos->second;
+            auto const tensorDtype = tensor->getDataType();
+            // WAR: TRT does not support mixed FP8 and FP16 input, so engine expects FP16 tensors.
+            TLLM_CHECK_WITH_INFO(tensorDtype == engineDtype
+                    || (tensorDtype == nvinfer1::DataType::kFP8 && engineDtype == nvinfer1::DataType::kHALF),
+                "%s: expected type %d, provided type %d", name, static_cast<std::int32_t>(engineDtype),
+                static_cast<std::int32_t>(tensorDtype));
+
+            tensor->reshape(dims);
+        }
+        else
+        {
+            tensor = ITensor::SharedPtr(mBufferManager.gpu(dims, engineDtype));
+            tensorMap.insert(pos, std::make_pair(ioTensor.name, tensor));
+        }
+
+        auto& binding = bindings[i];
+        auto* const data = tensor->data();
+        if (binding.data != data)
+        {
+            context.setTensorAddress(name, data);
+            binding.data = data;
         }
     }
 }
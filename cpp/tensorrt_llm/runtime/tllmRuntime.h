@@ -17,11 +17,15 @@
 
 #include "tensorrt_llm/runtime/bufferManager.h"
 #include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/engineWeights.h"
 #include "tensorrt_llm/runtime/iTensor.h"
+#include "tensorrt_llm/runtime/layerProfileStats.h"
 #include <NvInferRuntime.h>
 
 #include <cstdint>
 #include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace tensorrt_llm::runtime
@@ -45,6 +49,8 @@ public:
     {
     }
 
+    ~TllmRuntime();
+
     SizeType getNbContexts() const
     {
         return static_cast<SizeType>(mContexts.size());
@@ -60,8 +66,60 @@ public:
         return static_cast<SizeType>(mEngine->getNbOptimizationProfiles());
     }
 
+    //! @brief Adds a context of the optimization profile. The contexts run on the stream of the runtime, one at a time,
+    //! they share a single activation buffer sized for the largest profile.
     nvinfer1::IExecutionContext& addContext(std::int32_t profileIndex);
 
+    //! @brief Size of the activation buffer of the contexts, in bytes.
+    [[nodiscard]] std::size_t getEngineWorkspaceSize() const;
+
+    //! @brief Makes the buffers allocated afterwards come from the memory pool configured by `poolConfig`, the ones
+    //! allocated before stay in their pool.
+    void setMemoryPoolConfig(MemoryPoolConfig const& poolConfig)
+    {
+        mBufferManager = BufferManager{mStream, poolConfig};
+    }
+
+    //! @brief Makes the buffers allocated afterwards, and the activation buffer of the contexts, come from
+    //! `gpuAllocator`, e.g. the caching allocator of PyTorch. Must be called before the contexts are added.
+    void setGpuAllocator(IGpuAllocator::SharedPtr gpuAllocator);
+
+    //! @brief Keeps a fraction of the streamable weights on the GPU, the others stay in host memory and are copied to
+    //! the GPU by TensorRT when the layers run. The engine must be built with weight streaming, which requires
+    //! TensorRT 10. Must be called before the contexts are added.
+    void setGpuWeightsPercent(float gpuWeightsPercent);
+
+    [[nodiscard]] bool isRefittable() const
+    {
+        return mEngine->isRefittable();
+    }
+
+    //! @brief Replaces the weights of the engine by the ones of `weights` with the same names, the others are kept.
+    //! @details The engine must be built with use_refit. Waits for the work enqueued on the stream, so that the
+    //! enqueues before the refit use the previous weights and the ones after use the new weights. The contexts and
+    //! their bindings are kept. Throws if a weight does not fit the engine, before any weight is replaced.
+    void refit(EngineWeights const& weights);
+
+    //! @brief Makes the contexts of both runtimes share the larger of their activation buffers, the other one is freed.
+    //! @details Waits for the work enqueued on both streams. The contexts of the two runtimes must not run concurrently
+    //! afterwards, e.g. a draft and a target model alternating on one thread.
+    void shareEngineWorkspace(TllmRuntime& other);
+
+    //! @brief Selects the optimization profile that fits the shapes of the input tensors in tensorMap best.
+    //! @details A profile fits if every input shape lies between its minimum and maximum shapes. Of the fitting
+    //! profiles, the one with the smallest maximum volume is selected, ties go to the profile closest to
+    //! preferredProfile.
+    //! @return The index of the selected profile, -1 if no profile fits.
+    [[nodiscard]] SizeType selectProfile(TensorMap const& tensorMap, SizeType preferredProfile = 0) const;
+
+    //! @brief The order in which selectProfile() tries the profiles, independent of the input shapes.
+    //! @return All profiles by ascending maximum volume of the inputs, ties by distance to preferredProfile.
+    [[nodiscard]] std::vector<SizeType> getProfileOrder(SizeType preferredProfile = 0) const;
+
+    //! @brief The minimum and maximum shapes of an input in each profile, for callers that select a profile once.
+    [[nodiscard]] std::vector<std::pair<nvinfer1::Dims, nvinfer1::Dims>> const& getProfileShapes(
+        std::string const& name) const;
+
     void clearContexts();
 
     void setInputTensors(SizeType contextIndex, TensorMap const& tensorMap);
@@ -70,6 +128,16 @@ public:
 
     bool executeContext(SizeType contextIndex) const;
 
+    //! @brief Times the layers of one in every `interval` enqueues of the contexts with the TensorRT profiler, by kind
+    //! of layer, 0 disables it. A profiled enqueue synchronizes the stream, the enqueues captured in CUDA graphs are
+    //! not profiled. Defaults to TRTLLM_LAYER_PROFILING_INTERVAL.
+    void setLayerProfilingInterval(SizeType interval);
+
+    [[nodiscard]] SizeType getLayerProfilingInterval() const;
+
+    //! @brief Returns the layer times of the enqueues profiled since the last call and clears them.
+    LayerProfileStats collectLayerProfile();
+
     CudaStream const& getStream() const;
 
     BufferManager::CudaStreamPtr getStreamPtr()
@@ -98,10 +166,22 @@ public:
     }
 
 private:
+    //! @brief Members kept out of the layout of the prebuilt batch manager, e.g. the bindings set last.
+    struct Impl;
+
+    [[nodiscard]] Impl& getImpl() const;
+
+    //! @brief The activation buffer of the contexts, owned by the runtime or shared with another runtime.
+    [[nodiscard]] IBuffer& getEngineBuffer() const;
+
+    //! @brief Moves the activation buffer of the runtime to a buffer that can be shared with another runtime.
+    IBuffer::SharedPtr shareEngineBuffer();
+
     BufferManager::CudaStreamPtr mStream;
     BufferManager mBufferManager;
     std::unique_ptr<nvinfer1::IRuntime> mRuntime;
     std::unique_ptr<nvinfer1::ICudaEngine> mEngine;
+    // Null once the activation memory is shared with another runtime
     BufferManager::IBufferPtr mEngineBuffer;
     std::vector<std::unique_ptr<nvinfer1::IExecutionContext>> mContexts;
     std::unique_ptr<ITensor> mDummyTensor;
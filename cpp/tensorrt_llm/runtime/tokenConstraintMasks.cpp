@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/tokenConstraintMasks.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/kernels/logitsBitmask.h"
+
+#include <algorithm>
+
+using namespace tensorrt_llm::runtime;
+
+TokenConstraintMasks::TokenConstraintMasks(
+    std::vector<std::shared_ptr<ITokenConstraint>> constraints, SizeType vocabSizePadded, BufferManager const& manager)
+    : mManager{manager}
+    , mConstraints{std::move(constraints)}
+    , mVocabSizePadded{vocabSizePadded}
+    , mBitmaskSize{tensorrt_llm::kernels::getLogitsBitmaskSize(vocabSizePadded)}
+{
+    auto const batchSize = static_cast<SizeType>(mConstraints.size());
+    TLLM_CHECK_WITH_INFO(batchSize > 0, "Token constraints must be given for each request of the batch.");
+    auto const bitmaskShape = ITensor::makeShape({batchSize, mBitmaskSize});
+    mBitmasks = mManager.gpu(bitmaskShape, nvinfer1::DataType::kINT32);
+    mBitmasksHost = BufferManager::pinned(bitmaskShape, nvinfer1::DataType::kINT32);
+    mNewTokensHost = BufferManager::pinned(ITensor::makeShape({batchSize}), TRTDataType<TokenIdType>::value);
+    mSequenceLengthsHost = BufferManager::pinned(ITensor::makeShape({batchSize}), TRTDataType<SizeType>::value);
+    mAcceptedLengths.assign(batchSize, -1);
+
+    // The requests without a constraint allow all tokens at every step
+    auto* bitmasks = reinterpret_cast<std::uint32_t*>(bufferCast<std::int32_t>(*mBitmasksHost));
+    std::fill_n(bitmasks, batchSize * mBitmaskSize, ~std::uint32_t{0});
+}
+
+void TokenConstraintMasks::update()
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    auto const batchSize = static_cast<SizeType>(mConstraints.size());
+    if (mHasTokens)
+    {
+        // Only the decoder step has to be finished, the engine of the next step keeps running
+        mTokensEvent.synchronize();
+        auto const* newTokens = bufferCast<TokenIdType>(*mNewTokensHost);
+        auto const* sequenceLengths = bufferCast<SizeType>(*mSequenceLengthsHost);
+        for (SizeType bi = 0; bi < batchSize; ++bi)
+        {
+            // The first token is always new, afterwards a finished request does not grow anymore
+            if (mConstraints[bi] && (mAcceptedLengths[bi] < 0 || sequenceLengths[bi] > mAcceptedLengths[bi]))
+            {
+                mConstraints[bi]->acceptToken(newTokens[bi]);
+                mAcceptedLengths[bi] = sequenceLengths[bi];
+            }
+        }
+        mHasTokens = false;
+    }
+
+    // The copy of the previous step has finished with the decoder step, so the host buffer can be reused
+    auto* bitmasks = reinterpret_cast<std::uint32_t*>(bufferCast<std::int32_t>(*mBitmasksHost));
+    for (SizeType bi = 0; bi < batchSize; ++bi)
+    {
+        if (mConstraints[bi])
+        {
+            auto* bitmask = bitmasks + bi * mBitmaskSize;
+            std::fill_n(bitmask, mBitmaskSize, std::uint32_t{0});
+            mConstraints[bi]->fillAllowedTokens(bitmask, mVocabSizePadded);
+        }
+    }
+    mManager.copy(*mBitmasksHost, *mBitmasks);
+    TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
+}
+
+void TokenConstraintMasks::recordTokens(ITensor const& newTokens, ITensor const& sequenceLengths)
+{
+    TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
+    TLLM_CHECK_WITH_INFO(newTokens.getSize() == mConstraints.size() && sequenceLengths.getSize() == mConstraints.size(),
+        "Token constraints do not support beam search.");
+    mManager.copy(newTokens, *mNewTokensHost);
+    mManager.copy(sequenceLengths, *mSequenceLengthsHost);
+    mManager.getStream().record(mTokensEvent);
+    mHasTokens = true;
+    TLLM_LOG_DEBUG("%s stop", __PRETTY_FUNCTION__);
+}
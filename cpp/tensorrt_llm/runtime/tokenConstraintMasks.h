@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/common.h"
+#include "tensorrt_llm/runtime/cudaEvent.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+#include "tensorrt_llm/runtime/tokenConstraint.h"
+
+#include <memory>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+//! Drives the token constraints of a batch and keeps the logits bitmasks of the next decoder step on the device.
+//! The host only waits for the tokens of the last decoder step, so that the constraints run while the engine computes
+//! the logits of the next step.
+class TokenConstraintMasks
+{
+public:
+    using TensorPtr = ITensor::SharedPtr;
+
+    //! @param constraints [batchSize], nullptr for the requests without a constraint
+    TokenConstraintMasks(std::vector<std::shared_ptr<ITokenConstraint>> constraints, SizeType vocabSizePadded,
+        BufferManager const& manager);
+
+    //! @brief Advances the constraints by the tokens of the last recorded step and uploads the bitmasks of the next
+    //! step. Call it after the engine of the step has been enqueued.
+    void update();
+
+    //! @brief Copies the new tokens of a decoder step to the host, call it after the step has been enqueued.
+    //! @param newTokens [batchSize, 1], on gpu
+    //! @param sequenceLengths [batchSize, 1], on gpu
+    void recordTokens(ITensor const& newTokens, ITensor const& sequenceLengths);
+
+    //! @returns [batchSize, ceil(vocabSizePadded / 32)], bitmasks of the next step, on gpu
+    [[nodiscard]] TensorPtr const& getBitmasks() const
+    {
+        return mBitmasks;
+    }
+
+private:
+    BufferManager const& mManager;
+    std::vector<std::shared_ptr<ITokenConstraint>> mConstraints;
+    SizeType const mVocabSizePadded;
+    SizeType const mBitmaskSize;
+
+    TensorPtr mBitmasks;                    // [batchSize, bitmaskSize], on gpu
+    TensorPtr mBitmasksHost;                // [batchSize, bitmaskSize], pinned
+    TensorPtr mNewTokensHost;               // [batchSize], pinned
+    TensorPtr mSequenceLengthsHost;         // [batchSize], pinned
+    std::vector<SizeType> mAcceptedLengths; // [batchSize], sequence length each constraint has seen
+    CudaEvent mTokensEvent{};
+    bool mHasTokens{false};
+};
+
+} // namespace tensorrt_llm::runtime
@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/utils/gpuTopology.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <tuple>
+
+#if !defined(_WIN32)
+#include <dlfcn.h>
+#include <nvml.h>
+#endif
+
+namespace tensorrt_llm::runtime::utils
+{
+
+namespace
+{
+
+// Score of each NVLink between two devices, above the scores of all the PCIe paths
+constexpr int kNvLinkScore = 16;
+// Score of the fastest PCIe P2P path, the slower ones score less by their CUDA performance rank, down to 1
+constexpr int kMaxPcieScore = 8;
+// Largest number of devices whose partitions are all searched
+constexpr std::size_t kMaxSearchedDevices = 16;
+
+// Domain, bus and device of a device on the PCI bus
+using PciLocation = std::tuple<unsigned int, unsigned int, unsigned int>;
+
+PciLocation getPciLocation(SizeType device)
+{
+    int domain = 0;
+    int bus = 0;
+    int pciDevice = 0;
+    TLLM_CUDA_CHECK(cudaDeviceGetAttribute(&domain, cudaDevAttrPciDomainId, device));
+    TLLM_CUDA_CHECK(cudaDeviceGetAttribute(&bus, cudaDevAttrPciBusId, device));
+    TLLM_CUDA_CHECK(cudaDeviceGetAttribute(&pciDevice, cudaDevAttrPciDeviceId, device));
+    return {domain, bus, pciDevice};
+}
+
+// Counts the active NVLinks between each pair of devices into links. NVML is opened at runtime so that it is not a
+// dependency of the library, returns false when it is not available. The links to NVSwitches are not counted, all the
+// devices behind the same switches being equally connected.
+bool countNvLinks(std::vector<SizeType> const& devices, std::vector<std::vector<int>>& links)
+{
+#if defined(_WIN32)
+    return false;
+#else
+    void* handle = dlopen("libnvidia-ml.so.1", RTLD_LAZY);
+    if (handle == nullptr)
+    {
+        return false;
+    }
+
+    decltype(&nvmlInit_v2) init;
+    decltype(&nvmlShutdown) shutdown;
+    decltype(&nvmlDeviceGetHandleByPciBusId_v2) getHandleByPciBusId;
+    decltype(&nvmlDeviceGetNvLinkState) getNvLinkState;
+    decltype(&nvmlDeviceGetNvLinkRemotePciInfo_v2) getNvLinkRemotePciInfo;
+    *(void**) (&init) = dlsym(handle, "nvmlInit_v2");
+    *(void**) (&shutdown) = dlsym(handle, "nvmlShutdown");
+    *(void**) (&getHandleByPciBusId) = dlsym(handle, "nvmlDeviceGetHandleByPciBusId_v2");
+    *(void**) (&getNvLinkState) = dlsym(handle, "nvmlDeviceGetNvLinkState");
+    *(void**) (&getNvLinkRemotePciInfo) = dlsym(handle, "nvmlDeviceGetNvLinkRemotePciInfo_v2");
+    if (init == nullptr || shutdown == nullptr || getHandleByPciBusId == nullptr || getNvLinkState == nullptr
+        || getNvLinkRemotePciInfo == nullptr || init() != NVML_SUCCESS)
+    {
+        dlclose(handle);
+        return false;
+    }
+
+    std::vector<PciLocation> locations;
+    locations.reserve(devices.size());
+    std::transform(devices.begin(), devices.end(), std::back_inserter(locations), getPciLocation);
+
+    bool ok = true;
+    for (std::size_t idx = 0; idx < devices.size() && ok; ++idx)
+    {
+        char busId[32];
+        TLLM_CUDA_CHECK(cudaDeviceGetPCIBusId(busId, sizeof(busId), devices[idx]));
+        nvmlDevice_t nvmlDevice;
+        ok = getHandleByPciBusId(busId, &nvmlDevice) == NVML_SUCCESS;
+        for (unsigned int link = 0; link < NVML_NVLINK_MAX_LINKS && ok; ++link)
+        {
+            nvmlEnableState_t state;
+            nvmlPciInfo_t remote;
+            // The links past the ones of the device are not supported
+            if (getNvLinkState(nvmlDevice, link, &state) != NVML_SUCCESS || state != NVML_FEATURE_ENABLED
+                || getNvLinkRemotePciInfo(nvmlDevice, link, &remote) != NVML_SUCCESS)
+            {
+                continue;
+            }
+            auto const peer = std::find(locations.begin(), locations.end(),
+                PciLocation{remote.domain, remote.bus, remote.device});
+            if (peer != locations.end())
+            {
+                ++links[idx][std::distance(locations.begin(), peer)];
+            }
+        }
+    }
+
+    shutdown();
+    dlclose(handle);
+    if (!ok)
+    {
+        std::for_each(links.begin(), links.end(), [](auto& row) { std::fill(row.begin(), row.end(), 0); });
+    }
+    return ok;
+#endif
+}
+
+// Tries all the partitions of the devices in blocks of groupSize, each block in ascending order and starting with the
+// first device not in the previous blocks. score is the one of the blocks of order.
+void searchPartitions(std::vector<std::vector<int>> const& scores, std::size_t groupSize,
+    std::vector<std::size_t>& order, std::vector<bool>& placed, int score, int& bestScore,
+    std::vector<std::size_t>& bestOrder)
+{
+    auto const nbDevices = scores.size();
+    if (order.size() == nbDevices)
+    {
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestOrder = order;
+        }
+        return;
+    }
+
+    auto const groupBegin = order.size() - order.size() % groupSize;
+    auto const first = groupBegin == order.size()
+        ? static_cast<std::size_t>(std::distance(placed.begin(), std::find(placed.begin(), placed.end(), false)))
+        : order.back() + 1;
+    auto const last = groupBegin == order.size() ? first + 1 : nbDevices;
+    for (std::size_t idx = first; idx < last; ++idx)
+    {
+        if (placed[idx])
+        {
+            continue;
+        }
+        int linkScore = 0;
+        for (auto member = order.begin() + static_cast<std::ptrdiff_t>(groupBegin); member != order.end(); ++member)
+        {
+            linkScore += scores[*member][idx];
+        }
+        placed[idx] = true;
+        order.push_back(idx);
+        searchPartitions(scores, groupSize, order, placed, score + linkScore, bestScore, bestOrder);
+        order.pop_back();
+        placed[idx] = false;
+    }
+}
+
+} // namespace
+
+std::vector<std::vector<int>> getLinkScores(std::vector<SizeType> const& devices)
+{
+    auto const nbDevices = devices.size();
+    std::vector<std::vector<int>> scores(nbDevices, std::vector<int>(nbDevices, 0));
+    if (countNvLinks(devices, scores))
+    {
+        for (auto& row : scores)
+        {
+            std::transform(row.begin(), row.end(), row.begin(), [](int links) { return links * kNvLinkScore; });
+        }
+    }
+    else
+    {
+        TLLM_LOG_DEBUG("NVML is not available, the NVLinks are ranked by the CUDA P2P attributes");
+    }
+
+    for (std::size_t src = 0; src < nbDevices; ++src)
+    {
+        for (std::size_t dst = 0; dst < nbDevices; ++dst)
+        {
+            if (src == dst || scores[src][dst] > 0)
+            {
+                continue;
+            }
+            int accessSupported = 0;
+            int performanceRank = 0;
+            TLLM_CUDA_CHECK(
+                cudaDeviceGetP2PAttribute(&accessSupported, cudaDevP2PAttrAccessSupported, devices[src], devices[dst]));
+            TLLM_CUDA_CHECK(cudaDeviceGetP2PAttribute(
+                &performanceRank, cudaDevP2PAttrPerformanceRank, devices[src], devices[dst]));
+            scores[src][dst] = accessSupported ? std::max(kMaxPcieScore - performanceRank, 1) : 0;
+        }
+    }
+    return scores;
+}
+
+std::vector<SizeType> placeGroups(
+    std::vector<std::vector<int>> const& scores, std::vector<SizeType> const& devices, SizeType groupSize)
+{
+    auto const nbDevices = devices.size();
+    TLLM_CHECK(scores.size() == nbDevices);
+    TLLM_CHECK_WITH_INFO(groupSize > 0 && nbDevices % groupSize == 0,
+        "The %zu devices cannot be split in groups of %d devices", nbDevices, groupSize);
+    if (nbDevices > kMaxSearchedDevices || static_cast<std::size_t>(groupSize) == nbDevices)
+    {
+        return devices;
+    }
+
+    std::vector<std::size_t> bestOrder(nbDevices);
+    std::iota(bestOrder.begin(), bestOrder.end(), 0);
+    int bestScore = 0;
+    for (std::size_t idx = 0; idx < nbDevices; ++idx)
+    {
+        auto const groupBegin = idx - idx % groupSize;
+        for (std::size_t member = groupBegin; member < idx; ++member)
+        {
+            bestScore += scores[member][idx];
+        }
+    }
+
+    std::vector<std::size_t> order;
+    order.reserve(nbDevices);
+    std::vector<bool> placed(nbDevices, false);
+    searchPartitions(scores, groupSize, order, placed, 0, bestScore, bestOrder);
+
+    std::vector<SizeType> placement;
+    placement.reserve(nbDevices);
+    std::transform(bestOrder.begin(), bestOrder.end(), std::back_inserter(placement),
+        [&devices](std::size_t idx) { return devices[idx]; });
+    return placement;
+}
+
+} // namespace tensorrt_llm::runtime::utils
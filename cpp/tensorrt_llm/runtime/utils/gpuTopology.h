@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/runtime/common.h"
+
+#include <vector>
+
+namespace tensorrt_llm::runtime::utils
+{
+
+//! \brief Scores of the links between each pair of devices, higher for faster links and 0 without P2P. The NVLinks are
+//! counted through NVML when its library is found, the other links are ranked by the CUDA P2P attributes.
+//! \param devices The CUDA ordinals of the devices, the scores are indexed by their positions in it.
+std::vector<std::vector<int>> getLinkScores(std::vector<SizeType> const& devices);
+
+//! \brief Orders the devices so that the sum of the scores of the links within each block of groupSize consecutive
+//! devices is the highest, the blocks being the devices of the TP groups. Keeps the given order when no other one is
+//! strictly better, and when there are too many devices to search all the partitions.
+std::vector<SizeType> placeGroups(
+    std::vector<std::vector<int>> const& scores, std::vector<SizeType> const& devices, SizeType groupSize);
+
+} // namespace tensorrt_llm::runtime::utils
@@ -17,6 +17,8 @@
 #include "sessionUtils.h"
 
 #include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cpuAffinity.h"
+#include "tensorrt_llm/common/envUtils.h"
 #include "tensorrt_llm/runtime/runtimeKernels.h"
 #include "tensorrt_llm/runtime/tllmRuntime.h"
 
@@ -32,6 +34,10 @@ int initDevice(WorldConfig const& worldConfig)
 {
     auto const device = worldConfig.getDevice();
     TLLM_CUDA_CHECK(cudaSetDevice(device));
+    if (tc::getEnvBindThreadsToDevice())
+    {
+        tc::bindThreadToDevice(device);
+    }
     return device;
 }
 
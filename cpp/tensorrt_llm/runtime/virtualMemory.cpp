@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/runtime/virtualMemory.h"
+
+#include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/logger.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+
+#include <algorithm>
+
+namespace tensorrt_llm::runtime
+{
+
+namespace
+{
+CUmemAllocationProp getAllocationProp(int device)
+{
+    CUmemAllocationProp prop{};
+    prop.type = CU_MEM_ALLOCATION_TYPE_PINNED;
+    prop.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    prop.location.id = device;
+    return prop;
+}
+} // namespace
+
+VirtualMemoryTensor::VirtualMemoryTensor(Shape const& dims, std::size_t maxCapacity, nvinfer1::DataType type)
+    : mMaxCapacity{maxCapacity}
+    , mType{type}
+{
+    TLLM_CUDA_CHECK(cudaGetDevice(&mDevice));
+    auto const prop = getAllocationProp(mDevice);
+    check(mDriver.cuMemGetAllocationGranularity(&mGranularity, &prop, CU_MEM_ALLOC_GRANULARITY_RECOMMENDED),
+        "cuMemGetAllocationGranularity");
+    mReservedSize = common::divUp(std::max<std::size_t>(toBytes(mMaxCapacity), 1), mGranularity) * mGranularity;
+    check(mDriver.cuMemAddressReserve(&mAddress, mReservedSize, mGranularity, 0, 0), "cuMemAddressReserve");
+    try
+    {
+        reshape(dims);
+    }
+    catch (...)
+    {
+        release();
+        mDriver.cuMemAddressFree(mAddress, mReservedSize);
+        throw;
+    }
+}
+
+VirtualMemoryTensor::~VirtualMemoryTensor()
+{
+    try
+    {
+        release();
+        check(mDriver.cuMemAddressFree(mAddress, mReservedSize), "cuMemAddressFree");
+    }
+    catch (std::exception& e)
+    {
+        TLLM_LOG_EXCEPTION(e);
+    }
+}
+
+std::size_t VirtualMemoryTensor::getCapacity() const
+{
+    return std::min(mMappedSize / BufferDataType(mType).getSize(), mMaxCapacity);
+}
+
+void VirtualMemoryTensor::reshape(Shape const& dims)
+{
+    auto const newSize = ITensor::volumeNonNegative(dims);
+    TLLM_CHECK_WITH_INFO(newSize <= mMaxCapacity, "Cannot grow a virtual memory tensor beyond %zu elements, got %zu",
+        mMaxCapacity, newSize);
+    if (getCapacity() < newSize)
+    {
+        map(toBytes(newSize));
+    }
+    mDims = dims;
+    mSize = newSize;
+}
+
+void VirtualMemoryTensor::release()
+{
+    unmapBeyond(0);
+    mDims.nbDims = 0;
+    mSize = 0;
+}
+
+void VirtualMemoryTensor::trim()
+{
+    unmapBeyond(toBytes(mSize));
+}
+
+void VirtualMemoryTensor::map(std::size_t sizeInBytes)
+{
+    auto const size = common::divUp(sizeInBytes, mGranularity) * mGranularity - mMappedSize;
+    auto const prop = getAllocationProp(mDevice);
+    CUmemGenericAllocationHandle handle{};
+    check(mDriver.cuMemCreate(&handle, size, &prop, 0), "cuMemCreate");
+    auto const result = mDriver.cuMemMap(mAddress + mMappedSize, size, 0, handle, 0);
+    if (result != CUDA_SUCCESS)
+    {
+        mDriver.cuMemRelease(handle);
+        check(result, "cuMemMap");
+    }
+    mMappings.push_back({mMappedSize, size, handle});
+    mMappedSize += size;
+    MemoryCounters::getInstance().allocate<MemoryType::kGPU>(size, mTag);
+
+    CUmemAccessDesc access{};
+    access.location = prop.location;
+    access.flags = CU_MEM_ACCESS_FLAGS_PROT_READWRITE;
+    check(mDriver.cuMemSetAccess(mAddress + mMappings.back().offset, size, &access, 1), "cuMemSetAccess");
+}
+
+void VirtualMemoryTensor::unmapBeyond(std::size_t sizeInBytes)
+{
+    // The mappings are unmapped whole, the last one kept may extend beyond the size
+    while (!mMappings.empty() && mMappings.back().offset >= sizeInBytes)
+    {
+        auto const mapping = mMappings.back();
+        mMappings.pop_back();
+        mMappedSize -= mapping.size;
+        MemoryCounters::getInstance().deallocate<MemoryType::kGPU>(mapping.size, mTag);
+        check(mDriver.cuMemUnmap(mAddress + mapping.offset, mapping.size), "cuMemUnmap");
+        check(mDriver.cuMemRelease(mapping.handle), "cuMemRelease");
+    }
+}
+
+void VirtualMemoryTensor::check(CUresult result, char const* call) const
+{
+    if (result != CUDA_SUCCESS)
+    {
+        char const* name = nullptr;
+        mDriver.cuGetErrorName(result, &name);
+        TLLM_THROW("%s failed with %s", call, name ? name : "an unknown error");
+    }
+}
+
+} // namespace tensorrt_llm::runtime
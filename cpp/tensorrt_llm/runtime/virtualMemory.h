@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorrt_llm/common/cudaDriverWrapper.h"
+#include "tensorrt_llm/runtime/iTensor.h"
+#include "tensorrt_llm/runtime/memoryCounters.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace tensorrt_llm::runtime
+{
+
+//! \brief GPU tensor whose address range is reserved for its maximum capacity up front, e.g. a pool of KV cache
+//! blocks that grows and shrinks with the free memory.
+//!
+//! Physical memory is mapped at the end of the range when the tensor grows, and unmapped by `trim()`. The address of
+//! the tensor never changes, the pointers to its elements stay valid while they are mapped. The memory must not be
+//! used by any stream when it is unmapped.
+class VirtualMemoryTensor : virtual public ITensor
+{
+public:
+    //! \brief Reserves the address range of `maxCapacity` elements and maps the memory of `dims`.
+    VirtualMemoryTensor(Shape const& dims, std::size_t maxCapacity, nvinfer1::DataType type);
+
+    ~VirtualMemoryTensor() override;
+
+    void* data() override
+    {
+        return mSize > 0 ? reinterpret_cast<void*>(mAddress) : nullptr;
+    }
+
+    [[nodiscard]] void const* data() const override
+    {
+        return mSize > 0 ? reinterpret_cast<void const*>(mAddress) : nullptr;
+    }
+
+    [[nodiscard]] std::size_t getSize() const override
+    {
+        return mSize;
+    }
+
+    //! \brief Number of elements of the mapped memory.
+    [[nodiscard]] std::size_t getCapacity() const override;
+
+    //! \brief Number of elements of the reserved address range.
+    [[nodiscard]] std::size_t getMaxCapacity() const
+    {
+        return mMaxCapacity;
+    }
+
+    [[nodiscard]] nvinfer1::DataType getDataType() const override
+    {
+        return mType;
+    }
+
+    [[nodiscard]] MemoryType getMemoryType() const override
+    {
+        return MemoryType::kGPU;
+    }
+
+    [[nodiscard]] Shape const& getShape() const override
+    {
+        return mDims;
+    }
+
+    //! \brief Maps more memory if the new volume exceeds the capacity, up to the maximum capacity.
+    void reshape(Shape const& dims) override;
+
+    void resize(std::size_t newSize) override
+    {
+        ITensor::resize(newSize);
+    }
+
+    //! \brief Unmaps all the memory, the address range stays reserved.
+    void release() override;
+
+    //! \brief Unmaps the memory beyond the size of the tensor.
+    void trim();
+
+    //! \brief Granularity of the mappings, in bytes.
+    [[nodiscard]] std::size_t getGranularity() const
+    {
+        return mGranularity;
+    }
+
+private:
+    //! \brief Physical memory mapped at an offset of the address range.
+    struct Mapping
+    {
+        std::size_t offset;
+        std::size_t size;
+        CUmemGenericAllocationHandle handle;
+    };
+
+    void map(std::size_t sizeInBytes);
+
+    void unmapBeyond(std::size_t sizeInBytes);
+
+    void check(CUresult result, char const* call) const;
+
+    common::CUDADriverWrapper mDriver;
+    int mDevice{-1};
+    std::size_t mGranularity{0};
+    CUdeviceptr mAddress{0};
+    std::size_t mReservedSize{0};
+    std::size_t mMappedSize{0};
+    std::vector<Mapping> mMappings;
+    Shape mDims{};
+    std::size_t mSize{0};
+    std::size_t mMaxCapacity;
+    nvinfer1::DataType mType;
+    MemoryTag mTag{MemoryCounters::getCurrentTag()};
+};
+
+} // namespace tensorrt_llm::runtime
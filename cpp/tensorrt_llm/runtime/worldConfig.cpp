@@ -17,9 +17,12 @@
 #include "tensorrt_llm/runtime/worldConfig.h"
 
 #include "tensorrt_llm/common/assert.h"
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/envUtils.h"
 #include "tensorrt_llm/common/logger.h"
 #include "tensorrt_llm/common/mpiUtils.h"
 #include "tensorrt_llm/common/stringUtils.h"
+#include "tensorrt_llm/runtime/utils/gpuTopology.h"
 
 #include <algorithm>
 #include <numeric>
@@ -28,6 +31,34 @@
 using namespace tensorrt_llm::runtime;
 namespace tc = tensorrt_llm::common;
 
+namespace
+{
+
+// Orders the devices of the node so that the TP groups, blocks of consecutive ranks, are on the devices with the
+// fastest links between them. Every rank of the node finds the same placement. Empty when it does not apply: the TP
+// groups must be smaller than the node and split it evenly, and all the ranks must fit in it.
+std::optional<std::vector<SizeType>> placeTensorParallelGroups(
+    SizeType gpusPerNode, SizeType tensorParallelism, SizeType pipelineParallelism)
+{
+    int deviceCount = 0;
+    TLLM_CUDA_CHECK(cudaGetDeviceCount(&deviceCount));
+    auto const nbDevices = std::min(gpusPerNode, static_cast<SizeType>(deviceCount));
+    if (tensorParallelism <= 1 || tensorParallelism >= nbDevices || nbDevices % tensorParallelism != 0
+        || tensorParallelism * pipelineParallelism > nbDevices)
+    {
+        return std::nullopt;
+    }
+
+    std::vector<SizeType> devices(nbDevices);
+    std::iota(devices.begin(), devices.end(), 0);
+    auto placement = utils::placeGroups(utils::getLinkScores(devices), devices, tensorParallelism);
+    TLLM_LOG_INFO("Topology-aware placement of the TP groups of %d ranks on the devices: %s", tensorParallelism,
+        tc::arr2str(placement.data(), placement.size()).c_str());
+    return placement;
+}
+
+} // namespace
+
 WorldConfig::WorldConfig(SizeType tensorParallelism, SizeType pipelineParallelism, SizeType rank, SizeType gpusPerNode,
     std::optional<std::vector<SizeType>> const& deviceIds)
     : mTensorParallelism{tensorParallelism}
@@ -93,6 +124,10 @@ WorldConfig WorldConfig::mpi(SizeType gpusPerNode, std::optional<SizeType> tenso
     auto tp = tensorParallelism.value_or(mpiSize / pp);
     TLLM_CHECK(mpiSize == tp * pp);
 
+    if (!deviceIds.has_value() && tc::getEnvTopologyAwarePlacement())
+    {
+        return WorldConfig{tp, pp, mpiRank, gpusPerNode, placeTensorParallelGroups(gpusPerNode, tp, pp)};
+    }
     return WorldConfig{tp, pp, mpiRank, gpusPerNode, deviceIds};
 }
 
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/runtime/cudaStream.h"
+#include "tensorrt_llm/runtime/runtimeKernels.h"
+#include "tensorrt_llm/runtime/torchView.h"
+#include "tensorrt_llm/thop/thUtils.h"
+
+namespace th = torch;
+namespace tr = tensorrt_llm::runtime;
+
+namespace torch_ext
+{
+
+// Forks the copy-on-write blocks of the Python KVCacheManager, pool is [numRows, blockStride] and row
+// dst_block_ids[i] receives row src_block_ids[i]
+void copyBlocks(th::Tensor& pool, th::Tensor const& src_block_ids, th::Tensor const& dst_block_ids)
+{
+    CHECK_TH_CUDA(pool);
+    CHECK_CONTIGUOUS(pool);
+    CHECK_INPUT(src_block_ids, torch::kInt32);
+    CHECK_INPUT(dst_block_ids, torch::kInt32);
+    TORCH_CHECK(pool.dim() == 2, "pool must be [numRows, blockStride]");
+    TORCH_CHECK(src_block_ids.numel() == dst_block_ids.numel(), "Block id tensors must have the same size");
+
+    auto const blockStride = static_cast<std::size_t>(pool.size(1));
+    // The stream of PyTorch, not owned
+    tr::CudaStream stream{at::cuda::getCurrentCUDAStream().stream(), pool.get_device(), false};
+    auto poolView = tr::TorchView::of(pool);
+    tr::kernels::invokeCopyBlocks(
+        *poolView, *tr::TorchView::of(src_block_ids), *tr::TorchView::of(dst_block_ids), blockStride, stream);
+    sync_check_cuda_error();
+}
+
+} // namespace torch_ext
+
+static auto copy_blocks = torch::RegisterOperators("tensorrt_llm::copy_blocks", &torch_ext::copyBlocks);
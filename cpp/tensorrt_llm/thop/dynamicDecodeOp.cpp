@@ -130,31 +130,16 @@ void FtDynamicDecode<T>::setup(size_t batch_size, size_t beam_width, th::optiona
     dynamic_decode_layer_->setup(batch_size, beam_width, setupParams);
 }
 
+namespace
+{
+
 template <typename T>
-void FtDynamicDecode<T>::forward(th::Tensor& logits, // (batch_size, beam_width, hidden_size)
-    int step, int max_input_length, int max_attention_window, uint64_t ite, int local_batch_size, th::Tensor end_id,
+void updateForwardParams(typename tensorrt_llm::layers::DynamicDecodeLayer<T>::ForwardParams& forwardParams,
     th::optional<th::Tensor> embedding_bias_opt, th::optional<th::Tensor> input_lengths_opt,
     th::optional<th::Tensor> sequence_limit_length_opt, th::optional<th::Tensor> stop_words_list_opt,
     th::optional<th::Tensor> bad_words_list_opt, th::optional<th::Tensor> no_repeat_ngram_size_opt,
-    th::optional<th::Tensor> src_cache_indirection_opt,
-    // Outputs
-    th::Tensor& output_token_ids, th::Tensor& newTokens, th::Tensor& should_stop,
-    th::optional<th::Tensor> finished_input, th::optional<th::Tensor> finished_output,
-    th::optional<th::Tensor> sequence_lengths_opt, th::optional<th::Tensor> cum_log_probs_opt,
-    th::optional<th::Tensor> output_log_probs_opt, th::optional<th::Tensor> parent_ids_opt,
-    th::optional<th::Tensor> tgt_cache_indirection_opt, th::optional<th::Tensor> beam_hyps_output_ids_tgt_opt,
-    th::optional<th::Tensor> beam_hyps_sequence_lengths_tgt_opt, th::optional<th::Tensor> beam_hyps_cum_log_probs_opt,
-    th::optional<th::Tensor> beam_hyps_normed_scores_opt, th::optional<th::Tensor> beam_hyps_log_probs_opt,
-    th::optional<th::Tensor> beam_hyps_min_normed_scores_opt, th::optional<th::Tensor> beam_hyps_num_beams_opt,
-    th::optional<th::Tensor> beam_hyps_is_done_opt, bool use_beam_hyps)
-
+    th::optional<th::Tensor> finished_input)
 {
-    auto const& logits_converted = convert_tensor<float>(logits);
-    auto const& end_ids_converted = convert_tensor<int>(end_id);
-    typename tensorrt_llm::layers::DynamicDecodeLayer<T>::ForwardParams forwardParams{step, static_cast<int>(ite),
-        max_input_length, max_attention_window, local_batch_size, logits_converted, end_ids_converted};
-
-    safeUpdate<int>(src_cache_indirection_opt, forwardParams.src_cache_indirection);
     safeUpdate<int>(sequence_limit_length_opt, forwardParams.sequence_limit_length);
     safeUpdate<T>(embedding_bias_opt, forwardParams.embedding_bias);
     safeUpdate<int>(input_lengths_opt, forwardParams.input_lengths);
@@ -162,24 +147,26 @@ void FtDynamicDecode<T>::forward(th::Tensor& logits, // (batch_size, beam_width,
     safeUpdate<int>(stop_words_list_opt, forwardParams.stop_words_list);
     safeUpdate<int>(no_repeat_ngram_size_opt, forwardParams.no_repeat_ngram_size);
     safeUpdate<uint8_t>(finished_input, forwardParams.finished);
+}
 
-    auto const& output_ids_converted = convert_tensor<int>(output_token_ids);
-    typename tensorrt_llm::layers::DynamicDecodeLayer<T>::OutputParams outputParams{output_ids_converted};
+template <typename T>
+void updateOutputParams(typename tensorrt_llm::layers::DynamicDecodeLayer<T>::OutputParams& outputParams,
+    th::optional<th::Tensor> input_lengths_opt, th::Tensor& newTokens, th::optional<th::Tensor> finished_output,
+    th::optional<th::Tensor> sequence_lengths_opt, th::optional<th::Tensor> cum_log_probs_opt,
+    th::optional<th::Tensor> output_log_probs_opt, th::optional<th::Tensor> parent_ids_opt,
+    th::optional<th::Tensor> beam_hyps_output_ids_tgt_opt, th::optional<th::Tensor> beam_hyps_sequence_lengths_tgt_opt,
+    th::optional<th::Tensor> beam_hyps_cum_log_probs_opt, th::optional<th::Tensor> beam_hyps_normed_scores_opt,
+    th::optional<th::Tensor> beam_hyps_log_probs_opt, th::optional<th::Tensor> beam_hyps_min_normed_scores_opt,
+    th::optional<th::Tensor> beam_hyps_num_beams_opt, th::optional<th::Tensor> beam_hyps_is_done_opt,
+    bool use_beam_hyps)
+{
     outputParams.newTokens = std::move(convert_tensor<int>(newTokens));
 
     safeUpdate<uint8_t>(finished_output, outputParams.finished);
-    std::int32_t* finished_sum_host = nullptr;
-    if (forwardParams.sequence_limit_length && outputParams.finished.has_value())
-    {
-        outputParams.finished_sum = tcc::toTllmTensor(*finished_sum_);
-        finished_sum_host = tr::bufferCast<std::int32_t>(*finished_sum_);
-        *finished_sum_host = 0;
-    }
     safeUpdate<int>(sequence_lengths_opt, outputParams.sequence_length);
     safeUpdate<int>(parent_ids_opt, outputParams.parent_ids);
     safeUpdate<float>(cum_log_probs_opt, outputParams.cum_log_probs);
     safeUpdate<float>(output_log_probs_opt, outputParams.output_log_probs);
-    safeUpdate<int>(tgt_cache_indirection_opt, outputParams.tgt_cache_indirection);
 
     if (use_beam_hyps)
     {
@@ -194,6 +181,142 @@ void FtDynamicDecode<T>::forward(th::Tensor& logits, // (batch_size, beam_width,
         safeUpdatePtr<bool>(beam_hyps_is_done_opt, outputParams.beamHypotheses->is_done);
         safeUpdatePtr<int32_t const>(input_lengths_opt, outputParams.beamHypotheses->input_lengths);
     }
+}
+
+} // namespace
+
+template <typename T>
+void FtDynamicDecode<T>::forward(th::Tensor& logits, // (batch_size, beam_width, hidden_size)
+    int step, int max_input_length, int max_attention_window, uint64_t ite, int local_batch_size, th::Tensor end_id,
+    th::optional<th::Tensor> embedding_bias_opt, th::optional<th::Tensor> input_lengths_opt,
+    th::optional<th::Tensor> sequence_limit_length_opt, th::optional<th::Tensor> stop_words_list_opt,
+    th::optional<th::Tensor> bad_words_list_opt, th::optional<th::Tensor> no_repeat_ngram_size_opt,
+    th::optional<th::Tensor> src_cache_indirection_opt,
+    // Outputs
+    th::Tensor& output_token_ids, th::Tensor& newTokens, th::Tensor& should_stop,
+    th::optional<th::Tensor> finished_input, th::optional<th::Tensor> finished_output,
+    th::optional<th::Tensor> sequence_lengths_opt, th::optional<th::Tensor> cum_log_probs_opt,
+    th::optional<th::Tensor> output_log_probs_opt, th::optional<th::Tensor> parent_ids_opt,
+    th::optional<th::Tensor> tgt_cache_indirection_opt, th::optional<th::Tensor> beam_hyps_output_ids_tgt_opt,
+    th::optional<th::Tensor> beam_hyps_sequence_lengths_tgt_opt, th::optional<th::Tensor> beam_hyps_cum_log_probs_opt,
+    th::optional<th::Tensor> beam_hyps_normed_scores_opt, th::optional<th::Tensor> beam_hyps_log_probs_opt,
+    th::optional<th::Tensor> beam_hyps_min_normed_scores_opt, th::optional<th::Tensor> beam_hyps_num_beams_opt,
+    th::optional<th::Tensor> beam_hyps_is_done_opt, bool use_beam_hyps)
+
+{
+    auto const& logits_converted = convert_tensor<float>(logits);
+    auto const& end_ids_converted = convert_tensor<int>(end_id);
+    ForwardParams forwardParams{step, static_cast<int>(ite), max_input_length, max_attention_window, local_batch_size,
+        logits_converted, end_ids_converted};
+
+    safeUpdate<int>(src_cache_indirection_opt, forwardParams.src_cache_indirection);
+    updateForwardParams<T>(forwardParams, embedding_bias_opt, input_lengths_opt, sequence_limit_length_opt,
+        stop_words_list_opt, bad_words_list_opt, no_repeat_ngram_size_opt, finished_input);
+
+    auto const& output_ids_converted = convert_tensor<int>(output_token_ids);
+    OutputParams outputParams{output_ids_converted};
+    updateOutputParams<T>(outputParams, input_lengths_opt, newTokens, finished_output, sequence_lengths_opt,
+        cum_log_probs_opt, output_log_probs_opt, parent_ids_opt, beam_hyps_output_ids_tgt_opt,
+        beam_hyps_sequence_lengths_tgt_opt, beam_hyps_cum_log_probs_opt, beam_hyps_normed_scores_opt,
+        beam_hyps_log_probs_opt, beam_hyps_min_normed_scores_opt, beam_hyps_num_beams_opt, beam_hyps_is_done_opt,
+        use_beam_hyps);
+    safeUpdate<int>(tgt_cache_indirection_opt, outputParams.tgt_cache_indirection);
+    if (forwardParams.sequence_limit_length && outputParams.finished.has_value())
+    {
+        outputParams.finished_sum = tcc::toTllmTensor(*finished_sum_);
+    }
+
+    forward(forwardParams, outputParams, should_stop);
+}
+
+template <typename T>
+void FtDynamicDecode<T>::registerBuffers(th::Tensor end_id, th::optional<th::Tensor> embedding_bias_opt,
+    th::optional<th::Tensor> input_lengths_opt, th::optional<th::Tensor> sequence_limit_length_opt,
+    th::optional<th::Tensor> stop_words_list_opt, th::optional<th::Tensor> bad_words_list_opt,
+    th::optional<th::Tensor> no_repeat_ngram_size_opt, th::optional<th::Tensor> cache_indirection_0_opt,
+    th::optional<th::Tensor> cache_indirection_1_opt,
+    // Outputs
+    th::Tensor output_token_ids, th::Tensor newTokens, th::optional<th::Tensor> finished_input,
+    th::optional<th::Tensor> finished_output, th::optional<th::Tensor> sequence_lengths_opt,
+    th::optional<th::Tensor> cum_log_probs_opt, th::optional<th::Tensor> output_log_probs_opt,
+    th::optional<th::Tensor> parent_ids_opt, th::optional<th::Tensor> beam_hyps_output_ids_tgt_opt,
+    th::optional<th::Tensor> beam_hyps_sequence_lengths_tgt_opt, th::optional<th::Tensor> beam_hyps_cum_log_probs_opt,
+    th::optional<th::Tensor> beam_hyps_normed_scores_opt, th::optional<th::Tensor> beam_hyps_log_probs_opt,
+    th::optional<th::Tensor> beam_hyps_min_normed_scores_opt, th::optional<th::Tensor> beam_hyps_num_beams_opt,
+    th::optional<th::Tensor> beam_hyps_is_done_opt, bool use_beam_hyps)
+{
+    // The layer only keeps the pointers of the tensors, they are held here until the next registration
+    registered_tensors_ = {end_id, output_token_ids, newTokens};
+    for (auto const& tensor : {embedding_bias_opt, input_lengths_opt, sequence_limit_length_opt, stop_words_list_opt,
+             bad_words_list_opt, no_repeat_ngram_size_opt, cache_indirection_0_opt, cache_indirection_1_opt,
+             finished_input, finished_output, sequence_lengths_opt, cum_log_probs_opt, output_log_probs_opt,
+             parent_ids_opt, beam_hyps_output_ids_tgt_opt, beam_hyps_sequence_lengths_tgt_opt,
+             beam_hyps_cum_log_probs_opt, beam_hyps_normed_scores_opt, beam_hyps_log_probs_opt,
+             beam_hyps_min_normed_scores_opt, beam_hyps_num_beams_opt, beam_hyps_is_done_opt})
+    {
+        if (tensor.has_value())
+        {
+            registered_tensors_.push_back(tensor.value());
+        }
+    }
+
+    // The step arguments and the logits are set by forwardStep
+    registered_forward_params_
+        = std::make_unique<ForwardParams>(0, 0, 0, 0, 0, tc::Tensor{}, convert_tensor<int>(end_id));
+    updateForwardParams<T>(*registered_forward_params_, embedding_bias_opt, input_lengths_opt,
+        sequence_limit_length_opt, stop_words_list_opt, bad_words_list_opt, no_repeat_ngram_size_opt, finished_input);
+
+    registered_output_params_ = std::make_unique<OutputParams>(convert_tensor<int>(output_token_ids));
+    updateOutputParams<T>(*registered_output_params_, input_lengths_opt, newTokens, finished_output,
+        sequence_lengths_opt, cum_log_probs_opt, output_log_probs_opt, parent_ids_opt, beam_hyps_output_ids_tgt_opt,
+        beam_hyps_sequence_lengths_tgt_opt, beam_hyps_cum_log_probs_opt, beam_hyps_normed_scores_opt,
+        beam_hyps_log_probs_opt, beam_hyps_min_normed_scores_opt, beam_hyps_num_beams_opt, beam_hyps_is_done_opt,
+        use_beam_hyps);
+    if (registered_forward_params_->sequence_limit_length && registered_output_params_->finished.has_value())
+    {
+        registered_output_params_->finished_sum = tcc::toTllmTensor(*finished_sum_);
+    }
+
+    registered_cache_indirections_[0].reset();
+    registered_cache_indirections_[1].reset();
+    safeUpdate<int>(cache_indirection_0_opt, registered_cache_indirections_[0]);
+    safeUpdate<int>(cache_indirection_1_opt, registered_cache_indirections_[1]);
+}
+
+template <typename T>
+void FtDynamicDecode<T>::forwardStep(th::Tensor& logits, // (batch_size, beam_width, hidden_size)
+    int step, int max_input_length, int max_attention_window, uint64_t ite, int local_batch_size,
+    int src_cache_indirection_index, th::Tensor& should_stop)
+{
+    TLLM_CHECK_WITH_INFO(registered_forward_params_ != nullptr, "forward_step requires register_buffers first.");
+    TLLM_CHECK_WITH_INFO(src_cache_indirection_index == 0 || src_cache_indirection_index == 1,
+        "src_cache_indirection_index must be 0 or 1, but got %d.", src_cache_indirection_index);
+
+    auto& forwardParams = *registered_forward_params_;
+    forwardParams.step = step;
+    forwardParams.ite = static_cast<int>(ite);
+    forwardParams.max_input_length = max_input_length;
+    forwardParams.max_attention_window = max_attention_window;
+    forwardParams.local_batch_size = local_batch_size;
+    forwardParams.logits = convert_tensor<float>(logits);
+    forwardParams.src_cache_indirection = registered_cache_indirections_[src_cache_indirection_index];
+
+    auto& outputParams = *registered_output_params_;
+    outputParams.tgt_cache_indirection = registered_cache_indirections_[1 - src_cache_indirection_index];
+
+    forward(forwardParams, outputParams, should_stop);
+}
+
+template <typename T>
+void FtDynamicDecode<T>::forward(
+    ForwardParams const& forwardParams, OutputParams& outputParams, th::Tensor& should_stop)
+{
+    std::int32_t* finished_sum_host = nullptr;
+    if (outputParams.finished_sum.has_value())
+    {
+        finished_sum_host = tr::bufferCast<std::int32_t>(*finished_sum_);
+        *finished_sum_host = 0;
+    }
 
     dynamic_decode_layer_->forward(outputParams, forwardParams);
     if (finished_sum_host)
@@ -345,10 +468,74 @@ th::Tensor DynamicDecodeOp::forward(th::Tensor logits, int64_t step, int64_t max
     return should_stop;
 }
 
+void DynamicDecodeOp::registerBuffers(th::Tensor end_id, th::optional<th::Tensor> embedding_bias_opt,
+    th::optional<th::Tensor> input_lengths_opt, th::optional<th::Tensor> sequence_limit_length_opt,
+    th::optional<th::Tensor> stop_words_list_opt, th::optional<th::Tensor> bad_words_list_opt,
+    th::optional<th::Tensor> no_repeat_ngram_size_opt, th::optional<th::Tensor> cache_indirection_0_opt,
+    th::optional<th::Tensor> cache_indirection_1_opt,
+    // output buffers.
+    th::Tensor output_token_ids, th::Tensor newTokens, th::optional<th::Tensor> finished_input,
+    th::optional<th::Tensor> finished_output, th::optional<th::Tensor> sequence_lengths_opt,
+    th::optional<th::Tensor> cum_log_probs_opt, th::optional<th::Tensor> output_log_probs_opt,
+    th::optional<th::Tensor> parent_ids_opt, th::optional<th::Tensor> beam_hyps_output_ids_tgt_opt,
+    th::optional<th::Tensor> beam_hyps_sequence_lengths_tgt_opt, th::optional<th::Tensor> beam_hyps_cum_log_probs_opt,
+    th::optional<th::Tensor> beam_hyps_normed_scores_opt, th::optional<th::Tensor> beam_hyps_log_probs_opt,
+    th::optional<th::Tensor> beam_hyps_min_normed_scores_opt, th::optional<th::Tensor> beam_hyps_num_beams_opt,
+    th::optional<th::Tensor> beam_hyps_is_done_opt, bool use_beam_hyps)
+{
+    CHECK_INPUT(end_id, torch::kInt32);
+
+    CHECK_OPTIONAL_INPUT(input_lengths_opt, torch::kInt32);
+    CHECK_OPTIONAL_INPUT(sequence_limit_length_opt, torch::kInt32);
+    CHECK_OPTIONAL_INPUT(stop_words_list_opt, torch::kInt32);
+    CHECK_OPTIONAL_INPUT(bad_words_list_opt, torch::kInt32);
+    CHECK_OPTIONAL_INPUT(no_repeat_ngram_size_opt, torch::kInt32);
+    CHECK_OPTIONAL_INPUT(cache_indirection_0_opt, torch::kInt32);
+    CHECK_OPTIONAL_INPUT(cache_indirection_1_opt, torch::kInt32);
+
+    CHECK_INPUT(output_token_ids, torch::kInt32);
+    CHECK_OPTIONAL_INPUT(finished_input, torch::kUInt8);
+    CHECK_OPTIONAL_INPUT(finished_output, torch::kUInt8);
+    CHECK_OPTIONAL_INPUT(sequence_lengths_opt, torch::kInt32);
+    CHECK_OPTIONAL_INPUT(cum_log_probs_opt, torch::kFloat32);
+    CHECK_OPTIONAL_INPUT(output_log_probs_opt, torch::kFloat32);
+    CHECK_OPTIONAL_INPUT(parent_ids_opt, torch::kInt32);
+
+    should_stop_ = torch::zeros({1}, torch::dtype(torch::kBool).requires_grad(false));
+
+    dynamic_decode_->registerBuffers(end_id, embedding_bias_opt, input_lengths_opt, sequence_limit_length_opt,
+        stop_words_list_opt, bad_words_list_opt, no_repeat_ngram_size_opt, cache_indirection_0_opt,
+        cache_indirection_1_opt, output_token_ids, newTokens, finished_input, finished_output, sequence_lengths_opt,
+        cum_log_probs_opt, output_log_probs_opt, parent_ids_opt, beam_hyps_output_ids_tgt_opt,
+        beam_hyps_sequence_lengths_tgt_opt, beam_hyps_cum_log_probs_opt, beam_hyps_normed_scores_opt,
+        beam_hyps_log_probs_opt, beam_hyps_min_normed_scores_opt, beam_hyps_num_beams_opt, beam_hyps_is_done_opt,
+        use_beam_hyps);
+}
+
+th::Tensor DynamicDecodeOp::forwardStep(th::Tensor logits, int64_t step, int64_t max_input_length,
+    int64_t max_attention_window, int64_t ite, int64_t local_batch_size, int64_t src_cache_indirection_index)
+{
+    CHECK_INPUT(logits, scalar_type_);
+    TLLM_CHECK_WITH_INFO(logits.dim() == 3 && static_cast<size_t>(logits.size(2)) == vocab_size_padded_,
+        "logits is of shape (batch_size, beam_width, vocab_size(%ld)), but got shape=%s", vocab_size_padded_,
+        tensorrt_llm::common::vec2str(convert_shape(logits)).c_str());
+    TLLM_CHECK_WITH_INFO(should_stop_.defined(), "forward_step requires register_buffers first.");
+
+    should_stop_.data_ptr<bool>()[0] = false;
+
+    dynamic_decode_->forwardStep(logits, static_cast<int>(step), static_cast<int>(max_input_length),
+        static_cast<int>(max_attention_window), static_cast<uint32_t>(ite), static_cast<int>(local_batch_size),
+        static_cast<int>(src_cache_indirection_index), should_stop_);
+
+    return should_stop_;
+}
+
 } // namespace torch_ext
 
 static auto fasterTransformerGptContextDecoderTHS
     = torch::jit::class_<torch_ext::DynamicDecodeOp>("FasterTransformer", "DynamicDecodeOp")
           .def(torch::jit::init<int64_t, int64_t, int64_t, int64_t, at::ScalarType>())
           .def("setup", &torch_ext::DynamicDecodeOp::setup)
-          .def("forward", &torch_ext::DynamicDecodeOp::forward);
+          .def("forward", &torch_ext::DynamicDecodeOp::forward)
+          .def("register_buffers", &torch_ext::DynamicDecodeOp::registerBuffers)
+          .def("forward_step", &torch_ext::DynamicDecodeOp::forwardStep);
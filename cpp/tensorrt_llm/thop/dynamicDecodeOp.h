@@ -54,6 +54,28 @@ public:
         th::optional<th::Tensor> beam_hyps_num_beams_opt, th::optional<th::Tensor> beam_hyps_is_done_opt,
         bool use_beam_hyps)
         = 0;
+
+    virtual void registerBuffers(th::Tensor end_id, th::optional<th::Tensor> embedding_bias_opt,
+        th::optional<th::Tensor> input_lengths_opt, th::optional<th::Tensor> sequence_limit_length_opt,
+        th::optional<th::Tensor> stop_words_list_opt, th::optional<th::Tensor> bad_words_list_opt,
+        th::optional<th::Tensor> no_repeat_ngram_size_opt, th::optional<th::Tensor> cache_indirection_0_opt,
+        th::optional<th::Tensor> cache_indirection_1_opt,
+        // Outputs
+        th::Tensor output_token_ids, th::Tensor newTokens, th::optional<th::Tensor> finished_input,
+        th::optional<th::Tensor> finished_output, th::optional<th::Tensor> sequence_lengths_opt,
+        th::optional<th::Tensor> cum_log_probs_opt, th::optional<th::Tensor> output_log_probs_opt,
+        th::optional<th::Tensor> parent_ids_opt, th::optional<th::Tensor> beam_hyps_output_ids_tgt_opt,
+        th::optional<th::Tensor> beam_hyps_sequence_lengths_tgt_opt,
+        th::optional<th::Tensor> beam_hyps_cum_log_probs_opt, th::optional<th::Tensor> beam_hyps_normed_scores_opt,
+        th::optional<th::Tensor> beam_hyps_log_probs_opt, th::optional<th::Tensor> beam_hyps_min_normed_scores_opt,
+        th::optional<th::Tensor> beam_hyps_num_beams_opt, th::optional<th::Tensor> beam_hyps_is_done_opt,
+        bool use_beam_hyps)
+        = 0;
+
+    virtual void forwardStep(th::Tensor& logits, // (batch_size, beam_width, hidden_size)
+        int step, int max_input_length, int max_attention_window, uint64_t ite, int local_batch_size,
+        int src_cache_indirection_index, th::Tensor& should_stop)
+        = 0;
 };
 
 template <typename T>
@@ -91,7 +113,32 @@ public:
         th::optional<th::Tensor> beam_hyps_num_beams_opt, th::optional<th::Tensor> beam_hyps_is_done_opt,
         bool use_beam_hyps) override;
 
+    void registerBuffers(th::Tensor end_id, th::optional<th::Tensor> embedding_bias_opt,
+        th::optional<th::Tensor> input_lengths_opt, th::optional<th::Tensor> sequence_limit_length_opt,
+        th::optional<th::Tensor> stop_words_list_opt, th::optional<th::Tensor> bad_words_list_opt,
+        th::optional<th::Tensor> no_repeat_ngram_size_opt, th::optional<th::Tensor> cache_indirection_0_opt,
+        th::optional<th::Tensor> cache_indirection_1_opt,
+        // Outputs
+        th::Tensor output_token_ids, th::Tensor newTokens, th::optional<th::Tensor> finished_input,
+        th::optional<th::Tensor> finished_output, th::optional<th::Tensor> sequence_lengths_opt,
+        th::optional<th::Tensor> cum_log_probs_opt, th::optional<th::Tensor> output_log_probs_opt,
+        th::optional<th::Tensor> parent_ids_opt, th::optional<th::Tensor> beam_hyps_output_ids_tgt_opt,
+        th::optional<th::Tensor> beam_hyps_sequence_lengths_tgt_opt,
+        th::optional<th::Tensor> beam_hyps_cum_log_probs_opt, th::optional<th::Tensor> beam_hyps_normed_scores_opt,
+        th::optional<th::Tensor> beam_hyps_log_probs_opt, th::optional<th::Tensor> beam_hyps_min_normed_scores_opt,
+        th::optional<th::Tensor> beam_hyps_num_beams_opt, th::optional<th::Tensor> beam_hyps_is_done_opt,
+        bool use_beam_hyps) override;
+
+    void forwardStep(th::Tensor& logits, // (batch_size, beam_width, hidden_size)
+        int step, int max_input_length, int max_attention_window, uint64_t ite, int local_batch_size,
+        int src_cache_indirection_index, th::Tensor& should_stop) override;
+
 private:
+    using ForwardParams = typename tensorrt_llm::layers::DynamicDecodeLayer<T>::ForwardParams;
+    using OutputParams = typename tensorrt_llm::layers::DynamicDecodeLayer<T>::OutputParams;
+
+    void forward(ForwardParams const& forwardParams, OutputParams& outputParams, th::Tensor& should_stop);
+
     const size_t vocab_size_;
     const size_t vocab_size_padded_;
 
@@ -99,6 +146,12 @@ private:
 
     std::shared_ptr<tensorrt_llm::layers::DynamicDecodeLayer<T>> dynamic_decode_layer_;
     tensorrt_llm::runtime::ITensor::SharedPtr finished_sum_;
+
+    // The buffers of registerBuffers, converted once and reused by every forwardStep until the next registerBuffers
+    std::vector<th::Tensor> registered_tensors_;
+    std::unique_ptr<ForwardParams> registered_forward_params_;
+    std::unique_ptr<OutputParams> registered_output_params_;
+    std::optional<tc::Tensor> registered_cache_indirections_[2];
 };
 
 class DynamicDecodeOp : public th::jit::CustomClassHolder
@@ -135,6 +188,29 @@ public:
         th::optional<th::Tensor> beam_hyps_num_beams_opt, th::optional<th::Tensor> beam_hyps_is_done_opt,
         bool use_beam_hyps);
 
+    // Registers the tensors that stay the same during a generation, see forward for their shapes. The two cache
+    // indirections are swapped at each step, src_cache_indirection_index of forward_step selects the source.
+    void registerBuffers(th::Tensor end_id, th::optional<th::Tensor> embedding_bias_opt,
+        th::optional<th::Tensor> input_lengths_opt, th::optional<th::Tensor> sequence_limit_length_opt,
+        th::optional<th::Tensor> stop_words_list_opt, th::optional<th::Tensor> bad_words_list_opt,
+        th::optional<th::Tensor> no_repeat_ngram_size_opt, th::optional<th::Tensor> cache_indirection_0_opt,
+        th::optional<th::Tensor> cache_indirection_1_opt,
+        // output buffers.
+        th::Tensor output_token_ids, th::Tensor newTokens, th::optional<th::Tensor> finished_input,
+        th::optional<th::Tensor> finished_output, th::optional<th::Tensor> sequence_lengths_opt,
+        th::optional<th::Tensor> cum_log_probs_opt, th::optional<th::Tensor> output_log_probs_opt,
+        th::optional<th::Tensor> parent_ids_opt, th::optional<th::Tensor> beam_hyps_output_ids_tgt_opt,
+        th::optional<th::Tensor> beam_hyps_sequence_lengths_tgt_opt,
+        th::optional<th::Tensor> beam_hyps_cum_log_probs_opt, th::optional<th::Tensor> beam_hyps_normed_scores_opt,
+        th::optional<th::Tensor> beam_hyps_log_probs_opt, th::optional<th::Tensor> beam_hyps_min_normed_scores_opt,
+        th::optional<th::Tensor> beam_hyps_num_beams_opt, th::optional<th::Tensor> beam_hyps_is_done_opt,
+        bool use_beam_hyps);
+
+    // Decodes a step with the registered buffers. The returned should_stop is the same tensor at every step.
+    th::Tensor forwardStep(th::Tensor logits, // (batch_size, beam_width, vocab_size)
+        int64_t step, int64_t max_input_length, int64_t max_attention_window, int64_t ite, int64_t local_batch_size,
+        int64_t src_cache_indirection_index);
+
 private:
     size_t const vocab_size_;
     size_t const vocab_size_padded_;
@@ -145,6 +221,8 @@ private:
     at::ScalarType scalar_type_;
     // FT Dynamic decode layer wrapper instance.
     std::unique_ptr<IFtDynamicDecode> dynamic_decode_;
+    // Returned by forwardStep, allocated by registerBuffers
+    th::Tensor should_stop_;
 
     void createInstance();
 };
@@ -18,6 +18,8 @@
 #include "tensorrt_llm/common/cudaUtils.h"
 #include "tensorrt_llm/thop/thUtils.h"
 
+#include <c10/cuda/CUDACachingAllocator.h>
+
 using namespace tensorrt_llm::thop;
 using namespace tensorrt_llm::common;
 
@@ -72,3 +74,62 @@ void TorchAllocator::memSet(void* ptr, int const val, size_t const size)
 {
     check_cuda_error(cudaMemsetAsync(ptr, val, size, mStream));
 }
+
+namespace
+{
+
+std::size_t currentBytes(c10::cuda::CUDACachingAllocator::StatArray const& stats)
+{
+    auto const& stat = stats[static_cast<std::size_t>(c10::cuda::CUDACachingAllocator::StatType::AGGREGATE)];
+    return static_cast<std::size_t>(stat.current);
+}
+
+} // namespace
+
+TorchGpuAllocator::TorchGpuAllocator(int device)
+    : mDevice{device}
+{
+    if (mDevice < 0)
+    {
+        check_cuda_error(cudaGetDevice(&mDevice));
+    }
+}
+
+void* TorchGpuAllocator::allocate(std::size_t size, cudaStream_t stream)
+{
+    // The caching allocator reuses the blocks freed on the same stream without waiting, as the buffers of the runtime
+    return c10::cuda::CUDACachingAllocator::raw_alloc_with_stream(size, stream);
+}
+
+void TorchGpuAllocator::deallocate(void* ptr, [[maybe_unused]] std::size_t size, [[maybe_unused]] cudaStream_t stream)
+{
+    c10::cuda::CUDACachingAllocator::raw_delete(ptr);
+}
+
+std::size_t TorchGpuAllocator::reserved() const
+{
+    return currentBytes(c10::cuda::CUDACachingAllocator::getDeviceStats(mDevice).reserved_bytes);
+}
+
+std::size_t TorchGpuAllocator::used() const
+{
+    return currentBytes(c10::cuda::CUDACachingAllocator::getDeviceStats(mDevice).allocated_bytes);
+}
+
+std::size_t TorchGpuAllocator::usedHigh() const
+{
+    auto const stats = c10::cuda::CUDACachingAllocator::getDeviceStats(mDevice);
+    auto const& allocated
+        = stats.allocated_bytes[static_cast<std::size_t>(c10::cuda::CUDACachingAllocator::StatType::AGGREGATE)];
+    return static_cast<std::size_t>(allocated.peak);
+}
+
+void TorchGpuAllocator::resetUsedHigh()
+{
+    c10::cuda::CUDACachingAllocator::resetPeakStats(mDevice);
+}
+
+void TorchGpuAllocator::releaseCached()
+{
+    c10::cuda::CUDACachingAllocator::emptyCache();
+}
@@ -17,6 +17,7 @@
 #pragma once
 
 #include "tensorrt_llm/common/allocator.h"
+#include "tensorrt_llm/runtime/iGpuAllocator.h"
 
 #ifdef TORCH_CUDA
 #include "torch/extension.h"
@@ -63,5 +64,32 @@ private:
     cudaStream_t mStream{};
 };
 
+//! \brief Allocates the GPU buffers of the runtime from the caching allocator of PyTorch, see
+//! `GptSession::Options::gpuAllocator`. The memory freed by either side can be reused by the other one, and the
+//! statistics of the memory pool of the runtime are the ones of PyTorch for the device.
+class TorchGpuAllocator : public tensorrt_llm::runtime::IGpuAllocator
+{
+public:
+    //! \param device The device of the allocations, the current one if negative.
+    explicit TorchGpuAllocator(int device = -1);
+
+    [[nodiscard]] void* allocate(std::size_t size, cudaStream_t stream) override;
+
+    void deallocate(void* ptr, std::size_t size, cudaStream_t stream) override;
+
+    [[nodiscard]] std::size_t reserved() const override;
+
+    [[nodiscard]] std::size_t used() const override;
+
+    [[nodiscard]] std::size_t usedHigh() const override;
+
+    void resetUsedHigh() override;
+
+    void releaseCached() override;
+
+private:
+    int mDevice;
+};
+
 } // namespace thop
 } // namespace tensorrt_llm
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <mutex>
+#include <vector>
+
+#include "tensorrt_llm/batch_manager/asyncCallbacks.h"
+
+using namespace tensorrt_llm::batch_manager;
+
+TEST(AsyncCallbacks, Requests)
+{
+    AsyncCallbacks callbacks([](std::list<Response> const&) {});
+    auto getRequests = callbacks.getInferenceRequestsCallback();
+    EXPECT_TRUE(getRequests(8).empty());
+    for (int i = 0; i < 3; ++i)
+    {
+        callbacks.enqueueRequest(nullptr);
+    }
+    EXPECT_EQ(getRequests(0).size(), 0);
+    EXPECT_EQ(getRequests(2).size(), 2);
+    EXPECT_EQ(getRequests(2).size(), 1);
+}
+
+TEST(AsyncCallbacks, Responses)
+{
+    std::mutex mutex;
+    std::vector<uint64_t> ids;
+    std::vector<std::size_t> batchSizes;
+    {
+        AsyncCallbacks callbacks(
+            [&](std::list<Response> const& responses)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                batchSizes.push_back(responses.size());
+                for (auto const& response : responses)
+                {
+                    ids.push_back(response.requestId);
+                }
+            },
+            4);
+        auto sendResponse = callbacks.sendResponseCallback();
+        for (uint64_t id = 0; id < 10; ++id)
+        {
+            sendResponse(id, {}, id == 9, "");
+        }
+        // Queued responses are delivered before the destructor returns
+    }
+    EXPECT_EQ(ids, (std::vector<uint64_t>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+    for (auto const batchSize : batchSizes)
+    {
+        EXPECT_LE(batchSize, 4);
+    }
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorrt_llm/batch_manager/flightRecorder.h"
+
+using namespace tensorrt_llm::batch_manager;
+
+namespace
+{
+
+IterationStats makeStats(int64_t iteration, IterationStats::SizeType usedKvBlocks)
+{
+    IterationStats stats;
+    stats.iterationCounter = iteration;
+    stats.usedNumKvBlocks = usedKvBlocks;
+    stats.numScheduledRequests = 2;
+    stats.forwardTime = std::chrono::microseconds{100 + iteration};
+    return stats;
+}
+
+} // namespace
+
+TEST(FlightRecorder, Ring)
+{
+    std::list<std::shared_ptr<LlmRequest>> requests;
+    for (uint64_t id : {7, 9})
+    {
+        auto tokens = std::make_shared<LlmRequest::VecTokens>(4, 1);
+        requests.push_back(
+            std::make_shared<LlmRequest>(id, 8, tokens, tensorrt_llm::runtime::SamplingConfig{1}, false));
+    }
+
+    FlightRecorder recorder(4);
+    EXPECT_TRUE(recorder.getRecords().empty());
+    recorder.record(makeStats(0, 10), requests);
+    recorder.record(makeStats(1, 6), requests);
+    auto records = recorder.getRecords();
+    ASSERT_EQ(records.size(), 2);
+    EXPECT_EQ(records[0].kvBlocksAllocated, 10);
+    EXPECT_EQ(records[1].kvBlocksFreed, 4);
+    EXPECT_EQ(records[1].forwardTimeUs, 101);
+    EXPECT_EQ(records[1].requestIds[0], 7);
+    EXPECT_EQ(records[1].requestIds[1], 9);
+
+    // The oldest slot is left out, it may be the one being overwritten
+    for (int64_t iteration = 2; iteration < 10; ++iteration)
+    {
+        recorder.record(makeStats(iteration, 6));
+    }
+    records = recorder.getRecords();
+    ASSERT_EQ(records.size(), 3);
+    EXPECT_EQ(records.front().iterationCounter, 7);
+    EXPECT_EQ(records.back().iterationCounter, 9);
+}
+
+TEST(FlightRecorder, Dump)
+{
+    FlightRecorder recorder(8);
+    for (int64_t iteration = 0; iteration < 3; ++iteration)
+    {
+        recorder.record(makeStats(iteration, 1));
+    }
+    auto const path = ::testing::TempDir() + "flightRecorderTest.bin";
+    ASSERT_TRUE(recorder.dump(path.c_str()));
+
+    std::ifstream file(path, std::ios::binary);
+    FlightRecordFileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    EXPECT_EQ(header.magic, FlightRecordFileHeader::kMagic);
+    EXPECT_EQ(header.recordSize, sizeof(FlightRecord));
+    ASSERT_EQ(header.numRecords, 3);
+    std::vector<FlightRecord> records(header.numRecords);
+    file.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(FlightRecord));
+    ASSERT_TRUE(file.good());
+    EXPECT_EQ(records[2].iterationCounter, 2);
+    EXPECT_EQ(records[2].forwardTimeUs, 102);
+    file.close();
+
+    // An exception dumps the installed recorder
+    std::remove(path.c_str());
+    FlightRecorder::install(recorder, path);
+    EXPECT_THROW(throw NEW_TLLM_EXCEPTION("test"), tensorrt_llm::common::TllmException);
+    EXPECT_TRUE(std::ifstream(path).good());
+    tensorrt_llm::common::TllmException::setCreationHook(nullptr);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "tensorrt_llm/batch_manager/iterationStats.h"
+#include "tensorrt_llm/batch_manager/kvCacheManager.h"
+
+using namespace tensorrt_llm::batch_manager;
+
+TEST(IterationStats, ScheduledRequests)
+{
+    std::list<std::shared_ptr<LlmRequest>> requests;
+    for (int i = 0; i < 3; ++i)
+    {
+        auto tokens = std::make_shared<LlmRequest::VecTokens>(10 + i, 1);
+        requests.push_back(std::make_shared<LlmRequest>(i, 8, tokens, tensorrt_llm::runtime::SamplingConfig{2}, false));
+    }
+    requests.front()->mState = REQUEST_STATE_GENERATION_IN_PROGRESS;
+
+    IterationStats stats;
+    stats.addScheduledRequests(requests);
+    EXPECT_EQ(stats.numScheduledRequests, 3);
+    EXPECT_EQ(stats.numContextRequests, 2);
+    EXPECT_EQ(stats.numContextTokens, 11 + 12);
+    EXPECT_EQ(stats.numGenerationRequests, 1);
+    EXPECT_EQ(stats.numGenerationTokens, 2);
+
+    stats.forwardTime = std::chrono::microseconds{300};
+    stats.scheduleTime = std::chrono::microseconds{20};
+    EXPECT_EQ(stats.getStepTime().count(), 320);
+    auto const json = toJson(stats);
+    EXPECT_NE(json.find("\"Context Requests\":2"), std::string::npos);
+    EXPECT_NE(json.find("\"Forward Time (us)\":300"), std::string::npos);
+}
+
+TEST(IterationStats, Queue)
+{
+    IterationStatsQueue queue(2);
+    for (int64_t i = 0; i < 3; ++i)
+    {
+        IterationStats stats;
+        stats.iterationCounter = i;
+        queue.push(stats);
+    }
+    EXPECT_EQ(queue.getNumDropped(), 1);
+    std::vector<IterationStats> out;
+    EXPECT_EQ(queue.popAll(out), 2);
+    EXPECT_EQ(out.at(0).iterationCounter, 0);
+    EXPECT_EQ(out.at(1).iterationCounter, 1);
+}
+
+TEST(IterationStats, CommStats)
+{
+    using tensorrt_llm::common::CommIterationStats;
+    using tensorrt_llm::common::CommOp;
+
+    std::vector<CommIterationStats> collected(2);
+    collected[0][CommOp::kALL_REDUCE] = {4, 4096, 0.25F};
+    collected[1][CommOp::kALL_REDUCE] = {2, 1024, 0.25F};
+    collected[1][CommOp::kSEND] = {1, 512, 0.5F};
+
+    IterationStats stats;
+    stats.iterationCounter = 7;
+    stats.addCommStats(collected);
+    EXPECT_EQ(stats.commStats.iteration, 7);
+    EXPECT_EQ(stats.commStats[CommOp::kALL_REDUCE].count, 6);
+    EXPECT_EQ(stats.commStats[CommOp::kALL_REDUCE].bytes, 5120);
+    EXPECT_EQ(stats.commStats.getTotal().bytes, 5632);
+
+    auto const json = toJson(stats);
+    EXPECT_NE(json.find("\"Comm Time (us)\":1000"), std::string::npos);
+    EXPECT_NE(json.find("\"AllReduce Bytes\":5120"), std::string::npos);
+    EXPECT_NE(json.find("\"Send Time (us)\":500"), std::string::npos);
+    EXPECT_EQ(json.find("AllGather"), std::string::npos);
+}
+
+TEST(IterationStats, MemoryStats)
+{
+    using tensorrt_llm::runtime::MemoryTag;
+
+    IterationStats stats;
+    stats.gpuMemoryByTag[static_cast<std::size_t>(MemoryTag::kKV_CACHE)] = 1 << 30;
+    stats.gpuMemoryByTag[static_cast<std::size_t>(MemoryTag::kDECODER)] = 4096;
+
+    auto const json = toJson(stats);
+    EXPECT_NE(json.find("\"KV cache GPU Memory (bytes)\":1073741824"), std::string::npos);
+    EXPECT_NE(json.find("\"Decoder GPU Memory (bytes)\":4096"), std::string::npos);
+    EXPECT_EQ(json.find("Scratch GPU Memory"), std::string::npos);
+    EXPECT_EQ(json.find("Memory Pool"), std::string::npos);
+}
+
+TEST(IterationStats, MemoryPoolStats)
+{
+    struct FakeBufferManager
+    {
+        [[nodiscard]] std::size_t memoryPoolReserved() const
+        {
+            return 8192;
+        }
+
+        [[nodiscard]] std::size_t memoryPoolUsed() const
+        {
+            return 4096;
+        }
+
+        [[nodiscard]] std::size_t memoryPoolReleaseThreshold() const
+        {
+            return 2048;
+        }
+
+        [[nodiscard]] bool hasDedicatedMemoryPool() const
+        {
+            return true;
+        }
+    };
+
+    IterationStats stats;
+    stats.addMemoryPoolStats(FakeBufferManager{});
+    EXPECT_EQ(stats.memoryPoolReserved, 8192);
+    EXPECT_EQ(stats.memoryPoolUsed, 4096);
+
+    auto const json = toJson(stats);
+    EXPECT_NE(json.find("\"Memory Pool Reserved (bytes)\":8192"), std::string::npos);
+    EXPECT_NE(json.find("\"Memory Pool Used (bytes)\":4096"), std::string::npos);
+    EXPECT_NE(json.find("\"Memory Pool Release Threshold (bytes)\":2048"), std::string::npos);
+    EXPECT_NE(json.find("\"Memory Pool Dedicated\":true"), std::string::npos);
+}
+
+namespace
+{
+
+struct FakeKvCacheManager
+{
+    [[nodiscard]] kv_cache_manager::KvCacheStats getKvCacheStats() const
+    {
+        return {16, 6, 10, 64};
+    }
+};
+
+// Found by IterationStats::addKvCacheStats like kv_cache_manager::getKvCacheReuseStats
+kv_cache_manager::KvCacheReuseStats getKvCacheReuseStats(FakeKvCacheManager const&)
+{
+    return {12, 9, 3};
+}
+
+} // namespace
+
+TEST(IterationStats, KvCacheStats)
+{
+    IterationStats stats;
+    stats.addKvCacheStats(FakeKvCacheManager{});
+    EXPECT_EQ(stats.maxNumKvBlocks, 16);
+    EXPECT_EQ(stats.usedNumKvBlocks, 10);
+    EXPECT_EQ(stats.reusedNumKvBlocks, 3);
+    EXPECT_EQ(stats.newNumKvBlocks, 9);
+
+    auto const json = toJson(stats);
+    EXPECT_NE(json.find("\"Reused KV cache blocks\":3"), std::string::npos);
+    EXPECT_NE(json.find("\"New KV cache blocks\":9"), std::string::npos);
+}
+
+TEST(IterationStats, LayerProfile)
+{
+    using tensorrt_llm::runtime::LayerKind;
+    using tensorrt_llm::runtime::LayerProfileStats;
+
+    IterationStats stats;
+    EXPECT_EQ(toJson(stats).find("Layers Time"), std::string::npos);
+
+    LayerProfileStats profile;
+    profile.numProfiledEnqueues = 1;
+    profile[LayerKind::kATTENTION] = {24, 1.5F};
+    profile[LayerKind::kGEMM] = {96, 2.F};
+    stats.addLayerProfile(profile);
+    stats.addLayerProfile(profile);
+    EXPECT_EQ(stats.layerProfile.numProfiledEnqueues, 2);
+    EXPECT_EQ(stats.layerProfile[LayerKind::kGEMM].count, 192);
+    EXPECT_FLOAT_EQ(stats.layerProfile.getTotalTimeMs(), 7.F);
+
+    auto const json = toJson(stats);
+    EXPECT_NE(json.find("\"Profiled Enqueues\":2"), std::string::npos);
+    EXPECT_NE(json.find("\"Attention Layers Time (us)\":3000"), std::string::npos);
+    EXPECT_NE(json.find("\"GEMM Layers Time (us)\":4000"), std::string::npos);
+    EXPECT_NE(json.find("\"Collective Layers Time (us)\":0"), std::string::npos);
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tensorrt_llm/batch_manager/metricsRegistry.h"
+
+using namespace tensorrt_llm::batch_manager;
+
+namespace
+{
+
+bool contains(std::string const& text, std::string const& line)
+{
+    return text.find(line + "\n") != std::string::npos;
+}
+
+} // namespace
+
+TEST(MetricsRegistry, Histogram)
+{
+    MetricsHistogram histogram({1.0, 2.0, 4.0});
+    for (auto value : {0.5, 1.0, 3.0, 8.0})
+    {
+        histogram.observe(value);
+    }
+    EXPECT_EQ(histogram.getCumulativeCounts(), (std::vector<uint64_t>{2, 2, 3, 4}));
+    EXPECT_DOUBLE_EQ(histogram.getSum(), 12.5);
+    EXPECT_EQ(MetricsHistogram::exponentialBounds(1.0, 2.0, 3), (std::vector<double>{1.0, 2.0, 4.0}));
+}
+
+TEST(MetricsRegistry, Prometheus)
+{
+    MetricsRegistry registry;
+    auto& requests = registry.addCounter("requests_total", "Requests.", "phase=\"context\"");
+    registry.addCounter("requests_total", "Requests.", "phase=\"generation\"").add(2);
+    auto& active = registry.addGauge("active", "Active.");
+    auto& latency = registry.addHistogram("latency_seconds", "Latency.", {0.1, 1.0});
+    EXPECT_THROW(registry.addGauge("requests_total", "Requests."), std::exception);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i)
+    {
+        threads.emplace_back(
+            [&]()
+            {
+                for (int j = 0; j < 1000; ++j)
+                {
+                    requests.add();
+                }
+            });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    active.set(3);
+    latency.observe(0.5);
+
+    auto const text = registry.toPrometheus();
+    EXPECT_TRUE(contains(text, "# HELP requests_total Requests."));
+    EXPECT_TRUE(contains(text, "# TYPE requests_total counter"));
+    EXPECT_TRUE(contains(text, "requests_total{phase=\"context\"} 4000"));
+    EXPECT_TRUE(contains(text, "requests_total{phase=\"generation\"} 2"));
+    EXPECT_TRUE(contains(text, "# TYPE active gauge"));
+    EXPECT_TRUE(contains(text, "active 3"));
+    EXPECT_TRUE(contains(text, "# TYPE latency_seconds histogram"));
+    EXPECT_TRUE(contains(text, "latency_seconds_bucket{le=\"0.1\"} 0"));
+    EXPECT_TRUE(contains(text, "latency_seconds_bucket{le=\"1\"} 1"));
+    EXPECT_TRUE(contains(text, "latency_seconds_bucket{le=\"+Inf\"} 1"));
+    EXPECT_TRUE(contains(text, "latency_seconds_sum 0.5"));
+    EXPECT_TRUE(contains(text, "latency_seconds_count 1"));
+}
+
+TEST(MetricsRegistry, BatchManagerMetrics)
+{
+    IterationStats stats;
+    stats.numActiveRequests = 5;
+    stats.numQueuedRequests = 2;
+    stats.numContextTokens = 100;
+    stats.numGenerationTokens = 4;
+    stats.usedNumKvBlocks = 7;
+    stats.reusedNumKvBlocks = 3;
+    stats.forwardTime = std::chrono::microseconds{1500};
+    stats.scheduleTime = std::chrono::microseconds{500};
+
+    BatchManagerMetrics metrics;
+    metrics.record(stats);
+    metrics.record(stats);
+
+    auto const text = metrics.getRegistry().toPrometheus();
+    EXPECT_TRUE(contains(text, "tensorrt_llm_iterations_total 2"));
+    EXPECT_TRUE(contains(text, "tensorrt_llm_iteration_latency_seconds_count 2"));
+    EXPECT_TRUE(contains(text, "tensorrt_llm_phase_latency_seconds_count{phase=\"forward\"} 2"));
+    EXPECT_TRUE(contains(text, "tensorrt_llm_active_requests 5"));
+    EXPECT_TRUE(contains(text, "tensorrt_llm_queued_requests 2"));
+    EXPECT_TRUE(contains(text, "tensorrt_llm_tokens_total{phase=\"context\"} 200"));
+    EXPECT_TRUE(contains(text, "tensorrt_llm_tokens_per_second 52000"));
+    EXPECT_TRUE(contains(text, "tensorrt_llm_kv_cache_blocks{state=\"used\"} 7"));
+    EXPECT_TRUE(contains(text, "tensorrt_llm_kv_cache_reused_blocks_total 3"));
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "tensorrt_llm/batch_manager/requestReplay.h"
+
+using namespace tensorrt_llm::batch_manager;
+
+namespace
+{
+
+using Requests = std::list<std::shared_ptr<InferenceRequest>>;
+
+Requests makeRequests(std::vector<uint64_t> const& requestIds)
+{
+    Requests requests;
+    for (auto const requestId : requestIds)
+    {
+        requests.push_back(std::make_shared<InferenceRequest>(requestId));
+    }
+    return requests;
+}
+
+std::vector<uint64_t> getRequestIds(Requests const& requests)
+{
+    std::vector<uint64_t> requestIds;
+    for (auto const& request : requests)
+    {
+        requestIds.push_back(request->getRequestId());
+    }
+    return requestIds;
+}
+
+std::filesystem::path record()
+{
+    auto const path = std::filesystem::path{testing::TempDir()} / "requests.bin";
+    RequestRecorder recorder(path);
+    std::vector<Requests> fetched{makeRequests({1, 2}), {}, makeRequests({3}), {}, makeRequests({4, 5, 6})};
+    std::size_t iteration = 0;
+    auto getRequests = recorder.wrapInferenceRequestsCallback(
+        [&](int32_t) { return iteration < fetched.size() ? fetched[iteration++] : Requests{}; });
+    auto pollStopSignals = recorder.wrapPollStopSignalCallback(
+        [&]() { return iteration == 3 ? std::unordered_set<uint64_t>{1} : std::unordered_set<uint64_t>{}; });
+    for (std::size_t i = 0; i < fetched.size(); ++i)
+    {
+        EXPECT_EQ(getRequests(8).size(), fetched[i].size());
+        pollStopSignals();
+    }
+    return path;
+}
+
+} // namespace
+
+TEST(RequestReplay, SameIterations)
+{
+    auto const path = record();
+    RequestReplayer replayer(path);
+    EXPECT_EQ(replayer.getNumRequests(), 6);
+    EXPECT_EQ(replayer.getMaxRequestId(), 6);
+
+    std::vector<std::vector<uint64_t>> expected{{1, 2}, {}, {3}, {}, {4, 5, 6}};
+    for (std::size_t i = 0; i < expected.size(); ++i)
+    {
+        EXPECT_FALSE(replayer.isDone());
+        EXPECT_EQ(getRequestIds(replayer.getRequests(8)), expected[i]);
+        auto const stopSignals = replayer.getStopSignals();
+        EXPECT_EQ(stopSignals.size(), i == 2 ? 1 : 0);
+    }
+    EXPECT_TRUE(replayer.isDone());
+    EXPECT_EQ(replayer.getNumReplayed(), 6);
+    EXPECT_TRUE(replayer.getRequests(8).empty());
+}
+
+TEST(RequestReplay, FewerRequests)
+{
+    auto const path = record();
+    RequestReplayer replayer(path);
+    // The requests that do not fit are returned by the next fetches
+    std::vector<std::vector<uint64_t>> expected{{1}, {2}, {3}, {}, {4}, {5}, {6}};
+    for (auto const& requestIds : expected)
+    {
+        EXPECT_EQ(getRequestIds(replayer.getRequests(1)), requestIds);
+        replayer.getStopSignals();
+    }
+    EXPECT_TRUE(replayer.isDone());
+}
+
+TEST(RequestReplay, Truncated)
+{
+    auto const path = record();
+    auto const size = std::filesystem::file_size(path);
+    std::filesystem::resize_file(path, size - sizeof(int64_t));
+    RequestReplayer replayer(path);
+    // The last iteration is dropped
+    EXPECT_EQ(replayer.getNumRequests(), 3);
+
+    std::ofstream{path, std::ios::binary | std::ios::trunc} << "not a recording";
+    EXPECT_THROW(RequestReplayer{path}, tensorrt_llm::common::TllmException);
+}
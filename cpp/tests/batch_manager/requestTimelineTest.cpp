@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "tensorrt_llm/batch_manager/requestTimeline.h"
+
+using namespace tensorrt_llm::batch_manager;
+namespace tr = tensorrt_llm::runtime;
+
+namespace
+{
+
+std::vector<RequestTimelineEvent> getEventKinds(RequestTimeline const& timeline)
+{
+    std::vector<RequestTimelineEvent> kinds;
+    for (auto const& [event, time] : timeline.getEvents())
+    {
+        kinds.push_back(event);
+    }
+    return kinds;
+}
+
+} // namespace
+
+TEST(RequestTimelinesTest, Timeline)
+{
+    RequestTimelines timelines;
+    timelines.add(1);
+    EXPECT_TRUE(timelines.contains(1));
+
+    timelines.recordScheduled(1);
+    // Streamed responses, the first token is kept
+    timelines.recordResponse(1, false);
+    timelines.recordResponse(1, false);
+    timelines.recordResponse(1, true);
+
+    auto const timeline = timelines.take(1);
+    ASSERT_TRUE(timeline.has_value());
+    EXPECT_FALSE(timelines.contains(1));
+    ASSERT_TRUE(timeline->scheduled && timeline->firstToken && timeline->completion);
+    EXPECT_LE(timeline->arrival, *timeline->scheduled);
+    EXPECT_LE(*timeline->scheduled, *timeline->firstToken);
+    EXPECT_LE(*timeline->firstToken, *timeline->completion);
+    EXPECT_EQ(getEventKinds(*timeline),
+        (std::vector<RequestTimelineEvent>{RequestTimelineEvent::kArrival, RequestTimelineEvent::kScheduled,
+            RequestTimelineEvent::kFirstToken, RequestTimelineEvent::kCompletion}));
+
+    auto const events = timeline->getEvents();
+    auto const timelineTensor = timeline->toTensor();
+    ASSERT_EQ(timelineTensor->getShape().nbDims, 2);
+    EXPECT_EQ(timelineTensor->getShape().d[0], static_cast<std::int64_t>(events.size()));
+    EXPECT_EQ(timelineTensor->getShape().d[1], 2);
+    auto const* timelinePtr = tr::bufferCast<std::int64_t>(*timelineTensor);
+    for (std::size_t i = 0; i < events.size(); ++i)
+    {
+        EXPECT_EQ(timelinePtr[2 * i], static_cast<std::int64_t>(events[i].first));
+        EXPECT_EQ(timelinePtr[2 * i + 1], events[i].second);
+    }
+}
+
+TEST(RequestTimelinesTest, UntrackedRequests)
+{
+    RequestTimelines timelines;
+    timelines.recordScheduled(2);
+    timelines.recordResponse(2, true);
+    EXPECT_FALSE(timelines.take(2).has_value());
+    EXPECT_EQ(timelines.size(), 0);
+
+    // A request that is not streamed gets its first token with the final response
+    timelines.add(3);
+    timelines.recordResponse(3, true);
+    auto const timeline = timelines.take(3);
+    ASSERT_TRUE(timeline.has_value());
+    EXPECT_FALSE(timeline->scheduled.has_value());
+    EXPECT_EQ(timeline->firstToken, timeline->completion);
+}
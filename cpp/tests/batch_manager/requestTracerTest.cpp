@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "tensorrt_llm/batch_manager/requestTracer.h"
+
+using namespace tensorrt_llm::batch_manager;
+
+namespace
+{
+
+auto constexpr kTraceParent = "00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01";
+
+TraceSpan const* findSpan(std::vector<TraceSpan> const& spans, std::string const& name)
+{
+    for (auto const& span : spans)
+    {
+        if (span.name == name)
+        {
+            return &span;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+TEST(TraceContext, TraceParent)
+{
+    auto const context = TraceContext::fromTraceParent(kTraceParent);
+    ASSERT_TRUE(context.has_value());
+    EXPECT_EQ(context->traceIdHigh, 0x4bf92f3577b34da6ULL);
+    EXPECT_EQ(context->traceIdLow, 0xa3ce929d0e0e4736ULL);
+    EXPECT_EQ(context->spanId, 0x00f067aa0ba902b7ULL);
+    EXPECT_TRUE(context->isSampled());
+    EXPECT_EQ(context->toTraceParent(), kTraceParent);
+
+    // Later versions may append fields
+    EXPECT_TRUE(TraceContext::fromTraceParent("01-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-00-x"));
+    EXPECT_FALSE(TraceContext::fromTraceParent("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01-x"));
+    EXPECT_FALSE(TraceContext::fromTraceParent("ff-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01"));
+    EXPECT_FALSE(TraceContext::fromTraceParent("00-4BF92F3577B34DA6A3CE929D0E0E4736-00f067aa0ba902b7-01"));
+    EXPECT_FALSE(TraceContext::fromTraceParent("00-00000000000000000000000000000000-00f067aa0ba902b7-01"));
+    EXPECT_FALSE(TraceContext::fromTraceParent("00-4bf92f3577b34da6a3ce929d0e0e4736-0000000000000000-01"));
+    EXPECT_FALSE(TraceContext::fromTraceParent("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7"));
+}
+
+TEST(TraceContext, Tensor)
+{
+    auto const context = TraceContext::fromTraceParent(kTraceParent);
+    auto const tensor = context->toTensor();
+    auto const read = TraceContext::fromTensor(*tensor);
+    ASSERT_TRUE(read.has_value());
+    EXPECT_EQ(read->toTraceParent(), kTraceParent);
+}
+
+TEST(RequestTracer, Spans)
+{
+    std::mutex mutex;
+    std::vector<TraceSpan> exported;
+    {
+        RequestTracer tracer(
+            [&](std::vector<TraceSpan> const& spans)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                exported.insert(exported.end(), spans.begin(), spans.end());
+            });
+
+        EXPECT_TRUE(tracer.startRequest(1, *TraceContext::fromTraceParent(kTraceParent), 4, 2));
+        EXPECT_FALSE(tracer.startRequest(
+            3, *TraceContext::fromTraceParent("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-00")));
+        EXPECT_TRUE(tracer.isTraced(1));
+        EXPECT_FALSE(tracer.isTraced(2));
+        EXPECT_FALSE(tracer.isTraced(3));
+
+        RequestTimeline timeline;
+        timeline.scheduled = RequestTimeline::Clock::now();
+        timeline.firstToken = RequestTimeline::Clock::now();
+        timeline.completion = RequestTimeline::Clock::now();
+        for (uint64_t id : {1, 2, 3})
+        {
+            tracer.endRequest(id, timeline);
+        }
+        EXPECT_FALSE(tracer.isTraced(1));
+        tracer.flush();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        ASSERT_EQ(exported.size(), 4);
+        EXPECT_EQ(tracer.getNumDropped(), 0);
+    }
+
+    auto const* root = findSpan(exported, "llm_request");
+    ASSERT_NE(root, nullptr);
+    EXPECT_EQ(root->traceIdHigh, 0x4bf92f3577b34da6ULL);
+    EXPECT_EQ(root->parentSpanId, 0x00f067aa0ba902b7ULL);
+    EXPECT_EQ(std::get<int64_t>(root->attributes.at(0).second), 1);
+    EXPECT_EQ(std::get<int64_t>(root->attributes.at(1).second), 4);
+    EXPECT_EQ(std::get<int64_t>(root->attributes.at(2).second), 2);
+    EXPECT_EQ(std::get<int64_t>(root->attributes.at(3).second), 0);
+    for (auto const* name : {"queue", "first_token", "generation"})
+    {
+        auto const* span = findSpan(exported, name);
+        ASSERT_NE(span, nullptr) << name;
+        EXPECT_EQ(span->parentSpanId, root->spanId);
+        EXPECT_NE(span->spanId, root->spanId);
+        EXPECT_GE(span->startTimeUnixNano, root->startTimeUnixNano);
+        EXPECT_LE(span->endTimeUnixNano, root->endTimeUnixNano);
+    }
+
+    auto const json = toOtlpJson({*root}, "my \"service\"");
+    EXPECT_NE(json.find("\"stringValue\":\"my \\\"service\\\"\""), std::string::npos);
+    EXPECT_NE(json.find("\"traceId\":\"4bf92f3577b34da6a3ce929d0e0e4736\""), std::string::npos);
+    EXPECT_NE(json.find("\"parentSpanId\":\"00f067aa0ba902b7\""), std::string::npos);
+    EXPECT_NE(json.find("{\"key\":\"request_id\",\"value\":{\"intValue\":\"1\"}}"), std::string::npos);
+}
+
+TEST(RequestTracer, Drop)
+{
+    RequestTracer tracer([](std::vector<TraceSpan> const&) {}, 512, std::chrono::hours{1}, 2);
+    auto const context = *TraceContext::fromTraceParent(kTraceParent);
+    // Root and queue spans of requests that were never scheduled
+    tracer.startRequest(1, context);
+    tracer.startRequest(2, context);
+    tracer.endRequest(1, RequestTimeline{}, true);
+    tracer.endRequest(2, RequestTimeline{}, true);
+    tracer.flush();
+    EXPECT_EQ(tracer.getNumDropped(), 2);
+}
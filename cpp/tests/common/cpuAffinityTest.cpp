@@ -0,0 +1,31 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/common/cpuAffinity.h"
+
+namespace tc = tensorrt_llm::common;
+
+TEST(CpuAffinity, ParseCpuList)
+{
+    EXPECT_EQ(tc::parseCpuList("0-3,8,10-11\n"), (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    EXPECT_EQ(tc::parseCpuList("5"), (std::vector<int>{5}));
+    EXPECT_EQ(tc::parseCpuList("4-5,0-1,5"), (std::vector<int>{0, 1, 4, 5}));
+    EXPECT_TRUE(tc::parseCpuList("").empty());
+    EXPECT_TRUE(tc::parseCpuList("\n").empty());
+    EXPECT_TRUE(tc::parseCpuList("0-x").empty());
+}
@@ -22,6 +22,11 @@
 #include <nccl.h>
 
 #include <algorithm>
+#include <filesystem>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
 
 namespace mpi = tensorrt_llm::mpi;
 namespace tr = tensorrt_llm::runtime;
@@ -173,3 +178,112 @@ TEST(MPIUtils, SessionCommunicator)
     EXPECT_EQ(session.getRank(), 0);
     EXPECT_EQ(session.getSize(), 1);
 }
+
+namespace
+{
+
+// Exchanges messages as the rank of a file group, returns the number of the first failed check or 0.
+int runFileGroupRank(std::string const& dir, int rank, int size)
+{
+    auto comm = mpi::MpiComm::fileGroup(dir, rank, size);
+    if (comm.getRank() != rank || comm.getSize() != size)
+    {
+        return 1;
+    }
+
+    auto constexpr root = 1;
+    auto value = rank == root ? std::int64_t{42} : std::int64_t{};
+    comm.bcast(value, root);
+    if (value != 42)
+    {
+        return 2;
+    }
+
+    std::vector<std::int32_t> ranks(size);
+    comm.allgather(&rank, ranks.data(), 1, mpi::MpiType::kINT32);
+    for (int idx = 0; idx < size; ++idx)
+    {
+        if (ranks[idx] != idx)
+        {
+            return 3;
+        }
+    }
+
+    std::int32_t sum = 0;
+    comm.allreduce(&rank, &sum, 1, mpi::MpiType::kINT32, mpi::MpiOp::SUM);
+    if (sum != size * (size - 1) / 2)
+    {
+        return 4;
+    }
+
+    // Messages with the same tag arrive in order
+    auto constexpr tag = 3;
+    auto constexpr nbMessages = 4;
+    for (int idx = 0; idx < nbMessages; ++idx)
+    {
+        if (rank == 0)
+        {
+            comm.send(static_cast<float>(idx), 1, tag);
+        }
+        else if (rank == 1)
+        {
+            float message{};
+            comm.recv(message, 0, tag);
+            if (message != static_cast<float>(idx))
+            {
+                return 5;
+            }
+        }
+    }
+
+    // Reversed order of the ranks of each half
+    auto half = comm.split(rank % 2, -rank);
+    if (half.getSize() != size / 2 || half.getRank() != (size - 1 - rank) / 2)
+    {
+        return 6;
+    }
+    half.barrier();
+    comm.barrier();
+    return 0;
+}
+
+} // namespace
+
+TEST(MPIUtils, FileGroup)
+{
+    auto constexpr size = 4;
+    auto dir = std::filesystem::temp_directory_path() / ("tllmFileGroupTest" + std::to_string(getpid()));
+    std::filesystem::remove_all(dir);
+
+    for (int rank = 0; rank < size; ++rank)
+    {
+        if (fork() == 0)
+        {
+            int result = 255;
+            try
+            {
+                result = runFileGroupRank(dir.string(), rank, size);
+            }
+            catch (...)
+            {
+            }
+            _exit(result);
+        }
+    }
+    for (int rank = 0; rank < size; ++rank)
+    {
+        int status = 0;
+        wait(&status);
+        EXPECT_TRUE(WIFEXITED(status));
+        EXPECT_EQ(WEXITSTATUS(status), 0);
+    }
+
+    // The messages are removed when received
+    auto nbFiles = 0;
+    for (auto const& entry : std::filesystem::recursive_directory_iterator(dir))
+    {
+        nbFiles += entry.is_regular_file();
+    }
+    EXPECT_EQ(nbFiles, 0);
+    std::filesystem::remove_all(dir);
+}
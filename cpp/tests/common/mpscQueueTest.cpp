@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "tensorrt_llm/common/mpscQueue.h"
+
+using tensorrt_llm::common::MpscQueue;
+
+TEST(MpscQueue, PushPop)
+{
+    MpscQueue<int> queue;
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.tryPop());
+    for (int i = 0; i < 5; ++i)
+    {
+        queue.push(i);
+    }
+    EXPECT_EQ(queue.tryPop(), 0);
+    std::vector<int> out;
+    EXPECT_EQ(queue.popAll(out, 2), 2);
+    EXPECT_EQ(out, (std::vector<int>{1, 2}));
+    EXPECT_EQ(queue.popAll(out), 2);
+    EXPECT_EQ(out, (std::vector<int>{1, 2, 3, 4}));
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(MpscQueue, ConcurrentProducers)
+{
+    constexpr int kNumProducers = 4;
+    constexpr int kNumValues = 10000;
+    MpscQueue<std::pair<int, int>> queue;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kNumProducers; ++p)
+    {
+        producers.emplace_back(
+            [&queue, p]
+            {
+                for (int i = 0; i < kNumValues; ++i)
+                {
+                    queue.push({p, i});
+                }
+            });
+    }
+
+    // Values of each producer are popped in order
+    std::vector<int> next(kNumProducers, 0);
+    int numPopped = 0;
+    while (numPopped < kNumProducers * kNumValues)
+    {
+        auto value = queue.tryPop();
+        if (!value)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        EXPECT_EQ(value->second, next[value->first]);
+        ++next[value->first];
+        ++numPopped;
+    }
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+    EXPECT_TRUE(queue.empty());
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "tensorrt_llm/common/mpscRingBuffer.h"
+
+using tensorrt_llm::common::MpscRingBuffer;
+
+TEST(MpscRingBuffer, PushPop)
+{
+    MpscRingBuffer<int> buffer(3);
+    EXPECT_EQ(buffer.capacity(), 4);
+    EXPECT_FALSE(buffer.tryPop());
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(buffer.tryPush(i));
+    }
+    EXPECT_FALSE(buffer.tryPush(4));
+    EXPECT_EQ(buffer.tryPop(), 0);
+    EXPECT_TRUE(buffer.tryPush(5));
+    for (int expected : {1, 2, 3, 5})
+    {
+        EXPECT_EQ(buffer.tryPop(), expected);
+    }
+    EXPECT_FALSE(buffer.tryPop());
+}
+
+TEST(MpscRingBuffer, ConcurrentProducers)
+{
+    constexpr int kNumProducers = 4;
+    constexpr int kNumValues = 50000;
+    MpscRingBuffer<int> buffer(64);
+    std::vector<std::thread> producers;
+    for (int producer = 0; producer < kNumProducers; ++producer)
+    {
+        producers.emplace_back(
+            [&buffer, producer]
+            {
+                for (int i = 0; i < kNumValues; ++i)
+                {
+                    while (!buffer.tryPush(producer * kNumValues + i))
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+    }
+
+    // The values of each producer are popped in order
+    std::vector<int> next(kNumProducers, 0);
+    for (int numPopped = 0; numPopped < kNumProducers * kNumValues;)
+    {
+        auto value = buffer.tryPop();
+        if (!value)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        auto const producer = *value / kNumValues;
+        EXPECT_EQ(*value % kNumValues, next[producer]);
+        ++next[producer];
+        ++numPopped;
+    }
+    for (auto& producer : producers)
+    {
+        producer.join();
+    }
+    EXPECT_FALSE(buffer.tryPop());
+}
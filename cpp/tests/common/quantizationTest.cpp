@@ -35,6 +35,10 @@ TEST(Quantization, Constructor)
     static_assert(QuantMode::int8KvCache().hasInt8KvCache());
     static_assert(QuantMode::fp8KvCache().hasFp8KvCache());
     static_assert(QuantMode::fp8Qdq().hasFp8Qdq());
+    static_assert((QuantMode::int8KvCache() + QuantMode::kvCacheBlockScaling()).hasKvCacheBlockScaling());
+    static_assert(!QuantMode::kvCacheBlockScaling().hasKvCacheBlockScaling());
+    static_assert((QuantMode::fp8KvCache() + QuantMode::kvCacheOnlineScaling()).hasKvCacheOnlineScaling());
+    static_assert(!QuantMode::kvCacheOnlineScaling().hasKvCacheOnlineScaling());
 }
 
 TEST(Quantization, PlusMinus)
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "tensorrt_llm/common/spscRingBuffer.h"
+
+using tensorrt_llm::common::SpscRingBuffer;
+
+TEST(SpscRingBuffer, PushPop)
+{
+    SpscRingBuffer<int> buffer(3);
+    EXPECT_EQ(buffer.capacity(), 4);
+    EXPECT_FALSE(buffer.tryPop());
+    for (int i = 0; i < 4; ++i)
+    {
+        EXPECT_TRUE(buffer.tryPush(i));
+    }
+    EXPECT_FALSE(buffer.tryPush(4));
+    EXPECT_EQ(buffer.size(), 4);
+    EXPECT_EQ(buffer.tryPop(), 0);
+    EXPECT_TRUE(buffer.tryPush(5));
+    std::vector<int> out;
+    EXPECT_EQ(buffer.popAll(out, 2), 2);
+    EXPECT_EQ(out, (std::vector<int>{1, 2}));
+    EXPECT_EQ(buffer.popAll(out), 2);
+    EXPECT_EQ(out, (std::vector<int>{1, 2, 3, 5}));
+    EXPECT_EQ(buffer.size(), 0);
+}
+
+TEST(SpscRingBuffer, ConcurrentProducerConsumer)
+{
+    constexpr int kNumValues = 100000;
+    SpscRingBuffer<int> buffer(64);
+    std::thread producer(
+        [&buffer]
+        {
+            for (int i = 0; i < kNumValues; ++i)
+            {
+                while (!buffer.tryPush(i))
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+    int next = 0;
+    while (next < kNumValues)
+    {
+        auto value = buffer.tryPop();
+        if (!value)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        EXPECT_EQ(*value, next);
+        ++next;
+    }
+    producer.join();
+    EXPECT_FALSE(buffer.tryPop());
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TOP_LEVEL_DIR
+#error "Define TOP_LEVEL_DIR"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/kernels/banRepeatNgram.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/runtimeKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <set>
+
+namespace tk = tensorrt_llm::kernels;
+namespace trk = tensorrt_llm::runtime::kernels;
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+class BanRepeatNgramTest : public testing::Test
+{
+public:
+    void SetUp() override
+    {
+        mStream = std::make_shared<tensorrt_llm::runtime::CudaStream>();
+        mBufferManager = std::make_shared<tensorrt_llm::runtime::BufferManager>(mStream);
+    }
+
+    void TearDown() override {}
+
+    //! Grows the sequences one token per step and compares the tokens banned with the index to a scan of the sequences
+    void runTest(std::vector<int32_t> const& ngramSizes, SizeType vocabSizePadded, SizeType promptLen,
+        SizeType maxSeqLen, SizeType restartStep)
+    {
+        auto const batchSize = static_cast<SizeType>(ngramSizes.size());
+        std::mt19937 generator(42);
+        // A small range of tokens makes repeated n-grams frequent
+        std::uniform_int_distribution<int32_t> tokenDistr(0, 3);
+        std::vector<int32_t> outputIds(batchSize * maxSeqLen);
+        std::generate(outputIds.begin(), outputIds.end(), [&]() { return tokenDistr(generator); });
+
+        auto outputIdsDevice
+            = mBufferManager->copyFrom(outputIds, ITensor::makeShape({batchSize, maxSeqLen}), MemoryType::kGPU);
+        auto ngramSizesDevice
+            = mBufferManager->copyFrom(ngramSizes, ITensor::makeShape({batchSize}), MemoryType::kGPU);
+        auto seqLengthsDevice = mBufferManager->gpu(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT32);
+        auto logitsDevice
+            = mBufferManager->gpu(ITensor::makeShape({batchSize, vocabSizePadded}), nvinfer1::DataType::kFLOAT);
+        auto const indexSize = static_cast<SizeType>(tk::NgramIndex::getSize(batchSize, maxSeqLen) / sizeof(int32_t));
+        auto indexDevice = mBufferManager->gpu(ITensor::makeShape({indexSize}), nvinfer1::DataType::kINT32);
+        auto idsPtrHost = mBufferManager->pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT64);
+        auto idsPtrHostPtr = reinterpret_cast<const int**>(bufferCast<int64_t>(*idsPtrHost));
+        for (SizeType bi = 0; bi < batchSize; ++bi)
+        {
+            idsPtrHostPtr[bi] = bufferCast<int32_t>(*outputIdsDevice) + bi * maxSeqLen;
+        }
+
+        tk::NgramIndex const index(bufferCast<int32_t>(*indexDevice), maxSeqLen);
+        tk::invokeResetNgramIndex(index, 0, batchSize, mStream->get());
+
+        for (SizeType seqLen = promptLen; seqLen < maxSeqLen; ++seqLen)
+        {
+            // Restarting at a shorter length makes the kernel rebuild the indices
+            auto const length = seqLen < restartStep ? seqLen : seqLen - restartStep + promptLen;
+            trk::invokeFill(*seqLengthsDevice, length, *mStream);
+            trk::invokeFill(*logitsDevice, 0.0f, *mStream);
+            tk::invokeBanRepeatNgramFromIndex(bufferCast<float>(*logitsDevice), index, idsPtrHostPtr, nullptr,
+                bufferCast<int32_t>(*seqLengthsDevice), bufferCast<int32_t>(*ngramSizesDevice), batchSize,
+                vocabSizePadded, mStream->get());
+
+            auto const logitsHost = mBufferManager->copyFrom(*logitsDevice, MemoryType::kCPU);
+            mStream->synchronize();
+            auto const logitsHostPtr = bufferCast<float>(*logitsHost);
+
+            for (SizeType bi = 0; bi < batchSize; ++bi)
+            {
+                auto const* tokens = outputIds.data() + bi * maxSeqLen;
+                auto const n = ngramSizes[bi];
+                std::set<int32_t> banned;
+                for (SizeType p = 0; n > 0 && p + n <= length; ++p)
+                {
+                    if (std::equal(tokens + p, tokens + p + n - 1, tokens + length - n + 1))
+                    {
+                        banned.insert(tokens[p + n - 1]);
+                    }
+                }
+                for (SizeType ti = 0; ti < vocabSizePadded; ++ti)
+                {
+                    auto const logit = logitsHostPtr[bi * vocabSizePadded + ti];
+                    if (banned.count(ti))
+                    {
+                        EXPECT_TRUE(std::isinf(logit) && logit < 0)
+                            << "bi " << bi << " length " << length << " ti " << ti;
+                    }
+                    else
+                    {
+                        EXPECT_EQ(logit, 0.0f) << "bi " << bi << " length " << length << " ti " << ti;
+                    }
+                }
+            }
+        }
+    }
+
+protected:
+    std::shared_ptr<tensorrt_llm::runtime::BufferManager> mBufferManager;
+    std::shared_ptr<tensorrt_llm::runtime::CudaStream> mStream;
+};
+
+TEST_F(BanRepeatNgramTest, MatchesScan)
+{
+    this->runTest({0, 1, 2, 3, 4}, 32, 8, 128, 128);
+}
+
+TEST_F(BanRepeatNgramTest, RebuildsAfterRestart)
+{
+    this->runTest({2, 3, 3, 5}, 32, 8, 128, 64);
+}
+
+} // end of namespace
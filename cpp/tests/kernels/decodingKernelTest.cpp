@@ -22,6 +22,7 @@
 #include "tensorrt_llm/kernels/decodingCommon.h"
 #include "tensorrt_llm/kernels/decodingKernels.h"
 #include "tensorrt_llm/runtime/bufferManager.h"
+#include <algorithm>
 #include <curand_kernel.h>
 #include <random>
 
@@ -507,4 +508,175 @@ TYPED_TEST(DecodingKernelsTest, acceptDraftTokensByLogitsKernel)
     }
 }
 
+TEST(DecodingKernelsTest, acceptDraftTokensByArgmaxKernel)
+{
+    auto stream = std::make_shared<tensorrt_llm::runtime::CudaStream>();
+    BufferManager manager(stream);
+
+    SizeType constexpr batchSize{3};
+    SizeType constexpr maxDraftTokens{3};
+    SizeType constexpr vocabSize{6};
+    SizeType constexpr vocabSizePadded{8};
+    SizeType constexpr maxTokens{maxDraftTokens + 1};
+
+    // greedy target tokens for the rows of each request
+    std::vector<std::vector<SizeType>> const greedyTokens{{1, 2, 3, 4}, {5, 0, 2, 2}, {3, 3, 1, 1}};
+    std::vector<std::vector<SizeType>> const drafts{{1, 2, 3}, {5, 1, 2}, {1}};
+    std::vector<SizeType> const expectedAccepted{4, 2, 1};
+
+    auto logits = manager.pinned(
+        ITensor::makeShape({batchSize * maxTokens, vocabSizePadded}), nvinfer1::DataType::kFLOAT);
+    auto logitsPtr = bufferCast<float>(*logits);
+    for (SizeType ri = 0; ri < batchSize * maxTokens; ++ri)
+    {
+        for (SizeType vi = 0; vi < vocabSizePadded; ++vi)
+        {
+            // padded entries are ignored
+            logitsPtr[ri * vocabSizePadded + vi] = vi < vocabSize ? 0.1f * vi : 100.f;
+        }
+        logitsPtr[ri * vocabSizePadded + greedyTokens[ri / maxTokens][ri % maxTokens]] = 10.f;
+    }
+
+    auto logitsOffsets = manager.pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT32);
+    auto draftIds = manager.pinned(ITensor::makeShape({batchSize, maxDraftTokens}), nvinfer1::DataType::kINT32);
+    auto numsDraftTokens = manager.pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT32);
+    auto targetIds = manager.pinned(ITensor::makeShape({batchSize, maxTokens}), nvinfer1::DataType::kINT32);
+    auto numsAcceptedTokens = manager.pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT32);
+    for (SizeType bi = 0; bi < batchSize; ++bi)
+    {
+        bufferCast<SizeType>(*logitsOffsets)[bi] = bi * maxTokens;
+        bufferCast<SizeType>(*numsDraftTokens)[bi] = static_cast<SizeType>(drafts[bi].size());
+        std::copy(drafts[bi].begin(), drafts[bi].end(), bufferCast<SizeType>(*draftIds) + bi * maxDraftTokens);
+    }
+
+    tk::invokeAcceptDraftTokensByArgmax(bufferCast<SizeType>(*targetIds), bufferCast<SizeType>(*numsAcceptedTokens),
+        bufferCast<float>(*logits), bufferCast<SizeType>(*logitsOffsets), bufferCast<SizeType>(*draftIds),
+        bufferCast<SizeType>(*numsDraftTokens), batchSize, maxDraftTokens, vocabSize, vocabSizePadded, stream->get());
+    stream->synchronize();
+
+    for (SizeType bi = 0; bi < batchSize; ++bi)
+    {
+        auto const numAccepted = bufferCast<SizeType>(*numsAcceptedTokens)[bi];
+        EXPECT_EQ(numAccepted, expectedAccepted[bi]) << "bi " << bi;
+        for (SizeType ti = 0; ti < numAccepted; ++ti)
+        {
+            EXPECT_EQ(bufferCast<SizeType>(*targetIds)[bi * maxTokens + ti], greedyTokens[bi][ti])
+                << "bi " << bi << " ti " << ti;
+        }
+    }
+}
+
+TEST(DecodingKernelsTest, acceptTreeDraftTokensByArgmaxKernel)
+{
+    auto stream = std::make_shared<tensorrt_llm::runtime::CudaStream>();
+    BufferManager manager(stream);
+
+    SizeType constexpr batchSize{4};
+    SizeType constexpr vocabSize{10};
+    SizeType constexpr vocabSizePadded{12};
+    SizeType constexpr maxSeqLen{16};
+    SizeType constexpr inputLength{5};
+    // 0 -> {1, 2}, 1 -> {3}, 2 -> {4}, 3 -> {5}
+    std::vector<SizeType> const treeParents{-1, 0, 0, 1, 2, 3};
+    auto const numNodes = static_cast<SizeType>(treeParents.size());
+    SizeType constexpr maxPathLen{4};
+
+    // greedy target token after each node, and draft token of each node
+    std::vector<std::vector<SizeType>> const greedyTokens{
+        {7, 3, 0, 4, 0, 2}, {8, 0, 1, 0, 5, 0}, {6, 0, 0, 0, 0, 0}, {7, 3, 0, 4, 0, 2}};
+    std::vector<std::vector<SizeType>> const drafts{
+        {0, 7, 8, 3, 1, 4}, {0, 7, 8, 3, 1, 4}, {0, 7, 8, 3, 1, 4}, {0, 7, 8, 3, 1, 4}};
+    std::vector<SizeType> const endIds{9, 9, 9, 3};
+    std::vector<std::vector<SizeType>> const expectedPaths{{0, 1, 3, 5}, {0, 2, 4}, {0}, {0, 1, 3, 5}};
+    // the last request stops before its end id
+    std::vector<std::vector<SizeType>> const expectedTokens{{7, 3, 4, 2}, {8, 1, 5}, {6}, {7}};
+
+    auto logits
+        = manager.pinned(ITensor::makeShape({batchSize, numNodes, vocabSizePadded}), nvinfer1::DataType::kFLOAT);
+    auto logitsPtr = bufferCast<float>(*logits);
+    for (SizeType ri = 0; ri < batchSize * numNodes; ++ri)
+    {
+        for (SizeType vi = 0; vi < vocabSizePadded; ++vi)
+        {
+            // padded entries are ignored
+            logitsPtr[ri * vocabSizePadded + vi] = vi < vocabSize ? 0.1f * vi : 100.f;
+        }
+        logitsPtr[ri * vocabSizePadded + greedyTokens[ri / numNodes][ri % numNodes]] = 10.f;
+    }
+
+    auto draftIds = manager.pinned(ITensor::makeShape({batchSize, numNodes}), nvinfer1::DataType::kINT32);
+    auto treeParentsHost = manager.pinned(ITensor::makeShape({numNodes}), nvinfer1::DataType::kINT32);
+    auto endIdsHost = manager.pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT32);
+    auto sequenceLengths = manager.pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT32);
+    auto finished
+        = manager.pinned(ITensor::makeShape({batchSize}), TRTDataType<tk::FinishedState::UnderlyingType>::value);
+    auto outputIds = manager.pinned(ITensor::makeShape({batchSize, maxSeqLen}), nvinfer1::DataType::kINT32);
+    auto outputIdsPtr = manager.pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT64);
+    auto acceptedPaths = manager.pinned(ITensor::makeShape({batchSize, maxPathLen}), nvinfer1::DataType::kINT32);
+    auto numsAcceptedTokens = manager.pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT32);
+    auto finishedPtr = reinterpret_cast<tk::FinishedState*>(bufferCast<tk::FinishedState::UnderlyingType>(*finished));
+    auto outputIdsPtrPtr = reinterpret_cast<int**>(bufferCast<int64_t>(*outputIdsPtr));
+    std::copy(treeParents.begin(), treeParents.end(), bufferCast<SizeType>(*treeParentsHost));
+    std::copy(endIds.begin(), endIds.end(), bufferCast<SizeType>(*endIdsHost));
+    for (SizeType bi = 0; bi < batchSize; ++bi)
+    {
+        std::copy(drafts[bi].begin(), drafts[bi].end(), bufferCast<SizeType>(*draftIds) + bi * numNodes);
+        bufferCast<SizeType>(*sequenceLengths)[bi] = inputLength;
+        finishedPtr[bi] = tk::FinishedState::empty();
+        outputIdsPtrPtr[bi] = bufferCast<SizeType>(*outputIds) + bi * maxSeqLen;
+    }
+
+    tk::invokeAcceptTreeDraftTokensByArgmax(outputIdsPtrPtr, bufferCast<SizeType>(*sequenceLengths), finishedPtr,
+        bufferCast<SizeType>(*acceptedPaths), bufferCast<SizeType>(*numsAcceptedTokens), bufferCast<float>(*logits),
+        bufferCast<SizeType>(*draftIds), bufferCast<SizeType>(*treeParentsHost), bufferCast<SizeType>(*endIdsHost),
+        nullptr, batchSize, numNodes, maxPathLen, vocabSize, vocabSizePadded, stream->get());
+    stream->synchronize();
+
+    for (SizeType bi = 0; bi < batchSize; ++bi)
+    {
+        auto const numAccepted = bufferCast<SizeType>(*numsAcceptedTokens)[bi];
+        auto const expectedAccepted = static_cast<SizeType>(expectedTokens[bi].size());
+        EXPECT_EQ(numAccepted, expectedAccepted) << "bi " << bi;
+        EXPECT_EQ(bufferCast<SizeType>(*sequenceLengths)[bi], inputLength + expectedAccepted) << "bi " << bi;
+        EXPECT_EQ(finishedPtr[bi].isFinishedEOS(), bi == batchSize - 1) << "bi " << bi;
+        for (SizeType pi = 0; pi < static_cast<SizeType>(expectedPaths[bi].size()); ++pi)
+        {
+            EXPECT_EQ(bufferCast<SizeType>(*acceptedPaths)[bi * maxPathLen + pi], expectedPaths[bi][pi])
+                << "bi " << bi << " pi " << pi;
+        }
+        for (SizeType ti = 0; ti < numAccepted; ++ti)
+        {
+            EXPECT_EQ(outputIdsPtrPtr[bi][inputLength + ti], expectedTokens[bi][ti]) << "bi " << bi << " ti " << ti;
+        }
+    }
+}
+
+TEST(DecodingKernelsTest, buildTreeAttentionMaskKernel)
+{
+    auto stream = std::make_shared<tensorrt_llm::runtime::CudaStream>();
+    BufferManager manager(stream);
+
+    std::vector<SizeType> const treeParents{-1, 0, 0, 1, 2, 3};
+    auto const numNodes = static_cast<SizeType>(treeParents.size());
+    std::vector<std::vector<SizeType>> const ancestors{{0}, {0, 1}, {0, 2}, {0, 1, 3}, {0, 2, 4}, {0, 1, 3, 5}};
+
+    auto treeParentsHost = manager.pinned(ITensor::makeShape({numNodes}), nvinfer1::DataType::kINT32);
+    auto mask = manager.pinned(ITensor::makeShape({numNodes, numNodes}), nvinfer1::DataType::kINT32);
+    std::copy(treeParents.begin(), treeParents.end(), bufferCast<SizeType>(*treeParentsHost));
+
+    tk::invokeBuildTreeAttentionMask(
+        bufferCast<SizeType>(*mask), bufferCast<SizeType>(*treeParentsHost), numNodes, stream->get());
+    stream->synchronize();
+
+    for (SizeType ni = 0; ni < numNodes; ++ni)
+    {
+        for (SizeType nj = 0; nj < numNodes; ++nj)
+        {
+            auto const expected
+                = std::find(ancestors[ni].begin(), ancestors[ni].end(), nj) != ancestors[ni].end() ? 1 : 0;
+            EXPECT_EQ(bufferCast<SizeType>(*mask)[ni * numNodes + nj], expected) << "ni " << ni << " nj " << nj;
+        }
+    }
+}
+
 } // end of namespace
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TOP_LEVEL_DIR
+#error "Define TOP_LEVEL_DIR"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/kernels/lmHeadTopK.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+namespace tk = tensorrt_llm::kernels;
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+class LmHeadTopKTest : public testing::Test
+{
+public:
+    void SetUp() override
+    {
+        mStream = std::make_shared<tensorrt_llm::runtime::CudaStream>();
+        mBufferManager = std::make_shared<tensorrt_llm::runtime::BufferManager>(mStream);
+    }
+
+    void TearDown() override {}
+
+    // Merges the logits chunk by chunk and compares the candidates with a sort of the whole rows. The tokens from
+    // vocabSize to vocabSizePadded are padding and must never be selected.
+    void runTest(SizeType numRows, SizeType vocabSize, SizeType vocabSizePadded, SizeType chunkSize, SizeType topK)
+    {
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> distr(-8.0f, 8.0f);
+        std::vector<float> logits(numRows * vocabSizePadded);
+        std::generate(logits.begin(), logits.end(), [&]() { return distr(generator); });
+        // Padding larger than any logit
+        for (SizeType row = 0; row < numRows; ++row)
+        {
+            std::fill(logits.begin() + row * vocabSizePadded + vocabSize,
+                logits.begin() + (row + 1) * vocabSizePadded, 100.f);
+        }
+        std::vector<int> fullLogitsMask(numRows);
+        for (SizeType row = 0; row < numRows; ++row)
+        {
+            fullLogitsMask[row] = row % 2;
+        }
+
+        auto chunkDevice = mBufferManager->gpu(ITensor::makeShape({numRows, chunkSize}), nvinfer1::DataType::kFLOAT);
+        auto topKLogitsDevice = mBufferManager->gpu(ITensor::makeShape({numRows, topK}), nvinfer1::DataType::kFLOAT);
+        auto topKIdsDevice = mBufferManager->gpu(ITensor::makeShape({numRows, topK}), nvinfer1::DataType::kINT32);
+        auto fullLogitsDevice
+            = mBufferManager->gpu(ITensor::makeShape({numRows, vocabSizePadded}), nvinfer1::DataType::kFLOAT);
+        mBufferManager->setZero(*fullLogitsDevice);
+        auto maskDevice = mBufferManager->copyFrom(fullLogitsMask, ITensor::makeShape({numRows}), MemoryType::kGPU);
+
+        std::vector<float> chunk(numRows * chunkSize);
+        for (SizeType chunkStart = 0; chunkStart < vocabSizePadded; chunkStart += chunkSize)
+        {
+            auto const size = std::min(chunkSize, vocabSizePadded - chunkStart);
+            for (SizeType row = 0; row < numRows; ++row)
+            {
+                std::copy_n(logits.begin() + row * vocabSizePadded + chunkStart, size, chunk.begin() + row * size);
+            }
+            mBufferManager->copy(chunk.data(), *chunkDevice, MemoryType::kCPU);
+            tk::invokeLmHeadTopKMerge(bufferCast<float>(*chunkDevice), numRows, size,
+                std::clamp(vocabSize - chunkStart, 0, size), chunkStart, bufferCast<float>(*topKLogitsDevice),
+                bufferCast<int>(*topKIdsDevice), topK, chunkStart == 0,
+                bufferCast<float>(*fullLogitsDevice) + chunkStart, vocabSizePadded, bufferCast<int>(*maskDevice),
+                mStream->get());
+        }
+
+        auto const topKLogits = mBufferManager->copyFrom(*topKLogitsDevice, MemoryType::kCPU);
+        auto const topKIds = mBufferManager->copyFrom(*topKIdsDevice, MemoryType::kCPU);
+        auto const fullLogits = mBufferManager->copyFrom(*fullLogitsDevice, MemoryType::kCPU);
+        mStream->synchronize();
+        auto const topKLogitsPtr = bufferCast<float>(*topKLogits);
+        auto const topKIdsPtr = bufferCast<int>(*topKIds);
+        auto const fullLogitsPtr = bufferCast<float>(*fullLogits);
+
+        for (SizeType row = 0; row < numRows; ++row)
+        {
+            auto const* rowLogits = logits.data() + row * vocabSizePadded;
+            std::vector<int> ids(vocabSize);
+            std::iota(ids.begin(), ids.end(), 0);
+            std::stable_sort(ids.begin(), ids.end(), [&](int a, int b) { return rowLogits[a] > rowLogits[b]; });
+            for (SizeType k = 0; k < topK; ++k)
+            {
+                EXPECT_EQ(topKIdsPtr[row * topK + k], ids[k]) << "row " << row << " k " << k;
+                EXPECT_EQ(topKLogitsPtr[row * topK + k], rowLogits[ids[k]]) << "row " << row << " k " << k;
+            }
+            for (SizeType token = 0; token < vocabSizePadded; ++token)
+            {
+                auto const expected = fullLogitsMask[row] ? rowLogits[token] : 0.f;
+                EXPECT_EQ(fullLogitsPtr[row * vocabSizePadded + token], expected)
+                    << "row " << row << " token " << token;
+            }
+        }
+    }
+
+protected:
+    std::shared_ptr<tensorrt_llm::runtime::BufferManager> mBufferManager;
+    std::shared_ptr<tensorrt_llm::runtime::CudaStream> mStream;
+};
+
+TEST_F(LmHeadTopKTest, Greedy)
+{
+    this->runTest(4, 1000, 1000, 256, 1);
+}
+
+TEST_F(LmHeadTopKTest, TopKAcrossChunks)
+{
+    this->runTest(3, 5000, 5000, 1024, 50);
+}
+
+TEST_F(LmHeadTopKTest, PaddedVocab)
+{
+    this->runTest(2, 1000, 1024, 300, 8);
+}
+
+TEST_F(LmHeadTopKTest, MoreCandidatesThanChunk)
+{
+    this->runTest(2, 500, 500, 64, tk::kLmHeadMaxTopK);
+}
+
+} // end of namespace
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TOP_LEVEL_DIR
+#error "Define TOP_LEVEL_DIR"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/kernels/logitsBitmask.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include <cmath>
+#include <random>
+
+namespace tk = tensorrt_llm::kernels;
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+class LogitsBitmaskTest : public testing::Test
+{
+public:
+    void SetUp() override
+    {
+        mStream = std::make_shared<tensorrt_llm::runtime::CudaStream>();
+        mBufferManager = std::make_shared<tensorrt_llm::runtime::BufferManager>(mStream);
+    }
+
+    void TearDown() override {}
+
+    void runTest(SizeType batchSize, SizeType beamWidth, SizeType vocabSizePadded)
+    {
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> logitDistr(-3.0f, 3.0f);
+        std::bernoulli_distribution allowedDistr(0.3);
+
+        auto const bitmaskSize = tk::getLogitsBitmaskSize(vocabSizePadded);
+        std::vector<float> logits(batchSize * beamWidth * vocabSizePadded);
+        std::generate(logits.begin(), logits.end(), [&]() { return logitDistr(generator); });
+        std::vector<int32_t> bitmask(batchSize * bitmaskSize, 0);
+        for (SizeType bi = 0; bi < batchSize; ++bi)
+        {
+            for (SizeType ti = 0; ti < vocabSizePadded; ++ti)
+            {
+                // The first request allows all tokens, so that the kernel skips its words
+                if (bi == 0 || allowedDistr(generator))
+                {
+                    bitmask[bi * bitmaskSize + ti / 32] |= static_cast<int32_t>(1u << (ti % 32));
+                }
+            }
+        }
+
+        auto logitsDevice = mBufferManager->copyFrom(
+            logits, ITensor::makeShape({batchSize, beamWidth, vocabSizePadded}), MemoryType::kGPU);
+        auto bitmaskDevice
+            = mBufferManager->copyFrom(bitmask, ITensor::makeShape({batchSize, bitmaskSize}), MemoryType::kGPU);
+
+        tk::invokeApplyLogitsBitmask(bufferCast<float>(*logitsDevice),
+            reinterpret_cast<const uint32_t*>(bufferCast<int32_t>(*bitmaskDevice)), batchSize, beamWidth,
+            vocabSizePadded, mStream->get());
+
+        auto const logitsHost = mBufferManager->copyFrom(*logitsDevice, MemoryType::kCPU);
+        mStream->synchronize();
+        auto const logitsHostPtr = bufferCast<float>(*logitsHost);
+
+        for (SizeType bi = 0; bi < batchSize; ++bi)
+        {
+            for (SizeType bwi = 0; bwi < beamWidth; ++bwi)
+            {
+                for (SizeType ti = 0; ti < vocabSizePadded; ++ti)
+                {
+                    auto const idx = (bi * beamWidth + bwi) * vocabSizePadded + ti;
+                    auto const allowed = (static_cast<uint32_t>(bitmask[bi * bitmaskSize + ti / 32]) >> (ti % 32)) & 1u;
+                    if (allowed)
+                    {
+                        EXPECT_EQ(logitsHostPtr[idx], logits[idx]) << "bi " << bi << " bwi " << bwi << " ti " << ti;
+                    }
+                    else
+                    {
+                        EXPECT_TRUE(std::isinf(logitsHostPtr[idx]) && logitsHostPtr[idx] < 0)
+                            << "bi " << bi << " bwi " << bwi << " ti " << ti;
+                    }
+                }
+            }
+        }
+    }
+
+protected:
+    std::shared_ptr<tensorrt_llm::runtime::BufferManager> mBufferManager;
+    std::shared_ptr<tensorrt_llm::runtime::CudaStream> mStream;
+};
+
+TEST_F(LogitsBitmaskTest, BS8BW1)
+{
+    this->runTest(8, 1, 1024);
+}
+
+TEST_F(LogitsBitmaskTest, BS4BW2)
+{
+    this->runTest(4, 2, 1024);
+}
+
+TEST_F(LogitsBitmaskTest, BS4BW1UnalignedVocab)
+{
+    this->runTest(4, 1, 1000);
+}
+
+} // end of namespace
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TOP_LEVEL_DIR
+#error "Define TOP_LEVEL_DIR"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/kernels/loraSgmv.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include <algorithm>
+#include <random>
+
+namespace tk = tensorrt_llm::kernels;
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+class LoraSgmvTest : public testing::Test
+{
+public:
+    void SetUp() override
+    {
+        mStream = std::make_shared<tensorrt_llm::runtime::CudaStream>();
+        mBufferManager = std::make_shared<tensorrt_llm::runtime::BufferManager>(mStream);
+    }
+
+    void TearDown() override {}
+
+    // Every request has one row and its own adapter of the given rank, like the requests in the generation phase
+    void runTest(std::vector<SizeType> const& ranks, SizeType inHiddenSize, SizeType outHiddenSize, SizeType maxRank)
+    {
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> distr(-1.0f, 1.0f);
+        auto const random = [&](std::size_t size)
+        {
+            std::vector<float> values(size);
+            std::generate(values.begin(), values.end(), [&]() { return distr(generator); });
+            return values;
+        };
+
+        auto const numRequests = static_cast<SizeType>(ranks.size());
+        auto const input = random(numRequests * inHiddenSize);
+        auto inputDevice
+            = mBufferManager->copyFrom(input, ITensor::makeShape({numRequests, inHiddenSize}), MemoryType::kGPU);
+        auto lowRankDevice
+            = mBufferManager->gpu(ITensor::makeShape({numRequests, maxRank}), nvinfer1::DataType::kFLOAT);
+        auto outputDevice
+            = mBufferManager->gpu(ITensor::makeShape({numRequests, outHiddenSize}), nvinfer1::DataType::kFLOAT);
+        mBufferManager->setZero(*outputDevice);
+
+        std::vector<std::vector<float>> inWeights;
+        std::vector<std::vector<float>> outWeights;
+        std::vector<ITensor::SharedPtr> weightsDevice;
+        std::vector<tk::LoraSgmvProblem> problems;
+        for (SizeType ri = 0; ri < numRequests; ++ri)
+        {
+            auto const rank = ranks[ri];
+            inWeights.push_back(random(rank * inHiddenSize));
+            outWeights.push_back(random(outHiddenSize * rank));
+            auto inWeightDevice = mBufferManager->copyFrom(
+                inWeights.back(), ITensor::makeShape({rank, inHiddenSize}), MemoryType::kGPU);
+            auto outWeightDevice = mBufferManager->copyFrom(
+                outWeights.back(), ITensor::makeShape({outHiddenSize, rank}), MemoryType::kGPU);
+            problems.push_back({bufferCast<float>(*inputDevice) + ri * inHiddenSize,
+                bufferCast<float>(*lowRankDevice) + ri * maxRank, bufferCast<float>(*outputDevice) + ri * outHiddenSize,
+                inWeightDevice->data(), outWeightDevice->data(), 1, rank, outHiddenSize});
+            weightsDevice.emplace_back(std::move(inWeightDevice));
+            weightsDevice.emplace_back(std::move(outWeightDevice));
+        }
+        auto problemsDevice = mBufferManager->gpu(problems.size() * sizeof(tk::LoraSgmvProblem));
+        mBufferManager->copy(problems.data(), *problemsDevice, MemoryType::kCPU);
+
+        tk::invokeLoraSgmv<float>(static_cast<tk::LoraSgmvProblem const*>(problemsDevice->data()), numRequests, 1,
+            outHiddenSize, inHiddenSize, maxRank, mStream->get());
+
+        auto const outputHost = mBufferManager->copyFrom(*outputDevice, MemoryType::kCPU);
+        mStream->synchronize();
+        auto const outputHostPtr = bufferCast<float>(*outputHost);
+
+        for (SizeType ri = 0; ri < numRequests; ++ri)
+        {
+            auto const rank = ranks[ri];
+            std::vector<float> lowRank(rank, 0.f);
+            for (SizeType r = 0; r < rank; ++r)
+            {
+                for (SizeType k = 0; k < inHiddenSize; ++k)
+                {
+                    lowRank[r] += input[ri * inHiddenSize + k] * inWeights[ri][r * inHiddenSize + k];
+                }
+            }
+            for (SizeType n = 0; n < outHiddenSize; ++n)
+            {
+                float expected = 0.f;
+                for (SizeType r = 0; r < rank; ++r)
+                {
+                    expected += lowRank[r] * outWeights[ri][n * rank + r];
+                }
+                EXPECT_NEAR(outputHostPtr[ri * outHiddenSize + n], expected, 1e-3f * inHiddenSize)
+                    << "ri " << ri << " n " << n;
+            }
+        }
+    }
+
+protected:
+    std::shared_ptr<tensorrt_llm::runtime::BufferManager> mBufferManager;
+    std::shared_ptr<tensorrt_llm::runtime::CudaStream> mStream;
+};
+
+TEST_F(LoraSgmvTest, SameRank)
+{
+    this->runTest({8, 8, 8, 8}, 256, 512, 8);
+}
+
+TEST_F(LoraSgmvTest, MixedRanks)
+{
+    this->runTest({4, 16, 1, 64, 8}, 256, 96, 64);
+}
+
+TEST_F(LoraSgmvTest, ZeroRank)
+{
+    this->runTest({0, 8}, 128, 128, 8);
+}
+
+} // end of namespace
@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <gtest/gtest.h>
 #include <numeric>
+#include <random>
 
 #include "tensorrt_llm/kernels/mixtureOfExperts/moe_kernels.h"
 #include "tensorrt_llm/runtime/bufferManager.h"
@@ -619,6 +620,51 @@ TEST_F(MixtureOfExpertsTest, PermuteRenormalization)
     BasicPermuteTest(3);
 }
 
+TEST_F(MixtureOfExpertsTest, PermuteGroupedGemm)
+{
+    // The problems above are small enough for the grouped GEMV, check the grouped GEMM as well
+    mMoERunner.setUseMoeGemv(false);
+    BasicPermuteTest();
+    BasicPermuteTest(2);
+    BasicPermuteTest(3);
+}
+
+TEST_F(MixtureOfExpertsTest, FusedRouting)
+{
+    int hidden_size = DEFAULT_HIDDEN_SIZE;
+    int num_tokens = 5;
+
+    std::vector<DataType> hidden_states(hidden_size * num_tokens, 0);
+    std::iota(hidden_states.begin(), hidden_states.end(), 0.0f);
+
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> dist(-1.f, 1.f);
+    for (int num_experts : {8, 16, 64})
+    {
+        std::vector<float> probs(num_tokens * num_experts);
+        std::generate(probs.begin(), probs.end(), [&] { return dist(gen); });
+        for (int k : {1, 2, 4})
+        {
+            // The fused routing must give the same routing and results as the separate kernels
+            mMoERunner.setUseFusedRouting(false);
+            runMoEPermute({hidden_states}, {probs}, hidden_size, num_experts, k);
+            auto expected_experts = getDataFromDevice(mSelectedExpert, num_tokens * k);
+            auto expected_map = getDataFromDevice(mSourceToExpandedMap, num_tokens * k);
+            auto expected_final = getDataFromDevice(mFinalOutput, num_tokens * hidden_size);
+
+            mMoERunner.setUseFusedRouting(true);
+            runMoEPermute({});
+            EXPECT_EQ(expected_experts, getDataFromDevice(mSelectedExpert, num_tokens * k));
+            EXPECT_EQ(expected_map, getDataFromDevice(mSourceToExpandedMap, num_tokens * k));
+            auto final_results = getDataFromDevice(mFinalOutput, num_tokens * hidden_size);
+            for (int i = 0; i < num_tokens * hidden_size; i++)
+            {
+                EXPECT_FLOAT_EQ(expected_final[i], final_results[i]) << "Incorrect final value at position: " << i;
+            }
+        }
+    }
+}
+
 TEST_F(MixtureOfExpertsTest, Finished)
 {
     int hidden_size = DEFAULT_HIDDEN_SIZE;
@@ -757,6 +803,13 @@ TEST_F(MixtureOfExpertsTest, ExpertParallelRenorm)
     ExpertParallelTest(2);
 }
 
+TEST_F(MixtureOfExpertsTest, ExpertParallelGroupedGemm)
+{
+    mMoERunner.setUseMoeGemv(false);
+    ExpertParallelTest();
+    ExpertParallelTest(2);
+}
+
 void MixtureOfExpertsTest::TensorParallelTest(int k)
 {
     int hidden_size = DEFAULT_HIDDEN_SIZE;
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TOP_LEVEL_DIR
+#error "Define TOP_LEVEL_DIR"
+#endif
+
+#include "tensorrt_llm/kernels/samplingFusedKernels.h"
+#include "tests/kernels/sampling/samplingTest.h"
+
+#include <algorithm>
+
+namespace tc = tensorrt_llm::common;
+namespace tk = tensorrt_llm::kernels;
+namespace trk = tensorrt_llm::runtime::kernels;
+
+using namespace tensorrt_llm::runtime;
+using namespace tensorrt_llm::tests::kernels::sampling;
+
+namespace
+{
+
+template <typename T>
+class FusedSamplingKernelTest : public SamplingKernelTest<T>
+{
+
+protected:
+    using SamplingKernelTest<T>::mStream;
+    using SamplingKernelTest<T>::mBufferManager;
+
+    typename SamplingKernelTest<T>::TensorPtr mLogitsDevice;
+
+private:
+    size_t getWorkspaceSize(const SamplingKernelTestParam& params) override
+    {
+        // The fused kernel keeps its state in shared memory
+        return 1;
+    }
+
+    void callTestedFunction(const SamplingKernelTestParam& params, bool hasDiffRuntimeArgs, size_t workspaceSize,
+        tensorrt_llm::runtime::ITensor::SharedPtr& workspaceDevice) override
+    {
+        // The fused kernel reads the raw logits and computes the probabilities on the fly
+        mLogitsDevice = mBufferManager->copyFrom(*this->mLogitsHost, MemoryType::kGPU);
+
+        tk::invokeBatchFusedSampling<T>(bufferCast<int*>(*this->mIdsPtrHost),
+            bufferCast<int32_t>(*this->mSeqLengthsDevice),
+            reinterpret_cast<tk::FinishedState*>(
+                bufferCast<tk::FinishedState::UnderlyingType>(*this->mFinishedDevice)),
+            reinterpret_cast<tk::FinishedState*>(
+                bufferCast<tk::FinishedState::UnderlyingType>(*this->mFinishedDevice)),
+            bufferCast<float>(*this->mCumLogProbsDevice), bufferCast<float>(*this->mOutputLogProbsDevice),
+            bufferCast<T>(*mLogitsDevice), nullptr, nullptr, bufferCast<int32_t>(*this->mTopKsDevice),
+            bufferCast<float>(*this->mTopPsDevice), this->mCurandStatesDevice,
+            bufferCast<int32_t>(*this->mEndIdsDevice), params.batchSize, params.vocabSize, params.vocabSize,
+            bufferCast<bool>(*this->mSkipDecodeDevice), false, mStream->get());
+    }
+};
+
+TYPED_TEST_SUITE(FusedSamplingKernelTest, FloatAndHalfTypes);
+
+TYPED_TEST(FusedSamplingKernelTest, CorrectnessGreedy)
+{
+    this->runTest(SamplingKernelTestParam().setBatchSize(6).setVocabSize(4).setTopK(1).setTopP(1.0f).setOutputLen(1));
+};
+
+TYPED_TEST(FusedSamplingKernelTest, CorrectnessTopK)
+{
+    this->runTest(SamplingKernelTestParam().setBatchSize(6).setVocabSize(4).setTopK(2).setTopP(1.0f).setOutputLen(1));
+};
+
+TYPED_TEST(FusedSamplingKernelTest, CorrectnessTopKTopP)
+{
+    this->runTest(SamplingKernelTestParam().setBatchSize(6).setVocabSize(4).setTopK(2).setTopP(0.6f).setOutputLen(1));
+};
+
+TYPED_TEST(FusedSamplingKernelTest, CorrectnessTopP)
+{
+    this->runTest(SamplingKernelTestParam().setBatchSize(6).setVocabSize(4).setTopK(0).setTopP(0.9f).setOutputLen(1));
+};
+
+TYPED_TEST(FusedSamplingKernelTest, CorrectnessLargeVocabTopK)
+{
+    this->runTest(
+        SamplingKernelTestParam().setBatchSize(32).setVocabSize(51200).setTopK(63).setTopP(1.0f).setOutputLen(16));
+};
+
+TYPED_TEST(FusedSamplingKernelTest, CorrectnessLargeVocabTopP)
+{
+    this->runTest(
+        SamplingKernelTestParam().setBatchSize(32).setVocabSize(51200).setTopK(0).setTopP(0.2f).setOutputLen(16));
+};
+
+TYPED_TEST(FusedSamplingKernelTest, CorrectnessLargeVocabAncestral)
+{
+    this->runTest(
+        SamplingKernelTestParam().setBatchSize(32).setVocabSize(51200).setTopK(0).setTopP(1.0f).setOutputLen(16));
+};
+
+class FusedSamplingKernelSetTest : public SamplingKernelTest<float>
+{
+};
+
+TEST_F(FusedSamplingKernelSetTest, SamplesFromSelectedTokens)
+{
+    // Ten tied tokens hold 60% of the probability, the ties are broken by index order
+    SizeType constexpr vocabSize = 1000;
+    SizeType constexpr numTied = 10;
+    SizeType constexpr numSteps = 64;
+    std::vector<int32_t> const topKs{4, 0, 1, 0, 3};
+    std::vector<float> const topPs{1.0f, 0.5f, 1.0f, 1.0f, 0.5f};
+    std::vector<float> const temperatures{1.0f, 1.0f, 1.0f, 0.01f, 1.0f};
+    // Number of tied tokens that may be sampled per request
+    std::vector<int32_t> const numSelected{4, 9, 1, numTied, 2};
+    auto const batchSize = static_cast<SizeType>(topKs.size());
+
+    float const tiedLogit = std::log(1.5f * (vocabSize - 1 - numTied) / numTied);
+    std::vector<float> logits(batchSize * vocabSize, 0.0f);
+    for (SizeType bi = 0; bi < batchSize; ++bi)
+    {
+        std::fill_n(logits.begin() + bi * vocabSize, numTied, tiedLogit);
+    }
+    // The bias moves token 0 out of and token numTied into the tied tokens, which become [1, numTied]
+    std::vector<float> bias(vocabSize, 0.0f);
+    bias[0] = -1.0e4f;
+    bias[numTied] = tiedLogit;
+    std::vector<int32_t> const endIds(batchSize, vocabSize - 1);
+
+    auto logitsDevice = mBufferManager->copyFrom(logits, ITensor::makeShape({batchSize, vocabSize}), MemoryType::kGPU);
+    auto biasDevice = mBufferManager->copyFrom(bias, ITensor::makeShape({vocabSize}), MemoryType::kGPU);
+    auto topKsDevice = mBufferManager->copyFrom(topKs, ITensor::makeShape({batchSize}), MemoryType::kGPU);
+    auto topPsDevice = mBufferManager->copyFrom(topPs, ITensor::makeShape({batchSize}), MemoryType::kGPU);
+    auto temperaturesDevice = mBufferManager->copyFrom(temperatures, ITensor::makeShape({batchSize}), MemoryType::kGPU);
+    auto endIdsDevice = mBufferManager->copyFrom(endIds, ITensor::makeShape({batchSize}), MemoryType::kGPU);
+    auto outputIdsDevice = mBufferManager->gpu(ITensor::makeShape({batchSize, numSteps}), nvinfer1::DataType::kINT32);
+    auto seqLengthsDevice = mBufferManager->gpu(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT32);
+    trk::invokeFill(*seqLengthsDevice, int32_t{0}, *mStream);
+    auto idsPtrHost = mBufferManager->pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT64);
+    auto idsPtrHostPtr = reinterpret_cast<int**>(bufferCast<int64_t>(*idsPtrHost));
+    for (SizeType bi = 0; bi < batchSize; ++bi)
+    {
+        idsPtrHostPtr[bi] = bufferCast<int32_t>(*outputIdsDevice) + bi * numSteps;
+    }
+
+    curandState_t* curandStatesDevice;
+    cudaMalloc(&curandStatesDevice, sizeof(curandState_t) * batchSize);
+    tk::invokeCurandInitialize(curandStatesDevice, batchSize, 0, mStream->get());
+
+    for (SizeType step = 0; step < numSteps; ++step)
+    {
+        tk::invokeBatchFusedSampling<float>(idsPtrHostPtr, bufferCast<int32_t>(*seqLengthsDevice), nullptr, nullptr,
+            nullptr, nullptr, bufferCast<float>(*logitsDevice), bufferCast<float>(*biasDevice),
+            bufferCast<float>(*temperaturesDevice), bufferCast<int32_t>(*topKsDevice), bufferCast<float>(*topPsDevice),
+            curandStatesDevice, bufferCast<int32_t>(*endIdsDevice), batchSize, vocabSize, vocabSize, nullptr, false,
+            mStream->get());
+        // Without a finished buffer the sequence lengths are not updated
+        trk::invokeFill(*seqLengthsDevice, step + 1, *mStream);
+    }
+
+    auto const outputIdsHost = mBufferManager->copyFrom(*outputIdsDevice, MemoryType::kCPU);
+    mStream->synchronize();
+    cudaFree(curandStatesDevice);
+
+    auto const outputIdsHostPtr = bufferCast<int32_t>(*outputIdsHost);
+    for (SizeType bi = 0; bi < batchSize; ++bi)
+    {
+        for (SizeType step = 0; step < numSteps; ++step)
+        {
+            auto const id = outputIdsHostPtr[bi * numSteps + step];
+            EXPECT_GE(id, 1) << "batch " << bi << " step " << step;
+            EXPECT_LE(id, numSelected[bi]) << "batch " << bi << " step " << step;
+        }
+    }
+}
+
+TEST_F(FusedSamplingKernelSetTest, CounterBasedSamplingIsBatchInvariant)
+{
+    // The same requests sampled in different batch slots draw the same tokens
+    SizeType constexpr vocabSize = 1000;
+    SizeType constexpr numSteps = 16;
+    std::vector<uint64_t> const seeds{7, 42, 42, 1234, 99};
+    std::vector<int32_t> const topKs{0, 0, 16, 4, 0};
+    std::vector<float> const topPs{1.0f, 0.9f, 1.0f, 1.0f, 0.5f};
+    auto const batchSize = static_cast<SizeType>(seeds.size());
+
+    std::vector<float> logits(batchSize * vocabSize);
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<float> dist(-3.0f, 3.0f);
+    std::generate(logits.begin(), logits.end(), [&]() { return dist(gen); });
+    std::vector<int32_t> const endIds(batchSize, vocabSize);
+
+    auto runSampling = [&](std::vector<SizeType> const& slots)
+    {
+        // Request slots[bi] is placed in slot bi
+        std::vector<float> slotLogits(batchSize * vocabSize);
+        std::vector<uint64_t> slotSeeds(batchSize);
+        std::vector<int32_t> slotTopKs(batchSize);
+        std::vector<float> slotTopPs(batchSize);
+        for (SizeType bi = 0; bi < batchSize; ++bi)
+        {
+            std::copy_n(logits.begin() + slots[bi] * vocabSize, vocabSize, slotLogits.begin() + bi * vocabSize);
+            slotSeeds[bi] = seeds[slots[bi]];
+            slotTopKs[bi] = topKs[slots[bi]];
+            slotTopPs[bi] = topPs[slots[bi]];
+        }
+        auto logitsDevice
+            = mBufferManager->copyFrom(slotLogits, ITensor::makeShape({batchSize, vocabSize}), MemoryType::kGPU);
+        auto seedsDevice = mBufferManager->copyFrom(slotSeeds, ITensor::makeShape({batchSize}), MemoryType::kGPU);
+        auto topKsDevice = mBufferManager->copyFrom(slotTopKs, ITensor::makeShape({batchSize}), MemoryType::kGPU);
+        auto topPsDevice = mBufferManager->copyFrom(slotTopPs, ITensor::makeShape({batchSize}), MemoryType::kGPU);
+        auto endIdsDevice = mBufferManager->copyFrom(endIds, ITensor::makeShape({batchSize}), MemoryType::kGPU);
+        auto outputIdsDevice
+            = mBufferManager->gpu(ITensor::makeShape({batchSize, numSteps}), nvinfer1::DataType::kINT32);
+        auto seqLengthsDevice = mBufferManager->gpu(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT32);
+        auto idsPtrHost = mBufferManager->pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT64);
+        auto idsPtrHostPtr = reinterpret_cast<int**>(bufferCast<int64_t>(*idsPtrHost));
+        for (SizeType bi = 0; bi < batchSize; ++bi)
+        {
+            idsPtrHostPtr[bi] = bufferCast<int32_t>(*outputIdsDevice) + bi * numSteps;
+        }
+
+        for (SizeType step = 0; step < numSteps; ++step)
+        {
+            trk::invokeFill(*seqLengthsDevice, step, *mStream);
+            tk::invokeBatchFusedSampling<float>(idsPtrHostPtr, bufferCast<int32_t>(*seqLengthsDevice), nullptr,
+                nullptr, nullptr, nullptr, bufferCast<float>(*logitsDevice), nullptr, nullptr,
+                bufferCast<int32_t>(*topKsDevice), bufferCast<float>(*topPsDevice), nullptr,
+                bufferCast<int32_t>(*endIdsDevice), batchSize, vocabSize, vocabSize, nullptr, false, mStream->get(),
+                bufferCast<uint64_t>(*seedsDevice));
+        }
+
+        auto const outputIdsHost = mBufferManager->copyFrom(*outputIdsDevice, MemoryType::kCPU);
+        mStream->synchronize();
+        auto const outputIdsHostPtr = bufferCast<int32_t>(*outputIdsHost);
+        std::vector<std::vector<int32_t>> outputIds(batchSize);
+        for (SizeType bi = 0; bi < batchSize; ++bi)
+        {
+            outputIds[slots[bi]].assign(outputIdsHostPtr + bi * numSteps, outputIdsHostPtr + (bi + 1) * numSteps);
+        }
+        return outputIds;
+    };
+
+    auto const outputIds = runSampling({0, 1, 2, 3, 4});
+    EXPECT_EQ(outputIds, runSampling({4, 3, 2, 1, 0}));
+    EXPECT_EQ(outputIds, runSampling({2, 0, 4, 1, 3}));
+}
+
+} // end of namespace
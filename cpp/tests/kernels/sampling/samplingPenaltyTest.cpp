@@ -553,6 +553,46 @@ public:
             mBatchSize * mVocabSizePadded);
         EXPECT_TRUE(passed);
     }
+
+    void runHistogramTest(RepetitionPenaltyTestCase param)
+    {
+        subsetup(param);
+        auto histogramsDevice = mBufferManager->gpu(
+            tk::TokenHistograms::getSize(mBatchSize, mSequenceLength) / sizeof(int32_t), nvinfer1::DataType::kINT32);
+        tk::TokenHistograms const histograms(bufferCast<int32_t>(*histogramsDevice), mSequenceLength);
+        tk::invokeResetTokenHistograms(histograms, 0, mBatchSize, mStream->get());
+
+        // Build the histograms in two updates, as over several decoding steps
+        auto halfSeqLengthHost = mBufferManager->copyFrom(*mSeqLengthHost, MemoryType::kPINNED);
+        mStream->synchronize();
+        for (SizeType bi = 0; bi < mBatchSize; ++bi)
+        {
+            bufferCast<int32_t>(*halfSeqLengthHost)[bi] /= 2;
+        }
+        auto const idsPtr = reinterpret_cast<const int32_t**>(bufferCast<int64_t>(*mIdsPtrDevice));
+        tk::invokeUpdateTokenHistograms(histograms, idsPtr, bufferCast<int32_t>(*halfSeqLengthHost), mBatchSize,
+            mVocabSizePadded, mStream->get());
+        tk::invokeUpdateTokenHistograms(histograms, idsPtr, bufferCast<int32_t>(*mSeqLengthHost), mBatchSize,
+            mVocabSizePadded, mStream->get());
+
+        tk::invokeBatchApplyRepetitionPenaltyFromHistograms(bufferCast<T>(*mLogitsDevice),
+            bufferCast<float>(*mRepetitionPenaltiesDevice), bufferCast<float>(*mPresencePenaltiesDevice),
+            bufferCast<float>(*mFrequencyPenaltiesDevice), true, true, true, histograms, mBatchSize,
+            mVocabSizePadded, mStream->get());
+
+        auto logitsOutHost = mBufferManager->copyFrom(*mLogitsDevice, MemoryType::kCPU);
+
+        computeReference(bufferCast<T>(*mLogitsHost), bufferCast<int32_t>(*mOutputIdsHost),
+            bufferCast<int32_t>(*mSeqLengthHost), bufferCast<float>(*param.repetitionPenalties),
+            bufferCast<float>(*param.presencePenalties), bufferCast<float>(*param.frequencyPenalties),
+            param.repetitionPenaltiesSize, param.presencePenaltiesSize, param.frequencyPenaltiesSize);
+
+        mStream->synchronize();
+
+        bool passed = checkResult(param.toString(), bufferCast<T>(*logitsOutHost), bufferCast<T>(*mLogitsHost),
+            mBatchSize * mVocabSizePadded);
+        EXPECT_TRUE(passed);
+    }
 };
 
 TYPED_TEST_SUITE(RepetitionPenaltyTest, FloatAndHalfTypes);
@@ -881,6 +921,60 @@ TYPED_TEST(RepetitionPenaltyTest, PenaltyTypeFull)
                       .setFrequencyPenaltiesSize(batchSize));
 }
 
+TYPED_TEST(RepetitionPenaltyTest, PenaltyTypeFullFromHistograms)
+{
+    int32_t batchSize = 6;
+    TensorPtr repetitionPenaltyHost
+        = this->mBufferManager->pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kFLOAT);
+    TensorPtr presencePenaltyHost
+        = this->mBufferManager->pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kFLOAT);
+    TensorPtr frequencyPenaltyHost
+        = this->mBufferManager->pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kFLOAT);
+    for (int32_t i = 0; i < batchSize; ++i)
+    {
+        bufferCast<float>(*repetitionPenaltyHost)[i] = 0.53 + i * 0.2f;
+        bufferCast<float>(*presencePenaltyHost)[i] = 0.53 + i * 0.2f;
+        bufferCast<float>(*frequencyPenaltyHost)[i] = 0.53 + i * 0.2f;
+    }
+    this->runHistogramTest(RepetitionPenaltyTestCase()
+                               .setBatchSize(batchSize)
+                               .setVocabSize(4)
+                               .setMaxInputLength(5)
+                               .setRepetitionPenalties(repetitionPenaltyHost)
+                               .setPresencePenalties(presencePenaltyHost)
+                               .setFrequencyPenalties(frequencyPenaltyHost)
+                               .setRepetitionPenaltiesSize(batchSize)
+                               .setPresencePenaltiesSize(batchSize)
+                               .setFrequencyPenaltiesSize(batchSize));
+}
+
+TYPED_TEST(RepetitionPenaltyTest, PenaltyTypeFullFromHistogramsLargeVocab)
+{
+    int32_t batchSize = 4;
+    TensorPtr repetitionPenaltyHost
+        = this->mBufferManager->pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kFLOAT);
+    TensorPtr presencePenaltyHost
+        = this->mBufferManager->pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kFLOAT);
+    TensorPtr frequencyPenaltyHost
+        = this->mBufferManager->pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kFLOAT);
+    for (int32_t i = 0; i < batchSize; ++i)
+    {
+        bufferCast<float>(*repetitionPenaltyHost)[i] = 1.1f + i * 0.1f;
+        bufferCast<float>(*presencePenaltyHost)[i] = 0.1f * i;
+        bufferCast<float>(*frequencyPenaltyHost)[i] = 0.05f * i;
+    }
+    this->runHistogramTest(RepetitionPenaltyTestCase()
+                               .setBatchSize(batchSize)
+                               .setVocabSize(51200)
+                               .setMaxInputLength(600)
+                               .setRepetitionPenalties(repetitionPenaltyHost)
+                               .setPresencePenalties(presencePenaltyHost)
+                               .setFrequencyPenalties(frequencyPenaltyHost)
+                               .setRepetitionPenaltiesSize(batchSize)
+                               .setPresencePenaltiesSize(batchSize)
+                               .setFrequencyPenaltiesSize(batchSize));
+}
+
 struct MinLengthPenaltyTestParams
 {
     int32_t batchSize;
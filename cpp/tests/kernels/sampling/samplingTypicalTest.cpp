@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TOP_LEVEL_DIR
+#error "Define TOP_LEVEL_DIR"
+#endif
+
+#include "tensorrt_llm/kernels/samplingTypicalKernels.h"
+#include "tests/kernels/sampling/samplingTest.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace tc = tensorrt_llm::common;
+namespace tk = tensorrt_llm::kernels;
+namespace trk = tensorrt_llm::runtime::kernels;
+
+using namespace tensorrt_llm::runtime;
+using namespace tensorrt_llm::tests::kernels::sampling;
+
+namespace
+{
+
+class TypicalSamplingKernelTest : public SamplingKernelTest<float>
+{
+};
+
+TEST_F(TypicalSamplingKernelTest, SamplesFromSelectedTokens)
+{
+    SizeType constexpr vocabSize = 8;
+    SizeType constexpr numSteps = 64;
+    std::vector<float> const requestProbs{0.4f, 0.3f, 0.15f, 0.1f, 0.05f, 0.0f, 0.0f, 0.0f};
+    // The entropy is 1.39, the tokens ordered by the distance of -log(p) to it are 1, 0, 2, 3, 4
+    std::vector<float> const typicalPs{0.3f, 0.7f, 0.8f, 1.0f};
+    // Tokens that may be sampled per request, the tokens with probability 0 never are
+    std::vector<std::vector<int32_t>> const selected{{1}, {0, 1}, {0, 1, 2}, {0, 1, 2, 3, 4}};
+    auto const batchSize = static_cast<SizeType>(typicalPs.size());
+
+    std::vector<float> probs;
+    for (SizeType bi = 0; bi < batchSize; ++bi)
+    {
+        probs.insert(probs.end(), requestProbs.begin(), requestProbs.end());
+    }
+    std::vector<uint64_t> seeds(batchSize);
+    std::iota(seeds.begin(), seeds.end(), 0);
+    std::vector<int32_t> const endIds(batchSize, vocabSize);
+
+    auto probsDevice = mBufferManager->copyFrom(probs, ITensor::makeShape({batchSize, vocabSize}), MemoryType::kGPU);
+    auto typicalPsDevice = mBufferManager->copyFrom(typicalPs, ITensor::makeShape({batchSize}), MemoryType::kGPU);
+    auto seedsDevice = mBufferManager->copyFrom(seeds, ITensor::makeShape({batchSize}), MemoryType::kGPU);
+    auto endIdsDevice = mBufferManager->copyFrom(endIds, ITensor::makeShape({batchSize}), MemoryType::kGPU);
+    auto outputIdsDevice = mBufferManager->gpu(ITensor::makeShape({batchSize, numSteps}), nvinfer1::DataType::kINT32);
+    auto seqLengthsDevice = mBufferManager->gpu(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT32);
+    auto idsPtrHost = mBufferManager->pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT64);
+    auto idsPtrHostPtr = reinterpret_cast<int**>(bufferCast<int64_t>(*idsPtrHost));
+    for (SizeType bi = 0; bi < batchSize; ++bi)
+    {
+        idsPtrHostPtr[bi] = bufferCast<int32_t>(*outputIdsDevice) + bi * numSteps;
+    }
+
+    size_t workspaceSize = 0;
+    tk::invokeBatchTypicalSampling<float>(nullptr, workspaceSize, nullptr, nullptr, nullptr, nullptr, nullptr,
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, batchSize, vocabSize, nullptr, mStream->get());
+    auto workspaceDevice
+        = mBufferManager->gpu(ITensor::makeShape({static_cast<SizeType>(workspaceSize)}), nvinfer1::DataType::kINT8);
+
+    for (SizeType step = 0; step < numSteps; ++step)
+    {
+        // Without a finished buffer the sequence lengths are not updated
+        trk::invokeFill(*seqLengthsDevice, step, *mStream);
+        tk::invokeBatchTypicalSampling<float>(workspaceDevice->data(), workspaceSize, idsPtrHostPtr,
+            bufferCast<int32_t>(*seqLengthsDevice), nullptr, nullptr, nullptr, nullptr, bufferCast<float>(*probsDevice),
+            bufferCast<float>(*typicalPsDevice), nullptr, bufferCast<uint64_t>(*seedsDevice),
+            bufferCast<int32_t>(*endIdsDevice), batchSize, vocabSize, nullptr, mStream->get());
+    }
+
+    auto const outputIdsHost = mBufferManager->copyFrom(*outputIdsDevice, MemoryType::kCPU);
+    mStream->synchronize();
+
+    auto const outputIdsHostPtr = bufferCast<int32_t>(*outputIdsHost);
+    for (SizeType bi = 0; bi < batchSize; ++bi)
+    {
+        auto const& tokens = selected[bi];
+        for (SizeType step = 0; step < numSteps; ++step)
+        {
+            auto const id = outputIdsHostPtr[bi * numSteps + step];
+            EXPECT_NE(std::find(tokens.begin(), tokens.end(), id), tokens.end()) << "batch " << bi << " step " << step;
+        }
+    }
+}
+
+} // end of namespace
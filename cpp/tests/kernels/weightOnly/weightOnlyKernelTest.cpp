@@ -463,3 +463,31 @@ TEST(Kernel, WeightOnly)
         }
     }
 }
+
+TEST(Kernel, WeightOnlyPerChannelLargeBatch)
+{
+    bool pass;
+    int warmup = 10, iter = 30;
+    std::vector<int> ms{5, 8, 12, 16};
+    std::vector<int> ns{512, 4096};
+    std::vector<int> ks{512, 4096};
+    for (auto m : ms)
+    {
+        for (auto n : ns)
+        {
+            for (auto k : ks)
+            {
+                pass = benchmark<WeightOnlyActivationType::FP16, WeightOnlyQuantType::Int8b>(m, n, k, 0, warmup, iter);
+                EXPECT_TRUE(pass);
+                pass = benchmark<WeightOnlyActivationType::FP16, WeightOnlyQuantType::Int4b>(m, n, k, 0, warmup, iter);
+                EXPECT_TRUE(pass);
+#if defined(ENABLE_BF16)
+                pass = benchmark<WeightOnlyActivationType::BF16, WeightOnlyQuantType::Int8b>(m, n, k, 0, warmup, iter);
+                EXPECT_TRUE(pass);
+                pass = benchmark<WeightOnlyActivationType::BF16, WeightOnlyQuantType::Int4b>(m, n, k, 0, warmup, iter);
+                EXPECT_TRUE(pass);
+#endif
+            }
+        }
+    }
+}
@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef TOP_LEVEL_DIR
+#error "Define TOP_LEVEL_DIR"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/kernels/banBadWords.h"
+#include "tensorrt_llm/kernels/decodingCommon.h"
+#include "tensorrt_llm/kernels/stopCriteriaKernels.h"
+#include "tensorrt_llm/kernels/wordsAutomatonKernels.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace tk = tensorrt_llm::kernels;
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+class WordsAutomatonKernelsTest : public testing::Test
+{
+public:
+    using TensorPtr = tensorrt_llm::runtime::ITensor::SharedPtr;
+
+    void SetUp() override
+    {
+        mStream = std::make_shared<tensorrt_llm::runtime::CudaStream>();
+        mBufferManager = std::make_shared<tensorrt_llm::runtime::BufferManager>(mStream);
+    }
+
+    void TearDown() override {}
+
+    //! Random words with tokens from a small vocab, so that the sequences match some of them
+    void initData(SizeType seed, SizeType batchSize, SizeType beamWidth)
+    {
+        std::mt19937 generator(seed);
+        std::uniform_int_distribution<int> tokenDistr(0, mVocabSize - 1);
+        std::uniform_int_distribution<int> numWordsDistr(1, 12);
+        std::uniform_int_distribution<int> wordLenDistr(1, 4);
+        std::uniform_int_distribution<int> seqLenDistr(mNumSteps, mMaxSeqLen);
+
+        std::vector<std::vector<std::vector<int>>> words(batchSize);
+        mWordsLen = 1;
+        for (auto& batchWords : words)
+        {
+            SizeType totalLen = 0;
+            batchWords.resize(numWordsDistr(generator));
+            for (auto& word : batchWords)
+            {
+                word.resize(wordLenDistr(generator));
+                std::generate(word.begin(), word.end(), [&]() { return tokenDistr(generator); });
+                totalLen += word.size();
+            }
+            // One more entry than words, so that the offsets row always ends with a -1
+            mWordsLen = std::max(mWordsLen, totalLen + 1);
+        }
+
+        mWords = mBufferManager->pinned(ITensor::makeShape({batchSize, 2, mWordsLen}), nvinfer1::DataType::kINT32);
+        auto wordsData = bufferCast<int32_t>(*mWords);
+        std::fill(wordsData, wordsData + batchSize * 2 * mWordsLen, -1);
+        for (SizeType bi = 0; bi < batchSize; ++bi)
+        {
+            SizeType totalLen = 0;
+            for (SizeType wi = 0; wi < words[bi].size(); ++wi)
+            {
+                std::copy(words[bi][wi].begin(), words[bi][wi].end(), wordsData + bi * 2 * mWordsLen + totalLen);
+                totalLen += words[bi][wi].size();
+                wordsData[bi * 2 * mWordsLen + mWordsLen + wi] = totalLen;
+            }
+        }
+
+        mOutputIds = mBufferManager->pinned(
+            ITensor::makeShape({batchSize, beamWidth, mMaxSeqLen}), nvinfer1::DataType::kINT32);
+        mParentIds = mBufferManager->pinned(
+            ITensor::makeShape({batchSize, beamWidth, mMaxSeqLen}), nvinfer1::DataType::kINT32);
+        mOutputIdsPtr = mBufferManager->pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT64);
+        mParentIdsPtr = mBufferManager->pinned(ITensor::makeShape({batchSize}), nvinfer1::DataType::kINT64);
+        auto outputIdsData = bufferCast<int32_t>(*mOutputIds);
+        auto parentIdsData = bufferCast<int32_t>(*mParentIds);
+        auto outputIdsPtrsData = reinterpret_cast<void**>(bufferCast<int64_t>(*mOutputIdsPtr));
+        auto parentIdsPtrsData = reinterpret_cast<void**>(bufferCast<int64_t>(*mParentIdsPtr));
+        for (SizeType bi = 0; bi < batchSize; ++bi)
+        {
+            for (SizeType ri = 0; ri < beamWidth; ++ri)
+            {
+                for (SizeType si = 0; si < mMaxSeqLen; ++si)
+                {
+                    auto const idx = (bi * beamWidth + ri) * mMaxSeqLen + si;
+                    outputIdsData[idx] = tokenDistr(generator);
+                    // Every beam continues itself, so that both kernels see the same sequences
+                    parentIdsData[idx] = ri;
+                }
+            }
+            outputIdsPtrsData[bi] = outputIdsData + bi * beamWidth * mMaxSeqLen;
+            parentIdsPtrsData[bi] = parentIdsData + bi * beamWidth * mMaxSeqLen;
+        }
+
+        mFinalLengths.resize(batchSize * beamWidth);
+        std::generate(mFinalLengths.begin(), mFinalLengths.end(), [&]() { return seqLenDistr(generator); });
+        mSequenceLengths
+            = mBufferManager->pinned(ITensor::makeShape({batchSize, beamWidth}), nvinfer1::DataType::kINT32);
+        mFinished = mBufferManager->pinned(
+            ITensor::makeShape({batchSize, beamWidth}), TRTDataType<tk::FinishedState::UnderlyingType>::value);
+        mRefFinished = mBufferManager->pinned(
+            ITensor::makeShape({batchSize, beamWidth}), TRTDataType<tk::FinishedState::UnderlyingType>::value);
+        mLogits = mBufferManager->pinned(
+            ITensor::makeShape({batchSize, beamWidth, mVocabSize}), nvinfer1::DataType::kFLOAT);
+        mRefLogits = mBufferManager->pinned(
+            ITensor::makeShape({batchSize, beamWidth, mVocabSize}), nvinfer1::DataType::kFLOAT);
+
+        mStates = mBufferManager->pinned(ITensor::makeShape({batchSize, beamWidth}), nvinfer1::DataType::kINT32);
+        mStateLengths
+            = mBufferManager->pinned(ITensor::makeShape({batchSize, beamWidth}), nvinfer1::DataType::kINT32);
+        std::fill_n(bufferCast<int32_t>(*mStateLengths), batchSize * beamWidth, -1);
+    }
+
+    tk::WordsAutomaton buildAutomaton(SizeType batchSize, bool isBadWords)
+    {
+        auto const automaton
+            = tk::buildWordsAutomaton(bufferCast<int32_t>(*mWords), batchSize, mWordsLen, batchSize, isBadWords);
+        mAutomatonData = mBufferManager->pinned(
+            ITensor::makeShape({static_cast<SizeType>(automaton.data.size())}), nvinfer1::DataType::kINT32);
+        std::copy(automaton.data.begin(), automaton.data.end(), bufferCast<int32_t>(*mAutomatonData));
+        return automaton.view(bufferCast<int32_t>(*mAutomatonData));
+    }
+
+    //! Sequences grow one token per step from mFinalLengths - mNumSteps + 1, the automaton walks them at the first
+    //! step and takes a single transition per beam afterwards
+    void setStepLengths(SizeType step)
+    {
+        auto sequenceLengthsPtr = bufferCast<SizeType>(*mSequenceLengths);
+        for (std::size_t i = 0; i < mFinalLengths.size(); ++i)
+        {
+            sequenceLengthsPtr[i] = mFinalLengths[i] - mNumSteps + 1 + step;
+        }
+    }
+
+    void runStopWordsTest(SizeType batchSize, SizeType beamWidth)
+    {
+        initData(0, batchSize, beamWidth);
+        auto const automaton = buildAutomaton(batchSize, false);
+
+        auto finishedPtr
+            = reinterpret_cast<tk::FinishedState*>(bufferCast<tk::FinishedState::UnderlyingType>(*mFinished));
+        auto refFinishedPtr
+            = reinterpret_cast<tk::FinishedState*>(bufferCast<tk::FinishedState::UnderlyingType>(*mRefFinished));
+        SizeType numStopped = 0;
+        for (SizeType step = 0; step < mNumSteps; ++step)
+        {
+            setStepLengths(step);
+            std::fill_n(finishedPtr, batchSize * beamWidth, tk::FinishedState::empty());
+            std::fill_n(refFinishedPtr, batchSize * beamWidth, tk::FinishedState::empty());
+
+            tk::invokeStopWordsCriterion(reinterpret_cast<const int**>(bufferCast<int64_t>(*mOutputIdsPtr)),
+                reinterpret_cast<const int**>(bufferCast<int64_t>(*mParentIdsPtr)), bufferCast<SizeType>(*mWords),
+                refFinishedPtr, bufferCast<SizeType>(*mSequenceLengths), mWordsLen, batchSize, beamWidth, mMaxSeqLen,
+                mStream->get());
+            tk::invokeStopWordsAutomatonCriterion(automaton, bufferCast<SizeType>(*mStates),
+                bufferCast<SizeType>(*mStateLengths),
+                reinterpret_cast<const int**>(bufferCast<int64_t>(*mOutputIdsPtr)),
+                reinterpret_cast<const int**>(bufferCast<int64_t>(*mParentIdsPtr)), finishedPtr,
+                bufferCast<SizeType>(*mSequenceLengths), batchSize, beamWidth, mMaxSeqLen, mStream->get());
+            mStream->synchronize();
+
+            for (SizeType bi = 0; bi < batchSize * beamWidth; ++bi)
+            {
+                EXPECT_EQ(refFinishedPtr[bi].isFinishedStopWords(), finishedPtr[bi].isFinishedStopWords())
+                    << "index " << bi << " step " << step;
+                numStopped += refFinishedPtr[bi].isFinishedStopWords();
+            }
+        }
+        // Make sure that the test covers matches
+        EXPECT_GT(numStopped, 0);
+    }
+
+    void runBadWordsTest(SizeType batchSize, SizeType beamWidth)
+    {
+        initData(0, batchSize, beamWidth);
+        auto const automaton = buildAutomaton(batchSize, true);
+
+        auto logitsPtr = bufferCast<float>(*mLogits);
+        auto refLogitsPtr = bufferCast<float>(*mRefLogits);
+        auto const logitsSize = batchSize * beamWidth * mVocabSize;
+        SizeType numBanned = 0;
+        for (SizeType step = 0; step < mNumSteps; ++step)
+        {
+            setStepLengths(step);
+            std::fill_n(logitsPtr, logitsSize, 0.0f);
+            std::fill_n(refLogitsPtr, logitsSize, 0.0f);
+
+            tk::invokeBanBadWords(refLogitsPtr, reinterpret_cast<const int**>(bufferCast<int64_t>(*mOutputIdsPtr)),
+                beamWidth > 1 ? reinterpret_cast<const int**>(bufferCast<int64_t>(*mParentIdsPtr)) : nullptr,
+                batchSize, batchSize, beamWidth, bufferCast<SizeType>(*mWords), false, mWordsLen, mVocabSize,
+                bufferCast<SizeType>(*mSequenceLengths), mMaxSeqLen, mStream->get());
+            tk::invokeBanBadWordsAutomaton(logitsPtr, automaton, bufferCast<SizeType>(*mStates),
+                bufferCast<SizeType>(*mStateLengths),
+                reinterpret_cast<const int**>(bufferCast<int64_t>(*mOutputIdsPtr)),
+                beamWidth > 1 ? reinterpret_cast<const int**>(bufferCast<int64_t>(*mParentIdsPtr)) : nullptr,
+                bufferCast<SizeType>(*mSequenceLengths), batchSize, beamWidth, mVocabSize, mMaxSeqLen, mStream->get());
+            mStream->synchronize();
+
+            for (SizeType i = 0; i < logitsSize; ++i)
+            {
+                EXPECT_EQ(std::isinf(refLogitsPtr[i]), std::isinf(logitsPtr[i])) << "index " << i << " step " << step;
+                numBanned += std::isinf(refLogitsPtr[i]);
+            }
+        }
+        EXPECT_GT(numBanned, 0);
+    }
+
+protected:
+    std::shared_ptr<tensorrt_llm::runtime::BufferManager> mBufferManager;
+    std::shared_ptr<tensorrt_llm::runtime::CudaStream> mStream;
+
+    TensorPtr mWords;
+    TensorPtr mOutputIds;
+    TensorPtr mOutputIdsPtr;
+    TensorPtr mParentIds;
+    TensorPtr mParentIdsPtr;
+    TensorPtr mSequenceLengths;
+    TensorPtr mFinished;
+    TensorPtr mRefFinished;
+    TensorPtr mLogits;
+    TensorPtr mRefLogits;
+    TensorPtr mAutomatonData;
+    TensorPtr mStates;
+    TensorPtr mStateLengths;
+    std::vector<SizeType> mFinalLengths;
+    SizeType mWordsLen{0};
+
+    static constexpr SizeType mMaxSeqLen{32};
+    static constexpr SizeType mVocabSize{8};
+    static constexpr SizeType mNumSteps{8};
+};
+
+TEST_F(WordsAutomatonKernelsTest, stopWordsBS64BW1Test)
+{
+    this->runStopWordsTest(64, 1);
+}
+
+TEST_F(WordsAutomatonKernelsTest, stopWordsBS16BW2Test)
+{
+    this->runStopWordsTest(16, 2);
+}
+
+TEST_F(WordsAutomatonKernelsTest, badWordsBS64BW1Test)
+{
+    this->runBadWordsTest(64, 1);
+}
+
+TEST_F(WordsAutomatonKernelsTest, badWordsBS16BW2Test)
+{
+    this->runBadWordsTest(16, 2);
+}
+
+} // end of namespace
@@ -17,8 +17,11 @@
 #include <gtest/gtest.h>
 
 #include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/common/tllmException.h"
 #include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/scratchArena.h"
 
+#include <algorithm>
 #include <limits>
 #include <memory>
 
@@ -169,4 +172,211 @@ TEST_F(BufferManagerTest, MemPoolAttributes)
     manager.memoryPoolTrimTo(0);
     EXPECT_LE(manager.memoryPoolReserved(), reserved);
     EXPECT_LE(manager.memoryPoolFree(), free);
+
+    // The high watermark keeps the peak of the freed allocations until it is reset
+    manager.memoryPoolResetUsedHigh();
+    EXPECT_EQ(manager.memoryPoolUsedHigh(), manager.memoryPoolUsed());
+    {
+        auto const mem = manager.allocate(MemoryType::kGPU, kBytesToReserve);
+        mStream->synchronize();
+    }
+    mStream->synchronize();
+    EXPECT_GE(manager.memoryPoolUsedHigh(), manager.memoryPoolUsed() + kBytesToReserve);
+    manager.memoryPoolResetUsedHigh();
+    EXPECT_EQ(manager.memoryPoolUsedHigh(), manager.memoryPoolUsed());
+}
+
+namespace
+{
+
+// Counts the memory of its allocations, which it makes from the default memory pool
+class CountingGpuAllocator : public IGpuAllocator
+{
+public:
+    void* allocate(std::size_t size, ::cudaStream_t stream) override
+    {
+        void* ptr{nullptr};
+        TLLM_CUDA_CHECK(::cudaMallocAsync(&ptr, size, stream));
+        mUsed += size;
+        mUsedHigh = std::max(mUsedHigh, mUsed);
+        return ptr;
+    }
+
+    void deallocate(void* ptr, std::size_t size, ::cudaStream_t stream) override
+    {
+        TLLM_CUDA_CHECK(::cudaFreeAsync(ptr, stream));
+        mUsed -= size;
+    }
+
+    std::size_t reserved() const override
+    {
+        return mUsed + mCached;
+    }
+
+    std::size_t used() const override
+    {
+        return mUsed;
+    }
+
+    std::size_t usedHigh() const override
+    {
+        return mUsedHigh;
+    }
+
+    void resetUsedHigh() override
+    {
+        mUsedHigh = mUsed;
+    }
+
+    void releaseCached() override
+    {
+        mCached = 0;
+    }
+
+    std::size_t mUsed{0};
+    std::size_t mUsedHigh{0};
+    std::size_t mCached{64};
+};
+
+} // namespace
+
+TEST_F(BufferManagerTest, GpuAllocator)
+{
+    auto const allocator = std::make_shared<CountingGpuAllocator>();
+    BufferManager manager(mStream, allocator);
+    EXPECT_EQ(manager.getGpuAllocator(), allocator);
+
+    auto constexpr kBytes = 1 << 20;
+    {
+        auto const buffer = manager.gpu(kBytes);
+        auto const tensor = manager.gpu(ITensor::makeShape({kBytes / 4}), nvinfer1::DataType::kINT32);
+        EXPECT_EQ(allocator->used(), 2 * kBytes);
+        EXPECT_EQ(manager.memoryPoolUsed(), 2 * kBytes);
+        // Resizing a buffer beyond its capacity allocates again
+        tensor->reshape(ITensor::makeShape({kBytes / 2}));
+        EXPECT_EQ(manager.memoryPoolUsed(), 3 * kBytes);
+        // The pinned and host buffers do not use the allocator
+        auto const pinned = manager.pinned(kBytes);
+        EXPECT_EQ(manager.memoryPoolUsed(), 3 * kBytes);
+    }
+    EXPECT_EQ(manager.memoryPoolUsed(), 0);
+    EXPECT_EQ(manager.memoryPoolUsedHigh(), 3 * kBytes);
+    EXPECT_EQ(manager.memoryPoolFree(), allocator->mCached);
+    manager.memoryPoolResetUsedHigh();
+    EXPECT_EQ(manager.memoryPoolUsedHigh(), 0);
+    manager.memoryPoolTrimTo(0);
+    EXPECT_EQ(manager.memoryPoolReserved(), 0);
+}
+
+TEST(BufferArenaTest, Plan)
+{
+    BufferArena arena;
+    auto constexpr kType = nvinfer1::DataType::kFLOAT;
+    auto const shared = arena.add(kType, 1024, 0, 1);
+    auto const context = arena.add(kType, 512, 0, 0);
+    auto const generation = arena.add(kType, 256, 1, 1);
+    auto const small = arena.add(kType, 1, 1, 1);
+    arena.plan();
+
+    auto const sharedSize = 1024 * sizeof(float);
+    auto const contextSize = 512 * sizeof(float);
+    auto const generationSize = 256 * sizeof(float);
+    EXPECT_EQ(arena.getOffset(shared), 0);
+    EXPECT_EQ(arena.getOffset(context), sharedSize);
+    // The generation tensors reuse the memory of the context one
+    EXPECT_EQ(arena.getOffset(generation), sharedSize);
+    EXPECT_EQ(arena.getOffset(small), sharedSize + generationSize);
+    EXPECT_EQ(arena.getSize(), sharedSize + contextSize);
+    EXPECT_EQ(arena.getUnsharedSize(), sharedSize + contextSize + generationSize + BufferArena::kAlignment);
+
+    for (std::size_t idx = 0; idx < arena.getNbTensors(); ++idx)
+    {
+        EXPECT_EQ(arena.getOffset(idx) % BufferArena::kAlignment, 0);
+    }
+    EXPECT_THROW(arena.add(kType, 1, 1, 0), tc::TllmException);
+}
+
+TEST_F(BufferManagerTest, Arena)
+{
+    BufferManager manager(mStream);
+    BufferArena arena;
+    arena.add(nvinfer1::DataType::kINT32, 1000, 0, 0);
+    arena.add(nvinfer1::DataType::kHALF, 2000, 1, 1);
+    arena.add(nvinfer1::DataType::kINT64, 0, 0, 1);
+    arena.plan();
+
+    auto tensors = manager.gpu(arena);
+    ASSERT_EQ(tensors.size(), arena.getNbTensors());
+    for (std::size_t idx = 0; idx < tensors.size(); ++idx)
+    {
+        auto& tensor = *tensors[idx];
+        EXPECT_EQ(tensor.getMemoryType(), MemoryType::kGPU);
+        EXPECT_EQ(tensor.getDataType(), arena.getDataType(idx));
+        EXPECT_EQ(tensor.getSize(), 0);
+        EXPECT_EQ(tensor.getCapacity(), arena.getCapacity(idx));
+    }
+    EXPECT_EQ(tensors[0]->data(), tensors[1]->data());
+
+    tensors[0]->reshape(ITensor::makeShape({10, 100}));
+    EXPECT_EQ(tensors[0]->getSize(), 1000);
+    EXPECT_THROW(tensors[0]->reshape(ITensor::makeShape({1001})), std::bad_alloc);
+
+    // The tensors keep the allocation alive
+    auto tensor = tensors[1];
+    tensors.clear();
+    tensor->reshape(ITensor::makeShape({2000}));
+    manager.setZero(*tensor);
+    mStream->synchronize();
+}
+
+TEST_F(BufferManagerTest, ScratchArena)
+{
+    BufferManager manager(mStream);
+    ScratchArena scratch(manager, 1024);
+    EXPECT_EQ(scratch.getCapacity(), 1024);
+    EXPECT_THROW(static_cast<void>(scratch.allocate(16)), tc::TllmException);
+
+    void* firstData{};
+    {
+        ScratchArena::Frame const frame{scratch};
+        auto first = scratch.allocate(ITensor::makeShape({10, 10}), nvinfer1::DataType::kINT32);
+        EXPECT_EQ(first->getMemoryType(), MemoryType::kGPU);
+        EXPECT_EQ(first->getSize(), 100);
+        EXPECT_EQ(scratch.getUsed(), 512);
+        firstData = first->data();
+        {
+            ScratchArena::Frame const nested{scratch};
+            auto second = scratch.allocate(256, nvinfer1::DataType::kHALF);
+            EXPECT_EQ(second->data(), static_cast<std::uint8_t*>(firstData) + 512);
+            // The arena is full
+            auto third = scratch.allocate(1);
+            EXPECT_EQ(scratch.getNbOverflows(), 1);
+            EXPECT_EQ(scratch.getUsed(), 1280);
+            manager.setZero(*third);
+        }
+        EXPECT_EQ(scratch.getUsed(), 512);
+        // The memory of the nested frame is reused
+        auto second = scratch.allocate(1);
+        EXPECT_EQ(second->data(), static_cast<std::uint8_t*>(firstData) + 512);
+    }
+    EXPECT_EQ(scratch.getUsed(), 0);
+    EXPECT_EQ(scratch.getPeak(), 1280);
+
+    // The arena grows to the peak at the next frame and the same allocations get the same addresses at each step
+    std::vector<void*> addresses;
+    for (auto step = 0; step < 2; ++step)
+    {
+        ScratchArena::Frame const frame{scratch};
+        EXPECT_EQ(scratch.getCapacity(), 1280);
+        auto first = scratch.allocate(ITensor::makeShape({10, 10}), nvinfer1::DataType::kINT32);
+        auto second = scratch.allocate(256, nvinfer1::DataType::kHALF);
+        auto third = scratch.allocate(1);
+        manager.setZero(*third);
+        addresses.insert(addresses.end(), {first->data(), second->data(), third->data()});
+    }
+    EXPECT_EQ(scratch.getNbOverflows(), 1);
+    EXPECT_EQ(addresses[0], addresses[3]);
+    EXPECT_EQ(addresses[1], addresses[4]);
+    EXPECT_EQ(addresses[2], addresses[5]);
+    mStream->synchronize();
 }
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "tensorrt_llm/common/tllmException.h"
+#include "tensorrt_llm/runtime/detokenizer.h"
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+std::string decode(Detokenizer const& detokenizer, std::vector<TokenIdType> const& tokens)
+{
+    return detokenizer.decode(tokens.data(), tokens.size());
+}
+
+} // namespace
+
+TEST(DetokenizerTest, ByteLevel)
+{
+    // Ġ is the space, Ã and © the two bytes of é
+    auto const detokenizer = Detokenizer::parse(std::string{
+        R"({"added_tokens":[{"id":5,"content":"<|endoftext|>","special":true}],)"
+        R"("decoder":{"type":"ByteLevel"},)"
+        R"("model":{"type":"BPE","vocab":{"Hello":0,"Ġworld":1,"Ã":2,"©":3,"!":4}}})"});
+    EXPECT_EQ(detokenizer.getVocabSize(), 6);
+    EXPECT_EQ(decode(detokenizer, {0, 1, 4, 5}), "Hello world!");
+
+    // The first byte of é waits for the second one
+    Detokenizer::Stream stream;
+    std::vector<TokenIdType> const tokens{1, 2, 3};
+    EXPECT_EQ(detokenizer.decode(stream, tokens.data(), 2), " world");
+    EXPECT_EQ(detokenizer.decode(stream, tokens.data() + 2, 1), "\xC3\xA9");
+    EXPECT_EQ(detokenizer.finish(stream), "");
+
+    // A byte that is not completed is replaced at the end of the stream
+    EXPECT_EQ(detokenizer.decode(stream, tokens.data() + 1, 1), "");
+    EXPECT_EQ(detokenizer.finish(stream), "\xEF\xBF\xBD");
+    EXPECT_EQ(decode(detokenizer, {3, 0}), "\xEF\xBF\xBDHello");
+}
+
+TEST(DetokenizerTest, SentencePiece)
+{
+    auto const detokenizer = Detokenizer::parse(std::string{
+        R"({"added_tokens":[{"id":0,"content":"<unk>","special":true},{"id":1,"content":"<s>","special":true}],)"
+        R"("decoder":{"type":"Sequence","decoders":[)"
+        R"({"type":"Replace","pattern":{"String":"▁"},"content":" "},{"type":"ByteFallback"},{"type":"Fuse"},)"
+        R"({"type":"Strip","content":" ","start":1,"stop":0}]},)"
+        R"("model":{"type":"BPE","byte_fallback":true,)"
+        R"("vocab":{"<unk>":0,"<s>":1,"<0xE2>":2,"<0x82>":3,"<0xAC>":4,"▁Hello":5,"▁world":6}}})"});
+
+    // The leading space of the first word is stripped
+    EXPECT_EQ(decode(detokenizer, {1, 5, 6}), "Hello world");
+
+    // The bytes of € come one token at a time
+    Detokenizer::Stream stream;
+    std::vector<TokenIdType> const tokens{5, 2, 3, 4, 6};
+    std::string text;
+    for (auto const token : tokens)
+    {
+        auto const piece = detokenizer.decode(stream, &token, 1);
+        EXPECT_TRUE(token == 2 || token == 3 ? piece.empty() : !piece.empty());
+        text += piece;
+    }
+    EXPECT_EQ(text + detokenizer.finish(stream), "Hello\xE2\x82\xAC world");
+}
+
+TEST(DetokenizerTest, Unsupported)
+{
+    EXPECT_THROW(Detokenizer::parse(std::string{R"({"decoder":{"type":"WordPiece"},"model":{"vocab":{}}})"}),
+        tensorrt_llm::common::TllmException);
+}
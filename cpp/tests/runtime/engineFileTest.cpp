@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "tensorrt_llm/common/tllmException.h"
+#include "tensorrt_llm/runtime/engineFile.h"
+
+using namespace tensorrt_llm::runtime;
+
+TEST(EngineFileTest, LoadModes)
+{
+    auto const path = testing::TempDir() + "engine.bin";
+    // Not a multiple of the page size, to read the end of the file with O_DIRECT
+    std::vector<std::uint8_t> contents(3 * 4096 + 123);
+    for (std::size_t i = 0; i < contents.size(); ++i)
+    {
+        contents[i] = static_cast<std::uint8_t>(i * 7);
+    }
+    std::ofstream{path, std::ios::binary}.write(
+        reinterpret_cast<char const*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+
+    for (auto const mode :
+        {EngineFile::LoadMode::kMMAP, EngineFile::LoadMode::kDIRECT, EngineFile::LoadMode::kAUTO,
+            EngineFile::LoadMode::kREAD})
+    {
+        EngineFile engineFile(path, mode);
+        ASSERT_EQ(engineFile.size(), contents.size());
+        EXPECT_EQ(std::memcmp(engineFile.data(), contents.data(), contents.size()), 0);
+        EXPECT_NE(engineFile.getLoadMode(), EngineFile::LoadMode::kAUTO);
+    }
+
+    EXPECT_THROW(EngineFile(testing::TempDir() + "missing.bin", EngineFile::LoadMode::kMMAP),
+        tensorrt_llm::common::TllmException);
+}
+
+TEST(EngineFileTest, ParseLoadMode)
+{
+    EXPECT_EQ(EngineFile::parseLoadMode(""), EngineFile::LoadMode::kMMAP);
+    EXPECT_EQ(EngineFile::parseLoadMode("direct"), EngineFile::LoadMode::kDIRECT);
+    EXPECT_EQ(EngineFile::parseLoadMode("auto"), EngineFile::LoadMode::kAUTO);
+    EXPECT_EQ(EngineFile::parseLoadMode("read"), EngineFile::LoadMode::kREAD);
+    EXPECT_EQ(EngineFile::parseLoadMode("unknown"), EngineFile::LoadMode::kMMAP);
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "tensorrt_llm/common/tllmException.h"
+#include "tensorrt_llm/runtime/engineWeights.h"
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+void writeSafetensors(std::string const& path, std::string const& header, std::vector<std::uint8_t> const& data)
+{
+    std::ofstream file{path, std::ios::binary};
+    auto const headerSize = static_cast<std::uint64_t>(header.size());
+    file.write(reinterpret_cast<char const*>(&headerSize), sizeof(headerSize));
+    file << header;
+    file.write(reinterpret_cast<char const*>(data.data()), static_cast<std::streamsize>(data.size()));
+}
+
+} // namespace
+
+TEST(EngineWeightsTest, Read)
+{
+    auto const path = testing::TempDir() + "rank0.safetensors";
+    std::vector<float> const weight{1.F, 2.F, 3.F, 4.F, 5.F, 6.F};
+    std::vector<std::uint8_t> data(weight.size() * sizeof(float) + 4);
+    std::memcpy(data.data(), weight.data(), weight.size() * sizeof(float));
+    data[24] = 7;
+    writeSafetensors(path,
+        R"({"__metadata__":{"format":"pt"},)"
+        R"("transformer.layers.0.attention.dense.weight":{"dtype":"F32","shape":[2,3],"data_offsets":[0,24]},)"
+        R"("transformer.ln_f.weight":{"dtype":"I8","shape":[4],"data_offsets":[24,28]}})",
+        data);
+
+    // Copied to pinned memory, then read from the mapping of the file
+    for (auto const pinned : {true, false})
+    {
+        EngineWeights const weights{path, pinned};
+        EXPECT_EQ(weights.getSizeInBytes(), data.size());
+        auto const& all = weights.getWeights();
+        ASSERT_EQ(all.size(), 2);
+        auto const& dense = all[0].name == "transformer.ln_f.weight" ? all[1] : all[0];
+        auto const& lnf = all[0].name == "transformer.ln_f.weight" ? all[0] : all[1];
+        EXPECT_EQ(dense.name, "transformer.layers.0.attention.dense.weight");
+        EXPECT_EQ(dense.dataType, nvinfer1::DataType::kFLOAT);
+        EXPECT_EQ(dense.shape, (std::vector<std::int64_t>{2, 3}));
+        EXPECT_EQ(dense.count, 6);
+        EXPECT_EQ(std::memcmp(dense.values, weight.data(), weight.size() * sizeof(float)), 0);
+        EXPECT_EQ(lnf.dataType, nvinfer1::DataType::kINT8);
+        EXPECT_EQ(*static_cast<std::int8_t const*>(lnf.values), 7);
+    }
+}
+
+TEST(EngineWeightsTest, Invalid)
+{
+    auto const path = testing::TempDir() + "invalid.safetensors";
+    // The offsets do not match the shape
+    writeSafetensors(path, R"({"w":{"dtype":"F16","shape":[4],"data_offsets":[0,4]}})", std::vector<std::uint8_t>(8));
+    EXPECT_THROW(EngineWeights{path}, tensorrt_llm::common::TllmException);
+    // Past the end of the file
+    writeSafetensors(path, R"({"w":{"dtype":"F16","shape":[4],"data_offsets":[8,16]}})", std::vector<std::uint8_t>(8));
+    EXPECT_THROW(EngineWeights{path}, tensorrt_llm::common::TllmException);
+    writeSafetensors(path, R"({"w":{"dtype":"I64","shape":[1],"data_offsets":[0,8]}})", std::vector<std::uint8_t>(8));
+    EXPECT_THROW(EngineWeights{path}, tensorrt_llm::common::TllmException);
+}
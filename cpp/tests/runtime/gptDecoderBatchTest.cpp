@@ -24,6 +24,7 @@
 #include "tensorrt_llm/runtime/bufferManager.h"
 #include "tensorrt_llm/runtime/gptDecoderBatch.h"
 #include "tensorrt_llm/runtime/gptModelConfig.h"
+#include "tensorrt_llm/runtime/jointGptDecoderBatch.h"
 #include "tensorrt_llm/runtime/runtimeKernels.h"
 #include "tensorrt_llm/runtime/worldConfig.h"
 
@@ -179,7 +180,7 @@ void verifyResults(BufferManager& manager, GptDecoderBatch const& decoder,
 }
 
 void testDecoder(nvinfer1::DataType const dtype, std::vector<SamplingConfig> const& samplingConfigs,
-    SizeType maxBeamWidth, bool computeLogProbs, bool normalizeLogProbs)
+    SizeType maxBeamWidth, bool computeLogProbs, bool normalizeLogProbs, bool batchedDecoding = false)
 {
     TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
     SizeType constexpr tensorParallelism{1};
@@ -242,7 +243,10 @@ void testDecoder(nvinfer1::DataType const dtype, std::vector<SamplingConfig> con
     auto const maxAttentionWindow = maxSeqLength;
 
     // set up decoder
-    auto decoder = GptDecoderBatch(vocabSize, vocabSizePadded, streamPtr);
+    auto const decoderPtr = batchedDecoding
+        ? std::make_unique<JointGptDecoderBatch>(vocabSize, vocabSizePadded, streamPtr)
+        : std::make_unique<GptDecoderBatch>(vocabSize, vocabSizePadded, streamPtr);
+    auto& decoder = *decoderPtr;
     decoder.setup(batchSize, maxBeamWidth, maxSeqLength, maxAttentionWindow, maxGeneratedTokensPerStep, dataType);
 
     for (auto batchIdx = 0; batchIdx < batchSize; ++batchIdx)
@@ -289,7 +293,7 @@ void testDecoder(nvinfer1::DataType const dtype, std::vector<SamplingConfig> con
 }
 
 void testDecoderWavefront(nvinfer1::DataType const dtype, std::vector<SamplingConfig> const& samplingConfigs,
-    SizeType maxBeamWidth, bool computeLogProbs)
+    SizeType maxBeamWidth, bool computeLogProbs, bool batchedDecoding = false)
 {
     TLLM_LOG_DEBUG("%s start", __PRETTY_FUNCTION__);
     SizeType constexpr tensorParallelism{1};
@@ -352,7 +356,10 @@ void testDecoderWavefront(nvinfer1::DataType const dtype, std::vector<SamplingCo
     auto const maxAttentionWindow = maxSeqLength;
 
     // set up decoder
-    auto decoder = GptDecoderBatch(vocabSize, vocabSizePadded, streamPtr);
+    auto const decoderPtr = batchedDecoding
+        ? std::make_unique<JointGptDecoderBatch>(vocabSize, vocabSizePadded, streamPtr)
+        : std::make_unique<GptDecoderBatch>(vocabSize, vocabSizePadded, streamPtr);
+    auto& decoder = *decoderPtr;
     decoder.setup(batchSize, maxBeamWidth, maxSeqLength, maxAttentionWindow, maxGeneratedTokensPerStep, dataType);
 
     std::vector<SizeType> expectedSteps(batchSize, 0);
@@ -573,6 +580,33 @@ INSTANTIATE_TEST_SUITE_P(GptDecoderBwTest, ParamWavefrontTest,
         testing::Values(false, true)),
     generateTestName);
 
+class BatchedDecodingTest : public ::testing::TestWithParam<nvinfer1::DataType>
+{
+};
+
+TEST_P(BatchedDecodingTest, HeterogeneousSamplingConfigs)
+{
+    nvinfer1::DataType const dtype{GetParam()};
+    // greedy requests with different sampling parameters, the last one needs its own decoder
+    std::vector<SamplingConfig> samplingConfigs(5);
+    samplingConfigs[1].topK = {1};
+    samplingConfigs[1].temperature = {0.5f};
+    samplingConfigs[2].topP = {0.0f};
+    samplingConfigs[2].randomSeed = {42};
+    samplingConfigs[3].topK = {1};
+    samplingConfigs[3].minLength = {2};
+    samplingConfigs[3].repetitionPenalty = {1.2f};
+    samplingConfigs[4].topPDecay = {0.5f};
+
+    testDecoder(dtype, samplingConfigs, 1, false, false, true);
+    testDecoderWavefront(dtype, samplingConfigs, 1, false, true);
+}
+
+INSTANTIATE_TEST_SUITE_P(GptDecoderBatchedTest, BatchedDecodingTest,
+    testing::Values(nvinfer1::DataType::kFLOAT, nvinfer1::DataType::kHALF),
+    [](const testing::TestParamInfo<nvinfer1::DataType>& info)
+    { return std::string{info.param == nvinfer1::DataType::kFLOAT ? "Float" : "Half"}; });
+
 struct DraftConfig
 {
     SizeType maxGeneratedTokensPerStep;
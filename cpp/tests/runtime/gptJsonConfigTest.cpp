@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "tensorrt_llm/runtime/gptJsonConfig.h"
+
+using namespace tensorrt_llm::runtime;
+
+namespace
+{
+
+std::string makeConfig(int maxBatchSize)
+{
+    return R"({"version":"0.8.0",)"
+           R"("pretrained_config":{"architecture":"LlamaForCausalLM","dtype":"float16",)"
+           R"("mapping":{"tp_size":2,"pp_size":1},"num_attention_heads":32,"hidden_size":4096,)"
+           R"("vocab_size":32000,"num_hidden_layers":32,"num_key_value_heads":8,"quantization":{}},)"
+           R"("build_config":{"max_batch_size":)"
+        + std::to_string(maxBatchSize)
+        + R"(,"max_input_len":1024,"max_output_len":512,)"
+          R"("plugin_config":{"paged_kv_cache":true,"tokens_per_block":64,"gpt_attention_plugin":"float16",)"
+          R"("remove_input_padding":true,"use_custom_all_reduce":false,"use_context_fmha_for_generation":false}}})";
+}
+
+void writeConfig(std::filesystem::path const& path, std::string const& json)
+{
+    std::ofstream file{path};
+    file << json;
+}
+
+} // namespace
+
+TEST(GptJsonConfigTest, ParseFile)
+{
+    auto const path = std::filesystem::path{testing::TempDir()} / "config.json";
+    writeConfig(path, makeConfig(8));
+
+    auto const json = GptJsonConfig::parse(path);
+    EXPECT_EQ(json.getName(), "LlamaForCausalLM");
+    EXPECT_EQ(json.getTensorParallelism(), 2);
+    auto const modelConfig = json.getModelConfig();
+    EXPECT_EQ(modelConfig.getMaxBatchSize(), 8);
+    EXPECT_EQ(modelConfig.getNbHeads(), 16);
+    EXPECT_EQ(modelConfig.getNbKvHeads(), 4);
+    // Missing fields take their defaults
+    EXPECT_EQ(modelConfig.getMaxBeamWidth(), 0);
+    EXPECT_FALSE(modelConfig.getMaxNumTokens().has_value());
+
+    // Parsed again, from the cache
+    EXPECT_EQ(GptJsonConfig::parse(path).getModelConfig().getMaxBatchSize(), 8);
+
+    // A file that changed is parsed again
+    writeConfig(path, makeConfig(16));
+    EXPECT_EQ(GptJsonConfig::parse(path).getModelConfig().getMaxBatchSize(), 16);
+    EXPECT_EQ(GptJsonConfig::parse(makeConfig(4)).getModelConfig().getMaxBatchSize(), 4);
+}
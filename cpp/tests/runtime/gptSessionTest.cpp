@@ -426,7 +426,15 @@ void testGptSession(fs::path const& modelPath, ModelSpec const& modelSpec, Model
                 };
             }
 
-            session.generate(generationOutput, generationInput, samplingConfig);
+            // alternate with asynchronous calls, which must give the same outputs
+            if (r % 2 == 0)
+            {
+                session.generate(generationOutput, generationInput, samplingConfig);
+            }
+            else
+            {
+                session.generateAsync(generationOutput, generationInput, samplingConfig).get();
+            }
 
             // compare outputs
             if (!isChatGlmTest && worldConfig.isFirstPipelineParallelRank())
@@ -832,3 +840,16 @@ TEST_F(ChatGlm3SessionTest, SamplingFP16WithGptAttentionPluginBS1BM1)
     testGptSession(
         modelPath, modelSpec, modeIds, 1, batchSizes, "", mLogger, false, MicroBatchSizes(), true, modelName);
 }
+
+TEST(GptSessionTest, LookupDraftTokens)
+{
+    using VecTokens = std::vector<TokenIdType>;
+    // the longest suffix occurring earlier is matched
+    EXPECT_EQ(GptSession::lookupDraftTokens({1, 2, 3, 4, 1, 2, 3}, 2, 3), (VecTokens{4, 1}));
+    // shorter n-grams are tried when the longer ones do not occur
+    EXPECT_EQ(GptSession::lookupDraftTokens({1, 2, 3, 9, 3}, 4, 3), (VecTokens{9, 3}));
+    // the most recent occurrence wins
+    EXPECT_EQ(GptSession::lookupDraftTokens({1, 2, 1, 3, 1}, 4, 1), (VecTokens{3, 1}));
+    EXPECT_TRUE(GptSession::lookupDraftTokens({1, 2, 3}, 4, 3).empty());
+    EXPECT_TRUE(GptSession::lookupDraftTokens({1, 2, 1}, 0, 3).empty());
+}
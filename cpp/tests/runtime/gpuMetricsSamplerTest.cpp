@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "tensorrt_llm/runtime/gpuMetricsSampler.h"
+
+using namespace tensorrt_llm::runtime;
+
+TEST(GpuMetricsSamplerTest, Sampling)
+{
+    GpuMetricsSampler sampler(2, 0);
+    std::vector<bool> sampled;
+    for (int i = 0; i < 3; ++i)
+    {
+        sampled.push_back(sampler.sample(GpuPhase::kGENERATION));
+    }
+    // The steps of each phase are counted separately
+    sampled.push_back(sampler.sample(GpuPhase::kCONTEXT));
+    sampled.push_back(sampler.sample(GpuPhase::kGENERATION));
+    EXPECT_EQ(sampled, (std::vector<bool>{true, false, true, true, false}));
+
+    sampler.add(GpuPhase::kGENERATION, 1., {80., 40., 20., 10.});
+    sampler.add(GpuPhase::kGENERATION, 3., {40., 80., 60., 30.});
+    sampler.add(GpuPhase::kCONTEXT, 2., {10., 90., 50., 70.});
+
+    auto const stats = sampler.collect();
+    EXPECT_EQ(stats.getNumSamples(), 3);
+    auto const& generation = stats[GpuPhase::kGENERATION];
+    EXPECT_EQ(generation.numSamples, 2);
+    EXPECT_DOUBLE_EQ(generation.timeMs, 4.);
+    // Weighted by the duration of the steps
+    EXPECT_DOUBLE_EQ(generation.getAverage(GpuMetric::kDRAM_BW_UTIL), 50.);
+    EXPECT_DOUBLE_EQ(generation.getAverage(GpuMetric::kSM_UTIL), 70.);
+    EXPECT_DOUBLE_EQ(generation.getAverage(GpuMetric::kSM_OCCUPANCY), 50.);
+    EXPECT_DOUBLE_EQ(generation.getAverage(GpuMetric::kTENSOR_UTIL), 25.);
+    EXPECT_DOUBLE_EQ(stats[GpuPhase::kCONTEXT].getAverage(GpuMetric::kTENSOR_UTIL), 70.);
+
+    auto const cleared = sampler.collect();
+    EXPECT_EQ(cleared.getNumSamples(), 0);
+    EXPECT_DOUBLE_EQ(cleared[GpuPhase::kGENERATION].getAverage(GpuMetric::kSM_UTIL), 0.);
+}
+
+TEST(GpuMetricsSamplerTest, AddStats)
+{
+    GpuMetricsStats first;
+    first[GpuPhase::kCONTEXT].add(1., {10., 20., 30., 40.});
+    GpuMetricsStats second;
+    second[GpuPhase::kCONTEXT].add(1., {30., 40., 50., 60.});
+    second[GpuPhase::kGENERATION].add(2., {5., 5., 5., 5.});
+
+    first.add(second);
+    EXPECT_EQ(first[GpuPhase::kCONTEXT].numSamples, 2);
+    EXPECT_DOUBLE_EQ(first[GpuPhase::kCONTEXT].getAverage(GpuMetric::kDRAM_BW_UTIL), 20.);
+    EXPECT_DOUBLE_EQ(first[GpuPhase::kGENERATION].getAverage(GpuMetric::kSM_OCCUPANCY), 5.);
+    EXPECT_EQ(first.getNumSamples(), 3);
+}
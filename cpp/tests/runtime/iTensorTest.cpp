@@ -19,6 +19,7 @@
 
 #include "tensorrt_llm/runtime/bufferManager.h"
 #include "tensorrt_llm/runtime/iTensor.h"
+#include "tensorrt_llm/runtime/tensorSpan.h"
 
 using namespace tensorrt_llm::runtime;
 namespace tc = tensorrt_llm::common;
@@ -218,3 +219,44 @@ TEST(ITensorTest, TensorSlice)
     auto uniqueSlice = ITensor::slice(std::move(constSlice), 1);
     EXPECT_EQ(uniqueSlice->getShape().d[0], dims.d[0] - offset - 1);
 }
+
+TEST(ITensorTest, TensorSpan)
+{
+    auto const dims = ITensor::makeShape({16, 8, 4});
+    auto constexpr dataType = nvinfer1::DataType::kFLOAT;
+    ITensor::SharedPtr tensor{BufferManager::cpu(dims, dataType)};
+    auto const useCount = tensor.use_count();
+
+    std::size_t const offset = 4;
+    TensorSpan span(*tensor, offset, 2);
+    EXPECT_EQ(tensor.use_count(), useCount);
+    EXPECT_EQ(span.getShape().d[0], 2);
+    EXPECT_EQ(span.getShape().d[1], dims.d[1]);
+    EXPECT_EQ(span.getSize(), 2 * 8 * 4);
+    EXPECT_EQ(span.getCapacity(), tensor->getSize() - offset * 8 * 4);
+    EXPECT_EQ(span.data(), tensor->data(offset * 8 * 4));
+    EXPECT_EQ(span.getDataType(), dataType);
+    EXPECT_EQ(span.getMemoryType(), tensor->getMemoryType());
+
+    // Same address and shape as the owning slice
+    auto slice = ITensor::slice(tensor, offset, 2);
+    EXPECT_EQ(span.data(), slice->data());
+    EXPECT_EQ(ITensor::toString(span.getShape()), ITensor::toString(slice->getShape()));
+
+    TensorSpan tail(*tensor, 12);
+    EXPECT_EQ(tail.getShape().d[0], 4);
+    EXPECT_THROW(TensorSpan(*tensor, 17), std::out_of_range);
+    EXPECT_THROW(TensorSpan(*tensor, 15, 2), std::out_of_range);
+
+    TensorSpan view(span, ITensor::makeShape({16, 4}));
+    EXPECT_EQ(view.data(), span.data());
+    EXPECT_EQ(view.getSize(), 64);
+    EXPECT_THROW(view.reshape(ITensor::makeShape({static_cast<SizeType>(span.getCapacity()) + 1})), std::runtime_error);
+    view.unsqueeze(0);
+    EXPECT_EQ(view.getShape().nbDims, 3);
+    EXPECT_EQ(view.getSize(), 64);
+
+    EXPECT_NO_THROW(span.release());
+    EXPECT_EQ(span.data(), nullptr);
+    EXPECT_NE(tensor->data(), nullptr);
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "tensorrt_llm/runtime/layerProfiler.h"
+
+using namespace tensorrt_llm::runtime;
+
+TEST(LayerProfilerTest, LayerKind)
+{
+    EXPECT_EQ(LayerProfiler::getLayerKind("transformer/layers/0/attention/PLUGIN_V2_GPTAttention_0"),
+        LayerKind::kATTENTION);
+    EXPECT_EQ(LayerProfiler::getLayerKind("transformer/layers/0/attention/qkv/PLUGIN_V2_Gemm_0"), LayerKind::kGEMM);
+    EXPECT_EQ(LayerProfiler::getLayerKind("transformer/layers/0/mlp/fc/MATRIX_MULTIPLY_0"), LayerKind::kGEMM);
+    EXPECT_EQ(LayerProfiler::getLayerKind("transformer/layers/0/attention/dense/PLUGIN_V2_AllReduce_0"),
+        LayerKind::kCOLLECTIVE);
+    EXPECT_EQ(LayerProfiler::getLayerKind("transformer/layers/0/PLUGIN_V2_Recv_0"), LayerKind::kCOLLECTIVE);
+    EXPECT_EQ(LayerProfiler::getLayerKind("transformer/layers/0/input_layernorm/PLUGIN_V2_Rmsnorm_0"),
+        LayerKind::kOTHER);
+    // Classified by the first of the fused layers
+    EXPECT_EQ(LayerProfiler::getLayerKind("layers/0/mlp/fc/PLUGIN_V2_Gemm_0 + layers/0/mlp/ELEMENTWISE_PROD_0"),
+        LayerKind::kGEMM);
+}
+
+TEST(LayerProfilerTest, Sampling)
+{
+    LayerProfiler profiler(3);
+    std::vector<bool> profiled;
+    for (int i = 0; i < 7; ++i)
+    {
+        profiled.push_back(profiler.sample());
+    }
+    EXPECT_EQ(profiled, (std::vector<bool>{true, false, false, true, false, false, true}));
+
+    profiler.reportLayerTime("layers/0/attention/PLUGIN_V2_GPTAttention_0", 0.5F);
+    profiler.reportLayerTime("layers/1/attention/PLUGIN_V2_GPTAttention_1", 0.25F);
+    profiler.reportLayerTime("layers/0/mlp/fc/PLUGIN_V2_Gemm_0", 1.F);
+
+    auto const stats = profiler.collect();
+    EXPECT_EQ(stats.numProfiledEnqueues, 3);
+    EXPECT_EQ(stats[LayerKind::kATTENTION].count, 2);
+    EXPECT_FLOAT_EQ(stats[LayerKind::kATTENTION].timeMs, 0.75F);
+    EXPECT_EQ(stats[LayerKind::kGEMM].count, 1);
+    EXPECT_FLOAT_EQ(stats.getTotalTimeMs(), 1.75F);
+
+    auto const cleared = profiler.collect();
+    EXPECT_EQ(cleared.numProfiledEnqueues, 0);
+    EXPECT_FLOAT_EQ(cleared.getTotalTimeMs(), 0.F);
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/loraCache.h"
+
+#include <memory>
+#include <numeric>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+namespace tc = tensorrt_llm::common;
+
+class LoraCacheTest : public ::testing::Test // NOLINT(cppcoreguidelines-pro-type-member-init)
+{
+protected:
+    void SetUp() override
+    {
+        mDeviceCount = tc::getDeviceCount();
+        if (mDeviceCount == 0)
+            GTEST_SKIP();
+
+        mStream = std::make_shared<CudaStream>();
+        mCopyStream = std::make_shared<CudaStream>();
+    }
+
+    void TearDown() override {}
+
+    // One pinned tensor per weight matrix, filled with first, first + 1, ...
+    static std::vector<LoraCache::TensorPtr> makeWeights(std::vector<SizeType> const& sizes, float first)
+    {
+        std::vector<LoraCache::TensorPtr> weights;
+        for (auto const size : sizes)
+        {
+            LoraCache::TensorPtr weight = BufferManager::pinned(ITensor::makeShape({size}), nvinfer1::DataType::kFLOAT);
+            auto* data = bufferCast<float>(*weight);
+            std::iota(data, data + size, first);
+            first += static_cast<float>(size);
+            weights.push_back(std::move(weight));
+        }
+        return weights;
+    }
+
+    // Loads the adapter and waits for the copies
+    void load(LoraCache& cache, LoraCache::TaskIdType taskId)
+    {
+        EXPECT_FALSE(cache.tryLoad(taskId));
+        mCopyStream->synchronize();
+        EXPECT_TRUE(cache.tryLoad(taskId));
+    }
+
+    int mDeviceCount;
+    BufferManager::CudaStreamPtr mStream;
+    BufferManager::CudaStreamPtr mCopyStream;
+};
+
+TEST_F(LoraCacheTest, LoadAndEvict)
+{
+    auto constexpr pageSize = 16;
+    LoraCache cache{3, pageSize, nvinfer1::DataType::kFLOAT, mCopyStream};
+    cache.put(1, makeWeights({16, 8}, 0.F));
+    cache.put(2, makeWeights({4}, 100.F));
+    cache.put(3, makeWeights({2, 2}, 200.F));
+    EXPECT_TRUE(cache.contains(2));
+    EXPECT_FALSE(cache.contains(4));
+
+    load(cache, 1);
+    auto const pointers = cache.getWeightPointers(1);
+    ASSERT_EQ(pointers.size(), 2);
+    std::vector<float> second(8);
+    TLLM_CUDA_CHECK(cudaMemcpy(second.data(), pointers[1], second.size() * sizeof(float), cudaMemcpyDeviceToHost));
+    EXPECT_EQ(second.front(), 16.F);
+    EXPECT_EQ(second.back(), 23.F);
+
+    cache.acquire(1);
+    load(cache, 2);
+    EXPECT_EQ(cache.getNumFreePages(), 0);
+
+    // Only the page of adapter 2 can be freed, adapter 3 needs two
+    EXPECT_FALSE(cache.tryLoad(3));
+    EXPECT_TRUE(cache.tryLoad(2));
+    EXPECT_EQ(cache.getNumEvictions(), 0);
+
+    // Adapter 1 is the least recently used once released
+    cache.release(1, *mStream);
+    load(cache, 3);
+    EXPECT_EQ(cache.getNumEvictions(), 1);
+    EXPECT_EQ(cache.getNumLoads(), 3);
+    EXPECT_TRUE(cache.tryLoad(2));
+    EXPECT_THROW(static_cast<void>(cache.getWeightPointers(1)), tc::TllmException);
+
+    cache.erase(3);
+    EXPECT_FALSE(cache.contains(3));
+    EXPECT_EQ(cache.getNumFreePages(), 2);
+}
+
+TEST_F(LoraCacheTest, RejectsOversizedWeights)
+{
+    LoraCache cache{2, 4, nvinfer1::DataType::kFLOAT, mCopyStream};
+    EXPECT_THROW(cache.put(1, makeWeights({8}, 0.F)), tc::TllmException);
+    EXPECT_THROW(cache.put(1, makeWeights({4, 4, 4}, 0.F)), tc::TllmException);
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2022-2023, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "tensorrt_llm/common/cudaUtils.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
+#include "tensorrt_llm/runtime/promptTuningTableCache.h"
+
+#include <memory>
+#include <vector>
+
+using namespace tensorrt_llm::runtime;
+namespace tc = tensorrt_llm::common;
+
+class PromptTuningTableCacheTest : public ::testing::Test // NOLINT(cppcoreguidelines-pro-type-member-init)
+{
+protected:
+    void SetUp() override
+    {
+        mDeviceCount = tc::getDeviceCount();
+        if (mDeviceCount == 0)
+            GTEST_SKIP();
+
+        mStream = std::make_shared<CudaStream>();
+        mManager = std::make_unique<BufferManager>(mStream);
+    }
+
+    void TearDown() override {}
+
+    // Table of a task filled with the task id
+    PromptTuningTableCache::TableGetter makeGetter(std::vector<SizeType>& requested) const
+    {
+        return [this, &requested](SizeType taskId)
+        {
+            requested.push_back(taskId);
+            std::vector<float> values(kTaskVocabSize * kHiddenSize, static_cast<float>(taskId));
+            return mManager->copyFrom(values, ITensor::makeShape({kTaskVocabSize, kHiddenSize}), MemoryType::kCPU);
+        };
+    }
+
+    // Task ids of a batch with prompt tuning for all the requests
+    PromptTuningParams::TensorPtr makeTasks(std::vector<SizeType> const& taskIds, PromptTuningParams& params) const
+    {
+        params.promptTuningEnabled.assign(taskIds.size(), true);
+        return mManager->copyFrom(
+            taskIds, ITensor::makeShape({static_cast<SizeType>(taskIds.size())}), MemoryType::kCPU);
+    }
+
+    static auto constexpr kTaskVocabSize = 4;
+    static auto constexpr kHiddenSize = 8;
+
+    int mDeviceCount;
+    BufferManager::CudaStreamPtr mStream;
+    std::unique_ptr<BufferManager> mManager;
+};
+
+TEST_F(PromptTuningTableCacheTest, CopiesOnlyMissingTables)
+{
+    PromptTuningTableCache cache{2, kTaskVocabSize, kHiddenSize, nvinfer1::DataType::kFLOAT, mStream};
+    std::vector<SizeType> requested;
+    auto const getTable = makeGetter(requested);
+
+    PromptTuningParams params;
+    std::vector<SizeType> const firstIds{7, 3, 7};
+    auto tasks = makeTasks(firstIds, params);
+    cache.mapTasks(params, *tasks, getTable);
+    EXPECT_EQ(requested, (std::vector<SizeType>{7, 3}));
+    EXPECT_EQ(params.embeddingTable, cache.getEmbeddingTable());
+    auto const* slots = bufferCast<SizeType>(*tasks);
+    EXPECT_EQ(slots[0], slots[2]);
+    EXPECT_NE(slots[0], slots[1]);
+
+    // The rows of a slot hold the table of its task
+    auto const table = mManager->copyFrom(*cache.getEmbeddingTable(), MemoryType::kCPU);
+    mStream->synchronize();
+    auto const* values = bufferCast<float>(*table);
+    EXPECT_EQ(values[slots[0] * kTaskVocabSize * kHiddenSize], 7.F);
+    EXPECT_EQ(values[(slots[1] + 1) * kTaskVocabSize * kHiddenSize - 1], 3.F);
+
+    // Task 3 is cached, task 5 evicts task 7, the least recently used
+    std::vector<SizeType> const secondIds{3, 5};
+    tasks = makeTasks(secondIds, params);
+    cache.mapTasks(params, *tasks, getTable);
+    EXPECT_EQ(requested, (std::vector<SizeType>{7, 3, 5}));
+    EXPECT_TRUE(cache.contains(3));
+    EXPECT_FALSE(cache.contains(7));
+    EXPECT_EQ(cache.getNumLoads(), 3);
+    EXPECT_EQ(cache.getNumHits(), 2);
+}
+
+TEST_F(PromptTuningTableCacheTest, SkipsRequestsWithoutPromptTuning)
+{
+    PromptTuningTableCache cache{1, kTaskVocabSize, kHiddenSize, nvinfer1::DataType::kFLOAT, mStream};
+    std::vector<SizeType> requested;
+    auto const getTable = makeGetter(requested);
+
+    PromptTuningParams params;
+    std::vector<SizeType> const ids{2, 9};
+    auto tasks = makeTasks(ids, params);
+    params.promptTuningEnabled[1] = false;
+    cache.mapTasks(params, *tasks, getTable);
+    EXPECT_EQ(requested, (std::vector<SizeType>{2}));
+    EXPECT_EQ(bufferCast<SizeType>(*tasks)[0], 0);
+    EXPECT_EQ(bufferCast<SizeType>(*tasks)[1], 9);
+
+    // Two tasks do not fit in one slot
+    tasks = makeTasks(ids, params);
+    EXPECT_THROW(cache.mapTasks(params, *tasks, getTable), tc::TllmException);
+}
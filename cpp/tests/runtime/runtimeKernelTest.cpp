@@ -899,3 +899,58 @@ TEST_F(RuntimeKernelTest, CopyBatchStride5)
 {
     testCopyBatch(5, *mManager, *mStream);
 }
+
+namespace
+{
+void testCopyBlocks(SizeType blockStride, BufferManager& manager, CudaStream& stream)
+{
+    SizeType constexpr numBlocks{8};
+    SizeType constexpr numCopies{3};
+
+    auto const poolShape = ITensor::makeShape({numBlocks, blockStride});
+    auto const idsShape = ITensor::makeShape({numCopies});
+    auto poolHost = manager.cpu(poolShape, nvinfer1::DataType::kHALF);
+    auto srcBlockIds = manager.pinned(idsShape, nvinfer1::DataType::kINT32);
+    auto dstBlockIds = manager.pinned(idsShape, nvinfer1::DataType::kINT32);
+
+    auto poolHostPtr = bufferCast<half>(*poolHost);
+    for (SizeType idx = 0; idx < numBlocks * blockStride; ++idx)
+    {
+        poolHostPtr[idx] = half(static_cast<float>(idx % 1024));
+    }
+
+    // Fork block 1 into blocks 5, 6 and block 2 into block 7
+    std::vector<std::int32_t> const srcIds{1, 1, 2};
+    std::vector<std::int32_t> const dstIds{5, 6, 7};
+    std::copy(srcIds.begin(), srcIds.end(), bufferCast<std::int32_t>(*srcBlockIds));
+    std::copy(dstIds.begin(), dstIds.end(), bufferCast<std::int32_t>(*dstBlockIds));
+
+    auto poolDevice = manager.copyFrom(*poolHost, MemoryType::kGPU);
+    kernels::invokeCopyBlocks(*poolDevice, *srcBlockIds, *dstBlockIds, blockStride, stream);
+    auto outHost = manager.copyFrom(*poolDevice, MemoryType::kCPU);
+    stream.synchronize();
+
+    auto outHostPtr = bufferCast<half>(*outHost);
+    for (SizeType block = 0; block < numBlocks; ++block)
+    {
+        auto const it = std::find(dstIds.begin(), dstIds.end(), block);
+        auto const refBlock = it == dstIds.end() ? block : srcIds[std::distance(dstIds.begin(), it)];
+        for (SizeType ci = 0; ci < blockStride; ++ci)
+        {
+            EXPECT_EQ(static_cast<float>(poolHostPtr[refBlock * blockStride + ci]),
+                static_cast<float>(outHostPtr[block * blockStride + ci]))
+                << "Error at block: " << block << " column: " << ci << " for stride " << blockStride;
+        }
+    }
+}
+} // namespace
+
+TEST_F(RuntimeKernelTest, CopyBlocksStride512)
+{
+    testCopyBlocks(512, *mManager, *mStream);
+}
+
+TEST_F(RuntimeKernelTest, CopyBlocksStride3)
+{
+    testCopyBlocks(3, *mManager, *mStream);
+}
@@ -19,11 +19,16 @@
 
 #include "tensorrt_llm/common/cudaUtils.h"
 #include "tensorrt_llm/common/stringUtils.h"
+#include "tensorrt_llm/runtime/bufferManager.h"
 #include "tensorrt_llm/runtime/memoryCounters.h"
+#include "tensorrt_llm/runtime/pinnedPool.h"
 #include "tensorrt_llm/runtime/tllmBuffers.h"
+#include "tensorrt_llm/runtime/virtualMemory.h"
 
+#include <atomic>
 #include <limits>
 #include <memory>
+#include <optional>
 #include <sstream>
 #include <type_traits>
 
@@ -89,6 +94,152 @@ TEST_F(TllmBuffersTest, PinnedAllocator)
     EXPECT_EQ(counters.getPinnedDiff(), -size);
     EXPECT_EQ(allocator.getMemoryType(), MemoryType::kPINNED);
     EXPECT_THROW(allocator.deallocate(ptr, size), std::runtime_error);
+    // The block is kept by the pinned pool and reused
+    auto const hits = MemoryCounters::getPinnedPoolHits();
+    auto reused = allocator.allocate(size);
+    EXPECT_EQ(reused, ptr);
+    EXPECT_EQ(MemoryCounters::getPinnedPoolHits(), hits + 1);
+    EXPECT_NO_THROW(allocator.deallocate(reused, size));
+}
+
+TEST_F(TllmBuffersTest, MemoryTags)
+{
+    auto constexpr size = 1024;
+    auto const kvCache = MemoryCounters::getTagged(MemoryType::kCPU, MemoryTag::kKV_CACHE);
+    auto const decoder = MemoryCounters::getTagged(MemoryType::kCPU, MemoryTag::kDECODER);
+    EXPECT_EQ(MemoryCounters::getCurrentTag(), MemoryTag::kUNTAGGED);
+
+    std::optional<HostAllocator> kvCacheAllocator;
+    std::optional<HostAllocator> decoderAllocator;
+    {
+        MemoryCounters::TagScope const kvCacheScope{MemoryTag::kKV_CACHE};
+        kvCacheAllocator.emplace();
+        {
+            MemoryCounters::TagScope const decoderScope{MemoryTag::kDECODER};
+            decoderAllocator.emplace();
+        }
+        EXPECT_EQ(MemoryCounters::getCurrentTag(), MemoryTag::kKV_CACHE);
+    }
+    EXPECT_EQ(MemoryCounters::getCurrentTag(), MemoryTag::kUNTAGGED);
+    EXPECT_EQ(kvCacheAllocator->getMemoryTag(), MemoryTag::kKV_CACHE);
+    EXPECT_EQ(decoderAllocator->getMemoryTag(), MemoryTag::kDECODER);
+
+    // The memory is counted with the tag of the allocator, whatever the current tag
+    auto ptr = kvCacheAllocator->allocate(size);
+    EXPECT_EQ(MemoryCounters::getTagged(MemoryType::kCPU, MemoryTag::kKV_CACHE), kvCache + size);
+    EXPECT_EQ(MemoryCounters::getTagged(MemoryType::kCPU, MemoryTag::kDECODER), decoder);
+    EXPECT_NE(MemoryCounters::toTaggedString(MemoryType::kCPU).find("KV cache 1.00 KB"), std::string::npos);
+    {
+        MemoryCounters::TagScope const decoderScope{MemoryTag::kDECODER};
+        kvCacheAllocator->deallocate(ptr, size);
+    }
+    EXPECT_EQ(MemoryCounters::getTagged(MemoryType::kCPU, MemoryTag::kKV_CACHE), kvCache);
+    EXPECT_EQ(getMemoryTagName(MemoryTag::kSCRATCH), std::string{"Scratch"});
+    EXPECT_EQ(getMemoryTagName(MemoryTag::kLORA_CACHE), std::string{"LoRA cache"});
+    EXPECT_EQ(getMemoryTagName(MemoryTag::kPROMPT_TABLE_CACHE), std::string{"Prompt table cache"});
+}
+
+TEST_F(TllmBuffersTest, MemoryPeaks)
+{
+    auto constexpr size = 1024;
+    std::optional<HostAllocator> allocator;
+    {
+        MemoryCounters::TagScope const scope{MemoryTag::kSCRATCH};
+        allocator.emplace();
+    }
+    MemoryCounters::resetPeaks();
+    auto const scratch = MemoryCounters::getTagged(MemoryType::kCPU, MemoryTag::kSCRATCH);
+    auto const peak = MemoryCounters::getPeak(MemoryType::kCPU);
+    EXPECT_EQ(MemoryCounters::getTaggedPeak(MemoryType::kCPU, MemoryTag::kSCRATCH), scratch);
+
+    // The peak stays after the memory is freed, until the next reset
+    auto first = allocator->allocate(size);
+    auto second = allocator->allocate(size);
+    allocator->deallocate(second, size);
+    allocator->deallocate(first, size);
+    EXPECT_EQ(MemoryCounters::getTaggedPeak(MemoryType::kCPU, MemoryTag::kSCRATCH), scratch + 2 * size);
+    EXPECT_EQ(MemoryCounters::getPeak(MemoryType::kCPU), peak + 2 * size);
+    EXPECT_EQ(MemoryCounters::getTagged(MemoryType::kCPU, MemoryTag::kSCRATCH), scratch);
+
+    MemoryCounters::resetPeaks();
+    EXPECT_EQ(MemoryCounters::getTaggedPeak(MemoryType::kCPU, MemoryTag::kSCRATCH), scratch);
+}
+
+TEST_F(TllmBuffersTest, PinnedPoolClasses)
+{
+    EXPECT_EQ(PinnedPool::getClass(1), 0);
+    EXPECT_EQ(PinnedPool::getClass(PinnedPool::kMinBlockSize), 0);
+    EXPECT_EQ(PinnedPool::getClass(PinnedPool::kMaxBlockSize + 1), PinnedPool::kNbClasses);
+    for (std::size_t sizeClass = 0; sizeClass < PinnedPool::kNbClasses; ++sizeClass)
+    {
+        auto const classSize = PinnedPool::getClassSize(sizeClass);
+        EXPECT_EQ(PinnedPool::getClass(classSize), sizeClass);
+        if (sizeClass > 0)
+        {
+            auto const previousSize = PinnedPool::getClassSize(sizeClass - 1);
+            EXPECT_EQ(PinnedPool::getClass(previousSize + 1), sizeClass);
+            // At most a quarter of a block is wasted
+            EXPECT_LE(classSize - previousSize, classSize / 4);
+        }
+    }
+    EXPECT_EQ(PinnedPool::getClassSize(PinnedPool::kNbClasses - 1), PinnedPool::kMaxBlockSize);
+}
+
+TEST_F(TllmBuffersTest, PinnedPoolStreamOrder)
+{
+    if (mDeviceCount == 0)
+        GTEST_SKIP();
+
+    // Not a small block, which the thread would cache
+    auto constexpr size = 2 * PinnedPool::kMaxSmallBlockSize;
+    auto& pool = PinnedPool::getInstance();
+    CudaStream stream{};
+    // Keeps the stream busy until released
+    std::atomic<bool> released{false};
+    TLLM_CUDA_CHECK(cudaLaunchHostFunc(
+        stream.get(),
+        [](void* flag)
+        {
+            while (!static_cast<std::atomic<bool>*>(flag)->load())
+            {
+            }
+        },
+        &released));
+    auto* ptr = pool.allocate(size);
+    pool.recordStream(static_cast<char*>(ptr) + 1, stream.get());
+    pool.deallocate(ptr, size);
+    // The block is not reused before the work of the stream ran
+    auto* other = pool.allocate(size);
+    EXPECT_NE(other, ptr);
+    released = true;
+    stream.synchronize();
+    pool.deallocate(other, size);
+
+    auto const hits = pool.getNumHits();
+    auto* first = pool.allocate(size);
+    auto* second = pool.allocate(size);
+    EXPECT_EQ(pool.getNumHits(), hits + 2);
+    EXPECT_THAT((std::vector<void*>{first, second}), ::testing::UnorderedElementsAre(ptr, other));
+    pool.deallocate(first, size);
+    pool.deallocate(second, size);
+}
+
+TEST_F(TllmBuffersTest, PinnedPoolTrim)
+{
+    if (mDeviceCount == 0)
+        GTEST_SKIP();
+
+    auto& pool = PinnedPool::getInstance();
+    pool.trim();
+    auto const reserved = pool.getReserved();
+    // A small block, carved from a new slab
+    auto constexpr size = 3000;
+    auto* ptr = pool.allocate(size);
+    EXPECT_GT(pool.getReserved(), reserved);
+    pool.deallocate(ptr, size);
+    EXPECT_THROW(pool.deallocate(ptr, size), std::runtime_error);
+    pool.trim();
+    EXPECT_EQ(pool.getReserved(), reserved);
 }
 
 TEST_F(TllmBuffersTest, HostAllocator)
@@ -213,6 +364,53 @@ TEST_F(TllmBuffersTest, DeviceTensor)
     static_assert(!std::is_copy_assignable<DeviceBuffer>::value);
 }
 
+TEST_F(TllmBuffersTest, VirtualMemoryTensor)
+{
+    if (mDeviceCount == 0)
+        GTEST_SKIP();
+
+    auto& counters = MemoryCounters::getInstance();
+    auto const gpuBefore = counters.getGpu();
+    {
+        std::size_t constexpr maxGranules = 4;
+        VirtualMemoryTensor probe{ITensor::makeShape({0}), 1, nvinfer1::DataType::kFLOAT};
+        auto const granularity = probe.getGranularity();
+        auto const granule = granularity / sizeof(float);
+        auto const granuleDim = static_cast<ITensor::DimType>(granule);
+
+        VirtualMemoryTensor tensor{
+            ITensor::makeShape({granuleDim}), maxGranules * granule, nvinfer1::DataType::kFLOAT};
+        auto* const address = tensor.data();
+        EXPECT_NE(address, nullptr);
+        EXPECT_EQ(tensor.getCapacity(), granule);
+        EXPECT_EQ(counters.getGpu() - gpuBefore, granularity);
+
+        // Grows in place
+        tensor.reshape(ITensor::makeShape({3, granuleDim}));
+        EXPECT_EQ(tensor.data(), address);
+        EXPECT_EQ(tensor.getCapacity(), 3 * granule);
+        EXPECT_EQ(counters.getGpu() - gpuBefore, 3 * granularity);
+        BufferManager manager{std::make_shared<CudaStream>()};
+        manager.setZero(tensor);
+        manager.getStream().synchronize();
+
+        // Shrinks when trimmed
+        tensor.reshape(ITensor::makeShape({granuleDim}));
+        EXPECT_EQ(tensor.getCapacity(), 3 * granule);
+        tensor.trim();
+        EXPECT_EQ(tensor.data(), address);
+        EXPECT_EQ(tensor.getCapacity(), granule);
+        EXPECT_EQ(counters.getGpu() - gpuBefore, granularity);
+
+        EXPECT_THROW(tensor.resize(maxGranules * granule + 1), std::runtime_error);
+        tensor.release();
+        EXPECT_EQ(tensor.getCapacity(), 0);
+        EXPECT_EQ(tensor.data(), nullptr);
+        EXPECT_EQ(counters.getGpu(), gpuBefore);
+    }
+    EXPECT_EQ(counters.getGpu(), gpuBefore);
+}
+
 TEST_F(TllmBuffersTest, BufferSlice)
 {
     auto constexpr size = 1024;
@@ -145,3 +145,74 @@ TEST_F(TllmRuntimeTest, SinglePass)
     auto max = std::max_element(output.begin(), output.end());
     EXPECT_NEAR(*max, 0.140218f, 1e-5f);
 }
+
+TEST_F(TllmRuntimeTest, Rebind)
+{
+    EXPECT_TRUE(mSerializedEngine);
+    TllmRuntime rt{*mSerializedEngine, mLogger};
+    auto& engine = rt.getEngine();
+    rt.addContext(0);
+
+    auto constexpr dataType = trt::DataType::kFLOAT;
+    auto const inputName = engine.getIOTensorName(0);
+    auto const outputName = engine.getIOTensorName(1);
+
+    auto& allocator = rt.getBufferManager();
+    TllmRuntime::TensorMap tensorMap{};
+    auto inputBuffer = std::shared_ptr<ITensor>{allocator.gpu(engine.getTensorShape(inputName), dataType)};
+    allocator.setZero(*inputBuffer);
+    tensorMap.insert(std::make_pair(inputName, inputBuffer));
+    rt.setInputTensors(0, tensorMap);
+    rt.setOutputTensors(0, tensorMap);
+    rt.executeContext(0);
+
+    // unchanged bindings are kept, a new output buffer is bound
+    auto outputBuffer = std::shared_ptr<ITensor>{allocator.gpu(engine.getTensorShape(outputName), dataType)};
+    allocator.setZero(*outputBuffer);
+    tensorMap.insert_or_assign(outputName, outputBuffer);
+    rt.setInputTensors(0, tensorMap);
+    rt.setOutputTensors(0, tensorMap);
+    EXPECT_EQ(tensorMap.at(outputName), outputBuffer);
+    rt.executeContext(0);
+
+    std::vector<float> output(outputBuffer->getSize());
+    allocator.copy(*outputBuffer, output.data());
+    rt.getStream().synchronize();
+    auto max = std::max_element(output.begin(), output.end());
+    EXPECT_NEAR(*max, 0.140218f, 1e-5f);
+}
+
+TEST_F(TllmRuntimeTest, SelectProfile)
+{
+    TllmRuntime rt{*mSerializedEngine, mLogger};
+    auto& engine = rt.getEngine();
+    ASSERT_EQ(rt.getNbProfiles(), 1);
+
+    auto constexpr dataType = trt::DataType::kFLOAT;
+    auto const inputName = engine.getIOTensorName(0);
+
+    auto& allocator = rt.getBufferManager();
+    TllmRuntime::TensorMap tensorMap{};
+    tensorMap.insert(std::make_pair(
+        inputName, std::shared_ptr<ITensor>{allocator.gpu(engine.getTensorShape(inputName), dataType)}));
+    EXPECT_EQ(rt.selectProfile(tensorMap), 0);
+
+    // the engine has static shapes
+    tensorMap.insert_or_assign(
+        inputName, std::shared_ptr<ITensor>{allocator.gpu(ITensor::makeShape({2, 1, 28, 28}), dataType)});
+    EXPECT_EQ(rt.selectProfile(tensorMap), -1);
+
+    EXPECT_EQ(rt.getProfileOrder(), std::vector<SizeType>{0});
+    auto const& profileShapes = rt.getProfileShapes(inputName);
+    ASSERT_EQ(profileShapes.size(), 1);
+    auto const inputShape = engine.getTensorShape(inputName);
+    for (auto const& shape : {profileShapes[0].first, profileShapes[0].second})
+    {
+        ASSERT_EQ(shape.nbDims, inputShape.nbDims);
+        for (std::int32_t i = 0; i < shape.nbDims; ++i)
+        {
+            EXPECT_EQ(shape.d[i], inputShape.d[i]);
+        }
+    }
+    EXPECT_THROW(static_cast<void>(rt.getProfileShapes("unknown")), tc::TllmException);
+}
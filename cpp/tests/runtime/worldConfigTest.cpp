@@ -16,6 +16,7 @@
 
 #include <gtest/gtest.h>
 
+#include "tensorrt_llm/runtime/utils/gpuTopology.h"
 #include "tensorrt_llm/runtime/worldConfig.h"
 
 #include "tensorrt_llm/common/tllmException.h"
@@ -60,3 +61,23 @@ TEST(WorldConfig, DeviceIds)
     EXPECT_NO_THROW(
         tr::WorldConfig(tensorParallelism, pipelineParallelism, rank, gpusPerNode, std::vector{0, 1, 2, 3, 4, 6}));
 }
+
+TEST(WorldConfig, PlaceGroups)
+{
+    std::vector<tr::SizeType> const devices{0, 1, 2, 3};
+
+    // PCIe box with the NVLink pairs (0, 2) and (1, 3)
+    std::vector<std::vector<int>> scores(devices.size(), std::vector<int>(devices.size(), 1));
+    scores[0][2] = scores[2][0] = 64;
+    scores[1][3] = scores[3][1] = 64;
+    EXPECT_EQ(tr::utils::placeGroups(scores, devices, 2), (std::vector<tr::SizeType>{0, 2, 1, 3}));
+    // A single group spans all the devices
+    EXPECT_EQ(tr::utils::placeGroups(scores, devices, 4), devices);
+
+    // Uniform links keep the given order
+    std::vector<std::vector<int>> const uniformScores(devices.size(), std::vector<int>(devices.size(), 1));
+    EXPECT_EQ(tr::utils::placeGroups(uniformScores, devices, 2), devices);
+
+    // Groups that do not split the devices evenly
+    EXPECT_THROW(tr::utils::placeGroups(scores, devices, 3), tc::TllmException);
+}
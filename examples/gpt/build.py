@@ -301,6 +301,13 @@ def parse_arguments(args):
     parser.add_argument('--gather_all_token_logits',
                         action='store_true',
                         default=False)
+    parser.add_argument(
+        '--output_hidden_states',
+        action='store_true',
+        default=False,
+        help=
+        'Skip the LM head and return the hidden states of all the tokens, to serve embeddings with GptSession::encode. The engine cannot generate.'
+    )
 
     parser.add_argument('--enable_fp8', default=False, action='store_true')
     parser.add_argument(
@@ -310,6 +317,22 @@ def parse_arguments(args):
         help=
         'By default, we use dtype for KV cache. fp8_kv_cache chooses fp8 quantization for KV'
     )
+    parser.add_argument(
+        '--kv_cache_online_scaling',
+        default=False,
+        action="store_true",
+        help=
+        'Recalibrate the scale of the int8/fp8 KV cache at run time from the absmax of the keys and values '
+        'of the requests. The scale of the checkpoint is only the initial value.'
+    )
+    parser.add_argument(
+        '--kv_cache_block_scaling',
+        default=False,
+        action="store_true",
+        help=
+        'Quantize each block of the paged int8/fp8 KV cache with its own scale per KV head, computed from the '
+        'keys and values of the block, instead of the single scale of the checkpoint.'
+    )
     parser.add_argument(
         '--max_num_tokens',
         type=int,
@@ -327,6 +350,14 @@ def parse_arguments(args):
         action='store_true',
         help=
         'Activates latency-optimized algorithm for all-reduce instead of NCCL.')
+    parser.add_argument(
+        '--gemm_allreduce_chunks',
+        type=int,
+        default=0,
+        help=
+        'Splits the GEMM of the tensor parallel row linear layers into that many '
+        'chunks and overlaps the all-reduce of each chunk with the GEMM of the '
+        'next one. 0 disables the overlap.')
     parser.add_argument(
         '--use_lora_plugin',
         nargs='?',
@@ -348,6 +379,25 @@ def parse_arguments(args):
         help=
         'Activates paged context FMHA. This mode of the context FMHA is required for chunked context, speculative decoding and reuse of KV cache blocks. Context FMHA performance is worse when this mode is on.'
     )
+    parser.add_argument(
+        '--sliding_window_kv_cache',
+        action='store_true',
+        help=
+        'Release the paged KV cache blocks that slide out of the attention window instead of overwriting them in place. Requires the paged KV cache and the Python runtime.'
+    )
+    parser.add_argument(
+        '--block_cache_indirection',
+        action='store_true',
+        help=
+        'Let beam search read the paged KV cache through the blocks of the beams instead of one cache indirection entry per token. Requires the paged KV cache and the Python runtime.'
+    )
+    parser.add_argument(
+        '--sink_token_length',
+        type=int,
+        default=0,
+        help=
+        'Keep the KV cache of the first sink_token_length tokens when the cyclic KV cache (max_attention_window_size) drops the oldest tokens, as attention sinks (StreamingLLM). Requires beam width 1.'
+    )
     parser.add_argument(
         '--use_context_fmha_for_generation',
         action='store_true',
@@ -395,6 +445,13 @@ def parse_arguments(args):
         help=
         'Controls renormalization after gate logits. Check layers/moe.py for accepted values',
     )
+    parser.add_argument(
+        '--moe_all_to_all',
+        default=False,
+        action='store_true',
+        help=
+        'Dispatch the tokens to the experts with an all-to-all instead of an allreduce. Requires --moe_tp_mode 1',
+    )
     args = parser.parse_args(args)
     logger.set_level(args.log_level)
 
@@ -461,6 +518,20 @@ def parse_arguments(args):
         ), "You have to use GPT attention plugin when fp8 KV cache is set"
         args.quant_mode = args.quant_mode.set_fp8_kv_cache()
 
+    if args.kv_cache_online_scaling:
+        assert args.use_gpt_attention_plugin and (
+            args.int8_kv_cache or args.fp8_kv_cache
+        ), "kv_cache_online_scaling requires the GPT attention plugin and an int8 or fp8 KV cache."
+        args.quant_mode = args.quant_mode.set_kv_cache_online_scaling()
+
+    if args.kv_cache_block_scaling:
+        assert args.use_gpt_attention_plugin and args.paged_kv_cache and (
+            args.int8_kv_cache or args.fp8_kv_cache
+        ), "kv_cache_block_scaling requires the GPT attention plugin and a paged int8 or fp8 KV cache."
+        assert not args.use_paged_context_fmha and args.max_draft_len == 0, "kv_cache_block_scaling is not supported with paged context fmha."
+        assert not args.block_cache_indirection and args.sink_token_length == 0, "kv_cache_block_scaling is not supported with block_cache_indirection or sink_token_length."
+        args.quant_mode = args.quant_mode.set_kv_cache_block_scaling()
+
     if args.enable_fp8:
         args.quant_mode = args.quant_mode.set_fp8_qdq()
 
@@ -481,7 +552,8 @@ def parse_arguments(args):
         args.moe_top_k = 1
     args.moe_config = MoeConfig(args.moe_num_experts, args.moe_top_k,
                                 args.moe_tp_mode,
-                                args.moe_renorm_mode).validate()
+                                args.moe_renorm_mode,
+                                all_to_all=args.moe_all_to_all).validate()
 
     return args
 
@@ -546,6 +618,7 @@ def build_rank_engine(builder: Builder,
         embedding_sharding_dim=args.embedding_sharding_dim,
         share_embedding_table=share_embedding_table,
         moe_config=args.moe_config,
+        output_hidden_states=args.output_hidden_states,
     )
 
     if args.use_smooth_quant or args.use_weight_only:
@@ -620,6 +693,9 @@ def build_rank_engine(builder: Builder,
     if args.world_size > 1:
         network.plugin_config.set_nccl_plugin(args.dtype,
                                               args.use_custom_all_reduce)
+        if args.gemm_allreduce_chunks > 0:
+            network.plugin_config.set_gemm_allreduce_plugin(
+                args.gemm_allreduce_chunks)
 
     if args.use_lookup_plugin:
         # Use the plugin for the embedding parallelism and sharing
@@ -629,6 +705,26 @@ def build_rank_engine(builder: Builder,
         assert args.enable_context_fmha or args.enable_context_fmha_fp32_acc, "context fmha must be enabled"
         network.plugin_config.set_paged_context_fmha()
 
+    if args.sliding_window_kv_cache:
+        assert args.use_gpt_attention_plugin and args.paged_kv_cache, "sliding_window_kv_cache must be used with paged KV cache and attention."
+        assert not args.use_paged_context_fmha, "sliding_window_kv_cache is not supported with paged context fmha."
+        network.plugin_config.enable_sliding_window_kv_cache()
+
+    if args.block_cache_indirection:
+        assert args.use_gpt_attention_plugin and args.paged_kv_cache, "block_cache_indirection must be used with paged KV cache and attention."
+        assert not args.sliding_window_kv_cache, "block_cache_indirection is not supported with sliding_window_kv_cache."
+        network.plugin_config.enable_block_cache_indirection()
+
+    if args.output_hidden_states:
+        assert args.use_gpt_attention_plugin, "output_hidden_states must be used with the attention plugin."
+        assert not args.gather_all_token_logits, "output_hidden_states skips the LM head, the logits cannot be gathered."
+
+    if args.sink_token_length > 0:
+        assert args.use_gpt_attention_plugin, "sink_token_length must be used with the attention plugin."
+        assert not args.sliding_window_kv_cache and not args.block_cache_indirection, "sink_token_length is not supported with sliding_window_kv_cache or block_cache_indirection."
+        assert not args.use_paged_context_fmha and args.max_draft_len == 0, "sink_token_length is not supported with paged context fmha."
+        network.plugin_config.set_sink_token_length(args.sink_token_length)
+
     if args.use_context_fmha_for_generation:
         logger.warning(
             f'use_context_fmha_for_generation is set. This flag must be used only for testing'
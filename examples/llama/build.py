@@ -39,6 +39,8 @@ from tensorrt_llm.layers.attention import PositionEmbeddingType
 from tensorrt_llm.logger import logger
 from tensorrt_llm.mapping import Mapping
 from tensorrt_llm.models import quantize_model
+from tensorrt_llm.models.modeling_utils import (load_checkpoint_weights,
+                                                save_checkpoint_weights)
 from tensorrt_llm.network import net_guard
 from tensorrt_llm.plugin.plugin import ContextFMHAType
 from tensorrt_llm.quantization import QuantMode
@@ -207,6 +209,27 @@ def parse_arguments():
     parser.add_argument('--load_by_shard',
                         action='store_true',
                         help='Load a pretrained model shard-by-shard.')
+    parser.add_argument(
+        '--load_workers',
+        type=int,
+        default=1,
+        help=
+        'The number of threads reading and converting the shards with --load_by_shard.'
+    )
+    parser.add_argument(
+        '--save_converted_dir',
+        type=str,
+        default=None,
+        help=
+        'Also save the converted weights of each rank, sliced, quantized and preprocessed, to rank<N>.safetensors in this directory.'
+    )
+    parser.add_argument(
+        '--converted_dir',
+        type=str,
+        default=None,
+        help=
+        'Load the weights of each rank from the rank<N>.safetensors saved with --save_converted_dir instead of converting them. The other arguments must be the ones the weights were saved with.'
+    )
     parser.add_argument('--enable_debug_output',
                         default=False,
                         action='store_true')
@@ -269,6 +292,14 @@ def parse_arguments():
                         type=int,
                         default=128,
                         help='Group size used in GPTQ/AWQ quantization.')
+    parser.add_argument(
+        '--gptq_act_order',
+        default=False,
+        action="store_true",
+        help=
+        'The GPTQ checkpoint was quantized with act-order (desc_act), its g_idx '
+        'are used to sort the weights by group. Not supported with tensor '
+        'parallelism.')
     parser.add_argument(
         '--int8_kv_cache',
         default=False,
@@ -368,6 +399,22 @@ def parse_arguments():
         action='store_true',
         help=
         'Activates latency-optimized algorithm for all-reduce instead of NCCL.')
+    parser.add_argument(
+        '--gemm_allreduce_chunks',
+        type=int,
+        default=0,
+        help=
+        'Splits the GEMM of the tensor parallel row linear layers into that many '
+        'chunks and overlaps the all-reduce of each chunk with the GEMM of the '
+        'next one. 0 disables the overlap.')
+    parser.add_argument(
+        '--sequence_parallel',
+        action='store_true',
+        help=
+        'Splits the tokens over the tensor parallel ranks between the '
+        'attention and MLP blocks, the all-reduces become reduce-scatters and '
+        'all-gathers. Reduces the activation memory of the norms and the '
+        'residuals. Requires --remove_input_padding.')
     parser.add_argument(
         '--max_prompt_embedding_table_size',
         type=int,
@@ -384,6 +431,14 @@ def parse_arguments():
         choices=['float16', 'float32', 'bfloat16'],
         help="Activates the lora plugin which enables embedding sharing.")
     parser.add_argument('--hf_lora_dir', type=str, default=None)
+    parser.add_argument(
+        '--use_grouped_gemm_plugin',
+        nargs='?',
+        const='float16',
+        default=False,
+        choices=['float16', 'bfloat16'],
+        help="Runs the gate and up projections of the MLP in one grouped GEMM "
+        "launch when --use_fused_mlp is not set.")
     parser.add_argument(
         '--moe_num_experts',
         default=0,
@@ -410,6 +465,36 @@ def parse_arguments():
         help=
         'Controls renormalization after gate logits. Check layers/moe.py for accepted values',
     )
+    parser.add_argument(
+        '--moe_all_to_all',
+        default=False,
+        action='store_true',
+        help=
+        'Dispatch the tokens to the experts with an all-to-all instead of an allreduce. Requires --moe_tp_mode 1',
+    )
+    parser.add_argument(
+        '--moe_overlap_all_to_all',
+        default=False,
+        action='store_true',
+        help=
+        'Return the expert results of each GPU while the experts compute the tokens of the next one. Requires --moe_all_to_all',
+    )
+    parser.add_argument(
+        '--moe_replicated_experts',
+        default=[],
+        type=int,
+        nargs='+',
+        help=
+        'Hot experts copied to all the GPUs, their tokens are split evenly between the GPUs. Requires --moe_tp_mode 1',
+    )
+    parser.add_argument(
+        '--moe_group_size',
+        default=0,
+        type=int,
+        choices=[0, 64, 128],
+        help=
+        'Quantize the expert weights with one scale per group of rows instead of one per channel. Requires --use_weight_only',
+    )
 
     args = parser.parse_args()
     logger.set_level(args.log_level)
@@ -417,6 +502,22 @@ def parse_arguments():
     assert not (
         args.use_smooth_quant and args.use_weight_only
     ), "You cannot enable both SmoothQuant and INT8 weight-only together."
+    assert args.moe_group_size == 0 or args.use_weight_only, \
+        "--moe_group_size requires --use_weight_only"
+    if args.gptq_act_order:
+        assert args.per_group and args.weight_only_precision == 'int4_gptq', \
+            "--gptq_act_order requires a per-group int4_gptq checkpoint"
+        assert args.tp_size == 1, \
+            "--gptq_act_order is not supported with tensor parallelism"
+    if args.sequence_parallel:
+        assert args.tp_size > 1, "--sequence_parallel requires --tp_size > 1"
+        assert args.remove_input_padding, \
+            "--sequence_parallel requires --remove_input_padding"
+        assert not (args.use_smooth_quant or args.use_weight_only
+                    or args.enable_fp8), \
+            "--sequence_parallel is not supported with quantization"
+        assert args.moe_num_experts == 0, \
+            "--sequence_parallel is not supported with MoE"
 
     if not args.remove_input_padding:
         if args.use_gpt_attention_plugin:
@@ -582,7 +683,11 @@ def parse_arguments():
         args.moe_top_k = 1
     args.moe_config = MoeConfig(args.moe_num_experts, args.moe_top_k,
                                 args.moe_tp_mode,
-                                args.moe_renorm_mode).validate()
+                                args.moe_renorm_mode,
+                                all_to_all=args.moe_all_to_all,
+                                overlap_all_to_all=args.moe_overlap_all_to_all,
+                                replicated_experts=args.moe_replicated_experts,
+                                group_size=args.moe_group_size).validate()
 
     return args
 
@@ -627,7 +732,8 @@ def build_rank_engine(builder: Builder,
         rms_norm_eps=args.rms_norm_eps,
         use_fused_mlp=args.use_fused_mlp,
         use_prompt_tuning=args.max_prompt_embedding_table_size > 0,
-        moe_config=args.moe_config)
+        moe_config=args.moe_config,
+        sequence_parallel=args.sequence_parallel)
     quantize_kwargs = {}
     if args.use_smooth_quant or args.use_weight_only:
         if args.weight_only_precision == 'int4_awq':
@@ -642,6 +748,7 @@ def build_rank_engine(builder: Builder,
                 "group_size": args.group_size,
                 "zero": True,
                 "pre_quant_scale": False,
+                "act_order": args.gptq_act_order,
             }
     elif args.enable_fp8 or args.fp8_kv_cache:
         logger.info(f'Loading scaling factors from '
@@ -659,7 +766,11 @@ def build_rank_engine(builder: Builder,
 
     tensorrt_llm_llama = quantize_model(tensorrt_llm_llama, args.quant_mode,
                                         **quantize_kwargs)
-    if args.per_group:
+    if args.converted_dir is not None:
+        load_checkpoint_weights(
+            tensorrt_llm_llama,
+            os.path.join(args.converted_dir, f'rank{rank}.safetensors'))
+    elif args.per_group:
         load_func = load_from_awq_llama if args.weight_only_precision == 'int4_awq' else load_from_gptq_llama
         load_func(tensorrt_llm_llama=tensorrt_llm_llama,
                   quant_ckpt_path=args.quant_ckpt_path,
@@ -698,7 +809,8 @@ def build_rank_engine(builder: Builder,
                                     args.model_dir,
                                     mapping,
                                     dtype=args.dtype,
-                                    lora_config=args.lora_config)
+                                    lora_config=args.lora_config,
+                                    num_workers=args.load_workers)
         tok = time.time()
         t = time.strftime('%H:%M:%S', time.gmtime(tok - tik))
         logger.info(f'HF LLaMA loaded. Total time: {t}')
@@ -710,6 +822,11 @@ def build_rank_engine(builder: Builder,
                          fp16=(args.dtype == 'float16'),
                          multi_query_mode=(args.n_kv_head != args.n_head))
     profiler.print_memory_usage(f'Rank {rank} model weight loaded.')
+    if args.save_converted_dir is not None:
+        os.makedirs(args.save_converted_dir, exist_ok=True)
+        save_checkpoint_weights(
+            tensorrt_llm_llama,
+            os.path.join(args.save_converted_dir, f'rank{rank}.safetensors'))
 
     # Module -> Network
     network = builder.create_network()
@@ -727,6 +844,9 @@ def build_rank_engine(builder: Builder,
         network.plugin_config.set_rmsnorm_plugin(dtype=args.use_rmsnorm_plugin)
     if args.use_lora_plugin:
         network.plugin_config.set_lora_plugin(dtype=args.use_lora_plugin)
+    if args.use_grouped_gemm_plugin:
+        network.plugin_config.set_grouped_gemm_plugin(
+            dtype=args.use_grouped_gemm_plugin)
 
     # Quantization plugins.
     if args.use_smooth_quant:
@@ -753,6 +873,9 @@ def build_rank_engine(builder: Builder,
     if args.world_size > 1:
         network.plugin_config.set_nccl_plugin(args.dtype,
                                               args.use_custom_all_reduce)
+        if args.gemm_allreduce_chunks > 0:
+            network.plugin_config.set_gemm_allreduce_plugin(
+                args.gemm_allreduce_chunks)
     if args.remove_input_padding:
         network.plugin_config.enable_remove_input_padding()
     if args.paged_kv_cache:
@@ -808,8 +931,8 @@ def build(rank, args):
     builder = Builder()
     cache = None
     for cur_rank in range(args.world_size):
-        # skip other ranks if parallel_build is enabled
-        if args.parallel_build and cur_rank != rank:
+        # skip the ranks of the other processes if parallel_build is enabled
+        if args.parallel_build and cur_rank % args.build_processes != rank:
             continue
         tik = time.time()
 
@@ -893,12 +1016,13 @@ def build(rank, args):
 if __name__ == '__main__':
     args = parse_arguments()
     tik = time.time()
-    if args.parallel_build and args.world_size > 1 and \
-            torch.cuda.device_count() >= args.world_size:
+    # With fewer GPUs than ranks, each GPU builds several ranks one after the other
+    args.build_processes = min(args.world_size, torch.cuda.device_count())
+    if args.parallel_build and args.build_processes > 1:
         logger.warning(
-            f'Parallelly build TensorRT engines. Please make sure that all of the {args.world_size} GPUs are totally free.'
+            f'Parallelly build TensorRT engines. Please make sure that all of the {args.build_processes} GPUs are totally free.'
         )
-        mp.spawn(build, nprocs=args.world_size, args=(args, ))
+        mp.spawn(build, nprocs=args.build_processes, args=(args, ))
     else:
         args.parallel_build = False
         logger.info('Serially build TensorRT engines.')
@@ -42,6 +42,13 @@ def parse_arguments(args=None):
     )
     parser.add_argument('--log_level', type=str, default='error')
     parser.add_argument('--engine_dir', type=str, default='engine_outputs')
+    parser.add_argument(
+        '--checkpoint_dir',
+        type=str,
+        default=None,
+        help=
+        'An unsharded checkpoint to refit the engines with, sliced for their mapping. Requires --use_py_session.'
+    )
     parser.add_argument('--use_py_session',
                         default=False,
                         action='store_true',
@@ -93,6 +100,12 @@ def parse_arguments(args=None):
                         type=int,
                         help="Use beam search if num_beams >1",
                         default=1)
+    parser.add_argument(
+        '--num_return_sequences',
+        type=int,
+        help=
+        "Number of sequences sampled per input, sharing the computation and the KV cache of the input. Requires the Python session and num_beams == 1",
+        default=1)
     parser.add_argument('--temperature', type=float, default=1.0)
     parser.add_argument('--top_k', type=int, default=1)
     parser.add_argument('--top_p', type=float, default=0.0)
@@ -336,6 +349,10 @@ def main(args):
                          rank=runtime_rank,
                          debug_mode=args.debug_mode,
                          lora_ckpt_source=args.lora_ckpt_source)
+    if args.checkpoint_dir is not None:
+        assert args.use_py_session, \
+            "Refitting from a checkpoint requires the Python runtime session"
+        runner_kwargs.update(checkpoint_dir=args.checkpoint_dir)
     if not args.use_py_session:
         runner_kwargs.update(
             max_batch_size=len(batch_input_ids),
@@ -356,6 +373,7 @@ def main(args):
             top_k=args.top_k,
             top_p=args.top_p,
             num_beams=args.num_beams,
+            num_return_sequences=args.num_return_sequences,
             length_penalty=args.length_penalty,
             repetition_penalty=args.repetition_penalty,
             presence_penalty=args.presence_penalty,
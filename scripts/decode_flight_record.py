@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+# SPDX-FileCopyrightText: Copyright (c) 2022-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Decodes the file written by FlightRecorder::dump of
+cpp/include/tensorrt_llm/batch_manager/flightRecorder.h."""
+import argparse
+import json
+import struct
+import sys
+
+MAGIC = b'TLLMFLT1'
+HEADER = struct.Struct('<8sIIIIQ')
+# Same order as common::CommOp
+COMM_OPS = ['AllReduce', 'AllGather', 'ReduceScatter', 'Send', 'Recv']
+INT64_FIELDS = [
+    'iteration', 'timestamp_us', 'step_time_us', 'fetch_requests_time_us',
+    'schedule_time_us', 'forward_time_us', 'send_responses_time_us'
+]
+INT32_FIELDS = [
+    'active_requests', 'queued_requests', 'paused_requests',
+    'context_requests', 'generation_requests', 'context_tokens',
+    'generation_tokens', 'used_kv_blocks', 'free_kv_blocks',
+    'kv_blocks_allocated', 'kv_blocks_freed', 'scheduled_requests'
+]
+
+
+def decode(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    (magic, version, record_size, num_comm_ops, max_request_ids,
+     num_records) = HEADER.unpack_from(data)
+    if magic != MAGIC or version != 1:
+        raise ValueError(f'{path} is not a flight record of version 1')
+    record = struct.Struct(f'<{len(INT64_FIELDS)}q{len(INT32_FIELDS)}i'
+                           f'{num_comm_ops}f{num_comm_ops}I{max_request_ids}Q')
+    if record.size != record_size:
+        raise ValueError(
+            f'Unexpected record size {record_size}, expected {record.size}')
+
+    ops = COMM_OPS[:num_comm_ops]
+    records = []
+    for i in range(num_records):
+        values = record.unpack_from(data, HEADER.size + i * record_size)
+        fields = dict(zip(INT64_FIELDS + INT32_FIELDS, values))
+        offset = len(INT64_FIELDS) + len(INT32_FIELDS)
+        comm_times = values[offset:offset + num_comm_ops]
+        comm_counts = values[offset + num_comm_ops:offset + 2 * num_comm_ops]
+        request_ids = values[offset + 2 * num_comm_ops:]
+        num_ids = min(fields['scheduled_requests'], max_request_ids)
+        fields['comm_time_ms'] = {
+            op: t
+            for op, t, n in zip(ops, comm_times, comm_counts) if n > 0
+        }
+        fields['comm_count'] = {
+            op: n
+            for op, n in zip(ops, comm_counts) if n > 0
+        }
+        fields['request_ids'] = list(request_ids[:num_ids])
+        records.append(fields)
+    return records
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('path', help='File written by FlightRecorder::dump')
+    parser.add_argument('--json',
+                        action='store_true',
+                        help='Print the records as a JSON list')
+    args = parser.parse_args()
+
+    records = decode(args.path)
+    if args.json:
+        json.dump(records, sys.stdout, indent=2)
+        print()
+        return
+    for r in records:
+        comm_ms = sum(r['comm_time_ms'].values())
+        print(f"iter {r['iteration']} ts_us {r['timestamp_us']} "
+              f"step_us {r['step_time_us']} forward_us {r['forward_time_us']} "
+              f"active {r['active_requests']} queued {r['queued_requests']} "
+              f"paused {r['paused_requests']} "
+              f"ctx {r['context_requests']}/{r['context_tokens']}tok "
+              f"gen {r['generation_requests']}/{r['generation_tokens']}tok "
+              f"kv used {r['used_kv_blocks']} free {r['free_kv_blocks']} "
+              f"+{r['kv_blocks_allocated']} -{r['kv_blocks_freed']} "
+              f"comm_ms {comm_ms:.3f} ids {r['request_ids']}")
+
+
+if __name__ == '__main__':
+    main()
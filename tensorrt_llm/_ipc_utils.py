@@ -38,10 +38,14 @@ def peer_access(mapping: Mapping):
 
 
 def set_peer_access(mapping: Mapping, enabled: bool = True):
-    src_node = mapping.rank
-    for dest_node in mapping.tp_group:
-        if dest_node == src_node:
+    src_node = mapping.rank % mapping.gpus_per_node
+    for dest_rank in mapping.tp_group:
+        # Peer access only concerns the GPUs of the node
+        same_node = (dest_rank // mapping.gpus_per_node == mapping.rank //
+                     mapping.gpus_per_node)
+        if dest_rank == mapping.rank or not same_node:
             continue
+        dest_node = dest_rank % mapping.gpus_per_node
 
         error, result = cudart.cudaDeviceCanAccessPeer(src_node, dest_node)
         _raise_if_error(error)
@@ -90,9 +94,13 @@ class IpcMemory():
         """ Allocates a buffer with the given *size* on each GPU. Then, enables IPC communication between TP groups.
         Returns a list of buffer pointers, buffers[i] is a handle to the corresponding buffer residing on GPU #i.
         Call close_ipc_handle with the *buffer*.
+        When the TP group spans several nodes, only the buffers of the TP ranks of the node are shared, the pointers of
+        the other ranks are 0.
         """
         from mpi4py import MPI
-        comm = MPI.COMM_WORLD.Split(mapping.pp_rank, mapping.tp_rank)
+        node_idx = mapping.tp_rank // mapping.local_tp_size()
+        comm = MPI.COMM_WORLD.Split(
+            mapping.pp_rank * mapping.tp_size + node_idx, mapping.tp_rank)
 
         error, local_ptr = cudart.cudaMalloc(size)
         _raise_if_error(error)
@@ -108,22 +116,24 @@ class IpcMemory():
             handle.reserved = reserved
             handles.append(handle)
 
-        peer_ptrs = []
+        # One pointer per TP rank, as the C++ runtime lays out the workspace
+        peer_ptrs = [0] * mapping.tp_size
+        node_tp_rank = node_idx * mapping.local_tp_size()
         for node, handle in enumerate(handles):
-            if node == mapping.tp_rank:
-                peer_ptrs.append(local_ptr)
+            if node == mapping.local_tp_rank():
+                peer_ptrs[node_tp_rank + node] = local_ptr
             else:
                 error, ptr = cudart.cudaIpcOpenMemHandle(
                     handle, cudart.cudaIpcMemLazyEnablePeerAccess)
                 _raise_if_error(error)
-                peer_ptrs.append(ptr)
+                peer_ptrs[node_tp_rank + node] = ptr
 
         return peer_ptrs, local_ptr
 
     @staticmethod
     def close_ipc_memory(mapping: Mapping, peer_ptrs: List[int]):
-        for node, ptr in enumerate(peer_ptrs):
-            if node == mapping.tp_rank:
+        for rank, ptr in enumerate(peer_ptrs):
+            if rank == mapping.tp_rank:
                 _raise_if_error(cudart.cudaFree(ptr)[0])
-            else:
+            elif ptr != 0:
                 _raise_if_error(cudart.cudaIpcCloseMemHandle(ptr)[0])
@@ -16,18 +16,26 @@ import copy
 import json
 import math
 import os
+import re
 import time
+from contextlib import contextmanager
 from dataclasses import dataclass
 from functools import wraps
 from pathlib import Path
-from typing import Dict, Optional, Union
+from typing import Dict, Iterable, Optional, Tuple, Union
 
+import numpy as np
+import safetensors
+import safetensors.torch
 import tensorrt as trt
+import torch
 from packaging import version
 
-from ._utils import to_dict, to_json_file, trt_version
+from ._utils import (numpy_to_torch, to_dict, to_json_file, torch_to_numpy,
+                     trt_version)
 from .graph_rewriting import optimize
 from .logger import logger
+from .mapping import Mapping
 from .models import MODEL_MAP, PretrainedConfig, PretrainedModel
 from .network import Network, net_guard
 from .plugin import PluginConfig
@@ -98,6 +106,43 @@ class BuilderConfig(object):
         return config
 
 
+def get_build_cache_dir() -> Optional[Path]:
+    '''@brief: The directory of the caches shared by the builds of a node: the
+        TensorRT timing cache of each GPU and TensorRT version, and the tactics
+        of the GEMM plugins. TRTLLM_BUILD_CACHE_DIR, ~/.cache/tensorrt_llm by
+        default, an empty value disables the caches.
+    '''
+    cache_dir = os.environ.get('TRTLLM_BUILD_CACHE_DIR')
+    if cache_dir is None:
+        return Path.home() / '.cache' / 'tensorrt_llm'
+    return Path(cache_dir) if cache_dir else None
+
+
+def _get_shared_timing_cache_path(cache_dir: Path) -> Path:
+    # The timings are only valid on the GPU and TensorRT version they were measured with
+    device_name = re.sub(r'[^0-9A-Za-z]+', '_',
+                         torch.cuda.get_device_name()).strip('_')
+    major, minor = torch.cuda.get_device_capability()
+    return cache_dir / f'timing_cache_{device_name}_sm{major}{minor}_trt{trt_version()}.bin'
+
+
+@contextmanager
+def _lock_file(path: Path, exclusive: bool):
+    # Concurrent builds merge their timings into the same file
+    try:
+        import fcntl
+    except ImportError:
+        # Without locking, the file is still replaced atomically
+        yield
+        return
+    with open(f'{path}.lock', 'a') as lock:
+        fcntl.flock(lock, fcntl.LOCK_EX if exclusive else fcntl.LOCK_SH)
+        try:
+            yield
+        finally:
+            fcntl.flock(lock, fcntl.LOCK_UN)
+
+
 class Builder():
 
     _ALLOWED_PRECISIONS = ['float32', 'float16', 'bfloat16']
@@ -106,6 +151,8 @@ class Builder():
         super().__init__()
         self._trt_builder = trt.Builder(logger.trt_logger)
         self.strongly_typed = False
+        # Set by create_builder_config when the build cache is enabled
+        self._shared_timing_cache_path = None
 
     @property
     def trt_builder(self) -> trt.Builder:
@@ -139,6 +186,8 @@ class Builder():
                               int8: bool = False,
                               strongly_typed: bool = False,
                               opt_level: Optional[int] = None,
+                              weight_streaming: bool = False,
+                              strip_weights: bool = False,
                               **kwargs) -> BuilderConfig:
         ''' @brief Create a builder config with given precisions and timing cache
             @param precision: one of allowed precisions, defined in Builder._ALLOWED_PRECISIONS
@@ -147,6 +196,8 @@ class Builder():
             @param kwargs: any other arguments users would like to attach to the config object as attributes
             @param refit: set to accelerate multi-gpu building, build engine for 1 gpu and refit for the others
             @param int8: whether to build with int8 enabled or not. Can't be used together with refit option
+            @param weight_streaming: whether the weights can be streamed from host memory at runtime, requires TensorRT 10 and a strongly typed network
+            @param strip_weights: whether the refittable weights are left out of the engine and refitted when it is loaded, requires TensorRT 10 and refit
             @return: A BuilderConfig object, return None if failed
         '''
         self.strongly_typed = strongly_typed
@@ -183,6 +234,22 @@ class Builder():
         if use_refit:
             config.set_flag(trt.BuilderFlag.REFIT)
 
+        if weight_streaming:
+            if version.parse(trt_version()) < version.parse("10.0.0"):
+                logger.error("weight streaming requires TensorRT 10")
+            elif not strongly_typed:
+                logger.error("weight streaming requires a strongly typed network")
+            else:
+                config.set_flag(trt.BuilderFlag.WEIGHT_STREAMING)
+
+        if strip_weights:
+            if version.parse(trt_version()) < version.parse("10.0.0"):
+                logger.error("weightless engines require TensorRT 10")
+            elif not use_refit:
+                logger.error("weightless engines require refit")
+            else:
+                config.set_flag(trt.BuilderFlag.STRIP_PLAN)
+
         if opt_level is not None:
             config.builder_optimization_level = opt_level
 
@@ -205,6 +272,7 @@ class Builder():
         # When user does not given any existing cache, internally always created one
         # so the cache should never None here
         assert cache is not None and isinstance(cache, trt.ITimingCache)
+        self._load_shared_caches(config, cache)
         config.set_timing_cache(cache, ignore_mismatch=False)
 
         return BuilderConfig()._init(config,
@@ -214,6 +282,58 @@ class Builder():
                                      int8=int8,
                                      **kwargs)
 
+    def _load_shared_caches(self, config: trt.IBuilderConfig,
+                            cache: trt.ITimingCache):
+        '''@brief: Adds the timings measured by the earlier builds on this GPU
+            to cache, and makes the GEMM plugins share their tactics through
+            the build cache directory, see get_build_cache_dir.
+        '''
+        self._shared_timing_cache_path = None
+        cache_dir = get_build_cache_dir()
+        if cache_dir is None or not torch.cuda.is_available():
+            return
+        try:
+            os.makedirs(cache_dir, exist_ok=True)
+        except OSError as e:
+            logger.warning(f'Cannot create the build cache {cache_dir}: {e}')
+            return
+        os.environ.setdefault('TRTLLM_GEMM_PROFILE_CACHE_DIR', str(cache_dir))
+
+        path = _get_shared_timing_cache_path(cache_dir)
+        self._shared_timing_cache_path = path
+        if not path.exists():
+            return
+        with _lock_file(path, exclusive=False):
+            shared = config.create_timing_cache(path.read_bytes())
+        if cache.combine(shared, ignore_mismatch=False):
+            logger.info(f'Timing cache merged with {path}')
+        else:
+            logger.warning(f'Cannot merge the timing cache {path}')
+
+    def _save_shared_timing_cache(self, builder_config: BuilderConfig):
+        '''@brief: Merges the timings of the build into the shared timing cache.
+        '''
+        path = self._shared_timing_cache_path
+        cache = builder_config.trt_builder_config.get_timing_cache()
+        if path is None or cache is None:
+            return
+        try:
+            with _lock_file(path, exclusive=True):
+                # Keep the timings the other builds added since the file was read
+                if path.exists():
+                    merged = builder_config.trt_builder_config.create_timing_cache(
+                        path.read_bytes())
+                    merged.combine(cache, ignore_mismatch=False)
+                    cache = merged
+                tmp_path = path.with_name(f'{path.name}.tmp.{os.getpid()}')
+                with cache.serialize() as buffer:
+                    with open(tmp_path, 'wb') as f:
+                        f.write(buffer)
+                os.replace(tmp_path, path)
+            logger.info(f'Timing cache saved to {path}')
+        except OSError as e:
+            logger.warning(f'Cannot save the timing cache {path}: {e}')
+
     def _add_optimization_profile(self, network: Network,
                                   builder_config: BuilderConfig):
         assert isinstance(builder_config, BuilderConfig)
@@ -359,6 +479,7 @@ class Builder():
         if engine is None:
             logger.error('Engine building failed, please check the error log.')
             return None
+        self._save_shared_timing_cache(builder_config)
 
         tok = time.time()
         t = time.strftime('%H:%M:%S', time.gmtime(tok - tik))
@@ -401,6 +522,12 @@ class BuildConfig:
     max_num_tokens: Optional[int] = None
     max_prompt_embedding_table_size: int = 0
     gather_all_token_logits: int = False
+    # Refittable engines, whose weights can be replaced at load time
+    use_refit: bool = False
+    # Engines whose weights can be streamed from host memory, see gpuWeightsPercent of GptSession
+    weight_streaming: bool = False
+    # Engines without their refittable weights, which are saved next to them and refitted at load time
+    strip_weights: bool = False
     plugin_config: PluginConfig = PluginConfig()
 
     @classmethod
@@ -413,6 +540,9 @@ class BuildConfig:
         max_prompt_embedding_table_size = config.pop(
             'max_prompt_embedding_table_size', 0)
         gather_all_token_logits = config.pop('gather_all_token_logits', False)
+        use_refit = config.pop('use_refit', False)
+        weight_streaming = config.pop('weight_streaming', False)
+        strip_weights = config.pop('strip_weights', False)
 
         plugin_config = PluginConfig()
         if 'plugin_config' not in config:
@@ -424,6 +554,9 @@ class BuildConfig:
                 max_num_tokens=max_num_tokens,
                 max_prompt_embedding_table_size=max_prompt_embedding_table_size,
                 gather_all_token_logits=gather_all_token_logits,
+                use_refit=use_refit,
+                weight_streaming=weight_streaming,
+                strip_weights=strip_weights,
                 plugin_config=plugin_config)
 
         config = config['plugin_config']
@@ -469,6 +602,9 @@ class BuildConfig:
             max_num_tokens=max_num_tokens,
             max_prompt_embedding_table_size=max_prompt_embedding_table_size,
             gather_all_token_logits=gather_all_token_logits,
+            use_refit=use_refit,
+            weight_streaming=weight_streaming,
+            strip_weights=strip_weights,
             plugin_config=plugin_config)
 
     @classmethod
@@ -521,21 +657,28 @@ class EngineConfig:
 
 class Engine:
 
-    def __init__(self, config: EngineConfig, engine: trt.IHostMemory):
+    def __init__(self,
+                 config: EngineConfig,
+                 engine: trt.IHostMemory,
+                 weights: Optional[Dict[str, np.ndarray]] = None):
         self.config = config
         self.engine = engine
+        # The weights of an engine built with strip_weights
+        self.weights = weights
 
     def save(self, engine_dir: str):
-        if self.config.pretrained_config.mapping.rank == 0:
+        rank = self.config.pretrained_config.mapping.rank
+        if rank == 0:
             with open(os.path.join(engine_dir, 'config.json'),
                       "w",
                       encoding="utf-8") as f:
                 json.dump(self.config.to_dict(), f, indent=4)
-        serialize_engine(
-            self.engine,
-            os.path.join(
-                engine_dir,
-                f'rank{self.config.pretrained_config.mapping.rank}.engine'))
+        serialize_engine(self.engine,
+                         os.path.join(engine_dir, f'rank{rank}.engine'))
+        if self.weights is not None:
+            save_engine_weights(
+                self.weights,
+                os.path.join(engine_dir, f'rank{rank}.safetensors'))
 
     @classmethod
     def from_dir(cls, engine_dir: str, rank: int = 0):
@@ -546,7 +689,65 @@ class Engine:
             os.path.join(engine_dir, 'config.json'))
         config.pretrained_config.set_rank(rank)
 
-        return cls(config, engine_buffer)
+        engine = cls(config, engine_buffer)
+        if config.build_config.strip_weights:
+            with safetensors.safe_open(os.path.join(engine_dir,
+                                                    f'rank{rank}.safetensors'),
+                                       framework='pt') as f:
+                engine._refit(
+                    (name, torch_to_numpy(f.get_tensor(name)))
+                    for name in f.keys())
+        return engine
+
+    def refit(self, model: PretrainedModel):
+        '''@brief: Replaces the weights of the engine by the ones of the
+            parameters of the model, the engine must be built with use_refit.
+            Weights that are not parameters of the model, such as the ones
+            computed from them while building, are not replaced.
+        '''
+        self._refit((name, param.raw_value)
+                    for name, param in model.named_parameters())
+
+    def _refit(self, weights: Iterable[Tuple[str, np.ndarray]]):
+        tik = time.time()
+        runtime = trt.Runtime(logger.trt_logger)
+        engine = runtime.deserialize_cuda_engine(self.engine)
+        assert engine.refittable, "The engine is not built with use_refit"
+
+        refitter = trt.Refitter(engine, logger.trt_logger)
+        refittable = set(refitter.get_all_weights())
+        # The arrays must outlive the refit
+        values = []
+        for name, value in weights:
+            if name not in refittable:
+                continue
+            values.append(value)
+            if not refitter.set_named_weights(name, trt.Weights(value)):
+                raise RuntimeError(f'Failed to refit weight: {name}')
+        if not refitter.refit_cuda_engine():
+            raise RuntimeError('Failed to refit engine')
+        self.engine = engine.serialize()
+
+        tok = time.time()
+        t = time.strftime('%H:%M:%S', time.gmtime(tok - tik))
+        logger.info(f'Total time of refitting {engine.name}: {t}')
+
+
+def save_engine_weights(weights: Dict[str, np.ndarray], path: str):
+    '''@brief: Saves the weights of a weightless engine as safetensors, which
+        the runtime memory maps, so that the processes serving the engine on a
+        node share them in the page cache.
+    '''
+    logger.info(f'Saving engine weights to {path}...')
+    tik = time.time()
+    safetensors.torch.save_file(
+        {
+            name: numpy_to_torch(np.ascontiguousarray(value))
+            for name, value in weights.items()
+        }, path)
+    tok = time.time()
+    t = time.strftime('%H:%M:%S', time.gmtime(tok - tik))
+    logger.info(f'Engine weights saved. Total time: {t}')
 
 
 def get_engine_version(engine_dir: str) -> Union[None, str]:
@@ -564,6 +765,8 @@ def get_engine_version(engine_dir: str) -> Union[None, str]:
 def build_shard_model(model: PretrainedModel,
                       build_config: BuildConfig) -> Engine:
     builder = Builder()
+    # Weight streaming needs the types of all the tensors of the network
+    builder.strongly_typed = build_config.weight_streaming
     network = builder.create_network()
     network._plugin_config = build_config.plugin_config
 
@@ -604,14 +807,24 @@ def build_shard_model(model: PretrainedModel,
 
     builder_config = builder.create_builder_config(
         precision=model.config.dtype,
+        use_refit=build_config.use_refit or build_config.strip_weights,
         int8=model.config.quant_mode.has_act_or_weight_quant()
-        or model.config.quant_mode.has_int8_kv_cache())
+        or model.config.quant_mode.has_int8_kv_cache(),
+        strongly_typed=build_config.weight_streaming,
+        weight_streaming=build_config.weight_streaming,
+        strip_weights=build_config.strip_weights)
 
     # Network -> Engine
     engine = builder.build_engine(network, builder_config)
     engine_config = EngineConfig(model.config, build_config, __version__)
 
-    return Engine(engine_config, engine)
+    weights = None
+    if build_config.strip_weights:
+        weights = {
+            name: param.raw_value
+            for name, param in model.named_parameters()
+        }
+    return Engine(engine_config, engine, weights)
 
 
 def build(build_config: Union[str, BuildConfig],
@@ -619,7 +832,13 @@ def build(build_config: Union[str, BuildConfig],
           ckpt_dir: str = None,
           model_config: Union[str, PretrainedConfig] = None,
           weights=None,
-          model_cls=None) -> Engine:
+          model_cls=None,
+          mapping: Optional[Mapping] = None) -> Engine:
+    '''@brief: Builds the engine of the rank.
+
+        @param mapping: When set, the checkpoint or the weights are unsharded
+            and they are sliced for this mapping.
+    '''
     if ckpt_dir is not None:
         model_config = PretrainedConfig.from_json_file(
             os.path.join(ckpt_dir, 'config.json'))
@@ -629,6 +848,9 @@ def build(build_config: Union[str, BuildConfig],
             model_config = model_config
         else:
             model_config = PretrainedConfig.from_json_file(model_config)
+    if mapping is not None:
+        model_config = copy.deepcopy(model_config)
+        model_config.mapping = mapping
 
     if isinstance(build_config, str):
         build_config = BuildConfig.from_json_file(build_config)
@@ -643,11 +865,13 @@ def build(build_config: Union[str, BuildConfig],
         model_cls = MODEL_MAP[architecture]
 
     if ckpt_dir is not None:
-        model = model_cls.from_checkpoint(ckpt_dir, rank=rank)
+        model = model_cls.from_checkpoint(ckpt_dir, rank=rank, mapping=mapping)
     else:
         rank_config = copy.deepcopy(model_config)
         rank_config.set_rank(rank)
         model = model_cls.from_config(rank_config)
         if weights is not None:
+            if mapping is not None:
+                weights = model.shard_weights(weights)
             model.load(weights)
     return build_shard_model(model, build_config)
@@ -18,12 +18,13 @@ import time
 from concurrent.futures import ProcessPoolExecutor, wait
 from importlib.machinery import SourceFileLoader
 from multiprocessing import get_context
-from typing import Union
+from typing import Optional, Union
 
 import torch
 
 from ..builder import BuildConfig, build
 from ..logger import logger
+from ..mapping import Mapping
 from ..models import PretrainedConfig
 
 
@@ -117,21 +118,64 @@ def parse_arguments():
     parser.add_argument('--gather_all_token_logits',
                         action='store_true',
                         default=False)
+    parser.add_argument(
+        '--use_refit',
+        action='store_true',
+        default=False,
+        help=
+        'Build refittable engines, whose weights can be loaded from an unsharded checkpoint at runtime.'
+    )
+    parser.add_argument(
+        '--weight_streaming',
+        action='store_true',
+        default=False,
+        help=
+        'Build engines whose weights can be streamed from host memory at runtime, see gpu_weights_percent. Requires TensorRT 10.'
+    )
+    parser.add_argument(
+        '--strip_weights',
+        action='store_true',
+        default=False,
+        help=
+        'Build weightless engines, whose weights are saved to rank<N>.safetensors and refitted when they are loaded. Requires TensorRT 10.'
+    )
+    parser.add_argument(
+        '--tp_size',
+        type=int,
+        default=None,
+        help=
+        'Re-shard an unsharded checkpoint or model config to this tensor parallelism instead of building for its own.'
+    )
+    parser.add_argument(
+        '--pp_size',
+        type=int,
+        default=None,
+        help=
+        'Re-shard an unsharded checkpoint or model config to this pipeline parallelism instead of building for its own.'
+    )
 
     args = parser.parse_args()
 
     return args
 
 
-def build_and_save_shard(rank, gpu_id, ckpt_dir, build_config, output_dir,
-                         log_level, model_config, model_cls):
+def build_and_save_shard(rank,
+                         gpu_id,
+                         ckpt_dir,
+                         build_config,
+                         output_dir,
+                         log_level,
+                         model_config,
+                         model_cls,
+                         mapping=None):
     torch.cuda.set_device(gpu_id)
     logger.set_level(log_level)
     engine = build(build_config,
                    rank,
                    ckpt_dir,
                    model_config,
-                   model_cls=model_cls)
+                   model_cls=model_cls,
+                   mapping=mapping)
     engine.save(output_dir)
 
 
@@ -140,7 +184,8 @@ def build_and_save(ckpt_dir_or_model_config: str,
                    output_dir: str,
                    workers: int = 1,
                    log_level: str = 'info',
-                   model_cls=None):
+                   model_cls=None,
+                   mapping: Optional[Mapping] = None):
     ckpt_dir = ckpt_dir_or_model_config
     if ckpt_dir_or_model_config.lower().endswith('.json'):
         model_config = PretrainedConfig.from_json_file(ckpt_dir_or_model_config)
@@ -148,21 +193,27 @@ def build_and_save(ckpt_dir_or_model_config: str,
     else:
         model_config = PretrainedConfig.from_json_file(
             os.path.join(ckpt_dir_or_model_config, 'config.json'))
+    world_size = model_config.mapping.world_size
+    if mapping is not None:
+        world_size = mapping.world_size
 
     if workers == 1:
-        for rank in range(model_config.mapping.world_size):
+        for rank in range(world_size):
             build_and_save_shard(rank, rank % workers, ckpt_dir, build_config,
-                                 output_dir, log_level, model_config, model_cls)
+                                 output_dir, log_level, model_config, model_cls,
+                                 mapping)
     else:
         with ProcessPoolExecutor(mp_context=get_context('spawn'),
                                  max_workers=workers) as p:
             futures = [
                 p.submit(build_and_save_shard, rank, rank % workers, ckpt_dir,
                          build_config, output_dir, log_level, model_config,
-                         model_cls)
-                for rank in range(model_config.mapping.world_size)
+                         model_cls, mapping) for rank in range(world_size)
             ]
             wait(futures)
+            # A rank that failed to build fails the build
+            for future in futures:
+                future.result()
 
 
 def main():
@@ -199,6 +250,12 @@ def main():
             args.max_prompt_embedding_table_size,
             'gather_all_token_logits':
             args.gather_all_token_logits,
+            'use_refit':
+            args.use_refit,
+            'weight_streaming':
+            args.weight_streaming,
+            'strip_weights':
+            args.strip_weights,
             'plugin_config': {
                 'gpt_attention_plugin': args.use_gpt_attention_plugin,
                 'gemm_plugin': args.use_gemm_plugin,
@@ -213,9 +270,17 @@ def main():
             }
         })
 
+    mapping = None
+    if args.tp_size is not None or args.pp_size is not None:
+        tp_size = args.tp_size or 1
+        pp_size = args.pp_size or 1
+        mapping = Mapping(world_size=tp_size * pp_size,
+                          tp_size=tp_size,
+                          pp_size=pp_size)
+
     source = args.checkpoint_dir if args.checkpoint_dir is not None else args.model_config
     build_and_save(source, build_config, args.output_dir, workers,
-                   args.log_level, model_cls)
+                   args.log_level, model_cls, mapping)
 
     tok = time.time()
     t = time.strftime('%H:%M:%S', time.gmtime(tok - tik))
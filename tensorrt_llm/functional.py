@@ -635,6 +635,26 @@ class AttentionMaskType(IntEnum):
     causal = 1
     bidirectional = 2
     bidirectionalglm = 3  # TODO: merge this mask into bidirectional
+    blocksparse = 4
+
+
+class BlockSparseAttnParams:
+    '''
+    The pattern of AttentionMaskType.blocksparse. Each query attends causally
+    to the num_local_blocks blocks of block_size tokens ending with its own
+    block, and to every vertical_stride-th block before it. Unless
+    homo_head_pattern is set, the vertical blocks are shifted for each head.
+    '''
+
+    def __init__(self,
+                 block_size: int = 64,
+                 homo_head_pattern: bool = False,
+                 num_local_blocks: int = 16,
+                 vertical_stride: int = 8):
+        self.block_size = block_size
+        self.homo_head_pattern = homo_head_pattern
+        self.num_local_blocks = num_local_blocks
+        self.vertical_stride = vertical_stride
 
 
 class LayerNormType(IntEnum):
@@ -1826,7 +1846,11 @@ def softmax(input: Tensor, dim: Optional[int] = None) -> Tensor:
     return _create_tensor(layer.get_output(0), layer)
 
 
-def _lookup_plugin(input: Tensor, weight: Tensor, rank: int) -> Tensor:
+def _lookup_plugin(input: Tensor,
+                   weight: Tensor,
+                   rank: int,
+                   workspace: Optional[Tensor] = None,
+                   instance_id: int = 0) -> Tensor:
     '''
     Add an operation to perform lookup in a tensor.
 
@@ -1847,6 +1871,16 @@ def _lookup_plugin(input: Tensor, weight: Tensor, rank: int) -> Tensor:
         rank :  int
             The mpi rank.
 
+        workspace: Optional[Tensor]
+            The workspace of the custom all-reduce. If set, the lookup
+            combines the shards of the table itself: each rank pushes the rows
+            of its shard to the comm buffers of the other ranks, so the output
+            is complete and no all-reduce is needed.
+
+        instance_id: int
+            See allreduce's documentation for instance_id. Used with the
+            workspace only.
+
     Returns:
         The output tensor of the lookup layer.
     '''
@@ -1862,9 +1896,23 @@ def _lookup_plugin(input: Tensor, weight: Tensor, rank: int) -> Tensor:
     rank = trt.PluginField("rank", np.array([int(rank)], np.int32),
                            trt.PluginFieldType.INT32)
 
-    pfc = trt.PluginFieldCollection([pf_type, rank])
-    lookup_plug = plg_creator.create_plugin("lookup", pfc)
+    pfc = [pf_type, rank]
     plug_inputs = [input.trt_tensor, weight.trt_tensor]
+    if workspace is not None:
+        # The barriers share the flags of the custom all-reduce
+        if not hasattr(allreduce, "ids"):
+            allreduce.ids = set()
+        if instance_id in allreduce.ids:
+            logger.warning(
+                f"Custom allreduce has already used id {instance_id}")
+        allreduce.ids.add(instance_id)
+        pfc.append(
+            trt.PluginField("counter", np.array([instance_id + 1], np.int32),
+                            trt.PluginFieldType.INT32))
+        plug_inputs.append(workspace.trt_tensor)
+
+    pfc = trt.PluginFieldCollection(pfc)
+    lookup_plug = plg_creator.create_plugin("lookup", pfc)
     layer = default_trtnet().add_plugin_v2(plug_inputs, lookup_plug)
     _add_plugin_info(layer, plg_creator, "lookup", pfc)
     return _create_tensor(layer.get_output(0), layer)
@@ -1895,6 +1943,9 @@ def embedding(input: Tensor,
     are not stored on the associated GPU. To compute the final result, a
     parallel all-reduce operation is added to the TensorRT graph. That lookup
     can be performed using either the plugin or the operators TensorRT support.
+    When the plugin is used with the custom all-reduce and all the ranks are on
+    the node, the plugin combines the shards itself instead: each rank only
+    sends the rows of its shard, and nothing is zero-filled or summed.
 
     When'sharding_dim==1', each GPU stores a subset of the embedding table's columns.
     Each rank can obtain a portion of the embedding results.
@@ -1946,8 +1997,15 @@ def embedding(input: Tensor,
                     "Rank cannot be none for tensor parallelism on vocab dim")
 
             if default_net().plugin_config.lookup_plugin:
-                x = _lookup_plugin(input, weight, tp_rank)
-                x = allreduce(x, tp_group, workspace, instance_id)
+                # The workspace holds 3 pointers per rank of the node
+                if default_net().plugin_config.use_custom_all_reduce \
+                        and workspace is not None \
+                        and workspace.shape[0] // 3 == tp_size:
+                    x = _lookup_plugin(input, weight, tp_rank, workspace,
+                                       instance_id)
+                else:
+                    x = _lookup_plugin(input, weight, tp_rank)
+                    x = allreduce(x, tp_group, workspace, instance_id)
             else:
                 shape_weight = shape(weight)
                 vocab_size = slice(shape_weight, starts=[0], sizes=[1])
@@ -1998,6 +2056,115 @@ def embedding(input: Tensor,
     return x
 
 
+def lm_head_topk(hidden: Tensor,
+                 weight: Tensor,
+                 top_k: int,
+                 vocab_size: Optional[int] = None,
+                 full_logits_mask: Optional[Tensor] = None,
+                 tp_group: Optional[List[int]] = None,
+                 tp_rank: int = 0,
+                 chunk_size: int = 16384) -> Tuple[Tensor, ...]:
+    '''
+    Add an LM head that returns the top-k logits of each row and their token
+    ids instead of the logits of the whole vocabulary.
+
+    For greedy (top_k = 1) and top-k decoding, it avoids writing and reading
+    back the [rows, vocab] logits: the GEMM runs on chunks of 'chunk_size'
+    tokens and each chunk is merged into the running candidates. Requests that
+    need the full logits, e.g. for log probs or penalties, are flagged in
+    'full_logits_mask' and get them in an additional output, which is not
+    written for the other rows.
+
+    Parameters:
+        hidden : Tensor
+            The hidden states [..., hidden_size].
+
+        weight : Tensor
+            The weight of the LM head [vocab_size_padded, hidden_size], or its
+            shard along the vocabulary with tensor parallelism.
+
+        top_k : int
+            The number of candidates per row, up to 128.
+
+        vocab_size : Optional[int]
+            The number of tokens of the weight that may be selected, the rest
+            is padding. The whole weight if None. The size of the shard with
+            tensor parallelism.
+
+        full_logits_mask : Optional[Tensor]
+            An int32 tensor of the leading dimensions of 'hidden', non zero for
+            the rows that need the full logits.
+
+        tp_group : Optional[List[int]]
+            The ranks sharing the weight along the vocabulary. The candidates
+            of the shards are gathered and reduced to the top-k of the whole
+            vocabulary.
+
+        tp_rank : int
+            The rank of the shard.
+
+        chunk_size : int
+            The number of tokens of the vocabulary per GEMM.
+
+    Returns:
+        The top-k logits (float32) and token ids (int32) [..., top_k] and, with
+        'full_logits_mask', the logits [..., vocab_size_padded].
+    '''
+    if not default_net().plugin_config.lm_head_topk_plugin:
+        raise TypeError("LM head top-k is only supported with plugin")
+
+    plg_creator = trt.get_plugin_registry().get_plugin_creator(
+        'LmHeadTopK', '1', TRT_LLM_PLUGIN_NAMESPACE)
+    assert plg_creator is not None
+
+    local_vocab_size = weight.shape[0]
+    if vocab_size is None:
+        vocab_size = local_vocab_size
+    p_dtype = default_net().plugin_config.lm_head_topk_plugin
+    pfc = trt.PluginFieldCollection([
+        trt.PluginField("type_id",
+                        np.array([int(str_dtype_to_trt(p_dtype))], np.int32),
+                        trt.PluginFieldType.INT32),
+        trt.PluginField("top_k", np.array([top_k], np.int32),
+                        trt.PluginFieldType.INT32),
+        trt.PluginField("vocab_size", np.array([vocab_size], np.int32),
+                        trt.PluginFieldType.INT32),
+        trt.PluginField("vocab_offset",
+                        np.array([tp_rank * local_vocab_size], np.int32),
+                        trt.PluginFieldType.INT32),
+        trt.PluginField("chunk_size", np.array([chunk_size], np.int32),
+                        trt.PluginFieldType.INT32),
+        trt.PluginField("full_logits",
+                        np.array([int(full_logits_mask is not None)],
+                                 np.int32), trt.PluginFieldType.INT32)
+    ])
+    lm_head_plug = plg_creator.create_plugin("lm_head_topk", pfc)
+    plug_inputs = [hidden.trt_tensor, weight.trt_tensor]
+    if full_logits_mask is not None:
+        plug_inputs.append(full_logits_mask.trt_tensor)
+    layer = default_trtnet().add_plugin_v2(plug_inputs, lm_head_plug)
+    _add_plugin_info(layer, plg_creator, "lm_head_topk", pfc)
+    outputs = [
+        _create_tensor(layer.get_output(i), layer)
+        for i in range(layer.num_outputs)
+    ]
+
+    if tp_group is not None and len(tp_group) > 1:
+        # [..., top_k] -> [..., top_k * tp_size] -> top-k of the candidates
+        logits = allgather(outputs[0], tp_group, gather_dim=-1)
+        ids = allgather(outputs[1], tp_group, gather_dim=-1)
+        topk_layer = default_trtnet().add_topk(
+            logits.trt_tensor, trt.TopKOperation.MAX, top_k,
+            dim_to_trt_axes(logits.ndim() - 1))
+        outputs[0] = _create_tensor(topk_layer.get_output(0), topk_layer)
+        indices = _create_tensor(topk_layer.get_output(1), topk_layer)
+        outputs[1] = gather(ids, dim=ids.ndim() - 1, indices=indices)
+        if full_logits_mask is not None:
+            outputs[2] = allgather(outputs[2], tp_group, gather_dim=-1)
+
+    return tuple(outputs)
+
+
 def constant_to_tensor_(input: Union[Tensor, int, float],
                         dtype: trt.DataType = trt.float32) -> Tensor:
     if isinstance(input, int):
@@ -2805,13 +2972,33 @@ class AllReduceStrategy(IntEnum):
     ONESHOT = 1
     TWOSHOT = 2
     AUTO = 3
+    HIERARCHICAL = 4
+    NVLS = 5
+    LOWLATENCY = 6
 
 
-def allreduce(tensor: Tensor,
-              group: List[int],
-              workspace: Optional[Tensor] = None,
-              instance_id: int = 0,
-              strategy: Optional[AllReduceStrategy] = None) -> Tensor:
+class AllReduceFusionOp(IntEnum):
+    """
+    Warning: actual definition is in cpp/tensorrt_llm/kernels/customAllReduceKernels.h
+             they must be kept in sync
+    """
+    NONE = 0
+    RESIDUAL_RMS_NORM = 1
+
+
+def allreduce(
+    tensor: Tensor,
+    group: List[int],
+    workspace: Optional[Tensor] = None,
+    instance_id: int = 0,
+    strategy: Optional[AllReduceStrategy] = None,
+    fusion_op: AllReduceFusionOp = AllReduceFusionOp.NONE,
+    residual: Optional[Tensor] = None,
+    norm_weight: Optional[Tensor] = None,
+    eps: float = 1e-06,
+    scale: Optional[Tensor] = None,
+    ranks_per_node: Optional[int] = None
+) -> Union[Tensor, Tuple[Tensor, Tensor]]:
     '''
     Add an operation that performs a collective all-reduce.
 
@@ -2842,7 +3029,16 @@ def allreduce(tensor: Tensor,
             When using CUSTOM or AUTO mode, a tensor containing pointers to memory
             visible to all GPUs. It should be 3 poitners per TP rank -
             ptr to data buffer, ptr to barriers in, ptr to barriers out.
-            It must be initialized using IpcMemory class.
+            It must be initialized using IpcMemory class. When the group spans
+            several nodes, only the pointers of the ranks of the node are set
+            and the HIERARCHICAL strategy is used. NVLS reduces through
+            the multicast objects of the NVSwitch (Hopper) and falls back to
+            AUTO when they are not supported. AUTO also selects NVLS instead
+            of ONESHOT and TWOSHOT when they are. LOWLATENCY pushes the
+            data along with the synchronization flags in a single kernel, for
+            messages up to 64KB, and falls back to AUTO for larger ones. AUTO
+            also selects it for these messages, or where the measured
+            strategy table does, unless the normalization is fused.
 
         instance_id: int
             Used for synchronization with CUSTOM or AUTO. Corresponding plugins MUST have the same
@@ -2850,8 +3046,33 @@ def allreduce(tensor: Tensor,
             GPU#1, GPU#2... Also, instance_id MUST be unique per model. There should not be two allreduce instances
             in GPU#0 that have the same id.
 
+        fusion_op: AllReduceFusionOp
+            The operation fused after the all-reduce. With RESIDUAL_RMS_NORM,
+            the residual is added to the reduced tensor and the sum is
+            normalized with a RMSNorm of weight 'norm_weight', in the final
+            reduce stage of the ONESHOT strategy, and in a second kernel
+            otherwise. The last dimension of 'tensor' is the normalized one.
+
+        residual: Optional[Tensor]
+            The residual added to the reduced tensor, with the shape of 'tensor'.
+
+        norm_weight: Optional[Tensor]
+            The gamma of the RMSNorm, of shape [hidden_size].
+
+        eps: float
+            The epsilon of the RMSNorm.
+
+        scale: Optional[Tensor]
+            The per-tensor SmoothQuant scale of the normalized output. If set,
+            the normalized output is quantized to int8.
+
+        ranks_per_node: Optional[int]
+            The number of ranks of the group per node. By default, the plugin
+            counts the ranks sharing the host name of its rank at runtime.
+
     Returns:
-        The tensor produced by that layer.
+        The tensor produced by that layer. With RESIDUAL_RMS_NORM, the tuple
+        of the normalized tensor and the updated residual.
     '''
 
     allreduce_plg_creator = trt.get_plugin_registry().get_plugin_creator(
@@ -2890,15 +3111,139 @@ def allreduce(tensor: Tensor,
                                                     np.int32),
                                 trt.PluginFieldType.INT32)
     pfc.append(p_counter)
+    if ranks_per_node is not None:
+        p_ranks_per_node = trt.PluginField("ranks_per_node",
+                                           np.array([ranks_per_node], np.int32),
+                                           trt.PluginFieldType.INT32)
+        pfc.append(p_ranks_per_node)
+    if fusion_op != AllReduceFusionOp.NONE:
+        assert residual is not None and norm_weight is not None
+        pfc.append(
+            trt.PluginField("fusion_op", np.array([int(fusion_op)], np.int8),
+                            trt.PluginFieldType.INT8))
+        pfc.append(
+            trt.PluginField("eps", np.array([eps], np.float32),
+                            trt.PluginFieldType.FLOAT32))
+        pfc.append(
+            trt.PluginField("quant_output",
+                            np.array([int(scale is not None)], np.int32),
+                            trt.PluginFieldType.INT32))
 
     pfc = trt.PluginFieldCollection(pfc)
     ar_plug = allreduce_plg_creator.create_plugin("allreduce", pfc)
     plug_inputs = [tensor.trt_tensor]
     if strategy != AllReduceStrategy.RING:
         plug_inputs.append(workspace.trt_tensor)
+    if fusion_op != AllReduceFusionOp.NONE:
+        plug_inputs += [residual.trt_tensor, norm_weight.trt_tensor]
+        if scale is not None:
+            plug_inputs.append(scale.trt_tensor)
 
     layer = default_trtnet().add_plugin_v2(plug_inputs, ar_plug)
     _add_plugin_info(layer, allreduce_plg_creator, "allreduce", pfc)
+    if fusion_op != AllReduceFusionOp.NONE:
+        normed = _create_tensor(layer.get_output(0), layer)
+        residual_out = _create_tensor(layer.get_output(1), layer)
+        return normed, residual_out
+    return _create_tensor(layer.get_output(0), layer)
+
+
+def gemm_allreduce(tensor: Tensor,
+                   weight: Tensor,
+                   group: List[int],
+                   num_chunks: int = 4) -> Tensor:
+    '''
+    Add an operation that multiplies 'tensor' by the transpose of 'weight'
+    and all-reduces the product, overlapping the two.
+
+    The rows of the product are split into 'num_chunks' chunks. The NCCL
+    all-reduce of each chunk runs on a separate stream while the GEMM of the
+    next chunk runs, so that only the all-reduce of the last chunk is exposed.
+    It is the GEMM and all-reduce of a tensor parallel row linear layer.
+
+    Parameters:
+        tensor : Tensor
+            The input tensor of shape [..., K].
+
+        weight : Tensor
+            The weight of shape [N, K].
+
+        group : List[int]
+            The ranks participating into the all-reduce operation.
+
+        num_chunks : int
+            The number of chunks the rows of the product are split into.
+
+    Returns:
+        The tensor of shape [..., N] produced by that layer.
+    '''
+    plg_creator = trt.get_plugin_registry().get_plugin_creator(
+        'GemmAllReduce', '1', TRT_LLM_PLUGIN_NAMESPACE)
+    assert plg_creator is not None
+
+    group = trt.PluginField("group", np.array(group, dtype=np.int32),
+                            trt.PluginFieldType.INT32)
+    p_dtype = default_net().plugin_config.nccl_plugin
+    pf_dtype = trt.PluginField(
+        "type_id", np.array([int(str_dtype_to_trt(p_dtype))], np.int32),
+        trt.PluginFieldType.INT32)
+    p_num_chunks = trt.PluginField("num_chunks",
+                                   np.array([num_chunks], np.int32),
+                                   trt.PluginFieldType.INT32)
+    pfc = trt.PluginFieldCollection([group, pf_dtype, p_num_chunks])
+    gemm_ar_plug = plg_creator.create_plugin("gemm_allreduce", pfc)
+    plug_inputs = [tensor.trt_tensor, weight.trt_tensor]
+
+    layer = default_trtnet().add_plugin_v2(plug_inputs, gemm_ar_plug)
+    _add_plugin_info(layer, plg_creator, "gemm_allreduce", pfc)
+    return _create_tensor(layer.get_output(0), layer)
+
+
+def reduce_scatter(tensor: Tensor, group: List[int]) -> Tensor:
+    '''
+    Add an operation that performs a collective reduce-scatter.
+
+    Let's define 'world_size' as the length of the 'group' list. That functions
+    creates a layer to sum 'world_size' tensors distributed amongst the
+    'world_size' participating ranks (one GPU per rank) and to split the sum
+    along the first dimension. The rank of index 'i' in 'group' receives the
+    'i'-th slice.
+
+    That operation is implemented using a plugin that wraps the NCCL
+    reduce-scatter collective operation. See
+    https://docs.nvidia.com/deeplearning/nccl/user-guide/docs/usage/collectives.html#reducescatter
+    for details.
+
+    Parameters:
+        tensor : Tensor
+            The input tensor. Its first dimension must be a multiple of
+            'world_size'.
+
+        group : List[int]
+            The ranks participating into the reduce-scatter operation.
+
+    Returns:
+        The tensor produced by that layer, of first dimension
+        tensor.shape[0] // world_size.
+    '''
+    plg_creator = trt.get_plugin_registry().get_plugin_creator(
+        'ReduceScatter', '1', TRT_LLM_PLUGIN_NAMESPACE)
+    assert plg_creator is not None
+
+    group = trt.PluginField("group", np.array(group, dtype=np.int32),
+                            trt.PluginFieldType.INT32)
+
+    p_dtype = default_net().plugin_config.nccl_plugin
+    pf_type = trt.PluginField(
+        "type_id", np.array([int(str_dtype_to_trt(p_dtype))], np.int32),
+        trt.PluginFieldType.INT32)
+
+    pfc = trt.PluginFieldCollection([group, pf_type])
+    reduce_scatter_plug = plg_creator.create_plugin("reduce_scatter", pfc)
+    plug_inputs = [tensor.trt_tensor]
+
+    layer = default_trtnet().add_plugin_v2(plug_inputs, reduce_scatter_plug)
+    _add_plugin_info(layer, plg_creator, "reduce_scatter", pfc)
     return _create_tensor(layer.get_output(0), layer)
 
 
@@ -3242,6 +3587,7 @@ def gpt_attention(
     host_context_lengths: Optional[Tensor] = None,  # for pad-free input mode
     qkv_bias: Optional[Tensor] = None,
     use_cache: bool = True,
+    block_sparse_params: Optional[BlockSparseAttnParams] = None,
 ) -> Tuple[Tensor, Optional[Tensor]]:
     '''
     Add an operation that performs the multi-head attention in GPT-like models.
@@ -3359,6 +3705,7 @@ def gpt_attention(
                 * tensorrt_llm.layers.AttentionMaskType.causal for GPT,
                 * tensorrt_llm.layers.AttentionMaskType.bidirectional for ChatGLM-6B,
                 * tensorrt_llm.layers.AttentionMaskType.bidirectionalglm for GLM-10B,
+                * tensorrt_llm.layers.AttentionMaskType.blocksparse for block-sparse attention,
 
         alibi_slopes: Tensor
             The ALiBi slopes. The ALiBi bias is computed on-the-fly in the kernel
@@ -3406,6 +3753,10 @@ def gpt_attention(
 
         qkv_bias: Tensor = None,
 
+        block_sparse_params: BlockSparseAttnParams = None
+            The pattern of the blocksparse mask. Required with
+            AttentionMaskType.blocksparse, ignored otherwise,
+
     Returns:
         The tensor produced by that layer.
     '''
@@ -3490,7 +3841,7 @@ def gpt_attention(
                               trt.PluginFieldType.INT32)
     kv_cache_quant_mode_field = trt.PluginField(
         "kv_cache_quant_mode",
-        np.array(np.int8(kv_cache_quant_mode), dtype=np.int32),
+        np.array(np.int32(kv_cache_quant_mode), dtype=np.int32),
         trt.PluginFieldType.INT32)
     paged_kv_cache = trt.PluginField(
         "paged_kv_cache", np.array(paged_kv_cache_flag, dtype=np.int32),
@@ -3524,6 +3875,39 @@ def gpt_attention(
     use_cache_pf = trt.PluginField("use_cache",
                                    np.array([use_cache], dtype=np.int32),
                                    trt.PluginFieldType.INT32)
+    sliding_window_kv_cache = trt.PluginField(
+        "sliding_window_kv_cache",
+        np.array(np.int8(default_net().plugin_config.sliding_window_kv_cache),
+                 dtype=np.int8), trt.PluginFieldType.INT8)
+    assert (block_sparse_params is not None) or (
+        mask_type != AttentionMaskType.blocksparse
+    ), 'block_sparse_params is required by the blocksparse mask'
+    if block_sparse_params is None:
+        block_sparse_params = BlockSparseAttnParams()
+    block_sparse_block_size = trt.PluginField(
+        "block_sparse_block_size",
+        np.array([block_sparse_params.block_size], dtype=np.int32),
+        trt.PluginFieldType.INT32)
+    block_sparse_homo_head_pattern = trt.PluginField(
+        "block_sparse_homo_head_pattern",
+        np.array(np.int8(block_sparse_params.homo_head_pattern),
+                 dtype=np.int8), trt.PluginFieldType.INT8)
+    block_sparse_num_local_blocks = trt.PluginField(
+        "block_sparse_num_local_blocks",
+        np.array([block_sparse_params.num_local_blocks], dtype=np.int32),
+        trt.PluginFieldType.INT32)
+    block_sparse_vertical_stride = trt.PluginField(
+        "block_sparse_vertical_stride",
+        np.array([block_sparse_params.vertical_stride], dtype=np.int32),
+        trt.PluginFieldType.INT32)
+    block_cache_indirection = trt.PluginField(
+        "block_cache_indirection",
+        np.array(np.int8(default_net().plugin_config.block_cache_indirection),
+                 dtype=np.int8), trt.PluginFieldType.INT8)
+    sink_token_length = trt.PluginField(
+        "sink_token_length",
+        np.array([default_net().plugin_config.sink_token_length],
+                 dtype=np.int32), trt.PluginFieldType.INT32)
 
     pfc = trt.PluginFieldCollection([
         nheads, num_kv_heads, head_size, unidirectional, q_scaling,
@@ -3533,7 +3917,10 @@ def gpt_attention(
         context_fmha_type, multi_block_mode, kv_cache_quant_mode_field,
         remove_input_padding, mask_type, paged_kv_cache, tokens_per_block,
         pf_type, max_context_length, qkv_bias_enabled, do_cross_attention_field,
-        max_distance, use_paged_context_fmha_field, use_cache_pf
+        max_distance, use_paged_context_fmha_field, use_cache_pf,
+        sliding_window_kv_cache, block_sparse_block_size,
+        block_sparse_homo_head_pattern, block_sparse_num_local_blocks,
+        block_sparse_vertical_stride, block_cache_indirection, sink_token_length
     ])
 
     attn_plug = attn_plg_creator.create_plugin("causal_attn", pfc)
@@ -4186,3 +4573,45 @@ def lora_plugin(
             _create_tensor(layer.get_output(i), layer)
             for i in range(num_lora_modules)
         ]
+
+
+def grouped_gemm(input: Tensor, weights: List[Tensor]) -> List[Tensor]:
+    '''
+    Add the GEMMs of a shared input by several weights, run in a single
+    CUTLASS grouped GEMM launch. The result is the same as
+
+        [matmul(input, w, transb=True) for w in weights]
+
+    Parameters:
+        input : Tensor
+            The shared input of shape [..., K].
+
+        weights : List[Tensor]
+            The weights, of shapes [N_i, K].
+
+    Returns:
+        The list of the outputs, of shapes [..., N_i].
+    '''
+    if not default_net().plugin_config.grouped_gemm_plugin:
+        raise TypeError("Grouped GEMM is only supported with plugin")
+
+    plg_creator = trt.get_plugin_registry().get_plugin_creator(
+        'GroupedGemm', '1', TRT_LLM_PLUGIN_NAMESPACE)
+    assert plg_creator is not None
+
+    num_gemms = trt.PluginField("num_gemms",
+                                np.array(len(weights), dtype=np.int32),
+                                trt.PluginFieldType.INT32)
+    p_dtype = default_net().plugin_config.grouped_gemm_plugin
+    pf_type = trt.PluginField(
+        "type_id", np.array([int(str_dtype_to_trt(p_dtype))], np.int32),
+        trt.PluginFieldType.INT32)
+    pfc = trt.PluginFieldCollection([num_gemms, pf_type])
+    gemm_plug = plg_creator.create_plugin("grouped_gemm", pfc)
+
+    plug_inputs = [input.trt_tensor] + [w.trt_tensor for w in weights]
+    layer = default_trtnet().add_plugin_v2(plug_inputs, gemm_plug)
+    _add_plugin_info(layer, plg_creator, "grouped_gemm", pfc)
+    return [
+        _create_tensor(layer.get_output(i), layer) for i in range(len(weights))
+    ]
@@ -1,10 +1,16 @@
+import asyncio
+import itertools
+import json
 import logging
 import os
+import tempfile
 import time
+from collections import OrderedDict, deque
 from dataclasses import dataclass, field
 from enum import Enum
 from pathlib import Path
-from typing import Callable, ClassVar, Iterable, List, Optional, Tuple, Union
+from typing import (AsyncIterator, Callable, ClassVar, Dict, Iterable,
+                    Iterator, List, Optional, Tuple, Union)
 
 import torch
 from tqdm import tqdm
@@ -16,11 +22,24 @@ from tensorrt_llm.runtime import (GenerationSession, ModelRunner,
                                   SamplingConfig, model_runner)
 
 
+class RoutingPolicy(Enum):
+    ''' How GptManagerRouter picks the replica of a request.  '''
+    # the most free KV cache blocks, less the ones of the requests waiting for the next iteration
+    KV_CACHE = 0
+    # the fewest unfinished requests
+    QUEUE = 1
+    # the longest prompt prefix sent to the same replica before, whose KV cache blocks may be reused, then KV_CACHE
+    PREFIX = 2
+
+
 @dataclass
 class ParallelConfig:
     ''' The model distribution configs for LLM.  '''
     tp_size: int = 1
     pp_size: int = 1
+    # the number of replicas of the engine run by generate_async in this process, one per GPU
+    dp_size: int = 1
+    routing_policy: RoutingPolicy = RoutingPolicy.KV_CACHE
     devices: List[int] = field(default_factory=list, init=False)
 
     def __post_init__(self):
@@ -188,6 +207,11 @@ class LLM:
     _model_pipeline: List[Tuple[str, Callable]] = field(default_factory=list,
                                                         init=False)
 
+    # the in-flight batching backend of generate_async, started by its first call
+    _async_executor: Optional[Union["GptManagerExecutor",
+                                    "GptManagerRouter"]] = field(default=None,
+                                                                 init=False)
+
     # a cache manager is used to manage the cache of the model formats, like TensorRT-LLM checkpoints or engines.
     # _cache_manager: "CacheManager" = field(default=None, init=False)
 
@@ -346,6 +370,96 @@ class LLM:
             for o in outs:
                 yield o
 
+    async def generate_async(
+        self,
+        prompt: str | TokenIdsTy,
+        streaming: bool = True,
+        sampling_config: Optional[SamplingConfig] = None
+    ) -> AsyncIterator[GenerationOuptut]:
+        ''' Generate the output for a single input in an in-flight batch.
+
+        The concurrent calls are batched together by a C++ GptManager, which needs an engine built with the GPT
+        attention plugin, the paged KV cache and the removed input padding. A request joins the batch as soon as there
+        is room for it, and leaves it as soon as it is finished.
+
+        Args:
+            prompt: The raw text or token ids to the model.
+            streaming: Yield a GenerationOuptut for each piece generated, instead of one for the whole output.
+            sampling_config: The sampling config for the generation, a default one will be used if not provided.
+        '''
+        sampling_config = sampling_config or self.default_sampling_config
+        assert sampling_config is not None, "The sampling_config need to be provided."
+        assert sampling_config.num_beams == 1, "Support beam search later"
+
+        if isinstance(prompt, str):
+            assert self.tokenizer, "The tokenizer is not built or provided."
+            prompt = self.tokenizer.encode(prompt)
+
+        if self._async_executor is None:
+            # the responses are decoded to text in C++ with the tokenizer.json of a HF tokenizer
+            tokenizer_path = Path(self._model_dir) / 'tokenizer.json'
+            if not isinstance(self.tokenizer, TransformersTokenizer
+                              ) or not tokenizer_path.exists():
+                tokenizer_path = None
+            parallel_config = self.config.parallel_config
+            if parallel_config.dp_size > 1:
+                assert parallel_config.tp_size * parallel_config.pp_size == 1, \
+                    "The replicas of generate_async run on a single GPU each"
+                request_ids = itertools.count(1)
+                executors = [
+                    GptManagerExecutor(
+                        self._get_engine_dir(),
+                        max_beam_width=self.config.build_config.max_beam_width,
+                        tokenizer_path=tokenizer_path,
+                        device_ids=[device],
+                        request_ids=request_ids)
+                    for device in range(parallel_config.dp_size)
+                ]
+                self._async_executor = GptManagerRouter(
+                    executors,
+                    policy=parallel_config.routing_policy,
+                    prefix_block_size=self.config.build_config.plugin_config.
+                    tokens_per_block or 64)
+            else:
+                self._async_executor = GptManagerExecutor(
+                    self._get_engine_dir(),
+                    max_beam_width=self.config.build_config.max_beam_width,
+                    tokenizer_path=tokenizer_path)
+        request_id, results = self._async_executor.submit(
+            prompt, sampling_config, streaming)
+
+        token_ids = []
+        text = ""
+        finished = False
+        while not finished:
+            result = await results.get()
+            if isinstance(result, Exception):
+                raise result
+            new_token_ids, new_text, finished = result
+            token_ids += new_token_ids
+            # the text of the new tokens depends on the previous ones, e.g. for the spaces between words
+            if new_text is None and self.tokenizer:
+                full_text = self.tokenizer.decode(token_ids)
+                new_text, text = full_text[len(text):], full_text
+            piece = GenerationPiece(text=new_text, token_ids=new_token_ids)
+            yield GenerationOuptut(request_id=request_id,
+                                   generate_pieces=[piece])
+
+    def shutdown(self):
+        ''' Stop the in-flight batching backend of generate_async, if it was started.  '''
+        if self._async_executor is not None:
+            self._async_executor.shutdown()
+            self._async_executor = None
+
+    def _get_engine_dir(self) -> str:
+        ''' The directory of the engine, which a built engine is saved to the first time.  '''
+        if self._model_format is ModelFormatKind.TLLM_ENGINE:
+            return self._model_dir
+        if getattr(self, "_engine_dir", None) is None:
+            self._engine_dir = tempfile.TemporaryDirectory()
+            self.save(self._engine_dir.name)
+        return self._engine_dir.name
+
     def save(self, engine_dir: str):
         ''' Save the built engine to the given path.  '''
         from tensorrt_llm.builder import Builder
@@ -497,6 +611,243 @@ class LLM:
         raise NotImplementedError()
 
 
+class GptManagerExecutor:
+    ''' Runs the requests submitted from asyncio tasks in the in-flight batch of a C++ GptManager.
+
+    The GptManager calls back from its own thread: it fetches the pending requests at the start of each iteration, and
+    sends the responses of the iteration in a single call, which are passed to the event loop of each request.
+    '''
+
+    def __init__(self,
+                 engine_dir: str,
+                 max_beam_width: int = 1,
+                 max_num_sequences: Optional[int] = None,
+                 tokenizer_path: Optional[Path] = None,
+                 device_ids: Optional[List[int]] = None,
+                 request_ids: Optional[Iterator[int]] = None):
+        import tensorrt_llm.bindings as tllm
+
+        self._pending: deque = deque()
+        # the streaming mode, the input length and the results of each request
+        self._requests: Dict[int, Tuple[bool, int, asyncio.Queue,
+                                        asyncio.AbstractEventLoop]] = {}
+        # shared by the replicas of a GptManagerRouter, for unique ids
+        self._request_ids = request_ids or itertools.count(1)
+        # the input and max new tokens of each request waiting for the next iteration
+        self._pending_tokens: Dict[int, int] = {}
+        # the max, free and tokens per KV cache blocks of the last iteration
+        self._kv_cache_stats: Optional[Tuple[int, int, int]] = None
+
+        optional_params = tllm.TrtGptModelOptionalParams(
+            max_num_sequences=max_num_sequences)
+        if device_ids is not None:
+            optional_params.device_ids = device_ids
+        self._manager = tllm.GptManager(
+            Path(engine_dir),
+            tllm.TrtGptModelType.InflightBatching,
+            max_beam_width,
+            tllm.SchedulerPolicy.MAX_UTILIZATION,
+            self._fetch_requests,
+            None,
+            return_batch_manager_stats_cb=self._handle_stats,
+            optional_params=optional_params,
+            send_responses_cb=self._handle_responses,
+            tokenizer_path=tokenizer_path)
+
+    @property
+    def num_active_requests(self) -> int:
+        ''' The number of requests submitted and not finished yet.  '''
+        return len(self._requests)
+
+    def free_kv_blocks(self) -> Optional[int]:
+        ''' The free KV cache blocks of the last iteration, less the blocks of the requests waiting for the next one.
+
+        None before the stats of the first iteration.
+        '''
+        if self._kv_cache_stats is None:
+            return None
+        max_blocks, free_blocks, tokens_per_block = self._kv_cache_stats
+        # the stats are not sent without active requests, the blocks of the finished ones are free again
+        if not self._requests:
+            return max_blocks
+        pending_tokens = list(self._pending_tokens.values())
+        return free_blocks - sum(
+            (tokens + tokens_per_block - 1) // tokens_per_block
+            for tokens in pending_tokens)
+
+    def submit(self, input_ids: TokenIdsTy, sampling_config: SamplingConfig,
+               streaming: bool) -> Tuple[int, asyncio.Queue]:
+        ''' Queue a request for the next iteration of the GptManager.
+
+        Returns the id of the request, and the queue of its (new token ids, new text, is final) results. The text is
+        None without a tokenizer_path.
+        '''
+        import tensorrt_llm.bindings as tllm
+
+        def to_tensor(value, dtype):
+            if isinstance(value, torch.Tensor):
+                return value.to(dtype).reshape(-1)
+            return torch.tensor([value], dtype=dtype)
+
+        request_id = next(self._request_ids)
+        request = tllm.InferenceRequest(request_id)
+        request.input_ids = torch.tensor(input_ids, dtype=torch.int32)
+        request.max_new_tokens = to_tensor(sampling_config.max_new_tokens,
+                                           torch.int32)
+        request.end_id = to_tensor(sampling_config.end_id, torch.int32)
+        request.pad_id = to_tensor(sampling_config.pad_id, torch.int32)
+        request.beam_width = to_tensor(sampling_config.num_beams, torch.int32)
+        request.temperature = to_tensor(sampling_config.temperature,
+                                        torch.float32)
+        request.runtime_top_k = to_tensor(sampling_config.top_k, torch.int32)
+        request.runtime_top_p = to_tensor(sampling_config.top_p,
+                                          torch.float32)
+        request.length_penalty = to_tensor(sampling_config.length_penalty,
+                                           torch.float32)
+        request.repetition_penalty = to_tensor(
+            sampling_config.repetition_penalty, torch.float32)
+        request.min_length = to_tensor(sampling_config.min_length, torch.int32)
+        request.presence_penalty = to_tensor(sampling_config.presence_penalty,
+                                             torch.float32)
+        request.frequency_penalty = to_tensor(
+            sampling_config.frequency_penalty, torch.float32)
+        if sampling_config.random_seed is not None:
+            request.random_seed = to_tensor(sampling_config.random_seed,
+                                            torch.int64)
+        request.is_streaming = streaming
+
+        max_new_tokens = sampling_config.max_new_tokens
+        if isinstance(max_new_tokens, torch.Tensor):
+            max_new_tokens = int(max_new_tokens.max().item())
+
+        results = asyncio.Queue()
+        self._requests[request_id] = (streaming, len(input_ids), results,
+                                      asyncio.get_running_loop())
+        self._pending_tokens[request_id] = len(input_ids) + max_new_tokens
+        self._pending.append(request)
+        return request_id, results
+
+    def shutdown(self):
+        self._manager.shutdown()
+
+    def _fetch_requests(self, max_num_sequences: int) -> list:
+        fetched = []
+        while self._pending and len(fetched) < max_num_sequences:
+            request = self._pending.popleft()
+            self._pending_tokens.pop(request.request_id, None)
+            fetched.append(request)
+        return fetched
+
+    def _handle_stats(self, stats: str):
+        stats = json.loads(stats)
+        if "Free KV cache blocks" in stats:
+            self._kv_cache_stats = (stats["Max KV cache blocks"],
+                                    stats["Free KV cache blocks"],
+                                    stats["Tokens per KV cache block"])
+
+    def _handle_responses(self, responses: list):
+        for request_id, tensors, is_final, err_msg in responses:
+            if is_final:
+                streaming, input_length, results, loop = self._requests.pop(
+                    request_id)
+            else:
+                streaming, input_length, results, loop = self._requests[
+                    request_id]
+
+            if err_msg:
+                result = RuntimeError(err_msg)
+            else:
+                tensors = {t.name: t.tensor for t in tensors}
+                sequence_length = tensors["sequence_length"][0, 0].item()
+                # the streamed responses hold the new tokens only
+                begin = 0 if streaming else input_length
+                output_ids = tensors["output_ids"][
+                    0, 0, begin:sequence_length].tolist()
+                text = bytes(tensors["output_text"][0].numpy()).decode(
+                ) if "output_text" in tensors else None
+                result = (output_ids, text, is_final)
+            loop.call_soon_threadsafe(results.put_nowait, result)
+
+
+class GptManagerRouter:
+    ''' Dispatches the requests of generate_async to data parallel GptManagerExecutor replicas of one process.
+
+    Each request goes to the replica picked by the RoutingPolicy, from the KV cache stats that the replicas report at
+    the end of their iterations and from the requests submitted since, so that the replicas are balanced on their
+    capacity rather than in turn. The replicas without stats yet come first.
+    '''
+
+    def __init__(self,
+                 executors: List[GptManagerExecutor],
+                 policy: RoutingPolicy = RoutingPolicy.KV_CACHE,
+                 prefix_block_size: int = 64,
+                 max_prefixes: int = 65536):
+        assert executors, "The router needs at least one replica"
+        self._executors = executors
+        self._policy = policy
+        self._prefix_block_size = prefix_block_size
+        self._max_prefixes = max_prefixes
+        # the hashes of the block aligned prompt prefixes sent to each replica, the least recently used first
+        self._prefixes: List[OrderedDict] = [
+            OrderedDict() for _ in executors
+        ]
+
+    def submit(self, input_ids: TokenIdsTy, sampling_config: SamplingConfig,
+               streaming: bool) -> Tuple[int, asyncio.Queue]:
+        ''' Queue a request on the selected replica, see GptManagerExecutor.submit.  '''
+        prefixes = self._prefix_hashes(
+            input_ids) if self._policy is RoutingPolicy.PREFIX else []
+        index = self._select(prefixes)
+        for prefix in prefixes:
+            self._prefixes[index][prefix] = None
+            self._prefixes[index].move_to_end(prefix)
+        while len(self._prefixes[index]) > self._max_prefixes:
+            self._prefixes[index].popitem(last=False)
+        return self._executors[index].submit(input_ids, sampling_config,
+                                             streaming)
+
+    def shutdown(self):
+        for executor in self._executors:
+            executor.shutdown()
+
+    def _prefix_hashes(self, input_ids: TokenIdsTy) -> List[int]:
+        # the hash of each prefix chains the one of the previous block, like the block reuse of the KV cache
+        hashes = []
+        prefix_hash = 0
+        size = self._prefix_block_size
+        for end in range(size, len(input_ids) + 1, size):
+            prefix_hash = hash((prefix_hash, tuple(input_ids[end - size:end])))
+            hashes.append(prefix_hash)
+        return hashes
+
+    def _select(self, prefixes: List[int]) -> int:
+
+        def kv_cache_key(index: int) -> tuple:
+            executor = self._executors[index]
+            free_blocks = executor.free_kv_blocks()
+            if free_blocks is None:
+                return (0, 0, executor.num_active_requests)
+            return (1, -free_blocks, executor.num_active_requests)
+
+        def matched_blocks(index: int) -> int:
+            matched = 0
+            for prefix in prefixes:
+                if prefix not in self._prefixes[index]:
+                    break
+                matched += 1
+            return matched
+
+        indices = range(len(self._executors))
+        if self._policy is RoutingPolicy.QUEUE:
+            return min(
+                indices,
+                key=lambda i: self._executors[i].num_active_requests)
+        if self._policy is RoutingPolicy.PREFIX:
+            return min(indices,
+                       key=lambda i: (-matched_blocks(i), kv_cache_key(i)))
+        return min(indices, key=kv_cache_key)
+
+
 @dataclass
 class CacheManager:
     # TODO[chunweiy]: Add cache manager to manage the cache of the model formats, like TensorRT-LLM checkpoints or engines.
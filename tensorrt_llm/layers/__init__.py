@@ -14,8 +14,8 @@
 # limitations under the License.
 from .activation import Mish
 from .attention import (Attention, AttentionMaskType, AttentionParams,
-                        BertAttention, KeyValueCacheParams,
-                        PositionEmbeddingType)
+                        BertAttention, BlockSparseAttnParams,
+                        KeyValueCacheParams, PositionEmbeddingType)
 from .cast import Cast
 from .conv import Conv1d, Conv2d, ConvTranspose2d
 from .embedding import Embedding, PromptTuningEmbedding
@@ -33,6 +33,7 @@ __all__ = [
     'Linear',
     'RowLinear',
     'AttentionMaskType',
+    'BlockSparseAttnParams',
     'PositionEmbeddingType',
     'Attention',
     'BertAttention',
@@ -20,9 +20,10 @@ import tensorrt as trt
 
 from .._common import default_net, precision
 from .._utils import numpy_fp32_to_bf16, trt_dtype_to_np
-from ..functional import (AttentionMaskType, PositionEmbeddingType,
-                          RotaryScalingType, Tensor, bert_attention, cast, clip,
-                          concat, constant, embedding, expand_dims, expand_mask,
+from ..functional import (AttentionMaskType, BlockSparseAttnParams,
+                          PositionEmbeddingType, RotaryScalingType, Tensor,
+                          bert_attention, cast, clip, concat, constant,
+                          embedding, expand_dims, expand_mask,
                           generate_alibi_biases, generate_alibi_slopes,
                           gpt_attention, matmul, repeat_interleave, round,
                           shape, slice, softmax, split, unsqueeze, view, where)
@@ -375,11 +376,14 @@ class Attention(Module):
         num_buckets=0,
         instance_id: int = 0,
         dense_bias=None,
+        block_sparse_params=None,
+        sequence_parallel: bool = False,
     ):
         super().__init__()
 
         self.cross_attention = cross_attention
         self.attention_mask_type = attention_mask_type
+        self.block_sparse_params = block_sparse_params
         self.attention_head_size = hidden_size // num_attention_heads if attention_head_size is None else attention_head_size
         assert num_attention_heads % tp_size == 0, \
         "num_attention_heads must be divisible by tp_size"
@@ -453,6 +457,8 @@ class Attention(Module):
         # which matches the desired output size (h/tp + 2*kvh/tp) * d after splitting
 
         self.use_fp8_qdq = self.quant_mode.has_fp8_qdq()
+        assert not (self.use_fp8_qdq and sequence_parallel), \
+            "Sequence parallelism is not supported with FP8"
         if self.use_fp8_qdq:
             self.qkv = FP8Linear(
                 hidden_size,
@@ -491,7 +497,8 @@ class Attention(Module):
                                    dtype=dtype,
                                    tp_group=tp_group,
                                    tp_size=tp_size,
-                                   instance_id=instance_id)
+                                   instance_id=instance_id,
+                                   sequence_parallel=sequence_parallel)
 
         if self.unfuse_qkv_gemm:
             linear_class = FP8Linear if self.use_fp8_qdq else ColumnLinear
@@ -690,7 +697,8 @@ class Attention(Module):
         if default_net().plugin_config.gpt_attention_plugin:
             assert self.attention_mask_type in [
                 AttentionMaskType.causal, AttentionMaskType.bidirectional,
-                AttentionMaskType.bidirectionalglm
+                AttentionMaskType.bidirectionalglm,
+                AttentionMaskType.blocksparse
             ], 'Plugin only support masked MHA.'
             kv_orig_quant_scale = self.kv_orig_quant_scale.value if self.quant_mode.has_kv_cache_quant(
             ) else None
@@ -738,11 +746,14 @@ class Attention(Module):
                 max_distance=self.max_distance,
                 host_context_lengths=attention_params.host_context_lengths,
                 use_cache=use_cache,
+                block_sparse_params=self.block_sparse_params,
             )
 
         else:
             # plain TensorRT mode
             assert paged_kv_cache == False
+            assert self.attention_mask_type != AttentionMaskType.blocksparse, \
+                'The blocksparse mask needs the GPT attention plugin'
             past_key_value = None if kv_cache_params is None else kv_cache_params.get_first_past_key_value(
             )
 
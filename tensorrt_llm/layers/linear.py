@@ -20,7 +20,8 @@ import tensorrt as trt
 from .._common import default_net, default_trtnet
 from .._utils import str_dtype_to_trt
 from ..functional import (Tensor, _add_plugin_info, _create_tensor, allgather,
-                          allreduce, cast, matmul)
+                          allreduce, cast, gemm_allreduce, matmul,
+                          reduce_scatter)
 from ..module import Module
 from ..parameter import Parameter
 from ..plugin import TRT_LLM_PLUGIN_NAMESPACE
@@ -154,7 +155,8 @@ class RowLinear(Module):
                  tp_group=None,
                  tp_size=1,
                  instance_id: int = 0,
-                 strict_dtype: bool = False):
+                 strict_dtype: bool = False,
+                 sequence_parallel: bool = False):
         super().__init__()
         self.in_features = in_features // tp_size
         self.out_features = out_features
@@ -171,6 +173,9 @@ class RowLinear(Module):
         self.tp_group = tp_group
         self.tp_size = tp_size
         self.instance_id = instance_id
+        # Reduce-scatter the output along the tokens instead of all-reducing
+        # it, each rank keeps 1/tp_size of the tokens.
+        self.sequence_parallel = sequence_parallel
 
         self.lora = Lora(
             in_hidden_size=self.in_features,
@@ -189,22 +194,34 @@ class RowLinear(Module):
                         workspace=None,
                         lora_runtime_params: LoraRuntimeParams = None):
         hidden_state = x
-        if gemm_plugin:
-            x = _gemm_plugin(x,
-                             weight,
-                             transb=True,
-                             use_fp8=use_fp8,
-                             strict_dtype=self.strict_dtype)
+        use_lora = default_net(
+        ).plugin_config.lora_plugin and lora_runtime_params is not None
+        is_tp = self.tp_size > 1 and self.tp_group is not None
+        gemm_allreduce_chunks = default_net(
+        ).plugin_config.gemm_allreduce_chunks
+        # The LoRA output is added before the all-reduce, and the FP8 GEMM is
+        # not supported by the overlapped GEMM and all-reduce.
+        if is_tp and gemm_allreduce_chunks > 0 and not use_lora and \
+                not use_fp8 and not self.sequence_parallel:
+            x = gemm_allreduce(x, weight, self.tp_group, gemm_allreduce_chunks)
         else:
-            x = matmul(x, weight, transb=True)
-
-        if default_net(
-        ).plugin_config.lora_plugin and lora_runtime_params is not None:
-            x = x + self.lora(hidden_state,
-                              lora_runtime_params=lora_runtime_params)
-
-        if self.tp_size > 1 and self.tp_group is not None:
-            x = allreduce(x, self.tp_group, workspace, self.instance_id)
+            if gemm_plugin:
+                x = _gemm_plugin(x,
+                                 weight,
+                                 transb=True,
+                                 use_fp8=use_fp8,
+                                 strict_dtype=self.strict_dtype)
+            else:
+                x = matmul(x, weight, transb=True)
+
+            if use_lora:
+                x = x + self.lora(hidden_state,
+                                  lora_runtime_params=lora_runtime_params)
+
+            if is_tp and self.sequence_parallel:
+                x = reduce_scatter(x, self.tp_group)
+            elif is_tp:
+                x = allreduce(x, self.tp_group, workspace, self.instance_id)
 
         if self.bias is not None:
             if x.dtype != self.bias.value.dtype:
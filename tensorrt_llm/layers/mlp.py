@@ -14,10 +14,12 @@
 # limitations under the License.
 import numpy as np
 
+from .._common import default_net
 from .._utils import trt_dtype_to_np
-from ..functional import ACT2FN, concat
+from ..functional import ACT2FN, concat, grouped_gemm
 from ..module import Module
 from ..quantization import QuantMode
+from ..quantization.functional import GATED_ACTIVATION_TYPES, gated_activation
 from ..quantization.layers import FP8Linear, FP8RowLinear
 from .linear import ColumnLinear, RowLinear
 from .lora import Lora, LoraRuntimeParams
@@ -34,13 +36,16 @@ class MLP(Module):
                  tp_group=None,
                  tp_size=1,
                  quant_mode=QuantMode(0),
-                 instance_id: int = 0):
+                 instance_id: int = 0,
+                 sequence_parallel: bool = False):
         super().__init__()
         if hidden_act not in ACT2FN:
             raise ValueError(
                 'unsupported activation function: {}'.format(hidden_act))
         fc_output_size = 2 * ffn_hidden_size if hidden_act == 'swiglu' else ffn_hidden_size
         self.use_fp8_qdq = quant_mode.has_fp8_qdq()
+        assert not (self.use_fp8_qdq and sequence_parallel), \
+            "Sequence parallelism is not supported with FP8"
 
         if self.use_fp8_qdq:
             self.fc = FP8Linear(hidden_size,
@@ -71,7 +76,8 @@ class MLP(Module):
                                   dtype=dtype,
                                   tp_group=tp_group,
                                   tp_size=tp_size,
-                                  instance_id=instance_id)
+                                  instance_id=instance_id,
+                                  sequence_parallel=sequence_parallel)
 
         self.hidden_act = hidden_act
         self.dtype = dtype
@@ -107,7 +113,8 @@ class GatedMLP(MLP):
                  tp_group=None,
                  tp_size=1,
                  quant_mode=QuantMode(0),
-                 instance_id: int = 0):
+                 instance_id: int = 0,
+                 sequence_parallel: bool = False):
         self.use_fp8_qdq = quant_mode.has_fp8_qdq()
         super().__init__(hidden_size,
                          ffn_hidden_size,
@@ -117,7 +124,8 @@ class GatedMLP(MLP):
                          tp_group=tp_group,
                          tp_size=tp_size,
                          quant_mode=quant_mode,
-                         instance_id=instance_id)
+                         instance_id=instance_id,
+                         sequence_parallel=sequence_parallel)
 
         self.hidden_size = hidden_size
         self.ffn_hidden_size = ffn_hidden_size
@@ -163,16 +171,41 @@ class GatedMLP(MLP):
             mlp_proj_lora_params = lora_layer_params.get_runtime_params(
                 0, "mlp_4h_to_h")
 
-        inter = self.fc(hidden_states, mlp_fc_lora_params)
-        inter = ACT2FN[self.hidden_act](inter)
-        gate = self.gate(hidden_states, mlp_gate_lora_params)
-        intermediate = inter * gate
+        if self._use_grouped_gemm(lora_layer_params):
+            # fc and gate share the input, run both in one launch
+            inter, gate = grouped_gemm(
+                hidden_states, [self.fc.weight.value, self.gate.weight.value])
+            if self.bias:
+                inter = inter + self.fc.bias.value
+                gate = gate + self.gate.bias.value
+        else:
+            inter = self.fc(hidden_states, mlp_fc_lora_params)
+            gate = self.gate(hidden_states, mlp_gate_lora_params)
+        if default_net().plugin_config.gated_activation_plugin \
+                and self.hidden_act in GATED_ACTIVATION_TYPES:
+            # The activation and the product in one pass
+            intermediate = gated_activation(concat([inter, gate], dim=-1),
+                                            self.hidden_act)
+        else:
+            inter = ACT2FN[self.hidden_act](inter)
+            intermediate = inter * gate
         output = self.proj(intermediate,
                            workspace,
                            lora_runtime_params=mlp_proj_lora_params)
         return output
 
 
+    def _use_grouped_gemm(self, lora_layer_params):
+        # Only the plain fp16/bf16 linears, the grouped GEMM needs 8-element
+        # aligned rows
+        return bool(default_net().plugin_config.grouped_gemm_plugin) \
+            and lora_layer_params is None \
+            and type(self.fc) is ColumnLinear \
+            and type(self.gate) is ColumnLinear \
+            and self.fc.in_features % 8 == 0 \
+            and self.fc.out_features % 8 == 0
+
+
 class FusedGatedMLP(GatedMLP):
 
     def __init__(self,
@@ -184,7 +217,8 @@ class FusedGatedMLP(GatedMLP):
                  tp_group=None,
                  tp_size=1,
                  quant_mode=QuantMode(0),
-                 instance_id: int = 0):
+                 instance_id: int = 0,
+                 sequence_parallel: bool = False):
         super().__init__(hidden_size,
                          ffn_hidden_size,
                          hidden_act,
@@ -193,7 +227,8 @@ class FusedGatedMLP(GatedMLP):
                          tp_group=tp_group,
                          tp_size=tp_size,
                          quant_mode=quant_mode,
-                         instance_id=instance_id)
+                         instance_id=instance_id,
+                         sequence_parallel=sequence_parallel)
 
         self.mlp_in_lora = Lora(
             in_hidden_size=hidden_size,
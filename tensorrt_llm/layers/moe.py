@@ -12,7 +12,7 @@
 # WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 # See the License for the specific language governing permissions and
 # limitations under the License.
-from dataclasses import dataclass
+from dataclasses import dataclass, field
 from enum import IntEnum
 from typing import List
 
@@ -57,12 +57,54 @@ class MoeConfig:
     top_k: int = 0
     tp_mode: ParallelismMode = ParallelismMode.TENSOR_PARALLEL
     normalization_mode: ExpertScaleNormalizationMode = ExpertScaleNormalizationMode.RENORMALIZE
+    # With expert parallelism, send the tokens only to the ranks owning their
+    # experts with an all-to-all instead of running an allreduce on the output
+    all_to_all: bool = False
+    # With all_to_all, return the expert results of each rank while the
+    # experts compute the tokens of the next one
+    overlap_all_to_all: bool = False
+    # With expert parallelism, hot experts copied to all the ranks. Their
+    # tokens are split evenly between the ranks instead of all going to the
+    # rank owning the expert. Each rank holds its own experts followed by the
+    # replicated ones, see Mapping.ep_experts
+    replicated_experts: List[int] = field(default_factory=list)
+    # With weight-only quantization, number of rows of the expert weights
+    # sharing a scale. 0 uses one scale per output channel
+    group_size: int = 0
+
+    # [WARNING] Keep in sync with MOEExpertReplication in moe_kernels.h
+    MAX_REPLICATED_EXPERTS = 16
 
     def validate(self) -> "MoeConfig":
         if (self.num_experts == 0) != (self.top_k == 0):
             raise ValueError(
                 "Both or neither MoeConfig's num_experts and top_k must be set to 0"
             )
+        if (self.all_to_all and
+                self.tp_mode != MoeConfig.ParallelismMode.EXPERT_PARALLEL):
+            raise ValueError(
+                "MoeConfig's all_to_all requires the expert parallel mode")
+        if self.overlap_all_to_all and not self.all_to_all:
+            raise ValueError(
+                "MoeConfig's overlap_all_to_all requires all_to_all")
+        if self.replicated_experts:
+            if (self.tp_mode != MoeConfig.ParallelismMode.EXPERT_PARALLEL
+                    or self.all_to_all):
+                raise ValueError(
+                    "MoeConfig's replicated_experts requires the expert parallel mode without all_to_all"
+                )
+            if len(set(self.replicated_experts)) != len(
+                    self.replicated_experts) or any(
+                        e < 0 or e >= self.num_experts
+                        for e in self.replicated_experts):
+                raise ValueError(
+                    "MoeConfig's replicated_experts must be distinct experts")
+            if len(self.replicated_experts) > self.MAX_REPLICATED_EXPERTS:
+                raise ValueError(
+                    f"MoeConfig supports at most {self.MAX_REPLICATED_EXPERTS} replicated experts"
+                )
+        if self.group_size not in (0, 64, 128):
+            raise ValueError("MoeConfig's group_size must be 0, 64 or 128")
         return self
 
     def has_moe(self) -> bool:
@@ -90,7 +132,8 @@ def _moe_plugin(moe_config,
                 weight_dtype,
                 quant_mode=QuantMode(0),
                 tp_size=1,
-                tp_rank=0):
+                tp_rank=0,
+                ep_group=None):
     if isinstance(dtype, str):
         dtype = str_dtype_to_trt(dtype)
 
@@ -140,12 +183,34 @@ def _moe_plugin(moe_config,
         np.array(moe_config.normalization_mode, dtype=np.int32),
         trt.PluginFieldType.INT32)
 
-    pfc = trt.PluginFieldCollection([
+    plugin_fields = [
         p_num_experts, p_top_k, p_expert_hidden_size, p_expert_inter_size,
         p_activation_type, p_type_id, p_weight_type_id, p_quant_mode,
         p_use_finished, p_use_bias, p_tp_size, p_tp_rank, p_parallelism_mode,
         p_normalization_mode
-    ])
+    ]
+    # The plugin dispatches the tokens with an all-to-all within the group
+    if ep_group is not None:
+        plugin_fields.append(
+            trt.PluginField("ep_group", np.array(ep_group, dtype=np.int32),
+                            trt.PluginFieldType.INT32))
+        if moe_config.overlap_all_to_all:
+            plugin_fields.append(
+                trt.PluginField("overlap_all_to_all",
+                                np.array(1, dtype=np.int32),
+                                trt.PluginFieldType.INT32))
+    if moe_config.replicated_experts and tp_size > 1:
+        plugin_fields.append(
+            trt.PluginField(
+                "replicated_experts",
+                np.array(moe_config.replicated_experts, dtype=np.int32),
+                trt.PluginFieldType.INT32))
+    if moe_config.group_size > 0 and quant_mode.is_weight_only():
+        plugin_fields.append(
+            trt.PluginField("group_size",
+                            np.array(moe_config.group_size, dtype=np.int32),
+                            trt.PluginFieldType.INT32))
+    pfc = trt.PluginFieldCollection(plugin_fields)
 
     # Create the plugin with our constant inputs to the constructor
     plugin_creator = trt.get_plugin_registry().get_plugin_creator(
@@ -217,6 +282,8 @@ class MixtureOfExperts(Module):
                     f"MixtureOfExperts - Number of experts {self.num_experts} is not a multiple of EP size {self.tp_size}"
                 )
             self.experts_per_node = self.experts_per_node // tp_size
+            if self.tp_size > 1:
+                self.experts_per_node += len(moe_config.replicated_experts)
 
         elif moe_config.tp_mode == MoeConfig.ParallelismMode.TENSOR_PARALLEL:
             if self.ffn_hidden_size % self.tp_size != 0:
@@ -261,12 +328,19 @@ class MixtureOfExperts(Module):
             expert_2_shape = (self.experts_per_node, self.ffn_hidden_size,
                               hidden_size // bytes_per_col_scale)
 
-            self.experts_scale_1 = Parameter(shape=(self.experts_per_node,
-                                                    expert_1_out_size),
-                                             dtype=dtype)
-            self.experts_scale_2 = Parameter(shape=(self.experts_per_node,
-                                                    hidden_size),
-                                             dtype=dtype)
+            scale_1_shape = (self.experts_per_node, expert_1_out_size)
+            scale_2_shape = (self.experts_per_node, hidden_size)
+            group_size = moe_config.group_size
+            if group_size > 0:
+                # One row of scales per group of rows of the weights
+                scale_1_shape = (self.experts_per_node,
+                                 hidden_size // group_size, expert_1_out_size)
+                scale_2_shape = (self.experts_per_node,
+                                 self.ffn_hidden_size // group_size,
+                                 hidden_size)
+
+            self.experts_scale_1 = Parameter(shape=scale_1_shape, dtype=dtype)
+            self.experts_scale_2 = Parameter(shape=scale_2_shape, dtype=dtype)
         else:
             self.register_parameter('experts_scale_1', None)
             self.register_parameter('experts_scale_2', None)
@@ -300,6 +374,8 @@ class MixtureOfExperts(Module):
                                   self.router.in_features,
                                   dim=-1)[self.tp_rank]
         routing = self.router(routing_input)
+        use_all_to_all = (self.moe_config.all_to_all and self.tp_size > 1
+                          and self.tp_group is not None)
         output = _moe_plugin(self.moe_config,
                              hidden_states,
                              routing,
@@ -317,9 +393,11 @@ class MixtureOfExperts(Module):
                              weight_dtype=self.weight_dtype,
                              quant_mode=self.quant_mode,
                              tp_size=self.tp_size,
-                             tp_rank=self.tp_rank)
+                             tp_rank=self.tp_rank,
+                             ep_group=self.tp_group if use_all_to_all else None)
 
-        if self.tp_size > 1 and self.tp_group is not None and self.moe_config.tp_mode != MoeConfig.ParallelismMode.NONE:
+        # The all-to-all dispatch already returns the complete output
+        if self.tp_size > 1 and self.tp_group is not None and self.moe_config.tp_mode != MoeConfig.ParallelismMode.NONE and not use_all_to_all:
             output = allreduce(output,
                                self.tp_group,
                                workspace=workspace,
@@ -68,6 +68,14 @@ class Mapping(object):
     def has_tp(self):
         return self.tp_size > 1
 
+    def local_tp_size(self):
+        # The ranks of a tp group spanning several nodes are split between
+        # the nodes in order.
+        return min(self.tp_size, self.gpus_per_node)
+
+    def local_tp_rank(self):
+        return self.tp_rank % self.local_tp_size()
+
     def is_last_pp_rank(self):
         return self.pp_rank == self.pp_size - 1
 
@@ -95,8 +103,13 @@ class Mapping(object):
                              (self.pp_rank + 1) * layers_per_pipeline_stage)
         return list(layers_range)
 
-    def ep_experts(self, num_experts: int) -> List[int]:
+    def ep_experts(self,
+                   num_experts: int,
+                   replicated_experts: List[int] = ()) -> List[int]:
         experts_per_rank = num_experts // self.tp_size
         experts_range = range(self.tp_rank * experts_per_rank,
                               (self.tp_rank + 1) * experts_per_rank)
+        # The replicated experts are held by all the ranks after their own
+        if self.tp_size > 1:
+            return list(experts_range) + list(replicated_experts)
         return list(experts_range)
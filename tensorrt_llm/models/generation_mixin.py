@@ -541,6 +541,18 @@ class GenerationMixin:
                     ('batch_size_last_token_ids', bbd_range),
                 ]),
             )
+        elif mapping.is_last_pp_rank() and remove_input_padding:
+            # The hidden states are still gathered before the LM head, the
+            # runtime passes the positions of all the tokens only for the
+            # requests that return their context logits.
+            last_token_ids = Tensor(
+                name='last_token_ids',
+                dtype=trt.int32,
+                shape=[-1],
+                dim_range=OrderedDict([
+                    ('num_last_token_ids', num_tokens_range),
+                ]),
+            )
 
         basic_inputs = {
             'input_ids': input_ids,
@@ -389,7 +389,8 @@ class GPTLMHeadModel(GPTModel, GenerationMixin):
                  use_parallel_embedding=False,
                  embedding_sharding_dim=0,
                  moe_config=MoeConfig(),
-                 share_embedding_table=False):
+                 share_embedding_table=False,
+                 output_hidden_states=False):
 
         if isinstance(dtype, str):
             self._kv_dtype = str_dtype_to_trt(dtype)
@@ -423,6 +424,9 @@ class GPTLMHeadModel(GPTModel, GenerationMixin):
         self._vocab_size = vocab_size
         self._tp_size = mapping.tp_size
         self._num_kv_heads = num_kv_heads if num_kv_heads else num_heads
+        # Skip the LM head and return the hidden states of all the tokens,
+        # which the runtime pools into embeddings (GptSession::encode).
+        self._output_hidden_states = output_hidden_states
 
         super().__init__(
             num_layers=num_layers,
@@ -486,22 +490,28 @@ class GPTLMHeadModel(GPTModel, GenerationMixin):
         if use_cache:
             hidden_states, presents = hidden_states
 
-        hidden_states = gather_last_token_logits(
-            hidden_states, last_token_ids,
-            default_net().plugin_config.remove_input_padding)
+        if self._output_hidden_states:
+            # [num_tokens, hidden_size] or [batch_size, seq_len, hidden_size]
+            hidden_states.mark_output('hidden_states_output', self._dtype)
+            outputs = hidden_states
+        else:
+            hidden_states = gather_last_token_logits(
+                hidden_states, last_token_ids,
+                default_net().plugin_config.remove_input_padding)
 
-        # [batch_size, hidden_size] -> [batch_size, vocab_size]
-        lm_logits = self.lm_head(hidden_states)
-        lm_logits.mark_output('logits', self._logits_dtype)
+            # [batch_size, hidden_size] -> [batch_size, vocab_size]
+            lm_logits = self.lm_head(hidden_states)
+            lm_logits.mark_output('logits', self._logits_dtype)
+            outputs = lm_logits
 
         if use_cache:
             if default_net().plugin_config.paged_kv_cache == False:
                 for i, present in enumerate(presents):
                     present.mark_output(f'present_key_value_{i}',
                                         self._kv_dtype)
-            return (lm_logits, presents)
+            return (outputs, presents)
 
-        return lm_logits
+        return outputs
 
     def prepare_inputs(self,
                        max_batch_size,
@@ -14,12 +14,14 @@
 # limitations under the License.
 from typing import List, Optional
 
+import numpy as np
 import tensorrt as trt
 
 from ..._common import default_net
-from ..._utils import pad_vocab_size, str_dtype_to_trt
-from ...functional import (RotaryScalingType, Tensor, gather_last_token_logits,
-                           recv, send)
+from ..._utils import pad_vocab_size, str_dtype_to_trt, trt_dtype_to_np
+from ...functional import (RotaryScalingType, Tensor, allgather, concat,
+                           constant, expand, gather_last_token_logits, recv,
+                           send, shape, slice)
 from ...layers import (MOE, Attention, AttentionMaskType, AttentionParams,
                        ColumnLinear, Embedding, FusedGatedMLP, GatedMLP,
                        KeyValueCacheParams, LoraParams, MoeConfig,
@@ -28,11 +30,43 @@ from ...mapping import Mapping
 from ...module import Module, ModuleList, TopLevelModuleMixin
 from ...parameter import Parameter
 from ...quantization import QuantMode
-from ...quantization.layers import FP8Linear, FP8RowLinear
+from ...quantization.layers import FP8Linear, FP8RowLinear, SmoothQuantMLP
 from ..generation_mixin import GenerationMixin
 from ..modeling_utils import PretrainedConfig
 
 
+def split_tokens(hidden_states: Tensor, mapping: Mapping) -> Tensor:
+    '''
+    Keeps the slice of the tokens of the TP rank for sequence parallelism. The
+    tokens are padded to a multiple of the TP size first.
+    '''
+    tp_size = mapping.tp_size
+    num_tokens = shape(hidden_states, 0)
+    hidden_size = shape(hidden_states, 1)
+    tokens_per_rank = (num_tokens + (tp_size - 1)) / tp_size
+    zeros = constant(
+        np.zeros([1, hidden_states.size(-1)],
+                 dtype=trt_dtype_to_np(hidden_states.dtype)))
+    padding = expand(
+        zeros, concat([tokens_per_rank * tp_size - num_tokens, hidden_size]))
+    hidden_states = concat([hidden_states, padding], dim=0)
+    return slice(hidden_states,
+                 starts=concat([tokens_per_rank * mapping.tp_rank, 0]),
+                 sizes=concat([tokens_per_rank, hidden_size]))
+
+
+def gather_tokens(hidden_states: Tensor, num_tokens: Tensor,
+                  mapping: Mapping) -> Tensor:
+    '''
+    Gathers the slices of split_tokens from all the TP ranks and removes the
+    padding.
+    '''
+    hidden_states = allgather(hidden_states, mapping.tp_group)
+    return slice(hidden_states,
+                 starts=[0, 0],
+                 sizes=concat([num_tokens, shape(hidden_states, 1)]))
+
+
 class LLaMADecoderLayer(Module):
 
     def __init__(self,
@@ -57,7 +91,8 @@ class LLaMADecoderLayer(Module):
                  attn_bias=False,
                  mlp_bias=False,
                  use_fused_mlp=False,
-                 moe_config: MoeConfig = MoeConfig()):
+                 moe_config: MoeConfig = MoeConfig(),
+                 sequence_parallel=False):
         super().__init__()
         self._layer_id = layer_id  # useful for debugging
         # used for quantizing model
@@ -72,6 +107,10 @@ class LLaMADecoderLayer(Module):
         self.mlp_hidden_size = mlp_hidden_size
         self.attention_mask_type = attention_mask_type
         self.position_embedding_type = position_embedding_type
+        # The layer gets and returns 1/tp_size of the tokens. The norms and the
+        # residuals run on the slice, the attention and the MLP on all the
+        # tokens, gathered from the other ranks.
+        self.sequence_parallel = sequence_parallel and tp_size > 1
         self.input_layernorm = RmsNorm(normalized_shape=hidden_size,
                                        eps=rms_norm_eps,
                                        dtype=dtype)
@@ -92,13 +131,16 @@ class LLaMADecoderLayer(Module):
             use_auto_parallel=use_auto_parallel,
             quant_mode=quant_mode,
             instance_id=2 * layer_id,
+            sequence_parallel=self.sequence_parallel,
         )
         if not mlp_hidden_size:
             self.mlp_hidden_size = hidden_size * 4
 
         ClsMLP = GatedMLP
-        mlp_kwargs = {}
+        mlp_kwargs = {"sequence_parallel": self.sequence_parallel}
         if moe_config.has_moe():
+            assert not self.sequence_parallel, \
+                "Sequence parallelism is not supported with MoE"
             ClsMLP = MOE
             mlp_kwargs = {
                 "moe_config": moe_config,
@@ -132,6 +174,8 @@ class LLaMADecoderLayer(Module):
         hidden_states = self.input_layernorm(hidden_states)
         if self._layer_id == 0:
             self.register_network_output(f"norm0", hidden_states)
+        if self.sequence_parallel:
+            hidden_states = allgather(hidden_states, self.tp_group)
 
         attention_output = self.attention(hidden_states,
                                           attention_mask=attention_mask,
@@ -152,14 +196,23 @@ class LLaMADecoderLayer(Module):
         hidden_states = self.post_layernorm(hidden_states)
         if self._layer_id == 0:
             self.register_network_output(f"norm1", hidden_states)
+        if self.sequence_parallel:
+            hidden_states = allgather(hidden_states, self.tp_group)
+
+        if isinstance(self.mlp, SmoothQuantMLP):
+            # The residual is added in the epilogue of the proj GEMM
+            hidden_states = self.mlp(hidden_states,
+                                     all_reduce_workspace,
+                                     lora_layer_params=lora_layer_params,
+                                     residual=residual)
+        else:
+            hidden_states = self.mlp(hidden_states,
+                                     all_reduce_workspace,
+                                     lora_layer_params=lora_layer_params)
+            if self._layer_id == 0:
+                self.register_network_output(f"mlp", hidden_states)
 
-        hidden_states = self.mlp(hidden_states,
-                                 all_reduce_workspace,
-                                 lora_layer_params=lora_layer_params)
-        if self._layer_id == 0:
-            self.register_network_output(f"mlp", hidden_states)
-
-        hidden_states = residual + hidden_states
+            hidden_states = residual + hidden_states
         if use_cache:
             return (hidden_states, presents)
         return hidden_states
@@ -190,10 +243,12 @@ class LLaMAModel(Module):
                  attn_bias=False,
                  mlp_bias=False,
                  moe_config: MoeConfig = MoeConfig(),
-                 use_prompt_tuning: bool = False):
+                 use_prompt_tuning: bool = False,
+                 sequence_parallel: bool = False):
         super().__init__()
         self.mapping = mapping
         self.use_prompt_tuning = use_prompt_tuning
+        self.sequence_parallel = sequence_parallel and mapping.tp_size > 1
 
         EmbeddingCls = PromptTuningEmbedding if use_prompt_tuning else Embedding
         if self.mapping.is_first_pp_rank():
@@ -232,6 +287,7 @@ class LLaMAModel(Module):
                 mlp_bias=mlp_bias,
                 use_fused_mlp=use_fused_mlp,
                 moe_config=moe_config,
+                sequence_parallel=self.sequence_parallel,
             ) for i in self.mapping.pp_layers(num_layers)
         ])
 
@@ -271,6 +327,11 @@ class LLaMAModel(Module):
             hidden_states = recv(hidden_states, self.mapping.prev_pp_rank())
         self.register_network_output(f"embd", hidden_states)
 
+        if self.sequence_parallel:
+            # The pipeline stages exchange all the tokens
+            num_tokens = shape(hidden_states, 0)
+            hidden_states = split_tokens(hidden_states, self.mapping)
+
         for layer_idx, (
                 layer, past, pointer, host_pointer,
                 max_attention_window_size) in enumerate(
@@ -304,7 +365,13 @@ class LLaMAModel(Module):
 
         if self.mapping.is_last_pp_rank():
             hidden_states = self.ln_f(hidden_states)
+            if self.sequence_parallel:
+                hidden_states = gather_tokens(hidden_states, num_tokens,
+                                              self.mapping)
         else:
+            if self.sequence_parallel:
+                hidden_states = gather_tokens(hidden_states, num_tokens,
+                                              self.mapping)
             hidden_states = send(hidden_states, self.mapping.next_pp_rank())
 
         if use_cache:
@@ -338,7 +405,8 @@ class LLaMAForCausalLM(LLaMAModel, GenerationMixin, TopLevelModuleMixin):
                  attn_bias=False,
                  mlp_bias=False,
                  moe_config=MoeConfig(),
-                 use_prompt_tuning: bool = False):
+                 use_prompt_tuning: bool = False,
+                 sequence_parallel: bool = False):
         config = PretrainedConfig(
             architecture="LLaMAForCausalLM",
             dtype=dtype,
@@ -404,7 +472,7 @@ class LLaMAForCausalLM(LLaMAModel, GenerationMixin, TopLevelModuleMixin):
                          rotary_scaling, mapping, use_auto_parallel, quant_mode,
                          use_parallel_embedding, embedding_sharding_dim,
                          rms_norm_eps, use_fused_mlp, attn_bias, mlp_bias,
-                         moe_config, use_prompt_tuning)
+                         moe_config, use_prompt_tuning, sequence_parallel)
 
         vocab_size_padded = pad_vocab_size(vocab_size, mapping.tp_size)
         if self.mapping.is_last_pp_rank():
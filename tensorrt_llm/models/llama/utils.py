@@ -1,6 +1,8 @@
 import re
+from collections import deque
+from concurrent.futures import ThreadPoolExecutor
 from pathlib import Path
-from typing import Dict, Optional, Union
+from typing import Callable, Dict, Optional, Union
 
 import torch
 
@@ -9,6 +11,7 @@ def load_state_dict(
     file_path: Union[str, Path],
     dtype: torch.dtype,
     device: Optional[Union[str, torch.device]] = None,
+    name_filter: Optional[Callable[[str], bool]] = None,
 ) -> Dict[str, torch.Tensor]:
     """ Load weights from model file
 
@@ -18,6 +21,8 @@ def load_state_dict(
         file_path: model file path, ends with .bin or .safetensors.
         dtype: torch.dtype, data type.
         device: torch device like, optional. If None, load to cpu.
+        name_filter: callable, optional. The weights whose name it returns
+            False for are skipped, they are not read from a safetensors file.
     # Returns.
         Dict[str, torch.Tensor]
     """
@@ -33,11 +38,18 @@ def load_state_dict(
         from safetensors import safe_open
         with safe_open(file_path, framework='pt', device=device) as f:
             for name in f.keys():
-                model_params[name] = f.get_tensor(name).to(dtype).clone()
+                if name_filter is not None and not name_filter(name):
+                    continue
+                param = f.get_tensor(name)
+                # to() already copies when the dtype differs
+                model_params[name] = param.to(
+                    dtype) if param.dtype != dtype else param.clone()
     elif file_path.suffix == '.bin':
         # load from pytorch bin file
         state_dict = torch.load(file_path, map_location=device)
         for name in state_dict:
+            if name_filter is not None and not name_filter(name):
+                continue
             model_params[name] = state_dict[name].to(dtype)
     else:
         raise NotImplementedError(
@@ -81,3 +93,42 @@ def iterate_shard_files(model_dir: Union[Path, str],
 
     for shard_file in shard_files:
         yield shard_file
+
+
+def iterate_state_dicts(model_dir: Union[Path, str],
+                        dtype: torch.dtype,
+                        rank: int = 0,
+                        num_workers: int = 1,
+                        name_filter: Optional[Callable[[str], bool]] = None):
+    """ Load the shard files of a model directory in order
+
+    With num_workers > 1, up to num_workers shards are read ahead on as many
+    threads while the caller converts the current one. Reading safetensors and
+    casting the tensors release the GIL, so the reads overlap each other and
+    the conversion. At most num_workers + 1 shards are in memory.
+
+    # Yields.
+        (Path, Dict[str, torch.Tensor]) of each shard file.
+    """
+    shard_files = iterate_shard_files(model_dir, rank, progress_bar=False)
+    if num_workers <= 1:
+        for shard_file in shard_files:
+            yield shard_file, load_state_dict(shard_file,
+                                              dtype,
+                                              name_filter=name_filter)
+        return
+
+    with ThreadPoolExecutor(max_workers=num_workers) as executor:
+        pending = deque()
+        for shard_file in shard_files:
+            pending.append((shard_file,
+                            executor.submit(load_state_dict,
+                                            shard_file,
+                                            dtype,
+                                            name_filter=name_filter)))
+            if len(pending) > num_workers:
+                shard_file, future = pending.popleft()
+                yield shard_file, future.result()
+        while pending:
+            shard_file, future = pending.popleft()
+            yield shard_file, future.result()
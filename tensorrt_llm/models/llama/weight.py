@@ -13,7 +13,9 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 import configparser
+import threading
 import time
+from concurrent.futures import ThreadPoolExecutor
 from pathlib import Path
 from typing import Dict, List, Optional, Union
 
@@ -31,8 +33,7 @@ from tensorrt_llm.models.quantized.quant import get_dummy_quant_scales
 from tensorrt_llm.quantization import QuantMode
 from tensorrt_llm.runtime.lora_manager import LoraConfig
 
-from .utils import (iterate_shard_files, load_state_dict,
-                    retrieved_layer_index_from_name)
+from .utils import iterate_state_dicts, retrieved_layer_index_from_name
 
 
 def get_scaling_factors(
@@ -169,6 +170,25 @@ def dup_kv_weight(v, num_head, tp_size):
     return v.reshape(num_head * reps * head_size, -1).clone().detach()
 
 
+def groupwise_quantize_batched_matrix(weight, quant_type, group_size):
+    """Symmetric quantization of [experts, k, n] weights with one scale per
+    group of group_size rows. Returns the weights preprocessed for the MoE
+    GEMM and the [experts, k // group_size, n] scales."""
+    num_experts, k, n = weight.shape
+    grouped = weight.float().reshape(num_experts, k // group_size, group_size,
+                                     n)
+    qmax = 7 if quant_type == torch.quint4x2 else 127
+    scales = grouped.abs().amax(dim=2).clamp(min=1e-8) / qmax
+    qweight = torch.clamp(torch.round(grouped / scales.unsqueeze(2)),
+                          -qmax - 1, qmax).char().reshape(num_experts, k, n)
+    if quant_type == torch.quint4x2:
+        qweight = torch.ops.fastertransformer.pack_int8_tensor_to_packed_int4(
+            qweight)
+    qweight = torch.ops.fastertransformer.preprocess_weights_for_mixed_gemm(
+        qweight, quant_type)
+    return qweight, scales.to(weight.dtype)
+
+
 def parse_bin_config(ini_file):
     gpt_config = configparser.ConfigParser()
     gpt_config.read(ini_file)
@@ -237,7 +257,8 @@ def load_from_hf_llama(tensorrt_llm_llama: tensorrt_llm.models.LLaMAForCausalLM,
 
         rank_experts = list(range(moe_config.num_experts))
         if moe_config.tp_mode == moe_config.ParallelismMode.EXPERT_PARALLEL:
-            rank_experts = mapping.ep_experts(moe_config.num_experts)
+            rank_experts = mapping.ep_experts(moe_config.num_experts,
+                                              moe_config.replicated_experts)
         for suffix in ["w1", "w2", "w3"]:
             model_params[f'model.layers.{l}.block_sparse_moe.experts.{suffix}.weight'] = \
                 torch.stack(list(model_params[f'model.layers.{l}.block_sparse_moe.experts.{expert}.{suffix}.weight']
@@ -427,9 +448,16 @@ def load_from_hf_llama(tensorrt_llm_llama: tensorrt_llm.models.LLaMAForCausalLM,
                 if use_weight_only:
                     v = np.ascontiguousarray(
                         np.transpose(split_v, axes=(0, 2, 1)))
-                    processed_torch_weights, torch_weight_scales = \
-                        torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
-                            torch.tensor(v), plugin_weight_only_quant_type)
+                    group_size = tensorrt_llm_llama.moe_config.group_size
+                    if group_size > 0:
+                        processed_torch_weights, torch_weight_scales = \
+                            groupwise_quantize_batched_matrix(
+                                torch.tensor(v), plugin_weight_only_quant_type,
+                                group_size)
+                    else:
+                        processed_torch_weights, torch_weight_scales = \
+                            torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
+                                torch.tensor(v), plugin_weight_only_quant_type)
                     dst.value = processed_torch_weights
                     tensorrt_llm_llama.layers[
                         idx].mlp.experts_scale_2.value = torch_weight_scales
@@ -442,9 +470,16 @@ def load_from_hf_llama(tensorrt_llm_llama: tensorrt_llm.models.LLaMAForCausalLM,
                 if use_weight_only:
                     v = np.ascontiguousarray(
                         np.transpose(split_v, axes=(0, 2, 1)))
-                    processed_torch_weights, torch_weight_scales = \
-                        torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
-                            torch.tensor(v), plugin_weight_only_quant_type)
+                    group_size = tensorrt_llm_llama.moe_config.group_size
+                    if group_size > 0:
+                        processed_torch_weights, torch_weight_scales = \
+                            groupwise_quantize_batched_matrix(
+                                torch.tensor(v), plugin_weight_only_quant_type,
+                                group_size)
+                    else:
+                        processed_torch_weights, torch_weight_scales = \
+                            torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
+                                torch.tensor(v), plugin_weight_only_quant_type)
                     dst.value = processed_torch_weights
                     tensorrt_llm_llama.layers[
                         idx].mlp.experts_scale_1.value = torch_weight_scales
@@ -531,6 +566,7 @@ def load_from_hf_checkpoint(
         mapping=Mapping(),
         dtype: Union[str, torch.dtype] = torch.float32,
         lora_config=LoraConfig(),
+        num_workers: int = 1,
 ):
     tensorrt_llm.logger.info('Loading weights from HF LLaMA...')
     tik = time.time()
@@ -556,102 +592,122 @@ def load_from_hf_checkpoint(
 
     qkv_weight_helper = QkvWeightHelper(tensorrt_llm_llama)
 
-    for model_file in iterate_shard_files(model_dir,
-                                          rank=mapping.tp_rank,
-                                          progress_bar=False):
-        logger.debug(f'Loading file {str(model_file)}...')
-        model_params = load_state_dict(model_file, dtype=dtype)
-        for name, param in model_params.items():
-            logger.debug(f'Converting weight {name}...')
-            i = retrieved_layer_index_from_name(name)
-            if i is None:
-                layer = None
-            else:
-                if i not in layers_range:
-                    continue
-                layer = tensorrt_llm_llama.layers[i - layers_range[0]]
-
-            if 'model.embed_tokens.weight' in name:
-                if lora_config.is_valid and lora_config.embedding_weight is not None:
-                    param = lora_config.embedding_weight.to(dtype)
-                if hf_config.tie_word_embeddings:
-                    # lm_head.weight has the same weights as embedding
-                    if mapping.is_last_pp_rank():
-                        tensorrt_llm_llama.lm_head.weight.value = split(
-                            param, mapping.tp_size, mapping.tp_rank)
-                if tensorrt_llm_llama.use_parallel_embedding:
-                    param = split(param, mapping.tp_size, mapping.tp_rank,
-                                  tensorrt_llm_llama.embedding_sharding_dim)
-                if mapping.is_first_pp_rank():
-                    tensorrt_llm_llama.vocab_embedding.weight.value = param
-            elif 'model.norm.weight' in name:
-                if mapping.is_last_pp_rank():
-                    tensorrt_llm_llama.ln_f.weight.value = param
-            elif 'lm_head.weight' in name:
-                if lora_config.is_valid and lora_config.lm_head_weight is not None:
-                    param = lora_config.lm_head_weight.to(dtype)
+    def is_loaded(name):
+        # The layers of the other pipeline stages are not read
+        i = retrieved_layer_index_from_name(name)
+        return i is None or i in layers_range
+
+    def convert(name, param):
+        logger.debug(f'Converting weight {name}...')
+        i = retrieved_layer_index_from_name(name)
+        if i is None:
+            layer = None
+        else:
+            if i not in layers_range:
+                return
+            layer = tensorrt_llm_llama.layers[i - layers_range[0]]
+
+        if 'model.embed_tokens.weight' in name:
+            if lora_config.is_valid and lora_config.embedding_weight is not None:
+                param = lora_config.embedding_weight.to(dtype)
+            if hf_config.tie_word_embeddings:
+                # lm_head.weight has the same weights as embedding
                 if mapping.is_last_pp_rank():
                     tensorrt_llm_llama.lm_head.weight.value = split(
                         param, mapping.tp_size, mapping.tp_rank)
-            elif 'input_layernorm.weight' in name:
-                layer.input_layernorm.weight.value = param
-            elif 'post_attention_layernorm.weight' in name:
-                layer.post_layernorm.weight.value = param
-            elif qkv_weight_helper.is_qkv_weight(name):
+            if tensorrt_llm_llama.use_parallel_embedding:
+                param = split(param, mapping.tp_size, mapping.tp_rank,
+                              tensorrt_llm_llama.embedding_sharding_dim)
+            if mapping.is_first_pp_rank():
+                tensorrt_llm_llama.vocab_embedding.weight.value = param
+        elif 'model.norm.weight' in name:
+            if mapping.is_last_pp_rank():
+                tensorrt_llm_llama.ln_f.weight.value = param
+        elif 'lm_head.weight' in name:
+            if lora_config.is_valid and lora_config.lm_head_weight is not None:
+                param = lora_config.lm_head_weight.to(dtype)
+            if mapping.is_last_pp_rank():
+                tensorrt_llm_llama.lm_head.weight.value = split(
+                    param, mapping.tp_size, mapping.tp_rank)
+        elif 'input_layernorm.weight' in name:
+            layer.input_layernorm.weight.value = param
+        elif 'post_attention_layernorm.weight' in name:
+            layer.post_layernorm.weight.value = param
+        elif qkv_weight_helper.is_qkv_weight(name):
+            # The Q, K and V weights of a layer are fused by the thread that
+            # converts the last of them
+            with qkv_lock:
                 qkv_weight_helper.add_weight(i, name, param)
                 if not qkv_weight_helper.is_qkv_prepared(i):
-                    continue
+                    return
                 split_v = qkv_weight_helper.split_qkv_weights(i)
-                if use_weight_only:
-                    param = split_v.transpose()
-                    processed_torch_weights, torch_weight_scales = \
-                        torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
-                            param, plugin_weight_only_quant_type)
-                    layer.attention.qkv.weight.value = processed_torch_weights
-                    layer.attention.qkv.per_channel_scale.value = torch_weight_scales
-                else:
-                    layer.attention.qkv.weight.value = split_v
-            elif 'self_attn.o_proj.weight' in name:
-                split_v = split(param, mapping.tp_size, mapping.tp_rank, dim=1)
-                if use_weight_only:
-                    processed_torch_weights, torch_weight_scales = \
-                        torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
-                            split_v.transpose(), plugin_weight_only_quant_type)
-                    layer.attention.dense.weight.value = processed_torch_weights
-                    layer.attention.dense.per_channel_scale.value = torch_weight_scales
-                else:
-                    layer.attention.dense.weight.value = split_v
-            elif 'mlp.up_proj.weight' in name:
-                split_v = split(param, mapping.tp_size, mapping.tp_rank, dim=0)
-                if use_weight_only:
-                    processed_torch_weights, torch_weight_scales = \
-                        torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
-                            split_v.transpose(), plugin_weight_only_quant_type)
-                    layer.mlp.gate.weight.value = processed_torch_weights
-                    layer.mlp.gate.per_channel_scale.value = torch_weight_scales
-                else:
-                    layer.mlp.gate.weight.value = split_v
-            elif 'mlp.down_proj.weight' in name:
-                split_v = split(param, mapping.tp_size, mapping.tp_rank, dim=1)
-                if use_weight_only:
-                    processed_torch_weights, torch_weight_scales = \
-                        torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
-                            split_v.transpose(), plugin_weight_only_quant_type)
-                    layer.mlp.proj.weight.value = processed_torch_weights
-                    layer.mlp.proj.per_channel_scale.value = torch_weight_scales
-                else:
-                    layer.mlp.proj.weight.value = split_v
-            elif 'mlp.gate_proj.weight' in name:
-                split_v = split(param, mapping.tp_size, mapping.tp_rank, dim=0)
-                if use_weight_only:
-                    processed_torch_weights, torch_weight_scales = \
-                        torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
-                            split_v.transpose(), plugin_weight_only_quant_type)
-                    layer.mlp.fc.weight.value = processed_torch_weights
-                    layer.mlp.fc.per_channel_scale.value = torch_weight_scales
-                else:
-                    layer.mlp.fc.weight.value = split_v
-        del model_params
+            if use_weight_only:
+                param = split_v.transpose()
+                processed_torch_weights, torch_weight_scales = \
+                    torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
+                        param, plugin_weight_only_quant_type)
+                layer.attention.qkv.weight.value = processed_torch_weights
+                layer.attention.qkv.per_channel_scale.value = torch_weight_scales
+            else:
+                layer.attention.qkv.weight.value = split_v
+        elif 'self_attn.o_proj.weight' in name:
+            split_v = split(param, mapping.tp_size, mapping.tp_rank, dim=1)
+            if use_weight_only:
+                processed_torch_weights, torch_weight_scales = \
+                    torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
+                        split_v.transpose(), plugin_weight_only_quant_type)
+                layer.attention.dense.weight.value = processed_torch_weights
+                layer.attention.dense.per_channel_scale.value = torch_weight_scales
+            else:
+                layer.attention.dense.weight.value = split_v
+        elif 'mlp.up_proj.weight' in name:
+            split_v = split(param, mapping.tp_size, mapping.tp_rank, dim=0)
+            if use_weight_only:
+                processed_torch_weights, torch_weight_scales = \
+                    torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
+                        split_v.transpose(), plugin_weight_only_quant_type)
+                layer.mlp.gate.weight.value = processed_torch_weights
+                layer.mlp.gate.per_channel_scale.value = torch_weight_scales
+            else:
+                layer.mlp.gate.weight.value = split_v
+        elif 'mlp.down_proj.weight' in name:
+            split_v = split(param, mapping.tp_size, mapping.tp_rank, dim=1)
+            if use_weight_only:
+                processed_torch_weights, torch_weight_scales = \
+                    torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
+                        split_v.transpose(), plugin_weight_only_quant_type)
+                layer.mlp.proj.weight.value = processed_torch_weights
+                layer.mlp.proj.per_channel_scale.value = torch_weight_scales
+            else:
+                layer.mlp.proj.weight.value = split_v
+        elif 'mlp.gate_proj.weight' in name:
+            split_v = split(param, mapping.tp_size, mapping.tp_rank, dim=0)
+            if use_weight_only:
+                processed_torch_weights, torch_weight_scales = \
+                    torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
+                        split_v.transpose(), plugin_weight_only_quant_type)
+                layer.mlp.fc.weight.value = processed_torch_weights
+                layer.mlp.fc.per_channel_scale.value = torch_weight_scales
+            else:
+                layer.mlp.fc.weight.value = split_v
+
+    # The conversions of the tensors (splits, transposes and quantization)
+    # release the GIL, they run on num_workers threads while the next shards
+    # are read
+    qkv_lock = threading.Lock()
+    with ThreadPoolExecutor(max_workers=num_workers) as executor:
+        for model_file, model_params in iterate_state_dicts(
+                model_dir,
+                dtype,
+                num_workers=num_workers,
+                name_filter=is_loaded):
+            logger.debug(f'Converting weights of {str(model_file)}...')
+            for future in [
+                    executor.submit(convert, name, param)
+                    for name, param in model_params.items()
+            ]:
+                future.result()
+            del model_params
     tok = time.time()
     t = time.strftime('%H:%M:%S', time.gmtime(tok - tik))
     tensorrt_llm.logger.info(f'Weights loaded. Total time: {t}')
@@ -700,7 +756,8 @@ def load_from_meta_llama(
                                             tmp.shape[d] // ranks_per_ckpt,
                                             dim=d)[ckpt_rank].clone()
             elif "experts" in k and moe_config.tp_mode == moe_config.ParallelismMode.EXPERT_PARALLEL:
-                rank_experts = mapping.ep_experts(moe_config.num_experts)
+                rank_experts = mapping.ep_experts(moe_config.num_experts,
+                                                  moe_config.replicated_experts)
                 expert_id = int(k[k.find("experts"):].split(".")[1])
                 if expert_id in rank_experts:
                     split_ckpt[k] = v.clone()
@@ -816,7 +873,8 @@ def load_from_meta_llama(
 
         rank_experts = list(range(moe_config.num_experts))
         if moe_config.tp_mode == moe_config.ParallelismMode.EXPERT_PARALLEL:
-            rank_experts = mapping.ep_experts(moe_config.num_experts)
+            rank_experts = mapping.ep_experts(moe_config.num_experts,
+                                              moe_config.replicated_experts)
         for suffix in ["w1", "w2", "w3"]:
             ckpt[f'layers.{l}.feed_forward.experts.{suffix}.weight'] = \
                 torch.stack(list(ckpt[f'layers.{l}.feed_forward.experts.{expert}.{suffix}.weight']
@@ -1230,7 +1288,12 @@ def load_from_gptq_llama(tensorrt_llm_llama,
         w_unpacked[:, 1::2] = w_packed_int4x2 // 16
         return w_unpacked.contiguous()
 
-    def process_and_assign_weight(mOp, v, tp_dim=-1):
+    def load_g_idx(key):
+        # The input column of each row is in the group g_idx[row] with
+        # act-order, and in the group row // group_size otherwise
+        return load(key + ".g_idx").cpu()
+
+    def process_and_assign_weight(mOp, v, tp_dim=-1, g_idx=None):
         if tp_dim == -1:
             qweight_int32, qzeros_int32, scales_fp16 = [
                 item.cpu() for item in v
@@ -1245,6 +1308,18 @@ def load_from_gptq_llama(tensorrt_llm_llama,
 
         qweight_unpacked_int8 = unpack_int32_into_int8(
             qweight_int32.T).T.contiguous() - 8
+        if mOp.act_order_perm is not None:
+            # Sort the rows by group, so that each group is group_size
+            # contiguous rows like without act-order
+            assert g_idx is not None, "act-order requires g_idx"
+            perm = torch.argsort(g_idx, stable=True)
+            group_size = qweight_unpacked_int8.shape[0] // scales_fp16.shape[0]
+            assert torch.equal(
+                g_idx[perm],
+                torch.arange(g_idx.numel(), dtype=g_idx.dtype) // group_size
+            ), "Each group must have group_size rows"
+            qweight_unpacked_int8 = qweight_unpacked_int8[perm].contiguous()
+            mOp.act_order_perm.value = perm.to(torch.int32).numpy()
         qweight_interleaved = preprocessor(packer(qweight_unpacked_int8),
                                            torch.quint4x2).view(torch.int8)
         # zeros = zeros * scales
@@ -1294,6 +1369,17 @@ def load_from_gptq_llama(tensorrt_llm_llama,
         tensorrt_llm.logger.info(f'Process weights in layer: {layer_idx}')
         layer = tensorrt_llm_llama.layers[layer_idx]
 
+        act_order = layer.attention.qkv.act_order_perm is not None
+
+        def layer_g_idx(*names):
+            if not act_order:
+                return None
+            # The projections of the same input share the order of its columns
+            g_idx = [load_g_idx(prefix + name) for name in names]
+            assert all(torch.equal(g_idx[0], item) for item in g_idx[1:]), \
+                "The fused projections must have the same act-order"
+            return g_idx[0]
+
         # 4.1 attention.qkv
         qkv_weight_list = []
         for suf in gptq_suffix_list:
@@ -1305,23 +1391,38 @@ def load_from_gptq_llama(tensorrt_llm_llama,
                 qkv_list.append(comp_part)
             qkv_weight_list.append(torch.cat(qkv_list, dim=1))
 
-        process_and_assign_weight(layer.attention.qkv, qkv_weight_list)
+        process_and_assign_weight(
+            layer.attention.qkv, qkv_weight_list,
+            g_idx=layer_g_idx(*(gptq_key_list[3] + comp + gptq_key_list[4]
+                                for comp in ["q", "k", "v"])))
 
         # 4.2 attention.dense
         v = [load(prefix + gptq_key_list[5] + suf) for suf in gptq_suffix_list]
-        process_and_assign_weight(layer.attention.dense, v, 0)
+        process_and_assign_weight(layer.attention.dense,
+                                  v,
+                                  0,
+                                  g_idx=layer_g_idx(gptq_key_list[5]))
 
         # 4.3 mlp.gate
         v = [load(prefix + gptq_key_list[6] + suf) for suf in gptq_suffix_list]
-        process_and_assign_weight(layer.mlp.gate, v, 1)
+        process_and_assign_weight(layer.mlp.gate,
+                                  v,
+                                  1,
+                                  g_idx=layer_g_idx(gptq_key_list[6]))
 
         # 4.4 mlp.proj
         v = [load(prefix + gptq_key_list[7] + suf) for suf in gptq_suffix_list]
-        process_and_assign_weight(layer.mlp.proj, v, 0)
+        process_and_assign_weight(layer.mlp.proj,
+                                  v,
+                                  0,
+                                  g_idx=layer_g_idx(gptq_key_list[7]))
 
         # 4.5 mlp.fc
         v = [load(prefix + gptq_key_list[8] + suf) for suf in gptq_suffix_list]
-        process_and_assign_weight(layer.mlp.fc, v, 1)
+        process_and_assign_weight(layer.mlp.fc,
+                                  v,
+                                  1,
+                                  g_idx=layer_g_idx(gptq_key_list[8]))
 
         # 4.6 input_layernorm
         v = load(prefix + gptq_key_list[9])
@@ -1,14 +1,21 @@
 import copy
 import json
+import math
 import os
+import time
 from typing import List, Optional
 
+import numpy as np
 import safetensors
+import safetensors.torch
+import torch
 
 from .._common import default_net
-from .._utils import str_dtype_to_trt
+from .._utils import numpy_to_torch, str_dtype_to_trt
 from ..functional import PositionEmbeddingType, Tensor, gather_last_token_logits
-from ..layers import AttentionParams, KeyValueCacheParams, LoraParams
+from ..layers import (Attention, AttentionParams, ColumnLinear, Embedding,
+                      KeyValueCacheParams, LoraParams, RowLinear)
+from ..logger import logger
 from ..mapping import Mapping
 from ..module import Module, ModuleList
 from ..quantization import QuantMode
@@ -255,6 +262,79 @@ class DecoderLayerList(ModuleList):
         return hidden_states
 
 
+def split(v: torch.Tensor, tp_size: int, tp_rank: int, dim: int = 0):
+    '''Slices the tp_rank-th of tp_size chunks of v along dim, zero-padding v
+    when its size is not a multiple of tp_size (e.g. the vocabulary).'''
+    chunk = math.ceil(v.shape[dim] / tp_size)
+    padding = chunk * tp_size - v.shape[dim]
+    if padding > 0:
+        shape = list(v.shape)
+        shape[dim] = padding
+        v = torch.cat([v, v.new_zeros(shape)], dim=dim)
+    return v.narrow(dim, tp_rank * chunk, chunk).contiguous()
+
+
+def split_qkv(v: torch.Tensor, tp_size: int, tp_rank: int, num_heads: int,
+              head_size: int):
+    '''Slices the fused q, k and v of the rank. When there are fewer kv heads
+    than ranks, the ranks sharing a kv head get a copy of it.'''
+    num_kv_heads = (v.shape[0] // head_size - num_heads) // 2
+    q, k, v = torch.split(v, [
+        num_heads * head_size, num_kv_heads * head_size,
+        num_kv_heads * head_size
+    ])
+    q = split(q, tp_size, tp_rank)
+    if num_kv_heads < tp_size:
+        head = tp_rank * num_kv_heads // tp_size
+        k = k.narrow(0, head * head_size, head_size).contiguous()
+        v = v.narrow(0, head * head_size, head_size).contiguous()
+    else:
+        k = split(k, tp_size, tp_rank)
+        v = split(v, tp_size, tp_rank)
+    return torch.cat([q, k, v], dim=0)
+
+
+def save_checkpoint_weights(model: Module, path: str):
+    '''@brief: Saves the weights of the parameters of the model to a
+        safetensors file, such as the rank<N>.safetensors of a checkpoint.
+
+        The weights are saved as the network takes them: sliced for the rank
+        of the model, quantized and preprocessed, such as the interleaved INT4
+        weights of the weight-only GEMMs. Loading them with
+        load_checkpoint_weights, from_checkpoint or the refit of an engine
+        converts nothing, the conversion is done once for all the builds.
+    '''
+    logger.info(f'Saving the weights of {type(model).__name__} to {path}...')
+    tik = time.time()
+    safetensors.torch.save_file(
+        {
+            name: numpy_to_torch(np.ascontiguousarray(param.raw_value))
+            for name, param in model.named_parameters()
+        }, path)
+    tok = time.time()
+    t = time.strftime('%H:%M:%S', time.gmtime(tok - tik))
+    logger.info(f'Weights saved. Total time: {t}')
+
+
+def load_checkpoint_weights(model: Module, path: str):
+    '''@brief: Loads the weights saved by save_checkpoint_weights into the
+        parameters of the model, which must be configured as the one they were
+        saved from. The file is memory mapped and the weights are not
+        converted.
+    '''
+    logger.info(f'Loading the weights of {type(model).__name__} from {path}...')
+    tik = time.time()
+    with safetensors.safe_open(path, framework='pt', device='cpu') as f:
+        names = set(f.keys())
+        for name, param in model.named_parameters():
+            if name not in names:
+                raise ValueError(f'Weights {name} are not in {path}')
+            param.value = f.get_tensor(name)
+    tok = time.time()
+    t = time.strftime('%H:%M:%S', time.gmtime(tok - tik))
+    logger.info(f'Weights loaded. Total time: {t}')
+
+
 class PostInitCaller(type):
 
     def __call__(cls, *args, **kwargs):
@@ -283,20 +363,37 @@ class PretrainedModel(Module, GenerationMixin, metaclass=PostInitCaller):
         return cls(config)
 
     @classmethod
-    def from_checkpoint(cls, ckpt_dir: str, rank: int = 0):
+    def from_checkpoint(cls,
+                        ckpt_dir: str,
+                        rank: int = 0,
+                        mapping: Optional[Mapping] = None):
+        '''@brief: Loads the weights of the rank from the checkpoint.
+
+            @param mapping: When set, ckpt_dir is an unsharded checkpoint
+                (world_size 1) and its weights are sliced for this mapping
+                instead of the one of the checkpoint.
+        '''
         config = PretrainedConfig.from_json_file(
             os.path.join(ckpt_dir, 'config.json'))
+        ckpt_rank = rank
+        if mapping is not None:
+            assert config.mapping.world_size == 1, \
+                "Only unsharded checkpoints can be re-sharded"
+            config.mapping = copy.deepcopy(mapping)
+            ckpt_rank = 0
         config.set_rank(rank)
         model = cls.from_config(config)
 
         weights = {}
         with safetensors.safe_open(os.path.join(ckpt_dir,
-                                                f'rank{rank}.safetensors'),
+                                                f'rank{ckpt_rank}.safetensors'),
                                    framework='pt',
                                    device='cpu') as f:
             for key in f.keys():
                 weights[key] = f.get_tensor(key)
 
+        if mapping is not None:
+            weights = model.shard_weights(weights)
         model.load(weights)
 
         return model
@@ -307,6 +404,66 @@ class PretrainedModel(Module, GenerationMixin, metaclass=PostInitCaller):
                 continue
             param.value = weights[name]
 
+    def shard_weights(self, weights):
+        '''@brief: Slices the unsharded weights (tp_size 1, pp_size 1) for the
+            mapping of the model, from the tensor parallel layers the
+            parameters belong to. The other parameters are replicated.
+
+            @return: the weights of the rank, by the names of its parameters
+        '''
+        mapping = self.config.mapping
+        # The names of the checkpoint number the layers of all the stages
+        layer_lists = {
+            prefix: module.layer_list
+            for prefix, module in self.named_modules()
+            if isinstance(module, DecoderLayerList)
+        }
+
+        def checkpoint_name(name):
+            for prefix, layer_list in layer_lists.items():
+                if name.startswith(prefix + '.'):
+                    idx, suffix = name[len(prefix) + 1:].split('.', 1)
+                    return f'{prefix}.{layer_list[int(idx)]}.{suffix}'
+            return name
+
+        # Slicing of the parameters of the tensor parallel layers, the fused
+        # qkv first as it is also a ColumnLinear
+        tp_size, tp_rank = mapping.tp_size, mapping.tp_rank
+        slicers = {}
+        for _, module in self.named_modules():
+            if isinstance(module, Attention) and module.tp_size > 1:
+                num_heads = module.num_attention_heads * tp_size
+                for param in (module.qkv.weight, module.qkv.bias):
+                    slicers.setdefault(
+                        param, lambda v, m=module, h=num_heads: split_qkv(
+                            v, tp_size, tp_rank, h, m.attention_head_size))
+            elif isinstance(module, ColumnLinear) and module.tp_size > 1:
+                for param in (module.weight, module.bias):
+                    slicers.setdefault(
+                        param, lambda v: split(v, tp_size, tp_rank, 0))
+            elif isinstance(module, RowLinear) and module.tp_size > 1:
+                slicers.setdefault(module.weight,
+                                   lambda v: split(v, tp_size, tp_rank, 1))
+            elif isinstance(module, Embedding) and module.tp_size > 1:
+                slicers.setdefault(
+                    module.weight, lambda v, m=module: split(
+                        v, tp_size, tp_rank, m.sharding_dim))
+
+        shard = {}
+        for name, param in self.named_parameters():
+            ckpt_name = checkpoint_name(name)
+            if ckpt_name not in weights:
+                continue
+            v = weights[ckpt_name]
+            if param in slicers:
+                v = slicers[param](v)
+            if tuple(v.shape) != tuple(param.shape):
+                raise ValueError(
+                    f'Cannot re-shard {ckpt_name} of shape {tuple(v.shape)} '
+                    f'to {tuple(param.shape)}')
+            shard[name] = v
+        return shard
+
     def prepare_inputs(self,
                        max_batch_size,
                        max_input_len,
@@ -331,6 +331,7 @@ def _weight_only_groupwise_quantize(model,
                                     group_size=128,
                                     pre_quant_scale=False,
                                     zero=False,
+                                    act_order=False,
                                     exclude_modules=None,
                                     current_key_name=None):
     exclude_modules = ['lm_head'
@@ -343,7 +344,7 @@ def _weight_only_groupwise_quantize(model,
 
         if len(list(module.children())) > 0:
             _weight_only_groupwise_quantize(module, quant_mode, group_size,
-                                            pre_quant_scale, zero,
+                                            pre_quant_scale, zero, act_order,
                                             exclude_modules, current_key_name)
 
         if isinstance(module, ColumnLinear) and name not in exclude_modules:
@@ -356,6 +357,7 @@ def _weight_only_groupwise_quantize(model,
                     pre_quant_scale=pre_quant_scale,
                     zero=zero,
                     bias=module.bias is not None,
+                    act_order=act_order,
                     dtype=module.dtype,
                     tp_group=module.tp_group,
                     tp_size=module.tp_size,
@@ -370,6 +372,7 @@ def _weight_only_groupwise_quantize(model,
                     pre_quant_scale=pre_quant_scale,
                     zero=zero,
                     bias=module.bias is not None,
+                    act_order=act_order,
                     dtype=module.dtype,
                     tp_group=module.tp_group,
                     tp_size=module.tp_size)
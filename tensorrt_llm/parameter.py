@@ -52,6 +52,10 @@ class Parameter:
             self._shape = value.shape
             self._value = self._regularize_value(value)
 
+    @property
+    def shape(self):
+        return self._shape
+
     @property
     def value(self) -> Tensor:
         if (self._value is not None and isinstance(self._value, np.ndarray)
@@ -63,25 +63,35 @@ class PluginConfig(object):
         self.identity_plugin = False
         self.gemm_plugin = False
         self.smooth_quant_gemm_plugin = False
+        self.fp8_gemm_plugin = False
         self.layernorm_plugin = False
         self.layernorm_quantization_plugin = False
         self.rmsnorm_plugin = False
         self.rmsnorm_quantization_plugin = False
+        self.residual_rmsnorm_plugin = False
+        self.gated_activation_plugin = False
+        self.lm_head_topk_plugin = False
         self.attention_qk_half_accumulation = False
         self.remove_input_padding = False
         self.context_fmha_type = ContextFMHAType.disabled
         self.weight_only_groupwise_quant_matmul_plugin = False
         self.weight_only_quant_matmul_plugin = False
+        self.w4a8_gemm_plugin = False
         self.nccl_plugin = False
         self.use_custom_all_reduce = False
+        self.gemm_allreduce_chunks = 0
         self.quantize_per_token_plugin = False
         self.quantize_tensor_plugin = False
         self.paged_kv_cache = False
         self.tokens_per_block = 0
         self.lookup_plugin = False
         self.lora_plugin = False
+        self.grouped_gemm_plugin = False
         self.use_paged_context_fmha = False
         self.use_context_fmha_for_generation = False
+        self.sliding_window_kv_cache = False
+        self.block_cache_indirection = False
+        self.sink_token_length = 0
 
     def enable_qk_half_accum(self):
         self.attention_qk_half_accumulation = True
@@ -136,6 +146,10 @@ class PluginConfig(object):
         self.smooth_quant_gemm_plugin = dtype
         return self
 
+    def set_fp8_gemm_plugin(self, dtype='float16'):
+        self.fp8_gemm_plugin = dtype
+        return self
+
     def set_layernorm_plugin(self, dtype='float16'):
         self.layernorm_plugin = dtype
         return self
@@ -152,6 +166,18 @@ class PluginConfig(object):
         self.rmsnorm_quantization_plugin = dtype
         return self
 
+    def set_residual_rmsnorm_plugin(self, dtype='float16'):
+        self.residual_rmsnorm_plugin = dtype
+        return self
+
+    def set_gated_activation_plugin(self, dtype='float16'):
+        self.gated_activation_plugin = dtype
+        return self
+
+    def set_lm_head_topk_plugin(self, dtype='float16'):
+        self.lm_head_topk_plugin = dtype
+        return self
+
     def set_weight_only_quant_matmul_plugin(self, dtype='float16'):
         self.weight_only_quant_matmul_plugin = dtype
         return self
@@ -160,6 +186,10 @@ class PluginConfig(object):
         self.weight_only_groupwise_quant_matmul_plugin = dtype
         return self
 
+    def set_w4a8_gemm_plugin(self, dtype='float16'):
+        self.w4a8_gemm_plugin = dtype
+        return self
+
     def set_nccl_plugin(self,
                         dtype='float16',
                         use_custom_all_reduce: bool = False):
@@ -167,6 +197,10 @@ class PluginConfig(object):
         self.nccl_plugin = dtype
         return self
 
+    def set_gemm_allreduce_plugin(self, num_chunks: int = 4):
+        self.gemm_allreduce_chunks = num_chunks
+        return self
+
     def set_quantize_per_token_plugin(self):
         self.quantize_per_token_plugin = True
         return self
@@ -183,6 +217,10 @@ class PluginConfig(object):
         self.lora_plugin = dtype
         return self
 
+    def set_grouped_gemm_plugin(self, dtype='float16'):
+        self.grouped_gemm_plugin = dtype
+        return self
+
     def set_paged_context_fmha(self):
         self.use_paged_context_fmha = True
         return self
@@ -190,3 +228,18 @@ class PluginConfig(object):
     def set_context_fmha_for_generation(self):
         self.use_context_fmha_for_generation = True
         return self
+
+    def enable_sliding_window_kv_cache(self):
+        self.sliding_window_kv_cache = True
+        logger.info(f"Sliding Window KV Cache Enabled")
+        return self
+
+    def enable_block_cache_indirection(self):
+        self.block_cache_indirection = True
+        logger.info(f"Block Cache Indirection Enabled")
+        return self
+
+    def set_sink_token_length(self, sink_token_length):
+        self.sink_token_length = sink_token_length
+        logger.info(f"Sink Token Length is set to {sink_token_length}")
+        return self
@@ -20,13 +20,22 @@ import tensorrt as trt
 from .._common import default_net, default_trtnet
 from .._utils import str_dtype_to_np, str_dtype_to_trt
 from ..functional import (Tensor, _add_plugin_info, _create_tensor, cast, clip,
-                          constant, matmul, repeat_interleave, round)
+                          constant, index_select, matmul, repeat_interleave,
+                          round, silu, split)
 from ..plugin import TRT_LLM_PLUGIN_NAMESPACE
 
 
-def smooth_quant_gemm(input: Tensor, weights: Tensor, scales_a: Tensor,
-                      scales_b: Tensor, per_token_scaling: bool,
-                      per_channel_scaling: bool) -> Tensor:
+def smooth_quant_gemm(input: Tensor,
+                      weights: Tensor,
+                      scales_a: Tensor,
+                      scales_b: Tensor,
+                      per_token_scaling: bool,
+                      per_channel_scaling: bool,
+                      residual: Optional[Tensor] = None) -> Tensor:
+    '''
+    If residual is given, it is added to the output in the GEMM epilogue,
+    which saves a separate elementwise pass over the output.
+    '''
     if not default_net().plugin_config.smooth_quant_gemm_plugin:
         raise TypeError("Smooth Quant GEMM is only supported with plugin")
     else:
@@ -51,13 +60,20 @@ def smooth_quant_gemm(input: Tensor, weights: Tensor, scales_a: Tensor,
             "type_id", np.array([int(str_dtype_to_trt(p_dtype))], np.int32),
             trt.PluginFieldType.INT32)
 
+        has_residual = trt.PluginField(
+            "has_residual", np.array(int(residual is not None),
+                                     dtype=np.int32),
+            trt.PluginFieldType.INT32)
+
         pfc = trt.PluginFieldCollection(
-            [per_channel_scaling, per_token_scaling, pf_type])
+            [per_channel_scaling, per_token_scaling, pf_type, has_residual])
         gemm_plug = plg_creator.create_plugin("sq_gemm", pfc)
         plug_inputs = [
             input.trt_tensor, weights.trt_tensor, scales_a.trt_tensor,
             scales_b.trt_tensor
         ]
+        if residual is not None:
+            plug_inputs += [residual.trt_tensor]
         layer = default_trtnet().add_plugin_v2(plug_inputs, gemm_plug)
         _add_plugin_info(layer, plg_creator, "sq_gemm", pfc)
         layer.get_input(0).set_dynamic_range(-127, 127)
@@ -65,11 +81,96 @@ def smooth_quant_gemm(input: Tensor, weights: Tensor, scales_a: Tensor,
         return _create_tensor(layer.get_output(0), layer)
 
 
+def fp8_gemm(input: Tensor, weights: Tensor, scales_a: Tensor,
+             scales_b: Tensor, per_token_scaling: bool,
+             per_channel_scaling: bool) -> Tensor:
+    if not default_net().plugin_config.fp8_gemm_plugin:
+        raise TypeError("FP8 GEMM is only supported with plugin")
+    else:
+        plg_creator = trt.get_plugin_registry().get_plugin_creator(
+            'Fp8Gemm', '1', TRT_LLM_PLUGIN_NAMESPACE)
+        assert plg_creator is not None
+
+        per_channel_scaling = 1 if per_channel_scaling else 0
+        per_channel_scaling = trt.PluginField(
+            "has_per_channel_scaling",
+            np.array(per_channel_scaling, dtype=np.int32),
+            trt.PluginFieldType.INT32)
+
+        per_token_scaling = 1 if per_token_scaling else 0
+        per_token_scaling = trt.PluginField(
+            "has_per_token_scaling", np.array(per_token_scaling,
+                                              dtype=np.int32),
+            trt.PluginFieldType.INT32)
+
+        p_dtype = default_net().plugin_config.fp8_gemm_plugin
+        pf_type = trt.PluginField(
+            "type_id", np.array([int(str_dtype_to_trt(p_dtype))], np.int32),
+            trt.PluginFieldType.INT32)
+
+        pfc = trt.PluginFieldCollection(
+            [per_channel_scaling, per_token_scaling, pf_type])
+        gemm_plug = plg_creator.create_plugin("fp8_gemm", pfc)
+        plug_inputs = [
+            input.trt_tensor, weights.trt_tensor, scales_a.trt_tensor,
+            scales_b.trt_tensor
+        ]
+        layer = default_trtnet().add_plugin_v2(plug_inputs, gemm_plug)
+        _add_plugin_info(layer, plg_creator, "fp8_gemm", pfc)
+        return _create_tensor(layer.get_output(0), layer)
+
+
+def w4a8_gemm(input: Tensor,
+              weights: Tensor,
+              scales: Tensor,
+              per_channel_scaling: bool,
+              pre_quant_scale: Optional[Tensor] = None) -> Tensor:
+    if not default_net().plugin_config.w4a8_gemm_plugin:
+        raise TypeError("W4A8 GEMM is only supported with plugin")
+    else:
+        plg_creator = trt.get_plugin_registry().get_plugin_creator(
+            'W4A8Gemm', '1', TRT_LLM_PLUGIN_NAMESPACE)
+        assert plg_creator is not None
+
+        per_channel_scaling = 1 if per_channel_scaling else 0
+        per_channel_scaling = trt.PluginField(
+            "has_per_channel_scaling",
+            np.array(per_channel_scaling, dtype=np.int32),
+            trt.PluginFieldType.INT32)
+
+        has_pre_quant_scale = 1 if pre_quant_scale is not None else 0
+        has_pre_quant_scale = trt.PluginField(
+            "has_pre_quant_scale",
+            np.array(has_pre_quant_scale, dtype=np.int32),
+            trt.PluginFieldType.INT32)
+
+        p_dtype = default_net().plugin_config.w4a8_gemm_plugin
+        pf_type = trt.PluginField(
+            "type_id", np.array([int(str_dtype_to_trt(p_dtype))], np.int32),
+            trt.PluginFieldType.INT32)
+
+        pfc = trt.PluginFieldCollection(
+            [per_channel_scaling, has_pre_quant_scale, pf_type])
+        gemm_plug = plg_creator.create_plugin("w4a8_gemm", pfc)
+        plug_inputs = [input.trt_tensor, weights.trt_tensor, scales.trt_tensor]
+        if pre_quant_scale is not None:
+            plug_inputs += [pre_quant_scale.trt_tensor]
+        layer = default_trtnet().add_plugin_v2(plug_inputs, gemm_plug)
+        _add_plugin_info(layer, plg_creator, "w4a8_gemm", pfc)
+        return _create_tensor(layer.get_output(0), layer)
+
+
 def weight_only_quant_matmul(input: Tensor,
                              weights: Tensor,
                              scales: Tensor,
                              weightTypeId: int,
-                             dtype: str = 'float16') -> Tensor:
+                             dtype: str = 'float16',
+                             swiglu: bool = False) -> Tensor:
+    '''
+    If swiglu is set, the columns of the weights are the gate followed by the
+    up of a gated MLP, and silu(gate) * up is returned. With the plugin, the
+    two halves are read by one fused kernel on the small batch path.
+    '''
 
     if not default_net().plugin_config.weight_only_quant_matmul_plugin:
         if weights.dtype != trt.int8:
@@ -80,6 +181,9 @@ def weight_only_quant_matmul(input: Tensor,
             weights = dequantize(weights, scales, 1, input.dtype)
 
         res = matmul(input, weights)
+        if swiglu:
+            gate, up = split(res, res.size(-1) // 2, dim=-1)
+            res = silu(gate) * up
         return cast(res, dtype)
     else:
         plg_creator = trt.get_plugin_registry().get_plugin_creator(
@@ -94,8 +198,11 @@ def weight_only_quant_matmul(input: Tensor,
         pf_type = trt.PluginField(
             "type_id", np.array([int(str_dtype_to_trt(p_dtype))], np.int32),
             trt.PluginFieldType.INT32)
+        pf_swiglu = trt.PluginField("swiglu",
+                                    np.array(int(swiglu), dtype=np.int32),
+                                    trt.PluginFieldType.INT32)
 
-        pfc = trt.PluginFieldCollection([pf_type, weight_type_id])
+        pfc = trt.PluginFieldCollection([pf_type, weight_type_id, pf_swiglu])
         matmul_plug = plg_creator.create_plugin("woq_matmul", pfc)
         plug_inputs = [input.trt_tensor, weights.trt_tensor, scales.trt_tensor]
         layer = default_trtnet().add_plugin_v2(plug_inputs, matmul_plug)
@@ -112,10 +219,19 @@ def weight_only_groupwise_quant_matmul(input: Tensor,
                                        biases: Tensor,
                                        quant_algo: int,
                                        group_size: int,
-                                       dtype: str = 'float16') -> Tensor:
-
+                                       dtype: str = 'float16',
+                                       act_order_perm: Optional[Tensor] = None
+                                       ) -> Tensor:
+    '''
+    With act_order set in quant_algo, the K dimension of the weights is sorted
+    by group and act_order_perm gives the column of the input of each row of
+    the weights, see WeightOnlyGroupwiseQuantLinear.
+    '''
     if not default_net(
     ).plugin_config.weight_only_groupwise_quant_matmul_plugin:
+        if quant_algo & 8:
+            # act order
+            input = index_select(input, input.rank() - 1, act_order_perm)
         scales = repeat_interleave(scales, group_size, 0)
         weights = quantize(weights, scales, dtype='int8', axis=1)
         weights = dequantize(weights, scales, 1, input.dtype)
@@ -155,18 +271,22 @@ def weight_only_groupwise_quant_matmul(input: Tensor,
 
         matmul_plug = plg_creator.create_plugin("woq_groupwise_matmul", pfc)
 
-        # quant_algo = pre_quant_scale * 4 + zero * 2 + bias
+        # quant_algo = act_order * 8 + pre_quant_scale * 4 + zero * 2 + bias
         plug_inputs = [input.trt_tensor]
 
         # Flags for indicating whether the corresponding inputs are applied in quant_algo
-        # quant_algo = pre_quant_scale * PRE_QUANT_SCALE + zero * ZERO + bias * BIAS
-        # Here pre_quant_scale, zero and bias are boolean type
+        # quant_algo = act_order * ACT_ORDER + pre_quant_scale * PRE_QUANT_SCALE + zero * ZERO + bias * BIAS
+        # Here act_order, pre_quant_scale, zero and bias are boolean type
         BIAS = 1
         ZERO = 2
         PRE_QUANT_SCALE = 4
+        ACT_ORDER = 8
 
         if quant_algo & PRE_QUANT_SCALE:
             plug_inputs += [pre_quant_scale.trt_tensor]
+        if quant_algo & ACT_ORDER:
+            plug_inputs += [act_order_perm.trt_tensor]
+        weight_input_idx = len(plug_inputs)
 
         plug_inputs += [weights.trt_tensor, scales.trt_tensor]
 
@@ -177,10 +297,7 @@ def weight_only_groupwise_quant_matmul(input: Tensor,
 
         layer = default_trtnet().add_plugin_v2(plug_inputs, matmul_plug)
         _add_plugin_info(layer, plg_creator, "woq_groupwise_matmul", pfc)
-        if quant_algo & PRE_QUANT_SCALE:
-            layer.get_input(2).set_dynamic_range(-127, 127)
-        else:
-            layer.get_input(1).set_dynamic_range(-127, 127)
+        layer.get_input(weight_input_idx).set_dynamic_range(-127, 127)
 
         return _create_tensor(layer.get_output(0), layer)
 
@@ -291,6 +408,150 @@ def smooth_quant_rms_norm(input: Tensor,
                               layer), _create_tensor(layer.get_output(1), layer)
 
 
+def residual_rms_norm(
+        input: Tensor,
+        residual: Tensor,
+        normalized_shape: Union[int, Tuple[int]],
+        weight: Optional[Tensor] = None,
+        scale: Optional[Tensor] = None,
+        eps: float = 1e-05,
+        output_dtype: Optional[str] = None,
+        dynamic_act_scaling: bool = False) -> Tuple[Tensor, ...]:
+    '''
+    Adds the residual to the input and normalizes the sum in a single kernel,
+    which saves the separate elementwise pass and the extra read of the sum.
+
+    Returns the normalized sum, quantized to output_dtype ('int8' or 'fp8')
+    with the scale if given, the sum to use as the next residual and, with
+    dynamic_act_scaling, the per-token scales of the int8 output.
+    '''
+    if not default_net().plugin_config.residual_rmsnorm_plugin:
+        raise TypeError("Residual Rms Norm is only supported with plugin")
+    else:
+        plg_creator = trt.get_plugin_registry().get_plugin_creator(
+            'ResidualRmsnorm', '1', TRT_LLM_PLUGIN_NAMESPACE)
+        assert plg_creator is not None
+
+        p_dtype = default_net().plugin_config.residual_rmsnorm_plugin
+        output_dtype = p_dtype if output_dtype is None else output_dtype
+        quantized = output_dtype != p_dtype
+        assert quantized == (scale is not None), \
+            "The scale is required for and only for a quantized output"
+
+        eps = trt.PluginField("eps", np.array(eps, dtype=np.float32),
+                              trt.PluginFieldType.FLOAT32)
+        pf_type = trt.PluginField(
+            "type_id", np.array([int(str_dtype_to_trt(p_dtype))], np.int32),
+            trt.PluginFieldType.INT32)
+        pf_out_type = trt.PluginField(
+            "out_type_id",
+            np.array([int(str_dtype_to_trt(output_dtype))], np.int32),
+            trt.PluginFieldType.INT32)
+        dyn_act_scaling = trt.PluginField(
+            "dyn_act_scaling", np.array([int(dynamic_act_scaling)], np.int32),
+            trt.PluginFieldType.INT32)
+        pfc = trt.PluginFieldCollection(
+            [eps, pf_type, pf_out_type, dyn_act_scaling])
+        residual_rmsnorm_plug = plg_creator.create_plugin(
+            "residual_rmsnorm", pfc)
+        normalized_shape = [normalized_shape] if isinstance(
+            normalized_shape, int) else normalized_shape
+        if weight is None:
+            weight = constant(
+                np.ones(normalized_shape, dtype=str_dtype_to_np(p_dtype)))
+
+        plug_inputs = [input.trt_tensor, residual.trt_tensor, weight.trt_tensor]
+        if quantized:
+            plug_inputs += [scale.trt_tensor]
+        layer = default_trtnet().add_plugin_v2(plug_inputs,
+                                               residual_rmsnorm_plug)
+        if output_dtype == 'int8':
+            layer.get_output(0).set_dynamic_range(-127, 127)
+        _add_plugin_info(layer, plg_creator, "residual_rmsnorm", pfc)
+        return tuple(
+            _create_tensor(layer.get_output(i), layer)
+            for i in range(layer.num_outputs))
+
+
+# The activations of the gate of GatedActivationType in
+# gatedActivationKernels.h, by their names in ACT2FN
+GATED_ACTIVATION_TYPES = {
+    'silu': 0,
+    'gelu': 1,
+    'gelu_new': 1,
+    'gelu_fast': 1,
+    'geglu': 1,
+}
+
+
+def gated_activation(
+        input: Tensor,
+        activation: str,
+        smoother: Optional[Tensor] = None,
+        scale: Optional[Tensor] = None,
+        output_dtype: Optional[str] = None,
+        dynamic_act_scaling: bool = False) -> Union[Tensor, Tuple[Tensor]]:
+    '''
+    Computes act(gate) * up, where the last dimension of the input holds the
+    gate followed by the up, in a single kernel. The result is divided by the
+    smoother if given, and quantized to output_dtype ('int8' or 'fp8') for the
+    next GEMM with the static scale or, with dynamic_act_scaling, with
+    per-token scales. That saves the separate activation, multiplication and
+    quantization passes over the intermediate activations.
+
+    Returns the output or, with dynamic_act_scaling, the int8 output and its
+    per-token scales, like quantize_per_token.
+    '''
+    if not default_net().plugin_config.gated_activation_plugin:
+        raise TypeError("Gated activation is only supported with plugin")
+    if activation not in GATED_ACTIVATION_TYPES:
+        raise ValueError(f"Unsupported gated activation: {activation}")
+
+    plg_creator = trt.get_plugin_registry().get_plugin_creator(
+        'GatedActivation', '1', TRT_LLM_PLUGIN_NAMESPACE)
+    assert plg_creator is not None
+
+    p_dtype = default_net().plugin_config.gated_activation_plugin
+    output_dtype = p_dtype if output_dtype is None else output_dtype
+    static_scale = output_dtype != p_dtype and not dynamic_act_scaling
+    assert static_scale == (scale is not None), \
+        "The scale is required for and only for a statically quantized output"
+
+    pf_type = trt.PluginField(
+        "type_id", np.array([int(str_dtype_to_trt(p_dtype))], np.int32),
+        trt.PluginFieldType.INT32)
+    pf_out_type = trt.PluginField(
+        "out_type_id", np.array([int(str_dtype_to_trt(output_dtype))],
+                                np.int32), trt.PluginFieldType.INT32)
+    pf_activation = trt.PluginField(
+        "activation", np.array([GATED_ACTIVATION_TYPES[activation]],
+                               np.int32), trt.PluginFieldType.INT32)
+    has_smoother = trt.PluginField(
+        "has_smoother", np.array([int(smoother is not None)], np.int32),
+        trt.PluginFieldType.INT32)
+    dyn_act_scaling = trt.PluginField(
+        "dyn_act_scaling", np.array([int(dynamic_act_scaling)], np.int32),
+        trt.PluginFieldType.INT32)
+    pfc = trt.PluginFieldCollection(
+        [pf_type, pf_out_type, pf_activation, has_smoother, dyn_act_scaling])
+    gated_activation_plug = plg_creator.create_plugin("gated_activation", pfc)
+
+    plug_inputs = [input.trt_tensor]
+    if smoother is not None:
+        plug_inputs += [smoother.trt_tensor]
+    if static_scale:
+        plug_inputs += [scale.trt_tensor]
+    layer = default_trtnet().add_plugin_v2(plug_inputs, gated_activation_plug)
+    if output_dtype == 'int8':
+        layer.get_output(0).set_dynamic_range(-127, 127)
+    _add_plugin_info(layer, plg_creator, "gated_activation", pfc)
+    if not dynamic_act_scaling:
+        return _create_tensor(layer.get_output(0), layer)
+    return tuple(
+        _create_tensor(layer.get_output(i), layer)
+        for i in range(layer.num_outputs))
+
+
 def quantize(input: Tensor,
              scale_factor: Tensor,
              dtype: str,
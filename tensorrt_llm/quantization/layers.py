@@ -25,8 +25,9 @@ from ..layers.attention import AttentionMaskType, PositionEmbeddingType
 from ..layers.linear import Linear, RowLinear
 from ..module import Module
 from ..parameter import Parameter
-from .functional import (dequantize, quantize, quantize_per_token,
-                         quantize_tensor, smooth_quant_gemm,
+from .functional import (GATED_ACTIVATION_TYPES, dequantize, gated_activation,
+                         quantize, quantize_per_token, quantize_tensor,
+                         smooth_quant_gemm,
                          smooth_quant_layer_norm, smooth_quant_rms_norm,
                          weight_only_groupwise_quant_matmul,
                          weight_only_quant_matmul)
@@ -196,23 +197,37 @@ class SmoothQuantRowLinear(Module):
         self.tp_size = tp_size
         self.quant_mode = quant_mode
 
-    def forward(self, x, workspace=None, lora_runtime_params=None):
+    def forward(self,
+                x,
+                workspace=None,
+                lora_runtime_params=None,
+                residual=None):
         assert lora_runtime_params is None, "lora is not supported on SmoothQuantRowLinear now"
         if self.quant_mode.has_act_static_scaling():
             per_token_scale = self.act_scale.value
         else:
             x, per_token_scale = x
-        x = smooth_quant_gemm(x, self.weight.value, per_token_scale,
+        need_allreduce = self.tp_size > 1 and self.tp_group is not None
+        # The residual can only be added in the GEMM epilogue before the
+        # allreduce if there is none
+        fuse_residual = residual is not None and not need_allreduce
+        x = smooth_quant_gemm(x,
+                              self.weight.value,
+                              per_token_scale,
                               self.per_channel_scale.value,
                               self.quant_mode.has_per_token_dynamic_scaling(),
-                              self.quant_mode.has_per_channel_scaling())
+                              self.quant_mode.has_per_channel_scaling(),
+                              residual=residual if fuse_residual else None)
 
-        if self.tp_size > 1 and self.tp_group is not None:
+        if need_allreduce:
             x = allreduce(x, self.tp_group, workspace)
 
         if self.bias is not None:
             x = x + self.bias.value
 
+        if residual is not None and not fuse_residual:
+            x = x + residual
+
         return x
 
 
@@ -430,6 +445,7 @@ class WeightOnlyGroupwiseQuantLinear(Module):
                  pre_quant_scale=False,
                  zero=False,
                  bias=False,
+                 act_order=False,
                  dtype=None,
                  tp_group=None,
                  tp_size=1,
@@ -441,8 +457,9 @@ class WeightOnlyGroupwiseQuantLinear(Module):
         BIAS = 1
         ZERO = 2
         PRE_QUANT_SCALE = 4
+        ACT_ORDER = 8
 
-        self.quant_algo = pre_quant_scale * PRE_QUANT_SCALE + zero * ZERO + bias * BIAS
+        self.quant_algo = act_order * ACT_ORDER + pre_quant_scale * PRE_QUANT_SCALE + zero * ZERO + bias * BIAS
         self.group_size = group_size
         self.in_features = in_features
         self.out_features = out_features // tp_size
@@ -459,6 +476,15 @@ class WeightOnlyGroupwiseQuantLinear(Module):
         else:
             self.register_parameter('pre_quant_scale', None)
 
+        if act_order:
+            # The GPTQ act-order checkpoints have their groups interleaved
+            # along K. The rows of the weights are sorted by group when
+            # loaded, act_order_perm is the input column of each row.
+            self.act_order_perm = Parameter(shape=(self.in_features, ),
+                                            dtype="int32")
+        else:
+            self.register_parameter('act_order_perm', None)
+
         if zero:
             self.zero = Parameter(shape=scale_shape, dtype=dtype)
         else:
@@ -478,11 +504,14 @@ class WeightOnlyGroupwiseQuantLinear(Module):
         pre_quant_scale = self.pre_quant_scale.value if self.pre_quant_scale else None
         zero = self.zero.value if self.zero else None
         bias = self.bias.value if self.bias else None
+        act_order_perm = self.act_order_perm.value if self.act_order_perm else None
 
         x = weight_only_groupwise_quant_matmul(x, pre_quant_scale,
                                                self.qweight.value,
                                                self.scale.value, zero, bias,
-                                               self.quant_algo, self.group_size)
+                                               self.quant_algo,
+                                               self.group_size,
+                                               act_order_perm=act_order_perm)
 
         if self.gather_output and self.tp_size > 1 and self.tp_group is not None:
             # [dim0, local_dim] -> [dim0 * tp_size, local_dim] --> [dim0, local_dim * tp_size]
@@ -503,17 +532,25 @@ class WeightOnlyGroupwiseQuantRowLinear(Module):
                  pre_quant_scale=False,
                  zero=False,
                  bias=False,
+                 act_order=False,
                  dtype=None,
                  tp_group=None,
                  tp_size=1):
         super().__init__()
+        # The rows of a group are spread over the ranks with act-order, so the
+        # shards of K cannot be sorted by group
+        if act_order and tp_size > 1:
+            raise ValueError(
+                "act_order is not supported with tensor parallelism on row linear layers"
+            )
 
         # Flags for indicating whether the corresponding inputs are applied in quant_algo
         BIAS = 1
         ZERO = 2
         PRE_QUANT_SCALE = 4
+        ACT_ORDER = 8
 
-        self.quant_algo = pre_quant_scale * PRE_QUANT_SCALE + zero * ZERO + bias * BIAS
+        self.quant_algo = act_order * ACT_ORDER + pre_quant_scale * PRE_QUANT_SCALE + zero * ZERO + bias * BIAS
         self.group_size = group_size
         self.in_features = in_features // tp_size
         self.out_features = out_features
@@ -530,6 +567,13 @@ class WeightOnlyGroupwiseQuantRowLinear(Module):
         else:
             self.register_parameter('pre_quant_scale', None)
 
+        if act_order:
+            # See WeightOnlyGroupwiseQuantLinear
+            self.act_order_perm = Parameter(shape=(self.in_features, ),
+                                            dtype="int32")
+        else:
+            self.register_parameter('act_order_perm', None)
+
         if zero:
             self.zero = Parameter(shape=scale_shape, dtype=dtype)
         else:
@@ -548,11 +592,14 @@ class WeightOnlyGroupwiseQuantRowLinear(Module):
         pre_quant_scale = self.pre_quant_scale.value if self.pre_quant_scale else None
         zero = self.zero.value if self.zero else None
         bias = self.bias.value if self.bias else None
+        act_order_perm = self.act_order_perm.value if self.act_order_perm else None
 
         x = weight_only_groupwise_quant_matmul(x, pre_quant_scale,
                                                self.qweight.value,
                                                self.scale.value, zero, bias,
-                                               self.quant_algo, self.group_size)
+                                               self.quant_algo,
+                                               self.group_size,
+                                               act_order_perm=act_order_perm)
         if self.tp_size > 1 and self.tp_group is not None:
             x = allreduce(x, self.tp_group, workspace)
 
@@ -601,7 +648,11 @@ class SmoothQuantMLP(Module):
         else:
             self.register_parameter('quantization_scaling_factor', None)
 
-    def forward(self, hidden_states, workspace=None, lora_layer_params=None):
+    def forward(self,
+                hidden_states,
+                workspace=None,
+                lora_layer_params=None,
+                residual=None):
         inter = self.fc(hidden_states)
         inter = ACT2FN[self.hidden_act](inter)
         if default_net(
@@ -617,7 +668,8 @@ class SmoothQuantMLP(Module):
                 # Quantize per token outputs tuple:
                 # quantized tensor and scaling factors per token
                 inter = quantize_per_token(inter)
-        output = self.proj(inter, workspace)
+        # Returns residual + mlp(hidden_states) if residual is given
+        output = self.proj(inter, workspace, residual=residual)
         return output
 
 
@@ -942,8 +994,31 @@ class SmoothQuantGatedMLP(SmoothQuantMLP):
         else:
             self.register_parameter('quantization_scaling_factor', None)
 
-    def forward(self, hidden_states, workspace=None, lora_layer_params=None):
+    def forward(self,
+                hidden_states,
+                workspace=None,
+                lora_layer_params=None,
+                residual=None):
         assert lora_layer_params is None, "lora is not supported on SmoothQuantGatedMLP now"
+        if default_net().plugin_config.gated_activation_plugin \
+                and self.hidden_act in GATED_ACTIVATION_TYPES \
+                and self.quant_mode.has_act_and_weight_quant():
+            # The activation, the product, the smoothing and the quantization
+            # in one pass over the outputs of the GEMMs
+            gate_up = concat(
+                [self.fc(hidden_states),
+                 self.gate(hidden_states)], dim=-1)
+            static_scaling = self.quant_mode.has_act_static_scaling()
+            inter_x_gate = gated_activation(
+                gate_up,
+                self.hidden_act,
+                smoother=self.proj.smoother.value,
+                scale=self.quantization_scaling_factor.value
+                if static_scaling else None,
+                output_dtype='int8',
+                dynamic_act_scaling=not static_scaling)
+            return self.proj(inter_x_gate, workspace, residual=residual)
+
         inter = self.fc(hidden_states)
         inter = ACT2FN[self.hidden_act](inter)
         gate = self.gate(hidden_states)
@@ -962,7 +1037,8 @@ class SmoothQuantGatedMLP(SmoothQuantMLP):
                 # quantized tensor and scaling factors per token
                 inter_x_gate = quantize_per_token(inter_x_gate)
 
-        output = self.proj(inter_x_gate, workspace)
+        # Returns residual + mlp(hidden_states) if residual is given
+        output = self.proj(inter_x_gate, workspace, residual=residual)
         return output
 
 
@@ -36,6 +36,12 @@ class QuantMode(IntFlag):
     FP8_KV_CACHE = auto()
     # FP8 QDQ
     FP8_QDQ = auto()
+    # The 8-bit KV cache uses one scaling factor per (block, head) stored next
+    # to each paged block.
+    KV_CACHE_BLOCK_SCALING = auto()
+    # The scale of the 8-bit KV cache is recalibrated at run time from the
+    # absmax of the keys and values of the requests.
+    KV_CACHE_ONLINE_SCALING = auto()
 
     # The smallest power-of-two that is not used by a flag. Do not call auto() after that line.
     COUNT = auto()
@@ -94,6 +100,14 @@ class QuantMode(IntFlag):
     def has_kv_cache_quant(self):
         return self.has_int8_kv_cache() or self.has_fp8_kv_cache()
 
+    def has_kv_cache_block_scaling(self):
+        return self.has_kv_cache_quant() and self._any(
+            self.KV_CACHE_BLOCK_SCALING)
+
+    def has_kv_cache_online_scaling(self):
+        return self.has_kv_cache_quant() and self._any(
+            self.KV_CACHE_ONLINE_SCALING)
+
     def has_fp8_qdq(self):
         return self._any(self.FP8_QDQ)
 
@@ -108,6 +122,12 @@ class QuantMode(IntFlag):
     def set_fp8_kv_cache(self):
         return self | self.FP8_KV_CACHE
 
+    def set_kv_cache_block_scaling(self):
+        return self | self.KV_CACHE_BLOCK_SCALING
+
+    def set_kv_cache_online_scaling(self):
+        return self | self.KV_CACHE_ONLINE_SCALING
+
     def set_fp8_qdq(self):
         return self | self.FP8_QDQ
 
@@ -120,7 +140,9 @@ class QuantMode(IntFlag):
                          use_int4_weights=False,
                          use_int8_kv_cache=False,
                          use_fp8_kv_cache=False,
-                         use_fp8_qdq=False):
+                         use_fp8_qdq=False,
+                         use_kv_cache_block_scaling=False,
+                         use_kv_cache_online_scaling=False):
 
         def raise_error():
             raise ValueError(f"Unsupported combination of QuantMode args: "
@@ -132,7 +154,9 @@ class QuantMode(IntFlag):
                              f"{use_int4_weights=}"
                              f"{use_int8_kv_cache=}"
                              f"{use_fp8_kv_cache=}"
-                             f"{use_fp8_qdq=}")
+                             f"{use_fp8_qdq=}"
+                             f"{use_kv_cache_block_scaling=}"
+                             f"{use_kv_cache_online_scaling=}")
 
         # We must quantize weights when we quantize activations.
         if quantize_activations and not quantize_weights:
@@ -174,6 +198,18 @@ class QuantMode(IntFlag):
         if use_fp8_qdq:
             mode = mode | QuantMode.FP8_QDQ
 
+        # Per-block scales for the paged KV cache
+        if use_kv_cache_block_scaling:
+            if not (use_int8_kv_cache or use_fp8_kv_cache):
+                raise_error()
+            mode = mode | QuantMode.KV_CACHE_BLOCK_SCALING
+
+        # Scale of the KV cache recalibrated at run time
+        if use_kv_cache_online_scaling:
+            if not (use_int8_kv_cache or use_fp8_kv_cache):
+                raise_error()
+            mode = mode | QuantMode.KV_CACHE_ONLINE_SCALING
+
         return mode
 
     @staticmethod
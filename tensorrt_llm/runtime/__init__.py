@@ -12,12 +12,15 @@
 # WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 # See the License for the specific language governing permissions and
 # limitations under the License.
+from .batch_executor import BatchExecutor
+from .batch_scheduler import BatchScheduler, LlmRequest, SchedulerPolicy
 from .generation import SamplingConfig  # autoflake: skip
 from .generation import (ChatGLMGenerationSession, GenerationSession,
                          LogitsProcessor, LogitsProcessorList, ModelConfig,
                          QWenForCausalLMGenerationSession, StoppingCriteria,
                          StoppingCriteriaList, to_word_list_format)
-from .kv_cache_manager import GenerationSequence, KVCacheManager
+from .kv_cache_manager import GenerationSequence, KVCacheArena, KVCacheManager
+from .kv_cache_transceiver import KVCacheTransceiver
 from .lora_manager import LoraManager  # autoflake: skip
 from .model_runner import ModelRunner
 from .session import Session, TensorInfo
@@ -29,10 +32,16 @@ except ImportError:
     PYTHON_BINDINGS = False
 
 __all__ = [
+    'BatchExecutor',
+    'BatchScheduler',
+    'LlmRequest',
+    'SchedulerPolicy',
     'ModelConfig',
     'GenerationSession',
     'GenerationSequence',
+    'KVCacheArena',
     'KVCacheManager',
+    'KVCacheTransceiver',
     'LoraManager'
     'SamplingConfig',
     'Session',
@@ -0,0 +1,327 @@
+# SPDX-FileCopyrightText: Copyright (c) 2022-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+from typing import List, Optional, Tuple
+
+import torch
+
+from .batch_scheduler import (BatchScheduler, LlmRequest, LlmRequestState,
+                              PreemptionMode)
+from .generation import (ChatGLMGenerationSession, GenerationSession,
+                         RuntimeTensor)
+from .kv_cache_manager import GenerationSequence, KVCacheManager
+
+
+class BatchExecutor(object):
+    """
+    Runs requests in flight on a GenerationSession, one iteration of
+    in-flight batching per step(), with the requests of each iteration
+    selected by a BatchScheduler. Context chunks and generation tokens of
+    the scheduled requests run together in one packed engine call, and the
+    next token of every request is picked greedily.
+
+    The engine must be built with the GPT attention plugin, the paged KV
+    cache and removed input padding, for a GPT-style model without pipeline
+    parallelism, LoRA, prompt tuning or all token logits. Context chunks run
+    after the tokens already in the KV cache, which needs
+    use_paged_context_fmha when the scheduler has a context_chunk_size or
+    reuses blocks. Requests have a beam width of 1. A request paused with
+    PreemptionMode.RECOMPUTE runs its generated tokens again as context, so
+    the max_input_len of the engine must cover them.
+
+    The session must be set up with GenerationSession.setup() for at least
+    the max_batch_size of the scheduler, and the kv_cache_manager of the
+    scheduler must be made by create_kv_cache_manager().
+
+    With overlap_scheduling, the next iteration is scheduled by
+    BatchScheduler.schedule_next_requests() while the engine runs the
+    current one. Requests added in the meantime wait for the iteration after.
+    """
+
+    def __init__(self,
+                 session: GenerationSession,
+                 scheduler: BatchScheduler,
+                 end_id: int,
+                 overlap_scheduling: bool = False):
+        assert session.use_gpt_attention_plugin and session.paged_kv_cache and session.remove_input_padding, \
+            "BatchExecutor needs the GPT attention plugin, the paged KV cache and removed input padding"
+        assert not session.mapping.has_pp() and not session.cross_attention
+        assert not session.gather_all_token_logits and not session.use_lora_plugin and \
+            session.max_prompt_embedding_table_size == 0
+        assert not isinstance(session, ChatGLMGenerationSession), \
+            "BatchExecutor only supports GPT position ids"
+        assert session.buffer_allocated and scheduler.max_batch_size <= session.batch_size, \
+            "The session must be set up for the max_batch_size of the scheduler"
+        self.session = session
+        self.scheduler = scheduler
+        self.kv_cache_manager = scheduler.kv_cache_manager
+        self.end_id = end_id
+        self.overlap_scheduling = overlap_scheduling
+        # Requests in flight, in order of arrival
+        self.requests: List[LlmRequest] = []
+        # Requests to run and to pause in the next iteration, with
+        # overlap_scheduling
+        self._next_schedule: Optional[Tuple[List[LlmRequest],
+                                            List[LlmRequest]]] = None
+
+    @staticmethod
+    def create_kv_cache_manager(session: GenerationSession,
+                                blocks: Optional[int] = None,
+                                **kwargs) -> KVCacheManager:
+        """
+        Returns a KVCacheManager of the memory pools allocated by
+        session.setup(), with all their blocks unless blocks is given.
+        kwargs are passed to KVCacheManager, e.g. enable_block_reuse.
+        """
+        window_sizes = session._paged_kv_cache_window_sizes()
+        if blocks is None:
+            blocks = [
+                session.batch_size * session._max_blocks_per_seq(w)
+                for w in window_sizes
+            ]
+        memory_pools = [
+            session.buffer[f'present_key_value_{i}']
+            for i in range(session.first_layer, session.last_layer)
+        ]
+        return KVCacheManager(memory_pools,
+                              blocks,
+                              session.tokens_per_block,
+                              session._max_blocks_per_seq(),
+                              window_sizes,
+                              num_kv_heads=session.num_heads_kv,
+                              **kwargs)
+
+    def add_request(self, request: LlmRequest):
+        assert request.beam_width == 1, "BatchExecutor only supports a beam width of 1"
+        assert request.prompt_len <= self.session.max_context_length and \
+            request.prompt_len + request.max_new_tokens <= self.session.max_seq_length, \
+            "The request does not fit the lengths the session is set up for"
+        self.requests.append(request)
+
+    def has_requests(self) -> bool:
+        return len(self.requests) > 0
+
+    def step(self) -> List[LlmRequest]:
+        """
+        Runs one iteration. Returns the requests that completed in it, which
+        are removed from the executor and have released their blocks, and
+        the requests the scheduler rejected, in REQUEST_STATE_ERROR.
+        """
+        schedule = self._next_schedule
+        self._next_schedule = None
+        scheduled, rejected = self._schedule(schedule)
+        if len(scheduled) == 0 and self.has_requests():
+            # The blocks of the paused requests, and of the ones that
+            # completed after the iteration was scheduled, are free now
+            scheduled, more_rejected = self._schedule()
+            rejected += more_rejected
+            if len(scheduled) == 0 and self.has_requests():
+                raise RuntimeError(
+                    "None of the requests in flight fits the KV cache")
+        if len(scheduled) == 0:
+            return rejected
+        self._prepare(scheduled)
+
+        # The attention plugin takes the context requests first
+        batch = [r for r in scheduled if r.is_context_init_state()] + \
+            [r for r in scheduled if r.is_generation_in_progress_state()]
+        logits = self._run(batch)
+        new_tokens = logits.argmax(dim=-1)
+        if self.overlap_scheduling:
+            next_iteration = self.scheduler.schedule_next_requests(
+                self.requests, scheduled)
+        new_tokens = new_tokens.tolist()
+
+        finished = []
+        for request, token in zip(batch, new_tokens):
+            if request.is_context_init_state():
+                request.move_to_next_context_chunk()
+                if request.is_context_init_state():
+                    # The logits of a chunk before the last are not used
+                    continue
+            request.add_new_token(token)
+            if token == self.end_id or \
+                    request.num_generated_tokens >= request.max_new_tokens:
+                request.state = LlmRequestState.REQUEST_STATE_GENERATION_COMPLETE
+                finished.append(request)
+        for request in finished:
+            self.kv_cache_manager.remove_sequence(request.sequence)
+            self.requests.remove(request)
+
+        if self.overlap_scheduling:
+            self._next_schedule = self.scheduler.fix_up_next_requests(
+                next_iteration, finished)
+        return rejected + finished
+
+    def run(self, requests: List[LlmRequest]) -> List[LlmRequest]:
+        """
+        Adds the requests and steps until all the requests in flight
+        complete or are rejected. Returns them in order of completion.
+        """
+        for request in requests:
+            self.add_request(request)
+        completed = []
+        while self.has_requests():
+            completed += self.step()
+        return completed
+
+    def _schedule(
+        self,
+        schedule: Optional[Tuple[List[LlmRequest], List[LlmRequest]]] = None
+    ) -> Tuple[List[LlmRequest], List[LlmRequest]]:
+        """
+        Schedules the requests in flight unless a schedule is given, and
+        pauses the ones to pause. Returns the requests to run and the
+        rejected ones, which are removed from the executor.
+        """
+        if schedule is None:
+            schedule = self.scheduler.schedule_requests(self.requests)
+        scheduled, to_pause = schedule
+        self._pause(to_pause)
+        rejected = [
+            request for request in self.requests if request.is_error_state()
+        ]
+        for request in rejected:
+            self.requests.remove(request)
+        return scheduled, rejected
+
+    def _pause(self, to_pause: List[LlmRequest]):
+        manager = self.kv_cache_manager
+        for request in to_pause:
+            if request.preemption_mode == PreemptionMode.SWAP:
+                manager.swap_out(request.sequence)
+            else:
+                manager.remove_sequence(request.sequence)
+                request.pause()
+
+    def _prepare(self, scheduled: List[LlmRequest]):
+        """
+        Adds the sequences of the requests starting their context, swaps in
+        the swapped ones and allocates the slot of the token of the
+        generation requests.
+        """
+        manager = self.kv_cache_manager
+        generation = []
+        for request in scheduled:
+            if request.sequence is None:
+                request.sequence = GenerationSequence(
+                    seq_idx=request.request_id,
+                    batch_idx=len(manager.sequences))
+                input_ids = request.tokens[:request.prompt_len] \
+                    if manager.enable_block_reuse else None
+                num_cached_tokens = manager.add_sequence(
+                    request.sequence,
+                    request.prompt_len,
+                    input_ids=input_ids,
+                    cache_key=request.cache_key)
+                # Only the tokens not in the reused blocks are computed
+                request.context_current_position = num_cached_tokens
+                request.context_chunk_size = min(
+                    request.context_chunk_size,
+                    request.context_remaining_length)
+            elif manager.is_swapped(request.sequence):
+                manager.swap_in(request.sequence)
+            if request.is_generation_in_progress_state():
+                generation.append(request.sequence)
+        manager.add_tokens(generation)
+
+    def _get_step_inputs(
+        self, batch: List[LlmRequest]
+    ) -> Tuple[List[int], List[int], List[int], List[int], List[int]]:
+        """
+        Returns the packed input ids and position ids, and per request the
+        number of input tokens, the length of the KV cache after the step
+        and the request type.
+        """
+        input_ids = []
+        position_ids = []
+        num_input_tokens = []
+        kv_lengths = []
+        request_types = []
+        for request in batch:
+            if request.is_context_init_state():
+                past_length = request.context_current_position
+                tokens = request.tokens[past_length:past_length +
+                                        request.context_chunk_size]
+                request_types.append(0)
+            else:
+                past_length = request.num_tokens - 1
+                tokens = request.tokens[-1:]
+                request_types.append(1)
+            input_ids += tokens
+            position_ids += range(past_length, past_length + len(tokens))
+            num_input_tokens.append(len(tokens))
+            kv_lengths.append(past_length + len(tokens))
+        return input_ids, position_ids, num_input_tokens, kv_lengths, request_types
+
+    def _run(self, batch: List[LlmRequest]) -> torch.Tensor:
+        """
+        Enqueues the engine on the requests of batch, the context requests
+        first. Returns the logits of their last input token.
+        """
+        session = self.session
+        device = session.device
+        batch_size = len(batch)
+        input_ids, position_ids, num_input_tokens, kv_lengths, request_types = \
+            self._get_step_inputs(batch)
+        to_device = lambda values: torch.tensor(
+            values, dtype=torch.int32, device=device)
+        to_host = lambda values: torch.tensor(values, dtype=torch.int32)
+        # The context lengths of the generation requests are their prompt
+        context_lengths = [
+            num_tokens if request_type == 0 else request.prompt_len
+            for request, num_tokens, request_type in zip(
+                batch, num_input_tokens, request_types)
+        ]
+
+        # The rows of the scheduled sequences in the pointer arrays of the
+        # manager, which hold all its sequences
+        batch_indices = torch.tensor(
+            [request.sequence.get_batch_idx() for request in batch],
+            dtype=torch.int64)
+        host_kv_cache_block_pointers = [
+            pointer_array.index_select(0, batch_indices)
+            for pointer_array in self.kv_cache_manager.get_pointer_arrays(1)
+        ]
+        kv_cache_block_pointers = [
+            pointer_array.to(device)
+            for pointer_array in host_kv_cache_block_pointers
+        ]
+        cache_indirection = torch.zeros(
+            (batch_size, 1, session.max_attention_window_size),
+            dtype=torch.int32,
+            device=device)
+        last_token_ids = torch.cumsum(to_device(num_input_tokens),
+                                      dim=0,
+                                      dtype=torch.int32)
+
+        tensors = session._get_context_shape_buffer(
+            to_device(input_ids), to_device(context_lengths),
+            to_host(context_lengths), to_device(position_ids), last_token_ids,
+            None, cache_indirection, kv_cache_block_pointers,
+            host_kv_cache_block_pointers)
+        # Context chunks and generation tokens follow the tokens in the cache
+        for name, tensor in [
+            ('sequence_length', to_device(kv_lengths)),
+            ('host_past_key_value_lengths', to_host(kv_lengths)),
+            ('host_request_types', to_host(request_types)),
+        ]:
+            tensors[name] = RuntimeTensor.from_torch(name, tensor)
+
+        context = session.runtime.ctx_context
+        session.runtime._set_tensors(context, tensors)
+        stream = torch.cuda.current_stream().cuda_stream
+        if not session.runtime._run(context, stream):
+            raise RuntimeError('Executing TRT engine failed!')
+        return session.buffer['logits'][:batch_size]
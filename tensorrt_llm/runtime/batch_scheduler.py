@@ -0,0 +1,563 @@
+# SPDX-FileCopyrightText: Copyright (c) 2022-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+import copy
+import math
+from enum import IntEnum
+from typing import Hashable, List, Optional, Sequence, Tuple
+
+from .kv_cache_manager import (BlockPrefixTree, GenerationSequence,
+                               KVCacheManager)
+
+
+class LlmRequestState(IntEnum):
+    REQUEST_STATE_UNKNOWN = 0
+    REQUEST_STATE_CONTEXT_INIT = 1
+    REQUEST_STATE_GENERATION_IN_PROGRESS = 2
+    REQUEST_STATE_GENERATION_COMPLETE = 3
+    # Rejected by the scheduler, see LlmRequest.error_msg
+    REQUEST_STATE_ERROR = 4
+
+
+class SchedulerPolicy(IntEnum):
+    # Schedule as many requests as the free blocks allow for the next step,
+    # started requests that do not fit are paused
+    MAX_UTILIZATION = 0
+    # Only schedule a new request if the blocks it needs to complete are free
+    GUARANTEED_NO_EVICT = 1
+
+
+class PreemptionMode(IntEnum):
+    # Free the blocks and run the context again, with the generated tokens
+    RECOMPUTE = 0
+    # Move the blocks to host memory and back on resume
+    SWAP = 1
+
+
+class LlmRequest(object):
+    """
+    State of a request in flight, as seen by the BatchScheduler.
+
+    The context of a request may run in several chunks. The executor runs
+    context_chunk_size tokens from context_current_position when the request
+    is scheduled in the context phase, then calls move_to_next_context_chunk().
+    Generated tokens are added with add_new_token().
+    """
+
+    def __init__(self,
+                 request_id: int,
+                 input_tokens: Sequence[int],
+                 max_new_tokens: int,
+                 beam_width: int = 1,
+                 priority: int = 0,
+                 deadline: Optional[float] = None,
+                 cache_key: Optional[Hashable] = None):
+        self.request_id = request_id
+        self.input_tokens = input_tokens
+        # Prompt and generated tokens
+        self.tokens = list(input_tokens)
+        self.prompt_len = len(input_tokens)
+        self.max_new_tokens = max_new_tokens
+        self.num_generated_tokens = 0
+        self.beam_width = beam_width
+        # Requests of a higher priority class go first, then the ones with
+        # the earliest deadline, e.g. a time.monotonic() timestamp
+        self.priority = priority
+        self.deadline = deadline
+        # Passed to KVCacheManager.add_sequence() for block reuse
+        self.cache_key = cache_key
+        self.state = LlmRequestState.REQUEST_STATE_CONTEXT_INIT
+        # Context tokens already run, and tokens to run in this iteration
+        self.context_current_position = 0
+        self.context_chunk_size = 0
+        # Sequence in the KVCacheManager, set by the executor when the first
+        # context chunk is run
+        self.sequence: Optional[GenerationSequence] = None
+        # How to preempt the request, set when the scheduler pauses it
+        self.preemption_mode = PreemptionMode.RECOMPUTE
+        # Set once the context blocks are published for reuse
+        self.context_blocks_stored = False
+        # Iterations the request was held back for a sibling, see
+        # BatchScheduler
+        self.prefix_wait_iterations = 0
+        # Why the request was rejected, in REQUEST_STATE_ERROR
+        self.error_msg: Optional[str] = None
+
+    def is_context_init_state(self) -> bool:
+        return self.state == LlmRequestState.REQUEST_STATE_CONTEXT_INIT
+
+    def is_generation_in_progress_state(self) -> bool:
+        return self.state == LlmRequestState.REQUEST_STATE_GENERATION_IN_PROGRESS
+
+    def is_generation_complete_state(self) -> bool:
+        return self.state == LlmRequestState.REQUEST_STATE_GENERATION_COMPLETE
+
+    def is_error_state(self) -> bool:
+        return self.state == LlmRequestState.REQUEST_STATE_ERROR
+
+    def set_error(self, error_msg: str):
+        self.state = LlmRequestState.REQUEST_STATE_ERROR
+        self.error_msg = error_msg
+
+    @property
+    def context_remaining_length(self) -> int:
+        return self.prompt_len - self.context_current_position
+
+    def is_last_context_chunk(self) -> bool:
+        return self.context_chunk_size == self.context_remaining_length
+
+    def move_to_next_context_chunk(self):
+        self.context_current_position += self.context_chunk_size
+        self.context_chunk_size = 0
+        if self.context_remaining_length == 0:
+            self.state = LlmRequestState.REQUEST_STATE_GENERATION_IN_PROGRESS
+
+    @property
+    def num_tokens(self) -> int:
+        return len(self.tokens)
+
+    def add_new_token(self, token: int):
+        self.tokens.append(token)
+        self.num_generated_tokens += 1
+
+    def pause(self):
+        """
+        Resets a request whose blocks were freed. The generated tokens become
+        part of the prompt, which is run again when the request is resumed.
+        """
+        self.prompt_len = self.num_tokens
+        self.max_new_tokens -= self.num_generated_tokens
+        self.num_generated_tokens = 0
+        self.context_current_position = 0
+        self.context_chunk_size = 0
+        self.state = LlmRequestState.REQUEST_STATE_CONTEXT_INIT
+        self.sequence = None
+        self.context_blocks_stored = False
+
+
+class NextIteration(object):
+    """
+    Schedule of the iteration after the one running on the GPU, made by
+    BatchScheduler.schedule_next_requests(). The running requests it holds
+    are projected copies of them, mapped back by fix_up_next_requests().
+    """
+
+    def __init__(self, scheduled: List[LlmRequest],
+                 to_pause: List[LlmRequest],
+                 projected: List[Tuple[LlmRequest, LlmRequest]]):
+        self.scheduled = scheduled
+        self.to_pause = to_pause
+        # Projected copy and running request pairs
+        self.projected = projected
+
+
+class BatchScheduler(object):
+    """
+    Selects the requests to run in the next iteration of in-flight batching,
+    based on the KV cache blocks they need.
+
+    With max_num_tokens, the tokens run by an iteration, context plus
+    generation tokens, are bounded as well. The budget is filled greedily:
+    one token per beam of every generation request first, then the
+    contexts in order of arrival, so the GPU time of an iteration does not
+    depend on how many of its requests are in the context phase. A queued
+    request that can never run within the budget, e.g. a context longer than
+    max_num_tokens without a context_chunk_size, is set to
+    REQUEST_STATE_ERROR and not scheduled. The executor completes it with
+    its error_msg.
+
+    With a context_chunk_size, contexts are split into chunks of at most
+    context_chunk_size tokens. Each iteration first runs one token per beam
+    of every scheduled generation request. The chunks of scheduled contexts
+    then fill the rest of the max_num_tokens budget. A long prompt therefore
+    no longer stalls the generation requests in flight for a whole context
+    phase. All chunks but the last one are a multiple of tokens_per_block.
+    The blocks of the whole context are reserved when its first chunk is
+    scheduled.
+
+    MAX_UTILIZATION pauses the started requests that do not fit. Their
+    preemption_mode tells the executor how to free them: with RECOMPUTE
+    it frees the sequence with KVCacheManager.remove_sequence() and calls
+    LlmRequest.pause(); with SWAP it calls KVCacheManager.swap_out(). A
+    swapped request is scheduled again once its blocks fit, and the
+    executor calls KVCacheManager.swap_in() before running it.
+    Recomputing a context gets more expensive per token as it grows, since
+    attention is quadratic in its length, while swapping moves the same
+    number of bytes per token. Requests of at least swap_min_tokens tokens
+    are therefore swapped and shorter ones recomputed, while the swap space
+    of the KV cache manager, see its swap_space_bytes, holds their blocks.
+    Without swap_min_tokens all requests are recomputed.
+
+    Requests are taken in order of arrival. With order_by_priority they are
+    ordered by priority class, highest first, then by earliest deadline
+    within a class, so interactive requests are admitted before batch ones.
+    MAX_UTILIZATION then pauses the lowest priority requests first, which
+    frees their blocks for the higher priority ones.
+
+    Scheduling normally waits for the outputs of the running iteration.
+    schedule_next_requests() instead schedules the next iteration while the
+    GPU runs the current one, assuming none of the running requests
+    finishes: running contexts are taken as having run their chunk. Once
+    the running iteration is synced and its requests are updated,
+    fix_up_next_requests() drops the requests that finished. The blocks
+    and batch slots they free are only used from the iteration after, in
+    exchange the host work of scheduling is hidden behind the GPU step.
+
+    With prefix_affinity, which needs block reuse, the KV cache manager only
+    publishing blocks when a sequence is released no longer stops requests
+    from sharing a prompt prefix with a request in flight. The full context
+    blocks of started requests are published once their context has run.
+    Queued requests whose longest cached prefix is the same are scheduled
+    next to each other, while their blocks are cached. A queued request
+    sharing more full blocks with a request in flight, or with a queued
+    request ahead of it, than the cache holds is held back until these
+    blocks are published, for at most max_prefix_wait_iterations
+    iterations. It then runs only the tokens not computed yet.
+
+    BatchExecutor runs the scheduled iterations on a GenerationSession.
+    """
+
+    def __init__(self,
+                 max_batch_size: int,
+                 kv_cache_manager: KVCacheManager,
+                 scheduler_policy: SchedulerPolicy = SchedulerPolicy.
+                 GUARANTEED_NO_EVICT,
+                 context_chunk_size: Optional[int] = None,
+                 max_num_tokens: Optional[int] = None,
+                 swap_min_tokens: Optional[int] = None,
+                 order_by_priority: bool = False,
+                 prefix_affinity: bool = False,
+                 max_prefix_wait_iterations: int = 4):
+        tokens_per_block = kv_cache_manager.tokens_per_block
+        if context_chunk_size is not None:
+            assert context_chunk_size > 0 and context_chunk_size % tokens_per_block == 0, \
+                "context_chunk_size must be a multiple of tokens_per_block"
+        self.max_batch_size = max_batch_size
+        self.kv_cache_manager = kv_cache_manager
+        self.scheduler_policy = scheduler_policy
+        self.context_chunk_size = context_chunk_size
+        self.max_num_tokens = max_num_tokens
+        self.swap_min_tokens = swap_min_tokens
+        self.order_by_priority = order_by_priority
+        if prefix_affinity:
+            assert kv_cache_manager.enable_block_reuse, \
+                "prefix_affinity needs enable_block_reuse"
+        self.prefix_affinity = prefix_affinity
+        self.max_prefix_wait_iterations = max_prefix_wait_iterations
+
+    def _order_by_priority(self,
+                           requests: List[LlmRequest]) -> List[LlmRequest]:
+        if not self.order_by_priority:
+            return requests
+        # Stable, so requests of the same class and deadline stay FIFO
+        return sorted(requests,
+                      key=lambda r: (-r.priority, math.inf
+                                     if r.deadline is None else r.deadline))
+
+    def schedule_requests(
+        self, requests: List[LlmRequest]
+    ) -> Tuple[List[LlmRequest], List[LlmRequest]]:
+        """
+        Takes the requests in flight in order of arrival.
+        Returns the requests to run in this iteration, generation requests
+        first, and the started requests to pause, whose blocks are freed.
+        Queued requests that exceed the token budget are rejected.
+        """
+        requests = [
+            request for request in self._order_by_priority(requests)
+            if self._fits_token_budget(request)
+        ]
+        if self.prefix_affinity:
+            requests = self._order_by_prefix(requests)
+        if self.scheduler_policy == SchedulerPolicy.MAX_UTILIZATION:
+            scheduled, to_pause = self._schedule_max_utilization(requests)
+        else:
+            scheduled, to_pause = self._schedule_guaranteed_no_evict(requests)
+        return self._fit_token_budget(scheduled), to_pause
+
+    def schedule_next_requests(self, requests: List[LlmRequest],
+                               running: List[LlmRequest]) -> NextIteration:
+        """
+        Schedules the iteration after the running one, before its outputs
+        are synced. requests holds all requests in flight, in order of
+        arrival, including the running ones. The executor must have
+        allocated the blocks of the running iteration, with
+        KVCacheManager.add_tokens() or add_sequence(), and must not update
+        the requests until fix_up_next_requests().
+        """
+        running_ids = set(id(request) for request in running)
+        projected = []
+        projected_requests = []
+        for request in requests:
+            if id(request) in running_ids:
+                running_request = request
+                request = copy.copy(running_request)
+                if request.is_context_init_state():
+                    request.move_to_next_context_chunk()
+                projected.append((request, running_request))
+            projected_requests.append(request)
+        scheduled, to_pause = self.schedule_requests(projected_requests)
+        return NextIteration(scheduled, to_pause, projected)
+
+    def fix_up_next_requests(
+        self, next_iteration: NextIteration, finished: List[LlmRequest]
+    ) -> Tuple[List[LlmRequest], List[LlmRequest]]:
+        """
+        Called once the running iteration is synced and the executor has
+        updated its requests. Returns the requests to run in the next
+        iteration and the requests to pause, as schedule_requests(), without
+        the finished requests.
+        """
+        running_requests = {}
+        for projection, request in next_iteration.projected:
+            request.context_blocks_stored |= projection.context_blocks_stored
+            running_requests[id(projection)] = request
+        finished_ids = set(id(request) for request in finished)
+
+        def fix_up(requests: List[LlmRequest]) -> List[LlmRequest]:
+            fixed_requests = []
+            for request in requests:
+                running_request = running_requests.get(id(request))
+                if running_request is not None:
+                    chunk_size = request.context_chunk_size
+                    running_request.context_chunk_size = chunk_size
+                    running_request.preemption_mode = request.preemption_mode
+                    request = running_request
+                if id(request) not in finished_ids:
+                    fixed_requests.append(request)
+            return fixed_requests
+
+        return fix_up(next_iteration.scheduled), fix_up(
+            next_iteration.to_pause)
+
+    def _is_queued(self, request: LlmRequest) -> bool:
+        return request.sequence is None and request.is_context_init_state()
+
+    def _fits_token_budget(self, request: LlmRequest) -> bool:
+        """
+        Returns whether the request can ever run within max_num_tokens.
+        Rejects a queued request that cannot.
+        """
+        if request.is_error_state():
+            return False
+        if self.max_num_tokens is None or not self._is_queued(request):
+            return True
+        max_num_tokens = self.max_num_tokens
+        remaining_length = request.context_remaining_length
+        if request.beam_width > max_num_tokens:
+            request.set_error(
+                f"Beam width {request.beam_width} exceeds max_num_tokens "
+                f"{max_num_tokens}")
+            return False
+        # All chunks but the last one are a multiple of tokens_per_block
+        if remaining_length > max_num_tokens and (
+                self.context_chunk_size is None or
+                max_num_tokens < self.kv_cache_manager.tokens_per_block):
+            request.set_error(
+                f"Context of {remaining_length} tokens exceeds max_num_tokens "
+                f"{max_num_tokens}, set a context_chunk_size")
+            return False
+        return True
+
+    def _order_by_prefix(self, requests: List[LlmRequest]) -> List[LlmRequest]:
+        manager = self.kv_cache_manager
+        tokens_per_block = manager.tokens_per_block
+        # Requests whose context blocks are not published yet
+        publishers = []
+        for request in requests:
+            if not self._holds_blocks(request) or request.context_blocks_stored:
+                continue
+            if request.is_generation_in_progress_state():
+                manager.store_context_blocks(request.sequence)
+                request.context_blocks_stored = True
+            else:
+                publishers.append(request)
+
+        # Queued requests with the same cached prefix are grouped, a group
+        # takes the place of its first request
+        groups = {}
+        queued = [request for request in requests if self._is_queued(request)]
+        for request in queued:
+            tokens = request.tokens[:request.prompt_len]
+            num_cached_tokens = manager.get_num_cached_tokens(
+                tokens, request.cache_key)
+            num_cached_tokens -= num_cached_tokens % tokens_per_block
+            key = (request.priority, request.cache_key,
+                   tuple(tokens[:num_cached_tokens])
+                   ) if num_cached_tokens > 0 else request
+            groups.setdefault(key, []).append((request, num_cached_tokens))
+        grouped = [member for group in groups.values() for member in group]
+
+        ordered = []
+        for request, num_cached_tokens in grouped:
+            max_wait = self.max_prefix_wait_iterations
+            if request.prefix_wait_iterations < max_wait and any(
+                    self._get_num_shared_tokens(request, publisher) >
+                    num_cached_tokens for publisher in publishers):
+                request.prefix_wait_iterations += 1
+                continue
+            publishers.append(request)
+            ordered.append(request)
+        ordered = iter(ordered)
+        requests = [
+            next(ordered, None) if self._is_queued(request) else request
+            for request in requests
+        ]
+        return [request for request in requests if request is not None]
+
+    def _get_num_shared_tokens(self, request: LlmRequest,
+                               publisher: LlmRequest) -> int:
+        """
+        Returns the number of tokens of the full context blocks of publisher
+        that request can reuse.
+        """
+        if request.cache_key != publisher.cache_key:
+            return 0
+        tokens_per_block = self.kv_cache_manager.tokens_per_block
+        length = BlockPrefixTree._common_prefix_length(
+            request.tokens[:request.prompt_len],
+            publisher.tokens[:publisher.prompt_len])
+        return length - length % tokens_per_block
+
+    def _get_needed_blocks(self, request: LlmRequest,
+                           to_completion: bool) -> List[int]:
+        manager = self.kv_cache_manager
+        if request.sequence is not None and manager.is_swapped(
+                request.sequence) and not to_completion:
+            return manager.get_needed_blocks_to_swap_in(request.sequence)
+        if request.sequence is None:
+            # The blocks of the whole context are allocated at once
+            return manager.get_needed_blocks_to_completion(
+                request.prompt_len,
+                request.max_new_tokens if to_completion else 0)
+        if to_completion:
+            return manager.get_needed_blocks_to_completion(
+                request.prompt_len, request.max_new_tokens, request.sequence)
+        if request.is_context_init_state():
+            return [0] * len(manager.blocks_managers)
+        return manager.get_needed_blocks_one_step(request.sequence)
+
+    @staticmethod
+    def _try_reserve(free_blocks: List[int], needed_blocks: List[int]) -> bool:
+        if any(n > f for n, f in zip(needed_blocks, free_blocks)):
+            return False
+        for gi, n in enumerate(needed_blocks):
+            free_blocks[gi] -= n
+        return True
+
+    def _holds_blocks(self, request: LlmRequest) -> bool:
+        return request.sequence is not None and \
+            not self.kv_cache_manager.is_swapped(request.sequence)
+
+    def _get_preemption_mode(self, request: LlmRequest,
+                             free_swap_blocks: List[int]) -> PreemptionMode:
+        if self.swap_min_tokens is not None and \
+                request.num_tokens >= self.swap_min_tokens and \
+                self._try_reserve(free_swap_blocks,
+                                  self.kv_cache_manager.get_num_blocks_to_swap_out(
+                                      request.sequence)):
+            return PreemptionMode.SWAP
+        return PreemptionMode.RECOMPUTE
+
+    def _schedule_max_utilization(
+        self, requests: List[LlmRequest]
+    ) -> Tuple[List[LlmRequest], List[LlmRequest]]:
+        free_blocks = self.kv_cache_manager.get_num_free_blocks()
+        scheduled = []
+        for request in requests:
+            if request.is_generation_complete_state():
+                continue
+            if len(scheduled) == self.max_batch_size or not self._try_reserve(
+                    free_blocks,
+                    self._get_needed_blocks(request, to_completion=False)):
+                break
+            scheduled.append(request)
+        to_pause = [
+            request for request in requests
+            if self._holds_blocks(request) and request not in scheduled
+            and not request.is_generation_complete_state()
+        ]
+        free_swap_blocks = self.kv_cache_manager.get_num_free_swap_blocks()
+        for request in to_pause:
+            request.preemption_mode = self._get_preemption_mode(
+                request, free_swap_blocks)
+        return scheduled, to_pause
+
+    def _schedule_guaranteed_no_evict(
+        self, requests: List[LlmRequest]
+    ) -> Tuple[List[LlmRequest], List[LlmRequest]]:
+        free_blocks = self.kv_cache_manager.get_num_free_blocks()
+        active = [
+            request for request in requests
+            if not request.is_generation_complete_state()
+        ]
+        # Started requests keep the blocks they need to complete
+        scheduled = []
+        for request in active:
+            if self._holds_blocks(request):
+                self._try_reserve(
+                    free_blocks,
+                    self._get_needed_blocks(request, to_completion=True))
+                scheduled.append(request)
+        for request in active:
+            if self._holds_blocks(request):
+                continue
+            if len(scheduled) >= self.max_batch_size or not self._try_reserve(
+                    free_blocks,
+                    self._get_needed_blocks(request, to_completion=True)):
+                break
+            scheduled.append(request)
+        return scheduled[:self.max_batch_size], []
+
+    def _fit_token_budget(self,
+                          scheduled: List[LlmRequest]) -> List[LlmRequest]:
+        """
+        Fills the max_num_tokens budget and sets the context chunk of
+        scheduled context requests. Requests that get no token in this
+        iteration are dropped from the scheduled requests; started ones keep
+        their blocks.
+        """
+        max_num_tokens = math.inf if self.max_num_tokens is None else self.max_num_tokens
+        tokens_per_block = self.kv_cache_manager.tokens_per_block
+        num_tokens = 0
+        generation = []
+        for request in scheduled:
+            if not request.is_generation_in_progress_state():
+                continue
+            if num_tokens + request.beam_width > max_num_tokens:
+                break
+            generation.append(request)
+            num_tokens += request.beam_width
+
+        contexts = []
+        for request in scheduled:
+            if not request.is_context_init_state():
+                continue
+            remaining_length = request.context_remaining_length
+            if self.context_chunk_size is None:
+                # Whole contexts are admitted in order while they fit
+                if num_tokens + remaining_length > max_num_tokens:
+                    break
+                chunk_size = remaining_length
+            else:
+                chunk_size = min(remaining_length, self.context_chunk_size,
+                                 max_num_tokens - num_tokens)
+                if chunk_size < remaining_length:
+                    chunk_size -= chunk_size % tokens_per_block
+                if chunk_size <= 0:
+                    continue
+            request.context_chunk_size = chunk_size
+            num_tokens += chunk_size
+            contexts.append(request)
+        return generation + contexts
@@ -18,7 +18,7 @@ import csv
 import math
 from dataclasses import dataclass, field
 from functools import reduce, wraps
-from typing import Dict, Iterable, List, Optional, Sequence, Union
+from typing import Dict, Iterable, List, Optional, Sequence, Tuple, Union
 
 import numpy as np
 
@@ -33,7 +33,8 @@ from .._utils import pad_vocab_size, str_dtype_to_torch, trt_dtype_to_torch
 from ..logger import logger
 from ..mapping import Mapping
 from ..quantization import QuantMode
-from .kv_cache_manager import GenerationSequence, KVCacheManager
+from .kv_cache_manager import (CppKVCacheManager, GenerationSequence,
+                               KVCacheManager)
 from .lora_manager import LoraManager
 from .session import _scoped_stream
 
@@ -137,6 +138,86 @@ def _tile_beam_width(tensor: torch.Tensor, num_beams: int):
     return new_tensor
 
 
+class _IncrementalBeamOutput(object):
+    """
+    Streamed output of a generation, updated step by step.
+
+    gather_tree traces every beam back through its parents over the whole
+    sequence, so streaming its output costs O(length) per step. Here the
+    beams are kept materialized instead. Each step, only the positions after
+    the prefix common to all beams of a request are reordered by the parents
+    of the step, and the new tokens are appended. That common prefix can no
+    longer change, and update() returns the tokens it gained. Beams usually
+    agree again a few tokens back, so a step costs about O(1).
+
+    With use_beam_hyps, a finished hypothesis may still win over the beams
+    in flight, so the prefix of a request stops growing once it has one.
+    """
+
+    def __init__(self, output_ids: torch.Tensor, context_lengths: torch.Tensor,
+                 batch_size: int, beam_width: int):
+        # The input is the same for all beams, the last column takes the
+        # indices of the window beyond the sequence
+        output_ids = output_ids.view(batch_size, beam_width, -1)
+        self.histories = torch.cat(
+            (output_ids, output_ids[:, :, -1:]), dim=-1).clone()
+        self.max_seq_length = output_ids.size(-1)
+        self.context_lengths = context_lengths.long()
+        self.stable_lengths = self.context_lengths.clone()
+        self.done = torch.zeros_like(self.stable_lengths, dtype=torch.bool)
+        self.batch_size = batch_size
+        self.beam_width = beam_width
+
+    def update(self, step: int, output_ids: torch.Tensor,
+               parent_ids: torch.Tensor, finished: torch.Tensor,
+               beam_hyps_num_beams: Optional[torch.Tensor]
+               ) -> List[torch.Tensor]:
+        """
+        Adds the tokens of a step. Returns, per request, the tokens that
+        became common to all its beams.
+        """
+        batch_size, beam_width = self.batch_size, self.beam_width
+        output_ids = output_ids.view(batch_size, beam_width, -1)
+        positions = self.context_lengths + step
+        offsets = self.stable_lengths
+        relative_positions = positions - offsets
+        width = int(relative_positions.max().item()) + 1
+        columns = torch.arange(width, device=positions.device)
+        indices = (offsets[:, None] + columns[None, :]).clamp(
+            max=self.max_seq_length)
+        indices = indices[:, None, :].expand(batch_size, beam_width, width)
+        current = self.histories.gather(2, indices)
+
+        # Each beam continues the history of its parent with its new token
+        step_indices = positions[:, None, None].expand(batch_size, beam_width,
+                                                       1)
+        parents = parent_ids.gather(2, step_indices).long()
+        window = current.gather(1, parents.expand(-1, -1, width))
+        new_tokens = output_ids.gather(2, step_indices)
+        at_step = columns[None, :] == relative_positions[:, None]
+        window = torch.where(at_step[:, None, :], new_tokens, window)
+        valid = (columns[None, :] <= relative_positions[:, None]) & \
+            ~self.done[:, None]
+        window = torch.where(valid[:, None, :], window, current)
+        self.histories.scatter_(2, indices, window)
+
+        # The common prefix grows by the leading positions all beams agree on
+        agree = (window == window[:, :1]).all(dim=1) & valid
+        num_stable = agree.int().cumprod(dim=1).sum(dim=1)
+        if beam_hyps_num_beams is not None:
+            num_stable = torch.where(beam_hyps_num_beams > 0,
+                                     torch.zeros_like(num_stable), num_stable)
+        self.stable_lengths = offsets + num_stable
+        self.done |= finished.view(batch_size, beam_width).ne(0).all(dim=1)
+
+        begins = offsets.tolist()
+        ends = self.stable_lengths.tolist()
+        return [
+            self.histories[bi, 0, begins[bi]:ends[bi]]
+            for bi in range(batch_size)
+        ]
+
+
 class _Runtime(object):
     runtime_rank: int
     runtime: trt.Runtime
@@ -292,6 +373,8 @@ class ModelConfig:
     lora_plugin: bool = False
     lora_target_modules: List[str] = field(default_factory=list)
     use_context_fmha_for_generation: bool = False
+    sliding_window_kv_cache: bool = False
+    block_cache_indirection: bool = False
 
 
 @dataclass
@@ -301,6 +384,13 @@ class SamplingConfig:
 
     max_new_tokens: int = field(default=20)
     num_beams: int = field(default=1)
+    # Number of sequences sampled per prompt. The prompt is computed once and
+    # its KV cache is shared by the samples, which setup() counts as beams.
+    num_return_sequences: int = field(default=1)
+    # Number of most likely tokens returned with their log-probabilities for
+    # each generated step, 0 to disable. Computed on the device by the C++
+    # session.
+    num_top_log_probs: int = field(default=0)
     max_attention_window_size: Optional[int] = field(default=None)
     output_sequence_lengths: bool = field(default=False)
     return_dict: bool = field(default=False)
@@ -451,7 +541,8 @@ class GenerationSession(object):
                  debug_mode=False,
                  debug_tensors_to_save=None,
                  cuda_graph_mode=False,
-                 stream: torch.cuda.Stream = None):
+                 stream: torch.cuda.Stream = None,
+                 use_cpp_kv_cache_manager: bool = False):
         assert isinstance(model_config, ModelConfig)
         self._model_config = model_config
         self.mapping = mapping
@@ -468,12 +559,19 @@ class GenerationSession(object):
         self.debug_tensors_to_save = debug_tensors_to_save
 
         self.cuda_graph_mode = cuda_graph_mode
+        # The paged KV cache is managed by the KV cache manager of the C++
+        # runtime, which is kept across the calls of setup with the same sizes
+        self.use_cpp_kv_cache_manager = use_cpp_kv_cache_manager
+        self.cpp_kv_cache_manager = None
+        self.cpp_kv_cache_manager_config = None
         # Optional inputs for dynamic decoder
         self.top_p_decay = None
         self.top_p_min = None
         self.top_p_reset_ids = None
         #TODO: in tensorrt_llm/cpp/tensorrt_llm/thop/dynamicDecodeOp.cpp it's T, can be float or half?
         self.embedding_bias_opt = None
+        # Sequences sampled per prompt by the current decode()
+        self.num_return_sequences = 1
 
         self.buffer = None
         self.buffer_allocated = False
@@ -485,6 +583,16 @@ class GenerationSession(object):
             logger.warning(
                 "The paged KV cache in Python runtime is experimental. For performance and correctness, please, use C++ runtime."
             )
+        if self.use_cpp_kv_cache_manager:
+            assert self.paged_kv_cache, \
+                "The C++ KV cache manager requires the paged KV cache"
+            assert not self.sliding_window_kv_cache and not self.quant_mode.has_kv_cache_block_scaling(), \
+                "The C++ KV cache manager does not support the sliding window nor the KV cache block scaling"
+        if self.block_cache_indirection:
+            assert self.paged_kv_cache and self.use_gpt_attention_plugin and not self.use_cpp_kv_cache_manager, \
+                "The block cache indirection requires the paged KV cache of the GPT attention plugin and the Python KV cache manager"
+            assert not self.sliding_window_kv_cache and not self.quant_mode.has_kv_cache_block_scaling(), \
+                "The block cache indirection does not support the sliding window nor the KV cache block scaling"
 
         if self.mapping.has_pp():
             self.nccl_comm = torch.classes.FasterTransformer.NcclCommunicatorOp(
@@ -513,9 +621,19 @@ class GenerationSession(object):
         else:
             expected_tensor_names += ['hidden_states_input']
 
+        found_tensor_names = [
+            self.runtime.engine.get_tensor_name(i)
+            for i in range(self.runtime.engine.num_io_tensors)
+        ]
+        # Engines built with gather_all_token_logits and packed inputs gather
+        # the hidden states of the context tokens before the LM head too
+        self.has_last_token_ids = self.mapping.is_last_pp_rank(
+        ) and 'last_token_ids' in found_tensor_names
+
         if self.mapping.is_last_pp_rank():
             expected_tensor_names += ['logits']
-            if not model_config.gather_all_token_logits:
+            if (not model_config.gather_all_token_logits
+                    or self.has_last_token_ids):
                 expected_tensor_names += ['last_token_ids']
         else:
             expected_tensor_names += ['hidden_states_output']
@@ -600,10 +718,6 @@ class GenerationSession(object):
                     for i in range(self.first_layer, self.last_layer)
                 ]
 
-        found_tensor_names = [
-            self.runtime.engine.get_tensor_name(i)
-            for i in range(self.runtime.engine.num_io_tensors)
-        ]
         if not self.debug_mode and set(expected_tensor_names) != set(
                 found_tensor_names):
             logger.error(
@@ -730,6 +844,77 @@ class GenerationSession(object):
     def use_context_fmha_for_generation(self):
         return self._model_config.use_context_fmha_for_generation
 
+    @property
+    def sliding_window_kv_cache(self):
+        return self._model_config.sliding_window_kv_cache
+
+    @property
+    def block_cache_indirection(self):
+        return self._model_config.block_cache_indirection
+
+    def _max_blocks_per_seq(self,
+                            max_attention_window_size: Optional[int] = None
+                            ) -> int:
+        if max_attention_window_size is None:
+            max_attention_window_size = self.max_attention_window_size
+        max_blocks_per_seq = math.ceil(max_attention_window_size /
+                                       self.tokens_per_block)
+        if self.sliding_window_kv_cache:
+            # One more block than the window spans, so the oldest block is
+            # entirely out of the window when the ring wraps around.
+            max_blocks_per_seq += 1
+        return max_blocks_per_seq
+
+    def _paged_kv_cache_window_sizes(self) -> List[int]:
+        # Layers with a shorter attention window get a smaller pool. The
+        # sliding window uses the same ring for all layers.
+        if self.sliding_window_kv_cache:
+            return [self.max_attention_window_size] * self.num_layers
+        return [int(w.item()) for w in self.host_max_attention_window_sizes]
+
+    def _paged_kv_cache_shape(self, blocks: int) -> Tuple[int, ...]:
+        if self.quant_mode.has_kv_cache_block_scaling():
+            # Each int8/fp8 block is followed by one fp32 scale per head.
+            return (
+                blocks,
+                2,
+                self.num_heads_kv *
+                (self.tokens_per_block * self.head_size + 4),
+            )
+        return (
+            blocks,
+            2,
+            self.num_heads_kv,
+            self.tokens_per_block,
+            self.head_size,
+        )
+
+    def _setup_cpp_kv_cache_manager(self, batch_size: int, beam_width: int):
+        window_sizes = self._paged_kv_cache_window_sizes()
+        assert all(w == self.max_attention_window_size for w in window_sizes), \
+            "The C++ KV cache manager requires the same attention window for all layers"
+        max_blocks_per_seq = self._max_blocks_per_seq()
+        kv_cache_type = torch.int8 if self.quant_mode.has_kv_cache_quant(
+        ) else self.dtype
+        config = (batch_size, beam_width, max_blocks_per_seq,
+                  self.max_attention_window_size, kv_cache_type)
+        if self.cpp_kv_cache_manager_config != config:
+            # Frees the pools of the previous manager first
+            self.cpp_kv_cache_manager = None
+            self.cpp_kv_cache_manager = CppKVCacheManager(
+                self.num_layers,
+                self.num_heads,
+                self.num_heads_kv,
+                self.head_size,
+                kv_cache_type,
+                batch_size * beam_width * max_blocks_per_seq,
+                self.tokens_per_block,
+                max_blocks_per_seq,
+                self.max_attention_window_size,
+                batch_size,
+                beam_width=beam_width)
+            self.cpp_kv_cache_manager_config = config
+
     def __setup_decoder(self, input_ids: torch.Tensor,
                         sampling_config: SamplingConfig,
                         host_context_lengths: torch.Tensor):
@@ -841,6 +1026,27 @@ class GenerationSession(object):
         else:
             self.random_seed = None
 
+        num_samples = scfg.num_return_sequences
+        if num_samples > 1:
+            # The samples of a prompt are decoded as separate sequences with
+            # consecutive random seeds
+            for name in [
+                    'top_k', 'top_p', 'temperature', 'repetition_penalty',
+                    'host_length_penalty', 'presence_penalty',
+                    'frequency_penalty', 'min_length',
+                    'beam_search_diversity_rate'
+            ]:
+                value = getattr(self, name)
+                if value is not None:
+                    setattr(self, name,
+                            value.repeat_interleave(num_samples, dim=0))
+            self.length_penalty = self.host_length_penalty.to(self.device)
+            random_seed = self.random_seed if self.random_seed is not None else torch.zeros(
+                [batch_size], dtype=torch.int64)
+            self.random_seed = random_seed.repeat_interleave(
+                num_samples) + torch.arange(num_samples).repeat(batch_size)
+            batch_size *= num_samples
+
         if self.mapping.is_last_pp_rank():
             self.dynamic_decoder.setup(
                 batch_size, scfg.num_beams, self.top_k, self.top_p,
@@ -869,9 +1075,12 @@ class GenerationSession(object):
                 torch.nested.nested_tensor(split_ids_list,
                                            dtype=torch.int32,
                                            device='cuda'),
-                scfg.pad_id).reshape(batch_size, max_context_length)
+                scfg.pad_id).reshape(-1, max_context_length)
         else:
             padded_input_ids = input_ids
+        if num_samples > 1:
+            padded_input_ids = padded_input_ids.repeat_interleave(num_samples,
+                                                                  dim=0)
         if scfg.num_beams > 1:
             tiled_input_ids = _tile_beam_width(padded_input_ids, scfg.num_beams)
             tiled_input_ids = tiled_input_ids.reshape(batch_size,
@@ -1059,16 +1268,15 @@ class GenerationSession(object):
                 dtype=self._tensor_dtype('encoder_max_input_length'),
                 device=self.device)
 
-        if self.paged_kv_cache:
-            blocks = batch_size * beam_width * math.ceil(
-                self.max_attention_window_size / self.tokens_per_block)
-            cache_shape = (
-                blocks,
-                2,
-                self.num_heads_kv,
-                self.tokens_per_block,
-                self.head_size,
-            )
+        if self.use_cpp_kv_cache_manager:
+            # The pools are allocated by the C++ KV cache manager
+            self._setup_cpp_kv_cache_manager(batch_size, beam_width)
+        elif self.paged_kv_cache:
+            layer_cache_shapes = [
+                self._paged_kv_cache_shape(
+                    batch_size * beam_width * self._max_blocks_per_seq(w))
+                for w in self._paged_kv_cache_window_sizes()
+            ]
         else:
             cache_shape = (
                 batch_size,
@@ -1093,8 +1301,11 @@ class GenerationSession(object):
             else:
                 kv_cache_type = self.dtype if self.paged_kv_cache else self._tensor_dtype(
                     f'present_key_value_{i}')
-            self.buffer[f'present_key_value_{i}'] = torch.empty(
-                cache_shape, dtype=kv_cache_type, device=self.device)
+            if not self.use_cpp_kv_cache_manager:
+                if self.paged_kv_cache:
+                    cache_shape = layer_cache_shapes[i - self.first_layer]
+                self.buffer[f'present_key_value_{i}'] = torch.empty(
+                    cache_shape, dtype=kv_cache_type, device=self.device)
             if self.cross_attention:
                 self.buffer[f'cross_present_key_value_{i}'] = torch.empty(
                     cross_cache_shape, dtype=kv_cache_type, device=self.device)
@@ -1233,6 +1444,13 @@ class GenerationSession(object):
 
             if not self.gather_all_token_logits:
                 add_tensor(last_token_ids, 'last_token_ids')
+            elif self.has_last_token_ids:
+                # select the rows of all the tokens for the context logits
+                all_token_ids = torch.arange(1,
+                                             input_ids.numel() + 1,
+                                             dtype=torch.int32,
+                                             device=input_ids.device)
+                add_tensor(all_token_ids, 'last_token_ids')
         else:
             add_tensor(hidden_states_input, 'hidden_states_output')
 
@@ -1395,7 +1613,7 @@ class GenerationSession(object):
         if self.mapping.is_last_pp_rank():
             add_tensor(self.buffer['logits'], 'logits')
 
-            if not self.gather_all_token_logits:
+            if not self.gather_all_token_logits or self.has_last_token_ids:
                 add_tensor(last_token_ids, 'last_token_ids')
         else:
             add_tensor(hidden_states_input, 'hidden_states_output')
@@ -1634,6 +1852,13 @@ class GenerationSession(object):
             self.nccl_comm.recv(final_output_ids, self.mapping.pp_group[-1])
         return final_output_ids
 
+    def _decoder_batch_shape(self, batch_size: int,
+                             beam_width: int) -> Tuple[int, int]:
+        # The samples of a prompt are beams for the engine and the KV cache,
+        # but separate sequences for the decoder
+        num_samples = self.num_return_sequences
+        return batch_size * num_samples, beam_width // num_samples
+
     def finalize_decoder(self,
                          context_lengths,
                          batch_size,
@@ -1655,11 +1880,14 @@ class GenerationSession(object):
                 # In streaming mode, this results in incorrect decoding in the following steps.
                 beam_hyps_args = copy.deepcopy(beam_hyps_args)
 
+            decoder_batch_size, decoder_beam_width = self._decoder_batch_shape(
+                batch_size, beam_width)
             final_output_ids = self.gather_tree(
                 self.sequence_length_buffer, self.output_ids, self.parent_ids,
                 self.end_ids, context_lengths, self.cum_log_probs,
-                *beam_hyps_args, self.finished, self.length_penalty, batch_size,
-                beam_width, self.max_seq_length, scfg.use_beam_hyps)
+                *beam_hyps_args, self.finished, self.length_penalty,
+                decoder_batch_size, decoder_beam_width, self.max_seq_length,
+                scfg.use_beam_hyps).reshape(batch_size, beam_width, -1)
 
         # Communicate ranks in Pipeline Parallelism
         if self.mapping.has_pp():
@@ -1711,11 +1939,10 @@ class GenerationSession(object):
             attention_mask = model_inputs.get('attention_mask', None)
 
             if self.paged_kv_cache:
+                kv_cache_block_pointers = self.kv_cache_manager.get_device_pointer_arrays(
+                    1)
                 host_kv_cache_block_pointers = self.kv_cache_manager.get_pointer_arrays(
                     1)
-                kv_cache_block_pointers = [
-                    x.to('cuda') for x in host_kv_cache_block_pointers
-                ]
 
             ctx_tensors = self._get_context_shape_buffer(
                 input_ids, context_lengths, host_context_lengths, position_ids,
@@ -1796,7 +2023,10 @@ class GenerationSession(object):
                 for key in self.buffer.keys():
                     # Note: this tiles both self attn cache and cross attn cache!
                     # both names contain "present_key_value"
-                    if "present_key_value" in key:
+                    # With the plugin, the cross attn cache is read-only and
+                    # shared by the beams of a request, so it is not tiled.
+                    if "present_key_value" in key and not (
+                            self.use_gpt_attention_plugin and "cross" in key):
                         self.buffer[key] = _tile_beam_width(
                             self.buffer[key], beam_width)
             if self.mapping.is_last_pp_rank():
@@ -1829,12 +2059,16 @@ class GenerationSession(object):
                 # Increase number of tokens for all unfinished sequences.
                 # And allocate new blocks if needed.
                 # We set this to False for all sequences, since we use only length criterion to stop now
+                if self.block_cache_indirection and beam_width > 1:
+                    # Rebased before the decoder reorders the beams into
+                    # the indirection of the next step
+                    self.kv_cache_manager.rebase_cache_indirection(
+                        this_src_cache_indirection)
                 self.kv_cache_manager.step([False] * batch_size)
+                kv_cache_block_pointers = self.kv_cache_manager.get_device_pointer_arrays(
+                    beam_width)
                 host_kv_cache_block_pointers = self.kv_cache_manager.get_pointer_arrays(
                     beam_width)
-                kv_cache_block_pointers = [
-                    x.to('cuda') for x in host_kv_cache_block_pointers
-                ]
 
             next_context = self.runtime.context_1 if step % 2 else self.runtime.context_0
             next_step_tensors = self._get_next_step_shape_buffer(
@@ -1911,25 +2145,36 @@ class GenerationSession(object):
                     logits = logits_processor(step, final_output_ids_, logits)
                     self.buffer['logits'] = logits
                 # [batch_size x beam_width, vocab_size_padded] -> [batch_size, beam_width, vocab_size_padded]
+                decoder_batch_size, decoder_beam_width = self._decoder_batch_shape(
+                    batch_size, beam_width)
                 next_token_logits = logits.reshape(
-                    (batch_size, beam_width, -1)).to(self.decoder_logits_dtype)
+                    (decoder_batch_size, decoder_beam_width,
+                     -1)).to(self.decoder_logits_dtype)
                 decode_step = step + max_context_length
 
-                should_stop = self.dynamic_decoder.forward(
+                if step == 0:
+                    # The buffers stay the same until the end of the generation, the decoder converts them once
+                    # and the following steps only pass the logits
+                    self.dynamic_decoder.register_buffers(
+                        self.end_ids, self.embedding_bias_opt,
+                        context_lengths, sequence_limit_lengths,
+                        stop_words_list, bad_words_list, no_repeat_ngram_size,
+                        cache_indirections[0], cache_indirections[1],
+                        self.output_ids, self.new_tokens, self.finished,
+                        self.finished, self.sequence_length_buffer,
+                        self.cum_log_probs, self.log_probs, self.parent_ids,
+                        self.beam_hyps_output_ids_tgt,
+                        self.beam_hyps_sequence_lengths_tgt,
+                        self.beam_hyps_cum_log_probs,
+                        self.beam_hyps_normed_scores, self.beam_hyps_log_probs,
+                        self.beam_hyps_min_normed_scores,
+                        self.beam_hyps_num_beams, self.beam_hyps_is_done,
+                        scfg.use_beam_hyps)
+
+                should_stop = self.dynamic_decoder.forward_step(
                     next_token_logits, decode_step, max_context_length,
-                    self.max_attention_window_size, ite, batch_size,
-                    self.end_ids, self.embedding_bias_opt, context_lengths,
-                    sequence_limit_lengths, stop_words_list, bad_words_list,
-                    no_repeat_ngram_size, this_src_cache_indirection,
-                    self.output_ids, self.new_tokens, self.finished,
-                    self.finished, self.sequence_length_buffer,
-                    self.cum_log_probs, self.log_probs, self.parent_ids,
-                    this_tgt_cache_indirection, self.beam_hyps_output_ids_tgt,
-                    self.beam_hyps_sequence_lengths_tgt,
-                    self.beam_hyps_cum_log_probs, self.beam_hyps_normed_scores,
-                    self.beam_hyps_log_probs, self.beam_hyps_min_normed_scores,
-                    self.beam_hyps_num_beams, self.beam_hyps_is_done,
-                    scfg.use_beam_hyps)
+                    self.max_attention_window_size, ite, decoder_batch_size,
+                    step % 2)
                 if stopping_criteria is not None and not should_stop.item():
                     final_output_ids = self.finalize_decoder(context_lengths,
                                                              batch_size,
@@ -2098,11 +2343,18 @@ class GenerationSession(object):
                       encoder_input_lengths: torch.Tensor = None,
                       stopping_criteria: StoppingCriteria = None,
                       logits_processor: LogitsProcessor = None,
+                      incremental_beam_output: bool = False,
                       **kwargs):
         kv_cache_block_pointers = []
         host_kv_cache_block_pointers = []
         attention_mask = None
         context_logits = None
+        incremental_output = None
+        if incremental_beam_output and self.mapping.is_first_pp_rank():
+            assert not self.mapping.has_pp(), \
+                "incremental_beam_output does not support pipeline parallelism"
+            incremental_output = _IncrementalBeamOutput(
+                self.output_ids, context_lengths, batch_size, beam_width)
 
         def get_outputs_dict(output_ids):
             outputs = {}
@@ -2130,6 +2382,17 @@ class GenerationSession(object):
             if step == 0:
                 context_logits = logits
             if should_stop is not None:
+                if incremental_output is not None:
+                    # Only the tokens all beams agree on, the last output is
+                    # the full one
+                    stable_ids = incremental_output.update(
+                        step, self.output_ids, self.parent_ids, self.finished,
+                        self.beam_hyps_num_beams
+                        if scfg.use_beam_hyps and beam_width > 1 else None)
+                    if should_stop.item():
+                        break
+                    yield stable_ids
+                    continue
 
                 final_output_ids = self.finalize_decoder(context_lengths,
                                                          batch_size,
@@ -2190,10 +2453,22 @@ class GenerationSession(object):
                encoder_input_lengths: torch.Tensor = None,
                stopping_criteria: StoppingCriteria = None,
                logits_processor: LogitsProcessor = None,
+               incremental_beam_output: bool = False,
                **kwargs):
+        """
+        With streaming and incremental_beam_output, the outputs of the steps
+        are, per request, the tokens that all its beams now share, instead of
+        the output ids of the whole beams gathered at every step. The last
+        output is the one of the generation, as without streaming.
+        """
         scfg = sampling_config
         batch_size = context_lengths.size(0)
-        beam_width = scfg.num_beams
+        # Parallel samples of a prompt run as the beams of the engine
+        beam_width = scfg.num_beams * scfg.num_return_sequences
+        assert scfg.num_return_sequences == 1 or scfg.num_beams == 1, \
+            "Sampling several sequences per prompt does not support beam search"
+        assert scfg.num_return_sequences == 1 or not incremental_beam_output
+        self.num_return_sequences = scfg.num_return_sequences
         max_context_length = torch.max(context_lengths).item()
         host_context_lengths = context_lengths.cpu()
         assert batch_size == self.batch_size, \
@@ -2216,10 +2491,22 @@ class GenerationSession(object):
         if not self.buffer_allocated:
             raise RuntimeError('Buffer not allocated, please call setup first!')
 
-        sequence_limit_lengths = torch.full((batch_size, 1),
+        decoder_batch_size = batch_size * self.num_return_sequences
+        sequence_limit_lengths = torch.full((decoder_batch_size, 1),
                                             self.max_seq_length,
                                             dtype=torch.int32,
                                             device=self.device)
+        if self.num_return_sequences > 1:
+            # Per prompt inputs of the decoder are repeated for its samples
+            if stop_words_list is not None:
+                stop_words_list = stop_words_list.repeat_interleave(
+                    self.num_return_sequences, dim=0)
+            if bad_words_list is not None and bad_words_list.dim() == 3:
+                bad_words_list = bad_words_list.repeat_interleave(
+                    self.num_return_sequences, dim=0)
+            if isinstance(no_repeat_ngram_size, torch.Tensor):
+                no_repeat_ngram_size = no_repeat_ngram_size.repeat_interleave(
+                    self.num_return_sequences, dim=0)
 
         # Sequence_lengths for the dynamic decoder still has the input paddings.
         sequence_lengths = torch.full((batch_size * beam_width, 1),
@@ -2227,11 +2514,20 @@ class GenerationSession(object):
                                       dtype=torch.int32,
                                       device=self.device)
 
+        # With the block cache indirection, the beams only track the origin of
+        # the tokens of their current block, see
+        # KVCacheManager.rebase_cache_indirection().
+        cache_indirection_size = self.max_attention_window_size
+        if self.block_cache_indirection and beam_width > 1:
+            assert self.max_seq_length <= self.max_attention_window_size, \
+                "The block cache indirection does not support the cyclic KV cache"
+            assert self.max_attention_window_size > 1 + self.tokens_per_block
+            cache_indirection_size = 1 + self.tokens_per_block
         cache_indirections = [
             torch.full((
                 batch_size,
                 beam_width,
-                self.max_attention_window_size,
+                cache_indirection_size,
             ),
                        0,
                        dtype=torch.int32,
@@ -2239,12 +2535,19 @@ class GenerationSession(object):
             torch.full((
                 batch_size,
                 beam_width,
-                self.max_attention_window_size,
+                cache_indirection_size,
             ),
                        0,
                        dtype=torch.int32,
                        device=self.device)
         ]  # ping-pong buffers
+        if self.num_return_sequences > 1:
+            # Each sample reads its own cache, the decoder does not update
+            # the indirections of separate sequences
+            for cache_indirection in cache_indirections:
+                cache_indirection[:] = torch.arange(
+                    beam_width, dtype=torch.int32,
+                    device=self.device)[None, :, None]
 
         hidden_states = None
         if self.mapping.has_pp():
@@ -2254,24 +2557,41 @@ class GenerationSession(object):
             hidden_states = torch.zeros((1, max_num_tokens, hidden_size))
 
         # Init KV cache block manager
-        if self.paged_kv_cache:
-            max_blocks_per_seq = math.ceil(self.max_attention_window_size /
-                                           self.tokens_per_block)
-            blocks = batch_size * beam_width * max_blocks_per_seq
+        if self.use_cpp_kv_cache_manager:
+            self.kv_cache_manager = self.cpp_kv_cache_manager
+            self.kv_cache_manager.reset()
+        elif self.paged_kv_cache:
+            window_sizes = self._paged_kv_cache_window_sizes()
+            blocks = [
+                batch_size * beam_width * self._max_blocks_per_seq(w)
+                for w in window_sizes
+            ]
             memory_pools = [
                 self.buffer[f'present_key_value_{i}']
                 for i in range(self.first_layer, self.last_layer)
             ]
             self.kv_cache_manager = KVCacheManager(
-                memory_pools, blocks, self.tokens_per_block, max_blocks_per_seq,
-                self.max_attention_window_size, beam_width)
+                memory_pools,
+                blocks,
+                self.tokens_per_block,
+                self._max_blocks_per_seq(),
+                window_sizes,
+                beam_width,
+                enable_sliding_window=self.sliding_window_kv_cache,
+                block_cache_indirection=self.block_cache_indirection,
+                num_kv_heads=self.num_heads_kv)
 
+        if self.paged_kv_cache:
             # Add sequences to the manager
             for bi in range(batch_size):
                 generation_sequence = GenerationSequence(seq_idx=bi,
                                                          batch_idx=bi)
+                # The block cache indirection opens blocks at the positions
+                # the plugin writes, which ignore the context padding
+                context_length = int(host_context_lengths[bi]) if \
+                    self.block_cache_indirection else max_context_length
                 self.kv_cache_manager.add_sequence(generation_sequence,
-                                                   max_context_length)
+                                                   context_length)
 
         # start context phase
         if streaming:
@@ -2283,7 +2603,7 @@ class GenerationSession(object):
                 sequence_limit_lengths, stop_words_list, bad_words_list,
                 no_repeat_ngram_size, output_sequence_lengths, return_dict,
                 encoder_output, encoder_input_lengths, stopping_criteria,
-                logits_processor, **kwargs)
+                logits_processor, incremental_beam_output, **kwargs)
         else:
             return self.decode_regular(
                 batch_size, scfg, sequence_lengths, context_lengths,
@@ -12,11 +12,19 @@
 # WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 # See the License for the specific language governing permissions and
 # limitations under the License.
-from collections import defaultdict
-from typing import List
+import hashlib
+import heapq
+import itertools
+import math
+import os
+from collections import OrderedDict, defaultdict
+from dataclasses import dataclass
+from typing import Hashable, List, Optional, Sequence, Tuple, Union
 
 import torch
 
+from ..logger import logger
+
 
 class Block(object):
 
@@ -25,6 +33,12 @@ class Block(object):
         self.k_ptrs = k_ptrs
         self.v_ptrs = v_ptrs
         self.ref_count = 0
+        # Node of the prefix tree holding this block, None if not reusable
+        self.node = None
+        # Reuse statistics consulted by the eviction policy
+        self.last_access = 0
+        self.hit_count = 0
+        self.retention_priority = 0
 
     def add_link(self):
         self.ref_count += 1
@@ -68,6 +82,232 @@ class GenerationSequence(object):
         return self.seq_idx
 
 
+class PrefixTreeNode(object):
+
+    def __init__(self, tokens: Tuple[int, ...], block: Optional[Block],
+                 parent: Optional['PrefixTreeNode']):
+        # Tokens whose KV is stored in the block, at most tokens_per_block
+        self.tokens = tokens
+        # Block holding the KV on device, None while the KV only lives in the host cache
+        self.block = block
+        # Slot of the copy in the host cache, None if there is no copy
+        self.host_slot = None
+        self.parent = parent
+        self.depth = parent.depth + 1 if parent is not None else 0
+        # Children grouped by their first token
+        self.children = defaultdict(list)
+
+    def is_full(self, tokens_per_block: int) -> bool:
+        return len(self.tokens) == tokens_per_block
+
+
+class BlockPrefixTree(object):
+    """
+    Compressed prefix tree over the contents of reusable KV cache blocks.
+
+    Every node stores one block worth of tokens. Children are grouped by
+    their first token, so a lookup visits one node per block and compares
+    every token of the query at most once per candidate edge. Only full
+    blocks have children; a partially filled block is always a leaf.
+
+    The KV of a block also depends on what the tokens are run with, like a
+    LoRA adapter or a prompt embedding table. Blocks are stored under one
+    root per cache_key identifying them, so they are only shared between
+    sequences with the same cache_key.
+    """
+
+    def __init__(self, tokens_per_block: int):
+        self.tokens_per_block = tokens_per_block
+        self.roots = {}
+
+    def _root(self, cache_key: Optional[Hashable]) -> PrefixTreeNode:
+        if cache_key not in self.roots:
+            self.roots[cache_key] = PrefixTreeNode((), None, None)
+            self.roots[cache_key].cache_key = cache_key
+        return self.roots[cache_key]
+
+    @staticmethod
+    def _common_prefix_length(a: Sequence[int], b: Sequence[int]) -> int:
+        length = 0
+        for x, y in zip(a, b):
+            if x != y:
+                break
+            length += 1
+        return length
+
+    def match(
+        self,
+        tokens: Sequence[int],
+        cache_key: Optional[Hashable] = None
+    ) -> Tuple[List[PrefixTreeNode], int]:
+        """
+        Returns nodes covering the longest cached prefix of tokens and the
+        number of matched tokens. All returned nodes but the last one are
+        fully matched; the last one may be matched only partially.
+        """
+        nodes = []
+        num_matched = 0
+        node = self.roots.get(cache_key)
+        while node is not None and num_matched < len(tokens):
+            chunk = tokens[num_matched:num_matched + self.tokens_per_block]
+            best_child, best_length = None, 0
+            for child in node.children.get(chunk[0], []):
+                length = self._common_prefix_length(child.tokens, chunk)
+                if length > best_length:
+                    best_child, best_length = child, length
+            if best_child is None:
+                break
+            nodes.append(best_child)
+            num_matched += best_length
+            if best_length < self.tokens_per_block or not best_child.is_full(
+                    self.tokens_per_block):
+                break
+            node = best_child
+        return nodes, num_matched
+
+    def insert(self,
+               tokens: Sequence[int],
+               blocks: List[Block],
+               cache_key: Optional[Hashable] = None):
+        """
+        Publishes blocks holding the KV of tokens, one block per
+        tokens_per_block chunk. Chunks already present in the tree are kept
+        and the corresponding block of the caller is not stored.
+        """
+        node = self._root(cache_key)
+        for bi, block in enumerate(blocks):
+            chunk = tuple(tokens[bi * self.tokens_per_block:(bi + 1) *
+                                 self.tokens_per_block])
+            if len(chunk) == 0:
+                break
+            siblings = node.children[chunk[0]]
+            existing = next((c for c in siblings if c.tokens == chunk), None)
+            if existing is None:
+                if block.node is not None:
+                    # Block is already published under another prefix
+                    break
+                existing = PrefixTreeNode(chunk, block, node)
+                block.node = existing
+                siblings.append(existing)
+            elif existing.block is None and block.node is None:
+                # KV of an offloaded node is back on device
+                existing.block = block
+                block.node = existing
+            if not existing.is_full(self.tokens_per_block):
+                break
+            node = existing
+
+    def add_node(self, parent: Optional[PrefixTreeNode], tokens: Tuple[int,
+                                                                       ...],
+                 cache_key: Optional[Hashable] = None) -> PrefixTreeNode:
+        """
+        Adds a node holding tokens under parent, or under the root of
+        cache_key if parent is None. The caller attaches the block.
+        """
+        if parent is None:
+            parent = self._root(cache_key)
+        node = PrefixTreeNode(tokens, None, parent)
+        parent.children[tokens[0]].append(node)
+        return node
+
+    def nodes(self) -> List[Tuple[Optional[Hashable], PrefixTreeNode]]:
+        """
+        Returns all nodes with their cache_key, every node after its parent.
+        """
+        result = []
+        for cache_key, root in self.roots.items():
+            # Breadth first, so prefixes come before longer continuations
+            queue = [root]
+            for current in queue:
+                if current is not root:
+                    result.append((cache_key, current))
+                for children in current.children.values():
+                    queue.extend(children)
+        return result
+
+    def remove(self, node: PrefixTreeNode) -> List[PrefixTreeNode]:
+        """
+        Removes node together with its subtree, since the descendants are no
+        longer reachable without it.
+        Returns the nodes that were removed.
+        """
+        parent = node.parent
+        siblings = parent.children[node.tokens[0]]
+        siblings.remove(node)
+        if len(siblings) == 0:
+            parent.children.pop(node.tokens[0])
+        if parent.parent is None and len(parent.children) == 0:
+            self.roots.pop(parent.cache_key)
+
+        removed = []
+        stack = [node]
+        while len(stack) > 0:
+            current = stack.pop()
+            if current.block is not None:
+                current.block.node = None
+            removed.append(current)
+            for children in current.children.values():
+                stack.extend(children)
+        return removed
+
+
+class EvictionPolicy(object):
+    """
+    Orders free reusable blocks for eviction. Blocks with the smallest key
+    are evicted first.
+
+    Keys are computed when a block becomes free; a free block is never
+    accessed, so its key stays valid until it is claimed again.
+    Retention priority always comes first, so blocks of higher-priority
+    requests outlive all lower-priority ones. Among equal keys deeper
+    blocks go first, which evicts leaves before their prefixes.
+    """
+
+    def key(self, block: Block) -> Tuple:
+        raise NotImplementedError(
+            f"{self.__class__} is an abstract class. Only classes inheriting this class can be called."
+        )
+
+
+class LRUEvictionPolicy(EvictionPolicy):
+    """
+    Evicts the least recently used block first.
+    """
+
+    def key(self, block: Block) -> Tuple:
+        return (block.retention_priority, block.last_access, -block.node.depth)
+
+
+class LFUEvictionPolicy(EvictionPolicy):
+    """
+    Evicts the least frequently reused block first, then the least recently
+    used one.
+    """
+
+    def key(self, block: Block) -> Tuple:
+        return (block.retention_priority, block.hit_count, block.last_access,
+                -block.node.depth)
+
+
+@dataclass
+class KvCacheStats:
+    max_num_blocks: int
+    free_num_blocks: int
+    used_num_blocks: int
+    tokens_per_block: int
+    # Context blocks found in the cache, on device or in the host cache
+    reused_blocks: int = 0
+    # Context blocks that had to be computed
+    missed_blocks: int = 0
+    # Reusable blocks dropped from the device
+    evicted_blocks: int = 0
+    # Evicted blocks copied to, and back from, the host cache
+    offloaded_blocks: int = 0
+    onloaded_blocks: int = 0
+    # Runs of blocks allocated at once as large blocks
+    large_blocks: int = 0
+
+
 class BlocksManager(object):
     _sizeof = {
         torch.float32: 4,
@@ -80,58 +320,642 @@ class BlocksManager(object):
                  memory_pools: List[torch.Tensor],
                  blocks: int,
                  max_blocks_per_seq: int = 128,
-                 beam_width: int = 1):
+                 beam_width: int = 1,
+                 tokens_per_block: Optional[int] = None,
+                 host_cache_blocks: int = 0,
+                 eviction_policy: Optional[EvictionPolicy] = None,
+                 arena: Optional['KVCacheArena'] = None,
+                 arena_model: Optional[str] = None,
+                 large_block_factor: int = 1,
+                 pointer_array_width: Optional[int] = None,
+                 swap_blocks: int = 0):
         self.max_blocks_per_seq = max_blocks_per_seq
+        # Pointer rows are padded to this width, e.g. to the widest pool of a
+        # model whose layers share the max_blocks_per_seq dimension
+        self.pointer_array_width = pointer_array_width or max_blocks_per_seq
+        assert self.pointer_array_width >= max_blocks_per_seq
+        self.tokens_per_block = tokens_per_block
 
         self.pointer_array = None
+        # Pointer arrays of all memory pools kept by update_pointer_arrays(),
+        # with the owners whose rows are stale and whether rows were remapped
+        self.pointer_arrays = None
+        self.dirty_owners = set()
+        self.pointer_batch_changed = True
         self.memory_pools = memory_pools
         self.blocks = blocks
         self.beam_width = beam_width
 
         self.elts_per_blocks = []
+        # Views of shape [2, blocks, elts_per_block] of the pools, which are
+        # strided when the blocks are pages of a KVCacheArena
+        self.pool_blocks = []
         for pool in memory_pools:
             # Pool consists of memory for K and V caches
-            self.elts_per_blocks.append(pool.nelement() // (2 * blocks))
+            elts_per_block = pool.nelement() // (2 * blocks)
+            self.elts_per_blocks.append(elts_per_block)
+            self.pool_blocks.append(
+                pool.view(2, blocks, elts_per_block) if pool.is_contiguous(
+                ) else pool)
 
-        self.free_blocks = []
+        self.all_blocks = []
         for bi in range(blocks):
             k_ptrs = []
             v_ptrs = []
-            for pool, elts_per_block in zip(memory_pools, self.elts_per_blocks):
-                k_ptrs.append(self.get_mempool_pointer(bi, pool,
-                                                       elts_per_block))
-                v_ptrs.append(
-                    self.get_mempool_pointer(bi, pool, elts_per_block) +
-                    self.blocks * elts_per_block * self._sizeof[pool.dtype])
-            self.free_blocks.append(Block(bi, k_ptrs, v_ptrs))
+            for pool_blocks in self.pool_blocks:
+                k_ptrs.append(self.get_mempool_pointer(bi, pool_blocks))
+                v_ptrs.append(k_ptrs[-1] + pool_blocks.stride(0) *
+                              self._sizeof[pool_blocks.dtype])
+            self.all_blocks.append(Block(bi, k_ptrs, v_ptrs))
+
+        # With an arena, blocks are pages taken from it when allocated and
+        # given back when freed
+        self.arena = arena
+        self.arena_model = arena_model
+        if arena is not None:
+            self.free_blocks = []
+            arena.blocks_managers[arena_model] = self
+        else:
+            self.free_blocks = list(self.all_blocks)
+
+        # Large blocks are aligned runs of large_block_factor blocks, taken at
+        # once by allocate_large() and placed in consecutive slots. Single
+        # blocks are taken from the runs with the fewest free blocks, so that
+        # whole runs stay free. The pointer arrays list every block of a run.
+        assert large_block_factor == 1 or arena is None, \
+            "Large blocks need blocks that are not pages of an arena"
+        self.large_block_factor = large_block_factor
+        # Number of blocks of each run in free_blocks
+        self.num_free_in_run = [large_block_factor] * (
+            blocks // large_block_factor) if large_block_factor > 1 else []
 
         self.allocated_blocks = defaultdict(
             lambda: [[] for _ in range(self.beam_width)])
+        # Index in the sequence of the first block still allocated to each
+        # owner. Blocks are placed in a ring of max_blocks_per_seq pointers, so
+        # a block that slid out of the attention window can be released while
+        # the following ones keep their position.
+        self.first_block_idx = defaultdict(int)
+
+        # Index of reusable blocks, only used when block reuse is enabled
+        self.prefix_tree = BlockPrefixTree(
+            tokens_per_block) if tokens_per_block is not None else None
+
+        # Free blocks published in the prefix tree are kept apart from
+        # free_blocks in a heap ordered by the eviction policy. Entries of
+        # blocks claimed again are invalidated in place.
+        self.eviction_policy = eviction_policy if eviction_policy is not None else LRUEvictionPolicy(
+        )
+        self.cached_free_blocks = []
+        self.cached_free_entries = {}
+        self.num_cached_free_blocks = 0
+        self.access_clock = itertools.count(1)
+        self.stats = defaultdict(int)
+
+        # Pinned host memory tier receiving reusable blocks evicted from the
+        # device. Each host pool has shape [host_cache_blocks, 2, elts_per_block].
+        self.host_pools = []
+        self.host_free_slots = []
+        # Occupied host slots and their nodes in least recently used order
+        self.host_slots = OrderedDict()
+        self.offload_stream = None
+        if self.prefix_tree is not None and host_cache_blocks > 0:
+            for pool, elts_per_block in zip(memory_pools, self.elts_per_blocks):
+                self.host_pools.append(
+                    torch.empty(host_cache_blocks,
+                                2,
+                                elts_per_block,
+                                dtype=pool.dtype,
+                                pin_memory=True))
+            self.host_free_slots = list(range(host_cache_blocks))
+            self.offload_stream = torch.cuda.Stream()
+
+        # Pinned host memory receiving the blocks of swapped out sequences,
+        # allocated once. Each swap pool has shape
+        # [swap_blocks, 2, elts_per_block].
+        self.swap_pools = [
+            torch.empty(swap_blocks,
+                        2,
+                        elts_per_block,
+                        dtype=pool.dtype,
+                        pin_memory=True)
+            for pool, elts_per_block in zip(memory_pools, self.elts_per_blocks)
+        ] if swap_blocks > 0 else []
+        self.swap_free_slots = list(range(swap_blocks))
 
     def has_free_block(self) -> bool:
         """
         Returns True if we have at least 1 free block
         """
-        return len(self.free_blocks) > 0
+        return self.num_free_blocks() > 0
+
+    def num_free_blocks(self) -> int:
+        """
+        Returns the number of free blocks, including free reusable blocks and
+        the pages that can be taken from the arena
+        """
+        num_free_blocks = len(self.free_blocks) + self.num_cached_free_blocks
+        if self.arena is not None:
+            num_free_blocks += self.arena.get_num_available_pages(
+                self.arena_model)
+        return num_free_blocks
 
     def allocate(self,
                  owner: GenerationSequence,
-                 share_across_beam: bool = False):
+                 share_across_beam: bool = False) -> List[Block]:
         """
-        Add block to owner and increase ref count
+        Add block to owner and increase ref count.
+        Returns the distinct blocks that were allocated.
         """
         # Add blocks for whole beam width
         block = None
+        new_blocks = []
         for bi in range(self.beam_width):
             if not self.has_free_block():
                 raise RuntimeError("Can't allocate new block for KV cache")
 
             # Use the same block for all seqs in beam if share_across_beam
             if block is None or share_across_beam == False:
-                block = self.free_blocks.pop(0)
+                block = self._get_free_block()
+                new_blocks.append(block)
             # Add one reference to the block
             block.add_link()
             self.allocated_blocks[owner][bi].append(block)
+        self.dirty_owners.add(owner)
+        return new_blocks
+
+    def allocate_large(self, owner: GenerationSequence) -> List[Block]:
+        """
+        Adds a large block, large_block_factor contiguous blocks, to owner and
+        shares it across the beam.
+        Returns its blocks, an empty list if no run of blocks is free.
+        """
+        run_idx = next((ri for ri, num_free in enumerate(self.num_free_in_run)
+                        if num_free == self.large_block_factor), None)
+        if run_idx is None:
+            return []
+        first_idx = run_idx * self.large_block_factor
+        blocks = self.all_blocks[first_idx:first_idx + self.large_block_factor]
+        for block in blocks:
+            self._remove_free_block(block)
+            block.hit_count = 0
+            block.retention_priority = 0
+            for bi in range(self.beam_width):
+                block.add_link()
+                self.allocated_blocks[owner][bi].append(block)
+        self.stats['large_blocks'] += 1
+        self.dirty_owners.add(owner)
+        return blocks
+
+    def allocate_context(self, owner: GenerationSequence, num_blocks: int,
+                         num_full_blocks: int):
+        """
+        Adds num_blocks blocks shared across the beam to owner. The first
+        num_full_blocks of them, filled by the context, are taken as large
+        blocks while whole runs are free, the others as single blocks.
+        """
+        while num_full_blocks >= self.large_block_factor > 1 and \
+                self.allocate_large(owner):
+            num_blocks -= self.large_block_factor
+            num_full_blocks -= self.large_block_factor
+        for _ in range(num_blocks):
+            self.allocate(owner, share_across_beam=True)
+
+    def _get_free_block(self) -> Block:
+        """
+        Pops the next free block. A block that is still published for reuse
+        is evicted from the prefix tree first.
+        """
+        if len(self.free_blocks) > 0:
+            block = self._pop_free_block()
+        else:
+            page = self.arena.acquire(
+                self.arena_model) if self.arena is not None else None
+            block = self.all_blocks[
+                page] if page is not None else self._evict_cached_free_block()
+        block.hit_count = 0
+        block.retention_priority = 0
+        return block
+
+    def _run_idx(self, block: Block) -> Optional[int]:
+        run_idx = block.idx // self.large_block_factor
+        return run_idx if run_idx < len(self.num_free_in_run) else None
+
+    def _num_free_in_run(self, block: Block) -> int:
+        run_idx = self._run_idx(block)
+        return self.num_free_in_run[run_idx] if run_idx is not None else 0
+
+    def _pop_free_block(self) -> Block:
+        pos = 0
+        if self.large_block_factor > 1:
+            pos = min(range(len(self.free_blocks)),
+                      key=lambda i: self._num_free_in_run(self.free_blocks[i]))
+        block = self.free_blocks.pop(pos)
+        run_idx = self._run_idx(block)
+        if run_idx is not None:
+            self.num_free_in_run[run_idx] -= 1
+        return block
+
+    def _evict_cached_free_block(self) -> Block:
+        block = self._pop_cached_free_block()
+        self.stats['evicted_blocks'] += 1
+        if len(self.host_pools) > 0:
+            self._offload(block.node)
+        else:
+            self._unpublish(block.node)
+        return block
+
+    def reclaim_cached_block(self):
+        """
+        Evicts the next free reusable block and gives its page back to the
+        arena, for another model.
+        """
+        self.arena.release(self.arena_model,
+                           self._evict_cached_free_block().idx)
+
+    def _push_free_block(self, block: Block):
+        if block.node is None:
+            if self.arena is not None:
+                self.arena.release(self.arena_model, block.idx)
+            else:
+                self.free_blocks.append(block)
+                run_idx = self._run_idx(block)
+                if run_idx is not None:
+                    self.num_free_in_run[run_idx] += 1
+            return
+        entry = [self.eviction_policy.key(block), block.idx, block]
+        self.cached_free_entries[block.idx] = entry
+        heapq.heappush(self.cached_free_blocks, entry)
+        self.num_cached_free_blocks += 1
+
+    def _remove_free_block(self, block: Block):
+        entry = self.cached_free_entries.pop(block.idx, None)
+        if entry is None:
+            self.free_blocks.remove(block)
+            run_idx = self._run_idx(block)
+            if run_idx is not None:
+                self.num_free_in_run[run_idx] -= 1
+            return
+        # Invalidate in place, popped lazily
+        entry[-1] = None
+        self.num_cached_free_blocks -= 1
+
+    def _pop_cached_free_block(self) -> Block:
+        while True:
+            _, _, block = heapq.heappop(self.cached_free_blocks)
+            if block is not None:
+                self.cached_free_entries.pop(block.idx)
+                self.num_cached_free_blocks -= 1
+                return block
+
+    def _touch(self, blocks: List[Block], retention_priority: int):
+        # Blocks of one prefix share the access time, so leaves go first
+        access = next(self.access_clock)
+        for block in blocks:
+            block.last_access = access
+            block.retention_priority = max(block.retention_priority,
+                                           retention_priority)
+
+    def _unpublish(self, node: PrefixTreeNode):
+        """
+        Removes node and its subtree from the prefix tree and releases their
+        host slots.
+        """
+        for removed in self.prefix_tree.remove(node):
+            if removed.block is not None and removed.block.idx in self.cached_free_entries:
+                # Free block is not reusable anymore
+                self._remove_free_block(removed.block)
+                self._push_free_block(removed.block)
+            if removed.host_slot is not None:
+                self.host_slots.pop(removed.host_slot)
+                self.host_free_slots.append(removed.host_slot)
+                removed.host_slot = None
+
+    def _get_host_slot(self) -> Optional[int]:
+        """
+        Returns a free host slot, dropping the least recently used copy if
+        the host cache is full. Nodes that only live in the host cache lose
+        their KV and are removed with their subtree.
+        """
+        if len(self.host_free_slots) > 0:
+            return self.host_free_slots.pop()
+        if len(self.host_slots) == 0:
+            return None
+        slot, node = self.host_slots.popitem(last=False)
+        node.host_slot = None
+        if node.block is None:
+            self._unpublish(node)
+        return slot
+
+    def _block_views(self, block_idx: int):
+        """
+        Yields the K and V views of a block in each memory pool.
+        """
+        for pool_blocks in self.pool_blocks:
+            yield pool_blocks[0][block_idx], pool_blocks[1][block_idx]
+
+    def _offload(self, node: PrefixTreeNode):
+        """
+        Detaches the block of node, keeping its KV in the host cache.
+        The device-to-host copy runs on a side stream, so the host does not
+        wait for it. Work enqueued later on the current stream, which may
+        overwrite the block, waits for the copy.
+        """
+        block = node.block
+        if node.host_slot is None:
+            slot = self._get_host_slot()
+            if slot is None or block.node is None:
+                # No host memory, or node was dropped while making room
+                if slot is not None:
+                    self.host_free_slots.append(slot)
+                if block.node is not None:
+                    self._unpublish(node)
+                return
+            current_stream = torch.cuda.current_stream()
+            self.offload_stream.wait_stream(current_stream)
+            with torch.cuda.stream(self.offload_stream):
+                for host_pool, (k, v) in zip(self.host_pools,
+                                             self._block_views(block.idx)):
+                    host_pool[slot][0].copy_(k, non_blocking=True)
+                    host_pool[slot][1].copy_(v, non_blocking=True)
+            current_stream.wait_stream(self.offload_stream)
+            node.host_slot = slot
+            self.host_slots[slot] = node
+            self.stats['offloaded_blocks'] += 1
+        node.block = None
+        block.node = None
+
+    def _onload(self, node: PrefixTreeNode) -> bool:
+        """
+        Brings the KV of an offloaded node back to a free device block and
+        claims it. Returns False if no device block is available.
+        """
+        if not self.has_free_block():
+            return False
+        slot = node.host_slot
+        # Keep the slot from being reclaimed while evicting for the new block
+        self.host_slots.pop(slot)
+        block = self._get_free_block()
+        for host_pool, (k, v) in zip(self.host_pools,
+                                     self._block_views(block.idx)):
+            k.copy_(host_pool[slot][0], non_blocking=True)
+            v.copy_(host_pool[slot][1], non_blocking=True)
+        self.host_slots[slot] = node
+        node.block = block
+        block.node = node
+        block.add_link()
+        self.stats['onloaded_blocks'] += 1
+        return True
+
+    def match(self,
+              tokens: Sequence[int],
+              retention_priority: int = 0,
+              cache_key: Optional[Hashable] = None) -> Tuple[List[Block], int]:
+        """
+        Returns blocks holding the longest cached prefix of tokens stored
+        under cache_key and the number of matched tokens. Blocks found in the
+        host cache are copied back to the device. Every returned block is
+        claimed once and must be released by the caller.
+        """
+        nodes, num_matched = self.prefix_tree.match(tokens, cache_key)
+        blocks = []
+        for ni, node in enumerate(nodes):
+            if node.host_slot is not None:
+                self.host_slots.move_to_end(node.host_slot)
+            if node.block is not None:
+                self.claim(node.block)
+            elif not self._onload(node):
+                num_matched = ni * self.tokens_per_block
+                break
+            node.block.hit_count += 1
+            blocks.append(node.block)
+        self._touch(blocks, retention_priority)
+        num_blocks = math.ceil(len(tokens) / self.tokens_per_block)
+        self.stats['reused_blocks'] += len(blocks)
+        self.stats['missed_blocks'] += num_blocks - len(blocks)
+        return blocks, num_matched
+
+    def claim(self, block: Block):
+        """
+        Add one reference to a cached block, taking it out of the free blocks.
+        """
+        if not block.has_link():
+            self._remove_free_block(block)
+        block.add_link()
+
+    def release(self, block: Block):
+        """
+        Remove one reference from a block claimed with claim().
+        """
+        block.remove_link()
+        if not block.has_link():
+            self._push_free_block(block)
+
+    def reuse(self, owner: GenerationSequence, block: Block):
+        """
+        Add a cached block to all beams of owner. The block is only read, so
+        it is shared across beams and with other sequences.
+        """
+        for bi in range(self.beam_width):
+            self.claim(block)
+            self.allocated_blocks[owner][bi].append(block)
+        self.dirty_owners.add(owner)
+
+    def copy_blocks(self, pairs: List[Tuple[Block, Block]]):
+        """
+        Copies the KV contents of each src block to its dst block in all
+        memory pools, with one batched copy per pool: one launch of the
+        invokeCopyBlocks kernel for contiguous pools.
+        """
+        if len(pairs) == 0:
+            return
+        src_idx = [src.idx for src, _ in pairs]
+        dst_idx = [dst.idx for _, dst in pairs]
+        for pool_blocks in self.pool_blocks:
+            device = pool_blocks.device
+            if pool_blocks.is_contiguous():
+                # Rows blocks + i of the pool hold the V half of block i
+                num_blocks = pool_blocks.shape[1]
+                src = torch.tensor(
+                    src_idx + [i + num_blocks for i in src_idx],
+                    dtype=torch.int32,
+                    device=device)
+                dst = torch.tensor(
+                    dst_idx + [i + num_blocks for i in dst_idx],
+                    dtype=torch.int32,
+                    device=device)
+                torch.ops.tensorrt_llm.copy_blocks(
+                    pool_blocks.view(2 * num_blocks, -1), src, dst)
+            else:
+                src = torch.tensor(src_idx, dtype=torch.int64, device=device)
+                dst = torch.tensor(dst_idx, dtype=torch.int64, device=device)
+                pool_blocks.index_copy_(1, dst,
+                                        pool_blocks.index_select(1, src))
+
+    def _replace_block(self, owner: GenerationSequence, beams: List[int],
+                       block_pos: int) -> Tuple[Block, Block]:
+        """
+        Replaces block block_pos of the given beams of owner by a new block.
+        Returns the old and the new block.
+        """
+        if not self.has_free_block():
+            raise RuntimeError("Can't allocate new block for KV cache")
+        new_block = self._get_free_block()
+        block = self.allocated_blocks[owner][beams[0]][block_pos]
+        for bi in beams:
+            new_block.add_link()
+            self.allocated_blocks[owner][bi][block_pos] = new_block
+            block.remove_link()
+        if not block.has_link():
+            self._push_free_block(block)
+        self.dirty_owners.add(owner)
+        return block, new_block
+
+    def fork(self,
+             owner: GenerationSequence,
+             block_pos: int,
+             share_across_beam: bool = False,
+             beam_tokens: Optional[List[int]] = None
+             ) -> List[Tuple[Block, Block]]:
+        """
+        Prepares block block_pos of owner for a write. Blocks are shared until
+        they are written with different contents: a block published for
+        reuse or also referenced by another writer is replaced by a new block.
+        Beams sharing a block and writing the same token keep sharing it, so
+        a block is only forked on the first write where the beams diverge.
+        beam_tokens holds the token each beam writes, with
+        share_across_beam all beams write the same tokens, as in the context
+        phase. Without either, each beam ends up with its own block, the last
+        beam referencing a block keeps it.
+        Returns the (src, dst) pairs whose contents must be copied with
+        copy_blocks() before the write.
+        """
+        beams_blocks = self.allocated_blocks[owner]
+        if share_across_beam:
+            beam_keys = [0] * self.beam_width
+        elif beam_tokens is not None:
+            beam_keys = beam_tokens
+        else:
+            beam_keys = range(self.beam_width)
+        writers = {}
+        for bi, key in enumerate(beam_keys):
+            block = beams_blocks[bi][block_pos]
+            writers.setdefault((block.idx, key), []).append(bi)
+
+        pairs = []
+        for beams in writers.values():
+            block = beams_blocks[beams[0]][block_pos]
+            if block.ref_count > len(beams) or block.node is not None:
+                pairs.append(self._replace_block(owner, beams, block_pos))
+        return pairs
+
+    def get_num_fork_blocks(self, owner: GenerationSequence,
+                            block_pos: int) -> int:
+        """
+        Returns the number of blocks fork() allocates for block block_pos of
+        owner when the beams diverge, an upper bound with beam_tokens.
+        """
+        ref_counts = {}
+        num_blocks = 0
+        for bi in range(self.beam_width):
+            block = self.allocated_blocks[owner][bi][block_pos]
+            ref_count = ref_counts.get(block.idx, block.ref_count)
+            if ref_count > 1 or block.node is not None:
+                num_blocks += 1
+                ref_counts[block.idx] = ref_count - 1
+        return num_blocks
+
+    def rebuild_beams(self, owner: GenerationSequence, block_pos: int,
+                      rows: List[List[int]]) -> List[Tuple[Block, List[Block]]]:
+        """
+        Rebuilds the blocks of the beams of owner up to block block_pos, the
+        last full one, from a block cache indirection. rows[bi] holds the beam
+        whose blocks beam bi reads before block block_pos, then the beam
+        holding each token of block block_pos.
+        A block_pos block holding the tokens of several beams is replaced by
+        a new block gathering them, shared by the beams with the same tokens.
+        Returns the (dst, srcs) gathers to run with gather_blocks() before
+        any other block is allocated, srcs holding the source of each token.
+        """
+        beams_blocks = self.allocated_blocks[owner]
+        new_beams_blocks = []
+        gathers = {}
+        for row in rows:
+            blocks = beams_blocks[row[0]][:block_pos]
+            srcs = [beams_blocks[src][block_pos] for src in row[1:]]
+            if all(src is srcs[0] for src in srcs):
+                blocks.append(srcs[0])
+            else:
+                key = tuple(src.idx for src in srcs)
+                if key not in gathers:
+                    if not self.has_free_block():
+                        raise RuntimeError(
+                            "Can't allocate new block for KV cache")
+                    gathers[key] = (self._get_free_block(), srcs)
+                blocks.append(gathers[key][0])
+            new_beams_blocks.append(blocks)
+
+        # New links are added first so blocks kept by another beam stay alive
+        for blocks in new_beams_blocks:
+            for block in blocks:
+                block.add_link()
+        for blocks in beams_blocks:
+            for block in blocks:
+                block.remove_link()
+                if not block.has_link():
+                    self._push_free_block(block)
+        self.allocated_blocks[owner] = new_beams_blocks
+        self.dirty_owners.add(owner)
+        return list(gathers.values())
+
+    def gather_blocks(self, gathers: List[Tuple[Block, List[Block]]],
+                      num_kv_heads: int):
+        """
+        Copies token i of the i-th src block of each gather to its dst block
+        in all memory pools, with one batched copy per pool.
+        """
+        if len(gathers) == 0:
+            return
+        tokens_per_block = len(gathers[0][1])
+        dst_idx = [[dst.idx] for dst, _ in gathers]
+        src_idx = [[src.idx for src in srcs] for _, srcs in gathers]
+        for pool_blocks in self.pool_blocks:
+            device = pool_blocks.device
+            dst = torch.tensor(dst_idx, dtype=torch.int64, device=device)
+            src = torch.tensor(src_idx, dtype=torch.int64, device=device)
+            tokens = torch.arange(tokens_per_block, device=device)
+            # Blocks of K and V are [num_kv_heads, tokens_per_block, head_size]
+            blocks = pool_blocks.unflatten(2,
+                                           (num_kv_heads, tokens_per_block, -1))
+            blocks[:, dst, :, tokens] = blocks[:, src, :, tokens]
+
+    def store(self,
+              tokens: Sequence[int],
+              owner: GenerationSequence,
+              retention_priority: int = 0,
+              cache_key: Optional[Hashable] = None):
+        """
+        Publish the blocks of beam 0 of owner holding tokens for reuse under
+        cache_key. Must be called before the owner is freed.
+        """
+        assert self.prefix_tree is not None
+        num_blocks = math.ceil(len(tokens) / self.tokens_per_block)
+        blocks = self.allocated_blocks[owner][0][:num_blocks]
+        self.prefix_tree.insert(tokens, blocks, cache_key)
+        self._touch(blocks, retention_priority)
+
+    def release_first_block(self, owner: GenerationSequence):
+        """
+        Unlink the oldest block of all beams of owner.
+        Moves blocks with ref_count == 0 to free.
+        """
+        for bi in range(self.beam_width):
+            block = self.allocated_blocks[owner][bi].pop(0)
+            block.remove_link()
+            if not block.has_link():
+                self._push_free_block(block)
+        self.first_block_idx[owner] += 1
+        self.dirty_owners.add(owner)
 
     def free(self, owner: GenerationSequence):
         """
@@ -144,11 +968,206 @@ class BlocksManager(object):
                 # Move block to free if no one refers to it
                 block.remove_link()
 
-                # Move block to free if no one refers to it
+                # Move block to free if no one refers to it.
+                # Blocks published for reuse stay in the prefix tree until
+                # they are evicted.
                 if not block.has_link():
-                    self.free_blocks.append(block)
+                    self._push_free_block(block)
         # Remove owner from allocated blocks
         self.allocated_blocks.pop(owner)
+        self.first_block_idx.pop(owner, None)
+        # Rows of the remaining owners are remapped
+        self.dirty_owners.discard(owner)
+        self.pointer_batch_changed = True
+
+    def save_prefix_cache(self, path: str, fingerprint: str):
+        """
+        Writes the reusable blocks, on device and in the host cache, with
+        their tokens and links to path. The file is written next to path
+        and renamed, so a crash never leaves a truncated cache behind.
+        """
+        assert self.prefix_tree is not None
+        nodes = self.prefix_tree.nodes()
+        index = {id(node): ni for ni, (_, node) in enumerate(nodes)}
+        # Host copies are still in flight on the offload stream
+        torch.cuda.synchronize()
+        kv_caches = [
+            torch.empty(len(nodes), 2, elts_per_block, dtype=pool.dtype)
+            for pool, elts_per_block in zip(self.memory_pools,
+                                            self.elts_per_blocks)
+        ]
+        records = []
+        for ni, (cache_key, node) in enumerate(nodes):
+            if node.block is not None:
+                views = self._block_views(node.block.idx)
+            else:
+                views = ((host_pool[node.host_slot][0],
+                          host_pool[node.host_slot][1])
+                         for host_pool in self.host_pools)
+            for kv_cache, (k, v) in zip(kv_caches, views):
+                kv_cache[ni][0].copy_(k)
+                kv_cache[ni][1].copy_(v)
+            block = node.block
+            records.append({
+                'parent': index.get(id(node.parent), -1),
+                'cache_key': cache_key,
+                'tokens': node.tokens,
+                'hit_count': block.hit_count if block is not None else 0,
+                'retention_priority':
+                block.retention_priority if block is not None else 0,
+                'last_access': block.last_access if block is not None else 0,
+            })
+        tmp_path = f'{path}.tmp'
+        torch.save(
+            {
+                'fingerprint': fingerprint,
+                'tokens_per_block': self.tokens_per_block,
+                'nodes': records,
+                'kv_caches': kv_caches
+            }, tmp_path)
+        os.replace(tmp_path, path)
+
+    def load_prefix_cache(self, path: str, fingerprint: str) -> int:
+        """
+        Restores reusable blocks written by save_prefix_cache() into free
+        device blocks, then into the host cache. Must be called before any
+        block is allocated. The file is memory-mapped, so only the blocks
+        that fit are read. Nodes that do not fit are dropped together with
+        their subtree.
+        Returns the number of restored blocks, 0 if the file was written for
+        another model or cache layout.
+        """
+        assert self.prefix_tree is not None and self.arena is None
+        assert len(self.free_blocks) == self.blocks
+        state = torch.load(path, map_location='cpu', mmap=True)
+        layout = [(pool.dtype, elts_per_block) for pool, elts_per_block in
+                  zip(self.memory_pools, self.elts_per_blocks)]
+        saved_layout = [(kv_cache.dtype, kv_cache.shape[2])
+                        for kv_cache in state['kv_caches']]
+        if state['fingerprint'] != fingerprint or state[
+                'tokens_per_block'] != self.tokens_per_block or saved_layout != layout:
+            logger.warning(
+                f'Prefix cache {path} does not match the model, skip loading')
+            return 0
+
+        loaded = {}
+        last_access = 0
+        for ni, record in enumerate(state['nodes']):
+            parent = None
+            if record['parent'] >= 0:
+                parent = loaded.get(record['parent'])
+                if parent is None:
+                    continue
+            if len(self.free_blocks) > 0:
+                block = self._pop_free_block()
+                views = self._block_views(block.idx)
+            elif len(self.host_free_slots) > 0:
+                block = None
+                slot = self.host_free_slots.pop()
+                views = ((host_pool[slot][0], host_pool[slot][1])
+                         for host_pool in self.host_pools)
+            else:
+                break
+            for kv_cache, (k, v) in zip(state['kv_caches'], views):
+                k.copy_(kv_cache[ni][0])
+                v.copy_(kv_cache[ni][1])
+
+            node = self.prefix_tree.add_node(parent, record['tokens'],
+                                             record['cache_key'])
+            if block is not None:
+                node.block = block
+                block.node = node
+                block.hit_count = record['hit_count']
+                block.retention_priority = record['retention_priority']
+                block.last_access = record['last_access']
+                self._push_free_block(block)
+            else:
+                node.host_slot = slot
+                self.host_slots[slot] = node
+            last_access = max(last_access, record['last_access'])
+            loaded[ni] = node
+        self.access_clock = itertools.count(last_access + 1)
+        return len(loaded)
+
+    def swap_out(self, owner: GenerationSequence, device: str = 'cpu') -> Tuple:
+        """
+        Copies the blocks of owner to the pinned swap pools, or to new device
+        memory, once per distinct block. The copies are enqueued on the
+        current stream, before any later write to the blocks. The caller
+        frees owner afterwards.
+        Returns the state restored by swap_in(), which releases the slots of
+        the swap pools.
+        """
+        blocks = []
+        index = {}
+        for beam_blocks in self.allocated_blocks[owner]:
+            for block in beam_blocks:
+                if block.idx not in index:
+                    index[block.idx] = len(blocks)
+                    blocks.append(block)
+        layout = [[index[block.idx] for block in beam_blocks]
+                  for beam_blocks in self.allocated_blocks[owner]]
+        slots = []
+        if device == 'cpu':
+            if len(self.swap_free_slots) < len(blocks):
+                raise RuntimeError("Can't allocate swap space for KV cache")
+            slots = self.swap_free_slots[:len(blocks)]
+            del self.swap_free_slots[:len(blocks)]
+            # Views of the slots, one [2, elts_per_block] block each
+            host_blocks = [[swap_pool[slot] for slot in slots]
+                           for swap_pool in self.swap_pools]
+        else:
+            host_blocks = [
+                torch.empty(len(blocks),
+                            2,
+                            elts_per_block,
+                            dtype=pool.dtype,
+                            device=device) for pool, elts_per_block in zip(
+                                self.memory_pools, self.elts_per_blocks)
+            ]
+        for bi, block in enumerate(blocks):
+            for host_block, (k, v) in zip(host_blocks,
+                                          self._block_views(block.idx)):
+                host_block[bi][0].copy_(k, non_blocking=True)
+                host_block[bi][1].copy_(v, non_blocking=True)
+        return layout, host_blocks, self.first_block_idx.get(owner, 0), slots
+
+    def swap_in(self, owner: GenerationSequence, state: Tuple):
+        """
+        Allocates new blocks for owner and copies back the blocks saved by
+        swap_out(). Blocks shared by beams before are shared again.
+        """
+        layout, host_blocks, first_block_idx, slots = state
+        assert all(len(host_block) == 0 or host_block[0].shape[-1] == elts
+                   for host_block, elts in zip(host_blocks, self.elts_per_blocks)), \
+            "Blocks were copied from a cache with another layout"
+        num_blocks = get_num_swapped_blocks(state)
+        if self.num_free_blocks() < num_blocks:
+            raise RuntimeError("Can't allocate new block for KV cache")
+        blocks = [self._get_free_block() for _ in range(num_blocks)]
+        for bi, block in enumerate(blocks):
+            for host_block, (k, v) in zip(host_blocks,
+                                          self._block_views(block.idx)):
+                k.copy_(host_block[bi][0], non_blocking=True)
+                v.copy_(host_block[bi][1], non_blocking=True)
+        # A later swap_out() into the slots is enqueued after these copies
+        self.swap_free_slots += slots
+        for beam_idx, beam_layout in enumerate(layout):
+            for bi in beam_layout:
+                blocks[bi].add_link()
+                self.allocated_blocks[owner][beam_idx].append(blocks[bi])
+        if first_block_idx > 0:
+            self.first_block_idx[owner] = first_block_idx
+        self.dirty_owners.add(owner)
+
+    def get_num_distinct_blocks(self, owner: GenerationSequence) -> int:
+        """
+        Returns the number of distinct blocks of owner, the slots swap_out()
+        takes.
+        """
+        return len(
+            set(block.idx for beam_blocks in self.allocated_blocks[owner]
+                for block in beam_blocks))
 
     def get_number_blocks(self, owner: GenerationSequence) -> int:
         """
@@ -156,44 +1175,77 @@ class BlocksManager(object):
         """
         return len(self.allocated_blocks[owner][0])
 
-    def get_mempool_pointer(self, block_idx: int, pool: torch.Tensor,
-                            elts_per_block: int) -> int:
+    def get_mempool_pointer(self, block_idx: int,
+                            pool_blocks: torch.Tensor) -> int:
         """
-        Computes linear pointer
+        Computes linear pointer to the K cache of a block
         """
-        return pool.data_ptr(
-        ) + block_idx * elts_per_block * self._sizeof[pool.dtype]
+        return pool_blocks.data_ptr() + block_idx * pool_blocks.stride(
+            1) * self._sizeof[pool_blocks.dtype]
+
+    def _get_pointer_rows(self, owner: GenerationSequence, pool_idx: int,
+                          beam_width: int) -> List[List[List[int]]]:
+        """
+        Returns nested list of [beam_width, 2, pointer_array_width] of
+        pointers to the blocks of owner in memory pool
+        """
+        rows = [[[0] * self.pointer_array_width for _ in range(2)]
+                for _ in range(beam_width)]
+        first_block_idx = self.first_block_idx.get(owner, 0)
+        for bi in range(beam_width):
+            for block_linear_idx, block in enumerate(
+                    self.allocated_blocks[owner][bi]):
+                slot = (first_block_idx +
+                        block_linear_idx) % self.max_blocks_per_seq
+                # K cache pointers
+                rows[bi][0][slot] = block.get_k_ptr(pool_idx)
+                # V cache pointers
+                rows[bi][1][slot] = block.get_v_ptr(pool_idx)
+        return rows
 
     def get_pointer_array(self, pool_idx: int, beam_width: int) -> torch.Tensor:
         """
-        Returns array of [batch size, beam_width, 2, max_blocks_per_seq] of poitners
-        to the allocated blocks in memory pool
+        Returns array of [batch size, beam_width, 2, pointer_array_width] of
+        poitners to the allocated blocks in memory pool
         """
         assert (beam_width <= self.beam_width)
 
-        def create_nested_list(dims):
-            """Recursive function to generate nested list."""
-            if len(dims) == 1:
-                return [0 for _ in range(dims[0])]
-            return [create_nested_list(dims[1:]) for _ in range(dims[0])]
-
-        pointer_array = create_nested_list(
-            (len(self.allocated_blocks), beam_width, 2,
-             self.max_blocks_per_seq))
-
-        for owner, beams_blocks in self.allocated_blocks.items():
-            for bi in range(beam_width):
-                for block_linear_idx, block in enumerate(beams_blocks[bi]):
-                    # K cache pointers
-                    pointer_array[owner.get_batch_idx(
-                    )][bi][0][block_linear_idx] = block.get_k_ptr(pool_idx)
-                    # V cache pointers
-                    pointer_array[owner.get_batch_idx(
-                    )][bi][1][block_linear_idx] = block.get_v_ptr(pool_idx)
+        pointer_array = [None] * len(self.allocated_blocks)
+        for owner in self.allocated_blocks:
+            pointer_array[owner.get_batch_idx()] = self._get_pointer_rows(
+                owner, pool_idx, beam_width)
 
         self.pointer_array = torch.tensor(pointer_array, dtype=torch.int64)
         return self.pointer_array
 
+    def update_pointer_arrays(self, beam_width: int) -> Optional[List[int]]:
+        """
+        Brings pointer_arrays, the pointer arrays of all memory pools, up to
+        date. Only the rows of owners whose blocks changed since the last
+        update are rewritten, which at most happens when a sequence crosses a
+        block boundary. The arrays are rebuilt when the batch changed.
+        Returns the batch indices of the rewritten rows, None if rebuilt.
+        """
+        batch_size = len(self.allocated_blocks)
+        if self.pointer_arrays is None or self.pointer_batch_changed or tuple(
+                self.pointer_arrays[0].shape[:2]) != (batch_size, beam_width):
+            self.pointer_arrays = [
+                self.get_pointer_array(pool_idx, beam_width)
+                for pool_idx in range(len(self.memory_pools))
+            ]
+            dirty_rows = None
+        else:
+            dirty_rows = sorted(owner.get_batch_idx()
+                                for owner in self.dirty_owners)
+            for owner in self.dirty_owners:
+                for pool_idx, pointer_array in enumerate(self.pointer_arrays):
+                    pointer_array[owner.get_batch_idx()] = torch.tensor(
+                        self._get_pointer_rows(owner, pool_idx, beam_width),
+                        dtype=torch.int64)
+        self.dirty_owners.clear()
+        self.pointer_batch_changed = False
+        return dirty_rows
+
     def get_continous_caches(self, pool_idx: int) -> torch.Tensor:
         """
         Returns countinous KV caches.
@@ -202,12 +1254,12 @@ class BlocksManager(object):
         assert self.beam_width == 1
 
         elts_per_block = self.elts_per_blocks[pool_idx]
-        pool = self.memory_pools[pool_idx].flatten()
+        pool_blocks = self.pool_blocks[pool_idx]
         continous_kv_cache = torch.zeros(len(self.allocated_blocks),
                                          2,
                                          self.max_blocks_per_seq *
                                          elts_per_block,
-                                         dtype=pool.dtype,
+                                         dtype=pool_blocks.dtype,
                                          device="cuda")
         for owner, beam_blocks in self.allocated_blocks.items():
             for bi in range(self.beam_width):
@@ -216,65 +1268,345 @@ class BlocksManager(object):
                     batch_idx = owner.get_batch_idx()
                     # The first index in the sequence.
                     block_offset = block_linear_idx * elts_per_block
-                    # The first index in the pool for K.
-                    k_start = block.idx * elts_per_block
-                    # The first index in the pool for V.
-                    v_start = k_start + self.blocks * elts_per_block
 
                     continous_kv_cache[batch_idx][0][
                         block_offset:block_offset +
-                        elts_per_block] = pool[k_start:k_start + elts_per_block]
+                        elts_per_block] = pool_blocks[0][block.idx]
                     continous_kv_cache[batch_idx][1][
                         block_offset:block_offset +
-                        elts_per_block] = pool[v_start:v_start + elts_per_block]
+                        elts_per_block] = pool_blocks[1][block.idx]
 
         return continous_kv_cache
 
 
+class KVCacheArena(object):
+    """
+    Device memory shared by the paged KV caches of several models served by
+    one process, instead of a static split between them.
+
+    The memory is split into pages, each holding one block of any model: K
+    and V of all its memory pools. page_size_bytes must fit the largest
+    block, so models should use block sizes close to each other. A model
+    takes a page when it allocates a block and gives it back when the block
+    is freed, so the memory one model leaves idle is used by the others.
+    Each model is guaranteed min_pages and holds at most max_pages. When a
+    model runs out of pages, the pages of free reusable blocks of the model
+    holding the most pages above its guarantee are reclaimed.
+    """
+    _alignment = 256
+
+    def __init__(self,
+                 num_pages: int,
+                 page_size_bytes: int,
+                 device: str = 'cuda'):
+        assert page_size_bytes % self._alignment == 0
+        self.num_pages = num_pages
+        self.page_size_bytes = page_size_bytes
+        self.buffer = torch.empty(num_pages,
+                                  page_size_bytes,
+                                  dtype=torch.uint8,
+                                  device=device)
+        self.free_pages = list(range(num_pages))
+        # min_pages and max_pages of each model
+        self.quotas = {}
+        self.num_held_pages = {}
+        self.blocks_managers = {}
+
+    def add_model(self,
+                  name: str,
+                  layout: List[Tuple[torch.dtype, int]],
+                  min_pages: int = 0,
+                  max_pages: Optional[int] = None) -> List[torch.Tensor]:
+        """
+        Adds a model with one (dtype, elts_per_block) entry per memory pool.
+        Returns the memory pools to create its KVCacheManager with, views of
+        shape [2, num_pages, elts_per_block] over the pages.
+        """
+        assert name not in self.quotas
+        assert sum(quota[0] for quota in self.quotas.values()) + min_pages <= self.num_pages, \
+            "Guaranteed pages exceed the arena"
+        memory_pools = []
+        offset = 0
+        for dtype, elts_per_block in layout:
+            elt_size = BlocksManager._sizeof[dtype]
+            pages = self.buffer.view(dtype)
+            memory_pools.append(
+                pages.as_strided((2, self.num_pages, elts_per_block),
+                                 (elts_per_block, pages.shape[1], 1),
+                                 offset // elt_size))
+            offset += 2 * elts_per_block * elt_size
+            offset = math.ceil(offset / self._alignment) * self._alignment
+        assert offset <= self.page_size_bytes, \
+            f"Blocks of {name} need {offset} bytes, more than a page"
+        self.quotas[name] = (min_pages, self.num_pages
+                             if max_pages is None else max_pages)
+        self.num_held_pages[name] = 0
+        return memory_pools
+
+    def _get_num_reserved_pages(self, name: str) -> int:
+        # Free pages guaranteed to the other models
+        return sum(
+            max(min_pages - self.num_held_pages[other], 0)
+            for other, (min_pages, _) in self.quotas.items() if other != name)
+
+    def _get_reclaimable_models(self, name: str) -> List[str]:
+        return [
+            other for other, blocks_manager in self.blocks_managers.items()
+            if other != name and blocks_manager.num_cached_free_blocks > 0
+            and self.num_held_pages[other] > self.quotas[other][0]
+        ]
+
+    def get_num_available_pages(self, name: str) -> int:
+        """
+        Returns the number of pages model name can take, reclaiming free
+        reusable blocks of the other models if needed.
+        """
+        min_pages, max_pages = self.quotas[name]
+        num_pages = len(self.free_pages) - self._get_num_reserved_pages(name)
+        for other in self._get_reclaimable_models(name):
+            num_pages += min(
+                self.blocks_managers[other].num_cached_free_blocks,
+                self.num_held_pages[other] - self.quotas[other][0])
+        return max(min(num_pages, max_pages - self.num_held_pages[name]), 0)
+
+    def acquire(self, name: str) -> Optional[int]:
+        """
+        Returns a page for model name, None if it cannot take any.
+        """
+        if self.get_num_available_pages(name) == 0:
+            return None
+        while len(self.free_pages) <= self._get_num_reserved_pages(name):
+            other = max(self._get_reclaimable_models(name),
+                        key=lambda other: self.num_held_pages[other] - self.
+                        quotas[other][0])
+            self.blocks_managers[other].reclaim_cached_block()
+        self.num_held_pages[name] += 1
+        return self.free_pages.pop()
+
+    def release(self, name: str, page: int):
+        self.num_held_pages[name] -= 1
+        self.free_pages.append(page)
+
+
+def get_num_swapped_blocks(state: Tuple) -> int:
+    """
+    Returns the number of distinct blocks saved by BlocksManager.swap_out().
+    """
+    layout = state[0]
+    return max((bi + 1 for beam_layout in layout for bi in beam_layout),
+               default=0)
+
+
+def model_fingerprint(engine_buffer, model_config) -> str:
+    """
+    Identifies the KV produced by an engine, used to reject a persisted
+    prefix cache written for another engine or model configuration.
+    """
+    hasher = hashlib.sha256()
+    hasher.update(engine_buffer)
+    hasher.update(repr(model_config).encode())
+    return hasher.hexdigest()
+
+
 class KVCacheManager(object):
 
     def __init__(self,
                  memory_pools: List[torch.Tensor],
-                 blocks: int,
+                 blocks: Union[int, List[int]],
                  tokens_per_block: int,
                  max_blocks_per_seq: int,
-                 max_attention_window_size: int,
-                 beam_width: int = 1):
-
-        self.blocks_manager = BlocksManager(
-            memory_pools=memory_pools,
-            blocks=blocks,
-            max_blocks_per_seq=max_blocks_per_seq,
-            beam_width=beam_width)
-        self.num_pools = len(memory_pools)
+                 max_attention_window_size: Union[int, List[int]],
+                 beam_width: int = 1,
+                 enable_block_reuse: bool = False,
+                 host_cache_size_bytes: int = 0,
+                 eviction_policy: Optional[EvictionPolicy] = None,
+                 enable_sliding_window: bool = False,
+                 prefix_cache_path: Optional[str] = None,
+                 model_fingerprint: Optional[str] = None,
+                 kv_cache_arena: Optional[KVCacheArena] = None,
+                 model_name: Optional[str] = None,
+                 block_cache_indirection: bool = False,
+                 num_kv_heads: int = 0,
+                 large_block_factor: int = 1,
+                 swap_space_bytes: int = 0):
+        """
+        blocks and max_attention_window_size are either shared by all memory
+        pools or given per pool, e.g. for models mixing global and local
+        attention layers. Pools with the same window share blocks and are
+        sized for their own window: a pool with a window shorter than the
+        longest one holds ceil(window / tokens_per_block) blocks per
+        sequence, used as a cyclic kv cache. max_blocks_per_seq applies to
+        the pools with the longest window. The pointer arrays of all pools
+        are max_blocks_per_seq wide, the engine has one max_blocks_per_seq
+        dimension for all layers.
+
+        With block reuse and a prefix_cache_path, the reusable blocks saved
+        by save_prefix_cache() on a previous run are loaded if the file holds
+        the same model_fingerprint, see model_fingerprint().
+
+        With a kv_cache_arena, the memory_pools are the ones returned by
+        KVCacheArena.add_model() for model_name and blocks is the number of
+        pages of the arena. Blocks then take pages shared with the other
+        models of the arena.
+
+        With block_cache_indirection, beam search reads the cache through a
+        block cache indirection, see rebase_cache_indirection(). Copying
+        tokens between the blocks of the beams needs the num_kv_heads of the
+        pools.
+
+        With a large_block_factor > 1, the pools with the longest window hold
+        blocks of two sizes: the full context blocks of a sequence are taken
+        as large blocks of large_block_factor * tokens_per_block contiguous
+        tokens while whole runs of blocks are free, the generated tokens go
+        to single blocks. The kernels see large blocks as consecutive blocks
+        of tokens_per_block tokens, so the numbers of needed blocks are
+        counted in blocks of tokens_per_block tokens.
+
+        swap_space_bytes of pinned host memory are allocated once for
+        swap_out(), split evenly between the attention windows.
+        """
+        num_pools = len(memory_pools)
+        if not isinstance(blocks, list):
+            blocks = [blocks] * num_pools
+        if not isinstance(max_attention_window_size, list):
+            max_attention_window_size = [max_attention_window_size] * num_pools
+        assert len(blocks) == num_pools and len(
+            max_attention_window_size) == num_pools
+        # Longest window first, its blocks manager tracks reusable blocks
+        self.attention_window_sizes = sorted(set(max_attention_window_size),
+                                             reverse=True)
+        if len(self.attention_window_sizes) > 1:
+            assert not enable_block_reuse and not enable_sliding_window and host_cache_size_bytes == 0, \
+                "Block reuse, host cache and sliding window need the same attention window in all layers"
+        if kv_cache_arena is not None:
+            assert len(self.attention_window_sizes) == 1 and prefix_cache_path is None, \
+                "KV cache arena needs the same attention window in all layers and no prefix cache file"
+
+        if block_cache_indirection:
+            assert len(self.attention_window_sizes) == 1 and not enable_sliding_window and num_kv_heads > 0, \
+                "Block cache indirection needs the same attention window in all layers and no sliding window"
+
+        if enable_sliding_window:
+            # The pointers of a sequence form a ring that must hold one block
+            # more than the window spans.
+            assert beam_width == 1, "Sliding window KV cache does not support beam search"
+            assert max_blocks_per_seq > math.ceil(
+                self.attention_window_sizes[0] / tokens_per_block)
+
+        self.blocks_managers = []
+        # Blocks manager and index in it of each memory pool
+        self.pool_locations = [None] * num_pools
+        for window in self.attention_window_sizes:
+            pool_indices = [
+                pi for pi in range(num_pools)
+                if max_attention_window_size[pi] == window
+            ]
+            group_pools = [memory_pools[pi] for pi in pool_indices]
+            group_blocks = blocks[pool_indices[0]]
+            assert all(blocks[pi] == group_blocks for pi in pool_indices), \
+                "Pools with the same attention window must have the same number of blocks"
+            for local_idx, pi in enumerate(pool_indices):
+                self.pool_locations[pi] = (len(self.blocks_managers), local_idx)
+
+            # Size of one block, K and V, over all memory pools
+            block_size_bytes = sum(
+                pool.nelement() // group_blocks *
+                BlocksManager._sizeof[pool.dtype] for pool in group_pools)
+            self.blocks_managers.append(
+                BlocksManager(
+                    memory_pools=group_pools,
+                    blocks=group_blocks,
+                    max_blocks_per_seq=max_blocks_per_seq
+                    if window == self.attention_window_sizes[0] else
+                    math.ceil(window / tokens_per_block),
+                    beam_width=beam_width,
+                    tokens_per_block=tokens_per_block
+                    if enable_block_reuse else None,
+                    host_cache_blocks=host_cache_size_bytes // block_size_bytes,
+                    eviction_policy=eviction_policy,
+                    arena=kv_cache_arena,
+                    arena_model=model_name,
+                    large_block_factor=large_block_factor
+                    if window == self.attention_window_sizes[0] else 1,
+                    pointer_array_width=max_blocks_per_seq,
+                    swap_blocks=swap_space_bytes // len(
+                        self.attention_window_sizes) // block_size_bytes))
+        self.blocks_manager = self.blocks_managers[0]
+        self.num_pools = num_pools
         self.tokens_per_block = tokens_per_block
-        self.max_attention_window_size = max_attention_window_size
+        self.max_attention_window_size = self.attention_window_sizes[0]
         self.beam_width = beam_width
+        self.enable_block_reuse = enable_block_reuse
+        self.enable_sliding_window = enable_sliding_window
+        self.block_cache_indirection = block_cache_indirection
+        self.num_kv_heads = num_kv_heads
 
         self.lens = []
         self.sequences = []
+        # Context tokens of each sequence, used to publish blocks for reuse
+        self.tokens = []
+        self.retention_priorities = []
+        self.cache_keys = []
+        # State of the sequences swapped out to host memory
+        self.swapped_sequences = {}
 
-    def step(self, finished: List[bool]):
+        # Pointer arrays on device, with the rows changed since they were
+        # copied, None if they must be copied whole
+        self.device_pointer_arrays = None
+        self.device_dirty_rows = None
+
+        self.prefix_cache_path = prefix_cache_path
+        self.model_fingerprint = model_fingerprint
+        if enable_block_reuse and prefix_cache_path is not None and os.path.exists(
+                prefix_cache_path):
+            num_loaded = self.blocks_manager.load_prefix_cache(
+                prefix_cache_path, model_fingerprint)
+            logger.info(
+                f'Loaded {num_loaded} reusable KV cache blocks from {prefix_cache_path}'
+            )
+
+    def save_prefix_cache(self):
+        """
+        Writes the reusable blocks to prefix_cache_path, e.g. on shutdown.
+        Blocks of running sequences are not saved.
+        """
+        assert self.enable_block_reuse and self.prefix_cache_path is not None
+        self.blocks_manager.save_prefix_cache(self.prefix_cache_path,
+                                              self.model_fingerprint)
+
+    def step(self,
+             finished: List[bool],
+             new_tokens: Optional[List[List[int]]] = None):
         """
         Iterate to the next generation step.
         Add new blocks where needed and clear finished sequences.
+        new_tokens holds the tokens the beams of each sequence write in the
+        step, if they are known, see add_tokens().
         """
-        for seq in self.sequences:
-            batch_idx = seq.get_batch_idx()
-            # Enable cyclic kv cache when it exceeds the max_attention_window_size
-            if self.lens[batch_idx] == self.max_attention_window_size:
-                continue
-            if not finished[batch_idx] and self.lens[
-                    batch_idx] % self.tokens_per_block == 0:
-                self.blocks_manager.allocate(seq)
-
-            self.lens[batch_idx] += 1
+        unfinished = [
+            seq for seq in self.sequences if not finished[seq.get_batch_idx()]
+        ]
+        self.add_tokens(
+            unfinished, None if new_tokens is None else
+            [new_tokens[seq.get_batch_idx()] for seq in unfinished])
+        for fi in range(len(finished)):
+            if finished[fi]:
+                self.lens[fi] += 1
 
         # Remove finished sequences
         for fi in range(len(finished)):
             if finished[fi]:
-                self.blocks_manager.free(self.sequences[fi])
+                self._store_blocks(fi)
+                for blocks_manager in self.blocks_managers:
+                    blocks_manager.free(self.sequences[fi])
         self.lens = [l for l, f in zip(self.lens, finished) if not f]
+        self.tokens = [t for t, f in zip(self.tokens, finished) if not f]
+        self.retention_priorities = [
+            p for p, f in zip(self.retention_priorities, finished) if not f
+        ]
+        self.cache_keys = [
+            k for k, f in zip(self.cache_keys, finished) if not f
+        ]
 
         # Remap sequence ids
         new_sequences = []
@@ -286,34 +1618,653 @@ class KVCacheManager(object):
                 batch_idx += 1
         self.sequences = new_sequences
 
-    def add_sequence(self, sequence: GenerationSequence, context_len: int):
+    def add_tokens(self,
+                   sequences: List[GenerationSequence],
+                   new_tokens: Optional[List[List[int]]] = None):
+        """
+        Adds the slot of the next token of the given sequences only, e.g. the
+        generation requests of an in-flight batch, allocating new blocks
+        where needed.
+        new_tokens holds the token each beam of each sequence writes to the
+        slot. Beams sharing blocks keep sharing them while they write the
+        same tokens. Without new_tokens, the beams are taken as diverging.
+        """
+        # Blocks shared by beams or published for reuse are copied before
+        # their first divergent write, also when a cyclic kv cache wraps
+        # around to them
+        pairs = [[] for _ in self.blocks_managers]
+        for si, seq in enumerate(sequences):
+            batch_idx = seq.get_batch_idx()
+            beam_tokens = None if new_tokens is None else new_tokens[si]
+            for gi, window in enumerate(self.attention_window_sizes):
+                pairs[gi] += self._prepare_write(batch_idx, gi, window,
+                                                 beam_tokens)
+            self.lens[batch_idx] += 1
+        for blocks_manager, group_pairs in zip(self.blocks_managers, pairs):
+            blocks_manager.copy_blocks(group_pairs)
+
+    def rebase_cache_indirection(self, cache_indirection: torch.Tensor):
+        """
+        Rebuilds the blocks of the beams of the sequences about to open a new
+        block from their block cache indirection, then points each beam at its
+        own blocks again. Must be called before step().
+        cache_indirection has shape [batch_size, beam_width,
+        1 + tokens_per_block]: for each beam, the beam whose blocks hold the
+        tokens before the current block, then the beam holding each token of
+        the current block. It is only read on the host once per
+        tokens_per_block steps.
+        """
+        assert self.block_cache_indirection
+        batch_indices = [
+            bi for bi, length in enumerate(self.lens)
+            if length > 0 and length % self.tokens_per_block == 0
+            and length < self.max_attention_window_size
+        ]
+        if len(batch_indices) == 0:
+            return
+        rows = cache_indirection[batch_indices].tolist()
+        for bi, seq_rows in zip(batch_indices, rows):
+            # Blocks released by a sequence may be allocated to the next one
+            self.blocks_manager.gather_blocks(
+                self.blocks_manager.rebuild_beams(
+                    self.sequences[bi],
+                    self.lens[bi] // self.tokens_per_block - 1, seq_rows),
+                self.num_kv_heads)
+        cache_indirection[batch_indices] = torch.arange(
+            self.beam_width,
+            dtype=cache_indirection.dtype,
+            device=cache_indirection.device)[:, None]
+
+    def _prepare_write(
+            self,
+            batch_idx: int,
+            group_idx: int,
+            window: int,
+            beam_tokens: Optional[List[int]] = None
+    ) -> List[Tuple[Block, Block]]:
+        """
+        Allocates the block receiving the next token of a sequence in the
+        pools of one attention window, and forks it if it is shared and the
+        beams write different tokens to it.
+        Pools with a shorter window than the sequence wrap around, as a
+        cyclic kv cache.
+        Returns the (src, dst) pairs to copy before the write.
+        """
+        seq = self.sequences[batch_idx]
+        blocks_manager = self.blocks_managers[group_idx]
+        length = self.lens[batch_idx]
+        if length % self.tokens_per_block == 0 and (self.enable_sliding_window
+                                                    or length < window):
+            num_blocks = blocks_manager.get_number_blocks(seq)
+            if self.enable_sliding_window and \
+                    num_blocks == blocks_manager.max_blocks_per_seq:
+                # The ring is full and its oldest block is out of the window
+                self._release_first_block(batch_idx)
+            blocks_manager.allocate(seq,
+                                    share_across_beam=self._beams_agree(
+                                        seq, group_idx, beam_tokens))
+        if self.enable_sliding_window:
+            block_pos = length // self.tokens_per_block - \
+                blocks_manager.first_block_idx.get(seq, 0)
+        else:
+            block_pos = length % window // self.tokens_per_block
+        return blocks_manager.fork(seq, block_pos, beam_tokens=beam_tokens)
+
+    def _beams_agree(self, seq: GenerationSequence, group_idx: int,
+                     beam_tokens: Optional[List[int]]) -> bool:
+        """
+        Returns whether all beams of seq still share their blocks and write
+        the same token, so that a new block is shared by the beams as well.
+        """
+        if beam_tokens is None or len(set(beam_tokens)) > 1:
+            return False
+        beams_blocks = self.blocks_managers[group_idx].allocated_blocks[seq]
+        return all(
+            len(blocks) == 0 or blocks[-1] is beams_blocks[0][-1]
+            for blocks in beams_blocks)
+
+    def _store_blocks(self, batch_idx: int):
+        """
+        Publish the context blocks of a finishing sequence for reuse.
+        Sequences that wrapped around the cyclic kv cache have overwritten
+        their context and are not stored.
+        """
+        tokens = self.tokens[batch_idx]
+        if tokens is None or (not self.enable_sliding_window and self.lens[
+                batch_idx] >= self.max_attention_window_size):
+            return
+        self.blocks_manager.store(tokens, self.sequences[batch_idx],
+                                  self.retention_priorities[batch_idx],
+                                  self.cache_keys[batch_idx])
+        self.tokens[batch_idx] = None
+
+    def store_context_blocks(self, sequence: GenerationSequence):
+        """
+        Publish the full context blocks of a sequence whose context has run,
+        so sequences sharing its prefix reuse them before it finishes. These
+        blocks are not written again. The last, partially filled block is
+        published when the sequence is released.
+        """
+        batch_idx = sequence.get_batch_idx()
+        tokens = self.tokens[batch_idx]
+        if tokens is None or self.blocks_manager.first_block_idx.get(
+                sequence, 0) > 0 or (not self.enable_sliding_window
+                                     and self.lens[batch_idx]
+                                     >= self.max_attention_window_size):
+            return
+        num_tokens = len(tokens) - len(tokens) % self.tokens_per_block
+        if num_tokens > 0:
+            self.blocks_manager.store(tokens[:num_tokens], sequence,
+                                      self.retention_priorities[batch_idx],
+                                      self.cache_keys[batch_idx])
+
+    def get_num_cached_tokens(self,
+                              input_ids: Sequence[int],
+                              cache_key: Optional[Hashable] = None) -> int:
+        """
+        Returns the length of the longest prefix of input_ids held by
+        reusable blocks, on device or in the host cache, without claiming
+        them.
+        """
+        if not self.enable_block_reuse:
+            return 0
+        _, num_matched = self.blocks_manager.prefix_tree.match(
+            input_ids, cache_key)
+        return num_matched
+
+    def _release_first_block(self, batch_idx: int):
+        """
+        Release the oldest block of a sequence with a sliding window.
+        The context blocks are published for reuse before the first of them
+        is released, so they stay cached until they are evicted.
+        """
+        self._store_blocks(batch_idx)
+        self.blocks_manager.release_first_block(self.sequences[batch_idx])
+
+    def remove_sequence(self,
+                        sequence: GenerationSequence,
+                        store_blocks: bool = True):
+        """
+        Frees the blocks of an unfinished sequence, e.g. to preempt it, and
+        remaps the following sequences. Its context blocks are published for
+        reuse if store_blocks.
+        """
+        batch_idx = sequence.get_batch_idx()
+        if store_blocks:
+            self._store_blocks(batch_idx)
+        for blocks_manager in self.blocks_managers:
+            blocks_manager.free(sequence)
+        for seq_state in (self.lens, self.sequences, self.tokens,
+                          self.retention_priorities, self.cache_keys):
+            seq_state.pop(batch_idx)
+        for seq in self.sequences[batch_idx:]:
+            seq.batch_idx -= 1
+
+    def export_sequence(self,
+                        sequence: GenerationSequence,
+                        device: str = 'cpu') -> Tuple:
+        """
+        Copies the blocks of a sequence to pinned host memory, or to device
+        memory, and removes it from the manager. The copies are enqueued on
+        the current stream.
+        Returns the state restored by import_sequence(), in this manager or
+        in the manager of another rank, see KVCacheTransceiver.
+        """
+        batch_idx = sequence.get_batch_idx()
+        blocks_states = [
+            blocks_manager.swap_out(sequence, device)
+            for blocks_manager in self.blocks_managers
+        ]
+        state = (blocks_states, self.lens[batch_idx], self.tokens[batch_idx],
+                 self.retention_priorities[batch_idx],
+                 self.cache_keys[batch_idx])
+        self.remove_sequence(sequence, store_blocks=False)
+        return state
+
+    def swap_out(self, sequence: GenerationSequence):
         """
-        Add sequence to the manager and allocate minimum amount of blocks for context
+        Moves the blocks of a sequence to the swap space in pinned host
+        memory and removes it from the manager until swap_in(). A preempted
+        sequence then resumes without recomputing its context.
         """
-        seq_len = min(context_len, self.max_attention_window_size)
+        if any(n > f for n, f in zip(self.get_num_blocks_to_swap_out(sequence),
+                                     self.get_num_free_swap_blocks())):
+            raise RuntimeError("Can't allocate swap space for KV cache")
+        self.swapped_sequences[sequence] = self.export_sequence(sequence)
+
+    def swap_in(self, sequence: GenerationSequence):
+        """
+        Restores a sequence moved to host memory by swap_out() as the last
+        sequence of the batch.
+        """
+        self.import_sequence(sequence, self.swapped_sequences[sequence])
+        self.swapped_sequences.pop(sequence)
+
+    def import_sequence(self, sequence: GenerationSequence, state: Tuple):
+        """
+        Adds a sequence exported by export_sequence() as the last sequence of
+        the batch, without recomputing its KV.
+        """
+        needed_blocks = [
+            get_num_swapped_blocks(blocks_state) for blocks_state in state[0]
+        ]
+        if any(n > f for n, f in zip(needed_blocks,
+                                     self.get_num_free_blocks())):
+            raise RuntimeError("Can't allocate new block for KV cache")
+        blocks_states, length, tokens, retention_priority, cache_key = state
+        sequence.batch_idx = len(self.sequences)
+        for blocks_manager, state in zip(self.blocks_managers, blocks_states):
+            blocks_manager.swap_in(sequence, state)
+        self.lens.append(length)
+        self.sequences.append(sequence)
+        self.tokens.append(tokens)
+        self.retention_priorities.append(retention_priority)
+        self.cache_keys.append(cache_key)
+
+    def is_swapped(self, sequence: GenerationSequence) -> bool:
+        return sequence in self.swapped_sequences
+
+    def get_num_free_swap_blocks(self) -> List[int]:
+        """
+        Returns the number of blocks the swap space holds for the pools of
+        each attention window, in the order of attention_window_sizes.
+        """
+        return [
+            len(blocks_manager.swap_free_slots)
+            for blocks_manager in self.blocks_managers
+        ]
+
+    def get_num_blocks_to_swap_out(
+            self, sequence: GenerationSequence) -> List[int]:
+        """
+        Returns the number of blocks of the swap space swap_out() takes for
+        a sequence in the pools of each attention window.
+        """
+        return [
+            blocks_manager.get_num_distinct_blocks(sequence)
+            for blocks_manager in self.blocks_managers
+        ]
+
+    def add_sequence(self,
+                     sequence: GenerationSequence,
+                     context_len: int,
+                     input_ids: Optional[Sequence[int]] = None,
+                     retention_priority: int = 0,
+                     cache_key: Optional[Hashable] = None) -> int:
+        """
+        Add sequence to the manager and allocate minimum amount of blocks for context.
+
+        When block reuse is enabled and input_ids is given, blocks of earlier
+        sequences matching a prefix of input_ids are reused. A partially
+        matching block is copied so the sequence can append to it.
+        Sequences run with a LoRA adapter or a prompt embedding table must
+        pass a cache_key identifying it, e.g. (lora_uid, prompt_task_id).
+        Blocks are only reused between sequences with equal cache_key.
+        Blocks touched by sequences with a higher retention_priority are
+        evicted last.
+        With the sliding window only the blocks of the last tokens that fit in
+        the ring are allocated.
+        Returns the number of context tokens already present in the cache.
+        At least one context token is always left to compute. Callers passing
+        input_ids must only compute the remaining context tokens, reused
+        blocks are read-only. GenerationSession passes no input_ids and runs
+        the whole context.
+        """
+        seq_len = context_len if self.enable_sliding_window else min(
+            context_len, self.max_attention_window_size)
         self.lens.append(seq_len)
         self.sequences.append(sequence)
 
+        reuse = self.enable_block_reuse and input_ids is not None and \
+            context_len <= self.max_attention_window_size
+        if reuse and isinstance(input_ids, torch.Tensor):
+            input_ids = input_ids.tolist()
+        self.tokens.append(tuple(input_ids[:context_len]) if reuse else None)
+        self.retention_priorities.append(retention_priority)
+        self.cache_keys.append(cache_key)
+
         # With beam_width > 1 we share context blocks between beams.
+        # The last block, which is only partially filled by the context, is
+        # shared as well until the beams write their first generated token.
+        num_blocks = math.ceil(seq_len / self.tokens_per_block)
+
+        num_prepopulated_tokens = 0
+        partial_block = None
+        if reuse:
+            matched_blocks, num_prepopulated_tokens = \
+                self.blocks_manager.match(input_ids[:context_len - 1],
+                                          retention_priority, cache_key)
+            num_full_blocks = num_prepopulated_tokens // self.tokens_per_block
+            for block in matched_blocks[:num_full_blocks]:
+                self.blocks_manager.reuse(sequence, block)
+                self.blocks_manager.release(block)
+            if num_full_blocks < len(matched_blocks):
+                # Copied on write as the context is appended to it
+                partial_block = matched_blocks[num_full_blocks]
+                self.blocks_manager.reuse(sequence, partial_block)
+                self.blocks_manager.release(partial_block)
+        else:
+            num_full_blocks = 0
+
+        if self.enable_sliding_window:
+            first_block_idx = max(
+                num_blocks - self.blocks_manager.max_blocks_per_seq, 0)
+            self.blocks_manager.first_block_idx[sequence] = first_block_idx
+            num_full_blocks = max(num_full_blocks, first_block_idx)
+
+        first_new_block = num_full_blocks + (partial_block is not None)
+        self.blocks_manager.allocate_context(
+            sequence, num_blocks - first_new_block,
+            max(seq_len // self.tokens_per_block - first_new_block, 0))
+
+        if partial_block is not None:
+            self.blocks_manager.copy_blocks(
+                self.blocks_manager.fork(sequence,
+                                         num_full_blocks,
+                                         share_across_beam=True))
+
+        # Pools of layers with a shorter window only hold its last tokens
+        for window, blocks_manager in zip(self.attention_window_sizes[1:],
+                                          self.blocks_managers[1:]):
+            for _ in range(math.ceil(
+                    min(context_len, window) / self.tokens_per_block)):
+                blocks_manager.allocate(sequence, share_across_beam=True)
+
+        return num_prepopulated_tokens
+
+    def get_num_free_blocks(self) -> List[int]:
+        """
+        Returns the number of free blocks in the pools of each attention
+        window, in the order of attention_window_sizes.
+        """
+        return [
+            blocks_manager.num_free_blocks()
+            for blocks_manager in self.blocks_managers
+        ]
+
+    def get_needed_blocks_one_step(
+            self,
+            sequence: Optional[GenerationSequence] = None) -> List[int]:
+        """
+        Returns the number of blocks the next step() allocates in the pools
+        of each attention window, in the order of attention_window_sizes.
+        Only the blocks of sequence are counted if it is given.
+        """
+        needed_blocks = [0] * len(self.blocks_managers)
+        sequences = self.sequences if sequence is None else [sequence]
+        for seq in sequences:
+            length = self.lens[seq.get_batch_idx()]
+            for gi, window in enumerate(self.attention_window_sizes):
+                blocks_manager = self.blocks_managers[gi]
+                if length % self.tokens_per_block == 0 and (
+                        self.enable_sliding_window or length < window):
+                    # New blocks are not shared, so they are never forked
+                    needed_blocks[gi] += self.beam_width
+                    continue
+                if self.enable_sliding_window:
+                    block_pos = length // self.tokens_per_block - \
+                        blocks_manager.first_block_idx.get(seq, 0)
+                else:
+                    block_pos = length % window // self.tokens_per_block
+                needed_blocks[gi] += blocks_manager.get_num_fork_blocks(
+                    seq, block_pos)
+        return needed_blocks
+
+    def get_needed_blocks_to_swap_in(
+            self, sequence: GenerationSequence) -> List[int]:
+        """
+        Returns the number of blocks a swapped out sequence needs in the pools
+        of each attention window to be restored and run its next step.
+        """
+        blocks_states, length = self.swapped_sequences[sequence][:2]
+        needed_blocks = []
+        for window, state in zip(self.attention_window_sizes, blocks_states):
+            num_blocks = get_num_swapped_blocks(state)
+            if length % self.tokens_per_block == 0 and (
+                    self.enable_sliding_window or length < window):
+                num_blocks += self.beam_width
+            needed_blocks.append(num_blocks)
+        return needed_blocks
+
+    def get_needed_blocks_to_completion(
+            self,
+            context_len: int,
+            max_new_tokens: int,
+            sequence: Optional[GenerationSequence] = None) -> List[int]:
+        """
+        Returns an upper bound of the number of blocks a new sequence needs
+        in the pools of each attention window to generate max_new_tokens, in
+        the order of attention_window_sizes. Reused blocks are not taken
+        into account. For a sequence already added to the manager, the
+        blocks it holds are deducted.
+        """
+        needed_blocks = []
+        for window, blocks_manager in zip(self.attention_window_sizes,
+                                          self.blocks_managers):
+            if self.enable_sliding_window:
+                needed_blocks.append(
+                    min(
+                        math.ceil((context_len + max_new_tokens) /
+                                  self.tokens_per_block),
+                        blocks_manager.max_blocks_per_seq))
+                continue
+            # Full context blocks are shared by the beams
+            num_shared_blocks = min(context_len,
+                                    window) // self.tokens_per_block
+            num_blocks = math.ceil(
+                min(context_len + max_new_tokens, window) /
+                self.tokens_per_block)
+            needed_blocks.append(num_shared_blocks +
+                                 (num_blocks - num_shared_blocks) *
+                                 self.beam_width)
+        if sequence is not None:
+            for gi, blocks_manager in enumerate(self.blocks_managers):
+                num_allocated_blocks = len(
+                    set(block.idx
+                        for beam_blocks in blocks_manager.allocated_blocks.get(
+                            sequence, []) for block in beam_blocks))
+                needed_blocks[gi] = max(
+                    needed_blocks[gi] - num_allocated_blocks, 0)
+        return needed_blocks
+
+    def get_kv_cache_stats(self) -> KvCacheStats:
+        """
+        Returns block usage and reuse counters
+        """
+        max_num_blocks = sum(blocks_manager.blocks
+                             for blocks_manager in self.blocks_managers)
+        free_num_blocks = sum(blocks_manager.num_free_blocks()
+                              for blocks_manager in self.blocks_managers)
+        return KvCacheStats(max_num_blocks=max_num_blocks,
+                            free_num_blocks=free_num_blocks,
+                            used_num_blocks=max_num_blocks - free_num_blocks,
+                            tokens_per_block=self.tokens_per_block,
+                            **self.blocks_manager.stats)
+
+    def get_pointer_arrays(self, beam_width: int) -> List[torch.Tensor]:
+        """
+        Returns arrays of pointers for all memory pools.
+        The arrays are updated in place by later calls.
+        """
+        for blocks_manager in self.blocks_managers:
+            dirty_rows = blocks_manager.update_pointer_arrays(beam_width)
+            if dirty_rows is None or self.device_dirty_rows is None:
+                self.device_dirty_rows = None
+            else:
+                self.device_dirty_rows.update(dirty_rows)
+        return [
+            self.blocks_managers[gi].pointer_arrays[pi].view(dtype=torch.int64)
+            for gi, pi in self.pool_locations
+        ]
+
+    def get_device_pointer_arrays(self,
+                                  beam_width: int,
+                                  device: str = 'cuda') -> List[torch.Tensor]:
+        """
+        Returns arrays of pointers for all memory pools on device.
+        Only the rows changed since the last call are copied and scattered
+        into the arrays, which are updated in place by later calls.
+        """
+        host_pointer_arrays = self.get_pointer_arrays(beam_width)
+        if self.device_dirty_rows is None:
+            self.device_pointer_arrays = [
+                pointer_array.to(device)
+                for pointer_array in host_pointer_arrays
+            ]
+        elif len(self.device_dirty_rows) > 0:
+            rows = torch.tensor(sorted(self.device_dirty_rows),
+                                dtype=torch.int64)
+            device_rows = rows.to(device)
+            for device_array, host_array in zip(self.device_pointer_arrays,
+                                                host_pointer_arrays):
+                device_array.index_copy_(
+                    0, device_rows,
+                    host_array.index_select(0, rows).to(device))
+        self.device_dirty_rows = set()
+        return self.device_pointer_arrays
+
 
-        # First get number of blocks that can be shared across different beams.
-        # This is only possible for complete blocks -> round down.
-        context_blocks = seq_len // self.tokens_per_block
-        for _ in range(context_blocks):
-            # Share context stage blocks within beam
-            self.blocks_manager.allocate(sequence, share_across_beam=True)
+class CppKVCacheManager(object):
+    """
+    The KV cache manager of the C++ runtime behind the interface of
+    KVCacheManager that GenerationSession uses. The C++ manager allocates the
+    pools of all the layers, and writes the block pointers of a batch into a
+    single tensor of [num_layers, batch_size * beam_width, 2,
+    max_blocks_per_seq] in one call, the pointer arrays of the layers are
+    views of it.
 
-        # allocate one more block if there are tokens that can't be shared across beams.
-        if seq_len % self.tokens_per_block > 0:
-            self.blocks_manager.allocate(sequence, share_across_beam=False)
+    The sequences take the slots of their batch indices and finish together.
+    All the layers share the attention window, the sliding window and the kv
+    cache block scaling are not supported.
+    """
+
+    def __init__(self,
+                 num_layers: int,
+                 num_heads: int,
+                 num_kv_heads: int,
+                 head_size: int,
+                 dtype: torch.dtype,
+                 blocks: int,
+                 tokens_per_block: int,
+                 max_blocks_per_seq: int,
+                 max_attention_window_size: int,
+                 max_num_sequences: int,
+                 beam_width: int = 1,
+                 enable_block_reuse: bool = False):
+        from ..bindings import DataType
+        from ..bindings import KVCacheManager as _KVCacheManager
+        data_types = {
+            torch.float32: DataType.FLOAT,
+            torch.float16: DataType.HALF,
+            torch.bfloat16: DataType.BF16,
+            # fp8 kv caches are held in int8 pools of the same size
+            torch.int8: DataType.INT8,
+        }
+        self.impl = _KVCacheManager(num_layers,
+                                    num_heads,
+                                    num_kv_heads,
+                                    num_heads * head_size,
+                                    tokens_per_block,
+                                    blocks,
+                                    max_num_sequences,
+                                    beam_width,
+                                    max_blocks_per_seq,
+                                    max_attention_window_size,
+                                    data_types[dtype],
+                                    enable_block_reuse=enable_block_reuse)
+        self.num_layers = num_layers
+        self.tokens_per_block = tokens_per_block
+        self.max_blocks_per_seq = max_blocks_per_seq
+        self.beam_width = beam_width
+        self.sequences = []
+        self.pointers = None
+        self.device_pointers = None
+
+    def add_sequence(self,
+                     sequence: GenerationSequence,
+                     context_len: int,
+                     input_ids: Optional[Sequence[int]] = None) -> int:
+        """
+        Add sequence to the manager and allocate the blocks of its context.
+        With block reuse and input_ids, the blocks of earlier sequences
+        matching a prefix of input_ids are reused.
+        Returns the number of context tokens already present in the cache.
+        """
+        batch_idx = sequence.get_batch_idx()
+        assert batch_idx == len(self.sequences), \
+            "Sequences must be added in the order of their batch indices"
+        self.impl.add_sequence(
+            batch_idx, context_len, self.beam_width,
+            list(input_ids) if input_ids is not None else None)
+        self.sequences.append(sequence)
+        return self.impl.get_num_prepopulated_tokens(batch_idx)
+
+    def step(self, finished: List[bool]):
+        """
+        Iterate to the next generation step.
+        Add new blocks where needed and clear finished sequences.
+        """
+        assert all(finished) or not any(finished), \
+            "The sequences of the C++ KV cache manager finish together"
+        for batch_idx in range(len(self.sequences)):
+            if finished[batch_idx]:
+                self.impl.remove_sequence(batch_idx)
+            else:
+                self.impl.add_token(batch_idx)
+        if all(finished):
+            self.sequences = []
+
+    def reset(self):
+        """
+        Remove the sequences left by an interrupted generation.
+        """
+        self.step([True] * len(self.sequences))
 
     def get_pointer_arrays(self, beam_width: int) -> List[torch.Tensor]:
         """
-        Returns arrays of pointers for all memory pools
+        Returns arrays of pointers for all layers.
+        The arrays are updated in place by later calls.
+        """
+        batch_size = len(self.sequences)
+        shape = (self.num_layers, batch_size * beam_width, 2,
+                 self.max_blocks_per_seq)
+        if self.pointers is None or tuple(self.pointers.shape) != shape:
+            self.pointers = torch.empty(shape, dtype=torch.int64)
+        self.impl.get_block_pointers_of_batch(self.pointers, 0, batch_size,
+                                              beam_width)
+        return list(
+            self.pointers.view(self.num_layers, batch_size, beam_width, 2,
+                               self.max_blocks_per_seq).unbind(0))
+
+    def get_device_pointer_arrays(self,
+                                  beam_width: int,
+                                  device: str = 'cuda') -> List[torch.Tensor]:
+        """
+        Returns arrays of pointers for all layers on device, copied with a
+        single transfer. The arrays are updated in place by later calls.
+        """
+        self.get_pointer_arrays(beam_width)
+        if self.device_pointers is None or \
+                self.device_pointers.shape != self.pointers.shape:
+            self.device_pointers = torch.empty_like(self.pointers,
+                                                    device=device)
+        self.device_pointers.copy_(self.pointers)
+        batch_size = len(self.sequences)
+        return list(
+            self.device_pointers.view(self.num_layers, batch_size, beam_width,
+                                      2, self.max_blocks_per_seq).unbind(0))
+
+    def get_kv_cache_stats(self) -> KvCacheStats:
+        """
+        Returns block usage and reuse counters
         """
-        pointer_arrays = []
-        for pool in range(self.num_pools):
-            pointer_arrays.append(
-                self.blocks_manager.get_pointer_array(
-                    pool, beam_width).view(dtype=torch.int64))
-        return pointer_arrays
+        stats = self.impl.get_kv_cache_stats()
+        reuse_stats = self.impl.get_kv_cache_reuse_stats()
+        # The C++ manager counts the blocks not found in the cache, the ones
+        # of the generated tokens included
+        return KvCacheStats(max_num_blocks=stats.max_num_blocks,
+                            free_num_blocks=stats.free_num_blocks,
+                            used_num_blocks=stats.used_num_blocks,
+                            tokens_per_block=stats.tokens_per_block,
+                            reused_blocks=reuse_stats.reused_blocks,
+                            missed_blocks=reuse_stats.alloc_new_blocks)
@@ -0,0 +1,199 @@
+# SPDX-FileCopyrightText: Copyright (c) 2022-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+import json
+from typing import Hashable, List, Optional, Tuple
+
+import torch
+
+from .kv_cache_manager import GenerationSequence, KVCacheManager
+
+# Block dtypes a peer may announce
+_DTYPES = {
+    str(dtype).split('.')[-1]: dtype
+    for dtype in (torch.float32, torch.float16, torch.bfloat16, torch.int8,
+                  torch.uint8, torch.float8_e4m3fn)
+}
+_METADATA_VERSION = 1
+
+
+def _encode_cache_key(cache_key: Optional[Hashable]):
+    if cache_key is None or isinstance(cache_key, (bool, int, float, str)):
+        return cache_key
+    if isinstance(cache_key, tuple):
+        return [_encode_cache_key(key) for key in cache_key]
+    raise TypeError(
+        f"cache_key {cache_key!r} must be None, a bool, int, float, str or "
+        "a tuple of them to be sent")
+
+
+def _decode_cache_key(cache_key) -> Optional[Hashable]:
+    # Cache keys are hashable, so the lists of the metadata were tuples
+    if isinstance(cache_key, list):
+        return tuple(_decode_cache_key(key) for key in cache_key)
+    return cache_key
+
+
+def _encode_metadata(blocks_states: List[Tuple], length: int,
+                     tokens: Optional[Tuple[int]], retention_priority: int,
+                     cache_key: Optional[Hashable]) -> bytes:
+    groups = [{
+        'layout': layout,
+        'first_block_idx': first_block_idx,
+        'blocks': [{
+            'shape': list(block.shape),
+            'dtype': str(block.dtype).split('.')[-1]
+        } for block in blocks]
+    } for layout, blocks, first_block_idx, _ in blocks_states]
+    return json.dumps({
+        'version': _METADATA_VERSION,
+        'groups': groups,
+        'length': length,
+        'tokens': None if tokens is None else list(tokens),
+        'retention_priority': retention_priority,
+        'cache_key': _encode_cache_key(cache_key),
+    }).encode()
+
+
+def _decode_metadata(metadata: bytes) -> Tuple:
+    """
+    Parses and validates the metadata sent by a peer. Returns the groups of
+    (layout, [(shape, dtype)], first_block_idx) and the other fields of the
+    state of export_sequence().
+    """
+
+    def check(condition: bool, field: str):
+        if not condition:
+            raise ValueError(f"Invalid KV cache metadata: {field}")
+
+    def is_int(value) -> bool:
+        return isinstance(value, int) and not isinstance(value, bool)
+
+    try:
+        fields = json.loads(metadata.decode())
+    except (UnicodeDecodeError, json.JSONDecodeError) as e:
+        raise ValueError(f"Invalid KV cache metadata: {e}")
+    check(isinstance(fields, dict), 'not an object')
+    check(fields.get('version') == _METADATA_VERSION, 'version')
+    groups = []
+    check(isinstance(fields.get('groups'), list), 'groups')
+    for group in fields['groups']:
+        check(isinstance(group, dict), 'groups')
+        layout = group.get('layout')
+        check(
+            isinstance(layout, list) and all(
+                isinstance(beam_layout, list) and all(
+                    is_int(bi) and bi >= 0 for bi in beam_layout)
+                for beam_layout in layout), 'layout')
+        first_block_idx = group.get('first_block_idx')
+        check(is_int(first_block_idx) and first_block_idx >= 0,
+              'first_block_idx')
+        blocks = []
+        check(isinstance(group.get('blocks'), list), 'blocks')
+        for block in group['blocks']:
+            check(isinstance(block, dict), 'blocks')
+            shape = block.get('shape')
+            # [num_blocks, 2, elts_per_block], the blocks of one pool
+            check(
+                isinstance(shape, list) and len(shape) == 3
+                and all(is_int(dim) and dim >= 0 for dim in shape), 'shape')
+            check(block.get('dtype') in _DTYPES, 'dtype')
+            check(
+                all(bi < shape[0] for beam_layout in layout
+                    for bi in beam_layout), 'layout')
+            blocks.append((shape, _DTYPES[block['dtype']]))
+        groups.append((layout, blocks, first_block_idx))
+    check(is_int(fields.get('length')) and fields['length'] >= 0, 'length')
+    tokens = fields.get('tokens')
+    check(
+        tokens is None or
+        (isinstance(tokens, list) and all(is_int(t) for t in tokens)),
+        'tokens')
+    check(is_int(fields.get('retention_priority')), 'retention_priority')
+    return (groups, fields['length'],
+            None if tokens is None else tuple(tokens),
+            fields['retention_priority'],
+            _decode_cache_key(fields.get('cache_key')))
+
+
+class KVCacheTransceiver(object):
+    """
+    Moves sequences between the KV cache managers of different ranks, for
+    disaggregated serving: ranks running only the context phase send each
+    sequence once its context is done, ranks running only the generation
+    phase adopt its blocks and decode without recomputing the context.
+
+    The communicator is any object with send(tensor, rank) and
+    recv(tensor, rank), such as
+    torch.classes.FasterTransformer.NcclCommunicatorOp. Both managers must
+    have the same block layout. Sends and receives of a pair of ranks must
+    be issued in the same order on both sides.
+
+    The metadata of a sequence is sent as JSON of a fixed schema, validated
+    on receipt, so a peer can only announce blocks and fields, not objects.
+    Sent cache keys are None, bool, int, float, str or tuples of them.
+    """
+
+    def __init__(self, communicator, device: str = 'cuda'):
+        self.communicator = communicator
+        self.device = device
+
+    def send_sequence(self, kv_cache_manager: KVCacheManager,
+                      sequence: GenerationSequence, rank: int):
+        """
+        Sends a sequence to rank and removes it from kv_cache_manager.
+        """
+        # Checked before the sequence is removed from the manager
+        _encode_cache_key(
+            kv_cache_manager.cache_keys[sequence.get_batch_idx()])
+        blocks_states, length, tokens, retention_priority, cache_key = \
+            kv_cache_manager.export_sequence(sequence, self.device)
+        metadata = _encode_metadata(blocks_states, length, tokens,
+                                    retention_priority, cache_key)
+        # The size first, so the receiver can allocate the metadata
+        self.communicator.send(
+            torch.tensor([len(metadata)], dtype=torch.int64,
+                         device=self.device), rank)
+        self.communicator.send(
+            torch.tensor(list(metadata), dtype=torch.uint8,
+                         device=self.device), rank)
+        for _, blocks, _, _ in blocks_states:
+            for block in blocks:
+                self.communicator.send(block, rank)
+
+    def recv_sequence(self, kv_cache_manager: KVCacheManager,
+                      sequence: GenerationSequence, rank: int):
+        """
+        Receives a sequence sent by rank and adds it as the last sequence of
+        the batch of kv_cache_manager.
+        """
+        size = torch.empty(1, dtype=torch.int64, device=self.device)
+        self.communicator.recv(size, rank)
+        metadata = torch.empty(size.item(),
+                               dtype=torch.uint8,
+                               device=self.device)
+        self.communicator.recv(metadata, rank)
+        groups, length, tokens, retention_priority, cache_key = \
+            _decode_metadata(bytes(metadata.tolist()))
+        blocks_states = []
+        for layout, shapes, first_block_idx in groups:
+            blocks = []
+            for shape, dtype in shapes:
+                block = torch.empty(shape, dtype=dtype, device=self.device)
+                self.communicator.recv(block, rank)
+                blocks.append(block)
+            blocks_states.append((layout, blocks, first_block_idx, []))
+        kv_cache_manager.import_sequence(
+            sequence,
+            (blocks_states, length, tokens, retention_priority, cache_key))
@@ -26,6 +26,7 @@ from .._utils import mpi_world_size
 from ..builder import Engine, get_engine_version
 from ..logger import logger
 from ..mapping import Mapping
+from ..models import MODEL_MAP
 from ..quantization import QuantMode
 from .generation import (ChatGLMGenerationSession, GenerationSession,
                          LogitsProcessor, LoraManager, ModelConfig,
@@ -126,6 +127,10 @@ def _builder_to_model_config(config: dict) -> Tuple[ModelConfig, dict]:
     lora_plugin = plugin_config.get('lora_plugin')
     use_context_fmha_for_generation = plugin_config.get(
         'use_context_fmha_for_generation')
+    sliding_window_kv_cache = plugin_config.get('sliding_window_kv_cache',
+                                                False)
+    block_cache_indirection = plugin_config.get('block_cache_indirection',
+                                                False)
 
     model_config = ModelConfig(
         vocab_size=vocab_size,
@@ -148,7 +153,9 @@ def _builder_to_model_config(config: dict) -> Tuple[ModelConfig, dict]:
         use_custom_all_reduce=use_custom_all_reduce,
         lora_plugin=lora_plugin,
         lora_target_modules=lora_target_modules,
-        use_context_fmha_for_generation=use_context_fmha_for_generation)
+        use_context_fmha_for_generation=use_context_fmha_for_generation,
+        sliding_window_kv_cache=sliding_window_kv_cache,
+        block_cache_indirection=block_cache_indirection)
 
     other_config = {
         'world_size': world_size,
@@ -185,6 +192,16 @@ class ModelRunnerMixin:
             raise RuntimeError(
                 f"Num beams ({sampling_config.num_beams}) exceeds the engine or specified limit ({self.max_beam_width})"
             )
+        if sampling_config.num_return_sequences > 1:
+            if sampling_config.num_beams > 1:
+                raise RuntimeError(
+                    "Sampling several sequences per prompt does not support beam search"
+                )
+            # The samples of a prompt take the beams of the engine
+            if sampling_config.num_return_sequences > self.max_beam_width:
+                raise RuntimeError(
+                    f"Num return sequences ({sampling_config.num_return_sequences}) exceeds the engine or specified beam width limit ({self.max_beam_width})"
+                )
 
     def _prepare_inputs(self, batch_input_ids: List[torch.Tensor],
                         pad_id: int) -> Tuple[torch.Tensor]:
@@ -321,7 +338,8 @@ class ModelRunner(ModelRunnerMixin):
                  lora_dir: Optional[str] = None,
                  rank: int = 0,
                  debug_mode: bool = False,
-                 lora_ckpt_source: str = "hf") -> 'ModelRunner':
+                 lora_ckpt_source: str = "hf",
+                 checkpoint_dir: Optional[str] = None) -> 'ModelRunner':
         """
         Create a ModelRunner instance from an engine directory.
 
@@ -334,6 +352,9 @@ class ModelRunner(ModelRunnerMixin):
                 The runtime rank id.
             debug_mode (bool):
                 Whether or not to turn on the debug mode.
+            checkpoint_dir (str):
+                The directory of an unsharded checkpoint (world_size 1) to load the weights from. They are sliced
+                for the mapping of the engine, which must be built with use_refit.
         Returns:
             ModelRunner: An instance of ModelRunner.
         """
@@ -342,6 +363,8 @@ class ModelRunner(ModelRunnerMixin):
         engine_version = get_engine_version(engine_dir)
         # the old engine format
         if engine_version is None:
+            assert checkpoint_dir is None, \
+                "Only engines of the new format can load an unsharded checkpoint"
             engine_dir = Path(engine_dir)
             config_path = engine_dir / "config.json"
             model_config, other_config = read_config(config_path)
@@ -376,6 +399,13 @@ class ModelRunner(ModelRunnerMixin):
             engine = Engine.from_dir(engine_dir, rank)
             pretrained_config = engine.config.pretrained_config
             build_config = engine.config.build_config
+            if checkpoint_dir is not None:
+                model_cls = MODEL_MAP[pretrained_config.architecture]
+                model = model_cls.from_checkpoint(
+                    checkpoint_dir,
+                    rank=rank,
+                    mapping=pretrained_config.mapping)
+                engine.refit(model)
 
             tp_size = pretrained_config.mapping.tp_size
             num_heads = pretrained_config.num_attention_heads // tp_size
@@ -536,6 +566,9 @@ class ModelRunner(ModelRunnerMixin):
             sampling_config = copy.deepcopy(sampling_config)
         sampling_config.update(**kwargs)
         self._check_inputs(batch_input_ids, sampling_config)
+        if sampling_config.num_top_log_probs > 0:
+            raise RuntimeError(
+                "Top log probs are only supported in C++ session.")
 
         batch_size = len(batch_input_ids)
         batch_input_ids, input_lengths = self._prepare_inputs(
@@ -549,7 +582,8 @@ class ModelRunner(ModelRunnerMixin):
             batch_size=batch_size,
             max_context_length=input_lengths.max().item(),
             max_new_tokens=sampling_config.max_new_tokens,
-            beam_width=sampling_config.num_beams,
+            beam_width=sampling_config.num_beams *
+            sampling_config.num_return_sequences,
             max_attention_window_size=sampling_config.max_attention_window_size,
             lora_manager=self.lora_manager,
             lora_uids=lora_uids)
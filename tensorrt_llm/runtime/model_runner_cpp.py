@@ -15,20 +15,23 @@
 
 import copy
 from pathlib import Path
-from typing import List, Optional, Union
+from typing import Dict, List, Optional, Union
 
 import torch
 
 from .. import profiler
 from ..bindings import (DataType, GenerationInput, GenerationOutput,
                         GptJsonConfig, GptSession, GptSessionConfig,
-                        KvCacheConfig, PromptTuningParams)
+                        GptSessionOptions, KvCacheConfig, PoolingType,
+                        PromptTuningParams)
 from ..bindings import SamplingConfig as GptSamplingConfig
 from ..bindings import WorldConfig
+from ..builder import get_engine_version
 from ..logger import logger
+from ..mapping import Mapping
 from .generation import (LogitsProcessor, LoraManager, SamplingConfig,
                          StoppingCriteria)
-from .model_runner import ModelRunnerMixin
+from .model_runner import ModelRunnerMixin, read_config
 
 _bindings_dtype_to_torch_dtype_dict = {
     DataType.FLOAT: torch.float,
@@ -53,7 +56,8 @@ class ModelRunnerCpp(ModelRunnerMixin):
                  max_input_len: int,
                  max_output_len: int,
                  max_beam_width: int,
-                 lora_manager: Optional[LoraManager] = None) -> None:
+                 lora_manager: Optional[LoraManager] = None,
+                 lora_target_modules: Optional[List[str]] = None) -> None:
         """
         Create a ModelRunnerCpp instance.
         You are recommended to use the from_dir method to load the engine and create a ModelRunnerCpp instance.
@@ -71,6 +75,8 @@ class ModelRunnerCpp(ModelRunnerMixin):
                 The maximum beam width.
             lora_manager (LoraManager):
                 The LoRA manager to handle LoRA weights.
+            lora_target_modules (List[str]):
+                The modules of the engine the LoRA weights apply to.
         """
         self.session = session
         self.max_batch_size = max_batch_size
@@ -78,6 +84,7 @@ class ModelRunnerCpp(ModelRunnerMixin):
         self.max_output_len = max_output_len
         self.max_beam_width = max_beam_width
         self.lora_manager = lora_manager
+        self.lora_target_modules = lora_target_modules
 
     @classmethod
     def from_dir(cls,
@@ -90,7 +97,8 @@ class ModelRunnerCpp(ModelRunnerMixin):
                  max_beam_width: Optional[int] = None,
                  max_attention_window_size: Optional[int] = None,
                  debug_mode: bool = False,
-                 lora_ckpt_source: str = "hf") -> 'ModelRunnerCpp':
+                 lora_ckpt_source: str = "hf",
+                 use_torch_allocator: bool = False) -> 'ModelRunnerCpp':
         """
         Create a ModelRunnerCpp instance from an engine directory.
 
@@ -123,6 +131,9 @@ class ModelRunnerCpp(ModelRunnerMixin):
                 Whether or not to turn on the debug mode.
             lora_ckpt_source (str):
                 Source of checkpoint. Should be one of ['hf', 'nemo'].
+            use_torch_allocator (bool):
+                Whether to allocate the GPU buffers of the session from the caching allocator of PyTorch, so that the
+                session and the PyTorch code of the process share one pool of GPU memory.
         Returns:
             ModelRunnerCpp: An instance of ModelRunnerCpp.
         """
@@ -163,7 +174,10 @@ class ModelRunnerCpp(ModelRunnerMixin):
                                           max_output_len)
         session_config.kv_cache_config = KvCacheConfig(
             max_attention_window=max_attention_window_size)
+        session_options = GptSessionOptions()
+        session_options.use_torch_allocator = use_torch_allocator
         session = GptSession(config=session_config,
+                             options=session_options,
                              model_config=model_config,
                              world_config=world_config,
                              engine_file=str(serialize_path))
@@ -171,11 +185,30 @@ class ModelRunnerCpp(ModelRunnerMixin):
         loading_time = profiler.elapsed_time_in_sec("load tensorrt_llm engine")
         logger.info(f'Load engine takes: {loading_time} sec')
 
-        # TODO: LoRA not supported
+        lora_manager = None
+        lora_target_modules = None
         if lora_dir is not None:
-            raise RuntimeError("LoRA is not supported in C++ session.")
+            if get_engine_version(str(engine_dir)) is not None:
+                raise RuntimeError(
+                    "LoRA is only supported for the engines of the old format."
+                )
+            lora_model_config, _ = read_config(config_path)
+            if not lora_model_config.lora_plugin:
+                raise RuntimeError(
+                    "The engine is not built with the LoRA plugin.")
+            runtime_mapping = Mapping(world_size=world_config.size,
+                                      rank=rank,
+                                      tp_size=tp_size,
+                                      pp_size=pp_size)
+            lora_manager = LoraManager()
+            lora_manager.load_from_ckpt(model_dir=lora_dir,
+                                        model_config=lora_model_config,
+                                        runtime_mapping=runtime_mapping,
+                                        ckpt_source=lora_ckpt_source)
+            lora_target_modules = lora_model_config.lora_target_modules
         return cls(session,
-                   lora_manager=None,
+                   lora_manager=lora_manager,
+                   lora_target_modules=lora_target_modules,
                    max_batch_size=max_batch_size,
                    max_input_len=max_input_len,
                    max_output_len=max_output_len,
@@ -274,7 +307,8 @@ class ModelRunnerCpp(ModelRunnerMixin):
                 If return_dict=False, the method returns generated output_ids.
                 If return_dict=True, the method returns a dict of output_ids,
                 sequence_lengths (if sampling_config.output_sequence_lengths=True),
-                context_logits and generation_logits (if self.gather_all_token_logits=True).
+                context_logits and generation_logits (if self.gather_all_token_logits=True),
+                top_log_prob_ids and top_log_probs (if sampling_config.num_top_log_probs > 0).
         """
         if sampling_config is None:
             sampling_config = SamplingConfig(end_id=None, pad_id=None)
@@ -283,10 +317,18 @@ class ModelRunnerCpp(ModelRunnerMixin):
         sampling_config.update(**kwargs)
         self._check_inputs(batch_input_ids, sampling_config)
         gpt_sampling_config = _populate_sampling_config(sampling_config)
-        if lora_uids is not None:
-            raise RuntimeError("LoRA is not supported in C++ session.")
+        if lora_uids is not None and self.lora_manager is None:
+            raise RuntimeError(
+                "LoRA weights are not loaded, pass lora_dir to from_dir.")
+        if self.lora_manager is not None:
+            assert lora_uids is not None, \
+                "lora_uids should not be None when LoRA weights are loaded."
         if streaming:
             raise RuntimeError("Streaming is not supported in C++ session.")
+        if sampling_config.num_return_sequences > 1:
+            raise RuntimeError(
+                "Sampling several sequences per prompt is not supported in C++ session."
+            )
         if stopping_criteria is not None:
             raise RuntimeError(
                 "Stopping criteria is not supported in C++ session.")
@@ -307,6 +349,9 @@ class ModelRunnerCpp(ModelRunnerMixin):
         generation_input.max_new_tokens = sampling_config.max_new_tokens
         generation_input.bad_words_list = sampling_config.bad_words_list
         generation_input.stop_words_list = sampling_config.stop_words_list
+        if self.lora_manager is not None:
+            generation_input.extra_inputs = self._prepare_lora_inputs(
+                lora_uids, batch_size)
 
         if self.max_prompt_embedding_table_size > 0:
             ptuning_kwargs = self._prepare_ptuning(prompt_table_path,
@@ -334,6 +379,14 @@ class ModelRunnerCpp(ModelRunnerMixin):
                 (batch_size, sampling_config.num_beams,
                  sampling_config.max_new_tokens - 1, self.vocab_size_padded),
                 device=cuda_device)
+        if sampling_config.num_top_log_probs > 0:
+            top_log_probs_shape = (batch_size, sampling_config.num_beams,
+                                   sampling_config.max_new_tokens,
+                                   sampling_config.num_top_log_probs)
+            generation_output.top_log_prob_ids = torch.empty(
+                top_log_probs_shape, dtype=torch.int32, device=cuda_device)
+            generation_output.top_log_probs = torch.empty(
+                top_log_probs_shape, dtype=torch.float32, device=cuda_device)
 
         self.session.generate(generation_output, generation_input,
                               gpt_sampling_config)
@@ -345,11 +398,77 @@ class ModelRunnerCpp(ModelRunnerMixin):
                 outputs['context_logits'] = generation_output.context_logits
                 outputs[
                     'generation_logits'] = generation_output.generation_logits
+            if sampling_config.num_top_log_probs > 0:
+                outputs['top_log_prob_ids'] = generation_output.top_log_prob_ids
+                outputs['top_log_probs'] = generation_output.top_log_probs
             outputs = self._prepare_outputs(outputs, input_lengths)
         else:
             outputs = generation_output.ids
         return outputs
 
+    def encode(self,
+               batch_input_ids: List[torch.Tensor],
+               pooling: str = 'last',
+               pad_id: int = 0) -> torch.Tensor:
+        """
+        Encodes sequences of token ids into embeddings, the pooled hidden states of their last layer.
+        Only the context phase runs, the engine must be built with output_hidden_states so that it skips the LM head.
+
+        Args:
+            batch_input_ids (List[torch.Tensor]):
+                A list of input id tensors. Each tensor is of shape (sequence_length, ).
+            pooling (str):
+                'last' for the hidden state of the last token, 'mean' for the mean of the hidden states of all the tokens.
+            pad_id (int):
+                The id padding the inputs of an engine built without remove_input_padding.
+        Returns:
+            torch.Tensor:
+                The embeddings of shape (batch_size, hidden_size), in float32.
+        """
+        pooling_types = {'last': PoolingType.LAST, 'mean': PoolingType.MEAN}
+        if pooling not in pooling_types:
+            raise ValueError(
+                f"Unknown pooling {pooling}, expected one of {list(pooling_types)}."
+            )
+        batch_size = len(batch_input_ids)
+        batch_input_ids, input_lengths = self._prepare_inputs(
+            batch_input_ids, pad_id)
+        generation_input = GenerationInput(pad_id, pad_id,
+                                           batch_input_ids.cuda(),
+                                           input_lengths.cuda(),
+                                           self.remove_input_padding)
+
+        hidden_size = (self.hidden_size *
+                       self.session.world_config.tensor_parallelism)
+        embeddings = torch.empty((batch_size, hidden_size),
+                                 dtype=torch.float32,
+                                 device=torch.device(self.session.device))
+        self.session.encode(embeddings, generation_input,
+                            pooling_types[pooling])
+        return embeddings
+
+    def _prepare_lora_inputs(self, lora_uids: list,
+                             batch_size: int) -> Dict[str, torch.Tensor]:
+        # The inputs GenerationSession sets, for all the layers: the session
+        # binds the ones of the layers of its pipeline-parallel rank.
+        assert len(lora_uids) == batch_size
+        lora_inputs = {}
+        pointers_list = self.lora_manager.lora_weights_pointers_list
+        for layer_idx in range(len(pointers_list)):
+            for lora_module in self.lora_target_modules:
+                ranks = torch.zeros(batch_size, dtype=torch.int32)
+                pointers = torch.zeros((batch_size, 2), dtype=torch.int64)
+                for batch_idx, lora_uid in enumerate(lora_uids):
+                    if lora_uid is not None and lora_uid != "-1":
+                        ranks[batch_idx] = self.lora_manager.uid_to_low_ranks(
+                            lora_uid)[layer_idx][lora_module]
+                        pointers[batch_idx] = torch.tensor(
+                            pointers_list[layer_idx][lora_uid][lora_module])
+                prefix = f'{lora_module}_lora'
+                lora_inputs[f'{prefix}_ranks_{layer_idx}'] = ranks
+                lora_inputs[f'{prefix}_weights_pointers_{layer_idx}'] = pointers
+        return lora_inputs
+
 
 def _populate_sampling_config(
         sampling_config: SamplingConfig) -> GptSamplingConfig:
@@ -173,6 +173,86 @@ class TestFunctional(unittest.TestCase):
                                    torch_output.cpu().numpy(),
                                    atol=1e-3)
 
+    def load_packed_test_cases():
+        # head size 48 is not covered by the fused kernels
+        return list(
+            product([[3, 17, 64, 1], [128, 5]], [16], [48, 64], [
+                ContextFMHAType.disabled, ContextFMHAType.enabled,
+                ContextFMHAType.enabled_with_fp32_acc
+            ], ['float16', 'float32']))
+
+    @parameterized.expand(load_packed_test_cases, name_func=custom_name_func)
+    def test_bert_attention_packed(self, lengths, num_heads, head_size,
+                                   context_fmha_type, dtype):
+        hidden_size = num_heads * head_size
+        max_len = max(lengths)
+        num_tokens = sum(lengths)
+        torch_dtype = tensorrt_llm._utils.str_dtype_to_torch(dtype)
+
+        qkv = torch.randn((num_tokens, 3 * hidden_size),
+                          dtype=torch_dtype,
+                          device='cuda')
+        input_lengths = torch.tensor(lengths, dtype=torch.int32, device='cuda')
+        max_input_length = torch.empty((max_len, ),
+                                       dtype=torch.int32,
+                                       device='cuda')
+
+        builder = tensorrt_llm.Builder()
+        net = builder.create_network()
+        net.plugin_config.set_bert_attention_plugin(dtype)
+        net.plugin_config.set_context_fmha(context_fmha_type)
+        net.plugin_config.enable_remove_input_padding()
+        with tensorrt_llm.net_guard(net):
+            network = tensorrt_llm.default_trtnet()
+            qkv_tensor = Tensor(name='qkv',
+                                shape=tuple(qkv.shape),
+                                dtype=tensorrt_llm.str_dtype_to_trt(dtype))
+            input_lengths_tensor = Tensor(
+                name='input_lengths',
+                shape=tuple(input_lengths.shape),
+                dtype=tensorrt_llm.str_dtype_to_trt('int32'))
+            max_input_length_tensor = Tensor(
+                name='max_input_length',
+                shape=tuple(max_input_length.shape),
+                dtype=tensorrt_llm.str_dtype_to_trt('int32'))
+            outputs = tensorrt_llm.functional.bert_attention(
+                qkv_tensor,
+                input_lengths_tensor,
+                num_heads=num_heads,
+                head_size=head_size,
+                q_scaling=1.0,
+                max_input_length=max_input_length_tensor)
+            network.mark_output(outputs.trt_tensor)
+            outputs.trt_tensor.name = 'output'
+            outputs.trt_tensor.dtype = tensorrt_llm.str_dtype_to_trt(dtype)
+
+        engine = EngineFromNetwork(
+            (builder.trt_builder, net.trt_network),
+            config=CreateConfig(fp16=(dtype == 'float16')))
+        with TrtRunner(engine) as runner:
+            output = runner.infer(
+                feed_dict={
+                    'qkv': qkv,
+                    'input_lengths': input_lengths,
+                    'max_input_length': max_input_length
+                })['output']
+
+        # torch execution, one sequence at a time
+        ref = []
+        for q, k, v in [
+                t.float().view(-1, 3, num_heads, head_size).unbind(1)
+                for t in torch.split(qkv, lengths)
+        ]:
+            scores = torch.einsum('qhd,khd->hqk', q, k) / head_size**0.5
+            ref.append(
+                torch.einsum('hqk,khd->qhd', scores.softmax(-1),
+                             v).reshape(-1, hidden_size))
+        ref = torch.cat(ref)
+
+        np.testing.assert_allclose(output.float().cpu().numpy(),
+                                   ref.cpu().numpy(),
+                                   atol=2e-2 if dtype == 'float16' else 1e-4)
+
 
 if __name__ == "__main__":
     unittest.main()
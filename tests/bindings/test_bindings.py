@@ -122,6 +122,15 @@ def test_gpt_session_config():
     gpt_session_config.gen_micro_batch_size = gen_micro_batch_size
     assert gpt_session_config.gen_micro_batch_size == gen_micro_batch_size
 
+    gpt_session_options = _tb.GptSessionOptions()
+    assert gpt_session_options.cuda_graph_cache_size == 1
+    assert gpt_session_options.weights_file is None
+    assert not gpt_session_options.use_torch_allocator
+    gpt_session_options.use_torch_allocator = True
+    assert gpt_session_options.use_torch_allocator
+    gpt_session_options.use_torch_allocator = False
+    assert not gpt_session_options.use_torch_allocator
+
 
 def test_quant_mode():
     assert _tb.QuantMode.none().value == 0
@@ -288,6 +297,19 @@ def test_sampling_config():
     check_empty_then_set("length_penalty", float_array)
 
 
+def test_truncation_config():
+    truncation_config = _tb.TruncationConfig()
+
+    def check_empty_then_set(member, value):
+        assert getattr(truncation_config, member) is None
+        setattr(truncation_config, member, value)
+        assert getattr(truncation_config, member) == value
+
+    float_array = [1., 2., 3.]
+    check_empty_then_set("min_p", float_array)
+    check_empty_then_set("typical_p", float_array)
+
+
 def test_gpt_json_config():
     model_config = {
         "vocab_size": 1000,
@@ -566,3 +588,48 @@ def test_trt_gpt_model_optional_params():
     assert opt_params.device_ids is None
     opt_params.device_ids = [0, 1]
     assert opt_params.device_ids == [0, 1]
+
+
+def test_kv_cache_manager():
+    num_layers = 2
+    max_blocks_per_seq = 3
+    kv_cache_manager = _tb.KVCacheManager(num_layers=num_layers,
+                                          num_heads=2,
+                                          num_kv_heads=1,
+                                          hidden_size=16,
+                                          tokens_per_block=4,
+                                          max_num_blocks=8,
+                                          max_num_sequences=2,
+                                          max_beam_width=1,
+                                          max_blocks_per_seq=max_blocks_per_seq,
+                                          max_attention_window=12,
+                                          dtype=_tb.DataType.HALF)
+    assert kv_cache_manager.tokens_per_block == 4
+    assert kv_cache_manager.max_num_blocks == 8
+    assert kv_cache_manager.num_free_blocks == 8
+    assert not kv_cache_manager.enable_block_reuse
+    assert len(kv_cache_manager.memory_pools) > 0
+
+    kv_cache_manager.add_sequence(0, 5, 1)
+    kv_cache_manager.add_sequence(1, 4, 1)
+    assert kv_cache_manager.num_free_blocks == 5
+
+    pointers = torch.zeros((num_layers, 2, 2, max_blocks_per_seq),
+                           dtype=torch.int64)
+    kv_cache_manager.get_block_pointers_of_batch(pointers, 0, 2, 1)
+    assert torch.all(pointers[:, 0, :, :2] != 0)
+    assert torch.all(pointers[:, 1, :, 0] != 0)
+    # The layers, and the K and V of a block, have their own pointers
+    assert pointers[0, 0, 0, 0] != pointers[1, 0, 0, 0]
+    assert pointers[0, 0, 0, 0] != pointers[0, 0, 1, 0]
+
+    # The fifth token of the second sequence starts a block
+    kv_cache_manager.add_token(1)
+    assert kv_cache_manager.num_free_blocks == 4
+
+    kv_cache_manager.remove_sequence(0)
+    kv_cache_manager.remove_sequence(1)
+    stats = kv_cache_manager.get_kv_cache_stats()
+    assert stats.free_num_blocks == 8
+    assert stats.used_num_blocks == 0
+    assert stats.alloc_total_blocks == 4
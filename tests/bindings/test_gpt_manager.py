@@ -10,11 +10,13 @@ from binding_test_utils import *
 import tensorrt_llm.bindings as _tb
 
 
+@pytest.mark.parametrize("mode", ["callbacks", "batched", "queued"])
 @pytest.mark.parametrize("variant, results_file", [
     ("fp16-plugin-packed-paged",
      "output_tokens_fp16_plugin_packed_paged_tp1_pp1.npy"),
 ])
-def test_gpt_manager(variant, results_file, llm_root: _pl.Path,
+def test_gpt_manager(variant, results_file, mode,
+                     llm_root: _pl.Path,
                      resource_path: _pl.Path, engine_path: _pl.Path,
                      data_path: _pl.Path, llm_model_root):
     model_dir = "gpt2"
@@ -132,6 +134,11 @@ def test_gpt_manager(variant, results_file, llm_root: _pl.Path,
 
         remaining_requests -= 1
 
+    def responses_cb(responses: _tp.List[_tp.Tuple[int, _tp.List[
+        _tb.NamedTensor], bool, str]]):
+        for response in responses:
+            response_cb(*response)
+
     def should_stop():
         return set()
 
@@ -140,8 +147,32 @@ def test_gpt_manager(variant, results_file, llm_root: _pl.Path,
 
     opt_params = _tb.TrtGptModelOptionalParams()
 
-    with _tb.GptManager(model_path, _tb.TrtGptModelType.InflightBatching, 1,
-                        _tb.SchedulerPolicy.MAX_UTILIZATION, fetch_requests,
-                        response_cb, should_stop, stats_cb, opt_params, 10000):
+    if mode == "queued":
+        # the requests are enqueued and the responses polled, without callbacks
+        with _tb.GptManager(model_path,
+                            _tb.TrtGptModelType.InflightBatching,
+                            1,
+                            _tb.SchedulerPolicy.MAX_UTILIZATION,
+                            optional_params=opt_params) as manager:
+            while inference_request_list:
+                manager.enqueue(inference_request_list.pop())
+            while remaining_requests > 0:
+                responses_cb(manager.poll_responses())
+                _time.sleep(0.1)
+        return
+
+    send_cbs = (None, responses_cb) if mode == "batched" else (response_cb,
+                                                               None)
+    with _tb.GptManager(model_path,
+                        _tb.TrtGptModelType.InflightBatching,
+                        1,
+                        _tb.SchedulerPolicy.MAX_UTILIZATION,
+                        fetch_requests,
+                        send_cbs[0],
+                        should_stop,
+                        stats_cb,
+                        opt_params,
+                        10000,
+                        send_responses_cb=send_cbs[1]):
         while remaining_requests > 0:
             _time.sleep(0.1)
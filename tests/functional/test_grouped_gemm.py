@@ -0,0 +1,103 @@
+# SPDX-FileCopyrightText: Copyright (c) 2022-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+import os
+import sys
+import unittest
+
+import numpy as np
+import pytest
+import torch
+from parameterized import parameterized
+from polygraphy.backend.trt import CreateConfig, EngineFromNetwork, TrtRunner
+
+import tensorrt_llm
+from tensorrt_llm import Tensor
+
+sys.path.append(os.path.join(os.path.dirname(__file__), '..'))
+from utils.util import getSMVersion
+
+
+class TestFunctional(unittest.TestCase):
+
+    def setUp(self):
+        tensorrt_llm.logger.set_level('error')
+
+    @parameterized.expand([('float16', 1, [1024, 1024]),
+                           ('float16', 4, [2048, 256, 256]),
+                           ('float16', 37, [512]),
+                           ('bfloat16', 8, [1024, 1024])])
+    def test_grouped_gemm(self, dtype, m, out_features):
+        # The CUTLASS grouped GEMM is compiled for sm80
+        if getSMVersion() < 80:
+            pytest.skip(
+                "Grouped GEMM is not supported in pre-ampere architecture")
+
+        torch_dtype = tensorrt_llm._utils.str_dtype_to_torch(dtype)
+        k = 512
+        x_data = torch.randn((m, k), dtype=torch_dtype, device='cuda')
+        w_data = [
+            torch.randn((n, k), dtype=torch_dtype, device='cuda') * 0.05
+            for n in out_features
+        ]
+
+        builder = tensorrt_llm.Builder()
+        net = builder.create_network()
+        net.plugin_config.set_grouped_gemm_plugin(dtype)
+        with tensorrt_llm.net_guard(net):
+            network = tensorrt_llm.default_trtnet()
+            x = Tensor(name='x',
+                       shape=x_data.shape,
+                       dtype=tensorrt_llm.str_dtype_to_trt(dtype))
+            ws = [
+                Tensor(name=f'w{i}',
+                       shape=w.shape,
+                       dtype=tensorrt_llm.str_dtype_to_trt(dtype))
+                for i, w in enumerate(w_data)
+            ]
+            outputs = tensorrt_llm.functional.grouped_gemm(x, ws)
+            for i, output in enumerate(outputs):
+                output = output.trt_tensor
+                output.name = f'output{i}'
+                network.mark_output(output)
+                output.dtype = tensorrt_llm.str_dtype_to_trt(dtype)
+
+        build_engine = EngineFromNetwork(
+            (builder.trt_builder, net.trt_network),
+            config=CreateConfig(fp16=(dtype == 'float16'),
+                                bf16=(dtype == 'bfloat16')))
+        feed_dict = {'x': x_data}
+        feed_dict.update({f'w{i}': w for i, w in enumerate(w_data)})
+        with TrtRunner(build_engine) as runner:
+            outputs = runner.infer(feed_dict=feed_dict)
+
+        for i, w in enumerate(w_data):
+            ref = torch.matmul(x_data.float(), w.float().t())
+            np.testing.assert_allclose(ref.cpu().numpy(),
+                                       outputs[f'output{i}'].float().cpu(),
+                                       atol=5e-2,
+                                       rtol=1e-2)
+
+    def test_grouped_gemm_no_plugin(self):
+        builder = tensorrt_llm.Builder()
+        net = builder.create_network()
+        with tensorrt_llm.net_guard(net):
+            tensorrt_llm.default_trtnet()
+            with self.assertRaisesRegex(
+                    TypeError, "Grouped GEMM is only supported with plugin"):
+                tensorrt_llm.functional.grouped_gemm(None, [])
+
+
+if __name__ == '__main__':
+    unittest.main()
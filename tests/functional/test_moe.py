@@ -28,6 +28,7 @@ import tensorrt_llm
 from tensorrt_llm import Tensor
 from tensorrt_llm._utils import torch_to_numpy, trt_dtype_to_torch
 from tensorrt_llm.layers.moe import MoeConfig
+from tensorrt_llm.models.llama.weight import groupwise_quantize_batched_matrix
 from tensorrt_llm.quantization import QuantMode
 
 sys.path.append(os.path.join(os.path.dirname(__file__), '..'))
@@ -56,9 +57,19 @@ def gen_uniform_weights(*args, **kwargs):
     return (torch.rand(*args, **kwargs) * 2 - 1).contiguous()
 
 
-def quant_dequant(weights, quant_mode):
+def quant_dequant(weights, quant_mode, group_size=0):
     if not quant_mode.is_weight_only():
         return weights
+    if group_size > 0:
+        # Same rounding as groupwise_quantize_batched_matrix
+        qmax = 7 if quant_mode.is_int4_weight_only() else 127
+        weights_t = weights.T.float()
+        grouped = weights_t.reshape(-1, group_size, weights_t.shape[-1])
+        scales = grouped.abs().amax(dim=1, keepdim=True).clamp(min=1e-8) / qmax
+        quant_weights = torch.clamp(torch.round(grouped / scales), -qmax - 1,
+                                    qmax)
+        result = quant_weights * scales.to(weights.dtype).float()
+        return result.reshape(weights_t.shape).T.to(weights.dtype).contiguous()
     # use the test version `_symmetric_...` to get the non-interleaved weights
     type = torch.quint4x2 if quant_mode.is_int4_weight_only() else torch.int8
     quant_weights, _, torch_weight_scales = torch.ops.fastertransformer._symmetric_quantize_last_axis_of_batched_matrix(
@@ -347,6 +358,53 @@ class TestFunctional(unittest.TestCase):
                                    rtol=tolerances[weight_dtype_str],
                                    atol=tolerances[weight_dtype_str])
 
+    @parameterized.expand([('float16', 'int4', 64), ('float16', 'int4', 128),
+                           ('float16', 'int8', 128), ('bfloat16', 'int4', 64)],
+                          name_func=custom_name_func)
+    def test_groupwise_weight_only(self, dtype_str, weight_dtype_str,
+                                   group_size):
+        """ Compares the MOE plugin with groupwise quantized expert weights to the reference implementation """
+        if getSMVersion() < 80:
+            pytest.skip("The groupwise MoE GEMM requires SM80+")
+        num_experts, top_k, hidden_size, actfn = 4, 2, 128, 'swiglu'
+        dtype = tensorrt_llm.str_dtype_to_trt(dtype_str)
+        quant_mode = QuantMode.use_weight_only(
+            use_int4_weights=weight_dtype_str == 'int4')
+
+        ffn_hidden_size = 4 * hidden_size
+        self.create_weights(num_experts,
+                            hidden_size,
+                            ffn_hidden_size,
+                            True,
+                            dtype,
+                            trt.int8,
+                            is_gated=True)
+
+        input_data = gen_uniform_weights((5, 4, hidden_size),
+                                         dtype=trt_dtype_to_torch(dtype))
+
+        trt_res = self.trtImpl(input_data,
+                               num_experts,
+                               top_k,
+                               hidden_size,
+                               ffn_hidden_size,
+                               actfn,
+                               True,
+                               dtype,
+                               weight_dtype=trt.int8,
+                               quant_mode=quant_mode,
+                               group_size=group_size)['output'].float()
+
+        ref = self.referenceImpl(input_data,
+                                 top_k,
+                                 actfn,
+                                 trt.int8,
+                                 quant_mode,
+                                 MoeConfig.ExpertScaleNormalizationMode.NONE,
+                                 group_size=group_size).cpu().float()
+
+        np.testing.assert_allclose(trt_res, ref, rtol=2e-1, atol=2e-1)
+
     @staticmethod
     def get_mlp_params():
         params = []
@@ -456,14 +514,23 @@ class TestFunctional(unittest.TestCase):
                                    rtol=tolerances[dtype_str],
                                    atol=tolerances[dtype_str])
 
-    def set_weight_layer(self, input_weights, weight, scale, quant_mode):
+    def set_weight_layer(self,
+                         input_weights,
+                         weight,
+                         scale,
+                         quant_mode,
+                         group_size=0):
         if quant_mode.is_weight_only():
             torch_transpose = torch.transpose(input_weights, 1,
                                               2).contiguous().cpu()
             type = torch.quint4x2 if quant_mode.is_int4_weight_only(
             ) else torch.int8
-            processed_torch_weights, torch_weight_scales = torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
-                torch_transpose, type)
+            if group_size > 0:
+                processed_torch_weights, torch_weight_scales = groupwise_quantize_batched_matrix(
+                    torch_transpose, type, group_size)
+            else:
+                processed_torch_weights, torch_weight_scales = torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
+                    torch_transpose, type)
             # Change the shape to what moe expects without touching the underlying format
             weight.value = np.ascontiguousarray(
                 torch_to_numpy(processed_torch_weights))
@@ -485,7 +552,8 @@ class TestFunctional(unittest.TestCase):
                 quant_mode=QuantMode(0),
                 norm_mode=MoeConfig.ExpertScaleNormalizationMode.NONE,
                 finished=None,
-                custom_network=None):
+                custom_network=None,
+                group_size=0):
         builder = tensorrt_llm.Builder()
         net = builder.create_network()
         with tensorrt_llm.net_guard(net):
@@ -501,7 +569,8 @@ class TestFunctional(unittest.TestCase):
             moe = tensorrt_llm.layers.MOE(moe_config=MoeConfig(
                 num_experts=num_experts,
                 top_k=top_k,
-                normalization_mode=norm_mode),
+                normalization_mode=norm_mode,
+                group_size=group_size),
                                           hidden_size=hidden_size,
                                           ffn_hidden_size=ffn_hidden_size,
                                           hidden_act=actfn,
@@ -510,9 +579,9 @@ class TestFunctional(unittest.TestCase):
                                           quant_mode=quant_mode)
             moe.router.weight.value = torch_to_numpy(self.router_weights.cpu())
             self.set_weight_layer(self.fc1_weights, moe.experts_weight_1,
-                                  moe.experts_scale_1, quant_mode)
+                                  moe.experts_scale_1, quant_mode, group_size)
             self.set_weight_layer(self.fc2_weights, moe.experts_weight_2,
-                                  moe.experts_scale_2, quant_mode)
+                                  moe.experts_scale_2, quant_mode, group_size)
             if bias:
                 moe.experts_bias_1.value = torch_to_numpy(self.fc1_bias.cpu())
                 moe.experts_bias_2.value = torch_to_numpy(self.fc2_bias.cpu())
@@ -543,8 +612,14 @@ class TestFunctional(unittest.TestCase):
             outputs = runner.infer(feed_dict=feed_dict)
         return outputs
 
-    def referenceImpl(self, inputs, k, actfn, weight_dtype, quant_mode,
-                      norm_mode):
+    def referenceImpl(self,
+                      inputs,
+                      k,
+                      actfn,
+                      weight_dtype,
+                      quant_mode,
+                      norm_mode,
+                      group_size=0):
         # Always run the ref implementation at full precision TODO is this a good choice?
         inputs = inputs.cuda().float()
         inputs_merged = inputs.view(-1, inputs.shape[-1])
@@ -562,7 +637,8 @@ class TestFunctional(unittest.TestCase):
                 scales /= sum(scales)
             input = inputs_merged[i, :]
             for scale, expert in zip(scales, experts):
-                fc1_qd = quant_dequant(self.fc1_weights[expert], quant_mode)
+                fc1_qd = quant_dequant(self.fc1_weights[expert], quant_mode,
+                                       group_size)
                 if is_gated_activation(actfn):
                     fc1 = gated_matmul(input, fc1_qd.float(),
                                        self.fc1_bias[expert].float(), actfn)
@@ -571,7 +647,8 @@ class TestFunctional(unittest.TestCase):
                         input,
                         fc1_qd.T.float()) + self.fc1_bias[expert].float()
                     fc1 = doact(fc1, actfn)
-                fc2_qd = quant_dequant(self.fc2_weights[expert], quant_mode)
+                fc2_qd = quant_dequant(self.fc2_weights[expert], quant_mode,
+                                       group_size)
                 final = torch.matmul(
                     fc1, fc2_qd.T.float()) + self.fc2_bias[expert].float()
                 assert final.shape == (inputs.shape[-1], )
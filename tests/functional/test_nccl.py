@@ -28,7 +28,8 @@ from polygraphy.backend.trt import CreateConfig, EngineFromNetwork
 import tensorrt_llm as tllm
 from tensorrt_llm import Mapping, Tensor
 from tensorrt_llm._ipc_utils import IpcMemory, peer_access
-from tensorrt_llm.functional import AllReduceStrategy, allreduce
+from tensorrt_llm.functional import (AllReduceFusionOp, AllReduceStrategy,
+                                     allreduce, gemm_allreduce, reduce_scatter)
 
 
 def custom_name_func(testcase_func, param_num, param):
@@ -58,7 +59,8 @@ class TestCommunicationPlugin(unittest.TestCase):
     @parameterized.expand(list(
         product(["bfloat16", 'float16', "float32"], [
             AllReduceStrategy.RING, AllReduceStrategy.ONESHOT,
-            AllReduceStrategy.TWOSHOT
+            AllReduceStrategy.TWOSHOT, AllReduceStrategy.NVLS,
+            AllReduceStrategy.LOWLATENCY
         ], [64 * 70000, 64 * 70, 64])),
                           name_func=custom_name_func)
     def test_nccl_allreduce(self, dtype: str, strategy: AllReduceStrategy,
@@ -144,6 +146,350 @@ class TestCommunicationPlugin(unittest.TestCase):
                            (self.mapping.tp_size**(inner_loop - 1)) *
                            allreduce_ref.cpu()))
 
+    @parameterized.expand(list(
+        product(["bfloat16", 'float16', "float32"],
+                [64 * 70000, 64 * 70, 64])),
+                          name_func=custom_name_func)
+    def test_hierarchical_allreduce(self, dtype: str, size: int):
+        # Splits the GPUs in two pretend nodes, the ranks of each sharing an
+        # IPC workspace and reducing between the nodes with NCCL.
+        if self.world_size < 4 or self.world_size % 4 != 0:
+            pytest.skip()
+
+        node_mapping = Mapping(self.world_size,
+                               self.rank,
+                               gpus_per_node=self.world_size // 2,
+                               tp_size=self.world_size)
+        ipc_buffers = IpcMemory(node_mapping, IpcMemory.IPC_BUFFERS_SIZE)
+        ipc_barriers_in = IpcMemory(
+            node_mapping,
+            IpcMemory.IPC_BARRIERS_SIZE_PER_GPU * node_mapping.local_tp_size())
+        ipc_barriers_out = IpcMemory(
+            node_mapping,
+            IpcMemory.IPC_BARRIERS_SIZE_PER_GPU * node_mapping.local_tp_size())
+        workspace = torch.tensor(ipc_buffers.serialize() +
+                                 ipc_barriers_in.serialize() +
+                                 ipc_barriers_out.serialize(),
+                                 dtype=torch.int64,
+                                 device="cpu")
+
+        torch_dtype = tllm._utils.str_dtype_to_torch(dtype)
+        allreduce_ref = torch.zeros(self.reference_tensors[0][:size].shape,
+                                    dtype=torch_dtype,
+                                    device="cuda")
+        for i in range(self.world_size):
+            allreduce_ref = allreduce_ref + self.reference_tensors[i][:size].to(
+                torch_dtype)
+
+        builder = tllm.Builder()
+        net = builder.create_network()
+        net.plugin_config.set_nccl_plugin(dtype)
+
+        input = self.reference_tensors[self.rank][:size].to(torch_dtype)
+
+        with peer_access(self.mapping):
+            with tllm.net_guard(net):
+                network = tllm.default_trtnet()
+
+                x = Tensor(name='x',
+                           shape=input.shape,
+                           dtype=tllm.str_dtype_to_trt(dtype))
+                w = Tensor(name='workspace',
+                           shape=workspace.shape,
+                           dtype=trt.int64)
+
+                output = allreduce(
+                    x,
+                    node_mapping.tp_group,
+                    w,
+                    0,
+                    AllReduceStrategy.HIERARCHICAL,
+                    ranks_per_node=node_mapping.local_tp_size()).trt_tensor
+                output.name = 'output'
+                output.dtype = tllm.str_dtype_to_trt(dtype)
+                network.mark_output(output)
+
+            build_engine = EngineFromNetwork(
+                (builder.trt_builder, net.trt_network),
+                config=CreateConfig(
+                    fp16=(dtype == 'float16'),
+                    bf16=(dtype == 'bfloat16'),
+                    precision_constraints='obey',
+                ))
+
+            output = torch.zeros_like(input)
+
+            stream = torch.cuda.current_stream()
+            feed_dict = {'x': input, 'workspace': workspace}
+
+            session = tllm.runtime.Session.from_engine(build_engine())
+            session.run(inputs=feed_dict,
+                        outputs={"output": output},
+                        stream=stream.cuda_stream)
+            torch.cuda.synchronize()
+
+        self.assertTrue(torch.allclose(output.cpu(), allreduce_ref.cpu()))
+
+    @parameterized.expand(list(
+        product(["bfloat16", 'float16', "float32"], [
+            AllReduceStrategy.RING, AllReduceStrategy.ONESHOT,
+            AllReduceStrategy.TWOSHOT
+        ], [(16, 1024), (1, 4096)])),
+                          name_func=custom_name_func)
+    def test_allreduce_residual_rms_norm(self, dtype: str,
+                                         strategy: AllReduceStrategy,
+                                         shape: tuple):
+        if self.world_size == 1:
+            pytest.skip()
+
+        ipc_buffers = IpcMemory(self.mapping, IpcMemory.IPC_BUFFERS_SIZE)
+        ipc_barriers_in = IpcMemory(
+            self.mapping,
+            IpcMemory.IPC_BARRIERS_SIZE_PER_GPU * self.mapping.tp_size)
+        ipc_barriers_out = IpcMemory(
+            self.mapping,
+            IpcMemory.IPC_BARRIERS_SIZE_PER_GPU * self.mapping.tp_size)
+        workspace = torch.tensor(ipc_buffers.serialize() +
+                                 ipc_barriers_in.serialize() +
+                                 ipc_barriers_out.serialize(),
+                                 dtype=torch.int64,
+                                 device="cpu")
+
+        torch_dtype = tllm._utils.str_dtype_to_torch(dtype)
+        eps = 1e-5
+        torch.manual_seed(42)
+        inputs = [
+            torch.randn(shape, dtype=torch.float32, device="cuda")
+            for _ in range(self.world_size)
+        ]
+        residual = torch.randn(shape, dtype=torch.float32,
+                               device="cuda").to(torch_dtype)
+        gamma = torch.randn(shape[-1], dtype=torch.float32,
+                            device="cuda").to(torch_dtype)
+
+        residual_ref = residual.float()
+        for i in range(self.world_size):
+            residual_ref = residual_ref + inputs[i].to(torch_dtype).float()
+        residual_ref = residual_ref.to(torch_dtype).float()
+        normed_ref = residual_ref * torch.rsqrt(
+            residual_ref.pow(2).mean(-1, keepdim=True) + eps) * gamma.float()
+
+        builder = tllm.Builder()
+        net = builder.create_network()
+        net.plugin_config.set_nccl_plugin(dtype)
+
+        input = inputs[self.rank].to(torch_dtype)
+
+        with peer_access(self.mapping):
+            with tllm.net_guard(net):
+                network = tllm.default_trtnet()
+
+                x = Tensor(name='x',
+                           shape=input.shape,
+                           dtype=tllm.str_dtype_to_trt(dtype))
+                res = Tensor(name='residual',
+                             shape=residual.shape,
+                             dtype=tllm.str_dtype_to_trt(dtype))
+                weight = Tensor(name='gamma',
+                                shape=gamma.shape,
+                                dtype=tllm.str_dtype_to_trt(dtype))
+                w = Tensor(name='workspace',
+                           shape=workspace.shape,
+                           dtype=trt.int64)
+
+                normed, residual_out = allreduce(
+                    x,
+                    self.mapping.tp_group,
+                    w if strategy != AllReduceStrategy.RING else None,
+                    0,
+                    strategy,
+                    fusion_op=AllReduceFusionOp.RESIDUAL_RMS_NORM,
+                    residual=res,
+                    norm_weight=weight,
+                    eps=eps)
+                for name, tensor in [('output', normed),
+                                     ('residual_out', residual_out)]:
+                    tensor.trt_tensor.name = name
+                    tensor.trt_tensor.dtype = tllm.str_dtype_to_trt(dtype)
+                    network.mark_output(tensor.trt_tensor)
+
+            build_engine = EngineFromNetwork(
+                (builder.trt_builder, net.trt_network),
+                config=CreateConfig(
+                    fp16=(dtype == 'float16'),
+                    bf16=(dtype == 'bfloat16'),
+                    precision_constraints='obey',
+                ))
+
+            output = torch.zeros_like(input)
+            output_residual = torch.zeros_like(input)
+
+            stream = torch.cuda.current_stream()
+            feed_dict = {
+                'x': input,
+                'residual': residual,
+                'gamma': gamma,
+                'workspace': workspace
+            }
+
+            session = tllm.runtime.Session.from_engine(build_engine())
+            session.run(inputs=feed_dict,
+                        outputs={
+                            "output": output,
+                            "residual_out": output_residual
+                        },
+                        stream=stream.cuda_stream)
+            torch.cuda.synchronize()
+
+        atol = 1e-5 if dtype == "float32" else 5e-2
+        torch.testing.assert_close(output_residual.float(),
+                                   residual_ref,
+                                   atol=atol,
+                                   rtol=1e-2)
+        torch.testing.assert_close(output.float(),
+                                   normed_ref,
+                                   atol=atol * 4,
+                                   rtol=1e-2)
+
+    @parameterized.expand(list(
+        product(["bfloat16", 'float16', "float32"], [(1, 256), (37, 512)],
+                [1, 4])),
+                          name_func=custom_name_func)
+    def test_gemm_allreduce(self, dtype: str, shape: tuple, num_chunks: int):
+        if self.world_size == 1:
+            pytest.skip()
+
+        m, k = shape
+        n = 1024
+        torch_dtype = tllm._utils.str_dtype_to_torch(dtype)
+        torch.manual_seed(42)
+        inputs = [
+            torch.randn([m, k], dtype=torch.float32, device="cuda") / k
+            for _ in range(self.world_size)
+        ]
+        weights = [
+            torch.randn([n, k], dtype=torch.float32, device="cuda")
+            for _ in range(self.world_size)
+        ]
+        output_ref = torch.zeros([m, n], dtype=torch.float32, device="cuda")
+        for i in range(self.world_size):
+            output_ref = output_ref + inputs[i].to(torch_dtype).float(
+            ) @ weights[i].to(torch_dtype).float().t()
+
+        builder = tllm.Builder()
+        net = builder.create_network()
+        net.plugin_config.set_nccl_plugin(dtype)
+
+        input = inputs[self.rank].to(torch_dtype)
+        weight = weights[self.rank].to(torch_dtype)
+
+        with tllm.net_guard(net):
+            network = tllm.default_trtnet()
+
+            x = Tensor(name='x',
+                       shape=input.shape,
+                       dtype=tllm.str_dtype_to_trt(dtype))
+            w = Tensor(name='weight',
+                       shape=weight.shape,
+                       dtype=tllm.str_dtype_to_trt(dtype))
+
+            output = gemm_allreduce(x, w, self.mapping.tp_group,
+                                    num_chunks).trt_tensor
+            output.name = 'output'
+            output.dtype = tllm.str_dtype_to_trt(dtype)
+            network.mark_output(output)
+
+        build_engine = EngineFromNetwork(
+            (builder.trt_builder, net.trt_network),
+            config=CreateConfig(
+                fp16=(dtype == 'float16'),
+                bf16=(dtype == 'bfloat16'),
+                precision_constraints='obey',
+            ))
+
+        output = torch.zeros([m, n], dtype=torch_dtype, device="cuda")
+
+        stream = torch.cuda.current_stream()
+        feed_dict = {'x': input, 'weight': weight}
+
+        session = tllm.runtime.Session.from_engine(build_engine())
+        session.run(inputs=feed_dict,
+                    outputs={"output": output},
+                    stream=stream.cuda_stream)
+        torch.cuda.synchronize()
+
+        atol = 1e-3 if dtype == "float32" else 5e-2
+        torch.testing.assert_close(output.float(),
+                                   output_ref,
+                                   atol=atol,
+                                   rtol=1e-2)
+
+    @parameterized.expand(list(product(["bfloat16", 'float16', "float32"],
+                                       [1, 37])),
+                          name_func=custom_name_func)
+    def test_reduce_scatter(self, dtype: str, tokens_per_rank: int):
+        if self.world_size == 1:
+            pytest.skip()
+
+        hidden_size = 256
+        torch_dtype = tllm._utils.str_dtype_to_torch(dtype)
+        torch.manual_seed(42)
+        inputs = [
+            torch.randn([tokens_per_rank * self.world_size, hidden_size],
+                        dtype=torch.float32,
+                        device="cuda").to(torch_dtype)
+            for _ in range(self.world_size)
+        ]
+        output_ref = torch.zeros_like(inputs[0], dtype=torch.float32)
+        for i in range(self.world_size):
+            output_ref = output_ref + inputs[i].float()
+        output_ref = output_ref.chunk(self.world_size)[self.rank]
+
+        builder = tllm.Builder()
+        net = builder.create_network()
+        net.plugin_config.set_nccl_plugin(dtype)
+
+        input = inputs[self.rank]
+
+        with tllm.net_guard(net):
+            network = tllm.default_trtnet()
+
+            x = Tensor(name='x',
+                       shape=input.shape,
+                       dtype=tllm.str_dtype_to_trt(dtype))
+
+            output = reduce_scatter(x, self.mapping.tp_group).trt_tensor
+            output.name = 'output'
+            output.dtype = tllm.str_dtype_to_trt(dtype)
+            network.mark_output(output)
+
+        build_engine = EngineFromNetwork(
+            (builder.trt_builder, net.trt_network),
+            config=CreateConfig(
+                fp16=(dtype == 'float16'),
+                bf16=(dtype == 'bfloat16'),
+                precision_constraints='obey',
+            ))
+
+        output = torch.zeros([tokens_per_rank, hidden_size],
+                             dtype=torch_dtype,
+                             device="cuda")
+
+        stream = torch.cuda.current_stream()
+        feed_dict = {'x': input}
+
+        session = tllm.runtime.Session.from_engine(build_engine())
+        session.run(inputs=feed_dict,
+                    outputs={"output": output},
+                    stream=stream.cuda_stream)
+        torch.cuda.synchronize()
+
+        atol = 1e-5 if dtype == "float32" else 5e-2
+        torch.testing.assert_close(output.float(),
+                                   output_ref,
+                                   atol=atol,
+                                   rtol=1e-2)
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -1,11 +1,13 @@
+import asyncio
 import os
 import tempfile
 from typing import List
 
 from transformers import AutoTokenizer
 
-from tensorrt_llm.hlapi.llm import (LLM, ModelConfig, SamplingConfig,
-                                    TokenIdsTy, TokenizerBase)
+from tensorrt_llm.hlapi.llm import (LLM, GptManagerRouter, ModelConfig,
+                                    RoutingPolicy, SamplingConfig, TokenIdsTy,
+                                    TokenizerBase)
 
 llm_models_root = os.environ.get('LLM_MODELS_ROOT',
                                  '/scratch.trt_llm_data/llm-models/')
@@ -102,3 +104,73 @@ def test_llm_without_tokenizer():
 
     for output in llm(prompts, sampling_config=sampling_config):
         print(output)
+
+
+def test_llm_generate_async():
+    config = ModelConfig(model_dir=llama_model_path)
+    config.build_config.plugin_config.set_gpt_attention_plugin()
+    config.build_config.plugin_config.enable_paged_kv_cache()
+    config.build_config.plugin_config.enable_remove_input_padding()
+    llm = LLM(config)
+
+    prompts = ["hello world", "What is"]
+
+    async def generate(prompt: str, streaming: bool):
+        text = ""
+        async for output in llm.generate_async(prompt, streaming=streaming):
+            text += output.generate_pieces[0].text
+        return text
+
+    async def main():
+        # the concurrent calls share the in-flight batch
+        streamed = await asyncio.gather(
+            *[generate(prompt, streaming=True) for prompt in prompts])
+        whole = await asyncio.gather(
+            *[generate(prompt, streaming=False) for prompt in prompts])
+        assert len(streamed) == len(prompts)
+        assert all(text for text in streamed)
+        assert streamed == whole
+
+    asyncio.run(main())
+    llm.shutdown()
+
+
+class FakeExecutor:
+
+    def __init__(self, name: str, free_kv_blocks=None):
+        self.name = name
+        self.num_active_requests = 0
+        self._free_kv_blocks = free_kv_blocks
+
+    def free_kv_blocks(self):
+        return self._free_kv_blocks
+
+    def submit(self, input_ids, sampling_config, streaming):
+        self.num_active_requests += 1
+        return self.name, None
+
+
+def test_gpt_manager_router():
+    # the replicas without stats come first, then the ones with the most free blocks
+    router = GptManagerRouter([
+        FakeExecutor("a", free_kv_blocks=10),
+        FakeExecutor("b", free_kv_blocks=20),
+        FakeExecutor("c")
+    ])
+    assert router.submit([1, 2], None, False)[0] == "c"
+    router._executors[2]._free_kv_blocks = 5
+    assert router.submit([1, 2], None, False)[0] == "b"
+
+    router = GptManagerRouter([FakeExecutor("a"), FakeExecutor("b")],
+                              policy=RoutingPolicy.QUEUE)
+    assert [router.submit([1], None, False)[0]
+            for _ in range(4)] == ["a", "b", "a", "b"]
+
+    # a prompt sharing a full block with an earlier one follows it
+    router = GptManagerRouter([FakeExecutor("a"), FakeExecutor("b")],
+                              policy=RoutingPolicy.PREFIX,
+                              prefix_block_size=2)
+    assert router.submit([1, 2, 3], None, False)[0] == "a"
+    assert router.submit([4, 5, 6], None, False)[0] == "b"
+    assert router.submit([4, 5, 7, 8], None, False)[0] == "b"
+    assert router.submit([1, 9], None, False)[0] == "a"
@@ -37,7 +37,8 @@ from tensorrt_llm.functional import RotaryScalingType
 from tensorrt_llm.layers import PositionEmbeddingType
 from tensorrt_llm.network import net_guard
 from tensorrt_llm.plugin.plugin import ContextFMHAType
-from tensorrt_llm.runtime import ModelConfig, SamplingConfig
+from tensorrt_llm.runtime import (BatchExecutor, BatchScheduler, LlmRequest,
+                                  ModelConfig, SamplingConfig, SchedulerPolicy)
 from tensorrt_llm.runtime.generation import _prepare_attention_mask
 from tensorrt_llm.runtime.kv_cache_manager import (GenerationSequence,
                                                    KVCacheManager)
@@ -914,6 +915,104 @@ class TestGPT(unittest.TestCase):
 
         np.testing.assert_allclose(ref.cpu().numpy(), res.cpu().numpy())
 
+    @parameterized.expand([(False, ), (True, )])
+    def test_batch_executor(self, overlap_scheduling):
+        model = 'gpt'
+        log_level = 'error'
+        dtype = 'float32'
+        world_size = 1
+        rank = 0
+        hidden_act = 'gelu'
+        n_layer = 2
+        max_batch_size = 4
+        max_new_tokens = 16
+        tokens_per_block = 16
+        # Requests paused with RECOMPUTE run their generated tokens as context
+        max_input_len = 64 + max_new_tokens
+        end_id = 50257
+
+        gpt_config, hf_gpt = self._gen_hf_gpt(hidden_act, n_layer,
+                                              max_new_tokens, dtype)
+        runtime, engine_buffer = self._gen_tensorrt_llm_runtime(
+            log_level,
+            dtype,
+            world_size,
+            rank,
+            gpt_config,
+            hf_gpt,
+            model,
+            True,
+            max_batch_size,
+            max_input_len,
+            max_new_tokens,
+            False,
+            enable_remove_input_padding=True,
+            enable_paged_kv_cache=True,
+            tokens_per_block=tokens_per_block)
+
+        model_config = ModelConfig(vocab_size=gpt_config.vocab_size,
+                                   num_layers=gpt_config.n_layer,
+                                   num_heads=gpt_config.n_head,
+                                   num_kv_heads=gpt_config.n_head,
+                                   hidden_size=gpt_config.n_embd,
+                                   gpt_attention_plugin=True,
+                                   remove_input_padding=True,
+                                   paged_kv_cache=True,
+                                   tokens_per_block=tokens_per_block,
+                                   dtype=dtype)
+        mapping = tensorrt_llm.Mapping(world_size, rank, tp_size=world_size)
+        session = tensorrt_llm.runtime.GenerationSession(
+            model_config, engine_buffer, mapping)
+        session.setup(max_batch_size,
+                      max_context_length=max_input_len,
+                      max_new_tokens=max_new_tokens)
+
+        # Fewer blocks than the requests need to complete together, so that
+        # MAX_UTILIZATION swaps out the long requests and recomputes the
+        # short ones. The swap space holds all the blocks, K and V of fp32.
+        block_size_bytes = 2 * tokens_per_block * gpt_config.n_embd * 4 * n_layer
+        kv_cache_manager = BatchExecutor.create_kv_cache_manager(
+            session, blocks=10, swap_space_bytes=10 * block_size_bytes)
+        scheduler = BatchScheduler(
+            max_batch_size,
+            kv_cache_manager,
+            scheduler_policy=SchedulerPolicy.MAX_UTILIZATION,
+            max_num_tokens=128,
+            swap_min_tokens=48)
+        executor = BatchExecutor(session,
+                                 scheduler,
+                                 end_id,
+                                 overlap_scheduling=overlap_scheduling)
+
+        torch.manual_seed(0)
+        prompt_lens = [20, 45, 33, 60, 8, 27]
+        requests = [
+            LlmRequest(i,
+                       torch.randint(100, (prompt_len, )).tolist(),
+                       max_new_tokens)
+            for i, prompt_len in enumerate(prompt_lens)
+        ]
+        # The requests arrive over the first iterations
+        completed = []
+        for request in requests:
+            executor.add_request(request)
+            completed += executor.step()
+        while executor.has_requests():
+            completed += executor.step()
+        self.assertEqual(len(completed), len(requests))
+        self.assertEqual(kv_cache_manager.get_num_free_blocks(), [10])
+
+        for request in requests:
+            input_ids = torch.tensor([request.input_tokens]).cuda()
+            ref_output_ids = hf_gpt.generate(input_ids,
+                                             do_sample=False,
+                                             num_beams=1,
+                                             max_new_tokens=max_new_tokens,
+                                             pad_token_id=50256,
+                                             eos_token_id=end_id)
+            ref = ref_output_ids[0, len(request.input_tokens):].tolist()
+            self.assertEqual(request.tokens[len(request.input_tokens):], ref)
+
     def test_rope_scaling_is_set_in_attention(self):
         num_layers = 2
         position_embedding_type = PositionEmbeddingType.rope_gpt_neox
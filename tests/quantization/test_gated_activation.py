@@ -0,0 +1,126 @@
+# SPDX-FileCopyrightText: Copyright (c) 2022-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+import unittest
+
+import numpy as np
+import torch
+from parameterized import parameterized
+from polygraphy.backend.trt import CreateConfig, EngineFromNetwork, TrtRunner
+
+import tensorrt_llm
+from tensorrt_llm import Parameter, Tensor
+from tensorrt_llm.quantization.functional import gated_activation
+
+
+class TestFunctional(unittest.TestCase):
+
+    def setUp(self):
+        tensorrt_llm.logger.set_level('error')
+
+    # A width of 64 takes the vectorized path, 10 the scalar one
+    @parameterized.expand([('float16', 'silu', 'float16', False, False, 64),
+                           ('float16', 'gelu', 'float16', False, False, 10),
+                           ('float16', 'silu', 'int8', False, True, 64),
+                           ('float16', 'silu', 'int8', True, True, 64),
+                           ('float32', 'gelu', 'float32', False, True, 10),
+                           ('float32', 'silu', 'int8', True, False, 10)])
+    def test_gated_activation_plugin(self, dtype, activation, output_dtype,
+                                     dynamic_act_scaling, use_smoother, cols):
+        test_shape = [2, 5, 2 * cols]
+        torch_dtype = tensorrt_llm._utils.str_dtype_to_torch(dtype)
+        quantized = output_dtype == 'int8'
+        static_scaling = quantized and not dynamic_act_scaling
+
+        x_data = torch.randn(*test_shape, dtype=torch_dtype)
+        smoother_data = torch.rand(1, cols, dtype=torch.float32) + 0.5
+        scale_data = torch.randint(2, 32, (1, ), dtype=torch.float32)
+
+        def cast_to_int8_with_sat(tensor):
+            return tensor.round().clip(-128, 127).to(dtype=torch.int8)
+
+        # pytorch run
+        with torch.no_grad():
+            gate, up = x_data.to(torch.float32).chunk(2, dim=-1)
+            act = torch.nn.functional.silu(gate) if activation == 'silu' \
+                else torch.nn.functional.gelu(gate, approximate='tanh')
+            ref = (act * up).to(torch_dtype).to(torch.float32)
+            if use_smoother:
+                ref = ref / smoother_data
+            if dynamic_act_scaling:
+                abs_max_f, _ = ref.abs().max(dim=-1, keepdim=True)
+                dynamic_scale = abs_max_f / 127.0
+                ref_output = cast_to_int8_with_sat(ref * (127.0 / abs_max_f))
+            elif quantized:
+                ref_output = cast_to_int8_with_sat(ref * scale_data)
+            else:
+                ref_output = ref
+
+        # construct trt network
+        builder = tensorrt_llm.Builder()
+        net = builder.create_network()
+        net.plugin_config.set_gated_activation_plugin(dtype)
+        with tensorrt_llm.net_guard(net):
+            network = tensorrt_llm.default_trtnet()
+            x = Tensor(name='x',
+                       shape=x_data.shape,
+                       dtype=tensorrt_llm.str_dtype_to_trt(dtype))
+
+            outputs = gated_activation(
+                x,
+                activation,
+                smoother=Parameter(smoother_data.cpu().numpy()).value
+                if use_smoother else None,
+                scale=Parameter(scale_data.cpu().numpy()).value
+                if static_scaling else None,
+                output_dtype=output_dtype,
+                dynamic_act_scaling=dynamic_act_scaling)
+            if not dynamic_act_scaling:
+                outputs = (outputs, )
+
+            for name, tensor in zip(['output', 'dynamic_scales'], outputs):
+                tensor = tensor.trt_tensor
+                tensor.name = name
+                network.mark_output(tensor)
+
+            # trt run
+            build_engine = EngineFromNetwork(
+                (builder.trt_builder, net.trt_network),
+                config=CreateConfig(int8=quantized,
+                                    fp16=(dtype == 'float16'),
+                                    precision_constraints="obey"))
+            assert build_engine is not None, "Build engine failed"
+            with TrtRunner(build_engine) as runner:
+                outputs = runner.infer(feed_dict={'x': x_data.cpu().numpy()})
+
+        atol = 1e-2 if dtype == 'float16' else 1e-5
+        # Set absolute tolerance to 1 to mitigate some rounding error
+        np.testing.assert_allclose(ref_output.cpu().numpy(),
+                                   outputs['output'].astype(np.float32),
+                                   atol=1 if quantized else 2 * atol,
+                                   rtol=0 if quantized else 1e-2)
+        if dynamic_act_scaling:
+            np.testing.assert_allclose(dynamic_scale.cpu().numpy(),
+                                       outputs['dynamic_scales'],
+                                       atol=1e-2)
+
+    def test_gated_activation_no_plugin(self):
+        builder = tensorrt_llm.Builder()
+        net = builder.create_network()
+        with tensorrt_llm.net_guard(net):
+            tensorrt_llm.default_trtnet()
+            with self.assertRaisesRegex(
+                    TypeError,
+                    "Gated activation is only supported with plugin"):
+                gated_activation(None, 'silu')
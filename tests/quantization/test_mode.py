@@ -44,7 +44,7 @@ class TestQuantMode(unittest.TestCase):
 
     def test_count(self):
         # Make sure the COUNT value is as expected - change that test if you add a new flag.
-        self.assertEqual(QuantMode.COUNT.value, 1 << 9)
+        self.assertEqual(QuantMode.COUNT.value, 1 << 11)
 
     def test_from_description(self):
         # Test weight only.
@@ -169,6 +169,46 @@ class TestQuantMode(unittest.TestCase):
         # Make sure it returns True for weight-only.
         self.assertTrue(qm.is_int8_weight_only())
 
+    def test_kv_cache_block_scaling(self):
+        # Set int8 kv cache and block scaling flags.
+        qm = QuantMode.from_description(use_int8_kv_cache=True,
+                                        use_kv_cache_block_scaling=True)
+        # Make sure it returns True for block scaling.
+        self.assertTrue(qm.has_kv_cache_block_scaling())
+        self.assertTrue(qm.has_int8_kv_cache())
+
+        # Block scaling is ignored without a quantized KV cache.
+        qm = QuantMode.KV_CACHE_BLOCK_SCALING
+        self.assertFalse(qm.has_kv_cache_block_scaling())
+        # Make sure it returns True once the KV cache is quantized.
+        qm = qm.set_fp8_kv_cache()
+        self.assertTrue(qm.has_kv_cache_block_scaling())
+
+        # Expect failure if block scaling is requested without a quantized KV cache.
+        self.assertRaises(
+            ValueError, lambda: QuantMode.from_description(
+                use_kv_cache_block_scaling=True))
+
+    def test_kv_cache_online_scaling(self):
+        # Set fp8 kv cache and online scaling flags.
+        qm = QuantMode.from_description(use_fp8_kv_cache=True,
+                                        use_kv_cache_online_scaling=True)
+        # Make sure it returns True for online scaling.
+        self.assertTrue(qm.has_kv_cache_online_scaling())
+        self.assertFalse(qm.has_kv_cache_block_scaling())
+
+        # Online scaling is ignored without a quantized KV cache.
+        qm = QuantMode.KV_CACHE_ONLINE_SCALING
+        self.assertFalse(qm.has_kv_cache_online_scaling())
+        # Make sure it returns True once the KV cache is quantized.
+        qm = qm.set_int8_kv_cache()
+        self.assertTrue(qm.has_kv_cache_online_scaling())
+
+        # Expect failure if online scaling is requested without a quantized KV cache.
+        self.assertRaises(
+            ValueError, lambda: QuantMode.from_description(
+                use_kv_cache_online_scaling=True))
+
     def test_failure_quant(self):
         # Expect failure if weights are not quantized, but activations are.
         self.assertRaises(
@@ -0,0 +1,141 @@
+# SPDX-FileCopyrightText: Copyright (c) 2022-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+import unittest
+
+import numpy as np
+import torch
+from parameterized import parameterized
+from polygraphy.backend.trt import CreateConfig, EngineFromNetwork, TrtRunner
+from transformers.models.llama.modeling_llama import LlamaRMSNorm
+
+import tensorrt_llm
+from tensorrt_llm import Parameter, Tensor
+from tensorrt_llm.quantization.functional import residual_rms_norm
+
+
+class TestFunctional(unittest.TestCase):
+
+    def setUp(self):
+        tensorrt_llm.logger.set_level('error')
+
+    # A hidden size of 64 takes the vectorized path, 10 the scalar one
+    @parameterized.expand([('float16', 'float16', False, 64),
+                           ('float16', 'int8', False, 64),
+                           ('float16', 'int8', True, 64),
+                           ('float32', 'float32', False, 10),
+                           ('float32', 'int8', False, 10),
+                           ('float32', 'int8', True, 64)])
+    def test_residual_rms_norm_plugin(self, dtype, output_dtype,
+                                      dynamic_act_scaling, hidden_size):
+        test_shape = [2, 5, hidden_size]
+        torch_dtype = tensorrt_llm._utils.str_dtype_to_torch(dtype)
+        quantized = output_dtype == 'int8'
+
+        x_data = torch.randn(*test_shape, dtype=torch_dtype)
+        residual_data = torch.randn(*test_shape, dtype=torch_dtype)
+
+        m = LlamaRMSNorm(test_shape[-1])
+        with torch.no_grad():
+            m.weight.copy_(torch.rand(test_shape[-1]) + 0.5)
+
+        scale_data = torch.randint(2, 32, (1, ), dtype=torch.float32)
+
+        def cast_to_int8_with_sat(tensor):
+            return tensor.round().clip(-128, 127).to(dtype=torch.int8)
+
+        # pytorch run
+        with torch.no_grad():
+            ref_residual = (x_data.to(torch.float32) +
+                            residual_data.to(torch.float32))
+            ref = m(ref_residual).to(dtype=torch.float32)
+            if dynamic_act_scaling:
+                abs_max_f, _ = ref.abs().max(dim=-1, keepdim=True)
+                dynamic_scale = abs_max_f / 127.0
+                ref_output = cast_to_int8_with_sat(ref * (127.0 / abs_max_f))
+            elif quantized:
+                ref_output = cast_to_int8_with_sat(ref * scale_data)
+            else:
+                ref_output = ref
+
+        # construct trt network
+        builder = tensorrt_llm.Builder()
+        net = builder.create_network()
+        net.plugin_config.set_residual_rmsnorm_plugin(dtype)
+        with tensorrt_llm.net_guard(net):
+            network = tensorrt_llm.default_trtnet()
+            x = Tensor(name='x',
+                       shape=x_data.shape,
+                       dtype=tensorrt_llm.str_dtype_to_trt(dtype))
+            residual = Tensor(name='residual',
+                              shape=residual_data.shape,
+                              dtype=tensorrt_llm.str_dtype_to_trt(dtype))
+
+            outputs = residual_rms_norm(
+                x,
+                residual,
+                test_shape[-1],
+                weight=tensorrt_llm.constant(
+                    m.weight.detach().to(torch_dtype).cpu().numpy()),
+                scale=Parameter(scale_data.cpu().numpy()).value
+                if quantized else None,
+                eps=m.variance_epsilon,
+                output_dtype=output_dtype,
+                dynamic_act_scaling=dynamic_act_scaling)
+
+            names = ['output', 'residual_output', 'dynamic_scales']
+            for name, tensor in zip(names, outputs):
+                tensor = tensor.trt_tensor
+                tensor.name = name
+                network.mark_output(tensor)
+
+            # trt run
+            build_engine = EngineFromNetwork(
+                (builder.trt_builder, net.trt_network),
+                config=CreateConfig(int8=quantized,
+                                    fp16=(dtype == 'float16'),
+                                    precision_constraints="obey"))
+            assert build_engine is not None, "Build engine failed"
+            with TrtRunner(build_engine) as runner:
+                outputs = runner.infer(
+                    feed_dict={
+                        'x': x_data.cpu().numpy(),
+                        'residual': residual_data.cpu().numpy()
+                    })
+
+        atol = 1e-2 if dtype == 'float16' else 1e-5
+        np.testing.assert_allclose(ref_residual.cpu().numpy(),
+                                   outputs['residual_output'].astype(
+                                       np.float32),
+                                   atol=atol)
+        # Set absolute tolerance to 1 to mitigate some rounding error
+        np.testing.assert_allclose(ref_output.cpu().numpy(),
+                                   outputs['output'].astype(np.float32),
+                                   atol=1 if quantized else 2 * atol,
+                                   rtol=0 if quantized else 1e-2)
+        if dynamic_act_scaling:
+            np.testing.assert_allclose(dynamic_scale.cpu().numpy(),
+                                       outputs['dynamic_scales'],
+                                       atol=1e-2)
+
+    def test_residual_rms_norm_no_plugin(self):
+        builder = tensorrt_llm.Builder()
+        net = builder.create_network()
+        with tensorrt_llm.net_guard(net):
+            tensorrt_llm.default_trtnet()
+            with self.assertRaisesRegex(
+                    TypeError,
+                    "Residual Rms Norm is only supported with plugin"):
+                residual_rms_norm(None, None, 0)
+
@@ -40,7 +40,14 @@ class TestSmoothQuantGemm(unittest.TestCase):
     def setUp(self):
         tensorrt_llm.logger.set_level('error')
 
-    def _sq_gemm(self, m, n, k, dtype, per_token_scaling, per_channel_scaling):
+    def _sq_gemm(self,
+                 m,
+                 n,
+                 k,
+                 dtype,
+                 per_token_scaling,
+                 per_channel_scaling,
+                 has_residual=False):
         # Init operands for multiplication in int32
         shape1 = (m, k)
         mat1 = torch.randint(-128, 128, shape1, dtype=torch.int8)
@@ -61,6 +68,8 @@ class TestSmoothQuantGemm(unittest.TestCase):
                                        shape_scale_b,
                                        dtype=torch.float32)
 
+        residual_torch = torch.randn((m, n), dtype=torch.float32)
+
         # Create builder
         builder = tensorrt_llm.Builder()
         # Create empty network
@@ -87,10 +96,20 @@ class TestSmoothQuantGemm(unittest.TestCase):
                 name='scale_b',
                 shape=scale_b_torch.shape,
                 dtype=tensorrt_llm._utils.str_dtype_to_trt("float32"))
+            residual = None
+            if has_residual:
+                residual = Tensor(
+                    name='residual',
+                    shape=residual_torch.shape,
+                    dtype=tensorrt_llm._utils.str_dtype_to_trt(dtype))
             # Get output tensor for SQ gemm
-            output = smooth_quant_gemm(x, y, scale_a, scale_b,
+            output = smooth_quant_gemm(x,
+                                       y,
+                                       scale_a,
+                                       scale_b,
                                        per_token_scaling,
-                                       per_channel_scaling).trt_tensor
+                                       per_channel_scaling,
+                                       residual=residual).trt_tensor
             output.name = 'output'
             network.mark_output(output)
             output.dtype = tensorrt_llm._utils.str_dtype_to_trt(dtype)
@@ -103,15 +122,19 @@ class TestSmoothQuantGemm(unittest.TestCase):
                 fp16=(dtype == "float16"),
                 memory_pool_limits={trt.MemoryPoolType.WORKSPACE: 33554432}))
 
+        feed_dict = {
+            'x': mat1.numpy(),
+            'y': mat2.numpy(),
+            'scale_a': scale_a_torch.numpy(),
+            'scale_b': scale_b_torch.numpy()
+        }
+        if has_residual:
+            feed_dict['residual'] = residual_torch.numpy().astype(
+                tensorrt_llm._utils.str_dtype_to_np(dtype))
+
         # Infer engine
         with TrtRunner(build_engine) as runner:
-            outputs = runner.infer(
-                feed_dict={
-                    'x': mat1.numpy(),
-                    'y': mat2.numpy(),
-                    'scale_a': scale_a_torch.numpy(),
-                    'scale_b': scale_b_torch.numpy()
-                })
+            outputs = runner.infer(feed_dict=feed_dict)
 
         ref = _utils.gt_matmul_smooth_quant(mat1,
                                             mat2,
@@ -120,7 +143,15 @@ class TestSmoothQuantGemm(unittest.TestCase):
                                             dtype,
                                             bias=None)
 
-        np.testing.assert_allclose(ref.cpu().numpy(), outputs['output'])
+        if has_residual:
+            # The epilogue adds the residual before rounding to dtype
+            ref = ref.cpu().float() + residual_torch.to(ref.dtype).float()
+            np.testing.assert_allclose(ref.cpu().numpy(),
+                                       outputs['output'].astype(np.float32),
+                                       atol=1e-2,
+                                       rtol=2e-3)
+        else:
+            np.testing.assert_allclose(ref.cpu().numpy(), outputs['output'])
 
     @parameterized.expand([('float16', False, False), ('float16', False, True),
                            ('float16', True, False), ('float16', True, True),
@@ -145,6 +176,26 @@ class TestSmoothQuantGemm(unittest.TestCase):
         self._sq_gemm(bs * inseq, 4 * hidden_size, hidden_size, dtype,
                       per_channel_scaling, per_token_scaling)
 
+    @parameterized.expand([('float16', True, True), ('float16', False, False),
+                           ('float32', True, True)])
+    @pytest.mark.skipif(
+        getSMVersion() < 80,
+        reason="Smooth quant is not supported in pre-ampere architecture"
+    )  # Skip tests that are not supported in pre-ampere architecture
+    def test_matmul_residual(self, dtype, per_token_scaling,
+                             per_channel_scaling):
+        # mlp proj gemm followed by the residual add
+        bs = 2
+        inseq = 16
+        hidden_size = 768
+        self._sq_gemm(bs * inseq,
+                      hidden_size,
+                      4 * hidden_size,
+                      dtype,
+                      per_token_scaling,
+                      per_channel_scaling,
+                      has_residual=True)
+
     def test_sq_matmul_no_plugin(self):
         # Create builder
         builder = tensorrt_llm.Builder()
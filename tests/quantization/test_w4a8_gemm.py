@@ -0,0 +1,135 @@
+# SPDX-FileCopyrightText: Copyright (c) 2022-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+import os
+import sys
+import unittest
+
+import numpy as np
+import pytest
+
+# isort: off
+import torch
+import tensorrt as trt
+# isort: on
+from parameterized import parameterized
+from polygraphy.backend.trt import CreateConfig, EngineFromNetwork, TrtRunner
+
+import tensorrt_llm
+from tensorrt_llm import Tensor
+from tensorrt_llm.quantization.functional import w4a8_gemm
+
+sys.path.append(os.path.join(os.path.dirname(__file__), '..'))
+from utils.util import getSMVersion
+
+
+class TestW4A8Gemm(unittest.TestCase):
+
+    def setUp(self):
+        torch.manual_seed(0)
+        tensorrt_llm.logger.set_level('error')
+
+    def _w4a8_gemm(self, m, n, k, per_channel_scaling, has_pre_quant_scale):
+        dtype = 'float16'
+        act = torch.randn((m, k), dtype=torch.float16)
+        weight = torch.randint(-8, 8, (n, k), dtype=torch.int8)
+        # Element 2i in the low nibble of byte i
+        packed_weight = (weight[:, 0::2] & 0xF) | (weight[:, 1::2] << 4)
+        shape_scale = (1, n) if per_channel_scaling else (1, 1)
+        scale = torch.rand(shape_scale, dtype=torch.float32) * 1e-2 + 1e-3
+        pre_quant_scale = torch.rand((1, k), dtype=torch.float16) + 0.5
+
+        # Create builder
+        builder = tensorrt_llm.Builder()
+        # Create empty network
+        net = builder.create_network()
+        net.plugin_config.set_w4a8_gemm_plugin(dtype)
+        with tensorrt_llm.net_guard(net):
+            network = tensorrt_llm.default_trtnet()
+            x = Tensor(name='x',
+                       shape=act.shape,
+                       dtype=tensorrt_llm._utils.str_dtype_to_trt(dtype))
+            y = Tensor(name='y',
+                       shape=packed_weight.shape,
+                       dtype=tensorrt_llm._utils.str_dtype_to_trt("int8"))
+            s = Tensor(name='scale',
+                       shape=scale.shape,
+                       dtype=tensorrt_llm._utils.str_dtype_to_trt("float32"))
+            p = None
+            if has_pre_quant_scale:
+                p = Tensor(name='pre_quant_scale',
+                           shape=pre_quant_scale.shape,
+                           dtype=tensorrt_llm._utils.str_dtype_to_trt(dtype))
+            output = w4a8_gemm(x, y, s, per_channel_scaling, p).trt_tensor
+            output.name = 'output'
+            network.mark_output(output)
+            output.dtype = tensorrt_llm._utils.str_dtype_to_trt(dtype)
+
+        build_engine = EngineFromNetwork(
+            (builder.trt_builder, net.trt_network),
+            config=CreateConfig(
+                int8=True,
+                fp16=True,
+                memory_pool_limits={trt.MemoryPoolType.WORKSPACE: 33554432}))
+
+        feed_dict = {
+            'x': act.numpy(),
+            'y': packed_weight.numpy(),
+            'scale': scale.numpy()
+        }
+        if has_pre_quant_scale:
+            feed_dict['pre_quant_scale'] = pre_quant_scale.numpy()
+        with TrtRunner(build_engine) as runner:
+            outputs = runner.infer(feed_dict=feed_dict)
+
+        ref_act = act.float()
+        if has_pre_quant_scale:
+            ref_act = (act * pre_quant_scale).float()
+        scale_tokens = ref_act.abs().amax(dim=-1, keepdim=True) / 127.0
+        quantized_act = torch.round(ref_act / scale_tokens).clamp(-128, 127)
+        ref = torch.matmul(quantized_act, weight.float().transpose(0, 1))
+        ref = (ref * scale_tokens * scale).half()
+
+        np.testing.assert_allclose(ref.float().numpy(),
+                                   outputs['output'].astype(np.float32),
+                                   atol=2e-2,
+                                   rtol=2e-2)
+
+    @parameterized.expand([(1, False, False), (3, True, False), (4, True, True),
+                           (32, False, False), (32, True, False),
+                           (32, True, True)])
+    @pytest.mark.skipif(
+        getSMVersion() < 80,
+        reason="W4A8 is not supported in pre-ampere architecture"
+    )  # Skip tests that are not supported in pre-ampere architecture
+    def test_matmul(self, m, per_channel_scaling, has_pre_quant_scale):
+        hidden_size = 768
+        # GEMV for m <= 4, unpacked weights and int8 GEMM above
+        self._w4a8_gemm(m, 3 * hidden_size, hidden_size, per_channel_scaling,
+                        has_pre_quant_scale)
+
+    def test_w4a8_matmul_no_plugin(self):
+        # Create builder
+        builder = tensorrt_llm.Builder()
+        # Create empty network
+        net = builder.create_network()
+        with tensorrt_llm.net_guard(net):
+            tensorrt_llm.default_trtnet()
+            with self.assertRaisesRegex(
+                    TypeError, "W4A8 GEMM is only supported with plugin"):
+                w4a8_gemm(None, None, None, False)
+
+
+if __name__ == '__main__':
+    unittest.main()
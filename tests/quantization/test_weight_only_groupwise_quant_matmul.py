@@ -49,7 +49,8 @@ class TestWeightOnlyGroupWiseQuantMatmul(unittest.TestCase):
                            th_bias,
                            dtype,
                            quant_algo,
-                           group_size=128):
+                           group_size=128,
+                           th_act_order_perm=None):
         # Create builder
         builder = tensorrt_llm.Builder()
         net = builder.create_network()
@@ -82,13 +83,24 @@ class TestWeightOnlyGroupWiseQuantMatmul(unittest.TestCase):
             bias = Tensor(name='bias',
                           shape=th_bias.shape,
                           dtype=tensorrt_llm._utils.str_dtype_to_trt(dtype))
+            # Init TensorRT-LLM tensor for act-order permutation
+            act_order_perm = Tensor(
+                name='act_order_perm',
+                shape=th_act_order_perm.shape,
+                dtype=tensorrt_llm._utils.str_dtype_to_trt(
+                    "int32")) if th_act_order_perm is not None else None
 
             # Get output tensor for WBQ Matmul
-            output = weight_only_groupwise_quant_matmul(activation,
-                                                        pre_quant_scale, weight,
-                                                        scale, zero, bias,
-                                                        quant_algo,
-                                                        group_size).trt_tensor
+            output = weight_only_groupwise_quant_matmul(
+                activation,
+                pre_quant_scale,
+                weight,
+                scale,
+                zero,
+                bias,
+                quant_algo,
+                group_size,
+                act_order_perm=act_order_perm).trt_tensor
             output.name = 'output'
             network.mark_output(output)
             output.dtype = tensorrt_llm._utils.str_dtype_to_trt(dtype)
@@ -102,16 +114,18 @@ class TestWeightOnlyGroupWiseQuantMatmul(unittest.TestCase):
                 memory_pool_limits={trt.MemoryPoolType.WORKSPACE: 33554432}))
 
         # Infer engine
+        feed_dict = {
+            'activation': th_activation.numpy(),
+            'pre_quant_scale': th_pre_quant_scale.numpy(),
+            'weight': th_weight.numpy(),
+            'scale': th_scale.numpy(),
+            'zero': th_zero.numpy(),
+            'bias': th_bias.numpy()
+        }
+        if th_act_order_perm is not None:
+            feed_dict['act_order_perm'] = th_act_order_perm.numpy()
         with TrtRunner(build_engine) as runner:
-            outputs = runner.infer(
-                feed_dict={
-                    'activation': th_activation.numpy(),
-                    'pre_quant_scale': th_pre_quant_scale.numpy(),
-                    'weight': th_weight.numpy(),
-                    'scale': th_scale.numpy(),
-                    'zero': th_zero.numpy(),
-                    'bias': th_bias.numpy()
-                })
+            outputs = runner.infer(feed_dict=feed_dict)
 
         return torch.tensor(outputs['output'])
 
@@ -124,7 +138,8 @@ class TestWeightOnlyGroupWiseQuantMatmul(unittest.TestCase):
                               has_zero,
                               has_bias,
                               group_size=128,
-                              uint4_input=True):
+                              uint4_input=True,
+                              act_order=False):
         # Init operands for multiplication in int32
         torch.manual_seed(0)
         activation = _utils.woq_gen_weights(m, k, dtype)
@@ -141,8 +156,12 @@ class TestWeightOnlyGroupWiseQuantMatmul(unittest.TestCase):
         BIAS = 1
         ZERO = 2
         PRE_QUANT_SCALE = 4
+        ACT_ORDER = 8
 
-        quant_algo = has_pre_quant * PRE_QUANT_SCALE + has_zero * ZERO + has_bias * BIAS
+        quant_algo = act_order * ACT_ORDER + has_pre_quant * PRE_QUANT_SCALE + has_zero * ZERO + has_bias * BIAS
+        # The weights are sorted by group, row i of the weights multiplies
+        # the column perm[i] of the activation
+        act_order_perm = torch.randperm(k).int() if act_order else None
 
         packer = torch.ops.fastertransformer.pack_int8_tensor_to_packed_int4
         preprocessor = torch.ops.fastertransformer.preprocess_weights_for_mixed_gemm
@@ -161,8 +180,10 @@ class TestWeightOnlyGroupWiseQuantMatmul(unittest.TestCase):
         output = self._run_matmul_plugin(activation, pre_quant_scale,
                                          qweight_int4x2_interleaved, scale,
                                          zero, bias, dtype, quant_algo,
-                                         group_size).cpu()
+                                         group_size, act_order_perm).cpu()
 
+        if act_order:
+            activation = activation[:, act_order_perm.long()]
         if has_pre_quant:
             pre_quant_scale = pre_quant_scale.repeat(m, 1)
             activation = torch.mul(activation, pre_quant_scale)
@@ -258,6 +279,34 @@ class TestWeightOnlyGroupWiseQuantMatmul(unittest.TestCase):
                                    group_size,
                                    uint4_input=False)
 
+    @parameterized.expand([(1, 1024, 64, 'float16', False, True, False, 64),
+                           (1, 1024, 256, 'float16', True, True, False, 128),
+                           (16, 1024, 256, 'float16', False, True, True, 64),
+                           (64, 2048, 1024, 'float16', True, True, False, 128)
+                           ])
+    def test_act_order_matmul_int4_input(self,
+                                         m,
+                                         n,
+                                         k,
+                                         dtype,
+                                         has_pre_quant,
+                                         has_zero,
+                                         has_bias,
+                                         group_size=128):
+        # Skip tests that are not supported on V100
+        if getSMVersion() < 80:
+            pytest.skip("weight only groupwise contains bug on V100")
+        self._woq_groupwise_matmul(m,
+                                   n,
+                                   k,
+                                   dtype,
+                                   has_pre_quant,
+                                   has_zero,
+                                   has_bias,
+                                   group_size,
+                                   uint4_input=False,
+                                   act_order=True)
+
 
 if __name__ == '__main__':
     unittest.main()
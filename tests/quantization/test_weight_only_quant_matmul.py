@@ -51,8 +51,14 @@ class TestWeightOnlyQuantMatmul(unittest.TestCase):
 
         return self._run_matmul(mat1, weights, scales, dtype, wTypeId, True)
 
-    def _run_matmul(self, mat1, processed_torch_weights, torch_weight_scales,
-                    dtype, wTypeId, use_plugin):
+    def _run_matmul(self,
+                    mat1,
+                    processed_torch_weights,
+                    torch_weight_scales,
+                    dtype,
+                    wTypeId,
+                    use_plugin,
+                    swiglu=False):
         # Create builder
         builder = tensorrt_llm.Builder()
         # Create empty network
@@ -71,8 +77,11 @@ class TestWeightOnlyQuantMatmul(unittest.TestCase):
             # Init TensorRT-LLM tensor for per channel scaling
             scale = constant(torch_weight_scales.numpy())
             # Get output tensor for WOQ Matmul
-            output = weight_only_quant_matmul(x, weights, scale,
-                                              wTypeId).trt_tensor
+            output = weight_only_quant_matmul(x,
+                                              weights,
+                                              scale,
+                                              wTypeId,
+                                              swiglu=swiglu).trt_tensor
             output.name = 'output'
             network.mark_output(output)
             output.dtype = tensorrt_llm._utils.str_dtype_to_trt(dtype)
@@ -93,10 +102,18 @@ class TestWeightOnlyQuantMatmul(unittest.TestCase):
 
         return torch.tensor(outputs['output'])
 
-    def _woq_matmul(self, m, n, k, dtype, wTypeId, use_plugin=True):
+    def _woq_matmul(self,
+                    m,
+                    n,
+                    k,
+                    dtype,
+                    wTypeId,
+                    use_plugin=True,
+                    swiglu=False):
         # Init operands for multiplication in int32
         mat1 = _utils.woq_gen_weights(m, k, dtype) * 200.0
-        weight = _utils.woq_gen_weights(k, n, dtype)
+        # With SwiGLU, the weights are the gate followed by the up
+        weight = _utils.woq_gen_weights(k, 2 * n if swiglu else n, dtype)
 
         ref_torch_weights, processed_torch_weights, torch_weight_scales = _utils.woq_conversion(
             weight, wTypeId)
@@ -108,10 +125,20 @@ class TestWeightOnlyQuantMatmul(unittest.TestCase):
 
         output = self._run_matmul(mat1, processed_torch_weights,
                                   torch_weight_scales, dtype, wTypeId,
-                                  use_plugin)
+                                  use_plugin, swiglu)
 
         ref = _utils.woq_gt_matmul(m, mat1, ref_torch_weights,
                                    torch_weight_scales, dtype)
+        if swiglu:
+            gate, up = ref.float().chunk(2, dim=-1)
+            ref = torch.nn.functional.silu(gate) * up
+            # The quantization error of the gate is scaled by the up
+            atol = ref.abs().max().item() / float(1 << (8 // wTypeId - 1)) * 3
+            torch.testing.assert_close(output.float(),
+                                       ref.cpu(),
+                                       atol=atol,
+                                       rtol=0)
+            return
 
         _utils.woq_assert_colwise_near_eq(ref, output, wTypeId)
         '''
@@ -138,6 +165,19 @@ class TestWeightOnlyQuantMatmul(unittest.TestCase):
     def test_matmul(self, m, n, k, dtype, wTypeId, use_plugin):
         self._woq_matmul(m, n, k, dtype, wTypeId, use_plugin)
 
+    @parameterized.expand([
+        (1, 1024, 4096, 'float16', 1, True),
+        (4, 1024, 4096, 'float16', 2, True),
+        (128, 1024, 4096, 'float16', 1, True),
+        (1, 1024, 4096, 'float16', 1, False),
+    ])
+    @pytest.mark.skipif(
+        getSMVersion() < 80,
+        reason="weight only groupwise contains bug in pre-ampere architecture"
+    )  # Skip tests that are not supported in pre-ampere architecture
+    def test_matmul_swiglu(self, m, n, k, dtype, wTypeId, use_plugin):
+        self._woq_matmul(m, n, k, dtype, wTypeId, use_plugin, swiglu=True)
+
     @parameterized.expand([
         (1024, 4096, 'float16', 1), (4096, 512, 'float16', 1),
         (1024, 4096, 'float16', 2), (4096, 512, 'float16', 2)
@@ -0,0 +1,351 @@
+# SPDX-FileCopyrightText: Copyright (c) 2022-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+import unittest
+
+import torch
+
+import tensorrt_llm
+from tensorrt_llm.runtime.batch_scheduler import (BatchScheduler, LlmRequest,
+                                                  LlmRequestState,
+                                                  PreemptionMode,
+                                                  SchedulerPolicy)
+from tensorrt_llm.runtime.kv_cache_manager import (GenerationSequence,
+                                                   KVCacheManager)
+
+
+class TestBatchScheduler(unittest.TestCase):
+
+    def setUp(self):
+        tensorrt_llm.logger.set_level('error')
+
+    def create_manager(self, blocks, tokens_per_block=4, **kwargs):
+        memory_pool = torch.zeros(2,
+                                  blocks,
+                                  tokens_per_block,
+                                  8,
+                                  dtype=torch.float,
+                                  device='cuda')
+        return KVCacheManager(memory_pools=[memory_pool],
+                              blocks=blocks,
+                              tokens_per_block=tokens_per_block,
+                              max_attention_window_size=32,
+                              max_blocks_per_seq=8,
+                              **kwargs)
+
+    def start(self, manager, request):
+        # What the executor does when the first context chunk is run
+        request.sequence = GenerationSequence(seq_idx=request.request_id,
+                                              batch_idx=len(manager.sequences))
+        return manager.add_sequence(request.sequence,
+                                    request.prompt_len,
+                                    input_ids=request.tokens,
+                                    cache_key=request.cache_key)
+
+    def run_context_chunk(self, manager, request):
+        if request.sequence is None:
+            self.start(manager, request)
+        request.move_to_next_context_chunk()
+
+    def run_context(self, manager, request):
+        request.context_chunk_size = request.context_remaining_length
+        self.run_context_chunk(manager, request)
+
+    def test_chunked_context(self):
+        manager = self.create_manager(blocks=32)
+        scheduler = BatchScheduler(max_batch_size=4,
+                                   kv_cache_manager=manager,
+                                   context_chunk_size=8,
+                                   max_num_tokens=10)
+        generation = LlmRequest(0, list(range(6)), max_new_tokens=8)
+        self.run_context(manager, generation)
+        self.assertEqual(generation.state,
+                         LlmRequestState.REQUEST_STATE_GENERATION_IN_PROGRESS)
+        context = LlmRequest(1, list(range(20)), max_new_tokens=8)
+
+        # The prompt runs in chunks next to the generation request
+        for chunk_size in [8, 8, 4]:
+            scheduled, to_pause = scheduler.schedule_requests(
+                [generation, context])
+            self.assertEqual(scheduled, [generation, context])
+            self.assertEqual(to_pause, [])
+            self.assertEqual(context.context_chunk_size, chunk_size)
+            self.assertEqual(context.is_last_context_chunk(),
+                             chunk_size == 4)
+            self.run_context_chunk(manager, context)
+        self.assertEqual(context.state,
+                         LlmRequestState.REQUEST_STATE_GENERATION_IN_PROGRESS)
+
+        # Chunks are a multiple of tokens_per_block unless they are the last
+        scheduler.max_num_tokens = 7
+        context = LlmRequest(2, list(range(20)), max_new_tokens=8)
+        scheduled, _ = scheduler.schedule_requests(
+            [generation, context, LlmRequest(3, [1, 2], max_new_tokens=8)])
+        self.assertEqual([r.request_id for r in scheduled], [0, 2, 3])
+        self.assertEqual(context.context_chunk_size, 4)
+        self.assertEqual(scheduled[-1].context_chunk_size, 2)
+
+    def test_chunked_context_token_budget(self):
+        manager = self.create_manager(blocks=32)
+        scheduler = BatchScheduler(max_batch_size=4,
+                                   kv_cache_manager=manager,
+                                   context_chunk_size=8,
+                                   max_num_tokens=5)
+        requests = [
+            LlmRequest(i, list(range(6)), max_new_tokens=8) for i in range(2)
+        ]
+        for request in requests:
+            self.run_context(manager, request)
+
+        # Generation requests go first, the context waits for a whole block
+        context = LlmRequest(2, list(range(20)), max_new_tokens=8)
+        scheduled, _ = scheduler.schedule_requests(requests + [context])
+        self.assertEqual(scheduled, requests)
+        self.assertEqual(context.context_chunk_size, 0)
+
+        scheduler.max_num_tokens = 6
+        scheduled, _ = scheduler.schedule_requests(requests + [context])
+        self.assertEqual(scheduled, requests + [context])
+        self.assertEqual(context.context_chunk_size, 4)
+
+    def test_token_budget(self):
+        manager = self.create_manager(blocks=32)
+        scheduler = BatchScheduler(max_batch_size=8,
+                                   kv_cache_manager=manager,
+                                   max_num_tokens=12)
+        generation = [
+            LlmRequest(i, list(range(6)), max_new_tokens=8, beam_width=1)
+            for i in range(3)
+        ]
+        for request in generation:
+            self.run_context(manager, request)
+        contexts = [
+            LlmRequest(3 + i, list(range(length)), max_new_tokens=8)
+            for i, length in enumerate([8, 4, 2])
+        ]
+
+        # Whole contexts are admitted in order while they fit the budget
+        scheduled, _ = scheduler.schedule_requests(generation + contexts)
+        self.assertEqual(scheduled, generation + contexts[:1])
+        self.assertEqual(contexts[0].context_chunk_size, 8)
+
+        # Generation tokens count against the budget too
+        scheduler.max_num_tokens = 2
+        scheduled, _ = scheduler.schedule_requests(generation)
+        self.assertEqual(scheduled, generation[:2])
+
+        # A context that never fits the budget is rejected, the others run
+        scheduler.max_num_tokens = 6
+        scheduled, _ = scheduler.schedule_requests(contexts)
+        self.assertEqual(scheduled, contexts[1:])
+        self.assertTrue(contexts[0].is_error_state())
+        self.assertIsNotNone(contexts[0].error_msg)
+        scheduled, _ = scheduler.schedule_requests(contexts)
+        self.assertEqual(scheduled, contexts[1:])
+
+    def test_guaranteed_no_evict(self):
+        manager = self.create_manager(blocks=8)
+        scheduler = BatchScheduler(max_batch_size=4, kv_cache_manager=manager)
+        first = LlmRequest(0, list(range(8)), max_new_tokens=8)
+        second = LlmRequest(1, list(range(8)), max_new_tokens=8)
+        third = LlmRequest(2, list(range(4)), max_new_tokens=4)
+
+        # Each of the first two requests needs 4 blocks to complete
+        scheduled, _ = scheduler.schedule_requests([first, second, third])
+        self.assertEqual(scheduled, [first, second])
+        self.assertEqual(first.context_chunk_size, 8)
+        self.run_context_chunk(manager, first)
+        scheduled, _ = scheduler.schedule_requests([first, second, third])
+        self.assertEqual(scheduled, [first, second])
+
+    def test_max_utilization(self):
+        manager = self.create_manager(blocks=5)
+        scheduler = BatchScheduler(
+            max_batch_size=4,
+            kv_cache_manager=manager,
+            scheduler_policy=SchedulerPolicy.MAX_UTILIZATION)
+        requests = [
+            LlmRequest(i, list(range(8)), max_new_tokens=8) for i in range(2)
+        ]
+        scheduled, to_pause = scheduler.schedule_requests(requests)
+        self.assertEqual(scheduled, requests)
+        for request in requests:
+            self.run_context_chunk(manager, request)
+
+        # Both requests need a new block for their next token, only one fits
+        scheduled, to_pause = scheduler.schedule_requests(requests)
+        self.assertEqual(manager.get_needed_blocks_one_step(), [2])
+        self.assertEqual(manager.get_num_free_blocks(), [1])
+        self.assertEqual(scheduled, requests[:1])
+        self.assertEqual(to_pause, requests[1:])
+
+    def test_max_utilization_preemption(self):
+        # Swap space for 3 blocks of 4 tokens, 8 floats per token, K and V
+        manager = self.create_manager(blocks=5, swap_space_bytes=3 * 256)
+        scheduler = BatchScheduler(
+            max_batch_size=4,
+            kv_cache_manager=manager,
+            scheduler_policy=SchedulerPolicy.MAX_UTILIZATION,
+            swap_min_tokens=12)
+        long_request = LlmRequest(0, list(range(11)), max_new_tokens=8)
+        short_request = LlmRequest(1, list(range(4)), max_new_tokens=8)
+        for request in [long_request, short_request]:
+            self.run_context(manager, request)
+        manager.step([False, False])
+        for request in [long_request, short_request]:
+            request.add_new_token(0)
+
+        # The long request needs a new block, which is not free
+        scheduled, to_pause = scheduler.schedule_requests(
+            [long_request, short_request])
+        self.assertEqual(manager.get_num_free_blocks(), [0])
+        self.assertEqual(scheduled, [])
+        self.assertEqual(to_pause, [long_request, short_request])
+        self.assertEqual(long_request.preemption_mode, PreemptionMode.SWAP)
+        self.assertEqual(short_request.preemption_mode,
+                         PreemptionMode.RECOMPUTE)
+
+        manager.swap_out(long_request.sequence)
+        self.assertEqual(manager.get_num_free_swap_blocks(), [0])
+        manager.remove_sequence(short_request.sequence)
+        short_request.pause()
+        self.assertEqual(short_request.prompt_len, 5)
+        self.assertEqual(short_request.max_new_tokens, 7)
+        self.assertTrue(short_request.is_context_init_state())
+
+        # The swapped request resumes without running its context again
+        scheduled, to_pause = scheduler.schedule_requests(
+            [long_request, short_request])
+        self.assertEqual(scheduled, [long_request])
+        self.assertEqual(to_pause, [])
+        manager.swap_in(long_request.sequence)
+        self.assertEqual(manager.lens, [12])
+        self.assertEqual(manager.get_num_free_blocks(), [2])
+        self.assertEqual(manager.get_num_free_swap_blocks(), [3])
+
+        # Requests are recomputed when the swap space does not hold them
+        manager.swap_out(manager.sequences[0])
+        scheduler.swap_min_tokens = 4
+        other = LlmRequest(2, list(range(8)), max_new_tokens=8)
+        self.run_context(manager, other)
+        scheduler.max_batch_size = 0
+        _, to_pause = scheduler.schedule_requests([other])
+        self.assertEqual(to_pause, [other])
+        self.assertEqual(other.preemption_mode, PreemptionMode.RECOMPUTE)
+
+    def test_priority_ordering(self):
+        manager = self.create_manager(blocks=6)
+        scheduler = BatchScheduler(
+            max_batch_size=4,
+            kv_cache_manager=manager,
+            scheduler_policy=SchedulerPolicy.MAX_UTILIZATION,
+            order_by_priority=True)
+        batch = LlmRequest(0, list(range(8)), max_new_tokens=8)
+        self.run_context(manager, batch)
+        late = LlmRequest(1, list(range(8)), max_new_tokens=8, priority=1)
+        early = LlmRequest(2,
+                           list(range(8)),
+                           max_new_tokens=8,
+                           priority=1,
+                           deadline=1.0)
+        no_deadline = LlmRequest(3,
+                                 list(range(8)),
+                                 max_new_tokens=8,
+                                 priority=1)
+
+        # Earliest deadline first within a class, then FIFO
+        requests = [batch, late, early, no_deadline]
+        scheduled, to_pause = scheduler.schedule_requests(requests)
+        self.assertEqual(scheduled, [early, late])
+        # The batch request is preempted for the interactive ones
+        self.assertEqual(to_pause, [batch])
+
+        scheduler.order_by_priority = False
+        scheduled, to_pause = scheduler.schedule_requests(requests)
+        self.assertEqual(scheduled, [batch, late])
+        self.assertEqual(to_pause, [])
+
+    def test_prefix_affinity(self):
+        manager = self.create_manager(blocks=32, enable_block_reuse=True)
+        scheduler = BatchScheduler(max_batch_size=8,
+                                   kv_cache_manager=manager,
+                                   prefix_affinity=True)
+        prefix = list(range(8))
+        first = LlmRequest(0, prefix + [100, 101], max_new_tokens=4)
+        sibling = LlmRequest(1, prefix + [200, 201], max_new_tokens=4)
+        other = LlmRequest(2, list(range(50, 60)), max_new_tokens=4)
+
+        # The sibling waits for the context blocks of the first request
+        scheduled, _ = scheduler.schedule_requests([first, sibling, other])
+        self.assertEqual(scheduled, [first, other])
+        self.run_context(manager, first)
+        self.run_context(manager, other)
+        scheduled, _ = scheduler.schedule_requests([first, other, sibling])
+        self.assertEqual(scheduled, [first, other, sibling])
+        self.assertEqual(self.start(manager, sibling), 8)
+        self.assertEqual(sibling.prefix_wait_iterations, 1)
+
+        # Requests hitting the same cached prefix are grouped
+        hit = LlmRequest(3, prefix + [300], max_new_tokens=4)
+        miss = LlmRequest(4, list(range(70, 80)), max_new_tokens=4)
+        other_hit = LlmRequest(5, prefix + [400], max_new_tokens=4)
+        scheduled, _ = scheduler.schedule_requests(
+            [first, other, hit, miss, other_hit])
+        self.assertEqual(scheduled, [first, other, hit, other_hit, miss])
+
+        # Waiting is bounded
+        scheduler.max_prefix_wait_iterations = 0
+        late = LlmRequest(6, list(range(90, 100)), max_new_tokens=4)
+        late_sibling = LlmRequest(7, list(range(90, 100)), max_new_tokens=4)
+        scheduled, _ = scheduler.schedule_requests([late, late_sibling])
+        self.assertEqual(scheduled, [late, late_sibling])
+
+    def test_schedule_next_requests(self):
+        manager = self.create_manager(blocks=32)
+        scheduler = BatchScheduler(max_batch_size=4,
+                                   kv_cache_manager=manager,
+                                   context_chunk_size=8,
+                                   max_num_tokens=10)
+        generation = LlmRequest(0, list(range(6)), max_new_tokens=8)
+        self.run_context(manager, generation)
+        context = LlmRequest(1, list(range(20)), max_new_tokens=8)
+        requests = [generation, context]
+        running, _ = scheduler.schedule_requests(requests)
+        self.assertEqual(running, [generation, context])
+        self.start(manager, context)
+
+        # Scheduled while the first chunk runs, as if it had run
+        next_iteration = scheduler.schedule_next_requests(requests, running)
+        self.assertEqual(context.context_current_position, 0)
+        self.assertEqual(context.context_chunk_size, 8)
+        context.move_to_next_context_chunk()
+        scheduled, to_pause = scheduler.fix_up_next_requests(
+            next_iteration, finished=[])
+        self.assertEqual(scheduled, [generation, context])
+        self.assertEqual(to_pause, [])
+        self.assertEqual(context.context_current_position, 8)
+        self.assertEqual(context.context_chunk_size, 8)
+
+        # Finished requests are dropped
+        next_iteration = scheduler.schedule_next_requests(requests, scheduled)
+        context.move_to_next_context_chunk()
+        scheduled, _ = scheduler.fix_up_next_requests(next_iteration,
+                                                      finished=[generation])
+        self.assertEqual(scheduled, [context])
+        self.assertTrue(context.is_last_context_chunk())
+        self.assertEqual(context.context_chunk_size, 4)
+
+
+if __name__ == '__main__':
+    unittest.main()
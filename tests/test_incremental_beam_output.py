@@ -0,0 +1,90 @@
+# SPDX-FileCopyrightText: Copyright (c) 2022-2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+import unittest
+
+import torch
+
+from tensorrt_llm.runtime.generation import _IncrementalBeamOutput
+
+
+class TestIncrementalBeamOutput(unittest.TestCase):
+
+    def gather_beams(self, output_ids, parent_ids, context_length, step):
+        # Traces the beams back through their parents, as gather_tree does
+        beam_width = output_ids.size(0)
+        beams = []
+        for beam in range(beam_width):
+            tokens = []
+            for position in range(context_length + step, context_length - 1,
+                                  -1):
+                tokens.append(int(output_ids[beam, position]))
+                beam = int(parent_ids[beam, position])
+            beams.append(output_ids[0, :context_length].tolist() +
+                         tokens[::-1])
+        return beams
+
+    def test_incremental_beam_output(self):
+        torch.manual_seed(0)
+        batch_size, beam_width, max_seq_length = 3, 3, 24
+        context_lengths = torch.tensor([2, 4, 3])
+        output_ids = torch.zeros(batch_size,
+                                 beam_width,
+                                 max_seq_length,
+                                 dtype=torch.int32)
+        for bi in range(batch_size):
+            output_ids[bi, :, :context_lengths[bi]] = torch.arange(
+                context_lengths[bi])
+        parent_ids = torch.zeros_like(output_ids)
+        finished = torch.zeros(batch_size * beam_width, dtype=torch.uint8)
+        output = _IncrementalBeamOutput(output_ids, context_lengths,
+                                        batch_size, beam_width)
+
+        streamed = [context_lengths[bi].item() for bi in range(batch_size)]
+        streamed = [
+            output_ids[bi, 0, :streamed[bi]].tolist()
+            for bi in range(batch_size)
+        ]
+        for step in range(16):
+            for bi in range(batch_size):
+                position = context_lengths[bi] + step
+                # Few tokens and mostly the first parent, so beams converge
+                output_ids[bi, :, position] = torch.randint(
+                    2, (beam_width, ), dtype=torch.int32)
+                parent_ids[bi, :, position] = torch.randint(
+                    beam_width, (beam_width, ),
+                    dtype=torch.int32) * torch.randint(
+                        2, (beam_width, ), dtype=torch.int32)
+                if step == 0:
+                    parent_ids[bi, :, position] = 0
+            stable_ids = output.update(step, output_ids, parent_ids, finished,
+                                       None)
+            for bi in range(batch_size):
+                streamed[bi] += stable_ids[bi].tolist()
+                beams = self.gather_beams(output_ids[bi], parent_ids[bi],
+                                          context_lengths[bi].item(), step)
+                common_length = 0
+                while common_length < len(beams[0]) and all(
+                        beam[common_length] == beams[0][common_length]
+                        for beam in beams):
+                    common_length += 1
+                self.assertEqual(streamed[bi], beams[0][:common_length])
+                for beam in range(beam_width):
+                    self.assertEqual(
+                        output.histories[bi, beam, :len(beams[beam])].tolist(),
+                        beams[beam])
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -12,14 +12,22 @@
 # WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 # See the License for the specific language governing permissions and
 # limitations under the License.
+import os
+import tempfile
 import unittest
 
 import torch
 
 import tensorrt_llm
-from tensorrt_llm.runtime.kv_cache_manager import (Block, BlocksManager,
+from tensorrt_llm.runtime.kv_cache_manager import (Block, BlockPrefixTree,
+                                                   BlocksManager,
                                                    GenerationSequence,
-                                                   KVCacheManager)
+                                                   KVCacheArena,
+                                                   KVCacheManager,
+                                                   LFUEvictionPolicy)
+from tensorrt_llm.runtime.kv_cache_transceiver import (KVCacheTransceiver,
+                                                       _decode_metadata,
+                                                       _encode_cache_key)
 
 
 class TestKVCacheManager(unittest.TestCase):
@@ -347,6 +355,890 @@ class TestKVCacheManager(unittest.TestCase):
 
         check_amount_of_blocks(arrays[0][0][0][0], 2)
 
+    def test_kv_cache_manager_incremental_pointer_arrays(self):
+        blocks = 16
+        tokens_per_block = 4
+        memory_pool = torch.zeros(2,
+                                  blocks,
+                                  tokens_per_block,
+                                  8,
+                                  dtype=torch.float,
+                                  device='cuda')
+        manager = KVCacheManager(memory_pools=[memory_pool],
+                                 blocks=blocks,
+                                 tokens_per_block=tokens_per_block,
+                                 max_attention_window_size=16,
+                                 max_blocks_per_seq=4)
+        manager.add_sequence(GenerationSequence(seq_idx=0, batch_idx=0), 3)
+        manager.add_sequence(GenerationSequence(seq_idx=1, batch_idx=1), 6)
+        manager.add_sequence(GenerationSequence(seq_idx=2, batch_idx=2), 8)
+
+        def update_pointer_arrays():
+            host_arrays = manager.get_pointer_arrays(beam_width=1)
+            # Rows to copy to the device, None for the whole arrays
+            dirty_rows = manager.device_dirty_rows
+            device_arrays = manager.get_device_pointer_arrays(beam_width=1)
+            expected = manager.blocks_manager.get_pointer_array(0,
+                                                                beam_width=1)
+            self.assertTrue(torch.equal(host_arrays[0], expected))
+            self.assertTrue(torch.equal(device_arrays[0].cpu(), expected))
+            return dirty_rows
+
+        self.assertIsNone(update_pointer_arrays())
+
+        # Only sequences crossing a block boundary are rewritten
+        manager.step([False, False, False])
+        self.assertEqual(update_pointer_arrays(), {2})
+        manager.step([False, False, False])
+        self.assertEqual(update_pointer_arrays(), {0})
+        manager.step([False, False, False])
+        self.assertEqual(update_pointer_arrays(), {1})
+        manager.step([False, False, False])
+        self.assertEqual(update_pointer_arrays(), set())
+
+        # Rows are remapped when a sequence finishes
+        manager.step([False, True, False])
+        self.assertIsNone(update_pointer_arrays())
+
+    def test_kv_cache_manager_attention_window_per_pool(self):
+        tokens_per_block = 4
+        # A global attention layer followed by a local attention layer
+        global_pool = torch.zeros(2,
+                                  8,
+                                  tokens_per_block,
+                                  8,
+                                  dtype=torch.float,
+                                  device='cuda')
+        local_pool = torch.zeros(2,
+                                 4,
+                                 tokens_per_block,
+                                 8,
+                                 dtype=torch.float,
+                                 device='cuda')
+        manager = KVCacheManager(memory_pools=[global_pool, local_pool],
+                                 blocks=[8, 4],
+                                 tokens_per_block=tokens_per_block,
+                                 max_attention_window_size=[16, 8],
+                                 max_blocks_per_seq=4)
+        self.assertEqual(manager.attention_window_sizes, [16, 8])
+        self.assertEqual(manager.get_needed_blocks_to_completion(6, 10),
+                         [4, 2])
+        manager.add_sequence(GenerationSequence(seq_idx=0, batch_idx=0), 6)
+        manager.add_sequence(GenerationSequence(seq_idx=1, batch_idx=1), 10)
+        global_manager, local_manager = manager.blocks_managers
+        self.assertEqual(global_manager.num_free_blocks(), 3)
+        self.assertEqual(local_manager.num_free_blocks(), 0)
+
+        # The engine has one max_blocks_per_seq dimension for all layers, the
+        # pointers of the local layer are padded to it
+        arrays = manager.get_pointer_arrays(beam_width=1)
+        self.assertEqual(tuple(arrays[0].shape), (2, 1, 2, 4))
+        self.assertEqual(tuple(arrays[1].shape), (2, 1, 2, 4))
+        self.assertTrue(torch.all(arrays[1][:, :, :, :2] != 0))
+        self.assertTrue(torch.all(arrays[1][:, :, :, 2:] == 0))
+
+        # Only the global layer gets new blocks past the local window
+        self.assertEqual(manager.get_needed_blocks_one_step(), [0, 0])
+        manager.step([False, False])
+        self.assertEqual(manager.get_needed_blocks_one_step(), [0, 0])
+        manager.step([False, False])
+        self.assertEqual(manager.get_needed_blocks_one_step(), [2, 0])
+        manager.step([False, False])
+        self.assertEqual(global_manager.num_free_blocks(), 1)
+        self.assertEqual(local_manager.num_free_blocks(), 0)
+        self.assertEqual(manager.get_kv_cache_stats().free_num_blocks, 1)
+
+        manager.step([True, True])
+        self.assertEqual(global_manager.num_free_blocks(), 8)
+        self.assertEqual(local_manager.num_free_blocks(), 4)
+
+    def test_kv_cache_manager_swap(self):
+        blocks = 8
+        tokens_per_block = 4
+        beam_width = 2
+        memory_pool = torch.rand(2,
+                                 blocks,
+                                 tokens_per_block,
+                                 8,
+                                 dtype=torch.float,
+                                 device='cuda')
+        manager = KVCacheManager(memory_pools=[memory_pool],
+                                 blocks=blocks,
+                                 tokens_per_block=tokens_per_block,
+                                 max_attention_window_size=16,
+                                 max_blocks_per_seq=4,
+                                 beam_width=beam_width,
+                                 swap_space_bytes=4 * 256)
+        first = GenerationSequence(seq_idx=0, batch_idx=0)
+        second = GenerationSequence(seq_idx=1, batch_idx=1)
+        manager.add_sequence(first, 4)
+        manager.add_sequence(second, 6)
+        manager.step([False, False])
+        blocks_manager = manager.blocks_manager
+        first_kv = [[
+            next(blocks_manager._block_views(block.idx))[0].clone()
+            for block in beam
+        ] for beam in blocks_manager.allocated_blocks[first]]
+        # A shared context block and one block per beam
+        self.assertEqual(manager.get_num_free_blocks(), [8 - 3 - 3])
+
+        manager.swap_out(first)
+        self.assertTrue(manager.is_swapped(first))
+        self.assertEqual(manager.sequences, [second])
+        self.assertEqual(second.get_batch_idx(), 0)
+        self.assertEqual(manager.get_num_free_blocks(), [5])
+        self.assertEqual(manager.get_needed_blocks_to_swap_in(first), [3])
+        # The blocks are copied to the swap space allocated at construction
+        self.assertEqual(manager.get_num_free_swap_blocks(), [1])
+        with self.assertRaises(RuntimeError):
+            manager.swap_out(second)
+
+        # Overwrite the freed blocks, the swapped KV must survive
+        memory_pool.copy_(torch.rand_like(memory_pool))
+        manager.swap_in(first)
+        self.assertFalse(manager.is_swapped(first))
+        self.assertEqual(manager.get_num_free_swap_blocks(), [4])
+        self.assertEqual(first.get_batch_idx(), 1)
+        self.assertEqual(manager.lens, [7, 5])
+        self.assertEqual(manager.get_num_free_blocks(), [2])
+        first_beams = blocks_manager.allocated_blocks[first]
+        self.assertIs(first_beams[0][0], first_beams[1][0])
+        self.assertIsNot(first_beams[0][1], first_beams[1][1])
+        for beam, beam_kv in zip(first_beams, first_kv):
+            for block, kv in zip(beam, beam_kv):
+                self.assertTrue(
+                    torch.equal(
+                        next(blocks_manager._block_views(block.idx))[0], kv))
+
+        manager.step([True, True])
+        self.assertEqual(manager.get_num_free_blocks(), [8])
+
+    def test_kv_cache_transceiver(self):
+        blocks = 8
+        tokens_per_block = 4
+
+        class LoopbackCommunicator(object):
+
+            def __init__(self):
+                self.messages = []
+
+            def send(self, tensor, rank):
+                self.messages.append((rank, tensor.clone()))
+
+            def recv(self, tensor, rank):
+                _, message = self.messages.pop(0)
+                tensor.copy_(message)
+
+        def create_manager():
+            memory_pool = torch.rand(2,
+                                     blocks,
+                                     tokens_per_block,
+                                     8,
+                                     dtype=torch.float,
+                                     device='cuda')
+            return KVCacheManager(memory_pools=[memory_pool],
+                                  blocks=blocks,
+                                  tokens_per_block=tokens_per_block,
+                                  max_attention_window_size=16,
+                                  max_blocks_per_seq=4,
+                                  enable_block_reuse=True)
+
+        context_manager = create_manager()
+        generation_manager = create_manager()
+        transceiver = KVCacheTransceiver(LoopbackCommunicator())
+
+        sequence = GenerationSequence(seq_idx=0, batch_idx=0)
+        context_manager.add_sequence(sequence,
+                                     10,
+                                     input_ids=list(range(10)),
+                                     cache_key=('lora', 3))
+        blocks_manager = context_manager.blocks_manager
+        kv = [
+            next(blocks_manager._block_views(block.idx))[0].clone()
+            for block in blocks_manager.allocated_blocks[sequence][0]
+        ]
+
+        transceiver.send_sequence(context_manager, sequence, rank=1)
+        self.assertEqual(context_manager.sequences, [])
+        self.assertEqual(context_manager.get_num_free_blocks(), [8])
+        self.assertTrue(
+            all(rank == 1 for rank, _ in transceiver.communicator.messages))
+
+        decoded = GenerationSequence(seq_idx=0, batch_idx=0)
+        transceiver.recv_sequence(generation_manager, decoded, rank=0)
+        self.assertEqual(transceiver.communicator.messages, [])
+        self.assertEqual(generation_manager.lens, [10])
+        self.assertEqual(generation_manager.cache_keys, [('lora', 3)])
+        self.assertEqual(generation_manager.get_num_free_blocks(), [5])
+        blocks_manager = generation_manager.blocks_manager
+        for block, block_kv in zip(blocks_manager.allocated_blocks[decoded][0],
+                                   kv):
+            self.assertTrue(
+                torch.equal(
+                    next(blocks_manager._block_views(block.idx))[0],
+                    block_kv))
+
+        # The adopted context is reused like a locally computed one
+        generation_manager.step([True])
+        self.assertEqual(
+            generation_manager.get_num_cached_tokens(list(range(10)),
+                                                     cache_key=('lora', 3)),
+            10)
+
+        # The metadata of a peer is parsed, not unpickled
+        bad_dtype = (b'{"version": 1, "groups": [{"layout": [[0]], '
+                     b'"first_block_idx": 0, "blocks": [{"shape": [1, 2, 8], '
+                     b'"dtype": "object"}]}], "length": 4, "tokens": null, '
+                     b'"retention_priority": 0, "cache_key": null}')
+        for metadata in [b'\x80\x04K\x01.', b'[]', bad_dtype]:
+            with self.assertRaises(ValueError):
+                _decode_metadata(metadata)
+        with self.assertRaises(TypeError):
+            _encode_cache_key(object())
+
+    def test_kv_cache_arena(self):
+        tokens_per_block = 4
+        page_size_bytes = 1024
+        arena = KVCacheArena(num_pages=8,
+                             page_size_bytes=page_size_bytes,
+                             device='cuda')
+        small_pools = arena.add_model('small', [(torch.float16, 64)] * 2,
+                                      min_pages=2)
+        large_pools = arena.add_model('large', [(torch.float32, 64)],
+                                      max_pages=6)
+
+        def create_manager(memory_pools, name, enable_block_reuse=False):
+            return KVCacheManager(memory_pools=memory_pools,
+                                  blocks=arena.num_pages,
+                                  tokens_per_block=tokens_per_block,
+                                  max_attention_window_size=16,
+                                  max_blocks_per_seq=4,
+                                  enable_block_reuse=enable_block_reuse,
+                                  kv_cache_arena=arena,
+                                  model_name=name)
+
+        small = create_manager(small_pools, 'small', enable_block_reuse=True)
+        large = create_manager(large_pools, 'large')
+        self.assertEqual(small.get_num_free_blocks(), [8])
+        # The guaranteed pages of the small model are not available
+        self.assertEqual(large.get_num_free_blocks(), [6])
+
+        # Blocks of both models are pages of the arena
+        base = arena.buffer.data_ptr()
+        block = small.blocks_manager.all_blocks[3]
+        self.assertEqual(block.get_k_ptr(0), base + 3 * page_size_bytes)
+        self.assertEqual(block.get_v_ptr(0), block.get_k_ptr(0) + 64 * 2)
+        self.assertEqual(block.get_k_ptr(1), block.get_k_ptr(0) + 256)
+        block = large.blocks_manager.all_blocks[3]
+        self.assertEqual(block.get_k_ptr(0), base + 3 * page_size_bytes)
+        self.assertEqual(block.get_v_ptr(0), block.get_k_ptr(0) + 64 * 4)
+
+        sequence = GenerationSequence(seq_idx=0, batch_idx=0)
+        small.add_sequence(sequence, 10, input_ids=list(range(10)))
+        self.assertEqual(arena.num_held_pages['small'], 3)
+        self.assertEqual(large.get_num_free_blocks(), [5])
+
+        # Freed reusable blocks keep their pages until they are reclaimed
+        small.step([True])
+        self.assertEqual(arena.num_held_pages['small'], 3)
+        self.assertEqual(small.get_num_free_blocks(), [8])
+        self.assertEqual(large.get_num_free_blocks(), [6])
+        for seq_idx in range(2):
+            large.add_sequence(
+                GenerationSequence(seq_idx=seq_idx, batch_idx=seq_idx), 12)
+        self.assertEqual(arena.num_held_pages,
+                         {
+                             'small': 2,
+                             'large': 6
+                         })
+        self.assertEqual(small.blocks_manager.stats['evicted_blocks'], 1)
+        self.assertEqual(large.get_num_free_blocks(), [0])
+        self.assertEqual(small.get_num_free_blocks(), [2])
+
+        large.step([True, True])
+        self.assertEqual(len(arena.free_pages), 6)
+        self.assertEqual(small.get_num_free_blocks(), [8])
+
+    def test_block_prefix_tree(self):
+        tokens_per_block = 4
+        tree = BlockPrefixTree(tokens_per_block)
+        blocks = [Block(block_idx=i, k_ptrs=[0], v_ptrs=[0]) for i in range(6)]
+
+        def match(tokens):
+            nodes, num_matched = tree.match(tokens)
+            return [node.block for node in nodes], num_matched
+
+        # Two full blocks and one partial block
+        tree.insert(list(range(10)), blocks[:3])
+        self.assertEqual(match(list(range(10))), (blocks[:3], 10))
+        self.assertEqual(match(list(range(6))), (blocks[:2], 6))
+        self.assertEqual(match([0, 1, 2, 3, 4, 5, 6, 7, 8, 42]),
+                         (blocks[:3], 9))
+        self.assertEqual(match([42]), ([], 0))
+
+        # Sibling with the same first token
+        tree.insert([0, 1, 2, 3, 4, 42, 43, 44], [blocks[0], blocks[3]])
+        self.assertEqual(match([0, 1, 2, 3, 4, 42]),
+                         ([blocks[0], blocks[3]], 6))
+        self.assertEqual(match([0, 1, 2, 3, 4, 5, 6, 7]), (blocks[:2], 8))
+
+        # Removing a node removes its subtree
+        removed = tree.remove(blocks[0].node)
+        self.assertEqual(sorted(node.block.idx for node in removed),
+                         [0, 1, 2, 3])
+        self.assertTrue(all(b.node is None for b in blocks))
+        self.assertEqual(match(list(range(10))), ([], 0))
+
+    def test_kv_cache_manager_block_reuse(self):
+        blocks = 16
+        tokens_per_block = 4
+        dims_per_head = 8
+        memory_pool = torch.zeros(2,
+                                  blocks,
+                                  tokens_per_block,
+                                  dims_per_head,
+                                  dtype=torch.float,
+                                  device='cuda')
+        manager = KVCacheManager(memory_pools=[memory_pool],
+                                 blocks=blocks,
+                                 tokens_per_block=tokens_per_block,
+                                 max_attention_window_size=32,
+                                 max_blocks_per_seq=8,
+                                 enable_block_reuse=True)
+        prompt = list(range(10))
+        self.assertEqual(
+            manager.add_sequence(GenerationSequence(seq_idx=0, batch_idx=0),
+                                 len(prompt), prompt), 0)
+        memory_pool.copy_(torch.rand_like(memory_pool))
+        manager.step([True])
+        self.assertEqual(manager.blocks_manager.num_free_blocks(), blocks)
+
+        # Full blocks are shared, the partially matched block is copied
+        sequence = GenerationSequence(seq_idx=1, batch_idx=0)
+        self.assertEqual(
+            manager.add_sequence(sequence, 12, prompt[:9] + [42, 43, 44]), 9)
+        seq_blocks = manager.blocks_manager.allocated_blocks[sequence][0]
+        self.assertEqual([b.idx for b in seq_blocks[:2]], [0, 1])
+        self.assertNotEqual(seq_blocks[2].idx, 2)
+        self.assertTrue(
+            torch.equal(memory_pool[:, seq_blocks[2].idx],
+                        memory_pool[:, 2]))
+
+        # At least one context token is always computed
+        sequence = GenerationSequence(seq_idx=2, batch_idx=1)
+        self.assertEqual(manager.add_sequence(sequence, 8, prompt[:8]), 7)
+        self.assertEqual(manager.blocks_manager.allocated_blocks[sequence]
+                         [0][0].ref_count, 2)
+
+    def test_kv_cache_manager_block_reuse_cyclic(self):
+        blocks = 8
+        tokens_per_block = 4
+        memory_pool = torch.rand(2,
+                                 blocks,
+                                 tokens_per_block,
+                                 8,
+                                 dtype=torch.float,
+                                 device='cuda')
+        manager = KVCacheManager(memory_pools=[memory_pool],
+                                 blocks=blocks,
+                                 tokens_per_block=tokens_per_block,
+                                 max_attention_window_size=8,
+                                 max_blocks_per_seq=2,
+                                 enable_block_reuse=True)
+        prompt = list(range(6))
+        sequence = GenerationSequence(seq_idx=0, batch_idx=0)
+        manager.add_sequence(sequence, len(prompt), prompt)
+        manager.store_context_blocks(sequence)
+        seq_blocks = manager.blocks_manager.allocated_blocks[sequence][0]
+        published_block = seq_blocks[0]
+        published_kv = memory_pool[:, published_block.idx].clone()
+
+        # Writes wrapping around the cyclic kv cache fork the published block
+        manager.step([False])
+        manager.step([False])
+        self.assertIs(seq_blocks[0], published_block)
+        manager.step([False])
+        self.assertIsNot(seq_blocks[0], published_block)
+        self.assertTrue(
+            torch.equal(memory_pool[:, seq_blocks[0].idx], published_kv))
+        self.assertEqual(manager.get_num_cached_tokens(prompt), 4)
+
+    def test_kv_cache_manager_block_reuse_cache_key(self):
+        blocks = 12
+        tokens_per_block = 4
+        memory_pool = torch.zeros(2,
+                                  blocks,
+                                  tokens_per_block,
+                                  8,
+                                  dtype=torch.float,
+                                  device='cuda')
+        manager = KVCacheManager(memory_pools=[memory_pool],
+                                 blocks=blocks,
+                                 tokens_per_block=tokens_per_block,
+                                 max_attention_window_size=16,
+                                 max_blocks_per_seq=4,
+                                 enable_block_reuse=True)
+
+        def run(cache_key):
+            num_reused = manager.add_sequence(GenerationSequence(seq_idx=0,
+                                                                 batch_idx=0),
+                                              len(prompt),
+                                              prompt,
+                                              cache_key=cache_key)
+            manager.step([True])
+            return num_reused
+
+        # The same prompt run with different LoRA adapters does not share KV
+        prompt = list(range(9))
+        self.assertEqual(run(cache_key=('lora_0', None)), 0)
+        self.assertEqual(run(cache_key=('lora_1', None)), 0)
+        self.assertEqual(run(cache_key=None), 0)
+        self.assertEqual(run(cache_key=('lora_1', None)), 8)
+        self.assertEqual(run(cache_key=('lora_0', None)), 8)
+
+    def test_kv_cache_manager_persistent_prefix_cache(self):
+        blocks = 8
+        tokens_per_block = 4
+
+        def create_manager(fingerprint):
+            memory_pool = torch.zeros(2,
+                                      blocks,
+                                      tokens_per_block,
+                                      8,
+                                      dtype=torch.float,
+                                      device='cuda')
+            return KVCacheManager(memory_pools=[memory_pool],
+                                  blocks=blocks,
+                                  tokens_per_block=tokens_per_block,
+                                  max_attention_window_size=16,
+                                  max_blocks_per_seq=4,
+                                  enable_block_reuse=True,
+                                  prefix_cache_path=path,
+                                  model_fingerprint=fingerprint)
+
+        def add_sequence(manager, prompt, cache_key=None):
+            return manager.add_sequence(GenerationSequence(seq_idx=0,
+                                                           batch_idx=0),
+                                        len(prompt),
+                                        prompt,
+                                        cache_key=cache_key)
+
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            path = os.path.join(tmp_dir, 'prefix_cache.pt')
+            manager = create_manager('engine_0')
+            add_sequence(manager, list(range(9)))
+            manager.step([True])
+            add_sequence(manager, list(range(5)), cache_key=('lora_0', None))
+            manager.step([True])
+            pool = manager.blocks_manager.memory_pools[0]
+            pool.copy_(torch.rand_like(pool))
+            stored_block = manager.blocks_manager.prefix_tree.match(
+                list(range(4)))[0][0].block
+            stored_kv = [
+                kv.clone() for kv in next(
+                    manager.blocks_manager._block_views(stored_block.idx))
+            ]
+            manager.save_prefix_cache()
+
+            # A restarted manager finds the blocks of the previous run
+            manager = create_manager('engine_0')
+            self.assertEqual(manager.get_kv_cache_stats().free_num_blocks,
+                             blocks)
+            loaded_block = manager.blocks_manager.prefix_tree.match(
+                list(range(4)))[0][0].block
+            for kv, stored in zip(
+                    next(manager.blocks_manager._block_views(
+                        loaded_block.idx)), stored_kv):
+                self.assertTrue(torch.equal(kv, stored))
+            self.assertEqual(add_sequence(manager, list(range(10))), 9)
+            manager.step([True])
+            self.assertEqual(
+                add_sequence(manager,
+                             list(range(5)),
+                             cache_key=('lora_0', None)), 4)
+            manager.step([True])
+
+            # The cache of another engine is ignored
+            manager = create_manager('engine_1')
+            self.assertEqual(add_sequence(manager, list(range(10))), 0)
+
+    def test_kv_cache_manager_host_cache(self):
+        blocks = 4
+        tokens_per_block = 4
+        dims_per_head = 8
+        memory_pool = torch.zeros(2,
+                                  blocks,
+                                  tokens_per_block,
+                                  dims_per_head,
+                                  dtype=torch.float,
+                                  device='cuda')
+        block_size_bytes = 2 * tokens_per_block * dims_per_head * 4
+        manager = KVCacheManager(memory_pools=[memory_pool],
+                                 blocks=blocks,
+                                 tokens_per_block=tokens_per_block,
+                                 max_attention_window_size=16,
+                                 max_blocks_per_seq=4,
+                                 enable_block_reuse=True,
+                                 host_cache_size_bytes=4 * block_size_bytes)
+        prompt = list(range(9))
+        manager.add_sequence(GenerationSequence(seq_idx=0, batch_idx=0),
+                             len(prompt), prompt)
+        memory_pool.copy_(torch.rand_like(memory_pool))
+        reference = memory_pool[:, :2].clone()
+        manager.step([True])
+
+        # Evict all cached blocks from the device
+        other = GenerationSequence(seq_idx=1, batch_idx=0)
+        manager.add_sequence(other, 16, [100 + i for i in range(16)])
+        self.assertEqual(len(manager.blocks_manager.host_slots), 3)
+        manager.step([True])
+        torch.cuda.synchronize()
+
+        # Cached blocks are copied back from the host cache
+        sequence = GenerationSequence(seq_idx=2, batch_idx=0)
+        self.assertEqual(manager.add_sequence(sequence, 9, prompt), 8)
+        seq_blocks = manager.blocks_manager.allocated_blocks[sequence][0]
+        for i in range(2):
+            self.assertTrue(
+                torch.equal(memory_pool[:, seq_blocks[i].idx], reference[:,
+                                                                         i]))
+
+    def test_kv_cache_manager_eviction_policy(self):
+        blocks = 4
+        tokens_per_block = 4
+        memory_pool = torch.zeros(2,
+                                  blocks,
+                                  tokens_per_block,
+                                  8,
+                                  dtype=torch.float,
+                                  device='cuda')
+
+        def make_manager(eviction_policy=None):
+            return KVCacheManager(memory_pools=[memory_pool],
+                                  blocks=blocks,
+                                  tokens_per_block=tokens_per_block,
+                                  max_attention_window_size=16,
+                                  max_blocks_per_seq=4,
+                                  enable_block_reuse=True,
+                                  eviction_policy=eviction_policy)
+
+        def run(manager, prompt, retention_priority=0):
+            num_reused = manager.add_sequence(
+                GenerationSequence(seq_idx=0, batch_idx=0), len(prompt),
+                prompt, retention_priority)
+            manager.step([True])
+            return num_reused
+
+        prompt_a = [1, 2, 3, 4, 5]
+        prompt_b = [6, 7, 8, 9, 10]
+        new_prompt = list(range(100, 112))
+
+        # Higher retention priority outlives more recent use
+        manager = make_manager()
+        run(manager, prompt_b, retention_priority=1)
+        run(manager, prompt_a)
+        run(manager, new_prompt)
+        self.assertEqual(manager.get_kv_cache_stats().evicted_blocks, 3)
+        self.assertEqual(run(manager, prompt_b), 4)
+        self.assertEqual(manager.get_kv_cache_stats().free_num_blocks, blocks)
+
+        # LFU keeps the frequently reused prefix
+        manager = make_manager(LFUEvictionPolicy())
+        run(manager, prompt_a)
+        run(manager, prompt_a)
+        run(manager, prompt_b)
+        run(manager, new_prompt)
+        self.assertEqual(run(manager, prompt_a), 4)
+        self.assertEqual(manager.get_kv_cache_stats().reused_blocks, 2)
+
+    def test_kv_cache_manager_beam_copy_on_write(self):
+        blocks = 8
+        tokens_per_block = 4
+        memory_pool = torch.rand(2,
+                                 blocks,
+                                 tokens_per_block,
+                                 8,
+                                 dtype=torch.float,
+                                 device='cuda')
+        manager = KVCacheManager(memory_pools=[memory_pool],
+                                 blocks=blocks,
+                                 tokens_per_block=tokens_per_block,
+                                 max_attention_window_size=16,
+                                 max_blocks_per_seq=4,
+                                 beam_width=2)
+        sequence = GenerationSequence(seq_idx=0, batch_idx=0)
+        manager.add_sequence(sequence, 6)
+
+        # The partially filled context block is shared as well
+        beams_blocks = manager.blocks_manager.allocated_blocks[sequence]
+        self.assertEqual(beams_blocks[0], beams_blocks[1])
+        self.assertEqual(beams_blocks[0][1].ref_count, 2)
+        self.assertEqual(manager.get_kv_cache_stats().free_num_blocks,
+                         blocks - 2)
+
+        # The first generated token forks it, the last beam keeps the block
+        shared_block = beams_blocks[0][1]
+        manager.step([False])
+        self.assertIs(beams_blocks[0][0], beams_blocks[1][0])
+        self.assertIsNot(beams_blocks[0][1], shared_block)
+        self.assertIs(beams_blocks[1][1], shared_block)
+        self.assertEqual(shared_block.ref_count, 1)
+        self.assertTrue(
+            torch.equal(memory_pool[:, beams_blocks[0][1].idx],
+                        memory_pool[:, shared_block.idx]))
+
+        # Generated blocks are allocated per beam
+        manager.step([False])
+        manager.step([False])
+        self.assertIsNot(beams_blocks[0][2], beams_blocks[1][2])
+        self.assertEqual(manager.get_kv_cache_stats().free_num_blocks,
+                         blocks - 5)
+
+    def test_kv_cache_manager_block_cache_indirection(self):
+        blocks = 8
+        tokens_per_block = 4
+        num_kv_heads = 2
+        memory_pool = torch.rand(2,
+                                 blocks,
+                                 num_kv_heads,
+                                 tokens_per_block,
+                                 8,
+                                 dtype=torch.float,
+                                 device='cuda')
+        manager = KVCacheManager(memory_pools=[memory_pool],
+                                 blocks=blocks,
+                                 tokens_per_block=tokens_per_block,
+                                 max_attention_window_size=16,
+                                 max_blocks_per_seq=4,
+                                 beam_width=2,
+                                 block_cache_indirection=True,
+                                 num_kv_heads=num_kv_heads)
+        sequence = GenerationSequence(seq_idx=0, batch_idx=0)
+        manager.add_sequence(sequence, 4)
+        cache_indirection = torch.zeros(1,
+                                        2,
+                                        1 + tokens_per_block,
+                                        dtype=torch.int32,
+                                        device='cuda')
+
+        # The full context block stays shared by the beams
+        manager.rebase_cache_indirection(cache_indirection)
+        manager.step([False])
+        beams_blocks = manager.blocks_manager.allocated_blocks[sequence]
+        self.assertIs(beams_blocks[0][0], beams_blocks[1][0])
+        self.assertIsNot(beams_blocks[0][1], beams_blocks[1][1])
+        old_blocks = [beams_blocks[0][1], beams_blocks[1][1]]
+        for _ in range(3):
+            manager.step([False])
+
+        # Beam 0 mixes the tokens of both beams, beam 1 only has its own
+        cache_indirection[0] = torch.tensor([[1, 0, 1, 1, 0], [1, 1, 1, 1, 1]],
+                                            dtype=torch.int32)
+        manager.rebase_cache_indirection(cache_indirection)
+        beams_blocks = manager.blocks_manager.allocated_blocks[sequence]
+        self.assertIs(beams_blocks[0][0], beams_blocks[1][0])
+        self.assertIs(beams_blocks[1][1], old_blocks[1])
+        self.assertNotIn(beams_blocks[0][1], old_blocks)
+        self.assertEqual(old_blocks[0].ref_count, 0)
+        self.assertEqual(manager.get_kv_cache_stats().free_num_blocks,
+                         blocks - 3)
+        for token, src in enumerate([0, 1, 1, 0]):
+            self.assertTrue(
+                torch.equal(
+                    memory_pool[:, beams_blocks[0][1].idx, :, token],
+                    memory_pool[:, old_blocks[src].idx, :, token]))
+
+        # The beams read their own blocks again
+        self.assertTrue(
+            torch.equal(cache_indirection[0, :, 0],
+                        torch.tensor([0, 1], dtype=torch.int32,
+                                     device='cuda')))
+        self.assertTrue(
+            torch.equal(cache_indirection[0, 0],
+                        torch.zeros_like(cache_indirection[0, 0])))
+        manager.step([True])
+        self.assertEqual(manager.get_kv_cache_stats().free_num_blocks, blocks)
+
+    def test_kv_cache_manager_beam_lazy_fork(self):
+        blocks = 8
+        tokens_per_block = 4
+        memory_pool = torch.rand(2,
+                                 blocks,
+                                 tokens_per_block,
+                                 8,
+                                 dtype=torch.float,
+                                 device='cuda')
+        manager = KVCacheManager(memory_pools=[memory_pool],
+                                 blocks=blocks,
+                                 tokens_per_block=tokens_per_block,
+                                 max_attention_window_size=16,
+                                 max_blocks_per_seq=4,
+                                 beam_width=2)
+        sequence = GenerationSequence(seq_idx=0, batch_idx=0)
+        manager.add_sequence(sequence, 6)
+        beams_blocks = manager.blocks_manager.allocated_blocks[sequence]
+
+        # Beams writing the same tokens keep sharing their blocks, also the
+        # ones allocated in the generation phase
+        manager.step([False], [[7, 7]])
+        manager.step([False], [[3, 3]])
+        self.assertIs(beams_blocks[0][1], beams_blocks[1][1])
+        manager.step([False], [[4, 4]])
+        self.assertIs(beams_blocks[0][2], beams_blocks[1][2])
+        self.assertEqual(beams_blocks[0][2].ref_count, 2)
+        self.assertEqual(manager.get_kv_cache_stats().free_num_blocks,
+                         blocks - 3)
+
+        # The first divergent write forks the block being written only
+        shared_block = beams_blocks[0][2]
+        manager.step([False], [[1, 2]])
+        self.assertIs(beams_blocks[0][1], beams_blocks[1][1])
+        self.assertIsNot(beams_blocks[0][2], beams_blocks[1][2])
+        self.assertIs(beams_blocks[1][2], shared_block)
+        self.assertTrue(
+            torch.equal(memory_pool[:, beams_blocks[0][2].idx],
+                        memory_pool[:, shared_block.idx]))
+        self.assertEqual(manager.get_kv_cache_stats().free_num_blocks,
+                         blocks - 4)
+
+    def test_kv_cache_manager_sliding_window(self):
+        blocks = 8
+        tokens_per_block = 4
+        # The ring holds one block more than the window spans
+        max_blocks_per_seq = 3
+        memory_pool = torch.zeros(2,
+                                  blocks,
+                                  tokens_per_block,
+                                  8,
+                                  dtype=torch.float,
+                                  device='cuda')
+        manager = KVCacheManager(memory_pools=[memory_pool],
+                                 blocks=blocks,
+                                 tokens_per_block=tokens_per_block,
+                                 max_attention_window_size=8,
+                                 max_blocks_per_seq=max_blocks_per_seq,
+                                 enable_block_reuse=True,
+                                 enable_sliding_window=True)
+        prompt = list(range(6))
+        sequence = GenerationSequence(seq_idx=0, batch_idx=0)
+        manager.add_sequence(sequence, len(prompt), prompt)
+        seq_blocks = manager.blocks_manager.allocated_blocks[sequence][0]
+        first_block, second_block = seq_blocks
+
+        # Generate past the window, sequence holds at most 3 blocks
+        for _ in range(10):
+            manager.step([False])
+        self.assertEqual(manager.lens[0], 16)
+        self.assertEqual(manager.blocks_manager.get_number_blocks(sequence), 3)
+        self.assertEqual(manager.blocks_manager.first_block_idx[sequence], 1)
+        self.assertEqual(manager.get_kv_cache_stats().free_num_blocks,
+                         blocks - 3)
+
+        manager.step([False])
+        self.assertEqual(manager.blocks_manager.first_block_idx[sequence], 2)
+
+        # Block i of the sequence is at slot i % max_blocks_per_seq
+        arrays = manager.get_pointer_arrays(beam_width=1)
+        seq_blocks = manager.blocks_manager.allocated_blocks[sequence][0]
+        self.assertNotIn(second_block, seq_blocks)
+        for block_idx, block in enumerate(seq_blocks, start=2):
+            self.assertEqual(
+                arrays[0][0][0][0][block_idx % max_blocks_per_seq],
+                block.get_k_ptr(0))
+
+        # The released context blocks stay cached for reuse
+        manager.step([True])
+        self.assertEqual(manager.get_kv_cache_stats().free_num_blocks, blocks)
+        self.assertEqual(
+            manager.add_sequence(GenerationSequence(seq_idx=1, batch_idx=0),
+                                 len(prompt), prompt), 5)
+        seq_blocks = manager.blocks_manager.allocated_blocks[
+            manager.sequences[0]][0]
+        self.assertEqual(seq_blocks[0].idx, first_block.idx)
+        manager.step([True])
+
+        # Only the blocks of the last tokens of a long context are allocated
+        sequence = GenerationSequence(seq_idx=2, batch_idx=0)
+        manager.add_sequence(sequence, 21)
+        self.assertEqual(manager.lens[0], 21)
+        self.assertEqual(manager.blocks_manager.get_number_blocks(sequence), 3)
+        self.assertEqual(manager.blocks_manager.first_block_idx[sequence], 3)
+
+
+    def test_kv_cache_manager_large_blocks(self):
+        blocks = 8
+        tokens_per_block = 4
+        large_block_factor = 4
+        memory_pool = torch.zeros(2,
+                                  blocks,
+                                  tokens_per_block,
+                                  8,
+                                  dtype=torch.float,
+                                  device='cuda')
+
+        def create_manager():
+            return KVCacheManager(memory_pools=[memory_pool],
+                                  blocks=blocks,
+                                  tokens_per_block=tokens_per_block,
+                                  max_attention_window_size=32,
+                                  max_blocks_per_seq=8,
+                                  large_block_factor=large_block_factor)
+
+        def block_indices(manager, sequence):
+            return [
+                block.idx
+                for block in manager.blocks_manager.allocated_blocks[sequence]
+                [0]
+            ]
+
+        manager = create_manager()
+        # The 4 full context blocks are a large block, the last one is taken
+        # from the other run
+        first = GenerationSequence(seq_idx=0, batch_idx=0)
+        manager.add_sequence(first, 17)
+        self.assertEqual(block_indices(manager, first), [0, 1, 2, 3, 4])
+        self.assertEqual(manager.get_kv_cache_stats().large_blocks, 1)
+
+        # The blocks of a large block are contiguous
+        arrays = manager.get_pointer_arrays(beam_width=1)
+        block_bytes = memory_pool[0][0].nelement() * self._sizeof[
+            memory_pool.dtype]
+        for kv_idx in range(2):
+            for block_idx in range(1, large_block_factor):
+                self.assertEqual(
+                    arrays[0][0][0][kv_idx][block_idx] -
+                    arrays[0][0][0][kv_idx][block_idx - 1], block_bytes)
+
+        # Short contexts and generated tokens take single blocks from the
+        # broken run
+        second = GenerationSequence(seq_idx=1, batch_idx=1)
+        manager.add_sequence(second, 8)
+        self.assertEqual(block_indices(manager, second), [5, 6])
+        for _ in range(3):
+            manager.step([False, False])
+        self.assertEqual(block_indices(manager, second), [5, 6, 7])
+        self.assertEqual(manager.get_kv_cache_stats().free_num_blocks, 0)
+
+        # The run is whole again once the first sequence is released
+        manager.step([True, False])
+        third = GenerationSequence(seq_idx=2, batch_idx=1)
+        manager.add_sequence(third, 16)
+        self.assertEqual(block_indices(manager, third), [0, 1, 2, 3])
+        self.assertEqual(manager.get_kv_cache_stats().large_blocks, 2)
+
+        # Without a whole free run, full context blocks are single blocks
+        manager = create_manager()
+        sequences = [
+            GenerationSequence(seq_idx=idx, batch_idx=idx) for idx in range(3)
+        ]
+        for sequence, context_len in zip(sequences, [4, 12, 4]):
+            manager.add_sequence(sequence, context_len)
+        self.assertEqual(block_indices(manager, sequences[2]), [4])
+        manager.remove_sequence(sequences[1])
+        sequence = GenerationSequence(seq_idx=3, batch_idx=2)
+        manager.add_sequence(sequence, 16)
+        self.assertEqual(block_indices(manager, sequence), [5, 6, 7, 1])
+        self.assertEqual(manager.get_kv_cache_stats().large_blocks, 0)
 
 if __name__ == '__main__':
     unittest.main()